@@ -14,8 +14,10 @@ namespace fs = std::experimental::filesystem;
 #endif
 #include <syslog.h>
 #include <fstream>
+#include <future>
 #include <stdexcept>
 
+#include <fb303/ServiceData.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
@@ -75,6 +77,45 @@ namespace {
 //
 
 const std::string inet6Path = "/proc/net/if_inet6";
+
+/**
+ * Timings of the startup phases, from the start of main() to the ctrl server
+ * serving. Each phase is logged and exported as
+ * openr.startup.<phase>.duration_ms, along with openr.startup.total_ms once
+ * startup is complete.
+ */
+class StartupTimer {
+ public:
+  // end current phase, the next one starts
+  void
+  mark(std::string const& phase) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto durationMs = toMs(now - phaseStart_);
+    LOG(INFO) << "[Startup] " << phase << " took " << durationMs << "ms, "
+              << toMs(now - start_) << "ms since start";
+    facebook::fb303::fbData->setCounter(
+        folly::sformat("openr.startup.{}.duration_ms", phase), durationMs);
+    phaseStart_ = now;
+  }
+
+  void
+  done() {
+    const auto totalMs = toMs(std::chrono::steady_clock::now() - start_);
+    LOG(INFO) << "[Startup] Open/R started in " << totalMs << "ms";
+    facebook::fb303::fbData->setCounter("openr.startup.total_ms", totalMs);
+  }
+
+ private:
+  static int64_t
+  toMs(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+        .count();
+  }
+
+  const std::chrono::steady_clock::time_point start_{
+      std::chrono::steady_clock::now()};
+  std::chrono::steady_clock::time_point phaseStart_{start_};
+};
 } // namespace
 
 // Disable background jemalloc background thread => new jemalloc-5 feature
@@ -143,6 +184,7 @@ startEventBase(
     std::vector<std::thread>& allThreads,
     std::vector<std::unique_ptr<OpenrEventBase>>& orderedEvbs,
     Watchdog* watchdog,
+    std::shared_ptr<const Config> const& config,
     const std::string& name,
     std::unique_ptr<T> evbT) {
   CHECK(evbT);
@@ -152,9 +194,18 @@ startEventBase(
   evb->setEvbName(name);
 
   // Start a thread
-  allThreads.emplace_back(std::thread([evb = evb.get(), name]() noexcept {
+  auto threadConfig = config->getThreadConfig(name);
+  allThreads.emplace_back(std::thread([evb = evb.get(),
+                                       name,
+                                       threadConfig]() noexcept {
     LOG(INFO) << "Starting " << name << " thread ...";
-    folly::setThreadName(folly::sformat("openr-{}", name));
+    if (threadConfig.has_value()) {
+      folly::setThreadName(threadConfig->thread_name_ref().value_or(
+          folly::sformat("openr-{}", name)));
+      threading::setThreadAttributes(*threadConfig);
+    } else {
+      folly::setThreadName(folly::sformat("openr-{}", name));
+    }
     evb->run();
     LOG(INFO) << name << " thread got stopped.";
   }));
@@ -174,6 +225,8 @@ startEventBase(
 
 int
 main(int argc, char** argv) {
+  StartupTimer startupTimer;
+
   // Set version string to show when `openr --version` is invoked
   std::stringstream ss;
   BuildInfo::log(ss);
@@ -233,6 +286,13 @@ main(int argc, char** argv) {
   }
 
   SYSLOG(INFO) << config->getRunningConfig();
+  startupTimer.mark("config");
+
+  // Load persistent store from disk while the other modules are set up, it
+  // only depends on config
+  auto configStoreFuture = std::async(std::launch::async, [&config]() {
+    return std::make_unique<PersistentStore>(config);
+  });
 
   // Sanity checks on Segment Routing labels
   const int32_t maxLabel = Constants::kMaxSrLabel;
@@ -275,24 +335,40 @@ main(int argc, char** argv) {
   // Set main thread name
   folly::setThreadName("openr");
 
-  // Queue for inter-module communication
-  ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue;
-  ReplicateQueue<KvStoreSyncEvent> kvStoreSyncEventsQueue;
-  ReplicateQueue<InterfaceDatabase> interfaceUpdatesQueue;
-  ReplicateQueue<NeighborEvent> neighborUpdatesQueue;
-  ReplicateQueue<PrefixEvent> prefixUpdatesQueue;
-  ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue;
-  ReplicateQueue<PeerEvent> peerUpdatesQueue;
-  ReplicateQueue<DecisionRouteUpdate> staticRouteUpdatesQueue;
-  ReplicateQueue<DecisionRouteUpdate> fibUpdatesQueue;
-  ReplicateQueue<fbnl::NetlinkEvent> netlinkEventsQueue;
-  ReplicateQueue<LogSample> logSampleQueue;
+  // Queue for inter-module communication. Named queues export stats of their
+  // named readers.
+  auto queueName = [](std::string const& name) {
+    return FLAGS_enable_messaging_stats ? name : std::string();
+  };
+  ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue(
+      queueName("routeUpdatesQueue"));
+  ReplicateQueue<KvStoreSyncEvent> kvStoreSyncEventsQueue(
+      queueName("kvStoreSyncEventsQueue"));
+  ReplicateQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue(
+      queueName("interfaceUpdatesQueue"));
+  ReplicateQueue<NeighborEvent> neighborUpdatesQueue(
+      queueName("neighborUpdatesQueue"));
+  ReplicateQueue<PrefixEvent> prefixUpdatesQueue(
+      queueName("prefixUpdatesQueue"));
+  ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue(
+      queueName("kvStoreUpdatesQueue"));
+  ReplicateQueue<PeerEvent> peerUpdatesQueue(queueName("peerUpdatesQueue"));
+  ReplicateQueue<DecisionRouteUpdate> staticRouteUpdatesQueue(
+      queueName("staticRouteUpdatesQueue"));
+  ReplicateQueue<DecisionRouteUpdate> fibUpdatesQueue(
+      queueName("fibUpdatesQueue"));
+  ReplicateQueue<fbnl::NetlinkEvent> netlinkEventsQueue(
+      queueName("netlinkEventsQueue"));
+  ReplicateQueue<LogSample> logSampleQueue(queueName("logSampleQueue"));
 
   // Create the readers in the first place to make sure they can receive every
   // messages from the writer(s)
   auto decisionStaticRouteUpdatesQueueReader =
-      staticRouteUpdatesQueue.getReader();
-  auto fibStaticRouteUpdatesQueueReader = staticRouteUpdatesQueue.getReader();
+      staticRouteUpdatesQueue.getReader("decision");
+  auto fibStaticRouteUpdatesQueueReader =
+      staticRouteUpdatesQueue.getReader("fib");
+  // Fib may start well after Decision, while waiting for FibService
+  auto fibRouteUpdatesQueueReader = routeUpdatesQueue.getReader("fib");
 
   // structures to organize our modules
   std::vector<std::thread> allThreads;
@@ -305,6 +381,7 @@ main(int argc, char** argv) {
         allThreads,
         orderedEvbs,
         nullptr /* watchdog won't monitor itself */,
+        config,
         "watchdog",
         std::make_unique<Watchdog>(config));
   }
@@ -318,9 +395,16 @@ main(int argc, char** argv) {
   });
   mainEvb.waitUntilRunning();
 
+  // Only Fib needs FibService. Wait for it while the other modules start,
+  // they can discover neighbors and sync KvStore meanwhile
+  std::unique_ptr<std::thread> waitForFibServiceThread{nullptr};
   if (FLAGS_enable_fib_service_waiting and
       (not config->isNetlinkFibHandlerEnabled())) {
-    waitForFibService(mainEvb, *config->getConfig().fib_port_ref());
+    waitForFibServiceThread =
+        std::make_unique<std::thread>([&mainEvb, &config]() {
+          folly::setThreadName("openr-waitFibService");
+          waitForFibService(mainEvb, *config->getConfig().fib_port_ref());
+        });
   }
 
   std::shared_ptr<ThreadManager> thriftThreadMgr{nullptr};
@@ -333,11 +417,18 @@ main(int argc, char** argv) {
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "netlink",
       std::make_unique<OpenrEventBase>());
+  startupTimer.mark("netlink");
 
+  // LinkMonitor, the only reader of netlink events, handles link and address
+  // events only
   nlSock = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
-      nlEvb->getEvb(), netlinkEventsQueue);
+      nlEvb->getEvb(),
+      netlinkEventsQueue,
+      false /* enableIPv6RouteReplaceSemantics */,
+      openr::fbnl::kNetlinkLinkAddrEvents);
 
   // Start NetlinkFibHandler if specified
   if (config->isNetlinkFibHandlerEnabled()) {
@@ -355,10 +446,13 @@ main(int argc, char** argv) {
     netlinkFibServer->setCpp2WorkerThreadName("FibTWorker");
     netlinkFibServer->setPort(*config->getConfig().fib_port_ref());
 
-    netlinkFibServerThread =
-        std::make_unique<std::thread>([&netlinkFibServer, &nlSock]() {
+    const bool enableNexthopObjects =
+        *config->getConfig().enable_netlink_nexthop_objects_ref();
+    netlinkFibServerThread = std::make_unique<std::thread>(
+        [&netlinkFibServer, &nlSock, enableNexthopObjects]() {
           folly::setThreadName("openr-fibService");
-          auto fibHandler = std::make_shared<NetlinkFibHandler>(nlSock.get());
+          auto fibHandler = std::make_shared<NetlinkFibHandler>(
+              nlSock.get(), enableNexthopObjects);
           netlinkFibServer->setInterface(std::move(fibHandler));
 
           LOG(INFO) << "Starting NetlinkFib server...";
@@ -372,50 +466,58 @@ main(int argc, char** argv) {
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "config_store",
-      std::make_unique<PersistentStore>(config));
+      configStoreFuture.get());
+  startupTimer.mark("config_store");
 
   // Start monitor Module
   auto monitor = startEventBase(
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "monitor",
       std::make_unique<openr::Monitor>(
           config,
           Constants::kEventLogCategory.toString(),
-          logSampleQueue.getReader()));
+          logSampleQueue.getReader("monitor")));
+  startupTimer.mark("monitor");
 
   // Start KVStore
   auto kvStore = startEventBase(
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "kvstore",
       std::make_unique<KvStore>(
           context,
           kvStoreUpdatesQueue,
           kvStoreSyncEventsQueue,
-          peerUpdatesQueue.getReader(),
+          peerUpdatesQueue.getReader("kvstore"),
           logSampleQueue,
           KvStoreGlobalCmdUrl{folly::sformat(
               "tcp://{}:{}",
               *config->getConfig().listen_addr_ref(),
               FLAGS_kvstore_rep_port)},
           config));
+  startupTimer.mark("kvstore");
 
   auto prefixManager = startEventBase(
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "prefix_manager",
       std::make_unique<PrefixManager>(
           staticRouteUpdatesQueue,
-          prefixUpdatesQueue.getReader(),
-          routeUpdatesQueue.getReader(),
+          prefixUpdatesQueue.getReader("prefix_manager"),
+          routeUpdatesQueue.getReader("prefix_manager"),
           config,
           kvStore,
           initialPrefixHoldTime));
+  startupTimer.mark("prefix_manager");
 
   // Prefix Allocator to automatically allocate prefixes for nodes
   if (config->isPrefixAllocationEnabled()) {
@@ -423,6 +525,7 @@ main(int argc, char** argv) {
         allThreads,
         orderedEvbs,
         watchdog,
+        config,
         "prefix_allocator",
         std::make_unique<PrefixAllocator>(
             AreaId{*config->getAreaIds().begin()},
@@ -433,6 +536,7 @@ main(int argc, char** argv) {
             prefixUpdatesQueue,
             logSampleQueue,
             Constants::kPrefixAllocatorSyncInterval));
+    startupTimer.mark("prefix_allocator");
   }
 
   // Create Spark instance for neighbor discovery
@@ -440,20 +544,23 @@ main(int argc, char** argv) {
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "spark",
       std::make_unique<Spark>(
-          interfaceUpdatesQueue.getReader(),
+          interfaceUpdatesQueue.getReader("spark"),
           neighborUpdatesQueue,
           KvStoreCmdPort{static_cast<uint16_t>(FLAGS_kvstore_rep_port)},
           OpenrCtrlThriftPort{static_cast<uint16_t>(FLAGS_openr_ctrl_port)},
           std::make_shared<IoProvider>(),
           config));
+  startupTimer.mark("spark");
 
   // Create link monitor instance.
   auto linkMonitor = startEventBase(
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "link_monitor",
       std::make_unique<LinkMonitor>(
           config,
@@ -464,11 +571,12 @@ main(int argc, char** argv) {
           prefixUpdatesQueue,
           peerUpdatesQueue,
           logSampleQueue,
-          neighborUpdatesQueue.getReader(),
-          kvStoreSyncEventsQueue.getReader(),
-          netlinkEventsQueue.getReader(),
+          neighborUpdatesQueue.getReader("link_monitor"),
+          kvStoreSyncEventsQueue.getReader("link_monitor"),
+          netlinkEventsQueue.getReader("link_monitor"),
           FLAGS_override_drain_state,
           initialAdjHoldTime));
+  startupTimer.mark("link_monitor");
 
   // setup the SSL policy
   std::shared_ptr<wangle::SSLContextConfig> sslContext;
@@ -495,7 +603,7 @@ main(int argc, char** argv) {
   auto pluginArgs = PluginArgs{
       prefixUpdatesQueue,
       staticRouteUpdatesQueue,
-      routeUpdatesQueue.getReader(),
+      routeUpdatesQueue.getReader("plugin"),
       config,
       sslContext};
 
@@ -508,6 +616,7 @@ main(int argc, char** argv) {
   if (config->isVipServiceEnabled()) {
     vipPluginStart(pluginArgs);
   }
+  startupTimer.mark("plugins");
 
   // Wait for the above three modules to start and run before running
   // SPF in Decision module.  This is to make sure the Decision module
@@ -518,28 +627,40 @@ main(int argc, char** argv) {
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "decision",
       std::make_unique<Decision>(
           config,
           FLAGS_enable_bgp_route_programming,
-          kvStoreUpdatesQueue.getReader(),
+          kvStoreUpdatesQueue.getReader("decision"),
           std::move(decisionStaticRouteUpdatesQueueReader),
-          routeUpdatesQueue));
+          routeUpdatesQueue,
+          configStore));
+  startupTimer.mark("decision");
+
+  if (waitForFibServiceThread) {
+    waitForFibServiceThread->join();
+    waitForFibServiceThread.reset();
+    startupTimer.mark("wait_fib_service");
+  }
 
   // Define and start Fib Module
   auto fib = startEventBase(
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "fib",
       std::make_unique<Fib>(
           config,
           *config->getConfig().fib_port_ref(),
           std::chrono::seconds(3 * *sparkConf.keepalive_time_s_ref()),
-          routeUpdatesQueue.getReader(),
+          std::move(fibRouteUpdatesQueueReader),
           std::move(fibStaticRouteUpdatesQueueReader),
           fibUpdatesQueue,
-          logSampleQueue));
+          logSampleQueue,
+          configStore));
+  startupTimer.mark("fib");
 
   // Start OpenrCtrl thrift server
   auto thriftCtrlServer = std::make_unique<apache::thrift::ThriftServer>();
@@ -566,6 +687,7 @@ main(int argc, char** argv) {
       allThreads,
       orderedEvbs,
       watchdog,
+      config,
       "ctrl_evb",
       std::make_unique<OpenrEventBase>());
 
@@ -585,10 +707,13 @@ main(int argc, char** argv) {
 
   CHECK(ctrlHandler);
   thriftCtrlServer->setInterface(ctrlHandler);
-  thriftCtrlServer->setNumIOWorkerThreads(1);
-  // Intentionally kept this as (1). If you're changing to higher number please
-  // address thread safety for private member variables in OpenrCtrlHandler
-  thriftCtrlServer->setNumCPUWorkerThreads(1);
+  // OpenrCtrlHandler is thread safe. Reads served from module snapshots run
+  // on the CPU worker threads, other calls are forwarded to module event bases
+  const auto& thriftServerConfig = *config->getConfig().thrift_server_ref();
+  thriftCtrlServer->setNumIOWorkerThreads(
+      *thriftServerConfig.num_io_worker_threads_ref());
+  thriftCtrlServer->setNumCPUWorkerThreads(
+      *thriftServerConfig.num_cpu_worker_threads_ref());
   // Enable TOS reflection on the server socket
   thriftCtrlServer->setTosReflect(true);
 
@@ -607,6 +732,8 @@ main(int argc, char** argv) {
     }
     std::this_thread::yield();
   }
+  startupTimer.mark("ctrl_server");
+  startupTimer.done();
 
   // Wait for main eventbase to stop
   mainEvbThread.join();
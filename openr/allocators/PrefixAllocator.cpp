@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <fb303/ServiceData.h>
 #include <folly/Format.h>
 #include <folly/futures/Promise.h>
 
@@ -33,6 +34,12 @@ PrefixAllocator::PrefixAllocator(
     std::chrono::milliseconds syncInterval)
     : myNodeName_(config->getNodeName()),
       syncInterval_(syncInterval),
+      useRangeAllocatorBitmap_(
+          *config->getConfig().enable_range_allocator_bitmap_ref()),
+      enableFastReclaim_(
+          *config->getPrefixAllocationConfig().enable_fast_reclaim_ref()),
+      batchClaimHoldTime_(std::chrono::milliseconds(
+          *config->getPrefixAllocationConfig().batch_claim_hold_time_ms_ref())),
       setLoopbackAddress_(
           *config->getPrefixAllocationConfig().set_loopback_addr_ref()),
       overrideGlobalAddress_(
@@ -471,6 +478,51 @@ PrefixAllocator::getInitPrefixIndex() {
   return 0;
 }
 
+std::optional<uint32_t>
+PrefixAllocator::getPersistedPrefixIndex(
+    std::pair<uint32_t, uint32_t> const& range) {
+  CHECK(allocParams_.has_value());
+  auto maybeThriftAllocPrefix =
+      configStore_->loadThriftObj<thrift::AllocPrefix>(kConfigKey).get();
+  if (maybeThriftAllocPrefix.hasError()) {
+    return std::nullopt;
+  }
+  const auto seedPrefix =
+      toIPNetwork(*maybeThriftAllocPrefix->seedPrefix_ref());
+  const auto allocPrefixLen = *maybeThriftAllocPrefix->allocPrefixLen_ref();
+  const auto index = *maybeThriftAllocPrefix->allocPrefixIndex_ref();
+  if (seedPrefix != allocParams_->first or
+      allocPrefixLen != allocParams_->second or index < range.first or
+      index > range.second) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(index);
+}
+
+void
+PrefixAllocator::processAllocatedPrefixIndex(
+    std::optional<uint32_t> prefixIndex) {
+  if (prefixIndex.has_value() and allocStartTime_.has_value()) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - *allocStartTime_);
+    LOG(INFO) << "Allocated prefix index " << *prefixIndex << " in "
+              << elapsed.count() << "ms";
+    fb303::fbData->addStatValue(
+        "prefix_allocator.allocation_ms", elapsed.count(), fb303::AVG);
+    allocStartTime_.reset();
+  }
+  if (fastReclaimIndex_.has_value()) {
+    if (fastReclaimIndex_ != prefixIndex) {
+      LOG(WARNING) << "Re-claimed prefix index " << *fastReclaimIndex_
+                   << " is owned by another node";
+      fb303::fbData->addStatValue(
+          "prefix_allocator.fast_reclaim_conflict", 1, fb303::COUNT);
+    }
+    fastReclaimIndex_.reset();
+  }
+  applyMyPrefixIndex(prefixIndex);
+}
+
 void
 PrefixAllocator::startAllocation(
     std::optional<PrefixAllocationParams> const& allocParams,
@@ -509,7 +561,10 @@ PrefixAllocator::startAllocation(
       allocParams /* new params */);
 
   // Update local state
+  batchClaimTimer_.reset();
   rangeAllocator_.reset();
+  allocStartTime_.reset();
+  fastReclaimIndex_.reset();
   if (allocParams_) {
     applyMyPrefixIndex(std::nullopt); // Clear local state
   }
@@ -527,7 +582,7 @@ PrefixAllocator::startAllocation(
       Constants::kPrefixAllocMarker.toString(),
       kvStoreClient_.get(),
       [this](std::optional<uint32_t> newPrefixIndex) noexcept {
-        applyMyPrefixIndex(newPrefixIndex);
+        processAllocatedPrefixIndex(newPrefixIndex);
       },
       syncInterval_,
       // no need for randomness since "collision" is harmless
@@ -537,7 +592,9 @@ PrefixAllocator::startAllocation(
       [this](uint32_t allocIndex) noexcept -> bool {
         return checkE2eAllocIndex(allocIndex);
       },
-      Constants::kRangeAllocTtl);
+      Constants::kRangeAllocTtl,
+      // batch claims pick among free indices left by re-claimed ones
+      useRangeAllocatorBitmap_ or batchClaimHoldTime_.count() > 0);
 
   // start range allocation
   LOG(INFO) << "Starting prefix allocation with seed prefix: "
@@ -555,8 +612,36 @@ PrefixAllocator::startAllocation(
     endIndex -= 1;
   }
 
-  rangeAllocator_->startAllocator(
-      std::make_pair(startIndex, endIndex), getInitPrefixIndex());
+  const auto range = std::make_pair(startIndex, endIndex);
+  allocStartTime_ = std::chrono::steady_clock::now();
+  const auto persistedIndex = getPersistedPrefixIndex(range);
+
+  // Fast path: advertise persisted prefix index right away. RangeAllocator
+  // validates the claim and replaces it if another node owns the index.
+  if (enableFastReclaim_ and persistedIndex.has_value()) {
+    LOG(INFO) << "Re-claiming persisted prefix index " << *persistedIndex;
+    fb303::fbData->addStatValue(
+        "prefix_allocator.fast_reclaim", 1, fb303::COUNT);
+    fastReclaimIndex_ = persistedIndex;
+    applyMyPrefixIndex(persistedIndex);
+    rangeAllocator_->startAllocator(range, persistedIndex);
+    return;
+  }
+
+  // Batch contention resolution: hold back new claims so that indices
+  // persisted by rebooting nodes are claimed first
+  if (batchClaimHoldTime_.count() > 0 and not persistedIndex.has_value()) {
+    LOG(INFO) << "Deferring prefix index claim by "
+              << batchClaimHoldTime_.count() << "ms";
+    batchClaimTimer_ =
+        folly::AsyncTimeout::make(*getEvb(), [this, range]() noexcept {
+          rangeAllocator_->startAllocator(range, getInitPrefixIndex());
+        });
+    batchClaimTimer_->scheduleTimeout(batchClaimHoldTime_);
+    return;
+  }
+
+  rangeAllocator_->startAllocator(range, getInitPrefixIndex());
 }
 
 void
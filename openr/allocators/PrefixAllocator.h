@@ -112,6 +112,14 @@ class PrefixAllocator : public OpenrEventBase {
   // initialize my prefix
   uint32_t getInitPrefixIndex();
 
+  // persisted prefix index if it was allocated with current allocation
+  // parameters and lies within the allocation range
+  std::optional<uint32_t> getPersistedPrefixIndex(
+      std::pair<uint32_t, uint32_t> const& range);
+
+  // callback of RangeAllocator, records allocation latency
+  void processAllocatedPrefixIndex(std::optional<uint32_t> prefixIndex);
+
   // start allocating prefixes, can be called again with new prefix
   // or `std::nullopt` if seed prefix is no longer valid to withdraw
   // what we had before!
@@ -153,6 +161,15 @@ class PrefixAllocator : public OpenrEventBase {
   // Sync interval for range allocator
   const std::chrono::milliseconds syncInterval_;
 
+  // pick prefix index from a bitmap of free indices
+  const bool useRangeAllocatorBitmap_{false};
+
+  // re-claim persisted prefix index before confirmation through KvStore
+  const bool enableFastReclaim_{false};
+
+  // delay of claims of nodes without persisted prefix index, 0 if disabled
+  const std::chrono::milliseconds batchClaimHoldTime_{0};
+
   // hash node ID into prefix space
   const std::hash<std::string> hasher{};
 
@@ -203,6 +220,15 @@ class PrefixAllocator : public OpenrEventBase {
   // AsyncTimeout for prefix allocation retry
   std::unique_ptr<folly::AsyncTimeout> retryTimer_;
 
+  // AsyncTimeout for deferred claims in batch contention resolution
+  std::unique_ptr<folly::AsyncTimeout> batchClaimTimer_;
+
+  // start of the ongoing allocation, reset once an index is allocated
+  std::optional<std::chrono::steady_clock::time_point> allocStartTime_;
+
+  // prefix index re-claimed through the fast path, pending confirmation
+  std::optional<uint32_t> fastReclaimIndex_;
+
   /**
    * applyMyPrefix use this state to decide how to program address to kernel
    * boolean field means the address is beed applied or not.
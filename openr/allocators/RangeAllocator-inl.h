@@ -46,7 +46,8 @@ RangeAllocator<T>::RangeAllocator(
     const std::chrono::milliseconds maxBackoffDur /* = 2s */,
     const bool overrideOwner /* = true */,
     const std::function<bool(T)> checkValueInUseCb,
-    const std::chrono::milliseconds rangeAllocTtl)
+    const std::chrono::milliseconds rangeAllocTtl,
+    const bool useBitmap /* = false */)
     : nodeName_(nodeName),
       keyPrefix_(keyPrefix),
       kvStoreClient_(kvStoreClient),
@@ -56,7 +57,8 @@ RangeAllocator<T>::RangeAllocator(
       backoff_(minBackoffDur, maxBackoffDur),
       checkValueInUseCb_(std::move(checkValueInUseCb)),
       rangeAllocTtl_(rangeAllocTtl),
-      area_(area) {
+      area_(area),
+      useBitmap_(useBitmap) {
   timeout_ = folly::AsyncTimeout::make(
       *eventBase_->getEvb(), [this]() mutable noexcept {
         CHECK(allocateValue_.has_value());
@@ -272,6 +274,22 @@ RangeAllocator<T>::scheduleAllocate(const T seedVal) noexcept {
   CHECK(maybeKeyMap.has_value())
       << "Failed to dump keys with prefix: " << keyPrefix_
       << " from kvstore in area: " << area_.t;
+
+  if (useBitmap_ and allocRangeSize_ > 0 and
+      static_cast<uint64_t>(allocRangeSize_) <= kMaxBitmapRangeSize) {
+    const auto maybeVal = pickFreeValue(seedVal, *maybeKeyMap);
+    if (maybeVal.has_value()) {
+      newVal = maybeVal.value();
+    } else {
+      LOG(ERROR) << "All values are owned by higher originatorIds";
+    }
+
+    // Schedule timeout to allocate new value
+    allocateValue_ = newVal;
+    timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
+    return;
+  }
+
   const auto valOwners =
       folly::gen::from(*maybeKeyMap) |
       folly::gen::map([](std::pair<std::string, thrift::Value> const& kv) {
@@ -305,6 +323,65 @@ RangeAllocator<T>::scheduleAllocate(const T seedVal) noexcept {
   timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
 }
 
+template <typename T>
+std::optional<T>
+RangeAllocator<T>::pickFreeValue(
+    const T seedVal,
+    const std::unordered_map<std::string, thrift::Value>& keyMap) noexcept {
+  const uint64_t rangeSize = allocRangeSize_;
+  bitmap_.assign((rangeSize + 63) / 64, 0);
+  // bits past the end of the range are never free
+  if (rangeSize % 64) {
+    bitmap_.back() = ~0ULL << (rangeSize % 64);
+  }
+
+  for (const auto& kv : keyMap) {
+    const auto val =
+        details::binaryToPrimitive<T>(kv.second.value_ref().value());
+    if (val < allocRange_.first or val > allocRange_.second) {
+      continue;
+    }
+    // owned by lower originator and override is allowed
+    if (overrideOwner_ and nodeName_ >= *kv.second.originatorId_ref()) {
+      continue;
+    }
+    const uint64_t index = val - allocRange_.first;
+    bitmap_[index / 64] |= 1ULL << (index % 64);
+  }
+
+  uint64_t numFree{0};
+  for (const auto word : bitmap_) {
+    numFree += 64 - folly::popcount(word);
+  }
+
+  std::mt19937_64 gen(seedVal + folly::Random::rand64());
+  while (numFree > 0) {
+    // select the n-th free value of the range
+    auto n = std::uniform_int_distribution<uint64_t>(0, numFree - 1)(gen);
+    size_t i = 0;
+    for (;; ++i) {
+      const uint64_t wordFree = 64 - folly::popcount(bitmap_[i]);
+      if (n < wordFree) {
+        break;
+      }
+      n -= wordFree;
+    }
+    auto freeBits = ~bitmap_[i];
+    for (; n > 0; --n) {
+      freeBits &= freeBits - 1; // clear lowest free bit
+    }
+    const uint64_t bit = folly::findFirstSet(freeBits) - 1;
+    const T val = allocRange_.first + static_cast<T>(i * 64 + bit);
+    if (!checkValueInUseCb_ or !checkValueInUseCb_(val)) {
+      return val;
+    }
+    // in use by the application, never pick it again in this round
+    bitmap_[i] |= 1ULL << bit;
+    --numFree;
+  }
+  return std::nullopt;
+}
+
 template <typename T>
 void
 RangeAllocator<T>::keyValUpdated(
@@ -10,11 +10,14 @@
 #include <chrono>
 #include <random>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <folly/Format.h>
 #include <folly/Optional.h>
 #include <folly/Random.h>
 #include <folly/gen/Base.h>
+#include <folly/lang/Bits.h>
 
 #include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
@@ -45,6 +48,10 @@ class RangeAllocator {
    * owner with a lower ID knowingly. In some applications like Terragraph, we
    * don't want this to occur so existing allocated values are not stolen by
    * higher priority allocator instances joining later
+   * useBitmap: on retries, build a bitmap of values this node can not claim
+   * from the allocation keys in KvStore and pick the next value uniformly
+   * among the free ones, instead of probing linearly from a random value.
+   * Ranges larger than kMaxBitmapRangeSize always use linear probing.
    */
   RangeAllocator(
       AreaId const& area,
@@ -58,7 +65,8 @@ class RangeAllocator {
       const bool overrideOwner = true,
       const std::function<bool(T)> checkValueInUseCb = nullptr,
       const std::chrono::milliseconds rangeAllocTtl =
-          Constants::kRangeAllocTtl);
+          Constants::kRangeAllocTtl,
+      const bool useBitmap = false);
 
   /**
    * user must call this to start allocation
@@ -89,6 +97,9 @@ class RangeAllocator {
   // check if the whole range has been allocated
   bool isRangeConsumed() const;
 
+  // upper bound of range size for bitmap based allocation (2MB bitmap)
+  static constexpr uint64_t kMaxBitmapRangeSize{1ULL << 24};
+
  private:
   /**
    * Non-copyable and non-movable
@@ -111,6 +122,15 @@ class RangeAllocator {
    */
   void scheduleAllocate(const T seedVal) noexcept;
 
+  /**
+   * Pick a random value among those not claimed by other owners, based on
+   * a bitmap of the range built from the allocation keys in KvStore. Returns
+   * std::nullopt if no value can be owned.
+   */
+  std::optional<T> pickFreeValue(
+      const T seedVal,
+      const std::unordered_map<std::string, thrift::Value>& keyMap) noexcept;
+
   /* Invoked whenever there is an update for our currently allocated value
    */
   void keyValUpdated(
@@ -179,6 +199,13 @@ class RangeAllocator {
 
   // area ID
   const AreaId area_{};
+
+  // pick values from a bitmap of the range instead of linear probing
+  const bool useBitmap_{false};
+
+  // one bit per value of the range, set if the value can not be owned.
+  // Kept across allocation rounds to reuse its storage.
+  std::vector<uint64_t> bitmap_;
 };
 
 } // namespace openr
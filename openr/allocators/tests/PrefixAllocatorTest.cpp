@@ -719,6 +719,53 @@ TEST_F(PrefixAllocatorFixture, UpdateAllocation) {
       [&]() { kvStoreClient_->unsubscribeKeyFilter(); });
 }
 
+/**
+ * Verify that with fast re-claim the prefix index persisted by the previous
+ * incarnation is applied right away and confirmed through KvStore later.
+ */
+TEST_F(PrefixAllocatorFixture, FastReclaim) {
+  SetUp(thrift::PrefixAllocationMode::DYNAMIC_LEAF_NODE);
+  const uint32_t persistedIndex = 5;
+
+  // Stop prefix allocator and persist allocation of previous incarnation
+  prefixAllocator_->stop();
+  prefixAllocator_->waitUntilStopped();
+  prefixAllocator_.reset();
+
+  thrift::AllocPrefix thriftAllocPrefix;
+  thriftAllocPrefix.seedPrefix_ref() = toIpPrefix("10.1.0.0/16");
+  thriftAllocPrefix.allocPrefixLen_ref() = 24;
+  thriftAllocPrefix.allocPrefixIndex_ref() = persistedIndex;
+  configStore_->storeThriftObj("prefix-allocator-config", thriftAllocPrefix)
+      .get();
+
+  auto tConfig = config_->getConfig();
+  tConfig.prefix_allocation_config_ref()->enable_fast_reclaim_ref() = true;
+  config_ = std::make_shared<Config>(tConfig);
+  createPrefixAllocator();
+
+  // Persisted allocation params are used as KvStore has no seed prefix.
+  // Index is applied without waiting for the allocation handshake.
+  while (prefixAllocator_->getMyPrefixIndex() != persistedIndex) {
+    std::this_thread::yield();
+  }
+
+  // Claim gets confirmed in KvStore
+  const auto key = folly::sformat(
+      "{}{}", Constants::kPrefixAllocMarker.toString(), persistedIndex);
+  while (true) {
+    std::optional<thrift::Value> value;
+    evb_.getEvb()->runInEventBaseThreadAndWait(
+        [&]() { value = kvStoreClient_->getKey(kTestingAreaName, key); });
+    if (value.has_value()) {
+      EXPECT_EQ(myNodeName_, *value->originatorId_ref());
+      break;
+    }
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(persistedIndex, prefixAllocator_->getMyPrefixIndex());
+}
+
 /**
  * The following test allocates a prefix based on the allocParams, then
  * static allocation key is inserted with the prefix that's allocated.
@@ -112,7 +112,8 @@ class RangeAllocatorFixture : public ::testing::TestWithParam<bool> {
       const std::optional<std::vector<T>> maybeInitVals,
       std::function<void(int /* client id */, std::optional<T>)> callback,
       const std::chrono::milliseconds rangeAllocTtl =
-          Constants::kRangeAllocTtl) {
+          Constants::kRangeAllocTtl,
+      const bool useBitmap = false) {
     // sanity check
     if (maybeInitVals) {
       CHECK_EQ(clients.size(), maybeInitVals->size());
@@ -133,7 +134,8 @@ class RangeAllocatorFixture : public ::testing::TestWithParam<bool> {
           100ms /* max backoff */,
           overrideOwner /* override allowed */,
           nullptr,
-          rangeAllocTtl);
+          rangeAllocTtl,
+          useBitmap);
       // start allocator
       allocator->startAllocator(
           allocRange,
@@ -276,6 +278,59 @@ TEST_P(RangeAllocatorFixture, NoSeed) {
   }
 }
 
+/**
+ * Run all allocators with same seed value in bitmap mode, with a range that
+ * has exactly one value per allocator. Every allocator must end up with a
+ * distinct value.
+ */
+TEST_P(RangeAllocatorFixture, NoSeedBitmap) {
+  const uint64_t start = 61;
+  const uint64_t end = start + kNumClients - 1; // Range is inclusive
+
+  folly::Baton waitBaton;
+  bool isPost = false;
+  std::map<int /* client id */, uint64_t /* allocated value */> allocation;
+  auto allocators = createAllocators<uint64_t>(
+      {start, end},
+      std::nullopt,
+      [&](int clientId, std::optional<uint64_t> newVal) {
+        if (newVal) {
+          VLOG(1) << "client " << clientId << " got " << newVal.value();
+          ASSERT_GE(newVal.value(), start);
+          ASSERT_LE(newVal.value(), end);
+          allocation[clientId] = newVal.value();
+        } else {
+          VLOG(1) << "client " << clientId << " lost its previous value";
+          allocation.erase(clientId);
+        }
+
+        if (allocation.size() != kNumClients) {
+          return;
+        }
+        const auto allocatedVals = from(allocation) |
+            map([](std::pair<int, uint64_t> const& kv) { return kv.second; }) |
+            as<std::set<uint64_t>>();
+        if (allocatedVals.size() == kNumClients and not isPost) {
+          LOG(INFO) << "We got everything, stopping OpenrEventBase.";
+          isPost = true;
+          waitBaton.post();
+        }
+      },
+      Constants::kRangeAllocTtl,
+      true /* useBitmap */);
+
+  // Start the event loop and wait until it is finished execution.
+  evbThread = std::thread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  // Synchronization primitive
+  waitBaton.wait();
+
+  for (auto& allocator : allocators) {
+    allocator.reset();
+  }
+}
+
 /**
  * Run allocators with no seed but the range doesn't have enough allocation
  * space. In this case allocators with higher IDs will succeed and other
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/common/AdaptiveDebounce.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+AdaptiveDebounce::AdaptiveDebounce(
+    folly::EventBase* eventBase,
+    std::chrono::milliseconds minWindow,
+    std::chrono::milliseconds maxWindow,
+    TimeoutCallback callback)
+    : AsyncTimeout(eventBase),
+      minWindow_(minWindow),
+      maxWindow_(maxWindow),
+      callback_(std::move(callback)) {
+  CHECK(callback_);
+  CHECK_LE(minWindow_.count(), maxWindow_.count());
+}
+
+void
+AdaptiveDebounce::operator()() noexcept {
+  auto const now = std::chrono::steady_clock::now();
+  ++pending_.numEvents;
+
+  if (not isScheduled()) {
+    pendingSince_ = now;
+    pending_.immediate =
+        not lastEventTime_.has_value() or now - *lastEventTime_ >= maxWindow_;
+    window_ = pending_.immediate
+        ? std::chrono::milliseconds(0)
+        : std::min(std::max(minWindow_, lastCallbackCost_), maxWindow_);
+  } else {
+    // events keep coming, grow the window up to maxWindow
+    window_ = std::min(std::max(window_ * 2, minWindow_), maxWindow_);
+  }
+  lastEventTime_ = now;
+
+  // window is measured from the first event of the batch
+  auto const remaining = std::max(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          pendingSince_ + window_ - now),
+      std::chrono::milliseconds(0));
+  scheduleTimeout(remaining);
+}
+
+void
+AdaptiveDebounce::timeoutExpired() noexcept {
+  auto const start = std::chrono::steady_clock::now();
+  batch_ = pending_;
+  batch_.waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+      start - pendingSince_);
+  pending_ = Batch{};
+
+  callback_();
+
+  lastCallbackCost_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
+} // namespace openr
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include <folly/Function.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+namespace openr {
+
+/**
+ * Debounces events like AsyncDebounce, except the window adapts to the
+ * recent event rate and the cost of the callback instead of following a
+ * fixed backoff.
+ *
+ * - An event arriving after a quiet period of at least maxWindow, is
+ *   isolated and the callback runs on the next event loop iteration.
+ * - Otherwise the window starts at the larger of minWindow and the duration
+ *   of the last callback, so that back to back callbacks don't monopolize
+ *   the event base, and doubles with every further event.
+ * - No event waits more than maxWindow for the callback, regardless of the
+ *   rate of events.
+ */
+class AdaptiveDebounce final : private folly::AsyncTimeout {
+ public:
+  using TimeoutCallback = folly::Function<void(void)>;
+
+  // Describes the batch of events the callback is invoked for
+  struct Batch {
+    // number of events in the batch
+    size_t numEvents{0};
+    // time since the first event of the batch
+    std::chrono::milliseconds waited{0};
+    // whether the first event was isolated
+    bool immediate{false};
+  };
+
+  AdaptiveDebounce(
+      folly::EventBase* eventBase,
+      std::chrono::milliseconds minWindow,
+      std::chrono::milliseconds maxWindow,
+      TimeoutCallback callback);
+
+  ~AdaptiveDebounce() override = default;
+
+  /**
+   * Overload function operator. This method exposes debounced version of
+   * callback passed in.
+   */
+  void operator()() noexcept;
+
+  /**
+   * Batch being processed, valid within the callback
+   */
+  Batch const&
+  getBatch() const {
+    return batch_;
+  }
+
+  /**
+   * Duration of the last callback
+   */
+  std::chrono::milliseconds
+  getLastCallbackCost() const {
+    return lastCallbackCost_;
+  }
+
+ private:
+  void timeoutExpired() noexcept override;
+
+  const std::chrono::milliseconds minWindow_{0};
+  const std::chrono::milliseconds maxWindow_{0};
+  TimeoutCallback callback_{nullptr};
+
+  // current window, measured from the first event of the pending batch
+  std::chrono::milliseconds window_{0};
+  std::chrono::steady_clock::time_point pendingSince_;
+  std::optional<std::chrono::steady_clock::time_point> lastEventTime_;
+  std::chrono::milliseconds lastCallbackCost_{0};
+  Batch pending_;
+  Batch batch_;
+};
+
+} // namespace openr
@@ -40,9 +40,10 @@ constexpr int32_t Constants::kOpenrSupportedVersion;
 constexpr int32_t Constants::kOpenrVersion;
 constexpr int64_t Constants::kDefaultAdjWeight;
 constexpr int64_t Constants::kTtlInfinity;
+constexpr size_t Constants::kKvStoreSyncBuckets;
 constexpr size_t Constants::kMaxFullSyncPendingCountThreshold;
 constexpr size_t Constants::kNumTimeSeries;
-constexpr std::chrono::milliseconds Constants::kAdjacencyThrottleTimeout;
+constexpr size_t Constants::kTimerWheelSlots;
 constexpr std::chrono::milliseconds Constants::kFibInitialBackoff;
 constexpr std::chrono::milliseconds Constants::kFibMaxBackoff;
 constexpr std::chrono::milliseconds Constants::kFloodPendingPublication;
@@ -53,6 +54,7 @@ constexpr std::chrono::milliseconds Constants::kKvStoreClearThrottleTimeout;
 constexpr std::chrono::milliseconds Constants::kKvStoreSyncThrottleTimeout;
 constexpr std::chrono::milliseconds Constants::kLinkImmediateTimeout;
 constexpr std::chrono::milliseconds Constants::kLinkThrottleTimeout;
+constexpr std::chrono::milliseconds Constants::kNetlinkEventCoalesceWindow;
 constexpr std::chrono::milliseconds Constants::kLongPollReqHoldTime;
 constexpr std::chrono::milliseconds Constants::kMaxBackoff;
 constexpr std::chrono::milliseconds Constants::kMaxTtlUpdateInterval;
@@ -69,16 +71,20 @@ constexpr std::chrono::milliseconds Constants::kReadTimeout;
 constexpr std::chrono::milliseconds Constants::kServiceConnTimeout;
 constexpr std::chrono::milliseconds Constants::kServiceConnSSLTimeout;
 constexpr std::chrono::milliseconds Constants::kServiceProcTimeout;
+constexpr std::chrono::milliseconds Constants::kTimerWheelTick;
+constexpr std::chrono::milliseconds Constants::kTtlCountdownTick;
 constexpr std::chrono::milliseconds Constants::kTtlDecrement;
 constexpr std::chrono::milliseconds Constants::kTtlInfInterval;
 constexpr std::chrono::milliseconds Constants::kTtlThreshold;
 constexpr std::chrono::seconds Constants::kConvergenceMaxDuration;
 constexpr std::chrono::seconds Constants::kCounterSubmitInterval;
+constexpr std::chrono::seconds Constants::kDecisionFullRebuildInterval;
 constexpr std::chrono::seconds Constants::kKeepAliveIntvl;
 constexpr std::chrono::seconds Constants::kKeepAliveTime;
 constexpr std::chrono::seconds Constants::kMemoryThresholdTime;
 constexpr std::chrono::seconds Constants::kNetlinkSyncThrottleInterval;
 constexpr std::chrono::seconds Constants::kPlatformSyncInterval;
+constexpr std::chrono::seconds Constants::kInterfaceSafetySyncInterval;
 constexpr std::chrono::seconds Constants::kPlatformThriftIdleTimeout;
 constexpr std::chrono::seconds Constants::kStoreSyncInterval;
 constexpr std::chrono::seconds Constants::kThriftClientKeepAliveInterval;
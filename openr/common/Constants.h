@@ -72,9 +72,15 @@ class Constants {
   // default interval to publish to monitor
   static constexpr std::chrono::seconds kCounterSubmitInterval{5};
 
+  // interval to flush StatCounter values aggregated per thread into fb303
+  static constexpr std::chrono::seconds kStatCounterFlushInterval{1};
+
   // event log category
   static constexpr folly::StringPiece kEventLogCategory{"perfpipe_aquaman"};
 
+  // max number of pending event logs handed to the monitor backend at once
+  static constexpr size_t kMonitorMaxEventLogBatch{128};
+
   // ExponentialBackoff durations
   // Link-monitor, KvStore
   static constexpr std::chrono::milliseconds kInitialBackoff{64};
@@ -82,11 +88,23 @@ class Constants {
   // FIB, perhaps this could be removed and above used in time
   static constexpr std::chrono::milliseconds kFibInitialBackoff{8};
   static constexpr std::chrono::milliseconds kFibMaxBackoff{4096};
+  // Retries of a failed chunk of pipelined route programming before falling
+  // back to full FIB sync
+  static constexpr int32_t kFibChunkMaxRetries{2};
+  // Delay to persist digest of programmed routes for graceful restart, after
+  // routes were programmed. Batches digests of route updates in quick
+  // succession
+  static constexpr std::chrono::milliseconds kFibRouteDigestPersistDelay{
+      1000};
 
   // Persistent store specific
   static constexpr std::chrono::milliseconds kPersistentStoreInitialBackoff{
       100};
   static constexpr std::chrono::milliseconds kPersistentStoreMaxBackoff{5000};
+  // Size at which a log segment is sealed in log-structured mode
+  static constexpr size_t kPersistentStoreSegmentSize{1 << 20};
+  // Number of sealed log segments triggering compaction
+  static constexpr size_t kPersistentStoreMaxSegments{4};
 
   //
   // KvStore specific
@@ -101,6 +119,36 @@ class Constants {
   // kMaxBackoff to send the next sync request
   static constexpr size_t kMaxFullSyncPendingCountThreshold{32};
 
+  // Count of pending kvstore sync response the parallel sync limit starts
+  // with and doesn't go below when backing off
+  static constexpr size_t kMinFullSyncPendingCountThreshold{2};
+
+  // Full-syncs completing within this time increase the parallel sync limit,
+  // slower ones decrease it
+  static constexpr std::chrono::milliseconds kFullSyncTargetLatency{1000};
+
+  // Number of key-vals of a full-sync response merged per event loop
+  // iteration
+  static constexpr size_t kFullSyncMergeChunkSize{1024};
+
+  // Number of due keys expired per event loop iteration, and at most in a
+  // publication of expired keys
+  static constexpr size_t kTtlExpirySliceSize{1024};
+
+  // Number of buckets keys are hashed into for full-sync, see
+  // KvStoreBucketHashes
+  static constexpr size_t kKvStoreSyncBuckets{4096};
+
+  // Number of recent key changes logged for incremental full-sync, see
+  // KvStoreChangeLog
+  static constexpr size_t kKvStoreChangeLogSize{65536};
+
+  // Values sent to peers compressed need at least this many bytes of data
+  static constexpr size_t kKvStoreCompressValueMinSize{1024};
+
+  // Default interval of KvStore snapshots written for warm restart
+  static constexpr std::chrono::seconds kKvStoreSnapshotInterval{60};
+
   //
   // PrefixAllocator specific
 
@@ -119,6 +167,35 @@ class Constants {
   static constexpr folly::StringPiece kStaticPrefixAllocParamKey{
       "e2e-network-allocations"};
 
+  //
+  // Decision specific
+  //
+
+  // interval of the periodic full route rebuild, a safety net for topology
+  // changes handled by recomputing only the affected prefixes
+  static constexpr std::chrono::seconds kDecisionFullRebuildInterval{600};
+
+  // max number of pending KvStore publications processed in a single pass,
+  // followed by a single route rebuild
+  static constexpr size_t kDecisionMaxPublicationBatch{64};
+
+  // min number of values in a batch of publications to be deserialized in
+  // parallel, smaller batches don't pay off the hand-off to worker threads
+  static constexpr size_t kDecisionParallelDecodeMinValues{256};
+
+  // delay to persist the route db snapshot for warm start after routes
+  // changed, batches route changes in quick succession
+  static constexpr std::chrono::milliseconds kDecisionRouteDbPersistDelay{
+      5000};
+
+  // max age of a route db snapshot to warm start from. Snapshots are
+  // refreshed by every periodic full route rebuild
+  static constexpr std::chrono::seconds kDecisionRouteDbSnapshotMaxAge{1800};
+
+  // bound of the sum of UCMP next-hop weights of a route, so that weighted
+  // groups fit the hardware ECMP tables
+  static constexpr int32_t kUcmpMaxTotalWeight{128};
+
   //
   // LinkMonitor specific
   //
@@ -128,9 +205,16 @@ class Constants {
   static constexpr std::chrono::milliseconds kLinkThrottleTimeout{100};
   static constexpr std::chrono::milliseconds kLinkImmediateTimeout{1};
 
-  // Hold time to wait before advertising adjacency UP event to KvStore.
-  // Adjacency DOWN event is immediately advertised.
-  static constexpr std::chrono::milliseconds kAdjacencyThrottleTimeout{1000};
+  // Window to coalesce bursts of LINK/ADDR events into their net change
+  static constexpr std::chrono::milliseconds kNetlinkEventCoalesceWindow{10};
+
+  // Window to batch KvStore peer events of neighbors coming up or going down
+  // together, e.g. upon a line card reload
+  static constexpr std::chrono::milliseconds kPeerEventCoalesceWindow{10};
+
+  // Min interval between full syncs of interfaces to Spark, updates are
+  // deltas of previous one in between
+  static constexpr std::chrono::seconds kInterfaceDbFullSyncInterval{60};
 
   // overloaded note metric value
   static constexpr uint64_t kOverloadNodeMetric{1ull << 32};
@@ -154,6 +238,13 @@ class Constants {
   // for the purpose of limiting the number of packets per second processed
   static constexpr size_t kNumTimeSeries{1024};
 
+  // Tick interval and number of slots of the timer wheel of each event base,
+  // driving per neighbor, peer or key timers. Timers fire at most one tick
+  // late, and timers beyond one rotation (~10s) wait extra rotations in
+  // their slot
+  static constexpr std::chrono::milliseconds kTimerWheelTick{10};
+  static constexpr size_t kTimerWheelSlots{1024};
+
   //
   // Platform/Fib specific
   //
@@ -170,6 +261,11 @@ class Constants {
   // time interval to sync between Open/R and Platform
   static constexpr std::chrono::seconds kPlatformSyncInterval{60};
 
+  // Interval of the safety full dump of links and addresses from netlink.
+  // Interface state is otherwise kept up to date from netlink events and only
+  // re-synced when events were lost.
+  static constexpr std::chrono::seconds kInterfaceSafetySyncInterval{900};
+
   // time interval for keep alive check between fib and switch agent
   static constexpr std::chrono::milliseconds kKeepAliveCheckInterval{1000};
 
@@ -202,6 +298,10 @@ class Constants {
   // Kvstore timer for flooding pending publication
   static constexpr std::chrono::milliseconds kFloodPendingPublication{100};
 
+  // KvStore floods in flight to a peer, further floods are batched until one
+  // is acked
+  static constexpr size_t kMaxPendingFloodsPerPeer{4};
+
   // KvStore database TTLs
   static constexpr std::chrono::milliseconds kKvStoreDbTtl{5min};
 
@@ -214,6 +314,11 @@ class Constants {
   // KvStore key markers
   static constexpr folly::StringPiece kAdjDbMarker{"adj:"};
   static constexpr folly::StringPiece kPrefixDbMarker{"prefix:"};
+  static constexpr folly::StringPiece kPrefixShardDbMarker{"prefixshard:"};
+  // upper bound of prefix db shards per area, see num_prefix_db_shards
+  static constexpr int32_t kMaxPrefixDbShards{65536};
+  // changed prefixes per chunk of a parallel PrefixManager KvStore sync
+  static constexpr size_t kPrefixSyncChunkSize{1024};
   static constexpr folly::StringPiece kPrefixAllocMarker{"allocprefix:"};
   static constexpr folly::StringPiece kNodeLabelRangePrefix{"nodeLabel:"};
 
@@ -225,11 +330,16 @@ class Constants {
 
   // max interval to update TTL for each key in kvstore w/ finite TTL
   static constexpr std::chrono::milliseconds kMaxTtlUpdateInterval{2h};
+  // max length of the epochs TTL updates are batched in. It is shortened to
+  // 1/8th of the TTL for keys with a short TTL
+  static constexpr std::chrono::milliseconds kTtlRefreshEpoch{1000};
   // TTL infinity, never expires
   // int version
   static constexpr int64_t kTtlInfinity{INT32_MIN};
   // ttl to decrement before re-flooding
   static constexpr std::chrono::milliseconds kTtlDecrement{1};
+  // resolution of the TTL count down of keys, see TtlCountdownWheel
+  static constexpr std::chrono::milliseconds kTtlCountdownTick{1};
   // min ttl expiry time to qualify for peer sync
   static constexpr std::chrono::milliseconds kTtlThreshold{500};
   // ms version
@@ -242,6 +352,18 @@ class Constants {
   static constexpr uint16_t kPerfBufferSize{10};
   static constexpr std::chrono::seconds kConvergenceMaxDuration{3s};
 
+  // stages of traced updates, see thrift::PerfSpan
+  static constexpr folly::StringPiece kPerfSpanKvStoreFlood{"KVSTORE_FLOOD"};
+  static constexpr folly::StringPiece kPerfSpanKvStoreUpdatesQueue{
+      "KVSTORE_UPDATES_QUEUE"};
+  static constexpr folly::StringPiece kPerfSpanDecisionDebounce{
+      "DECISION_DEBOUNCE"};
+  static constexpr folly::StringPiece kPerfSpanDecisionRouteBuild{
+      "DECISION_ROUTE_BUILD"};
+  static constexpr folly::StringPiece kPerfSpanRouteUpdatesQueue{
+      "ROUTE_UPDATES_QUEUE"};
+  static constexpr folly::StringPiece kPerfSpanFibProgram{"FIB_PROGRAM"};
+
   // hold time for longPoll requests in openrCtrl thrift server
   static constexpr std::chrono::milliseconds kLongPollReqHoldTime{20000};
 
@@ -288,6 +410,9 @@ class Constants {
 
   // Threshold time in secs to crash after reaching critical memory
   static constexpr std::chrono::seconds kMemoryThresholdTime{600};
+
+  // Interval to aggregate the pending samples of a running profiler
+  static constexpr std::chrono::seconds kProfilerDrainInterval{1};
 };
 
 } // namespace openr
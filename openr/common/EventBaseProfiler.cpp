@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/common/EventBaseProfiler.h"
+
+#include <algorithm>
+
+#include <fb303/ServiceData.h>
+#include <fmt/format.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+namespace {
+
+int64_t
+getPercentile(std::vector<int64_t> samples, double percentile) {
+  if (samples.empty()) {
+    return 0;
+  }
+  const size_t index = std::min(
+      samples.size() - 1, static_cast<size_t>(percentile * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples.at(index);
+}
+
+} // namespace
+
+void
+EventBaseProfiler::loopSample(int64_t busyTime, int64_t /* idleTime */) {
+  std::lock_guard<std::mutex> l(lock_);
+  if (loopSamples_.size() < kNumLoopSamples) {
+    loopSamples_.emplace_back(busyTime);
+  } else {
+    loopSamples_.at(nextLoopSample_) = busyTime;
+  }
+  nextLoopSample_ = (nextLoopSample_ + 1) % kNumLoopSamples;
+  maxLoopTimeUs_ = std::max(maxLoopTimeUs_, busyTime);
+}
+
+void
+EventBaseProfiler::recordCallback(
+    std::string const& name, std::chrono::microseconds duration) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto& callback = callbacks_[name];
+  *callback.count_ref() += 1;
+  *callback.total_us_ref() += duration.count();
+  callback.max_us_ref() = std::max(*callback.max_us_ref(), duration.count());
+}
+
+thrift::EventBaseProfile
+EventBaseProfiler::getProfile(
+    std::string const& evbName, size_t numSlowCallbacks) const {
+  thrift::EventBaseProfile profile;
+  profile.evb_name_ref() = evbName;
+
+  std::lock_guard<std::mutex> l(lock_);
+  profile.loop_time_p50_us_ref() = getPercentile(loopSamples_, 0.50);
+  profile.loop_time_p99_us_ref() = getPercentile(loopSamples_, 0.99);
+  profile.loop_time_max_us_ref() = maxLoopTimeUs_;
+
+  auto& slowCallbacks = *profile.slow_callbacks_ref();
+  for (auto const& [name, callback] : callbacks_) {
+    slowCallbacks.emplace_back(callback);
+    slowCallbacks.back().name_ref() = name;
+  }
+  std::sort(
+      slowCallbacks.begin(),
+      slowCallbacks.end(),
+      [](auto const& lhs, auto const& rhs) {
+        return *lhs.max_us_ref() > *rhs.max_us_ref();
+      });
+  if (slowCallbacks.size() > numSlowCallbacks) {
+    slowCallbacks.resize(numSlowCallbacks);
+  }
+  return profile;
+}
+
+void
+EventBaseProfiler::exportCounters(std::string const& evbName) const {
+  const auto profile = getProfile(evbName);
+  const auto prefix = fmt::format("evb.{}", evbName);
+
+  fb303::fbData->setCounter(
+      prefix + ".loop_time_us.p50", *profile.loop_time_p50_us_ref());
+  fb303::fbData->setCounter(
+      prefix + ".loop_time_us.p99", *profile.loop_time_p99_us_ref());
+  fb303::fbData->setCounter(
+      prefix + ".loop_time_us.max", *profile.loop_time_max_us_ref());
+  for (auto const& callback : *profile.slow_callbacks_ref()) {
+    const auto callbackPrefix =
+        fmt::format("{}.callback.{}", prefix, *callback.name_ref());
+    fb303::fbData->setCounter(
+        callbackPrefix + ".max_us", *callback.max_us_ref());
+    fb303::fbData->setCounter(
+        callbackPrefix + ".avg_us",
+        *callback.total_us_ref() / std::max<int64_t>(*callback.count_ref(), 1));
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/io/async/EventBase.h>
+
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+/**
+ * Profiler of an event base. Measures busy time of every loop iteration (via
+ * folly::EventBaseObserver) and execution time of named callbacks, i.e.
+ * timers, socket handlers and sections explicitly profiled by modules.
+ *
+ * Recording happens on the event base thread and only updates in-memory
+ * state. exportCounters() periodically publishes loop time percentiles and
+ * the slowest callbacks as fb303 counters under `evb.<evbName>.`. All methods
+ * are thread safe.
+ */
+class EventBaseProfiler final : public folly::EventBaseObserver {
+ public:
+  // number of recent loop iterations percentiles are computed over
+  static constexpr size_t kNumLoopSamples{1024};
+
+  // number of slowest callbacks reported
+  static constexpr size_t kNumSlowCallbacks{10};
+
+  //
+  // folly::EventBaseObserver
+  //
+
+  uint32_t
+  getSampleRate() const override {
+    return 1;
+  }
+
+  // busy and idle time of a loop iteration in microseconds
+  void loopSample(int64_t busyTime, int64_t idleTime) override;
+
+  // record execution time of named callback
+  void recordCallback(
+      std::string const& name, std::chrono::microseconds duration);
+
+  // loop time percentiles and slowest callbacks, slowest first
+  thrift::EventBaseProfile getProfile(
+      std::string const& evbName,
+      size_t numSlowCallbacks = kNumSlowCallbacks) const;
+
+  // export profile as fb303 counters
+  void exportCounters(std::string const& evbName) const;
+
+ private:
+  mutable std::mutex lock_;
+
+  // ring of busy times of recent loop iterations
+  std::vector<int64_t> loopSamples_;
+  size_t nextLoopSample_{0};
+  int64_t maxLoopTimeUs_{0};
+
+  std::unordered_map<std::string, thrift::CallbackProfile> callbacks_;
+};
+
+} // namespace openr
@@ -340,3 +340,9 @@ DEFINE_bool(
     enable_event_log_submission,
     true,
     "If set, will enable Monitor::processEventLog() to submit the logs");
+
+DEFINE_bool(
+    enable_messaging_stats,
+    false,
+    "If set, will export wait time and depth of inter-module queues per reader "
+    "as messaging.<queue>.reader.<module>.* counters");
@@ -137,3 +137,5 @@ DECLARE_uint32(bgp_min_nexthop);
 
 DECLARE_uint32(monitor_max_event_log);
 DECLARE_bool(enable_event_log_submission);
+
+DECLARE_bool(enable_messaging_stats);
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace openr {
+
+/**
+ * Map of MPLS labels to values of type T, with the interface of the subset
+ * of std::unordered_map used for route tables.
+ *
+ * Labels are handed out of a few bounded ranges, e.g. node segment and
+ * adjacency label ranges, so tables are dense within them. Instead of
+ * hashing labels, the label space is split into pages of kPageSize
+ * consecutive labels. A page holds entries inline, indexed by label, along
+ * with a bitmap of occupied slots. Pages are only allocated once they hold
+ * an entry and are released once they are empty, and are kept sorted by
+ * label. Lookups are a binary search over the few pages and a bit test,
+ * iteration is a sequential scan in label order.
+ *
+ * References to entries are stable until they are erased. Iterators are
+ * invalidated by insertions of labels of a new page, and by erasures which
+ * release a page. Labels are ordered by their unsigned value. Not thread
+ * safe.
+ */
+template <typename Label, typename T>
+class LabelMap {
+  static_assert(std::is_integral_v<Label>, "labels must be integers");
+
+ public:
+  using key_type = Label;
+  using mapped_type = T;
+  using value_type = std::pair<const Label, T>;
+  using size_type = size_t;
+
+  // labels covered by a page, 256 labels of up to 20 bits make for at most
+  // 4096 pages
+  static constexpr size_t kPageBits = 8;
+  static constexpr size_t kPageSize = size_t{1} << kPageBits;
+
+ private:
+  struct Page {
+    Page() = default;
+
+    Page(Page const& other) : occupied(other.occupied), size(other.size) {
+      forEach([&](size_t slot) {
+        new (&slots[slot]) value_type(*other.get(slot));
+      });
+    }
+
+    Page& operator=(Page const&) = delete;
+
+    ~Page() {
+      forEach([&](size_t slot) { get(slot)->~value_type(); });
+    }
+
+    bool
+    contains(size_t slot) const {
+      return occupied[slot / 64] & (uint64_t{1} << (slot % 64));
+    }
+
+    value_type*
+    get(size_t slot) {
+      return std::launder(reinterpret_cast<value_type*>(&slots[slot]));
+    }
+
+    value_type const*
+    get(size_t slot) const {
+      return std::launder(reinterpret_cast<value_type const*>(&slots[slot]));
+    }
+
+    // first occupied slot at or after slot, kPageSize if none
+    size_t
+    next(size_t slot) const {
+      for (size_t word = slot / 64; word < occupied.size(); ++word) {
+        auto bits = occupied[word];
+        if (word == slot / 64) {
+          bits &= ~uint64_t{0} << (slot % 64);
+        }
+        if (bits) {
+          return word * 64 + __builtin_ctzll(bits);
+        }
+      }
+      return kPageSize;
+    }
+
+    template <typename F>
+    void
+    forEach(F&& f) const {
+      for (size_t slot = next(0); slot < kPageSize; slot = next(slot + 1)) {
+        f(slot);
+      }
+    }
+
+    std::array<uint64_t, kPageSize / 64> occupied{};
+    size_t size{0};
+    std::array<
+        std::aligned_storage_t<sizeof(value_type), alignof(value_type)>,
+        kPageSize>
+        slots;
+  };
+
+  // pages sorted by page number, i.e. label / kPageSize
+  using Pages = std::vector<std::pair<uint32_t, std::unique_ptr<Page>>>;
+
+  template <bool kConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = LabelMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer =
+        std::conditional_t<kConst, value_type const*, value_type*>;
+    using reference =
+        std::conditional_t<kConst, value_type const&, value_type&>;
+
+    Iterator() = default;
+
+    // iterator to const_iterator
+    template <bool kC = kConst, typename = std::enable_if_t<kC>>
+    Iterator(Iterator<false> const& other) // NOLINT
+        : pages_(other.pages_), page_(other.page_), slot_(other.slot_) {}
+
+    reference
+    operator*() const {
+      return *(*pages_)[page_].second->get(slot_);
+    }
+
+    pointer
+    operator->() const {
+      return (*pages_)[page_].second->get(slot_);
+    }
+
+    Iterator&
+    operator++() {
+      slot_ = (*pages_)[page_].second->next(slot_ + 1);
+      if (slot_ == kPageSize) {
+        ++page_;
+        slot_ =
+            page_ < pages_->size() ? (*pages_)[page_].second->next(0) : 0;
+      }
+      return *this;
+    }
+
+    Iterator
+    operator++(int) {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool
+    operator==(Iterator const& other) const {
+      return page_ == other.page_ and slot_ == other.slot_;
+    }
+
+    bool
+    operator!=(Iterator const& other) const {
+      return not(*this == other);
+    }
+
+   private:
+    friend class LabelMap;
+    template <bool>
+    friend class Iterator;
+
+    Iterator(Pages const* pages, size_t page, size_t slot)
+        : pages_(pages), page_(page), slot_(slot) {}
+
+    Pages const* pages_{nullptr};
+    size_t page_{0};
+    size_t slot_{0};
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  LabelMap() = default;
+
+  LabelMap(LabelMap const& other) : size_(other.size_) {
+    pages_.reserve(other.pages_.size());
+    for (auto const& [number, page] : other.pages_) {
+      pages_.emplace_back(number, std::make_unique<Page>(*page));
+    }
+  }
+
+  LabelMap&
+  operator=(LabelMap const& other) {
+    if (this != &other) {
+      *this = LabelMap(other);
+    }
+    return *this;
+  }
+
+  LabelMap(LabelMap&& other) noexcept
+      : pages_(std::move(other.pages_)), size_(std::exchange(other.size_, 0)) {
+    other.pages_.clear();
+  }
+
+  LabelMap&
+  operator=(LabelMap&& other) noexcept {
+    pages_ = std::move(other.pages_);
+    size_ = std::exchange(other.size_, 0);
+    other.pages_.clear();
+    return *this;
+  }
+
+  iterator
+  begin() {
+    return iterator(&pages_, 0, pages_.empty() ? 0 : pages_[0].second->next(0));
+  }
+
+  const_iterator
+  begin() const {
+    return const_iterator(
+        &pages_, 0, pages_.empty() ? 0 : pages_[0].second->next(0));
+  }
+
+  const_iterator
+  cbegin() const {
+    return begin();
+  }
+
+  iterator
+  end() {
+    return iterator(&pages_, pages_.size(), 0);
+  }
+
+  const_iterator
+  end() const {
+    return const_iterator(&pages_, pages_.size(), 0);
+  }
+
+  const_iterator
+  cend() const {
+    return end();
+  }
+
+  size_t
+  size() const {
+    return size_;
+  }
+
+  bool
+  empty() const {
+    return size_ == 0;
+  }
+
+  void
+  clear() {
+    pages_.clear();
+    size_ = 0;
+  }
+
+  // approximate bytes held by the entries and their pages
+  size_t
+  getMemoryUsage() const {
+    return pages_.capacity() * sizeof(typename Pages::value_type) +
+        pages_.size() * sizeof(Page);
+  }
+
+  iterator
+  find(Label label) {
+    auto it = lookup(label);
+    return iterator(&pages_, it.page_, it.slot_);
+  }
+
+  const_iterator
+  find(Label label) const {
+    return lookup(label);
+  }
+
+  size_t
+  count(Label label) const {
+    return lookup(label) != end() ? 1 : 0;
+  }
+
+  T&
+  at(Label label) {
+    return const_cast<T&>(std::as_const(*this).at(label));
+  }
+
+  T const&
+  at(Label label) const {
+    auto it = lookup(label);
+    if (it == end()) {
+      throw std::out_of_range("LabelMap::at");
+    }
+    return it->second;
+  }
+
+  // construct entry of label out of args, unless label is present
+  // @return iterator to the entry of label, and true if it was added
+  template <typename... Args>
+  std::pair<iterator, bool>
+  try_emplace(Label label, Args&&... args) {
+    const auto number = getPageNumber(label);
+    const auto slot = getSlot(label);
+    const auto page = findPage(number);
+    if (page == pages_.size() or pages_[page].first != number) {
+      pages_.emplace(
+          pages_.begin() + page, number, std::make_unique<Page>());
+    }
+    auto& entries = *pages_[page].second;
+    if (entries.contains(slot)) {
+      return {iterator(&pages_, page, slot), false};
+    }
+    new (&entries.slots[slot]) value_type(
+        std::piecewise_construct,
+        std::forward_as_tuple(label),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    entries.occupied[slot / 64] |= uint64_t{1} << (slot % 64);
+    ++entries.size;
+    ++size_;
+    return {iterator(&pages_, page, slot), true};
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool>
+  emplace(Label label, Args&&... args) {
+    return try_emplace(label, std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool>
+  insert_or_assign(Label label, M&& value) {
+    auto res = try_emplace(label, std::forward<M>(value));
+    if (not res.second) {
+      res.first->second = std::forward<M>(value);
+    }
+    return res;
+  }
+
+  // @return number of entries erased
+  size_t
+  erase(Label label) {
+    auto it = lookup(label);
+    if (it == end()) {
+      return 0;
+    }
+    erase(it);
+    return 1;
+  }
+
+  // @return iterator to the entry following the erased one
+  iterator
+  erase(const_iterator pos) {
+    auto& entries = *pages_[pos.page_].second;
+    entries.get(pos.slot_)->~value_type();
+    entries.occupied[pos.slot_ / 64] &= ~(uint64_t{1} << (pos.slot_ % 64));
+    --entries.size;
+    --size_;
+    iterator next(&pages_, pos.page_, pos.slot_);
+    if (entries.size == 0) {
+      // release page, the next entry is the first of the following page
+      pages_.erase(pages_.begin() + pos.page_);
+      next.slot_ =
+          pos.page_ < pages_.size() ? pages_[pos.page_].second->next(0) : 0;
+      return next;
+    }
+    return ++next;
+  }
+
+  // order of labels in iteration
+  static bool
+  compareLabels(Label a, Label b) {
+    return static_cast<uint32_t>(a) < static_cast<uint32_t>(b);
+  }
+
+  bool
+  operator==(LabelMap const& other) const {
+    return size_ == other.size_ and std::equal(begin(), end(), other.begin());
+  }
+
+  bool
+  operator!=(LabelMap const& other) const {
+    return not(*this == other);
+  }
+
+ private:
+  static uint32_t
+  getPageNumber(Label label) {
+    return static_cast<uint32_t>(label) >> kPageBits;
+  }
+
+  static size_t
+  getSlot(Label label) {
+    return static_cast<uint32_t>(label) & (kPageSize - 1);
+  }
+
+  // position of the first page with number not lower than number
+  size_t
+  findPage(uint32_t number) const {
+    return std::lower_bound(
+               pages_.begin(),
+               pages_.end(),
+               number,
+               [](auto const& page, uint32_t n) { return page.first < n; }) -
+        pages_.begin();
+  }
+
+  const_iterator
+  lookup(Label label) const {
+    const auto number = getPageNumber(label);
+    const auto slot = getSlot(label);
+    const auto page = findPage(number);
+    if (page == pages_.size() or pages_[page].first != number or
+        not pages_[page].second->contains(slot)) {
+      return end();
+    }
+    return const_iterator(&pages_, page, slot);
+  }
+
+  Pages pages_;
+  size_t size_{0};
+};
+
+} // namespace openr
@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include <folly/SocketAddress.h>
 #include <folly/io/SocketOptionMap.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/AsyncSocket.h>
@@ -157,4 +162,67 @@ getOpenrCtrlSecureClient(
   return client;
 }
 
+/*
+ * Pool of thrift clients, one per server address, for callers issuing many
+ * requests to the same servers. Channels multiplex requests, hence a single
+ * client per server serves any number of pipelined requests, and connection
+ * setup is paid once instead of per request.
+ *
+ * Clients are handed out again as long as their channel is good, otherwise
+ * rebuilt with the factory, which decides transport and timeouts. All clients
+ * must be bound to the same event base, and the pool must only be used from
+ * its thread.
+ */
+template <typename Client>
+class ThriftClientPool {
+ public:
+  using ClientFactory =
+      std::function<std::unique_ptr<Client>(const folly::SocketAddress&)>;
+
+  explicit ThriftClientPool(ClientFactory factory)
+      : factory_(std::move(factory)) {}
+
+  // pooled client of addr if healthy, or a new one. nullptr if the factory
+  // fails to create one
+  std::shared_ptr<Client>
+  getClient(const folly::SocketAddress& addr) {
+    auto it = clients_.find(addr);
+    if (it != clients_.end()) {
+      if (isGood(*it->second)) {
+        return it->second;
+      }
+      clients_.erase(it);
+    }
+    std::shared_ptr<Client> client = factory_(addr);
+    if (client) {
+      clients_.emplace(addr, client);
+    }
+    return client;
+  }
+
+  // drop client of addr, e.g. after a request failed. Holders of it keep it
+  void
+  invalidate(const folly::SocketAddress& addr) {
+    clients_.erase(addr);
+  }
+
+  size_t
+  size() const {
+    return clients_.size();
+  }
+
+ private:
+  static bool
+  isGood(Client& client) {
+    auto* channel =
+        dynamic_cast<apache::thrift::ClientChannel*>(client.getChannel());
+    return channel and channel->good();
+  }
+
+  ClientFactory factory_;
+  std::unordered_map<folly::SocketAddress, std::shared_ptr<Client>> clients_;
+};
+
+using OpenrCtrlClientPool = ThriftClientPool<thrift::OpenrCtrlCppAsyncClient>;
+
 } // namespace openr
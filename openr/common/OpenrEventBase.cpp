@@ -7,8 +7,11 @@
 
 #include "openr/common/OpenrEventBase.h"
 
+#include <fmt/format.h>
 #include <folly/fibers/FiberManagerMap.h>
 
+#include <openr/common/Constants.h>
+
 namespace openr {
 
 namespace {
@@ -48,12 +51,16 @@ EventBaseStopSignalHandler::signalReceived(int signal) noexcept {
 
 OpenrEventBase::ZmqEventHandler::ZmqEventHandler(
     folly::EventBase* evb,
+    EventBaseProfiler& profiler,
+    std::string name,
     int fd,
     uintptr_t socketPtr,
     int zmqEvents,
     fbzmq::SocketCallback callback)
     : folly::EventHandler(evb, folly::NetworkSocket::fromFd(fd)),
       callback_(std::move(callback)),
+      profiler_(profiler),
+      name_(name.empty() ? fmt::format("socket_fd.{}", fd) : std::move(name)),
       zmqEvents_(zmqEvents),
       ptr_(reinterpret_cast<void*>(socketPtr)) {
   CHECK(evb);
@@ -107,6 +114,7 @@ OpenrEventBase::ZmqEventHandler::handlerReady(uint16_t events) noexcept {
   do {
     // Invoke callback if there is an overlap
     if (zmqEvents_ & zmqEvents) {
+      ScopedCallbackTimer timer(profiler_, name_);
       callback_(zmqEvents);
     }
 
@@ -122,7 +130,11 @@ OpenrEventBase::ZmqEventHandler::handlerReady(uint16_t events) noexcept {
 }
 
 OpenrEventBase::OpenrEventBase()
-    : fiberManager_(folly::fibers::getFiberManager(evb_, getFmOptions())) {
+    : profiler_(std::make_shared<EventBaseProfiler>()),
+      fiberManager_(folly::fibers::getFiberManager(evb_, getFmOptions())) {
+  // Measure busy time of every loop iteration
+  evb_.setObserver(profiler_);
+
   // Periodic timer to update eventbase's timestamp. This is used by Watchdog to
   // identify stuck threads.
   // update aliveness timestamp
@@ -130,6 +142,9 @@ OpenrEventBase::OpenrEventBase()
   timeout_ = folly::AsyncTimeout::make(evb_, [this]() noexcept {
     timestamp_.store(
         std::chrono::steady_clock::now().time_since_epoch().count());
+    if (not evbName_.empty()) {
+      profiler_->exportCounters(evbName_);
+    }
     timeout_->scheduleTimeout(std::chrono::seconds(1));
   });
   timeout_->scheduleTimeout(0);
@@ -147,6 +162,9 @@ OpenrEventBase::stop() {
   for (auto& future : fiberTaskFutures_) {
     future.wait();
   }
+  for (auto& future : coroTaskFutures_) {
+    future.wait();
+  }
   evb_.terminateLoopSoon();
 }
 
@@ -169,21 +187,46 @@ OpenrEventBase::waitUntilStopped() {
 
 void
 OpenrEventBase::scheduleTimeout(
-    std::chrono::milliseconds timeout, folly::EventBase::Func callback) {
-  evb_.scheduleAt(
-      std::move(callback), timeout + std::chrono::steady_clock::now());
+    std::chrono::milliseconds timeout,
+    folly::EventBase::Func callback,
+    std::string name) {
+  scheduleTimeoutAt(
+      timeout + std::chrono::steady_clock::now(),
+      std::move(callback),
+      std::move(name));
 }
 
 void
 OpenrEventBase::scheduleTimeoutAt(
     std::chrono::steady_clock::time_point scheduleTime,
-    folly::EventBase::Func callback) {
-  evb_.scheduleAt(std::move(callback), scheduleTime);
+    folly::EventBase::Func callback,
+    std::string name) {
+  evb_.scheduleAt(
+      [this, callback = std::move(callback), name = std::move(name)]() mutable {
+        ScopedCallbackTimer timer(*profiler_, name);
+        callback();
+      },
+      scheduleTime);
+}
+
+TimerWheel&
+OpenrEventBase::getTimerWheel() {
+  if (not timerWheel_) {
+    timerWheel_ = std::make_unique<TimerWheel>(
+        &evb_,
+        Constants::kTimerWheelTick,
+        Constants::kTimerWheelSlots,
+        evbName_.empty() ? "evb" : fmt::format("evb.{}", evbName_));
+  }
+  return *timerWheel_;
 }
 
 void
 OpenrEventBase::addSocketFd(
-    int socketFd, int events, fbzmq::SocketCallback callback) {
+    int socketFd,
+    int events,
+    fbzmq::SocketCallback callback,
+    std::string name) {
   if (fdHandlers_.count(socketFd)) {
     throw std::runtime_error("Socket-fd is already registered");
   }
@@ -192,6 +235,8 @@ OpenrEventBase::addSocketFd(
       std::forward_as_tuple(socketFd),
       std::forward_as_tuple(
           &evb_,
+          *profiler_,
+          std::move(name),
           socketFd,
           reinterpret_cast<uintptr_t>(nullptr),
           events,
@@ -200,7 +245,10 @@ OpenrEventBase::addSocketFd(
 
 void
 OpenrEventBase::addSocket(
-    uintptr_t socketPtr, int events, fbzmq::SocketCallback callback) {
+    uintptr_t socketPtr,
+    int events,
+    fbzmq::SocketCallback callback,
+    std::string name) {
   int socketFd = getZmqSocketFd(socketPtr);
   if (fdHandlers_.count(socketFd)) {
     throw std::runtime_error("Socket is already registered");
@@ -209,7 +257,13 @@ OpenrEventBase::addSocket(
       std::piecewise_construct,
       std::forward_as_tuple(socketFd),
       std::forward_as_tuple(
-          &evb_, socketFd, socketPtr, events, std::move(callback)));
+          &evb_,
+          *profiler_,
+          std::move(name),
+          socketFd,
+          socketPtr,
+          events,
+          std::move(callback)));
 }
 
 void
@@ -12,9 +12,15 @@
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/zmq/Socket.h>
 #include <folly/fibers/FiberManager.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/experimental/coro/Task.h>
+#endif
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/io/async/EventHandler.h>
 
+#include <openr/common/EventBaseProfiler.h>
+#include <openr/common/TimerWheel.h>
+
 namespace openr {
 
 class EventBaseStopSignalHandler : public folly::AsyncSignalHandler {
@@ -60,6 +66,20 @@ class OpenrEventBase {
     return fiberManager_.addTaskFuture(std::move(func));
   }
 
+#if FOLLY_HAS_COROUTINES
+  /**
+   * Add a co-routine task running on this event base. Preferred over fiber
+   * tasks for long running queue readers, a suspended co-routine only holds
+   * its frame instead of a whole fiber stack. All tasks will be awaited in
+   * `stop()`.
+   */
+  void
+  addCoroTask(folly::coro::Task<void>&& task) {
+    coroTaskFutures_.emplace_back(
+        std::move(task).scheduleOn(folly::getKeepAliveToken(evb_)).start());
+  }
+#endif
+
   /**
    * EventBase API aliases
    */
@@ -68,6 +88,25 @@ class OpenrEventBase {
     evb_.runInEventBaseThread(std::move(callback));
   }
 
+  /**
+   * Run `func` synchronously and record its execution time under `name` in
+   * the profile of this event base
+   */
+  template <typename F>
+  decltype(auto)
+  profileCallback(std::string const& name, F&& func) {
+    ScopedCallbackTimer timer(*profiler_, name);
+    return func();
+  }
+
+  /**
+   * Loop latency and slowest callbacks of this event base
+   */
+  thrift::EventBaseProfile
+  getProfile() const {
+    return profiler_->getProfile(evbName_);
+  }
+
   /**
    * Get latest timestamp of health check timer
    */
@@ -96,19 +135,38 @@ class OpenrEventBase {
    */
 
   void scheduleTimeout(
-      std::chrono::milliseconds timeout, folly::EventBase::Func callback);
+      std::chrono::milliseconds timeout,
+      folly::EventBase::Func callback,
+      std::string name = "timeout");
 
   void scheduleTimeoutAt(
       std::chrono::steady_clock::time_point scheduleTime,
-      folly::EventBase::Func callback);
+      folly::EventBase::Func callback,
+      std::string name = "timeout");
+
+  /**
+   * Timer wheel of this event base, for timers kept per neighbor, peer or
+   * key. Its timers are cheap to schedule and cancel, and all of them are
+   * driven by a single event base timer. Created on first use, which must be
+   * from the thread of the event base or before it runs.
+   */
+  TimerWheel& getTimerWheel();
 
   /**
-   * Socket/FD polling APIs
+   * Socket/FD polling APIs. Callbacks are profiled under `name`, or
+   * `socket_fd.<fd>` if it is empty.
    */
 
-  void addSocketFd(int socketFd, int events, fbzmq::SocketCallback callback);
+  void addSocketFd(
+      int socketFd,
+      int events,
+      fbzmq::SocketCallback callback,
+      std::string name = "");
   void addSocket(
-      uintptr_t socketPtr, int events, fbzmq::SocketCallback callback);
+      uintptr_t socketPtr,
+      int events,
+      fbzmq::SocketCallback callback,
+      std::string name = "");
 
   void removeSocketFd(int socketFd);
   void removeSocket(uintptr_t socketPtr);
@@ -128,6 +186,29 @@ class OpenrEventBase {
   }
 
  private:
+  /**
+   * Record execution time of the enclosing scope
+   */
+  class ScopedCallbackTimer {
+   public:
+    ScopedCallbackTimer(EventBaseProfiler& profiler, std::string const& name)
+        : profiler_(profiler),
+          name_(name),
+          start_(std::chrono::steady_clock::now()) {}
+
+    ~ScopedCallbackTimer() {
+      profiler_.recordCallback(
+          name_,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start_));
+    }
+
+   private:
+    EventBaseProfiler& profiler_;
+    std::string const& name_;
+    const std::chrono::steady_clock::time_point start_;
+  };
+
   /**
    * Event handler class for sockets and fds
    */
@@ -135,6 +216,8 @@ class OpenrEventBase {
    public:
     ZmqEventHandler(
         folly::EventBase* evb,
+        EventBaseProfiler& profiler,
+        std::string name,
         int fd,
         uintptr_t socketPtr,
         int zmqEvents,
@@ -146,8 +229,10 @@ class OpenrEventBase {
     // EventHandler callback. Unblocks read/write wait
     void handlerReady(uint16_t events) noexcept override;
 
-    // Callback for handling event
+    // Callback for handling event, and its name for profiling
     fbzmq::SocketCallback callback_;
+    EventBaseProfiler& profiler_;
+    const std::string name_;
 
     // Subscribed events
     const int zmqEvents_{0};
@@ -162,10 +247,16 @@ class OpenrEventBase {
   // EventBase object for async event polling/scheduling
   folly::EventBase evb_;
 
+  // Profiler observing evb_
+  std::shared_ptr<EventBaseProfiler> profiler_;
+
   // FiberManager driven by evb_, for scheduling fiber tasks
   folly::fibers::FiberManager& fiberManager_;
   std::vector<folly::Future<folly::Unit>> fiberTaskFutures_;
 
+  // Co-routine tasks
+  std::vector<folly::SemiFuture<folly::Unit>> coroTaskFutures_;
+
   // Data structure to hold fd and their handlers
   std::unordered_map<int /* fd */, ZmqEventHandler> fdHandlers_;
 
@@ -173,6 +264,9 @@ class OpenrEventBase {
   std::atomic<std::chrono::steady_clock::duration::rep> timestamp_;
   std::unique_ptr<folly::AsyncTimeout> timeout_;
 
+  // Timer wheel driven by evb_, created on first use
+  std::unique_ptr<TimerWheel> timerWheel_;
+
   // Unique name to identify eventbase
   std::string evbName_;
 };
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include <folly/IPAddress.h>
+
+namespace openr {
+
+/**
+ * IP prefix packed into two 64-bit words, most significant bit first, with
+ * IPv4 addresses in the upper 32 bits of the first word. Bit n of the
+ * address is bit n of the words for either family.
+ *
+ * Masking, matching and comparing prefixes take a couple of word operations,
+ * without the per-call family branches, bounds checks and copies of
+ * folly::IPAddress. Prefixes are masked to their length on construction.
+ */
+class PackedPrefix {
+ public:
+  PackedPrefix() = default;
+
+  explicit PackedPrefix(folly::CIDRNetwork const& prefix)
+      : len_(prefix.second), isV4_(prefix.first.isV4()) {
+    auto const* bytes = prefix.first.bytes();
+    for (size_t i = 0; i < prefix.first.byteCount(); ++i) {
+      words_[i / 8] |= uint64_t(bytes[i]) << (56 - 8 * (i % 8));
+    }
+    applyMask(len_);
+  }
+
+  // host prefix of address
+  explicit PackedPrefix(folly::IPAddress const& addr)
+      : PackedPrefix(folly::CIDRNetwork{addr, uint8_t(addr.bitCount())}) {}
+
+  bool
+  isV4() const {
+    return isV4_;
+  }
+
+  uint8_t
+  length() const {
+    return len_;
+  }
+
+  size_t
+  bitCount() const {
+    return isV4_ ? 32 : 128;
+  }
+
+  bool
+  getNthMSBit(size_t n) const {
+    return (words_[n / 64] >> (63 - n % 64)) & 1;
+  }
+
+  void
+  setNthMSBit(size_t n, bool value) {
+    const uint64_t bit = uint64_t(1) << (63 - n % 64);
+    words_[n / 64] = value ? words_[n / 64] | bit : words_[n / 64] & ~bit;
+  }
+
+  // prefix masked to len, len must not exceed the prefix length
+  PackedPrefix
+  mask(uint8_t len) const {
+    PackedPrefix masked(*this);
+    masked.len_ = len;
+    masked.applyMask(len);
+    return masked;
+  }
+
+  // whether this prefix contains other, both of the same family
+  bool
+  covers(PackedPrefix const& other) const {
+    const auto mask = getMask(len_);
+    return len_ <= other.len_ and
+        ((other.words_[0] & mask[0]) ^ words_[0]) == 0 and
+        ((other.words_[1] & mask[1]) ^ words_[1]) == 0;
+  }
+
+  // number of leading bits both prefixes have in common, up to the length of
+  // the shorter one
+  size_t
+  getCommonLength(PackedPrefix const& other) const {
+    const uint64_t high = words_[0] ^ other.words_[0];
+    const uint64_t low = words_[1] ^ other.words_[1];
+    const size_t common = high ? __builtin_clzll(high)
+        : low                  ? 64 + __builtin_clzll(low)
+                               : 128;
+    return std::min<size_t>({common, len_, other.len_});
+  }
+
+  folly::CIDRNetwork
+  toNetwork() const {
+    std::array<uint8_t, 16> bytes{};
+    const size_t byteCount = bitCount() / 8;
+    for (size_t i = 0; i < byteCount; ++i) {
+      bytes[i] = uint8_t(words_[i / 8] >> (56 - 8 * (i % 8)));
+    }
+    return {
+        folly::IPAddress::fromBinary(folly::ByteRange(bytes.data(), byteCount)),
+        len_};
+  }
+
+  bool
+  operator==(PackedPrefix const& other) const {
+    return words_ == other.words_ and len_ == other.len_ and
+        isV4_ == other.isV4_;
+  }
+
+  bool
+  operator!=(PackedPrefix const& other) const {
+    return not(*this == other);
+  }
+
+ private:
+  static std::array<uint64_t, 2>
+  getMask(uint8_t len) {
+    constexpr uint64_t kOnes = ~uint64_t(0);
+    if (len == 0) {
+      return {0, 0};
+    }
+    if (len <= 64) {
+      return {kOnes << (64 - len), 0};
+    }
+    return {kOnes, kOnes << (128 - len)};
+  }
+
+  void
+  applyMask(uint8_t len) {
+    const auto mask = getMask(len);
+    words_[0] &= mask[0];
+    words_[1] &= mask[1];
+  }
+
+  std::array<uint64_t, 2> words_{0, 0};
+  uint8_t len_{0};
+  bool isV4_{false};
+};
+
+} // namespace openr
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <folly/IPAddress.h>
+
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+/**
+ * Collector of one page of a cursor based dump (see thrift::PageParams) over
+ * an unordered container.
+ *
+ * Entries are added in any order. The collector keeps the `limit` smallest
+ * keys strictly greater than `cursor` (any key if not set), hence memory is
+ * bounded by the page size rather than by the size of the container. No state
+ * is kept between pages, the key of the last entry of a full page is the
+ * cursor of the next one.
+ *
+ *   PageCollector<std::string, Iterator> page(cursor, limit);
+ *   for (auto it = map.begin(); it != map.end(); ++it) {
+ *     page.add(it->first, it);
+ *   }
+ *   auto nextCursor = page.getNextCursor();
+ *   for (auto& [key, it] : page.release()) { ... }
+ */
+template <typename Key, typename Entry>
+class PageCollector {
+ public:
+  PageCollector(std::optional<Key> cursor, size_t limit)
+      : cursor_(std::move(cursor)), limit_(limit) {}
+
+  void
+  add(Key const& key, Entry entry) {
+    if (limit_ == 0 or (cursor_.has_value() and not(*cursor_ < key))) {
+      return;
+    }
+    if (entries_.size() < limit_) {
+      entries_.emplace_back(key, std::move(entry));
+      std::push_heap(entries_.begin(), entries_.end(), compareKeys);
+      return;
+    }
+    // page is full, replace the largest key if greater
+    if (not(key < entries_.front().first)) {
+      return;
+    }
+    std::pop_heap(entries_.begin(), entries_.end(), compareKeys);
+    entries_.back() = std::make_pair(key, std::move(entry));
+    std::push_heap(entries_.begin(), entries_.end(), compareKeys);
+  }
+
+  size_t
+  size() const {
+    return entries_.size();
+  }
+
+  bool
+  isFull() const {
+    return entries_.size() >= limit_;
+  }
+
+  // Cursor of the next page, set if this page is full
+  std::optional<Key>
+  getNextCursor() const {
+    if (entries_.empty() or not isFull()) {
+      return std::nullopt;
+    }
+    // root of the max-heap
+    return entries_.front().first;
+  }
+
+  // Entries of the page in ascending key order, resets the collector
+  std::vector<std::pair<Key, Entry>>
+  release() {
+    std::sort_heap(entries_.begin(), entries_.end(), compareKeys);
+    return std::exchange(entries_, {});
+  }
+
+ private:
+  static bool
+  compareKeys(
+      std::pair<Key, Entry> const& lhs, std::pair<Key, Entry> const& rhs) {
+    return lhs.first < rhs.first;
+  }
+
+  const std::optional<Key> cursor_;
+  const size_t limit_;
+
+  // max-heap on key
+  std::vector<std::pair<Key, Entry>> entries_;
+};
+
+/**
+ * Validated page size of thrift::PageParams
+ * throws thrift::OpenrError if not positive
+ */
+inline size_t
+getPageLimit(thrift::PageParams const& page) {
+  if (*page.limit_ref() <= 0) {
+    throw thrift::OpenrError(
+        fmt::format("Invalid page limit {}", *page.limit_ref()));
+  }
+  return *page.limit_ref();
+}
+
+/**
+ * Cursor of pages keyed by prefix
+ */
+inline std::string
+toPageCursor(folly::CIDRNetwork const& prefix) {
+  return folly::IPAddress::networkToString(prefix);
+}
+
+// throws thrift::OpenrError on malformed cursor
+inline folly::CIDRNetwork
+getPrefixFromPageCursor(std::string const& cursor) {
+  try {
+    return folly::IPAddress::createNetwork(cursor);
+  } catch (std::exception const&) {
+    throw thrift::OpenrError(fmt::format("Invalid page cursor {}", cursor));
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddress.h>
+
+#include <openr/common/PackedPrefix.h>
+
+namespace openr {
+
+/**
+ * Path-compressed binary trie of IP prefixes, one for IPv4 and one for IPv6,
+ * mapping each prefix to a value of type T.
+ *
+ * Every node stands for a prefix. Nodes either hold an entry, or join two
+ * sub-tries diverging at the bit after their prefix, so the trie has less
+ * than two nodes per entry. Lookups walk at most one node per bit of the
+ * prefix looked up, independent of the number of entries, which makes
+ * longestPrefixMatch() O(prefix length) instead of a scan of all prefixes.
+ *
+ * Prefixes are masked to their length on the way in, and compared in their
+ * PackedPrefix form while walking the trie. Not thread safe.
+ */
+template <typename T>
+class PrefixTrie {
+ public:
+  using value_type = std::pair<folly::CIDRNetwork, T>;
+
+  // add prefix with value, or replace the value of prefix if present
+  // @return true if prefix was added
+  bool
+  insert(folly::CIDRNetwork const& prefix, T value) {
+    const PackedPrefix key(prefix);
+    auto makeEntry = [&]() {
+      return value_type(key.toNetwork(), std::move(value));
+    };
+    auto* slot = &getRoot(key);
+    while (true) {
+      if (not *slot) {
+        *slot = makeNode(key, makeEntry());
+        ++size_;
+        return true;
+      }
+
+      auto* node = slot->get();
+      auto const nodeLen = node->prefix.length();
+      auto const commonLen = node->prefix.getCommonLength(key);
+
+      // node is the prefix
+      if (commonLen == nodeLen and commonLen == key.length()) {
+        const bool added = not node->entry.has_value();
+        node->entry = makeEntry();
+        size_ += added ? 1 : 0;
+        return added;
+      }
+
+      // node covers the prefix, descend
+      if (commonLen == nodeLen) {
+        slot = &node->children[key.getNthMSBit(nodeLen)];
+        continue;
+      }
+
+      // prefix covers node, insert it above
+      if (commonLen == key.length()) {
+        auto newNode = makeNode(key, makeEntry());
+        newNode->children[node->prefix.getNthMSBit(commonLen)] =
+            std::move(*slot);
+        *slot = std::move(newNode);
+        ++size_;
+        return true;
+      }
+
+      // prefix and node diverge, join them under their common prefix
+      auto joinNode = makeNode(key.mask(commonLen), std::nullopt);
+      joinNode->children[key.getNthMSBit(commonLen)] =
+          makeNode(key, makeEntry());
+      joinNode->children[node->prefix.getNthMSBit(commonLen)] =
+          std::move(*slot);
+      *slot = std::move(joinNode);
+      ++size_;
+      return true;
+    }
+  }
+
+  // remove prefix, and the nodes which are not needed anymore without it
+  // @return true if prefix was present
+  bool
+  erase(folly::CIDRNetwork const& prefix) {
+    const PackedPrefix key(prefix);
+    std::vector<std::unique_ptr<Node>*> path;
+    for (auto* slot = &getRoot(key); *slot;) {
+      auto* node = slot->get();
+      if (not node->prefix.covers(key)) {
+        break;
+      }
+      path.emplace_back(slot);
+      if (node->prefix.length() == key.length()) {
+        break;
+      }
+      slot = &node->children[key.getNthMSBit(node->prefix.length())];
+    }
+    if (path.empty() or (*path.back())->prefix.length() != key.length() or
+        not(*path.back())->entry.has_value()) {
+      return false;
+    }
+
+    (*path.back())->entry.reset();
+    --size_;
+
+    // replace nodes left without entry by their only child, if any
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      auto& slot = **it;
+      auto& children = slot->children;
+      if (slot->entry.has_value() or (children[0] and children[1])) {
+        break;
+      }
+      slot = std::move(children[0] ? children[0] : children[1]);
+    }
+    return true;
+  }
+
+  // entry of prefix, nullptr if not present
+  value_type const*
+  find(folly::CIDRNetwork const& prefix) const {
+    auto const* match = longestPrefixMatch(prefix);
+    return match and match->first.second == prefix.second ? match : nullptr;
+  }
+
+  // entry of the longest prefix covering prefix, prefix itself included.
+  // nullptr if no prefix covers it
+  value_type const*
+  longestPrefixMatch(folly::CIDRNetwork const& prefix) const {
+    const PackedPrefix key(prefix);
+    value_type const* match = nullptr;
+    auto const* node = getRoot(key).get();
+    while (node and node->prefix.covers(key)) {
+      if (node->entry.has_value()) {
+        match = &node->entry.value();
+      }
+      if (node->prefix.length() == key.length()) {
+        break;
+      }
+      node = node->children[key.getNthMSBit(node->prefix.length())].get();
+    }
+    return match;
+  }
+
+  // entries of all prefixes covering prefix, prefix itself included,
+  // shortest first
+  std::vector<value_type const*>
+  getCoveringPrefixes(folly::CIDRNetwork const& prefix) const {
+    const PackedPrefix key(prefix);
+    std::vector<value_type const*> matches;
+    auto const* node = getRoot(key).get();
+    while (node and node->prefix.covers(key)) {
+      if (node->entry.has_value()) {
+        matches.emplace_back(&node->entry.value());
+      }
+      if (node->prefix.length() == key.length()) {
+        break;
+      }
+      node = node->children[key.getNthMSBit(node->prefix.length())].get();
+    }
+    return matches;
+  }
+
+  size_t
+  size() const {
+    return size_;
+  }
+
+  bool
+  empty() const {
+    return size_ == 0;
+  }
+
+  void
+  clear() {
+    v4Root_.reset();
+    v6Root_.reset();
+    size_ = 0;
+  }
+
+ private:
+  struct Node {
+    // prefix this node stands for, masked to its length
+    PackedPrefix prefix;
+
+    // set if prefix is in the trie, unset for nodes joining two sub-tries
+    std::optional<value_type> entry;
+
+    // sub-tries of longer prefixes by their first bit after prefix
+    std::array<std::unique_ptr<Node>, 2> children;
+  };
+
+  static std::unique_ptr<Node>
+  makeNode(PackedPrefix const& prefix, std::optional<value_type> entry) {
+    auto node = std::make_unique<Node>();
+    node->prefix = prefix;
+    node->entry = std::move(entry);
+    return node;
+  }
+
+  std::unique_ptr<Node>&
+  getRoot(PackedPrefix const& prefix) {
+    return prefix.isV4() ? v4Root_ : v6Root_;
+  }
+
+  std::unique_ptr<Node> const&
+  getRoot(PackedPrefix const& prefix) const {
+    return prefix.isV4() ? v4Root_ : v6Root_;
+  }
+
+  std::unique_ptr<Node> v4Root_;
+  std::unique_ptr<Node> v6Root_;
+  size_t size_{0};
+};
+
+} // namespace openr
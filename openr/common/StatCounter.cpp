@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "openr/common/StatCounter.h"
+
+#include <mutex>
+#include <unordered_set>
+
+#include <folly/Indestructible.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+namespace {
+
+// All live counters. Only accessed on registration and flush, never on the
+// hot path.
+struct CounterRegistry {
+  std::mutex lock;
+  std::unordered_set<StatCounter*> counters;
+};
+
+CounterRegistry&
+getRegistry() {
+  // Leaked to outlive counters with static storage duration
+  static folly::Indestructible<CounterRegistry> registry;
+  return *registry;
+}
+
+} // namespace
+
+StatCounter::StatCounter(std::string key, fb303::ExportType type)
+    : key_(std::move(key)), type_(type) {
+  auto& registry = getRegistry();
+  std::lock_guard<std::mutex> l(registry.lock);
+  registry.counters.emplace(this);
+}
+
+StatCounter::~StatCounter() {
+  auto& registry = getRegistry();
+  std::lock_guard<std::mutex> l(registry.lock);
+  registry.counters.erase(this);
+}
+
+void
+StatCounter::flushAll() {
+  auto& registry = getRegistry();
+  std::lock_guard<std::mutex> l(registry.lock);
+  for (auto counter : registry.counters) {
+    counter->flush();
+  }
+}
+
+void
+StatCounter::flush() {
+  const auto numSamples = numSamples_.readFullAndReset();
+  if (numSamples == 0) {
+    return;
+  }
+  const auto sum = sum_.readFullAndReset();
+
+  // Export type is (re-)registered on every flush, there is no cost on the hot
+  // path and stats survive fb303 reset
+  fb303::fbData->addStatExportType(key_, type_);
+  fb303::fbData->addStatValueAggregated(key_, sum, numSamples);
+}
+
+} // namespace openr
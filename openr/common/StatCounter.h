@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <fb303/ServiceData.h>
+#include <folly/ThreadCachedInt.h>
+
+namespace openr {
+
+/**
+ * Replacement of `fb303::fbData->addStatValue(key, value, type)` for hot
+ * paths. Values are aggregated in a per-thread cache without any lock or
+ * contended atomic, and periodically flushed into fb303 stats via flushAll().
+ * The exported stats are the ones of addStatValue, only lagging by the flush
+ * interval. Few increments racing with a flush may be miscounted, which is
+ * acceptable for statistics.
+ *
+ * Counters are meant to be defined at namespace scope, next to the code
+ * bumping them
+ *
+ *   StatCounter numUpdatesCounter{"kvstore.num_updates", fb303::COUNT};
+ *   ...
+ *   numUpdatesCounter.add();
+ *
+ * NOTE: Keys must be known upfront. Keys composed at runtime, e.g. per peer
+ * or per area, should keep using addStatValue.
+ */
+class StatCounter {
+ public:
+  StatCounter(std::string key, facebook::fb303::ExportType type);
+  ~StatCounter();
+
+  /**
+   * non-copyable
+   */
+  StatCounter(StatCounter const&) = delete;
+  StatCounter& operator=(StatCounter const&) = delete;
+
+  void
+  add(int64_t value = 1) {
+    sum_.increment(value);
+    numSamples_.increment(1);
+  }
+
+  std::string const&
+  getKey() const {
+    return key_;
+  }
+
+  /**
+   * Flush values aggregated by all threads into fb303 stats. Invoked
+   * periodically by Monitor, and by tests before reading counters.
+   */
+  static void flushAll();
+
+ private:
+  // Flush aggregated values of this counter
+  void flush();
+
+  const std::string key_;
+  const facebook::fb303::ExportType type_;
+
+  folly::ThreadCachedInt<int64_t> sum_;
+  folly::ThreadCachedInt<int64_t> numSamples_;
+};
+
+} // namespace openr
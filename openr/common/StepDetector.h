@@ -7,11 +7,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <functional>
 #include <stdexcept>
+#include <vector>
 
-#include <folly/stats/BucketedTimeSeries.h>
 #include <openr/config/Config.h>
 #include <openr/if/gen-cpp2/OpenrConfig_types.h>
 
@@ -34,6 +35,12 @@ namespace openr {
  * to catch this case.
  * Notes: we assume the underlying time series is stable for longer than slow
  * sliding window between steps.
+ *
+ * Both windows are bucketed by sample period, the fast one being the latest
+ * buckets of the slow one. They share a single ring of buckets and keep
+ * running sums, so adding a value is constant time, apart from clearing the
+ * buckets skipped by a gap in the time series. Bucketing and expiry are the
+ * ones of folly::BucketedTimeSeries, the windows used to be.
  */
 template <typename ValueType, typename TimeType>
 class StepDetector {
@@ -50,24 +57,44 @@ class StepDetector {
         loThreshold_(*stepConfig.lower_threshold_ref()),
         hiThreshold_(*stepConfig.upper_threshold_ref()),
         absThreshold_(*stepConfig.ads_threshold_ref()),
-        fastSlideWindow_(fastWndSize_, samplePeriod * fastWndSize_),
-        slowSlideWindow_(slowWndSize_, samplePeriod * slowWndSize_),
+        samplePeriod_(samplePeriod),
+        buckets_(slowWndSize_),
         stepCb_(std::move(stepCb)) {
     CHECK_LT(loThreshold_, hiThreshold_);
     CHECK_LT(fastWndSize_, slowWndSize_);
+    CHECK_GT(samplePeriod_.count(), 0);
   }
 
   // add the value 'val' at time 'now' to both fast and slow sliding window
   bool
   addValue(TimeType now, const ValueType& val) {
-    bool fastSuccess = fastSlideWindow_.addValue(now, val);
-    bool slowSuccess = slowSlideWindow_.addValue(now, val);
+    const int64_t bucket = now.count() / samplePeriod_.count();
+    if (bucket > latestBucket_) {
+      advance(bucket);
+    }
+
+    // a value older than a window is dropped from it
+    const bool slowSuccess =
+        bucket > latestBucket_ - static_cast<int64_t>(slowWndSize_);
+    const bool fastSuccess =
+        bucket > latestBucket_ - static_cast<int64_t>(fastWndSize_);
+    if (slowSuccess) {
+      auto& entry = buckets_[bucket % slowWndSize_];
+      entry.sum += val;
+      ++entry.count;
+      slowWnd_.sum += val;
+      ++slowWnd_.count;
+    }
+    if (fastSuccess) {
+      fastWnd_.sum += val;
+      ++fastWnd_.count;
+    }
 
-    auto fastAvg = fastSlideWindow_.avg();
-    auto slowAvg = slowSlideWindow_.avg();
+    auto fastAvg = fastWnd_.avg();
+    auto slowAvg = slowWnd_.avg();
 
     // init last average if not initialized and we gather enough samples
-    if (!lastAvgInit_ && slowSlideWindow_.count() >= slowWndSize_ / 2) {
+    if (!lastAvgInit_ && slowWnd_.count >= slowWndSize_ / 2) {
       lastAvg_ = slowAvg;
       lastAvgInit_ = true;
     }
@@ -120,6 +147,44 @@ class StepDetector {
   StepDetector(StepDetector const&) = delete;
   StepDetector& operator=(StepDetector const&) = delete;
 
+  struct Bucket {
+    ValueType sum{0};
+    uint64_t count{0};
+
+    double
+    avg() const {
+      return count ? static_cast<double>(sum) / count : 0;
+    }
+  };
+
+  // move the windows forward to end with given bucket
+  void
+  advance(int64_t bucket) {
+    const auto gap = static_cast<uint64_t>(bucket - latestBucket_);
+    if (gap >= fastWndSize_) {
+      fastWnd_ = Bucket();
+    }
+    if (gap >= slowWndSize_) {
+      slowWnd_ = Bucket();
+      std::fill(buckets_.begin(), buckets_.end(), Bucket());
+      latestBucket_ = bucket;
+      return;
+    }
+    for (auto next = latestBucket_ + 1; next <= bucket; ++next) {
+      const auto fastExpired = next - static_cast<int64_t>(fastWndSize_);
+      if (gap < fastWndSize_ && fastExpired >= 0) {
+        auto const& expired = buckets_[fastExpired % slowWndSize_];
+        fastWnd_.sum -= expired.sum;
+        fastWnd_.count -= expired.count;
+      }
+      auto& expired = buckets_[next % slowWndSize_];
+      slowWnd_.sum -= expired.sum;
+      slowWnd_.count -= expired.count;
+      expired = Bucket();
+    }
+    latestBucket_ = bucket;
+  }
+
   // fast sliding window size
   const uint64_t fastWndSize_{0};
 
@@ -135,13 +200,18 @@ class StepDetector {
   // absolute step threshold to detect gradual change
   const ValueType absThreshold_{0};
 
-  // fast sliding window
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      fastSlideWindow_;
+  // interval time series is sampled, i.e. duration of a bucket
+  const TimeType samplePeriod_;
 
-  // slow sliding window size
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      slowSlideWindow_;
+  // ring of the buckets of the slow window, indexed by bucket modulo size
+  std::vector<Bucket> buckets_;
+
+  // latest bucket added to, the windows end with it
+  int64_t latestBucket_{0};
+
+  // running sums of the fast and slow windows
+  Bucket fastWnd_;
+  Bucket slowWnd_;
 
   // callback when step is detected
   const std::function<void(const ValueType&)> stepCb_{nullptr};
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <limits>
+#include <stdexcept>
+
+#include <glog/logging.h>
+
+#include <openr/common/StringInterner.h>
+
+namespace openr {
+
+StringInterner::Id
+StringInterner::intern(std::string_view str) {
+  // fast path, most lookups are for strings we have already seen
+  if (auto id = find(str)) {
+    return *id;
+  }
+
+  auto table = table_.wlock();
+  auto it = table->ids.find(str);
+  if (it != table->ids.end()) {
+    // raced with another writer
+    return it->second;
+  }
+  CHECK_LT(table->strings.size(), std::numeric_limits<Id>::max());
+  Id const id = table->strings.size();
+  auto const& stored = table->strings.emplace_back(str);
+  table->ids.emplace(std::string_view(stored), id);
+  return id;
+}
+
+std::optional<StringInterner::Id>
+StringInterner::find(std::string_view str) const {
+  auto table = table_.rlock();
+  auto it = table->ids.find(str);
+  if (it == table->ids.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::string const&
+StringInterner::get(Id id) const {
+  auto table = table_.rlock();
+  if (id >= table->strings.size()) {
+    throw std::out_of_range(std::to_string(id));
+  }
+  // element references are stable, safe to use after releasing the lock
+  return table->strings[id];
+}
+
+size_t
+StringInterner::size() const {
+  return table_.rlock()->strings.size();
+}
+
+StringInterner&
+StringInterner::nodeNames() {
+  // leaked on purpose, interned references must outlive static destructors
+  static auto* interner = new StringInterner();
+  return *interner;
+}
+
+StringInterner&
+StringInterner::ifNames() {
+  static auto* interner = new StringInterner();
+  return *interner;
+}
+
+StringInterner&
+StringInterner::areas() {
+  static auto* interner = new StringInterner();
+  return *interner;
+}
+
+} // namespace openr
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <folly/Synchronized.h>
+
+namespace openr {
+
+/**
+ * Process-wide symbol table mapping strings to dense 32-bit ids.
+ *
+ * Every distinct string is stored exactly once. Ids are handed out in
+ * insertion order starting at 0 and are never reused, so callers can keep per
+ * symbol state in vectors indexed by id and sized with size(). The reference
+ * returned by get() stays valid for the lifetime of the process, hence two
+ * references obtained from the same table are equal iff they alias.
+ *
+ * Entries are never removed. Memory is bounded by the number of distinct
+ * names ever seen, which is fine for node, interface and area names.
+ *
+ * All methods are thread safe.
+ */
+class StringInterner {
+ public:
+  using Id = uint32_t;
+
+  StringInterner() = default;
+
+  // non-copyable, tables are meant to be shared
+  StringInterner(StringInterner const&) = delete;
+  StringInterner& operator=(StringInterner const&) = delete;
+
+  // return the id of str, adding it to the table if it is not present yet
+  Id intern(std::string_view str);
+
+  // return the id of str if it has been interned before
+  std::optional<Id> find(std::string_view str) const;
+
+  // return the string for an id previously returned by intern()
+  // throws std::out_of_range for unknown ids
+  std::string const& get(Id id) const;
+
+  // convenience for intern() followed by get()
+  std::string const&
+  internAndGet(std::string_view str) {
+    return get(intern(str));
+  }
+
+  size_t size() const;
+
+  //
+  // Process-wide tables. Node names use a table of their own so that the id
+  // space stays dense for per node vectors in Decision
+  //
+  static StringInterner& nodeNames();
+  static StringInterner& ifNames();
+  static StringInterner& areas();
+
+ private:
+  struct Table {
+    // deque never relocates elements on push_back, ids_ keys view into it
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, Id> ids;
+  };
+
+  folly::Synchronized<Table> table_;
+};
+
+} // namespace openr
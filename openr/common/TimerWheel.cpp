@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/common/TimerWheel.h>
+
+#include <algorithm>
+
+#include <fb303/ServiceData.h>
+#include <glog/logging.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+TimerWheel::Timer::Timer(
+    TimerWheel& wheel, folly::Function<void() noexcept> callback)
+    : wheel_(wheel), callback_(std::move(callback)) {
+  CHECK(callback_);
+}
+
+TimerWheel::Timer::~Timer() {
+  if (destroyed_) {
+    *destroyed_ = true;
+  }
+  cancelTimeout();
+}
+
+void
+TimerWheel::Timer::scheduleTimeout(std::chrono::milliseconds timeout) {
+  wheel_.schedule(*this, timeout);
+}
+
+void
+TimerWheel::Timer::cancelTimeout() {
+  if (isScheduled()) {
+    wheel_.cancel(*this);
+  }
+}
+
+TimerWheel::TimerWheel(
+    folly::EventBase* evb,
+    std::chrono::milliseconds tickInterval,
+    size_t numSlots,
+    std::string counterPrefix)
+    : tickInterval_(tickInterval),
+      lagCounter_(counterPrefix + ".timer_lag_ms"),
+      batchSizeCounter_(counterPrefix + ".timer_batch_size"),
+      startTime_(std::chrono::steady_clock::now()),
+      slots_(numSlots) {
+  CHECK(tickInterval_ > std::chrono::milliseconds(0))
+      << "Tick interval of timer wheel can't be 0";
+  CHECK(numSlots > 0) << "Timer wheel needs at least one slot";
+
+  tickTimeout_ = folly::AsyncTimeout::make(
+      *evb, [this]() noexcept { processTicks(); });
+
+  fb303::fbData->addStatExportType(lagCounter_, fb303::AVG);
+  fb303::fbData->addStatExportType(lagCounter_, fb303::MAX);
+  fb303::fbData->addStatExportType(batchSizeCounter_, fb303::AVG);
+}
+
+TimerWheel::~TimerWheel() {
+  // timers may outlive the wheel, leave them unscheduled
+  for (auto& slot : slots_) {
+    for (auto* timer : slot) {
+      timer->slot_ = nullptr;
+    }
+  }
+  for (auto* timer : expired_) {
+    timer->slot_ = nullptr;
+  }
+}
+
+std::unique_ptr<TimerWheel::Timer>
+TimerWheel::makeTimer(folly::Function<void() noexcept> callback) {
+  return std::unique_ptr<Timer>(new Timer(*this, std::move(callback)));
+}
+
+void
+TimerWheel::schedule(Timer& timer, std::chrono::milliseconds timeout) {
+  cancel(timer);
+
+  auto const now = std::chrono::steady_clock::now();
+  if (numScheduled_ == 0) {
+    // wheel was idle, skip the empty ticks elapsed since
+    currentTick_ = std::max<uint64_t>(
+        currentTick_, (now - startTime_) / tickInterval_);
+  }
+
+  // round expiry up to the next tick, timers never fire early
+  timer.deadline_ = now + std::max(timeout, std::chrono::milliseconds(0));
+  const uint64_t expiryTick = std::max<uint64_t>(
+      currentTick_ + 1,
+      (timer.deadline_ - startTime_ + tickInterval_ -
+       std::chrono::steady_clock::duration(1)) /
+          tickInterval_);
+
+  auto& slot = slots_[expiryTick % slots_.size()];
+  timer.rounds_ = (expiryTick - currentTick_ - 1) / slots_.size();
+  timer.slot_ = &slot;
+  timer.pos_ = slot.insert(slot.end(), &timer);
+  ++numScheduled_;
+
+  scheduleTick();
+}
+
+void
+TimerWheel::cancel(Timer& timer) {
+  if (not timer.slot_) {
+    return;
+  }
+  timer.slot_->erase(timer.pos_);
+  timer.slot_ = nullptr;
+  --numScheduled_;
+
+  if (numScheduled_ == 0) {
+    tickTimeout_->cancelTimeout();
+  }
+}
+
+void
+TimerWheel::processTicks() noexcept {
+  auto const now = std::chrono::steady_clock::now();
+  const uint64_t nowTick = (now - startTime_) / tickInterval_;
+  while (currentTick_ < nowTick and numScheduled_ > 0) {
+    ++currentTick_;
+    processSlot(slots_[currentTick_ % slots_.size()]);
+  }
+  scheduleTick();
+}
+
+void
+TimerWheel::processSlot(std::list<Timer*>& slot) {
+  // collect timers of this tick first, callbacks may schedule new ones
+  for (auto it = slot.begin(); it != slot.end();) {
+    auto* timer = *it++;
+    if (timer->rounds_ > 0) {
+      --timer->rounds_;
+      continue;
+    }
+    expired_.splice(expired_.end(), slot, timer->pos_);
+    timer->slot_ = &expired_;
+  }
+  if (expired_.empty()) {
+    return;
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+  size_t batchSize{0};
+  while (not expired_.empty()) {
+    auto* timer = expired_.front();
+    cancel(*timer);
+    ++batchSize;
+
+    auto const lag = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - timer->deadline_);
+    fb303::fbData->addStatValue(
+        lagCounter_, std::max<int64_t>(0, lag.count()), fb303::AVG);
+
+    // callback may destroy its timer, hold it until it returns
+    bool destroyed{false};
+    timer->destroyed_ = &destroyed;
+    auto callback = std::move(timer->callback_);
+    callback();
+    if (not destroyed) {
+      timer->destroyed_ = nullptr;
+      timer->callback_ = std::move(callback);
+    }
+  }
+  fb303::fbData->addStatValue(batchSizeCounter_, batchSize, fb303::AVG);
+}
+
+void
+TimerWheel::scheduleTick() {
+  if (numScheduled_ == 0 or tickTimeout_->isScheduled()) {
+    return;
+  }
+  auto const nextTickTime = startTime_ + (currentTick_ + 1) * tickInterval_;
+  auto const delay = std::chrono::ceil<std::chrono::milliseconds>(
+      nextTickTime - std::chrono::steady_clock::now());
+  tickTimeout_->scheduleTimeout(
+      std::max(delay, std::chrono::milliseconds(0)));
+}
+
+} // namespace openr
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+namespace openr {
+
+/**
+ * Hashed timing wheel, driving many timers of an event base with a single
+ * folly::AsyncTimeout.
+ *
+ * Time is divided in ticks, and timers are hashed into one of a fixed number
+ * of slots by the tick they expire at. Timers expiring more than one rotation
+ * ahead wait their remaining rotations in their slot. Scheduling and
+ * cancelling is O(1), and timers of a tick fire together in a batch, in the
+ * order they were scheduled. Timers never fire before their timeout, and at
+ * most one tick late on an idle event base.
+ *
+ * Exports, under the given counter prefix
+ *  - <prefix>.timer_lag_ms: delay of timers firing after their timeout
+ *  - <prefix>.timer_batch_size: number of timers firing in the same tick
+ *
+ * Not thread safe, timers must be used from the thread of the event base.
+ * Timers may be scheduled, cancelled or destroyed from their own callback.
+ */
+class TimerWheel final {
+ public:
+  class Timer final {
+   public:
+    ~Timer();
+
+    // (re)schedule timer to expire after timeout
+    void scheduleTimeout(std::chrono::milliseconds timeout);
+
+    // cancel timer if scheduled
+    void cancelTimeout();
+
+    bool
+    isScheduled() const {
+      return slot_ != nullptr;
+    }
+
+   private:
+    friend class TimerWheel;
+
+    Timer(TimerWheel& wheel, folly::Function<void() noexcept> callback);
+
+    Timer(Timer const&) = delete;
+    Timer& operator=(Timer const&) = delete;
+
+    TimerWheel& wheel_;
+
+    folly::Function<void() noexcept> callback_;
+
+    // slot and position of scheduled timer, nullptr if not scheduled
+    std::list<Timer*>* slot_{nullptr};
+    std::list<Timer*>::iterator pos_;
+
+    // rotations of the wheel left before expiry
+    uint64_t rounds_{0};
+
+    // time point of expiry, for lag
+    std::chrono::steady_clock::time_point deadline_;
+
+    // set while callback runs, to detect destruction from the callback
+    bool* destroyed_{nullptr};
+  };
+
+  TimerWheel(
+      folly::EventBase* evb,
+      std::chrono::milliseconds tickInterval,
+      size_t numSlots,
+      std::string counterPrefix);
+
+  ~TimerWheel();
+
+  // create unscheduled timer, calling callback on expiry
+  std::unique_ptr<Timer> makeTimer(folly::Function<void() noexcept> callback);
+
+  // number of scheduled timers
+  size_t
+  getNumScheduled() const {
+    return numScheduled_;
+  }
+
+ private:
+  TimerWheel(TimerWheel const&) = delete;
+  TimerWheel& operator=(TimerWheel const&) = delete;
+
+  void schedule(Timer& timer, std::chrono::milliseconds timeout);
+
+  void cancel(Timer& timer);
+
+  // fire timers of ticks elapsed since last call
+  void processTicks() noexcept;
+
+  // fire timers of current tick
+  void processSlot(std::list<Timer*>& slot);
+
+  // schedule tick timeout if timers are pending
+  void scheduleTick();
+
+  const std::chrono::milliseconds tickInterval_{0};
+
+  const std::string lagCounter_;
+  const std::string batchSizeCounter_;
+
+  // time point of tick 0
+  const std::chrono::steady_clock::time_point startTime_;
+
+  // last tick processed
+  uint64_t currentTick_{0};
+
+  std::vector<std::list<Timer*>> slots_;
+
+  // timers of current tick yet to fire
+  std::list<Timer*> expired_;
+
+  size_t numScheduled_{0};
+
+  std::unique_ptr<folly::AsyncTimeout> tickTimeout_{nullptr};
+};
+
+} // namespace openr
@@ -5,7 +5,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cctype>
+
 #include <fmt/core.h>
+#include <folly/hash/Hash.h>
 #include <openr/common/Types.h>
 
 #include <openr/common/NetworkUtil.h>
@@ -63,61 +66,155 @@ PrefixKey::PrefixKey(
           prefix_.first.str(),
           prefix_.second)) {}
 
+namespace {
+
+// leading run of chars of s accepted by isValid
+template <typename Fn>
+std::string_view
+takeWhile(std::string_view s, Fn&& isValid) {
+  size_t len = 0;
+  while (len < s.size() and isValid(s[len])) {
+    ++len;
+  }
+  return s.substr(0, len);
+}
+
+// [a-zA-Z0-9.\-_] of node and area names
+bool
+isNameChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) or c == '.' or
+      c == '-' or c == '_';
+}
+
+// [a-fA-F0-9.:] of IP addresses
+bool
+isAddrChar(char c) {
+  return std::isxdigit(static_cast<unsigned char>(c)) or c == '.' or c == ':';
+}
+
+// network from fields of a prefix key, as folly::IPAddress::createNetwork()
+// without building intermediate strings or throwing
+std::optional<folly::CIDRNetwork>
+toNetwork(PrefixKey::KeyFields const& fields) {
+  auto addr = folly::IPAddress::tryFromString(
+      folly::StringPiece(fields.ipAddr.data(), fields.ipAddr.size()));
+  if (addr.hasError() or static_cast<size_t>(fields.plen) > addr->bitCount()) {
+    return std::nullopt;
+  }
+  const auto plen = static_cast<uint8_t>(fields.plen);
+  return folly::CIDRNetwork{addr->mask(plen), plen};
+}
+
+} // namespace
+
+std::optional<PrefixKey::KeyFields>
+PrefixKey::parseKeyFields(std::string_view key, bool isV2) {
+  const std::string_view marker(
+      Constants::kPrefixDbMarker.data(), Constants::kPrefixDbMarker.size());
+  if (key.substr(0, marker.size()) != marker) {
+    return std::nullopt;
+  }
+  key.remove_prefix(marker.size());
+
+  // consume name and the ':' following it
+  auto takeName = [&key](std::string_view& name) {
+    name = takeWhile(key, isNameChar);
+    if (name.empty() or name.size() == key.size() or key[name.size()] != ':') {
+      return false;
+    }
+    key.remove_prefix(name.size() + 1);
+    return true;
+  };
+
+  KeyFields fields;
+  if (not takeName(fields.node) or (not isV2 and not takeName(fields.area))) {
+    return std::nullopt;
+  }
+
+  // [<ip>/<plen>]
+  if (key.empty() or key.front() != '[') {
+    return std::nullopt;
+  }
+  key.remove_prefix(1);
+  fields.ipAddr = takeWhile(key, isAddrChar);
+  key.remove_prefix(fields.ipAddr.size());
+  if (fields.ipAddr.empty() or key.empty() or key.front() != '/') {
+    return std::nullopt;
+  }
+  key.remove_prefix(1);
+  auto plen = takeWhile(key, [](char c) { return c >= '0' and c <= '9'; });
+  if (plen.empty() or plen.size() > 3 or key.size() != plen.size() + 1 or
+      key.back() != ']') {
+    return std::nullopt;
+  }
+  for (char c : plen) {
+    fields.plen = fields.plen * 10 + (c - '0');
+  }
+  return fields;
+}
+
 bool
 PrefixKey::isPrefixKeyV2Str(const std::string& key) {
-  int64_t plen{0};
-  std::string node{};
-  std::string ipStr{};
-  folly::CIDRNetwork ipAddress;
-  auto patt =
-      RE2::FullMatch(key, PrefixKey::getPrefixRE2(), &node, &ipStr, &plen);
-  auto pattV2 =
-      RE2::FullMatch(key, PrefixKey::getPrefixRE2V2(), &node, &ipStr, &plen);
-
-  return (not patt) and pattV2;
+  return (not parseKeyFields(key, false)) and parseKeyFields(key, true);
 }
 
 folly::Expected<PrefixKey, std::string>
 PrefixKey::fromStr(const std::string& key) {
-  int plen{0};
-  std::string area{};
-  std::string node{};
-  std::string ipstr{};
-  folly::CIDRNetwork ipaddress;
-  auto patt = RE2::FullMatch(key, getPrefixRE2(), &node, &area, &ipstr, &plen);
-  if (!patt) {
+  auto fields = parseKeyFields(key, false);
+  if (not fields) {
     return folly::makeUnexpected(fmt::format("Invalid key format {}", key));
   }
-
-  try {
-    ipaddress =
-        folly::IPAddress::createNetwork(fmt::format("{}/{}", ipstr, plen));
-  } catch (const folly::IPAddressFormatException& e) {
-    LOG(INFO) << "Exception in converting to Prefix. " << e.what();
+  auto network = toNetwork(*fields);
+  if (not network) {
     return folly::makeUnexpected(std::string("Invalid IP address in key"));
   }
-  return PrefixKey(node, ipaddress, area, false);
+  return PrefixKey(
+      std::string(fields->node), *network, std::string(fields->area), false);
 }
 
 folly::Expected<PrefixKey, std::string>
 PrefixKey::fromStrV2(const std::string& key, const std::string& area) {
-  int plen{0};
-  std::string node{};
-  std::string ipStr{};
-  folly::CIDRNetwork ipAddress;
-  auto patt = RE2::FullMatch(key, getPrefixRE2V2(), &node, &ipStr, &plen);
-  if (!patt) {
+  auto fields = parseKeyFields(key, true);
+  if (not fields) {
     return folly::makeUnexpected(fmt::format("Invalid key format {}", key));
   }
-
-  try {
-    ipAddress =
-        folly::IPAddress::createNetwork(fmt::format("{}/{}", ipStr, plen));
-  } catch (const folly::IPAddressFormatException& e) {
-    LOG(INFO) << "Exception in converting to Prefix. " << e.what();
+  auto network = toNetwork(*fields);
+  if (not network) {
     return folly::makeUnexpected(std::string("Invalid IP address in key"));
   }
-  return PrefixKey(node, ipAddress, area, true);
+  return PrefixKey(std::string(fields->node), *network, area, true);
+}
+
+PrefixShardKey::PrefixShardKey(
+    std::string const& node, std::string const& area, int32_t shard)
+    : nodeAndArea_(node, area),
+      shard_(shard),
+      prefixShardKeyString_(fmt::format(
+          "{}{}:{}:{}",
+          Constants::kPrefixShardDbMarker.toString(),
+          node,
+          area,
+          shard)) {}
+
+folly::Expected<PrefixShardKey, std::string>
+PrefixShardKey::fromStr(const std::string& key) {
+  std::string node{};
+  std::string area{};
+  int32_t shard{0};
+  if (not RE2::FullMatch(key, getPrefixShardRE2(), &node, &area, &shard)) {
+    return folly::makeUnexpected(fmt::format("Invalid key format {}", key));
+  }
+  return PrefixShardKey(node, area, shard);
+}
+
+int32_t
+PrefixShardKey::getShard(folly::CIDRNetwork const& prefix, int32_t numShards) {
+  CHECK_GT(numShards, 0);
+  // std::hash is implementation defined, shards must not move across versions
+  auto hash =
+      folly::hash::fnv64_buf(prefix.first.bytes(), prefix.first.byteCount());
+  hash = folly::hash::fnv64_buf(&prefix.second, sizeof(prefix.second), hash);
+  return static_cast<int32_t>(hash % static_cast<uint64_t>(numShards));
 }
 
 } // namespace openr
@@ -8,7 +8,9 @@
 #pragma once
 
 #include <openr/if/gen-cpp2/Network_types.h>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -17,6 +19,7 @@
 #include <fmt/core.h>
 #include <folly/Expected.h>
 #include <folly/IPAddress.h>
+#include <folly/futures/Promise.h>
 #include <re2/re2.h>
 #include <re2/set.h>
 
@@ -182,8 +185,10 @@ struct PrefixEntry {
 
   bool
   operator==(const PrefixEntry& other) const {
-    return *tPrefixEntry == *other.tPrefixEntry && dstAreas == other.dstAreas &&
-        network == other.network;
+    // Sources re-sending unchanged entries usually share the attributes
+    return (tPrefixEntry == other.tPrefixEntry ||
+            *tPrefixEntry == *other.tPrefixEntry) &&
+        dstAreas == other.dstAreas && network == other.network;
   }
 };
 
@@ -218,6 +223,19 @@ struct PrefixEvent {
    */
   std::unordered_set<std::string> dstAreas{};
 
+  /**
+   * Sequence number of the event chosen by the source, echoed in `ack`
+   */
+  uint64_t seqNum{0};
+
+  /**
+   * Optional acknowledgement, fulfilled with `seqNum` once PrefixManager has
+   * applied the event. Sources injecting large volumes of prefixes, e.g. BGP
+   * plugin, bound the events in flight by waiting for acks of earlier ones.
+   * ATTN: only PrefixManager fulfills it, other readers of the queue must not
+   */
+  std::shared_ptr<folly::Promise<uint64_t>> ack{nullptr};
+
   explicit PrefixEvent(
       const PrefixEventType& eventType,
       const std::optional<thrift::PrefixType>& type = std::nullopt,
@@ -342,6 +360,27 @@ struct InterfaceInfo {
  */
 using InterfaceDatabase = std::vector<InterfaceInfo>;
 
+/**
+ * Structure of interface updates published by LinkMonitor. A full sync
+ * carries all interfaces, replacing previously published ones. Otherwise it
+ * is a delta of the previous update: interfaces added or changed since, and
+ * names of interfaces removed since. Full syncs are published periodically
+ * for consistency.
+ */
+struct InterfaceDatabaseUpdate {
+  bool isFullSync{true};
+
+  InterfaceDatabase interfaces{};
+
+  std::vector<std::string> removedIfNames{};
+
+  InterfaceDatabaseUpdate() {}
+
+  // Full sync of given interfaces
+  explicit InterfaceDatabaseUpdate(InterfaceDatabase interfaces)
+      : interfaces(std::move(interfaces)) {}
+};
+
 /**
  * Structure defining KvStore peer sync event, published to subscribers.
  * LinkMonitor subscribes this event for signal adjancency UP event propagation
@@ -406,6 +445,20 @@ class PrefixKey {
       const std::string& key,
       const std::string& area = thrift::Types_constants::kDefaultArea());
 
+  // Fields of a prefix key string, viewing into the string
+  struct KeyFields {
+    std::string_view node;
+    // empty for v2 format
+    std::string_view area;
+    std::string_view ipAddr;
+    int plen{0};
+  };
+
+  // Hand-written, allocation free equivalent of matching getPrefixRE2(), or
+  // getPrefixRE2V2() if isV2, against key. std::nullopt if key doesn't match
+  static std::optional<KeyFields> parseKeyFields(
+      std::string_view key, bool isV2);
+
   // TODO: deprecate after migration
   static const RE2&
   getPrefixRE2() {
@@ -490,6 +543,69 @@ class PrefixKey {
   std::string const prefixKeyStringV2_;
 };
 
+/**
+ * Key of a shard of the prefix db of a node in an area, carrying all prefixes
+ * hashed to the shard, see `num_prefix_db_shards`.
+ *
+ *  prefixshard  :  node1  :  area1  :  17
+ *       |            |         |        |
+ *     marker       nodeId    areaId   shard
+ */
+class PrefixShardKey {
+ public:
+  PrefixShardKey(
+      std::string const& node, std::string const& area, int32_t shard);
+
+  // construct PrefixShardKey object from a give key string
+  static folly::Expected<PrefixShardKey, std::string> fromStr(
+      const std::string& key);
+
+  // shard of prefix among numShards, stable across restarts and platforms
+  static int32_t getShard(folly::CIDRNetwork const& prefix, int32_t numShards);
+
+  static const RE2&
+  getPrefixShardRE2() {
+    static const RE2 prefixShardKeyPattern{fmt::format(
+        "{}(?P<node>[a-zA-Z\\d\\.\\-\\_]+):"
+        "(?P<area>[a-zA-Z0-9\\.\\_\\-]+):"
+        "(?P<shard>[\\d]+)",
+        Constants::kPrefixShardDbMarker.toString())};
+    return prefixShardKeyPattern;
+  }
+
+  // return node name and area pair
+  inline NodeAndArea const&
+  getNodeAndArea() const {
+    return nodeAndArea_;
+  }
+
+  inline std::string const&
+  getNodeName() const {
+    return nodeAndArea_.first;
+  }
+
+  inline std::string const&
+  getPrefixArea() const {
+    return nodeAndArea_.second;
+  }
+
+  inline int32_t
+  getShard() const {
+    return shard_;
+  }
+
+  // return raw prefix shard key string from kvstore
+  inline std::string const&
+  getPrefixShardKey() const {
+    return prefixShardKeyString_;
+  }
+
+ private:
+  NodeAndArea const nodeAndArea_;
+  int32_t const shard_{0};
+  std::string const prefixShardKeyString_;
+};
+
 } // namespace openr
 
 template <>
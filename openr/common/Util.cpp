@@ -8,13 +8,24 @@
 #include "Util.h"
 
 #include <fmt/core.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <openr/common/PackedPrefix.h>
+
 #if __has_include("filesystem")
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -136,10 +147,15 @@ bitStrValue(const folly::IPAddress& ip, uint32_t start, uint32_t end) {
   uint32_t index{0};
   CHECK_GE(start, 0);
   CHECK_LE(start, end);
+  if (end >= ip.bitCount()) {
+    throw std::invalid_argument(
+        fmt::format("Bit index must be < {}, found {}", ip.bitCount(), end));
+  }
+  const PackedPrefix packed(ip);
   // 0 based index
   for (uint32_t i = start; i <= end; i++) {
     index <<= 1;
-    index |= ip.getNthMSBit(i);
+    index |= packed.getNthMSBit(i);
   }
   return index;
 }
@@ -149,11 +165,10 @@ getNthPrefix(
     const folly::CIDRNetwork& seedPrefix,
     uint32_t allocPrefixLen,
     uint32_t prefixIndex) {
-  // get underlying byte array representing IP
   const uint32_t bitCount = seedPrefix.first.bitCount();
-  auto ipBytes = std::string(
-      reinterpret_cast<const char*>(seedPrefix.first.bytes()),
-      seedPrefix.first.byteCount());
+  if (allocPrefixLen > bitCount) {
+    throw std::invalid_argument("Alloc prefix is longer than address.");
+  }
 
   // host number bit length
   // in seed prefix
@@ -172,27 +187,14 @@ getNthPrefix(
   }
 
   // using bits (seedHostBitLen-allocHostBitLen-1)..0 of @prefixIndex to
-  // set bits (seedHostBitLen - 1)..allocHostBitLen of ipBytes
+  // set bits (seedHostBitLen - 1)..allocHostBitLen of the seed address,
+  // counted from its least significant bit
+  PackedPrefix prefix(seedPrefix.first);
   for (uint8_t i = 0; i < allocBits; ++i) {
-    // global bit index across bytes
-    auto idx = i + allocHostBitLen;
-    // byte index: network byte order, i.e., big-endian
-    auto byteIdx = bitCount / 8 - idx / 8 - 1;
-    // bit index inside the byte
-    auto bitIdx = idx % 8;
-    if (prefixIndex & (0x1 << i)) {
-      // set
-      ipBytes.at(byteIdx) |= (0x1 << bitIdx);
-    } else {
-      // clear
-      ipBytes.at(byteIdx) &= ~(0x1 << bitIdx);
-    }
+    prefix.setNthMSBit(
+        bitCount - 1 - (i + allocHostBitLen), prefixIndex & (1u << i));
   }
-
-  // convert back to CIDR
-  auto allocPrefixIp = folly::IPAddress::fromBinary(folly::ByteRange(
-      reinterpret_cast<const uint8_t*>(ipBytes.data()), ipBytes.size()));
-  return {allocPrefixIp.mask(allocPrefixLen), allocPrefixLen};
+  return prefix.mask(allocPrefixLen).toNetwork();
 }
 
 void
@@ -272,15 +274,110 @@ getDurationBetweenPerfEvents(
   return std::chrono::milliseconds(second - first);
 }
 
+bool
+maybeStartPerfTrace(
+    thrift::PerfEvents& perfEvents, double sampleRate) noexcept {
+  if (perfEvents.traceId_ref().has_value()) {
+    return true;
+  }
+  if (sampleRate <= 0 or folly::Random::randDouble01() >= sampleRate) {
+    return false;
+  }
+  // zero is reserved for "not traced" in logs
+  int64_t traceId{0};
+  while (traceId == 0) {
+    traceId = static_cast<int64_t>(folly::Random::rand64());
+  }
+  perfEvents.traceId_ref() = traceId;
+  return true;
+}
+
+void
+mergePerfTrace(
+    thrift::PerfEvents& perfEvents, const thrift::PerfEvents& from) noexcept {
+  if (perfEvents.traceId_ref().has_value() or
+      not from.traceId_ref().has_value()) {
+    return;
+  }
+  perfEvents.traceId_ref() = *from.traceId_ref();
+  perfEvents.spans_ref()->insert(
+      perfEvents.spans_ref()->begin(),
+      from.spans_ref()->cbegin(),
+      from.spans_ref()->cend());
+}
+
+void
+startPerfSpan(
+    thrift::PerfEvents& perfEvents,
+    const std::string& nodeName,
+    folly::StringPiece stage) noexcept {
+  if (not perfEvents.traceId_ref().has_value()) {
+    return;
+  }
+  thrift::PerfSpan span;
+  span.stage_ref() = stage.str();
+  span.startNodeName_ref() = nodeName;
+  span.startUs_ref() = getUnixTimeStampUs();
+  perfEvents.spans_ref()->emplace_back(std::move(span));
+}
+
+std::optional<std::chrono::microseconds>
+endPerfSpan(
+    thrift::PerfEvents& perfEvents,
+    const std::string& nodeName,
+    folly::StringPiece stage) noexcept {
+  if (not perfEvents.traceId_ref().has_value()) {
+    return std::nullopt;
+  }
+  auto& spans = *perfEvents.spans_ref();
+  auto it = std::find_if(spans.rbegin(), spans.rend(), [&](auto const& span) {
+    return *span.endUs_ref() == 0 and *span.stage_ref() == stage;
+  });
+  if (it == spans.rend()) {
+    return std::nullopt;
+  }
+  it->endNodeName_ref() = nodeName;
+  it->endUs_ref() = getUnixTimeStampUs();
+  // timestamps of spans across nodes are subject to clock skew
+  return std::chrono::microseconds(
+      std::max<int64_t>(0, *it->endUs_ref() - *it->startUs_ref()));
+}
+
+std::vector<std::string>
+sprintPerfSpans(const thrift::PerfEvents& perfEvents) noexcept {
+  std::vector<std::string> spanStrs;
+  for (auto const& span : *perfEvents.spans_ref()) {
+    if (*span.endUs_ref() == 0) {
+      spanStrs.emplace_back(fmt::format(
+          "stage: {}, node: {}, open, start-timestamp-us: {}",
+          *span.stage_ref(),
+          *span.startNodeName_ref(),
+          *span.startUs_ref()));
+      continue;
+    }
+    spanStrs.emplace_back(fmt::format(
+        "stage: {}, node: {} -> {}, duration: {}us, start-timestamp-us: {}",
+        *span.stage_ref(),
+        *span.startNodeName_ref(),
+        *span.endNodeName_ref(),
+        *span.endUs_ref() - *span.startUs_ref(),
+        *span.startUs_ref()));
+  }
+  return spanStrs;
+}
+
+// SpookyHash goes over the data 8 bytes at a time, unlike boost::hash which
+// combines every byte separately
 template <class T>
 int64_t
 generateHashImpl(
     const int64_t version, const std::string& originatorId, const T& value) {
-  size_t seed = 0;
-  boost::hash_combine(seed, version);
-  boost::hash_combine(seed, originatorId);
+  uint64_t seed = folly::hash::twang_mix64(static_cast<uint64_t>(version));
+  seed = folly::hash::SpookyHashV2::Hash64(
+      originatorId.data(), originatorId.size(), seed);
   if (value.has_value()) {
-    boost::hash_combine(seed, value.value());
+    seed = folly::hash::SpookyHashV2::Hash64(
+        value.value().data(), value.value().size(), seed);
   }
   return static_cast<int64_t>(seed);
 }
@@ -911,7 +1008,7 @@ createUnicastRoutesFromMap(
 
 std::vector<thrift::MplsRoute>
 createMplsRoutesWithSelectedNextHopsMap(
-    const std::unordered_map<uint32_t, RibMplsEntry>& mplsRoutes) {
+    const LabelMap<uint32_t, RibMplsEntry>& mplsRoutes) {
   // Build routes to be programmed
   std::vector<thrift::MplsRoute> newRoutes;
 
@@ -1145,4 +1242,45 @@ getThreadBytesImpl(bool isAllocated) {
 }
 
 } // namespace memory
+
+namespace threading {
+
+void
+setThreadAttributes(thrift::ThreadConfig const& threadConfig) {
+  if (not threadConfig.cpu_affinity_ref()->empty()) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : *threadConfig.cpu_affinity_ref()) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    const int err =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (err != 0) {
+      LOG(ERROR) << "Failed to set CPU affinity to ["
+                 << folly::join(", ", *threadConfig.cpu_affinity_ref())
+                 << "]: " << folly::errnoStr(err);
+    }
+  }
+
+  if (threadConfig.nice_ref().has_value()) {
+    // Nice value applies to a single thread on Linux when given its tid
+    const pid_t tid = syscall(SYS_gettid);
+    if (setpriority(PRIO_PROCESS, tid, *threadConfig.nice_ref()) != 0) {
+      LOG(ERROR) << "Failed to set nice value to " << *threadConfig.nice_ref()
+                 << ": " << folly::errnoStr(errno);
+    }
+  }
+}
+
+std::chrono::microseconds
+getThreadCpuTime() {
+  struct timespec ts {};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return std::chrono::microseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+}
+
+} // namespace threading
 } // namespace openr
@@ -10,6 +10,8 @@
 #include <boost/functional/hash.hpp>
 #include <folly/FileUtil.h>
 #include <folly/IPAddress.h>
+#include <folly/small_vector.h>
+#include <folly/io/IOBufQueue.h>
 #include <folly/memory/MallctlHelper.h>
 #include <glog/logging.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
@@ -18,6 +20,7 @@
 
 #include <openr/common/BuildInfo.h>
 #include <openr/common/Constants.h>
+#include <openr/common/LabelMap.h>
 #include <openr/common/MplsUtil.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Types.h>
@@ -123,6 +126,16 @@ getUnixTimeStampMs() noexcept {
       .count();
 }
 
+/**
+ * Return unix timestamp - Number of microseconds elapsed since the epoch
+ */
+inline int64_t
+getUnixTimeStampUs() noexcept {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
 /**
  * Add a perf event to perf event list
  */
@@ -144,6 +157,35 @@ getDurationBetweenPerfEvents(
     const std::string& firstName,
     const std::string& secondName) noexcept;
 
+/**
+ * Tracing of sampled updates. A trace is identified by `traceId` of perf
+ * events and records the stages an update goes through as spans. All span
+ * helpers are no-op on perf events which are not traced.
+ */
+
+// Start tracing with probability `sampleRate`. Return true if traced
+bool maybeStartPerfTrace(
+    thrift::PerfEvents& perfEvents, double sampleRate) noexcept;
+
+// Adopt trace of `from` if `perfEvents` is not yet traced
+void mergePerfTrace(
+    thrift::PerfEvents& perfEvents, const thrift::PerfEvents& from) noexcept;
+
+// Open a span of `stage` on `nodeName`
+void startPerfSpan(
+    thrift::PerfEvents& perfEvents,
+    const std::string& nodeName,
+    folly::StringPiece stage) noexcept;
+
+// Close most recent open span of `stage` and return its duration
+std::optional<std::chrono::microseconds> endPerfSpan(
+    thrift::PerfEvents& perfEvents,
+    const std::string& nodeName,
+    folly::StringPiece stage) noexcept;
+
+std::vector<std::string> sprintPerfSpans(
+    const thrift::PerfEvents& perfEvents) noexcept;
+
 /**
  * Generate hash for each keyval pair
  * as a abstract of version number, originator and values
@@ -224,6 +266,34 @@ writeThriftObjStr(ThriftType const& obj, Serializer& serializer) {
   return result;
 }
 
+/**
+ * Serialize into `out`, replacing its contents. Capacity of `out` and of a
+ * per-thread scratch queue is reused across calls, which saves the buffer
+ * allocations of the variant above for objects serialized repeatedly.
+ */
+template <typename ThriftType, typename Serializer>
+void
+writeThriftObjStr(
+    ThriftType const& obj, Serializer& serializer, std::string& out) {
+  thread_local folly::IOBufQueue scratch{
+      folly::IOBufQueue::cacheChainLength()};
+  serializer.serialize(obj, &scratch);
+  out.clear();
+  scratch.appendToString(out);
+  scratch.clearAndTryReuseLargestBuffer();
+}
+
+/**
+ * Serialize by appending to `queue`, e.g. to hand the buffer on to a socket
+ * or to an IOBuf based transport without copying it into a string.
+ */
+template <typename ThriftType, typename Serializer>
+void
+writeThriftObj(
+    ThriftType const& obj, Serializer& serializer, folly::IOBufQueue& queue) {
+  serializer.serialize(obj, &queue);
+}
+
 template <typename ThriftType, typename Serializer>
 ThriftType
 readThriftObj(folly::IOBuf& buf, Serializer& serializer) {
@@ -232,6 +302,16 @@ readThriftObj(folly::IOBuf& buf, Serializer& serializer) {
   return obj;
 }
 
+// Deserialize from a buffer owned by the caller, e.g. a socket read buffer,
+// without copying it first
+template <typename ThriftType, typename Serializer>
+ThriftType
+readThriftObj(folly::ByteRange buf, Serializer& serializer) {
+  ThriftType obj;
+  serializer.deserialize(buf, obj);
+  return obj;
+}
+
 template <typename ThriftType, typename Serializer>
 ThriftType
 readThriftObjStr(const std::string& buf, Serializer& serializer) {
@@ -414,7 +494,7 @@ std::vector<thrift::NextHopThrift> selectMplsNextHops(
 std::vector<thrift::MplsRoute> createMplsRoutesWithSelectedNextHops(
     const std::vector<thrift::MplsRoute>& routes);
 std::vector<thrift::MplsRoute> createMplsRoutesWithSelectedNextHopsMap(
-    const std::unordered_map<uint32_t, RibMplsEntry>& mplsRoutes);
+    const LabelMap<uint32_t, RibMplsEntry>& mplsRoutes);
 
 std::string getNodeNameFromKey(const std::string& key);
 
@@ -496,6 +576,21 @@ uint64_t getThreadBytesImpl(bool isAllocated);
 
 } // namespace memory
 
+namespace threading {
+
+/**
+ * Apply CPU affinity and nice value of `threadConfig` to the calling thread.
+ * Failures are logged and the thread keeps its current attributes.
+ */
+void setThreadAttributes(thrift::ThreadConfig const& threadConfig);
+
+/**
+ * CPU time consumed by the calling thread so far
+ */
+std::chrono::microseconds getThreadCpuTime();
+
+} // namespace threading
+
 } // namespace openr
 
 //
@@ -504,18 +599,21 @@ uint64_t getThreadBytesImpl(bool isAllocated);
 
 namespace openr {
 
-template <typename Key, typename MetricsWrapper>
+namespace detail {
+
+template <typename Key, typename Prefixes, typename GetMetrics>
 std::set<Key>
-selectBestPrefixMetrics(
-    std::unordered_map<Key, MetricsWrapper> const& prefixes) {
+selectBestPrefixMetricsImpl(Prefixes const& prefixes, GetMetrics getMetrics) {
   // Leveraging tuple for ease of comparision
   std::tuple<int32_t, int32_t, int32_t> bestMetricsTuple{
       std::numeric_limits<int32_t>::min(),
       std::numeric_limits<int32_t>::min(),
       std::numeric_limits<int32_t>::min()};
-  std::set<Key> bestKeys;
+  // Refer to keys of the best metrics seen so far, they're copied into the
+  // returned set only once the best metrics are known
+  folly::small_vector<Key const*, 8> bestKeys;
   for (auto& [key, metricsWrapper] : prefixes) {
-    auto& metrics = metricsWrapper.metrics_ref().value();
+    auto& metrics = getMetrics(metricsWrapper);
     std::tuple<int32_t, int32_t, int32_t> metricsTuple{
         metrics.path_preference_ref().value(), /* prefer-higher */
         metrics.source_preference_ref().value(), /* prefer-higher */
@@ -526,51 +624,43 @@ selectBestPrefixMetrics(
       continue;
     }
 
-    // Clear set and update best metric if this is a new best metric
+    // Clear keys and update best metric if this is a new best metric
     if (metricsTuple > bestMetricsTuple) {
       bestMetricsTuple = metricsTuple;
       bestKeys.clear();
     }
 
     // Current metrics is either best or same as best metrics we've seen so far
-    bestKeys.emplace(key);
+    bestKeys.emplace_back(&key);
   }
 
-  return bestKeys;
+  std::set<Key> result;
+  for (auto const* key : bestKeys) {
+    result.emplace(*key);
+  }
+  return result;
 }
 
+} // namespace detail
+
 template <typename Key, typename MetricsWrapper>
 std::set<Key>
 selectBestPrefixMetrics(
-    std::unordered_map<Key, std::shared_ptr<MetricsWrapper>> const& prefixes) {
-  // Leveraging tuple for ease of comparision
-  std::tuple<int32_t, int32_t, int32_t> bestMetricsTuple{
-      std::numeric_limits<int32_t>::min(),
-      std::numeric_limits<int32_t>::min(),
-      std::numeric_limits<int32_t>::min()};
-  std::set<Key> bestKeys;
-  for (auto& [key, metricsWrapper] : prefixes) {
-    auto& metrics = metricsWrapper->metrics_ref().value();
-    std::tuple<int32_t, int32_t, int32_t> metricsTuple{
-        metrics.path_preference_ref().value(), /* prefer-higher */
-        metrics.source_preference_ref().value(), /* prefer-higher */
-        metrics.distance_ref().value() * -1 /* prefer-lower */};
-
-    // Skip if this is less than best metrics we've seen so far
-    if (metricsTuple < bestMetricsTuple) {
-      continue;
-    }
-
-    // Clear set and update best metric if this is a new best metric
-    if (metricsTuple > bestMetricsTuple) {
-      bestMetricsTuple = metricsTuple;
-      bestKeys.clear();
-    }
-
-    // Current metrics is either best or same as best metrics we've seen so far
-    bestKeys.emplace(key);
-  }
+    std::unordered_map<Key, MetricsWrapper> const& prefixes) {
+  return detail::selectBestPrefixMetricsImpl<Key>(
+      prefixes, [](MetricsWrapper const& metricsWrapper) -> auto& {
+        return metricsWrapper.metrics_ref().value();
+      });
+}
 
-  return bestKeys;
+template <typename Key, typename MetricsWrapper>
+std::set<Key>
+selectBestPrefixMetrics(
+    std::unordered_map<Key, std::shared_ptr<MetricsWrapper>> const& prefixes) {
+  return detail::selectBestPrefixMetricsImpl<Key>(
+      prefixes,
+      [](std::shared_ptr<MetricsWrapper> const& metricsWrapper) -> auto& {
+        return metricsWrapper->metrics_ref().value();
+      });
 }
 } // namespace openr
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <folly/io/async/EventBase.h>
+#include <openr/common/AdaptiveDebounce.h>
+
+namespace openr {
+
+namespace {
+const std::chrono::milliseconds kMinWindow{10};
+const std::chrono::milliseconds kMaxWindow{100};
+} // namespace
+
+TEST(AdaptiveDebounce, IsolatedEvent) {
+  folly::EventBase evb;
+  std::vector<AdaptiveDebounce::Batch> batches;
+  AdaptiveDebounce debouncedFn(
+      &evb, kMinWindow, kMaxWindow, [&]() noexcept {
+        batches.emplace_back(debouncedFn.getBatch());
+      });
+
+  debouncedFn();
+  evb.loop();
+  ASSERT_EQ(1, batches.size());
+  EXPECT_TRUE(batches.back().immediate);
+  EXPECT_EQ(1, batches.back().numEvents);
+  EXPECT_LT(batches.back().waited, kMinWindow);
+
+  // event after a quiet period is isolated as well
+  /* sleep override */
+  std::this_thread::sleep_for(kMaxWindow);
+  debouncedFn();
+  evb.loop();
+  ASSERT_EQ(2, batches.size());
+  EXPECT_TRUE(batches.back().immediate);
+}
+
+TEST(AdaptiveDebounce, EventStorm) {
+  folly::EventBase evb;
+  std::vector<AdaptiveDebounce::Batch> batches;
+  AdaptiveDebounce debouncedFn(
+      &evb, kMinWindow, kMaxWindow, [&]() noexcept {
+        batches.emplace_back(debouncedFn.getBatch());
+      });
+
+  // window grows from immediate over 10ms to 20ms
+  for (int i = 0; i < 3; ++i) {
+    debouncedFn();
+  }
+  evb.loop();
+  ASSERT_EQ(1, batches.size());
+  EXPECT_TRUE(batches.back().immediate);
+  EXPECT_EQ(3, batches.back().numEvents);
+  EXPECT_GE(batches.back().waited, 2 * kMinWindow);
+  EXPECT_LT(batches.back().waited, kMaxWindow);
+
+  // follow-up event isn't isolated, waits at least the min window
+  debouncedFn();
+  evb.loop();
+  ASSERT_EQ(2, batches.size());
+  EXPECT_FALSE(batches.back().immediate);
+  EXPECT_EQ(1, batches.back().numEvents);
+  EXPECT_GE(batches.back().waited, kMinWindow);
+
+  // window is bounded regardless of the number of events
+  for (int i = 0; i < 100; ++i) {
+    debouncedFn();
+  }
+  evb.loop();
+  ASSERT_EQ(3, batches.size());
+  EXPECT_EQ(100, batches.back().numEvents);
+  EXPECT_GE(batches.back().waited, kMaxWindow);
+  EXPECT_LT(batches.back().waited, kMaxWindow + kMaxWindow / 2);
+}
+
+TEST(AdaptiveDebounce, CallbackCost) {
+  folly::EventBase evb;
+  const std::chrono::milliseconds cost{30};
+  size_t numCalls{0};
+  AdaptiveDebounce debouncedFn(
+      &evb, kMinWindow, kMaxWindow, [&]() noexcept {
+        ++numCalls;
+        /* sleep override */
+        std::this_thread::sleep_for(cost);
+      });
+
+  debouncedFn();
+  evb.loop();
+  EXPECT_EQ(1, numCalls);
+  EXPECT_GE(debouncedFn.getLastCallbackCost(), cost);
+
+  // window starts at the cost of the last callback
+  auto const start = std::chrono::steady_clock::now();
+  debouncedFn();
+  evb.loop();
+  EXPECT_EQ(2, numCalls);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 2 * cost);
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  return RUN_ALL_TESTS();
+}
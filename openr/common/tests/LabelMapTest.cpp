@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/LabelMap.h>
+
+using openr::LabelMap;
+
+namespace {
+template <typename Label, typename T>
+std::map<Label, T>
+toMap(LabelMap<Label, T> const& labelMap) {
+  return std::map<Label, T>(labelMap.begin(), labelMap.end());
+}
+} // namespace
+
+TEST(LabelMapTest, Basic) {
+  LabelMap<int32_t, std::string> labelMap;
+  EXPECT_TRUE(labelMap.empty());
+  EXPECT_EQ(labelMap.end(), labelMap.begin());
+  EXPECT_EQ(labelMap.end(), labelMap.find(100));
+
+  // labels within a page and across pages
+  EXPECT_TRUE(labelMap.emplace(100, "a").second);
+  EXPECT_TRUE(labelMap.emplace(101, "b").second);
+  EXPECT_TRUE(labelMap.emplace(50000, "c").second);
+  EXPECT_TRUE(labelMap.emplace(1, "d").second);
+  EXPECT_EQ(4, labelMap.size());
+
+  // emplace keeps the present entry, insert_or_assign replaces it
+  auto [it, added] = labelMap.emplace(100, "e");
+  EXPECT_FALSE(added);
+  EXPECT_EQ("a", it->second);
+  EXPECT_FALSE(labelMap.insert_or_assign(100, "f").second);
+  EXPECT_EQ("f", labelMap.at(100));
+  EXPECT_TRUE(labelMap.insert_or_assign(1048575, "g").second);
+  EXPECT_EQ(5, labelMap.size());
+
+  EXPECT_EQ(1, labelMap.count(50000));
+  EXPECT_EQ(0, labelMap.count(50001));
+  EXPECT_THROW(labelMap.at(50001), std::out_of_range);
+  ASSERT_NE(labelMap.end(), labelMap.find(101));
+  EXPECT_EQ(101, labelMap.find(101)->first);
+
+  // iteration in label order
+  std::vector<int32_t> labels;
+  for (auto const& [label, _] : labelMap) {
+    labels.emplace_back(label);
+  }
+  EXPECT_EQ(std::vector<int32_t>({1, 100, 101, 50000, 1048575}), labels);
+
+  // erase by label and by iterator, releasing pages
+  EXPECT_EQ(1, labelMap.erase(50000));
+  EXPECT_EQ(0, labelMap.erase(50000));
+  auto next = labelMap.erase(labelMap.find(1));
+  ASSERT_NE(labelMap.end(), next);
+  EXPECT_EQ(100, next->first);
+  next = labelMap.erase(labelMap.find(1048575));
+  EXPECT_EQ(labelMap.end(), next);
+  EXPECT_EQ(
+      (std::map<int32_t, std::string>{{100, "f"}, {101, "b"}}),
+      toMap(labelMap));
+
+  // copies are deep
+  auto copy = labelMap;
+  EXPECT_EQ(labelMap, copy);
+  copy.at(101) = "h";
+  EXPECT_NE(labelMap, copy);
+  EXPECT_EQ("b", labelMap.at(101));
+
+  auto moved = std::move(copy);
+  EXPECT_EQ(2, moved.size());
+  EXPECT_EQ("h", moved.at(101));
+
+  labelMap.clear();
+  EXPECT_TRUE(labelMap.empty());
+  EXPECT_EQ(labelMap.end(), labelMap.begin());
+}
+
+TEST(LabelMapTest, RandomOperations) {
+  // mirror random operations on a std::map
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<uint32_t> labels(0, 4000);
+  LabelMap<uint32_t, uint32_t> labelMap;
+  std::map<uint32_t, uint32_t> expected;
+  for (uint32_t i = 0; i < 20000; ++i) {
+    const auto label = labels(rng);
+    if (rng() % 3) {
+      labelMap.insert_or_assign(label, i);
+      expected.insert_or_assign(label, i);
+    } else {
+      EXPECT_EQ(expected.erase(label), labelMap.erase(label));
+    }
+    ASSERT_EQ(expected.size(), labelMap.size());
+  }
+  EXPECT_EQ(expected, toMap(labelMap));
+
+  // erase every other entry while iterating
+  bool erase = true;
+  for (auto it = labelMap.begin(); it != labelMap.end(); erase = not erase) {
+    if (erase) {
+      expected.erase(it->first);
+      it = labelMap.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  EXPECT_EQ(expected, toMap(labelMap));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
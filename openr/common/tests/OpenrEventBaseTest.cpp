@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include <openr/common/OpenrEventBase.h>
+#include <openr/messaging/Queue.h>
 
 using namespace openr;
 
@@ -156,6 +157,29 @@ TEST_F(OpenrEventBaseTestFixture, TimeoutTest) {
   EXPECT_LE(std::chrono::milliseconds(200), elapsedMs);
 }
 
+TEST_F(OpenrEventBaseTestFixture, TimerWheelTest) {
+  folly::Baton waitBaton;
+  std::unique_ptr<TimerWheel::Timer> timer;
+
+  const auto startTs = std::chrono::steady_clock::now();
+  evb.getEvb()->runInEventBaseThread([&]() noexcept {
+    // same wheel for all timers of the event base
+    EXPECT_EQ(&evb.getTimerWheel(), &evb.getTimerWheel());
+    timer = evb.getTimerWheel().makeTimer([&]() noexcept { waitBaton.post(); });
+    timer->scheduleTimeout(std::chrono::milliseconds(200));
+    EXPECT_EQ(1, evb.getTimerWheel().getNumScheduled());
+  });
+
+  waitBaton.wait();
+  const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTs);
+  EXPECT_LE(std::chrono::milliseconds(200), elapsedMs);
+  evb.getEvb()->runInEventBaseThreadAndWait([&]() noexcept {
+    EXPECT_EQ(0, evb.getTimerWheel().getNumScheduled());
+    timer.reset();
+  });
+}
+
 TEST_F(OpenrEventBaseTestFixture, ZmqSocketPollTest) {
   const auto msg = fbzmq::Message::from(std::string("test message")).value();
   const size_t expectedMsgs{16};
@@ -241,6 +265,94 @@ TEST_F(OpenrEventBaseTestFixture, SocketFdPollTest) {
   EXPECT_TRUE(true);
 }
 
+#if FOLLY_HAS_COROUTINES
+TEST_F(OpenrEventBaseTestFixture, CoroTaskTest) {
+  messaging::RWQueue<int> queue;
+  folly::Baton waitBaton;
+  int sum{0};
+
+  // Co-routine reading from queue until it gets closed
+  auto task = [](messaging::RWQueue<int>& q,
+                 int& total,
+                 folly::Baton<>& baton) -> folly::coro::Task<void> {
+    while (true) {
+      auto maybeVal = co_await q.getCoro();
+      if (maybeVal.hasError()) {
+        break;
+      }
+      total += maybeVal.value();
+      if (total == 6) {
+        baton.post();
+      }
+    }
+  };
+  evb.getEvb()->runInEventBaseThreadAndWait(
+      [&]() { evb.addCoroTask(task(queue, sum, waitBaton)); });
+
+  queue.push(1);
+  queue.push(2);
+  queue.push(3);
+  waitBaton.wait();
+  EXPECT_EQ(6, sum);
+
+  // Task terminates on close, which is awaited by `stop()` in TearDown
+  queue.close();
+}
+#endif
+
+TEST(OpenrEventBaseTest, ProfileCallbackTest) {
+  OpenrEventBase evb;
+  evb.setEvbName("test");
+
+  EXPECT_EQ(3, evb.profileCallback("fast", []() { return 3; }));
+  evb.profileCallback("slow", []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  });
+  evb.profileCallback("slow", []() {});
+
+  const auto profile = evb.getProfile();
+  EXPECT_EQ("test", *profile.evb_name_ref());
+  ASSERT_EQ(2, profile.slow_callbacks_ref()->size());
+
+  // slowest callback comes first
+  auto const& slow = profile.slow_callbacks_ref()->at(0);
+  EXPECT_EQ("slow", *slow.name_ref());
+  EXPECT_EQ(2, *slow.count_ref());
+  EXPECT_LE(20000, *slow.max_us_ref());
+  EXPECT_LE(*slow.max_us_ref(), *slow.total_us_ref());
+  EXPECT_EQ("fast", *profile.slow_callbacks_ref()->at(1).name_ref());
+}
+
+TEST_F(OpenrEventBaseTestFixture, ProfileTimeoutAndLoopTest) {
+  folly::Baton waitBaton;
+
+  evb.getEvb()->runInEventBaseThread([&]() noexcept {
+    evb.scheduleTimeout(
+        std::chrono::milliseconds(10),
+        [&]() {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          waitBaton.post();
+        },
+        "slow_timeout");
+  });
+  waitBaton.wait();
+
+  // Read profile from evb thread to make sure timeout callback has returned
+  thrift::EventBaseProfile profile;
+  evb.getEvb()->runInEventBaseThreadAndWait(
+      [&]() { profile = evb.getProfile(); });
+
+  ASSERT_EQ(1, profile.slow_callbacks_ref()->size());
+  auto const& callback = profile.slow_callbacks_ref()->at(0);
+  EXPECT_EQ("slow_timeout", *callback.name_ref());
+  EXPECT_EQ(1, *callback.count_ref());
+  EXPECT_LE(20000, *callback.max_us_ref());
+
+  // Loop iteration running the timeout is accounted as busy time
+  EXPECT_LE(20000, *profile.loop_time_max_us_ref());
+  EXPECT_LE(*profile.loop_time_p50_us_ref(), *profile.loop_time_max_us_ref());
+}
+
 int
 main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <folly/Random.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/PackedPrefix.h>
+#include <openr/common/PrefixTrie.h>
+
+using openr::PackedPrefix;
+using openr::PrefixTrie;
+
+namespace {
+folly::CIDRNetwork
+toNetwork(std::string const& prefix) {
+  return folly::IPAddress::createNetwork(prefix);
+}
+} // namespace
+
+TEST(PrefixTrieTest, LongestPrefixMatch) {
+  PrefixTrie<std::string> trie;
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ(nullptr, trie.longestPrefixMatch(toNetwork("10.0.0.1/32")));
+
+  EXPECT_TRUE(trie.insert(toNetwork("10.0.0.0/8"), "a"));
+  EXPECT_TRUE(trie.insert(toNetwork("10.1.0.0/16"), "b"));
+  EXPECT_TRUE(trie.insert(toNetwork("10.1.2.0/24"), "c"));
+  EXPECT_TRUE(trie.insert(toNetwork("10.2.0.0/16"), "d"));
+  EXPECT_TRUE(trie.insert(toNetwork("::/0"), "e"));
+  EXPECT_TRUE(trie.insert(toNetwork("fc00::/7"), "f"));
+  EXPECT_EQ(6, trie.size());
+
+  // replacing a value doesn't add a prefix
+  EXPECT_FALSE(trie.insert(toNetwork("10.2.0.0/16"), "g"));
+  EXPECT_EQ(6, trie.size());
+
+  auto lookup = [&](std::string const& prefix) -> std::string {
+    auto match = trie.longestPrefixMatch(toNetwork(prefix));
+    return match ? match->second : "";
+  };
+  EXPECT_EQ("c", lookup("10.1.2.3/32"));
+  EXPECT_EQ("c", lookup("10.1.2.0/24"));
+  EXPECT_EQ("b", lookup("10.1.3.0/24"));
+  EXPECT_EQ("b", lookup("10.1.0.0/16"));
+  EXPECT_EQ("a", lookup("10.1.0.0/15"));
+  EXPECT_EQ("g", lookup("10.2.255.255/32"));
+  EXPECT_EQ("a", lookup("10.3.0.0/16"));
+  EXPECT_EQ("", lookup("10.0.0.0/7"));
+  EXPECT_EQ("", lookup("11.0.0.0/8"));
+
+  // families are separate, ::/0 doesn't match IPv4
+  EXPECT_EQ("f", lookup("fd00::1/128"));
+  EXPECT_EQ("e", lookup("2001:db8::/32"));
+  EXPECT_EQ("", lookup("0.0.0.0/0"));
+
+  // host bits are masked
+  EXPECT_EQ(
+      toNetwork("10.1.2.0/24"),
+      trie.longestPrefixMatch({folly::IPAddress("10.1.2.3"), 24})->first);
+
+  // exact match only
+  EXPECT_NE(nullptr, trie.find(toNetwork("10.1.0.0/16")));
+  EXPECT_EQ(nullptr, trie.find(toNetwork("10.1.2.3/32")));
+  EXPECT_EQ(nullptr, trie.find(toNetwork("10.0.0.0/9")));
+}
+
+TEST(PrefixTrieTest, Erase) {
+  PrefixTrie<int> trie;
+  trie.insert(toNetwork("10.0.0.0/8"), 1);
+  trie.insert(toNetwork("10.1.0.0/16"), 2);
+  trie.insert(toNetwork("10.2.0.0/16"), 3);
+
+  // nodes joining sub-tries aren't entries
+  EXPECT_FALSE(trie.erase(toNetwork("10.0.0.0/14")));
+  EXPECT_FALSE(trie.erase(toNetwork("10.3.0.0/16")));
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.0.0.0/8")));
+  EXPECT_FALSE(trie.erase(toNetwork("10.0.0.0/8")));
+  EXPECT_EQ(2, trie.size());
+  EXPECT_EQ(nullptr, trie.longestPrefixMatch(toNetwork("10.3.0.0/16")));
+  EXPECT_EQ(2, trie.longestPrefixMatch(toNetwork("10.1.1.1/32"))->second);
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.1.0.0/16")));
+  EXPECT_EQ(nullptr, trie.longestPrefixMatch(toNetwork("10.1.1.1/32")));
+  EXPECT_EQ(3, trie.longestPrefixMatch(toNetwork("10.2.1.1/32"))->second);
+
+  trie.clear();
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ(nullptr, trie.longestPrefixMatch(toNetwork("10.2.1.1/32")));
+}
+
+TEST(PrefixTrieTest, CoveringPrefixes) {
+  PrefixTrie<int> trie;
+  trie.insert(toNetwork("10.0.0.0/8"), 1);
+  trie.insert(toNetwork("10.1.0.0/16"), 2);
+  trie.insert(toNetwork("10.1.2.0/24"), 3);
+  trie.insert(toNetwork("10.2.0.0/16"), 4);
+
+  auto lookup = [&](std::string const& prefix) {
+    std::vector<int> values;
+    for (auto const* entry : trie.getCoveringPrefixes(toNetwork(prefix))) {
+      values.emplace_back(entry->second);
+    }
+    return values;
+  };
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), lookup("10.1.2.3/32"));
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), lookup("10.1.2.0/24"));
+  EXPECT_EQ(std::vector<int>({1, 2}), lookup("10.1.3.0/24"));
+  EXPECT_EQ(std::vector<int>({1}), lookup("10.1.0.0/15"));
+  EXPECT_EQ(std::vector<int>({1, 4}), lookup("10.2.0.1/32"));
+  EXPECT_EQ(std::vector<int>(), lookup("11.0.0.0/8"));
+}
+
+//
+// Compare against a scan over all prefixes, as inserts and erases reshape the
+// trie
+//
+TEST(PrefixTrieTest, RandomizedAgainstScan) {
+  PrefixTrie<int> trie;
+  std::map<folly::CIDRNetwork, int> prefixes;
+
+  // prefixes in a small address range so that they nest and diverge often
+  auto randomPrefix = [](uint8_t maxLen) {
+    auto addr = folly::IPAddressV4::fromLongHBO(
+        0x0a000000 | (folly::Random::rand32() & 0x00ff0f00));
+    uint8_t len = folly::Random::rand32(maxLen + 1);
+    return folly::CIDRNetwork(folly::IPAddress(addr).mask(len), len);
+  };
+
+  for (int i = 0; i < 10000; ++i) {
+    auto prefix = randomPrefix(24);
+    if (folly::Random::oneIn(3)) {
+      EXPECT_EQ(prefixes.erase(prefix) > 0, trie.erase(prefix));
+    } else {
+      EXPECT_EQ(prefixes.count(prefix) == 0, trie.insert(prefix, i));
+      prefixes[prefix] = i;
+    }
+    ASSERT_EQ(prefixes.size(), trie.size());
+
+    auto query = randomPrefix(32);
+    std::optional<std::pair<folly::CIDRNetwork, int>> expected;
+    for (auto const& [entryPrefix, value] : prefixes) {
+      if (entryPrefix.second <= query.second and
+          query.first.mask(entryPrefix.second) == entryPrefix.first and
+          (not expected or entryPrefix.second > expected->first.second)) {
+        expected = std::make_pair(entryPrefix, value);
+      }
+    }
+    auto match = trie.longestPrefixMatch(query);
+    ASSERT_EQ(expected.has_value(), match != nullptr);
+    if (expected) {
+      EXPECT_EQ(*expected, *match);
+    }
+  }
+}
+
+//
+// Packed prefixes agree with folly on masking, matching and common length
+//
+TEST(PackedPrefixTest, AgainstIPAddress) {
+  auto randomAddress = [](bool isV4) {
+    std::array<uint8_t, 16> bytes{};
+    for (auto& byte : bytes) {
+      byte = folly::Random::rand32(256);
+    }
+    return folly::IPAddress::fromBinary(
+        folly::ByteRange(bytes.data(), isV4 ? 4 : 16));
+  };
+
+  for (int i = 0; i < 10000; ++i) {
+    const bool isV4 = folly::Random::oneIn(2);
+    const auto addr = randomAddress(isV4);
+    const uint8_t len = folly::Random::rand32(addr.bitCount() + 1);
+    const folly::CIDRNetwork network{addr.mask(len), len};
+
+    const PackedPrefix prefix(folly::CIDRNetwork{addr, len});
+    EXPECT_EQ(isV4, prefix.isV4());
+    EXPECT_EQ(len, prefix.length());
+    EXPECT_EQ(network, prefix.toNetwork());
+    EXPECT_EQ(PackedPrefix(network), prefix);
+    for (size_t bit = 0; bit < addr.bitCount(); ++bit) {
+      EXPECT_EQ(network.first.getNthMSBit(bit), prefix.getNthMSBit(bit));
+    }
+
+    const uint8_t shorter = folly::Random::rand32(len + 1);
+    EXPECT_EQ(
+        folly::CIDRNetwork(addr.mask(shorter), shorter),
+        prefix.mask(shorter).toNetwork());
+    EXPECT_TRUE(prefix.mask(shorter).covers(prefix));
+
+    // other prefix sharing a random number of leading bits
+    auto other = PackedPrefix(randomAddress(isV4));
+    const size_t common = folly::Random::rand32(addr.bitCount() + 1);
+    for (size_t bit = 0; bit < common; ++bit) {
+      other.setNthMSBit(bit, addr.getNthMSBit(bit));
+    }
+    size_t expected = 0;
+    while (expected < addr.bitCount() and
+           addr.getNthMSBit(expected) ==
+               other.toNetwork().first.getNthMSBit(expected)) {
+      ++expected;
+    }
+    EXPECT_EQ(std::min<size_t>(expected, len), prefix.getCommonLength(other));
+    EXPECT_EQ(expected >= len, prefix.covers(other));
+  }
+}
+
+int
+main(int argc, char** argv) {
+  // Basic initialization
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <fb303/ServiceData.h>
+#include <folly/init/Init.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/StatCounter.h>
+
+namespace fb303 = facebook::fb303;
+
+using namespace openr;
+
+TEST(StatCounterTest, ExportTypes) {
+  StatCounter countCounter{"test.stat_counter.count_type", fb303::COUNT};
+  StatCounter sumCounter{"test.stat_counter.sum_type", fb303::SUM};
+  StatCounter avgCounter{"test.stat_counter.avg_type", fb303::AVG};
+
+  countCounter.add();
+  countCounter.add();
+  countCounter.add();
+  sumCounter.add(10);
+  sumCounter.add(20);
+  avgCounter.add(10);
+  avgCounter.add(20);
+
+  // Nothing is reported before flush
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(0, counters.count("test.stat_counter.count_type.count"));
+  EXPECT_EQ(0, counters.count("test.stat_counter.sum_type.sum"));
+
+  // Same values as if reported via addStatValue
+  StatCounter::flushAll();
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(3, counters.at("test.stat_counter.count_type.count"));
+  EXPECT_EQ(30, counters.at("test.stat_counter.sum_type.sum"));
+  EXPECT_EQ(15, counters.at("test.stat_counter.avg_type.avg"));
+
+  // Values are reported only once
+  StatCounter::flushAll();
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(3, counters.at("test.stat_counter.count_type.count"));
+  EXPECT_EQ(30, counters.at("test.stat_counter.sum_type.sum"));
+}
+
+TEST(StatCounterTest, MultipleThreads) {
+  const int kNumThreads{4};
+  const int kNumAdds{100000};
+  StatCounter counter{"test.stat_counter.threads", fb303::SUM};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < kNumAdds; ++j) {
+        counter.add(2);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Values aggregated by exited threads are kept
+  StatCounter::flushAll();
+
+  EXPECT_EQ(
+      2 * kNumThreads * kNumAdds,
+      fb303::fbData->getCounters().at("test.stat_counter.threads.sum"));
+}
+
+TEST(StatCounterTest, ResetData) {
+  StatCounter counter{"test.stat_counter.reset", fb303::SUM};
+  counter.add(5);
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  // Stat is exported again after fb303 reset
+  counter.add(7);
+  StatCounter::flushAll();
+  EXPECT_EQ(7, fb303::fbData->getCounters().at("test.stat_counter.reset.sum"));
+}
+
+int
+main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  return RUN_ALL_TESTS();
+}
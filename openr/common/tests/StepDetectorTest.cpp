@@ -178,6 +178,50 @@ TEST(StepDetectorTest, SlowBoiling) {
   }
 }
 
+// time series with late samples and gaps, as RTTs of a neighbor are
+TEST(StepDetectorTest, GapsAndLateSamples) {
+  std::vector<int64_t> steps;
+  auto stepCb = [&](const int64_t& avg) { steps.push_back(avg); };
+
+  openr::StepDetector<int64_t, std::chrono::milliseconds> stepDetector(
+      getTestConfig(),
+      std::chrono::milliseconds(100) /* sampling period */,
+      stepCb /* callback function */);
+
+  // several samples per period
+  int64_t timeStamp = 0;
+  for (size_t i = 0; i < 3 * SLOW_WINDOW_SIZE; ++i) {
+    EXPECT_TRUE(
+        stepDetector.addValue(std::chrono::milliseconds(timeStamp), 100));
+    timeStamp += 50;
+  }
+  EXPECT_TRUE(steps.empty());
+
+  // samples older than the slow window are dropped, older than the fast one
+  // only go to the slow window
+  EXPECT_FALSE(stepDetector.addValue(std::chrono::milliseconds(0), 1000));
+  EXPECT_FALSE(stepDetector.addValue(
+      std::chrono::milliseconds(timeStamp - 100 * FAST_WINDOW_SIZE - 100),
+      1000));
+  EXPECT_TRUE(steps.empty());
+
+  // windows are empty after a gap longer than the slow window, the next
+  // samples set the mean
+  timeStamp += 100 * SLOW_WINDOW_SIZE;
+  EXPECT_TRUE(stepDetector.addValue(std::chrono::milliseconds(timeStamp), 200));
+  ASSERT_EQ(1, steps.size());
+  EXPECT_EQ(200, steps.back());
+
+  // gap shorter than the slow window, the fast window catches up first
+  timeStamp += 100 * FAST_WINDOW_SIZE;
+  for (size_t i = 0; i < SLOW_WINDOW_SIZE; ++i) {
+    stepDetector.addValue(std::chrono::milliseconds(timeStamp), 400);
+    timeStamp += 100;
+  }
+  ASSERT_EQ(2, steps.size());
+  EXPECT_EQ(400, steps.back());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/StringInterner.h>
+
+TEST(StringInternerTest, ApiTest) {
+  openr::StringInterner interner;
+  EXPECT_EQ(0, interner.size());
+  EXPECT_FALSE(interner.find("node-1").has_value());
+
+  // ids are dense and handed out in insertion order
+  EXPECT_EQ(0, interner.intern("node-1"));
+  EXPECT_EQ(1, interner.intern("node-2"));
+  EXPECT_EQ(0, interner.intern(std::string("node-1")));
+  EXPECT_EQ(2, interner.size());
+  EXPECT_EQ(1, interner.find("node-2").value());
+
+  EXPECT_EQ("node-1", interner.get(0));
+  EXPECT_EQ("node-2", interner.get(1));
+  EXPECT_THROW(interner.get(2), std::out_of_range);
+
+  // equal strings share a single copy
+  EXPECT_EQ(&interner.get(0), &interner.internAndGet("node-1"));
+
+  // references remain valid as the table grows
+  auto const& first = interner.get(0);
+  for (int i = 0; i < 10000; ++i) {
+    interner.intern(std::to_string(i));
+  }
+  EXPECT_EQ(&first, &interner.get(0));
+  EXPECT_EQ("node-1", first);
+}
+
+TEST(StringInternerTest, ConcurrentIntern) {
+  openr::StringInterner interner;
+  auto const numThreads = 4;
+  auto const numStrings = 1000;
+  std::vector<std::vector<openr::StringInterner::Id>> ids(numThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < numStrings; ++i) {
+        ids.at(t).emplace_back(interner.intern(std::to_string(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // every thread must have observed the same id for a given string
+  EXPECT_EQ(numStrings, interner.size());
+  for (int t = 1; t < numThreads; ++t) {
+    EXPECT_EQ(ids.at(0), ids.at(t));
+  }
+  for (int i = 0; i < numStrings; ++i) {
+    EXPECT_EQ(std::to_string(i), interner.get(ids.at(0).at(i)));
+  }
+}
+
+int
+main(int argc, char** argv) {
+  // Basic initialization
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <folly/io/async/EventBase.h>
+#include <openr/common/TimerWheel.h>
+
+namespace chrono = std::chrono;
+
+namespace openr {
+
+namespace {
+const chrono::milliseconds kTick{10};
+} // namespace
+
+TEST(TimerWheelTest, FireInOrder) {
+  folly::EventBase evb;
+  TimerWheel wheel(&evb, kTick, 8, "test");
+
+  // timeouts spread over several rotations of the wheel
+  const std::vector<int> timeoutsMs{250, 0, 35, 100, 5, 80, 35};
+  std::vector<int> fired;
+  std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+  auto const start = chrono::steady_clock::now();
+  for (size_t i = 0; i < timeoutsMs.size(); ++i) {
+    timers.emplace_back(wheel.makeTimer([&, i]() noexcept {
+      auto const elapsed = chrono::steady_clock::now() - start;
+      // never early
+      EXPECT_GE(elapsed, chrono::milliseconds(timeoutsMs[i]));
+      fired.emplace_back(timeoutsMs[i]);
+    }));
+    timers.back()->scheduleTimeout(chrono::milliseconds(timeoutsMs[i]));
+    EXPECT_TRUE(timers.back()->isScheduled());
+  }
+  EXPECT_EQ(timeoutsMs.size(), wheel.getNumScheduled());
+
+  evb.loop();
+
+  EXPECT_EQ(std::vector<int>({0, 5, 35, 35, 80, 100, 250}), fired);
+  EXPECT_EQ(0, wheel.getNumScheduled());
+  for (auto const& timer : timers) {
+    EXPECT_FALSE(timer->isScheduled());
+  }
+}
+
+TEST(TimerWheelTest, CancelAndReschedule) {
+  folly::EventBase evb;
+  TimerWheel wheel(&evb, kTick, 4, "test");
+
+  int count1{0};
+  int count2{0};
+  auto timer1 = wheel.makeTimer([&]() noexcept { ++count1; });
+  auto timer2 = wheel.makeTimer([&]() noexcept { ++count2; });
+
+  // cancelled timer never fires
+  timer1->scheduleTimeout(chrono::milliseconds(20));
+  timer1->cancelTimeout();
+  EXPECT_FALSE(timer1->isScheduled());
+  EXPECT_EQ(0, wheel.getNumScheduled());
+
+  // rescheduling replaces previous timeout
+  timer2->scheduleTimeout(chrono::milliseconds(20));
+  timer2->scheduleTimeout(chrono::milliseconds(60));
+  EXPECT_EQ(1, wheel.getNumScheduled());
+
+  auto const start = chrono::steady_clock::now();
+  evb.loop();
+  EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(60));
+  EXPECT_EQ(0, count1);
+  EXPECT_EQ(1, count2);
+}
+
+TEST(TimerWheelTest, CallbackOwnsTimers) {
+  folly::EventBase evb;
+  TimerWheel wheel(&evb, kTick, 4, "test");
+
+  // periodic timer, rescheduling itself
+  int periodicCount{0};
+  std::unique_ptr<TimerWheel::Timer> periodic;
+  periodic = wheel.makeTimer([&]() noexcept {
+    if (++periodicCount < 5) {
+      periodic->scheduleTimeout(kTick);
+    }
+  });
+  periodic->scheduleTimeout(kTick);
+
+  // timer destroying itself, and a timer of the same tick
+  std::unique_ptr<TimerWheel::Timer> other;
+  std::unique_ptr<TimerWheel::Timer> oneshot;
+  oneshot = wheel.makeTimer([&]() noexcept {
+    oneshot.reset();
+    other.reset();
+  });
+  other = wheel.makeTimer([&]() noexcept { ADD_FAILURE(); });
+  oneshot->scheduleTimeout(chrono::milliseconds(30));
+  other->scheduleTimeout(chrono::milliseconds(30));
+
+  evb.loop();
+
+  EXPECT_EQ(5, periodicCount);
+  EXPECT_EQ(nullptr, oneshot);
+  EXPECT_EQ(nullptr, other);
+  EXPECT_EQ(0, wheel.getNumScheduled());
+}
+
+TEST(TimerWheelTest, TimerOutlivesWheel) {
+  folly::EventBase evb;
+  auto wheel = std::make_unique<TimerWheel>(&evb, kTick, 4, "test");
+
+  auto timer = wheel->makeTimer([]() noexcept { ADD_FAILURE(); });
+  timer->scheduleTimeout(chrono::milliseconds(100));
+  wheel.reset();
+
+  EXPECT_FALSE(timer->isScheduled());
+  evb.loop();
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  return RUN_ALL_TESTS();
+}
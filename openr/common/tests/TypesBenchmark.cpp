@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fmt/format.h>
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/Types.h>
+
+namespace openr {
+
+namespace {
+
+// v1 and v2 prefix keys of numKeys distinct prefixes
+std::vector<std::string>
+createKeys(size_t numKeys, bool isV2) {
+  std::vector<std::string> keys;
+  keys.reserve(numKeys);
+  for (size_t i = 0; i < numKeys; ++i) {
+    const auto prefix = folly::IPAddress::createNetwork(
+        fmt::format("fc00:{:x}:{:x}::/64", i >> 16, i & 0xffff));
+    const PrefixKey key(fmt::format("node-{}", i % 100), prefix, "area-1");
+    keys.emplace_back(isV2 ? key.getPrefixKeyV2() : key.getPrefixKey());
+  }
+  return keys;
+}
+
+/*
+ * Matching of the prefix key regex alone, as done by PrefixKey::fromStr()
+ * before keys got parsed by hand
+ */
+void
+BM_PrefixKeyRegexMatch(uint32_t iters, size_t numKeys) {
+  std::vector<std::string> keys;
+  BENCHMARK_SUSPEND {
+    keys = createKeys(numKeys, false);
+  }
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& key : keys) {
+      int plen{0};
+      std::string node, area, ipAddr;
+      folly::doNotOptimizeAway(RE2::FullMatch(
+          key, PrefixKey::getPrefixRE2(), &node, &area, &ipAddr, &plen));
+    }
+  }
+}
+
+void
+BM_PrefixKeyParseKeyFields(uint32_t iters, size_t numKeys) {
+  std::vector<std::string> keys;
+  BENCHMARK_SUSPEND {
+    keys = createKeys(numKeys, false);
+  }
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& key : keys) {
+      folly::doNotOptimizeAway(PrefixKey::parseKeyFields(key, false));
+    }
+  }
+}
+
+void
+BM_PrefixKeyFromStr(uint32_t iters, size_t numKeys, bool isV2) {
+  std::vector<std::string> keys;
+  BENCHMARK_SUSPEND {
+    keys = createKeys(numKeys, isV2);
+  }
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& key : keys) {
+      folly::doNotOptimizeAway(
+          isV2 ? PrefixKey::fromStrV2(key) : PrefixKey::fromStr(key));
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(BM_PrefixKeyRegexMatch, 100000, 100000);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_PrefixKeyParseKeyFields, 100000, 100000);
+BENCHMARK_NAMED_PARAM(BM_PrefixKeyFromStr, 100000, 100000, false);
+BENCHMARK_NAMED_PARAM(BM_PrefixKeyFromStr, 100000_v2, 100000, true);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
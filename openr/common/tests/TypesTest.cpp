@@ -117,6 +117,117 @@ TEST(TypesTest, fromStrV2Test) {
   EXPECT_TRUE(PrefixKey::fromStr(invalidStrWithBadPrefix).hasError());
 }
 
+/**
+ * Verify parsed key fields agree with matches of the prefix key regexes
+ */
+TEST(TypesTest, ParseKeyFieldsTest) {
+  const std::string marker = Constants::kPrefixDbMarker.toString();
+  const std::vector<std::string> keys{
+      marker + "node-1.a_b:area.1:[fc00::1/128]",
+      marker + "node-1:[10.0.0.0/24]",
+      marker + "node-1:area-1:[10.0.0.0/999]",
+      marker + "node-1:area-1:[10.0.0.0/1234]",
+      marker + "node-1:area-1:[10.0.0.0/]",
+      marker + "node-1:area-1:[10.0.0.0/24",
+      marker + "node-1:area-1:[10.0.0.0/24]x",
+      marker + "node-1:area-1:[/24]",
+      marker + "node-1:area-1:10.0.0.0/24",
+      marker + "node 1:area-1:[10.0.0.0/24]",
+      marker + "node-1:area:1:[10.0.0.0/24]",
+      marker + ":area-1:[10.0.0.0/24]",
+      marker + "node-1::[10.0.0.0/24]",
+      marker + "node-1:[::g/64]",
+      "adj:node-1:[10.0.0.0/24]",
+      marker,
+      "",
+  };
+
+  for (auto const& key : keys) {
+    std::string node, area, ipAddr;
+    int plen{0};
+    auto fields = PrefixKey::parseKeyFields(key, false);
+    ASSERT_EQ(
+        RE2::FullMatch(
+            key, PrefixKey::getPrefixRE2(), &node, &area, &ipAddr, &plen),
+        fields.has_value())
+        << key;
+    if (fields) {
+      EXPECT_EQ(node, fields->node);
+      EXPECT_EQ(area, fields->area);
+      EXPECT_EQ(ipAddr, fields->ipAddr);
+      EXPECT_EQ(plen, fields->plen);
+    }
+
+    fields = PrefixKey::parseKeyFields(key, true);
+    ASSERT_EQ(
+        RE2::FullMatch(key, PrefixKey::getPrefixRE2V2(), &node, &ipAddr, &plen),
+        fields.has_value())
+        << key;
+    if (fields) {
+      EXPECT_EQ(node, fields->node);
+      EXPECT_TRUE(fields->area.empty());
+      EXPECT_EQ(ipAddr, fields->ipAddr);
+      EXPECT_EQ(plen, fields->plen);
+    }
+  }
+
+  // prefix length beyond the address width, host bits are masked
+  EXPECT_TRUE(
+      PrefixKey::fromStr(marker + "node-1:area-1:[10.0.0.0/33]").hasError());
+  EXPECT_TRUE(PrefixKey::fromStrV2(marker + "node-1:[fc00::/129]").hasError());
+  auto maybeKey = PrefixKey::fromStrV2(marker + "node-1:[10.1.2.3/16]");
+  ASSERT_FALSE(maybeKey.hasError());
+  EXPECT_EQ(
+      folly::IPAddress::createNetwork("10.1.0.0/16"),
+      maybeKey->getCIDRNetwork());
+  EXPECT_TRUE(PrefixKey::isPrefixKeyV2Str(marker + "node-1:[10.1.2.3/16]"));
+  EXPECT_FALSE(
+      PrefixKey::isPrefixKeyV2Str(marker + "node-1:area-1:[10.1.2.3/16]"));
+}
+
+TEST(TypesTest, PrefixShardKeyTest) {
+  const std::string nodeName{"node-1"};
+  const std::string areaId{"area-1"};
+
+  const PrefixShardKey key(nodeName, areaId, 7);
+  EXPECT_EQ(
+      fmt::format(
+          "{}{}:{}:7",
+          Constants::kPrefixShardDbMarker.toString(),
+          nodeName,
+          areaId),
+      key.getPrefixShardKey());
+
+  auto maybeKey = PrefixShardKey::fromStr(key.getPrefixShardKey());
+  ASSERT_FALSE(maybeKey.hasError());
+  EXPECT_EQ(nodeName, maybeKey.value().getNodeName());
+  EXPECT_EQ(areaId, maybeKey.value().getPrefixArea());
+  EXPECT_EQ(7, maybeKey.value().getShard());
+
+  EXPECT_TRUE(PrefixShardKey::fromStr(
+                  fmt::format(
+                      "{}{}:{}:7",
+                      Constants::kPrefixDbMarker.toString(),
+                      nodeName,
+                      areaId))
+                  .hasError());
+  EXPECT_TRUE(PrefixShardKey::fromStr(
+                  fmt::format(
+                      "{}{}:{}:x",
+                      Constants::kPrefixShardDbMarker.toString(),
+                      nodeName,
+                      areaId))
+                  .hasError());
+
+  // shard of a prefix is stable and within range
+  const auto prefix = folly::IPAddress::createNetwork("fc00::1/128");
+  const auto shard = PrefixShardKey::getShard(prefix, 16);
+  EXPECT_EQ(shard, PrefixShardKey::getShard(prefix, 16));
+  EXPECT_LE(0, shard);
+  EXPECT_GT(16, shard);
+  EXPECT_EQ(0, PrefixShardKey::getShard(prefix, 1));
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -511,6 +511,49 @@ TEST(UtilTest, getDurationBetweenPerfEventsTest) {
   }
 }
 
+TEST(UtilTest, perfTraceTest) {
+  // not sampled, spans are ignored
+  {
+    thrift::PerfEvents perfEvents;
+    EXPECT_FALSE(maybeStartPerfTrace(perfEvents, 0));
+    startPerfSpan(perfEvents, "node1", "KVSTORE_FLOOD");
+    EXPECT_FALSE(endPerfSpan(perfEvents, "node2", "KVSTORE_FLOOD"));
+    EXPECT_FALSE(perfEvents.traceId_ref().has_value());
+    EXPECT_TRUE(perfEvents.spans_ref()->empty());
+  }
+  // sampled, spans are closed most recent first
+  {
+    thrift::PerfEvents perfEvents;
+    EXPECT_TRUE(maybeStartPerfTrace(perfEvents, 1));
+    ASSERT_TRUE(perfEvents.traceId_ref().has_value());
+    EXPECT_NE(0, *perfEvents.traceId_ref());
+    const auto traceId = *perfEvents.traceId_ref();
+    // already traced, trace is kept
+    EXPECT_TRUE(maybeStartPerfTrace(perfEvents, 1));
+    EXPECT_EQ(traceId, *perfEvents.traceId_ref());
+
+    startPerfSpan(perfEvents, "node1", "KVSTORE_FLOOD");
+    startPerfSpan(perfEvents, "node1", "KVSTORE_FLOOD");
+    EXPECT_TRUE(endPerfSpan(perfEvents, "node2", "KVSTORE_FLOOD"));
+    EXPECT_FALSE(endPerfSpan(perfEvents, "node2", "FIB_PROGRAM"));
+    ASSERT_EQ(2, perfEvents.spans_ref()->size());
+    EXPECT_EQ(0, *perfEvents.spans_ref()->at(0).endUs_ref());
+    EXPECT_EQ("node2", *perfEvents.spans_ref()->at(1).endNodeName_ref());
+    EXPECT_GE(
+        *perfEvents.spans_ref()->at(1).endUs_ref(),
+        *perfEvents.spans_ref()->at(1).startUs_ref());
+    EXPECT_EQ(2, sprintPerfSpans(perfEvents).size());
+
+    // trace is adopted by perf events which are not traced
+    thrift::PerfEvents otherPerfEvents;
+    addPerfEvent(otherPerfEvents, "node2", "DECISION_RECEIVED");
+    mergePerfTrace(otherPerfEvents, perfEvents);
+    EXPECT_EQ(traceId, *otherPerfEvents.traceId_ref());
+    EXPECT_EQ(*perfEvents.spans_ref(), *otherPerfEvents.spans_ref());
+    EXPECT_EQ(1, otherPerfEvents.events_ref()->size());
+  }
+}
+
 TEST(UtilTest, selectMplsNextHops) {
   // Validate pop route
   auto bestNextHops = selectMplsNextHops({path1_2_2_pop});
@@ -898,6 +941,35 @@ TEST(UtilTest, AddJitter) {
       t2_jitter_s <= (1 + pct / 100.0) * t2_jitter_s);
 }
 
+TEST(UtilTest, ThriftObjSerialization) {
+  apache::thrift::CompactSerializer serializer;
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName_ref() = "node-1";
+  for (auto const& prefix : {"10.0.0.0/8", "fc00::/64"}) {
+    prefixDb.prefixEntries_ref()->emplace_back(
+        createPrefixEntry(toIpPrefix(prefix)));
+  }
+  const auto expected = writeThriftObjStr(prefixDb, serializer);
+
+  // Contents of the output string are replaced, repeatedly
+  std::string out = "stale contents";
+  for (int i = 0; i < 3; ++i) {
+    writeThriftObjStr(prefixDb, serializer, out);
+    EXPECT_EQ(expected, out);
+  }
+
+  folly::IOBufQueue queue;
+  writeThriftObj(prefixDb, serializer, queue);
+  auto buf = queue.move();
+  buf->coalesce();
+  EXPECT_EQ(expected, buf->moveToFbString().toStdString());
+
+  EXPECT_EQ(
+      prefixDb,
+      readThriftObj<thrift::PrefixDatabase>(
+          folly::ByteRange(folly::StringPiece(expected)), serializer));
+}
+
 TEST(UtilTest, BestMetricsSelection) {
   auto createMetrics = [](int32_t pp, int32_t sp, int32_t d) {
     thrift::PrefixEntry prefixEntry;
@@ -7,9 +7,17 @@
 
 #include "PersistentStore.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
 #include <chrono>
 
+#include <fb303/ServiceData.h>
+#include <fmt/format.h>
+#include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/io/IOBuf.h>
 
 #include <openr/common/Util.h>
@@ -30,7 +38,11 @@ PersistentStore::PersistentStore(
     bool dryrun,
     bool periodicallySaveToDisk)
     : storageFilePath_(config->getConfig().get_persistent_config_store_path()),
-      dryrun_(dryrun) {
+      dryrun_(dryrun),
+      groupCommitWindow_(std::chrono::milliseconds(
+          *config->getConfig().config_store_group_commit_ms_ref())),
+      logStructured_(
+          *config->getConfig().enable_log_structured_config_store_ref()) {
   if (periodicallySaveToDisk) {
     // Create timer and backoff mechanism only if backoff is requested
     saveDbTimerBackoff_ =
@@ -50,6 +62,21 @@ PersistentStore::PersistentStore(
     });
   }
 
+  if (groupCommitWindow_.count() > 0) {
+    groupCommitTimer_ = folly::AsyncTimeout::make(
+        *getEvb(), [this]() noexcept { flushGroupCommit(); });
+  }
+
+  if (logStructured_) {
+    compactionPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        1, std::make_shared<folly::NamedThreadFactory>("ConfigStoreCompact"));
+    if (not loadSegmentsFromDisk()) {
+      LOG(ERROR) << "Failed to load config-database segments of: "
+                 << storageFilePath_;
+    }
+    return;
+  }
+
   // Load initial database. On failure we will just report error and continue
   // with empty database
   if (not loadDatabaseFromDisk()) {
@@ -59,6 +86,19 @@ PersistentStore::PersistentStore(
 }
 
 PersistentStore::~PersistentStore() {
+  if (not pendingCommits_.empty()) {
+    flushGroupCommit();
+  }
+  if (logStructured_) {
+    // Wait for ongoing compaction and append pending objects, no new
+    // compaction is started
+    compactionPool_->join();
+    compactionPool_.reset();
+    if (not pObjects_.empty()) {
+      savePersistentObjectToDisk();
+    }
+    return;
+  }
   saveDatabaseToDisk();
 }
 
@@ -73,9 +113,17 @@ PersistentStore::store(std::string key, std::string value) {
     SYSLOG(INFO) << "Store key: " << key << ", value: " << value
                  << " to config-store";
     // Override previous value if any
+    mappedValues_.erase(key);
     database_.insert_or_assign(key, value);
     auto pObject = toPersistentObject(ActionType::ADD, key, value);
     pObjects_.emplace_back(std::move(pObject));
+    if (groupCommitTimer_) {
+      // Complete once batch is on disk
+      pendingCommits_.emplace_back(
+          [p = std::move(p)]() mutable { p.setValue(); });
+      maybeSaveObjectToDisk();
+      return;
+    }
     maybeSaveObjectToDisk();
     p.setValue();
   });
@@ -89,9 +137,16 @@ PersistentStore::erase(std::string key) {
   runInEventBaseThread(
       [this, p = std::move(p), key = std::move(key)]() mutable noexcept {
         SYSLOG(INFO) << "Erase key: " << key << " from config-store";
-        if (database_.erase(key) > 0) {
+        if (database_.erase(key) + mappedValues_.erase(key) > 0) {
           auto pObject = toPersistentObject(ActionType::DEL, key, "");
           pObjects_.emplace_back(std::move(pObject));
+          if (groupCommitTimer_) {
+            // Complete once batch is on disk
+            pendingCommits_.emplace_back(
+                [p = std::move(p)]() mutable { p.setValue(true); });
+            maybeSaveObjectToDisk();
+            return;
+          }
           maybeSaveObjectToDisk();
           p.setValue(true);
         } else {
@@ -111,6 +166,15 @@ PersistentStore::load(std::string key) {
         auto it = database_.find(key);
         if (it != database_.end()) {
           p.setValue(it->second);
+          return;
+        }
+        // Decode value of a mapped segment on first load
+        auto mappedIt = mappedValues_.find(key);
+        if (mappedIt != mappedValues_.end()) {
+          auto [dbIt, _] =
+              database_.emplace(key, mappedIt->second.toString());
+          mappedValues_.erase(mappedIt);
+          p.setValue(dbIt->second);
         } else {
           p.setValue(std::nullopt);
         }
@@ -120,7 +184,12 @@ PersistentStore::load(std::string key) {
 
 void
 PersistentStore::maybeSaveObjectToDisk() noexcept {
-  if (not saveDbTimerBackoff_) {
+  if (groupCommitTimer_) {
+    // Batch writes of the window
+    if (not groupCommitTimer_->isScheduled()) {
+      groupCommitTimer_->scheduleTimeout(groupCommitWindow_);
+    }
+  } else if (not saveDbTimerBackoff_) {
     // This is primarily used for unit testing to save DB immediately
     // Block the response till file is saved
     savePersistentObjectToDisk();
@@ -130,6 +199,27 @@ PersistentStore::maybeSaveObjectToDisk() noexcept {
   }
 }
 
+void
+PersistentStore::flushGroupCommit() noexcept {
+  auto pendingCommits = std::move(pendingCommits_);
+  pendingCommits_.clear();
+  fb303::fbData->addStatValue(
+      "persistent_store.group_commit_size", pObjects_.size(), fb303::AVG);
+  if (not savePersistentObjectToDisk()) {
+    // Database is still updated in memory, retry with backoff if enabled
+    LOG(ERROR) << "Failed to commit " << pendingCommits.size()
+               << " writes to disk";
+    if (saveDbTimer_ and not saveDbTimer_->isScheduled()) {
+      saveDbTimerBackoff_->reportError();
+      saveDbTimer_->scheduleTimeout(
+          saveDbTimerBackoff_->getTimeRemainingUntilRetry());
+    }
+  }
+  for (auto& complete : pendingCommits) {
+    complete();
+  }
+}
+
 bool
 PersistentStore::savePersistentObjectToDisk() noexcept {
   if (not dryrun_) {
@@ -151,7 +241,13 @@ PersistentStore::savePersistentObjectToDisk() noexcept {
 
     // Append IoBuf to disk
     auto ioBuf = queue.move();
-    auto success = writeIoBufToDisk(ioBuf, WriteType::APPEND);
+    if (logStructured_) {
+      numOfWritesToDisk_++;
+      return appendToSegment(std::move(ioBuf));
+    }
+    auto success = groupCommitTimer_
+        ? appendIoBufToDiskSync(ioBuf, storageFilePath_)
+        : writeIoBufToDisk(ioBuf, WriteType::APPEND, storageFilePath_);
     if (success.hasError()) {
       LOG(ERROR) << "Failed to write PersistentObject to file '"
                  << storageFilePath_ << "'. Error: " << success.error();
@@ -211,7 +307,7 @@ PersistentStore::saveDatabaseToDisk() noexcept {
     ioBuf = queue.move();
   }
 
-  auto success = writeIoBufToDisk(ioBuf, WriteType::WRITE);
+  auto success = writeIoBufToDisk(ioBuf, WriteType::WRITE, storageFilePath_);
   if (success.hasError()) {
     LOG(ERROR) << "Failed to write database to file '" << storageFilePath_
                << "'. Error: " << success.error();
@@ -287,10 +383,46 @@ PersistentStore::loadDatabaseTlvFormat(
   return folly::Unit();
 }
 
+folly::Expected<folly::Unit, std::string>
+PersistentStore::appendIoBufToDiskSync(
+    const std::unique_ptr<folly::IOBuf>& ioBuf,
+    const fs::path& filePath) noexcept {
+  const int fd =
+      folly::openNoInt(filePath.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0666);
+  if (fd < 0) {
+    return folly::makeUnexpected(
+        fmt::format("open failed: {}", folly::errnoStr(errno)));
+  }
+  SCOPE_EXIT {
+    folly::closeNoInt(fd);
+  };
+
+  // One record per buffer of the chain
+  auto iov = ioBuf->getIov();
+  if (folly::writevFull(fd, iov.data(), iov.size()) < 0) {
+    return folly::makeUnexpected(
+        fmt::format("writev failed: {}", folly::errnoStr(errno)));
+  }
+  const auto startTs = std::chrono::steady_clock::now();
+  if (::fdatasync(fd) != 0) {
+    return folly::makeUnexpected(
+        fmt::format("fdatasync failed: {}", folly::errnoStr(errno)));
+  }
+  fb303::fbData->addStatValue(
+      "persistent_store.fsync_ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTs)
+          .count(),
+      fb303::AVG);
+  return folly::Unit();
+}
+
 // Write over or append IoBuf to disk atomically
 folly::Expected<folly::Unit, std::string>
 PersistentStore::writeIoBufToDisk(
-    const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept {
+    const std::unique_ptr<folly::IOBuf>& ioBuf,
+    WriteType writeType,
+    const fs::path& filePath) noexcept {
   std::string fileData("");
   try {
     ioBuf->coalesce();
@@ -298,12 +430,12 @@ PersistentStore::writeIoBufToDisk(
 
     if (writeType == WriteType::WRITE) {
       // Write over
-      folly::writeFileAtomic(storageFilePath_.c_str(), fileData, 0666);
+      folly::writeFileAtomic(filePath.c_str(), fileData, 0666);
     } else {
       // Append to file
       folly::writeFile(
           fileData,
-          storageFilePath_.c_str(),
+          filePath.c_str(),
           O_WRONLY | O_APPEND | O_CREAT,
           0666);
     }
@@ -314,6 +446,229 @@ PersistentStore::writeIoBufToDisk(
   return folly::Unit();
 }
 
+fs::path
+PersistentStore::getSegmentPath(uint64_t segmentId) const {
+  return fmt::format("{}.seg{}", storageFilePath_.string(), segmentId);
+}
+
+bool
+PersistentStore::loadSegmentsFromDisk() noexcept {
+  std::vector<uint64_t> segmentIds;
+  const auto prefix = storageFilePath_.filename().string() + ".seg";
+  try {
+    auto dir = storageFilePath_.parent_path();
+    if (dir.empty()) {
+      dir = ".";
+    }
+    if (fs::exists(dir)) {
+      for (auto const& entry : fs::directory_iterator(dir)) {
+        const auto name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) != 0) {
+          continue;
+        }
+        auto segmentId = folly::tryTo<uint64_t>(name.substr(prefix.size()));
+        if (segmentId.hasValue()) {
+          segmentIds.emplace_back(*segmentId);
+        }
+      }
+    }
+
+    // Migrate database file of regular mode into first segment
+    if (segmentIds.empty() and fs::exists(storageFilePath_)) {
+      if (dryrun_) {
+        return loadDatabaseFromDisk();
+      }
+      LOG(INFO) << "Migrating " << storageFilePath_ << " to log segment";
+      fs::rename(storageFilePath_, getSegmentPath(0));
+      segmentIds.emplace_back(0);
+    }
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to list segments of " << storageFilePath_
+               << ". Error: " << folly::exceptionStr(e);
+    return false;
+  }
+  std::sort(segmentIds.begin(), segmentIds.end());
+
+  bool success{true};
+  for (auto segmentId : segmentIds) {
+    const auto path = getSegmentPath(segmentId);
+    std::unique_ptr<folly::MemoryMapping> mapping;
+    try {
+      if (fs::file_size(path) < kTlvFormatMarker.size()) {
+        // Crashed while creating segment
+        continue;
+      }
+      mapping = std::make_unique<folly::MemoryMapping>(path.c_str());
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Failed to map segment " << path
+                 << ". Error: " << folly::exceptionStr(e);
+      success = false;
+      continue;
+    }
+
+    const auto segment = mapping->range();
+    const folly::StringPiece marker(
+        reinterpret_cast<const char*>(segment.data()),
+        kTlvFormatMarker.size());
+    if (marker == kTlvSnapshotMarker) {
+      // Snapshot covers all previous segments, left over by interrupted
+      // compaction
+      mappedValues_.clear();
+      mappings_.clear();
+      firstSegmentId_ = segmentId;
+    } else if (marker != kTlvFormatMarker) {
+      LOG(ERROR) << "Unknown format of segment " << path;
+      success = false;
+      continue;
+    }
+    if (not indexSegment(segment)) {
+      LOG(ERROR) << "Truncated records in segment " << path;
+      success = false;
+    }
+    mappings_.emplace_back(std::move(mapping));
+  }
+
+  // Always append to a new segment, never after a possibly torn record
+  activeSegmentId_ = segmentIds.empty() ? 0 : segmentIds.back() + 1;
+  if (segmentIds.empty()) {
+    firstSegmentId_ = 0;
+  } else if (firstSegmentId_ < segmentIds.front()) {
+    firstSegmentId_ = segmentIds.front();
+  }
+  LOG(INFO) << "Indexed " << mappedValues_.size() << " keys from "
+            << mappings_.size() << " segments of " << storageFilePath_;
+  return success;
+}
+
+bool
+PersistentStore::indexSegment(folly::ByteRange segment) noexcept {
+  auto ioBuf = folly::IOBuf::wrapBuffer(segment);
+  folly::io::Cursor cursor(ioBuf.get());
+  try {
+    cursor.skip(kTlvFormatMarker.size());
+    while (cursor.canAdvance(1)) {
+      // Same encoding as in `encodePersistentObject`, values are referenced
+      // in the mapping instead of being copied
+      const auto type = ActionType(cursor.readBE<uint8_t>());
+      auto length = cursor.readBE<uint32_t>();
+      auto key = cursor.readFixedString(length);
+      length = cursor.readBE<uint32_t>();
+      if (not cursor.canAdvance(length)) {
+        return false;
+      }
+      const folly::StringPiece value(
+          reinterpret_cast<const char*>(cursor.data()), length);
+      cursor.skip(length);
+
+      if (type == ActionType::ADD) {
+        mappedValues_.insert_or_assign(std::move(key), value);
+      } else if (type == ActionType::DEL) {
+        mappedValues_.erase(key);
+      }
+    }
+  } catch (std::out_of_range const&) {
+    return false;
+  }
+  return true;
+}
+
+bool
+PersistentStore::appendToSegment(std::unique_ptr<folly::IOBuf> ioBuf) noexcept {
+  if (activeSegmentSize_ == 0) {
+    // New segment starts with format marker
+    auto marker = folly::IOBuf::copyBuffer(
+        kTlvFormatMarker.data(), kTlvFormatMarker.size());
+    marker->prependChain(std::move(ioBuf));
+    ioBuf = std::move(marker);
+  }
+  const auto size = ioBuf->computeChainDataLength();
+  const auto segmentPath = getSegmentPath(activeSegmentId_);
+  auto success = groupCommitTimer_
+      ? appendIoBufToDiskSync(ioBuf, segmentPath)
+      : writeIoBufToDisk(ioBuf, WriteType::APPEND, segmentPath);
+  if (success.hasError()) {
+    LOG(ERROR) << "Failed to write PersistentObject to segment "
+               << activeSegmentId_ << " of '" << storageFilePath_
+               << "'. Error: " << success.error();
+    return false;
+  }
+
+  activeSegmentSize_ += size;
+  if (activeSegmentSize_ >= Constants::kPersistentStoreSegmentSize) {
+    ++activeSegmentId_;
+    activeSegmentSize_ = 0;
+    maybeCompactSegments();
+  }
+  return true;
+}
+
+void
+PersistentStore::maybeCompactSegments() noexcept {
+  if (not compactionPool_ or compactionInProgress_) {
+    return;
+  }
+  const uint64_t firstSegmentId = firstSegmentId_;
+  const uint64_t snapshotSegmentId = activeSegmentId_ - 1;
+  if (snapshotSegmentId - firstSegmentId <
+      Constants::kPersistentStoreMaxSegments) {
+    return;
+  }
+
+  // Snapshot of current database replaces the last sealed segment. It may
+  // include records of the active segment, replaying them is idempotent.
+  std::vector<std::pair<std::string, std::string>> snapshot;
+  snapshot.reserve(database_.size() + mappedValues_.size());
+  for (auto const& [key, value] : database_) {
+    snapshot.emplace_back(key, value);
+  }
+  for (auto const& [key, value] : mappedValues_) {
+    snapshot.emplace_back(key, value.toString());
+  }
+
+  compactionInProgress_ = true;
+  compactionPool_->add([this,
+                        snapshot = std::move(snapshot),
+                        firstSegmentId,
+                        snapshotSegmentId]() noexcept {
+    const auto startTs = std::chrono::steady_clock::now();
+    auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
+    queue.append(kTlvSnapshotMarker.data(), kTlvSnapshotMarker.size());
+    for (auto const& [key, value] : snapshot) {
+      auto buf = encodePersistentObject(
+          toPersistentObject(ActionType::ADD, key, value));
+      if (buf.hasError()) {
+        LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error: "
+                   << buf.error();
+        compactionInProgress_ = false;
+        return;
+      }
+      queue.append(std::move(*buf));
+    }
+
+    auto success = writeIoBufToDisk(
+        queue.move(), WriteType::WRITE, getSegmentPath(snapshotSegmentId));
+    if (success.hasError()) {
+      LOG(ERROR) << "Failed to write snapshot segment of '" << storageFilePath_
+                 << "'. Error: " << success.error();
+      compactionInProgress_ = false;
+      return;
+    }
+    for (auto segmentId = firstSegmentId; segmentId < snapshotSegmentId;
+         ++segmentId) {
+      std::error_code ec;
+      fs::remove(getSegmentPath(segmentId), ec);
+    }
+    LOG(INFO) << "Compacted segments [" << firstSegmentId << ", "
+              << snapshotSegmentId << "] of " << storageFilePath_ << ". Took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - startTs)
+                     .count()
+              << "ms";
+    firstSegmentId_ = snapshotSegmentId;
+    compactionInProgress_ = false;
+  });
+}
+
 // A made up encoding of a PersistentObject.
 folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
 PersistentStore::encodePersistentObject(
@@ -17,7 +17,9 @@ namespace fs = std::experimental::filesystem;
 #endif
 #include <string>
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
+#include <folly/system/MemoryMapping.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
@@ -28,6 +30,9 @@ namespace fs = std::experimental::filesystem;
 
 namespace {
 constexpr folly::StringPiece kTlvFormatMarker{"TlvFormatMarker"};
+// Marker of a log segment holding a snapshot of the whole database
+constexpr folly::StringPiece kTlvSnapshotMarker{"TlvSnapshotMark"};
+static_assert(kTlvSnapshotMarker.size() == kTlvFormatMarker.size());
 enum WriteType { APPEND = 1, WRITE = 2 };
 
 } // anonymous namespace
@@ -51,6 +56,12 @@ struct PersistentObject {
  *
  * `storageFilePath`: Describe the path of file in file system where data will
  * be stored/retrieved from (in binary format).
+ *
+ * With `enable_log_structured_config_store` records are appended to segment
+ * files `<storageFilePath>.seg<id>` instead. A segment is sealed once it
+ * exceeds Constants::kPersistentStoreSegmentSize and sealed segments are
+ * compacted into a snapshot segment in the background. On startup segments
+ * are memory mapped and only indexed, values are decoded on first load.
  */
 class PersistentStore : public OpenrEventBase {
  public:
@@ -133,9 +144,35 @@ class PersistentStore : public OpenrEventBase {
   // Function to save Persistent Object to local disk.
   bool savePersistentObjectToDisk() noexcept;
 
+  // Complete pending writes once group commit window elapsed
+  void flushGroupCommit() noexcept;
+
+  // Append IoBuf to local disk with a single writev followed by fdatasync
+  static folly::Expected<folly::Unit, std::string> appendIoBufToDiskSync(
+      const std::unique_ptr<folly::IOBuf>& ioBuf,
+      const fs::path& filePath) noexcept;
+
   // Write IoBuf ro local disk
-  folly::Expected<folly::Unit, std::string> writeIoBufToDisk(
-      const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept;
+  static folly::Expected<folly::Unit, std::string> writeIoBufToDisk(
+      const std::unique_ptr<folly::IOBuf>& ioBuf,
+      WriteType writeType,
+      const fs::path& filePath) noexcept;
+
+  // Path of log segment with given id
+  fs::path getSegmentPath(uint64_t segmentId) const;
+
+  // Map log segments and index their records into `mappedValues_`
+  bool loadSegmentsFromDisk() noexcept;
+
+  // Index records of a mapped segment. Returns false on malformed records,
+  // records before them are indexed.
+  bool indexSegment(folly::ByteRange segment) noexcept;
+
+  // Append records to active log segment, sealing it when full
+  bool appendToSegment(std::unique_ptr<folly::IOBuf> ioBuf) noexcept;
+
+  // Compact sealed segments into a snapshot segment in the background
+  void maybeCompactSegments() noexcept;
 
   // Function to create a PersistentObject.
   PersistentObject toPersistentObject(
@@ -168,6 +205,41 @@ class PersistentStore : public OpenrEventBase {
 
   // Define a persistent object
   std::vector<PersistentObject> pObjects_;
+
+  //
+  // Group commit
+  //
+
+  // Window to batch writes in, disabled if 0
+  const std::chrono::milliseconds groupCommitWindow_{0};
+
+  // Timer flushing batched writes when window elapsed
+  std::unique_ptr<folly::AsyncTimeout> groupCommitTimer_;
+
+  // Completions of batched writes, invoked once the batch is on disk
+  std::vector<folly::Function<void()>> pendingCommits_;
+
+  //
+  // Log-structured mode
+  //
+
+  const bool logStructured_{false};
+
+  // Id of segment receiving appends and number of bytes written to it
+  uint64_t activeSegmentId_{0};
+  size_t activeSegmentSize_{0};
+
+  // Id of oldest segment on disk, written by compaction when it completes
+  std::atomic<uint64_t> firstSegmentId_{0};
+  std::atomic<bool> compactionInProgress_{false};
+
+  // Segments mapped on startup and values of their live records. A key is
+  // either in `mappedValues_` or in `database_`.
+  std::vector<std::unique_ptr<folly::MemoryMapping>> mappings_;
+  std::unordered_map<std::string, folly::StringPiece> mappedValues_;
+
+  // Single thread to compact sealed segments
+  std::unique_ptr<folly::CPUThreadPoolExecutor> compactionPool_;
 };
 
 } // namespace openr
@@ -10,11 +10,17 @@
 
 namespace openr {
 
-PersistentStoreWrapper::PersistentStoreWrapper(const unsigned long tid)
-    : filePath(folly::sformat("/tmp/openr_persistent_store_test_{}", tid)) {
+PersistentStoreWrapper::PersistentStoreWrapper(
+    const unsigned long tid, bool logStructured, int32_t groupCommitMs)
+    : filePath(folly::sformat(
+          "/tmp/openr_persistent_store_test_{}{}",
+          tid,
+          logStructured ? "_log" : "")) {
   VLOG(1) << "PersistentStoreWrapper: Creating PersistentStore.";
   auto tConfig = getBasicOpenrConfig();
   tConfig.persistent_config_store_path_ref() = filePath;
+  tConfig.enable_log_structured_config_store_ref() = logStructured;
+  tConfig.config_store_group_commit_ms_ref() = groupCommitMs;
   auto config = std::make_shared<Config>(tConfig);
   store_ = std::make_unique<PersistentStore>(config);
 }
@@ -66,12 +66,13 @@ eraseKeyFromStore(
  * 3. Erase keys
  */
 void
-BM_PersistentStoreWrite(uint32_t iters, size_t numOfStringKeys) {
+BM_PersistentStoreWrite(
+    uint32_t iters, size_t numOfStringKeys, bool logStructured) {
   auto suspender = folly::BenchmarkSuspender();
   const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
 
   // Create new storeWrapper and perform some operations on it
-  auto store = std::make_unique<PersistentStoreWrapper>(tid);
+  auto store = std::make_unique<PersistentStoreWrapper>(tid, logStructured);
   store->run();
 
   // Generate keys
@@ -99,11 +100,12 @@ BM_PersistentStoreWrite(uint32_t iters, size_t numOfStringKeys) {
  * 4. Erase keys
  */
 void
-BM_PersistentStoreLoad(uint32_t iters, size_t numOfStringKeys) {
+BM_PersistentStoreLoad(
+    uint32_t iters, size_t numOfStringKeys, bool logStructured) {
   auto suspender = folly::BenchmarkSuspender();
   const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
   // Create new storeWrapper and perform some operations on it
-  auto store = std::make_unique<PersistentStoreWrapper>(tid);
+  auto store = std::make_unique<PersistentStoreWrapper>(tid, logStructured);
   store->run();
 
   // Generate keys
@@ -132,12 +134,14 @@ BM_PersistentStoreLoad(uint32_t iters, size_t numOfStringKeys) {
  * 3. Create and destroy a store
  */
 void
-BM_PersistentStoreCreateDestroy(uint32_t iters, size_t numOfStringKeys) {
+BM_PersistentStoreCreateDestroy(
+    uint32_t iters, size_t numOfStringKeys, bool logStructured) {
   auto suspender = folly::BenchmarkSuspender();
   const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
 
   // Create storeWrapper and perform some operations on it
-  auto store = std::make_unique<PersistentStoreWrapper>(tid + 1);
+  auto store =
+      std::make_unique<PersistentStoreWrapper>(tid + 1, logStructured);
   store->run();
 
   // Generate keys
@@ -152,26 +156,45 @@ BM_PersistentStoreCreateDestroy(uint32_t iters, size_t numOfStringKeys) {
 
   for (uint32_t i = 0; i < iters; i++) {
     // Create & destroy the store - ensure the same tid
-    auto store1 = std::make_unique<PersistentStoreWrapper>(tid + 1);
+    auto store1 =
+        std::make_unique<PersistentStoreWrapper>(tid + 1, logStructured);
   }
 }
 
-// The parameter is the number of keys already written to store
-// before benchmarking the time.
-BENCHMARK_PARAM(BM_PersistentStoreWrite, 10);
-BENCHMARK_PARAM(BM_PersistentStoreWrite, 100);
-BENCHMARK_PARAM(BM_PersistentStoreWrite, 1000);
-BENCHMARK_PARAM(BM_PersistentStoreWrite, 10000);
-
-BENCHMARK_PARAM(BM_PersistentStoreLoad, 10);
-BENCHMARK_PARAM(BM_PersistentStoreLoad, 100);
-BENCHMARK_PARAM(BM_PersistentStoreLoad, 1000);
-BENCHMARK_PARAM(BM_PersistentStoreLoad, 10000);
-
-BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 10);
-BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 100);
-BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 1000);
-BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 10000);
+// The first parameter is the number of keys already written to store
+// before benchmarking the time. The second one selects log-structured store.
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 10, 10, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 100, 100, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 1000, 1000, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 10000, 10000, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 10_log_structured, 10, true);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 100_log_structured, 100, true);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreWrite, 1000_log_structured, 1000, true);
+BENCHMARK_NAMED_PARAM(
+    BM_PersistentStoreWrite, 10000_log_structured, 10000, true);
+
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 10, 10, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 100, 100, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 1000, 1000, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 10000, 10000, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 10_log_structured, 10, true);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 100_log_structured, 100, true);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreLoad, 1000_log_structured, 1000, true);
+BENCHMARK_NAMED_PARAM(
+    BM_PersistentStoreLoad, 10000_log_structured, 10000, true);
+
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreCreateDestroy, 10, 10, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreCreateDestroy, 100, 100, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreCreateDestroy, 1000, 1000, false);
+BENCHMARK_NAMED_PARAM(BM_PersistentStoreCreateDestroy, 10000, 10000, false);
+BENCHMARK_NAMED_PARAM(
+    BM_PersistentStoreCreateDestroy, 10_log_structured, 10, true);
+BENCHMARK_NAMED_PARAM(
+    BM_PersistentStoreCreateDestroy, 100_log_structured, 100, true);
+BENCHMARK_NAMED_PARAM(
+    BM_PersistentStoreCreateDestroy, 1000_log_structured, 1000, true);
+BENCHMARK_NAMED_PARAM(
+    BM_PersistentStoreCreateDestroy, 10000_log_structured, 10000, true);
 
 } // namespace openr
 
@@ -215,6 +215,96 @@ TEST(PersistentStoreTest, BulkStoreLoad) {
   }
 }
 
+TEST(PersistentStoreTest, GroupCommit) {
+  // Distinct file from other tests to start with empty store
+  const auto tid =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) + 1;
+
+  StoreDatabase database;
+  std::string filePath;
+  {
+    PersistentStoreWrapper store(
+        tid, false /* logStructured */, 100 /* groupCommitMs */);
+    store.run();
+    filePath = store.filePath;
+
+    // Burst of writes is committed in batches, futures complete once their
+    // batch is on disk
+    std::vector<folly::SemiFuture<folly::Unit>> futures;
+    for (auto index = 0; index < 50; index++) {
+      const auto key = folly::sformat("key-{}", index);
+      const auto val = folly::sformat("val-{}", folly::Random::rand32());
+      database[key] = val;
+      futures.emplace_back(store->store(key, val));
+    }
+    folly::collectAll(std::move(futures)).get();
+    EXPECT_LT(store->getNumOfDbWritesToDisk(), 50);
+
+    EXPECT_TRUE(store->erase("key-0").get());
+    database.erase("key-0");
+  }
+
+  EXPECT_EQ(database, loadDatabaseFromDisk(filePath));
+}
+
+TEST(PersistentStoreTest, LogStructuredStoreLoad) {
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const std::string largeVal(64 * 1024, 'x');
+
+  StoreDatabase database;
+  std::string filePath;
+  {
+    PersistentStoreWrapper store(tid, true /* logStructured */);
+    store.run();
+    filePath = store.filePath;
+
+    // Write enough data to seal and compact several segments
+    for (auto index = 0; index < 100; index++) {
+      const auto key = folly::sformat("key-{}", index % 40);
+      const auto val = folly::sformat("{}-{}", largeVal, index);
+      database[key] = val;
+      store->store(key, val).get();
+    }
+    for (auto index = 0; index < 10; index++) {
+      const auto key = folly::sformat("key-{}", index);
+      database.erase(key);
+      EXPECT_TRUE(store->erase(key).get());
+    }
+    // Stop & destroy store, waiting for compaction to finish
+  }
+
+  // Sealed segments before last snapshot are compacted
+  const fs::path storagePath(filePath);
+  const auto filePrefix = storagePath.filename().string() + ".seg";
+  std::vector<fs::path> segments;
+  for (auto const& entry : fs::directory_iterator(storagePath.parent_path())) {
+    if (entry.path().filename().string().compare(
+            0, filePrefix.size(), filePrefix) == 0) {
+      segments.emplace_back(entry.path());
+    }
+  }
+  EXPECT_FALSE(fs::exists(filePath));
+  EXPECT_LE(segments.size(), Constants::kPersistentStoreMaxSegments + 2);
+
+  {
+    // Reload from mapped segments
+    PersistentStoreWrapper store(tid, true /* logStructured */);
+    store.run();
+    for (auto const& [key, val] : database) {
+      auto value = store->load(key).get();
+      ASSERT_TRUE(value.has_value());
+      EXPECT_EQ(val, *value);
+    }
+    for (auto index = 0; index < 10; index++) {
+      EXPECT_FALSE(store->load(folly::sformat("key-{}", index)).get());
+    }
+  }
+
+  for (auto const& segment : segments) {
+    fs::remove(segment);
+  }
+}
+
 } // namespace openr
 
 int
@@ -7,12 +7,16 @@
 
 #include <fb303/ServiceData.h>
 #include <folly/FileUtil.h>
+#include <folly/String.h>
 #include <glog/logging.h>
 #include <openr/if/gen-cpp2/Types_constants.h>
 #include <thrift/lib/cpp/util/EnumUtils.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <sched.h>
+#include <algorithm>
 #include <stdexcept>
 
+#include <openr/common/Constants.h>
 #include <openr/config/Config.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/if/gen-cpp2/OpenrConfig_types.h>
@@ -82,6 +86,95 @@ Config::getRunningConfig() const {
   return contents;
 }
 
+namespace {
+
+// reset fields which can be applied without restart, so that the remainder
+// of two configs can be compared as a whole
+thrift::OpenrConfig
+getRestartOnlyConfig(thrift::OpenrConfig config) {
+  config.originated_prefixes_ref().reset();
+  config.spark_config_ref()->hello_time_s_ref() = 0;
+  config.spark_config_ref()->fastinit_hello_time_ms_ref() = 0;
+  for (auto& area : *config.areas_ref()) {
+    area.neighbor_regexes_ref()->clear();
+    area.include_interface_regexes_ref()->clear();
+    area.exclude_interface_regexes_ref()->clear();
+    area.redistribute_interface_regexes_ref()->clear();
+  }
+  std::sort(
+      config.areas_ref()->begin(),
+      config.areas_ref()->end(),
+      [](auto const& lhs, auto const& rhs) {
+        return *lhs.area_id_ref() < *rhs.area_id_ref();
+      });
+  return config;
+}
+
+} // namespace
+
+ConfigDiff
+Config::getDiff(const Config& newConfig) const {
+  ConfigDiff diff;
+  const auto& newTConfig = newConfig.getConfig();
+
+  std::unordered_map<std::string, const thrift::AreaConfig*> oldAreas;
+  for (auto const& area : *config_.areas_ref()) {
+    oldAreas.emplace(*area.area_id_ref(), &area);
+  }
+  for (auto const& area : *newTConfig.areas_ref()) {
+    auto it = oldAreas.find(*area.area_id_ref());
+    if (it == oldAreas.end()) {
+      diff.addedAreas.emplace_back(*area.area_id_ref());
+      continue;
+    }
+    auto const& oldArea = *it->second;
+    if (*oldArea.neighbor_regexes_ref() != *area.neighbor_regexes_ref() or
+        *oldArea.include_interface_regexes_ref() !=
+            *area.include_interface_regexes_ref() or
+        *oldArea.exclude_interface_regexes_ref() !=
+            *area.exclude_interface_regexes_ref() or
+        *oldArea.redistribute_interface_regexes_ref() !=
+            *area.redistribute_interface_regexes_ref()) {
+      diff.changedAreas.emplace_back(*area.area_id_ref());
+    }
+    oldAreas.erase(it);
+  }
+  for (auto const& [areaId, _] : oldAreas) {
+    diff.removedAreas.emplace_back(areaId);
+  }
+  std::sort(diff.removedAreas.begin(), diff.removedAreas.end());
+
+  const auto& oldSpark = *config_.spark_config_ref();
+  const auto& newSpark = *newTConfig.spark_config_ref();
+  diff.sparkHelloTimeChanged =
+      *oldSpark.hello_time_s_ref() != *newSpark.hello_time_s_ref() or
+      *oldSpark.fastinit_hello_time_ms_ref() !=
+          *newSpark.fastinit_hello_time_ms_ref();
+
+  diff.originatedPrefixesChanged =
+      config_.originated_prefixes_ref().to_optional() !=
+      newTConfig.originated_prefixes_ref().to_optional();
+
+  // area membership changes need KvStore and Spark to be re-created
+  diff.requiresRestart =
+      not(getRestartOnlyConfig(config_) == getRestartOnlyConfig(newTConfig));
+  return diff;
+}
+
+std::string
+ConfigDiff::toString() const {
+  return fmt::format(
+      "added areas: [{}], removed areas: [{}], changed areas: [{}], "
+      "spark hello time changed: {}, originated prefixes changed: {}, "
+      "requires restart: {}",
+      folly::join(", ", addedAreas),
+      folly::join(", ", removedAreas),
+      folly::join(", ", changedAreas),
+      sparkHelloTimeChanged,
+      originatedPrefixesChanged,
+      requiresRestart);
+}
+
 PrefixAllocationParams
 Config::createPrefixAllocationParams(
     const std::string& seedPfxStr, uint8_t allocationPfxLen) {
@@ -114,8 +207,73 @@ Config::createPrefixAllocationParams(
   return {seedPfx, allocationPfxLen};
 }
 
+std::vector<std::string>
+Config::getNeighborAreaIds(
+    std::string const& neighbor, std::string const& iface) const {
+  auto key = std::make_pair(iface, neighbor);
+  {
+    auto cache = neighborAreaCache_.rlock();
+    auto it = cache->find(key);
+    if (it != cache->end()) {
+      return it->second;
+    }
+  }
+
+  std::vector<std::string> areaIds;
+  for (auto const& [areaId, areaConf] : areaConfigs_) {
+    if (areaConf.shouldDiscoverOnIface(iface) and
+        areaConf.shouldPeerWithNeighbor(neighbor)) {
+      areaIds.emplace_back(areaId);
+    }
+  }
+  std::sort(areaIds.begin(), areaIds.end());
+  neighborAreaCache_.wlock()->emplace(std::move(key), areaIds);
+  return areaIds;
+}
+
+Config::IfaceAreaMatch
+Config::getIfaceAreaMatch(std::string const& iface) const {
+  {
+    auto cache = ifaceAreaMatchCache_.rlock();
+    auto it = cache->find(iface);
+    if (it != cache->end()) {
+      return it->second;
+    }
+  }
+
+  IfaceAreaMatch match;
+  for (auto const& [areaId, areaConf] : areaConfigs_) {
+    match.shouldDiscover |= areaConf.shouldDiscoverOnIface(iface);
+    if (areaConf.shouldRedistributeIface(iface)) {
+      match.redistributeAreaIds.emplace_back(areaId);
+    }
+  }
+  std::sort(
+      match.redistributeAreaIds.begin(), match.redistributeAreaIds.end());
+  ifaceAreaMatchCache_.wlock()->emplace(iface, match);
+  return match;
+}
+
+bool
+Config::anyAreaShouldDiscoverOnIface(std::string const& iface) const {
+  return getIfaceAreaMatch(iface).shouldDiscover;
+}
+
+bool
+Config::anyAreaShouldRedistributeIface(std::string const& iface) const {
+  return not getIfaceAreaMatch(iface).redistributeAreaIds.empty();
+}
+
+std::vector<std::string>
+Config::getRedistributeAreaIds(std::string const& iface) const {
+  return getIfaceAreaMatch(iface).redistributeAreaIds;
+}
+
 void
 Config::populateAreaConfig() {
+  ifaceAreaMatchCache_.wlock()->clear();
+  neighborAreaCache_.wlock()->clear();
+
   if (config_.get_areas().empty()) {
     // TODO remove once transition to areas is complete
     thrift::AreaConfig defaultArea;
@@ -162,6 +320,31 @@ Config::populateAreaConfig() {
       }
     }
 
+    for (auto const& prefix : *areaConf.summary_prefixes_ref()) {
+      folly::CIDRNetwork network;
+      try {
+        network = folly::IPAddress::createNetwork(prefix);
+      } catch (const folly::IPAddressFormatException&) {
+        throw std::invalid_argument(fmt::format(
+            "Invalid summary prefix {} for area config id: {}",
+            prefix,
+            areaConf.get_area_id()));
+      }
+      // summary prefix is advertised as CONFIG prefix, same as originated
+      // prefixes
+      if (auto originatedPrefixes = config_.originated_prefixes_ref()) {
+        for (auto const& originated : *originatedPrefixes) {
+          if (folly::IPAddress::createNetwork(*originated.prefix_ref()) ==
+              network) {
+            throw std::invalid_argument(fmt::format(
+                "Summary prefix {} for area config id: {} is originated",
+                prefix,
+                areaConf.get_area_id()));
+          }
+        }
+      }
+    }
+
     if (!areaConfigs_.emplace(areaConf.get_area_id(), areaConf).second) {
       throw std::invalid_argument(
           fmt::format("Duplicate area config id: {}", areaConf.get_area_id()));
@@ -240,6 +423,59 @@ Config::populateInternalDb() {
       throw std::out_of_range("kvstore flood_msg_burst_size should be > 0");
     }
   }
+  if (const auto& originatorRate = kvConf.originator_flood_rate_ref()) {
+    if (not kvConf.flood_rate_ref().has_value()) {
+      throw std::invalid_argument(
+          "kvstore originator_flood_rate requires flood_rate");
+    }
+    if (*originatorRate->flood_msg_per_sec_ref() <= 0) {
+      throw std::out_of_range(
+          "kvstore originator flood_msg_per_sec should be > 0");
+    }
+    if (*originatorRate->flood_msg_burst_size_ref() <= 0) {
+      throw std::out_of_range(
+          "kvstore originator flood_msg_burst_size should be > 0");
+    }
+  }
+  if (const auto& keyClasses = kvConf.key_classes_ref()) {
+    std::unordered_set<std::string> names{"default"};
+    for (auto const& keyClass : *keyClasses) {
+      if (not names.emplace(*keyClass.name_ref()).second) {
+        throw std::invalid_argument(fmt::format(
+            "kvstore key class {} is defined twice or reserved",
+            *keyClass.name_ref()));
+      }
+      if (keyClass.key_prefixes_ref()->empty()) {
+        throw std::invalid_argument(fmt::format(
+            "kvstore key class {} has no key prefixes", *keyClass.name_ref()));
+      }
+    }
+  }
+  if (const auto& floodCoalesce = kvConf.flood_coalesce_ref()) {
+    if (*floodCoalesce->min_window_ms_ref() <= 0) {
+      throw std::out_of_range("kvstore coalesce min_window_ms should be > 0");
+    }
+    if (*floodCoalesce->max_window_ms_ref() <
+        *floodCoalesce->min_window_ms_ref()) {
+      throw std::out_of_range(
+          "kvstore coalesce max_window_ms should be >= min_window_ms");
+    }
+    if (*floodCoalesce->max_batch_keys_ref() <= 0) {
+      throw std::out_of_range("kvstore coalesce max_batch_keys should be > 0");
+    }
+  }
+  if (const auto& snapshotInterval = kvConf.snapshot_interval_s_ref()) {
+    if (*snapshotInterval <= 0) {
+      throw std::out_of_range("kvstore snapshot_interval_s should be > 0");
+    }
+  }
+  if (const auto& sampleRate = kvConf.perf_trace_sample_rate_ref()) {
+    if (*sampleRate < 0 or *sampleRate > 1) {
+      throw std::out_of_range(fmt::format(
+          "kvstore perf_trace_sample_rate ({}) should be in [0, 1]",
+          *sampleRate));
+    }
+  }
 
   //
   // Decision
@@ -252,6 +488,78 @@ Config::populateInternalDb() {
         *decisionConfig.debounce_min_ms_ref(),
         *decisionConfig.debounce_max_ms_ref()));
   }
+  if (*decisionConfig.route_build_threads_ref() < 1) {
+    throw std::out_of_range(fmt::format(
+        "decision_config.route_build_threads ({}) should be >= 1",
+        *decisionConfig.route_build_threads_ref()));
+  }
+  if (*decisionConfig.publication_decode_threads_ref() < 1) {
+    throw std::out_of_range(fmt::format(
+        "decision_config.publication_decode_threads ({}) should be >= 1",
+        *decisionConfig.publication_decode_threads_ref()));
+  }
+  if (auto dampConf = decisionConfig.prefix_dampening_config_ref()) {
+    if (*dampConf->withdraw_penalty_ref() < 0 or
+        *dampConf->attribute_change_penalty_ref() < 0) {
+      throw std::out_of_range(fmt::format(
+          "withdraw_penalty ({}) and attribute_change_penalty ({}) should be "
+          ">= 0",
+          *dampConf->withdraw_penalty_ref(),
+          *dampConf->attribute_change_penalty_ref()));
+    }
+    if (*dampConf->half_life_ms_ref() <= 0) {
+      throw std::out_of_range(fmt::format(
+          "half_life_ms ({}) should be > 0", *dampConf->half_life_ms_ref()));
+    }
+    if (*dampConf->max_suppress_ms_ref() < 0) {
+      throw std::out_of_range(fmt::format(
+          "max_suppress_ms ({}) should be >= 0",
+          *dampConf->max_suppress_ms_ref()));
+    }
+    if (*dampConf->reuse_threshold_ref() <= 0 or
+        *dampConf->reuse_threshold_ref() >=
+            *dampConf->suppress_threshold_ref()) {
+      throw std::out_of_range(fmt::format(
+          "reuse_threshold ({}) should be > 0 and < suppress_threshold ({})",
+          *dampConf->reuse_threshold_ref(),
+          *dampConf->suppress_threshold_ref()));
+    }
+  }
+
+  std::unordered_set<std::string> srPolicyNames;
+  std::unordered_set<folly::CIDRNetwork> srPolicyPrefixes;
+  for (auto const& policy : *decisionConfig.sr_policies_ref()) {
+    auto const& name = *policy.name_ref();
+    if (name.empty() or not srPolicyNames.emplace(name).second) {
+      throw std::invalid_argument(fmt::format(
+          "SR policy name '{}' should be non-empty and unique", name));
+    }
+    if (policy.destination_ref()->empty()) {
+      throw std::invalid_argument(
+          fmt::format("SR policy {} has no destination", name));
+    }
+    if (*policy.max_segments_ref() < 1) {
+      throw std::out_of_range(fmt::format(
+          "SR policy {} max_segments ({}) should be >= 1",
+          name,
+          *policy.max_segments_ref()));
+    }
+    for (auto const& prefix : *policy.prefixes_ref()) {
+      folly::CIDRNetwork network;
+      try {
+        network = folly::IPAddress::createNetwork(prefix);
+      } catch (const folly::IPAddressFormatException&) {
+        throw std::invalid_argument(
+            fmt::format("Invalid prefix {} of SR policy {}", prefix, name));
+      }
+      if (not srPolicyPrefixes.emplace(network).second) {
+        throw std::invalid_argument(fmt::format(
+            "Prefix {} of SR policy {} is steered by another policy",
+            prefix,
+            name));
+      }
+    }
+  }
 
   //
   // Spark
@@ -332,6 +640,30 @@ Config::populateInternalDb() {
         *sparkConfig.step_detector_conf_ref()->upper_threshold_ref()));
   }
 
+  if (*sparkConfig.num_workers_ref() <= 0) {
+    throw std::out_of_range(fmt::format(
+        "num_workers ({}) should be > 0", *sparkConfig.num_workers_ref()));
+  }
+
+  if (const auto& fastConf = sparkConfig.fast_detection_config_ref()) {
+    if (*fastConf->tx_interval_ms_ref() <= 0) {
+      throw std::out_of_range(fmt::format(
+          "fast_detection_config.tx_interval_ms ({}) should be > 0",
+          *fastConf->tx_interval_ms_ref()));
+    }
+    if (*fastConf->detect_multiplier_ref() <= 0) {
+      throw std::out_of_range(fmt::format(
+          "fast_detection_config.detect_multiplier ({}) should be > 0",
+          *fastConf->detect_multiplier_ref()));
+    }
+    if (*fastConf->port_ref() <= 0 || *fastConf->port_ref() > 65535 ||
+        *fastConf->port_ref() == *sparkConfig.neighbor_discovery_port_ref()) {
+      throw std::out_of_range(fmt::format(
+          "fast_detection_config.port ({}) should be in range [1, 65535] and differ from neighbor_discovery_port",
+          *fastConf->port_ref()));
+    }
+  }
+
   if (*sparkConfig.step_detector_conf_ref()->fast_window_size_ref() < 0 ||
       *sparkConfig.step_detector_conf_ref()->slow_window_size_ref() < 0 ||
       (*sparkConfig.step_detector_conf_ref()->fast_window_size_ref() >
@@ -352,6 +684,25 @@ Config::populateInternalDb() {
         *sparkConfig.step_detector_conf_ref()->upper_threshold_ref()));
   }
 
+  //
+  // Fib
+  //
+  if (const auto& fibConf = config_.fib_programming_config_ref()) {
+    if (*fibConf->chunk_size_ref() <= 0) {
+      throw std::out_of_range("fib chunk_size should be > 0");
+    }
+    if (*fibConf->max_chunks_in_flight_ref() <= 0) {
+      throw std::out_of_range("fib max_chunks_in_flight should be > 0");
+    }
+    // unspecified, default, main and local tables are reserved
+    if (auto table = fibConf->shadow_table_id_ref();
+        table.has_value() and
+        (*table <= 0 or (*table >= 253 and *table <= 255))) {
+      throw std::out_of_range(fmt::format(
+          "fib shadow_table_id ({}) should be > 0 and not reserved", *table));
+    }
+  }
+
   //
   // Monitor
   //
@@ -388,6 +739,65 @@ Config::populateInternalDb() {
         *lmConf.linkflap_max_backoff_ms_ref()));
   }
 
+  // penalty based dampening validation
+  if (lmConf.linkflap_dampening_config_ref().has_value()) {
+    const auto& dampConf = *lmConf.linkflap_dampening_config_ref();
+    if (*dampConf.penalty_per_flap_ref() <= 0) {
+      throw std::out_of_range(fmt::format(
+          "penalty_per_flap ({}) should be > 0",
+          *dampConf.penalty_per_flap_ref()));
+    }
+    if (*dampConf.half_life_ms_ref() <= 0) {
+      throw std::out_of_range(fmt::format(
+          "half_life_ms ({}) should be > 0", *dampConf.half_life_ms_ref()));
+    }
+    if (*dampConf.max_suppress_ms_ref() < 0) {
+      throw std::out_of_range(fmt::format(
+          "max_suppress_ms ({}) should be >= 0",
+          *dampConf.max_suppress_ms_ref()));
+    }
+    if (*dampConf.reuse_threshold_ref() <= 0 or
+        *dampConf.reuse_threshold_ref() >=
+            *dampConf.suppress_threshold_ref()) {
+      throw std::out_of_range(fmt::format(
+          "reuse_threshold ({}) should be > 0 and < suppress_threshold ({})",
+          *dampConf.reuse_threshold_ref(),
+          *dampConf.suppress_threshold_ref()));
+    }
+  }
+
+  if (lmConf.rtt_metric_quantization_config_ref().has_value()) {
+    const auto& rttConf = *lmConf.rtt_metric_quantization_config_ref();
+    if (*rttConf.band_width_us_ref() <= 0) {
+      throw std::out_of_range(fmt::format(
+          "band_width_us ({}) should be > 0", *rttConf.band_width_us_ref()));
+    }
+    if (*rttConf.hysteresis_us_ref() < 0) {
+      throw std::out_of_range(fmt::format(
+          "hysteresis_us ({}) should be >= 0", *rttConf.hysteresis_us_ref()));
+    }
+    if (*rttConf.min_hold_time_ms_ref() < 0) {
+      throw std::out_of_range(fmt::format(
+          "min_hold_time_ms ({}) should be >= 0",
+          *rttConf.min_hold_time_ms_ref()));
+    }
+  }
+
+  // adjacency advertisement coalescing validation
+  if (*lmConf.adj_advertise_min_interval_ms_ref() < 0) {
+    throw std::out_of_range(fmt::format(
+        "adj_advertise_min_interval_ms ({}) should be >= 0",
+        *lmConf.adj_advertise_min_interval_ms_ref()));
+  }
+
+  if (*lmConf.adj_advertise_min_interval_ms_ref() >
+      *lmConf.adj_advertise_max_delay_ms_ref()) {
+    throw std::out_of_range(fmt::format(
+        "adj_advertise_min_interval_ms ({}) should be <= adj_advertise_max_delay_ms ({})",
+        *lmConf.adj_advertise_min_interval_ms_ref(),
+        *lmConf.adj_advertise_max_delay_ms_ref()));
+  }
+
   //
   // Segment Routing Config
   //
@@ -455,6 +865,12 @@ Config::populateInternalDb() {
       throw std::invalid_argument("invalid prefix_allocation_mode");
     }
 
+    if (*paConf->batch_claim_hold_time_ms_ref() < 0) {
+      throw std::out_of_range(fmt::format(
+          "batch_claim_hold_time_ms ({}) should be >= 0",
+          *paConf->batch_claim_hold_time_ms_ref()));
+    }
+
     auto seedPrefix = paConf->seed_prefix_ref().value_or("");
     auto allocatePfxLen = paConf->allocate_prefix_len_ref().value_or(0);
 
@@ -542,5 +958,85 @@ Config::populateInternalDb() {
         "enable_watchdog = true, but watchdog_config is empty");
   }
 
+  //
+  // thread configs
+  //
+  for (auto const& [module, threadConfig] : *config_.thread_configs_ref()) {
+    if (threadConfig.thread_name_ref() and
+        (threadConfig.thread_name_ref()->empty() or
+         threadConfig.thread_name_ref()->size() > 15)) {
+      throw std::out_of_range(fmt::format(
+          "thread_name of module {} must have 1 to 15 characters", module));
+    }
+    for (auto cpu : *threadConfig.cpu_affinity_ref()) {
+      if (cpu < 0 or cpu >= CPU_SETSIZE) {
+        throw std::out_of_range(fmt::format(
+            "cpu_affinity of module {}: invalid CPU {}", module, cpu));
+      }
+    }
+    if (threadConfig.nice_ref() and
+        (*threadConfig.nice_ref() < -20 or *threadConfig.nice_ref() > 19)) {
+      throw std::out_of_range(fmt::format(
+          "nice of module {} should be in range [-20, 19], got {}",
+          module,
+          *threadConfig.nice_ref()));
+    }
+  }
+
+  //
+  // ctrl stream config
+  //
+  const auto& streamConfig = *config_.ctrl_stream_config_ref();
+  if (*streamConfig.max_buffered_updates_ref() <= 0) {
+    throw std::out_of_range(fmt::format(
+        "ctrl_stream_config.max_buffered_updates ({}) should be > 0",
+        *streamConfig.max_buffered_updates_ref()));
+  }
+  if (*streamConfig.max_coalesced_entries_ref() <= 0) {
+    throw std::out_of_range(fmt::format(
+        "ctrl_stream_config.max_coalesced_entries ({}) should be > 0",
+        *streamConfig.max_coalesced_entries_ref()));
+  }
+
+  //
+  // sharded prefix db
+  //
+  if (*config_.num_prefix_db_shards_ref() < 0 or
+      *config_.num_prefix_db_shards_ref() > Constants::kMaxPrefixDbShards) {
+    throw std::out_of_range(fmt::format(
+        "num_prefix_db_shards ({}) should be in range [0, {}]",
+        *config_.num_prefix_db_shards_ref(),
+        Constants::kMaxPrefixDbShards));
+  }
+  if (*config_.prefix_manager_sync_threads_ref() < 1) {
+    throw std::out_of_range(fmt::format(
+        "prefix_manager_sync_threads ({}) should be >= 1",
+        *config_.prefix_manager_sync_threads_ref()));
+  }
+
+  //
+  // persistent config store
+  //
+  if (*config_.config_store_group_commit_ms_ref() < 0) {
+    throw std::out_of_range(fmt::format(
+        "config_store_group_commit_ms ({}) should be >= 0",
+        *config_.config_store_group_commit_ms_ref()));
+  }
+
+  //
+  // thrift server config
+  //
+  const auto& thriftServerConfig = *config_.thrift_server_ref();
+  if (*thriftServerConfig.num_io_worker_threads_ref() <= 0) {
+    throw std::out_of_range(fmt::format(
+        "thrift_server.num_io_worker_threads ({}) should be > 0",
+        *thriftServerConfig.num_io_worker_threads_ref()));
+  }
+  if (*thriftServerConfig.num_cpu_worker_threads_ref() <= 0) {
+    throw std::out_of_range(fmt::format(
+        "thrift_server.num_cpu_worker_threads ({}) should be > 0",
+        *thriftServerConfig.num_cpu_worker_threads_ref()));
+  }
+
 } // namespace openr
 } // namespace openr
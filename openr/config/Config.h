@@ -15,6 +15,8 @@ namespace fs = std::filesystem;
 namespace fs = std::experimental::filesystem;
 #endif
 #include <folly/IPAddress.h>
+#include <folly/Synchronized.h>
+#include <folly/hash/Hash.h>
 #include <openr/common/MplsUtil.h>
 #include <re2/re2.h>
 #include <re2/set.h>
@@ -42,6 +44,9 @@ class AreaConfiguration {
     if (area.get_import_policy_name()) {
       importPolicyName_ = *area.import_policy_name_ref();
     }
+    for (auto const& prefix : *area.summary_prefixes_ref()) {
+      summaryPrefixes_.emplace_back(folly::IPAddress::createNetwork(prefix));
+    }
   }
 
   std::string const&
@@ -70,11 +75,19 @@ class AreaConfiguration {
     return importPolicyName_;
   }
 
+  std::vector<folly::CIDRNetwork> const&
+  getSummaryPrefixes() const {
+    return summaryPrefixes_;
+  }
+
  private:
   const std::string areaId_;
 
   std::optional<std::string> importPolicyName_{std::nullopt};
 
+  // prefixes summarizing routes redistributed into this area
+  std::vector<folly::CIDRNetwork> summaryPrefixes_;
+
   // given a list of strings we will convert is to a compiled RE2::Set
   static std::shared_ptr<re2::RE2::Set> compileRegexSet(
       std::vector<std::string> const& strings);
@@ -83,6 +96,30 @@ class AreaConfiguration {
       interfaceExcludeRegexSet_, interfaceRedistRegexSet_;
 };
 
+/*
+ * Difference between a running config and a new config. Changes other than
+ * the ones listed individually can only be applied by restarting Open/R.
+ */
+struct ConfigDiff {
+  std::vector<std::string> addedAreas;
+  std::vector<std::string> removedAreas;
+  // areas whose neighbor or interface regexes changed
+  std::vector<std::string> changedAreas;
+  // spark hello_time_s or fastinit_hello_time_ms changed
+  bool sparkHelloTimeChanged{false};
+  bool originatedPrefixesChanged{false};
+  bool requiresRestart{false};
+
+  bool
+  empty() const {
+    return addedAreas.empty() and removedAreas.empty() and
+        changedAreas.empty() and not sparkHelloTimeChanged and
+        not originatedPrefixesChanged and not requiresRestart;
+  }
+
+  std::string toString() const;
+};
+
 class Config {
  public:
   explicit Config(const std::string& configFile);
@@ -102,6 +139,9 @@ class Config {
   }
   std::string getRunningConfig() const;
 
+  // diff of `newConfig` against this config, see ConfigDiff
+  ConfigDiff getDiff(const Config& newConfig) const;
+
   const std::string&
   getNodeName() const {
     return *config_.node_name_ref();
@@ -198,6 +238,23 @@ class Config {
     return ids;
   }
 
+  // Memoized area regex matching. Results are cached per interface and
+  // (interface, neighbor) until areas are populated again. Thread safe.
+
+  // sorted IDs of areas in which to peer with `neighbor` on `iface`
+  std::vector<std::string> getNeighborAreaIds(
+      std::string const& neighbor, std::string const& iface) const;
+
+  // returns any(a.shouldDiscoverOnIface(iface) for a in areas)
+  bool anyAreaShouldDiscoverOnIface(std::string const& iface) const;
+
+  // returns any(a.shouldRedistributeIface(iface) for a in areas)
+  bool anyAreaShouldRedistributeIface(std::string const& iface) const;
+
+  // sorted IDs of areas to redistribute addresses of `iface` into
+  std::vector<std::string> getRedistributeAreaIds(
+      std::string const& iface) const;
+
   //
   // spark
   //
@@ -329,6 +386,18 @@ class Config {
     return *config_.watchdog_config_ref();
   }
 
+  //
+  // thread config
+  //
+  std::optional<thrift::ThreadConfig>
+  getThreadConfig(std::string const& module) const {
+    auto it = config_.thread_configs_ref()->find(module);
+    if (it == config_.thread_configs_ref()->end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
   //
   // monitor
   //
@@ -376,6 +445,23 @@ class Config {
 
   // areaId -> neighbor regex and interface regex mapped
   std::unordered_map<std::string /* areaId */, AreaConfiguration> areaConfigs_;
+
+  // interface regex matches across all areas
+  struct IfaceAreaMatch {
+    bool shouldDiscover{false};
+    std::vector<std::string> redistributeAreaIds;
+  };
+  IfaceAreaMatch getIfaceAreaMatch(std::string const& iface) const;
+
+  // match caches of area regexes, cleared in populateAreaConfig()
+  mutable folly::Synchronized<
+      std::unordered_map<std::string /* iface */, IfaceAreaMatch>>
+      ifaceAreaMatchCache_;
+  mutable folly::Synchronized<std::unordered_map<
+      std::pair<std::string /* iface */, std::string /* neighbor */>,
+      std::vector<std::string /* areaId */>,
+      folly::hasher<std::pair<std::string, std::string>>>>
+      neighborAreaCache_;
 };
 
 } // namespace openr
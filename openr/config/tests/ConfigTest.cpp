@@ -272,6 +272,31 @@ TEST(ConfigTest, PopulateAreaConfig) {
     EXPECT_THROW(auto c = Config(conf), std::invalid_argument);
   }
 
+  // summary prefixes
+  {
+    openr::thrift::AreaConfig areaConfig;
+    areaConfig.area_id_ref() = myArea;
+    areaConfig.summary_prefixes_ref()->emplace_back("10.0.0.0/8");
+    std::vector<openr::thrift::AreaConfig> vec = {areaConfig};
+    auto conf = getBasicOpenrConfig("node-1", "domain", vec);
+    Config cfg = Config(conf);
+    EXPECT_EQ(
+        cfg.getAreas().at(myArea).getSummaryPrefixes(),
+        std::vector<folly::CIDRNetwork>(
+            {folly::IPAddress::createNetwork("10.0.0.0/8")}));
+
+    // summary prefix can't be an originated prefix
+    openr::thrift::OriginatedPrefix originatedPrefix;
+    originatedPrefix.prefix_ref() = "10.0.0.0/8";
+    conf.originated_prefixes_ref() = {originatedPrefix};
+    EXPECT_THROW(auto c = Config(conf), std::invalid_argument);
+
+    // invalid summary prefix
+    conf.originated_prefixes_ref().reset();
+    conf.areas_ref()->at(0).summary_prefixes_ref() = {"10.0.0.0/42"};
+    EXPECT_THROW(auto c = Config(conf), std::invalid_argument);
+  }
+
   // area segment node label
   {
     auto confAreaPolicy = getBasicOpenrConfig();
@@ -353,6 +378,101 @@ TEST(ConfigTest, AreaConfiguration) {
   EXPECT_FALSE(areaConf.shouldRedistributeIface(""));
 }
 
+TEST(ConfigTest, MemoizedAreaMatch) {
+  openr::thrift::AreaConfig areaConfig1;
+  areaConfig1.area_id_ref() = "area1";
+  areaConfig1.include_interface_regexes_ref()->emplace_back("iface.*");
+  areaConfig1.exclude_interface_regexes_ref()->emplace_back(".*400.*");
+  areaConfig1.redistribute_interface_regexes_ref()->emplace_back("loopback.*");
+  areaConfig1.neighbor_regexes_ref()->emplace_back("fsw.*");
+  openr::thrift::AreaConfig areaConfig2;
+  areaConfig2.area_id_ref() = "area2";
+  areaConfig2.include_interface_regexes_ref()->emplace_back("iface.*");
+  areaConfig2.redistribute_interface_regexes_ref()->emplace_back("loopback1");
+  areaConfig2.neighbor_regexes_ref()->emplace_back(".*");
+  Config cfg{
+      getBasicOpenrConfig("node-1", "domain", {areaConfig2, areaConfig1})};
+
+  // repeated lookups are served from cache with same results
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(
+        std::vector<std::string>({"area1", "area2"}),
+        cfg.getNeighborAreaIds("fsw001", "iface20"));
+    EXPECT_EQ(
+        std::vector<std::string>({"area2"}),
+        cfg.getNeighborAreaIds("rsw001", "iface20"));
+    EXPECT_EQ(
+        std::vector<std::string>({"area2"}),
+        cfg.getNeighborAreaIds("fsw001", "iface400"));
+    EXPECT_TRUE(cfg.getNeighborAreaIds("fsw001", "loopback1").empty());
+
+    EXPECT_TRUE(cfg.anyAreaShouldDiscoverOnIface("iface400"));
+    EXPECT_FALSE(cfg.anyAreaShouldDiscoverOnIface("loopback1"));
+    EXPECT_TRUE(cfg.anyAreaShouldRedistributeIface("loopback2"));
+    EXPECT_FALSE(cfg.anyAreaShouldRedistributeIface("iface20"));
+    EXPECT_EQ(
+        std::vector<std::string>({"area1", "area2"}),
+        cfg.getRedistributeAreaIds("loopback1"));
+    EXPECT_EQ(
+        std::vector<std::string>({"area1"}),
+        cfg.getRedistributeAreaIds("loopback2"));
+  }
+}
+
+TEST(ConfigTest, ConfigDiff) {
+  openr::thrift::AreaConfig areaConfig1;
+  areaConfig1.area_id_ref() = "area1";
+  areaConfig1.include_interface_regexes_ref()->emplace_back("iface.*");
+  areaConfig1.neighbor_regexes_ref()->emplace_back(".*");
+  openr::thrift::AreaConfig areaConfig2;
+  areaConfig2.area_id_ref() = "area2";
+  areaConfig2.neighbor_regexes_ref()->emplace_back(".*");
+  const auto tConfig =
+      getBasicOpenrConfig("node-1", "domain", {areaConfig1, areaConfig2});
+  const Config cfg{tConfig};
+
+  // identical config
+  EXPECT_TRUE(cfg.getDiff(Config{tConfig}).empty());
+
+  // regexes, hello timers and originated prefixes are applied in place
+  {
+    auto newTConfig = tConfig;
+    newTConfig.areas_ref()->at(1).include_interface_regexes_ref()->emplace_back(
+        "po.*");
+    newTConfig.spark_config_ref()->hello_time_s_ref() = 5;
+    thrift::OriginatedPrefix originatedPrefix;
+    originatedPrefix.prefix_ref() = "fc00::/64";
+    newTConfig.originated_prefixes_ref() =
+        std::vector<thrift::OriginatedPrefix>{originatedPrefix};
+    // area order doesn't matter
+    std::swap(newTConfig.areas_ref()->at(0), newTConfig.areas_ref()->at(1));
+
+    const auto diff = cfg.getDiff(Config{newTConfig});
+    EXPECT_FALSE(diff.empty());
+    EXPECT_TRUE(diff.addedAreas.empty());
+    EXPECT_TRUE(diff.removedAreas.empty());
+    EXPECT_EQ(std::vector<std::string>({"area2"}), diff.changedAreas);
+    EXPECT_TRUE(diff.sparkHelloTimeChanged);
+    EXPECT_TRUE(diff.originatedPrefixesChanged);
+    EXPECT_FALSE(diff.requiresRestart);
+  }
+
+  // area membership and other knobs need a restart
+  {
+    auto newTConfig = tConfig;
+    newTConfig.areas_ref()->at(1).area_id_ref() = "area3";
+    newTConfig.enable_v4_ref() = true;
+
+    const auto diff = cfg.getDiff(Config{newTConfig});
+    EXPECT_EQ(std::vector<std::string>({"area3"}), diff.addedAreas);
+    EXPECT_EQ(std::vector<std::string>({"area2"}), diff.removedAreas);
+    EXPECT_TRUE(diff.changedAreas.empty());
+    EXPECT_FALSE(diff.sparkHelloTimeChanged);
+    EXPECT_FALSE(diff.originatedPrefixesChanged);
+    EXPECT_TRUE(diff.requiresRestart);
+  }
+}
+
 TEST(ConfigTest, BgpTranslationConfig) {
   auto tConfig = getBasicOpenrConfig();
   tConfig.enable_bgp_peering_ref() = true;
@@ -426,6 +546,100 @@ TEST(ConfigTest, PopulateInternalDb) {
         ->flood_msg_burst_size_ref() = 0;
     EXPECT_THROW((Config(confInvalidFloodMsgPerSec)), std::out_of_range);
   }
+  // originator_flood_rate without flood_rate
+  {
+    auto confInvalidOriginatorRate = getBasicOpenrConfig();
+    confInvalidOriginatorRate.kvstore_config_ref()
+        ->originator_flood_rate_ref() = getFloodRate();
+    EXPECT_THROW((Config(confInvalidOriginatorRate)), std::invalid_argument);
+  }
+  // originator flood_msg_per_sec <= 0
+  {
+    auto confInvalidOriginatorRate = getBasicOpenrConfig();
+    confInvalidOriginatorRate.kvstore_config_ref()->flood_rate_ref() =
+        getFloodRate();
+    confInvalidOriginatorRate.kvstore_config_ref()
+        ->originator_flood_rate_ref() = getFloodRate();
+    confInvalidOriginatorRate.kvstore_config_ref()
+        ->originator_flood_rate_ref()
+        ->flood_msg_per_sec_ref() = 0;
+    EXPECT_THROW((Config(confInvalidOriginatorRate)), std::out_of_range);
+  }
+  // key class named default or without key prefixes
+  {
+    auto confInvalidKeyClass = getBasicOpenrConfig();
+    thrift::KvstoreKeyClass keyClass;
+    keyClass.name_ref() = "default";
+    keyClass.key_prefixes_ref() = {"adj:"};
+    confInvalidKeyClass.kvstore_config_ref()->key_classes_ref() = {keyClass};
+    EXPECT_THROW((Config(confInvalidKeyClass)), std::invalid_argument);
+
+    keyClass.name_ref() = "adj";
+    keyClass.key_prefixes_ref()->clear();
+    confInvalidKeyClass.kvstore_config_ref()->key_classes_ref() = {keyClass};
+    EXPECT_THROW((Config(confInvalidKeyClass)), std::invalid_argument);
+  }
+  // coalesce max_window_ms < min_window_ms
+  {
+    auto confInvalidCoalesce = getBasicOpenrConfig();
+    thrift::KvstoreFloodCoalesce floodCoalesce;
+    floodCoalesce.min_window_ms_ref() = 10;
+    floodCoalesce.max_window_ms_ref() = 5;
+    confInvalidCoalesce.kvstore_config_ref()->flood_coalesce_ref() =
+        floodCoalesce;
+    EXPECT_THROW((Config(confInvalidCoalesce)), std::out_of_range);
+  }
+  // coalesce max_batch_keys <= 0
+  {
+    auto confInvalidCoalesce = getBasicOpenrConfig();
+    thrift::KvstoreFloodCoalesce floodCoalesce;
+    floodCoalesce.max_batch_keys_ref() = 0;
+    confInvalidCoalesce.kvstore_config_ref()->flood_coalesce_ref() =
+        floodCoalesce;
+    EXPECT_THROW((Config(confInvalidCoalesce)), std::out_of_range);
+  }
+  // snapshot_interval_s <= 0
+  {
+    auto confInvalidSnapshot = getBasicOpenrConfig();
+    confInvalidSnapshot.kvstore_config_ref()->snapshot_interval_s_ref() = 0;
+    EXPECT_THROW((Config(confInvalidSnapshot)), std::out_of_range);
+  }
+  // perf_trace_sample_rate out of [0, 1]
+  {
+    auto confInvalidSampleRate = getBasicOpenrConfig();
+    confInvalidSampleRate.kvstore_config_ref()->perf_trace_sample_rate_ref() =
+        1.5;
+    EXPECT_THROW((Config(confInvalidSampleRate)), std::out_of_range);
+    confInvalidSampleRate.kvstore_config_ref()->perf_trace_sample_rate_ref() =
+        -0.1;
+    EXPECT_THROW((Config(confInvalidSampleRate)), std::out_of_range);
+  }
+
+  // Decision
+
+  // Exception: route_build_threads < 1
+  {
+    auto confInvalidDecision = getBasicOpenrConfig();
+    confInvalidDecision.decision_config_ref()->route_build_threads_ref() = 0;
+    EXPECT_THROW((Config(confInvalidDecision)), std::out_of_range);
+  }
+  // Exception: publication_decode_threads < 1
+  {
+    auto confInvalidDecision = getBasicOpenrConfig();
+    confInvalidDecision.decision_config_ref()
+        ->publication_decode_threads_ref() = 0;
+    EXPECT_THROW((Config(confInvalidDecision)), std::out_of_range);
+  }
+  // prefix_dampening_config: reuse_threshold >= suppress_threshold
+  {
+    auto confInvalidDecision = getBasicOpenrConfig();
+    thrift::PrefixDampeningConfig dampConf;
+    dampConf.suppress_threshold_ref() = 1000;
+    dampConf.reuse_threshold_ref() = 1000;
+    confInvalidDecision.decision_config_ref()->prefix_dampening_config_ref() =
+        dampConf;
+    EXPECT_THROW((Config(confInvalidDecision)), std::out_of_range);
+  }
 
   // Spark
 
@@ -484,6 +698,34 @@ TEST(ConfigTest, PopulateInternalDb) {
     EXPECT_THROW(auto c = Config(confInvalidSpark), std::invalid_argument);
   }
 
+  // Exception: fast detection tx_interval_ms <= 0, detect_multiplier <= 0,
+  //            port out of range or same as neighbor_discovery_port
+  {
+    auto confInvalidSpark = getBasicOpenrConfig();
+    thrift::SparkFastDetectionConfig fastConf;
+    fastConf.tx_interval_ms_ref() = 0;
+    confInvalidSpark.spark_config_ref()->fast_detection_config_ref() = fastConf;
+    EXPECT_THROW(auto c = Config(confInvalidSpark), std::out_of_range);
+
+    fastConf = thrift::SparkFastDetectionConfig();
+    fastConf.detect_multiplier_ref() = 0;
+    confInvalidSpark.spark_config_ref()->fast_detection_config_ref() = fastConf;
+    EXPECT_THROW(auto c = Config(confInvalidSpark), std::out_of_range);
+
+    fastConf = thrift::SparkFastDetectionConfig();
+    fastConf.port_ref() =
+        *confInvalidSpark.spark_config_ref()->neighbor_discovery_port_ref();
+    confInvalidSpark.spark_config_ref()->fast_detection_config_ref() = fastConf;
+    EXPECT_THROW(auto c = Config(confInvalidSpark), std::out_of_range);
+  }
+
+  // Exception num_workers > 0
+  {
+    auto confInvalidSpark = getBasicOpenrConfig();
+    confInvalidSpark.spark_config_ref()->num_workers_ref() = 0;
+    EXPECT_THROW(auto c = Config(confInvalidSpark), std::out_of_range);
+  }
+
   // Exception step_detector_fast_window_size >= 0
   //           step_detector_slow_window_size >= 0
   //           step_detector_lower_threshold >= 0
@@ -529,6 +771,25 @@ TEST(ConfigTest, PopulateInternalDb) {
     EXPECT_THROW(auto c = Config(confInvalidSpark), std::invalid_argument);
   }
 
+  // Fib
+
+  // Exception chunk_size <= 0
+  {
+    auto confInvalidFib = getBasicOpenrConfig();
+    thrift::FibProgrammingConfig fibConf;
+    fibConf.chunk_size_ref() = 0;
+    confInvalidFib.fib_programming_config_ref() = fibConf;
+    EXPECT_THROW(auto c = Config(confInvalidFib), std::out_of_range);
+  }
+  // Exception max_chunks_in_flight <= 0
+  {
+    auto confInvalidFib = getBasicOpenrConfig();
+    thrift::FibProgrammingConfig fibConf;
+    fibConf.max_chunks_in_flight_ref() = 0;
+    confInvalidFib.fib_programming_config_ref() = fibConf;
+    EXPECT_THROW(auto c = Config(confInvalidFib), std::out_of_range);
+  }
+
   // Monitor
 
   // Exception monitor_max_event_log >= 0
@@ -562,6 +823,50 @@ TEST(ConfigTest, PopulateInternalDb) {
         300000;
     EXPECT_THROW(auto c = Config(confInvalidLm), std::out_of_range);
   }
+  // adj_advertise_min_interval_ms < 0
+  {
+    auto confInvalidLm = getBasicOpenrConfig();
+    confInvalidLm.link_monitor_config_ref()
+        ->adj_advertise_min_interval_ms_ref() = -1;
+    EXPECT_THROW(auto c = Config(confInvalidLm), std::out_of_range);
+  }
+  // adj_advertise_min_interval_ms > adj_advertise_max_delay_ms
+  {
+    auto confInvalidLm = getBasicOpenrConfig();
+    confInvalidLm.link_monitor_config_ref()
+        ->adj_advertise_min_interval_ms_ref() = 2000;
+    confInvalidLm.link_monitor_config_ref()->adj_advertise_max_delay_ms_ref() =
+        1000;
+    EXPECT_THROW(auto c = Config(confInvalidLm), std::out_of_range);
+  }
+  // linkflap_dampening_config: reuse_threshold >= suppress_threshold
+  {
+    auto confInvalidLm = getBasicOpenrConfig();
+    thrift::LinkFlapDampeningConfig dampConf;
+    dampConf.suppress_threshold_ref() = 1000;
+    dampConf.reuse_threshold_ref() = 1000;
+    confInvalidLm.link_monitor_config_ref()->linkflap_dampening_config_ref() =
+        dampConf;
+    EXPECT_THROW(auto c = Config(confInvalidLm), std::out_of_range);
+  }
+  // linkflap_dampening_config: half_life_ms <= 0
+  {
+    auto confInvalidLm = getBasicOpenrConfig();
+    thrift::LinkFlapDampeningConfig dampConf;
+    dampConf.half_life_ms_ref() = 0;
+    confInvalidLm.link_monitor_config_ref()->linkflap_dampening_config_ref() =
+        dampConf;
+    EXPECT_THROW(auto c = Config(confInvalidLm), std::out_of_range);
+  }
+  // rtt_metric_quantization_config: band_width_us <= 0
+  {
+    auto confInvalidLm = getBasicOpenrConfig();
+    thrift::RttMetricQuantizationConfig rttConf;
+    rttConf.band_width_us_ref() = 0;
+    confInvalidLm.link_monitor_config_ref()
+        ->rtt_metric_quantization_config_ref() = rttConf;
+    EXPECT_THROW(auto c = Config(confInvalidLm), std::out_of_range);
+  }
 
   // prefix allocation
 
@@ -593,6 +898,16 @@ TEST(ConfigTest, PopulateInternalDb) {
         thrift::PrefixAllocationMode::DYNAMIC_ROOT_NODE;
     EXPECT_THROW((Config(confInvalidPa)), std::invalid_argument);
   }
+  // batch_claim_hold_time_ms < 0
+  {
+    auto confInvalidPa = getBasicOpenrConfig();
+    confInvalidPa.enable_prefix_allocation_ref() = true;
+    confInvalidPa.prefix_allocation_config_ref() = getPrefixAllocationConfig(
+        thrift::PrefixAllocationMode::DYNAMIC_ROOT_NODE);
+    confInvalidPa.prefix_allocation_config_ref()
+        ->batch_claim_hold_time_ms_ref() = -1;
+    EXPECT_THROW((Config(confInvalidPa)), std::out_of_range);
+  }
   // seed_prefix: invalid ipadrres format
   {
     auto confInvalidPa = getBasicOpenrConfig();
@@ -665,6 +980,83 @@ TEST(ConfigTest, PopulateInternalDb) {
     EXPECT_THROW((Config(confInvalid)), std::invalid_argument);
   }
 
+  // thread configs
+
+  // thread_name too long
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    thrift::ThreadConfig threadConfig;
+    threadConfig.thread_name_ref() = "openr-decision-module";
+    confInvalid.thread_configs_ref()->emplace("decision", threadConfig);
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+  // invalid cpu
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    thrift::ThreadConfig threadConfig;
+    threadConfig.cpu_affinity_ref() = {0, -1};
+    confInvalid.thread_configs_ref()->emplace("spark", threadConfig);
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+  // nice out of range
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    thrift::ThreadConfig threadConfig;
+    threadConfig.nice_ref() = -21;
+    confInvalid.thread_configs_ref()->emplace("spark", threadConfig);
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+
+  // ctrl stream limits <= 0
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.ctrl_stream_config_ref()->max_buffered_updates_ref() = 0;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.ctrl_stream_config_ref()->max_coalesced_entries_ref() = -1;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+
+  // num_prefix_db_shards out of range
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.num_prefix_db_shards_ref() = -1;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.num_prefix_db_shards_ref() = Constants::kMaxPrefixDbShards + 1;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+
+  // prefix_manager_sync_threads < 1
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.prefix_manager_sync_threads_ref() = 0;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+
+  // config_store_group_commit_ms < 0
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.config_store_group_commit_ms_ref() = -1;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+
+  // thrift server threads <= 0
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.thrift_server_ref()->num_io_worker_threads_ref() = 0;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+  {
+    auto confInvalid = getBasicOpenrConfig();
+    confInvalid.thrift_server_ref()->num_cpu_worker_threads_ref() = -1;
+    EXPECT_THROW((Config(confInvalid)), std::out_of_range);
+  }
+
   // vip service
   {
     auto conf = getBasicOpenrConfig();
@@ -761,6 +1153,21 @@ TEST(ConfigTest, GeneralGetter) {
     EXPECT_TRUE(config.isWatchdogEnabled());
     EXPECT_EQ(watchdogConf, config.getWatchdogConfig());
   }
+
+  // config with thread configs
+  {
+    auto tConfig = getBasicOpenrConfig("fsw001");
+    thrift::ThreadConfig threadConfig;
+    threadConfig.thread_name_ref() = "openr-spark";
+    threadConfig.cpu_affinity_ref() = {0, 1};
+    threadConfig.nice_ref() = -10;
+    tConfig.thread_configs_ref()->emplace("spark", threadConfig);
+
+    auto config = Config(tConfig);
+
+    EXPECT_EQ(threadConfig, config.getThreadConfig("spark"));
+    EXPECT_EQ(std::nullopt, config.getThreadConfig("decision"));
+  }
 }
 
 TEST(ConfigTest, KvstoreGetter) {
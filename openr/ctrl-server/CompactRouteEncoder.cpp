@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/ctrl-server/CompactRouteEncoder.h>
+
+#include <algorithm>
+
+#include <fmt/format.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+#include <openr/common/NetworkUtil.h>
+
+namespace openr {
+
+namespace {
+
+thrift::UnicastRouteCompact
+createUnicastRouteCompact(
+    std::string prefix,
+    int64_t nextHopGroupId,
+    std::optional<thrift::AdminDistance> adminDistance) {
+  thrift::UnicastRouteCompact route;
+  route.prefix_ref() = std::move(prefix);
+  route.nextHopGroupId_ref() = nextHopGroupId;
+  route.adminDistance_ref().from_optional(adminDistance);
+  return route;
+}
+
+thrift::MplsRouteCompact
+createMplsRouteCompact(
+    int32_t topLabel,
+    int64_t nextHopGroupId,
+    std::optional<thrift::AdminDistance> adminDistance) {
+  thrift::MplsRouteCompact route;
+  route.topLabel_ref() = topLabel;
+  route.nextHopGroupId_ref() = nextHopGroupId;
+  route.adminDistance_ref().from_optional(adminDistance);
+  return route;
+}
+
+} // namespace
+
+std::string
+CompactRouteEncoder::encodeNetwork(folly::CIDRNetwork const& network) {
+  std::string packed(
+      reinterpret_cast<const char*>(network.first.bytes()),
+      network.first.byteCount());
+  packed.push_back(static_cast<char>(network.second));
+  return packed;
+}
+
+std::string
+CompactRouteEncoder::encodePrefix(thrift::IpPrefix const& prefix) {
+  return encodeNetwork(toIPNetwork(prefix));
+}
+
+thrift::IpPrefix
+CompactRouteEncoder::decodePrefix(std::string const& prefix) {
+  if (prefix.size() != 5 and prefix.size() != 17) {
+    throw thrift::OpenrError(fmt::format(
+        "Invalid compact prefix {}", folly::hexlify(prefix)));
+  }
+  thrift::IpPrefix ipPrefix;
+  ipPrefix.prefixAddress_ref()->addr_ref() =
+      prefix.substr(0, prefix.size() - 1);
+  ipPrefix.prefixLength_ref() = static_cast<uint8_t>(prefix.back());
+  return ipPrefix;
+}
+
+int64_t
+CompactRouteEncoder::addNextHopGroupRef(
+    std::vector<thrift::NextHopThrift> const& nextHops,
+    thrift::RouteDatabaseDeltaCompact& delta) {
+  // next-hops are a set, key them in canonical order
+  std::vector<std::pair<std::string, size_t>> serialized;
+  serialized.reserve(nextHops.size());
+  for (size_t i = 0; i < nextHops.size(); ++i) {
+    serialized.emplace_back(
+        serializer_.serialize<std::string>(nextHops.at(i)), i);
+  }
+  std::sort(serialized.begin(), serialized.end());
+  std::string key;
+  for (auto const& [nextHop, _] : serialized) {
+    key.append(fmt::format("{}:", nextHop.size())).append(nextHop);
+  }
+
+  auto [it, inserted] = nextHopGroupIds_.try_emplace(key, 0);
+  if (not inserted) {
+    ++nextHopGroups_.at(it->second).refCount;
+    return it->second;
+  }
+
+  const auto id = nextNextHopGroupId_++;
+  it->second = id;
+  auto& group = nextHopGroups_[id];
+  group.key = std::move(key);
+  for (auto const& [_, index] : serialized) {
+    group.nextHops.emplace_back(nextHops.at(index));
+  }
+  group.refCount = 1;
+  delta.nextHopGroupsToAdd_ref()->emplace(id, group.nextHops);
+  return id;
+}
+
+void
+CompactRouteEncoder::releaseNextHopGroupRef(
+    int64_t id, thrift::RouteDatabaseDeltaCompact& delta) {
+  auto it = nextHopGroups_.find(id);
+  CHECK(it != nextHopGroups_.end()) << "Unknown next-hop group " << id;
+  if (--it->second.refCount > 0) {
+    return;
+  }
+  nextHopGroupIds_.erase(it->second.key);
+  nextHopGroups_.erase(it);
+  delta.nextHopGroupsToDelete_ref()->emplace_back(id);
+}
+
+thrift::RouteDatabaseDeltaCompact
+CompactRouteEncoder::encode(thrift::RouteDatabaseDelta const& delta) {
+  thrift::RouteDatabaseDeltaCompact compact;
+  // released after all updates, so that groups moving between routes are
+  // not deleted and created again
+  std::vector<int64_t> released;
+
+  for (auto const& route : *delta.unicastRoutesToUpdate_ref()) {
+    const auto id = addNextHopGroupRef(*route.nextHops_ref(), compact);
+    const auto network = toIPNetwork(*route.dest_ref());
+    auto adminDistance = route.adminDistance_ref().to_optional();
+    auto [it, inserted] =
+        unicastRoutes_.try_emplace(network, RouteEntry{id, adminDistance});
+    if (not inserted) {
+      released.emplace_back(it->second.nextHopGroupId);
+      it->second = RouteEntry{id, adminDistance};
+    }
+    compact.unicastRoutesToUpdate_ref()->emplace_back(
+        createUnicastRouteCompact(encodeNetwork(network), id, adminDistance));
+  }
+  for (auto const& prefix : *delta.unicastRoutesToDelete_ref()) {
+    const auto network = toIPNetwork(prefix);
+    auto it = unicastRoutes_.find(network);
+    if (it != unicastRoutes_.end()) {
+      released.emplace_back(it->second.nextHopGroupId);
+      unicastRoutes_.erase(it);
+    }
+    compact.unicastRoutesToDelete_ref()->emplace_back(encodeNetwork(network));
+  }
+
+  for (auto const& route : *delta.mplsRoutesToUpdate_ref()) {
+    const auto id = addNextHopGroupRef(*route.nextHops_ref(), compact);
+    auto adminDistance = route.adminDistance_ref().to_optional();
+    auto [it, inserted] = mplsRoutes_.try_emplace(
+        *route.topLabel_ref(), RouteEntry{id, adminDistance});
+    if (not inserted) {
+      released.emplace_back(it->second.nextHopGroupId);
+      it->second = RouteEntry{id, adminDistance};
+    }
+    compact.mplsRoutesToUpdate_ref()->emplace_back(
+        createMplsRouteCompact(*route.topLabel_ref(), id, adminDistance));
+  }
+  for (auto label : *delta.mplsRoutesToDelete_ref()) {
+    auto it = mplsRoutes_.find(label);
+    if (it != mplsRoutes_.end()) {
+      released.emplace_back(it->second.nextHopGroupId);
+      mplsRoutes_.erase(it);
+    }
+    compact.mplsRoutesToDelete_ref()->emplace_back(label);
+  }
+
+  for (auto id : released) {
+    releaseNextHopGroupRef(id, compact);
+  }
+  return compact;
+}
+
+thrift::RouteDatabaseDeltaCompact
+CompactRouteEncoder::getFullDump() const {
+  thrift::RouteDatabaseDeltaCompact dump;
+  for (auto const& [id, group] : nextHopGroups_) {
+    dump.nextHopGroupsToAdd_ref()->emplace(id, group.nextHops);
+  }
+  for (auto const& [network, entry] : unicastRoutes_) {
+    dump.unicastRoutesToUpdate_ref()->emplace_back(createUnicastRouteCompact(
+        encodeNetwork(network), entry.nextHopGroupId, entry.adminDistance));
+  }
+  for (auto const& [label, entry] : mplsRoutes_) {
+    dump.mplsRoutesToUpdate_ref()->emplace_back(createMplsRouteCompact(
+        label, entry.nextHopGroupId, entry.adminDistance));
+  }
+  return dump;
+}
+
+void
+CompactRouteDeltaCoalescer::add(thrift::RouteDatabaseDeltaCompact&& delta) {
+  for (auto& [id, nextHops] : *delta.nextHopGroupsToAdd_ref()) {
+    nextHopGroupsToAdd_.insert_or_assign(id, std::move(nextHops));
+  }
+  for (auto& route : *delta.unicastRoutesToUpdate_ref()) {
+    auto prefix = *route.prefix_ref();
+    unicastRoutesToDelete_.erase(prefix);
+    unicastRoutesToUpdate_.insert_or_assign(
+        std::move(prefix), std::move(route));
+  }
+  for (auto& prefix : *delta.unicastRoutesToDelete_ref()) {
+    unicastRoutesToUpdate_.erase(prefix);
+    unicastRoutesToDelete_.emplace(std::move(prefix));
+  }
+  for (auto& route : *delta.mplsRoutesToUpdate_ref()) {
+    auto label = *route.topLabel_ref();
+    mplsRoutesToDelete_.erase(label);
+    mplsRoutesToUpdate_.insert_or_assign(label, std::move(route));
+  }
+  for (auto label : *delta.mplsRoutesToDelete_ref()) {
+    mplsRoutesToUpdate_.erase(label);
+    mplsRoutesToDelete_.emplace(label);
+  }
+  for (auto id : *delta.nextHopGroupsToDelete_ref()) {
+    // created while coalescing, never sent
+    if (nextHopGroupsToAdd_.erase(id) == 0) {
+      nextHopGroupsToDelete_.emplace(id);
+    }
+  }
+}
+
+size_t
+CompactRouteDeltaCoalescer::size() const {
+  return nextHopGroupsToAdd_.size() + unicastRoutesToUpdate_.size() +
+      unicastRoutesToDelete_.size() + mplsRoutesToUpdate_.size() +
+      mplsRoutesToDelete_.size() + nextHopGroupsToDelete_.size();
+}
+
+std::vector<thrift::RouteDatabaseDeltaCompact>
+CompactRouteDeltaCoalescer::release() {
+  if (size() == 0) {
+    return {};
+  }
+  thrift::RouteDatabaseDeltaCompact delta;
+  for (auto& [id, nextHops] : nextHopGroupsToAdd_) {
+    delta.nextHopGroupsToAdd_ref()->emplace(id, std::move(nextHops));
+  }
+  for (auto& [_, route] : unicastRoutesToUpdate_) {
+    delta.unicastRoutesToUpdate_ref()->emplace_back(std::move(route));
+  }
+  delta.unicastRoutesToDelete_ref()->assign(
+      unicastRoutesToDelete_.begin(), unicastRoutesToDelete_.end());
+  for (auto& [_, route] : mplsRoutesToUpdate_) {
+    delta.mplsRoutesToUpdate_ref()->emplace_back(std::move(route));
+  }
+  delta.mplsRoutesToDelete_ref()->assign(
+      mplsRoutesToDelete_.begin(), mplsRoutesToDelete_.end());
+  delta.nextHopGroupsToDelete_ref()->assign(
+      nextHopGroupsToDelete_.begin(), nextHopGroupsToDelete_.end());
+
+  nextHopGroupsToAdd_.clear();
+  unicastRoutesToUpdate_.clear();
+  unicastRoutesToDelete_.clear();
+  mplsRoutesToUpdate_.clear();
+  mplsRoutesToDelete_.clear();
+  nextHopGroupsToDelete_.clear();
+
+  std::vector<thrift::RouteDatabaseDeltaCompact> deltas;
+  deltas.emplace_back(std::move(delta));
+  return deltas;
+}
+
+} // namespace openr
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/IPAddress.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/if/gen-cpp2/Network_types.h>
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+/**
+ * Encoder of Fib route deltas into thrift::RouteDatabaseDeltaCompact.
+ *
+ * Mirrors the routes it encodes, along with the dictionary of next-hop
+ * groups they reference. A group is created for every distinct set of
+ * next-hops, announced in the delta creating it, and deleted in the delta
+ * releasing its last route. Group ids are never reused.
+ *
+ * Deltas must be encoded in order. Replaying deltas already reflected in the
+ * mirrored routes is harmless, as updates and deletes are absolute.
+ *
+ * NOTE: Not thread safe
+ */
+class CompactRouteEncoder {
+ public:
+  // compact delta of `delta`, which is applied to mirrored routes
+  thrift::RouteDatabaseDeltaCompact encode(
+      thrift::RouteDatabaseDelta const& delta);
+
+  // all mirrored routes along with the groups they reference
+  thrift::RouteDatabaseDeltaCompact getFullDump() const;
+
+  size_t
+  getNumRoutes() const {
+    return unicastRoutes_.size() + mplsRoutes_.size();
+  }
+
+  size_t
+  getNumNextHopGroups() const {
+    return nextHopGroups_.size();
+  }
+
+  // see thrift::UnicastRouteCompact
+  static std::string encodeNetwork(folly::CIDRNetwork const& network);
+  static std::string encodePrefix(thrift::IpPrefix const& prefix);
+
+  // throws thrift::OpenrError on malformed prefix
+  static thrift::IpPrefix decodePrefix(std::string const& prefix);
+
+ private:
+  struct NextHopGroup {
+    std::string key;
+    std::vector<thrift::NextHopThrift> nextHops;
+    size_t refCount{0};
+  };
+
+  struct RouteEntry {
+    int64_t nextHopGroupId{0};
+    std::optional<thrift::AdminDistance> adminDistance;
+  };
+
+  // id of the group of next-hops, created and announced in delta if new
+  int64_t addNextHopGroupRef(
+      std::vector<thrift::NextHopThrift> const& nextHops,
+      thrift::RouteDatabaseDeltaCompact& delta);
+
+  // delete the group and announce it in delta if not referenced anymore
+  void releaseNextHopGroupRef(
+      int64_t id, thrift::RouteDatabaseDeltaCompact& delta);
+
+  apache::thrift::CompactSerializer serializer_;
+
+  int64_t nextNextHopGroupId_{1};
+  std::unordered_map<int64_t, NextHopGroup> nextHopGroups_;
+  // canonical (sorted serialized) next-hops to group id
+  std::unordered_map<std::string, int64_t> nextHopGroupIds_;
+
+  std::unordered_map<folly::CIDRNetwork, RouteEntry> unicastRoutes_;
+  std::unordered_map<int32_t, RouteEntry> mplsRoutes_;
+};
+
+/**
+ * Coalescer of compact route deltas for BufferedStreamPublisher. Keeps the
+ * latest update or delete per prefix and label, and the union of group
+ * changes. Groups both created and deleted while coalescing are dropped as
+ * no route references them anymore.
+ */
+class CompactRouteDeltaCoalescer {
+ public:
+  void add(thrift::RouteDatabaseDeltaCompact&& delta);
+
+  size_t size() const;
+
+  std::vector<thrift::RouteDatabaseDeltaCompact> release();
+
+ private:
+  std::map<int64_t, std::vector<thrift::NextHopThrift>> nextHopGroupsToAdd_;
+  std::unordered_map<std::string, thrift::UnicastRouteCompact>
+      unicastRoutesToUpdate_;
+  std::unordered_set<std::string> unicastRoutesToDelete_;
+  std::unordered_map<int32_t, thrift::MplsRouteCompact> mplsRoutesToUpdate_;
+  std::unordered_set<int32_t> mplsRoutesToDelete_;
+  std::unordered_set<int64_t> nextHopGroupsToDelete_;
+};
+
+} // namespace openr
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/ctrl-server/CounterIndex.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <fb303/ServiceData.h>
+#include <fmt/format.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+CounterIndex::CounterIndex(
+    std::chrono::milliseconds refreshInterval, size_t maxRegexes)
+    : refreshInterval_(refreshInterval), maxRegexes_(maxRegexes) {}
+
+std::string
+CounterIndex::getLiteralPrefix(std::string const& regex) {
+  if (regex.empty() or regex.front() != '^' or
+      regex.find('|') != std::string::npos) {
+    // not anchored, or alternatives may not be
+    return "";
+  }
+
+  std::string prefix;
+  for (size_t i = 1; i < regex.size(); ++i) {
+    char c = regex.at(i);
+    if (c == '\\') {
+      // escaped punctuation is literal, anything else is a character class
+      if (i + 1 == regex.size() or not std::ispunct(regex.at(i + 1))) {
+        break;
+      }
+      c = regex.at(++i);
+    } else if (std::strchr(".[]()*+?{}^$", c)) {
+      break;
+    }
+    // literal is optional if followed by a quantifier allowing zero
+    if (i + 1 < regex.size() and std::strchr("*?{", regex.at(i + 1))) {
+      break;
+    }
+    prefix.push_back(c);
+  }
+  return prefix;
+}
+
+void
+CounterIndex::invalidate() {
+  state_.wlock()->refreshTime.reset();
+}
+
+void
+CounterIndex::maybeRefreshNames(State& state) const {
+  const auto now = std::chrono::steady_clock::now();
+  if (state.refreshTime.has_value() and
+      now - *state.refreshTime < refreshInterval_) {
+    return;
+  }
+  state.refreshTime = now;
+
+  std::vector<std::string> names;
+  for (auto& [name, _] : fb303::fbData->getCounters()) {
+    names.emplace_back(name);
+  }
+  // std::map keys are sorted
+  if (names == state.names) {
+    return;
+  }
+  state.names = std::move(names);
+  ++state.namesVersion;
+
+  // forget removed counters
+  auto const& allNames = state.names;
+  for (auto it = state.lastValues.begin(); it != state.lastValues.end();) {
+    if (std::binary_search(allNames.begin(), allNames.end(), it->first)) {
+      ++it;
+    } else {
+      it = state.lastValues.erase(it);
+    }
+  }
+}
+
+std::optional<std::vector<std::string>>
+CounterIndex::getMatchingNames(State& state, std::string const& regex) const {
+  maybeRefreshNames(state);
+
+  auto it = state.regexes.find(regex);
+  if (it == state.regexes.end()) {
+    CompiledRegex compiled;
+    compiled.regex = std::make_unique<RE2>(regex, RE2::Quiet);
+    if (not compiled.regex->ok()) {
+      return std::nullopt;
+    }
+    compiled.literalPrefix = getLiteralPrefix(regex);
+    // patterns come from clients, bound the cache
+    if (state.regexes.size() >= maxRegexes_) {
+      state.regexes.clear();
+    }
+    it = state.regexes.emplace(regex, std::move(compiled)).first;
+  }
+
+  auto& compiled = it->second;
+  if (compiled.namesVersion != state.namesVersion) {
+    compiled.names.clear();
+    auto const& prefix = compiled.literalPrefix;
+    for (auto nameIt = std::lower_bound(
+             state.names.begin(), state.names.end(), prefix);
+         nameIt != state.names.end() and
+         nameIt->compare(0, prefix.size(), prefix) == 0;
+         ++nameIt) {
+      if (RE2::PartialMatch(*nameIt, *compiled.regex)) {
+        compiled.names.emplace_back(*nameIt);
+      }
+    }
+    compiled.namesVersion = state.namesVersion;
+  }
+  return compiled.names;
+}
+
+std::map<std::string, int64_t>
+CounterIndex::getRegexCounters(std::string const& regex) {
+  auto names = getMatchingNames(*state_.wlock(), regex);
+
+  std::map<std::string, int64_t> counters;
+  if (names.has_value() and not names->empty()) {
+    fb303::fbData->getSelectedCounters(counters, *names);
+  }
+  return counters;
+}
+
+thrift::CountersDelta
+CounterIndex::getRegexCountersDelta(
+    std::string const& regex, thrift::CountersDeltaToken const& token) {
+  // values are read under the lock, hence versions of concurrent queries are
+  // ordered like the values they saw
+  auto state = state_.wlock();
+  auto names = getMatchingNames(*state, regex);
+  if (not names.has_value()) {
+    throw thrift::OpenrError(fmt::format("Invalid regex {}", regex));
+  }
+
+  std::map<std::string, int64_t> counters;
+  if (not names->empty()) {
+    fb303::fbData->getSelectedCounters(counters, *names);
+  }
+
+  const auto version = ++state->version;
+  const bool isFullDump = *token.epoch_ref() != epoch_ or
+      *token.version_ref() <= 0 or *token.version_ref() >= version;
+
+  thrift::CountersDelta delta;
+  for (auto& [name, value] : counters) {
+    auto [it, inserted] = state->lastValues.try_emplace(name);
+    if (inserted or it->second.value != value) {
+      it->second.value = value;
+      it->second.version = version;
+    }
+    if (isFullDump or it->second.version > *token.version_ref()) {
+      delta.counters_ref()->emplace(name, value);
+    }
+  }
+  delta.token_ref()->epoch_ref() = epoch_;
+  delta.token_ref()->version_ref() = version;
+  delta.isFullDump_ref() = isFullDump;
+  return delta;
+}
+
+} // namespace openr
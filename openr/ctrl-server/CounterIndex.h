@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Synchronized.h>
+#include <re2/re2.h>
+
+#include <openr/common/Util.h>
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+/**
+ * Index of fb303 counter names serving regex counter queries without
+ * fetching and matching the whole counter map on every call.
+ *
+ * - Counter names are kept sorted and refreshed from fb303 at most once per
+ *   `refreshInterval`, hence new counters may show up that late.
+ * - Regexes anchored with `^` are only matched against names starting with
+ *   their literal prefix, e.g. `kvstore.peers` of `^kvstore\.peers\..*`.
+ * - Compiled regexes are cached by pattern along with the names they match,
+ *   which are recomputed only when the index is refreshed.
+ * - Values of the matching names only are fetched from fb303.
+ *
+ * For delta queries, the last value seen of every counter is kept with the
+ * version at which it was seen changing. All methods are thread safe.
+ */
+class CounterIndex {
+ public:
+  explicit CounterIndex(
+      std::chrono::milliseconds refreshInterval = std::chrono::seconds(10),
+      size_t maxRegexes = 256);
+
+  // counters whose name partially matches regex, empty if regex is invalid
+  std::map<std::string, int64_t> getRegexCounters(std::string const& regex);
+
+  // see OpenrCtrl.getRegexCountersDelta()
+  // throws thrift::OpenrError if regex is invalid
+  thrift::CountersDelta getRegexCountersDelta(
+      std::string const& regex, thrift::CountersDeltaToken const& token);
+
+  // refresh counter names on the next query
+  void invalidate();
+
+  // literal prefix of all names partially matching regex, empty if regex is
+  // not anchored at the beginning
+  static std::string getLiteralPrefix(std::string const& regex);
+
+ private:
+  struct CompiledRegex {
+    std::unique_ptr<RE2> regex;
+    std::string literalPrefix;
+    // matching names at namesVersion
+    int64_t namesVersion{-1};
+    std::vector<std::string> names;
+  };
+
+  struct LastValue {
+    int64_t value{0};
+    int64_t version{0};
+  };
+
+  struct State {
+    // sorted names of all counters
+    std::vector<std::string> names;
+    int64_t namesVersion{0};
+    std::optional<std::chrono::steady_clock::time_point> refreshTime;
+
+    std::unordered_map<std::string /* pattern */, CompiledRegex> regexes;
+
+    // delta queries
+    std::unordered_map<std::string, LastValue> lastValues;
+    int64_t version{0};
+  };
+
+  // names of counters matching regex, std::nullopt if regex is invalid
+  std::optional<std::vector<std::string>> getMatchingNames(
+      State& state, std::string const& regex) const;
+
+  void maybeRefreshNames(State& state) const;
+
+  const std::chrono::milliseconds refreshInterval_;
+  const size_t maxRegexes_;
+
+  // identifies this instance in tokens, versions restart with it
+  const int64_t epoch_{getUnixTimeStampMs()};
+
+  folly::Synchronized<State> state_;
+};
+
+} // namespace openr
@@ -18,7 +18,6 @@ namespace fs = std::experimental::filesystem;
 #include <folly/ExceptionString.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/ssl/OpenSSLUtils.h>
-#include <re2/re2.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 #include <openr/common/Constants.h>
@@ -30,6 +29,7 @@ namespace fs = std::experimental::filesystem;
 #include <openr/link-monitor/LinkMonitor.h>
 #include <openr/monitor/LogSample.h>
 #include <openr/prefix-manager/PrefixManager.h>
+#include <openr/watchdog/Profiler.h>
 
 namespace fb303 = facebook::fb303;
 
@@ -51,6 +51,7 @@ OpenrCtrlHandler::OpenrCtrlHandler(
     : fb303::BaseService("openr"),
       nodeName_(nodeName),
       acceptablePeerCommonNames_(acceptablePeerCommonNames),
+      ctrlEvb_(ctrlEvb),
       decision_(decision),
       fib_(fib),
       kvStore_(kvStore),
@@ -59,7 +60,7 @@ OpenrCtrlHandler::OpenrCtrlHandler(
       configStore_(configStore),
       prefixManager_(prefixManager),
       spark_(spark),
-      config_(config) {
+      config_(std::move(config)) {
   // Add fiber task to receive publication from KvStore
   if (kvStore_) {
     auto taskFutureKvStore = ctrlEvb->addFiberTaskFuture(
@@ -75,9 +76,7 @@ OpenrCtrlHandler::OpenrCtrlHandler(
             }
 
             kvStorePublishers_.withWLock([&](auto& kvStorePublishers_) {
-              for (auto& [_, publisher] : kvStorePublishers_) {
-                publisher->publish(maybePublication.value());
-              }
+              kvStorePublishers_.publish(maybePublication.value());
             });
 
             bool isAdjChanged = false;
@@ -133,6 +132,18 @@ OpenrCtrlHandler::OpenrCtrlHandler(
                 }
               });
             }
+
+            // expired "adj:*" keys change adjacencies as well
+            auto const& expiredKeys =
+                *maybePublication.value().expiredKeys_ref();
+            for (auto const& key : expiredKeys) {
+              if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+                isAdjChanged = true;
+                break;
+              }
+            }
+            processAdjWatches(
+                *maybePublication.value().area_ref(), isAdjChanged);
           }
           LOG(INFO) << "KvStore updates processing fiber stopped";
         });
@@ -174,6 +185,24 @@ OpenrCtrlHandler::OpenrCtrlHandler(
                 }
               }
             });
+
+            // Encode the update for compact streams, or keep it for replay
+            // while the encoder is being seeded
+            fibCompactState_.withWLock([&maybeUpdate](auto& state) {
+              if (state.encoder.has_value()) {
+                const auto fibUpdateCompact =
+                    state.encoder->encode(maybeUpdate.value().toThrift());
+                for (auto& [_, publisher] : state.publishers) {
+                  publisher.next(fibUpdateCompact);
+                }
+                fb303::fbData->setCounter(
+                    "ctrl.fib_compact.num_next_hop_groups",
+                    state.encoder->getNumNextHopGroups());
+              } else if (state.seeding) {
+                state.pendingUpdates.emplace_back(
+                    maybeUpdate.value().toThrift());
+              }
+            });
           }
           LOG(INFO) << "Fib updates processing fiber stopped";
         });
@@ -188,6 +217,7 @@ OpenrCtrlHandler::~OpenrCtrlHandler() {
 
   LOG(INFO) << "Cleanup all pending request(s).";
   longPollReqs_.withWLock([&](auto& longPollReqs) { longPollReqs.clear(); });
+  adjWatchState_.withWLock([](auto& state) { state.watches.clear(); });
 
   LOG(INFO)
       << "Waiting for termination of kvStoreUpdatesQueue, FibUpdatesQueue";
@@ -205,9 +235,7 @@ void
 OpenrCtrlHandler::closeKvStorePublishers() {
   std::vector<std::unique_ptr<KvStorePublisher>> publishers;
   kvStorePublishers_.withWLock([&](auto& kvStorePublishers_) {
-    for (auto& [_, publisher] : kvStorePublishers_) {
-      publishers.emplace_back(std::move(publisher));
-    }
+    publishers = kvStorePublishers_.releaseAll();
   });
   LOG(INFO) << "Terminating " << publishers.size()
             << " active KvStore snoop stream(s).";
@@ -222,17 +250,46 @@ OpenrCtrlHandler::closeKvStorePublishers() {
 // Refer to note on top of closeKvStorePublishers
 void
 OpenrCtrlHandler::closeFibPublishers() {
-  std::vector<apache::thrift::ServerStreamPublisher<thrift::RouteDatabaseDelta>>
-      fibPublishers_close;
+  std::vector<FibStreamPublisher> fibPublishers_close;
   fibPublishers_.withWLock([&fibPublishers_close](auto& fibPublishers) {
     for (auto& [_, fibPublisher] : fibPublishers) {
       fibPublishers_close.emplace_back(std::move(fibPublisher));
     }
   });
+  std::vector<FibDetailStreamPublisher> fibDetailPublishers_close;
+  fibDetailPublishers_.withWLock(
+      [&fibDetailPublishers_close](auto& fibDetailPublishers) {
+        for (auto& [_, fibDetailPublisher] : fibDetailPublishers) {
+          fibDetailPublishers_close.emplace_back(std::move(fibDetailPublisher));
+        }
+      });
   LOG(INFO) << "Terminating " << fibPublishers_close.size()
-            << " active Fib snoop stream(s).";
+            << " active Fib snoop stream(s) and "
+            << fibDetailPublishers_close.size()
+            << " active Fib detail snoop stream(s).";
   for (auto& fibPublisher : fibPublishers_close) {
-    std::move(fibPublisher).complete();
+    fibPublisher.complete();
+  }
+  for (auto& fibDetailPublisher : fibDetailPublishers_close) {
+    fibDetailPublisher.complete();
+  }
+
+  std::vector<FibCompactStreamPublisher> fibCompactPublishers_close;
+  std::vector<PendingFibCompactSubscriber> pendingSubscribers;
+  fibCompactState_.withWLock([&](auto& state) {
+    for (auto& [_, publisher] : state.publishers) {
+      fibCompactPublishers_close.emplace_back(std::move(publisher));
+    }
+    pendingSubscribers = std::exchange(state.pendingSubscribers, {});
+  });
+  LOG(INFO) << "Terminating " << fibCompactPublishers_close.size()
+            << " active Fib compact snoop stream(s).";
+  for (auto& fibCompactPublisher : fibCompactPublishers_close) {
+    fibCompactPublisher.complete();
+  }
+  for (auto& subscriber : pendingSubscribers) {
+    subscriber.promise.setException(
+        thrift::OpenrError("publisher terminated"));
   }
 }
 
@@ -284,6 +341,34 @@ OpenrCtrlHandler::getEventLogs(std::vector<::std::string>& _return) {
   }
 }
 
+void
+OpenrCtrlHandler::startProfiler(int32_t durationS, int32_t frequencyHz) {
+  auto config = getConfigSnapshot();
+  if (not config->isWatchdogEnabled() or
+      not *config->getWatchdogConfig().enable_profiler_ref()) {
+    throw thrift::OpenrError("Profiler is not enabled");
+  }
+  if (durationS <= 0 or frequencyHz <= 0) {
+    throw thrift::OpenrError("Profiler duration and frequency should be > 0");
+  }
+  try {
+    Profiler::get().start(
+        std::chrono::seconds(durationS), static_cast<uint32_t>(frequencyHz));
+  } catch (std::exception const& e) {
+    throw thrift::OpenrError(folly::exceptionStr(e).toStdString());
+  }
+}
+
+void
+OpenrCtrlHandler::getProfilerFoldedStacks(std::string& _return) {
+  auto config = getConfigSnapshot();
+  if (not config->isWatchdogEnabled() or
+      not *config->getWatchdogConfig().enable_profiler_ref()) {
+    throw thrift::OpenrError("Profiler is not enabled");
+  }
+  _return = Profiler::get().getFoldedStacks();
+}
+
 void
 OpenrCtrlHandler::getCounters(std::map<std::string, int64_t>& _return) {
   BaseService::getCounters(_return);
@@ -293,39 +378,23 @@ void
 OpenrCtrlHandler::getRegexCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::string> regex) {
-  // Compile regex
-  re2::RE2 compiledRegex(*regex);
-  if (not compiledRegex.ok()) {
-    return;
-  }
-
-  // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
+  _return = counterIndex_.getRegexCounters(*regex);
+}
 
-  // Filter counters
-  for (auto const& kv : counters) {
-    if (RE2::PartialMatch(kv.first, compiledRegex)) {
-      _return.emplace(kv);
-    }
-  }
+void
+OpenrCtrlHandler::getRegexCountersDelta(
+    thrift::CountersDelta& _return,
+    std::unique_ptr<std::string> regex,
+    std::unique_ptr<thrift::CountersDeltaToken> token) {
+  _return = counterIndex_.getRegexCountersDelta(*regex, *token);
 }
 
 void
 OpenrCtrlHandler::getSelectedCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::vector<std::string>> keys) {
-  // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
-
-  // Filter counters
-  for (auto const& key : *keys) {
-    auto it = counters.find(key);
-    if (it != counters.end()) {
-      _return.emplace(*it);
-    }
-  }
+  // Lookup of the selected counters only
+  fb303::fbData->getSelectedCounters(_return, *keys);
 }
 
 int64_t
@@ -350,6 +419,25 @@ OpenrCtrlHandler::getBuildInfo(thrift::BuildInfo& _buildInfo) {
   _buildInfo = getBuildInfoThrift();
 }
 
+void
+OpenrCtrlHandler::getEventBaseProfiles(
+    std::vector<thrift::EventBaseProfile>& _profiles) {
+  const std::vector<OpenrEventBase*> evbs{
+      decision_,
+      fib_,
+      kvStore_,
+      linkMonitor_,
+      monitor_,
+      configStore_,
+      prefixManager_,
+      spark_};
+  for (auto evb : evbs) {
+    if (evb) {
+      _profiles.emplace_back(evb->getProfile());
+    }
+  }
+}
+
 // validate config
 void
 OpenrCtrlHandler::dryrunConfig(
@@ -358,17 +446,60 @@ OpenrCtrlHandler::dryrunConfig(
     throw thrift::OpenrError("Dereference nullptr for config file");
   }
 
+  auto config = loadConfig(*file);
+  LOG(INFO) << "Config diff of " << *file << ": "
+            << getConfigSnapshot()->getDiff(*config).toString();
+  _return = config->getRunningConfig();
+}
+
+// apply config without restart
+void
+OpenrCtrlHandler::reloadConfig(
+    std::string& _return, std::unique_ptr<std::string> file) {
+  if (not file) {
+    throw thrift::OpenrError("Dereference nullptr for config file");
+  }
+  auto config = loadConfig(*file);
+
+  // reloads are serialized by holding the lock till changes are applied
+  auto lockedConfig = config_.wlock();
+  const auto diff = (*lockedConfig)->getDiff(*config);
+  LOG(INFO) << "Reloading config " << *file << ": " << diff.toString();
+  if (diff.requiresRestart) {
+    throw thrift::OpenrError(fmt::format(
+        "Config {} has changes only applied upon restart: {}",
+        *file,
+        diff.toString()));
+  }
+
+  // apply changed parts only, modules keep their state
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
+  if (linkMonitor_ and not diff.changedAreas.empty()) {
+    futures.emplace_back(linkMonitor_->updateConfig(config));
+  }
+  if (spark_ and
+      (diff.sparkHelloTimeChanged or not diff.changedAreas.empty())) {
+    futures.emplace_back(spark_->updateConfig(config));
+  }
+  if (prefixManager_ and diff.originatedPrefixesChanged) {
+    futures.emplace_back(prefixManager_->updateConfig(config));
+  }
+  folly::collectAll(std::move(futures)).get();
+
+  *lockedConfig = config;
+  _return = config->getRunningConfig();
+}
+
+std::shared_ptr<const Config>
+OpenrCtrlHandler::loadConfig(const std::string& fileName) {
   // check if the config file exists and readable
-  const auto& fileName = *file;
   if (not fs::exists(fileName)) {
     throw thrift::OpenrError(
         fmt::format("Config file doesn't exist: {}", fileName));
   }
 
   try {
-    // Create policy manager using new config file
-    auto config = Config(fileName);
-    _return = config.getRunningConfig();
+    return std::make_shared<const Config>(fileName);
   } catch (const std::exception& ex) {
     throw thrift::OpenrError(ex.what());
   }
@@ -376,19 +507,20 @@ OpenrCtrlHandler::dryrunConfig(
 
 void
 OpenrCtrlHandler::getRunningConfig(std::string& _return) {
-  _return = config_->getRunningConfig();
+  _return = getConfigSnapshot()->getRunningConfig();
 }
 
 void
 OpenrCtrlHandler::getRunningConfigThrift(thrift::OpenrConfig& _config) {
-  _config = config_->getConfig();
+  _config = getConfigSnapshot()->getConfig();
 }
 
 std::unique_ptr<std::string>
 OpenrCtrlHandler::getSingleAreaOrThrow(std::string const& caller) {
   fb303::fbData->addStatValue(
       fmt::format("ctrl.get_single_area.{}", caller), 1, fb303::COUNT);
-  auto const& areas = config_->getAreas();
+  auto config = getConfigSnapshot();
+  auto const& areas = config->getAreas();
   if (1 != areas.size()) {
     throw thrift::OpenrError(
         "Iterface requires node to be confgiured with exactly one area");
@@ -432,6 +564,17 @@ OpenrCtrlHandler::semifuture_syncPrefixesByType(
       .defer([](folly::Try<bool>&&) { return folly::Unit(); });
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::PrefixChangeBatchResult>>
+OpenrCtrlHandler::semifuture_applyPrefixChanges(
+    std::unique_ptr<thrift::PrefixChangeBatch> batch) {
+  CHECK(prefixManager_);
+  return prefixManager_->applyPrefixChanges(std::move(*batch))
+      .deferValue([](thrift::PrefixChangeBatchResult&& result) {
+        return std::make_unique<thrift::PrefixChangeBatchResult>(
+            std::move(result));
+      });
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
 OpenrCtrlHandler::semifuture_getPrefixes() {
   CHECK(prefixManager_);
@@ -489,13 +632,43 @@ OpenrCtrlHandler::semifuture_getAreaAdvertisedRoutesFiltered(
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDb() {
   CHECK(fib_);
-  return fib_->getRouteDb();
+  return routeDbCache_.get("", fib_->getRouteStateVersion(), [this]() {
+    return fib_->getRouteDb();
+  });
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetail>>
 OpenrCtrlHandler::semifuture_getRouteDetailDb() {
   CHECK(fib_);
-  return fib_->getRouteDetailDb();
+  if (not decision_ or not fib_->isRouteStateCompact()) {
+    return fib_->getRouteDetailDb();
+  }
+  return fib_->getRouteDetailDb().deferValue(
+      [this](std::unique_ptr<thrift::RouteDatabaseDetail>&& routeDetailDb) {
+        decision_->fillBestRoutes(*routeDetailDb->unicastRoutes_ref());
+        return std::move(routeDetailDb);
+      });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetailPage>>
+OpenrCtrlHandler::semifuture_getRouteDetailDbPage(
+    std::unique_ptr<thrift::PageParams> page) {
+  CHECK(fib_);
+  return getRouteDetailDbPage(std::move(*page));
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetailPage>>
+OpenrCtrlHandler::getRouteDetailDbPage(thrift::PageParams page) {
+  if (not decision_ or not fib_->isRouteStateCompact()) {
+    return fib_->getRouteDetailDbPage(std::move(page));
+  }
+  return fib_->getRouteDetailDbPage(std::move(page))
+      .deferValue(
+          [this](std::unique_ptr<thrift::RouteDatabaseDetailPage>&& page) {
+            decision_->fillBestRoutes(
+                *page->routeDb_ref()->unicastRoutes_ref());
+            return std::move(page);
+          });
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
@@ -566,6 +739,15 @@ OpenrCtrlHandler::semifuture_getReceivedRoutesFiltered(
   return decision_->getReceivedRoutesFiltered(std::move(*filter));
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::ReceivedRoutesPage>>
+OpenrCtrlHandler::semifuture_getReceivedRoutesFilteredPage(
+    std::unique_ptr<thrift::ReceivedRouteFilter> filter,
+    std::unique_ptr<thrift::PageParams> page) {
+  CHECK(decision_);
+  return decision_->getReceivedRoutesFilteredPage(
+      std::move(*filter), std::move(*page));
+}
+
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDbComputed(
     std::unique_ptr<std::string> nodeName) {
@@ -575,19 +757,24 @@ OpenrCtrlHandler::semifuture_getRouteDbComputed(
 
 folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
 OpenrCtrlHandler::semifuture_getDecisionAdjacencyDbs() {
-  auto filter = std::make_unique<thrift::AdjacenciesFilter>();
-  filter->selectAreas_ref() = {
-      *getSingleAreaOrThrow("getDecisionAdjacencyDbs")};
-  return semifuture_getDecisionAdjacenciesFiltered(std::move(filter))
-      .deferValue([](std::unique_ptr<std::vector<thrift::AdjacencyDatabase>>&&
-                         adjDbs) mutable {
-        auto res = std::make_unique<thrift::AdjDbs>();
-        for (auto& db : *adjDbs) {
-          auto name = db.get_thisNodeName();
-          res->emplace(std::move(name), std::move(db));
-        }
-        return res;
-      });
+  CHECK(decision_);
+  auto area = getSingleAreaOrThrow("getDecisionAdjacencyDbs");
+  const auto version = decision_->getAdjacencyDbsVersion();
+  return adjacencyDbsCache_.get(*area, version, [this, area = *area]() {
+    auto filter = std::make_unique<thrift::AdjacenciesFilter>();
+    filter->selectAreas_ref() = {area};
+    return semifuture_getDecisionAdjacenciesFiltered(std::move(filter))
+        .deferValue(
+            [](std::unique_ptr<std::vector<thrift::AdjacencyDatabase>>&&
+                   adjDbs) mutable {
+              auto res = std::make_unique<thrift::AdjDbs>();
+              for (auto& db : *adjDbs) {
+                auto name = db.get_thisNodeName();
+                res->emplace(std::move(name), std::move(db));
+              }
+              return res;
+            });
+  });
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::AdjacencyDatabase>>>
@@ -660,6 +847,16 @@ OpenrCtrlHandler::semifuture_getKvStoreKeyValsFilteredArea(
           });
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::KvStoreKeyValsPage>>
+OpenrCtrlHandler::semifuture_getKvStoreKeyValsFilteredAreaPage(
+    std::unique_ptr<thrift::KeyDumpParams> filter,
+    std::unique_ptr<std::string> area,
+    std::unique_ptr<thrift::PageParams> page) {
+  CHECK(kvStore_);
+  return kvStore_->dumpKvStoreKeysPage(
+      std::move(*area), std::move(*filter), std::move(*page));
+}
+
 folly::SemiFuture<std::unique_ptr<thrift::Publication>>
 OpenrCtrlHandler::semifuture_getKvStoreHashFiltered(
     std::unique_ptr<thrift::KeyDumpParams> filter) {
@@ -750,6 +947,89 @@ OpenrCtrlHandler::semifuture_longPollKvStoreAdjArea(
   return sf;
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::KvStoreAdjWatchToken>>
+OpenrCtrlHandler::semifuture_watchKvStoreAdj(
+    std::unique_ptr<std::set<std::string>> selectAreas,
+    std::unique_ptr<thrift::KvStoreAdjWatchToken> token) {
+  auto [p, sf] = folly::makePromiseContract<
+      std::unique_ptr<thrift::KvStoreAdjWatchToken>>();
+
+  auto areas = std::move(*selectAreas);
+  auto config = getConfigSnapshot();
+  auto const& configuredAreas = config->getAreas();
+  if (areas.empty()) {
+    for (auto const& [area, _] : configuredAreas) {
+      areas.emplace(area);
+    }
+  }
+  for (auto const& area : areas) {
+    if (not configuredAreas.count(area)) {
+      p.setException(thrift::OpenrError(
+          fmt::format("Area {} is not configured for this node", area)));
+      return std::move(sf);
+    }
+  }
+
+  adjWatchState_.withWLock([&](auto& state) {
+    auto currentToken = state.getToken(adjWatchEpoch_, areas);
+    if (currentToken != *token) {
+      VLOG(3) << "Adj generation differs from watch token. Notify immediately";
+      p.setValue(std::make_unique<thrift::KvStoreAdjWatchToken>(
+          std::move(currentToken)));
+      return;
+    }
+    const auto expiryTimeMs =
+        getUnixTimeStampMs() + Constants::kLongPollReqHoldTime.count();
+    state.nextExpiryTimeMs = std::min(state.nextExpiryTimeMs, expiryTimeMs);
+    state.watches.emplace(
+        pendingRequestId_++,
+        AdjWatch{std::move(p), std::move(areas), expiryTimeMs});
+  });
+  return std::move(sf);
+}
+
+void
+OpenrCtrlHandler::processAdjWatches(
+    std::string const& area, bool isAdjChanged) {
+  adjWatchState_.withWLock([&](auto& state) {
+    if (isAdjChanged) {
+      ++state.generations[area];
+    }
+    // nothing to answer until a change or the earliest hold time expiry
+    const auto now = getUnixTimeStampMs();
+    if (not isAdjChanged and now < state.nextExpiryTimeMs) {
+      return;
+    }
+    state.nextExpiryTimeMs = std::numeric_limits<int64_t>::max();
+    for (auto it = state.watches.begin(); it != state.watches.end();) {
+      auto& watch = it->second;
+      if ((isAdjChanged and watch.areas.count(area)) or
+          now >= watch.expiryTimeMs) {
+        watch.promise.setValue(std::make_unique<thrift::KvStoreAdjWatchToken>(
+            state.getToken(adjWatchEpoch_, watch.areas)));
+        it = state.watches.erase(it);
+      } else {
+        state.nextExpiryTimeMs =
+            std::min(state.nextExpiryTimeMs, watch.expiryTimeMs);
+        ++it;
+      }
+    }
+  });
+}
+
+thrift::KvStoreAdjWatchToken
+OpenrCtrlHandler::AdjWatchState::getToken(
+    int64_t epoch, std::set<std::string> const& areas) const {
+  thrift::KvStoreAdjWatchToken token;
+  token.epoch_ref() = epoch;
+  for (auto const& area : areas) {
+    auto it = generations.find(area);
+    token.generations_ref()->emplace(
+        area, it != generations.end() ? it->second : 0);
+  }
+  return token;
+}
+
 folly::SemiFuture<folly::Unit>
 OpenrCtrlHandler::semifuture_processKvStoreDualMessage(
     std::unique_ptr<thrift::DualMessages> messages,
@@ -792,7 +1072,13 @@ folly::SemiFuture<std::unique_ptr<::std::vector<thrift::KvStoreAreaSummary>>>
 OpenrCtrlHandler::semifuture_getKvStoreAreaSummary(
     std::unique_ptr<std::set<std::string>> selectAreas) {
   CHECK(kvStore_);
-  return kvStore_->getKvStoreAreaSummaryInternal(std::move(*selectAreas));
+  auto key = folly::join(",", *selectAreas);
+  return kvStoreAreaSummaryCache_.get(
+      std::move(key),
+      kvStore_->getKvStoreSummaryGeneration(),
+      [this, selectAreas = std::move(*selectAreas)]() mutable {
+        return kvStore_->getKvStoreAreaSummaryInternal(std::move(selectAreas));
+      });
 }
 
 apache::thrift::ServerStream<thrift::Publication>
@@ -802,30 +1088,35 @@ OpenrCtrlHandler::subscribeKvStoreFilter(
   // Get new client-ID (monotonically increasing)
   auto clientToken = publisherToken_++;
 
-  auto streamAndPublisher =
-      apache::thrift::ServerStream<thrift::Publication>::createPublisher(
-          [this, clientToken]() {
-            kvStorePublishers_.withWLock([&](auto& kvStorePublishers_) {
-              if (kvStorePublishers_.erase(clientToken)) {
-                LOG(INFO) << "KvStore snoop stream-" << clientToken
-                          << " ended.";
-              } else {
-                LOG(ERROR) << "Can't remove unknown KvStore snoop stream-"
-                           << clientToken;
-              }
-              fb303::fbData->setCounter(
-                  "subscribers.kvstore", kvStorePublishers_.size());
-            });
-          });
+  auto streamAndPublisher = KvStoreStreamPublisher::create(
+      fmt::format("kvstore.{}", clientToken),
+      *getConfigSnapshot()->getConfig().ctrl_stream_config_ref(),
+      [this, clientToken]() {
+        kvStorePublishers_.withWLock([&](auto& kvStorePublishers_) {
+          if (kvStorePublishers_.remove(clientToken)) {
+            LOG(INFO) << "KvStore snoop stream-" << clientToken << " ended.";
+          } else {
+            LOG(ERROR) << "Can't remove unknown KvStore snoop stream-"
+                       << clientToken;
+          }
+          fb303::fbData->setCounter(
+              "subscribers.kvstore", kvStorePublishers_.size());
+          fb303::fbData->setCounter(
+              "subscribers.kvstore.filter_groups",
+              kvStorePublishers_.getNumGroups());
+        });
+      });
 
   kvStorePublishers_.withWLock([&](auto& kvStorePublishers_) {
-    assert(kvStorePublishers_.count(clientToken) == 0);
+    assert(not kvStorePublishers_.contains(clientToken));
     LOG(INFO) << "KvStore snoop stream-" << clientToken
               << " started for areas: " << folly::join(", ", *selectAreas);
     auto kvStorePublisher = std::make_unique<KvStorePublisher>(
         *selectAreas, std::move(*filter), std::move(streamAndPublisher.second));
-    kvStorePublishers_.emplace(clientToken, std::move(kvStorePublisher));
+    kvStorePublishers_.add(clientToken, std::move(kvStorePublisher));
     fb303::fbData->setCounter("subscribers.kvstore", kvStorePublishers_.size());
+    fb303::fbData->setCounter(
+        "subscribers.kvstore.filter_groups", kvStorePublishers_.getNumGroups());
   });
   return std::move(streamAndPublisher.first);
 }
@@ -884,25 +1175,48 @@ OpenrCtrlHandler::semifuture_subscribeAndGetAreaKvStores(
       });
 }
 
+apache::thrift::ServerStream<thrift::KeySetParams>
+OpenrCtrlHandler::subscribeKvStorePeerFlood(
+    std::unique_ptr<std::string> area, std::unique_ptr<std::string> peerName) {
+  CHECK(kvStore_);
+  auto config = getConfigSnapshot();
+  if (not config->getKvStoreConfig().enable_flood_stream_ref().value_or(
+          false)) {
+    throw thrift::OpenrError("KvStore flood stream is not enabled");
+  }
+
+  auto streamAndPublisher = KvStoreFloodStreamPublisher::create(
+      fmt::format("kvstore.flood.{}.{}", *area, *peerName),
+      *config->getConfig().ctrl_stream_config_ref(),
+      [peerName = *peerName]() {
+        LOG(INFO) << "KvStore flood stream of " << peerName << " ended.";
+      });
+  kvStore_->addKvStoreFloodStream(
+      std::move(*area),
+      std::move(*peerName),
+      std::move(streamAndPublisher.second));
+  return std::move(streamAndPublisher.first);
+}
+
 apache::thrift::ServerStream<thrift::RouteDatabaseDelta>
 OpenrCtrlHandler::subscribeFib() {
   // Get new client-ID (monotonically increasing)
   auto clientToken = publisherToken_++;
 
-  auto streamAndPublisher =
-      apache::thrift::ServerStream<thrift::RouteDatabaseDelta>::createPublisher(
-          [this, clientToken]() {
-            fibPublishers_.withWLock([&clientToken](auto& fibPublishers) {
-              if (fibPublishers.erase(clientToken)) {
-                LOG(INFO) << "Fib snoop stream-" << clientToken << " ended.";
-              } else {
-                LOG(ERROR) << "Can't remove unknown Fib snoop stream-"
-                           << clientToken;
-              }
-              fb303::fbData->setCounter(
-                  "subscribers.fib", fibPublishers.size());
-            });
-          });
+  auto streamAndPublisher = FibStreamPublisher::create(
+      fmt::format("fib.{}", clientToken),
+      *getConfigSnapshot()->getConfig().ctrl_stream_config_ref(),
+      [this, clientToken]() {
+        fibPublishers_.withWLock([&clientToken](auto& fibPublishers) {
+          if (fibPublishers.erase(clientToken)) {
+            LOG(INFO) << "Fib snoop stream-" << clientToken << " ended.";
+          } else {
+            LOG(ERROR) << "Can't remove unknown Fib snoop stream-"
+                       << clientToken;
+          }
+          fb303::fbData->setCounter("subscribers.fib", fibPublishers.size());
+        });
+      });
 
   fibPublishers_.withWLock([&clientToken,
                             &streamAndPublisher](auto& fibPublishers) {
@@ -935,19 +1249,23 @@ OpenrCtrlHandler::subscribeFibDetail() {
   // Get new client-ID (monotonically increasing)
   auto clientToken = publisherToken_++;
 
-  auto streamAndPublisher = apache::thrift::ServerStream<
-      thrift::RouteDatabaseDeltaDetail>::createPublisher([this, clientToken]() {
-    fibDetailPublishers_.withWLock([&clientToken](auto& fibDetailPublishers) {
-      if (fibDetailPublishers.erase(clientToken)) {
-        LOG(INFO) << "Fib detail snoop stream-" << clientToken << " ended.";
-      } else {
-        LOG(ERROR) << "Can't remove unknown Fib detail snoop stream-"
-                   << clientToken;
-      }
-      fb303::fbData->setCounter(
-          "subscribers.fibDetail", fibDetailPublishers.size());
-    });
-  });
+  auto streamAndPublisher = FibDetailStreamPublisher::create(
+      fmt::format("fib_detail.{}", clientToken),
+      *getConfigSnapshot()->getConfig().ctrl_stream_config_ref(),
+      [this, clientToken]() {
+        fibDetailPublishers_.withWLock(
+            [&clientToken](auto& fibDetailPublishers) {
+              if (fibDetailPublishers.erase(clientToken)) {
+                LOG(INFO) << "Fib detail snoop stream-" << clientToken
+                          << " ended.";
+              } else {
+                LOG(ERROR) << "Can't remove unknown Fib detail snoop stream-"
+                           << clientToken;
+              }
+              fb303::fbData->setCounter(
+                  "subscribers.fibDetail", fibDetailPublishers.size());
+            });
+      });
 
   fibDetailPublishers_.withWLock(
       [&clientToken, &streamAndPublisher](auto& fibDetailPublishers) {
@@ -978,6 +1296,146 @@ OpenrCtrlHandler::semifuture_subscribeAndGetFibDetail() {
       });
 }
 
+folly::SemiFuture<apache::thrift::ResponseAndServerStream<
+    thrift::RouteDatabaseDeltaCompact,
+    thrift::RouteDatabaseDeltaCompact>>
+OpenrCtrlHandler::semifuture_subscribeAndGetFibCompact() {
+  CHECK(fib_);
+  // Get new client-ID (monotonically increasing)
+  auto clientToken = publisherToken_++;
+
+  auto streamAndPublisher = FibCompactStreamPublisher::create(
+      fmt::format("fib_compact.{}", clientToken),
+      *getConfigSnapshot()->getConfig().ctrl_stream_config_ref(),
+      [this, clientToken]() {
+        fibCompactState_.withWLock([&clientToken](auto& state) {
+          if (state.publishers.erase(clientToken)) {
+            LOG(INFO) << "Fib compact snoop stream-" << clientToken
+                      << " ended.";
+          } else {
+            LOG(ERROR) << "Can't remove unknown Fib compact snoop stream-"
+                       << clientToken;
+          }
+          fb303::fbData->setCounter(
+              "subscribers.fibCompact", state.publishers.size());
+        });
+      });
+
+  // structured bindings can't be captured in C++17
+  auto promiseAndFuture = folly::makePromiseContract<FibCompactResponse>();
+  std::optional<thrift::RouteDatabaseDeltaCompact> dump;
+  bool startSeeding{false};
+  fibCompactState_.withWLock([&](auto& state) {
+    assert(state.publishers.count(clientToken) == 0);
+    LOG(INFO) << "Fib compact snoop stream-" << clientToken << " started.";
+    state.publishers.emplace(
+        clientToken, std::move(streamAndPublisher.second));
+    fb303::fbData->setCounter(
+        "subscribers.fibCompact", state.publishers.size());
+
+    // snapshot of the encoder, consistent with the stream
+    if (state.encoder.has_value()) {
+      dump = state.encoder->getFullDump();
+      return;
+    }
+    state.pendingSubscribers.emplace_back(PendingFibCompactSubscriber{
+        std::move(promiseAndFuture.first),
+        std::move(streamAndPublisher.first)});
+    startSeeding = not std::exchange(state.seeding, true);
+  });
+
+  if (dump.has_value()) {
+    return folly::makeSemiFuture(FibCompactResponse{
+        std::move(*dump), std::move(streamAndPublisher.first)});
+  }
+  if (startSeeding) {
+    seedFibCompactEncoder();
+  }
+  return std::move(promiseAndFuture.second);
+}
+
+void
+OpenrCtrlHandler::seedFibCompactEncoder() {
+  // encode on ctrl event base, along with Fib updates
+  fib_->getRouteDb().via(ctrlEvb_->getEvb()).thenTry(
+      [this](folly::Try<std::unique_ptr<thrift::RouteDatabase>>&& db) {
+        std::vector<PendingFibCompactSubscriber> subscribers;
+        std::optional<thrift::RouteDatabaseDeltaCompact> dump;
+        fibCompactState_.withWLock([&](auto& state) {
+          subscribers = std::exchange(state.pendingSubscribers, {});
+          auto pendingUpdates = std::exchange(state.pendingUpdates, {});
+          state.seeding = false;
+          if (db.hasException()) {
+            return;
+          }
+
+          auto& encoder = state.encoder.emplace();
+          thrift::RouteDatabaseDelta snapshot;
+          snapshot.unicastRoutesToUpdate_ref() =
+              std::move(*db.value()->unicastRoutes_ref());
+          snapshot.mplsRoutesToUpdate_ref() =
+              std::move(*db.value()->mplsRoutes_ref());
+          encoder.encode(snapshot);
+          // updates are absolute, replaying the ones in snapshot is harmless
+          for (auto const& update : pendingUpdates) {
+            encoder.encode(update);
+          }
+          LOG(INFO) << "Seeded Fib compact encoder with "
+                    << encoder.getNumRoutes() << " routes and "
+                    << encoder.getNumNextHopGroups() << " next-hop groups.";
+          dump = encoder.getFullDump();
+        });
+
+        // answer outside of the lock, dropping streams invokes `onComplete`
+        for (auto& subscriber : subscribers) {
+          if (dump.has_value()) {
+            subscriber.promise.setValue(
+                FibCompactResponse{*dump, std::move(subscriber.stream)});
+          } else {
+            subscriber.promise.setException(db.exception());
+          }
+        }
+      });
+}
+
+apache::thrift::ServerStream<thrift::KvStoreKeyValsPage>
+OpenrCtrlHandler::streamKvStoreKeyValsFilteredArea(
+    std::unique_ptr<thrift::KeyDumpParams> filter,
+    std::unique_ptr<std::string> area,
+    std::unique_ptr<thrift::PageParams> page) {
+  CHECK(kvStore_);
+  return createPagedStream<thrift::KvStoreKeyValsPage>(
+      [this, filter = std::move(*filter), area = std::move(*area)](
+          thrift::PageParams const& pageParams) {
+        return kvStore_->dumpKvStoreKeysPage(area, filter, pageParams);
+      },
+      std::move(*page));
+}
+
+apache::thrift::ServerStream<thrift::RouteDatabaseDetailPage>
+OpenrCtrlHandler::streamRouteDetailDb(
+    std::unique_ptr<thrift::PageParams> page) {
+  CHECK(fib_);
+  return createPagedStream<thrift::RouteDatabaseDetailPage>(
+      [this](thrift::PageParams const& pageParams) {
+        return getRouteDetailDbPage(pageParams);
+      },
+      std::move(*page));
+}
+
+apache::thrift::ServerStream<thrift::ReceivedRoutesPage>
+OpenrCtrlHandler::streamReceivedRoutesFiltered(
+    std::unique_ptr<thrift::ReceivedRouteFilter> filter,
+    std::unique_ptr<thrift::PageParams> page) {
+  CHECK(decision_);
+  return createPagedStream<thrift::ReceivedRoutesPage>(
+      [this, filter = std::move(*filter)](
+          thrift::PageParams const& pageParams) {
+        return decision_->getReceivedRoutesFilteredPage(filter, pageParams);
+      },
+      std::move(*page));
+}
+
 //
 // LinkMonitor APIs
 //
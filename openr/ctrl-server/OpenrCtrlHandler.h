@@ -11,6 +11,10 @@
 #include <openr/common/Types.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/config/Config.h>
+#include <openr/ctrl-server/CompactRouteEncoder.h>
+#include <openr/ctrl-server/CounterIndex.h>
+#include <openr/ctrl-server/ResponseCache.h>
+#include <openr/ctrl-server/StreamPublisher.h>
 #include <openr/decision/Decision.h>
 #include <openr/fib/Fib.h>
 #include <openr/if/gen-cpp2/OpenrCtrlCpp.h>
@@ -21,6 +25,27 @@
 #include <openr/prefix-manager/PrefixManager.h>
 
 namespace openr {
+
+using FibStreamPublisher = BufferedStreamPublisher<
+    thrift::RouteDatabaseDelta,
+    RouteDeltaCoalescer<thrift::RouteDatabaseDelta>>;
+using FibDetailStreamPublisher = BufferedStreamPublisher<
+    thrift::RouteDatabaseDeltaDetail,
+    RouteDeltaCoalescer<thrift::RouteDatabaseDeltaDetail>>;
+using FibCompactStreamPublisher = BufferedStreamPublisher<
+    thrift::RouteDatabaseDeltaCompact,
+    CompactRouteDeltaCoalescer>;
+
+/**
+ * OpenrCtrl thrift service. Calls run concurrently on the thrift server's CPU
+ * worker threads (see ThriftServerConfig.num_cpu_worker_threads), hence all
+ * state of the handler is synchronized.
+ *
+ * Reads of state published by modules, e.g. Decision snapshots, cached
+ * responses and counters, are served on the calling thread. Other calls,
+ * including all mutations, are forwarded to the event base of the owning
+ * module which serializes them with its own processing.
+ */
 class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
                                public facebook::fb303::BaseService {
  public:
@@ -59,6 +84,11 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       std::unique_ptr<std::vector<std::string>> keys) override;
   int64_t getCounter(std::unique_ptr<std::string> key) override;
 
+  void getRegexCountersDelta(
+      thrift::CountersDelta& _return,
+      std::unique_ptr<std::string> regex,
+      std::unique_ptr<thrift::CountersDeltaToken> token) override;
+
   // Openr Node Name
   void getMyNodeName(std::string& _return) override;
 
@@ -73,12 +103,23 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   void dryrunConfig(
       ::std::string& _return, std::unique_ptr<::std::string> file) override;
 
+  void reloadConfig(
+      ::std::string& _return, std::unique_ptr<::std::string> file) override;
+
   //
   // Monitor APIs
   //
 
   void getEventLogs(std::vector<::std::string>& _return) override;
 
+  //
+  // Profiler APIs
+  //
+
+  void startProfiler(int32_t durationS, int32_t frequencyHz) override;
+
+  void getProfilerFoldedStacks(std::string& _return) override;
+
   //
   // PrefixManager APIs
   //
@@ -96,6 +137,10 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       thrift::PrefixType prefixType,
       std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::PrefixChangeBatchResult>>
+  semifuture_applyPrefixChanges(
+      std::unique_ptr<thrift::PrefixChangeBatch> batch) override;
+
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
   semifuture_getPrefixes() override;
 
@@ -133,6 +178,10 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetail>>
   semifuture_getRouteDetailDb() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetailPage>>
+  semifuture_getRouteDetailDbPage(
+      std::unique_ptr<thrift::PageParams> page) override;
+
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
   semifuture_getUnicastRoutesFiltered(
       std::unique_ptr<std::vector<::std::string>> prefixes) override;
@@ -174,6 +223,11 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   semifuture_getReceivedRoutesFiltered(
       std::unique_ptr<thrift::ReceivedRouteFilter> filter) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::ReceivedRoutesPage>>
+  semifuture_getReceivedRoutesFilteredPage(
+      std::unique_ptr<thrift::ReceivedRouteFilter> filter,
+      std::unique_ptr<thrift::PageParams> page) override;
+
   folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
   semifuture_getDecisionAdjacencyDbs() override;
 
@@ -209,6 +263,12 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       std::unique_ptr<thrift::KeyDumpParams> filter,
       std::unique_ptr<std::string> area) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::KvStoreKeyValsPage>>
+  semifuture_getKvStoreKeyValsFilteredAreaPage(
+      std::unique_ptr<thrift::KeyDumpParams> filter,
+      std::unique_ptr<std::string> area,
+      std::unique_ptr<thrift::PageParams> page) override;
+
   folly::SemiFuture<std::unique_ptr<thrift::Publication>>
   semifuture_getKvStoreHashFiltered(
       std::unique_ptr<thrift::KeyDumpParams> filter) override;
@@ -273,6 +333,10 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       std::unique_ptr<thrift::KeyDumpParams> filter,
       std::unique_ptr<std::set<std::string>> selectAreas) override;
 
+  apache::thrift::ServerStream<thrift::KeySetParams> subscribeKvStorePeerFlood(
+      std::unique_ptr<std::string> area,
+      std::unique_ptr<std::string> peerName) override;
+
   folly::SemiFuture<apache::thrift::ResponseAndServerStream<
       thrift::RouteDatabase,
       thrift::RouteDatabaseDelta>>
@@ -283,6 +347,26 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       thrift::RouteDatabaseDeltaDetail>>
   semifuture_subscribeAndGetFibDetail() override;
 
+  folly::SemiFuture<apache::thrift::ResponseAndServerStream<
+      thrift::RouteDatabaseDeltaCompact,
+      thrift::RouteDatabaseDeltaCompact>>
+  semifuture_subscribeAndGetFibCompact() override;
+
+  // Paginated dumps as streams, see createPagedStream()
+  apache::thrift::ServerStream<thrift::KvStoreKeyValsPage>
+  streamKvStoreKeyValsFilteredArea(
+      std::unique_ptr<thrift::KeyDumpParams> filter,
+      std::unique_ptr<std::string> area,
+      std::unique_ptr<thrift::PageParams> page) override;
+
+  apache::thrift::ServerStream<thrift::RouteDatabaseDetailPage>
+  streamRouteDetailDb(std::unique_ptr<thrift::PageParams> page) override;
+
+  apache::thrift::ServerStream<thrift::ReceivedRoutesPage>
+  streamReceivedRoutesFiltered(
+      std::unique_ptr<thrift::ReceivedRouteFilter> filter,
+      std::unique_ptr<thrift::PageParams> page) override;
+
   // Long poll support
   folly::SemiFuture<bool> semifuture_longPollKvStoreAdj(
       std::unique_ptr<thrift::KeyVals> snapshot) override;
@@ -291,6 +375,11 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       std::unique_ptr<std::string> area,
       std::unique_ptr<thrift::KeyVals> snapshot) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::KvStoreAdjWatchToken>>
+  semifuture_watchKvStoreAdj(
+      std::unique_ptr<std::set<std::string>> selectAreas,
+      std::unique_ptr<thrift::KvStoreAdjWatchToken> token) override;
+
   //
   // LinkMonitor APIs
   //
@@ -330,6 +419,8 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // Explicitly override blocking API call as no ASYNC needed
   void getOpenrVersion(thrift::OpenrVersions& openrVersion) override;
   void getBuildInfo(thrift::BuildInfo& buildInfo) override;
+  void getEventBaseProfiles(
+      std::vector<thrift::EventBaseProfile>& profiles) override;
 
   //
   // PersistentStore APIs
@@ -366,11 +457,21 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
     return kvStorePublishers_.wlock()->size();
   }
 
+  inline size_t
+  getNumKvStorePublisherGroups() {
+    return kvStorePublishers_.wlock()->getNumGroups();
+  }
+
   inline size_t
   getNumPendingLongPollReqs() {
     return longPollReqs_->size();
   }
 
+  inline size_t
+  getNumPendingAdjWatches() {
+    return adjWatchState_->watches.size();
+  }
+
   inline size_t
   getNumFibPublishers() {
     return fibPublishers_.wlock()->size();
@@ -381,6 +482,11 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
     return fibDetailPublishers_.wlock()->size();
   }
 
+  inline size_t
+  getNumFibCompactPublishers() {
+    return fibCompactState_.wlock()->publishers.size();
+  }
+
   //
   // API to cleanup private variables
   //
@@ -394,13 +500,37 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // eaxclty 1 area is configured
   std::unique_ptr<std::string> getSingleAreaOrThrow(std::string const& caller);
 
+  // running config, as replaced by reloadConfig()
+  std::shared_ptr<const Config>
+  getConfigSnapshot() const {
+    return config_.copy();
+  }
+
+  // load and validate config file, throws thrift::OpenrError
+  static std::shared_ptr<const Config> loadConfig(const std::string& fileName);
+
+  // page of Fib route details, best routes completed by Decision if Fib keeps
+  // a compact route state
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetailPage>>
+  getRouteDetailDbPage(thrift::PageParams page);
+
   void authorizeConnection();
   void closeKvStorePublishers();
   void closeFibPublishers();
 
+  // seed encoder of compact Fib streams with a Fib snapshot, then answer
+  // pending subscribers
+  void seedFibCompactEncoder();
+
+  // bump adj generation of area if changed, and answer watches of the area or
+  // past their hold time
+  void processAdjWatches(std::string const& area, bool isAdjChanged);
+
   const std::string nodeName_;
   const std::unordered_set<std::string> acceptablePeerCommonNames_;
 
+  OpenrEventBase* ctrlEvb_{nullptr};
+
   // Pointers to Open/R modules
   Decision* decision_{nullptr};
   Fib* fib_{nullptr};
@@ -410,28 +540,43 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   PersistentStore* configStore_{nullptr};
   PrefixManager* prefixManager_{nullptr};
   Spark* spark_{nullptr};
-  std::shared_ptr<const Config> config_;
+  // replaced by reloadConfig()
+  folly::Synchronized<std::shared_ptr<const Config>> config_;
 
   // Publisher token (monotonically increasing) for all publishers
   std::atomic<int64_t> publisherToken_{0};
 
-  // Active kvstore snoop publishers
-  folly::Synchronized<
-      std::unordered_map<int64_t, std::unique_ptr<KvStorePublisher>>>
-      kvStorePublishers_;
+  // Active kvstore snoop publishers, indexed by area and filter
+  folly::Synchronized<KvStorePublisherIndex> kvStorePublishers_;
 
   // Active Fib streaming publishers
-  folly::Synchronized<std::unordered_map<
-      int64_t,
-      apache::thrift::ServerStreamPublisher<thrift::RouteDatabaseDelta>>>
+  folly::Synchronized<std::unordered_map<int64_t, FibStreamPublisher>>
       fibPublishers_;
 
   // Active Fib Detail streaming publishers
-  folly::Synchronized<std::unordered_map<
-      int64_t,
-      apache::thrift::ServerStreamPublisher<thrift::RouteDatabaseDeltaDetail>>>
+  folly::Synchronized<std::unordered_map<int64_t, FibDetailStreamPublisher>>
       fibDetailPublishers_;
 
+  // Compact Fib streams share one encoder mirroring Fib routes. It is seeded
+  // with a Fib snapshot on first subscription, updates received meanwhile are
+  // replayed, then maintained from Fib updates. Subscribers get a full dump of
+  // the encoder, hence their snapshot is consistent with their stream.
+  using FibCompactResponse = apache::thrift::ResponseAndServerStream<
+      thrift::RouteDatabaseDeltaCompact,
+      thrift::RouteDatabaseDeltaCompact>;
+  struct PendingFibCompactSubscriber {
+    folly::Promise<FibCompactResponse> promise;
+    apache::thrift::ServerStream<thrift::RouteDatabaseDeltaCompact> stream;
+  };
+  struct FibCompactState {
+    std::optional<CompactRouteEncoder> encoder;
+    bool seeding{false};
+    std::vector<thrift::RouteDatabaseDelta> pendingUpdates;
+    std::vector<PendingFibCompactSubscriber> pendingSubscribers;
+    std::unordered_map<int64_t, FibCompactStreamPublisher> publishers;
+  };
+  folly::Synchronized<FibCompactState> fibCompactState_;
+
   // pending longPoll requests from clients, which consists of
   // 1). promise; 2). timestamp when req received on server
   std::atomic<int64_t> pendingRequestId_{0};
@@ -440,6 +585,34 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       std::unordered_map<int64_t, std::pair<folly::Promise<bool>, int64_t>>>>
       longPollReqs_;
 
+  // pending adj watches, answered from per area adj generations
+  struct AdjWatch {
+    folly::Promise<std::unique_ptr<thrift::KvStoreAdjWatchToken>> promise;
+    std::set<std::string> areas;
+    int64_t expiryTimeMs{0};
+  };
+  struct AdjWatchState {
+    std::unordered_map<std::string /* area */, int64_t> generations;
+    std::unordered_map<int64_t, AdjWatch> watches;
+    // earliest expiry time of watches
+    int64_t nextExpiryTimeMs{std::numeric_limits<int64_t>::max()};
+
+    thrift::KvStoreAdjWatchToken getToken(
+        int64_t epoch, std::set<std::string> const& areas) const;
+  };
+  // identifies this instance in tokens, generations restart with it
+  const int64_t adjWatchEpoch_{getUnixTimeStampMs()};
+  folly::Synchronized<AdjWatchState> adjWatchState_;
+
+  // index of counter names for regex counter queries
+  CounterIndex counterIndex_;
+
+  // responses of APIs polled by tooling, invalidated by module generations
+  ResponseCache<thrift::RouteDatabase> routeDbCache_{"route_db"};
+  ResponseCache<thrift::AdjDbs> adjacencyDbsCache_{"adjacency_dbs"};
+  ResponseCache<std::vector<thrift::KvStoreAreaSummary>>
+      kvStoreAreaSummaryCache_{"kvstore_area_summary"};
+
   // fiber task future hold for kvStore update, fib update reader's
   std::vector<folly::Future<folly::Unit>> workers_;
 }; // class OpenrCtrlHandler
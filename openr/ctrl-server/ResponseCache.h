@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <fb303/ServiceData.h>
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+#include <folly/futures/Future.h>
+
+namespace openr {
+
+/**
+ * Cache of responses of read-only ctrl APIs which are polled periodically.
+ * A response is built once per generation of the module state it is built
+ * from (e.g. Fib route state version), then copied to every caller until the
+ * generation changes. Entries are keyed by the arguments of the API.
+ *
+ * The generation must be read before building the response. A response is
+ * then never tagged with a newer generation than the state it was built
+ * from, the opposite only costs a rebuild on the next call.
+ *
+ * Exports `ctrl.response_cache.<name>.{hits,misses}` stats.
+ */
+template <typename T>
+class ResponseCache {
+ public:
+  using BuildFn = folly::Function<folly::SemiFuture<std::unique_ptr<T>>()>;
+
+  explicit ResponseCache(std::string const& name, size_t maxEntries = 16)
+      : hitsKey_("ctrl.response_cache." + name + ".hits"),
+        missesKey_("ctrl.response_cache." + name + ".misses"),
+        maxEntries_(maxEntries) {}
+
+  folly::SemiFuture<std::unique_ptr<T>>
+  get(std::string key, int64_t generation, BuildFn build) {
+    {
+      auto entries = entries_.rlock();
+      auto it = entries->find(key);
+      if (it != entries->end() and it->second.generation == generation) {
+        facebook::fb303::fbData->addStatValue(
+            hitsKey_, 1, facebook::fb303::COUNT);
+        return folly::makeSemiFuture(
+            std::make_unique<T>(*it->second.response));
+      }
+    }
+
+    facebook::fb303::fbData->addStatValue(
+        missesKey_, 1, facebook::fb303::COUNT);
+    return build().deferValue(
+        [this, key = std::move(key), generation](std::unique_ptr<T>&& resp) {
+          insert(key, generation, *resp);
+          return std::move(resp);
+        });
+  }
+
+  size_t
+  size() const {
+    return entries_.rlock()->size();
+  }
+
+ private:
+  void
+  insert(std::string const& key, int64_t generation, T const& response) {
+    auto entries = entries_.wlock();
+    auto it = entries->find(key);
+    if (it != entries->end()) {
+      // keep the newest response of racing builds
+      if (it->second.generation < generation) {
+        it->second = Entry{generation, std::make_shared<const T>(response)};
+      }
+      return;
+    }
+    // arguments come from clients, bound the number of entries
+    if (entries->size() >= maxEntries_) {
+      entries->clear();
+    }
+    entries->emplace(
+        key, Entry{generation, std::make_shared<const T>(response)});
+  }
+
+  struct Entry {
+    int64_t generation{0};
+    std::shared_ptr<const T> response;
+  };
+
+  const std::string hitsKey_;
+  const std::string missesKey_;
+  const size_t maxEntries_;
+
+  folly::Synchronized<std::unordered_map<std::string, Entry>> entries_;
+};
+
+} // namespace openr
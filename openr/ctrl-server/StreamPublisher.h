@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fb303/ServiceData.h>
+#include <fmt/format.h>
+#include <folly/ExceptionWrapper.h>
+#include <folly/Function.h>
+#include <folly/IPAddress.h>
+#include <folly/ScopeGuard.h>
+#include <folly/executors/InlineExecutor.h>
+#include <folly/fibers/Baton.h>
+#include <folly/futures/Future.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/CancellationToken.h>
+#include <folly/experimental/coro/AsyncGenerator.h>
+#include <folly/experimental/coro/Task.h>
+#endif
+#include <thrift/lib/cpp2/async/ServerStream.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/OpenrConfig_types.h>
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+/**
+ * Publisher of a thrift server stream with bounded buffering, for subscribers
+ * which don't keep up with updates.
+ *
+ * Updates are buffered until the client pulls them. Past
+ * `max_buffered_updates`, further updates are merged by `Coalescer` into the
+ * latest state per key, which is sent once the buffer is drained. Past
+ * `max_coalesced_entries` keys, the stream is completed with an error and the
+ * subscriber has to subscribe again to resync with a snapshot.
+ *
+ * Coalescer must provide
+ *   void add(T&& update);
+ *   size_t size() const;         // number of coalesced keys
+ *   std::vector<T> release();    // coalesced updates, resets state
+ *
+ * All methods are thread safe. `onComplete` passed to create() is invoked once
+ * the stream ends, either cancelled by the client or completed by publisher.
+ *
+ * NOTE: Buffering relies on the pull model of generator based streams and
+ * requires co-routines. Without them, updates are pushed to the stream without
+ * limit.
+ */
+template <typename T, typename Coalescer>
+class BufferedStreamPublisher {
+ public:
+  static std::pair<apache::thrift::ServerStream<T>, BufferedStreamPublisher>
+  create(
+      std::string name,
+      thrift::CtrlStreamConfig const& config,
+      folly::Function<void()> onComplete) {
+    auto state = std::make_shared<State>(std::move(name), config);
+#if FOLLY_HAS_COROUTINES
+    return std::make_pair(
+        apache::thrift::ServerStream<T>(
+            generate(state, folly::makeGuard(std::move(onComplete)))),
+        BufferedStreamPublisher(std::move(state)));
+#else
+    auto streamAndPublisher =
+        apache::thrift::ServerStream<T>::createPublisher(std::move(onComplete));
+    state->publisher.emplace(std::move(streamAndPublisher.second));
+    return std::make_pair(
+        std::move(streamAndPublisher.first),
+        BufferedStreamPublisher(std::move(state)));
+#endif
+  }
+
+  /**
+   * Non blocking publish of an update. Ignored once completed.
+   */
+  void
+  next(T update) {
+    auto& state = *state_;
+    folly::fibers::Baton* pendingRead{nullptr};
+    {
+      std::lock_guard<std::mutex> l(state.lock);
+      if (state.completed) {
+        return;
+      }
+#if FOLLY_HAS_COROUTINES
+      if (state.coalescer.size() == 0 and
+          state.buffer.size() < state.maxBufferedUpdates) {
+        state.buffer.emplace_back(std::move(update));
+      } else {
+        // lagging, merge with other updates not sent yet
+        state.coalescer.add(std::move(update));
+        fb303::fbData->addStatValue(
+            "ctrl.stream.num_coalesced_updates", 1, fb303::COUNT);
+        if (state.coalescer.size() > state.maxCoalescedEntries) {
+          LOG(WARNING) << "Disconnecting slow subscriber of " << state.name
+                       << ", lagging by " << state.coalescer.size()
+                       << " entries";
+          fb303::fbData->addStatValue(
+              "ctrl.stream.num_slow_subscriber_disconnects", 1, fb303::COUNT);
+          state.buffer.clear();
+          state.coalescer.release();
+          state.completed = true;
+          state.error = folly::make_exception_wrapper<std::runtime_error>(
+              "subscriber too slow, subscribe again to resync");
+        }
+      }
+      state.exportLag();
+      pendingRead = std::exchange(state.pendingRead, nullptr);
+#else
+      state.publisher->next(std::move(update));
+#endif
+    }
+    if (pendingRead) {
+      pendingRead->post();
+    }
+  }
+
+  /**
+   * Complete the stream once buffered updates have been sent, with optional
+   * error
+   */
+  void
+  complete(folly::exception_wrapper error = {}) {
+    auto& state = *state_;
+#if FOLLY_HAS_COROUTINES
+    folly::fibers::Baton* pendingRead{nullptr};
+    {
+      std::lock_guard<std::mutex> l(state.lock);
+      if (state.completed) {
+        return;
+      }
+      state.completed = true;
+      state.error = std::move(error);
+      pendingRead = std::exchange(state.pendingRead, nullptr);
+    }
+    if (pendingRead) {
+      pendingRead->post();
+    }
+#else
+    std::optional<apache::thrift::ServerStreamPublisher<T>> publisher;
+    {
+      std::lock_guard<std::mutex> l(state.lock);
+      if (state.completed) {
+        return;
+      }
+      state.completed = true;
+      publisher = std::exchange(state.publisher, std::nullopt);
+    }
+    // `onComplete` is invoked inline, complete outside of the lock
+    if (error) {
+      std::move(*publisher).complete(std::move(error));
+    } else {
+      std::move(*publisher).complete();
+    }
+#endif
+  }
+
+  /**
+   * Number of updates and coalesced entries not yet pulled by the client
+   */
+  size_t
+  getLag() const {
+    std::lock_guard<std::mutex> l(state_->lock);
+    return state_->getLag();
+  }
+
+  bool
+  isCompleted() const {
+    std::lock_guard<std::mutex> l(state_->lock);
+    return state_->completed;
+  }
+
+ private:
+  struct State {
+    State(std::string name, thrift::CtrlStreamConfig const& config)
+        : name(std::move(name)),
+          maxBufferedUpdates(*config.max_buffered_updates_ref()),
+          maxCoalescedEntries(*config.max_coalesced_entries_ref()) {}
+
+    ~State() {
+      fb303::fbData->clearCounter(lagCounterKey());
+    }
+
+    size_t
+    getLag() const {
+      return buffer.size() + coalescer.size();
+    }
+
+    std::string
+    lagCounterKey() const {
+      return fmt::format("ctrl.stream.{}.lag", name);
+    }
+
+    void
+    exportLag() const {
+      fb303::fbData->setCounter(lagCounterKey(), getLag());
+    }
+
+    const std::string name;
+    const size_t maxBufferedUpdates;
+    const size_t maxCoalescedEntries;
+
+    mutable std::mutex lock;
+    bool completed{false};
+    folly::exception_wrapper error;
+    std::deque<T> buffer;
+    Coalescer coalescer;
+    // read of the stream waiting for updates
+    folly::fibers::Baton* pendingRead{nullptr};
+#if !FOLLY_HAS_COROUTINES
+    std::optional<apache::thrift::ServerStreamPublisher<T>> publisher;
+#endif
+  };
+
+  explicit BufferedStreamPublisher(std::shared_ptr<State> state)
+      : state_(std::move(state)) {}
+
+#if FOLLY_HAS_COROUTINES
+  template <typename OnCompleteGuard>
+  static folly::coro::AsyncGenerator<T&&>
+  generate(std::shared_ptr<State> state, OnCompleteGuard onComplete) {
+    while (true) {
+      folly::fibers::Baton baton;
+      std::optional<T> update;
+      bool completed{false};
+      folly::exception_wrapper error;
+      {
+        std::lock_guard<std::mutex> l(state->lock);
+        if (state->buffer.empty()) {
+          // caught up, send coalesced state
+          for (auto& coalesced : state->coalescer.release()) {
+            state->buffer.emplace_back(std::move(coalesced));
+          }
+        }
+        if (not state->buffer.empty()) {
+          update.emplace(std::move(state->buffer.front()));
+          state->buffer.pop_front();
+          state->exportLag();
+        } else if (state->completed) {
+          completed = true;
+          error = std::move(state->error);
+        } else {
+          state->pendingRead = &baton;
+        }
+      }
+
+      if (update.has_value()) {
+        co_yield std::move(update).value();
+        continue;
+      }
+      if (completed) {
+        if (error) {
+          co_yield folly::coro::co_error(std::move(error));
+        }
+        co_return;
+      }
+
+      // wait for an update, or for the client to cancel the stream
+      {
+        folly::CancellationCallback cb(
+            co_await folly::coro::co_current_cancellation_token, [&]() {
+              std::lock_guard<std::mutex> l(state->lock);
+              if (state->pendingRead == &baton) {
+                state->pendingRead = nullptr;
+                baton.post();
+              }
+            });
+        co_await baton;
+      }
+      if ((co_await folly::coro::co_current_cancellation_token)
+              .isCancellationRequested()) {
+        co_return;
+      }
+    }
+  }
+#endif
+
+  std::shared_ptr<State> state_;
+};
+
+/**
+ * Coalescer of route deltas (thrift::RouteDatabaseDelta or
+ * thrift::RouteDatabaseDeltaDetail) to the latest update or delete per
+ * prefix and label.
+ */
+template <typename DeltaT>
+class RouteDeltaCoalescer {
+ public:
+  void
+  add(DeltaT&& delta) {
+    for (auto& route : *delta.unicastRoutesToUpdate_ref()) {
+      auto prefix = toIPNetwork(*route.dest_ref());
+      unicastRoutesToDelete_.erase(prefix);
+      unicastRoutesToUpdate_.insert_or_assign(prefix, std::move(route));
+    }
+    for (auto& prefix : *delta.unicastRoutesToDelete_ref()) {
+      auto network = toIPNetwork(prefix);
+      unicastRoutesToUpdate_.erase(network);
+      unicastRoutesToDelete_.insert_or_assign(network, std::move(prefix));
+    }
+    for (auto& route : *delta.mplsRoutesToUpdate_ref()) {
+      auto label = *route.topLabel_ref();
+      mplsRoutesToDelete_.erase(label);
+      mplsRoutesToUpdate_.insert_or_assign(label, std::move(route));
+    }
+    for (auto label : *delta.mplsRoutesToDelete_ref()) {
+      mplsRoutesToUpdate_.erase(label);
+      mplsRoutesToDelete_.emplace(label);
+    }
+  }
+
+  size_t
+  size() const {
+    return unicastRoutesToUpdate_.size() + unicastRoutesToDelete_.size() +
+        mplsRoutesToUpdate_.size() + mplsRoutesToDelete_.size();
+  }
+
+  std::vector<DeltaT>
+  release() {
+    if (size() == 0) {
+      return {};
+    }
+    DeltaT delta;
+    for (auto& [_, route] : unicastRoutesToUpdate_) {
+      delta.unicastRoutesToUpdate_ref()->emplace_back(std::move(route));
+    }
+    for (auto& [_, prefix] : unicastRoutesToDelete_) {
+      delta.unicastRoutesToDelete_ref()->emplace_back(std::move(prefix));
+    }
+    for (auto& [_, route] : mplsRoutesToUpdate_) {
+      delta.mplsRoutesToUpdate_ref()->emplace_back(std::move(route));
+    }
+    delta.mplsRoutesToDelete_ref()->assign(
+        mplsRoutesToDelete_.begin(), mplsRoutesToDelete_.end());
+    unicastRoutesToUpdate_.clear();
+    unicastRoutesToDelete_.clear();
+    mplsRoutesToUpdate_.clear();
+    mplsRoutesToDelete_.clear();
+
+    std::vector<DeltaT> deltas;
+    deltas.emplace_back(std::move(delta));
+    return deltas;
+  }
+
+ private:
+  using UnicastRouteT =
+      typename std::decay_t<decltype(*DeltaT().unicastRoutesToUpdate_ref())>::
+          value_type;
+  using MplsRouteT = typename std::decay_t<decltype(
+      *DeltaT().mplsRoutesToUpdate_ref())>::value_type;
+
+  std::unordered_map<folly::CIDRNetwork, UnicastRouteT> unicastRoutesToUpdate_;
+  std::unordered_map<folly::CIDRNetwork, thrift::IpPrefix>
+      unicastRoutesToDelete_;
+  std::unordered_map<int32_t, MplsRouteT> mplsRoutesToUpdate_;
+  std::unordered_set<int32_t> mplsRoutesToDelete_;
+};
+
+// returns the page of a paginated dump at cursor of page params
+template <typename PageT>
+using GetPageFn = folly::Function<folly::SemiFuture<std::unique_ptr<PageT>>(
+    thrift::PageParams const&)>;
+
+namespace detail {
+
+#if FOLLY_HAS_COROUTINES
+template <typename PageT>
+folly::coro::AsyncGenerator<PageT&&>
+generatePages(GetPageFn<PageT> getPage, thrift::PageParams page) {
+  while (true) {
+    auto thriftPage = co_await getPage(page);
+    auto nextCursor = thriftPage->nextCursor_ref().to_optional();
+    co_yield std::move(*thriftPage);
+    if (not nextCursor.has_value()) {
+      co_return;
+    }
+    page.cursor_ref() = std::move(*nextCursor);
+  }
+}
+#else
+template <typename PageT>
+void
+publishPages(
+    std::shared_ptr<GetPageFn<PageT>> getPage,
+    thrift::PageParams page,
+    std::shared_ptr<apache::thrift::ServerStreamPublisher<PageT>> publisher) {
+  (*getPage)(page)
+      .via(&folly::InlineExecutor::instance())
+      .thenTry([getPage, page, publisher](
+                   folly::Try<std::unique_ptr<PageT>>&& thriftPage) mutable {
+        if (thriftPage.hasException()) {
+          std::move(*publisher).complete(std::move(thriftPage.exception()));
+          return;
+        }
+        auto nextCursor = thriftPage.value()->nextCursor_ref().to_optional();
+        publisher->next(std::move(*thriftPage.value()));
+        if (not nextCursor.has_value()) {
+          std::move(*publisher).complete();
+          return;
+        }
+        page.cursor_ref() = std::move(*nextCursor);
+        publishPages(std::move(getPage), std::move(page), std::move(publisher));
+      });
+}
+#endif
+
+} // namespace detail
+
+/**
+ * Server stream of a paginated dump (see thrift::PageParams), from the page
+ * at `page.cursor` to the last one. `getPage` returns the page at given
+ * cursor, usually running on the module's event base, which is thus released
+ * between pages. Errors of `getPage` complete the stream with the error.
+ *
+ * With co-routines, the next page is only fetched once the client pulled the
+ * previous one. Without them, pages are fetched one after another and pushed
+ * to the stream as soon as they are ready.
+ */
+template <typename PageT>
+apache::thrift::ServerStream<PageT>
+createPagedStream(GetPageFn<PageT> getPage, thrift::PageParams page) {
+#if FOLLY_HAS_COROUTINES
+  return apache::thrift::ServerStream<PageT>(
+      detail::generatePages<PageT>(std::move(getPage), std::move(page)));
+#else
+  auto [stream, publisher] =
+      apache::thrift::ServerStream<PageT>::createPublisher([]() {});
+  detail::publishPages<PageT>(
+      std::make_shared<GetPageFn<PageT>>(std::move(getPage)),
+      std::move(page),
+      std::make_shared<apache::thrift::ServerStreamPublisher<PageT>>(
+          std::move(publisher)));
+  return std::move(stream);
+#endif
+}
+
+} // namespace openr
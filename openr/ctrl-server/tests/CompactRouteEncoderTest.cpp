@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/init/Init.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/ctrl-server/CompactRouteEncoder.h>
+
+using namespace openr;
+
+namespace {
+
+const auto prefix1 = toIpPrefix("10.0.0.0/24");
+const auto prefix2 = toIpPrefix("fc00::/64");
+const auto prefix3 = toIpPrefix("fc00:1::/64");
+
+const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1", 1);
+const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2", 1);
+
+thrift::RouteDatabaseDelta
+createDelta(
+    std::vector<thrift::UnicastRoute> unicastRoutesToUpdate,
+    std::vector<thrift::IpPrefix> unicastRoutesToDelete = {}) {
+  thrift::RouteDatabaseDelta delta;
+  delta.unicastRoutesToUpdate_ref() = std::move(unicastRoutesToUpdate);
+  delta.unicastRoutesToDelete_ref() = std::move(unicastRoutesToDelete);
+  return delta;
+}
+
+} // namespace
+
+TEST(CompactRouteEncoderTest, Prefix) {
+  for (auto const& prefix : {prefix1, prefix2}) {
+    const auto encoded = CompactRouteEncoder::encodePrefix(prefix);
+    EXPECT_EQ(
+        prefix.prefixAddress_ref()->addr_ref()->size() + 1, encoded.size());
+    EXPECT_EQ(prefix, CompactRouteEncoder::decodePrefix(encoded));
+  }
+  EXPECT_THROW(CompactRouteEncoder::decodePrefix(""), thrift::OpenrError);
+  EXPECT_THROW(
+      CompactRouteEncoder::decodePrefix("invalid"), thrift::OpenrError);
+}
+
+TEST(CompactRouteEncoderTest, NextHopGroups) {
+  CompactRouteEncoder encoder;
+
+  // routes sharing next-hops, in any order, share a group
+  auto compact = encoder.encode(createDelta(
+      {createUnicastRoute(prefix1, {nh1, nh2}),
+       createUnicastRoute(prefix2, {nh2, nh1})}));
+  ASSERT_EQ(1, compact.nextHopGroupsToAdd_ref()->size());
+  const auto groupId = compact.nextHopGroupsToAdd_ref()->begin()->first;
+  ASSERT_EQ(2, compact.unicastRoutesToUpdate_ref()->size());
+  for (auto const& route : *compact.unicastRoutesToUpdate_ref()) {
+    EXPECT_EQ(groupId, *route.nextHopGroupId_ref());
+  }
+  EXPECT_EQ(2, encoder.getNumRoutes());
+  EXPECT_EQ(1, encoder.getNumNextHopGroups());
+
+  // existing group is referenced without being sent again
+  compact =
+      encoder.encode(createDelta({createUnicastRoute(prefix3, {nh1, nh2})}));
+  EXPECT_TRUE(compact.nextHopGroupsToAdd_ref()->empty());
+  EXPECT_EQ(
+      groupId,
+      *compact.unicastRoutesToUpdate_ref()->at(0).nextHopGroupId_ref());
+
+  // moving routes to a new group, old one is deleted with its last route
+  compact = encoder.encode(createDelta(
+      {createUnicastRoute(prefix1, {nh1}), createUnicastRoute(prefix2, {nh1})},
+      {prefix3}));
+  ASSERT_EQ(1, compact.nextHopGroupsToAdd_ref()->size());
+  const auto newGroupId = compact.nextHopGroupsToAdd_ref()->begin()->first;
+  EXPECT_NE(groupId, newGroupId);
+  EXPECT_EQ(
+      std::vector<int64_t>{groupId}, *compact.nextHopGroupsToDelete_ref());
+  EXPECT_EQ(
+      std::vector<std::string>{CompactRouteEncoder::encodePrefix(prefix3)},
+      *compact.unicastRoutesToDelete_ref());
+  EXPECT_EQ(2, encoder.getNumRoutes());
+  EXPECT_EQ(1, encoder.getNumNextHopGroups());
+
+  // replayed update changes nothing
+  compact = encoder.encode(createDelta({createUnicastRoute(prefix1, {nh1})}));
+  EXPECT_TRUE(compact.nextHopGroupsToAdd_ref()->empty());
+  EXPECT_TRUE(compact.nextHopGroupsToDelete_ref()->empty());
+
+  // full dump
+  const auto dump = encoder.getFullDump();
+  EXPECT_EQ(1, dump.nextHopGroupsToAdd_ref()->count(newGroupId));
+  EXPECT_EQ(2, dump.unicastRoutesToUpdate_ref()->size());
+  EXPECT_TRUE(dump.nextHopGroupsToDelete_ref()->empty());
+}
+
+TEST(CompactRouteEncoderTest, MplsRoutes) {
+  CompactRouteEncoder encoder;
+
+  thrift::RouteDatabaseDelta delta;
+  delta.unicastRoutesToUpdate_ref() = {createUnicastRoute(prefix1, {nh1})};
+  delta.mplsRoutesToUpdate_ref() = {createMplsRoute(100, {nh1})};
+  auto compact = encoder.encode(delta);
+  EXPECT_EQ(1, compact.nextHopGroupsToAdd_ref()->size());
+  EXPECT_EQ(100, *compact.mplsRoutesToUpdate_ref()->at(0).topLabel_ref());
+
+  delta = thrift::RouteDatabaseDelta();
+  delta.unicastRoutesToDelete_ref() = {prefix1};
+  delta.mplsRoutesToDelete_ref() = {100};
+  compact = encoder.encode(delta);
+  EXPECT_EQ(1, compact.nextHopGroupsToDelete_ref()->size());
+  EXPECT_EQ(0, encoder.getNumRoutes());
+  EXPECT_EQ(0, encoder.getNumNextHopGroups());
+}
+
+TEST(CompactRouteEncoderTest, Coalescer) {
+  CompactRouteEncoder encoder;
+  CompactRouteDeltaCoalescer coalescer;
+  EXPECT_TRUE(coalescer.release().empty());
+
+  auto first =
+      encoder.encode(createDelta({createUnicastRoute(prefix1, {nh1})}));
+  const auto groupId = first.nextHopGroupsToAdd_ref()->begin()->first;
+  coalescer.add(std::move(first));
+  // group created and deleted while coalescing is dropped, route is deleted
+  coalescer.add(encoder.encode(
+      createDelta({createUnicastRoute(prefix2, {nh2})}, {prefix1})));
+  EXPECT_EQ(3, coalescer.size());
+
+  auto released = coalescer.release();
+  ASSERT_EQ(1, released.size());
+  auto const& delta = released.at(0);
+  EXPECT_EQ(1, delta.nextHopGroupsToAdd_ref()->size());
+  EXPECT_EQ(0, delta.nextHopGroupsToAdd_ref()->count(groupId));
+  EXPECT_TRUE(delta.nextHopGroupsToDelete_ref()->empty());
+  EXPECT_EQ(1, delta.unicastRoutesToUpdate_ref()->size());
+  EXPECT_EQ(
+      std::vector<std::string>{CompactRouteEncoder::encodePrefix(prefix1)},
+      *delta.unicastRoutesToDelete_ref());
+  EXPECT_EQ(0, coalescer.size());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  FLAGS_logtostderr = true;
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fb303/ServiceData.h>
+#include <folly/init/Init.h>
+#include <gtest/gtest.h>
+
+#include <openr/ctrl-server/CounterIndex.h>
+
+namespace fb303 = facebook::fb303;
+
+using namespace openr;
+
+TEST(CounterIndexTest, LiteralPrefix) {
+  EXPECT_EQ("", CounterIndex::getLiteralPrefix("kvstore.peers"));
+  EXPECT_EQ("", CounterIndex::getLiteralPrefix("^kvstore|^decision"));
+  EXPECT_EQ("kvstore", CounterIndex::getLiteralPrefix("^kvstore.peers"));
+  EXPECT_EQ(
+      "kvstore.peers.",
+      CounterIndex::getLiteralPrefix("^kvstore\\.peers\\..*"));
+  EXPECT_EQ(
+      "kvstore.peer", CounterIndex::getLiteralPrefix("^kvstore\\.peers?"));
+  EXPECT_EQ("kvstore", CounterIndex::getLiteralPrefix("^kvstore\\d"));
+  EXPECT_EQ("ab", CounterIndex::getLiteralPrefix("^ab+c"));
+  EXPECT_EQ("a", CounterIndex::getLiteralPrefix("^ab{0,2}"));
+}
+
+TEST(CounterIndexTest, RegexCounters) {
+  fb303::fbData->setCounter("test.counter_index.a.one", 1);
+  fb303::fbData->setCounter("test.counter_index.a.two", 2);
+  fb303::fbData->setCounter("test.counter_index.b.one", 3);
+
+  CounterIndex index;
+  using CounterMap = std::map<std::string, int64_t>;
+  EXPECT_EQ(
+      (CounterMap{
+          {"test.counter_index.a.one", 1}, {"test.counter_index.a.two", 2}}),
+      index.getRegexCounters("^test\\.counter_index\\.a\\."));
+  EXPECT_EQ(
+      (CounterMap{
+          {"test.counter_index.a.one", 1}, {"test.counter_index.b.one", 3}}),
+      index.getRegexCounters("counter_index.*one"));
+  EXPECT_TRUE(index.getRegexCounters("^test\\.counter_index\\.c").empty());
+  EXPECT_TRUE(index.getRegexCounters("(invalid").empty());
+
+  // cached names, fresh values
+  fb303::fbData->setCounter("test.counter_index.a.one", 10);
+  EXPECT_EQ(
+      10, index.getRegexCounters("^test\\.counter_index\\.a\\.").at(
+              "test.counter_index.a.one"));
+
+  // new counters show up once names are refreshed
+  fb303::fbData->setCounter("test.counter_index.a.three", 4);
+  EXPECT_EQ(2, index.getRegexCounters("^test\\.counter_index\\.a\\.").size());
+  index.invalidate();
+  EXPECT_EQ(3, index.getRegexCounters("^test\\.counter_index\\.a\\.").size());
+}
+
+TEST(CounterIndexTest, RegexCountersDelta) {
+  fb303::fbData->setCounter("test.counter_index.delta.one", 1);
+  fb303::fbData->setCounter("test.counter_index.delta.two", 2);
+
+  CounterIndex index;
+  const std::string regex{"^test\\.counter_index\\.delta\\."};
+
+  // full dump with default token
+  auto delta = index.getRegexCountersDelta(regex, {});
+  EXPECT_TRUE(*delta.isFullDump_ref());
+  EXPECT_EQ(2, delta.counters_ref()->size());
+  auto token = *delta.token_ref();
+
+  // nothing changed
+  delta = index.getRegexCountersDelta(regex, token);
+  EXPECT_FALSE(*delta.isFullDump_ref());
+  EXPECT_TRUE(delta.counters_ref()->empty());
+
+  // changed counter only, also seen by clients with older tokens
+  fb303::fbData->setCounter("test.counter_index.delta.two", 20);
+  auto const newToken = *delta.token_ref();
+  delta = index.getRegexCountersDelta(regex, newToken);
+  EXPECT_EQ(
+      (std::map<std::string, int64_t>{{"test.counter_index.delta.two", 20}}),
+      *delta.counters_ref());
+  delta = index.getRegexCountersDelta(regex, token);
+  EXPECT_EQ(1, delta.counters_ref()->size());
+
+  // token of another instance
+  token.epoch_ref() = *token.epoch_ref() - 1;
+  delta = index.getRegexCountersDelta(regex, token);
+  EXPECT_TRUE(*delta.isFullDump_ref());
+  EXPECT_EQ(2, delta.counters_ref()->size());
+
+  EXPECT_THROW(
+      index.getRegexCountersDelta("(invalid", {}), thrift::OpenrError);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  FLAGS_logtostderr = true;
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
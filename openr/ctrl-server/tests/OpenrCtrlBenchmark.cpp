@@ -0,0 +1,569 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <fbzmq/zmq/Context.h>
+#include <fmt/format.h>
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/config/Config.h>
+#include <openr/config/tests/Utils.h>
+#include <openr/ctrl-server/OpenrCtrlHandler.h>
+#include <openr/decision/Decision.h>
+#include <openr/fib/Fib.h>
+#include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/messaging/ReplicateQueue.h>
+#include <openr/tests/mocks/PrefixGenerator.h>
+
+DEFINE_uint32(num_kvstore_keys, 500000, "Number of keys in KvStore");
+DEFINE_uint32(num_fib_routes, 300000, "Number of unicast routes in Fib");
+DEFINE_uint32(
+    num_decision_nodes,
+    1000,
+    "Number of nodes in the adjacency ring, their adj keys count in KvStore");
+
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes parameters to another one, with a custom name.
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FOLLY_PP_STRINGIZE(name) "(" FOLLY_PP_STRINGIZE(param_name) ")", \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
+
+namespace {
+// Number of routes updated per Fib delta streamed to subscribers
+const uint32_t kFibDeltaSize = 10;
+// Number of distinct next-hop sets shared by the routes
+const uint32_t kNumNextHopSets = 64;
+const uint8_t kNumNextHops = 16;
+// Size of synthetic KvStore values
+const size_t kValueSize = 64;
+// Number of keys set into KvStore at once while populating it
+const size_t kKvStoreBatchSize = 1000;
+
+} // namespace
+
+namespace openr {
+
+enum class CtrlApi {
+  KVSTORE_ADJ_DUMP,
+  KVSTORE_HASH_DUMP,
+  KVSTORE_AREA_SUMMARY,
+  DECISION_ADJACENCIES,
+  ROUTE_DB,
+};
+
+/**
+ * Stands up OpenrCtrlHandler with KvStore, Decision and Fib populated with
+ * synthetic state. Decision learns a ring of adjacencies from KvStore, which
+ * also holds filler keys. Fib is fed routes directly, in dryrun mode.
+ */
+class CtrlWrapper {
+ public:
+  CtrlWrapper() {
+    // Register Singleton
+    folly::SingletonVault::singleton()->registrationComplete();
+
+    auto tConfig = getBasicOpenrConfig(kNodeName);
+    tConfig.decision_config_ref()->debounce_min_ms_ref() = 10;
+    tConfig.decision_config_ref()->debounce_max_ms_ref() = 500;
+    config = std::make_shared<Config>(tConfig);
+
+    kvStoreWrapper = std::make_unique<KvStoreWrapper>(context, config);
+    kvStoreWrapper->run();
+
+    // Decision routes are not consumed, Fib is fed synthetic routes instead
+    decision = std::make_shared<Decision>(
+        config,
+        true, /* enableBgpRouteProgramming */
+        kvStoreWrapper->getReader(),
+        staticRouteUpdatesQueue.getReader(),
+        decisionRouteUpdatesQueue);
+    decisionThread = std::thread([this]() { decision->run(); });
+    decision->waitUntilRunning();
+
+    fib = std::make_shared<Fib>(
+        config,
+        -1, /* thrift port */
+        std::chrono::seconds(0), /* coldStartDuration */
+        routeUpdatesQueue.getReader(),
+        staticRouteUpdatesQueue.getReader(),
+        fibUpdatesQueue,
+        logSampleQueue);
+    fibThread = std::thread([this]() { fib->run(); });
+    fib->waitUntilRunning();
+
+    handler = std::make_shared<OpenrCtrlHandler>(
+        kNodeName,
+        std::unordered_set<std::string>{} /* acceptable peers */,
+        &ctrlEvb,
+        decision.get(),
+        fib.get(),
+        kvStoreWrapper->getKvStore(),
+        nullptr /* linkMonitor */,
+        nullptr /* monitor */,
+        nullptr /* configStore */,
+        nullptr /* prefixManager */,
+        nullptr /* spark */,
+        config);
+    ctrlEvbThread = std::thread([this]() { ctrlEvb.run(); });
+    ctrlEvb.waitUntilRunning();
+
+    populateKvStore();
+    populateFib();
+  }
+
+  ~CtrlWrapper() {
+    routeUpdatesQueue.close();
+    staticRouteUpdatesQueue.close();
+    decisionRouteUpdatesQueue.close();
+    fibUpdatesQueue.close();
+    logSampleQueue.close();
+    kvStoreWrapper->closeQueue();
+
+    handler.reset();
+    ctrlEvb.stop();
+    ctrlEvb.waitUntilStopped();
+    ctrlEvbThread.join();
+
+    fib->stop();
+    fibThread.join();
+    decision->stop();
+    decisionThread.join();
+    kvStoreWrapper->stop();
+  }
+
+  // Issue one request of given API, blocking until its response
+  void
+  call(CtrlApi api) {
+    switch (api) {
+    case CtrlApi::KVSTORE_ADJ_DUMP: {
+      auto filter = std::make_unique<thrift::KeyDumpParams>();
+      filter->keys_ref() = {Constants::kAdjDbMarker.str()};
+      folly::doNotOptimizeAway(
+          handler
+              ->semifuture_getKvStoreKeyValsFilteredArea(
+                  std::move(filter),
+                  std::make_unique<std::string>(kTestingAreaName))
+              .get());
+      break;
+    }
+    case CtrlApi::KVSTORE_HASH_DUMP: {
+      auto filter = std::make_unique<thrift::KeyDumpParams>();
+      filter->doNotPublishValue_ref() = true;
+      folly::doNotOptimizeAway(
+          handler
+              ->semifuture_getKvStoreKeyValsFilteredArea(
+                  std::move(filter),
+                  std::make_unique<std::string>(kTestingAreaName))
+              .get());
+      break;
+    }
+    case CtrlApi::KVSTORE_AREA_SUMMARY: {
+      folly::doNotOptimizeAway(
+          handler
+              ->semifuture_getKvStoreAreaSummary(
+                  std::make_unique<std::set<std::string>>())
+              .get());
+      break;
+    }
+    case CtrlApi::DECISION_ADJACENCIES: {
+      folly::doNotOptimizeAway(
+          handler
+              ->semifuture_getDecisionAdjacenciesFiltered(
+                  std::make_unique<thrift::AdjacenciesFilter>())
+              .get());
+      break;
+    }
+    case CtrlApi::ROUTE_DB: {
+      folly::doNotOptimizeAway(handler->semifuture_getRouteDb().get());
+      break;
+    }
+    }
+  }
+
+  // Stream a delta of kFibDeltaSize routes to all Fib subscribers
+  void
+  publishFibDelta() {
+    DecisionRouteUpdate routeUpdate;
+    for (uint32_t i = 0; i < kFibDeltaSize; ++i) {
+      const auto network = toIPNetwork(
+          prefixes.at(folly::Random::rand32(prefixes.size())));
+      const auto& nhs =
+          nextHopSets.at(folly::Random::rand32(nextHopSets.size()));
+      routeUpdate.unicastRoutesToUpdate.emplace(
+          network, RibUnicastEntry(network, nhs));
+    }
+    fibUpdatesQueue.push(std::move(routeUpdate));
+  }
+
+  const std::string kNodeName{"node-0"};
+
+  fbzmq::Context context;
+  std::shared_ptr<Config> config;
+
+  messaging::ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue;
+  messaging::ReplicateQueue<DecisionRouteUpdate> staticRouteUpdatesQueue;
+  messaging::ReplicateQueue<DecisionRouteUpdate> decisionRouteUpdatesQueue;
+  messaging::ReplicateQueue<DecisionRouteUpdate> fibUpdatesQueue;
+  messaging::ReplicateQueue<LogSample> logSampleQueue;
+
+  std::unique_ptr<KvStoreWrapper> kvStoreWrapper;
+  std::shared_ptr<Decision> decision;
+  std::thread decisionThread;
+  std::shared_ptr<Fib> fib;
+  std::thread fibThread;
+
+  OpenrEventBase ctrlEvb;
+  std::thread ctrlEvbThread;
+  std::shared_ptr<OpenrCtrlHandler> handler;
+
+  std::vector<thrift::IpPrefix> prefixes;
+  std::vector<std::unordered_set<thrift::NextHopThrift>> nextHopSets;
+
+ private:
+  void
+  populateKvStore() {
+    apache::thrift::CompactSerializer serializer;
+    const auto numNodes = FLAGS_num_decision_nodes;
+
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    auto flush = [&]() {
+      kvStoreWrapper->setKeys(kTestingAreaName, keyVals);
+      keyVals.clear();
+    };
+
+    // ring of nodes, each adjacent to its two neighbors
+    for (uint32_t i = 0; i < numNodes; ++i) {
+      const auto nodeName = fmt::format("node-{}", i);
+      std::vector<thrift::Adjacency> adjs;
+      for (auto j : {(i + 1) % numNodes, (i + numNodes - 1) % numNodes}) {
+        adjs.emplace_back(createAdjacency(
+            fmt::format("node-{}", j),
+            fmt::format("if_{}_{}", i, j),
+            fmt::format("if_{}_{}", j, i),
+            fmt::format("fe80::{:x}", j + 1),
+            fmt::format("10.{}.{}.{}", j >> 16, (j >> 8) & 0xff, j & 0xff),
+            1 /* metric */,
+            0 /* adjLabel */));
+      }
+      keyVals.emplace_back(
+          fmt::format("{}{}", Constants::kAdjDbMarker, nodeName),
+          createThriftValue(
+              1,
+              nodeName,
+              writeThriftObjStr(createAdjDb(nodeName, adjs, 0), serializer)));
+      if (keyVals.size() >= kKvStoreBatchSize) {
+        flush();
+      }
+    }
+
+    // filler keys up to the expected scale
+    const std::string value(kValueSize, 'v');
+    for (uint32_t i = numNodes; i < FLAGS_num_kvstore_keys; ++i) {
+      keyVals.emplace_back(
+          fmt::format("key:{}", i), createThriftValue(1, kNodeName, value));
+      if (keyVals.size() >= kKvStoreBatchSize) {
+        flush();
+      }
+    }
+    flush();
+
+    // wait for Decision to learn all adjacencies
+    while (decision->getDecisionAdjacenciesFiltered({}).get()->size() <
+           numNodes) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    LOG(INFO) << "KvStore populated with " << FLAGS_num_kvstore_keys
+              << " keys, Decision with " << numNodes << " adjacency dbs";
+  }
+
+  void
+  populateFib() {
+    for (uint32_t i = 0; i < kNumNextHopSets; ++i) {
+      auto nhs = PrefixGenerator::getRandomNextHopsUnicast(
+          kNumNextHops, fmt::format("iface_{}", i));
+      nextHopSets.emplace_back(nhs.begin(), nhs.end());
+    }
+    prefixes = PrefixGenerator::ipv6PrefixGenerator(
+        FLAGS_num_fib_routes, 128 /* bitMaskLen */);
+
+    DecisionRouteUpdate routeUpdate;
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+      const auto network = toIPNetwork(prefixes.at(i));
+      routeUpdate.unicastRoutesToUpdate.emplace(
+          network,
+          RibUnicastEntry(network, nextHopSets.at(i % nextHopSets.size())));
+    }
+    routeUpdatesQueue.push(std::move(routeUpdate));
+
+    // randomly generated prefixes may collide
+    const auto numRoutes = prefixes.size();
+    while (fib->getRouteDb().get()->unicastRoutes_ref()->size() <
+           std::min<size_t>(numRoutes, FLAGS_num_fib_routes * 0.99)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    LOG(INFO) << "Fib populated with " << numRoutes << " routes";
+  }
+};
+
+// Created once in main(), populating it at scale is expensive
+std::unique_ptr<CtrlWrapper> ctrlWrapper;
+
+// Record p50/p99/max of latencies, in micro-seconds
+static void
+addLatencyCounters(
+    folly::UserCounters& counters,
+    const std::string& name,
+    std::vector<uint64_t>& latenciesUs) {
+  if (latenciesUs.empty()) {
+    return;
+  }
+  std::sort(latenciesUs.begin(), latenciesUs.end());
+  auto percentile = [&latenciesUs](double p) {
+    return latenciesUs.at(
+        std::min(latenciesUs.size() - 1, size_t(latenciesUs.size() * p)));
+  };
+  counters[name + "_p50_us"] = percentile(0.5);
+  counters[name + "_p99_us"] = percentile(0.99);
+  counters[name + "_max_us"] = latenciesUs.back();
+}
+
+static uint64_t
+elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/**
+ * Benchmark throughput and latency of read API
+ * 1. Split iterations over `numClients` concurrent clients
+ * 2. Each client issues requests back to back
+ * 3. Report aggregate QPS and per-request latency
+ */
+static void
+BM_CtrlReadApi(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    CtrlApi api,
+    unsigned numClients) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::vector<uint64_t>> latenciesUs(numClients);
+  std::vector<std::thread> clients;
+
+  const auto start = std::chrono::steady_clock::now();
+  suspender.dismiss(); // Start measuring benchmark time
+  for (unsigned c = 0; c < numClients; ++c) {
+    clients.emplace_back([&, c]() {
+      for (uint32_t i = c; i < iters; i += numClients) {
+        const auto reqStart = std::chrono::steady_clock::now();
+        ctrlWrapper->call(api);
+        latenciesUs.at(c).emplace_back(elapsedUs(reqStart));
+      }
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  const auto totalUs = std::max<uint64_t>(1, elapsedUs(start));
+  counters["qps"] = uint64_t(iters) * 1000000 / totalUs;
+  std::vector<uint64_t> allLatenciesUs;
+  for (auto& clientLatenciesUs : latenciesUs) {
+    allLatenciesUs.insert(
+        allLatenciesUs.end(),
+        clientLatenciesUs.begin(),
+        clientLatenciesUs.end());
+  }
+  addLatencyCounters(counters, "latency", allLatenciesUs);
+}
+
+/**
+ * Benchmark Fib stream fan-out
+ * 1. Subscribe `numSubscribers` Fib streams, each on its own event base
+ * 2. Publish a route delta from Fib
+ * 3. Wait until all subscribers received it
+ */
+static void
+BM_FibStreamFanout(
+    folly::UserCounters& counters, uint32_t iters, unsigned numSubscribers) {
+  auto suspender = folly::BenchmarkSuspender();
+
+  std::atomic<uint64_t> received{0};
+  std::vector<std::unique_ptr<folly::ScopedEventBaseThread>> evbThreads;
+  std::vector<apache::thrift::ClientStreamSubscription> subscriptions;
+  for (unsigned i = 0; i < numSubscribers; ++i) {
+    evbThreads.emplace_back(std::make_unique<folly::ScopedEventBaseThread>());
+    auto responseAndStream =
+        ctrlWrapper->handler->semifuture_subscribeAndGetFib().get();
+    subscriptions.emplace_back(
+        std::move(responseAndStream.stream)
+            .toClientStreamUnsafeDoNotUse()
+            .subscribeExTry(
+                evbThreads.back()->getEventBase(), [&received](auto&& t) {
+                  if (t.hasValue()) {
+                    ++received;
+                  }
+                }));
+  }
+
+  std::vector<uint64_t> latenciesUs;
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto expected = received.load() + numSubscribers;
+    ctrlWrapper->publishFibDelta();
+    // previous delta was received, hence this one can't be coalesced
+    while (received.load() < expected) {
+      std::this_thread::yield();
+    }
+    latenciesUs.emplace_back(elapsedUs(start));
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  for (auto& subscription : subscriptions) {
+    subscription.cancel();
+    std::move(subscription).detach();
+  }
+  addLatencyCounters(counters, "fanout", latenciesUs);
+}
+
+/**
+ * Benchmark impact of query load on the event bases of owning modules
+ * 1. Start `numClients` clients dumping KvStore and routes in a loop
+ * 2. Measure the time for a no-op to run on KvStore, Decision and Fib
+ *    event bases
+ */
+static void
+BM_ModuleEvbUnderLoad(
+    folly::UserCounters& counters, uint32_t iters, unsigned numClients) {
+  auto suspender = folly::BenchmarkSuspender();
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> clients;
+  for (unsigned c = 0; c < numClients; ++c) {
+    clients.emplace_back([&stop, c]() {
+      const std::vector<CtrlApi> apis{
+          CtrlApi::KVSTORE_HASH_DUMP,
+          CtrlApi::DECISION_ADJACENCIES,
+          CtrlApi::ROUTE_DB};
+      for (size_t i = c; not stop.load(); ++i) {
+        ctrlWrapper->call(apis.at(i % apis.size()));
+      }
+    });
+  }
+
+  std::map<std::string, OpenrEventBase*> modules{
+      {"kvstore", ctrlWrapper->kvStoreWrapper->getKvStore()},
+      {"decision", ctrlWrapper->decision.get()},
+      {"fib", ctrlWrapper->fib.get()},
+  };
+  std::map<std::string, std::vector<uint64_t>> latenciesUs;
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto& [name, module] : modules) {
+      const auto start = std::chrono::steady_clock::now();
+      module->getEvb()->runInEventBaseThreadAndWait([]() noexcept {});
+      latenciesUs[name].emplace_back(elapsedUs(start));
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  stop = true;
+  for (auto& client : clients) {
+    client.join();
+  }
+  for (auto& [name, moduleLatenciesUs] : latenciesUs) {
+    addLatencyCounters(counters, name + "_evb", moduleLatenciesUs);
+  }
+}
+
+// Parameters are the API and the number of concurrent clients
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi, counters, KvStoreAdjDump_1, CtrlApi::KVSTORE_ADJ_DUMP, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi, counters, KvStoreAdjDump_16, CtrlApi::KVSTORE_ADJ_DUMP, 16);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi,
+    counters,
+    KvStoreHashDump_1,
+    CtrlApi::KVSTORE_HASH_DUMP,
+    1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi,
+    counters,
+    KvStoreHashDump_16,
+    CtrlApi::KVSTORE_HASH_DUMP,
+    16);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi,
+    counters,
+    KvStoreAreaSummary_1,
+    CtrlApi::KVSTORE_AREA_SUMMARY,
+    1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi,
+    counters,
+    KvStoreAreaSummary_16,
+    CtrlApi::KVSTORE_AREA_SUMMARY,
+    16);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi,
+    counters,
+    DecisionAdjacencies_1,
+    CtrlApi::DECISION_ADJACENCIES,
+    1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi,
+    counters,
+    DecisionAdjacencies_16,
+    CtrlApi::DECISION_ADJACENCIES,
+    16);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi, counters, RouteDb_1, CtrlApi::ROUTE_DB, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CtrlReadApi, counters, RouteDb_16, CtrlApi::ROUTE_DB, 16);
+
+// The parameter is the number of Fib stream subscribers
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FibStreamFanout, counters, 1, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FibStreamFanout, counters, 10, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_FibStreamFanout, counters, 100, 100);
+
+// The parameter is the number of concurrent clients
+BENCHMARK_COUNTERS_NAME_PARAM(BM_ModuleEvbUnderLoad, counters, 0, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_ModuleEvbUnderLoad, counters, 4, 4);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_ModuleEvbUnderLoad, counters, 16, 16);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  openr::ctrlWrapper = std::make_unique<openr::CtrlWrapper>();
+  folly::runBenchmarks();
+  openr::ctrlWrapper.reset();
+  return 0;
+}
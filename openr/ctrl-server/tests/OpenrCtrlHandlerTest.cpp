@@ -228,7 +228,7 @@ class OpenrCtrlFixture : public ::testing::Test {
 
  private:
   messaging::ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue_;
-  messaging::ReplicateQueue<InterfaceDatabase> interfaceUpdatesQueue_;
+  messaging::ReplicateQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue_;
   messaging::ReplicateQueue<PeerEvent> peerUpdatesQueue_;
   messaging::ReplicateQueue<NeighborEvent> neighborUpdatesQueue_;
   messaging::ReplicateQueue<PrefixEvent> prefixUpdatesQueue_;
@@ -329,6 +329,24 @@ TEST_F(OpenrCtrlFixture, RouteApis) {
     EXPECT_EQ(0, db.mplsRoutes_ref()->size());
   }
 
+  // unchanged route db is served from the response cache
+  {
+    auto getCount = [](std::string const& key) {
+      auto counters = facebook::fb303::fbData->getCounters();
+      auto it = counters.find(fmt::format("ctrl.response_cache.{}.count", key));
+      return it != counters.end() ? it->second : 0;
+    };
+    const auto misses = getCount("route_db.misses");
+    const auto hits = getCount("route_db.hits");
+
+    thrift::RouteDatabase db;
+    client_->sync_getRouteDb(db);
+    EXPECT_EQ(nodeName_, db.thisNodeName_ref());
+    EXPECT_EQ(0, db.unicastRoutes_ref()->size());
+    EXPECT_EQ(misses, getCount("route_db.misses"));
+    EXPECT_EQ(hits + 1, getCount("route_db.hits"));
+  }
+
   {
     thrift::RouteDatabase db;
     client_->sync_getRouteDbComputed(db, nodeName_);
@@ -553,6 +571,19 @@ TEST_F(OpenrCtrlFixture, KvStoreApis) {
     EXPECT_EQ(9, areaKVCountMap[kSpineAreaId]);
     EXPECT_EQ(2, areaKVCountMap[kPodAreaId]);
     EXPECT_EQ(2, areaKVCountMap[kPlaneAreaId]);
+
+    // cached summary is invalidated by new keys
+    thrift::KeyVals newKeyVals;
+    newKeyVals["keyPod3"] =
+        createThriftValue(1, "node1", std::string("valuePod3"));
+    setKvStoreKeyVals(newKeyVals, kPodAreaId);
+    client_->sync_getKvStoreAreaSummary(summary, areaSetAll);
+    EXPECT_THAT(summary, testing::SizeIs(3));
+    for (auto const& areaSummary : summary) {
+      if (areaSummary.get_area() == kPodAreaId) {
+        EXPECT_EQ(3, areaSummary.get_keyValsCount());
+      }
+    }
   }
   //
   // Dual and Flooding APIs
@@ -947,6 +978,8 @@ TEST_F(OpenrCtrlFixture, subscribeAndGetKvStoreFilteredWithKeysNoTtlUpdate) {
     /* There are two clients */
     EXPECT_EQ(2, handler->getNumKvStorePublishers());
     EXPECT_EQ(2, handler_other->getNumKvStorePublishers());
+    /* Both subscribed with the same filter, publications are filtered once */
+    EXPECT_EQ(1, handler->getNumKvStorePublisherGroups());
 
     /* key4 and random_prefix keys are getting added for the first time */
     kvStoreWrapper_->setKey(
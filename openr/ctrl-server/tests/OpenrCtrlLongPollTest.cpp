@@ -305,6 +305,62 @@ TEST_F(LongPollFixture, LongPollAdjExpired) {
   ASSERT_TRUE(isAdjChanged);
 }
 
+TEST_F(LongPollFixture, WatchAdj) {
+  //
+  // This UT verifies the watch API returns the current token right away for
+  // an outdated one, and then waits for the next "adj:" key change.
+  //
+  const std::set<std::string> areas{kTestingAreaName};
+
+  // default token is outdated, get the current one
+  thrift::KvStoreAdjWatchToken token;
+  client1_->sync_watchKvStoreAdj(token, areas, thrift::KvStoreAdjWatchToken());
+  EXPECT_NE(0, *token.epoch_ref());
+  ASSERT_EQ(1, token.generations_ref()->count(kTestingAreaName));
+  const auto generation = token.generations_ref()->at(kTestingAreaName);
+
+  // empty area selection watches all configured areas
+  thrift::KvStoreAdjWatchToken allAreasToken;
+  client1_->sync_watchKvStoreAdj(allAreasToken, {}, token);
+  EXPECT_EQ(token, allAreasToken);
+
+  // mimick there is a new publication from kvstore
+  std::chrono::steady_clock::time_point startTime;
+  testEvb_.scheduleTimeout(std::chrono::milliseconds(1000), [&]() noexcept {
+    // non adj key changes don't answer the watch
+    kvStoreWrapper_->setKey(
+        kTestingAreaName,
+        prefixKey_,
+        createThriftValue(1, nodeName_, std::string("value1")));
+    startTime = std::chrono::steady_clock::now();
+    kvStoreWrapper_->setKey(
+        kTestingAreaName,
+        adjKey_,
+        createThriftValue(1, nodeName_, std::string("value1")));
+    testEvb_.stop();
+  });
+  std::thread evlThread([&]() { testEvb_.run(); });
+  testEvb_.waitUntilRunning();
+
+  thrift::KvStoreAdjWatchToken newToken;
+  client1_->sync_watchKvStoreAdj(newToken, areas, token);
+  const auto endTime = std::chrono::steady_clock::now();
+  ASSERT_LE(endTime - startTime, std::chrono::milliseconds(450));
+  EXPECT_EQ(*token.epoch_ref(), *newToken.epoch_ref());
+  EXPECT_LT(generation, newToken.generations_ref()->at(kTestingAreaName));
+  EXPECT_EQ(
+      0,
+      kvStoreWrapper_->getThriftServerCtrlHandler()->getNumPendingAdjWatches());
+
+  // watch on unknown area
+  EXPECT_THROW(
+      client1_->sync_watchKvStoreAdj(newToken, {"unknown"}, newToken),
+      thrift::OpenrError);
+
+  testEvb_.waitUntilStopped();
+  evlThread.join();
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/ctrl-server/StreamPublisher.h>
+#include <openr/kvstore/KvStorePublisher.h>
+
+using namespace openr;
+
+namespace {
+
+using DeltaStreamPublisher = BufferedStreamPublisher<
+    thrift::RouteDatabaseDelta,
+    RouteDeltaCoalescer<thrift::RouteDatabaseDelta>>;
+
+thrift::RouteDatabaseDelta
+createDelta(
+    std::vector<std::string> const& toUpdate,
+    std::vector<std::string> const& toDelete) {
+  thrift::RouteDatabaseDelta delta;
+  for (auto const& prefix : toUpdate) {
+    delta.unicastRoutesToUpdate_ref()->emplace_back(
+        createUnicastRoute(toIpPrefix(prefix), {}));
+  }
+  for (auto const& prefix : toDelete) {
+    delta.unicastRoutesToDelete_ref()->emplace_back(toIpPrefix(prefix));
+  }
+  return delta;
+}
+
+thrift::CtrlStreamConfig
+createStreamConfig(int32_t maxBufferedUpdates, int32_t maxCoalescedEntries) {
+  thrift::CtrlStreamConfig config;
+  config.max_buffered_updates_ref() = maxBufferedUpdates;
+  config.max_coalesced_entries_ref() = maxCoalescedEntries;
+  return config;
+}
+
+} // namespace
+
+TEST(StreamPublisherTest, RouteDeltaCoalescerTest) {
+  RouteDeltaCoalescer<thrift::RouteDatabaseDelta> coalescer;
+  EXPECT_TRUE(coalescer.release().empty());
+
+  coalescer.add(createDelta({"10.0.0.0/24", "10.0.1.0/24"}, {}));
+  coalescer.add(createDelta({"10.0.2.0/24"}, {"10.0.0.0/24"}));
+  coalescer.add(createDelta({"10.0.1.0/24"}, {}));
+  thrift::RouteDatabaseDelta mplsDelta;
+  mplsDelta.mplsRoutesToUpdate_ref()->emplace_back(createMplsRoute(100, {}));
+  mplsDelta.mplsRoutesToDelete_ref()->emplace_back(200);
+  coalescer.add(std::move(mplsDelta));
+  EXPECT_EQ(5, coalescer.size());
+
+  auto deltas = coalescer.release();
+  EXPECT_EQ(0, coalescer.size());
+  ASSERT_EQ(1, deltas.size());
+  auto const& delta = deltas.at(0);
+  EXPECT_EQ(2, delta.unicastRoutesToUpdate_ref()->size());
+  ASSERT_EQ(1, delta.unicastRoutesToDelete_ref()->size());
+  EXPECT_EQ(
+      toIpPrefix("10.0.0.0/24"), delta.unicastRoutesToDelete_ref()->at(0));
+  ASSERT_EQ(1, delta.mplsRoutesToUpdate_ref()->size());
+  EXPECT_EQ(100, *delta.mplsRoutesToUpdate_ref()->at(0).topLabel_ref());
+  EXPECT_EQ(std::vector<int32_t>{200}, *delta.mplsRoutesToDelete_ref());
+}
+
+TEST(StreamPublisherTest, PublicationCoalescerTest) {
+  PublicationCoalescer coalescer;
+
+  thrift::Publication pub1;
+  pub1.area_ref() = "area1";
+  pub1.keyVals_ref()->emplace("key1", createThriftValue(1, "node1", "v1"));
+  pub1.keyVals_ref()->emplace("key2", createThriftValue(1, "node1", "v2"));
+  coalescer.add(std::move(pub1));
+
+  // TTL update of key1 keeps its value, key2 expires
+  thrift::Publication pub2;
+  pub2.area_ref() = "area1";
+  auto ttlUpdate = createThriftValue(1, "node1", std::nullopt, 500, 2);
+  pub2.keyVals_ref()->emplace("key1", ttlUpdate);
+  pub2.expiredKeys_ref()->emplace_back("key2");
+  coalescer.add(std::move(pub2));
+
+  thrift::Publication pub3;
+  pub3.area_ref() = "area2";
+  pub3.keyVals_ref()->emplace("key1", createThriftValue(1, "node2", "v3"));
+  coalescer.add(std::move(pub3));
+  EXPECT_EQ(3, coalescer.size());
+
+  auto pubs = coalescer.release();
+  EXPECT_EQ(0, coalescer.size());
+  ASSERT_EQ(2, pubs.size());
+  EXPECT_EQ("area1", *pubs.at(0).area_ref());
+  ASSERT_EQ(1, pubs.at(0).keyVals_ref()->count("key1"));
+  auto const& value = pubs.at(0).keyVals_ref()->at("key1");
+  EXPECT_EQ("v1", value.value_ref().value());
+  EXPECT_EQ(500, *value.ttl_ref());
+  EXPECT_EQ(2, *value.ttlVersion_ref());
+  EXPECT_EQ(
+      std::vector<std::string>{"key2"}, *pubs.at(0).expiredKeys_ref());
+  EXPECT_EQ("area2", *pubs.at(1).area_ref());
+  EXPECT_EQ(1, pubs.at(1).keyVals_ref()->size());
+}
+
+#if FOLLY_HAS_COROUTINES
+/**
+ * Updates not pulled by the client are buffered, then coalesced, until the
+ * subscriber is disconnected
+ */
+TEST(StreamPublisherTest, SlowSubscriberTest) {
+  bool completed{false};
+  auto streamAndPublisher = DeltaStreamPublisher::create(
+      "test", createStreamConfig(2, 3), [&completed]() { completed = true; });
+  auto& publisher = streamAndPublisher.second;
+
+  publisher.next(createDelta({"10.0.0.0/24"}, {}));
+  publisher.next(createDelta({"10.0.1.0/24"}, {}));
+  EXPECT_EQ(2, publisher.getLag());
+
+  // buffer is full, coalesce
+  publisher.next(createDelta({"10.0.2.0/24"}, {}));
+  publisher.next(createDelta({"10.0.2.0/24", "10.0.3.0/24"}, {}));
+  EXPECT_EQ(4, publisher.getLag());
+  EXPECT_FALSE(publisher.isCompleted());
+
+  // too many coalesced routes, disconnect
+  publisher.next(createDelta({"10.0.4.0/24", "10.0.5.0/24"}, {}));
+  EXPECT_TRUE(publisher.isCompleted());
+  EXPECT_EQ(0, publisher.getLag());
+
+  // stream is released, generator is destroyed
+  EXPECT_FALSE(completed);
+  {
+    auto stream = std::move(streamAndPublisher.first);
+  }
+  EXPECT_TRUE(completed);
+}
+
+/**
+ * Client receives buffered updates in order, then coalesced updates, then the
+ * stream completion
+ */
+TEST(StreamPublisherTest, ConsumeTest) {
+  auto streamAndPublisher =
+      DeltaStreamPublisher::create("test", createStreamConfig(2, 100), []() {});
+  auto& publisher = streamAndPublisher.second;
+
+  publisher.next(createDelta({"10.0.0.0/24"}, {}));
+  publisher.next(createDelta({"10.0.1.0/24"}, {}));
+  publisher.next(createDelta({"10.0.2.0/24"}, {}));
+  publisher.next(createDelta({}, {"10.0.2.0/24"}));
+  publisher.complete();
+
+  std::vector<thrift::RouteDatabaseDelta> received;
+  bool streamCompleted{false};
+  auto subscription =
+      std::move(streamAndPublisher.first)
+          .toClientStreamUnsafeDoNotUse()
+          .subscribeExTry(folly::getEventBase(), [&](auto&& t) {
+            if (t.hasValue()) {
+              received.emplace_back(std::move(*t));
+            } else if (not t.hasException()) {
+              streamCompleted = true;
+            }
+          });
+  std::move(subscription).join();
+
+  EXPECT_TRUE(streamCompleted);
+  ASSERT_EQ(3, received.size());
+  EXPECT_EQ(createDelta({"10.0.0.0/24"}, {}), received.at(0));
+  EXPECT_EQ(createDelta({"10.0.1.0/24"}, {}), received.at(1));
+  // coalesced add and delete of 10.0.2.0/24
+  EXPECT_EQ(createDelta({}, {"10.0.2.0/24"}), received.at(2));
+}
+#endif
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  FLAGS_logtostderr = true;
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -18,6 +18,7 @@
 #include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/String.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #ifndef NO_FOLLY_EXCEPTION_TRACER
 #include <folly/experimental/exception_tracer/ExceptionTracer.h>
@@ -38,6 +39,23 @@ using folly::gen::mapped;
 
 namespace openr {
 
+namespace {
+
+const std::string kRouteDbSnapshotKey{"decision-route-db-snapshot"};
+
+// fingerprint of best prefix entry of route, computed if route has none
+uint64_t
+getFingerprint(RibUnicastEntry const& entry) {
+  if (entry.fingerprint) {
+    return entry.fingerprint;
+  }
+  auto copy = entry;
+  copy.updateFingerprint();
+  return copy.fingerprint;
+}
+
+} // namespace
+
 namespace detail {
 
 void
@@ -45,11 +63,26 @@ DecisionPendingUpdates::applyLinkStateChange(
     std::string const& nodeName,
     LinkState::LinkStateChange const& change,
     apache::thrift::optional_field_ref<thrift::PerfEvents const&> perfEvents) {
+  bool const isLocal = nodeName == myNodeName_;
+  // draining ourselves or our links only moves routes over the drained
+  // elements, it doesn't change nexthop addresses or labels
+  bool const isLocalDrain =
+      isLocal && change.onlyDrainChanged && !change.linkAttributesChanged;
   needsFullRebuild_ |=
-      (change.topologyChanged || change.nodeLabelChanged ||
-       // we only need a full rebuild if link attributes change locally
-       // this would be a nexthop or link label change
-       (change.linkAttributesChanged && nodeName == myNodeName_));
+      (change.nodeLabelChanged ||
+       // we only need a full rebuild if topology or link attributes change
+       // locally. this would be a nexthop or link label change
+       (((change.topologyChanged && !isLocalDrain) ||
+         change.linkAttributesChanged) &&
+        isLocal));
+  // remote topology changes and local drains only affect routes towards
+  // nodes whose shortest paths changed, Decision scopes the rebuild to those
+  if (change.topologyChanged && (not isLocal || isLocalDrain)) {
+    topologyChangedNodes_.insert(nodeName);
+  }
+  localDrainChanged_ |= isLocalDrain;
+  remoteLinkAttributesChanged_ |= trackRemoteLinkAttributes_ &&
+      change.linkAttributesChanged && not isLocal;
   addUpdate(perfEvents);
 }
 
@@ -66,7 +99,10 @@ DecisionPendingUpdates::reset() {
   count_ = 0;
   perfEvents_ = std::nullopt;
   needsFullRebuild_ = false;
+  localDrainChanged_ = false;
+  remoteLinkAttributesChanged_ = false;
   updatedPrefixes_.clear();
+  topologyChangedNodes_.clear();
 }
 
 void
@@ -76,6 +112,29 @@ DecisionPendingUpdates::addEvent(std::string const& eventDescription) {
   }
 }
 
+void
+DecisionPendingUpdates::addTrace(thrift::PerfEvents const& trace) {
+  if (not perfEvents_ or perfEvents_->traceId_ref().has_value()) {
+    return;
+  }
+  mergePerfTrace(*perfEvents_, trace);
+  startSpan(Constants::kPerfSpanDecisionDebounce);
+}
+
+void
+DecisionPendingUpdates::startSpan(folly::StringPiece stage) {
+  if (perfEvents_) {
+    startPerfSpan(*perfEvents_, myNodeName_, stage);
+  }
+}
+
+void
+DecisionPendingUpdates::endSpan(folly::StringPiece stage) {
+  if (perfEvents_) {
+    endPerfSpan(*perfEvents_, myNodeName_, stage);
+  }
+}
+
 std::optional<thrift::PerfEvents>
 DecisionPendingUpdates::moveOutEvents() {
   std::optional<thrift::PerfEvents> events = std::move(perfEvents_);
@@ -97,7 +156,12 @@ DecisionPendingUpdates::addUpdate(
            *perfEvents->events_ref()->front().unixTs_ref())) {
     // if we don't have any perf events for this batch and this update also
     // doesn't have anything, let's start building the event list from now
-    perfEvents_ = perfEvents ? *perfEvents : thrift::PerfEvents{};
+    auto newPerfEvents = perfEvents ? *perfEvents : thrift::PerfEvents{};
+    // keep trace of the batch
+    if (perfEvents_) {
+      mergePerfTrace(newPerfEvents, *perfEvents_);
+    }
+    perfEvents_ = std::move(newPerfEvents);
     addPerfEvent(*perfEvents_, myNodeName_, "DECISION_RECEIVED");
   }
 }
@@ -115,7 +179,8 @@ Decision::Decision(
     messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue,
     messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue,
     // producer queue
-    messaging::ReplicateQueue<DecisionRouteUpdate>& routeUpdatesQueue)
+    messaging::ReplicateQueue<DecisionRouteUpdate>& routeUpdatesQueue,
+    PersistentStore* configStore)
     : config_(config),
       routeUpdatesQueue_(routeUpdatesQueue),
       myNodeName_(*config->getConfig().node_name_ref()),
@@ -128,7 +193,11 @@ Decision::Decision(
           std::chrono::milliseconds(*config->getConfig()
                                          .decision_config_ref()
                                          ->debounce_max_ms_ref()),
-          [this]() noexcept { rebuildRoutes("DECISION_DEBOUNCE"); }) {
+          [this]() noexcept {
+            profileCallback("rebuild_routes", [&]() {
+              rebuildRoutes("DECISION_DEBOUNCE");
+            });
+          }) {
   spfSolver_ = std::make_unique<SpfSolver>(
       config->getNodeName(),
       config->isV4Enabled(),
@@ -136,7 +205,58 @@ Decision::Decision(
       config->isAdjacencyLabelsEnabled(),
       enableBgpRouteProgramming,
       config->isBestRouteSelectionEnabled(),
-      config->isV4OverV6NexthopEnabled());
+      config->isV4OverV6NexthopEnabled(),
+      *config->getConfig().decision_config_ref()->route_build_threads_ref(),
+      *config->getConfig().decision_config_ref()->enable_lfa_ref(),
+      *config->getConfig().decision_config_ref()->enable_ucmp_ref(),
+      *config->getConfig().decision_config_ref()->sr_policies_ref());
+  if (spfSolver_->getSrPolicySolver()) {
+    pendingUpdates_.setTrackRemoteLinkAttributes();
+  }
+
+  const auto decodeThreads = *config->getConfig()
+                                  .decision_config_ref()
+                                  ->publication_decode_threads_ref();
+  if (decodeThreads > 1) {
+    decodePool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        decodeThreads,
+        std::make_shared<folly::NamedThreadFactory>("DecisionDecode"));
+  }
+
+  enableRouteUpdateLanes_ = *config->getConfig()
+                                 .decision_config_ref()
+                                 ->enable_route_update_lanes_ref();
+
+  if (*config->getConfig()
+           .decision_config_ref()
+           ->enable_adaptive_debounce_ref()) {
+    adaptiveRebuildDebounced_ = std::make_unique<AdaptiveDebounce>(
+        getEvb(),
+        std::chrono::milliseconds(
+            *config->getConfig().decision_config_ref()->debounce_min_ms_ref()),
+        std::chrono::milliseconds(
+            *config->getConfig().decision_config_ref()->debounce_max_ms_ref()),
+        [this]() noexcept {
+          auto const& batch = adaptiveRebuildDebounced_->getBatch();
+          VLOG(2) << "Decision: adaptive debounce of " << batch.numEvents
+                  << " updates over " << batch.waited.count() << "ms"
+                  << (batch.immediate ? ", immediate" : "");
+          pendingUpdates_.addEvent(
+              batch.immediate ? "ADAPTIVE_DEBOUNCE_IMMEDIATE"
+                              : "ADAPTIVE_DEBOUNCE_EXTENDED");
+          fb303::fbData->addStatValue(
+              "decision.adaptive_debounce.window_ms",
+              batch.waited.count(),
+              fb303::AVG);
+          fb303::fbData->addStatValue(
+              "decision.adaptive_debounce.batch_size",
+              batch.numEvents,
+              fb303::AVG);
+          profileCallback("rebuild_routes", [&]() {
+            rebuildRoutes("DECISION_DEBOUNCE");
+          });
+        });
+  }
 
   coldStartTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
     pendingUpdates_.setNeedsFullRebuild();
@@ -146,6 +266,20 @@ Decision::Decision(
     coldStartTimer_->scheduleTimeout(std::chrono::seconds(*eor));
   }
 
+  // Warm start relies on the full route rebuild at the end of cold start to
+  // replace the routes of the snapshot
+  if (configStore and
+      *config->getConfig().decision_config_ref()->enable_warm_start_ref()) {
+    if (coldStartTimer_->isScheduled()) {
+      configStore_ = configStore;
+      persistRouteDbTimer_ = folly::AsyncTimeout::make(
+          *getEvb(), [this]() noexcept { persistRouteDbSnapshot(); });
+      loadRouteDbSnapshot();
+    } else {
+      LOG(WARNING) << "Decision warm start requires eor_time_s, disabled";
+    }
+  }
+
   // Schedule periodic timer for counter submission
   counterUpdateTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
     updateGlobalCounters();
@@ -154,37 +288,34 @@ Decision::Decision(
   });
   counterUpdateTimer_->scheduleTimeout(Constants::kCounterSubmitInterval);
 
-  // Add reader to process publication from KvStore
+  // Schedule periodic full route rebuild
+  fullRebuildTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+    pendingUpdates_.setNeedsFullRebuild();
+    rebuildRoutes("PERIODIC_FULL_REBUILD");
+    fullRebuildTimer_->scheduleTimeout(Constants::kDecisionFullRebuildInterval);
+  });
+  fullRebuildTimer_->scheduleTimeout(Constants::kDecisionFullRebuildInterval);
+
+  // Add readers to process publication from KvStore and static routes
+  // publication from prefix-manager
+#if FOLLY_HAS_COROUTINES
+  addCoroTask(processKvStoreUpdates(std::move(kvStoreUpdatesQueue)));
+  addCoroTask(processStaticRouteUpdates(std::move(staticRouteUpdatesQueue)));
+#else
   addFiberTask([q = std::move(kvStoreUpdatesQueue), this]() mutable noexcept {
     LOG(INFO) << "Starting KvStore updates processing fiber";
     while (true) {
-      auto maybeThriftPub = q.get(); // perform read
-      VLOG(2) << "Received KvStore update";
-      if (maybeThriftPub.hasError()) {
+      // perform read, along with publications pending meanwhile
+      auto maybeThriftPubs =
+          q.getBatch(Constants::kDecisionMaxPublicationBatch);
+      if (maybeThriftPubs.hasError()) {
         LOG(INFO) << "Terminating KvStore updates processing fiber";
         break;
       }
-      try {
-        processPublication(std::move(maybeThriftPub).value());
-      } catch (const std::exception& e) {
-#ifndef NO_FOLLY_EXCEPTION_TRACER
-        // collect stack strace then fail the process
-        for (auto& exInfo : folly::exception_tracer::getCurrentExceptions()) {
-          LOG(ERROR) << exInfo;
-        }
-#endif
-        // FATAL to produce core dump
-        LOG(FATAL) << "Exception occured in Decision::processPublication - "
-                   << folly::exceptionStr(e);
-      }
-      // compute routes with exponential backoff timer if needed
-      if (pendingUpdates_.needsRouteUpdate()) {
-        rebuildRoutesDebounced_();
-      }
+      processPublications(std::move(maybeThriftPubs).value());
     }
   });
 
-  // Add reader to process static routes publication from prefix-manager
   addFiberTask(
       [q = std::move(staticRouteUpdatesQueue), this]() mutable noexcept {
         LOG(INFO) << "Starting static routes update processing fiber";
@@ -198,17 +329,54 @@ Decision::Decision(
           processStaticRoutesUpdate(std::move(maybeThriftPub).value());
         }
       });
+#endif
+
+  if (auto dampConf = config->getConfig()
+                          .decision_config_ref()
+                          ->prefix_dampening_config_ref()) {
+    prefixDampener_ = std::make_unique<PrefixDampener>(*dampConf);
+    prefixReuseTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+      std::unordered_set<folly::CIDRNetwork> reused;
+      for (auto const& [prefix, type] : prefixDampener_->reuse()) {
+        fb303::fbData->addStatValue(
+            fmt::format(
+                "decision.prefix_dampening.reuses.{}",
+                apache::thrift::util::enumNameSafe(type)),
+            1,
+            fb303::SUM);
+        reused.emplace(prefix);
+      }
+      if (not reused.empty()) {
+        LOG(INFO) << "Reusing routes of " << reused.size()
+                  << " dampened prefixes";
+        pendingUpdates_.applyPrefixStateChange(
+            std::move(reused),
+            thrift::PrefixDatabase().perfEvents_ref()); // Empty perf events
+        scheduleRebuildRoutes();
+      }
+      schedulePrefixReuse();
+    });
+  }
 
   // Create RibPolicy timer to process routes on policy expiry
   ribPolicyTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
     LOG(WARNING) << "RibPolicy is expired";
-    pendingUpdates_.setNeedsFullRebuild();
+    updateRibPolicy(ribPolicy_.get(), nullptr);
     rebuildRoutes("RIB_POLICY_EXPIRED");
   });
 
+  // Readers always find a snapshot, even before the first publication
+  publishSnapshot();
+
   // Initialize some stat keys
   fb303::fbData->addStatExportType(
       "decision.rib_policy_processing.time_ms", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "decision.topology_scoped_rebuild_runs", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "decision.topology_scoped_rebuild_prefixes", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "decision.periodic_full_rebuild_mismatch", fb303::COUNT);
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
@@ -221,6 +389,9 @@ Decision::getDecisionRouteDb(std::string nodeName) {
     if (nodeName.empty()) {
       nodeName = myNodeName_;
     }
+    if (nodeName == myNodeName_) {
+      updateReachableNodes();
+    }
     auto maybeRouteDb =
         spfSolver_->buildRouteDb(nodeName, areaLinkStates_, prefixState_);
     if (maybeRouteDb.has_value()) {
@@ -235,64 +406,109 @@ Decision::getDecisionRouteDb(std::string nodeName) {
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::AdjacencyDatabase>>>
 Decision::getDecisionAdjacenciesFiltered(thrift::AdjacenciesFilter filter) {
-  folly::Promise<std::unique_ptr<std::vector<thrift::AdjacencyDatabase>>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread(
-      [p = std::move(p), filter = std::move(filter), this]() mutable {
-        auto res = std::make_unique<std::vector<thrift::AdjacencyDatabase>>();
-        for (auto const& [area, linkState] : areaLinkStates_) {
-          if (filter.get_selectAreas().empty() ||
-              filter.get_selectAreas().count(area)) {
-            for (auto const& [_, db] : linkState.getAdjacencyDatabases()) {
-              res->push_back(db);
-            }
-          }
-        }
-        p.setValue(std::move(res));
-      });
-  return sf;
+  auto const snapshot = snapshot_.load();
+  auto res = std::make_unique<std::vector<thrift::AdjacencyDatabase>>();
+  for (auto const& [area, adjDbs] : snapshot->adjacencyDbs) {
+    if (filter.get_selectAreas().empty() ||
+        filter.get_selectAreas().count(area)) {
+      for (auto const& adjDb : *adjDbs) {
+        res->emplace_back(
+            readThriftObjStr<thrift::AdjacencyDatabase>(*adjDb, serializer_));
+      }
+    }
+  }
+  return folly::makeSemiFuture(std::move(res));
+}
+
+int64_t
+Decision::getAdjacencyDbsVersion() const {
+  return snapshot_.load()->adjacencyDbsVersion;
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::ReceivedRouteDetail>>>
 Decision::getReceivedRoutesFiltered(thrift::ReceivedRouteFilter filter) {
+  auto const snapshot = snapshot_.load();
   auto [p, sf] = folly::makePromiseContract<
       std::unique_ptr<std::vector<thrift::ReceivedRouteDetail>>>();
-  runInEventBaseThread(
-      [this, p = std::move(p), filter = std::move(filter)]() mutable noexcept {
-        try {
-          // Get route details
-          auto routes = prefixState_.getReceivedRoutesFiltered(filter);
-
-          // Add best path result to this
-          auto const& bestRoutesCache = spfSolver_->getBestRoutesCache();
-          for (auto& route : routes) {
-            auto const& bestRoutesIt =
-                bestRoutesCache.find(toIPNetwork(*route.prefix_ref()));
-            if (bestRoutesIt != bestRoutesCache.end()) {
-              auto const& bestRoutes = bestRoutesIt->second;
-              // Set all selected node-area
-              for (auto const& [node, area] : bestRoutes.allNodeAreas) {
-                route.bestKeys_ref()->emplace_back();
-                auto& key = route.bestKeys_ref()->back();
-                key.node_ref() = node;
-                key.area_ref() = area;
-              }
-              // Set best node-area
-              route.bestKey_ref()->node_ref() = bestRoutes.bestNodeArea.first;
-              route.bestKey_ref()->area_ref() = bestRoutes.bestNodeArea.second;
-            }
-          }
+  try {
+    // Get route details
+    auto routes = snapshot->prefixState->getReceivedRoutesFiltered(filter);
 
-          // Set the promise
-          p.setValue(std::make_unique<std::vector<thrift::ReceivedRouteDetail>>(
-              std::move(routes)));
-        } catch (const thrift::OpenrError& e) {
-          p.setException(e);
-        }
-      });
+    // Add best path result to this
+    addBestRoutes(routes, *snapshot->bestRoutesCache);
+
+    // Set the promise
+    p.setValue(std::make_unique<std::vector<thrift::ReceivedRouteDetail>>(
+        std::move(routes)));
+  } catch (const thrift::OpenrError& e) {
+    p.setException(e);
+  }
+  return std::move(sf);
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::ReceivedRoutesPage>>
+Decision::getReceivedRoutesFilteredPage(
+    thrift::ReceivedRouteFilter filter, thrift::PageParams page) {
+  auto const snapshot = snapshot_.load();
+  auto [p, sf] =
+      folly::makePromiseContract<std::unique_ptr<thrift::ReceivedRoutesPage>>();
+  try {
+    auto thriftPage =
+        snapshot->prefixState->getReceivedRoutesFilteredPage(filter, page);
+    addBestRoutes(*thriftPage.routes_ref(), *snapshot->bestRoutesCache);
+    p.setValue(
+        std::make_unique<thrift::ReceivedRoutesPage>(std::move(thriftPage)));
+  } catch (const thrift::OpenrError& e) {
+    p.setException(e);
+  }
   return std::move(sf);
 }
 
+void
+Decision::fillBestRoutes(
+    std::vector<thrift::UnicastRouteDetail>& routes) const {
+  auto const snapshot = snapshot_.load();
+  auto const& prefixes = snapshot->prefixState->prefixes();
+  auto const& bestRoutesCache = *snapshot->bestRoutesCache;
+  for (auto& route : routes) {
+    auto const prefix = toIPNetwork(*route.unicastRoute_ref()->dest_ref());
+    auto const bestRoutesIt = bestRoutesCache.find(prefix);
+    auto const prefixIt = prefixes.find(prefix);
+    if (bestRoutesIt == bestRoutesCache.end() or prefixIt == prefixes.end()) {
+      continue;
+    }
+    // same best prefix entry the route was computed from
+    auto const entryIt =
+        prefixIt->second.find(bestRoutesIt->second.bestNodeArea);
+    if (entryIt != prefixIt->second.end()) {
+      route.bestRoute_ref() = *entryIt->second;
+    }
+  }
+}
+
+void
+Decision::addBestRoutes(
+    std::vector<thrift::ReceivedRouteDetail>& routes,
+    BestRoutesCache const& bestRoutesCache) {
+  for (auto& route : routes) {
+    auto const& bestRoutesIt =
+        bestRoutesCache.find(toIPNetwork(*route.prefix_ref()));
+    if (bestRoutesIt != bestRoutesCache.end()) {
+      auto const& bestRoutes = bestRoutesIt->second;
+      // Set all selected node-area
+      for (auto const& [node, area] : bestRoutes.allNodeAreas) {
+        route.bestKeys_ref()->emplace_back();
+        auto& key = route.bestKeys_ref()->back();
+        key.node_ref() = node;
+        key.area_ref() = area;
+      }
+      // Set best node-area
+      route.bestKey_ref()->node_ref() = bestRoutes.bestNodeArea.first;
+      route.bestKey_ref()->area_ref() = bestRoutes.bestNodeArea.second;
+    }
+  }
+}
+
 folly::SemiFuture<folly::Unit>
 Decision::clearRibPolicy() {
   auto [p, sf] = folly::makePromiseContract<folly::Unit>();
@@ -309,9 +525,9 @@ Decision::clearRibPolicy() {
       error.message_ref() = "No RIB policy configured";
       p.setException(error);
     } else {
-      ribPolicy_ = nullptr;
       // Trigger route computation
-      pendingUpdates_.setNeedsFullRebuild();
+      updateRibPolicy(ribPolicy_.get(), nullptr);
+      ribPolicy_ = nullptr;
       rebuildRoutes("RIB_POLICY_CLEARED");
       p.setValue();
     }
@@ -351,13 +567,13 @@ Decision::setRibPolicy(thrift::RibPolicy const& ribPolicyThrift) {
         // Update local policy instance
         LOG(INFO) << "Updating RibPolicy with new instance. Validity "
                   << durationLeft.count() << "ms";
+        updateRibPolicy(ribPolicy_.get(), ribPolicy.get());
         ribPolicy_ = std::move(ribPolicy);
 
         // Schedule timer for processing routes on expiry
         ribPolicyTimer_->scheduleTimeout(durationLeft);
 
         // Trigger route computation
-        pendingUpdates_.setNeedsFullRebuild();
         rebuildRoutes("RIB_POLICY_UPDATE");
 
         // Mark the policy update request to be done
@@ -366,6 +582,18 @@ Decision::setRibPolicy(thrift::RibPolicy const& ribPolicyThrift) {
   return std::move(sf);
 }
 
+void
+Decision::updateRibPolicy(
+    RibPolicy const* oldPolicy, RibPolicy const* newPolicy) {
+  auto affected = RibPolicy::getAffectedPrefixes(
+      oldPolicy, newPolicy, routeDb_.unicastRoutes);
+  LOG(INFO) << "RibPolicy change affects " << affected.size() << " of "
+            << routeDb_.unicastRoutes.size() << " routes";
+  fb303::fbData->addStatValue(
+      "decision.rib_policy.affected_routes", affected.size(), fb303::AVG);
+  ribPolicyChangedPrefixes_.merge(affected);
+}
+
 folly::SemiFuture<thrift::RibPolicy>
 Decision::getRibPolicy() {
   auto [p, sf] = folly::makePromiseContract<thrift::RibPolicy>();
@@ -388,8 +616,185 @@ Decision::getRibPolicy() {
   return std::move(sf);
 }
 
+#if FOLLY_HAS_COROUTINES
+folly::coro::Task<void>
+Decision::processKvStoreUpdates(
+    messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue) {
+  LOG(INFO) << "Starting KvStore updates processing task";
+  while (true) {
+    // perform read, along with publications pending meanwhile
+    auto maybeThriftPubs = co_await kvStoreUpdatesQueue.getBatchCoro(
+        Constants::kDecisionMaxPublicationBatch);
+    if (maybeThriftPubs.hasError()) {
+      LOG(INFO) << "Terminating KvStore updates processing task";
+      break;
+    }
+    processPublications(std::move(maybeThriftPubs).value());
+  }
+}
+
+folly::coro::Task<void>
+Decision::processStaticRouteUpdates(
+    messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue) {
+  LOG(INFO) << "Starting static routes update processing task";
+  while (true) {
+    auto maybeThriftPub = co_await staticRouteUpdatesQueue.getCoro();
+    VLOG(2) << "Received static routes update";
+    if (maybeThriftPub.hasError()) {
+      LOG(INFO) << "Terminating static routes update processing task";
+      break;
+    }
+    processStaticRoutesUpdate(std::move(maybeThriftPub).value());
+  }
+}
+#endif
+
+void
+Decision::processPublications(std::vector<thrift::Publication>&& thriftPubs) {
+  VLOG(2) << "Received " << thriftPubs.size() << " KvStore updates";
+  try {
+    auto startTime = std::chrono::steady_clock::now();
+    auto decodedPubs = decodePublications(thriftPubs);
+    fb303::fbData->addStatValue(
+        "decision.publication_decode_ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count(),
+        fb303::AVG);
+
+    startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < thriftPubs.size(); ++i) {
+      profileCallback("process_publication", [&]() {
+        processPublication(
+            std::move(thriftPubs.at(i)), std::move(decodedPubs.at(i)));
+      });
+    }
+    fb303::fbData->addStatValue(
+        "decision.publication_apply_ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count(),
+        fb303::AVG);
+  } catch (const std::exception& e) {
+#ifndef NO_FOLLY_EXCEPTION_TRACER
+    // collect stack strace then fail the process
+    for (auto& exInfo : folly::exception_tracer::getCurrentExceptions()) {
+      LOG(ERROR) << exInfo;
+    }
+#endif
+    // FATAL to produce core dump
+    LOG(FATAL) << "Exception occured in Decision::processPublication - "
+               << folly::exceptionStr(e);
+  }
+  // compute routes with exponential backoff timer if needed. Snapshot is
+  // published by the rebuild, otherwise right away
+  if (pendingUpdates_.needsRouteUpdate()) {
+    scheduleRebuildRoutes();
+  } else {
+    publishSnapshot();
+  }
+}
+
+std::vector<Decision::DecodedValues>
+Decision::decodePublications(
+    std::vector<thrift::Publication> const& thriftPubs) {
+  // values to decode, along with slot to decode them into
+  std::vector<std::tuple<std::string const*, std::string const*, DecodedValue*>>
+      values;
+  std::vector<DecodedValues> decodedPubs(thriftPubs.size());
+  for (size_t i = 0; i < thriftPubs.size(); ++i) {
+    auto const& keyVals = *thriftPubs.at(i).keyVals_ref();
+    auto& decodedValues = decodedPubs.at(i);
+    decodedValues.resize(keyVals.size());
+    auto const* adjDbDigests =
+        folly::get_ptr(adjDbDigests_, *thriftPubs.at(i).area_ref());
+    size_t j = 0;
+    for (auto const& [key, rawVal] : keyVals) {
+      auto& decoded = decodedValues.at(j++);
+      if (not rawVal.value_ref().has_value()) {
+        continue;
+      }
+      auto const& value = rawVal.value_ref().value();
+      if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+        // ATTN: checked again when applied, as publications of the batch
+        //       applied before may change the digest
+        decoded.rawHash = std::hash<std::string>{}(value);
+        auto const* digest =
+            adjDbDigests ? folly::get_ptr(*adjDbDigests, key) : nullptr;
+        if (digest and digest->rawHash == decoded.rawHash) {
+          decoded.unchanged = true;
+          continue;
+        }
+      }
+      values.emplace_back(&key, &value, &decoded);
+    }
+  }
+
+  auto decodeRange = [this, &values](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      auto const& [key, value, decoded] = values.at(i);
+      decodeValue(*key, *value, *decoded);
+    }
+  };
+
+  if (not decodePool_ or
+      values.size() < Constants::kDecisionParallelDecodeMinValues) {
+    decodeRange(0, values.size());
+    return decodedPubs;
+  }
+
+  auto const numShards = std::min<size_t>(
+      decodePool_->numThreads(),
+      values.size() / Constants::kDecisionParallelDecodeMinValues + 1);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numShards);
+  for (size_t i = 0; i < numShards; ++i) {
+    auto const begin = values.size() * i / numShards;
+    auto const end = values.size() * (i + 1) / numShards;
+    futures.emplace_back(folly::via(
+        folly::getKeepAliveToken(decodePool_.get()),
+        [&decodeRange, begin, end]() { decodeRange(begin, end); }));
+  }
+  // rethrows the first failure, if any
+  folly::collect(futures).get();
+  return decodedPubs;
+}
+
 void
-Decision::processPublication(thrift::Publication&& thriftPub) {
+Decision::decodeValue(
+    std::string const& key,
+    std::string const& value,
+    DecodedValue& decoded) const {
+  // ATTN: CompactSerializer is stateless, hence safe to share across threads
+  try {
+    if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+      decoded.adjacencyDb =
+          readThriftObjStr<thrift::AdjacencyDatabase>(value, serializer_);
+
+      // hash over fields LinkState relies on, i.e. ignoring perf events and
+      // adjacency timestamps
+      auto adjacencyDb = decoded.adjacencyDb.value();
+      adjacencyDb.perfEvents_ref().reset();
+      for (auto& adj : *adjacencyDb.adjacencies_ref()) {
+        adj.timestamp_ref() = 0;
+      }
+      thread_local std::string scratch;
+      writeThriftObjStr(adjacencyDb, serializer_, scratch);
+      decoded.contentHash = std::hash<std::string>{}(scratch);
+    } else if (
+        key.find(Constants::kPrefixDbMarker.toString()) == 0 or
+        key.find(Constants::kPrefixShardDbMarker.toString()) == 0) {
+      decoded.prefixDb =
+          readThriftObjStr<thrift::PrefixDatabase>(value, serializer_);
+    }
+  } catch (const std::exception& e) {
+    decoded.error = folly::exceptionStr(e).toStdString();
+  }
+}
+
+void
+Decision::processPublication(
+    thrift::Publication&& thriftPub, DecodedValues&& decodedValues) {
   CHECK(not thriftPub.area_ref()->empty());
   auto const& area = *thriftPub.area_ref();
 
@@ -404,8 +809,17 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
     return;
   }
 
+  // Traced update, done waiting in the queue from KvStore
+  if (auto perfEvents = thriftPub.perfEvents_ref()) {
+    endPerfSpan(
+        *perfEvents, myNodeName_, Constants::kPerfSpanKvStoreUpdatesQueue);
+  }
+  const auto numPendingUpdates = pendingUpdates_.getCount();
+
   // LSDB addition/update
+  size_t valueIndex = 0;
   for (const auto& [key, rawVal] : *thriftPub.keyVals_ref()) {
+    auto& decoded = decodedValues.at(valueIndex++);
     if (not rawVal.value_ref().has_value()) {
       // skip TTL update
       DCHECK(*rawVal.ttlVersion_ref() > 0);
@@ -413,15 +827,38 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
     }
 
     try {
-      if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+      auto* adjDbDigest = key.find(Constants::kAdjDbMarker.toString()) == 0
+          ? &adjDbDigests_[area][key]
+          : nullptr;
+      if (decoded.unchanged and adjDbDigest->rawHash != decoded.rawHash) {
+        // digest changed by a publication applied after decoding
+        decoded.unchanged = false;
+        decodeValue(key, rawVal.value_ref().value(), decoded);
+      }
+      if (decoded.error.has_value()) {
+        throw std::runtime_error(*decoded.error);
+      }
+      if (adjDbDigest) {
         // adjacencyDb: update keys starting with "adj:"
-        auto adjacencyDb = readThriftObjStr<thrift::AdjacencyDatabase>(
-            rawVal.value_ref().value(), serializer_);
+        if (decoded.unchanged or
+            (adjDbDigest->contentHash != 0 and
+             adjDbDigest->contentHash == decoded.contentHash)) {
+          adjDbDigest->rawHash = decoded.rawHash;
+          fb303::fbData->addStatValue(
+              "decision.adj_db_update_skipped", 1, fb303::COUNT);
+          continue;
+        }
+        *adjDbDigest = AdjDbDigest{decoded.rawHash, decoded.contentHash};
+
+        auto& adjacencyDb = decoded.adjacencyDb.value();
         auto& nodeName = adjacencyDb.get_thisNodeName();
         LinkStateMetric holdUpTtl = 0, holdDownTtl = 0;
         adjacencyDb.area_ref() = area;
 
         fb303::fbData->addStatValue("decision.adj_db_update", 1, fb303::COUNT);
+        maybeSnapshotTopology(area);
+        snapshotDirtyAreas_.emplace(area);
+        adjacencyCountersStale_ = true;
         pendingUpdates_.applyLinkStateChange(
             nodeName,
             areaLinkState.updateAdjacencyDatabase(
@@ -429,8 +866,7 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
             adjacencyDb.perfEvents_ref());
       } else if (key.find(Constants::kPrefixDbMarker.toString()) == 0) {
         // prefixDb: update keys starting with "prefix:"
-        auto prefixDb = readThriftObjStr<thrift::PrefixDatabase>(
-            rawVal.value_ref().value(), serializer_);
+        auto const& prefixDb = decoded.prefixDb.value();
         if (1 != prefixDb.get_prefixEntries().size()) {
           LOG(ERROR) << "Expecting exactly one entry per prefix key";
           fb303::fbData->addStatValue("decision.error", 1, fb303::COUNT);
@@ -457,11 +893,18 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
 
         fb303::fbData->addStatValue(
             "decision.prefix_db_update", 1, fb303::COUNT);
+        snapshotPrefixStateDirty_ = true;
         pendingUpdates_.applyPrefixStateChange(
             prefixDb.get_deletePrefix()
                 ? prefixState_.deletePrefix(prefixKey)
                 : prefixState_.updatePrefix(prefixKey, entry),
             prefixDb.perfEvents_ref());
+      } else if (key.find(Constants::kPrefixShardDbMarker.toString()) == 0) {
+        // prefixShardDb: update keys starting with "prefixshard:"
+        auto const& prefixDb = decoded.prefixDb.value();
+        fb303::fbData->addStatValue(
+            "decision.prefix_shard_db_update", 1, fb303::COUNT);
+        updatePrefixShardDatabase(area, key, prefixDb);
       }
     } catch (const std::exception& e) {
       LOG(ERROR) << "Failed to deserialize info for key " << key
@@ -469,6 +912,21 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
     }
   }
 
+  // Originators gone from the area along with their keys, their prefixes
+  // are withdrawn at once instead of parsing every expired prefix key
+  std::unordered_set<std::string> goneNodes;
+  if (auto expiredOriginators = thriftPub.expiredOriginators_ref()) {
+    for (auto const& nodeName : *expiredOriginators) {
+      fb303::fbData->addStatValue(
+          "decision.expired_originators", 1, fb303::COUNT);
+      goneNodes.emplace(nodeName);
+      snapshotPrefixStateDirty_ = true;
+      pendingUpdates_.applyPrefixStateChange(
+          prefixState_.deleteNodePrefixes(nodeName, area),
+          thrift::PrefixDatabase().perfEvents_ref()); // Empty perf events
+    }
+  }
+
   // LSDB deletion
   // TODO: avoid decoding from string by injecting data-structures
   // instead of raw strings into `expiredKeys` collection
@@ -477,12 +935,19 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
 
     if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
       // adjacencyDb: delete keys starting with "adj:"
+      adjDbDigests_[area].erase(key);
+      maybeSnapshotTopology(area);
+      snapshotDirtyAreas_.emplace(area);
+      adjacencyCountersStale_ = true;
       pendingUpdates_.applyLinkStateChange(
           nodeName,
           areaLinkState.deleteAdjacencyDatabase(nodeName),
           thrift::PrefixDatabase().perfEvents_ref()); // Empty perf events
     } else if (key.find(Constants::kPrefixDbMarker.toString()) == 0) {
       // prefixDb: delete keys starting with "prefix:"
+      if (goneNodes.count(nodeName)) {
+        continue;
+      }
       // TODO: avoid decoding from string
       std::string node{};
       folly::CIDRNetwork network{};
@@ -509,11 +974,91 @@ Decision::processPublication(thrift::Publication&& thriftPub) {
 
       // construct new prefix key with local publication area id
       PrefixKey prefixKey(node, network, area, isPrefixKeyV2);
+      snapshotPrefixStateDirty_ = true;
       pendingUpdates_.applyPrefixStateChange(
           prefixState_.deletePrefix(prefixKey),
           thrift::PrefixDatabase().perfEvents_ref()); // Empty perf events
+    } else if (key.find(Constants::kPrefixShardDbMarker.toString()) == 0) {
+      // prefixShardDb: delete keys starting with "prefixshard:"
+      deletePrefixShardDatabase(area, key);
+    }
+  }
+
+  // Carry on trace with the route rebuild it triggers
+  auto perfEvents = thriftPub.perfEvents_ref();
+  if (perfEvents and pendingUpdates_.getCount() > numPendingUpdates) {
+    pendingUpdates_.addTrace(*perfEvents);
+  }
+}
+
+void
+Decision::updatePrefixShardDatabase(
+    const std::string& area,
+    const std::string& key,
+    const thrift::PrefixDatabase& prefixDb) {
+  auto const& nodeName = prefixDb.get_thisNodeName();
+  std::unordered_set<folly::CIDRNetwork> prefixes;
+  // changes of the whole shard are applied as one update
+  std::unordered_set<folly::CIDRNetwork> changed;
+  if (not prefixDb.get_deletePrefix()) {
+    for (auto const& entry : prefixDb.get_prefixEntries()) {
+      // Ignore self redistributed route reflection, see per prefix keys
+      auto const& areaStack = entry.get_area_stack();
+      if (nodeName == myNodeName_ && areaStack.size() > 0 &&
+          areaLinkStates_.count(areaStack.back())) {
+        continue;
+      }
+      const auto network = toIPNetwork(entry.get_prefix());
+      changed.merge(
+          prefixState_.updatePrefix(PrefixKey(nodeName, network, area), entry));
+      prefixes.emplace(network);
+    }
+  }
+
+  // withdraw prefixes no longer carried by the shard
+  auto& areaShards = prefixShards_[area];
+  auto it = areaShards.find(key);
+  if (it != areaShards.end()) {
+    for (auto const& network : it->second.prefixes) {
+      if (prefixes.count(network)) {
+        continue;
+      }
+      changed.merge(prefixState_.deletePrefix(
+          PrefixKey(it->second.nodeName, network, area)));
     }
   }
+  snapshotPrefixStateDirty_ = true;
+  pendingUpdates_.applyPrefixStateChange(
+      std::move(changed), prefixDb.perfEvents_ref());
+
+  if (prefixes.empty()) {
+    areaShards.erase(key);
+  } else {
+    areaShards[key] = PrefixShard{nodeName, std::move(prefixes)};
+  }
+}
+
+void
+Decision::deletePrefixShardDatabase(
+    const std::string& area, const std::string& key) {
+  auto areaIt = prefixShards_.find(area);
+  if (areaIt == prefixShards_.end()) {
+    return;
+  }
+  auto it = areaIt->second.find(key);
+  if (it == areaIt->second.end()) {
+    return;
+  }
+  std::unordered_set<folly::CIDRNetwork> changed;
+  for (auto const& network : it->second.prefixes) {
+    changed.merge(prefixState_.deletePrefix(
+        PrefixKey(it->second.nodeName, network, area)));
+  }
+  snapshotPrefixStateDirty_ = true;
+  pendingUpdates_.applyPrefixStateChange(
+      std::move(changed),
+      thrift::PrefixDatabase().perfEvents_ref()); // Empty perf events
+  areaIt->second.erase(it);
 }
 
 void
@@ -547,20 +1092,186 @@ Decision::processStaticRoutesUpdate(DecisionRouteUpdate&& routeUpdate) {
   // update static MPLS routes
   if (routeUpdate.mplsRoutesToUpdate.size() or
       routeUpdate.mplsRoutesToDelete.size()) {
-    spfSolver_->updateStaticMplsRoutes(
-        routeUpdate.mplsRoutesToUpdate, routeUpdate.mplsRoutesToDelete);
-    pendingUpdates_.setNeedsFullRebuild(); // Mark for full DB rebuild
+    // only rebuild changed labels and routes of prefixes depending on them
+    auto dependents = spfSolver_->updateStaticMplsRoutes(
+        routeUpdate.mplsRoutesToUpdate,
+        routeUpdate.mplsRoutesToDelete,
+        myNodeName_,
+        prefixState_);
+    for (auto const& mplsRoute : routeUpdate.mplsRoutesToUpdate) {
+      staticMplsChangedLabels_.emplace(mplsRoute.label);
+    }
+    staticMplsChangedLabels_.insert(
+        routeUpdate.mplsRoutesToDelete.cbegin(),
+        routeUpdate.mplsRoutesToDelete.cend());
+    pendingUpdates_.applyPrefixStateChange(
+        std::move(dependents), thrift::PrefixDatabase().perfEvents_ref());
+  }
+  scheduleRebuildRoutes();
+}
+
+void
+Decision::scheduleRebuildRoutes() {
+  if (adaptiveRebuildDebounced_) {
+    (*adaptiveRebuildDebounced_)();
+  } else {
+    rebuildRoutesDebounced_();
+  }
+}
+
+void
+Decision::publishSnapshot() {
+  if (snapshotDirtyAreas_.empty() and not snapshotPrefixStateDirty_ and
+      not snapshotBestRoutesDirty_) {
+    return;
+  }
+  auto const current = snapshot_.load();
+  auto next = current ? std::make_shared<Snapshot>(*current)
+                      : std::make_shared<Snapshot>();
+  for (auto const& area : snapshotDirtyAreas_) {
+    // shares the serialized databases of LinkState, deserialized on read
+    auto adjDbs =
+        std::make_shared<std::vector<std::shared_ptr<const std::string>>>();
+    for (auto const& [_, nodeDb] :
+         areaLinkStates_.at(area).getNodeAdjacencyDbs()) {
+      adjDbs->push_back(nodeDb.serializedDb);
+    }
+    next->adjacencyDbs.insert_or_assign(area, std::move(adjDbs));
+  }
+  if (not snapshotDirtyAreas_.empty()) {
+    ++next->adjacencyDbsVersion;
+  }
+  if (snapshotPrefixStateDirty_) {
+    next->prefixState = std::make_shared<const PrefixState>(prefixState_);
+  }
+  if (snapshotBestRoutesDirty_) {
+    next->bestRoutesCache = std::make_shared<const BestRoutesCache>(
+        spfSolver_->getBestRoutesCache());
+  }
+  snapshot_.store(std::move(next));
+
+  snapshotDirtyAreas_.clear();
+  snapshotPrefixStateDirty_ = false;
+  snapshotBestRoutesDirty_ = false;
+}
+
+Decision::TopologySnapshot
+Decision::getTopologySnapshot(LinkState const& linkState) const {
+  TopologySnapshot snapshot;
+  snapshot.mySpfResult = linkState.getSpfResult(myNodeName_);
+  for (auto const& link : linkState.linksFromNode(myNodeName_)) {
+    if (link->isUp()) {
+      snapshot.myUpLinks.emplace(
+          link->directionalToString(myNodeName_),
+          link->getOtherNodeName(myNodeName_));
+    }
+  }
+  return snapshot;
+}
+
+void
+Decision::maybeSnapshotTopology(std::string const& area) {
+  if (pendingUpdates_.needsFullRebuild() or topologySnapshots_.count(area)) {
+    return;
+  }
+  topologySnapshots_.emplace(
+      area, getTopologySnapshot(areaLinkStates_.at(area)));
+}
+
+std::optional<std::unordered_set<std::string>>
+Decision::getTopologyAffectedNodes() const {
+  auto const& changedNodes = pendingUpdates_.topologyChangedNodes();
+  std::unordered_set<std::string> affectedNodes{
+      changedNodes.begin(), changedNodes.end()};
+  for (auto const& [area, oldSnapshot] : topologySnapshots_) {
+    auto const newSnapshot = getTopologySnapshot(areaLinkStates_.at(area));
+    auto const& oldSpf = oldSnapshot.mySpfResult;
+    auto const& newSpf = newSnapshot.mySpfResult;
+    if (oldSnapshot.myUpLinks != newSnapshot.myUpLinks) {
+      // one of our links came up or went down. Unless we drained or undrained
+      // them, their nexthop addresses may have changed as well. LFA
+      // alternates may go over any of our links
+      if (not pendingUpdates_.localDrainChanged() or
+          spfSolver_->isLfaEnabled()) {
+        return std::nullopt;
+      }
+      // links only carry routes towards nodes reached through their
+      // neighbor, before or after the drain
+      std::unordered_set<std::string> neighbors;
+      auto addFlipped = [&neighbors](auto const& links, auto const& others) {
+        for (auto const& [link, neighbor] : links) {
+          if (not others.count(link)) {
+            neighbors.emplace(neighbor);
+          }
+        }
+      };
+      addFlipped(oldSnapshot.myUpLinks, newSnapshot.myUpLinks);
+      addFlipped(newSnapshot.myUpLinks, oldSnapshot.myUpLinks);
+      for (auto const* spf : {&oldSpf, &newSpf}) {
+        for (auto const& [node, result] : *spf) {
+          for (auto const& nextHop : result.nextHops()) {
+            if (neighbors.count(nextHop)) {
+              affectedNodes.insert(node);
+              break;
+            }
+          }
+        }
+      }
+    }
+    // nodes whose shortest path metric or nexthops changed
+    for (auto const& [node, result] : newSpf) {
+      auto it = oldSpf.find(node);
+      if (it == oldSpf.end() or it->second.metric() != result.metric() or
+          it->second.nextHops() != result.nextHops()) {
+        affectedNodes.insert(node);
+      }
+    }
+    for (auto const& [node, _] : oldSpf) {
+      if (not newSpf.count(node)) {
+        affectedNodes.insert(node);
+      }
+    }
+  }
+  return affectedNodes;
+}
+
+std::unordered_set<folly::CIDRNetwork>
+Decision::getTopologyAffectedPrefixes(
+    std::unordered_set<std::string> const& affectedNodes) const {
+  // KSP2 routes depend on full paths rather than shortest path metrics, they
+  // are always recomputed
+  std::unordered_set<folly::CIDRNetwork> prefixes{
+      prefixState_.ksp2Prefixes().begin(), prefixState_.ksp2Prefixes().end()};
+  for (auto const& node : affectedNodes) {
+    auto const& nodePrefixes = prefixState_.getPrefixesFromNode(node);
+    prefixes.insert(nodePrefixes.begin(), nodePrefixes.end());
+  }
+  return prefixes;
+}
+
+void
+Decision::updateReachableNodes() {
+  spfSolver_->computeSpfResults(myNodeName_, areaLinkStates_);
+  for (auto const& [area, linkState] : areaLinkStates_) {
+    std::unordered_set<std::string> nodes;
+    for (auto const& [node, _] : linkState.getSpfResult(myNodeName_)) {
+      nodes.emplace(node);
+    }
+    auto changed = prefixState_.updateReachableNodes(area, std::move(nodes));
+    reachabilityChangedPrefixes_.merge(changed);
   }
-  rebuildRoutesDebounced_();
 }
 
 void
 Decision::rebuildRoutes(std::string const& event) {
   if (coldStartTimer_->isScheduled()) {
+    publishSnapshot();
     return;
   }
 
   pendingUpdates_.addEvent(event);
+  pendingUpdates_.endSpan(Constants::kPerfSpanDecisionDebounce);
+  pendingUpdates_.startSpan(Constants::kPerfSpanDecisionRouteBuild);
   VLOG(1) << "Decision: processing " << pendingUpdates_.getCount()
           << " accumulated updates. " << event;
   if (pendingUpdates_.perfEvents()) {
@@ -573,6 +1284,32 @@ Decision::rebuildRoutes(std::string const& event) {
     }
   }
 
+  // scope remote topology changes to the prefixes of affected nodes
+  std::unordered_set<std::string> topologyAffectedNodes;
+  std::unordered_set<folly::CIDRNetwork> topologyAffectedPrefixes;
+  bool const hasTopologyChange =
+      not pendingUpdates_.topologyChangedNodes().empty();
+  if (hasTopologyChange and not pendingUpdates_.needsFullRebuild()) {
+    if (auto maybeNodes = getTopologyAffectedNodes()) {
+      topologyAffectedNodes = std::move(maybeNodes).value();
+      topologyAffectedPrefixes =
+          getTopologyAffectedPrefixes(topologyAffectedNodes);
+    } else {
+      pendingUpdates_.setNeedsFullRebuild();
+    }
+  }
+  topologySnapshots_.clear();
+  updateReachableNodes();
+  // routes of prefixes steered onto segment routing policies whose path
+  // changed, also rebuilt for remote link attribute changes
+  auto srPolicyChangedPrefixes =
+      spfSolver_->updateSrPolicyPaths(myNodeName_, areaLinkStates_);
+  if (not pendingUpdates_.needsFullRebuild()) {
+    topologyAffectedPrefixes.merge(reachabilityChangedPrefixes_);
+    topologyAffectedPrefixes.merge(srPolicyChangedPrefixes);
+  }
+  reachabilityChangedPrefixes_.clear();
+
   DecisionRouteUpdate update;
   if (pendingUpdates_.needsFullRebuild()) {
     // if only static routes gets updated, we still need to update routes
@@ -593,15 +1330,86 @@ Decision::rebuildRoutes(std::string const& event) {
     }
     // update `DecisionRouteDb` cache and return delta as `update`
     update = routeDb_.calculateUpdate(std::move(db));
+    // periodic rebuild is expected to be a no-op, a delta means incremental
+    // rebuilds missed some dependency
+    if (event == "PERIODIC_FULL_REBUILD" and not update.empty()) {
+      LOG(WARNING) << "Periodic full route rebuild resulted in route delta";
+      fb303::fbData->addStatValue(
+          "decision.periodic_full_rebuild_mismatch", 1, fb303::COUNT);
+    }
   } else {
-    // process prefixes update from `prefixState_`
-    for (auto const& prefix : pendingUpdates_.updatedPrefixes()) {
+    if (hasTopologyChange) {
+      fb303::fbData->addStatValue(
+          "decision.topology_scoped_rebuild_runs", 1, fb303::COUNT);
+      if (pendingUpdates_.localDrainChanged()) {
+        fb303::fbData->addStatValue(
+            "decision.drain_scoped_rebuild_runs", 1, fb303::COUNT);
+      }
+      fb303::fbData->addStatValue(
+          "decision.topology_scoped_rebuild_prefixes",
+          topologyAffectedPrefixes.size(),
+          fb303::AVG);
+      // next hops towards node labels of affected nodes may have changed as
+      // well
+      for (auto& [label, maybeEntry] : spfSolver_->buildNodeLabelRoutes(
+               myNodeName_, areaLinkStates_, topologyAffectedNodes)) {
+        auto it = routeDb_.mplsRoutes.find(label);
+        if (maybeEntry.has_value()) {
+          if (it == routeDb_.mplsRoutes.end() or it->second != *maybeEntry) {
+            update.mplsRoutesToUpdate.emplace_back(
+                std::move(maybeEntry).value());
+          }
+        } else if (it != routeDb_.mplsRoutes.end()) {
+          update.mplsRoutesToDelete.emplace_back(label);
+        }
+      }
+    }
+    // static MPLS routes changed since last route rebuild, unless node label
+    // routes above took care of their label already
+    std::unordered_set<int32_t> nodeLabels;
+    for (auto const& entry : update.mplsRoutesToUpdate) {
+      nodeLabels.emplace(entry.label);
+    }
+    nodeLabels.insert(
+        update.mplsRoutesToDelete.begin(), update.mplsRoutesToDelete.end());
+    for (auto const label : staticMplsChangedLabels_) {
+      if (nodeLabels.count(label)) {
+        continue;
+      }
+      auto it = routeDb_.mplsRoutes.find(label);
+      if (auto const* entry = spfSolver_->getStaticMplsRoute(label)) {
+        if (it == routeDb_.mplsRoutes.end() or it->second != *entry) {
+          update.mplsRoutesToUpdate.emplace_back(*entry);
+        }
+      } else if (it != routeDb_.mplsRoutes.end()) {
+        update.mplsRoutesToDelete.emplace_back(label);
+      }
+    }
+    // process prefixes update from `prefixState_` and topology changes
+    auto updateRoute = [&](folly::CIDRNetwork const& prefix) {
       if (auto maybeRibEntry = spfSolver_->createRouteForPrefixOrGetStaticRoute(
               myNodeName_, areaLinkStates_, prefixState_, prefix)) {
         update.addRouteToUpdate(std::move(maybeRibEntry).value());
       } else {
         update.unicastRoutesToDelete.emplace_back(prefix);
       }
+    };
+    for (auto const& prefix : topologyAffectedPrefixes) {
+      updateRoute(prefix);
+    }
+    for (auto const& prefix : pendingUpdates_.updatedPrefixes()) {
+      if (not topologyAffectedPrefixes.count(prefix)) {
+        updateRoute(prefix);
+      }
+    }
+    // routes whose policy transformation may have changed
+    std::vector<folly::CIDRNetwork> policyOnlyPrefixes;
+    for (auto const& prefix : ribPolicyChangedPrefixes_) {
+      if (not topologyAffectedPrefixes.count(prefix) and
+          not pendingUpdates_.updatedPrefixes().count(prefix)) {
+        updateRoute(prefix);
+        policyOnlyPrefixes.emplace_back(prefix);
+      }
     }
     if (ribPolicy_) {
       auto start = std::chrono::steady_clock::now();
@@ -615,17 +1423,256 @@ Decision::rebuildRoutes(std::string const& event) {
         update.unicastRoutesToDelete.push_back(prefix);
       }
     }
+    // re-evaluated routes the policy change left as they were
+    for (auto const& prefix : policyOnlyPrefixes) {
+      auto it = update.unicastRoutesToUpdate.find(prefix);
+      auto const* current = folly::get_ptr(routeDb_.unicastRoutes, prefix);
+      if (it != update.unicastRoutesToUpdate.end() and current and
+          it->second == *current) {
+        update.unicastRoutesToUpdate.erase(it);
+      }
+    }
+  }
+  ribPolicyChangedPrefixes_.clear();
+  staticMplsChangedLabels_.clear();
+
+  if (prefixDampener_) {
+    applyPrefixDampening(update, pendingUpdates_.updatedPrefixes());
   }
 
   routeDb_.update(update);
+  if (configStore_ and not persistRouteDbTimer_->isScheduled() and
+      (not update.empty() or event == "COLD_START_UPDATE" or
+       event == "PERIODIC_FULL_REBUILD")) {
+    persistRouteDbTimer_->scheduleTimeout(
+        Constants::kDecisionRouteDbPersistDelay);
+  }
+  // publish before sending update, so readers notified by it see the result
+  snapshotBestRoutesDirty_ = true;
+  publishSnapshot();
   pendingUpdates_.addEvent("ROUTE_UPDATE");
+  pendingUpdates_.endSpan(Constants::kPerfSpanDecisionRouteBuild);
+  pendingUpdates_.startSpan(Constants::kPerfSpanRouteUpdatesQueue);
   update.perfEvents = pendingUpdates_.moveOutEvents();
+  std::optional<DecisionRouteUpdate> highPriorityUpdate;
+  if (enableRouteUpdateLanes_) {
+    // whole delta is high priority if the scope of topology changes is
+    // unknown
+    highPriorityUpdate = splitHighPriorityRoutes(
+        update,
+        hasTopologyChange,
+        hasTopologyChange and pendingUpdates_.needsFullRebuild()
+            ? nullptr
+            : &topologyAffectedPrefixes);
+  }
   pendingUpdates_.reset();
 
-  // send `DecisionRouteUpdate` to Fib/PrefixMgr
+  // send `DecisionRouteUpdate` to Fib/PrefixMgr, high priority lane first
+  if (highPriorityUpdate.has_value()) {
+    routeUpdatesQueue_.push(std::move(highPriorityUpdate).value());
+  }
+  if (not highPriorityUpdate.has_value() or not update.empty()) {
+    routeUpdatesQueue_.push(std::move(update));
+  }
+}
+
+void
+Decision::loadRouteDbSnapshot() {
+  thrift::DecisionRouteDbSnapshot snapshot;
+  try {
+    auto maybeSnapshot =
+        configStore_
+            ->loadThriftObj<thrift::DecisionRouteDbSnapshot>(
+                kRouteDbSnapshotKey)
+            .get();
+    if (maybeSnapshot.hasError()) {
+      LOG(INFO) << "No route db snapshot to warm start from";
+      return;
+    }
+    snapshot = std::move(maybeSnapshot).value();
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to load route db snapshot. Error: "
+               << folly::exceptionStr(e);
+    return;
+  }
+
+  const auto age = std::chrono::milliseconds(
+      getUnixTimeStampMs() - *snapshot.timestampMs_ref());
+  if (*snapshot.thisNodeName_ref() != myNodeName_ or
+      age > Constants::kDecisionRouteDbSnapshotMaxAge) {
+    LOG(INFO) << fmt::format(
+        "Ignoring route db snapshot of node {}, taken {}s ago",
+        *snapshot.thisNodeName_ref(),
+        std::chrono::duration_cast<std::chrono::seconds>(age).count());
+    return;
+  }
+  try {
+    routeDb_ = DecisionRouteDb::fromSnapshot(snapshot);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Invalid route db snapshot. Error: "
+               << folly::exceptionStr(e);
+    return;
+  }
+  LOG(INFO) << fmt::format(
+      "Warm start from route db snapshot of {} unicast and {} mpls routes",
+      routeDb_.unicastRoutes.size(),
+      routeDb_.mplsRoutes.size());
+  fb303::fbData->addStatValue(
+      "decision.warm_start_routes",
+      routeDb_.unicastRoutes.size() + routeDb_.mplsRoutes.size(),
+      fb303::COUNT);
+
+  // Fib and PrefixManager expect the routes of the snapshot, so that the
+  // route rebuild at the end of cold start only publishes the difference
+  DecisionRouteUpdate update;
+  for (auto const& [_, entry] : routeDb_.unicastRoutes) {
+    update.addRouteToUpdate(entry);
+  }
+  for (auto const& [_, entry] : routeDb_.mplsRoutes) {
+    update.mplsRoutesToUpdate.emplace_back(entry);
+  }
   routeUpdatesQueue_.push(std::move(update));
 }
 
+void
+Decision::persistRouteDbSnapshot() {
+  auto snapshot = routeDb_.toSnapshot();
+  snapshot.thisNodeName_ref() = myNodeName_;
+  snapshot.timestampMs_ref() = getUnixTimeStampMs();
+  try {
+    configStore_->storeThriftObj(kRouteDbSnapshotKey, snapshot).get();
+    VLOG(1) << "Persisted route db snapshot";
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to persist route db snapshot. Error: "
+               << folly::exceptionStr(e);
+  }
+}
+
+std::optional<DecisionRouteUpdate>
+Decision::splitHighPriorityRoutes(
+    DecisionRouteUpdate& update,
+    bool hasTopologyChange,
+    std::unordered_set<folly::CIDRNetwork> const* topologyAffectedPrefixes) {
+  if (hasTopologyChange and topologyAffectedPrefixes == nullptr) {
+    update.priority = DecisionRouteUpdate::HIGH;
+    return std::nullopt;
+  }
+
+  // withdrawals go first, they stop blackholing traffic towards lost
+  // destinations
+  DecisionRouteUpdate highPriorityUpdate;
+  highPriorityUpdate.type = update.type;
+  highPriorityUpdate.priority = DecisionRouteUpdate::HIGH;
+  std::swap(
+      highPriorityUpdate.unicastRoutesToDelete, update.unicastRoutesToDelete);
+  std::swap(highPriorityUpdate.mplsRoutesToDelete, update.mplsRoutesToDelete);
+  if (hasTopologyChange) {
+    std::swap(
+        highPriorityUpdate.mplsRoutesToUpdate, update.mplsRoutesToUpdate);
+    for (auto it = update.unicastRoutesToUpdate.begin();
+         it != update.unicastRoutesToUpdate.end();) {
+      if (topologyAffectedPrefixes->count(it->first)) {
+        highPriorityUpdate.unicastRoutesToUpdate.emplace(
+            it->first, std::move(it->second));
+        it = update.unicastRoutesToUpdate.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  update.priority = DecisionRouteUpdate::BULK;
+
+  // perf events trace the high priority lane, which carries the changes of
+  // the triggering event
+  if (highPriorityUpdate.empty()) {
+    return std::nullopt;
+  }
+  highPriorityUpdate.perfEvents = std::move(update.perfEvents);
+  update.perfEvents = std::nullopt;
+  return highPriorityUpdate;
+}
+
+void
+Decision::applyPrefixDampening(
+    DecisionRouteUpdate& update,
+    std::unordered_set<folly::CIDRNetwork> const& updatedPrefixes) {
+  const auto now = PrefixDampener::Clock::now();
+
+  // Returns true if route change of prefix is to be withheld, `entry` being
+  // the new route or nullptr if it is withdrawn
+  auto isDampened = [&](folly::CIDRNetwork const& prefix,
+                        RibUnicastEntry const* entry) {
+    auto const* published = folly::get_ptr(routeDb_.unicastRoutes, prefix);
+    auto const* typed = entry ? entry : published;
+    auto const type = typed ? *typed->bestPrefixEntry.type_ref()
+                            : prefixDampener_->getPrefixType(prefix);
+    if (not type.has_value() or not prefixDampener_->isDampenedType(*type)) {
+      return false;
+    }
+
+    const bool wasSuppressed = prefixDampener_->isSuppressed(prefix);
+    bool suppressed = wasSuppressed;
+    if (updatedPrefixes.count(prefix)) {
+      suppressed = prefixDampener_->reportRouteChange(
+          prefix,
+          *type,
+          published ? getFingerprint(*published) : 0,
+          entry ? getFingerprint(*entry) : 0,
+          now);
+    }
+    auto const typeName = apache::thrift::util::enumNameSafe(*type);
+    if (suppressed and not wasSuppressed) {
+      LOG(INFO) << "Suppressing routes of flapping prefix "
+                << folly::IPAddress::networkToString(prefix);
+      fb303::fbData->addStatValue(
+          fmt::format("decision.prefix_dampening.suppressions.{}", typeName),
+          1,
+          fb303::SUM);
+    }
+    if (suppressed) {
+      fb303::fbData->addStatValue(
+          fmt::format(
+              "decision.prefix_dampening.suppressed_updates.{}", typeName),
+          1,
+          fb303::SUM);
+    }
+    return suppressed;
+  };
+
+  // Withdrawals of published routes go out. Routes of prefixes suppressed on
+  // withdrawal are withheld once they come back.
+  std::vector<folly::CIDRNetwork> routesToDelete;
+  for (auto const& prefix : update.unicastRoutesToDelete) {
+    if (not isDampened(prefix, nullptr) or
+        routeDb_.unicastRoutes.count(prefix)) {
+      routesToDelete.emplace_back(prefix);
+    }
+  }
+  update.unicastRoutesToDelete = std::move(routesToDelete);
+
+  // Routes of suppressed prefixes are withheld, published ones withdrawn
+  for (auto it = update.unicastRoutesToUpdate.begin();
+       it != update.unicastRoutesToUpdate.end();) {
+    if (isDampened(it->first, &it->second)) {
+      if (routeDb_.unicastRoutes.count(it->first)) {
+        update.unicastRoutesToDelete.emplace_back(it->first);
+      }
+      it = update.unicastRoutesToUpdate.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  schedulePrefixReuse();
+}
+
+void
+Decision::schedulePrefixReuse() {
+  if (auto next = prefixDampener_->getNextReuseTime()) {
+    prefixReuseTimer_->scheduleTimeout(*next);
+  }
+}
+
 void
 Decision::updateCounters(
     std::string key,
@@ -637,51 +1684,90 @@ Decision::updateCounters(
 }
 
 void
-Decision::updateGlobalCounters() const {
-  size_t numAdjacencies = 0, numPartialAdjacencies = 0;
+Decision::updateAdjacencyCounters() {
+  adjacencyCountersStale_ = false;
+  AdjacencyCounters counters;
   std::unordered_set<std::string> nodeSet;
   for (auto const& [_, linkState] : areaLinkStates_) {
-    numAdjacencies += linkState.numLinks();
     auto const& mySpfResult = linkState.getSpfResult(myNodeName_);
-    for (auto const& kv : linkState.getAdjacencyDatabases()) {
+    for (auto const& kv : linkState.getNodeAdjacencyDbs()) {
       nodeSet.insert(kv.first);
-      const auto& adjDb = kv.second;
+      const auto& nodeDb = kv.second;
+      counters.adjacencyDbBytes += sizeof(nodeDb) + kv.first.size() +
+          nodeDb.serializedDb->size();
       size_t numLinks = linkState.linksFromNode(kv.first).size();
       // Consider partial adjacency only iff node is reachable from current
       // node
-      if (mySpfResult.count(*adjDb.thisNodeName_ref()) && 0 != numLinks) {
+      if (mySpfResult.count(kv.first) && 0 != numLinks) {
         // only add to the count if this node is not completely disconnected
-        size_t diff = adjDb.adjacencies_ref()->size() - numLinks;
+        size_t diff = nodeDb.numAdjacencies - numLinks;
         // Number of links (bi-directional) must be <= number of adjacencies
         CHECK_GE(diff, 0);
-        numPartialAdjacencies += diff;
+        counters.numPartialAdjacencies += diff;
       }
     }
   }
+  counters.numNodes = nodeSet.size();
+  adjacencyCounters_ = counters;
+}
 
-  size_t numConflictingPrefixes{0};
-  for (const auto& [prefix, prefixEntries] : prefixState_.prefixes()) {
-    if (not PrefixState::hasConflictingForwardingInfo(prefixEntries)) {
-      continue;
-    }
+void
+Decision::updateGlobalCounters() {
+  if (adjacencyCountersStale_) {
+    updateAdjacencyCounters();
+  }
+
+  size_t numAdjacencies = 0;
+  for (auto const& [_, linkState] : areaLinkStates_) {
+    numAdjacencies += linkState.numLinks();
+  }
+
+  for (const auto& prefix : prefixState_.conflictingPrefixes()) {
     LOG(WARNING) << "Prefix " << folly::IPAddress::networkToString(prefix)
                  << " has conflicting "
                  << "forwarding algorithm or type.";
-    numConflictingPrefixes += 1;
   }
 
   // Add custom counters
   fb303::fbData->setCounter(
-      "decision.num_conflicting_prefixes", numConflictingPrefixes);
+      "decision.num_conflicting_prefixes",
+      prefixState_.conflictingPrefixes().size());
   fb303::fbData->setCounter(
-      "decision.num_partial_adjacencies", numPartialAdjacencies);
+      "decision.num_partial_adjacencies",
+      adjacencyCounters_.numPartialAdjacencies);
   fb303::fbData->setCounter(
       "decision.num_complete_adjacencies", numAdjacencies);
   // When node has no adjacencies then linkState reports 0
   fb303::fbData->setCounter(
-      "decision.num_nodes", std::max(nodeSet.size(), static_cast<size_t>(1ul)));
+      "decision.num_nodes",
+      std::max(adjacencyCounters_.numNodes, static_cast<size_t>(1ul)));
   fb303::fbData->setCounter(
       "decision.num_prefixes", prefixState_.prefixes().size());
+  if (prefixDampener_) {
+    fb303::fbData->setCounter(
+        "decision.prefix_dampening.num_suppressed_prefixes",
+        prefixDampener_->getNumSuppressed());
+  }
+  fb303::fbData->setCounter(
+      "decision.num_nexthop_groups", NextHopGroup::getNumGroups());
+
+  // approximate memory held by the link states, prefixes and routes,
+  // accounted for by Watchdog. Next-hop groups are shared by the routes
+  const size_t prefixBytes = prefixState_.prefixes().size() *
+          (sizeof(folly::CIDRNetwork) + sizeof(PrefixEntries)) +
+      prefixState_.getNumPrefixEntries() *
+          (sizeof(PrefixEntries::value_type) + sizeof(thrift::PrefixEntry));
+  fb303::fbData->setCounter(
+      "decision.memory.links_bytes", numAdjacencies * sizeof(Link));
+  fb303::fbData->setCounter(
+      "decision.memory.adjacency_dbs_bytes",
+      adjacencyCounters_.adjacencyDbBytes);
+  fb303::fbData->setCounter("decision.memory.prefixes_bytes", prefixBytes);
+  fb303::fbData->setCounter(
+      "decision.memory.routes_bytes",
+      routeDb_.unicastRoutes.size() *
+              sizeof(decltype(routeDb_.unicastRoutes)::value_type) +
+          routeDb_.mplsRoutes.getMemoryUsage());
 }
 
 } // namespace openr
@@ -8,25 +8,34 @@
 #pragma once
 
 #include <chrono>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/String.h>
+#include <folly/concurrency/AtomicSharedPtr.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/AdaptiveDebounce.h>
 #include <openr/common/AsyncDebounce.h>
 #include <openr/common/AsyncThrottle.h>
 #include <openr/common/MplsUtil.h>
 #include <openr/common/OpenrEventBase.h>
 #include <openr/common/Util.h>
+#include <openr/config-store/PersistentStore.h>
 #include <openr/config/Config.h>
 #include <openr/decision/LinkState.h>
+#include <openr/decision/PrefixDampener.h>
 #include <openr/decision/PrefixState.h>
 #include <openr/decision/RibEntry.h>
 #include <openr/decision/RibPolicy.h>
@@ -64,7 +73,15 @@ class DecisionPendingUpdates {
 
   bool
   needsRouteUpdate() const {
-    return needsFullRebuild() || !updatedPrefixes_.empty();
+    return needsFullRebuild() || !updatedPrefixes_.empty() ||
+        !topologyChangedNodes_.empty() || remoteLinkAttributesChanged_;
+  }
+
+  // Also update routes upon link attribute changes of remote nodes, e.g.
+  // adjacency labels and admin groups segment routing policy paths rely on
+  void
+  setTrackRemoteLinkAttributes() {
+    trackRemoteLinkAttributes_ = true;
   }
 
   std::unordered_set<folly::CIDRNetwork> const&
@@ -72,6 +89,18 @@ class DecisionPendingUpdates {
     return updatedPrefixes_;
   }
 
+  std::unordered_set<std::string> const&
+  topologyChangedNodes() const {
+    return topologyChangedNodes_;
+  }
+
+  // whether myNodeName_ drained or undrained itself or some of its links in
+  // this batch, with no other local change
+  bool
+  localDrainChanged() const {
+    return localDrainChanged_;
+  }
+
   void applyLinkStateChange(
       std::string const& nodeName,
       LinkState::LinkStateChange const& change,
@@ -85,6 +114,13 @@ class DecisionPendingUpdates {
 
   void addEvent(std::string const& eventDescription);
 
+  // Adopt trace of an update of this batch, the first one traced wins
+  void addTrace(thrift::PerfEvents const& trace);
+
+  // Start/end span of `stage` if the batch is traced
+  void startSpan(folly::StringPiece stage);
+  void endSpan(folly::StringPiece stage);
+
   std::optional<thrift::PerfEvents> const&
   perfEvents() const {
     return perfEvents_;
@@ -113,6 +149,18 @@ class DecisionPendingUpdates {
   // track prefixes that have changed in this batch
   std::unordered_set<folly::CIDRNetwork> updatedPrefixes_;
 
+  // remote nodes whose adjacencies changed the topology in this batch, and
+  // myNodeName_ for local drains. Only routes depending on the SPF result of
+  // affected nodes are rebuilt
+  std::unordered_set<std::string> topologyChangedNodes_;
+
+  // see localDrainChanged()
+  bool localDrainChanged_{false};
+
+  // see setTrackRemoteLinkAttributes()
+  bool trackRemoteLinkAttributes_{false};
+  bool remoteLinkAttributesChanged_{false};
+
   // local node name to determine action on linkAttributes change
   std::string myNodeName_;
 };
@@ -143,7 +191,8 @@ class Decision : public OpenrEventBase {
       bool enableBgpRouteProgramming,
       messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue,
       messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue,
-      messaging::ReplicateQueue<DecisionRouteUpdate>& routeUpdatesQueue);
+      messaging::ReplicateQueue<DecisionRouteUpdate>& routeUpdatesQueue,
+      PersistentStore* configStore = nullptr);
 
   virtual ~Decision() = default;
 
@@ -155,17 +204,38 @@ class Decision : public OpenrEventBase {
       std::string nodeName);
 
   /*
-   * Retrieve AdjacencyDatabase for all nodes in all areas
+   * Retrieve AdjacencyDatabase for all nodes in all areas. Served from the
+   * latest published snapshot on the calling thread
    */
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::AdjacencyDatabase>>>
   getDecisionAdjacenciesFiltered(thrift::AdjacenciesFilter filter = {});
 
   /*
-   * Retrieve received routes along with best route selection output.
+   * Version of the adjacency databases served by
+   * getDecisionAdjacenciesFiltered, bumped whenever a snapshot with changed
+   * adjacencies is published
+   */
+  int64_t getAdjacencyDbsVersion() const;
+
+  /*
+   * Retrieve received routes along with best route selection output. Served
+   * from the latest published snapshot on the calling thread
    */
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::ReceivedRouteDetail>>>
   getReceivedRoutesFiltered(thrift::ReceivedRouteFilter filter);
 
+  // paginated variant of getReceivedRoutesFiltered, see thrift::PageParams
+  folly::SemiFuture<std::unique_ptr<thrift::ReceivedRoutesPage>>
+  getReceivedRoutesFilteredPage(
+      thrift::ReceivedRouteFilter filter, thrift::PageParams page);
+
+  /*
+   * Fill best routes of unicast route details from the latest published
+   * snapshot on the calling thread, for route details of a Fib keeping a
+   * compact route state. Routes without any are left untouched
+   */
+  void fillBestRoutes(std::vector<thrift::UnicastRouteDetail>& routes) const;
+
   /*
    * Set new or replace existing RibPolicy. This will trigger the new policy
    * run against computed routes and delta will be published.
@@ -186,7 +256,11 @@ class Decision : public OpenrEventBase {
   folly::SemiFuture<folly::Unit> clearRibPolicy();
 
   // periodically called by counterUpdateTimer_, exposed publicly for testing
-  void updateGlobalCounters() const;
+  void updateGlobalCounters();
+
+  // recount adjacencies of the link states. Only once adjacency databases
+  // changed, so that periodic counter updates don't walk the topology
+  void updateAdjacencyCounters();
 
   void updateCounters(
       std::string key,
@@ -197,8 +271,51 @@ class Decision : public OpenrEventBase {
   Decision(Decision const&) = delete;
   Decision& operator=(Decision const&) = delete;
 
-  // process publication from KvStore
-  void processPublication(thrift::Publication&& thriftPub);
+  // fill best route selection of received routes
+  static void addBestRoutes(
+      std::vector<thrift::ReceivedRouteDetail>& routes,
+      BestRoutesCache const& bestRoutesCache);
+
+#if FOLLY_HAS_COROUTINES
+  // reader tasks of publications from KvStore and PrefixManager
+  folly::coro::Task<void> processKvStoreUpdates(
+      messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue);
+  folly::coro::Task<void> processStaticRouteUpdates(
+      messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue);
+#endif
+
+  // process batch of publications read from KvStore and trigger route rebuild
+  void processPublications(std::vector<thrift::Publication>&& thriftPubs);
+
+  // value of a publication, deserialized ahead of applying it
+  struct DecodedValue {
+    std::optional<thrift::AdjacencyDatabase> adjacencyDb;
+    std::optional<thrift::PrefixDatabase> prefixDb;
+    // set if deserialization failed
+    std::optional<std::string> error;
+    // adj: keys only, hash of raw value and of fields relevant to LinkState
+    size_t rawHash{0};
+    size_t contentHash{0};
+    // adj: keys only, raw value same as last applied one, left undecoded
+    bool unchanged{false};
+  };
+  // decoded values of a publication, in order of its keyVals
+  using DecodedValues = std::vector<DecodedValue>;
+
+  // deserialize adj/prefix values of publications, on decodePool_ for large
+  // batches. Values are returned in order of publications.
+  std::vector<DecodedValues> decodePublications(
+      std::vector<thrift::Publication> const& thriftPubs);
+
+  // deserialize a single value, thread-safe
+  void decodeValue(
+      std::string const& key,
+      std::string const& value,
+      DecodedValue& decoded) const;
+
+  // process publication from KvStore, along with its decoded values
+  void processPublication(
+      thrift::Publication&& thriftPub, DecodedValues&& decodedValues);
 
   // process publication from PrefixManager
   void processStaticRoutesUpdate(DecisionRouteUpdate&& routeUpdate);
@@ -210,6 +327,20 @@ class Decision : public OpenrEventBase {
   // gracefulRestartDuration
   std::unique_ptr<folly::AsyncTimeout> coldStartTimer_{nullptr};
 
+  // seed routeDb_ with the snapshot persisted by the previous instance, if
+  // any, and publish its routes right away
+  void loadRouteDbSnapshot();
+
+  // persist snapshot of routeDb_ to configStore_
+  void persistRouteDbSnapshot();
+
+  // Persistent store of route db snapshots for warm start, nullptr if
+  // disabled
+  PersistentStore* configStore_{nullptr};
+
+  // Timer to persist route db snapshot, debounces route changes
+  std::unique_ptr<folly::AsyncTimeout> persistRouteDbTimer_{nullptr};
+
   /**
    * Rebuild all routes and send out update delta. Check current pendingUpdates_
    * to decide which routes need rebuilding, otherwise rebuild all. Use
@@ -218,23 +349,105 @@ class Decision : public OpenrEventBase {
    */
   void rebuildRoutes(std::string const& event);
 
+  /**
+   * Sync nodes reachable from myNodeName_ in each area into prefixState_,
+   * collecting prefixes whose reachable originators changed into
+   * reachabilityChangedPrefixes_.
+   */
+  void updateReachableNodes();
+
+  /**
+   * Collect prefixes of routes affected by replacing RibPolicy oldPolicy by
+   * newPolicy into ribPolicyChangedPrefixes_, for the next route rebuild to
+   * re-evaluate instead of rebuilding all routes.
+   */
+  void updateRibPolicy(RibPolicy const* oldPolicy, RibPolicy const* newPolicy);
+
+  // state of an area as seen from myNodeName_ which scoped route rebuilds are
+  // computed against. Captured before the first topology change of a batch
+  struct TopologySnapshot {
+    LinkState::SpfResult mySpfResult;
+    // directional name -> neighbor, of links up from myNodeName_
+    std::map<std::string, std::string> myUpLinks;
+  };
+
+  TopologySnapshot getTopologySnapshot(LinkState const& linkState) const;
+
+  // capture snapshot of the area. No-op if a full rebuild is already pending
+  // or the area has been captured in the current batch
+  void maybeSnapshotTopology(std::string const& area);
+
+  // Collect the nodes whose routes to recompute for topology changes in the
+  // batch. Returns std::nullopt if the change is local to myNodeName_ and all
+  // routes must be rebuilt. Links of myNodeName_ drained or undrained in the
+  // batch only affect the nodes reached through their neighbors
+  std::optional<std::unordered_set<std::string>> getTopologyAffectedNodes()
+      const;
+
+  // prefixes to recompute for changes of affectedNodes
+  std::unordered_set<folly::CIDRNetwork> getTopologyAffectedPrefixes(
+      std::unordered_set<std::string> const& affectedNodes) const;
+
+  // Withhold routes of prefixes suppressed by prefixDampener_ from update.
+  // Changes of routes of updatedPrefixes, i.e. caused by prefix
+  // advertisements, are penalized.
+  void applyPrefixDampening(
+      DecisionRouteUpdate& update,
+      std::unordered_set<folly::CIDRNetwork> const& updatedPrefixes);
+
+  // schedule prefixReuseTimer_ for the next prefix to be reused
+  void schedulePrefixReuse();
+
+  // Move high priority routes of update into a separate update, to be
+  // published ahead of it: withdrawals, and with topology changes the routes
+  // of topologyAffectedPrefixes and MPLS routes. All routes are high priority
+  // if topologyAffectedPrefixes is null. Returns std::nullopt if update is
+  // to be published on its own.
+  std::optional<DecisionRouteUpdate> splitHighPriorityRoutes(
+      DecisionRouteUpdate& update,
+      bool hasTopologyChange,
+      std::unordered_set<folly::CIDRNetwork> const* topologyAffectedPrefixes);
+
   void sendRouteUpdate(
       DecisionRouteDb&& routeDb,
       std::optional<thrift::PerfEvents>&& perfEvents);
 
+  // publish a new snapshot_ if any of its parts is dirty. Parts that did not
+  // change are shared with the previous snapshot
+  void publishSnapshot();
+
   // node to prefix entries database for nodes advertising per prefix keys
   std::optional<thrift::PrefixDatabase> updateNodePrefixDatabase(
       const std::string& key, const thrift::PrefixDatabase& prefixDb);
 
+  // prefix entries of nodes advertising sharded prefix db, see
+  // `num_prefix_db_shards`. Each shard carries all prefixes of the node
+  // hashed to it, prefixes missing from an update are withdrawn
+  void updatePrefixShardDatabase(
+      const std::string& area,
+      const std::string& key,
+      const thrift::PrefixDatabase& prefixDb);
+  void deletePrefixShardDatabase(
+      const std::string& area, const std::string& key);
+
   // cached routeDb
   DecisionRouteDb routeDb_;
 
   // Queue to publish route changes
   messaging::ReplicateQueue<DecisionRouteUpdate>& routeUpdatesQueue_;
 
+  // Publish route changes in priority lanes, see splitHighPriorityRoutes()
+  bool enableRouteUpdateLanes_{false};
+
   // Pointer to RibPolicy
   std::unique_ptr<RibPolicy> ribPolicy_;
 
+  // Dampening of flapping prefixes, null if disabled
+  std::unique_ptr<PrefixDampener> prefixDampener_;
+
+  // Timer to rebuild routes of dampened prefixes once they are reused
+  std::unique_ptr<folly::AsyncTimeout> prefixReuseTimer_;
+
   // Timer associated with RibPolicy. Triggered when ribPolicy is expired. This
   // aims to revert the policy effects on programmed routes.
   std::unique_ptr<folly::AsyncTimeout> ribPolicyTimer_;
@@ -248,8 +461,50 @@ class Decision : public OpenrEventBase {
   // global prefix state
   PrefixState prefixState_;
 
+  // adjacency counters as of the last adjacency database change
+  struct AdjacencyCounters {
+    size_t numPartialAdjacencies{0};
+    size_t numNodes{0};
+    size_t adjacencyDbBytes{0};
+  };
+  AdjacencyCounters adjacencyCounters_;
+  bool adjacencyCountersStale_{false};
+
+  // prefixes whose reachable originators changed since last route rebuild
+  std::unordered_set<folly::CIDRNetwork> reachabilityChangedPrefixes_;
+
+  // prefixes of routes affected by RibPolicy changes since last route rebuild
+  std::unordered_set<folly::CIDRNetwork> ribPolicyChangedPrefixes_;
+
+  // labels of static MPLS routes changed since last route rebuild
+  std::unordered_set<int32_t> staticMplsChangedLabels_;
+
+  // prefixes carried by each prefix db shard key, per area
+  struct PrefixShard {
+    std::string nodeName;
+    std::unordered_set<folly::CIDRNetwork> prefixes;
+  };
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_map<std::string /* key */, PrefixShard>>
+      prefixShards_;
+
+  // digests of adjacency dbs applied to LinkState. Republished adjacency
+  // dbs differing only in perf events or timestamps are skipped.
+  struct AdjDbDigest {
+    size_t rawHash{0};
+    size_t contentHash{0};
+  };
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_map<std::string /* key */, AdjDbDigest>>
+      adjDbDigests_;
+
   apache::thrift::CompactSerializer serializer_;
 
+  // workers deserializing publications, null if done on Decision thread
+  std::unique_ptr<folly::CPUThreadPoolExecutor> decodePool_;
+
   // base interval to submit to monitor with (jitter will be added)
   std::chrono::seconds monitorSyncInterval_{0};
 
@@ -259,17 +514,51 @@ class Decision : public OpenrEventBase {
   // Timer for updating and submitting counters periodically
   std::unique_ptr<folly::AsyncTimeout> counterUpdateTimer_{nullptr};
 
+  // Timer for periodic full route rebuild. Guards against divergence of
+  // routes computed by scoped rebuilds
+  std::unique_ptr<folly::AsyncTimeout> fullRebuildTimer_{nullptr};
+
+  // per area snapshot taken before topology changes of the pending batch
+  std::unordered_map<std::string, TopologySnapshot> topologySnapshots_;
+
   // this node's name and the key markers
   const std::string myNodeName_;
 
   // store rebuildRoutes to-do status and perf events
   detail::DecisionPendingUpdates pendingUpdates_;
 
+  // Immutable view of the state served by read APIs on any thread without
+  // going through the event base. Published after route rebuilds, or right
+  // after processing a publication which doesn't need one, so readers are at
+  // most one debounce interval behind.
+  struct Snapshot {
+    // compact serialized adjacency databases, shared with LinkState
+    std::unordered_map<
+        std::string /* area */,
+        std::shared_ptr<const std::vector<std::shared_ptr<const std::string>>>>
+        adjacencyDbs;
+    int64_t adjacencyDbsVersion{0};
+    std::shared_ptr<const PrefixState> prefixState;
+    std::shared_ptr<const BestRoutesCache> bestRoutesCache;
+  };
+  folly::atomic_shared_ptr<const Snapshot> snapshot_;
+
+  // parts of snapshot_ which changed since it was published
+  std::unordered_set<std::string> snapshotDirtyAreas_;
+  bool snapshotPrefixStateDirty_{true};
+  bool snapshotBestRoutesDirty_{true};
+
   /**
    * Debounced trigger for rebuildRoutes invoked by input paths kvstore update
    * queue and static routes update queue
    */
   AsyncDebounce<std::chrono::milliseconds> rebuildRoutesDebounced_;
+
+  // Used instead of rebuildRoutesDebounced_ with adaptive debounce enabled
+  std::unique_ptr<AdaptiveDebounce> adaptiveRebuildDebounced_;
+
+  // Trigger debounced rebuildRoutes
+  void scheduleRebuildRoutes();
 };
 
 } // namespace openr
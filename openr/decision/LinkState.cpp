@@ -8,12 +8,19 @@
 #include "openr/decision/LinkState.h"
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <map>
+#include <queue>
+#include <tuple>
 #include <utility>
 
 #include <fb303/ServiceData.h>
 #include <folly/Format.h>
+#include <folly/futures/Future.h>
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
 
 namespace fb303 = facebook::fb303;
 
@@ -130,16 +137,27 @@ Link::Link(
     const std::string& if1,
     const std::string& nodeName2,
     const std::string& if2)
-    : area_(area),
-      n1_(nodeName1),
-      n2_(nodeName2),
-      if1_(if1),
-      if2_(if2),
-      orderedNames_(
-          std::minmax(std::make_pair(n1_, if1_), std::make_pair(n2_, if2_))),
+    : id1_(StringInterner::nodeNames().intern(nodeName1)),
+      id2_(StringInterner::nodeNames().intern(nodeName2)),
+      area_(StringInterner::areas().internAndGet(area)),
+      n1_(StringInterner::nodeNames().get(id1_)),
+      n2_(StringInterner::nodeNames().get(id2_)),
+      if1_(StringInterner::ifNames().internAndGet(if1)),
+      if2_(StringInterner::ifNames().internAndGet(if2)),
+      orderedNames_(std::minmax(
+          InternedNamePair(&n1_, &if1_),
+          InternedNamePair(&n2_, &if2_),
+          [](InternedNamePair const& a, InternedNamePair const& b) {
+            return std::tie(*a.first, *a.second) <
+                std::tie(*b.first, *b.second);
+          })),
       hash(std::hash<std::pair<
                std::pair<std::string, std::string>,
-               std::pair<std::string, std::string>>>()(orderedNames_)) {}
+               std::pair<std::string, std::string>>>()(std::make_pair(
+          std::make_pair(
+              *orderedNames_.first.first, *orderedNames_.first.second),
+          std::make_pair(
+              *orderedNames_.second.first, *orderedNames_.second.second)))) {}
 
 Link::Link(
     const std::string& area,
@@ -154,6 +172,10 @@ Link::Link(
   overload2_ = *adj2.isOverloaded_ref();
   adjLabel1_ = *adj1.adjLabel_ref();
   adjLabel2_ = *adj2.adjLabel_ref();
+  weight1_ = *adj1.weight_ref();
+  weight2_ = *adj2.weight_ref();
+  adminGroups1_ = *adj1.adminGroups_ref();
+  adminGroups2_ = *adj2.adminGroups_ref();
   nhV41_ = *adj1.nextHopV4_ref();
   nhV42_ = *adj2.nextHopV4_ref();
   nhV61_ = *adj1.nextHopV6_ref();
@@ -171,14 +193,35 @@ Link::getOtherNodeName(const std::string& nodeName) const {
   throw std::invalid_argument(nodeName);
 }
 
+LinkStateNodeId
+Link::getOtherNodeId(LinkStateNodeId nodeId) const {
+  if (id1_ == nodeId) {
+    return id2_;
+  }
+  if (id2_ == nodeId) {
+    return id1_;
+  }
+  throw std::invalid_argument(std::to_string(nodeId));
+}
+
 const std::string&
 Link::firstNodeName() const {
-  return orderedNames_.first.first;
+  return *orderedNames_.first.first;
 }
 
 const std::string&
 Link::secondNodeName() const {
-  return orderedNames_.second.first;
+  return *orderedNames_.second.first;
+}
+
+LinkStateNodeId
+Link::firstNodeId() const {
+  return orderedNames_.first.first == &n1_ ? id1_ : id2_;
+}
+
+LinkStateNodeId
+Link::secondNodeId() const {
+  return orderedNames_.first.first == &n1_ ? id2_ : id1_;
 }
 
 const std::string&
@@ -214,6 +257,28 @@ Link::getAdjLabelFromNode(const std::string& nodeName) const {
   throw std::invalid_argument(nodeName);
 }
 
+int64_t
+Link::getWeightFromNode(const std::string& nodeName) const {
+  if (n1_ == nodeName) {
+    return weight1_;
+  }
+  if (n2_ == nodeName) {
+    return weight2_;
+  }
+  throw std::invalid_argument(nodeName);
+}
+
+int64_t
+Link::getAdminGroupsFromNode(const std::string& nodeName) const {
+  if (n1_ == nodeName) {
+    return adminGroups1_;
+  }
+  if (n2_ == nodeName) {
+    return adminGroups2_;
+  }
+  throw std::invalid_argument(nodeName);
+}
+
 bool
 Link::getOverloadFromNode(const std::string& nodeName) const {
   if (n1_ == nodeName) {
@@ -325,6 +390,29 @@ Link::setAdjLabelFromNode(const std::string& nodeName, int32_t adjLabel) {
   }
 }
 
+void
+Link::setWeightFromNode(const std::string& nodeName, int64_t weight) {
+  if (n1_ == nodeName) {
+    weight1_ = weight;
+  } else if (n2_ == nodeName) {
+    weight2_ = weight;
+  } else {
+    throw std::invalid_argument(nodeName);
+  }
+}
+
+void
+Link::setAdminGroupsFromNode(
+    const std::string& nodeName, int64_t adminGroups) {
+  if (n1_ == nodeName) {
+    adminGroups1_ = adminGroups;
+  } else if (n2_ == nodeName) {
+    adminGroups2_ = adminGroups;
+  } else {
+    throw std::invalid_argument(nodeName);
+  }
+}
+
 bool
 Link::setOverloadFromNode(
     const std::string& nodeName,
@@ -349,7 +437,14 @@ Link::operator<(const Link& other) const {
   if (this->hash != other.hash) {
     return this->hash < other.hash;
   }
-  return this->orderedNames_ < other.orderedNames_;
+  auto const names = [](auto const& orderedNames) {
+    return std::tie(
+        *orderedNames.first.first,
+        *orderedNames.first.second,
+        *orderedNames.second.first,
+        *orderedNames.second.second);
+  };
+  return names(this->orderedNames_) < names(other.orderedNames_);
 }
 
 bool
@@ -376,7 +471,103 @@ Link::directionalToString(const std::string& fromNode) const {
       getIfaceFromNode(getOtherNodeName(fromNode)));
 }
 
-LinkState::LinkState(const std::string& area) : area_(area) {}
+namespace {
+// source of LinkState generations. Unique across instances so that results
+// memoized against one LinkState are never mistaken as valid for another
+std::atomic<uint64_t> nextGeneration{1};
+
+// SPF counters, bumped for every source node route computation runs SPF from
+StatCounter spfRunsCounter{"decision.spf_runs", fb303::COUNT};
+StatCounter spfBfsRunsCounter{"decision.spf_bfs_runs", fb303::COUNT};
+StatCounter spfTimeCounter{"decision.spf_ms", fb303::AVG};
+StatCounter incrementalSpfRunsCounter{
+    "decision.incremental_spf_runs", fb303::COUNT};
+StatCounter incrementalSpfTimeCounter{
+    "decision.incremental_spf_ms", fb303::AVG};
+} // namespace
+
+LinkState::LinkState(const std::string& area)
+    : area_(area), generation_(nextGeneration++) {}
+
+void
+LinkState::maybeBumpGeneration(LinkStateChange const& change) {
+  if (change.topologyChanged || change.linkAttributesChanged ||
+      change.nodeLabelChanged) {
+    generation_ = nextGeneration++;
+  }
+}
+
+std::shared_ptr<const LinkState::AdjacencyCsr>
+LinkState::getCsr() const {
+  {
+    auto csr = *csr_.rlock();
+    if (csr && csr->generation == generation_) {
+      return csr;
+    }
+  }
+  auto csr = csr_.wlock();
+  // another caller may have built it while we were waiting for the lock
+  if (!*csr || (*csr)->generation != generation_) {
+    *csr = buildCsr();
+  }
+  return *csr;
+}
+
+std::shared_ptr<const LinkState::AdjacencyCsr>
+LinkState::buildCsr() const {
+  auto csr = std::make_shared<AdjacencyCsr>();
+  csr->generation = generation_;
+
+  // every node of this LinkState was interned when its first link was made
+  auto const numNodes = StringInterner::nodeNames().size();
+  csr->nodeNames.resize(numNodes, nullptr);
+  csr->nodeOverloaded.resize(numNodes, false);
+  csr->rowOffsets.resize(numNodes + 1, 0);
+
+  std::vector<std::vector<std::shared_ptr<Link>>> rows(numNodes);
+  size_t numEdges = 0;
+  for (auto const& link : allLinks_) {
+    if (!link->isUp()) {
+      continue;
+    }
+    rows.at(link->firstNodeId()).push_back(link);
+    rows.at(link->secondNodeId()).push_back(link);
+    csr->nodeNames[link->firstNodeId()] = &link->firstNodeName();
+    csr->nodeNames[link->secondNodeId()] = &link->secondNodeName();
+    numEdges += 2;
+  }
+  csr->edgeTargets.reserve(numEdges);
+  csr->edgeMetrics.reserve(numEdges);
+  csr->edgeLinks.reserve(numEdges);
+
+  std::optional<LinkStateMetric> uniformMetric;
+  for (size_t nodeId = 0; nodeId < numNodes; ++nodeId) {
+    csr->rowOffsets[nodeId] = csr->edgeTargets.size();
+    auto& row = rows[nodeId];
+    if (row.empty()) {
+      continue;
+    }
+    auto const& nodeName = *csr->nodeNames[nodeId];
+    csr->nodeOverloaded[nodeId] = isNodeOverloaded(nodeName);
+    std::sort(row.begin(), row.end(), LinkPtrLess{});
+    for (auto& link : row) {
+      auto const metric = link->getMetricFromNode(nodeName);
+      if (!uniformMetric.has_value()) {
+        uniformMetric = metric;
+      } else if (*uniformMetric != metric) {
+        uniformMetric = 0;
+      }
+      csr->edgeTargets.push_back(link->getOtherNodeId(nodeId));
+      csr->edgeMetrics.push_back(metric);
+      csr->edgeLinks.push_back(std::move(link));
+    }
+  }
+  csr->rowOffsets[numNodes] = csr->edgeTargets.size();
+  csr->uniformMetric = uniformMetric.value_or(0);
+
+  fb303::fbData->addStatValue("decision.spf_csr_builds", 1, fb303::COUNT);
+  return csr;
+}
 
 size_t
 LinkState::LinkPtrHash::operator()(const std::shared_ptr<Link>& l) const {
@@ -431,6 +622,7 @@ LinkState::removeLink(std::shared_ptr<Link> link) {
   CHECK(linkMap_.at(link->firstNodeName()).erase(link));
   CHECK(linkMap_.at(link->secondNodeName()).erase(link));
   CHECK(allLinks_.erase(link));
+  heldLinks_.erase(link);
 }
 
 void
@@ -446,12 +638,14 @@ LinkState::removeNode(const std::string& nodeName) {
     try {
       CHECK(linkMap_.at(link->getOtherNodeName(nodeName)).erase(link));
       CHECK(allLinks_.erase(link));
+      heldLinks_.erase(link);
     } catch (std::out_of_range const& e) {
       LOG(FATAL) << "std::out_of_range for " << nodeName;
     }
   }
   linkMap_.erase(search);
   nodeOverloads_.erase(nodeName);
+  heldNodes_.erase(nodeName);
 }
 
 const LinkState::LinkSet&
@@ -464,6 +658,28 @@ LinkState::linksFromNode(const std::string& nodeName) const {
   return defaultEmptySet;
 }
 
+std::set<std::string> const&
+LinkState::getNodesWithLabel(int32_t label) const {
+  static const std::set<std::string> defaultEmptySet;
+  auto search = nodeLabelIndex_.find(label);
+  if (search != nodeLabelIndex_.end()) {
+    return search->second;
+  }
+  return defaultEmptySet;
+}
+
+void
+LinkState::unindexNodeLabel(const std::string& nodeName, int32_t label) {
+  auto search = nodeLabelIndex_.find(label);
+  if (search == nodeLabelIndex_.end()) {
+    return;
+  }
+  search->second.erase(nodeName);
+  if (search->second.empty()) {
+    nodeLabelIndex_.erase(search);
+  }
+}
+
 std::vector<std::shared_ptr<Link>>
 LinkState::orderedLinksFromNode(const std::string& nodeName) const {
   std::vector<std::shared_ptr<Link>> links;
@@ -484,8 +700,13 @@ LinkState::updateNodeOverloaded(
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
   if (nodeOverloads_.count(nodeName)) {
-    return nodeOverloads_.at(nodeName).updateValue(
-        isOverloaded, holdUpTtl, holdDownTtl);
+    auto& overload = nodeOverloads_.at(nodeName);
+    const bool changed =
+        overload.updateValue(isOverloaded, holdUpTtl, holdDownTtl);
+    if (overload.hasHold()) {
+      heldNodes_.insert(nodeName);
+    }
+    return changed;
   }
   nodeOverloads_.emplace(nodeName, HoldableValue<bool>{isOverloaded});
   // don't indicate LinkState changed if this is a new node
@@ -500,47 +721,88 @@ LinkState::isNodeOverloaded(const std::string& nodeName) const {
 LinkState::LinkStateChange
 LinkState::decrementHolds() {
   LinkStateChange change;
-  for (auto& link : allLinks_) {
-    change.topologyChanged |= link->decrementHolds();
+  LinkSet changedLinks;
+  std::unordered_set<std::string> changedNodes;
+  for (auto it = heldLinks_.begin(); it != heldLinks_.end();) {
+    auto const& link = *it;
+    if (link->hasHolds() and link->decrementHolds()) {
+      changedLinks.insert(link);
+    }
+    if (link->hasHolds()) {
+      ++it;
+    } else {
+      it = heldLinks_.erase(it);
+    }
   }
-  for (auto& kv : nodeOverloads_) {
-    change.topologyChanged |= kv.second.decrementTtl();
+  for (auto it = heldNodes_.begin(); it != heldNodes_.end();) {
+    auto& overload = nodeOverloads_.at(*it);
+    if (overload.decrementTtl()) {
+      changedNodes.insert(*it);
+    }
+    if (overload.hasHold()) {
+      ++it;
+    } else {
+      it = heldNodes_.erase(it);
+    }
   }
+  change.topologyChanged = !changedLinks.empty() || !changedNodes.empty();
   if (change.topologyChanged) {
-    spfResults_.clear();
-    kthPathResults_.clear();
+    recordTopologyChange(changedLinks, changedNodes);
   }
+  maybeBumpGeneration(change);
   return change;
 }
 
 bool
 LinkState::hasHolds() const {
-  for (auto& link : allLinks_) {
+  for (auto& link : heldLinks_) {
     if (link->hasHolds()) {
       return true;
     }
   }
-  for (auto& kv : nodeOverloads_) {
-    if (kv.second.hasHold()) {
+  for (auto& nodeName : heldNodes_) {
+    if (nodeOverloads_.at(nodeName).hasHold()) {
       return true;
     }
   }
   return false;
 }
 
+std::unordered_map<std::string, thrift::AdjacencyDatabase>
+LinkState::getAdjacencyDatabases() const {
+  std::unordered_map<std::string, thrift::AdjacencyDatabase> adjDbs;
+  adjDbs.reserve(adjacencyDatabases_.size());
+  for (auto const& [nodeName, nodeDb] : adjacencyDatabases_) {
+    adjDbs.emplace(
+        nodeName,
+        apache::thrift::CompactSerializer::deserialize<
+            thrift::AdjacencyDatabase>(*nodeDb.serializedDb));
+  }
+  return adjDbs;
+}
+
+std::optional<thrift::AdjacencyDatabase>
+LinkState::getAdjacencyDatabase(const std::string& nodeName) const {
+  auto it = adjacencyDatabases_.find(nodeName);
+  if (it == adjacencyDatabases_.end()) {
+    return std::nullopt;
+  }
+  return apache::thrift::CompactSerializer::deserialize<
+      thrift::AdjacencyDatabase>(*it->second.serializedDb);
+}
+
 std::shared_ptr<Link>
 LinkState::maybeMakeLink(
-    const std::string& nodeName, const thrift::Adjacency& adj) const {
+    const std::string& nodeName,
+    const thrift::Adjacency& adj,
+    const std::vector<thrift::Adjacency>& otherAdjs) const {
   // only return Link if it is bidirectional.
-  auto search = adjacencyDatabases_.find(*adj.otherNodeName_ref());
-  if (search != adjacencyDatabases_.end()) {
-    for (const auto& otherAdj : *search->second.adjacencies_ref()) {
-      if (nodeName == *otherAdj.otherNodeName_ref() &&
-          *adj.otherIfName_ref() == *otherAdj.ifName_ref() &&
-          *adj.ifName_ref() == *otherAdj.otherIfName_ref()) {
-        return std::make_shared<Link>(
-            area_, nodeName, adj, *adj.otherNodeName_ref(), otherAdj);
-      }
+  for (const auto& otherAdj : otherAdjs) {
+    if (nodeName == *otherAdj.otherNodeName_ref() &&
+        *adj.otherIfName_ref() == *otherAdj.ifName_ref() &&
+        *adj.ifName_ref() == *otherAdj.otherIfName_ref()) {
+      return std::make_shared<Link>(
+          area_, nodeName, adj, *adj.otherNodeName_ref(), otherAdj);
     }
   }
   return nullptr;
@@ -550,8 +812,22 @@ std::vector<std::shared_ptr<Link>>
 LinkState::getOrderedLinkSet(const thrift::AdjacencyDatabase& adjDb) const {
   std::vector<std::shared_ptr<Link>> links;
   links.reserve(adjDb.adjacencies_ref()->size());
+  // adjacencies of neighbors, deserialized once per neighbor. Unknown
+  // neighbors map to no adjacencies
+  std::unordered_map<std::string, std::vector<thrift::Adjacency>> otherAdjs;
   for (const auto& adj : *adjDb.adjacencies_ref()) {
-    auto linkPtr = maybeMakeLink(*adjDb.thisNodeName_ref(), adj);
+    auto const& otherNodeName = *adj.otherNodeName_ref();
+    auto it = otherAdjs.find(otherNodeName);
+    if (it == otherAdjs.end()) {
+      std::vector<thrift::Adjacency> adjs;
+      if (otherNodeName == *adjDb.thisNodeName_ref()) {
+        adjs = *adjDb.adjacencies_ref();
+      } else if (auto otherDb = getAdjacencyDatabase(otherNodeName)) {
+        adjs = std::move(*otherDb->adjacencies_ref());
+      }
+      it = otherAdjs.emplace(otherNodeName, std::move(adjs)).first;
+    }
+    auto linkPtr = maybeMakeLink(*adjDb.thisNodeName_ref(), adj, it->second);
     if (nullptr != linkPtr) {
       links.emplace_back(linkPtr);
     }
@@ -583,11 +859,15 @@ LinkState::updateAdjacencyDatabase(
             << ", rtt: " << *adj.rtt_ref();
   }
 
-  // Default construct if it did not exist
-  thrift::AdjacencyDatabase priorAdjacencyDb(
-      std::move(adjacencyDatabases_[nodeName]));
-  // replace
-  adjacencyDatabases_[nodeName] = newAdjacencyDb;
+  bool const isNewNode = not adjacencyDatabases_.count(nodeName);
+  // Default construct if it did not exist, replace
+  auto& nodeDb = adjacencyDatabases_[nodeName];
+  auto const priorNodeLabel = nodeDb.nodeLabel;
+  nodeDb.serializedDb = std::make_shared<const std::string>(
+      apache::thrift::CompactSerializer::serialize<std::string>(
+          newAdjacencyDb));
+  nodeDb.nodeLabel = *newAdjacencyDb.nodeLabel_ref();
+  nodeDb.numAdjacencies = newAdjacencyDb.adjacencies_ref()->size();
 
   // for comparing old and new state, we order the links based on the tuple
   // <nodeName1, iface1, nodeName2, iface2>, this allows us to easily discern
@@ -595,15 +875,28 @@ LinkState::updateAdjacencyDatabase(
   auto oldLinks = orderedLinksFromNode(nodeName);
   auto newLinks = getOrderedLinkSet(newAdjacencyDb);
 
-  // fill these sets with the appropriate links
-  std::unordered_set<Link> linksUp;
-  std::unordered_set<Link> linksDown;
+  // links and nodes whose change altered the topology
+  LinkSet changedLinks;
+  std::unordered_set<std::string> changedNodes;
+  // whether anything but overload changes altered the topology
+  bool nonDrainTopologyChange = false;
 
-  change.topologyChanged |= updateNodeOverloaded(
-      nodeName, *newAdjacencyDb.isOverloaded_ref(), holdUpTtl, holdDownTtl);
+  if (updateNodeOverloaded(
+          nodeName,
+          *newAdjacencyDb.isOverloaded_ref(),
+          holdUpTtl,
+          holdDownTtl)) {
+    change.topologyChanged = true;
+    changedNodes.insert(nodeName);
+  }
 
-  change.nodeLabelChanged =
-      *priorAdjacencyDb.nodeLabel_ref() != *newAdjacencyDb.nodeLabel_ref();
+  change.nodeLabelChanged = priorNodeLabel != *newAdjacencyDb.nodeLabel_ref();
+  if (isNewNode or change.nodeLabelChanged) {
+    if (not isNewNode) {
+      unindexNodeLabel(nodeName, priorNodeLabel);
+    }
+    nodeLabelIndex_[*newAdjacencyDb.nodeLabel_ref()].emplace(nodeName);
+  }
 
   auto newIter = newLinks.begin();
   auto oldIter = oldLinks.begin();
@@ -613,7 +906,14 @@ LinkState::updateAdjacencyDatabase(
       // newIter is pointing at a Link not currently present, record this as a
       // link to add and advance newIter
       (*newIter)->setHoldUpTtl(holdUpTtl);
-      change.topologyChanged |= (*newIter)->isUp();
+      if ((*newIter)->hasHolds()) {
+        heldLinks_.insert(*newIter);
+      }
+      if ((*newIter)->isUp()) {
+        change.topologyChanged = true;
+        nonDrainTopologyChange = true;
+        changedLinks.insert(*newIter);
+      }
       // even if we are holding a change, we apply the change to our link state
       // and check for holds when running spf. this ensures we don't add the
       // same hold twice
@@ -628,7 +928,11 @@ LinkState::updateAdjacencyDatabase(
       // as a link to remove and advance oldIter.
       // If this link was previously overloaded or had a hold up, this does not
       // change the topology.
-      change.topologyChanged |= (*oldIter)->isUp();
+      if ((*oldIter)->isUp()) {
+        change.topologyChanged = true;
+        nonDrainTopologyChange = true;
+        changedLinks.insert(*oldIter);
+      }
       removeLink(*oldIter);
       VLOG(1) << "[LINK DOWN] " << (*oldIter)->toString();
       ++oldIter;
@@ -648,11 +952,18 @@ LinkState::updateAdjacencyDatabase(
           newLink.directionalToString(nodeName),
           oldLink.getMetricFromNode(nodeName),
           newLink.getMetricFromNode(nodeName));
-      change.topologyChanged |= oldLink.setMetricFromNode(
-          nodeName,
-          newLink.getMetricFromNode(nodeName),
-          holdUpTtl,
-          holdDownTtl);
+      if (oldLink.setMetricFromNode(
+              nodeName,
+              newLink.getMetricFromNode(nodeName),
+              holdUpTtl,
+              holdDownTtl)) {
+        change.topologyChanged = true;
+        nonDrainTopologyChange = true;
+        changedLinks.insert(*oldIter);
+      }
+      if (oldLink.hasHolds()) {
+        heldLinks_.insert(*oldIter);
+      }
     }
 
     if (newLink.getOverloadFromNode(nodeName) !=
@@ -662,11 +973,17 @@ LinkState::updateAdjacencyDatabase(
           newLink.directionalToString(nodeName),
           oldLink.getOverloadFromNode(nodeName),
           newLink.getOverloadFromNode(nodeName));
-      change.topologyChanged |= oldLink.setOverloadFromNode(
-          nodeName,
-          newLink.getOverloadFromNode(nodeName),
-          holdUpTtl,
-          holdDownTtl);
+      if (oldLink.setOverloadFromNode(
+              nodeName,
+              newLink.getOverloadFromNode(nodeName),
+              holdUpTtl,
+              holdDownTtl)) {
+        change.topologyChanged = true;
+        changedLinks.insert(*oldIter);
+      }
+      if (oldLink.hasHolds()) {
+        heldLinks_.insert(*oldIter);
+      }
     }
 
     // Check if adjacency label has changed
@@ -685,6 +1002,33 @@ LinkState::updateAdjacencyDatabase(
           nodeName, newLink.getAdjLabelFromNode(nodeName));
     }
 
+    // Check if adjacency weight has changed
+    if (newLink.getWeightFromNode(nodeName) !=
+        oldLink.getWeightFromNode(nodeName)) {
+      VLOG(1) << folly::sformat(
+          "[LINK UPDATE] Weight change on link {}: {} => {}",
+          newLink.directionalToString(nodeName),
+          oldLink.getWeightFromNode(nodeName),
+          newLink.getWeightFromNode(nodeName));
+
+      change.linkAttributesChanged |= true;
+      oldLink.setWeightFromNode(nodeName, newLink.getWeightFromNode(nodeName));
+    }
+
+    // Check if administrative groups have changed
+    if (newLink.getAdminGroupsFromNode(nodeName) !=
+        oldLink.getAdminGroupsFromNode(nodeName)) {
+      VLOG(1) << folly::sformat(
+          "[LINK UPDATE] Admin groups change on link {}: {:#x} => {:#x}",
+          newLink.directionalToString(nodeName),
+          oldLink.getAdminGroupsFromNode(nodeName),
+          newLink.getAdminGroupsFromNode(nodeName));
+
+      change.linkAttributesChanged |= true;
+      oldLink.setAdminGroupsFromNode(
+          nodeName, newLink.getAdminGroupsFromNode(nodeName));
+    }
+
     // check if local nextHops Changed
     if (newLink.getNhV4FromNode(nodeName) !=
         oldLink.getNhV4FromNode(nodeName)) {
@@ -711,10 +1055,11 @@ LinkState::updateAdjacencyDatabase(
     ++newIter;
     ++oldIter;
   }
+  change.onlyDrainChanged = change.topologyChanged && !nonDrainTopologyChange;
   if (change.topologyChanged) {
-    spfResults_.clear();
-    kthPathResults_.clear();
+    recordTopologyChange(changedLinks, changedNodes);
   }
+  maybeBumpGeneration(change);
   return change;
 }
 
@@ -725,15 +1070,18 @@ LinkState::deleteAdjacencyDatabase(const std::string& nodeName) {
   auto search = adjacencyDatabases_.find(nodeName);
 
   if (search != adjacencyDatabases_.end()) {
+    // all links of the node are going away
+    LinkSet changedLinks = linksFromNode(nodeName);
     removeNode(nodeName);
+    unindexNodeLabel(nodeName, search->second.nodeLabel);
     adjacencyDatabases_.erase(search);
-    spfResults_.clear();
-    kthPathResults_.clear();
+    recordTopologyChange(changedLinks, {});
     change.topologyChanged = true;
   } else {
     LOG(WARNING) << "Trying to delete adjacency db for non-existing node "
                  << nodeName;
   }
+  maybeBumpGeneration(change);
   return change;
 }
 
@@ -754,43 +1102,622 @@ std::vector<LinkState::Path> const&
 LinkState::getKthPaths(
     const std::string& src, const std::string& dest, size_t k) const {
   CHECK_GE(k, 1);
+  {
+    auto memo = memo_.rlock();
+    auto entryIter = memo->kthPathResults.find(std::make_tuple(src, dest, k));
+    if (memo->kthPathResults.end() != entryIter) {
+      return entryIter->second;
+    }
+  }
+  auto memo = memo_.wlock();
+  return getKthPathsLocked(*memo, src, dest, k);
+}
+
+std::vector<LinkState::Path> const&
+LinkState::getKthPathsLocked(
+    Memo& memo,
+    const std::string& src,
+    const std::string& dest,
+    size_t k) const {
   std::tuple<std::string, std::string, size_t> key(src, dest, k);
-  auto entryIter = kthPathResults_.find(key);
-  if (kthPathResults_.end() == entryIter) {
-    LinkSet linksToIgnore;
-    for (size_t i = 1; i < k; ++i) {
-      for (auto const& path : getKthPaths(src, dest, i)) {
-        for (auto const& link : path) {
-          linksToIgnore.insert(link);
-        }
+  auto entryIter = memo.kthPathResults.find(key);
+  if (memo.kthPathResults.end() == entryIter) {
+    auto const linksToIgnore = getLinksOfLowerPathsLocked(memo, src, dest, k);
+    auto const& res = linksToIgnore.empty()
+        ? getSpfResultLocked(memo, {src, true})
+        : runSpf(src, true, linksToIgnore);
+    entryIter =
+        memo.kthPathResults.emplace(key, tracePaths(src, dest, res)).first;
+  }
+  return entryIter->second;
+}
+
+LinkState::LinkSet
+LinkState::getLinksOfLowerPathsLocked(
+    Memo& memo,
+    const std::string& src,
+    const std::string& dest,
+    size_t k) const {
+  LinkSet links;
+  for (size_t i = 1; i < k; ++i) {
+    for (auto const& path : getKthPathsLocked(memo, src, dest, i)) {
+      for (auto const& link : path) {
+        links.insert(link);
       }
     }
-    std::vector<LinkState::Path> paths;
-    auto const& res = linksToIgnore.empty() ? getSpfResult(src, true)
-                                            : runSpf(src, true, linksToIgnore);
-    if (res.count(dest)) {
-      LinkSet visitedLinks;
-      auto path = traceOnePath(src, dest, res, visitedLinks);
-      while (path && !path->empty()) {
-        paths.push_back(std::move(*path));
-        path = traceOnePath(src, dest, res, visitedLinks);
+  }
+  return links;
+}
+
+std::vector<LinkState::Path>
+LinkState::tracePaths(
+    const std::string& src,
+    const std::string& dest,
+    SpfResult const& result) const {
+  std::vector<LinkState::Path> paths;
+  if (result.count(dest)) {
+    LinkSet visitedLinks;
+    auto path = traceOnePath(src, dest, result, visitedLinks);
+    while (path && !path->empty()) {
+      paths.push_back(std::move(*path));
+      path = traceOnePath(src, dest, result, visitedLinks);
+    }
+  }
+  return paths;
+}
+
+void
+LinkState::computeKthPaths(
+    const std::string& src,
+    std::vector<std::string> const& dests,
+    size_t k,
+    folly::Executor* executor) const {
+  CHECK_GE(k, 1);
+  if (k > 1) {
+    computeKthPaths(src, dests, k - 1, executor);
+  }
+
+  // SPF runs needed for dests, keyed on the links they ignore
+  struct SpfRun {
+    LinkSet linksToIgnore;
+    std::vector<std::string const*> dests;
+    SpfResult result;
+  };
+  std::vector<SpfRun> runs;
+  {
+    auto memo = memo_.wlock();
+    std::map<std::vector<Link const*>, size_t> runIndex;
+    for (auto const& dest : dests) {
+      if (memo->kthPathResults.count(std::make_tuple(src, dest, k))) {
+        continue;
       }
+      auto linksToIgnore = getLinksOfLowerPathsLocked(*memo, src, dest, k);
+      if (linksToIgnore.empty()) {
+        // served from the memoized shortest paths of src
+        getKthPathsLocked(*memo, src, dest, k);
+        continue;
+      }
+      std::vector<Link const*> runKey;
+      runKey.reserve(linksToIgnore.size());
+      for (auto const& link : linksToIgnore) {
+        runKey.emplace_back(link.get());
+      }
+      std::sort(runKey.begin(), runKey.end());
+      auto [it, inserted] = runIndex.emplace(std::move(runKey), runs.size());
+      if (inserted) {
+        runs.emplace_back(SpfRun{std::move(linksToIgnore), {}, {}});
+      }
+      runs.at(it->second).dests.emplace_back(&dest);
+    }
+  }
+  if (runs.empty()) {
+    return;
+  }
+
+  // runSpf only reads the topology, distinct runs can go in parallel
+  if (executor and runs.size() > 1) {
+    std::vector<folly::Future<folly::Unit>> futures;
+    futures.reserve(runs.size());
+    for (auto& run : runs) {
+      futures.emplace_back(
+          folly::via(folly::getKeepAliveToken(executor), [&src, &run, this]() {
+            run.result = runSpf(src, true, run.linksToIgnore);
+          }));
+    }
+    folly::collect(futures).get();
+  } else {
+    for (auto& run : runs) {
+      run.result = runSpf(src, true, run.linksToIgnore);
+    }
+  }
+
+  auto memo = memo_.wlock();
+  for (auto const& run : runs) {
+    for (auto const* dest : run.dests) {
+      memo->kthPathResults.emplace(
+          std::make_tuple(src, *dest, k), tracePaths(src, *dest, run.result));
     }
-    entryIter = kthPathResults_.emplace(key, std::move(paths)).first;
   }
-  return entryIter->second;
 }
 
 LinkState::SpfResult const&
 LinkState::getSpfResult(
     const std::string& thisNodeName, bool useLinkMetric) const {
   std::pair<std::string, bool> key{thisNodeName, useLinkMetric};
-  auto entryIter = spfResults_.find(key);
-  if (spfResults_.end() == entryIter) {
-    auto res = runSpf(thisNodeName, useLinkMetric);
-    entryIter = spfResults_.emplace(std::move(key), std::move(res)).first;
+  {
+    // fast path, the memoized result is up to date
+    auto memo = memo_.rlock();
+    auto entryIter = memo->spfResults.find(key);
+    if (memo->spfResults.end() != entryIter &&
+        !entryIter->second.hasPendingChanges()) {
+      return entryIter->second.result;
+    }
   }
-  return entryIter->second;
+  auto memo = memo_.wlock();
+  return getSpfResultLocked(*memo, std::move(key));
+}
+
+LinkState::SpfResult const&
+LinkState::getSpfResultLocked(
+    Memo& memo, std::pair<std::string, bool> key) const {
+  auto const& [thisNodeName, useLinkMetric] = key;
+  auto entryIter = memo.spfResults.find(key);
+  if (memo.spfResults.end() == entryIter) {
+    MemoizedSpfResult memoized;
+    memoized.result = runSpf(thisNodeName, useLinkMetric);
+    entryIter = memo.spfResults.emplace(key, std::move(memoized)).first;
+  }
+  auto& memoized = entryIter->second;
+  if (memoized.hasPendingChanges()) {
+    if (!updateSpfResult(thisNodeName, useLinkMetric, memoized)) {
+      memoized.result = runSpf(thisNodeName, useLinkMetric);
+    }
+    memoized.changedLinks.clear();
+    memoized.changedNodes.clear();
+  }
+  return memoized.result;
+}
+
+std::unordered_map<std::string, double>
+LinkState::getUcmpCapacities(
+    const std::string& src, std::vector<std::string> dests) const {
+  std::sort(dests.begin(), dests.end());
+  auto key = std::make_pair(src, std::move(dests));
+  {
+    auto memo = memo_.rlock();
+    auto entryIter = memo->ucmpCapacities.find(key);
+    if (memo->ucmpCapacities.end() != entryIter &&
+        entryIter->second.first == generation_) {
+      return entryIter->second.second;
+    }
+  }
+
+  auto const& spfResult = getSpfResult(src);
+
+  // walk the shortest path DAG back from dests, aggregating the weight of
+  // the links between each node and its downstream neighbors. Non positive
+  // weights are taken as the default weight of 1
+  std::unordered_map<
+      std::string,
+      std::unordered_map<std::string /* downstream */, double /* weight */>>
+      downstream;
+  std::unordered_set<std::string> visited;
+  std::vector<std::string> toVisit;
+  for (auto const& dest : key.second) {
+    if (dest != src && spfResult.count(dest) && visited.insert(dest).second) {
+      toVisit.emplace_back(dest);
+    }
+  }
+  while (!toVisit.empty()) {
+    auto node = std::move(toVisit.back());
+    toVisit.pop_back();
+    for (auto const& pathLink : spfResult.at(node).pathLinks()) {
+      auto const& prevNode = pathLink.prevNode;
+      downstream[prevNode][node] += static_cast<double>(
+          std::max<int64_t>(pathLink.link->getWeightFromNode(prevNode), 1));
+      if (prevNode != src && visited.insert(prevNode).second) {
+        toVisit.emplace_back(prevNode);
+      }
+    }
+  }
+
+  // downstream nodes are further from src, compute their capacity first
+  std::vector<std::pair<LinkStateMetric, std::string const*>> order;
+  order.reserve(visited.size());
+  for (auto const& node : visited) {
+    order.emplace_back(spfResult.at(node).metric(), &node);
+  }
+  std::sort(order.begin(), order.end(), [](auto const& a, auto const& b) {
+    return a.first > b.first;
+  });
+  std::unordered_set<std::string> const destSet(
+      key.second.begin(), key.second.end());
+  std::unordered_map<std::string, double> capacities;
+  auto pathCapacity = [&](std::string const& node) {
+    double capacity = 0;
+    for (auto const& [nextNode, weight] : downstream[node]) {
+      // only unordered across zero metric links, bounded by the links then
+      auto it = capacities.find(nextNode);
+      capacity +=
+          it != capacities.end() ? std::min(weight, it->second) : weight;
+    }
+    return capacity;
+  };
+  for (auto const& [_, node] : order) {
+    capacities[*node] = destSet.count(*node)
+        ? std::numeric_limits<double>::infinity()
+        : pathCapacity(*node);
+  }
+
+  std::unordered_map<std::string, double> result;
+  for (auto const& [neighbor, weight] : downstream[src]) {
+    auto it = capacities.find(neighbor);
+    result.emplace(
+        neighbor,
+        it != capacities.end() ? std::min(weight, it->second) : weight);
+  }
+
+  auto memo = memo_.wlock();
+  memo->ucmpCapacities[std::move(key)] = std::make_pair(generation_, result);
+  return result;
+}
+
+LinkState::NextHopIndex::NextHopIndex(
+    std::string const& src,
+    LinkSet const& links,
+    SpfResult const& spfResult) {
+  // only up links of least metric towards a neighbor are along shortest
+  // paths through it
+  std::unordered_map<std::string, Bits> neighborLinks;
+  for (auto const& link : links) {
+    auto const& neighbor = link->getOtherNodeName(src);
+    auto it = spfResult.find(neighbor);
+    if (!link->isUp() || it == spfResult.end() ||
+        link->getMetricFromNode(src) != it->second.metric()) {
+      continue;
+    }
+    auto const index = links_.size();
+    links_.emplace_back(link);
+    auto& bits = neighborLinks[neighbor];
+    bits.resize(index / 64 + 1, 0);
+    bits[index / 64] |= uint64_t{1} << (index % 64);
+  }
+
+  nextHopLinks_.reserve(spfResult.size());
+  for (auto const& [node, nodeResult] : spfResult) {
+    auto& bits = nextHopLinks_[node];
+    for (auto const& nextHop : nodeResult.nextHops()) {
+      auto it = neighborLinks.find(nextHop);
+      if (it != neighborLinks.end()) {
+        unite(bits, it->second);
+      }
+    }
+  }
+}
+
+LinkState::NextHopIndex::Bits const*
+LinkState::NextHopIndex::getNextHopLinks(std::string const& node) const {
+  auto it = nextHopLinks_.find(node);
+  return it != nextHopLinks_.end() ? &it->second : nullptr;
+}
+
+void
+LinkState::NextHopIndex::unite(Bits& bits, Bits const& other) {
+  if (bits.size() < other.size()) {
+    bits.resize(other.size(), 0);
+  }
+  for (size_t word = 0; word < other.size(); ++word) {
+    bits[word] |= other[word];
+  }
+}
+
+std::shared_ptr<const LinkState::NextHopIndex>
+LinkState::getNextHopIndex(const std::string& src) const {
+  {
+    auto memo = memo_.rlock();
+    auto entryIter = memo->nextHopIndices.find(src);
+    if (memo->nextHopIndices.end() != entryIter &&
+        entryIter->second.first == generation_) {
+      return entryIter->second.second;
+    }
+  }
+
+  auto index = std::make_shared<const NextHopIndex>(
+      src, linksFromNode(src), getSpfResult(src));
+  auto memo = memo_.wlock();
+  memo->nextHopIndices[src] = std::make_pair(generation_, index);
+  return index;
+}
+
+void
+LinkState::recordTopologyChange(
+    LinkSet const& changedLinks,
+    std::unordered_set<std::string> const& changedNodes) {
+  auto memo = memo_.wlock();
+  for (auto& [_, memoized] : memo->spfResults) {
+    memoized.changedLinks.insert(changedLinks.begin(), changedLinks.end());
+    memoized.changedNodes.insert(changedNodes.begin(), changedNodes.end());
+  }
+  memo->kthPathResults.clear();
+  memo->ucmpCapacities.clear();
+  memo->nextHopIndices.clear();
+}
+
+bool
+LinkState::updateSpfResult(
+    const std::string& src, bool useLinkMetric, MemoizedSpfResult& memo) const {
+  auto& result = memo.result;
+  if (!result.count(src)) {
+    return false;
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+
+  auto const linkMetric = [useLinkMetric](
+                              Link const& link, std::string const& from) {
+    return useLinkMetric ? link.getMetricFromNode(from) : 1;
+  };
+  // same transit rule as runSpf(): no traffic through overloaded nodes
+  auto const canTransit = [this, &src](std::string const& node) {
+    return node == src || !isNodeOverloaded(node);
+  };
+  // true if `child` reached `parent` over `link` on one of its shortest paths
+  auto const isSpfChild = [&result](
+                              std::string const& parent,
+                              Link const& link,
+                              std::string const& child) {
+    auto it = result.find(child);
+    if (it == result.end()) {
+      return false;
+    }
+    for (auto const& pathLink : it->second.pathLinks()) {
+      if (pathLink.prevNode == parent && *pathLink.link == link) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  //
+  // Step 1: find the nodes that had at least one shortest path going through
+  // a changed link or a node whose overload changed, i.e. the subtrees of the
+  // shortest path DAG hanging off of changed elements. Their distance may
+  // grow, so they lose their current result.
+  //
+  std::unordered_set<std::string> affected;
+  auto const addSubtree = [&](std::string const& root) {
+    std::vector<std::string> stack{root};
+    while (!stack.empty()) {
+      auto node = std::move(stack.back());
+      stack.pop_back();
+      if (node == src || !affected.insert(node).second) {
+        continue;
+      }
+      for (auto const& link : linksFromNode(node)) {
+        auto const& other = link->getOtherNodeName(node);
+        if (isSpfChild(node, *link, other)) {
+          stack.push_back(other);
+        }
+      }
+    }
+  };
+  for (auto const& link : memo.changedLinks) {
+    auto const& n1 = link->firstNodeName();
+    auto const& n2 = link->secondNodeName();
+    if (isSpfChild(n1, *link, n2)) {
+      addSubtree(n2);
+    }
+    if (isSpfChild(n2, *link, n1)) {
+      addSubtree(n1);
+    }
+  }
+  for (auto const& node : memo.changedNodes) {
+    for (auto const& link : linksFromNode(node)) {
+      auto const& other = link->getOtherNodeName(node);
+      if (isSpfChild(node, *link, other)) {
+        addSubtree(other);
+      }
+    }
+  }
+
+  // past this point full recomputation is cheaper
+  if (affected.size() * 2 > result.size()) {
+    return false;
+  }
+
+  //
+  // Step 2: recompute distances with Dijkstra seeded from the boundary of the
+  // affected region and from changed elements that may offer shorter paths.
+  // Unaffected nodes keep their distance unless they are relaxed to a
+  // strictly smaller one.
+  //
+  std::unordered_map<std::string, LinkStateMetric> newDistances;
+  std::priority_queue<
+      std::pair<LinkStateMetric, std::string>,
+      std::vector<std::pair<LinkStateMetric, std::string>>,
+      std::greater<std::pair<LinkStateMetric, std::string>>>
+      heap;
+  auto const distance =
+      [&](std::string const& node) -> std::optional<LinkStateMetric> {
+    auto newIt = newDistances.find(node);
+    if (newIt != newDistances.end()) {
+      return newIt->second;
+    }
+    if (affected.count(node)) {
+      return std::nullopt;
+    }
+    auto it = result.find(node);
+    if (it != result.end()) {
+      return it->second.metric();
+    }
+    return std::nullopt;
+  };
+  auto const relax = [&](std::string const& node, LinkStateMetric metric) {
+    auto const current = distance(node);
+    if (!current.has_value() || metric < *current) {
+      newDistances[node] = metric;
+      heap.emplace(metric, node);
+    }
+  };
+  // relax all links out of `node` using its distance prior to this update
+  auto const relaxFrom = [&](std::string const& node) {
+    if (affected.count(node) || !result.count(node) || !canTransit(node)) {
+      return;
+    }
+    auto const metric = result.at(node).metric();
+    for (auto const& link : linksFromNode(node)) {
+      if (link->isUp()) {
+        relax(link->getOtherNodeName(node), metric + linkMetric(*link, node));
+      }
+    }
+  };
+  for (auto const& node : affected) {
+    for (auto const& link : linksFromNode(node)) {
+      auto const& other = link->getOtherNodeName(node);
+      if (link->isUp() && !affected.count(other) && result.count(other) &&
+          canTransit(other)) {
+        relax(node, result.at(other).metric() + linkMetric(*link, other));
+      }
+    }
+  }
+  for (auto const& link : memo.changedLinks) {
+    relaxFrom(link->firstNodeName());
+    relaxFrom(link->secondNodeName());
+  }
+  for (auto const& node : memo.changedNodes) {
+    relaxFrom(node);
+  }
+
+  std::unordered_set<std::string> settled;
+  while (!heap.empty()) {
+    auto [metric, node] = heap.top();
+    heap.pop();
+    if (newDistances.at(node) != metric || !settled.insert(node).second) {
+      // stale heap entry
+      continue;
+    }
+    if (!canTransit(node)) {
+      continue;
+    }
+    for (auto const& link : linksFromNode(node)) {
+      if (link->isUp()) {
+        relax(link->getOtherNodeName(node), metric + linkMetric(*link, node));
+      }
+    }
+  }
+
+  for (auto const& node : affected) {
+    if (!newDistances.count(node)) {
+      // no longer reachable
+      result.erase(node);
+    }
+  }
+  for (auto const& [node, metric] : newDistances) {
+    auto it = result.find(node);
+    if (it == result.end()) {
+      result.emplace(node, NodeSpfResult(metric));
+    } else {
+      it->second.reset(metric);
+    }
+  }
+
+  //
+  // Step 3: rebuild path links and nexthops. A node needs this if its own
+  // distance changed, if a neighbor's distance or transit ability changed, or
+  // if one of its links changed. Nexthop changes then propagate down to the
+  // node's children. Nodes are visited in the same (metric, name) order
+  // runSpf() finalizes them so path links end up in the same order.
+  //
+  std::unordered_set<std::string> dirty;
+  auto const addWithNeighbors = [&](std::string const& node) {
+    dirty.insert(node);
+    for (auto const& link : linksFromNode(node)) {
+      dirty.insert(link->getOtherNodeName(node));
+    }
+  };
+  for (auto const& node : affected) {
+    addWithNeighbors(node);
+  }
+  for (auto const& [node, _] : newDistances) {
+    addWithNeighbors(node);
+  }
+  for (auto const& link : memo.changedLinks) {
+    dirty.insert(link->firstNodeName());
+    dirty.insert(link->secondNodeName());
+  }
+  for (auto const& node : memo.changedNodes) {
+    addWithNeighbors(node);
+  }
+
+  for (auto const& node : dirty) {
+    auto it = result.find(node);
+    if (node != src && it != result.end()) {
+      heap.emplace(it->second.metric(), node);
+    }
+  }
+  std::unordered_set<std::string> rebuilt;
+  while (!heap.empty()) {
+    auto [metric, node] = heap.top();
+    heap.pop();
+    if (!rebuilt.insert(node).second) {
+      continue;
+    }
+
+    // parents are the neighbors along a shortest path, ordered the way
+    // runSpf() would have finalized them
+    std::vector<std::pair<LinkStateMetric, std::string>> parents;
+    for (auto const& link : linksFromNode(node)) {
+      auto const& other = link->getOtherNodeName(node);
+      auto otherIt = result.find(other);
+      if (link->isUp() && otherIt != result.end() && canTransit(other) &&
+          otherIt->second.metric() + linkMetric(*link, other) == metric) {
+        parents.emplace_back(otherIt->second.metric(), other);
+      }
+    }
+    std::sort(parents.begin(), parents.end());
+    parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+
+    NodeSpfResult nodeResult(metric);
+    for (auto const& [parentMetric, parent] : parents) {
+      auto const& parentNextHops = result.at(parent).nextHops();
+      for (auto const& link : linksFromNode(parent)) {
+        if (!link->isUp() || link->getOtherNodeName(parent) != node ||
+            parentMetric + linkMetric(*link, parent) != metric) {
+          continue;
+        }
+        nodeResult.addPath(link, parent);
+        nodeResult.addNextHops(parentNextHops);
+        if (nodeResult.nextHops().empty()) {
+          // directly connected node
+          nodeResult.addNextHop(node);
+        }
+      }
+    }
+
+    auto& currentResult = result.at(node);
+    bool const nextHopsChanged =
+        currentResult.nextHops() != nodeResult.nextHops();
+    currentResult = std::move(nodeResult);
+    if (!nextHopsChanged || !canTransit(node)) {
+      continue;
+    }
+    for (auto const& link : linksFromNode(node)) {
+      auto const& child = link->getOtherNodeName(node);
+      auto childIt = result.find(child);
+      if (link->isUp() && child != src && childIt != result.end() &&
+          metric + linkMetric(*link, node) == childIt->second.metric()) {
+        heap.emplace(childIt->second.metric(), child);
+      }
+    }
+  }
+
+  incrementalSpfRunsCounter.add();
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  VLOG(3) << "Incremental SPF recomputed " << rebuilt.size() << " of "
+          << result.size() << " nodes in " << deltaTime.count() << "ms.";
+  incrementalSpfTimeCounter.add(deltaTime.count());
+  return true;
 }
 
 /**
@@ -803,24 +1730,62 @@ LinkState::runSpf(
     const LinkState::LinkSet& linksToIgnore) const {
   LinkState::SpfResult result;
 
-  fb303::fbData->addStatValue("decision.spf_runs", 1, fb303::COUNT);
+  spfRunsCounter.add();
   const auto startTime = std::chrono::steady_clock::now();
 
-  DijkstraQ q;
-  q.insertNode(thisNodeName, 0);
+  auto const maybeSrcId = StringInterner::nodeNames().find(thisNodeName);
+  if (!maybeSrcId.has_value()) {
+    // node has never had any links, it can only reach itself
+    result.emplace(thisNodeName, NodeSpfResult(0));
+    return result;
+  }
+  auto const srcId = *maybeSrcId;
+  auto const csr = getCsr();
+  if (srcId >= csr->numNodes()) {
+    // interned after the CSR was built, so there are no links from this node
+    result.emplace(thisNodeName, NodeSpfResult(0));
+    return result;
+  }
+
+  if (auto const uniformMetric = useLinkMetric ? csr->uniformMetric : 1;
+      uniformMetric != 0) {
+    result = runBfs(*csr, thisNodeName, srcId, uniformMetric, linksToIgnore);
+    auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime);
+    spfBfsRunsCounter.add();
+    spfTimeCounter.add(deltaTime.count());
+    return result;
+  }
+
+  // per node state indexed by node id. nodes never reached keep the max
+  // metric
+  auto const numNodes = csr->numNodes();
+  std::vector<NodeSpfResult> nodeResults(
+      numNodes, NodeSpfResult(std::numeric_limits<LinkStateMetric>::max()));
+  std::vector<bool> settled(numNodes, false);
+  std::vector<LinkStateNodeId> settledOrder;
+  // the source may have no up links, and so no name in the CSR
+  auto const nodeName = [&](LinkStateNodeId nodeId) -> std::string const& {
+    return nodeId == srcId ? thisNodeName : *csr->nodeNames[nodeId];
+  };
+
+  DijkstraQ q(numNodes);
+  q.insertNode(srcId, 0);
+  nodeResults[srcId].reset(0);
   uint64_t loop = 0;
-  while (auto node = q.extractMin()) {
+  while (!q.empty()) {
     ++loop;
     // we've found this node's shortest paths. record it
-    auto emplaceRc = result.emplace(node->nodeName, std::move(node->result));
-    CHECK(emplaceRc.second);
+    auto const recordedNodeId = q.extractMin();
+    settled[recordedNodeId] = true;
+    settledOrder.push_back(recordedNodeId);
 
-    auto const& recordedNodeName = emplaceRc.first->first;
-    auto const recordedNodeMetric = emplaceRc.first->second.metric();
-    auto const& recordedNodeNextHops = emplaceRc.first->second.nextHops();
+    auto const& recordedNodeName = nodeName(recordedNodeId);
+    auto const& recordedNodeResult = nodeResults[recordedNodeId];
+    auto const recordedNodeMetric = recordedNodeResult.metric();
+    auto const& recordedNodeNextHops = recordedNodeResult.nextHops();
 
-    if (isNodeOverloaded(recordedNodeName) &&
-        recordedNodeName != thisNodeName) {
+    if (csr->nodeOverloaded[recordedNodeId] && recordedNodeId != srcId) {
       // no transit traffic through this node. we've recorded the nexthops to
       // this node, but will not consider any of it's adjancecies as offering
       // lower cost paths towards further away nodes. This effectively drains
@@ -832,43 +1797,125 @@ LinkState::runSpf(
     // already have a lower cost path from thisNodeName
     //
     // this is the "relax" step in the Dijkstra Algorithm pseudocode in CLRS
-    for (const auto& link : linksFromNode(recordedNodeName)) {
-      auto& otherNodeName = link->getOtherNodeName(recordedNodeName);
-      if (!link->isUp() or result.count(otherNodeName) or
-          linksToIgnore.count(link)) {
+    for (auto edge = csr->rowOffsets[recordedNodeId];
+         edge < csr->rowOffsets[recordedNodeId + 1];
+         ++edge) {
+      auto const otherNodeId = csr->edgeTargets[edge];
+      auto const& link = csr->edgeLinks[edge];
+      if (settled[otherNodeId] or
+          (!linksToIgnore.empty() and linksToIgnore.count(link))) {
         continue;
       }
-      auto metric =
-          useLinkMetric ? link->getMetricFromNode(recordedNodeName) : 1;
-      auto otherNode = q.get(otherNodeName);
-      if (!otherNode) {
-        q.insertNode(otherNodeName, recordedNodeMetric + metric);
-        otherNode = q.get(otherNodeName);
+      auto metric = useLinkMetric ? csr->edgeMetrics[edge] : 1;
+      auto& otherNodeResult = nodeResults[otherNodeId];
+      if (!q.contains(otherNodeId)) {
+        q.insertNode(otherNodeId, recordedNodeMetric + metric);
+        otherNodeResult.reset(recordedNodeMetric + metric);
       }
-      if (otherNode->result.metric() >= recordedNodeMetric + metric) {
+      if (otherNodeResult.metric() >= recordedNodeMetric + metric) {
         // recordedNodeName is either along an alternate shortest path towards
         // otherNodeName or is along a new shorter path. In either case,
         // otherNodeName should use recordedNodeName's nextHops until it finds
         // some shorter path
-        if (otherNode->result.metric() > recordedNodeMetric + metric) {
+        if (otherNodeResult.metric() > recordedNodeMetric + metric) {
           // if this is strictly better, forget about any other paths
-          otherNode->result.reset(recordedNodeMetric + metric);
-          q.reMake();
+          otherNodeResult.reset(recordedNodeMetric + metric);
+          q.decreaseKey(otherNodeId, recordedNodeMetric + metric);
         }
-        otherNode->result.addPath(link, recordedNodeName);
-        otherNode->result.addNextHops(recordedNodeNextHops);
-        if (otherNode->result.nextHops().empty()) {
+        otherNodeResult.addPath(link, recordedNodeName);
+        otherNodeResult.addNextHops(recordedNodeNextHops);
+        if (otherNodeResult.nextHops().empty()) {
           // directly connected node
-          otherNode->result.addNextHop(otherNodeName);
+          otherNodeResult.addNextHop(nodeName(otherNodeId));
         }
       }
     }
   }
+
+  result.reserve(settledOrder.size());
+  for (auto const nodeId : settledOrder) {
+    result.emplace(nodeName(nodeId), std::move(nodeResults[nodeId]));
+  }
   VLOG(3) << "Dijkstra loop count: " << loop;
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
   VLOG(3) << "SPF elapsed time: " << deltaTime.count() << "ms.";
-  fb303::fbData->addStatValue("decision.spf_ms", deltaTime.count(), fb303::AVG);
+  spfTimeCounter.add(deltaTime.count());
+  return result;
+}
+
+LinkState::SpfResult
+LinkState::runBfs(
+    AdjacencyCsr const& csr,
+    const std::string& thisNodeName,
+    LinkStateNodeId srcId,
+    LinkStateMetric metric,
+    const LinkState::LinkSet& linksToIgnore) const {
+  auto const numNodes = csr.numNodes();
+  std::vector<NodeSpfResult> nodeResults(
+      numNodes, NodeSpfResult(std::numeric_limits<LinkStateMetric>::max()));
+  std::vector<bool> reached(numNodes, false);
+  std::vector<LinkStateNodeId> settledOrder;
+  auto const nodeName = [&](LinkStateNodeId nodeId) -> std::string const& {
+    return nodeId == srcId ? thisNodeName : *csr.nodeNames[nodeId];
+  };
+
+  reached[srcId] = true;
+  nodeResults[srcId].reset(0);
+  std::vector<LinkStateNodeId> frontier{srcId};
+  std::vector<LinkStateNodeId> nextFrontier;
+  LinkStateMetric levelMetric = 0;
+  while (!frontier.empty()) {
+    auto const nextMetric = levelMetric + metric;
+    std::sort(
+        frontier.begin(),
+        frontier.end(),
+        [&nodeName](LinkStateNodeId a, LinkStateNodeId b) {
+          return nodeName(a) < nodeName(b);
+        });
+    for (auto const nodeId : frontier) {
+      settledOrder.push_back(nodeId);
+      if (csr.nodeOverloaded[nodeId] && nodeId != srcId) {
+        // no transit traffic through this node, same as runSpf()
+        continue;
+      }
+      auto const& fromNodeName = nodeName(nodeId);
+      auto const& nodeNextHops = nodeResults[nodeId].nextHops();
+      for (auto edge = csr.rowOffsets[nodeId];
+           edge < csr.rowOffsets[nodeId + 1];
+           ++edge) {
+        auto const& link = csr.edgeLinks[edge];
+        if (!linksToIgnore.empty() and linksToIgnore.count(link)) {
+          continue;
+        }
+        auto const otherNodeId = csr.edgeTargets[edge];
+        auto& otherNodeResult = nodeResults[otherNodeId];
+        if (!reached[otherNodeId]) {
+          reached[otherNodeId] = true;
+          otherNodeResult.reset(nextMetric);
+          nextFrontier.push_back(otherNodeId);
+        } else if (otherNodeResult.metric() != nextMetric) {
+          // reached on this or an earlier level
+          continue;
+        }
+        otherNodeResult.addPath(link, fromNodeName);
+        otherNodeResult.addNextHops(nodeNextHops);
+        if (otherNodeResult.nextHops().empty()) {
+          // directly connected node
+          otherNodeResult.addNextHop(nodeName(otherNodeId));
+        }
+      }
+    }
+    frontier.swap(nextFrontier);
+    nextFrontier.clear();
+    levelMetric = nextMetric;
+  }
+
+  SpfResult result;
+  result.reserve(settledOrder.size());
+  for (auto const nodeId : settledOrder) {
+    result.emplace(nodeName(nodeId), std::move(nodeResults[nodeId]));
+  }
   return result;
 }
 
@@ -8,12 +8,19 @@
 #pragma once
 
 #include <algorithm>
+#include <limits>
+#include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <folly/Executor.h>
+#include <folly/Synchronized.h>
+#include <openr/common/StringInterner.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 
@@ -21,6 +28,10 @@ namespace openr {
 
 using LinkStateMetric = uint64_t;
 
+// interned node name, see StringInterner::nodeNames(). Used by the SPF core to
+// keep per node state in flat vectors instead of string keyed maps
+using LinkStateNodeId = StringInterner::Id;
+
 // HoldableValue is the basic building block for ordered FIB programming
 // (rfc 6976)
 //
@@ -96,18 +107,24 @@ class Link {
       const openr::thrift::Adjacency& adj2);
 
  private:
-  const std::string area_;
-  const std::string n1_, n2_, if1_, if2_;
+  // node names are interned first, n1_ and n2_ refer into the interner
+  const LinkStateNodeId id1_, id2_;
+  // all names are references to process-wide interned strings, so each name
+  // is stored once no matter how many links refer to it
+  const std::string& area_;
+  const std::string &n1_, &n2_, &if1_, &if2_;
   HoldableValue<LinkStateMetric> metric1_{1}, metric2_{1};
   HoldableValue<bool> overload1_{false}, overload2_{false};
   int32_t adjLabel1_{0}, adjLabel2_{0};
+  int64_t weight1_{1}, weight2_{1};
+  int64_t adminGroups1_{0}, adminGroups2_{0};
   thrift::BinaryAddress nhV41_, nhV42_, nhV61_, nhV62_;
   LinkStateMetric holdUpTtl_{0};
 
-  const std::pair<
-      std::pair<std::string, std::string>,
-      std::pair<std::string, std::string>>
-      orderedNames_;
+  // <nodeName, ifName> of both ends, ordered by name. Since names are
+  // interned, equal names are equal pointers
+  using InternedNamePair = std::pair<const std::string*, const std::string*>;
+  const std::pair<InternedNamePair, InternedNamePair> orderedNames_;
 
  public:
   const size_t hash{0};
@@ -127,16 +144,27 @@ class Link {
 
   const std::string& getOtherNodeName(const std::string& nodeName) const;
 
+  LinkStateNodeId getOtherNodeId(LinkStateNodeId nodeId) const;
+
   const std::string& firstNodeName() const;
 
   const std::string& secondNodeName() const;
 
+  // ids of firstNodeName() and secondNodeName()
+  LinkStateNodeId firstNodeId() const;
+
+  LinkStateNodeId secondNodeId() const;
+
   const std::string& getIfaceFromNode(const std::string& nodeName) const;
 
   LinkStateMetric getMetricFromNode(const std::string& nodeName) const;
 
   int32_t getAdjLabelFromNode(const std::string& nodeName) const;
 
+  int64_t getWeightFromNode(const std::string& nodeName) const;
+
+  int64_t getAdminGroupsFromNode(const std::string& nodeName) const;
+
   bool getOverloadFromNode(const std::string& nodeName) const;
 
   const thrift::BinaryAddress& getNhV4FromNode(
@@ -159,6 +187,11 @@ class Link {
 
   void setAdjLabelFromNode(const std::string& nodeName, int32_t adjLabel);
 
+  void setWeightFromNode(const std::string& nodeName, int64_t weight);
+
+  void setAdminGroupsFromNode(
+      const std::string& nodeName, int64_t adminGroups);
+
   bool setOverloadFromNode(
       const std::string& nodeName,
       bool overload,
@@ -261,25 +294,151 @@ class LinkState {
 
   using Path = std::vector<std::shared_ptr<Link>>;
 
+  // Next-hops of a source node towards every node it reaches, as bitsets
+  // over the up links of the source. Unions and comparisons of next-hops are
+  // word-parallel, links are only looked up once next-hops are final
+  class NextHopIndex {
+   public:
+    // bit i stands for links().at(i)
+    using Bits = std::vector<uint64_t>;
+
+    NextHopIndex(
+        std::string const& src,
+        LinkSet const& links,
+        SpfResult const& spfResult);
+
+    std::vector<std::shared_ptr<Link>> const&
+    links() const {
+      return links_;
+    }
+
+    // links of src along shortest paths towards node, i.e. those towards
+    // the next-hops of node along ones of least metric. nullptr if node is
+    // not reachable
+    Bits const* getNextHopLinks(std::string const& node) const;
+
+    // bits |= other
+    static void unite(Bits& bits, Bits const& other);
+
+    // call f with every link of bits
+    template <typename F>
+    void
+    forEachLink(Bits const& bits, F&& f) const {
+      for (size_t word = 0; word < bits.size(); ++word) {
+        for (auto rest = bits[word]; rest; rest &= rest - 1) {
+          f(links_.at(word * 64 + __builtin_ctzll(rest)));
+        }
+      }
+    }
+
+   private:
+    std::vector<std::shared_ptr<Link>> links_;
+    std::unordered_map<std::string /* node */, Bits> nextHopLinks_;
+  };
+
   // Shortest paths API:
   // - getSpfResult()
   // - getKthPaths()
   //
-  // each is memoized all params. memoization invalidated for any topolgy
-  // altering calls, i.e. if decrementHolds(), updateAdjacencyDatabase(), or
-  // deleteAdjacencyDatabase() returns with LinkState::topologyChanged set true
+  // each is memoized all params. For getKthPaths(), memoization is
+  // invalidated for any topolgy altering calls, i.e. if decrementHolds(),
+  // updateAdjacencyDatabase(), or deleteAdjacencyDatabase() returns with
+  // LinkState::topologyChanged set true. Memoized getSpfResult() entries are
+  // instead repaired incrementally on the next call, recomputing only the
+  // part of the shortest path DAG affected by the links and nodes that changed
   SpfResult const& getSpfResult(
       const std::string& nodeName, bool useLinkMetric = true) const;
 
+  // Capacity from src towards the closest of dests through each neighbor of
+  // src, along the shortest path DAG. Capacity of a node is the sum over its
+  // downstream neighbors of min(weight of the links to the neighbor,
+  // capacity of the neighbor), dests having unbounded capacity. Adjacency
+  // weights are the link capacities. Memoized until the next change of
+  // generation
+  std::unordered_map<std::string /* neighbor */, double> getUcmpCapacities(
+      const std::string& src, std::vector<std::string> dests) const;
+
+  // next-hop index of src, built from its SPF result. Memoized until the
+  // next change of generation
+  std::shared_ptr<const NextHopIndex> getNextHopIndex(
+      const std::string& src) const;
+
  private:
   // LinkState belongs to a unique area
   const std::string area_;
 
-  // memoization structure for getSpfResult()
-  mutable std::unordered_map<
-      std::pair<std::string /* nodeName */, bool /* useLinkMetric */>,
-      SpfResult>
-      spfResults_;
+  // memoized SPF result along with the topology changes that happened since
+  // it was last brought up to date
+  struct MemoizedSpfResult {
+    SpfResult result;
+    // links that were added, removed or changed metric / up state
+    LinkSet changedLinks;
+    // nodes whose overload state changed
+    std::unordered_set<std::string> changedNodes;
+
+    bool
+    hasPendingChanges() const {
+      return !changedLinks.empty() || !changedNodes.empty();
+    }
+  };
+
+  struct Memo {
+    // memoization structure for getSpfResult()
+    std::unordered_map<
+        std::pair<std::string /* nodeName */, bool /* useLinkMetric */>,
+        MemoizedSpfResult>
+        spfResults;
+
+    // memoization structure for getKthPaths()
+    std::unordered_map<
+        std::tuple<
+            std::string /* src */,
+            std::string /* dest */,
+            size_t /* k */>,
+        std::vector<LinkState::Path>>
+        kthPathResults;
+
+    // memoization structure for getUcmpCapacities(), along with the
+    // generation it was computed for
+    std::map<
+        std::pair<std::string /* src */, std::vector<std::string> /* dests */>,
+        std::pair<uint64_t, std::unordered_map<std::string, double>>>
+        ucmpCapacities;
+
+    // memoization structure for getNextHopIndex(), along with the
+    // generation it was built for
+    std::unordered_map<
+        std::string /* src */,
+        std::pair<uint64_t, std::shared_ptr<const NextHopIndex>>>
+        nextHopIndices;
+  };
+
+  // Memoized results are filled lazily from const methods. The lock makes
+  // those safe to call concurrently (e.g. from SpfSolver worker threads),
+  // references handed out stay valid until the next topology altering call
+  mutable folly::Synchronized<Memo> memo_;
+
+  SpfResult const& getSpfResultLocked(
+      Memo& memo, std::pair<std::string, bool> key) const;
+
+  std::vector<LinkState::Path> const& getKthPathsLocked(
+      Memo& memo,
+      const std::string& src,
+      const std::string& dest,
+      size_t k) const;
+
+  // links of all memoized paths of rank < k from src to dest
+  LinkSet getLinksOfLowerPathsLocked(
+      Memo& memo,
+      const std::string& src,
+      const std::string& dest,
+      size_t k) const;
+
+  // edge-disjoint paths from src to dest in result
+  std::vector<LinkState::Path> tracePaths(
+      const std::string& src,
+      const std::string& dest,
+      SpfResult const& result) const;
 
  public:
   // Trace edge-disjoint paths from dest to src.
@@ -293,14 +452,17 @@ class LinkState {
   std::vector<LinkState::Path> const& getKthPaths(
       const std::string& src, const std::string& dest, size_t k) const;
 
- private:
-  // memoization structure for getKthPaths()
-  mutable std::unordered_map<
-      std::tuple<std::string /* src */, std::string /* dest */, size_t /* k */>,
-      std::vector<LinkState::Path>>
-      kthPathResults_;
+  // Batched getKthPaths(src, dest, k) for all dests, filling the same memo.
+  // Destinations whose lower ranked paths cover the same links share a
+  // single SPF run and distinct runs are spread over executor, if given.
+  // Results stay memoized until the next topology change
+  void computeKthPaths(
+      const std::string& src,
+      std::vector<std::string> const& dests,
+      size_t k,
+      folly::Executor* executor = nullptr) const;
+
 
- public:
   // non-const public methods
   // IMPT: clear memoization structures as appropirate in these functions
   class LinkStateChange {
@@ -322,8 +484,14 @@ class LinkState {
     bool topologyChanged{false};
     bool linkAttributesChanged{false};
     bool nodeLabelChanged{false};
+    // set along with topologyChanged if overload changes of the node or its
+    // links are all that changed the topology, i.e. a drain or undrain. Only
+    // refines topologyChanged, not part of equality
+    bool onlyDrainChanged{false};
   };
 
+  // decrement holds of held links and nodes, a single change covers all
+  // holds expiring in this call
   LinkStateChange decrementHolds();
 
   // update adjacencies for the given router
@@ -350,6 +518,14 @@ class LinkState {
     return area_;
   }
 
+  // process-wide unique id of the current state. Changes whenever a call
+  // alters topology, link attributes or node labels. Results derived from a
+  // LinkState can be reused for as long as its generation is unchanged
+  uint64_t
+  getGeneration() const {
+    return generation_;
+  }
+
   bool
   hasNode(const std::string& nodeName) const {
     return 0 != adjacencyDatabases_.count(nodeName);
@@ -371,14 +547,46 @@ class LinkState {
     return linkMap_.size();
   }
 
-  // get adjacency databases
-  std::unordered_map<
-      std::string /* nodeName */,
-      thrift::AdjacencyDatabase> const&
-  getAdjacencyDatabases() const {
+  // Latest AdjacencyDatabase of a node. Topology derived from it lives in
+  // links and node overloads, the database itself is only kept in compact
+  // serialized form, along with the fields LinkState needs natively
+  struct NodeAdjacencyDb {
+    // immutable, may be shared with readers beyond this LinkState
+    std::shared_ptr<const std::string> serializedDb;
+    int32_t nodeLabel{0};
+    size_t numAdjacencies{0};
+  };
+
+  std::unordered_map<std::string /* nodeName */, NodeAdjacencyDb> const&
+  getNodeAdjacencyDbs() const {
     return adjacencyDatabases_;
   }
 
+  // adjacency databases, deserialized on every call. Meant for read APIs and
+  // tests, computations should use links and getNodeLabel()
+  std::unordered_map<std::string /* nodeName */, thrift::AdjacencyDatabase>
+  getAdjacencyDatabases() const;
+
+  // adjacency database of node, std::nullopt if none. Deserialized as well
+  std::optional<thrift::AdjacencyDatabase> getAdjacencyDatabase(
+      const std::string& nodeName) const;
+
+  // node label advertised by node, throws std::out_of_range if none
+  int32_t
+  getNodeLabel(const std::string& nodeName) const {
+    return adjacencyDatabases_.at(nodeName).nodeLabel;
+  }
+
+  // node label -> nodes advertising it, kept up to date with adjacency
+  // databases. A label with more than one node is a label conflict
+  std::unordered_map<int32_t, std::set<std::string>> const&
+  getNodeLabelIndex() const {
+    return nodeLabelIndex_;
+  }
+
+  // nodes advertising the node label, empty if none
+  std::set<std::string> const& getNodesWithLabel(int32_t label) const;
+
   // check if path A is part of path B.
   // Example:
   // path A: a->b->c
@@ -424,7 +632,62 @@ class LinkState {
       LinkStateMetric holdUpTtl,
       LinkStateMetric holdDownTtl);
 
-  // run Dijkstra's Shortest Path First algorithm on the link state graph
+  // assign a new generation if change is non-empty
+  void maybeBumpGeneration(LinkStateChange const& change);
+
+  // record topology changes against all memoized results. Called in place of
+  // clearing memoization whenever topologyChanged is set
+  void recordTopologyChange(
+      LinkSet const& changedLinks,
+      std::unordered_set<std::string> const& changedNodes);
+
+  // repair `memo.result` to reflect `memo.changedLinks` and
+  // `memo.changedNodes`, in the style of dynamic SPT algorithms (e.g.
+  // Ramalingam-Reps): only nodes whose shortest paths go through a changed
+  // element, or that can improve because of one, are recomputed.
+  // Returns false if the affected part of the graph is too large for this to
+  // beat a full SPF run. `memo.result` is left untouched in that case.
+  bool updateSpfResult(
+      const std::string& src, bool useLinkMetric, MemoizedSpfResult& memo)
+      const;
+
+  // compressed sparse row (CSR) mirror of the up links in linkMap_, read by
+  // SPF in place of the node name keyed sets. Links stay the source of truth:
+  // this only copies out what relaxation needs into flat arrays indexed by
+  // LinkStateNodeId and edge index. Immutable once built, see getCsr()
+  struct AdjacencyCsr {
+    // generation_ this was built for
+    uint64_t generation{0};
+
+    // per node, sized to cover every node id in use when built. Outgoing
+    // edges of a node are [rowOffsets[id], rowOffsets[id + 1]), sorted by
+    // LinkPtrLess
+    std::vector<uint32_t> rowOffsets;
+    std::vector<const std::string*> nodeNames;
+    std::vector<bool> nodeOverloaded;
+
+    // per directional edge
+    std::vector<LinkStateNodeId> edgeTargets;
+    std::vector<LinkStateMetric> edgeMetrics;
+    std::vector<std::shared_ptr<Link>> edgeLinks;
+
+    // metric of all edges if it is the same, 0 otherwise. See runBfs()
+    LinkStateMetric uniformMetric{0};
+
+    size_t
+    numNodes() const {
+      return nodeNames.size();
+    }
+  };
+
+  // return the CSR for the current generation, building it on first use.
+  // Safe to call concurrently from const methods
+  std::shared_ptr<const AdjacencyCsr> getCsr() const;
+
+  std::shared_ptr<const AdjacencyCsr> buildCsr() const;
+
+  // run Dijkstra's Shortest Path First algorithm on the link state graph.
+  // Falls back to runBfs() if every link has the same metric
   SpfResult runSpf(
       const std::string& src, /* the source node for the SPF run */
       bool useLinkMetric, /* if set, the algorithm will respect adjancecy
@@ -434,10 +697,24 @@ class LinkState {
           {} /* optionaly specify a set of links to not use when running */)
       const;
 
-  // returns Link object if the reverse adjancency is present in
-  // adjacencyDatabases_.at(adj.otherNodeName), else returns nullptr
+  // With a uniform metric Dijkstra degenerates to BFS: nodes are settled
+  // level by level and, due to the tie break on name, in name order within a
+  // level. runBfs() replays exactly that order with a frontier per level and
+  // no heap, so results are identical to the Dijkstra run, path link order
+  // included
+  SpfResult runBfs(
+      AdjacencyCsr const& csr,
+      const std::string& src,
+      LinkStateNodeId srcId,
+      LinkStateMetric metric,
+      const LinkSet& linksToIgnore) const;
+
+  // returns Link object if the reverse adjancency is present in otherAdjs,
+  // the adjacencies of adj.otherNodeName, else returns nullptr
   std::shared_ptr<Link> maybeMakeLink(
-      const std::string& nodeName, const thrift::Adjacency& adj) const;
+      const std::string& nodeName,
+      const thrift::Adjacency& adj,
+      const std::vector<thrift::Adjacency>& otherAdjs) const;
 
   std::vector<std::shared_ptr<Link>> getOrderedLinkSet(
       const thrift::AdjacencyDatabase& adjDb) const;
@@ -445,6 +722,9 @@ class LinkState {
   std::vector<std::shared_ptr<Link>> orderedLinksFromNode(
       const std::string& nodeName) const;
 
+  // remove nodeName from the nodes advertising label
+  void unindexNodeLabel(const std::string& nodeName, int32_t label);
+
   // this stores the same link object accessible from either nodeName
   std::unordered_map<std::string /* nodeName */, LinkSet> linkMap_;
 
@@ -454,76 +734,147 @@ class LinkState {
   std::unordered_map<std::string /* nodeName */, HoldableValue<bool>>
       nodeOverloads_;
 
+  // links and nodes which may have holds, so that decrementHolds() and
+  // hasHolds() only visit those. Entries whose holds were cleared otherwise
+  // are dropped by the next decrementHolds()
+  LinkSet heldLinks_;
+  std::unordered_set<std::string> heldNodes_;
+
   // the latest AdjacencyDatabase we've received from each node
-  std::unordered_map<std::string, thrift::AdjacencyDatabase>
-      adjacencyDatabases_;
+  std::unordered_map<std::string, NodeAdjacencyDb> adjacencyDatabases_;
+
+  // see getNodeLabelIndex()
+  std::unordered_map<int32_t, std::set<std::string>> nodeLabelIndex_;
+
+  // see getGeneration()
+  uint64_t generation_{0};
+
+  // see AdjacencyCsr
+  mutable folly::Synchronized<std::shared_ptr<const AdjacencyCsr>> csr_;
 
 }; // class LinkState
 
-// Classes needed for running Dijkstra
-// In addition to implementing the priority queue at the heart of Dijkstra's
-// algorithm, this structure also allows us to store appication specfic data:
-// nexthops.
-class DijkstraQNode {
+// Priority queue needed for running Dijkstra
+// Nodes are referred to by LinkStateNodeId. This is a d-ary min heap keyed on
+// <metric, nodeName> which tracks the heap position of every queued node, so
+// a metric decrease is an O(log n) sift instead of a full heap rebuild. All
+// per node state lives in vectors indexed by node id.
+class DijkstraQ {
  public:
-  DijkstraQNode(const std::string& n, LinkStateMetric m)
-      : nodeName(n), result(m) {}
-  const std::string nodeName;
-  LinkState::NodeSpfResult result;
-};
+  // `numNodes` bounds the node ids that can be inserted
+  explicit DijkstraQ(size_t numNodes)
+      : positions_(numNodes, kNotInHeap),
+        metrics_(numNodes),
+        nodeNames_(numNodes, nullptr) {}
 
-class DijkstraQ {
- private:
-  std::vector<std::shared_ptr<DijkstraQNode>> heap_;
-  std::unordered_map<std::string, std::shared_ptr<DijkstraQNode>> nameToNode_;
+  bool
+  empty() const {
+    return heap_.empty();
+  }
 
-  struct {
-    bool
-    operator()(
-        std::shared_ptr<DijkstraQNode> a,
-        std::shared_ptr<DijkstraQNode> b) const {
-      if (a->result.metric() != b->result.metric()) {
-        return a->result.metric() > b->result.metric();
-      }
-      return a->nodeName > b->nodeName;
-    }
-  } DijkstraQNodeGreater;
+  bool
+  contains(LinkStateNodeId nodeId) const {
+    return positions_.at(nodeId) != kNotInHeap;
+  }
 
- public:
   void
-  insertNode(const std::string& nodeName, LinkStateMetric d) {
-    heap_.push_back(std::make_shared<DijkstraQNode>(nodeName, d));
-    nameToNode_[nodeName] = heap_.back();
-    std::push_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+  insertNode(LinkStateNodeId nodeId, LinkStateMetric d) {
+    CHECK(!contains(nodeId));
+    metrics_[nodeId] = d;
+    if (!nodeNames_[nodeId]) {
+      nodeNames_[nodeId] = &StringInterner::nodeNames().get(nodeId);
+    }
+    positions_[nodeId] = heap_.size();
+    heap_.push_back(nodeId);
+    siftUp(heap_.size() - 1);
   }
 
-  std::shared_ptr<DijkstraQNode>
-  get(const std::string& nodeName) {
-    if (nameToNode_.count(nodeName)) {
-      return nameToNode_.at(nodeName);
-    }
-    return nullptr;
+  // lower the metric of a node already in the queue
+  void
+  decreaseKey(LinkStateNodeId nodeId, LinkStateMetric d) {
+    CHECK(contains(nodeId));
+    CHECK_LE(d, metrics_[nodeId]);
+    metrics_[nodeId] = d;
+    siftUp(positions_[nodeId]);
   }
 
-  std::shared_ptr<DijkstraQNode>
+  // Assertion: queue is not empty
+  LinkStateNodeId
   extractMin() {
-    if (heap_.empty()) {
-      return nullptr;
-    }
-    auto min = heap_.at(0);
-    CHECK(nameToNode_.erase(min->nodeName));
-    std::pop_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+    CHECK(!heap_.empty());
+    auto const min = heap_.front();
+    positions_[min] = kNotInHeap;
+    heap_.front() = heap_.back();
     heap_.pop_back();
+    if (!heap_.empty()) {
+      positions_[heap_.front()] = 0;
+      siftDown(0);
+    }
     return min;
   }
 
+ private:
+  static constexpr size_t kArity{4};
+  static constexpr size_t kNotInHeap{std::numeric_limits<size_t>::max()};
+
+  bool
+  less(LinkStateNodeId a, LinkStateNodeId b) const {
+    if (metrics_[a] != metrics_[b]) {
+      return metrics_[a] < metrics_[b];
+    }
+    return *nodeNames_[a] < *nodeNames_[b];
+  }
+
+  void
+  place(size_t pos, LinkStateNodeId nodeId) {
+    heap_[pos] = nodeId;
+    positions_[nodeId] = pos;
+  }
+
+  void
+  siftUp(size_t pos) {
+    auto const nodeId = heap_[pos];
+    while (pos > 0) {
+      auto const parent = (pos - 1) / kArity;
+      if (!less(nodeId, heap_[parent])) {
+        break;
+      }
+      place(pos, heap_[parent]);
+      pos = parent;
+    }
+    place(pos, nodeId);
+  }
+
   void
-  reMake() {
-    // this is a bit slow but is rarely called in our application. In fact,
-    // in networks where the metric is hop count, this will never be called
-    // and the Dijkstra run is no different than BFS
-    std::make_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+  siftDown(size_t pos) {
+    auto const nodeId = heap_[pos];
+    while (true) {
+      auto const firstChild = pos * kArity + 1;
+      if (firstChild >= heap_.size()) {
+        break;
+      }
+      auto const lastChild = std::min(firstChild + kArity, heap_.size());
+      auto minChild = firstChild;
+      for (auto child = firstChild + 1; child < lastChild; ++child) {
+        if (less(heap_[child], heap_[minChild])) {
+          minChild = child;
+        }
+      }
+      if (!less(heap_[minChild], nodeId)) {
+        break;
+      }
+      place(pos, heap_[minChild]);
+      pos = minChild;
+    }
+    place(pos, nodeId);
   }
+
+  std::vector<LinkStateNodeId> heap_;
+  // position of each node in heap_, kNotInHeap if not queued
+  std::vector<size_t> positions_;
+  std::vector<LinkStateMetric> metrics_;
+  // interned names used to break metric ties, resolved on first insert
+  std::vector<const std::string*> nodeNames_;
 };
 } // namespace openr
 
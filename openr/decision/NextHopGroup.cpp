@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/decision/NextHopGroup.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace openr {
+
+struct NextHopGroup::Group {
+  uint64_t id{0};
+  NextHopSet nexthops;
+};
+
+namespace {
+
+using NextHopSet = NextHopGroup::NextHopSet;
+
+// hash of next-hops, independent of their order in the set
+struct NextHopSetHash {
+  size_t
+  operator()(const NextHopSet* nexthops) const {
+    size_t hash = nexthops->size();
+    for (auto const& nh : *nexthops) {
+      hash += std::hash<thrift::NextHopThrift>()(nh);
+    }
+    return hash;
+  }
+};
+
+struct NextHopSetEqual {
+  bool
+  operator()(const NextHopSet* lhs, const NextHopSet* rhs) const {
+    return *lhs == *rhs;
+  }
+};
+
+// Groups alive keyed by their next-hops. Entries are removed by the deleter
+// of their group, entries of expired groups are replaced when the same
+// next-hops are interned again before the deleter runs
+struct GroupTable {
+  std::mutex mutex;
+  uint64_t nextId{1};
+  std::unordered_map<
+      const NextHopSet*,
+      std::weak_ptr<const void>,
+      NextHopSetHash,
+      NextHopSetEqual>
+      groups;
+};
+
+GroupTable&
+getGroupTable() {
+  // leaked on purpose, groups may outlive static destruction
+  static auto* table = new GroupTable();
+  return *table;
+}
+
+} // namespace
+
+NextHopGroup::NextHopGroup(NextHopSet nexthops) {
+  if (nexthops.empty()) {
+    return;
+  }
+
+  auto& table = getGroupTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto it = table.groups.find(&nexthops);
+  if (it != table.groups.end()) {
+    if (auto existing = it->second.lock()) {
+      group_ = std::static_pointer_cast<const Group>(existing);
+      return;
+    }
+    // group expired, its deleter is waiting for the lock
+    table.groups.erase(it);
+  }
+
+  auto group = std::shared_ptr<const Group>(
+      new Group{table.nextId++, std::move(nexthops)}, [](const Group* group) {
+        auto& table = getGroupTable();
+        {
+          std::lock_guard<std::mutex> lock(table.mutex);
+          auto it = table.groups.find(&group->nexthops);
+          // entry may belong to a newer group of same next-hops
+          if (it != table.groups.end() and it->first == &group->nexthops) {
+            table.groups.erase(it);
+          }
+        }
+        delete group;
+      });
+  table.groups.emplace(&group->nexthops, group);
+  group_ = std::move(group);
+}
+
+uint64_t
+NextHopGroup::getId() const {
+  return group_ ? group_->id : 0;
+}
+
+const NextHopSet&
+NextHopGroup::get() const {
+  static const NextHopSet kEmptyNextHops;
+  return group_ ? group_->nexthops : kEmptyNextHops;
+}
+
+bool
+NextHopGroup::emplace(value_type nexthop) {
+  if (count(nexthop)) {
+    return false;
+  }
+  auto nexthops = get();
+  nexthops.emplace(std::move(nexthop));
+  *this = NextHopGroup(std::move(nexthops));
+  return true;
+}
+
+NextHopGroup::size_type
+NextHopGroup::erase(const value_type& nexthop) {
+  if (not count(nexthop)) {
+    return 0;
+  }
+  auto nexthops = get();
+  nexthops.erase(nexthop);
+  *this = NextHopGroup(std::move(nexthops));
+  return 1;
+}
+
+size_t
+NextHopGroup::getNumGroups() {
+  auto& table = getGroupTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.groups.size();
+}
+
+} // namespace openr
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <unordered_set>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+/**
+ * Immutable set of next-hops, shared by all routes with the same ECMP set.
+ *
+ * Groups are interned in a process-wide table keyed by their next-hops, and
+ * are ref-counted by the routes holding them. A group leaves the table with
+ * its last route. As a set of next-hops has at most one group at a time, two
+ * groups are equal if and only if their IDs are, which makes route
+ * comparison independent of the number of next-hops.
+ *
+ * Modifying next-hops of a group swaps it for the group of the modified set,
+ * leaving other routes of the original group untouched. Thread safe.
+ */
+class NextHopGroup {
+ public:
+  using NextHopSet = std::unordered_set<thrift::NextHopThrift>;
+  using value_type = thrift::NextHopThrift;
+  using const_iterator = NextHopSet::const_iterator;
+  using iterator = const_iterator;
+  using size_type = NextHopSet::size_type;
+
+  // empty group, with ID 0
+  NextHopGroup() = default;
+
+  // group of next-hops, shared with existing group of same next-hops if any
+  /* implicit */ NextHopGroup(NextHopSet nexthops);
+
+  /* implicit */ NextHopGroup(std::initializer_list<value_type> nexthops)
+      : NextHopGroup(NextHopSet(nexthops)) {}
+
+  // ID of group, unique among groups alive. 0 for empty group
+  uint64_t getId() const;
+
+  const NextHopSet& get() const;
+
+  /* implicit */ operator const NextHopSet&() const {
+    return get();
+  }
+
+  const_iterator
+  begin() const {
+    return get().begin();
+  }
+
+  const_iterator
+  end() const {
+    return get().end();
+  }
+
+  size_type
+  size() const {
+    return get().size();
+  }
+
+  bool
+  empty() const {
+    return get().empty();
+  }
+
+  size_type
+  count(const value_type& nexthop) const {
+    return get().count(nexthop);
+  }
+
+  // add next-hop, swapping group if next-hop was not in it
+  // @return true if next-hop was added
+  bool emplace(value_type nexthop);
+
+  // remove next-hop, swapping group if next-hop was in it
+  // @return number of next-hops removed
+  size_type erase(const value_type& nexthop);
+
+  bool
+  operator==(const NextHopGroup& other) const {
+    return getId() == other.getId();
+  }
+
+  bool
+  operator!=(const NextHopGroup& other) const {
+    return !(*this == other);
+  }
+
+  // number of groups alive, for monitoring
+  static size_t getNumGroups();
+
+ private:
+  struct Group;
+
+  // nullptr for empty group
+  std::shared_ptr<const Group> group_;
+};
+
+} // namespace openr
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/decision/PrefixDampener.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// Heap with fewer entries is never compacted
+constexpr size_t kMinHeapSizeForCompaction{64};
+
+// Penalty below which state of a prefix which is not suppressed is dropped
+constexpr double kMinPenalty{1.0};
+
+} // namespace
+
+PrefixDampener::PrefixDampener(thrift::PrefixDampeningConfig const& config)
+    : config_(config) {
+  CHECK_GT(*config_.half_life_ms_ref(), 0);
+  CHECK_GT(*config_.reuse_threshold_ref(), 0);
+  // Penalty which takes exactly max_suppress_ms to decay to reuse threshold
+  const double halfLives =
+      static_cast<double>(*config_.max_suppress_ms_ref()) /
+      *config_.half_life_ms_ref();
+  maxPenalty_ =
+      *config_.reuse_threshold_ref() * std::exp2(std::min(halfLives, 64.0));
+}
+
+bool
+PrefixDampener::isDampenedType(thrift::PrefixType type) const {
+  return config_.prefix_types_ref()->count(type) != 0;
+}
+
+double
+PrefixDampener::getDecayedPenalty(
+    State const& state, Clock::time_point now) const {
+  if (state.penalty <= 0) {
+    return 0;
+  }
+  const double elapsedMs =
+      std::chrono::duration<double, std::milli>(now - state.lastUpdateTime)
+          .count();
+  const double halfLives =
+      std::max(elapsedMs, 0.0) / *config_.half_life_ms_ref();
+  return state.penalty * std::exp2(-halfLives);
+}
+
+bool
+PrefixDampener::reportRouteChange(
+    folly::CIDRNetwork const& prefix,
+    thrift::PrefixType type,
+    uint64_t publishedFingerprint,
+    uint64_t fingerprint,
+    Clock::time_point now) {
+  auto it = states_.find(prefix);
+  if (it == states_.end()) {
+    // Advertisement of a prefix with no history adds no penalty
+    if (publishedFingerprint == 0 or publishedFingerprint == fingerprint) {
+      return false;
+    }
+    it = states_.emplace(prefix, State{}).first;
+  }
+  auto& state = it->second;
+
+  // Route of suppressed prefix is withheld, compare to the last one reported
+  const uint64_t previous =
+      state.suppressed ? state.fingerprint : publishedFingerprint;
+  double penalty = getDecayedPenalty(state, now);
+  if (previous != 0 and fingerprint == 0) {
+    penalty += *config_.withdraw_penalty_ref();
+  } else if (previous != 0 and fingerprint != previous) {
+    penalty += *config_.attribute_change_penalty_ref();
+  }
+  state.penalty = static_cast<float>(std::min(penalty, maxPenalty_));
+  state.lastUpdateTime = now;
+  state.fingerprint = fingerprint;
+  state.type = type;
+
+  if (not state.suppressed and
+      state.penalty < *config_.suppress_threshold_ref()) {
+    maybePrune(now);
+    return false;
+  }
+  if (not state.suppressed) {
+    state.suppressed = true;
+    ++numSuppressed_;
+  }
+
+  // Suppressed until penalty decays below reuse threshold
+  const double suppressMs = *config_.half_life_ms_ref() *
+      std::log2(state.penalty / *config_.reuse_threshold_ref());
+  const auto suppress = std::chrono::duration<double, std::milli>(
+      std::max(suppressMs, 0.0));
+  state.reuseTime =
+      now + std::chrono::duration_cast<Clock::duration>(suppress);
+  heap_.emplace(state.reuseTime, prefix);
+
+  // Drop stale entries. Amortized over the pushes which created them.
+  if (heap_.size() > kMinHeapSizeForCompaction and
+      heap_.size() > 2 * numSuppressed_) {
+    std::vector<HeapEntry> entries;
+    for (auto const& [statePrefix, prefixState] : states_) {
+      if (prefixState.suppressed) {
+        entries.emplace_back(prefixState.reuseTime, statePrefix);
+      }
+    }
+    heap_ = decltype(heap_)(std::greater<HeapEntry>(), std::move(entries));
+  }
+  return true;
+}
+
+bool
+PrefixDampener::isSuppressed(folly::CIDRNetwork const& prefix) const {
+  auto it = states_.find(prefix);
+  return it != states_.end() and it->second.suppressed;
+}
+
+std::optional<thrift::PrefixType>
+PrefixDampener::getPrefixType(folly::CIDRNetwork const& prefix) const {
+  auto it = states_.find(prefix);
+  if (it == states_.end()) {
+    return std::nullopt;
+  }
+  return it->second.type;
+}
+
+std::vector<std::pair<folly::CIDRNetwork, thrift::PrefixType>>
+PrefixDampener::reuse(Clock::time_point now) {
+  std::vector<std::pair<folly::CIDRNetwork, thrift::PrefixType>> reused;
+  while (not heap_.empty() and heap_.top().first <= now) {
+    auto const [reuseTime, prefix] = heap_.top();
+    heap_.pop();
+    auto it = states_.find(prefix);
+    if (it == states_.end() or not it->second.suppressed or
+        it->second.reuseTime != reuseTime) {
+      continue;
+    }
+    it->second.suppressed = false;
+    it->second.fingerprint = 0;
+    --numSuppressed_;
+    reused.emplace_back(prefix, it->second.type);
+  }
+  maybePrune(now);
+  return reused;
+}
+
+std::optional<std::chrono::milliseconds>
+PrefixDampener::getNextReuseTime(Clock::time_point now) {
+  while (not heap_.empty()) {
+    auto const& [reuseTime, prefix] = heap_.top();
+    auto it = states_.find(prefix);
+    if (it == states_.end() or not it->second.suppressed or
+        it->second.reuseTime != reuseTime) {
+      heap_.pop();
+      continue;
+    }
+    return std::max(
+        std::chrono::ceil<std::chrono::milliseconds>(reuseTime - now),
+        std::chrono::milliseconds(0));
+  }
+  return std::nullopt;
+}
+
+double
+PrefixDampener::getPenalty(
+    folly::CIDRNetwork const& prefix, Clock::time_point now) const {
+  auto it = states_.find(prefix);
+  if (it == states_.end()) {
+    return 0;
+  }
+  return getDecayedPenalty(it->second, now);
+}
+
+void
+PrefixDampener::maybePrune(Clock::time_point now) {
+  if (now - lastPruneTime_ <
+      std::chrono::milliseconds(*config_.half_life_ms_ref())) {
+    return;
+  }
+  lastPruneTime_ = now;
+  for (auto it = states_.begin(); it != states_.end();) {
+    if (not it->second.suppressed and
+        getDecayedPenalty(it->second, now) < kMinPenalty) {
+      it = states_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddress.h>
+
+#include <openr/if/gen-cpp2/OpenrConfig_types.h>
+
+namespace openr {
+
+/**
+ * Prefix flap dampening, in the spirit of BGP route flap dampening (RFC
+ * 2439). Decision reports changes of routes caused by prefix advertisements,
+ * identified by the fingerprint of their best prefix entry:
+ *
+ * - withdrawal of an advertised prefix adds `withdraw_penalty`
+ * - change of best prefix entry of an advertised prefix adds
+ *   `attribute_change_penalty`
+ * - (re-)advertisement of a prefix adds no penalty
+ *
+ * Penalty decays exponentially with `half_life_ms`. A prefix is suppressed
+ * once its penalty reaches `suppress_threshold`, until it decays below
+ * `reuse_threshold`, but for no longer than `max_suppress_ms`. Routes of
+ * suppressed prefixes are withheld from route updates by Decision.
+ *
+ * State is only kept for prefixes which flapped recently and is dropped once
+ * the penalty decayed. Suppressed prefixes are kept in a min-heap keyed by
+ * their reuse time, so reporting a change costs O(log n) and finding the
+ * prefixes to reuse is amortized O(log n), n being the number of suppressed
+ * prefixes.
+ */
+class PrefixDampener final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit PrefixDampener(thrift::PrefixDampeningConfig const& config);
+
+  // Whether routes of prefixes of this type are dampened
+  bool isDampenedType(thrift::PrefixType type) const;
+
+  /**
+   * Report change of route of prefix, with fingerprints of the best prefix
+   * entry of the published route and of the new route, 0 for no route.
+   * The published route is ignored for suppressed prefixes, as their routes
+   * are withheld. Returns true if prefix is suppressed.
+   */
+  bool reportRouteChange(
+      folly::CIDRNetwork const& prefix,
+      thrift::PrefixType type,
+      uint64_t publishedFingerprint,
+      uint64_t fingerprint,
+      Clock::time_point now = Clock::now());
+
+  bool isSuppressed(folly::CIDRNetwork const& prefix) const;
+
+  // Type last reported for prefix, std::nullopt if no state is kept for it
+  std::optional<thrift::PrefixType> getPrefixType(
+      folly::CIDRNetwork const& prefix) const;
+
+  // Prefixes whose penalty decayed to reuse threshold by `now`, along with
+  // their type. They are not suppressed anymore.
+  std::vector<std::pair<folly::CIDRNetwork, thrift::PrefixType>> reuse(
+      Clock::time_point now = Clock::now());
+
+  // Time until next prefix is to be reused, std::nullopt if none is
+  // suppressed
+  std::optional<std::chrono::milliseconds> getNextReuseTime(
+      Clock::time_point now = Clock::now());
+
+  // Current penalty of prefix
+  double getPenalty(
+      folly::CIDRNetwork const& prefix,
+      Clock::time_point now = Clock::now()) const;
+
+  size_t
+  getNumSuppressed() const {
+    return numSuppressed_;
+  }
+
+  // Number of prefixes dampening state is kept for
+  size_t
+  size() const {
+    return states_.size();
+  }
+
+ private:
+  struct State {
+    Clock::time_point lastUpdateTime;
+    // time at which prefix is reused, if suppressed
+    Clock::time_point reuseTime;
+    // fingerprint of the withheld route, if suppressed
+    uint64_t fingerprint{0};
+    // penalty as of lastUpdateTime
+    float penalty{0};
+    thrift::PrefixType type{thrift::PrefixType::LOOPBACK};
+    bool suppressed{false};
+  };
+
+  // penalty decayed from last update to `now`
+  double getDecayedPenalty(State const& state, Clock::time_point now) const;
+
+  // drop states of prefixes which are not suppressed and whose penalty
+  // decayed, at most once per half-life
+  void maybePrune(Clock::time_point now);
+
+  const thrift::PrefixDampeningConfig config_;
+
+  // penalty ceiling, so that suppression never exceeds max_suppress_ms
+  double maxPenalty_{0};
+
+  std::unordered_map<folly::CIDRNetwork, State> states_;
+  size_t numSuppressed_{0};
+  Clock::time_point lastPruneTime_;
+
+  // Min-heap of suppressed prefixes. Entries are invalidated lazily, i.e. an
+  // entry is valid only if it matches the reuseTime of a suppressed prefix.
+  using HeapEntry = std::pair<Clock::time_point, folly::CIDRNetwork>;
+  std::priority_queue<
+      HeapEntry,
+      std::vector<HeapEntry>,
+      std::greater<HeapEntry>>
+      heap_;
+};
+
+} // namespace openr
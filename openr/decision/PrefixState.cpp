@@ -7,6 +7,9 @@
 
 #include "openr/decision/PrefixState.h"
 
+#include <algorithm>
+
+#include <openr/common/PageCollector.h>
 #include <openr/common/Util.h>
 
 using apache::thrift::can_throw;
@@ -31,10 +34,16 @@ PrefixState::updatePrefix(
     return changed;
   }
   // Update prefix
-  if (not inserted) {
+  if (inserted) {
+    ++numPrefixEntries_;
+    ++areaToPrefixes_[key.getPrefixArea()][key.getCIDRNetwork()];
+  } else {
     it->second = std::make_shared<thrift::PrefixEntry>(entry);
   }
   changed.insert(key.getCIDRNetwork());
+  nodeToPrefixes_[key.getNodeName()].insert(key.getCIDRNetwork());
+  updatePrefixSets(key.getCIDRNetwork());
+  updateReachablePrefix(key.getCIDRNetwork());
 
   VLOG(1) << "[ROUTE ADVERTISEMENT] "
           << "Area: " << key.getPrefixArea() << ", Node: " << key.getNodeName()
@@ -57,52 +66,272 @@ PrefixState::deletePrefix(PrefixKey const& key) {
     prefixKeyV2_.erase(key);
   }
 
-  auto search = prefixes_.find(key.getCIDRNetwork());
-  if (search != prefixes_.end() and
-      search->second.erase(key.getNodeAndArea())) {
+  if (deleteEntry(
+          key.getNodeName(), key.getPrefixArea(), key.getCIDRNetwork())) {
     changed.insert(key.getCIDRNetwork());
-    VLOG(1) << "[ROUTE WITHDRAW] "
-            << "Area: " << key.getPrefixArea()
-            << ", Node: " << key.getNodeName() << ", "
-            << folly::IPAddress::networkToString(key.getCIDRNetwork());
-    // clean up data structures
-    if (search->second.empty()) {
-      prefixes_.erase(search);
+  }
+  return changed;
+}
+
+std::unordered_set<folly::CIDRNetwork>
+PrefixState::deleteNodePrefixes(
+    std::string const& nodeName, std::string const& area) {
+  std::unordered_set<folly::CIDRNetwork> changed;
+  auto nodeIt = nodeToPrefixes_.find(nodeName);
+  if (nodeIt == nodeToPrefixes_.end()) {
+    return changed;
+  }
+  // copy, deleteEntry() updates the index
+  auto const prefixes = nodeIt->second;
+  for (auto const& prefix : prefixes) {
+    if (deleteEntry(nodeName, area, prefix)) {
+      prefixKeyV2_.erase(PrefixKey(nodeName, prefix, area, true));
+      changed.insert(prefix);
     }
   }
   return changed;
 }
 
-std::vector<thrift::ReceivedRouteDetail>
-PrefixState::getReceivedRoutesFiltered(
-    thrift::ReceivedRouteFilter const& filter) const {
-  std::vector<thrift::ReceivedRouteDetail> routes;
+bool
+PrefixState::deleteEntry(
+    std::string const& nodeName,
+    std::string const& area,
+    folly::CIDRNetwork const& prefix) {
+  auto search = prefixes_.find(prefix);
+  if (search == prefixes_.end() or
+      not search->second.erase(NodeAndArea{nodeName, area})) {
+    return false;
+  }
+  --numPrefixEntries_;
+  auto areaIt = areaToPrefixes_.find(area);
+  if (areaIt != areaToPrefixes_.end()) {
+    auto countIt = areaIt->second.find(prefix);
+    if (countIt != areaIt->second.end() and --countIt->second == 0) {
+      areaIt->second.erase(countIt);
+      if (areaIt->second.empty()) {
+        areaToPrefixes_.erase(areaIt);
+      }
+    }
+  }
+  VLOG(1) << "[ROUTE WITHDRAW] "
+          << "Area: " << area << ", Node: " << nodeName << ", "
+          << folly::IPAddress::networkToString(prefix);
+  // keep index if node still advertises the prefix in some other area
+  bool const stillAdvertised = std::any_of(
+      search->second.begin(),
+      search->second.end(),
+      [&nodeName](auto const& kv) { return kv.first.first == nodeName; });
+  if (not stillAdvertised) {
+    auto nodeIt = nodeToPrefixes_.find(nodeName);
+    if (nodeIt != nodeToPrefixes_.end()) {
+      nodeIt->second.erase(prefix);
+      if (nodeIt->second.empty()) {
+        nodeToPrefixes_.erase(nodeIt);
+      }
+    }
+  }
+  updatePrefixSets(prefix);
+  // clean up data structures
+  if (search->second.empty()) {
+    prefixes_.erase(search);
+  }
+  updateReachablePrefix(prefix);
+  return true;
+}
+
+std::unordered_set<folly::CIDRNetwork>
+PrefixState::updateReachableNodes(
+    std::string const& area, std::unordered_set<std::string> nodes) {
+  // nodes whose reachability flipped, all unreachable ones if area wasn't
+  // tracked yet
+  std::vector<std::string> changedNodes;
+  auto [it, inserted] = reachableNodes_.try_emplace(area);
+  auto& oldNodes = it->second;
+  if (inserted) {
+    for (auto const& [node, _] : nodeToPrefixes_) {
+      if (not nodes.count(node)) {
+        changedNodes.emplace_back(node);
+      }
+    }
+  } else {
+    for (auto const& node : oldNodes) {
+      if (not nodes.count(node)) {
+        changedNodes.emplace_back(node);
+      }
+    }
+    for (auto const& node : nodes) {
+      if (not oldNodes.count(node)) {
+        changedNodes.emplace_back(node);
+      }
+    }
+  }
+  oldNodes = std::move(nodes);
+
+  // only prefixes advertised by these nodes in the area are affected
+  std::unordered_set<folly::CIDRNetwork> changed;
+  for (auto const& node : changedNodes) {
+    for (auto const& prefix : getPrefixesFromNode(node)) {
+      if (prefixes_.at(prefix).count({node, area})) {
+        changed.emplace(prefix);
+      }
+    }
+  }
+  for (auto const& prefix : changed) {
+    updateReachablePrefix(prefix);
+  }
+  return changed;
+}
+
+PrefixEntries const&
+PrefixState::getReachablePrefixEntries(folly::CIDRNetwork const& prefix) const {
+  static const PrefixEntries kEmptyPrefixEntries;
+  auto it = reachablePrefixes_.find(prefix);
+  return it != reachablePrefixes_.end() ? it->second : kEmptyPrefixEntries;
+}
+
+void
+PrefixState::updateReachablePrefix(folly::CIDRNetwork const& prefix) {
+  auto search = prefixes_.find(prefix);
+  if (search == prefixes_.end()) {
+    reachablePrefixes_.erase(prefix);
+    return;
+  }
+  PrefixEntries entries;
+  for (auto const& [nodeAndArea, entry] : search->second) {
+    auto areaIt = reachableNodes_.find(nodeAndArea.second);
+    if (areaIt == reachableNodes_.end() or
+        areaIt->second.count(nodeAndArea.first)) {
+      entries.emplace(nodeAndArea, entry);
+    }
+  }
+  if (entries.empty()) {
+    reachablePrefixes_.erase(prefix);
+  } else {
+    reachablePrefixes_.insert_or_assign(prefix, std::move(entries));
+  }
+}
+
+std::unordered_set<folly::CIDRNetwork> const&
+PrefixState::getPrefixesFromNode(std::string const& nodeName) const {
+  static const std::unordered_set<folly::CIDRNetwork> kEmptyPrefixes;
+  auto it = nodeToPrefixes_.find(nodeName);
+  return it != nodeToPrefixes_.end() ? it->second : kEmptyPrefixes;
+}
+
+void
+PrefixState::updatePrefixSets(folly::CIDRNetwork const& prefix) {
+  bool isKsp2{false};
+  bool isConflicting{false};
+  auto search = prefixes_.find(prefix);
+  if (search != prefixes_.end()) {
+    for (auto const& [_, entry] : search->second) {
+      isKsp2 |= *entry->forwardingAlgorithm_ref() ==
+          thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
+    }
+    isConflicting = hasConflictingForwardingInfo(search->second);
+  }
+  if (isKsp2) {
+    ksp2Prefixes_.insert(prefix);
+  } else {
+    ksp2Prefixes_.erase(prefix);
+  }
+  if (isConflicting) {
+    conflictingPrefixes_.insert(prefix);
+  } else {
+    conflictingPrefixes_.erase(prefix);
+  }
+}
+
+template <typename Fn>
+void
+PrefixState::forEachFilteredPrefix(
+    thrift::ReceivedRouteFilter const& filter, Fn&& fn) const {
   if (filter.prefixes_ref()) {
     for (auto& prefix : filter.prefixes_ref().value()) {
       auto it = prefixes_.find(toIPNetwork(prefix));
-      if (it == prefixes_.end()) {
-        continue;
+      if (it != prefixes_.end()) {
+        fn(it->first, it->second);
       }
-      filterAndAddReceivedRoute(
-          routes,
-          filter.nodeName_ref(),
-          filter.areaName_ref(),
-          it->first,
-          it->second);
+    }
+  } else if (filter.nodeName_ref()) {
+    for (auto const& prefix : getPrefixesFromNode(*filter.nodeName_ref())) {
+      fn(prefix, prefixes_.at(prefix));
+    }
+  } else if (filter.areaName_ref()) {
+    auto areaIt = areaToPrefixes_.find(*filter.areaName_ref());
+    if (areaIt == areaToPrefixes_.end()) {
+      return;
+    }
+    for (auto const& [prefix, _] : areaIt->second) {
+      fn(prefix, prefixes_.at(prefix));
     }
   } else {
-    for (auto& [prefix, prefixEntries] : prefixes_) {
-      filterAndAddReceivedRoute(
-          routes,
-          filter.nodeName_ref(),
-          filter.areaName_ref(),
-          prefix,
-          prefixEntries);
+    for (auto const& [prefix, prefixEntries] : prefixes_) {
+      fn(prefix, prefixEntries);
     }
   }
+}
+
+std::vector<thrift::ReceivedRouteDetail>
+PrefixState::getReceivedRoutesFiltered(
+    thrift::ReceivedRouteFilter const& filter) const {
+  std::vector<thrift::ReceivedRouteDetail> routes;
+  forEachFilteredPrefix(
+      filter,
+      [&](folly::CIDRNetwork const& prefix,
+          PrefixEntries const& prefixEntries) {
+        filterAndAddReceivedRoute(
+            routes,
+            filter.nodeName_ref(),
+            filter.areaName_ref(),
+            prefix,
+            prefixEntries);
+      });
   return routes;
 }
 
+thrift::ReceivedRoutesPage
+PrefixState::getReceivedRoutesFilteredPage(
+    thrift::ReceivedRouteFilter const& filter,
+    thrift::PageParams const& page) const {
+  auto const& nodeFilter = filter.nodeName_ref();
+  auto const& areaFilter = filter.areaName_ref();
+  std::optional<folly::CIDRNetwork> cursor;
+  if (page.cursor_ref().has_value()) {
+    cursor = getPrefixFromPageCursor(*page.cursor_ref());
+  }
+  PageCollector<folly::CIDRNetwork, PrefixEntries const*> collector(
+      cursor, getPageLimit(page));
+
+  // only prefixes with entries passing the filter count towards the page
+  auto addPrefix = [&](folly::CIDRNetwork const& prefix,
+                       PrefixEntries const& prefixEntries) {
+    for (auto const& [nodeAndArea, _] : prefixEntries) {
+      if ((not nodeFilter or *nodeFilter == nodeAndArea.first) and
+          (not areaFilter or *areaFilter == nodeAndArea.second)) {
+        collector.add(prefix, &prefixEntries);
+        return;
+      }
+    }
+  };
+
+  forEachFilteredPrefix(filter, addPrefix);
+
+  thrift::ReceivedRoutesPage thriftPage;
+  if (auto nextCursor = collector.getNextCursor()) {
+    thriftPage.nextCursor_ref() = toPageCursor(*nextCursor);
+  }
+  for (auto const& [prefix, prefixEntries] : collector.release()) {
+    filterAndAddReceivedRoute(
+        *thriftPage.routes_ref(),
+        nodeFilter,
+        areaFilter,
+        prefix,
+        *prefixEntries);
+  }
+  return thriftPage;
+}
+
 void
 PrefixState::filterAndAddReceivedRoute(
     std::vector<thrift::ReceivedRouteDetail>& routes,
@@ -9,6 +9,7 @@
 
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <openr/common/NetworkUtil.h>
@@ -35,9 +36,62 @@ class PrefixState {
   // empty if node/area did not previosuly advertise
   std::unordered_set<folly::CIDRNetwork> deletePrefix(PrefixKey const& key);
 
+  // withdraw all prefixes of node in area at once, e.g. once it is gone.
+  // Returns the set of changed prefixes
+  std::unordered_set<folly::CIDRNetwork> deleteNodePrefixes(
+      std::string const& nodeName, std::string const& area);
+
+  // set nodes reachable in SPF from the local node within the area, returns
+  // prefixes whose reachable originators changed
+  std::unordered_set<folly::CIDRNetwork> updateReachableNodes(
+      std::string const& area, std::unordered_set<std::string> nodes);
+
+  // whether reachability has been set for any area, i.e. whether
+  // getReachablePrefixEntries() leaves out unreachable originators
+  bool
+  hasReachableNodes() const {
+    return not reachableNodes_.empty();
+  }
+
+  // entries of the prefix from originators reachable in their area. Areas
+  // whose reachability isn't set are considered reachable.
+  PrefixEntries const& getReachablePrefixEntries(
+      folly::CIDRNetwork const& prefix) const;
+
+  // prefixes advertised by nodeName in any area
+  std::unordered_set<folly::CIDRNetwork> const& getPrefixesFromNode(
+      std::string const& nodeName) const;
+
+  // prefixes with at least one entry using KSP2_ED_ECMP. Their routes depend
+  // on whole paths towards the advertising nodes rather than only on shortest
+  // path metrics and nexthops
+  std::unordered_set<folly::CIDRNetwork> const&
+  ksp2Prefixes() const {
+    return ksp2Prefixes_;
+  }
+
+  // prefixes whose entries don't agree on forwarding algorithm and type,
+  // see hasConflictingForwardingInfo()
+  std::unordered_set<folly::CIDRNetwork> const&
+  conflictingPrefixes() const {
+    return conflictingPrefixes_;
+  }
+
+  // number of entries of all prefixes
+  size_t
+  getNumPrefixEntries() const {
+    return numPrefixEntries_;
+  }
+
   std::vector<thrift::ReceivedRouteDetail> getReceivedRoutesFiltered(
       thrift::ReceivedRouteFilter const& filter) const;
 
+  // one page of received routes by ascending prefix, see thrift::PageParams
+  // throws thrift::OpenrError on invalid page params
+  thrift::ReceivedRoutesPage getReceivedRoutesFilteredPage(
+      thrift::ReceivedRouteFilter const& filter,
+      thrift::PageParams const& page) const;
+
   /**
    * Filter routes only the <type> attribute
    */
@@ -55,16 +109,59 @@ class PrefixState {
   static bool hasConflictingForwardingInfo(PrefixEntries const& prefixEntries);
 
  private:
-  // TODO: Also maintain clean list of reachable prefix entries. A node might
-  // become un-reachable we might still have their prefix entries, until gets
-  // expired in KvStore. This will simplify logic in route computation where
-  // we exclude unreachable nodes.
-
   // Data structure to maintain mapping from:
   //  IpPrefix -> collection of originator(i.e. [node, area] combination)
   std::unordered_map<folly::CIDRNetwork, PrefixEntries> prefixes_;
 
   // Local cache for v2 format of prefix keys
   std::unordered_set<PrefixKey> prefixKeyV2_;
+
+  // Index of prefixes_ by advertising node, used to scope route recomputation
+  // to the prefixes of nodes affected by a topology change
+  std::unordered_map<std::string, std::unordered_set<folly::CIDRNetwork>>
+      nodeToPrefixes_;
+
+  // Index of prefixes_ by area, with the number of nodes advertising the
+  // prefix in the area. Serves received route queries filtered by area
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_map<folly::CIDRNetwork, size_t>>
+      areaToPrefixes_;
+
+  std::unordered_set<folly::CIDRNetwork> ksp2Prefixes_;
+
+  std::unordered_set<folly::CIDRNetwork> conflictingPrefixes_;
+
+  size_t numPrefixEntries_{0};
+
+  // A node might become un-reachable while we still have their prefix
+  // entries, until they get expired in KvStore. prefixes_ restricted to
+  // reachable originators, sharing entries with prefixes_, spares route
+  // computation from excluding unreachable nodes per prefix.
+  std::unordered_map<std::string /* area */, std::unordered_set<std::string>>
+      reachableNodes_;
+  std::unordered_map<folly::CIDRNetwork, PrefixEntries> reachablePrefixes_;
+
+  // re-derive reachablePrefixes_ entry after entries or reachability of
+  // originators of prefix changed
+  void updateReachablePrefix(folly::CIDRNetwork const& prefix);
+
+  // refresh ksp2Prefixes_ and conflictingPrefixes_ membership after entries
+  // of prefix changed
+  void updatePrefixSets(folly::CIDRNetwork const& prefix);
+
+  // call fn(prefix, prefixEntries) for the prefixes which may have entries
+  // passing filter, looked up through the narrowest of the indexes such that
+  // filtered queries cost time proportional to their result
+  template <typename Fn>
+  void forEachFilteredPrefix(
+      thrift::ReceivedRouteFilter const& filter, Fn&& fn) const;
+
+  // remove the entry of node in area from prefix, along with the indexes of
+  // it. Returns false if there was none
+  bool deleteEntry(
+      std::string const& nodeName,
+      std::string const& area,
+      folly::CIDRNetwork const& prefix);
 };
 } // namespace openr
@@ -13,19 +13,21 @@
 
 #include <folly/IPAddress.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/decision/NextHopGroup.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/if/gen-cpp2/OpenrCtrl.h>
 #include <openr/if/gen-cpp2/Types_types.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
 
 namespace openr {
 
 struct RibEntry {
   // TODO: should this be map<area, nexthops>?
-  std::unordered_set<thrift::NextHopThrift> nexthops;
+  // Shared with all entries of same next-hops, compared by group ID
+  NextHopGroup nexthops;
 
   // constructor
-  explicit RibEntry(std::unordered_set<thrift::NextHopThrift> nexthops)
-      : nexthops(std::move(nexthops)) {}
+  explicit RibEntry(NextHopGroup nexthops) : nexthops(std::move(nexthops)) {}
 
   RibEntry() = default;
 
@@ -41,18 +43,22 @@ struct RibUnicastEntry : RibEntry {
   std::string bestArea;
   // install to fib or not
   bool doNotInstall{false};
+  // loop-free alternates to switch to upon failure of nexthops, if computed
+  std::unordered_set<thrift::NextHopThrift> backupNexthops;
+  // fingerprint of bestPrefixEntry, 0 if not computed. Entries which both
+  // carry one are compared by it instead of deep comparing bestPrefixEntry,
+  // refresh with updateFingerprint() after modifying bestPrefixEntry
+  uint64_t fingerprint{0};
 
   // constructor
   explicit RibUnicastEntry(const folly::CIDRNetwork& prefix) : prefix(prefix) {}
 
-  RibUnicastEntry(
-      const folly::CIDRNetwork& prefix,
-      std::unordered_set<thrift::NextHopThrift> nexthops)
+  RibUnicastEntry(const folly::CIDRNetwork& prefix, NextHopGroup nexthops)
       : RibEntry(std::move(nexthops)), prefix(prefix) {}
 
   RibUnicastEntry(
       const folly::CIDRNetwork& prefix,
-      std::unordered_set<thrift::NextHopThrift> nexthops,
+      NextHopGroup nexthops,
       thrift::PrefixEntry bestPrefixEntry,
       const std::string& bestArea,
       bool doNotInstall = false)
@@ -64,8 +70,15 @@ struct RibUnicastEntry : RibEntry {
 
   bool
   operator==(const RibUnicastEntry& other) const {
-    return prefix == other.prefix && bestPrefixEntry == other.bestPrefixEntry &&
-        doNotInstall == other.doNotInstall && RibEntry::operator==(other);
+    if (prefix != other.prefix || doNotInstall != other.doNotInstall ||
+        !RibEntry::operator==(other) ||
+        backupNexthops != other.backupNexthops) {
+      return false;
+    }
+    if (fingerprint && other.fingerprint) {
+      return fingerprint == other.fingerprint;
+    }
+    return bestPrefixEntry == other.bestPrefixEntry;
   }
 
   bool
@@ -73,6 +86,16 @@ struct RibUnicastEntry : RibEntry {
     return !(*this == other);
   }
 
+  void
+  updateFingerprint() {
+    const auto serialized =
+        apache::thrift::CompactSerializer::serialize<std::string>(
+            bestPrefixEntry);
+    fingerprint = std::hash<std::string>{}(serialized);
+    // 0 is reserved for entries without fingerprint
+    fingerprint = fingerprint ? fingerprint : 1;
+  }
+
   // TODO: rename this func
   thrift::UnicastRoute
   toThrift() const {
@@ -80,6 +103,10 @@ struct RibUnicastEntry : RibEntry {
     tUnicast.dest_ref() = toIpPrefix(prefix);
     tUnicast.nextHops_ref() =
         std::vector<thrift::NextHopThrift>(nexthops.begin(), nexthops.end());
+    if (not backupNexthops.empty()) {
+      tUnicast.backupNextHops_ref() = std::vector<thrift::NextHopThrift>(
+          backupNexthops.begin(), backupNexthops.end());
+    }
     return tUnicast;
   }
 
@@ -99,8 +126,7 @@ struct RibMplsEntry : RibEntry {
   explicit RibMplsEntry(int32_t label) : label(label) {}
 
   // constructor
-  RibMplsEntry(
-      int32_t label, std::unordered_set<thrift::NextHopThrift> nexthops)
+  RibMplsEntry(int32_t label, NextHopGroup nexthops)
       : RibEntry(std::move(nexthops)), label(label) {}
 
   static RibMplsEntry
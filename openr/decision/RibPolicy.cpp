@@ -7,6 +7,8 @@
 
 #include <openr/decision/RibPolicy.h>
 
+#include <algorithm>
+
 #include <fb303/ServiceData.h>
 #include <folly/MapUtil.h>
 
@@ -76,19 +78,7 @@ RibPolicyStatement::match(const RibUnicastEntry& route) const {
   }
 
   // Attempt to match the route on tags if populated in the RibPolicy statement
-  bool tagMatch{false};
-  if (tagSet_.empty()) {
-    tagMatch = true;
-  } else {
-    for (const auto& tag : tagSet_) {
-      // Find a match with at least one tag in the RibPolicyStatement
-      const auto tagFoundIt = route.bestPrefixEntry.tags_ref()->find(tag);
-      if (tagFoundIt != route.bestPrefixEntry.tags_ref()->end()) {
-        tagMatch = true;
-        break;
-      }
-    }
-  }
+  const bool tagMatch = matchTags(*route.bestPrefixEntry.tags_ref());
 
   // Attempt to match the route on prefix if populated in the RibPolicy
   // statement
@@ -104,12 +94,39 @@ RibPolicyStatement::match(const RibUnicastEntry& route) const {
   return tagMatch && prefixMatch;
 }
 
+bool
+RibPolicyStatement::matchTags(const std::set<std::string>& tags) const {
+  if (tagSet_.empty()) {
+    return true;
+  }
+  // Find a match with at least one tag in the RibPolicyStatement
+  // ATTN: iterate over the smaller of the two sets
+  if (tags.size() < tagSet_.size()) {
+    return std::any_of(tags.begin(), tags.end(), [this](const auto& tag) {
+      return tagSet_.count(tag) > 0;
+    });
+  }
+  return std::any_of(tagSet_.begin(), tagSet_.end(), [&tags](const auto& tag) {
+    return tags.count(tag) > 0;
+  });
+}
+
+bool
+RibPolicyStatement::operator==(const RibPolicyStatement& other) const {
+  return prefixSet_ == other.prefixSet_ and tagSet_ == other.tagSet_ and
+      action_ == other.action_;
+}
+
 bool
 RibPolicyStatement::applyAction(RibUnicastEntry& route) const {
   if (not match(route)) {
     return false;
   }
+  return transform(route);
+}
 
+bool
+RibPolicyStatement::transform(RibUnicastEntry& route) const {
   // Iterate over all next-hops. NOTE that we iterate over rvalue
   CHECK(action_.set_weight_ref().has_value());
   auto const& weightAction = action_.set_weight_ref().value();
@@ -175,6 +192,19 @@ RibPolicy::RibPolicy(thrift::RibPolicy const& policy)
   for (auto const& statement : *policy.statements_ref()) {
     policyStatements_.emplace_back(RibPolicyStatement(statement));
   }
+
+  // Compile matchers. Indices are appended in statement order, hence sorted
+  for (size_t i = 0; i < policyStatements_.size(); ++i) {
+    auto const& statement = policyStatements_.at(i);
+    for (auto const& prefix : statement.getPrefixSet()) {
+      prefixIndex_[prefix].emplace_back(i);
+    }
+    if (statement.getPrefixSet().empty()) {
+      for (auto const& tag : statement.getTagSet()) {
+        tagOnlyIndex_[tag].emplace_back(i);
+      }
+    }
+  }
 }
 
 thrift::RibPolicy
@@ -205,20 +235,51 @@ RibPolicy::isActive() const {
   return getTtlDuration().count() > 0;
 }
 
-bool
-RibPolicy::match(const RibUnicastEntry& route) const {
-  for (auto const& statement : policyStatements_) {
-    if (statement.match(route)) {
-      return true;
+const std::vector<size_t>&
+RibPolicy::getMatchingStatements(const RibUnicastEntry& route) const {
+  auto const& tags = *route.bestPrefixEntry.tags_ref();
+  auto [it, inserted] = matchCache_.try_emplace(route.prefix);
+  auto& entry = it->second;
+  if (not inserted and entry.tags == tags) {
+    return entry.statements;
+  }
+
+  entry.tags = tags;
+  entry.statements.clear();
+  auto prefixIt = prefixIndex_.find(route.prefix);
+  if (prefixIt != prefixIndex_.end()) {
+    for (auto index : prefixIt->second) {
+      if (policyStatements_.at(index).matchTags(tags)) {
+        entry.statements.emplace_back(index);
+      }
     }
   }
-  return false;
+  for (auto const& tag : tags) {
+    auto tagIt = tagOnlyIndex_.find(tag);
+    if (tagIt != tagOnlyIndex_.end()) {
+      entry.statements.insert(
+          entry.statements.end(), tagIt->second.begin(), tagIt->second.end());
+    }
+  }
+  // statements matching several tags are listed once, first match first
+  std::sort(entry.statements.begin(), entry.statements.end());
+  entry.statements.erase(
+      std::unique(entry.statements.begin(), entry.statements.end()),
+      entry.statements.end());
+  return entry.statements;
+}
+
+bool
+RibPolicy::match(const RibUnicastEntry& route) const {
+  return not getMatchingStatements(route).empty();
 }
 
 bool
 RibPolicy::applyAction(RibUnicastEntry& route) const {
-  for (auto const& statement : policyStatements_) {
-    if (statement.applyAction(route)) {
+  // ATTN: first statement transforming the route wins, a matching statement
+  //       invalidating all next-hops falls through to the next one
+  for (auto index : getMatchingStatements(route)) {
+    if (policyStatements_.at(index).transform(route)) {
       return true;
     }
   }
@@ -242,7 +303,64 @@ RibPolicy::applyPolicy(std::unordered_map<folly::CIDRNetwork, RibUnicastEntry>&
     }
     ++iter;
   }
+
+  // forget routes which are gone
+  if (matchCache_.size() > unicastEntries.size()) {
+    for (auto it = matchCache_.begin(); it != matchCache_.end();) {
+      it = unicastEntries.count(it->first) ? std::next(it)
+                                           : matchCache_.erase(it);
+    }
+  }
   return change;
 }
 
+std::unordered_set<folly::CIDRNetwork>
+RibPolicy::getAffectedPrefixes(
+    RibPolicy const* oldPolicy,
+    RibPolicy const* newPolicy,
+    std::unordered_map<folly::CIDRNetwork, RibUnicastEntry> const& routes) {
+  std::unordered_set<folly::CIDRNetwork> affected;
+  // tags of changed tag-only statements, matched against all routes below
+  std::unordered_set<std::string> changedTags;
+
+  // collect routes matching statements of policy changed in other
+  auto addChanged = [&](RibPolicy const* policy, RibPolicy const* other) {
+    if (not policy) {
+      return;
+    }
+    auto const& statements = policy->policyStatements_;
+    for (size_t i = 0; i < statements.size(); ++i) {
+      auto const& statement = statements.at(i);
+      if (other and i < other->policyStatements_.size() and
+          statement == other->policyStatements_.at(i)) {
+        continue;
+      }
+      // prefix matchers are exact, any tag matcher is checked on re-evaluation
+      for (auto const& prefix : statement.getPrefixSet()) {
+        if (routes.count(prefix)) {
+          affected.emplace(prefix);
+        }
+      }
+      if (statement.getPrefixSet().empty()) {
+        changedTags.insert(
+            statement.getTagSet().begin(), statement.getTagSet().end());
+      }
+    }
+  };
+  addChanged(oldPolicy, newPolicy);
+  addChanged(newPolicy, oldPolicy);
+
+  if (not changedTags.empty()) {
+    for (auto const& [prefix, route] : routes) {
+      auto const& tags = *route.bestPrefixEntry.tags_ref();
+      if (std::any_of(tags.begin(), tags.end(), [&](auto const& tag) {
+            return changedTags.count(tag) > 0;
+          })) {
+        affected.emplace(prefix);
+      }
+    }
+  }
+  return affected;
+}
+
 } // namespace openr
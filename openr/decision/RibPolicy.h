@@ -6,6 +6,11 @@
  */
 
 #include <chrono>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <openr/common/NetworkUtil.h>
 #include <openr/decision/RibEntry.h>
@@ -42,6 +47,33 @@ class RibPolicyStatement {
    */
   bool applyAction(RibUnicastEntry& route) const;
 
+  /**
+   * Transform route known to match, e.g. through RibPolicy indices
+   *
+   * @returns boolean indicating if route is transformed or not.
+   */
+  bool transform(RibUnicastEntry& route) const;
+
+  /**
+   * Checks if tags qualify the tag match criteria, true if there is none
+   */
+  bool matchTags(const std::set<std::string>& tags) const;
+
+  /**
+   * Statements matching and transforming routes alike, names aside
+   */
+  bool operator==(const RibPolicyStatement& other) const;
+
+  const std::unordered_set<folly::CIDRNetwork>&
+  getPrefixSet() const {
+    return prefixSet_;
+  }
+
+  const std::unordered_set<std::string>&
+  getTagSet() const {
+    return tagSet_;
+  }
+
  private:
   const std::string name_;
 
@@ -62,6 +94,14 @@ class RibPolicyStatement {
  * efficient processing of policy. Provides APIs for easier code intengration
  * for route policing.
  *
+ * Statements are compiled into indices of the statements matching a prefix,
+ * and of tag-only statements matching a tag, so evaluating a route costs a
+ * few hash lookups instead of a pass over all statements. Matching statements
+ * are cached per route prefix and tags for the lifetime of the policy, as a
+ * policy is immutable and replaced in whole on update.
+ *
+ * NOTE: Not thread safe, because of the cache
+ *
  * Refer to `struct RibPolicy` in `OpenrCtrl.thrift` for more documentation.
  */
 class RibPolicy {
@@ -110,10 +150,41 @@ class RibPolicy {
       std::unordered_map<folly::CIDRNetwork, RibUnicastEntry>& unicastEntries)
       const;
 
+  /**
+   * Prefixes of routes which may be transformed differently by newPolicy
+   * than by oldPolicy, nullptr standing for no policy. These are the routes
+   * matching a statement of either policy which is not at the same position,
+   * unchanged, in the other one. All other routes match the same statements
+   * in both policies, and are left as they are. Validity is not considered.
+   */
+  static std::unordered_set<folly::CIDRNetwork> getAffectedPrefixes(
+      RibPolicy const* oldPolicy,
+      RibPolicy const* newPolicy,
+      std::unordered_map<folly::CIDRNetwork, RibUnicastEntry> const& routes);
+
  private:
+  /**
+   * Indices of statements matching route, in statement order. Cached.
+   */
+  const std::vector<size_t>& getMatchingStatements(
+      const RibUnicastEntry& route) const;
+
   // List of policy statements
   std::vector<RibPolicyStatement> policyStatements_;
 
+  // Statements with prefix matcher, by prefix. Tags are still to be matched
+  std::unordered_map<folly::CIDRNetwork, std::vector<size_t>> prefixIndex_;
+
+  // Statements with tag matcher ONLY, by tag
+  std::unordered_map<std::string, std::vector<size_t>> tagOnlyIndex_;
+
+  // Matching statements of routes, valid as long as their tags are unchanged
+  struct MatchCacheEntry {
+    std::set<std::string> tags;
+    std::vector<size_t> statements;
+  };
+  mutable std::unordered_map<folly::CIDRNetwork, MatchCacheEntry> matchCache_;
+
   // Validity
   const std::chrono::steady_clock::time_point validUntilTs_;
 };
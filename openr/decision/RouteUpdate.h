@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <list>
+#include <unordered_set>
 #include <vector>
 
 #include <folly/IPAddress.h>
@@ -38,7 +40,18 @@ struct DecisionRouteUpdate {
     FULL_SYNC
   };
 
+  enum Priority {
+    // Not assigned to a priority lane, programmed in order of arrival
+    NONE,
+    // Withdrawals and reachability changes caused by topology changes
+    HIGH,
+    // Bulk route changes, e.g. caused by prefix or policy updates. May be
+    // preempted by high priority route updates.
+    BULK
+  };
+
   Type type;
+  Priority priority{NONE};
   std::unordered_map<folly::CIDRNetwork /* prefix */, RibUnicastEntry>
       unicastRoutesToUpdate;
   std::vector<folly::CIDRNetwork> unicastRoutesToDelete;
@@ -59,10 +72,93 @@ struct DecisionRouteUpdate {
     unicastRoutesToUpdate.emplace(std::move(prefix), std::move(route));
   }
 
+  bool
+  empty() const {
+    return unicastRoutesToUpdate.empty() and unicastRoutesToDelete.empty() and
+        mplsRoutesToUpdate.empty() and mplsRoutesToDelete.empty();
+  }
+
+  size_t
+  size() const {
+    return unicastRoutesToUpdate.size() + unicastRoutesToDelete.size() +
+        mplsRoutesToUpdate.size() + mplsRoutesToDelete.size();
+  }
+
+  /*
+   * Drop the routes of prefixes and labels updated or deleted by `other`,
+   * as they are superseded by it
+   */
+  void
+  eraseRoutesOf(DecisionRouteUpdate const& other) {
+    std::unordered_set<folly::CIDRNetwork> prefixes{
+        other.unicastRoutesToDelete.begin(),
+        other.unicastRoutesToDelete.end()};
+    for (auto const& [prefix, _] : other.unicastRoutesToUpdate) {
+      prefixes.emplace(prefix);
+    }
+    for (auto const& prefix : prefixes) {
+      unicastRoutesToUpdate.erase(prefix);
+    }
+    unicastRoutesToDelete.erase(
+        std::remove_if(
+            unicastRoutesToDelete.begin(),
+            unicastRoutesToDelete.end(),
+            [&](auto const& prefix) { return prefixes.count(prefix); }),
+        unicastRoutesToDelete.end());
+
+    std::unordered_set<int32_t> labels{
+        other.mplsRoutesToDelete.begin(), other.mplsRoutesToDelete.end()};
+    for (auto const& route : other.mplsRoutesToUpdate) {
+      labels.emplace(route.label);
+    }
+    mplsRoutesToUpdate.erase(
+        std::remove_if(
+            mplsRoutesToUpdate.begin(),
+            mplsRoutesToUpdate.end(),
+            [&](auto const& route) { return labels.count(route.label); }),
+        mplsRoutesToUpdate.end());
+    mplsRoutesToDelete.erase(
+        std::remove_if(
+            mplsRoutesToDelete.begin(),
+            mplsRoutesToDelete.end(),
+            [&](auto label) { return labels.count(label); }),
+        mplsRoutesToDelete.end());
+  }
+
+  /*
+   * Merge newer route update `other` into this one
+   */
+  void
+  merge(DecisionRouteUpdate&& other) {
+    eraseRoutesOf(other);
+    for (auto& [prefix, route] : other.unicastRoutesToUpdate) {
+      unicastRoutesToUpdate.emplace(prefix, std::move(route));
+    }
+    unicastRoutesToDelete.insert(
+        unicastRoutesToDelete.end(),
+        other.unicastRoutesToDelete.begin(),
+        other.unicastRoutesToDelete.end());
+    mplsRoutesToUpdate.insert(
+        mplsRoutesToUpdate.end(),
+        std::make_move_iterator(other.mplsRoutesToUpdate.begin()),
+        std::make_move_iterator(other.mplsRoutesToUpdate.end()));
+    mplsRoutesToDelete.insert(
+        mplsRoutesToDelete.end(),
+        other.mplsRoutesToDelete.begin(),
+        other.mplsRoutesToDelete.end());
+    if (not perfEvents.has_value()) {
+      perfEvents = std::move(other.perfEvents);
+    }
+  }
+
   // TODO: rename this func
   thrift::RouteDatabaseDelta
   toThrift() {
     thrift::RouteDatabaseDelta delta;
+    // size lists upfront, deltas of full syncs hold the whole RIB
+    delta.unicastRoutesToUpdate_ref()->reserve(unicastRoutesToUpdate.size());
+    delta.unicastRoutesToDelete_ref()->reserve(unicastRoutesToDelete.size());
+    delta.mplsRoutesToUpdate_ref()->reserve(mplsRoutesToUpdate.size());
 
     // unicast
     for (const auto& [_, route] : unicastRoutesToUpdate) {
@@ -85,6 +181,11 @@ struct DecisionRouteUpdate {
   thrift::RouteDatabaseDeltaDetail
   toThriftDetail() {
     thrift::RouteDatabaseDeltaDetail deltaDetail;
+    deltaDetail.unicastRoutesToUpdate_ref()->reserve(
+        unicastRoutesToUpdate.size());
+    deltaDetail.unicastRoutesToDelete_ref()->reserve(
+        unicastRoutesToDelete.size());
+    deltaDetail.mplsRoutesToUpdate_ref()->reserve(mplsRoutesToUpdate.size());
 
     // unicast
     for (const auto& [_, route] : unicastRoutesToUpdate) {
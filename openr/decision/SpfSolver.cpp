@@ -5,10 +5,18 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <openr/common/StatCounter.h>
 #include <openr/decision/RibEntry.h>
 #include <openr/decision/SpfSolver.h>
 
+#include <cmath>
+#include <functional>
+#include <numeric>
+
 #include <fb303/ServiceData.h>
+#include <folly/MapUtil.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/futures/Future.h>
 
 namespace fb303 = facebook::fb303;
 
@@ -18,6 +26,50 @@ using SpfResult = openr::LinkState::SpfResult;
 
 namespace openr {
 
+namespace {
+
+// Counters bumped for every prefix or label during route computation
+StatCounter getRouteForPrefixCounter{
+    "decision.get_route_for_prefix", fb303::COUNT};
+StatCounter routeMemoHitsCounter{"decision.route_memo.hits", fb303::COUNT};
+StatCounter routeMemoMissesCounter{"decision.route_memo.misses", fb303::COUNT};
+StatCounter skippedUnicastRouteCounter{
+    "decision.skipped_unicast_route", fb303::COUNT};
+StatCounter noRouteToPrefixCounter{"decision.no_route_to_prefix", fb303::COUNT};
+StatCounter skippedMplsRouteCounter{
+    "decision.skipped_mpls_route", fb303::COUNT};
+StatCounter duplicateNodeLabelCounter{
+    "decision.duplicate_node_label", fb303::COUNT};
+StatCounter noRouteToLabelCounter{"decision.no_route_to_label", fb303::COUNT};
+StatCounter incompatibleForwardingTypeCounter{
+    "decision.incompatible_forwarding_type", fb303::COUNT};
+
+// Copy of prefix entries from nodes reachable from myNodeName, entries are
+// checked only within the area the advertising node belongs to
+PrefixEntries
+filterReachablePrefixEntries(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates,
+    PrefixEntries const& allPrefixEntries) {
+  auto prefixEntries = folly::copy(allPrefixEntries);
+  for (auto& [area, linkState] : areaLinkStates) {
+    auto const& mySpfResult = linkState.getSpfResult(myNodeName);
+
+    // Delete entries of unreachable nodes from prefixEntries
+    for (auto it = prefixEntries.cbegin(); it != prefixEntries.cend();) {
+      const auto& [prefixNode, prefixArea] = it->first;
+      if (area != prefixArea || mySpfResult.count(prefixNode)) {
+        ++it; // retain
+      } else {
+        it = prefixEntries.erase(it); // erase the unreachable prefix entry
+      }
+    }
+  }
+  return prefixEntries;
+}
+
+} // namespace
+
 DecisionRouteUpdate
 DecisionRouteDb::calculateUpdate(DecisionRouteDb&& newDb) const {
   DecisionRouteUpdate delta;
@@ -25,6 +77,8 @@ DecisionRouteDb::calculateUpdate(DecisionRouteDb&& newDb) const {
   // unicastRoutesToUpdate
   for (auto& [prefix, entry] : newDb.unicastRoutes) {
     const auto& search = unicastRoutes.find(prefix);
+    // NOTE: next-hops of entries are compared by group ID, best prefix
+    // entries by fingerprint
     if (search == unicastRoutes.end() || search->second != entry) {
       // new prefix, or prefix entry changed
       delta.addRouteToUpdate(std::move(entry));
@@ -38,21 +92,35 @@ DecisionRouteDb::calculateUpdate(DecisionRouteDb&& newDb) const {
     }
   }
 
-  // mplsRoutesToUpdate
-  for (const auto& [label, entry] : newDb.mplsRoutes) {
-    const auto& search = mplsRoutes.find(label);
-    if (search == mplsRoutes.end() || search->second != entry) {
-      delta.mplsRoutesToUpdate.emplace_back(entry);
-    }
-  }
+  calculateMplsUpdate(newDb.mplsRoutes, delta);
+  return delta;
+}
 
-  // mplsRoutesToDelete
-  for (auto const& [label, _] : mplsRoutes) {
-    if (!newDb.mplsRoutes.count(label)) {
-      delta.mplsRoutesToDelete.emplace_back(label);
+void
+DecisionRouteDb::calculateMplsUpdate(
+    MplsRoutes const& newMplsRoutes, DecisionRouteUpdate& delta) const {
+  auto oldIt = mplsRoutes.begin();
+  auto newIt = newMplsRoutes.begin();
+  while (oldIt != mplsRoutes.end() or newIt != newMplsRoutes.end()) {
+    // mplsRoutesToDelete
+    if (newIt == newMplsRoutes.end() or
+        (oldIt != mplsRoutes.end() and
+         MplsRoutes::compareLabels(oldIt->first, newIt->first))) {
+      delta.mplsRoutesToDelete.emplace_back(oldIt->first);
+      ++oldIt;
+      continue;
+    }
+    // mplsRoutesToUpdate
+    if (oldIt == mplsRoutes.end() or oldIt->first != newIt->first) {
+      delta.mplsRoutesToUpdate.emplace_back(newIt->second);
+    } else {
+      if (oldIt->second != newIt->second) {
+        delta.mplsRoutesToUpdate.emplace_back(newIt->second);
+      }
+      ++oldIt;
     }
+    ++newIt;
   }
-  return delta;
 }
 
 void
@@ -71,6 +139,70 @@ DecisionRouteDb::update(DecisionRouteUpdate const& update) {
   }
 }
 
+thrift::DecisionRouteDbSnapshot
+DecisionRouteDb::toSnapshot() const {
+  thrift::DecisionRouteDbSnapshot snapshot;
+  // group ID -> index into nextHopGroups
+  std::unordered_map<uint64_t, int32_t> groupIndices;
+  auto getGroupIndex = [&](NextHopGroup const& nexthops) {
+    auto [it, inserted] = groupIndices.emplace(
+        nexthops.getId(), snapshot.nextHopGroups_ref()->size());
+    if (inserted) {
+      snapshot.nextHopGroups_ref()->emplace_back(
+          nexthops.begin(), nexthops.end());
+    }
+    return it->second;
+  };
+
+  for (auto const& [prefix, entry] : unicastRoutes) {
+    auto& route = snapshot.unicastRoutes_ref()->emplace_back();
+    route.prefix_ref() = toIpPrefix(prefix);
+    route.nextHopGroup_ref() = getGroupIndex(entry.nexthops);
+    route.backupNextHops_ref()->assign(
+        entry.backupNexthops.begin(), entry.backupNexthops.end());
+    route.bestPrefixEntry_ref() = entry.bestPrefixEntry;
+    route.bestArea_ref() = entry.bestArea;
+    route.doNotInstall_ref() = entry.doNotInstall;
+  }
+  for (auto const& [label, entry] : mplsRoutes) {
+    auto& route = snapshot.mplsRoutes_ref()->emplace_back();
+    route.label_ref() = label;
+    route.nextHopGroup_ref() = getGroupIndex(entry.nexthops);
+  }
+  return snapshot;
+}
+
+DecisionRouteDb
+DecisionRouteDb::fromSnapshot(thrift::DecisionRouteDbSnapshot const& snapshot) {
+  std::vector<NextHopGroup> groups;
+  groups.reserve(snapshot.nextHopGroups_ref()->size());
+  for (auto const& nexthops : *snapshot.nextHopGroups_ref()) {
+    groups.emplace_back(
+        NextHopGroup::NextHopSet(nexthops.begin(), nexthops.end()));
+  }
+
+  DecisionRouteDb routeDb;
+  for (auto const& route : *snapshot.unicastRoutes_ref()) {
+    RibUnicastEntry entry(
+        toIPNetwork(*route.prefix_ref()),
+        groups.at(*route.nextHopGroup_ref()),
+        *route.bestPrefixEntry_ref(),
+        *route.bestArea_ref(),
+        *route.doNotInstall_ref());
+    entry.backupNexthops.insert(
+        route.backupNextHops_ref()->begin(), route.backupNextHops_ref()->end());
+    // as computed routes, so that route diffs compare fingerprints
+    entry.updateFingerprint();
+    routeDb.unicastRoutes.insert_or_assign(entry.prefix, std::move(entry));
+  }
+  for (auto const& route : *snapshot.mplsRoutes_ref()) {
+    routeDb.mplsRoutes.insert_or_assign(
+        *route.label_ref(),
+        RibMplsEntry(*route.label_ref(), groups.at(*route.nextHopGroup_ref())));
+  }
+  return routeDb;
+}
+
 SpfSolver::SpfSolver(
     const std::string& myNodeName,
     bool enableV4,
@@ -78,14 +210,29 @@ SpfSolver::SpfSolver(
     bool enableAdjacencyLabels,
     bool enableBgpRouteProgramming,
     bool enableBestRouteSelection,
-    bool v4OverV6Nexthop)
+    bool v4OverV6Nexthop,
+    size_t routeBuildThreads,
+    bool enableLfa,
+    bool enableUcmp,
+    std::vector<thrift::SrPolicyConfig> srPolicies)
     : myNodeName_(myNodeName),
       enableV4_(enableV4),
       enableNodeSegmentLabel_(enableNodeSegmentLabel),
       enableAdjacencyLabels_(enableAdjacencyLabels),
       enableBgpRouteProgramming_(enableBgpRouteProgramming),
       enableBestRouteSelection_(enableBestRouteSelection),
-      v4OverV6Nexthop_(v4OverV6Nexthop) {
+      v4OverV6Nexthop_(v4OverV6Nexthop),
+      enableLfa_(enableLfa),
+      enableUcmp_(enableUcmp) {
+  if (routeBuildThreads > 1) {
+    routeBuildPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        routeBuildThreads,
+        std::make_shared<folly::NamedThreadFactory>("DecisionRouteBuild"));
+  }
+  if (not srPolicies.empty()) {
+    srPolicySolver_ = std::make_unique<SrPolicySolver>(std::move(srPolicies));
+  }
+
   // Initialize stat keys
   fb303::fbData->addStatExportType("decision.adj_db_update", fb303::COUNT);
   fb303::fbData->addStatExportType(
@@ -93,6 +240,7 @@ SpfSolver::SpfSolver(
   fb303::fbData->addStatExportType("decision.no_route_to_label", fb303::COUNT);
   fb303::fbData->addStatExportType("decision.no_route_to_prefix", fb303::COUNT);
   fb303::fbData->addStatExportType("decision.path_build_ms", fb303::AVG);
+  fb303::fbData->addStatExportType("decision.ksp2_path_build_ms", fb303::AVG);
   fb303::fbData->addStatExportType("decision.prefix_db_update", fb303::COUNT);
   fb303::fbData->addStatExportType("decision.route_build_ms", fb303::AVG);
   fb303::fbData->addStatExportType("decision.route_build_runs", fb303::COUNT);
@@ -105,7 +253,14 @@ SpfSolver::SpfSolver(
       "decision.skipped_unicast_route", fb303::COUNT);
   fb303::fbData->addStatExportType("decision.spf_ms", fb303::AVG);
   fb303::fbData->addStatExportType("decision.spf_runs", fb303::COUNT);
+  fb303::fbData->addStatExportType("decision.spf_bfs_runs", fb303::COUNT);
+  fb303::fbData->addStatExportType("decision.spf_csr_builds", fb303::COUNT);
+  fb303::fbData->addStatExportType("decision.incremental_spf_ms", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "decision.incremental_spf_runs", fb303::COUNT);
   fb303::fbData->addStatExportType("decision.errors", fb303::COUNT);
+  fb303::fbData->addStatExportType("decision.route_memo.hits", fb303::COUNT);
+  fb303::fbData->addStatExportType("decision.route_memo.misses", fb303::COUNT);
 }
 
 SpfSolver::~SpfSolver() = default;
@@ -144,6 +299,48 @@ void
 SpfSolver::updateStaticMplsRoutes(
     const std::vector<RibMplsEntry>& mplsRoutesToUpdate,
     const std::vector<int32_t>& mplsRoutesToDelete) {
+  applyStaticMplsRoutes(mplsRoutesToUpdate, mplsRoutesToDelete);
+
+  // routes of self advertised prefixes use static MPLS next-hops
+  if (mplsRoutesToUpdate.size() or mplsRoutesToDelete.size()) {
+    routeMemo_.clear();
+  }
+}
+
+std::unordered_set<folly::CIDRNetwork>
+SpfSolver::updateStaticMplsRoutes(
+    const std::vector<RibMplsEntry>& mplsRoutesToUpdate,
+    const std::vector<int32_t>& mplsRoutesToDelete,
+    const std::string& myNodeName,
+    PrefixState const& prefixState) {
+  applyStaticMplsRoutes(mplsRoutesToUpdate, mplsRoutesToDelete);
+
+  std::unordered_set<int32_t> labels{
+      mplsRoutesToDelete.begin(), mplsRoutesToDelete.end()};
+  for (const auto& mplsRoute : mplsRoutesToUpdate) {
+    labels.emplace(mplsRoute.label);
+  }
+
+  // routes of self advertised prefixes use static MPLS next-hops of their
+  // prepend label, see addBestPaths()
+  std::unordered_set<folly::CIDRNetwork> dependents;
+  for (const auto& prefix : prefixState.getPrefixesFromNode(myNodeName)) {
+    for (const auto& [nodeAndArea, entry] : prefixState.prefixes().at(prefix)) {
+      if (nodeAndArea.first == myNodeName and entry->prependLabel_ref() and
+          labels.count(entry->prependLabel_ref().value())) {
+        dependents.emplace(prefix);
+        routeMemo_.erase(prefix);
+        break;
+      }
+    }
+  }
+  return dependents;
+}
+
+void
+SpfSolver::applyStaticMplsRoutes(
+    const std::vector<RibMplsEntry>& mplsRoutesToUpdate,
+    const std::vector<int32_t>& mplsRoutesToDelete) {
   // Process MPLS routes to add or update
   LOG_IF(INFO, mplsRoutesToUpdate.size())
       << "Adding/Updating " << mplsRoutesToUpdate.size()
@@ -173,10 +370,21 @@ SpfSolver::createRouteForPrefixOrGetStaticRoute(
     std::unordered_map<std::string, LinkState> const& areaLinkStates,
     PrefixState const& prefixState,
     folly::CIDRNetwork const& prefix) {
+  maybeInvalidateRouteMemo(myNodeName, areaLinkStates);
+  if (not prefixState.prefixes().count(prefix)) {
+    routeMemo_.erase(prefix);
+  }
+
   // route output from `PrefixState` has higher priority over
   // static unicast routes
-  if (auto maybeRoute = createRouteForPrefix(
-          myNodeName, areaLinkStates, prefixState, prefix)) {
+  auto maybeRoute = createRouteForPrefix(
+      myNodeName,
+      areaLinkStates,
+      prefixState,
+      prefix,
+      bestRoutesCache_,
+      routeMemo_);
+  if (maybeRoute) {
     return maybeRoute;
   }
 
@@ -188,14 +396,85 @@ SpfSolver::createRouteForPrefixOrGetStaticRoute(
   return std::nullopt;
 }
 
+void
+SpfSolver::maybeInvalidateRouteMemo(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) {
+  std::map<std::string, uint64_t> generations;
+  for (auto const& [area, linkState] : areaLinkStates) {
+    generations.emplace(area, linkState.getGeneration());
+  }
+  if (myNodeName != routeMemoNodeName_ or
+      generations != routeMemoGenerations_) {
+    routeMemo_.clear();
+    routeMemoNodeName_ = myNodeName;
+    routeMemoGenerations_ = std::move(generations);
+  }
+}
+
+void
+SpfSolver::updateRouteMemoCounters() const {
+  // approximate, accounts for the memo entries only. Prefix entries are
+  // shared with PrefixState, next-hops with their NextHopGroup
+  size_t bytes = 0;
+  for (auto const& [_, memo] : routeMemo_) {
+    bytes += sizeof(folly::CIDRNetwork) + sizeof(MemoizedRoute) +
+        memo.prefixEntries.size() * sizeof(PrefixEntries::value_type);
+  }
+  fb303::fbData->setCounter("decision.route_memo.entries", routeMemo_.size());
+  fb303::fbData->setCounter("decision.route_memo.bytes", bytes);
+}
+
 std::optional<RibUnicastEntry>
 SpfSolver::createRouteForPrefix(
     const std::string& myNodeName,
     std::unordered_map<std::string, LinkState> const& areaLinkStates,
     PrefixState const& prefixState,
-    folly::CIDRNetwork const& prefix) {
-  fb303::fbData->addStatValue("decision.get_route_for_prefix", 1, fb303::COUNT);
+    folly::CIDRNetwork const& prefix,
+    BestRoutesCache& bestRoutesCache,
+    RouteMemo& newRouteMemo) {
+  getRouteForPrefixCounter.add();
+
+  auto search = prefixState.prefixes().find(prefix);
+  if (search != prefixState.prefixes().end()) {
+    auto memoIt = routeMemo_.find(prefix);
+    if (memoIt != routeMemo_.end() and
+        memoIt->second.prefixEntries == search->second) {
+      routeMemoHitsCounter.add();
+      auto const& memo = memoIt->second;
+      if (memo.bestRouteSelection.has_value()) {
+        bestRoutesCache.insert_or_assign(prefix, *memo.bestRouteSelection);
+      } else {
+        bestRoutesCache.erase(prefix);
+      }
+      return memo.route;
+    }
+  }
+  routeMemoMissesCounter.add();
 
+  auto route = computeRouteForPrefix(
+      myNodeName, areaLinkStates, prefixState, prefix, bestRoutesCache);
+  if (search != prefixState.prefixes().end()) {
+    auto bestIt = bestRoutesCache.find(prefix);
+    newRouteMemo.insert_or_assign(
+        prefix,
+        MemoizedRoute{
+            search->second,
+            route,
+            bestIt != bestRoutesCache.end()
+                ? std::make_optional(bestIt->second)
+                : std::nullopt});
+  }
+  return route;
+}
+
+std::optional<RibUnicastEntry>
+SpfSolver::computeRouteForPrefix(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates,
+    PrefixState const& prefixState,
+    folly::CIDRNetwork const& prefix,
+    BestRoutesCache& bestRoutesCache) {
   // Sanity check for V4 prefixes
   const bool isV4Prefix = prefix.first.isV4();
   if (isV4Prefix and (not enableV4_) and (not v4OverV6Nexthop_)) {
@@ -203,8 +482,7 @@ SpfSolver::createRouteForPrefix(
                  << folly::IPAddress::networkToString(prefix)
                  << " while v4 is not enabled, and "
                  << "we are not allowing v4 prefix over v6 nexthop.";
-    fb303::fbData->addStatValue(
-        "decision.skipped_unicast_route", 1, fb303::COUNT);
+    skippedUnicastRouteCounter.add();
     return std::nullopt;
   }
 
@@ -215,34 +493,28 @@ SpfSolver::createRouteForPrefix(
   auto const& allPrefixEntries = search->second;
 
   // Clear best route selection in prefix state
-  bestRoutesCache_.erase(prefix);
+  bestRoutesCache.erase(prefix);
 
   //
-  // Create list of prefix-entries from reachable nodes only
-  // NOTE: We're copying prefix-entries and it can be expensive. Using
-  // pointers for storing prefix information can be efficient (CPU & Memory)
+  // Create list of prefix-entries from reachable nodes only. PrefixState
+  // keeps it up to date for the local node, copy and filter otherwise.
   //
-  auto prefixEntries = folly::copy(allPrefixEntries);
-  for (auto& [area, linkState] : areaLinkStates) {
-    auto const& mySpfResult = linkState.getSpfResult(myNodeName);
-
-    // Delete entries of unreachable nodes from prefixEntries
-    for (auto it = prefixEntries.cbegin(); it != prefixEntries.cend();) {
-      const auto& [prefixNode, prefixArea] = it->first;
-      // Only check reachability within the area that prefixNode belongs to.
-      if (area != prefixArea || mySpfResult.count(prefixNode)) {
-        ++it; // retain
-      } else {
-        it = prefixEntries.erase(it); // erase the unreachable prefix entry
-      }
-    }
+  PrefixEntries reachableEntries;
+  bool const useReachableView =
+      myNodeName == myNodeName_ and prefixState.hasReachableNodes();
+  if (not useReachableView) {
+    reachableEntries = filterReachablePrefixEntries(
+        myNodeName, areaLinkStates, allPrefixEntries);
   }
+  PrefixEntries const& prefixEntries = useReachableView
+      ? prefixState.getReachablePrefixEntries(prefix)
+      : reachableEntries;
 
   // Skip if no valid prefixes
   if (prefixEntries.empty()) {
     VLOG(3) << "Skipping route to " << folly::IPAddress::networkToString(prefix)
             << " with no reachable node.";
-    fb303::fbData->addStatValue("decision.no_route_to_prefix", 1, fb303::COUNT);
+    noRouteToPrefixCounter.add();
     return std::nullopt;
   }
 
@@ -280,16 +552,14 @@ SpfSolver::createRouteForPrefix(
       LOG(ERROR) << "Skipping route for "
                  << folly::IPAddress::networkToString(prefix)
                  << " which is advertised with BGP and non-BGP type.";
-      fb303::fbData->addStatValue(
-          "decision.skipped_unicast_route", 1, fb303::COUNT);
+      skippedUnicastRouteCounter.add();
       return std::nullopt;
     }
     if (missingMv and not enableBestRouteSelection_) {
       LOG(ERROR) << "Skipping route for "
                  << folly::IPAddress::networkToString(prefix)
                  << " at least one advertiser is missing its metric vector.";
-      fb303::fbData->addStatValue(
-          "decision.skipped_unicast_route", 1, fb303::COUNT);
+      skippedUnicastRouteCounter.add();
       return std::nullopt;
     }
   }
@@ -303,12 +573,12 @@ SpfSolver::createRouteForPrefix(
   if (bestRouteSelectionResult.allNodeAreas.empty()) {
     LOG(WARNING) << "No route to prefix "
                  << folly::IPAddress::networkToString(prefix);
-    fb303::fbData->addStatValue("decision.no_route_to_prefix", 1, fb303::COUNT);
+    noRouteToPrefixCounter.add();
     return std::nullopt;
   }
 
   // Set best route selection in prefix state
-  bestRoutesCache_.insert_or_assign(prefix, bestRouteSelectionResult);
+  bestRoutesCache.insert_or_assign(prefix, bestRouteSelectionResult);
 
   // Skip adding route for one prefix advertised by current node in all
   // following scenarios:
@@ -331,6 +601,20 @@ SpfSolver::createRouteForPrefix(
     return std::nullopt;
   }
 
+  // Steer onto the path of its segment routing policy, if any
+  if (srPolicySolver_ and myNodeName == myNodeName_) {
+    if (auto nextHop = getSrPolicyNextHop(
+            prefix, bestRouteSelectionResult, prefixEntries)) {
+      return addBestPaths(
+          myNodeName,
+          prefix,
+          bestRouteSelectionResult,
+          prefixEntries,
+          hasBGP,
+          {std::move(nextHop).value()});
+    }
+  }
+
   // Get the forwarding type and algorithm
   const auto [forwardingType, forwardingAlgo] =
       getPrefixForwardingTypeAndAlgorithm(
@@ -371,6 +655,188 @@ SpfSolver::createRouteForPrefix(
   }
 }
 
+void
+SpfSolver::createRoutesForPrefixesParallel(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates,
+    PrefixState const& prefixState,
+    DecisionRouteDb& routeDb) {
+  // Per-prefix computation only reads immutable state, except for the
+  // memoized shortest paths in LinkState, which are safe to fill from any
+  // thread. Our own SPF every prefix needs is computed upfront by
+  // buildRouteDb().
+  std::vector<folly::CIDRNetwork const*> prefixes;
+  prefixes.reserve(prefixState.prefixes().size());
+  for (auto const& [prefix, _] : prefixState.prefixes()) {
+    prefixes.emplace_back(&prefix);
+  }
+
+  struct Shard {
+    std::vector<RibUnicastEntry> routes;
+    BestRoutesCache bestRoutesCache;
+    RouteMemo routeMemo;
+  };
+  auto const numShards = std::max<size_t>(
+      1, std::min<size_t>(routeBuildPool_->numThreads(), prefixes.size()));
+  std::vector<Shard> shards(numShards);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numShards);
+  for (size_t i = 0; i < numShards; ++i) {
+    auto const begin = prefixes.size() * i / numShards;
+    auto const end = prefixes.size() * (i + 1) / numShards;
+    futures.emplace_back(folly::via(
+        folly::getKeepAliveToken(routeBuildPool_.get()),
+        [&, i, begin, end]() {
+          auto& shard = shards.at(i);
+          for (auto j = begin; j < end; ++j) {
+            if (auto maybeRoute = createRouteForPrefix(
+                    myNodeName,
+                    areaLinkStates,
+                    prefixState,
+                    *prefixes.at(j),
+                    shard.bestRoutesCache,
+                    shard.routeMemo)) {
+              shard.routes.emplace_back(std::move(maybeRoute).value());
+            }
+          }
+        }));
+  }
+  // rethrows the first failure, if any
+  folly::collect(futures).get();
+
+  // Merge shards. Prefixes are disjoint across shards so the outcome doesn't
+  // depend on the order in which shards completed
+  for (auto& shard : shards) {
+    for (auto& route : shard.routes) {
+      routeDb.addUnicastRoute(std::move(route));
+    }
+    bestRoutesCache_.merge(shard.bestRoutesCache);
+    for (auto& [prefix, memo] : shard.routeMemo) {
+      routeMemo_.insert_or_assign(prefix, std::move(memo));
+    }
+  }
+}
+
+void
+SpfSolver::computeSpfResults(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) {
+  const auto startTime = std::chrono::steady_clock::now();
+  auto computeArea = [this, &myNodeName](LinkState const& linkState) {
+    linkState.getSpfResult(myNodeName);
+    if (enableLfa_) {
+      for (auto const& link : linkState.linksFromNode(myNodeName)) {
+        linkState.getSpfResult(link->getOtherNodeName(myNodeName));
+      }
+    }
+  };
+  if (routeBuildPool_ and areaLinkStates.size() > 1) {
+    // memoization is synchronized per LinkState, areas don't contend
+    std::vector<folly::Future<folly::Unit>> futures;
+    futures.reserve(areaLinkStates.size());
+    for (auto const& [_, linkState] : areaLinkStates) {
+      futures.emplace_back(folly::via(
+          folly::getKeepAliveToken(routeBuildPool_.get()),
+          [&computeArea, &linkState = linkState]() {
+            computeArea(linkState);
+          }));
+    }
+    // rethrows the first failure, if any
+    folly::collect(futures).get();
+  } else {
+    for (auto const& [_, linkState] : areaLinkStates) {
+      computeArea(linkState);
+    }
+  }
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  fb303::fbData->addStatValue(
+      "decision.spf_build_ms", deltaTime.count(), fb303::AVG);
+}
+
+std::unordered_set<folly::CIDRNetwork>
+SpfSolver::updateSrPolicyPaths(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) {
+  // policies are headed at this node, paths are never computed for others
+  if (not srPolicySolver_ or myNodeName != myNodeName_) {
+    return {};
+  }
+  return srPolicySolver_->updatePaths(myNodeName, areaLinkStates);
+}
+
+std::optional<thrift::NextHopThrift>
+SpfSolver::getSrPolicyNextHop(
+    folly::CIDRNetwork const& prefix,
+    BestRouteSelectionResult const& bestRouteSelectionResult,
+    PrefixEntries const& prefixEntries) const {
+  auto const* policy = srPolicySolver_->getPolicyForPrefix(prefix);
+  if (not policy or
+      not bestRouteSelectionResult.hasNode(*policy->destination_ref())) {
+    return std::nullopt;
+  }
+  auto const* path = srPolicySolver_->getPath(*policy->name_ref());
+  if (not path) {
+    return std::nullopt;
+  }
+
+  // prepend label of the destination goes to the bottom of the stack
+  std::vector<int32_t> labels;
+  auto entryIt =
+      prefixEntries.find(NodeAndArea{*policy->destination_ref(), path->area});
+  if (entryIt != prefixEntries.end() and
+      entryIt->second->prependLabel_ref()) {
+    labels.emplace_back(entryIt->second->prependLabel_ref().value());
+  }
+  labels.insert(labels.end(), path->labels.begin(), path->labels.end());
+  std::optional<thrift::MplsAction> mplsAction;
+  if (not labels.empty()) {
+    mplsAction = createMplsAction(
+        thrift::MplsActionCode::PUSH, std::nullopt, std::move(labels));
+  }
+
+  auto const& firstLink = path->links.front();
+  return createNextHop(
+      prefix.first.isV4() and not v4OverV6Nexthop_
+          ? firstLink->getNhV4FromNode(myNodeName_)
+          : firstLink->getNhV6FromNode(myNodeName_),
+      firstLink->getIfaceFromNode(myNodeName_),
+      path->metric,
+      mplsAction,
+      firstLink->getArea(),
+      firstLink->getOtherNodeName(myNodeName_));
+}
+
+void
+SpfSolver::computeKsp2Paths(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates,
+    PrefixState const& prefixState) {
+  const auto startTime = std::chrono::steady_clock::now();
+  for (auto const& [area, linkState] : areaLinkStates) {
+    std::unordered_set<std::string> nodes;
+    for (auto const& prefix : prefixState.ksp2Prefixes()) {
+      for (auto const& [nodeAndArea, _] : prefixState.prefixes().at(prefix)) {
+        if (nodeAndArea.second == area) {
+          nodes.emplace(nodeAndArea.first);
+        }
+      }
+    }
+    if (nodes.empty()) {
+      continue;
+    }
+    linkState.computeKthPaths(
+        myNodeName,
+        std::vector<std::string>(nodes.begin(), nodes.end()),
+        2,
+        routeBuildPool_.get());
+  }
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  fb303::fbData->addStatValue(
+      "decision.ksp2_path_build_ms", deltaTime.count(), fb303::AVG);
+}
+
 std::optional<DecisionRouteDb>
 SpfSolver::buildRouteDb(
     const std::string& myNodeName,
@@ -391,15 +857,43 @@ SpfSolver::buildRouteDb(
 
   // Clear best route selection cache
   bestRoutesCache_.clear();
+  maybeInvalidateRouteMemo(myNodeName, areaLinkStates);
+
+  // shortest paths of all areas ahead of paths and routes depending on them
+  computeSpfResults(myNodeName, areaLinkStates);
+  updateSrPolicyPaths(myNodeName, areaLinkStates);
+  if (not prefixState.ksp2Prefixes().empty()) {
+    computeKsp2Paths(myNodeName, areaLinkStates, prefixState);
+  }
 
   // Create IPv4, IPv6 routes (includes IP -> MPLS routes)
-  for (const auto& [prefix, _] : prefixState.prefixes()) {
-    if (auto maybeRoute = createRouteForPrefix(
-            myNodeName, areaLinkStates, prefixState, prefix)) {
-      routeDb.addUnicastRoute(std::move(maybeRoute).value());
+  if (routeBuildPool_) {
+    createRoutesForPrefixesParallel(
+        myNodeName, areaLinkStates, prefixState, routeDb);
+  } else {
+    for (const auto& [prefix, _] : prefixState.prefixes()) {
+      if (auto maybeRoute = createRouteForPrefix(
+              myNodeName,
+              areaLinkStates,
+              prefixState,
+              prefix,
+              bestRoutesCache_,
+              routeMemo_)) {
+        routeDb.addUnicastRoute(std::move(maybeRoute).value());
+      }
     }
   }
 
+  // Drop memoized routes of withdrawn prefixes
+  for (auto it = routeMemo_.begin(); it != routeMemo_.end();) {
+    if (prefixState.prefixes().count(it->first)) {
+      ++it;
+    } else {
+      it = routeMemo_.erase(it);
+    }
+  }
+  updateRouteMemoCounters();
+
   // Create static unicast routes
   for (auto [prefix, ribUnicastEntry] : staticUnicastRoutes_) {
     if (routeDb.unicastRoutes.count(prefix)) {
@@ -409,102 +903,46 @@ SpfSolver::buildRouteDb(
     routeDb.addUnicastRoute(RibUnicastEntry(ribUnicastEntry));
   }
 
+  // Create MPLS routes (node labels, adjacency labels and static routes)
+  routeDb.mplsRoutes = buildMplsRoutes(myNodeName, areaLinkStates);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
+  fb303::fbData->addStatValue(
+      "decision.route_build_ms", deltaTime.count(), fb303::AVG);
+  return routeDb;
+} // buildRouteDb
+
+MplsRoutes
+SpfSolver::buildMplsRoutes(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) {
+  DecisionRouteDb routeDb{};
+
   //
   // Create MPLS routes for all nodeLabel
   //
   if (enableNodeSegmentLabel_) {
-    std::unordered_map<int32_t, std::pair<std::string, RibMplsEntry>>
-        labelToNode;
-    for (const auto& [area, linkState] : areaLinkStates) {
-      for (const auto& [_, adjDb] : linkState.getAdjacencyDatabases()) {
-        const auto topLabel = *adjDb.nodeLabel_ref();
-        const auto& nodeName = *adjDb.thisNodeName_ref();
-        // Top label is not set => Non-SR mode
-        if (topLabel == 0) {
-          LOG(INFO) << "Ignoring node label " << topLabel << " of node "
-                    << nodeName;
-          fb303::fbData->addStatValue(
-              "decision.skipped_mpls_route", 1, fb303::COUNT);
-          continue;
-        }
-        // If mpls label is not valid then ignore it
-        if (not isMplsLabelValid(topLabel)) {
-          LOG(ERROR) << "Ignoring invalid node label " << topLabel
-                     << " of node " << nodeName;
-          fb303::fbData->addStatValue(
-              "decision.skipped_mpls_route", 1, fb303::COUNT);
-          continue;
-        }
-
-        // There can be a temporary collision in node label allocation. Usually
-        // happens when two segmented networks allocating labels from the same
-        // range join together. In case of such conflict we respect the node
-        // label of bigger node-ID
-        auto iter = labelToNode.find(topLabel);
-        if (iter != labelToNode.end()) {
-          LOG(INFO) << "Found duplicate label " << topLabel << "from "
-                    << iter->second.first << " " << nodeName;
-          fb303::fbData->addStatValue(
-              "decision.duplicate_node_label", 1, fb303::COUNT);
-          if (iter->second.first < nodeName) {
-            continue;
-          }
-        }
-
-        // Install POP_AND_LOOKUP for next layer
-        if (*adjDb.thisNodeName_ref() == myNodeName) {
-          thrift::NextHopThrift nh;
-          nh.address_ref() = toBinaryAddress(folly::IPAddressV6("::"));
-          nh.area_ref() = area;
-          nh.mplsAction_ref() =
-              createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
-          labelToNode.erase(topLabel);
-          labelToNode.emplace(
-              topLabel,
-              std::make_pair(myNodeName, RibMplsEntry(topLabel, {nh})));
-          continue;
-        }
-
-        // Get best nexthop towards the node
-        auto metricNhs = getNextHopsWithMetric(
-            myNodeName,
-            {{adjDb.thisNodeName_ref().value(), area}},
-            false,
-            areaLinkStates);
-        if (metricNhs.second.empty()) {
-          LOG(WARNING) << "No route to nodeLabel " << std::to_string(topLabel)
-                       << " of node " << nodeName;
-          fb303::fbData->addStatValue(
-              "decision.no_route_to_label", 1, fb303::COUNT);
-          continue;
-        }
-
-        // Create nexthops with appropriate MplsAction (PHP and SWAP). Note that
-        // all nexthops are valid for routing without loops. Fib is responsible
-        // for installing these routes by making sure it programs least cost
-        // nexthops first and of same action type (based on HW limitations)
-        labelToNode.erase(topLabel);
-        labelToNode.emplace(
-            topLabel,
-            std::make_pair(
-                adjDb.thisNodeName_ref().value(),
-                RibMplsEntry(
-                    topLabel,
-                    getNextHopsThrift(
-                        myNodeName,
-                        {{adjDb.thisNodeName_ref().value(), area}},
-                        false /* isV4 */,
-                        v4OverV6Nexthop_,
-                        false /* perDestination */,
-                        metricNhs.first,
-                        metricNhs.second,
-                        topLabel,
-                        areaLinkStates))));
+    std::unordered_set<int32_t> labels;
+    for (const auto& [_, linkState] : areaLinkStates) {
+      for (const auto& labelNodes : linkState.getNodeLabelIndex()) {
+        labels.emplace(labelNodes.first);
       }
     }
-
-    for (auto& [_, nodeToEntry] : labelToNode) {
-      routeDb.addMplsRoute(std::move(nodeToEntry.second));
+    const bool trackOwners = myNodeName == myNodeName_;
+    if (trackOwners) {
+      nodeLabelOwners_.clear();
+    }
+    for (const auto label : labels) {
+      std::string owner;
+      if (auto entry =
+              createNodeLabelRoute(myNodeName, label, areaLinkStates, owner)) {
+        routeDb.addMplsRoute(std::move(entry).value());
+        if (trackOwners) {
+          nodeLabelOwners_.emplace(label, std::move(owner));
+        }
+      }
     }
   }
 
@@ -523,8 +961,7 @@ SpfSolver::buildRouteDb(
         if (not isMplsLabelValid(topLabel)) {
           LOG(ERROR) << "Ignoring invalid adjacency label " << topLabel
                      << " of link " << link->directionalToString(myNodeName);
-          fb303::fbData->addStatValue(
-              "decision.skipped_mpls_route", 1, fb303::COUNT);
+          skippedMplsRouteCounter.add();
           continue;
         }
 
@@ -548,13 +985,145 @@ SpfSolver::buildRouteDb(
     routeDb.addMplsRoute(RibMplsEntry(mplsEntry));
   }
 
-  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
-  fb303::fbData->addStatValue(
-      "decision.route_build_ms", deltaTime.count(), fb303::AVG);
-  return routeDb;
-} // buildRouteDb
+  return std::move(routeDb.mplsRoutes);
+}
+
+std::unordered_map<int32_t, std::optional<RibMplsEntry>>
+SpfSolver::buildNodeLabelRoutes(
+    const std::string& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates,
+    std::unordered_set<std::string> const& nodes) {
+  std::unordered_map<int32_t, std::optional<RibMplsEntry>> routes;
+  if (not enableNodeSegmentLabel_) {
+    return routes;
+  }
+
+  std::unordered_set<int32_t> labels;
+  for (const auto& [_, linkState] : areaLinkStates) {
+    for (const auto& node : nodes) {
+      auto it = linkState.getNodeAdjacencyDbs().find(node);
+      if (it != linkState.getNodeAdjacencyDbs().end()) {
+        labels.emplace(it->second.nodeLabel);
+      }
+    }
+  }
+  const bool trackOwners = myNodeName == myNodeName_;
+  if (trackOwners) {
+    // the node may have withdrawn its label since
+    for (const auto& [label, owner] : nodeLabelOwners_) {
+      if (nodes.count(owner)) {
+        labels.emplace(label);
+      }
+    }
+  }
+
+  for (const auto label : labels) {
+    std::string owner;
+    auto entry = createNodeLabelRoute(myNodeName, label, areaLinkStates, owner);
+    if (trackOwners) {
+      if (entry.has_value()) {
+        nodeLabelOwners_.insert_or_assign(label, std::move(owner));
+      } else {
+        nodeLabelOwners_.erase(label);
+      }
+    }
+    // static MPLS routes are part of the route database as well
+    if (not entry.has_value() and staticMplsRoutes_.count(label)) {
+      entry = staticMplsRoutes_.at(label);
+    }
+    routes.emplace(label, std::move(entry));
+  }
+  return routes;
+}
+
+std::optional<RibMplsEntry>
+SpfSolver::createNodeLabelRoute(
+    const std::string& myNodeName,
+    int32_t label,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates,
+    std::string& owner) {
+  // nodes advertising the label, by name
+  std::vector<std::pair<std::string, std::string>> nodeAreas;
+  for (const auto& [area, linkState] : areaLinkStates) {
+    for (const auto& node : linkState.getNodesWithLabel(label)) {
+      nodeAreas.emplace_back(node, area);
+    }
+  }
+  if (nodeAreas.empty()) {
+    return std::nullopt;
+  }
+  std::sort(nodeAreas.begin(), nodeAreas.end());
+
+  // Top label is not set => Non-SR mode
+  if (label == 0) {
+    for (const auto& [nodeName, _] : nodeAreas) {
+      LOG(INFO) << "Ignoring node label " << label << " of node " << nodeName;
+    }
+    skippedMplsRouteCounter.add(nodeAreas.size());
+    return std::nullopt;
+  }
+  // If mpls label is not valid then ignore it
+  if (not isMplsLabelValid(label)) {
+    for (const auto& [nodeName, _] : nodeAreas) {
+      LOG(ERROR) << "Ignoring invalid node label " << label << " of node "
+                 << nodeName;
+    }
+    skippedMplsRouteCounter.add(nodeAreas.size());
+    return std::nullopt;
+  }
+
+  // There can be a temporary collision in node label allocation. Usually
+  // happens when two segmented networks allocating labels from the same
+  // range join together. In case of such conflict we respect the node label
+  // of the reachable node with the lowest name
+  if (nodeAreas.size() > 1) {
+    LOG(INFO) << "Found duplicate label " << label << " from "
+              << nodeAreas.size() << " nodes";
+    duplicateNodeLabelCounter.add(nodeAreas.size() - 1);
+  }
+
+  // Install POP_AND_LOOKUP for next layer
+  for (const auto& [nodeName, area] : nodeAreas) {
+    if (nodeName == myNodeName) {
+      thrift::NextHopThrift nh;
+      nh.address_ref() = toBinaryAddress(folly::IPAddressV6("::"));
+      nh.area_ref() = area;
+      nh.mplsAction_ref() =
+          createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
+      owner = myNodeName;
+      return RibMplsEntry(label, {nh});
+    }
+  }
+
+  for (const auto& [nodeName, area] : nodeAreas) {
+    // Get best nexthop towards the node
+    auto nextHopLinks =
+        getNextHopLinks(myNodeName, {{nodeName, area}}, areaLinkStates);
+    if (nextHopLinks.second.empty()) {
+      LOG(WARNING) << "No route to nodeLabel " << std::to_string(label)
+                   << " of node " << nodeName;
+      noRouteToLabelCounter.add();
+      continue;
+    }
+
+    // Create nexthops with appropriate MplsAction (PHP and SWAP). Note that
+    // all nexthops are valid for routing without loops. Fib is responsible
+    // for installing these routes by making sure it programs least cost
+    // nexthops first and of same action type (based on HW limitations)
+    owner = nodeName;
+    return RibMplsEntry(
+        label,
+        getNextHopsThrift(
+            myNodeName,
+            {{nodeName, area}},
+            false /* isV4 */,
+            v4OverV6Nexthop_,
+            nextHopLinks.first,
+            nextHopLinks.second,
+            label));
+  }
+  return std::nullopt;
+}
 
 BestRouteSelectionResult
 SpfSolver::selectBestRoutes(
@@ -576,7 +1145,7 @@ SpfSolver::selectBestRoutes(
   } else {
     // If it is openr route, all nodes are considered as best nodes.
     for (auto const& [nodeAndArea, prefixEntry] : prefixEntries) {
-      ret.allNodeAreas.emplace(nodeAndArea);
+      ret.allNodeAreas.emplace_hint(ret.allNodeAreas.end(), nodeAndArea);
     }
     ret.bestNodeArea = *ret.allNodeAreas.begin();
     ret.success = true;
@@ -587,7 +1156,7 @@ SpfSolver::selectBestRoutes(
 
 std::optional<int64_t>
 SpfSolver::getMinNextHopThreshold(
-    BestRouteSelectionResult nodes, PrefixEntries const& prefixEntries) {
+    BestRouteSelectionResult const& nodes, PrefixEntries const& prefixEntries) {
   std::optional<int64_t> maxMinNexthopForPrefix = std::nullopt;
   for (const auto& nodeArea : nodes.allNodeAreas) {
     const auto& prefixEntry = prefixEntries.at(nodeArea);
@@ -605,24 +1174,26 @@ BestRouteSelectionResult
 SpfSolver::maybeFilterDrainedNodes(
     BestRouteSelectionResult&& result,
     std::unordered_map<std::string, LinkState> const& areaLinkStates) const {
-  BestRouteSelectionResult filtered = folly::copy(result);
-  for (auto iter = filtered.allNodeAreas.cbegin();
-       iter != filtered.allNodeAreas.cend();) {
-    const auto& [node, area] = *iter;
-    if (areaLinkStates.at(area).isNodeOverloaded(node)) {
-      iter = filtered.allNodeAreas.erase(iter);
+  auto isOverloaded = [&areaLinkStates](NodeAndArea const& nodeAndArea) {
+    return areaLinkStates.at(nodeAndArea.second)
+        .isNodeOverloaded(nodeAndArea.first);
+  };
+  // Keep result as is if no node or every node is drained
+  size_t numOverloaded = std::count_if(
+      result.allNodeAreas.cbegin(), result.allNodeAreas.cend(), isOverloaded);
+  if (numOverloaded == 0 or numOverloaded == result.allNodeAreas.size()) {
+    return std::move(result);
+  }
+
+  for (auto iter = result.allNodeAreas.cbegin();
+       iter != result.allNodeAreas.cend();) {
+    if (isOverloaded(*iter)) {
+      iter = result.allNodeAreas.erase(iter);
     } else {
       ++iter;
     }
   }
-
-  // Update the bestNodeArea to a valid key
-  if (not filtered.allNodeAreas.empty() and
-      filtered.bestNodeArea != result.bestNodeArea) {
-    filtered.bestNodeArea = *filtered.allNodeAreas.begin();
-  }
-
-  return filtered.allNodeAreas.empty() ? result : filtered;
+  return std::move(result);
 }
 
 BestRouteSelectionResult
@@ -631,9 +1202,10 @@ SpfSolver::runBestPathSelectionBgp(
     PrefixEntries const& prefixEntries,
     std::unordered_map<std::string, LinkState> const& areaLinkStates) {
   BestRouteSelectionResult ret;
-  std::optional<thrift::MetricVector> bestVector;
+  // refers to the metric vector of the best entry, entries outlive selection
+  thrift::MetricVector const* bestVector{nullptr};
   for (auto const& [nodeAndArea, prefixEntry] : prefixEntries) {
-    switch (bestVector.has_value()
+    switch (bestVector
                 ? MetricVectorUtils::compareMetricVectors(
                       can_throw(*prefixEntry->mv_ref()), *bestVector)
                 : MetricVectorUtils::CompareResult::WINNER) {
@@ -641,7 +1213,7 @@ SpfSolver::runBestPathSelectionBgp(
       ret.allNodeAreas.clear();
       FOLLY_FALLTHROUGH;
     case MetricVectorUtils::CompareResult::TIE_WINNER:
-      bestVector = can_throw(*prefixEntry->mv_ref());
+      bestVector = &can_throw(*prefixEntry->mv_ref());
       ret.bestNodeArea = nodeAndArea;
       FOLLY_FALLTHROUGH;
     case MetricVectorUtils::CompareResult::TIE_LOOSER:
@@ -684,43 +1256,84 @@ SpfSolver::selectBestPathsSpf(
   // TODO: This is one off the hack to unblock special routing needs. With
   // complete support of multi-area setup, we can delete the following code
   // block.
-  auto filteredBestNodeAreas = bestRouteSelectionResult.allNodeAreas;
+  // Copy best node areas only when they need filtering
+  std::optional<std::set<NodeAndArea>> filteredBestNodeAreas;
   if (bestRouteSelectionResult.hasNode(myNodeName) and perDestination) {
     for (const auto& [nodeAndArea, prefixEntry] : prefixEntries) {
       if (nodeAndArea.first == myNodeName and prefixEntry->prependLabel_ref()) {
-        filteredBestNodeAreas.erase(nodeAndArea);
+        filteredBestNodeAreas = bestRouteSelectionResult.allNodeAreas;
+        filteredBestNodeAreas->erase(nodeAndArea);
         break;
       }
     }
   }
 
   // Get next-hops
-  const auto nextHopsWithMetric = getNextHopsWithMetric(
-      myNodeName, filteredBestNodeAreas, perDestination, areaLinkStates);
-  if (nextHopsWithMetric.second.empty()) {
+  std::optional<std::unordered_set<thrift::NextHopThrift>> nextHops;
+  if (perDestination) {
+    const auto nextHopsWithMetric = getNextHopsWithMetric(
+        myNodeName,
+        filteredBestNodeAreas ? *filteredBestNodeAreas
+                              : bestRouteSelectionResult.allNodeAreas,
+        areaLinkStates);
+    if (not nextHopsWithMetric.second.empty()) {
+      nextHops = getNextHopsThrift(
+          myNodeName,
+          bestRouteSelectionResult.allNodeAreas,
+          isV4Prefix,
+          v4OverV6Nexthop_,
+          nextHopsWithMetric.first,
+          nextHopsWithMetric.second,
+          areaLinkStates,
+          prefixEntries);
+    }
+  } else {
+    const auto nextHopLinks = getNextHopLinks(
+        myNodeName, bestRouteSelectionResult.allNodeAreas, areaLinkStates);
+    if (not nextHopLinks.second.empty()) {
+      nextHops = getNextHopsThrift(
+          myNodeName,
+          bestRouteSelectionResult.allNodeAreas,
+          isV4Prefix,
+          v4OverV6Nexthop_,
+          nextHopLinks.first,
+          nextHopLinks.second,
+          std::nullopt /* swapLabel */);
+    }
+  }
+  if (not nextHops.has_value()) {
     VLOG(3) << "No route to prefix "
             << folly::IPAddress::networkToString(prefix);
-    fb303::fbData->addStatValue("decision.no_route_to_prefix", 1, fb303::COUNT);
+    noRouteToPrefixCounter.add();
     return std::nullopt;
   }
 
-  return addBestPaths(
+  auto route = addBestPaths(
       myNodeName,
       prefix,
       bestRouteSelectionResult,
       prefixEntries,
       isBgp,
-      getNextHopsThrift(
-          myNodeName,
-          bestRouteSelectionResult.allNodeAreas,
-          isV4Prefix,
-          v4OverV6Nexthop_,
-          perDestination,
-          nextHopsWithMetric.first,
-          nextHopsWithMetric.second,
-          std::nullopt /* swapLabel */,
-          areaLinkStates,
-          prefixEntries));
+      std::move(nextHops).value());
+  if (route.has_value() and enableUcmp_ and not perDestination) {
+    route->nexthops = getUcmpNextHops(
+        myNodeName,
+        filteredBestNodeAreas ? *filteredBestNodeAreas
+                              : bestRouteSelectionResult.allNodeAreas,
+        route->nexthops,
+        areaLinkStates);
+  }
+  // backup next-hops only for IP routes, SR_MPLS routes carry per
+  // destination labels
+  if (route.has_value() and enableLfa_ and not perDestination) {
+    route->backupNexthops = getLfaNextHops(
+        myNodeName,
+        bestRouteSelectionResult.allNodeAreas,
+        isV4Prefix,
+        route->nexthops,
+        areaLinkStates);
+  }
+  return route;
 }
 
 std::optional<RibUnicastEntry>
@@ -740,8 +1353,7 @@ SpfSolver::selectBestPathsKsp2(
                << " for algorithm KSPF2_ED_ECMP of "
                << folly::IPAddress::networkToString(prefix);
 
-    fb303::fbData->addStatValue(
-        "decision.incompatible_forwarding_type", 1, fb303::COUNT);
+    incompatibleForwardingTypeCounter.add();
     return std::nullopt;
   }
 
@@ -805,10 +1417,10 @@ SpfSolver::selectBestPathsKsp2(
       for (auto& link : path) {
         cost += link->getMetricFromNode(nextNodeName);
         nextNodeName = link->getOtherNodeName(nextNodeName);
-        auto& adjDb = linkState.getAdjacencyDatabases().at(nextNodeName);
-        labels.push_front(adjDb.get_nodeLabel());
-        if (not isMplsLabelValid(adjDb.get_nodeLabel())) {
-          invalidNodes.emplace_back(adjDb.get_thisNodeName());
+        auto const nodeLabel = linkState.getNodeLabel(nextNodeName);
+        labels.push_front(nodeLabel);
+        if (not isMplsLabelValid(nodeLabel)) {
+          invalidNodes.emplace_back(nextNodeName);
         }
       }
       // Ignore paths including nodes with invalid node labels.
@@ -915,12 +1527,15 @@ SpfSolver::addBestPaths(
   }
 
   // Create RibUnicastEntry and add it the list
-  return RibUnicastEntry(
+  RibUnicastEntry entry(
       prefix,
       std::move(nextHops),
       *(prefixEntries.at(bestRouteSelectionResult.bestNodeArea)),
       bestRouteSelectionResult.bestNodeArea.second,
       isBgp & (not enableBgpRouteProgramming_)); // doNotInstall
+  // route diffs compare fingerprints instead of best prefix entries
+  entry.updateFingerprint();
+  return entry;
 }
 
 std::pair<Metric, std::unordered_set<std::string>>
@@ -956,7 +1571,6 @@ std::pair<
 SpfSolver::getNextHopsWithMetric(
     const std::string& myNodeName,
     const std::set<NodeAndArea>& dstNodeAreas,
-    bool perDestination,
     std::unordered_map<std::string, LinkState> const& areaLinkStates) {
   // build up next hop nodes that are along a shortest path to the prefix
   std::unordered_map<
@@ -990,9 +1604,8 @@ SpfSolver::getNextHopsWithMetric(
 
     // Add neighbors with shortest path to the prefix
     for (const auto& dstNode : minCostNodes) {
-      const auto dstNodeRef = perDestination ? dstNode : "";
       for (const auto& nhName : shortestPathsFromHere.at(dstNode).nextHops()) {
-        nextHopNodes[std::make_pair(nhName, dstNodeRef)] = shortestMetric -
+        nextHopNodes[std::make_pair(nhName, dstNode)] = shortestMetric -
             linkState.getMetricFromAToB(myNodeName, nhName).value();
       }
     }
@@ -1001,6 +1614,47 @@ SpfSolver::getNextHopsWithMetric(
   return std::make_pair(shortestMetric, nextHopNodes);
 }
 
+std::pair<
+    Metric /* min metric to destination */,
+    std::unordered_map<std::string /* area */, SpfSolver::NextHopLinks>>
+SpfSolver::getNextHopLinks(
+    const std::string& myNodeName,
+    const std::set<NodeAndArea>& dstNodeAreas,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) const {
+  std::unordered_map<std::string, NextHopLinks> nextHopLinks;
+  Metric shortestMetric = std::numeric_limits<Metric>::max();
+
+  for (auto const& [area, linkState] : areaLinkStates) {
+    auto const& minMetricNodes =
+        getMinCostNodes(linkState.getSpfResult(myNodeName), dstNodeAreas);
+
+    // Choose routes with lowest Metric, ecmp across areas of the same one
+    if (shortestMetric < minMetricNodes.first) {
+      continue;
+    }
+    if (shortestMetric > minMetricNodes.first) {
+      shortestMetric = minMetricNodes.first;
+      nextHopLinks.clear();
+    }
+
+    // unite next-hops of the closest destinations
+    NextHopLinks areaNextHopLinks{linkState.getNextHopIndex(myNodeName), {}};
+    for (const auto& dstNode : minMetricNodes.second) {
+      if (auto const* bits = areaNextHopLinks.index->getNextHopLinks(dstNode)) {
+        LinkState::NextHopIndex::unite(areaNextHopLinks.bits, *bits);
+      }
+    }
+    if (std::any_of(
+            areaNextHopLinks.bits.begin(),
+            areaNextHopLinks.bits.end(),
+            [](uint64_t word) { return word != 0; })) {
+      nextHopLinks.emplace(area, std::move(areaNextHopLinks));
+    }
+  }
+
+  return std::make_pair(shortestMetric, std::move(nextHopLinks));
+}
+
 // TODO Let's use strong-types for the bools to detect any abusement at the
 // building time.
 std::unordered_set<thrift::NextHopThrift>
@@ -1009,15 +1663,11 @@ SpfSolver::getNextHopsThrift(
     const std::set<NodeAndArea>& dstNodeAreas,
     bool isV4,
     bool v4OverV6Nexthop,
-    bool perDestination,
     const Metric minMetric,
     std::unordered_map<std::pair<std::string, std::string>, Metric>
         nextHopNodes,
-    std::optional<int32_t> swapLabel,
     std::unordered_map<std::string, LinkState> const& areaLinkStates,
     PrefixEntries const& prefixEntries) const {
-  // Note: perDestination flag determines the next-hop search range by whether
-  // filtering those not-in dstNodeAreas or not.
   // TODO: Reorg this function to make the logic cleaner, and cleanup unused
   // code.
 
@@ -1026,10 +1676,9 @@ SpfSolver::getNextHopsThrift(
   std::unordered_set<thrift::NextHopThrift> nextHops;
   for (const auto& [area, linkState] : areaLinkStates) {
     for (const auto& link : linkState.linksFromNode(myNodeName)) {
-      for (const auto& [dstNode, dstArea] :
-           perDestination ? dstNodeAreas : std::set<NodeAndArea>{{"", ""}}) {
+      for (const auto& [dstNode, dstArea] : dstNodeAreas) {
         // Only consider destinations within the area
-        if (not dstArea.empty() and area != dstArea) {
+        if (area != dstArea) {
           continue;
         }
 
@@ -1045,7 +1694,7 @@ SpfSolver::getNextHopsThrift(
         // Ignore link if other side of link is one of our destination and we
         // are trying to send to dstNode via neighbor (who is also our
         // destination)
-        if (not dstNode.empty() and dstNodeAreas.count({neighborNode, area}) and
+        if (dstNodeAreas.count({neighborNode, area}) and
             neighborNode != dstNode) {
           continue;
         }
@@ -1057,47 +1706,33 @@ SpfSolver::getNextHopsThrift(
           continue;
         }
 
-        // Create associated mpls action if swapLabel is provided
+        // Create associated mpls action towards dest node
         std::optional<thrift::MplsAction> mplsAction;
-        if (swapLabel.has_value()) {
-          CHECK(not mplsAction.has_value());
-          bool isNextHopAlsoDst = dstNodeAreas.count({neighborNode, area});
-          mplsAction = createMplsAction(
-              isNextHopAlsoDst ? thrift::MplsActionCode::PHP
-                               : thrift::MplsActionCode::SWAP,
-              isNextHopAlsoDst ? std::nullopt : swapLabel);
-        }
+        std::vector<int32_t> pushLabels;
 
-        // Create associated mpls action if dest node is not empty
-        if (not dstNode.empty()) {
-          std::vector<int32_t> pushLabels;
-
-          // Add destination prepend label if any.
-          auto& dstPrefixEntry = prefixEntries.at({dstNode, area});
-          if (dstPrefixEntry->prependLabel_ref()) {
-            pushLabels.emplace_back(dstPrefixEntry->prependLabel_ref().value());
-            if (not isMplsLabelValid(pushLabels.back())) {
-              continue;
-            }
+        // Add destination prepend label if any.
+        auto& dstPrefixEntry = prefixEntries.at({dstNode, area});
+        if (dstPrefixEntry->prependLabel_ref()) {
+          pushLabels.emplace_back(dstPrefixEntry->prependLabel_ref().value());
+          if (not isMplsLabelValid(pushLabels.back())) {
+            continue;
           }
+        }
 
-          // Add destination node label if it is not neighbor node
-          if (dstNode != neighborNode) {
-            pushLabels.emplace_back(
-                *linkState.getAdjacencyDatabases().at(dstNode).nodeLabel_ref());
-            if (not isMplsLabelValid(pushLabels.back())) {
-              continue;
-            }
+        // Add destination node label if it is not neighbor node
+        if (dstNode != neighborNode) {
+          pushLabels.emplace_back(linkState.getNodeLabel(dstNode));
+          if (not isMplsLabelValid(pushLabels.back())) {
+            continue;
           }
+        }
 
-          // Create PUSH mpls action if there are labels to push
-          if (not pushLabels.empty()) {
-            CHECK(not mplsAction.has_value());
-            mplsAction = createMplsAction(
-                thrift::MplsActionCode::PUSH,
-                std::nullopt,
-                std::move(pushLabels));
-          }
+        // Create PUSH mpls action if there are labels to push
+        if (not pushLabels.empty()) {
+          mplsAction = createMplsAction(
+              thrift::MplsActionCode::PUSH,
+              std::nullopt,
+              std::move(pushLabels));
         }
 
         nextHops.emplace(createNextHop(
@@ -1108,10 +1743,257 @@ SpfSolver::getNextHopsThrift(
             mplsAction,
             link->getArea(),
             link->getOtherNodeName(myNodeName)));
-      } // end for perDestination ...
+      } // end for dstNodeAreas ...
     } // end for linkState ...
   }
   return nextHops;
 }
 
+std::unordered_set<thrift::NextHopThrift>
+SpfSolver::getNextHopsThrift(
+    const std::string& myNodeName,
+    const std::set<NodeAndArea>& dstNodeAreas,
+    bool isV4,
+    bool v4OverV6Nexthop,
+    const Metric minMetric,
+    std::unordered_map<std::string, NextHopLinks> const& nextHopLinks,
+    std::optional<int32_t> swapLabel) const {
+  std::unordered_set<thrift::NextHopThrift> nextHops;
+  for (const auto& [area, areaNextHopLinks] : nextHopLinks) {
+    areaNextHopLinks.index->forEachLink(
+        areaNextHopLinks.bits, [&](std::shared_ptr<Link> const& link) {
+          const auto& neighborNode = link->getOtherNodeName(myNodeName);
+
+          // Create associated mpls action if swapLabel is provided
+          std::optional<thrift::MplsAction> mplsAction;
+          if (swapLabel.has_value()) {
+            bool isNextHopAlsoDst = dstNodeAreas.count({neighborNode, area});
+            mplsAction = createMplsAction(
+                isNextHopAlsoDst ? thrift::MplsActionCode::PHP
+                                 : thrift::MplsActionCode::SWAP,
+                isNextHopAlsoDst ? std::nullopt : swapLabel);
+          }
+
+          nextHops.emplace(createNextHop(
+              isV4 and not v4OverV6Nexthop ? link->getNhV4FromNode(myNodeName)
+                                           : link->getNhV6FromNode(myNodeName),
+              link->getIfaceFromNode(myNodeName),
+              minMetric,
+              mplsAction,
+              link->getArea(),
+              neighborNode));
+        });
+  }
+  return nextHops;
+}
+
+std::unordered_set<thrift::NextHopThrift>
+SpfSolver::getUcmpNextHops(
+    const std::string& myNodeName,
+    const std::set<NodeAndArea>& dstNodeAreas,
+    std::unordered_set<thrift::NextHopThrift> const& nextHops,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) const {
+  if (nextHops.size() < 2) {
+    return nextHops;
+  }
+
+  // <area, neighbor> -> capacity through neighbor, and weight of the links
+  // towards it among nextHops
+  std::map<std::pair<std::string, std::string>, std::pair<double, double>>
+      neighborCapacities;
+  // <area, neighbor, ifName> -> link weight
+  std::map<std::tuple<std::string, std::string, std::string>, double>
+      linkWeights;
+  for (auto const& [area, linkState] : areaLinkStates) {
+    auto const& minCostNodes =
+        getMinCostNodes(linkState.getSpfResult(myNodeName), dstNodeAreas)
+            .second;
+    if (minCostNodes.empty()) {
+      continue;
+    }
+    for (auto const& [neighbor, capacity] : linkState.getUcmpCapacities(
+             myNodeName,
+             std::vector<std::string>(
+                 minCostNodes.begin(), minCostNodes.end()))) {
+      neighborCapacities[{area, neighbor}].first = capacity;
+    }
+    for (auto const& link : linkState.linksFromNode(myNodeName)) {
+      linkWeights[{area,
+                   link->getOtherNodeName(myNodeName),
+                   link->getIfaceFromNode(myNodeName)}] = static_cast<double>(
+          std::max<int64_t>(link->getWeightFromNode(myNodeName), 1));
+    }
+  }
+
+  auto getLinkWeight = [&linkWeights](thrift::NextHopThrift const& nextHop) {
+    return folly::get_default(
+        linkWeights,
+        std::make_tuple(
+            nextHop.area_ref().value_or(""),
+            nextHop.neighborNodeName_ref().value_or(""),
+            nextHop.address_ref()->ifName_ref().value_or("")),
+        1.0);
+  };
+  for (auto const& nextHop : nextHops) {
+    neighborCapacities[{nextHop.area_ref().value_or(""),
+                        nextHop.neighborNodeName_ref().value_or("")}]
+        .second += getLinkWeight(nextHop);
+  }
+
+  // split the capacity through each neighbor across its links
+  std::vector<thrift::NextHopThrift const*> ordered;
+  std::vector<double> capacities;
+  for (auto const& nextHop : nextHops) {
+    auto const& [capacity, weight] = neighborCapacities.at(
+        {nextHop.area_ref().value_or(""),
+         nextHop.neighborNodeName_ref().value_or("")});
+    auto const linkWeight = getLinkWeight(nextHop);
+    ordered.emplace_back(&nextHop);
+    capacities.emplace_back(
+        capacity > 0 ? capacity * linkWeight / weight : linkWeight);
+  }
+
+  auto const weights = normalizeUcmpWeights(capacities);
+  if (std::adjacent_find(
+          weights.begin(), weights.end(), std::not_equal_to<>()) ==
+      weights.end()) {
+    return nextHops;
+  }
+  std::unordered_set<thrift::NextHopThrift> weightedNextHops;
+  for (size_t i = 0; i < ordered.size(); ++i) {
+    auto nextHop = *ordered[i];
+    nextHop.weight_ref() = weights[i];
+    weightedNextHops.emplace(std::move(nextHop));
+  }
+  return weightedNextHops;
+}
+
+// static
+std::vector<int32_t>
+SpfSolver::normalizeUcmpWeights(
+    std::vector<double> const& capacities, int32_t maxTotal) {
+  std::vector<int32_t> weights(capacities.size(), 1);
+  double total = 0;
+  double minCapacity = std::numeric_limits<double>::max();
+  for (auto const capacity : capacities) {
+    if (capacity > 0) {
+      total += capacity;
+      minCapacity = std::min(minCapacity, capacity);
+    }
+  }
+  if (total <= 0 or capacities.size() >= static_cast<size_t>(maxTotal)) {
+    return weights;
+  }
+
+  // largest multiple of the smallest capacity fitting maxTotal, such that
+  // small ratios are kept exact. Shrunk while weights rounded up to 1
+  // overflow maxTotal, all weights are 1 at worst
+  double scale = std::floor(maxTotal * minCapacity / total) / minCapacity;
+  if (scale <= 0) {
+    scale = maxTotal / total;
+  }
+  while (true) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < capacities.size(); ++i) {
+      weights[i] = static_cast<int32_t>(std::max<int64_t>(
+          std::llround(std::max(capacities[i], 0.0) * scale), 1));
+      sum += weights[i];
+    }
+    if (sum <= maxTotal) {
+      break;
+    }
+    scale *= 0.9;
+  }
+
+  int32_t divisor = 0;
+  for (auto const weight : weights) {
+    divisor = std::gcd(divisor, weight);
+  }
+  for (auto& weight : weights) {
+    weight /= divisor;
+  }
+  return weights;
+}
+
+std::unordered_set<thrift::NextHopThrift>
+SpfSolver::getLfaNextHops(
+    const std::string& myNodeName,
+    const std::set<NodeAndArea>& dstNodeAreas,
+    bool isV4,
+    NextHopGroup const& primaryNextHops,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) const {
+  std::unordered_set<std::string> primaryNeighbors;
+  for (auto const& nextHop : primaryNextHops) {
+    if (nextHop.neighborNodeName_ref().has_value()) {
+      primaryNeighbors.emplace(*nextHop.neighborNodeName_ref());
+    }
+  }
+
+  // distance of the closest destination in spfResult, if any is reachable
+  auto getDistance = [&dstNodeAreas](
+                         SpfResult const& spfResult,
+                         std::string const& area) -> std::optional<Metric> {
+    std::optional<Metric> distance;
+    for (auto const& [dstNode, dstArea] : dstNodeAreas) {
+      auto it = spfResult.find(dstNode);
+      if (dstArea == area and it != spfResult.end() and
+          (not distance or it->second.metric() < *distance)) {
+        distance = it->second.metric();
+      }
+    }
+    return distance;
+  };
+
+  std::unordered_set<thrift::NextHopThrift> nextHops;
+  Metric bestMetric = std::numeric_limits<Metric>::max();
+  for (auto const& [area, linkState] : areaLinkStates) {
+    auto const& mySpfResult = linkState.getSpfResult(myNodeName);
+    auto const myDistance = getDistance(mySpfResult, area);
+    // no alternates for unreachable or locally originated prefixes
+    if (not myDistance or *myDistance == 0) {
+      continue;
+    }
+
+    for (auto const& link : linkState.linksFromNode(myNodeName)) {
+      auto const neighbor = link->getOtherNodeName(myNodeName);
+      if (not link->isUp() or primaryNeighbors.count(neighbor)) {
+        continue;
+      }
+      auto const& neighborSpfResult = linkState.getSpfResult(neighbor);
+      auto const neighborDistance = getDistance(neighborSpfResult, area);
+      auto const backDistance = neighborSpfResult.find(myNodeName);
+      if (not neighborDistance or backDistance == neighborSpfResult.end()) {
+        continue;
+      }
+      // overloaded neighbor doesn't transit traffic, unless destination
+      if (*neighborDistance != 0 and linkState.isNodeOverloaded(neighbor)) {
+        continue;
+      }
+      // loop-free condition: Dist(N, D) < Dist(N, S) + Dist(S, D)
+      if (*neighborDistance >= backDistance->second.metric() + *myDistance) {
+        continue;
+      }
+
+      Metric const metric =
+          link->getMetricFromNode(myNodeName) + *neighborDistance;
+      if (metric > bestMetric) {
+        continue;
+      }
+      if (metric < bestMetric) {
+        bestMetric = metric;
+        nextHops.clear();
+      }
+      nextHops.emplace(createNextHop(
+          isV4 and not v4OverV6Nexthop_ ? link->getNhV4FromNode(myNodeName)
+                                        : link->getNhV6FromNode(myNodeName),
+          link->getIfaceFromNode(myNodeName),
+          metric,
+          std::nullopt /* mplsAction */,
+          link->getArea(),
+          neighbor));
+    }
+  }
+  return nextHops;
+}
+
 } // namespace openr
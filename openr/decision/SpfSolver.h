@@ -8,17 +8,26 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <string>
 #include <unordered_map>
 
+#include <folly/MapUtil.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/LabelMap.h>
 #include <openr/decision/LinkState.h>
 #include <openr/decision/PrefixState.h>
 #include <openr/decision/RibEntry.h>
 #include <openr/decision/RouteUpdate.h>
+#include <openr/decision/SrPolicy.h>
 
 namespace openr {
 
 using StaticMplsRoutes = std::unordered_map<int32_t, RibMplsEntry>;
+// dense in node segment and adjacency label ranges
+using MplsRoutes = LabelMap<int32_t, RibMplsEntry>;
 using StaticUnicastRoutes =
     std::unordered_map<folly::CIDRNetwork, RibUnicastEntry>;
 
@@ -54,20 +63,51 @@ struct BestRouteSelectionResult {
   }
 };
 
+using BestRoutesCache =
+    std::unordered_map<folly::CIDRNetwork, BestRouteSelectionResult>;
+
+/**
+ * Route computed for a prefix along with the inputs it was computed from.
+ * The route is reused as long as the prefix entries and the generations of
+ * all area link states are unchanged.
+ */
+struct MemoizedRoute {
+  // PrefixState replaces entries on change, compared by pointer
+  PrefixEntries prefixEntries;
+  std::optional<RibUnicastEntry> route;
+  std::optional<BestRouteSelectionResult> bestRouteSelection;
+};
+
+using RouteMemo = std::unordered_map<folly::CIDRNetwork, MemoizedRoute>;
+
 class DecisionRouteDb {
  public:
   std::unordered_map<folly::CIDRNetwork /* prefix */, RibUnicastEntry>
       unicastRoutes;
-  std::unordered_map<int32_t /* label */, RibMplsEntry> mplsRoutes;
+  MplsRoutes mplsRoutes;
 
   // calculate the delta between this and newDb. Note, this method is const;
   // We are not actually updating here. We may mutate the DecisionRouteUpdate in
   // some way before calling update with it
   DecisionRouteUpdate calculateUpdate(DecisionRouteDb&& newDb) const;
 
+  // add the delta between mplsRoutes and newMplsRoutes to delta, both are
+  // walked in label order
+  void calculateMplsUpdate(
+      MplsRoutes const& newMplsRoutes, DecisionRouteUpdate& delta) const;
+
   // update the state of this with the DecisionRouteUpdate passed
   void update(DecisionRouteUpdate const& update);
 
+  // compact snapshot of routes for warm start, next-hop groups shared by
+  // routes are stored once
+  thrift::DecisionRouteDbSnapshot toSnapshot() const;
+
+  // routes of snapshot, throws std::out_of_range if it refers to unknown
+  // next-hop groups
+  static DecisionRouteDb fromSnapshot(
+      thrift::DecisionRouteDbSnapshot const& snapshot);
+
   thrift::RouteDatabase
   toThrift() const {
     thrift::RouteDatabase tRouteDb;
@@ -109,9 +149,20 @@ class SpfSolver {
       bool enableAdjacencyLabels,
       bool enableBgpRouteProgramming = false,
       bool enableBestRouteSelection = false,
-      bool v4OverV6Nexthop = false);
+      bool v4OverV6Nexthop = false,
+      size_t routeBuildThreads = 1,
+      bool enableLfa = false,
+      bool enableUcmp = false,
+      std::vector<thrift::SrPolicyConfig> srPolicies = {});
   ~SpfSolver();
 
+  // Integer weights proportional to capacities, each at least 1 and summing
+  // up to at most maxTotal (all 1 if there are more capacities than that),
+  // reduced by their greatest common divisor
+  static std::vector<int32_t> normalizeUcmpWeights(
+      std::vector<double> const& capacities,
+      int32_t maxTotal = Constants::kUcmpMaxTotalWeight);
+
   //
   // util function to update IP/MPLS static route
   //
@@ -124,35 +175,132 @@ class SpfSolver {
       const std::vector<RibMplsEntry>& mplsRoutesToUpdate,
       const std::vector<int32_t>& mplsRoutesToDelete);
 
+  // Same as above, returning prefixes whose routes for myNodeName depend on
+  // the static MPLS routes of the changed labels, i.e. prefixes myNodeName
+  // advertises with one of them as prepend label. Only their memoized routes
+  // are dropped, instead of all of them
+  std::unordered_set<folly::CIDRNetwork> updateStaticMplsRoutes(
+      const std::vector<RibMplsEntry>& mplsRoutesToUpdate,
+      const std::vector<int32_t>& mplsRoutesToDelete,
+      const std::string& myNodeName,
+      PrefixState const& prefixState);
+
+  // static MPLS route of label, nullptr if none
+  RibMplsEntry const*
+  getStaticMplsRoute(int32_t label) const {
+    return folly::get_ptr(staticMplsRoutes_, label);
+  }
+
+  // Compute shortest paths from myNodeName in all areas, one task per area on
+  // the route build pool if any. Results are memoized in LinkState, so that
+  // route computation doesn't wait on areas one after another. With LFA
+  // enabled shortest paths from neighbors of myNodeName are computed as well
+  void computeSpfResults(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates);
+
   // Build route database using given prefix and link states for a given
   // router, myNodeName
   // Returns std::nullopt if myNodeName doesn't have any prefix database
+  // With routeBuildThreads > 1 per-prefix routes are computed in parallel, the
+  // result is identical to the sequential computation
   std::optional<DecisionRouteDb> buildRouteDb(
       const std::string& myNodeName,
       std::unordered_map<std::string, LinkState> const& areaLinkStates,
       PrefixState const& prefixState);
 
+  // Build MPLS routes for node segment labels, adjacency labels of
+  // myNodeName and static MPLS routes. This is the MPLS part of buildRouteDb
+  MplsRoutes buildMplsRoutes(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates);
+
+  // Node label MPLS routes for the labels of nodes, e.g. nodes whose shortest
+  // paths changed, and for the labels the last MPLS routes built for
+  // myNodeName routed towards them. Labels left without a route map to
+  // std::nullopt
+  std::unordered_map<int32_t, std::optional<RibMplsEntry>> buildNodeLabelRoutes(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates,
+      std::unordered_set<std::string> const& nodes);
+
   std::optional<RibUnicastEntry> createRouteForPrefixOrGetStaticRoute(
       const std::string& myNodeName,
       std::unordered_map<std::string, LinkState> const& areaLinkStates,
       PrefixState const& prefixState,
       folly::CIDRNetwork const& prefix);
 
-  std::unordered_map<folly::CIDRNetwork, BestRouteSelectionResult> const&
+  BestRoutesCache const&
   getBestRoutesCache() const {
     return bestRoutesCache_;
   }
 
+  // Update paths of the segment routing policies headed at myNodeName, see
+  // SrPolicySolver. Returns prefixes steered by policies whose path changed
+  std::unordered_set<folly::CIDRNetwork> updateSrPolicyPaths(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates);
+
+  // nullptr if no segment routing policy is configured
+  SrPolicySolver const*
+  getSrPolicySolver() const {
+    return srPolicySolver_.get();
+  }
+
+  bool
+  isLfaEnabled() const {
+    return enableLfa_;
+  }
+
  private:
   // no-copy
   SpfSolver(SpfSolver const&) = delete;
   SpfSolver& operator=(SpfSolver const&) = delete;
 
+  // best route selection of the prefix is recorded in bestRoutesCache.
+  // Reuses the route memoized in routeMemo_ if still valid, otherwise the
+  // route is computed and recorded in newRouteMemo
   std::optional<RibUnicastEntry> createRouteForPrefix(
       const std::string& myNodeName,
       std::unordered_map<std::string, LinkState> const& areaLinkStates,
       PrefixState const& prefixState,
-      folly::CIDRNetwork const& prefix);
+      folly::CIDRNetwork const& prefix,
+      BestRoutesCache& bestRoutesCache,
+      RouteMemo& newRouteMemo);
+
+  std::optional<RibUnicastEntry> computeRouteForPrefix(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates,
+      PrefixState const& prefixState,
+      folly::CIDRNetwork const& prefix,
+      BestRoutesCache& bestRoutesCache);
+
+  // clear routeMemo_ if it was filled for another node or any area link state
+  // changed generation since
+  void maybeInvalidateRouteMemo(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates);
+
+  // export size of routeMemo_, walks all entries so only done on full builds
+  void updateRouteMemoCounters() const;
+
+  // Compute routes of all prefixes in prefixState on routeBuildPool_ and add
+  // them to routeDb. Prefixes are split into one shard per thread, each shard
+  // fills its own best route cache and route memo which are merged in
+  // bestRoutesCache_ and routeMemo_
+  void createRoutesForPrefixesParallel(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates,
+      PrefixState const& prefixState,
+      DecisionRouteDb& routeDb);
+
+  // Compute first and second shortest paths towards all advertisers of
+  // KSP2_ED_ECMP prefixes, one batch per area on routeBuildPool_ if any.
+  // selectBestPathsKsp2 is then served from LinkState memoization
+  void computeKsp2Paths(
+      const std::string& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates,
+      PrefixState const& prefixState);
 
   static std::pair<openr::LinkStateMetric, std::unordered_set<std::string>>
   getMinCostNodes(
@@ -208,7 +356,8 @@ class SpfSolver {
 
   // helper to get min nexthop for a prefix, used in selectKsp2
   std::optional<int64_t> getMinNextHopThreshold(
-      BestRouteSelectionResult nodes, PrefixEntries const& prefixEntries);
+      BestRouteSelectionResult const& nodes,
+      PrefixEntries const& prefixEntries);
 
   // Helper to filter overloaded nodes for anycast addresses
   //
@@ -219,7 +368,7 @@ class SpfSolver {
       std::unordered_map<std::string, LinkState> const& areaLinkStates) const;
 
   // Give source node-name and dstNodeNames, this function returns the set of
-  // nexthops towards these set of dstNodeNames
+  // nexthops towards each of the closest dstNodeNames
   std::pair<
       openr::LinkStateMetric /* minimum metric to destination */,
       std::unordered_map<
@@ -229,27 +378,95 @@ class SpfSolver {
   getNextHopsWithMetric(
       const std::string& srcNodeName,
       const std::set<NodeAndArea>& dstNodeAreas,
-      bool perDestination,
       std::unordered_map<std::string, LinkState> const& areaLinkStates);
 
-  // This function converts best nexthop nodes to best nexthop adjacencies
-  // which can then be passed to FIB for programming. It considers and
-  // parallel link logic (tested by our UT)
-  // If swap label is provided then it will be used to associate SWAP or PHP
-  // mpls action
+  // This function converts best nexthop nodes per destination to best
+  // nexthop adjacencies, pushing the labels of destinations, which can then
+  // be passed to FIB for programming. It considers and parallel link logic
+  // (tested by our UT)
   std::unordered_set<thrift::NextHopThrift> getNextHopsThrift(
       const std::string& myNodeName,
       const std::set<NodeAndArea>& dstNodeAreas,
       bool isV4,
       bool v4OverV6Nexthop,
-      bool perDestination,
       const openr::LinkStateMetric minMetric,
       std::unordered_map<
           std::pair<std::string, std::string>,
           openr::LinkStateMetric> nextHopNodes,
-      std::optional<int32_t> swapLabel,
       std::unordered_map<std::string, LinkState> const& areaLinkStates,
-      PrefixEntries const& prefixEntries = {}) const;
+      PrefixEntries const& prefixEntries) const;
+
+  // links of myNodeName in an area along shortest paths, as bits over the
+  // next-hop index of the area
+  struct NextHopLinks {
+    std::shared_ptr<const LinkState::NextHopIndex> index;
+    LinkState::NextHopIndex::Bits bits;
+  };
+
+  // Links of myNodeName along shortest paths towards the closest of
+  // dstNodeAreas, per area of least metric. Next-hops of the destinations
+  // are united as bitsets, empty if none is reachable
+  std::pair<
+      openr::LinkStateMetric /* minimum metric to destination */,
+      std::unordered_map<std::string /* area */, NextHopLinks>>
+  getNextHopLinks(
+      const std::string& myNodeName,
+      const std::set<NodeAndArea>& dstNodeAreas,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates) const;
+
+  // Converts next-hop links to nexthops which can then be passed to FIB for
+  // programming. If swap label is provided then it will be used to associate
+  // SWAP or PHP mpls action
+  std::unordered_set<thrift::NextHopThrift> getNextHopsThrift(
+      const std::string& myNodeName,
+      const std::set<NodeAndArea>& dstNodeAreas,
+      bool isV4,
+      bool v4OverV6Nexthop,
+      const openr::LinkStateMetric minMetric,
+      std::unordered_map<std::string, NextHopLinks> const& nextHopLinks,
+      std::optional<int32_t> swapLabel) const;
+
+  // Loop-free alternate (RFC 5286) next-hops towards dstNodeAreas, via
+  // neighbors other than the primary next-hops whose shortest path to the
+  // destination doesn't go back through myNodeName. Only the alternates of
+  // lowest metric are returned, empty if there is none.
+  // next-hop onto the path of the segment routing policy steering prefix, if
+  // the policy leads to one of the best nodes and has a path
+  std::optional<thrift::NextHopThrift> getSrPolicyNextHop(
+      folly::CIDRNetwork const& prefix,
+      BestRouteSelectionResult const& bestRouteSelectionResult,
+      PrefixEntries const& prefixEntries) const;
+
+  std::unordered_set<thrift::NextHopThrift> getLfaNextHops(
+      const std::string& myNodeName,
+      const std::set<NodeAndArea>& dstNodeAreas,
+      bool isV4,
+      NextHopGroup const& primaryNextHops,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates) const;
+
+  // UCMP weighted copy of nextHops towards dstNodeAreas. Each next-hop gets
+  // the capacity of the shortest paths through its neighbor, split across
+  // parallel links by their weight, see LinkState::getUcmpCapacities().
+  // Left as ECMP (weight 0) if weights are all equal.
+  std::unordered_set<thrift::NextHopThrift> getUcmpNextHops(
+      const std::string& myNodeName,
+      const std::set<NodeAndArea>& dstNodeAreas,
+      std::unordered_set<thrift::NextHopThrift> const& nextHops,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates) const;
+
+  // Node label route for label, among the nodes advertising it in any area.
+  // The label of myNodeName is popped, else it is routed towards the first
+  // reachable node by name. Sets owner to that node
+  std::optional<RibMplsEntry> createNodeLabelRoute(
+      const std::string& myNodeName,
+      int32_t label,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates,
+      std::string& owner);
+
+  // store static MPLS routes to add or update, and erase those to delete
+  void applyStaticMplsRoutes(
+      const std::vector<RibMplsEntry>& mplsRoutesToUpdate,
+      const std::vector<int32_t>& mplsRoutesToDelete);
 
   // Collection to store static IP/MPLS routes
   StaticMplsRoutes staticMplsRoutes_;
@@ -258,8 +475,17 @@ class SpfSolver {
   // Cache of best route selection.
   // - Cleared when topology changes
   // - Updated for the prefix whenever a route is created for it
-  std::unordered_map<folly::CIDRNetwork, BestRouteSelectionResult>
-      bestRoutesCache_;
+  BestRoutesCache bestRoutesCache_;
+
+  // Memoized per prefix routes, see MemoizedRoute. Only valid for the node
+  // and link state generations below
+  RouteMemo routeMemo_;
+  std::string routeMemoNodeName_;
+  std::map<std::string /* area */, uint64_t> routeMemoGenerations_;
+
+  // node label -> node its route leads to, as of the last MPLS routes built
+  // for myNodeName_
+  std::unordered_map<int32_t, std::string> nodeLabelOwners_;
 
   const std::string myNodeName_;
 
@@ -279,5 +505,19 @@ class SpfSolver {
   // prefixes with v6 nexthops to Fib module for programming. Else it will just
   // use v4 over v4 nexthop.
   const bool v4OverV6Nexthop_{false};
+
+  // compute loop-free alternates of IP routes as backup next-hops
+  const bool enableLfa_{false};
+
+  // weight next-hops of IP routes by the capacity of paths through them
+  const bool enableUcmp_{false};
+
+  // paths of segment routing policies headed at myNodeName_, only created if
+  // any is configured
+  std::unique_ptr<SrPolicySolver> srPolicySolver_;
+
+  // pool for parallel route computation, only created for more than one
+  // route build thread
+  std::unique_ptr<folly::CPUThreadPoolExecutor> routeBuildPool_;
 };
 } // namespace openr
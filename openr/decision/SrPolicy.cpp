@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/decision/SrPolicy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <tuple>
+
+#include <fb303/ServiceData.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+#include <openr/common/MplsUtil.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+bool
+SrPolicyPath::operator==(SrPolicyPath const& other) const {
+  return area == other.area and metric == other.metric and
+      labels == other.labels and
+      std::equal(
+             links.begin(),
+             links.end(),
+             other.links.begin(),
+             other.links.end(),
+             [](auto const& a, auto const& b) { return *a == *b; });
+}
+
+SrPolicySolver::SrPolicySolver(std::vector<thrift::SrPolicyConfig> policies)
+    : policies_(std::move(policies)) {
+  std::sort(
+      policies_.begin(), policies_.end(), [](auto const& a, auto const& b) {
+        return *a.name_ref() < *b.name_ref();
+      });
+
+  // policies of same affinity constraints share the CSPF run of the first
+  std::map<std::tuple<int64_t, int64_t, int64_t>, size_t> constraints;
+  for (size_t i = 0; i < policies_.size(); ++i) {
+    auto const& policy = policies_[i];
+    if (auto group = policy.disjoint_group_ref()) {
+      disjointGroups_[*group].emplace_back(i);
+      sharedCspf_.emplace_back(std::nullopt);
+    } else {
+      auto key = std::make_tuple(
+          *policy.include_any_ref(),
+          *policy.include_all_ref(),
+          *policy.exclude_any_ref());
+      sharedCspf_.emplace_back(constraints.emplace(key, i).first->second);
+    }
+    for (auto const& prefix : *policy.prefixes_ref()) {
+      auto network = folly::IPAddress::createNetwork(prefix);
+      if (prefixToPolicy_.emplace(network, i).second) {
+        steeredPrefixes_.emplace_back(network);
+      }
+    }
+  }
+  paths_.resize(policies_.size());
+
+  fb303::fbData->addStatExportType("decision.sr_policy.build_ms", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "decision.sr_policy.path_changes", fb303::SUM);
+}
+
+thrift::SrPolicyConfig const*
+SrPolicySolver::getPolicyForPrefix(folly::CIDRNetwork const& prefix) const {
+  auto it = prefixToPolicy_.find(prefix);
+  return it != prefixToPolicy_.end() ? &policies_.at(it->second) : nullptr;
+}
+
+SrPolicyPath const*
+SrPolicySolver::getPath(std::string const& name) const {
+  auto it = std::lower_bound(
+      policies_.begin(),
+      policies_.end(),
+      name,
+      [](auto const& policy, auto const& key) {
+        return *policy.name_ref() < key;
+      });
+  if (it == policies_.end() or *it->name_ref() != name) {
+    return nullptr;
+  }
+  auto const& path = paths_.at(it - policies_.begin());
+  return path ? &path.value() : nullptr;
+}
+
+std::unordered_set<folly::CIDRNetwork>
+SrPolicySolver::updatePaths(
+    std::string const& myNodeName,
+    std::unordered_map<std::string, LinkState> const& areaLinkStates) {
+  std::map<std::string, uint64_t> generations;
+  std::map<std::string, LinkState const*> sortedAreas;
+  for (auto const& [area, linkState] : areaLinkStates) {
+    generations.emplace(area, linkState.getGeneration());
+    sortedAreas.emplace(area, &linkState);
+  }
+  if (myNodeName == headEnd_ and generations == generations_) {
+    return {};
+  }
+  if (myNodeName != headEnd_) {
+    // previous paths start elsewhere, nothing to keep
+    paths_.assign(policies_.size(), std::nullopt);
+  }
+  headEnd_ = myNodeName;
+  generations_ = std::move(generations);
+
+  const auto startTime = std::chrono::steady_clock::now();
+  std::vector<std::optional<SrPolicyPath>> paths(policies_.size());
+  std::map<std::pair<std::string, size_t>, CspfResult> sharedResults;
+  const LinkState::LinkSet noExcludedLinks;
+  for (size_t i = 0; i < policies_.size(); ++i) {
+    if (sharedCspf_[i].has_value()) {
+      paths[i] = computePath(
+          i,
+          myNodeName,
+          sortedAreas,
+          noExcludedLinks,
+          sharedResults);
+    }
+  }
+  // each policy of a disjoint group avoids the links of the ones before
+  for (auto const& [_, members] : disjointGroups_) {
+    LinkState::LinkSet excludedLinks;
+    for (auto const i : members) {
+      paths[i] = computePath(
+          i,
+          myNodeName,
+          sortedAreas,
+          excludedLinks,
+          sharedResults);
+      if (paths[i].has_value()) {
+        excludedLinks.insert(paths[i]->links.begin(), paths[i]->links.end());
+      }
+    }
+  }
+
+  std::vector<bool> changed(policies_.size(), false);
+  size_t numChanged = 0, numUp = 0;
+  for (size_t i = 0; i < policies_.size(); ++i) {
+    numUp += paths[i].has_value();
+    if (paths[i] == paths_[i]) {
+      continue;
+    }
+    changed[i] = true;
+    ++numChanged;
+    if (paths[i].has_value()) {
+      LOG(INFO) << "SR policy " << *policies_[i].name_ref() << " path in area "
+                << paths[i]->area << ", metric " << paths[i]->metric
+                << ", labels [" << folly::join(", ", paths[i]->labels) << "]";
+    } else {
+      LOG(WARNING) << "SR policy " << *policies_[i].name_ref()
+                   << " has no path satisfying its constraints";
+    }
+  }
+  paths_ = std::move(paths);
+
+  std::unordered_set<folly::CIDRNetwork> changedPrefixes;
+  for (auto const& [prefix, i] : prefixToPolicy_) {
+    if (changed[i]) {
+      changedPrefixes.emplace(prefix);
+    }
+  }
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  fb303::fbData->addStatValue(
+      "decision.sr_policy.build_ms", deltaTime.count(), fb303::AVG);
+  fb303::fbData->addStatValue(
+      "decision.sr_policy.path_changes", numChanged, fb303::SUM);
+  fb303::fbData->setCounter("decision.sr_policy.num_up", numUp);
+  fb303::fbData->setCounter(
+      "decision.sr_policy.num_down", policies_.size() - numUp);
+  return changedPrefixes;
+}
+
+std::optional<SrPolicyPath>
+SrPolicySolver::computePath(
+    size_t i,
+    std::string const& myNodeName,
+    std::map<std::string, LinkState const*> const& sortedAreas,
+    LinkState::LinkSet const& excludedLinks,
+    std::map<std::pair<std::string, size_t>, CspfResult>& sharedResults) {
+  auto const& policy = policies_.at(i);
+  auto const& dest = *policy.destination_ref();
+  if (dest == myNodeName) {
+    return std::nullopt;
+  }
+
+  // first area, by name, with a path satisfying the constraints
+  for (auto const& [area, linkState] : sortedAreas) {
+    if (not linkState->hasNode(myNodeName) or not linkState->hasNode(dest)) {
+      continue;
+    }
+    std::optional<SrPolicyPath> best;
+    if (auto const shared = sharedCspf_.at(i)) {
+      auto key = std::make_pair(area, *shared);
+      auto it = sharedResults.find(key);
+      if (it == sharedResults.end()) {
+        it = sharedResults
+                 .emplace(
+                     key,
+                     runCspf(*linkState, myNodeName, policy, excludedLinks))
+                 .first;
+      }
+      best = tracePath(it->second, myNodeName, policy);
+    } else {
+      best = tracePath(
+          runCspf(*linkState, myNodeName, policy, excludedLinks),
+          myNodeName,
+          policy);
+    }
+    if (not best.has_value()) {
+      continue;
+    }
+    best->area = area;
+
+    // keep the previous path unless the new one is strictly shorter
+    auto const& previous = paths_.at(i);
+    if (previous.has_value() and previous->area == area) {
+      auto links = previous->links;
+      auto metric = getPathMetric(
+          *linkState, myNodeName, links, policy, excludedLinks);
+      if (metric.has_value() and *metric <= best->metric) {
+        best->links = std::move(links);
+        best->metric = *metric;
+      }
+    }
+
+    auto labels = computeLabels(
+        *linkState, myNodeName, best->links, *policy.max_segments_ref());
+    if (not labels.has_value()) {
+      LOG(WARNING) << "SR policy " << *policy.name_ref()
+                   << " path can't be encoded in at most "
+                   << *policy.max_segments_ref() << " segment labels";
+      return std::nullopt;
+    }
+    best->labels = std::move(labels).value();
+    return best;
+  }
+  return std::nullopt;
+}
+
+bool
+SrPolicySolver::isLinkAllowed(
+    thrift::SrPolicyConfig const& policy,
+    std::shared_ptr<Link> const& link,
+    std::string const& fromNode,
+    LinkState::LinkSet const& excludedLinks) {
+  if (not link->isUp() or excludedLinks.count(link)) {
+    return false;
+  }
+  auto const adminGroups = link->getAdminGroupsFromNode(fromNode);
+  auto const includeAny = *policy.include_any_ref();
+  auto const includeAll = *policy.include_all_ref();
+  return (includeAny == 0 or (adminGroups & includeAny) != 0) and
+      (adminGroups & includeAll) == includeAll and
+      (adminGroups & *policy.exclude_any_ref()) == 0;
+}
+
+SrPolicySolver::CspfResult
+SrPolicySolver::runCspf(
+    LinkState const& linkState,
+    std::string const& src,
+    thrift::SrPolicyConfig const& policy,
+    LinkState::LinkSet const& excludedLinks) {
+  CspfResult result;
+  std::unordered_set<std::string> settled;
+  using QueueEntry = std::pair<LinkStateMetric, std::string>;
+  std::priority_queue<
+      QueueEntry,
+      std::vector<QueueEntry>,
+      std::greater<QueueEntry>>
+      queue;
+  result.emplace(
+      src, std::make_pair(LinkStateMetric{0}, std::shared_ptr<Link>()));
+  queue.emplace(0, src);
+  while (not queue.empty()) {
+    auto const [metric, node] = queue.top();
+    queue.pop();
+    if (not settled.insert(node).second) {
+      continue;
+    }
+    // overloaded nodes are destinations only
+    if (node != src and linkState.isNodeOverloaded(node)) {
+      continue;
+    }
+    for (auto const& link : linkState.linksFromNode(node)) {
+      if (not isLinkAllowed(policy, link, node, excludedLinks)) {
+        continue;
+      }
+      auto const& otherNode = link->getOtherNodeName(node);
+      if (settled.count(otherNode)) {
+        continue;
+      }
+      auto const otherMetric = metric + link->getMetricFromNode(node);
+      auto it = result.find(otherNode);
+      // ties are broken by link, keeping paths independent of visit order
+      if (it == result.end() or otherMetric < it->second.first or
+          (otherMetric == it->second.first and *link < *it->second.second)) {
+        result.insert_or_assign(otherNode, std::make_pair(otherMetric, link));
+        queue.emplace(otherMetric, otherNode);
+      }
+    }
+  }
+  return result;
+}
+
+std::optional<SrPolicyPath>
+SrPolicySolver::tracePath(
+    CspfResult const& result,
+    std::string const& src,
+    thrift::SrPolicyConfig const& policy) {
+  auto const& dest = *policy.destination_ref();
+  auto it = result.find(dest);
+  if (it == result.end()) {
+    return std::nullopt;
+  }
+  auto const maxMetric = policy.max_metric_ref();
+  if (maxMetric.has_value() and
+      it->second.first >
+          static_cast<LinkStateMetric>(std::max<int64_t>(*maxMetric, 0))) {
+    return std::nullopt;
+  }
+
+  SrPolicyPath path;
+  path.metric = it->second.first;
+  std::string node = dest;
+  while (node != src) {
+    auto const& link = result.at(node).second;
+    path.links.emplace_back(link);
+    node = link->getOtherNodeName(node);
+  }
+  std::reverse(path.links.begin(), path.links.end());
+  return path;
+}
+
+std::optional<LinkStateMetric>
+SrPolicySolver::getPathMetric(
+    LinkState const& linkState,
+    std::string const& src,
+    LinkState::Path& path,
+    thrift::SrPolicyConfig const& policy,
+    LinkState::LinkSet const& excludedLinks) {
+  LinkStateMetric metric = 0;
+  std::string node = src;
+  for (auto& link : path) {
+    if (node != src and linkState.isNodeOverloaded(node)) {
+      return std::nullopt;
+    }
+    // links of the path may have been replaced since, look them up by name
+    auto const& links = linkState.linksFromNode(node);
+    auto it = links.find(link);
+    if (it == links.end() or
+        not isLinkAllowed(policy, *it, node, excludedLinks)) {
+      return std::nullopt;
+    }
+    link = *it;
+    metric += link->getMetricFromNode(node);
+    node = link->getOtherNodeName(node);
+  }
+  auto const maxMetric = policy.max_metric_ref();
+  if (maxMetric.has_value() and
+      metric > static_cast<LinkStateMetric>(std::max<int64_t>(*maxMetric, 0))) {
+    return std::nullopt;
+  }
+  return metric;
+}
+
+std::optional<std::vector<int32_t>>
+SrPolicySolver::computeLabels(
+    LinkState const& linkState,
+    std::string const& src,
+    LinkState::Path const& path,
+    int32_t maxSegments) {
+  // packets are sent over the first link, labels steer them from its far end
+  std::vector<int32_t> labels;
+  std::string node = path.front()->getOtherNodeName(src);
+  size_t i = 1;
+  while (i < path.size()) {
+    // follow the path as far as it is the unique shortest path from node,
+    // which the node label of the last node reached encodes
+    auto const& spfResult = linkState.getSpfResult(node);
+    LinkStateMetric metric = 0;
+    std::string hop = node;
+    size_t j = i;
+    for (; j < path.size(); ++j) {
+      auto const& link = path[j];
+      metric += link->getMetricFromNode(hop);
+      auto const& nextHop = link->getOtherNodeName(hop);
+      auto it = spfResult.find(nextHop);
+      if (it == spfResult.end() or it->second.metric() != metric or
+          it->second.pathLinks().size() != 1 or
+          not(*it->second.pathLinks().front().link == *link)) {
+        break;
+      }
+      hop = nextHop;
+    }
+    if (j > i) {
+      auto const nodeLabel = linkState.getNodeLabel(hop);
+      if (isMplsLabelValid(nodeLabel)) {
+        labels.emplace_back(nodeLabel);
+        node = hop;
+        i = j;
+        continue;
+      }
+    }
+
+    // otherwise, the adjacency label of the next link of the path
+    auto const adjLabel = path[i]->getAdjLabelFromNode(node);
+    if (not isMplsLabelValid(adjLabel)) {
+      return std::nullopt;
+    }
+    labels.emplace_back(adjLabel);
+    node = path[i]->getOtherNodeName(node);
+    ++i;
+  }
+  if (labels.size() > static_cast<size_t>(std::max(maxSegments, 0))) {
+    return std::nullopt;
+  }
+  // bottom of the stack first
+  std::reverse(labels.begin(), labels.end());
+  return labels;
+}
+
+} // namespace openr
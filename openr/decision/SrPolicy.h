@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/IPAddress.h>
+
+#include <openr/decision/LinkState.h>
+#include <openr/if/gen-cpp2/OpenrConfig_types.h>
+
+namespace openr {
+
+/**
+ * Path of a segment routing policy, from the head-end to the destination of
+ * the policy
+ */
+struct SrPolicyPath {
+  std::string area;
+  LinkState::Path links;
+  LinkStateMetric metric{0};
+  // labels to push on packets sent over the first link of the path, bottom
+  // of the stack first as in thrift::MplsAction. Empty for a one hop path
+  std::vector<int32_t> labels;
+
+  bool operator==(SrPolicyPath const& other) const;
+};
+
+/**
+ * Constrained shortest path first (CSPF) computation of the segment routing
+ * policies headed at this node, see thrift::SrPolicyConfig.
+ *
+ * Paths are recomputed whenever the link state of an area changes. Policies
+ * with the same affinity constraints which are not part of a disjoint group
+ * share a single constrained SPF run, so cost grows with the number of
+ * distinct constraints rather than with the number of policies. A path which
+ * still satisfies its constraints is only replaced by a strictly shorter one,
+ * so that unrelated topology changes don't move traffic between equal cost
+ * paths.
+ */
+class SrPolicySolver {
+ public:
+  explicit SrPolicySolver(std::vector<thrift::SrPolicyConfig> policies);
+
+  // Recompute paths for head-end myNodeName if link state of any area changed
+  // since the last call. Returns prefixes steered by policies whose path
+  // changed
+  std::unordered_set<folly::CIDRNetwork> updatePaths(
+      std::string const& myNodeName,
+      std::unordered_map<std::string, LinkState> const& areaLinkStates);
+
+  // policy steering prefix, nullptr if none
+  thrift::SrPolicyConfig const* getPolicyForPrefix(
+      folly::CIDRNetwork const& prefix) const;
+
+  // current path of policy, nullptr if no path satisfies its constraints
+  SrPolicyPath const* getPath(std::string const& name) const;
+
+  std::vector<folly::CIDRNetwork> const&
+  getSteeredPrefixes() const {
+    return steeredPrefixes_;
+  }
+
+  size_t
+  getNumPolicies() const {
+    return policies_.size();
+  }
+
+ private:
+  // per node reached, metric and link it is reached over from the source
+  using CspfResult = std::unordered_map<
+      std::string,
+      std::pair<LinkStateMetric, std::shared_ptr<Link>>>;
+
+  // whether link, traversed from fromNode, may be on the path of policy
+  static bool isLinkAllowed(
+      thrift::SrPolicyConfig const& policy,
+      std::shared_ptr<Link> const& link,
+      std::string const& fromNode,
+      LinkState::LinkSet const& excludedLinks);
+
+  // shortest paths from src over the links allowed for policy. Transit
+  // through overloaded nodes is avoided
+  static CspfResult runCspf(
+      LinkState const& linkState,
+      std::string const& src,
+      thrift::SrPolicyConfig const& policy,
+      LinkState::LinkSet const& excludedLinks);
+
+  // path from src to dest in result, if dest was reached within the metric
+  // bound of policy
+  static std::optional<SrPolicyPath> tracePath(
+      CspfResult const& result,
+      std::string const& src,
+      thrift::SrPolicyConfig const& policy);
+
+  // current metric of path, if all its links are still up and allowed
+  static std::optional<LinkStateMetric> getPathMetric(
+      LinkState const& linkState,
+      std::string const& src,
+      LinkState::Path& path,
+      thrift::SrPolicyConfig const& policy,
+      LinkState::LinkSet const& excludedLinks);
+
+  // label stack steering packets sent over the first link of path along it,
+  // std::nullopt if it can't be encoded in max_segments labels
+  static std::optional<std::vector<int32_t>> computeLabels(
+      LinkState const& linkState,
+      std::string const& src,
+      LinkState::Path const& path,
+      int32_t maxSegments);
+
+  // compute path of policy with index i, reusing the previous path if it is
+  // not worse than the best one
+  std::optional<SrPolicyPath> computePath(
+      size_t i,
+      std::string const& myNodeName,
+      std::map<std::string, LinkState const*> const& sortedAreas,
+      LinkState::LinkSet const& excludedLinks,
+      std::map<std::pair<std::string, size_t>, CspfResult>& sharedResults);
+
+  // sorted by name
+  std::vector<thrift::SrPolicyConfig> policies_;
+
+  // index into policies_ of the policy sharing its CSPF run with policy i,
+  // std::nullopt for policies of a disjoint group
+  std::vector<std::optional<size_t>> sharedCspf_;
+
+  // disjoint group -> indices into policies_, in order of policy name
+  std::map<std::string, std::vector<size_t>> disjointGroups_;
+
+  std::unordered_map<folly::CIDRNetwork, size_t> prefixToPolicy_;
+  std::vector<folly::CIDRNetwork> steeredPrefixes_;
+
+  // current paths, by index into policies_
+  std::vector<std::optional<SrPolicyPath>> paths_;
+
+  // head-end and area generations the paths were computed for
+  std::string headEnd_;
+  std::map<std::string, uint64_t> generations_;
+};
+
+} // namespace openr
@@ -5,10 +5,137 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <fmt/format.h>
+
+#include <openr/common/Util.h>
+#include <openr/decision/LinkState.h>
 #include <openr/decision/tests/RoutingBenchmarkUtils.h>
 
+namespace {
+// count of heap allocations made by this process. Replacing the global
+// allocation functions here (and not in openrlib) keeps the instrumentation
+// local to the benchmark binary
+std::atomic<uint64_t> allocationCount{0};
+} // namespace
+
+void*
+operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
 namespace openr {
 
+/*
+ * BM_LinkStateGridSpf:
+ * measures the SPF core alone. A full SPF is run from a few nodes of a grid
+ * topology on a fresh copy of the LinkState, so no memoized results are used.
+ * Reports the average time and heap allocation count per SPF run.
+ */
+void
+BM_LinkStateGridSpf(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+  auto suspender = folly::BenchmarkSuspender();
+  int n = std::sqrt(numOfSws);
+  auto adjDbs = createGrid(n, 0, SP_ECMP).first;
+  LinkState linkState(kTestingAreaName);
+  std::vector<std::string> nodeNames;
+  for (auto const& [_, adjDb] : adjDbs) {
+    linkState.updateAdjacencyDatabase(adjDb);
+    if (nodeNames.size() < 16) {
+      nodeNames.emplace_back(*adjDb.thisNodeName_ref());
+    }
+  }
+
+  uint64_t spfRuns{0};
+  uint64_t allocations{0};
+  std::chrono::nanoseconds spfTime{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    auto freshLinkState = linkState;
+    suspender.dismiss(); // Start measuring benchmark time
+    auto const startAllocations = allocationCount.load();
+    auto const startTime = std::chrono::steady_clock::now();
+    for (auto const& nodeName : nodeNames) {
+      freshLinkState.getSpfResult(nodeName);
+    }
+    spfTime += std::chrono::steady_clock::now() - startTime;
+    allocations += allocationCount.load() - startAllocations;
+    spfRuns += nodeNames.size();
+    suspender.rehire(); // Stop measuring time again
+  }
+
+  spfRuns = spfRuns == 0 ? 1 : spfRuns;
+  counters["spf_us"] =
+      std::chrono::duration_cast<std::chrono::microseconds>(spfTime).count() /
+      spfRuns;
+  counters["allocations_per_spf"] = allocations / spfRuns;
+}
+
+BENCHMARK_COUNTERS_PARAM(BM_LinkStateGridSpf, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_LinkStateGridSpf, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_LinkStateGridSpf, counters, 10000);
+
+/*
+ * BM_SelectBestPrefixMetrics:
+ * measures best route selection over the prefix entries of a single prefix.
+ * Entries come in rising preference for every tenth, so the best set is
+ * replaced repeatedly before the winners are known. Reports the average time
+ * and heap allocation count per selection.
+ */
+void
+BM_SelectBestPrefixMetrics(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numEntries) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto const prefix = toIpPrefix("fc00::/64");
+  PrefixEntries prefixEntries;
+  for (uint32_t i = 0; i < numEntries; ++i) {
+    prefixEntries.emplace(
+        NodeAndArea{fmt::format("node-{}", i), kTestingAreaName},
+        std::make_shared<thrift::PrefixEntry>(createPrefixEntryWithMetrics(
+            prefix,
+            thrift::PrefixType::DEFAULT,
+            createMetrics(i / 10, 0, 0))));
+  }
+
+  uint64_t allocations{0};
+  std::chrono::nanoseconds selectionTime{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss(); // Start measuring benchmark time
+    auto const startAllocations = allocationCount.load();
+    auto const startTime = std::chrono::steady_clock::now();
+    auto bestNodeAreas = selectBestPrefixMetrics(prefixEntries);
+    folly::doNotOptimizeAway(bestNodeAreas);
+    selectionTime += std::chrono::steady_clock::now() - startTime;
+    allocations += allocationCount.load() - startAllocations;
+    suspender.rehire(); // Stop measuring time again
+  }
+
+  iters = iters == 0 ? 1 : iters;
+  counters["selection_ns"] = selectionTime.count() / iters;
+  counters["allocations_per_selection"] = allocations / iters;
+}
+
+BENCHMARK_COUNTERS_PARAM(BM_SelectBestPrefixMetrics, counters, 10);
+BENCHMARK_COUNTERS_PARAM(BM_SelectBestPrefixMetrics, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_SelectBestPrefixMetrics, counters, 1000);
+
 /*
  * BM_DecisionGridInitialUpdate:
  * measures preformance of initial KvStore publication for a grid topology.
@@ -74,6 +201,21 @@ BENCHMARK_COUNTERS_PARAM(
 BENCHMARK_COUNTERS_PARAM(
     BM_DecisionGridPrefixUpdates, counters, 100, KSP2_ED_ECMP, 1000);
 
+/*
+ * BM_DecisionGridPrefixChurn:
+ * measures performance of route updates under steady-state prefix churn for
+ * a grid topology, i.e. Poisson advertisements, withdrawals, tag and metric
+ * changes, and mass withdrawals of all prefixes of a node.
+ * The last parameter is the number of churned prefixes
+ */
+
+BENCHMARK_COUNTERS_PARAM(
+    BM_DecisionGridPrefixChurn, counters, 100, SP_ECMP, 1000);
+BENCHMARK_COUNTERS_PARAM(
+    BM_DecisionGridPrefixChurn, counters, 100, SP_ECMP, 10000);
+BENCHMARK_COUNTERS_PARAM(
+    BM_DecisionGridPrefixChurn, counters, 1000, SP_ECMP, 10000);
+
 // The integer parameter is numOfGivenNodes in topology,
 // which >= numOfActualNodesInTopo.
 // numOfPods = (numOfGivenNodes - numOfSsws) / numOfFswsAndRswsPerPod
@@ -83,6 +225,47 @@ BENCHMARK_COUNTERS_PARAM(
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 344, SP_ECMP, 1);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 1000, SP_ECMP, 1);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 5000, SP_ECMP, 1);
+
+/*
+ * BM_RoutingClosPhases:
+ * times the phases of route computation on a multi-plane Clos topology: SPF,
+ * best route selection, route build, RIB policy, and rebuild plus diff after a
+ * single link or node failure.
+ *
+ * @first integer: number of pods
+ * @second integer: number of planes, i.e. ECMP width between pods
+ * @third integer: number of prefixes per rsw
+ * @fourth bool: whether every plane is an area of its own
+ */
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingClosPhases, counters, 8_4_1, 8, 4, 1, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingClosPhases, counters, 8_4_100, 8, 4, 100, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingClosPhases, counters, 32_4_1, 32, 4, 1, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingClosPhases, counters, 8_8_1, 8, 8, 1, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingClosPhases, counters, 8_4_1_areas, 8, 4, 1, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingClosPhases, counters, 8_4_100_areas, 8, 4, 100, true);
+
+/*
+ * BM_RoutingWanPhases:
+ * same phases on a WAN-like random geometric topology
+ *
+ * @first integer: number of nodes
+ * @second integer: average node degree
+ * @third integer: number of prefixes per node
+ */
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingWanPhases, counters, 100_4_1, 100, 4, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingWanPhases, counters, 100_4_100, 100, 4, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingWanPhases, counters, 1000_4_1, 1000, 4, 1);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_RoutingWanPhases, counters, 1000_8_1, 1000, 8, 1);
 } // namespace openr
 
 int
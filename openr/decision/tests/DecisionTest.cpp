@@ -6,6 +6,7 @@
  */
 
 #include <memory>
+#include <numeric>
 #include "openr/if/gen-cpp2/OpenrConfig_types.h"
 
 #include <fb303/ServiceData.h>
@@ -24,6 +25,7 @@
 
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
 #include <openr/config/tests/Utils.h>
 #include <openr/decision/Decision.h>
@@ -483,6 +485,148 @@ TEST(ShortestPathTest, UnreachableNodes) {
   }
 }
 
+//
+// Square R1-R2-R4-R3-R1 with R3-R4 at metric 15. R1 reaches R4 via R2, R3 is
+// a loop-free alternate as its shortest path to R4 doesn't go through R1. It
+// isn't for R2, reached via R1 by R3 at equal cost.
+//
+TEST(ShortestPathTest, LoopFreeAlternates) {
+  auto adj34Lfa = adj34;
+  adj34Lfa.metric_ref() = 15;
+  auto adj43Lfa = adj43;
+  adj43Lfa.metric_ref() = 15;
+
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName,
+      false /* disable v4 */,
+      true /* enable segment label */,
+      true /* enable adj labels */,
+      false /* disable bgp route programming */,
+      false /* disable best route selection */,
+      false /* disable v4 over v6 nexthop */,
+      1 /* route build threads */,
+      true /* enable LFA */);
+
+  std::unordered_map<std::string, LinkState> areaLinkStates;
+  areaLinkStates.emplace(kTestingAreaName, LinkState(kTestingAreaName));
+  auto& linkState = areaLinkStates.at(kTestingAreaName);
+  PrefixState prefixState;
+
+  linkState.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  linkState.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24}, 2));
+  linkState.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj34Lfa}, 3));
+  linkState.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43Lfa}, 4));
+  updatePrefixDatabase(prefixState, prefixDb2);
+  updatePrefixDatabase(prefixState, prefixDb4);
+
+  auto routeDb = spfSolver.buildRouteDb(nodeName, areaLinkStates, prefixState);
+  ASSERT_TRUE(routeDb.has_value());
+
+  auto const& route4 = routeDb->unicastRoutes.at(toIPNetwork(addr4));
+  EXPECT_THAT(
+      route4.nexthops,
+      testing::UnorderedElementsAre(createNextHopFromAdj(adj12, false, 20)));
+  EXPECT_THAT(
+      route4.backupNexthops,
+      testing::UnorderedElementsAre(createNextHopFromAdj(adj13, false, 25)));
+  EXPECT_EQ(1, route4.toThrift().backupNextHops_ref()->size());
+
+  auto const& route2 = routeDb->unicastRoutes.at(toIPNetwork(addr2));
+  EXPECT_THAT(
+      route2.nexthops,
+      testing::UnorderedElementsAre(createNextHopFromAdj(adj12, false, 10)));
+  EXPECT_TRUE(route2.backupNexthops.empty());
+  EXPECT_FALSE(route2.toThrift().backupNextHops_ref().has_value());
+}
+
+TEST(ShortestPathTest, NormalizeUcmpWeights) {
+  // proportional, reduced by gcd
+  EXPECT_THAT(
+      SpfSolver::normalizeUcmpWeights({100, 100}, 128),
+      testing::ElementsAre(1, 1));
+  EXPECT_THAT(
+      SpfSolver::normalizeUcmpWeights({40, 10}, 12),
+      testing::ElementsAre(4, 1));
+
+  // bounded total, each weight is at least 1
+  auto weights = SpfSolver::normalizeUcmpWeights({1000, 1, 0}, 16);
+  EXPECT_THAT(weights, testing::ElementsAre(14, 1, 1));
+  EXPECT_LE(std::accumulate(weights.begin(), weights.end(), 0), 16);
+
+  // more next-hops than the total
+  EXPECT_THAT(
+      SpfSolver::normalizeUcmpWeights({3, 2, 1}, 2),
+      testing::ElementsAre(1, 1, 1));
+}
+
+//
+// Square R1-R2-R4-R3-R1, all at metric 10. R1-R2 has weight 3 but R2-R4 only
+// 2, R1-R3 and R3-R4 have weight 1. With UCMP, R1 sends twice as much to R4
+// via R2 as via R3, capped by the capacity downstream of R2.
+//
+TEST(ShortestPathTest, UcmpWeights) {
+  auto adj12Ucmp = adj12;
+  adj12Ucmp.weight_ref() = 3;
+  auto adj24Ucmp = adj24;
+  adj24Ucmp.weight_ref() = 2;
+
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName,
+      false /* disable v4 */,
+      true /* enable segment label */,
+      true /* enable adj labels */,
+      false /* disable bgp route programming */,
+      false /* disable best route selection */,
+      false /* disable v4 over v6 nexthop */,
+      1 /* route build threads */,
+      false /* disable LFA */,
+      true /* enable UCMP */);
+
+  std::unordered_map<std::string, LinkState> areaLinkStates;
+  areaLinkStates.emplace(kTestingAreaName, LinkState(kTestingAreaName));
+  auto& linkState = areaLinkStates.at(kTestingAreaName);
+  PrefixState prefixState;
+
+  linkState.updateAdjacencyDatabase(createAdjDb("1", {adj12Ucmp, adj13}, 1));
+  linkState.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24Ucmp}, 2));
+  linkState.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj34}, 3));
+  linkState.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43}, 4));
+  updatePrefixDatabase(prefixState, prefixDb2);
+  updatePrefixDatabase(prefixState, prefixDb4);
+
+  auto routeDb = spfSolver.buildRouteDb(nodeName, areaLinkStates, prefixState);
+  ASSERT_TRUE(routeDb.has_value());
+
+  auto nh12 = createNextHopFromAdj(adj12Ucmp, false, 20);
+  nh12.weight_ref() = 2;
+  auto nh13 = createNextHopFromAdj(adj13, false, 20);
+  nh13.weight_ref() = 1;
+  EXPECT_THAT(
+      routeDb->unicastRoutes.at(toIPNetwork(addr4)).nexthops,
+      testing::UnorderedElementsAre(nh12, nh13));
+
+  // single next-hop stays unweighted
+  EXPECT_THAT(
+      routeDb->unicastRoutes.at(toIPNetwork(addr2)).nexthops,
+      testing::UnorderedElementsAre(
+          createNextHopFromAdj(adj12Ucmp, false, 10)));
+
+  // equal capacities once R2-R4 is down to weight 1, back to ECMP
+  adj24Ucmp.weight_ref() = 1;
+  EXPECT_TRUE(
+      linkState.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj24Ucmp}, 2))
+          .linkAttributesChanged);
+  routeDb = spfSolver.buildRouteDb(nodeName, areaLinkStates, prefixState);
+  ASSERT_TRUE(routeDb.has_value());
+  EXPECT_THAT(
+      routeDb->unicastRoutes.at(toIPNetwork(addr4)).nexthops,
+      testing::UnorderedElementsAre(
+          createNextHopFromAdj(adj12Ucmp, false, 20),
+          createNextHopFromAdj(adj13, false, 20)));
+}
+
 //
 // R1 and R2 are adjacent, and R1 has this declared in its
 // adjacency database. However, R1 is missing the AdjDb from
@@ -726,6 +870,136 @@ TEST(SpfSolver, AdjacencyUpdate) {
   }
 }
 
+//
+// Routes with same next-hops share one next-hop group, which is released
+// with its last route, and route updates are calculated on group IDs
+//
+TEST(RibEntry, SharedNextHopGroups) {
+  const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1");
+  const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2");
+  const auto numGroups = NextHopGroup::getNumGroups();
+  {
+    DecisionRouteDb routeDb;
+    routeDb.addUnicastRoute(
+        RibUnicastEntry(toIPNetwork(addr1), NextHops{nh1, nh2}));
+    routeDb.addUnicastRoute(
+        RibUnicastEntry(toIPNetwork(addr2), NextHops{nh2, nh1}));
+    routeDb.addMplsRoute(RibMplsEntry(1, NextHops{nh1, nh2}));
+
+    const auto& entry1 = routeDb.unicastRoutes.at(toIPNetwork(addr1));
+    const auto& entry2 = routeDb.unicastRoutes.at(toIPNetwork(addr2));
+    EXPECT_NE(0, entry1.nexthops.getId());
+    EXPECT_EQ(entry1.nexthops.getId(), entry2.nexthops.getId());
+    EXPECT_EQ(
+        entry1.nexthops.getId(), routeDb.mplsRoutes.at(1).nexthops.getId());
+    EXPECT_EQ(numGroups + 1, NextHopGroup::getNumGroups());
+    EXPECT_THAT(entry2.nexthops, testing::UnorderedElementsAre(nh1, nh2));
+
+    // same next-hops, no update
+    DecisionRouteDb newDb;
+    newDb.addUnicastRoute(
+        RibUnicastEntry(toIPNetwork(addr1), NextHops{nh1, nh2}));
+    newDb.addUnicastRoute(RibUnicastEntry(toIPNetwork(addr2), NextHops{nh1}));
+    auto update = routeDb.calculateUpdate(std::move(newDb));
+    EXPECT_EQ(numGroups + 2, NextHopGroup::getNumGroups());
+    ASSERT_EQ(1, update.unicastRoutesToUpdate.size());
+    EXPECT_THAT(
+        update.unicastRoutesToUpdate.at(toIPNetwork(addr2)).nexthops,
+        testing::UnorderedElementsAre(nh1));
+
+    // modifying next-hops swaps group of modified route only
+    auto entry = entry1;
+    entry.nexthops.erase(nh2);
+    EXPECT_EQ(
+        update.unicastRoutesToUpdate.at(toIPNetwork(addr2)).nexthops,
+        entry.nexthops);
+    EXPECT_NE(entry1.nexthops, entry.nexthops);
+    EXPECT_EQ(2, entry1.nexthops.size());
+  }
+  EXPECT_EQ(numGroups, NextHopGroup::getNumGroups());
+}
+
+//
+// Entries carrying fingerprints compare best prefix entries by them, others
+// deep compare best prefix entries
+//
+TEST(RibEntry, Fingerprint) {
+  const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1");
+  auto prefixEntry = createPrefixEntry(addr1);
+  RibUnicastEntry entry1(
+      toIPNetwork(addr1), NextHops{nh1}, prefixEntry, kTestingAreaName);
+  RibUnicastEntry entry2(entry1);
+  EXPECT_EQ(0, entry1.fingerprint);
+  EXPECT_EQ(entry1, entry2);
+
+  entry1.updateFingerprint();
+  entry2.updateFingerprint();
+  EXPECT_NE(0, entry1.fingerprint);
+  EXPECT_EQ(entry1.fingerprint, entry2.fingerprint);
+  EXPECT_EQ(entry1, entry2);
+
+  // best prefix entry changed
+  prefixEntry.tags_ref()->insert("tag1");
+  RibUnicastEntry entry3(
+      toIPNetwork(addr1), NextHops{nh1}, prefixEntry, kTestingAreaName);
+  EXPECT_NE(entry1, entry3);
+  entry3.updateFingerprint();
+  EXPECT_NE(entry1.fingerprint, entry3.fingerprint);
+  EXPECT_NE(entry1, entry3);
+
+  // next-hops are compared regardless of fingerprints
+  entry2.nexthops.erase(nh1);
+  EXPECT_NE(entry1, entry2);
+
+  DecisionRouteDb routeDb;
+  routeDb.addUnicastRoute(RibUnicastEntry(entry1));
+  DecisionRouteDb newDb;
+  newDb.addUnicastRoute(RibUnicastEntry(entry3));
+  auto update = routeDb.calculateUpdate(std::move(newDb));
+  ASSERT_EQ(1, update.unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      prefixEntry,
+      update.unicastRoutesToUpdate.at(toIPNetwork(addr1)).bestPrefixEntry);
+}
+
+//
+// Routes survive a snapshot round trip, next-hop groups shared by routes are
+// stored once
+//
+TEST(DecisionRouteDb, Snapshot) {
+  const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1");
+  const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2");
+  DecisionRouteDb routeDb;
+  RibUnicastEntry entry1(
+      toIPNetwork(addr1),
+      NextHops{nh1, nh2},
+      createPrefixEntry(addr1),
+      kTestingAreaName);
+  entry1.backupNexthops.insert(nh2);
+  routeDb.addUnicastRoute(std::move(entry1));
+  routeDb.addUnicastRoute(RibUnicastEntry(
+      toIPNetwork(addr2),
+      NextHops{nh1},
+      createPrefixEntry(addr2),
+      kTestingAreaName,
+      true /* doNotInstall */));
+  routeDb.addMplsRoute(RibMplsEntry(1, NextHops{nh2, nh1}));
+
+  auto snapshot = routeDb.toSnapshot();
+  EXPECT_EQ(2, snapshot.nextHopGroups_ref()->size());
+
+  snapshot = CompactSerializer::deserialize<thrift::DecisionRouteDbSnapshot>(
+      CompactSerializer::serialize<std::string>(snapshot));
+  auto loadedDb = DecisionRouteDb::fromSnapshot(snapshot);
+  EXPECT_EQ(routeDb.unicastRoutes, loadedDb.unicastRoutes);
+  EXPECT_EQ(routeDb.mplsRoutes, loadedDb.mplsRoutes);
+  EXPECT_TRUE(routeDb.calculateUpdate(std::move(loadedDb)).empty());
+
+  // unknown next-hop group
+  snapshot.mplsRoutes_ref()->front().nextHopGroup_ref() = 2;
+  EXPECT_THROW(DecisionRouteDb::fromSnapshot(snapshot), std::out_of_range);
+}
+
 //
 // Node-1 connects to 2 but 2 doesn't report bi-directionality
 // Node-2 and Node-3 are bi-directionally connected
@@ -1916,6 +2190,7 @@ TEST_P(SimpleRingTopologyFixture, ShortestPathTest) {
       false /* useKsp2Ed */,
       true /* use node segment label */,
       true /* use adj labels */);
+  StatCounter::flushAll();
   fb303::fbData->resetAllData();
   auto routeMap = getRouteMap(
       *spfSolver, {"1", "2", "3", "4"}, areaLinkStates, prefixState);
@@ -1926,6 +2201,7 @@ TEST_P(SimpleRingTopologyFixture, ShortestPathTest) {
   EXPECT_EQ(36, routeMap.size());
 
   // validate router 1
+  StatCounter::flushAll();
   const auto counters = fb303::fbData->getCounters();
   EXPECT_EQ(counters.at("decision.spf_runs.count"), 4);
   EXPECT_EQ(
@@ -2060,6 +2336,7 @@ TEST_P(SimpleRingTopologyFixture, DuplicateMplsRoutes) {
       false /* useKsp2Ed */,
       true /* use node segment label */,
       true /* use adj labels */);
+  StatCounter::flushAll();
   fb303::fbData->resetAllData();
   // make node1's mpls label same as node2.
   adjacencyDb1.nodeLabel_ref() = 2;
@@ -2075,6 +2352,7 @@ TEST_P(SimpleRingTopologyFixture, DuplicateMplsRoutes) {
 
   verifyRouteInUpdateNoDelete("3", 2, emptyRouteDb);
 
+  StatCounter::flushAll();
   auto counters = fb303::fbData->getCounters();
   // verify the counters to be 3 because each node will noticed a duplicate
   // for mpls label 1.
@@ -2087,6 +2365,7 @@ TEST_P(SimpleRingTopologyFixture, DuplicateMplsRoutes) {
   auto compDb3 =
       spfSolver->buildRouteDb("3", areaLinkStates, prefixState).value();
 
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   // now the counter should be 6, becasue we called buildRouteDb 3 times.
   EXPECT_EQ(counters.at("decision.duplicate_node_label.count.60"), 6);
@@ -2104,10 +2383,41 @@ TEST_P(SimpleRingTopologyFixture, DuplicateMplsRoutes) {
   verifyRouteInUpdateNoDelete("3", 2, compDb3);
 
   // because there is no duplicate anymore, so that counter should keep as 6.
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(counters.at("decision.duplicate_node_label.count.60"), 6);
 }
 
+//
+// Node label routes recomputed for a subset of nodes match a full build, and
+// cover the labels routed towards nodes which went away
+//
+TEST_P(SimpleRingTopologyFixture, NodeLabelRoutesForNodes) {
+  CustomSetUp(
+      false /* disable LFA */,
+      false /* useKsp2Ed */,
+      true /* use node segment label */,
+      true /* use adj labels */);
+  const auto routeDb =
+      spfSolver->buildRouteDb("1", areaLinkStates, prefixState).value();
+  EXPECT_EQ(1, routeDb.mplsRoutes.count(4));
+
+  auto routes = spfSolver->buildNodeLabelRoutes("1", areaLinkStates, {"2"});
+  ASSERT_EQ(1, routes.size());
+  ASSERT_TRUE(routes.at(2).has_value());
+  EXPECT_EQ(routeDb.mplsRoutes.at(2), *routes.at(2));
+
+  // node 4 goes away along with its label
+  areaLinkStates.at(kTestingAreaName).deleteAdjacencyDatabase("4");
+  routes = spfSolver->buildNodeLabelRoutes("1", areaLinkStates, {"4"});
+  ASSERT_EQ(1, routes.size());
+  EXPECT_FALSE(routes.at(4).has_value());
+
+  const auto newRouteDb =
+      spfSolver->buildRouteDb("1", areaLinkStates, prefixState).value();
+  EXPECT_EQ(0, newRouteDb.mplsRoutes.count(4));
+}
+
 //
 // Use the same topology, but test multi-path routing
 //
@@ -2416,6 +2726,27 @@ TEST_P(SimpleRingTopologyFixture, IpToMplsLabelPrepend) {
            createNextHopFromAdj(adj43, v4Enabled, 20, push1Prepend),
            createNextHop(nh1Addr, std::nullopt, 0, std::nullopt),
            createNextHop(nh2Addr, std::nullopt, 0, std::nullopt)}));
+
+  // Routes of prefixes advertised with the prepend label by the node depend
+  // on its static MPLS route, routes of other nodes don't
+  const auto prefix1 = toIPNetwork(v4Enabled ? addr1V4 : addr1);
+  auto deleteStaticMplsRoute = [&](int32_t label, std::string const& node) {
+    return spfSolver->updateStaticMplsRoutes({}, {label}, node, prefixState);
+  };
+  EXPECT_EQ(
+      std::unordered_set<folly::CIDRNetwork>{prefix1},
+      deleteStaticMplsRoute(prependLabel, "4"));
+  EXPECT_EQ(nullptr, spfSolver->getStaticMplsRoute(prependLabel));
+  EXPECT_TRUE(deleteStaticMplsRoute(prependLabel, "2").empty());
+  EXPECT_TRUE(deleteStaticMplsRoute(prependLabel + 1, "4").empty());
+
+  // Memoized route of node4 is dropped, static next-hops are gone
+  routeMap = getRouteMap(*spfSolver, {"4"}, areaLinkStates, prefixState);
+  EXPECT_EQ(
+      routeMap[make_pair("4", toString(v4Enabled ? addr1V4 : addr1))],
+      NextHops(
+          {createNextHopFromAdj(adj42, v4Enabled, 20, push1Prepend),
+           createNextHopFromAdj(adj43, v4Enabled, 20, push1Prepend)}));
 }
 
 //
@@ -2428,6 +2759,7 @@ TEST_P(SimpleRingTopologyFixture, Ksp2EdEcmp) {
       true /* enable node segment label */,
       true /* enable adj labels */,
       std::get<1>(GetParam()));
+  StatCounter::flushAll();
   fb303::fbData->resetAllData();
   auto routeMap = getRouteMap(
       *spfSolver, {"1", "2", "3", "4"}, areaLinkStates, prefixState);
@@ -2439,6 +2771,7 @@ TEST_P(SimpleRingTopologyFixture, Ksp2EdEcmp) {
       (std::get<1>(GetParam()) == thrift::PrefixType::BGP ? 48 : 36),
       routeMap.size());
 
+  StatCounter::flushAll();
   const auto counters = fb303::fbData->getCounters();
   // 4 + 4 * 3 peer per node (clean runs are memoized, 2nd runs  with linksTo
   // ignore are not so we redo for each neighbor)
@@ -4585,6 +4918,173 @@ TEST_P(GridTopologyFixture, ShortestPathTest) {
   EXPECT_EQ(gridDistance(src, dst, n), *nextHops.begin()->metric_ref());
 }
 
+// parallel route computation must yield exactly the sequential result
+TEST_P(GridTopologyFixture, ParallelRouteBuild) {
+  SpfSolver parallelSpfSolver(
+      nodeName,
+      false,
+      true /* enable node segment label */,
+      true /* enable adj segment labels */,
+      false,
+      false,
+      false,
+      4 /* route build threads */);
+
+  for (auto const& node : {std::string("0"), folly::sformat("{}", n * n - 1)}) {
+    auto routeDb = spfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+    auto parallelRouteDb =
+        parallelSpfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+    ASSERT_TRUE(routeDb.has_value());
+    ASSERT_TRUE(parallelRouteDb.has_value());
+    EXPECT_EQ(n * n - 1, parallelRouteDb->unicastRoutes.size());
+    EXPECT_EQ(routeDb->unicastRoutes, parallelRouteDb->unicastRoutes);
+    EXPECT_EQ(routeDb->mplsRoutes, parallelRouteDb->mplsRoutes);
+
+    auto const& bestRoutes = spfSolver.getBestRoutesCache();
+    auto const& parallelBestRoutes = parallelSpfSolver.getBestRoutesCache();
+    EXPECT_EQ(bestRoutes.size(), parallelBestRoutes.size());
+    for (auto const& [prefix, bestRoute] : bestRoutes) {
+      ASSERT_EQ(1, parallelBestRoutes.count(prefix));
+      auto const& parallelBestRoute = parallelBestRoutes.at(prefix);
+      EXPECT_EQ(bestRoute.allNodeAreas, parallelBestRoute.allNodeAreas);
+      EXPECT_EQ(bestRoute.bestNodeArea, parallelBestRoute.bestNodeArea);
+    }
+  }
+}
+
+// shortest paths of all areas are computed upfront, in parallel
+TEST_P(GridTopologyFixture, ParallelSpfAcrossAreas) {
+  // second area of the same topology
+  std::string const area2{"area2"};
+  LinkState linkState2(area2);
+  for (auto const& [_, adjDb] :
+       areaLinkStates.at(kTestingAreaName).getAdjacencyDatabases()) {
+    auto adjDb2 = adjDb;
+    adjDb2.area_ref() = area2;
+    linkState2.updateAdjacencyDatabase(adjDb2);
+  }
+  areaLinkStates.emplace(area2, std::move(linkState2));
+
+  SpfSolver parallelSpfSolver(
+      nodeName,
+      false,
+      true /* enable node segment label */,
+      true /* enable adj segment labels */,
+      false,
+      false,
+      false,
+      4 /* route build threads */);
+  std::string const node{"0"};
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+  parallelSpfSolver.computeSpfResults(node, areaLinkStates);
+  StatCounter::flushAll();
+  EXPECT_EQ(2, fb303::fbData->getCounters()["decision.spf_runs.count"]);
+  for (auto const& [_, linkState] : areaLinkStates) {
+    EXPECT_EQ(n * n, linkState.getSpfResult(node).size());
+  }
+
+  // route build is served from the memoized shortest paths
+  auto routeDb =
+      parallelSpfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  ASSERT_TRUE(routeDb.has_value());
+  StatCounter::flushAll();
+  EXPECT_EQ(2, fb303::fbData->getCounters()["decision.spf_runs.count"]);
+}
+
+TEST_P(GridTopologyFixture, ParallelKsp2RouteBuild) {
+  // switch all prefixes to KSP2_ED_ECMP
+  for (int node = 0; node < n * n; ++node) {
+    updatePrefixDatabase(
+        prefixState,
+        createPrefixDb(
+            folly::sformat("{}", node),
+            {createPrefixEntry(
+                toIpPrefix(nodeToPrefixV6(node)),
+                thrift::PrefixType::LOOPBACK,
+                "",
+                thrift::PrefixForwardingType::SR_MPLS,
+                thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP)}));
+  }
+  ASSERT_EQ(n * n, prefixState.ksp2Prefixes().size());
+
+  SpfSolver parallelSpfSolver(
+      nodeName,
+      false,
+      true /* enable node segment label */,
+      true /* enable adj segment labels */,
+      false,
+      false,
+      false,
+      4 /* route build threads */);
+  // copied before any path is computed, both solvers compute KSP2 paths
+  auto parallelAreaLinkStates = areaLinkStates;
+
+  std::string const node{"0"};
+  auto routeDb = spfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  auto parallelRouteDb =
+      parallelSpfSolver.buildRouteDb(node, parallelAreaLinkStates, prefixState);
+  ASSERT_TRUE(routeDb.has_value());
+  ASSERT_TRUE(parallelRouteDb.has_value());
+  EXPECT_EQ(n * n - 1, parallelRouteDb->unicastRoutes.size());
+  EXPECT_EQ(routeDb->unicastRoutes, parallelRouteDb->unicastRoutes);
+}
+
+TEST_P(GridTopologyFixture, RouteMemoization) {
+  std::string const node{"0"};
+  int64_t const numPrefixes = prefixState.prefixes().size();
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  auto routeDb = spfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  ASSERT_TRUE(routeDb.has_value());
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(0, counters["decision.route_memo.hits.count"]);
+  EXPECT_EQ(numPrefixes, counters["decision.route_memo.misses.count"]);
+  EXPECT_EQ(numPrefixes, counters["decision.route_memo.entries"]);
+
+  // unchanged inputs, all routes are reused
+  auto memoRouteDb = spfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  ASSERT_TRUE(memoRouteDb.has_value());
+  EXPECT_EQ(routeDb->unicastRoutes, memoRouteDb->unicastRoutes);
+  StatCounter::flushAll();
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(numPrefixes, counters["decision.route_memo.hits.count"]);
+  EXPECT_EQ(numPrefixes, counters["decision.route_memo.misses.count"]);
+
+  // new prefix, only its route is computed
+  auto const lastNode = folly::sformat("{}", n * n - 1);
+  updatePrefixDatabase(
+      prefixState,
+      createPrefixDb(lastNode, {createPrefixEntry(toIpPrefix("fd00::1/128"))}));
+  memoRouteDb = spfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  ASSERT_TRUE(memoRouteDb.has_value());
+  EXPECT_EQ(n * n, memoRouteDb->unicastRoutes.size());
+  StatCounter::flushAll();
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(2 * numPrefixes, counters["decision.route_memo.hits.count"]);
+  EXPECT_EQ(numPrefixes + 1, counters["decision.route_memo.misses.count"]);
+
+  // topology change invalidates all memoized routes
+  auto& linkState = areaLinkStates.at(kTestingAreaName);
+  auto adjDb = linkState.getAdjacencyDatabases().at(lastNode);
+  adjDb.nodeLabel_ref() = *adjDb.nodeLabel_ref() + 10000;
+  EXPECT_TRUE(linkState.updateAdjacencyDatabase(adjDb).nodeLabelChanged);
+  memoRouteDb = spfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  ASSERT_TRUE(memoRouteDb.has_value());
+  StatCounter::flushAll();
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(2 * numPrefixes, counters["decision.route_memo.hits.count"]);
+  EXPECT_EQ(2 * numPrefixes + 2, counters["decision.route_memo.misses.count"]);
+
+  SpfSolver freshSpfSolver(node, false, true, true, false);
+  auto freshRouteDb =
+      freshSpfSolver.buildRouteDb(node, areaLinkStates, prefixState);
+  ASSERT_TRUE(freshRouteDb.has_value());
+  EXPECT_EQ(freshRouteDb->unicastRoutes, memoRouteDb->unicastRoutes);
+}
+
 // measure SPF execution time for large networks
 TEST(GridTopology, StressTest) {
   if (!FLAGS_stress_test) {
@@ -4992,6 +5492,57 @@ TEST_F(DecisionTestFixture, PrefixKeyBackwardCompatibility) {
   }
 }
 
+/*
+ * Prefix shard keys carry several prefixes of a node. Every update replaces
+ * the set of prefixes of the shard, and expiry withdraws all of them.
+ *
+ * Topology:
+ *
+ * 1 ---- 2 (advertising prefixes in shard 0)
+ */
+TEST_F(DecisionTestFixture, PrefixShardKey) {
+  const auto shardKey =
+      PrefixShardKey("2", kTestingAreaName, 0).getPrefixShardKey();
+
+  // Step1: shard with addr1 + addr2
+  {
+    auto publication = createThriftPublication(
+        {{"adj:1", createAdjValue("1", 1, {adj12}, false, 1)},
+         {"adj:2", createAdjValue("2", 1, {adj21}, false, 2)},
+         {shardKey, createPrefixValue("2", 1, {addr1, addr2})}},
+        /* expired-keys */
+        {});
+    sendKvPublication(publication);
+
+    verifyReceivedRoutes(toIPNetwork(addr1), false);
+    verifyReceivedRoutes(toIPNetwork(addr2), false);
+  }
+
+  // Step2: addr1 removed from the shard
+  {
+    auto publication = createThriftPublication(
+        {{shardKey, createPrefixValue("2", 2, {addr2})}},
+        /* expired-keys */
+        {});
+    sendKvPublication(publication);
+
+    verifyReceivedRoutes(toIPNetwork(addr1), true);
+    verifyReceivedRoutes(toIPNetwork(addr2), false);
+  }
+
+  // Step3: shard expired
+  {
+    auto publication = createThriftPublication(
+        /* no prefix key update */
+        {},
+        /* expired-keys */
+        {shardKey});
+    sendKvPublication(publication);
+
+    verifyReceivedRoutes(toIPNetwork(addr2), true);
+  }
+}
+
 // The following topology is used:
 //
 // 1---2---3
@@ -6119,6 +6670,68 @@ TEST(Decision, RibPolicyFeatureKnob) {
   routeUpdatesQueue.close();
 }
 
+/**
+ * Verifies that Decision publishes routes of the persisted snapshot right
+ * away on warm start, and ignores snapshots of other nodes.
+ */
+TEST(Decision, WarmStart) {
+  auto tConfig = getBasicOpenrConfig("1");
+  tConfig.eor_time_s_ref() = 1;
+  tConfig.decision_config_ref()->enable_warm_start_ref() = true;
+  auto config = std::make_shared<Config>(tConfig);
+
+  auto configStore = std::make_unique<PersistentStore>(config, true);
+  std::thread configStoreThread([&]() { configStore->run(); });
+  configStore->waitUntilRunning();
+
+  const auto nh = createNextHop(toBinaryAddress("fe80::2"), "iface");
+  DecisionRouteDb routeDb;
+  routeDb.addUnicastRoute(RibUnicastEntry(
+      toIPNetwork(addr1), NextHops{nh}, createPrefixEntry(addr1), "area"));
+  routeDb.addMplsRoute(RibMplsEntry(1, NextHops{nh}));
+  auto snapshot = routeDb.toSnapshot();
+  snapshot.thisNodeName_ref() = "1";
+  snapshot.timestampMs_ref() = getUnixTimeStampMs();
+
+  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<DecisionRouteUpdate> staticRouteUpdatesQueue;
+  messaging::ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue;
+  auto routeUpdatesReader = routeUpdatesQueue.getReader();
+  auto createDecision = [&]() {
+    return std::make_unique<Decision>(
+        config,
+        true, /* enableBgpRouteProgramming */
+        kvStoreUpdatesQueue.getReader(),
+        staticRouteUpdatesQueue.getReader(),
+        routeUpdatesQueue,
+        configStore.get());
+  };
+
+  // routes of snapshot are published
+  configStore->storeThriftObj("decision-route-db-snapshot", snapshot).get();
+  auto decision = createDecision();
+  ASSERT_EQ(1, routeUpdatesReader.size());
+  auto update = routeUpdatesReader.get().value();
+  ASSERT_EQ(1, update.unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      routeDb.unicastRoutes.at(toIPNetwork(addr1)),
+      update.unicastRoutesToUpdate.at(toIPNetwork(addr1)));
+  ASSERT_EQ(1, update.mplsRoutesToUpdate.size());
+  EXPECT_EQ(routeDb.mplsRoutes.at(1), update.mplsRoutesToUpdate.front());
+
+  // snapshot of another node
+  snapshot.thisNodeName_ref() = "2";
+  configStore->storeThriftObj("decision-route-db-snapshot", snapshot).get();
+  decision = createDecision();
+  EXPECT_EQ(0, routeUpdatesReader.size());
+
+  kvStoreUpdatesQueue.close();
+  staticRouteUpdatesQueue.close();
+  routeUpdatesQueue.close();
+  configStore->stop();
+  configStoreThread.join();
+}
+
 // The following topology is used:
 //
 //         100
@@ -6232,6 +6845,79 @@ TEST_F(DecisionTestFixture, ParallelLinks) {
       NextHops({createNextHopFromAdj(adj12_2, false, 800)}));
 }
 
+// The following topology is used:
+//
+// 2---1---3
+//
+// Node 1 drains and undrains its link towards 2. Only the route towards 2 is
+// rebuilt, the delta matches the one of a full rebuild.
+//
+TEST_F(DecisionTestFixture, LocalLinkDrain) {
+  auto adj12 =
+      createAdjacency("2", "1/2", "2/1", "fe80::2", "192.168.0.2", 10, 0);
+  auto adj13 =
+      createAdjacency("3", "1/3", "3/1", "fe80::3", "192.168.0.3", 10, 0);
+  auto adj21 =
+      createAdjacency("1", "2/1", "1/2", "fe80::1", "192.168.0.1", 10, 0);
+  auto adj31 =
+      createAdjacency("1", "3/1", "1/3", "fe80::1", "192.168.0.1", 10, 0);
+
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12, adj13})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"adj:3", createAdjValue("3", 1, {adj31})},
+       createPrefixKeyValue("2", 1, addr2),
+       createPrefixKeyValue("3", 1, addr3)},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  auto routeDbDelta = recvRouteUpdates();
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToUpdate.size());
+
+  // drain link towards 2, its route is withdrawn
+  auto adj12Drained = adj12;
+  adj12Drained.isOverloaded_ref() = true;
+  publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 2, {adj12Drained, adj13})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  auto routeDbBefore = dumpRouteDb({"1"})["1"];
+  sendKvPublication(publication);
+  routeDbDelta = recvRouteUpdates();
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_THAT(
+      routeDbDelta.unicastRoutesToDelete,
+      testing::UnorderedElementsAre(addr2Cidr));
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  auto routeDelta = findDeltaRoutes(routeDb, routeDbBefore);
+  EXPECT_TRUE(checkEqualRoutesDelta(routeDbDelta, routeDelta));
+
+  // undrain, route is restored
+  publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 3, {adj12, adj13})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  routeDbBefore = dumpRouteDb({"1"})["1"];
+  sendKvPublication(publication);
+  routeDbDelta = recvRouteUpdates();
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.count(addr2Cidr));
+  routeDb = dumpRouteDb({"1"})["1"];
+  routeDelta = findDeltaRoutes(routeDb, routeDbBefore);
+  EXPECT_TRUE(checkEqualRoutesDelta(routeDbDelta, routeDelta));
+  RouteMap routeMap;
+  fillRouteMap("1", routeMap, routeDb);
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr2))],
+      NextHops({createNextHopFromAdj(adj12, false, 10)}));
+}
+
 // The following topology is used:
 //
 // 1---2---3---4
@@ -6254,6 +6940,7 @@ TEST_F(DecisionTestFixture, PubDebouncing) {
       {},
       std::string(""));
 
+  StatCounter::flushAll();
   auto counters = fb303::fbData->getCounters();
   EXPECT_EQ(0, counters["decision.spf_runs.count"]);
   EXPECT_EQ(0, counters["decision.route_build_runs.count"]);
@@ -6262,6 +6949,7 @@ TEST_F(DecisionTestFixture, PubDebouncing) {
   recvRouteUpdates();
 
   // validate SPF after initial sync, no rebouncing here
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(1, counters["decision.spf_runs.count"]);
   EXPECT_EQ(1, counters["decision.route_build_runs.count"]);
@@ -6298,6 +6986,7 @@ TEST_F(DecisionTestFixture, PubDebouncing) {
   sendKvPublication(publication);
   recvRouteUpdates();
 
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(2, counters["decision.spf_runs.count"]);
   EXPECT_EQ(2, counters["decision.route_build_runs.count"]);
@@ -6312,6 +7001,7 @@ TEST_F(DecisionTestFixture, PubDebouncing) {
   sendKvPublication(publication);
   recvRouteUpdates();
 
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(2, counters["decision.spf_runs.count"]);
   // only prefix changed no full rebuild needed
@@ -6345,6 +7035,7 @@ TEST_F(DecisionTestFixture, PubDebouncing) {
   sendKvPublication(publication);
   recvRouteUpdates();
 
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(3, counters["decision.spf_runs.count"]);
   EXPECT_EQ(3, counters["decision.route_build_runs.count"]);
@@ -6381,6 +7072,7 @@ TEST_F(DecisionTestFixture, PubDebouncing) {
   sendKvPublication(publication);
   recvRouteUpdates();
 
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   // only prefix has changed so spf_runs is unchanged
   EXPECT_EQ(3, counters["decision.spf_runs.count"]);
@@ -6409,6 +7101,7 @@ TEST_F(DecisionTestFixture, NoSpfOnIrrelevantPublication) {
       {},
       std::string(""));
 
+  StatCounter::flushAll();
   auto counters = fb303::fbData->getCounters();
   EXPECT_EQ(0, counters["decision.spf_runs.count"]);
 
@@ -6419,6 +7112,7 @@ TEST_F(DecisionTestFixture, NoSpfOnIrrelevantPublication) {
   std::this_thread::sleep_for(3 * debounceTimeoutMax);
 
   // make sure the counter did not increment
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(0, counters["decision.spf_runs.count"]);
 }
@@ -6442,6 +7136,7 @@ TEST_F(DecisionTestFixture, NoSpfOnDuplicatePublication) {
       {},
       std::string(""));
 
+  StatCounter::flushAll();
   auto counters = fb303::fbData->getCounters();
   EXPECT_EQ(0, counters["decision.spf_runs.count"]);
 
@@ -6452,6 +7147,7 @@ TEST_F(DecisionTestFixture, NoSpfOnDuplicatePublication) {
   std::this_thread::sleep_for(3 * debounceTimeoutMax);
 
   // make sure counter is incremented
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(1, counters["decision.spf_runs.count"]);
 
@@ -6463,10 +7159,58 @@ TEST_F(DecisionTestFixture, NoSpfOnDuplicatePublication) {
   std::this_thread::sleep_for(3 * debounceTimeoutMax);
 
   // make sure counter is not incremented
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(1, counters["decision.spf_runs.count"]);
 }
 
+//
+// Republished adjacency dbs differing only in timestamps or perf events are
+// skipped, without LinkState update.
+//
+TEST_F(DecisionTestFixture, SkipUnchangedAdjacencyDatabase) {
+  sendKvPublication(createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       createPrefixKeyValue("1", 1, addr1),
+       createPrefixKeyValue("2", 1, addr2)},
+      {},
+      {},
+      {},
+      std::string("")));
+  recvRouteUpdates();
+
+  // same content, new version, timestamp and perf events
+  auto adj21Refreshed = adj21;
+  adj21Refreshed.timestamp_ref() = *adj21.timestamp_ref() + 1000;
+  auto adjDb = createAdjDb("2", {adj21Refreshed}, 0);
+  adjDb.perfEvents_ref() = thrift::PerfEvents();
+  addPerfEvent(*adjDb.perfEvents_ref(), "2", "ADJ_DB_UPDATED");
+  auto value = createAdjValue("2", 2, {adj21});
+  value.value_ref() = writeThriftObjStr(adjDb, serializer);
+  sendKvPublication(createThriftPublication(
+      {{"adj:2", value}}, {}, {}, {}, std::string("")));
+  // identical raw value, skipped before deserialization
+  sendKvPublication(createThriftPublication(
+      {{"adj:2", value}}, {}, {}, {}, std::string("")));
+
+  // changed content is applied
+  auto adj21Changed = adj21;
+  adj21Changed.isOverloaded_ref() = true;
+  sendKvPublication(createThriftPublication(
+      {{"adj:2", createAdjValue("2", 3, {adj21Changed})}},
+      {},
+      {},
+      {},
+      std::string("")));
+  recvRouteUpdates();
+
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(2, counters["decision.adj_db_update_skipped.count"]);
+  EXPECT_EQ(3, counters["decision.adj_db_update.count"]);
+}
+
 /**
  * Test to verify route calculation when a prefix is advertised from more than
  * one node.
@@ -6776,6 +7520,7 @@ TEST_F(DecisionTestFixture, DecisionSubReliability) {
 
   const int64_t adjUpdateCnt = 1000 /* initial */;
   const int64_t prefixUpdateCnt = totalSent + 1000 /* initial */ + 1 /* end */;
+  StatCounter::flushAll();
   auto counters = fb303::fbData->getCounters();
   EXPECT_EQ(1, counters["decision.spf_runs.count"]);
   EXPECT_EQ(adjUpdateCnt, counters["decision.adj_db_update.count"]);
@@ -6789,6 +7534,7 @@ TEST_F(DecisionTestFixture, Counters) {
   // Verifiy some initial/default counters
   {
     decision->updateGlobalCounters();
+    StatCounter::flushAll();
     const auto counters = fb303::fbData->getCounters();
     EXPECT_EQ(counters.at("decision.num_nodes"), 1);
     EXPECT_EQ(counters.at("decision.num_conflicting_prefixes"), 0);
@@ -6859,6 +7605,7 @@ TEST_F(DecisionTestFixture, Counters) {
 
   // Verify counters
   decision->updateGlobalCounters();
+  StatCounter::flushAll();
   const auto counters = fb303::fbData->getCounters();
   EXPECT_EQ(counters.at("decision.num_conflicting_prefixes"), 1);
   EXPECT_EQ(counters.at("decision.num_partial_adjacencies"), 1);
@@ -6883,6 +7630,7 @@ TEST_F(DecisionTestFixture, Counters) {
   recvRouteUpdates();
 
   decision->updateGlobalCounters();
+  StatCounter::flushAll();
   EXPECT_EQ(
       fb303::fbData->getCounters().at("decision.num_partial_adjacencies"), 0);
 }
@@ -6912,6 +7660,44 @@ TEST_F(DecisionTestFixture, ExceedMaxBackoff) {
   sendKvPublication(publication);
 }
 
+class DecisionParallelDecodeFixture : public DecisionTestFixture {
+ protected:
+  openr::thrift::OpenrConfig
+  createConfig() override {
+    auto tConfig = DecisionTestFixture::createConfig();
+    tConfig.decision_config_ref()->publication_decode_threads_ref() = 4;
+    return tConfig;
+  }
+};
+
+/*
+ * Publication large enough to be deserialized on worker threads yields the
+ * same routes, and a malformed value only fails its own key.
+ */
+TEST_F(DecisionParallelDecodeFixture, LargePublication) {
+  const size_t numPrefixes = Constants::kDecisionParallelDecodeMinValues * 4;
+  std::unordered_map<std::string, thrift::Value> keyVals{
+      {"adj:1", createAdjValue("1", 1, {adj12}, false, 1)},
+      {"adj:2", createAdjValue("2", 1, {adj21}, false, 2)}};
+  for (size_t i = 0; i < numPrefixes; ++i) {
+    keyVals.emplace(createPrefixKeyValue(
+        "2", 1, toIpPrefix(folly::sformat("fc00:{:x}::/64", i + 1))));
+  }
+  auto malformed = createPrefixKeyValue("2", 1, toIpPrefix("fc01::/64"));
+  malformed.second.value_ref() = "malformed";
+  keyVals.emplace(std::move(malformed));
+
+  sendKvPublication(
+      createThriftPublication(keyVals, {}, {}, {}, std::string("")));
+  auto routeDbDelta = recvRouteUpdates();
+  EXPECT_EQ(numPrefixes, routeDbDelta.unicastRoutesToUpdate.size());
+  for (auto const& [prefix, route] : routeDbDelta.unicastRoutesToUpdate) {
+    EXPECT_EQ(
+        NextHops({createNextHopFromAdj(adj12, false, 10)}),
+        route.nexthops.get());
+  }
+}
+
 // DecisionTestFixture with different enableBestRouteSelection_ input
 class EnableBestRouteSelectionFixture
     : public DecisionTestFixture,
@@ -6938,6 +7724,7 @@ TEST_P(EnableBestRouteSelectionFixture, PrefixWithMixedTypeRoutes) {
   // Verifiy some initial/default counters
   {
     decision->updateGlobalCounters();
+    StatCounter::flushAll();
     const auto counters = fb303::fbData->getCounters();
     EXPECT_EQ(counters.at("decision.num_nodes"), 1);
   }
@@ -6998,6 +7785,7 @@ TEST_P(EnableBestRouteSelectionFixture, PrefixWithMixedTypeRoutes) {
   }
   // Verify counters
   decision->updateGlobalCounters();
+  StatCounter::flushAll();
   const auto counters = fb303::fbData->getCounters();
   int skippedUnicastRouteCnt = GetParam() ? 0 : 1;
   EXPECT_EQ(
@@ -7278,11 +8066,34 @@ TEST(DecisionPendingUpdates, needsFullRebuild) {
   EXPECT_FALSE(updates.needsFullRebuild());
   linkStateChange.linkAttributesChanged = false;
   linkStateChange.topologyChanged = true;
+  // topology change of remote node is scoped to affected routes
   updates.applyLinkStateChange("node2", linkStateChange, kEmptyPerfEventRef);
   EXPECT_TRUE(updates.needsRouteUpdate());
+  EXPECT_FALSE(updates.needsFullRebuild());
+  EXPECT_THAT(
+      updates.topologyChangedNodes(), testing::UnorderedElementsAre("node2"));
+  updates.applyLinkStateChange("node1", linkStateChange, kEmptyPerfEventRef);
+  EXPECT_TRUE(updates.needsRouteUpdate());
   EXPECT_TRUE(updates.needsFullRebuild());
 
   updates.reset();
+  EXPECT_TRUE(updates.topologyChangedNodes().empty());
+  // local drain is scoped as well, unless link attributes changed along
+  linkStateChange.onlyDrainChanged = true;
+  updates.applyLinkStateChange("node1", linkStateChange, kEmptyPerfEventRef);
+  EXPECT_TRUE(updates.needsRouteUpdate());
+  EXPECT_FALSE(updates.needsFullRebuild());
+  EXPECT_TRUE(updates.localDrainChanged());
+  EXPECT_THAT(
+      updates.topologyChangedNodes(), testing::UnorderedElementsAre("node1"));
+  linkStateChange.linkAttributesChanged = true;
+  updates.applyLinkStateChange("node1", linkStateChange, kEmptyPerfEventRef);
+  EXPECT_TRUE(updates.needsFullRebuild());
+
+  updates.reset();
+  EXPECT_FALSE(updates.localDrainChanged());
+  linkStateChange.onlyDrainChanged = false;
+  linkStateChange.linkAttributesChanged = false;
   linkStateChange.topologyChanged = false;
   linkStateChange.nodeLabelChanged = true;
   updates.applyLinkStateChange("node2", linkStateChange, kEmptyPerfEventRef);
@@ -5,6 +5,12 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <map>
+#include <random>
+#include <set>
+
+#include <folly/Format.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -80,6 +86,42 @@ TEST(HoldableValueTest, BasicOperation) {
   EXPECT_EQ(5, hvLsm.value());
 }
 
+TEST(DijkstraQTest, OrderAndDecreaseKey) {
+  auto& interner = openr::StringInterner::nodeNames();
+  std::vector<openr::LinkStateNodeId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.emplace_back(interner.intern(folly::sformat("dijkstra-q-{:03d}", i)));
+  }
+  openr::DijkstraQ q(interner.size());
+  EXPECT_TRUE(q.empty());
+
+  // insert in reverse, with every block of 4 nodes sharing a metric
+  for (int i = 99; i >= 0; --i) {
+    q.insertNode(ids.at(i), 1000 + i / 4);
+  }
+  EXPECT_TRUE(q.contains(ids.at(42)));
+
+  // lower a few metrics, including ties which must be broken by name
+  q.decreaseKey(ids.at(99), 1);
+  q.decreaseKey(ids.at(50), 1);
+  q.decreaseKey(ids.at(70), 0);
+  q.decreaseKey(ids.at(3), 1000);
+
+  std::vector<openr::LinkStateNodeId> expected{
+      ids.at(70), ids.at(50), ids.at(99)};
+  for (int i = 0; i < 100; ++i) {
+    if (i != 99 && i != 50 && i != 70) {
+      expected.push_back(ids.at(i));
+    }
+  }
+  for (auto const nodeId : expected) {
+    ASSERT_FALSE(q.empty());
+    EXPECT_EQ(nodeId, q.extractMin());
+    EXPECT_FALSE(q.contains(nodeId));
+  }
+  EXPECT_TRUE(q.empty());
+}
+
 TEST(LinkTest, BasicOperation) {
   std::string n1 = "node1";
   auto adj1 =
@@ -177,15 +219,31 @@ TEST(LinkStateTest, BasicOperation) {
 
   EXPECT_FALSE(state.isNodeOverloaded(n1));
   adjDb1.isOverloaded_ref() = true;
-  EXPECT_TRUE(state.updateAdjacencyDatabase(adjDb1, 0, 0).topologyChanged);
+  auto change = state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_TRUE(change.topologyChanged);
+  EXPECT_TRUE(change.onlyDrainChanged);
   EXPECT_TRUE(state.isNodeOverloaded(n1));
   EXPECT_FALSE(state.updateAdjacencyDatabase(adjDb1, 0, 0).topologyChanged);
   adjDb1.isOverloaded_ref() = false;
   EXPECT_TRUE(state.updateAdjacencyDatabase(adjDb1, 0, 0).topologyChanged);
   EXPECT_FALSE(state.isNodeOverloaded(n1));
 
+  // link drain
+  adjDb1.adjacencies_ref()->at(0).isOverloaded_ref() = true;
+  change = state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_TRUE(change.topologyChanged);
+  EXPECT_TRUE(change.onlyDrainChanged);
+  // drain along with a metric change
+  adjDb1.adjacencies_ref()->at(0).isOverloaded_ref() = false;
+  adjDb1.adjacencies_ref()->at(1).metric_ref() = 2;
+  change = state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_TRUE(change.topologyChanged);
+  EXPECT_FALSE(change.onlyDrainChanged);
+
   adjDb1 = openr::createAdjDb(n1, {adj13}, 1);
-  EXPECT_TRUE(state.updateAdjacencyDatabase(adjDb1, 0, 0).topologyChanged);
+  change = state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_TRUE(change.topologyChanged);
+  EXPECT_FALSE(change.onlyDrainChanged);
   EXPECT_THAT(state.linksFromNode(n1), UnorderedElementsAre(Pointee(l3)));
   EXPECT_THAT(state.linksFromNode(n2), UnorderedElementsAre(Pointee(l2)));
   EXPECT_THAT(
@@ -197,6 +255,240 @@ TEST(LinkStateTest, BasicOperation) {
   EXPECT_THAT(state.linksFromNode(n3), UnorderedElementsAre(Pointee(l2)));
 }
 
+TEST(LinkStateTest, Generation) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  auto adjDb1 = openr::createAdjDb(n1, {adj12}, 1);
+  auto adjDb2 = openr::createAdjDb(n2, {adj21}, 2);
+
+  openr::LinkState state{kTestingAreaName};
+  openr::LinkState otherState{kTestingAreaName};
+  EXPECT_NE(state.getGeneration(), otherState.getGeneration());
+
+  auto generation = state.getGeneration();
+  state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_NE(generation, state.getGeneration());
+  generation = state.getGeneration();
+  EXPECT_TRUE(state.updateAdjacencyDatabase(adjDb2, 0, 0).topologyChanged);
+  EXPECT_NE(generation, state.getGeneration());
+
+  // no-op update keeps the generation
+  generation = state.getGeneration();
+  EXPECT_EQ(
+      openr::LinkState::LinkStateChange(),
+      state.updateAdjacencyDatabase(adjDb2, 0, 0));
+  EXPECT_EQ(generation, state.getGeneration());
+
+  // copies share the generation until either is altered
+  openr::LinkState copy = state;
+  EXPECT_EQ(generation, copy.getGeneration());
+  adjDb2.nodeLabel_ref() = 20;
+  EXPECT_TRUE(copy.updateAdjacencyDatabase(adjDb2, 0, 0).nodeLabelChanged);
+  EXPECT_NE(generation, copy.getGeneration());
+  EXPECT_EQ(generation, state.getGeneration());
+
+  EXPECT_TRUE(state.deleteAdjacencyDatabase(n2).topologyChanged);
+  EXPECT_NE(generation, state.getGeneration());
+  EXPECT_NE(copy.getGeneration(), state.getGeneration());
+}
+
+TEST(LinkStateTest, Holds) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  auto adjDb1 = openr::createAdjDb(n1, {adj12}, 1);
+  auto adjDb2 = openr::createAdjDb(n2, {adj21}, 2);
+
+  openr::LinkState state{kTestingAreaName};
+  state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_FALSE(state.hasHolds());
+
+  // link comes up after its hold up expires
+  EXPECT_FALSE(state.updateAdjacencyDatabase(adjDb2, 2, 0).topologyChanged);
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_FALSE(state.decrementHolds().topologyChanged);
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_TRUE(state.decrementHolds().topologyChanged);
+  EXPECT_FALSE(state.hasHolds());
+  EXPECT_EQ(openr::LinkState::LinkStateChange(), state.decrementHolds());
+
+  // node overload is held down, along with the link of a new adjacency
+  auto adj12b =
+      openr::createAdjacency(n2, "if4", "if3", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21b =
+      openr::createAdjacency(n1, "if3", "if4", "fe80::1", "10.0.0.1", 1, 1, 1);
+  adjDb1 = openr::createAdjDb(n1, {adj12, adj12b}, 1);
+  adjDb2 = openr::createAdjDb(n2, {adj21, adj21b}, 2);
+  adjDb2.isOverloaded_ref() = true;
+  state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  EXPECT_FALSE(state.updateAdjacencyDatabase(adjDb2, 1, 1).topologyChanged);
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_FALSE(state.isNodeOverloaded(n2));
+  // both holds expire with a single change
+  EXPECT_TRUE(state.decrementHolds().topologyChanged);
+  EXPECT_TRUE(state.isNodeOverloaded(n2));
+  EXPECT_FALSE(state.hasHolds());
+
+  // holds of removed links are dropped
+  adjDb2.isOverloaded_ref() = false;
+  adjDb2.adjacencies_ref()->pop_back();
+  state.updateAdjacencyDatabase(adjDb2, 0, 0);
+  adjDb2.adjacencies_ref()->emplace_back(adj21b);
+  state.updateAdjacencyDatabase(adjDb2, 3, 0);
+  EXPECT_TRUE(state.hasHolds());
+  state.deleteAdjacencyDatabase(n2);
+  EXPECT_FALSE(state.hasHolds());
+}
+
+TEST(LinkStateTest, NodeLabelIndex) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  auto adjDb1 = openr::createAdjDb(n1, {adj12}, 1);
+  auto adjDb2 = openr::createAdjDb(n2, {adj21}, 2);
+
+  openr::LinkState state{kTestingAreaName};
+  state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  state.updateAdjacencyDatabase(adjDb2, 0, 0);
+  EXPECT_EQ(2, state.getNodeLabelIndex().size());
+  EXPECT_EQ(std::set<std::string>{n1}, state.getNodesWithLabel(1));
+  EXPECT_EQ(std::set<std::string>{n2}, state.getNodesWithLabel(2));
+
+  // conflicting label
+  adjDb2.nodeLabel_ref() = 1;
+  state.updateAdjacencyDatabase(adjDb2, 0, 0);
+  EXPECT_EQ(1, state.getNodeLabelIndex().size());
+  EXPECT_EQ((std::set<std::string>{n1, n2}), state.getNodesWithLabel(1));
+  EXPECT_TRUE(state.getNodesWithLabel(2).empty());
+
+  state.deleteAdjacencyDatabase(n1);
+  EXPECT_EQ(std::set<std::string>{n2}, state.getNodesWithLabel(1));
+  state.deleteAdjacencyDatabase(n2);
+  EXPECT_TRUE(state.getNodeLabelIndex().empty());
+}
+
+/**
+ * Verify adjacency databases read back from their serialized form, and links
+ * made with adjacencies of neighbors known only in that form
+ */
+TEST(LinkStateTest, AdjacencyDatabases) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  std::string n3 = "node3";
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  // unidirectional
+  auto adj13 =
+      openr::createAdjacency(n3, "if3", "if1", "fe80::3", "10.0.0.3", 1, 1, 1);
+  auto adjDb1 = openr::createAdjDb(n1, {adj12, adj13}, 1);
+  auto adjDb2 = openr::createAdjDb(n2, {adj21}, 2);
+
+  openr::LinkState state{kTestingAreaName};
+  state.updateAdjacencyDatabase(adjDb1, 0, 0);
+  state.updateAdjacencyDatabase(adjDb2, 0, 0);
+  EXPECT_EQ(1, state.numLinks());
+  EXPECT_EQ(1, state.linksFromNode(n1).size());
+
+  EXPECT_EQ(adjDb1, state.getAdjacencyDatabase(n1));
+  EXPECT_EQ(adjDb2, state.getAdjacencyDatabase(n2));
+  EXPECT_EQ(std::nullopt, state.getAdjacencyDatabase(n3));
+  EXPECT_EQ(
+      (std::unordered_map<std::string, openr::thrift::AdjacencyDatabase>{
+          {n1, adjDb1}, {n2, adjDb2}}),
+      state.getAdjacencyDatabases());
+  EXPECT_EQ(1, state.getNodeLabel(n1));
+  EXPECT_EQ(2, state.getNodeLabel(n2));
+  EXPECT_THROW(state.getNodeLabel(n3), std::out_of_range);
+  EXPECT_EQ(2, state.getNodeAdjacencyDbs().at(n1).numAdjacencies);
+
+  state.deleteAdjacencyDatabase(n2);
+  EXPECT_EQ(0, state.numLinks());
+  EXPECT_EQ(std::nullopt, state.getAdjacencyDatabase(n2));
+}
+
+/**
+ * Verify next-hop links of the next-hop index, over the square 1-2-4-3-1
+ * with a second link of higher metric between 1 and 2
+ */
+TEST(LinkStateTest, NextHopIndex) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  std::string n3 = "node3";
+  std::string n4 = "node4";
+  auto adj12 =
+      openr::createAdjacency(n2, "if12", "if21", "fe80::2", "10.0.0.2", 1, 1);
+  auto adj12b =
+      openr::createAdjacency(n2, "if12b", "if21b", "fe80::2", "10.0.0.2", 5, 2);
+  auto adj13 =
+      openr::createAdjacency(n3, "if13", "if31", "fe80::3", "10.0.0.3", 1, 3);
+  auto adj21 =
+      openr::createAdjacency(n1, "if21", "if12", "fe80::1", "10.0.0.1", 1, 4);
+  auto adj21b =
+      openr::createAdjacency(n1, "if21b", "if12b", "fe80::1", "10.0.0.1", 5, 5);
+  auto adj24 =
+      openr::createAdjacency(n4, "if24", "if42", "fe80::4", "10.0.0.4", 1, 6);
+  auto adj31 =
+      openr::createAdjacency(n1, "if31", "if13", "fe80::1", "10.0.0.1", 1, 7);
+  auto adj34 =
+      openr::createAdjacency(n4, "if34", "if43", "fe80::4", "10.0.0.4", 1, 8);
+  auto adj42 =
+      openr::createAdjacency(n2, "if42", "if24", "fe80::2", "10.0.0.2", 1, 9);
+  auto adj43 =
+      openr::createAdjacency(n3, "if43", "if34", "fe80::3", "10.0.0.3", 1, 10);
+
+  openr::LinkState state{kTestingAreaName};
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n1, {adj12, adj12b, adj13}, 1), 0, 0);
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n2, {adj21, adj21b, adj24}, 2), 0, 0);
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n3, {adj31, adj34}, 3), 0, 0);
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n4, {adj42, adj43}, 4), 0, 0);
+
+  auto const index = state.getNextHopIndex(n1);
+  EXPECT_EQ(index, state.getNextHopIndex(n1));
+  // the link of higher metric to node2 is not along any shortest path
+  EXPECT_EQ(2, index->links().size());
+
+  auto getIfaces = [&](std::string const& node) {
+    std::set<std::string> ifaces;
+    if (auto const* bits = index->getNextHopLinks(node)) {
+      index->forEachLink(*bits, [&](std::shared_ptr<openr::Link> const& link) {
+        ifaces.emplace(link->getIfaceFromNode(n1));
+      });
+    }
+    return ifaces;
+  };
+  EXPECT_EQ(std::set<std::string>({"if12"}), getIfaces(n2));
+  EXPECT_EQ(std::set<std::string>({"if13"}), getIfaces(n3));
+  EXPECT_EQ(std::set<std::string>({"if12", "if13"}), getIfaces(n4));
+  EXPECT_EQ(std::set<std::string>(), getIfaces(n1));
+  EXPECT_EQ(nullptr, index->getNextHopLinks("unknown"));
+
+  // rebuilt for the new topology, node4 is only reachable through node3
+  state.updateAdjacencyDatabase(openr::createAdjDb(n4, {adj43}, 4), 0, 0);
+  EXPECT_NE(index, state.getNextHopIndex(n1));
+  auto const* bits = state.getNextHopIndex(n1)->getNextHopLinks(n4);
+  ASSERT_NE(nullptr, bits);
+  openr::LinkState::NextHopIndex::Bits united;
+  openr::LinkState::NextHopIndex::unite(united, *bits);
+  EXPECT_EQ(*bits, united);
+  EXPECT_EQ(1, __builtin_popcountll(united.at(0)));
+}
+
 TEST(LinkStateTest, pathAInPathB) {
   auto l1 =
       std::make_shared<openr::Link>(kTestingAreaName, "1", "1/2", "2", "2/1");
@@ -316,6 +608,287 @@ TEST(LinkStateTest, getKthPaths) {
   }
 }
 
+TEST(LinkStateTest, computeKthPaths) {
+  //   1---2---3
+  //   |   |   |
+  //   4---5---6
+  //   |   |   |
+  //   7---8---9
+  auto linkState = openr::getLinkState({
+      {1, {2, 4}},
+      {2, {1, 3, 5}},
+      {3, {2, 6}},
+      {4, {1, 5, 7}},
+      {5, {2, 4, 6, 8}},
+      {6, {3, 5, 9}},
+      {7, {4, 8}},
+      {8, {5, 7, 9}},
+      {9, {6, 8}},
+  });
+  // shares links with linkState, paths can be compared by pointer
+  auto expectedLinkState = linkState;
+
+  std::vector<std::string> dests;
+  for (int node = 1; node <= 9; ++node) {
+    dests.emplace_back(folly::sformat("{}", node));
+  }
+  dests.emplace_back("unknown");
+
+  folly::CPUThreadPoolExecutor executor(4);
+  linkState.computeKthPaths("1", dests, 2, &executor);
+  for (auto const& dest : dests) {
+    for (size_t k = 1; k <= 2; ++k) {
+      EXPECT_EQ(
+          expectedLinkState.getKthPaths("1", dest, k),
+          linkState.getKthPaths("1", dest, k))
+          << dest << ", k = " << k;
+    }
+  }
+  EXPECT_THAT(linkState.getKthPaths("1", "2", 2), ElementsAre(SizeIs(3)));
+  EXPECT_THAT(linkState.getKthPaths("1", "unknown", 2), IsEmpty());
+
+  // sequential batch matches as well
+  auto sequentialLinkState = expectedLinkState;
+  sequentialLinkState.computeKthPaths("1", dests, 3);
+  for (auto const& dest : dests) {
+    EXPECT_EQ(
+        expectedLinkState.getKthPaths("1", dest, 3),
+        sequentialLinkState.getKthPaths("1", dest, 3))
+        << dest;
+  }
+}
+
+namespace {
+
+// node -> (neighbor -> metric) model of a topology without parallel links
+using TopologyModel = std::map<int, std::map<int, int>>;
+
+openr::thrift::AdjacencyDatabase
+createAdjDbFromModel(
+    TopologyModel const& topology, int node, bool isOverloaded) {
+  std::vector<openr::thrift::Adjacency> adjs;
+  for (auto const& [adj, metric] : topology.at(node)) {
+    adjs.push_back(openr::createAdjacency(
+        folly::sformat("{}", adj),
+        folly::sformat("{}/{}", node, adj),
+        folly::sformat("{}/{}", adj, node),
+        folly::sformat("fe80::{}", adj),
+        folly::sformat("192.168.0.{}", adj),
+        metric,
+        (node << 16) + adj));
+  }
+  return openr::createAdjDb(
+      folly::sformat("{}", node), adjs, node, isOverloaded);
+}
+
+// compare node results ignoring the order in which path links are stored
+void
+expectSpfResultsEqual(
+    openr::LinkState::SpfResult const& expected,
+    openr::LinkState::SpfResult const& actual) {
+  auto const pathLinksOf = [](openr::LinkState::NodeSpfResult const& res) {
+    std::vector<std::string> pathLinks;
+    for (auto const& pathLink : res.pathLinks()) {
+      pathLinks.emplace_back(
+          pathLink.link->directionalToString(pathLink.prevNode));
+    }
+    std::sort(pathLinks.begin(), pathLinks.end());
+    return pathLinks;
+  };
+
+  ASSERT_EQ(expected.size(), actual.size());
+  for (auto const& [node, nodeResult] : expected) {
+    auto it = actual.find(node);
+    ASSERT_NE(actual.end(), it) << node;
+    EXPECT_EQ(nodeResult.metric(), it->second.metric()) << node;
+    EXPECT_EQ(nodeResult.nextHops(), it->second.nextHops()) << node;
+    EXPECT_EQ(pathLinksOf(nodeResult), pathLinksOf(it->second)) << node;
+  }
+}
+
+} // namespace
+
+//
+// Apply random topology changes and verify that incrementally repaired SPF
+// results always match a full SPF run on a freshly built LinkState
+//
+TEST(LinkStateTest, IncrementalSpf) {
+  const int kNumNodes = 24;
+  std::mt19937 gen(0x5bf);
+  std::uniform_int_distribution<int> nodeDist(0, kNumNodes - 1);
+  std::uniform_int_distribution<int> metricDist(1, 4);
+
+  // ring with random chords
+  TopologyModel topology;
+  std::set<int> overloadedNodes;
+  auto const addBiLink = [&](int a, int b, int metric) {
+    if (a != b) {
+      topology[a][b] = metric;
+      topology[b][a] = metric;
+    }
+  };
+  for (int i = 0; i < kNumNodes; ++i) {
+    topology[i];
+    addBiLink(i, (i + 1) % kNumNodes, metricDist(gen));
+  }
+  for (int i = 0; i < kNumNodes; ++i) {
+    addBiLink(nodeDist(gen), nodeDist(gen), metricDist(gen));
+  }
+
+  openr::LinkState linkState{kTestingAreaName};
+  for (auto const& [node, _] : topology) {
+    linkState.updateAdjacencyDatabase(
+        createAdjDbFromModel(topology, node, false), 0, 0);
+  }
+
+  for (int step = 0; step < 60; ++step) {
+    // populate memoization (with and without link metrics) from all nodes
+    for (bool useLinkMetric : {true, false}) {
+      for (int i = 0; i < kNumNodes; ++i) {
+        linkState.getSpfResult(folly::sformat("{}", i), useLinkMetric);
+      }
+    }
+
+    // apply a random change
+    std::set<int> changedNodes;
+    const int a = nodeDist(gen), b = nodeDist(gen);
+    switch (step % 4) {
+    case 0: // metric change, one direction only
+      if (topology.at(a).count(b)) {
+        topology[a][b] = metricDist(gen);
+        changedNodes.insert(a);
+      }
+      break;
+    case 1: // link down or up
+      if (topology.at(a).count(b)) {
+        topology[a].erase(b);
+        topology[b].erase(a);
+      } else {
+        addBiLink(a, b, metricDist(gen));
+      }
+      changedNodes.insert(a);
+      changedNodes.insert(b);
+      break;
+    case 2: // overload toggle
+      if (!overloadedNodes.erase(a)) {
+        overloadedNodes.insert(a);
+      }
+      changedNodes.insert(a);
+      break;
+    default: // node restart
+      for (auto const& [adj, _] : topology.at(a)) {
+        changedNodes.insert(adj);
+      }
+      linkState.deleteAdjacencyDatabase(folly::sformat("{}", a));
+      changedNodes.insert(a);
+      break;
+    }
+    for (int node : changedNodes) {
+      linkState.updateAdjacencyDatabase(
+          createAdjDbFromModel(topology, node, overloadedNodes.count(node)),
+          0,
+          0);
+    }
+
+    openr::LinkState freshLinkState{kTestingAreaName};
+    for (auto const& [node, _] : topology) {
+      freshLinkState.updateAdjacencyDatabase(
+          createAdjDbFromModel(topology, node, overloadedNodes.count(node)),
+          0,
+          0);
+    }
+    for (bool useLinkMetric : {true, false}) {
+      for (int i = 0; i < kNumNodes; ++i) {
+        auto const node = folly::sformat("{}", i);
+        expectSpfResultsEqual(
+            freshLinkState.getSpfResult(node, useLinkMetric),
+            linkState.getSpfResult(node, useLinkMetric));
+      }
+    }
+  }
+}
+
+//
+// With the same metric on every link SPF runs as BFS. Compare it against
+// Dijkstra, forced by a disconnected link with a different metric, including
+// the order of path links
+//
+TEST(LinkStateTest, UniformMetricBfs) {
+  const int kNumNodes = 24;
+  const int kMetric = 3;
+  std::mt19937 gen(0xbf5);
+  std::uniform_int_distribution<int> nodeDist(0, kNumNodes - 1);
+
+  TopologyModel topology;
+  auto const addBiLink = [&](int a, int b) {
+    if (a != b) {
+      topology[a][b] = kMetric;
+      topology[b][a] = kMetric;
+    }
+  };
+  for (int i = 0; i < kNumNodes; ++i) {
+    addBiLink(i, (i + 1) % kNumNodes);
+  }
+  for (int i = 0; i < kNumNodes; ++i) {
+    addBiLink(nodeDist(gen), nodeDist(gen));
+  }
+  std::set<int> overloadedNodes{nodeDist(gen), nodeDist(gen)};
+
+  openr::LinkState linkState{kTestingAreaName};
+  openr::LinkState dijkstraLinkState{kTestingAreaName};
+  for (auto const& [node, _] : topology) {
+    auto const adjDb =
+        createAdjDbFromModel(topology, node, overloadedNodes.count(node));
+    linkState.updateAdjacencyDatabase(adjDb, 0, 0);
+    dijkstraLinkState.updateAdjacencyDatabase(adjDb, 0, 0);
+  }
+  TopologyModel disconnected{
+      {kNumNodes, {{kNumNodes + 1, kMetric + 1}}},
+      {kNumNodes + 1, {{kNumNodes, kMetric + 1}}}};
+  for (int node : {kNumNodes, kNumNodes + 1}) {
+    dijkstraLinkState.updateAdjacencyDatabase(
+        createAdjDbFromModel(disconnected, node, false), 0, 0);
+  }
+
+  for (int i = 0; i < kNumNodes; ++i) {
+    auto const node = folly::sformat("{}", i);
+    auto const& bfsResult = linkState.getSpfResult(node, true);
+    auto const& dijkstraResult = dijkstraLinkState.getSpfResult(node, true);
+    ASSERT_EQ(dijkstraResult.size(), bfsResult.size()) << node;
+    for (auto const& [dest, nodeResult] : dijkstraResult) {
+      auto it = bfsResult.find(dest);
+      ASSERT_NE(bfsResult.end(), it) << node << " -> " << dest;
+      EXPECT_EQ(nodeResult.metric(), it->second.metric());
+      EXPECT_EQ(nodeResult.nextHops(), it->second.nextHops());
+      ASSERT_EQ(nodeResult.pathLinks().size(), it->second.pathLinks().size());
+      for (size_t j = 0; j < nodeResult.pathLinks().size(); ++j) {
+        EXPECT_EQ(
+            nodeResult.pathLinks().at(j).link->directionalToString(
+                nodeResult.pathLinks().at(j).prevNode),
+            it->second.pathLinks().at(j).link->directionalToString(
+                it->second.pathLinks().at(j).prevNode))
+            << node << " -> " << dest;
+      }
+    }
+  }
+
+  // a metric change makes the topology non-uniform again
+  auto const [a, neighbors] = *topology.begin();
+  topology[a][neighbors.begin()->first] = kMetric + 1;
+  linkState.updateAdjacencyDatabase(
+      createAdjDbFromModel(topology, a, overloadedNodes.count(a)), 0, 0);
+  dijkstraLinkState.updateAdjacencyDatabase(
+      createAdjDbFromModel(topology, a, overloadedNodes.count(a)), 0, 0);
+  for (int i = 0; i < kNumNodes; ++i) {
+    auto const node = folly::sformat("{}", i);
+    auto dijkstraResult = dijkstraLinkState.getSpfResult(node, true);
+    for (int disconnectedNode : {kNumNodes, kNumNodes + 1}) {
+      dijkstraResult.erase(folly::sformat("{}", disconnectedNode));
+    }
+    expectSpfResultsEqual(dijkstraResult, linkState.getSpfResult(node, true));
+  }
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fmt/format.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/decision/PrefixDampener.h>
+
+using namespace std::chrono_literals;
+
+namespace openr {
+
+namespace {
+
+const auto kPrefix = folly::IPAddress::createNetwork("fc00::1/128");
+
+thrift::PrefixDampeningConfig
+getDampeningConfig() {
+  thrift::PrefixDampeningConfig config;
+  config.withdraw_penalty_ref() = 1000;
+  config.attribute_change_penalty_ref() = 500;
+  config.suppress_threshold_ref() = 2000;
+  config.reuse_threshold_ref() = 750;
+  config.half_life_ms_ref() = 1000;
+  config.max_suppress_ms_ref() = 4000;
+  return config;
+}
+
+} // namespace
+
+/**
+ * Verify suppression of a prefix which is withdrawn and advertised again
+ * - advertisements add no penalty, withdrawals do
+ * - changes while suppressed are compared to the withheld route
+ * - prefix is reused once penalty decays below reuse threshold
+ */
+TEST(PrefixDampener, WithdrawSuppression) {
+  PrefixDampener dampener(getDampeningConfig());
+  const auto start = PrefixDampener::Clock::now();
+  const auto vip = thrift::PrefixType::VIP;
+
+  EXPECT_TRUE(dampener.isDampenedType(vip));
+  EXPECT_FALSE(dampener.isDampenedType(thrift::PrefixType::LOOPBACK));
+
+  // First advertisement, no state kept
+  EXPECT_FALSE(dampener.reportRouteChange(kPrefix, vip, 0, 1, start));
+  EXPECT_EQ(0, dampener.size());
+
+  EXPECT_FALSE(dampener.reportRouteChange(kPrefix, vip, 1, 0, start));
+  EXPECT_DOUBLE_EQ(1000, dampener.getPenalty(kPrefix, start));
+  EXPECT_FALSE(dampener.reportRouteChange(kPrefix, vip, 0, 1, start));
+  EXPECT_DOUBLE_EQ(1000, dampener.getPenalty(kPrefix, start));
+  EXPECT_FALSE(dampener.isSuppressed(kPrefix));
+  EXPECT_FALSE(dampener.getNextReuseTime(start).has_value());
+
+  // Second withdrawal reaches suppress threshold
+  EXPECT_TRUE(dampener.reportRouteChange(kPrefix, vip, 1, 0, start));
+  EXPECT_TRUE(dampener.isSuppressed(kPrefix));
+  EXPECT_EQ(1, dampener.getNumSuppressed());
+  // 1000ms * log2(2000 / 750)
+  auto next = dampener.getNextReuseTime(start);
+  ASSERT_TRUE(next.has_value());
+  EXPECT_GE(*next, 1415ms);
+  EXPECT_LE(*next, 1416ms);
+
+  // Advertised again while suppressed, route is withheld
+  EXPECT_TRUE(dampener.reportRouteChange(kPrefix, vip, 0, 1, start + 100ms));
+  // Attribute change of withheld route is penalized
+  EXPECT_TRUE(dampener.reportRouteChange(kPrefix, vip, 0, 2, start + 100ms));
+  EXPECT_GT(dampener.getPenalty(kPrefix, start + 100ms), 2000);
+  next = dampener.getNextReuseTime(start + 100ms);
+  ASSERT_TRUE(next.has_value());
+  EXPECT_GT(*next, 1415ms);
+
+  // Reused once penalty decayed
+  EXPECT_TRUE(dampener.reuse(start + 1500ms).empty());
+  auto reused = dampener.reuse(start + 100ms + *next);
+  ASSERT_EQ(1, reused.size());
+  EXPECT_EQ(kPrefix, reused.at(0).first);
+  EXPECT_EQ(vip, reused.at(0).second);
+  EXPECT_FALSE(dampener.isSuppressed(kPrefix));
+  EXPECT_EQ(0, dampener.getNumSuppressed());
+  EXPECT_FALSE(dampener.getNextReuseTime(start + 100ms + *next).has_value());
+
+  // Route published again after reuse is not penalized
+  const auto penalty = dampener.getPenalty(kPrefix, start + 5000ms);
+  EXPECT_FALSE(
+      dampener.reportRouteChange(kPrefix, vip, 0, 2, start + 5000ms));
+  EXPECT_NEAR(penalty, dampener.getPenalty(kPrefix, start + 5000ms), 0.01);
+}
+
+/**
+ * Verify penalty is capped such that suppression never exceeds
+ * max_suppress_ms, and state of decayed prefixes is dropped
+ */
+TEST(PrefixDampener, MaxSuppressTime) {
+  PrefixDampener dampener(getDampeningConfig());
+  const auto start = PrefixDampener::Clock::now();
+  const auto bgp = thrift::PrefixType::BGP;
+
+  for (int i = 0; i < 100; ++i) {
+    dampener.reportRouteChange(kPrefix, bgp, 1, 2, start);
+    dampener.reportRouteChange(kPrefix, bgp, 2, 1, start);
+  }
+  EXPECT_TRUE(dampener.isSuppressed(kPrefix));
+  // 750 * 2^(4000ms / 1000ms)
+  EXPECT_NEAR(12000, dampener.getPenalty(kPrefix, start), 1);
+  auto next = dampener.getNextReuseTime(start);
+  ASSERT_TRUE(next.has_value());
+  EXPECT_LE(*next, 4000ms);
+
+  EXPECT_EQ(1, dampener.reuse(start + 4000ms).size());
+  EXPECT_EQ(1, dampener.size());
+
+  // Decayed to nothing, dropped on prune
+  dampener.reuse(start + 60s);
+  EXPECT_EQ(0, dampener.size());
+}
+
+/**
+ * Verify prefixes are reused in order of their reuse time, including stale
+ * heap entries left behind by repeated changes of suppressed prefixes
+ */
+TEST(PrefixDampener, ReuseOrder) {
+  PrefixDampener dampener(getDampeningConfig());
+  const auto start = PrefixDampener::Clock::now();
+  const auto vip = thrift::PrefixType::VIP;
+  const int numPrefixes = 1000;
+
+  auto getPrefix = [](int i) {
+    return folly::IPAddress::createNetwork(
+        fmt::format("fc00::{:x}/128", i + 1));
+  };
+
+  // Suppress prefix i at start + i ms
+  for (int i = 0; i < numPrefixes; ++i) {
+    const auto now = start + std::chrono::milliseconds(i);
+    dampener.reportRouteChange(getPrefix(i), vip, 1, 0, now);
+    EXPECT_TRUE(dampener.reportRouteChange(getPrefix(i), vip, 1, 0, now));
+  }
+  EXPECT_EQ(numPrefixes, dampener.getNumSuppressed());
+
+  // Repeated changes of withheld route of prefix 0, stale entries compacted
+  for (int i = 0; i < 3 * numPrefixes; ++i) {
+    dampener.reportRouteChange(getPrefix(0), vip, 0, i % 2 + 1, start);
+  }
+  EXPECT_EQ(numPrefixes, dampener.getNumSuppressed());
+
+  // Prefix 1 is next to be reused, prefix 0 is suppressed for longest
+  auto next = dampener.getNextReuseTime(start);
+  ASSERT_TRUE(next.has_value());
+  auto reused = dampener.reuse(start + *next);
+  ASSERT_EQ(1, reused.size());
+  EXPECT_EQ(getPrefix(1), reused.at(0).first);
+
+  reused = dampener.reuse(start + *next + 998ms);
+  ASSERT_EQ(numPrefixes - 2, reused.size());
+  for (size_t i = 0; i < reused.size(); ++i) {
+    EXPECT_EQ(getPrefix(i + 2), reused.at(i).first);
+  }
+  EXPECT_TRUE(dampener.isSuppressed(getPrefix(0)));
+  EXPECT_EQ(1, dampener.getNumSuppressed());
+
+  reused = dampener.reuse(start + 4000ms);
+  ASSERT_EQ(1, reused.size());
+  EXPECT_EQ(getPrefix(0), reused.at(0).first);
+  EXPECT_FALSE(dampener.getNextReuseTime(start + 4000ms).has_value());
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
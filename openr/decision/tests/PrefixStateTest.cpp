@@ -239,6 +239,54 @@ TEST(PrefixState, GetReceivedRoutes) {
   }
 }
 
+/**
+ * Verifies routes filtered by node or area are kept in sync with
+ * advertisements and withdrawals
+ */
+TEST(PrefixState, GetReceivedRoutesIndexed) {
+  PrefixState state;
+  const auto prefix1 = toIPNetwork(toIpPrefix("10.0.0.0/8"));
+  const auto prefix2 = toIPNetwork(toIpPrefix("11.0.0.0/8"));
+  const auto entry1 = createPrefixEntry(toIpPrefix("10.0.0.0/8"));
+  const auto entry2 = createPrefixEntry(toIpPrefix("11.0.0.0/8"));
+
+  // prefix1 -> (node0, area0), (node1, area0), prefix2 -> (node1, area1)
+  state.updatePrefix(PrefixKey("node0", prefix1, "area0"), entry1);
+  state.updatePrefix(PrefixKey("node1", prefix1, "area0"), entry1);
+  state.updatePrefix(PrefixKey("node1", prefix2, "area1"), entry2);
+
+  auto getPrefixes = [&state](
+                         std::optional<std::string> node,
+                         std::optional<std::string> area) {
+    thrift::ReceivedRouteFilter filter;
+    filter.nodeName_ref().from_optional(node);
+    filter.areaName_ref().from_optional(area);
+    std::set<std::string> prefixes;
+    for (auto const& route : state.getReceivedRoutesFiltered(filter)) {
+      prefixes.emplace(toString(*route.prefix_ref()));
+    }
+    return prefixes;
+  };
+  using Prefixes = std::set<std::string>;
+
+  EXPECT_EQ(Prefixes({"10.0.0.0/8", "11.0.0.0/8"}), getPrefixes("node1", {}));
+  EXPECT_EQ(Prefixes({"10.0.0.0/8"}), getPrefixes({}, "area0"));
+  EXPECT_EQ(Prefixes({"11.0.0.0/8"}), getPrefixes("node1", "area1"));
+  EXPECT_EQ(Prefixes(), getPrefixes("node0", "area1"));
+
+  // one of two originators in area0 withdraws prefix1
+  state.deletePrefix(PrefixKey("node1", prefix1, "area0"));
+  EXPECT_EQ(Prefixes({"11.0.0.0/8"}), getPrefixes("node1", {}));
+  EXPECT_EQ(Prefixes({"10.0.0.0/8"}), getPrefixes({}, "area0"));
+
+  // last entries of the area and node are gone
+  state.deletePrefix(PrefixKey("node0", prefix1, "area0"));
+  state.deleteNodePrefixes("node1", "area1");
+  EXPECT_EQ(Prefixes(), getPrefixes({}, "area0"));
+  EXPECT_EQ(Prefixes(), getPrefixes("node1", {}));
+  EXPECT_EQ(Prefixes(), getPrefixes({}, {}));
+}
+
 /**
  * Verifies the test case with empty entries. Other cases are exercised above
  */
@@ -255,6 +303,252 @@ TEST(PrefixState, FilterReceivedRoutes) {
   EXPECT_TRUE(routes.empty());
 }
 
+/**
+ * Verifies `getReceivedRoutesFilteredPage` walks prefixes in order across
+ * pages, with prefixes skipped by the filter not counting towards a page
+ */
+TEST(PrefixState, GetReceivedRoutesPage) {
+  PrefixState state;
+  for (int i = 0; i < 5; ++i) {
+    const auto prefixEntry =
+        createPrefixEntry(toIpPrefix(fmt::format("10.0.{}.0/24", i)));
+    state.updatePrefix(
+        PrefixKey("node0", toIPNetwork(prefixEntry.get_prefix()), "area0"),
+        prefixEntry);
+    // only even prefixes in area1
+    if (i % 2 == 0) {
+      state.updatePrefix(
+          PrefixKey("node1", toIPNetwork(prefixEntry.get_prefix()), "area1"),
+          prefixEntry);
+    }
+  }
+
+  //
+  // All prefixes, two per page
+  //
+  {
+    thrift::ReceivedRouteFilter filter;
+    thrift::PageParams page;
+    page.limit_ref() = 2;
+    std::vector<thrift::IpPrefix> prefixes;
+    size_t numPages{0};
+    while (true) {
+      auto thriftPage = state.getReceivedRoutesFilteredPage(filter, page);
+      ++numPages;
+      for (auto const& route : *thriftPage.routes_ref()) {
+        prefixes.emplace_back(*route.prefix_ref());
+      }
+      if (not thriftPage.nextCursor_ref().has_value()) {
+        break;
+      }
+      page.cursor_ref() = *thriftPage.nextCursor_ref();
+    }
+    EXPECT_EQ(3, numPages);
+    ASSERT_EQ(5, prefixes.size());
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(toIpPrefix(fmt::format("10.0.{}.0/24", i)), prefixes.at(i));
+    }
+  }
+
+  //
+  // Area filter, only matching prefixes fill the page
+  //
+  {
+    thrift::ReceivedRouteFilter filter;
+    filter.areaName_ref() = "area1";
+    thrift::PageParams page;
+    page.limit_ref() = 2;
+    auto thriftPage = state.getReceivedRoutesFilteredPage(filter, page);
+    ASSERT_EQ(2, thriftPage.routes_ref()->size());
+    EXPECT_EQ(
+        toIpPrefix("10.0.0.0/24"),
+        *thriftPage.routes_ref()->at(0).prefix_ref());
+    EXPECT_EQ(
+        toIpPrefix("10.0.2.0/24"),
+        *thriftPage.routes_ref()->at(1).prefix_ref());
+    EXPECT_EQ(1, thriftPage.routes_ref()->at(0).routes_ref()->size());
+    EXPECT_EQ("10.0.2.0/24", thriftPage.nextCursor_ref().value());
+
+    page.cursor_ref() = *thriftPage.nextCursor_ref();
+    thriftPage = state.getReceivedRoutesFilteredPage(filter, page);
+    ASSERT_EQ(1, thriftPage.routes_ref()->size());
+    EXPECT_EQ(
+        toIpPrefix("10.0.4.0/24"),
+        *thriftPage.routes_ref()->at(0).prefix_ref());
+    EXPECT_FALSE(thriftPage.nextCursor_ref().has_value());
+  }
+
+  //
+  // Invalid page params
+  //
+  {
+    thrift::ReceivedRouteFilter filter;
+    thrift::PageParams page;
+    page.limit_ref() = 0;
+    EXPECT_THROW(
+        state.getReceivedRoutesFilteredPage(filter, page), thrift::OpenrError);
+    page.limit_ref() = 1;
+    page.cursor_ref() = "not-a-prefix";
+    EXPECT_THROW(
+        state.getReceivedRoutesFilteredPage(filter, page), thrift::OpenrError);
+  }
+}
+
+/**
+ * Verifies the node, KSP2 and conflicting prefix indices, and the count of
+ * entries, follow prefix updates and withdrawals
+ */
+TEST(PrefixState, PrefixIndices) {
+  PrefixState state;
+  auto const prefix1 = toIpPrefix("10.0.0.1/32");
+  auto const prefix2 = toIpPrefix("10.0.0.2/32");
+  auto const network1 = toIPNetwork(prefix1);
+  auto const network2 = toIPNetwork(prefix2);
+
+  auto [key1Area1, entry1Area1] =
+      createPrefixKeyAndEntry("node1", prefix1, "area1");
+  auto [key1Area2, entry1Area2] =
+      createPrefixKeyAndEntry("node1", prefix1, "area2");
+  auto [key2, entry2] = createPrefixKeyAndEntry("node2", prefix2, "area1");
+  entry2->forwardingAlgorithm_ref() =
+      thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
+
+  EXPECT_TRUE(state.getPrefixesFromNode("node1").empty());
+  state.updatePrefix(key1Area1, *entry1Area1);
+  state.updatePrefix(key1Area2, *entry1Area2);
+  state.updatePrefix(key2, *entry2);
+  EXPECT_THAT(
+      state.getPrefixesFromNode("node1"),
+      testing::UnorderedElementsAre(network1));
+  EXPECT_THAT(
+      state.getPrefixesFromNode("node2"),
+      testing::UnorderedElementsAre(network2));
+  EXPECT_THAT(state.ksp2Prefixes(), testing::UnorderedElementsAre(network2));
+  EXPECT_TRUE(state.conflictingPrefixes().empty());
+  EXPECT_EQ(3, state.getNumPrefixEntries());
+
+  // entries of prefix1 disagree on forwarding type
+  entry1Area2->forwardingType_ref() = thrift::PrefixForwardingType::SR_MPLS;
+  state.updatePrefix(key1Area2, *entry1Area2);
+  EXPECT_THAT(
+      state.conflictingPrefixes(), testing::UnorderedElementsAre(network1));
+  EXPECT_EQ(3, state.getNumPrefixEntries());
+
+  // node1 still advertises prefix1 in area2
+  state.deletePrefix(key1Area1);
+  EXPECT_THAT(
+      state.getPrefixesFromNode("node1"),
+      testing::UnorderedElementsAre(network1));
+  EXPECT_TRUE(state.conflictingPrefixes().empty());
+  EXPECT_EQ(2, state.getNumPrefixEntries());
+  state.deletePrefix(key1Area2);
+  EXPECT_TRUE(state.getPrefixesFromNode("node1").empty());
+
+  // changing the forwarding algorithm updates the KSP2 index
+  entry2->forwardingAlgorithm_ref() =
+      thrift::PrefixForwardingAlgorithm::SP_ECMP;
+  state.updatePrefix(key2, *entry2);
+  EXPECT_TRUE(state.ksp2Prefixes().empty());
+  state.deletePrefix(key2);
+  EXPECT_TRUE(state.getPrefixesFromNode("node2").empty());
+  EXPECT_EQ(0, state.getNumPrefixEntries());
+}
+
+/**
+ * Verify all prefixes of a node gone from an area are withdrawn at once,
+ * leaving its prefixes in other areas and the ones of other nodes
+ */
+TEST(PrefixState, DeleteNodePrefixes) {
+  PrefixState state;
+  auto const network1 = toIPNetwork(toIpPrefix("10.0.0.1/32"));
+  auto const network2 = toIPNetwork(toIpPrefix("10.0.0.2/32"));
+  for (auto const& [node, prefix, area] :
+       std::vector<std::tuple<std::string, std::string, std::string>>{
+           {"node1", "10.0.0.1/32", "area1"},
+           {"node1", "10.0.0.2/32", "area1"},
+           {"node1", "10.0.0.2/32", "area2"},
+           {"node2", "10.0.0.1/32", "area1"}}) {
+    auto [key, entry] = createPrefixKeyAndEntry(node, toIpPrefix(prefix), area);
+    state.updatePrefix(key, *entry);
+  }
+  EXPECT_EQ(4, state.getNumPrefixEntries());
+
+  EXPECT_THAT(
+      state.deleteNodePrefixes("node1", "area1"),
+      testing::UnorderedElementsAre(network1, network2));
+  EXPECT_EQ(2, state.getNumPrefixEntries());
+  EXPECT_THAT(
+      state.getPrefixesFromNode("node1"),
+      testing::UnorderedElementsAre(network2));
+  EXPECT_EQ(1, state.prefixes().at(network1).count({"node2", "area1"}));
+  EXPECT_TRUE(state.deleteNodePrefixes("node1", "area1").empty());
+  EXPECT_TRUE(state.deleteNodePrefixes("node3", "area1").empty());
+
+  EXPECT_THAT(
+      state.deleteNodePrefixes("node1", "area2"),
+      testing::UnorderedElementsAre(network2));
+  EXPECT_TRUE(state.getPrefixesFromNode("node1").empty());
+  EXPECT_EQ(0, state.prefixes().count(network2));
+  EXPECT_EQ(1, state.getNumPrefixEntries());
+}
+
+TEST(PrefixState, ReachablePrefixEntries) {
+  PrefixState state;
+  auto const prefix = toIpPrefix("10.0.0.1/32");
+  auto const network = toIPNetwork(prefix);
+
+  auto [key1, entry1] = createPrefixKeyAndEntry("node1", prefix, "area1");
+  auto [key2, entry2] = createPrefixKeyAndEntry("node2", prefix, "area1");
+  auto [key3, entry3] = createPrefixKeyAndEntry("node3", prefix, "area2");
+  state.updatePrefix(key1, *entry1);
+  state.updatePrefix(key2, *entry2);
+  state.updatePrefix(key3, *entry3);
+
+  // without reachability all entries are considered reachable
+  EXPECT_FALSE(state.hasReachableNodes());
+  EXPECT_EQ(3, state.getReachablePrefixEntries(network).size());
+
+  // node2 unreachable in area1, area2 not tracked
+  EXPECT_THAT(
+      state.updateReachableNodes("area1", {"node1"}),
+      testing::UnorderedElementsAre(network));
+  EXPECT_TRUE(state.hasReachableNodes());
+  auto const& entries = state.getReachablePrefixEntries(network);
+  EXPECT_EQ(2, entries.size());
+  EXPECT_EQ(1, entries.count({"node1", "area1"}));
+  EXPECT_EQ(1, entries.count({"node3", "area2"}));
+
+  // no change in reachability
+  EXPECT_TRUE(state.updateReachableNodes("area1", {"node1"}).empty());
+
+  // node3 unreachable in area2
+  EXPECT_THAT(
+      state.updateReachableNodes("area2", {}),
+      testing::UnorderedElementsAre(network));
+  EXPECT_EQ(1, state.getReachablePrefixEntries(network).size());
+
+  // prefix updates from unreachable nodes stay out of the view
+  entry2->type_ref() = thrift::PrefixType::BREEZE;
+  state.updatePrefix(key2, *entry2);
+  EXPECT_EQ(1, state.getReachablePrefixEntries(network).size());
+
+  // node2 reachable again
+  EXPECT_THAT(
+      state.updateReachableNodes("area1", {"node1", "node2"}),
+      testing::UnorderedElementsAre(network));
+  EXPECT_EQ(
+      thrift::PrefixType::BREEZE,
+      *state.getReachablePrefixEntries(network)
+           .at({"node2", "area1"})
+           ->type_ref());
+
+  state.deletePrefix(key1);
+  state.deletePrefix(key2);
+  EXPECT_TRUE(state.getReachablePrefixEntries(network).empty());
+  state.deletePrefix(key3);
+  EXPECT_TRUE(state.getReachablePrefixEntries(network).empty());
+}
+
 /**
  * Test PrefixState::hasConflictingForwardingInfo
  */
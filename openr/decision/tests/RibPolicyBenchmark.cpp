@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fmt/format.h>
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/Util.h>
+#include <openr/decision/RibPolicy.h>
+
+namespace openr {
+
+namespace {
+
+// prefixes matched per prefix statement
+const size_t kPrefixesPerStatement{16};
+// distinct tags among routes
+const size_t kNumTags{64};
+
+folly::CIDRNetwork
+getPrefix(size_t index) {
+  return folly::IPAddress::createNetwork(
+      fmt::format("fc00:{:x}:{:x}::/64", index >> 16, index & 0xffff));
+}
+
+/*
+ * Every other statement matches prefixes, spread over all routes. The others
+ * match a tag, and some of them a prefix as well.
+ */
+thrift::RibPolicy
+createPolicy(size_t numStatements, size_t numRoutes) {
+  thrift::RibPolicy policy;
+  policy.ttl_secs_ref() = 3600;
+  for (size_t i = 0; i < numStatements; ++i) {
+    thrift::RibPolicyStatement stmt;
+    stmt.name_ref() = fmt::format("stmt-{}", i);
+    stmt.action_ref()->set_weight_ref() = thrift::RibRouteActionWeight{};
+    stmt.action_ref()->set_weight_ref()->default_weight_ref() =
+        static_cast<int32_t>(i + 1);
+    if (i % 2 == 0 or i % 3 == 0) {
+      std::vector<thrift::IpPrefix> prefixes;
+      for (size_t j = 0; j < kPrefixesPerStatement; ++j) {
+        prefixes.emplace_back(
+            toIpPrefix(getPrefix((i * kPrefixesPerStatement + j) % numRoutes)));
+      }
+      stmt.matcher_ref()->prefixes_ref() = std::move(prefixes);
+    }
+    if (i % 2 == 1) {
+      stmt.matcher_ref()->tags_ref() =
+          std::vector<std::string>{fmt::format("tag-{}", i % kNumTags)};
+    }
+    policy.statements_ref()->emplace_back(std::move(stmt));
+  }
+  return policy;
+}
+
+std::unordered_map<folly::CIDRNetwork, RibUnicastEntry>
+createRoutes(size_t numRoutes) {
+  const auto nh = createNextHop(
+      toBinaryAddress("fe80::1"), "iface1", 0, std::nullopt, "area1", "nbr1");
+  std::unordered_map<folly::CIDRNetwork, RibUnicastEntry> routes;
+  for (size_t i = 0; i < numRoutes; ++i) {
+    RibUnicastEntry route(getPrefix(i), {nh});
+    route.bestPrefixEntry.tags_ref()->insert(
+        fmt::format("tag-{}", i % kNumTags));
+    routes.emplace(route.prefix, std::move(route));
+  }
+  return routes;
+}
+
+} // namespace
+
+/*
+ * BM_RibPolicyApplyPolicy:
+ * measures RibPolicy::applyPolicy() over all routes of a full route rebuild.
+ * With `warm` the policy evaluated the same routes before, so matching
+ * statements come from its cache.
+ */
+static void
+BM_RibPolicyApplyPolicy(
+    uint32_t iters, size_t numStatements, size_t numRoutes, bool warm) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto tPolicy = createPolicy(numStatements, numRoutes);
+  const auto routes = createRoutes(numRoutes);
+  auto policy = std::make_unique<RibPolicy>(tPolicy);
+  if (warm) {
+    auto copy = routes;
+    policy->applyPolicy(copy);
+  }
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto copy = routes;
+    if (not warm) {
+      policy = std::make_unique<RibPolicy>(tPolicy);
+    }
+    suspender.dismiss();
+    auto change = policy->applyPolicy(copy);
+    folly::doNotOptimizeAway(change);
+    suspender.rehire();
+  }
+}
+
+/*
+ * @first integer: number of policy statements
+ * @second integer: number of routes
+ * @third bool: whether matching statements are cached
+ */
+BENCHMARK_NAMED_PARAM(BM_RibPolicyApplyPolicy, 10_10000, 10, 10000, false);
+BENCHMARK_NAMED_PARAM(BM_RibPolicyApplyPolicy, 100_10000, 100, 10000, false);
+BENCHMARK_NAMED_PARAM(BM_RibPolicyApplyPolicy, 1000_10000, 1000, 10000, false);
+BENCHMARK_NAMED_PARAM(
+    BM_RibPolicyApplyPolicy, 1000_100000, 1000, 100000, false);
+BENCHMARK_NAMED_PARAM(
+    BM_RibPolicyApplyPolicy, 1000_100000_warm, 1000, 100000, true);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -394,6 +394,130 @@ TEST(RibPolicy, ApplyPolicy) {
   }
 }
 
+TEST(RibPolicy, CompiledMatch) {
+  const auto nh1 = createNextHop(
+      toBinaryAddress("fe80::1"), "iface1", 0, std::nullopt, "area1", "nbr1");
+  const auto nh2 = createNextHop(
+      toBinaryAddress("fe80::2"), "iface2", 0, std::nullopt, "area2", "nbr2");
+
+  // stmt1: prefix + tag, invalidates all next-hops of area2
+  // stmt2: tag only
+  // stmt3: prefix only
+  std::vector<thrift::IpPrefix> prefixes{toIpPrefix("fc01::/64")};
+  const auto stmt1 = createPolicyStatement(
+      prefixes, std::vector<std::string>{"tag1"}, 2, {{"area2", 0}});
+  const auto stmt2 = createPolicyStatement(
+      std::nullopt, std::vector<std::string>{"tag1", "tag2"}, 3, {});
+  const auto stmt3 = createPolicyStatement(prefixes, std::nullopt, 4, {});
+  auto policy = RibPolicy(createPolicy({stmt1, stmt2, stmt3}, 10));
+
+  auto getWeight = [](RibUnicastEntry const& entry) {
+    CHECK_EQ(1, entry.nexthops.size());
+    return *entry.nexthops.begin()->weight_ref();
+  };
+
+  // stmt1 matches but invalidates the only next-hop, stmt2 applies
+  {
+    RibUnicastEntry entry(folly::IPAddress::createNetwork("fc01::/64"), {nh2});
+    entry.bestPrefixEntry.tags_ref()->insert("tag1");
+    EXPECT_TRUE(policy.match(entry));
+    EXPECT_TRUE(policy.applyAction(entry));
+    EXPECT_EQ(3, getWeight(entry));
+  }
+
+  // same prefix with tags changed, cache is not used. stmt3 applies
+  {
+    RibUnicastEntry entry(folly::IPAddress::createNetwork("fc01::/64"), {nh2});
+    entry.bestPrefixEntry.tags_ref()->insert("tag3");
+    EXPECT_TRUE(policy.applyAction(entry));
+    EXPECT_EQ(4, getWeight(entry));
+  }
+
+  // stmt1 applies
+  {
+    RibUnicastEntry entry(folly::IPAddress::createNetwork("fc01::/64"), {nh1});
+    entry.bestPrefixEntry.tags_ref()->insert("tag1");
+    EXPECT_TRUE(policy.applyAction(entry));
+    EXPECT_EQ(2, getWeight(entry));
+  }
+
+  // other prefix, by tag ONLY
+  {
+    RibUnicastEntry entry(folly::IPAddress::createNetwork("fc02::/64"), {nh1});
+    EXPECT_FALSE(policy.match(entry));
+    entry.bestPrefixEntry.tags_ref()->insert("tag2");
+    EXPECT_TRUE(policy.match(entry));
+    EXPECT_TRUE(policy.applyAction(entry));
+    EXPECT_EQ(3, getWeight(entry));
+  }
+}
+
+/**
+ * Verify only routes matching statements changed between policies are
+ * affected by a policy change
+ */
+TEST(RibPolicy, AffectedPrefixes) {
+  const auto nh = createNextHop(
+      toBinaryAddress("fe80::1"), "iface1", 0, std::nullopt, "area1", "nbr1");
+  const auto prefix1 = folly::IPAddress::createNetwork("fc01::/64");
+  const auto prefix2 = folly::IPAddress::createNetwork("fc02::/64");
+  const auto prefix3 = folly::IPAddress::createNetwork("fc03::/64");
+  std::unordered_map<folly::CIDRNetwork, RibUnicastEntry> routes;
+  for (auto const& prefix : {prefix1, prefix2, prefix3}) {
+    routes.emplace(prefix, RibUnicastEntry(prefix, {nh}));
+  }
+  routes.at(prefix2).bestPrefixEntry.tags_ref()->insert("tag1");
+
+  // stmt1: prefix1 and a prefix without route, stmt2: tag1
+  const auto stmt1 = createPolicyStatement(
+      std::vector<thrift::IpPrefix>{
+          toIpPrefix("fc01::/64"), toIpPrefix("fc09::/64")},
+      std::nullopt,
+      2,
+      {});
+  const auto stmt2 = createPolicyStatement(
+      std::nullopt, std::vector<std::string>{"tag1"}, 3, {});
+  const RibPolicy policy(createPolicy({stmt1, stmt2}, 10));
+
+  using Prefixes = std::unordered_set<folly::CIDRNetwork>;
+  EXPECT_EQ(
+      Prefixes({prefix1, prefix2}),
+      RibPolicy::getAffectedPrefixes(nullptr, &policy, routes));
+  EXPECT_EQ(
+      Prefixes({prefix1, prefix2}),
+      RibPolicy::getAffectedPrefixes(&policy, nullptr, routes));
+
+  // same statements, renewed policy
+  const RibPolicy renewed(createPolicy({stmt1, stmt2}, 20));
+  EXPECT_TRUE(RibPolicy::getAffectedPrefixes(&policy, &renewed, routes)
+                  .empty());
+
+  // action of stmt2 changed
+  auto stmt2Changed = stmt2;
+  stmt2Changed.action_ref()->set_weight_ref()->default_weight_ref() = 4;
+  const RibPolicy changed(createPolicy({stmt1, stmt2Changed}, 10));
+  EXPECT_EQ(
+      Prefixes({prefix2}),
+      RibPolicy::getAffectedPrefixes(&policy, &changed, routes));
+
+  // statements reordered
+  const RibPolicy reordered(createPolicy({stmt2, stmt1}, 10));
+  EXPECT_EQ(
+      Prefixes({prefix1, prefix2}),
+      RibPolicy::getAffectedPrefixes(&policy, &reordered, routes));
+
+  // statement appended, matching prefix3
+  const auto stmt3 = createPolicyStatement(
+      std::vector<thrift::IpPrefix>{toIpPrefix("fc03::/64")},
+      std::nullopt,
+      5,
+      {});
+  const RibPolicy appended(createPolicy({stmt1, stmt2, stmt3}, 10));
+  EXPECT_EQ(
+      Prefixes({prefix3}),
+      RibPolicy::getAffectedPrefixes(&policy, &appended, routes));
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -7,6 +7,13 @@
 
 #include <openr/decision/tests/RoutingBenchmarkUtils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <openr/tests/mocks/PrefixChurnGenerator.h>
+
 namespace openr {
 // Get a unique Id for adjacency-label
 inline uint32_t
@@ -583,6 +590,198 @@ updateRandomGridPrefixes(
       decisionWrapper, processTimes, nodeName, std::move(keyDbPair));
 }
 
+// Add adjacencies in both directions between two nodes of the area
+void
+addRoutingLink(
+    RoutingTopology& topology,
+    const std::string& area,
+    const std::string& nodeName,
+    const uint32_t nodeId,
+    const std::string& otherNodeName,
+    const uint32_t otherId,
+    const int32_t metric) {
+  auto addAdjacency = [&](const std::string& name,
+                          const uint32_t id,
+                          const std::string& otherName,
+                          const uint32_t otherNameId) {
+    auto& areaAdjDbs = topology.adjDbs[area];
+    auto it = areaAdjDbs.find(name);
+    if (it == areaAdjDbs.end()) {
+      it = areaAdjDbs.emplace(name, createAdjDb(name, {}, id, false, area))
+               .first;
+    }
+    it->second.adjacencies_ref()->emplace_back(createThriftAdjacency(
+        otherName,
+        getIfName(id, otherNameId),
+        folly::sformat(
+            "fe80:{}::{}",
+            toHex(otherNameId >> 16),
+            toHex(otherNameId & 0xffff)),
+        folly::sformat(
+            "10.{}.{}.{}",
+            otherNameId >> 16,
+            (otherNameId >> 8) & 0xff,
+            otherNameId & 0xff),
+        metric,
+        100001 + otherNameId /* adjacency-label */,
+        false /* overload-bit */,
+        100,
+        10000 /* timestamp */,
+        1 /* weight */,
+        getIfName(otherNameId, id)));
+  };
+  addAdjacency(nodeName, nodeId, otherNodeName, otherId);
+  addAdjacency(otherNodeName, otherId, nodeName, nodeId);
+}
+
+// Advertise numOfPrefixes distinct prefixes from node in the area
+void
+addRoutingPrefixes(
+    RoutingTopology& topology,
+    const std::string& nodeName,
+    const uint32_t nodeId,
+    const std::string& area,
+    const int numOfPrefixes) {
+  CHECK_GT(0x10000, nodeId);
+  CHECK_GT(0x10000, numOfPrefixes);
+  for (int i = 0; i < numOfPrefixes; ++i) {
+    const auto network = folly::IPAddress::createNetwork(
+        folly::sformat("fc00:{:x}:{:x}::/64", nodeId, i));
+    topology.prefixes.emplace_back(
+        PrefixKey(nodeName, network, area),
+        createPrefixEntry(toIpPrefix(network)));
+  }
+}
+
+RoutingTopology
+createClosTopology(
+    const int numOfPlanes,
+    const int numOfSswsPerPlane,
+    const int numOfPods,
+    const int numOfRswsPerPod,
+    const int numOfPrefixesPerNode,
+    const bool planesAsAreas) {
+  LOG(INFO) << "clos: " << numOfPlanes << " planes, " << numOfPods << " pods";
+  RoutingTopology topology;
+  std::vector<std::string> areas;
+  for (int plane = 0; plane < (planesAsAreas ? numOfPlanes : 1); ++plane) {
+    if (planesAsAreas) {
+      areas.emplace_back(folly::sformat("plane-{}", plane));
+    } else {
+      areas.emplace_back(kTestingAreaName);
+    }
+  }
+
+  // ids: ssws first, then fsws and rsws pod by pod
+  const uint32_t numOfSsws = numOfPlanes * numOfSswsPerPlane;
+  auto getFswId = [&](int pod, int plane) {
+    return numOfSsws + pod * numOfPlanes + plane;
+  };
+  auto getRswId = [&](int pod, int rsw) {
+    return numOfSsws + numOfPods * numOfPlanes + pod * numOfRswsPerPod + rsw;
+  };
+
+  for (int pod = 0; pod < numOfPods; ++pod) {
+    for (int plane = 0; plane < numOfPlanes; ++plane) {
+      const auto& area = areas.at(planesAsAreas ? plane : 0);
+      const auto fswName = folly::sformat("fsw-{}-{}", pod, plane);
+      for (int ssw = 0; ssw < numOfSswsPerPlane; ++ssw) {
+        addRoutingLink(
+            topology,
+            area,
+            fswName,
+            getFswId(pod, plane),
+            folly::sformat("ssw-{}-{}", plane, ssw),
+            plane * numOfSswsPerPlane + ssw,
+            1);
+      }
+      for (int rsw = 0; rsw < numOfRswsPerPod; ++rsw) {
+        addRoutingLink(
+            topology,
+            area,
+            folly::sformat("rsw-{}-{}", pod, rsw),
+            getRswId(pod, rsw),
+            fswName,
+            getFswId(pod, plane),
+            1);
+      }
+    }
+    for (int rsw = 0; rsw < numOfRswsPerPod; ++rsw) {
+      for (auto const& area : areas) {
+        addRoutingPrefixes(
+            topology,
+            folly::sformat("rsw-{}-{}", pod, rsw),
+            getRswId(pod, rsw),
+            area,
+            numOfPrefixesPerNode);
+      }
+    }
+  }
+  topology.rootNode = "rsw-0-0";
+  return topology;
+}
+
+RoutingTopology
+createWanTopology(
+    const int numOfNodes,
+    const int avgDegree,
+    const int numOfPrefixesPerNode,
+    const uint32_t seed) {
+  LOG(INFO) << "wan: " << numOfNodes << " nodes, degree " << avgDegree;
+  RoutingTopology topology;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  std::vector<std::pair<double, double>> positions;
+  for (int i = 0; i < numOfNodes; ++i) {
+    positions.emplace_back(dist(gen), dist(gen));
+  }
+
+  // expected degree of a random geometric graph is n * pi * r^2
+  const double radius = std::sqrt(avgDegree / (M_PI * numOfNodes));
+  auto getMetric = [](double distance) {
+    return std::max<int32_t>(1, distance * 1000);
+  };
+  for (int i = 0; i < numOfNodes; ++i) {
+    const auto nodeName = folly::sformat("wan-{}", i);
+    std::optional<int> nearest;
+    double nearestDistance{std::numeric_limits<double>::max()};
+    for (int j = 0; j < i; ++j) {
+      const double distance = std::hypot(
+          positions.at(i).first - positions.at(j).first,
+          positions.at(i).second - positions.at(j).second);
+      if (distance < radius) {
+        addRoutingLink(
+            topology,
+            kTestingAreaName,
+            nodeName,
+            i,
+            folly::sformat("wan-{}", j),
+            j,
+            getMetric(distance));
+      }
+      if (distance < nearestDistance) {
+        nearest = j;
+        nearestDistance = distance;
+      }
+    }
+    // linked to nearest already if it is within radius
+    if (nearest.has_value() and nearestDistance >= radius) {
+      addRoutingLink(
+          topology,
+          kTestingAreaName,
+          nodeName,
+          i,
+          folly::sformat("wan-{}", *nearest),
+          *nearest,
+          getMetric(nearestDistance));
+    }
+    addRoutingPrefixes(
+        topology, nodeName, i, kTestingAreaName, numOfPrefixesPerNode);
+  }
+  topology.rootNode = "wan-0";
+  return topology;
+}
+
 //
 // Get average processTimes and insert as user counters.
 //
@@ -730,6 +929,105 @@ BM_DecisionGridPrefixUpdates(
   insertUserCounters(counters, iters, processTimes, forwardingAlgorithm);
 }
 
+void
+BM_DecisionGridPrefixChurn(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    thrift::PrefixForwardingAlgorithm forwardingAlgorithm,
+    uint32_t numberOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string nodeName{"1"};
+  auto decisionWrapper = std::make_shared<DecisionWrapper>(nodeName);
+  int n = std::sqrt(numOfSws);
+  auto [adjs, prefixes] = createGrid(n, 1, forwardingAlgorithm);
+
+  std::vector<uint64_t> intitalProcessTimes{0, 0, 0};
+
+  sendRecvInitialUpdate(
+      decisionWrapper,
+      intitalProcessTimes,
+      nodeName,
+      std::move(adjs),
+      std::move(prefixes));
+
+  // Churn is spread over all nodes of the grid, named after their index as
+  // originators are
+  PrefixChurnGenerator::Config config;
+  config.numPrefixes = numberOfPrefixes;
+  config.numOriginators = n * n;
+  config.initialAdvertisedShare = 0.8;
+  config.massWithdrawRate = 1;
+  PrefixChurnGenerator generator(config);
+
+  // Publish churn events with forwarding of the benchmark, all within one
+  // publication as if they were flooded within one KvStore sync
+  auto sendRecvEvents =
+      [&](std::vector<PrefixChurnGenerator::Event>& events,
+          std::vector<uint64_t>& processTimes) {
+        thrift::PerfEvents perfEvents;
+        addPerfEvent(perfEvents, nodeName, "DECISION_INIT_UPDATE");
+        thrift::Publication pub;
+        pub.area_ref() = kTestingAreaName;
+        for (auto& event : events) {
+          for (auto& entry : event.entries) {
+            entry.forwardingAlgorithm_ref() = forwardingAlgorithm;
+            entry.forwardingType_ref() = KSP2_ED_ECMP == forwardingAlgorithm
+                ? thrift::PrefixForwardingType::SR_MPLS
+                : thrift::PrefixForwardingType::IP;
+          }
+          for (auto& [key, value] : PrefixChurnGenerator::toKeyVals(
+                   event, kTestingAreaName, perfEvents)) {
+            (*pub.keyVals_ref())[key] = std::move(value);
+          }
+        }
+        sendRecvUpdate(decisionWrapper, processTimes, pub);
+      };
+
+  // Initially advertised prefixes, at their first version
+  std::vector<PrefixChurnGenerator::Event> initialEvents;
+  for (uint32_t originator = 0; originator < config.numOriginators;
+       ++originator) {
+    PrefixChurnGenerator::Event event;
+    event.originator = originator;
+    event.entries = generator.getAdvertisedEntries(originator);
+    event.versions.resize(event.entries.size(), 1);
+    initialEvents.emplace_back(std::move(event));
+  }
+  sendRecvEvents(initialEvents, intitalProcessTimes);
+
+  std::vector<uint64_t> processTimes{0, 0, 0};
+  uint64_t numEvents{0};
+  uint64_t numKeys{0};
+
+  // Events over consecutive 100ms of simulated time, with at least one event
+  // so that each publication triggers a route update
+  std::vector<std::vector<PrefixChurnGenerator::Event>> batches;
+  for (uint32_t i = 0; i < iters; i++) {
+    auto events = generator.nextFor(std::chrono::milliseconds(100));
+    if (events.empty()) {
+      events.emplace_back(generator.next());
+    }
+    numEvents += events.size();
+    for (auto const& event : events) {
+      numKeys += event.entries.size();
+    }
+    batches.emplace_back(std::move(events));
+  }
+
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (auto& events : batches) {
+    sendRecvEvents(events, processTimes);
+  }
+
+  suspender.rehire(); // Stop measuring time again
+  // Insert processTimes as user counters
+  insertUserCounters(counters, iters, processTimes, forwardingAlgorithm);
+  counters["churn_events"] = numEvents / std::max(iters, 1u);
+  counters["churn_keys"] = numKeys / std::max(iters, 1u);
+}
+
 //
 // Benchmark test for fabric topology.
 //
@@ -803,4 +1101,207 @@ BM_DecisionFabric(
   // Insert processTimes as user counters
   insertUserCounters(counters, iters, processTimes, std::nullopt);
 }
+
+//
+// Time each phase of route computation for the root node: SPF, best route
+// selection, route build, RIB policy, and rebuild plus diff after failing a
+// random link and a random node. Every iteration starts from a fresh copy of
+// the link states, so no memoized SPF results are reused across iterations.
+//
+void
+runRoutingPhases(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    RoutingTopology const& topology) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto& rootNode = topology.rootNode;
+  std::unordered_map<std::string, LinkState> areaLinkStates;
+  // nodes which may fail, by area
+  std::vector<std::pair<std::string, std::string>> candidates;
+  for (auto const& [area, adjDbs] : topology.adjDbs) {
+    auto& linkState =
+        areaLinkStates.emplace(area, LinkState(area)).first->second;
+    for (auto const& [nodeName, adjDb] : adjDbs) {
+      linkState.updateAdjacencyDatabase(adjDb);
+      if (nodeName != rootNode) {
+        candidates.emplace_back(area, nodeName);
+      }
+    }
+  }
+  CHECK(not candidates.empty());
+  PrefixState prefixState;
+  for (auto const& [key, entry] : topology.prefixes) {
+    prefixState.updatePrefix(key, entry);
+  }
+
+  // policy matching every prefix
+  thrift::RibPolicyStatement stmt;
+  stmt.name_ref() = "all";
+  stmt.action_ref()->set_weight_ref() = thrift::RibRouteActionWeight{};
+  stmt.action_ref()->set_weight_ref()->default_weight_ref() = 1;
+  stmt.matcher_ref()->prefixes_ref() = std::vector<thrift::IpPrefix>{};
+  for (auto const& [prefix, _] : prefixState.prefixes()) {
+    stmt.matcher_ref()->prefixes_ref()->emplace_back(toIpPrefix(prefix));
+  }
+  thrift::RibPolicy tPolicy;
+  tPolicy.ttl_secs_ref() = 3600;
+  tPolicy.statements_ref()->emplace_back(std::move(stmt));
+
+  std::chrono::nanoseconds spfTime{0};
+  std::chrono::nanoseconds selectionTime{0};
+  std::chrono::nanoseconds routeBuildTime{0};
+  std::chrono::nanoseconds policyTime{0};
+  std::chrono::nanoseconds diffTime{0};
+  std::chrono::nanoseconds linkFailureTime{0};
+  std::chrono::nanoseconds nodeFailureTime{0};
+  size_t numOfRoutes{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    auto linkStates = areaLinkStates;
+    SpfSolver spfSolver(
+        rootNode,
+        false /* enableV4 */,
+        false /* enableNodeSegmentLabel */,
+        false /* enableAdjacencyLabels */);
+
+    // initial route computation, phase by phase
+    suspender.dismiss(); // Start measuring benchmark time
+    auto startTime = std::chrono::steady_clock::now();
+    spfSolver.computeSpfResults(rootNode, linkStates);
+    auto endTime = std::chrono::steady_clock::now();
+    spfTime += endTime - startTime;
+
+    startTime = endTime;
+    for (auto const& [_, prefixEntries] : prefixState.prefixes()) {
+      auto bestNodeAreas = selectBestPrefixMetrics(prefixEntries);
+      folly::doNotOptimizeAway(bestNodeAreas);
+    }
+    endTime = std::chrono::steady_clock::now();
+    selectionTime += endTime - startTime;
+
+    startTime = endTime;
+    auto routeDb = spfSolver.buildRouteDb(rootNode, linkStates, prefixState);
+    routeBuildTime += std::chrono::steady_clock::now() - startTime;
+    suspender.rehire(); // Stop measuring time again
+    CHECK(routeDb.has_value());
+    numOfRoutes = routeDb->unicastRoutes.size();
+
+    auto policyRoutes = routeDb->unicastRoutes;
+    RibPolicy policy(tPolicy);
+    suspender.dismiss();
+    startTime = std::chrono::steady_clock::now();
+    auto policyChange = policy.applyPolicy(policyRoutes);
+    policyTime += std::chrono::steady_clock::now() - startTime;
+    folly::doNotOptimizeAway(policyChange);
+    suspender.rehire();
+
+    // fail one link of a random node, both directions
+    const auto& [linkArea, linkNode] =
+        candidates.at(folly::Random::rand32(candidates.size()));
+    auto adjDb = topology.adjDbs.at(linkArea).at(linkNode);
+    auto& adjs = *adjDb.adjacencies_ref();
+    auto failedAdj = adjs.at(folly::Random::rand32(adjs.size()));
+    adjs.erase(
+        std::remove_if(
+            adjs.begin(),
+            adjs.end(),
+            [&](auto const& adj) {
+              return *adj.ifName_ref() == *failedAdj.ifName_ref();
+            }),
+        adjs.end());
+    auto otherAdjDb =
+        topology.adjDbs.at(linkArea).at(*failedAdj.otherNodeName_ref());
+    auto& otherAdjs = *otherAdjDb.adjacencies_ref();
+    otherAdjs.erase(
+        std::remove_if(
+            otherAdjs.begin(),
+            otherAdjs.end(),
+            [&](auto const& adj) {
+              return *adj.ifName_ref() == *failedAdj.otherIfName_ref();
+            }),
+        otherAdjs.end());
+
+    suspender.dismiss();
+    startTime = std::chrono::steady_clock::now();
+    auto& linkState = linkStates.at(linkArea);
+    linkState.updateAdjacencyDatabase(adjDb);
+    linkState.updateAdjacencyDatabase(otherAdjDb);
+    spfSolver.computeSpfResults(rootNode, linkStates);
+    auto newRouteDb = spfSolver.buildRouteDb(rootNode, linkStates, prefixState);
+    auto diffStartTime = std::chrono::steady_clock::now();
+    auto update = routeDb->calculateUpdate(std::move(newRouteDb.value()));
+    endTime = std::chrono::steady_clock::now();
+    linkFailureTime += endTime - startTime;
+    diffTime += endTime - diffStartTime;
+    folly::doNotOptimizeAway(update);
+    suspender.rehire();
+
+    // fail a random node, i.e. withdraw its adjacencies in all areas
+    linkStates = areaLinkStates;
+    spfSolver.computeSpfResults(rootNode, linkStates);
+    const auto& failedNode =
+        candidates.at(folly::Random::rand32(candidates.size())).second;
+    suspender.dismiss();
+    startTime = std::chrono::steady_clock::now();
+    for (auto& [area, areaLinkState] : linkStates) {
+      if (topology.adjDbs.at(area).count(failedNode)) {
+        areaLinkState.deleteAdjacencyDatabase(failedNode);
+      }
+    }
+    spfSolver.computeSpfResults(rootNode, linkStates);
+    newRouteDb = spfSolver.buildRouteDb(rootNode, linkStates, prefixState);
+    update = routeDb->calculateUpdate(std::move(newRouteDb.value()));
+    nodeFailureTime += std::chrono::steady_clock::now() - startTime;
+    folly::doNotOptimizeAway(update);
+    suspender.rehire();
+  }
+
+  iters = iters == 0 ? 1 : iters;
+  auto toUs = [iters](std::chrono::nanoseconds time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time)
+               .count() /
+        iters;
+  };
+  counters["num_routes"] = numOfRoutes;
+  counters["spf_us"] = toUs(spfTime);
+  counters["best_route_selection_us"] = toUs(selectionTime);
+  counters["route_build_us"] = toUs(routeBuildTime);
+  counters["rib_policy_us"] = toUs(policyTime);
+  counters["diff_us"] = toUs(diffTime);
+  counters["link_failure_rebuild_us"] = toUs(linkFailureTime);
+  counters["node_failure_rebuild_us"] = toUs(nodeFailureTime);
+}
+
+void
+BM_RoutingClosPhases(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfPods,
+    uint32_t numOfPlanes,
+    uint32_t numOfPrefixesPerNode,
+    bool planesAsAreas) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto topology = createClosTopology(
+      numOfPlanes,
+      kNumOfSswsPerPlane,
+      numOfPods,
+      kNumOfRswsPerPod,
+      numOfPrefixesPerNode,
+      planesAsAreas);
+  suspender.dismiss();
+  runRoutingPhases(counters, iters, topology);
+}
+
+void
+BM_RoutingWanPhases(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfNodes,
+    uint32_t avgDegree,
+    uint32_t numOfPrefixesPerNode) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto topology =
+      createWanTopology(numOfNodes, avgDegree, numOfPrefixesPerNode);
+  suspender.dismiss();
+  runRoutingPhases(counters, iters, topology);
+}
 } // namespace openr
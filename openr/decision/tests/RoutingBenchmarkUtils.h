@@ -323,6 +323,50 @@ thrift::Publication createFabric(
     const int numOfFswsPerPod,
     const int numOfRswsPerPod);
 
+//
+// Topology handed to LinkState/PrefixState directly, without Decision
+//
+struct RoutingTopology {
+  // area -> node -> adjacency database of the node in the area
+  std::unordered_map<
+      std::string,
+      std::unordered_map<std::string, thrift::AdjacencyDatabase>>
+      adjDbs;
+
+  // prefix advertisements of all nodes
+  std::vector<std::pair<PrefixKey, thrift::PrefixEntry>> prefixes;
+
+  // node whose routes are computed
+  std::string rootNode;
+};
+
+/**
+ * Create a multi-plane Clos topology. Every pod has one fsw per plane, which
+ * connects to all ssws of its plane and to all rsws of the pod. rsws advertise
+ * the prefixes, so the ECMP width between rsws of different pods is
+ * numOfPlanes. With planesAsAreas every plane is an area of its own and rsws
+ * advertise their prefixes in all of them.
+ */
+RoutingTopology createClosTopology(
+    const int numOfPlanes,
+    const int numOfSswsPerPlane,
+    const int numOfPods,
+    const int numOfRswsPerPod,
+    const int numOfPrefixesPerNode,
+    const bool planesAsAreas);
+
+/**
+ * Create a WAN-like random geometric topology. Nodes are placed uniformly in
+ * a unit square and linked when closer than the radius giving avgDegree on
+ * average, with metrics proportional to distance. Every node is linked to its
+ * nearest predecessor as well, keeping the topology connected.
+ */
+RoutingTopology createWanTopology(
+    const int numOfNodes,
+    const int avgDegree,
+    const int numOfPrefixesPerNode,
+    const uint32_t seed = 1);
+
 //
 // Randomly choose one rsw from a random pod,
 // toggle it's overload bit in AdjacencyDb
@@ -382,6 +426,18 @@ void BM_DecisionGridPrefixUpdates(
     thrift::PrefixForwardingAlgorithm forwardingAlgorithm,
     uint32_t numberOfPrefixes);
 
+//
+// Steady-state prefix churn out of PrefixChurnGenerator, spread over the
+// nodes of the grid. numberOfPrefixes is the size of the churned universe,
+// each iteration publishes the events of 100ms of simulated time
+//
+void BM_DecisionGridPrefixChurn(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    thrift::PrefixForwardingAlgorithm forwardingAlgorithm,
+    uint32_t numberOfPrefixes);
+
 void BM_DecisionGridAdjUpdates(
     folly::UserCounters& counters,
     uint32_t iters,
@@ -399,6 +455,24 @@ void BM_DecisionFabric(
     thrift::PrefixForwardingAlgorithm forwardingAlgorithm,
     uint32_t numberOfPrefixes = 1);
 
+//
+// Benchmark tests for route computation phases, driving SpfSolver directly.
+//
+void BM_RoutingClosPhases(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfPods,
+    uint32_t numOfPlanes,
+    uint32_t numOfPrefixesPerNode,
+    bool planesAsAreas);
+
+void BM_RoutingWanPhases(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfNodes,
+    uint32_t avgDegree,
+    uint32_t numOfPrefixesPerNode);
+
 const auto SP_ECMP = thrift::PrefixForwardingAlgorithm::SP_ECMP;
 const auto KSP2_ED_ECMP = thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
 } // namespace openr
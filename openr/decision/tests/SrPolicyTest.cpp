@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fmt/format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/decision/SrPolicy.h>
+
+using namespace openr;
+
+namespace {
+
+const int64_t kRed{0x1};
+
+// bidirectional link between nodes a and b
+struct Edge {
+  int a;
+  int b;
+  int32_t metric;
+  int64_t adminGroups{0};
+};
+
+int32_t
+getNodeLabel(int node) {
+  return 100 + node;
+}
+
+int32_t
+getAdjLabel(int from, int to) {
+  return 1000 + 10 * from + to;
+}
+
+thrift::Adjacency
+getAdjacency(int from, int to, int32_t metric, int64_t adminGroups) {
+  auto adj = createAdjacency(
+      std::to_string(to),
+      fmt::format("if_{}_{}", from, to),
+      fmt::format("if_{}_{}", to, from),
+      fmt::format("fe80::{}", to),
+      fmt::format("10.0.0.{}", to),
+      metric,
+      getAdjLabel(from, to));
+  adj.adminGroups_ref() = adminGroups;
+  return adj;
+}
+
+std::unordered_map<std::string, LinkState>
+createAreaLinkStates() {
+  std::unordered_map<std::string, LinkState> areaLinkStates;
+  areaLinkStates.emplace(kTestingAreaName, LinkState(kTestingAreaName));
+  return areaLinkStates;
+}
+
+// advertise adjacency databases of nodes 1 to numNodes
+void
+updateTopology(
+    std::unordered_map<std::string, LinkState>& areaLinkStates,
+    std::vector<Edge> const& edges,
+    int numNodes) {
+  auto& linkState = areaLinkStates.at(kTestingAreaName);
+  for (int node = 1; node <= numNodes; ++node) {
+    std::vector<thrift::Adjacency> adjs;
+    for (auto const& edge : edges) {
+      if (edge.a == node) {
+        adjs.emplace_back(
+            getAdjacency(edge.a, edge.b, edge.metric, edge.adminGroups));
+      }
+      if (edge.b == node) {
+        adjs.emplace_back(
+            getAdjacency(edge.b, edge.a, edge.metric, edge.adminGroups));
+      }
+    }
+    linkState.updateAdjacencyDatabase(
+        createAdjDb(std::to_string(node), adjs, getNodeLabel(node)));
+  }
+}
+
+thrift::SrPolicyConfig
+getPolicy(
+    std::string const& name,
+    int destination,
+    std::vector<std::string> const& prefixes = {}) {
+  thrift::SrPolicyConfig policy;
+  policy.name_ref() = name;
+  policy.destination_ref() = std::to_string(destination);
+  policy.prefixes_ref() = prefixes;
+  return policy;
+}
+
+// nodes along path, from the head-end
+std::vector<std::string>
+getNodes(SrPolicyPath const& path, std::string node = "1") {
+  std::vector<std::string> nodes{node};
+  for (auto const& link : path.links) {
+    node = link->getOtherNodeName(node);
+    nodes.emplace_back(node);
+  }
+  return nodes;
+}
+
+} // namespace
+
+/**
+ * Verify affinity and metric constraints, and label stacks
+ *
+ *    1 --- 2 -red- 3
+ *    |            |
+ *    +---- 4 -----+
+ *
+ * Metrics: 1-2: 1, 2-3: 1, 1-4: 2, 4-3: 5
+ */
+TEST(SrPolicySolverTest, Constraints) {
+  auto areaLinkStates = createAreaLinkStates();
+  updateTopology(
+      areaLinkStates, {{1, 2, 1}, {2, 3, 1, kRed}, {1, 4, 2}, {4, 3, 5}}, 4);
+
+  auto avoidRed = getPolicy("avoid-red", 3);
+  avoidRed.exclude_any_ref() = kRed;
+  auto bounded = getPolicy("bounded", 3);
+  bounded.exclude_any_ref() = kRed;
+  bounded.max_metric_ref() = 6;
+  auto redOnly = getPolicy("red-only", 3);
+  redOnly.include_all_ref() = kRed;
+  auto oneSegment = getPolicy("one-segment", 3);
+  oneSegment.exclude_any_ref() = kRed;
+  oneSegment.max_segments_ref() = 0;
+  SrPolicySolver solver(
+      {getPolicy("shortest", 3), avoidRed, bounded, redOnly, oneSegment});
+  solver.updatePaths("1", areaLinkStates);
+
+  // shortest path to 3 from 2 is unique, node label of 3 steers along it
+  auto const* path = solver.getPath("shortest");
+  ASSERT_NE(nullptr, path);
+  EXPECT_EQ(std::vector<std::string>({"1", "2", "3"}), getNodes(*path));
+  EXPECT_EQ(2, path->metric);
+  EXPECT_EQ(std::vector<int32_t>({getNodeLabel(3)}), path->labels);
+
+  // shortest path to 3 from 4 goes back through 1, adjacency label of 4-3
+  path = solver.getPath("avoid-red");
+  ASSERT_NE(nullptr, path);
+  EXPECT_EQ(std::vector<std::string>({"1", "4", "3"}), getNodes(*path));
+  EXPECT_EQ(7, path->metric);
+  EXPECT_EQ(std::vector<int32_t>({getAdjLabel(4, 3)}), path->labels);
+
+  EXPECT_EQ(nullptr, solver.getPath("bounded"));
+  EXPECT_EQ(nullptr, solver.getPath("red-only"));
+  EXPECT_EQ(nullptr, solver.getPath("one-segment"));
+  EXPECT_EQ(nullptr, solver.getPath("unknown"));
+}
+
+/**
+ * Verify policies of a disjoint group share no link
+ */
+TEST(SrPolicySolverTest, DisjointGroup) {
+  auto areaLinkStates = createAreaLinkStates();
+  updateTopology(
+      areaLinkStates, {{1, 2, 1}, {2, 3, 1}, {1, 4, 2}, {4, 3, 2}}, 4);
+
+  std::vector<thrift::SrPolicyConfig> policies;
+  for (auto const& name : {"c", "b", "a"}) {
+    policies.emplace_back(getPolicy(name, 3));
+    policies.back().disjoint_group_ref() = "group";
+  }
+  SrPolicySolver solver(std::move(policies));
+  solver.updatePaths("1", areaLinkStates);
+
+  // computed in order of name
+  auto const* path = solver.getPath("a");
+  ASSERT_NE(nullptr, path);
+  EXPECT_EQ(std::vector<std::string>({"1", "2", "3"}), getNodes(*path));
+  path = solver.getPath("b");
+  ASSERT_NE(nullptr, path);
+  EXPECT_EQ(std::vector<std::string>({"1", "4", "3"}), getNodes(*path));
+  EXPECT_EQ(std::vector<int32_t>({getNodeLabel(3)}), path->labels);
+  EXPECT_EQ(nullptr, solver.getPath("c"));
+}
+
+/**
+ * Verify paths are only recomputed upon link state changes and are kept over
+ * equal cost paths
+ */
+TEST(SrPolicySolverTest, Reoptimization) {
+  const auto prefix = folly::IPAddress::createNetwork("10.0.0.0/24");
+  auto areaLinkStates = createAreaLinkStates();
+  std::vector<Edge> edges{{1, 2, 1}, {2, 3, 1}, {1, 4, 1}, {4, 3, 1}};
+  updateTopology(areaLinkStates, edges, 4);
+
+  SrPolicySolver solver({getPolicy("policy", 3, {"10.0.0.0/24"})});
+  ASSERT_NE(nullptr, solver.getPolicyForPrefix(prefix));
+  EXPECT_EQ("policy", *solver.getPolicyForPrefix(prefix)->name_ref());
+  EXPECT_EQ(
+      std::vector<folly::CIDRNetwork>{prefix}, solver.getSteeredPrefixes());
+
+  EXPECT_EQ(
+      std::unordered_set<folly::CIDRNetwork>{prefix},
+      solver.updatePaths("1", areaLinkStates));
+  EXPECT_TRUE(solver.updatePaths("1", areaLinkStates).empty());
+  ASSERT_NE(nullptr, solver.getPath("policy"));
+  auto const via = getNodes(*solver.getPath("policy")).at(1);
+  auto const other = via == "2" ? "4" : "2";
+
+  // path through `via` gets longer, moved to the other one
+  for (auto& edge : edges) {
+    if (edge.a == 1 and std::to_string(edge.b) == via) {
+      edge.metric = 10;
+    }
+  }
+  updateTopology(areaLinkStates, edges, 4);
+  EXPECT_EQ(
+      std::unordered_set<folly::CIDRNetwork>{prefix},
+      solver.updatePaths("1", areaLinkStates));
+  ASSERT_NE(nullptr, solver.getPath("policy"));
+  EXPECT_EQ(other, getNodes(*solver.getPath("policy")).at(1));
+
+  // back to equal cost, path is kept
+  for (auto& edge : edges) {
+    edge.metric = 1;
+  }
+  updateTopology(areaLinkStates, edges, 4);
+  EXPECT_TRUE(solver.updatePaths("1", areaLinkStates).empty());
+  ASSERT_NE(nullptr, solver.getPath("policy"));
+  EXPECT_EQ(other, getNodes(*solver.getPath("policy")).at(1));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
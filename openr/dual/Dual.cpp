@@ -705,6 +705,8 @@ DualNode::peerDown(const std::string& neighbor) {
   localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
   // clear counters
   clearCounters(neighbor);
+  // neighbor resets its state for me, messages still queued are stale
+  pendingMsgsToSend_.erase(neighbor);
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
   for (auto& [_, dual] : duals_) {
@@ -749,6 +751,20 @@ DualNode::getSptRootId() const noexcept {
   return std::nullopt;
 }
 
+std::optional<std::string>
+DualNode::getSptRootId(size_t hash) const noexcept {
+  std::vector<std::string const*> rootIds;
+  for (const auto& [rootId, dual] : duals_) {
+    if (dual.hasValidRoute()) {
+      rootIds.emplace_back(&rootId);
+    }
+  }
+  if (rootIds.empty()) {
+    return std::nullopt;
+  }
+  return *rootIds.at(hash % rootIds.size());
+}
+
 std::unordered_set<std::string>
 DualNode::getSptPeers(const std::optional<std::string>& rootId) const noexcept {
   if (not rootId.has_value()) {
@@ -774,7 +790,12 @@ DualNode::processDualMessages(const thrift::DualMessages& messages) {
   counters_[neighbor].msgRecv_ref() =
       *counters_[neighbor].msgRecv_ref() + messages.messages_ref()->size();
 
-  for (const auto& msg : *messages.messages_ref()) {
+  // several distance changes for a root in the batch result in one
+  // computation on the latest one
+  auto msgs = *messages.messages_ref();
+  coalesceDualMessages(msgs);
+
+  for (const auto& msg : msgs) {
     const auto& rootId = *msg.dstId_ref();
     addDual(rootId);
     auto& dual = duals_.at(rootId);
@@ -879,12 +900,60 @@ DualNode::clearCounters(const std::string& neighbor) noexcept {
   counters_[neighbor] = thrift::DualPerNeighborCounters();
 }
 
+void
+DualNode::coalesceDualMessages(std::vector<thrift::DualMessage>& messages) {
+  // roots with an UPDATE later in the messages, and no QUERY or REPLY since
+  std::unordered_set<std::string> updatedRoots;
+  std::vector<bool> superseded(messages.size(), false);
+  for (size_t i = messages.size(); i-- > 0;) {
+    const auto& msg = messages.at(i);
+    if (*msg.type_ref() != thrift::DualMessageType::UPDATE) {
+      updatedRoots.erase(*msg.dstId_ref());
+      continue;
+    }
+    superseded.at(i) = not updatedRoots.emplace(*msg.dstId_ref()).second;
+  }
+
+  size_t next = 0;
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (not superseded.at(i)) {
+      if (next != i) {
+        messages.at(next) = std::move(messages.at(i));
+      }
+      ++next;
+    }
+  }
+  messages.resize(next);
+}
+
 void
 DualNode::sendAllDualMessages(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+  bool queued = false;
+  for (auto& [neighbor, msgs] : msgsToSend) {
+    if (msgs.messages_ref()->empty()) {
+      continue;
+    }
+    auto& pending = *pendingMsgsToSend_[neighbor].messages_ref();
+    pending.insert(
+        pending.end(),
+        std::make_move_iterator(msgs.messages_ref()->begin()),
+        std::make_move_iterator(msgs.messages_ref()->end()));
+    queued = true;
+  }
+  if (queued) {
+    scheduleDualMessagesFlush();
+  }
+}
+
+void
+DualNode::flushDualMessages() {
+  auto msgsToSend = std::move(pendingMsgsToSend_);
+  pendingMsgsToSend_.clear();
   for (auto& kv : msgsToSend) {
     const auto& neighbor = kv.first;
     auto& msgs = kv.second;
+    coalesceDualMessages(*msgs.messages_ref());
     if (msgs.messages_ref()->empty()) {
       // ignore empty messages
       continue;
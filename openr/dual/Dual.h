@@ -11,6 +11,7 @@
 #include <limits>
 #include <stack>
 #include <unordered_map>
+#include <vector>
 
 #include <folly/Format.h>
 
@@ -345,6 +346,11 @@ class DualNode {
   // return none if no ready SPT found
   std::optional<std::string> getSptRootId() const noexcept;
 
+  // pick one of the root-ids who have a valid-route by hash, e.g. of a
+  // flooded key, spreading flooding over the SPTs of all healthy roots
+  // return none if no ready SPT found
+  std::optional<std::string> getSptRootId(size_t hash) const noexcept;
+
   // get SPT-peers for a given root-id
   // return empty-set if dual for root-id is not ready
   std::unordered_set<std::string> getSptPeers(
@@ -372,14 +378,32 @@ class DualNode {
   // get dual related counters
   thrift::DualCounters getCounters() const noexcept;
 
+  // send out the dual messages queued since the last flush, see
+  // scheduleDualMessagesFlush()
+  void flushDualMessages();
+
+  // drop UPDATEs superseded by a later UPDATE for the same root, unless a
+  // QUERY or REPLY for the root lies in between. Receivers only keep the
+  // latest report-distance of an UPDATE, so they end up in the same state
+  static void coalesceDualMessages(std::vector<thrift::DualMessage>& messages);
+
   // myRootId
   const std::string nodeId;
 
   // I'm a root or not
   const bool isRoot{false};
 
+ protected:
+  // called when dual messages get queued. Flushes right away by default,
+  // subclasses may defer flushDualMessages(), e.g. to the end of the event
+  // loop iteration, to send the messages of several events together
+  virtual void
+  scheduleDualMessagesFlush() {
+    flushDualMessages();
+  }
+
  private:
-  // send out dual messages for a given <neighbor: dual-messages>
+  // queue dual messages for a given <neighbor: dual-messages>
   void sendAllDualMessages(
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -397,6 +421,9 @@ class DualNode {
 
   // map<neighbor-id: counters>
   std::unordered_map<std::string, thrift::DualPerNeighborCounters> counters_;
+
+  // dual messages queued until the next flushDualMessages()
+  std::unordered_map<std::string, thrift::DualMessages> pendingMsgsToSend_;
 };
 
 } // namespace openr
@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include <fmt/format.h>
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+
+#include <openr/dual/Dual.h>
+
+namespace openr {
+
+namespace {
+
+// upper bound of rounds per simulated event, protects against a
+// non-converging run
+const size_t kMaxRounds{100000};
+
+// number of flooding origins sampled per topology
+const size_t kNumFloodOrigins{16};
+
+class DualSimulator;
+
+/*
+ * DualNode whose I/O goes through the simulator. Outgoing messages are
+ * flushed once per round, like KvStoreDb flushes them once per event loop
+ * iteration
+ */
+class DualSimNode final : public DualNode {
+ public:
+  DualSimNode(const std::string& nodeId, bool isRoot, DualSimulator& sim)
+      : DualNode(nodeId, isRoot), sim_(sim) {}
+
+  bool sendDualMessages(
+      const std::string& neighbor,
+      const thrift::DualMessages& msgs) noexcept override;
+
+  void processNexthopChange(
+      const std::string& rootId,
+      const std::optional<std::string>& oldNh,
+      const std::optional<std::string>& newNh) noexcept override;
+
+ protected:
+  void scheduleDualMessagesFlush() override;
+
+ private:
+  DualSimulator& sim_;
+};
+
+/*
+ * In-process simulation of DUAL over a topology. Messages sent in a round are
+ * delivered in the next one, so the number of rounds until no message is in
+ * flight is the convergence time in link latencies. SPT-children are set
+ * right away on nexthop changes, as the FLOOD_TOPO_SET command of KvStore
+ * would.
+ */
+class DualSimulator {
+ public:
+  struct Stats {
+    size_t rounds{0};
+    size_t packets{0};
+    size_t messages{0};
+  };
+
+  struct FloodStats {
+    // publications sent over all links
+    size_t transmissions{0};
+    // nodes which received the publication, origin included
+    size_t reached{0};
+  };
+
+  void
+  addNode(const std::string& nodeId, bool isRoot) {
+    nodes_.emplace(
+        nodeId, std::make_unique<DualSimNode>(nodeId, isRoot, *this));
+    adjacencies_[nodeId];
+  }
+
+  // add a link, brought up by the next linkUp()
+  void
+  addLink(const std::string& node1, const std::string& node2, int64_t cost) {
+    adjacencies_[node1][node2] = cost;
+    adjacencies_[node2][node1] = cost;
+  }
+
+  void
+  linkUp(const std::string& node1, const std::string& node2) {
+    const auto cost = adjacencies_.at(node1).at(node2);
+    upLinks_.emplace(linkKey(node1, node2));
+    nodes_.at(node1)->peerUp(node2, cost);
+    nodes_.at(node2)->peerUp(node1, cost);
+  }
+
+  void
+  allLinksUp() {
+    for (const auto& [node, neighbors] : adjacencies_) {
+      for (const auto& [neighbor, _] : neighbors) {
+        if (node < neighbor) {
+          linkUp(node, neighbor);
+        }
+      }
+    }
+  }
+
+  void
+  linkDown(const std::string& node1, const std::string& node2) {
+    if (upLinks_.erase(linkKey(node1, node2)) == 0) {
+      return;
+    }
+    nodes_.at(node1)->peerDown(node2);
+    nodes_.at(node2)->peerDown(node1);
+  }
+
+  // node fails, neighbors see all of its links going down
+  void
+  nodeDown(const std::string& nodeId) {
+    for (const auto& [neighbor, _] : adjacencies_.at(nodeId)) {
+      if (upLinks_.erase(linkKey(nodeId, neighbor)) and
+          nodes_.count(neighbor)) {
+        nodes_.at(neighbor)->peerDown(nodeId);
+      }
+    }
+    nodes_.erase(nodeId);
+    dirtyNodes_.erase(nodeId);
+  }
+
+  // deliver messages round by round until none is in flight
+  Stats
+  run() {
+    stats_ = Stats();
+    flush();
+    while (not inFlight_.empty() and stats_.rounds < kMaxRounds) {
+      ++stats_.rounds;
+      auto inFlight = std::move(inFlight_);
+      inFlight_.clear();
+      for (const auto& [neighbor, msgs] : inFlight) {
+        const auto& src = *msgs.srcId_ref();
+        // dropped along with the session
+        if (not upLinks_.count(linkKey(src, neighbor))) {
+          continue;
+        }
+        nodes_.at(neighbor)->processDualMessages(msgs);
+      }
+      flush();
+    }
+    CHECK(inFlight_.empty()) << "DUAL did not converge";
+    return stats_;
+  }
+
+  // flood a publication from origin over the SPT origin picks, or over all
+  // links if spt is false
+  FloodStats
+  flood(const std::string& origin, bool spt) const {
+    FloodStats stats;
+    const auto rootId = nodes_.at(origin)->getSptRootId();
+    std::unordered_set<std::string> reached{origin};
+    std::deque<std::pair<std::string, std::string>> queue{{origin, ""}};
+    while (not queue.empty()) {
+      const auto [node, sender] = queue.front();
+      queue.pop_front();
+      std::vector<std::string> peers;
+      if (spt) {
+        const auto sptPeers = nodes_.at(node)->getSptPeers(rootId);
+        peers.assign(sptPeers.begin(), sptPeers.end());
+      } else {
+        for (const auto& [neighbor, _] : adjacencies_.at(node)) {
+          if (upLinks_.count(linkKey(node, neighbor))) {
+            peers.emplace_back(neighbor);
+          }
+        }
+      }
+      for (const auto& peer : peers) {
+        if (peer == sender) {
+          continue;
+        }
+        ++stats.transmissions;
+        if (reached.emplace(peer).second) {
+          queue.emplace_back(peer, node);
+        }
+      }
+    }
+    stats.reached = reached.size();
+    return stats;
+  }
+
+  const std::map<std::string, std::unique_ptr<DualSimNode>>&
+  getNodes() const {
+    return nodes_;
+  }
+
+  void
+  send(const std::string& neighbor, const thrift::DualMessages& msgs) {
+    ++stats_.packets;
+    stats_.messages += msgs.messages_ref()->size();
+    inFlight_.emplace_back(neighbor, msgs);
+  }
+
+  void
+  setChild(
+      const std::string& rootId,
+      const std::string& child,
+      const std::optional<std::string>& oldNh,
+      const std::optional<std::string>& newNh) {
+    if (oldNh.has_value() and nodes_.count(*oldNh) and
+        nodes_.at(*oldNh)->hasDual(rootId)) {
+      nodes_.at(*oldNh)->getDual(rootId).removeChild(child);
+    }
+    if (newNh.has_value() and nodes_.count(*newNh) and
+        nodes_.at(*newNh)->hasDual(rootId)) {
+      nodes_.at(*newNh)->getDual(rootId).addChild(child);
+    }
+  }
+
+  void
+  markDirty(const std::string& nodeId) {
+    dirtyNodes_.emplace(nodeId);
+  }
+
+ private:
+  static std::pair<std::string, std::string>
+  linkKey(const std::string& node1, const std::string& node2) {
+    return node1 < node2 ? std::make_pair(node1, node2)
+                         : std::make_pair(node2, node1);
+  }
+
+  void
+  flush() {
+    auto dirtyNodes = std::move(dirtyNodes_);
+    dirtyNodes_.clear();
+    for (const auto& nodeId : dirtyNodes) {
+      nodes_.at(nodeId)->flushDualMessages();
+    }
+  }
+
+  std::map<std::string, std::unique_ptr<DualSimNode>> nodes_;
+  // map<node: map<neighbor: cost>>
+  std::map<std::string, std::map<std::string, int64_t>> adjacencies_;
+  std::set<std::pair<std::string, std::string>> upLinks_;
+  // nodes with queued dual messages, sorted for reproducible runs
+  std::set<std::string> dirtyNodes_;
+  // <neighbor, dual-messages> sent in the current round
+  std::vector<std::pair<std::string, thrift::DualMessages>> inFlight_;
+  Stats stats_;
+};
+
+bool
+DualSimNode::sendDualMessages(
+    const std::string& neighbor, const thrift::DualMessages& msgs) noexcept {
+  sim_.send(neighbor, msgs);
+  return true;
+}
+
+void
+DualSimNode::processNexthopChange(
+    const std::string& rootId,
+    const std::optional<std::string>& oldNh,
+    const std::optional<std::string>& newNh) noexcept {
+  sim_.setChild(rootId, nodeId, oldNh, newNh);
+}
+
+void
+DualSimNode::scheduleDualMessagesFlush() {
+  sim_.markDirty(nodeId);
+}
+
+/*
+ * Fabric of 4 planes with 8 spine switches each. Every pod has one fabric
+ * switch per plane, connected to all spines of its plane, and 20 rack
+ * switches connected to all fabric switches of the pod. The first spine of
+ * each plane is a flood root, up to numRoots.
+ */
+std::unique_ptr<DualSimulator>
+createFabric(size_t numPods, size_t numRoots) {
+  const size_t numPlanes{4};
+  const size_t numSswsPerPlane{8};
+  const size_t numRswsPerPod{20};
+  auto sim = std::make_unique<DualSimulator>();
+  for (size_t plane = 0; plane < numPlanes; ++plane) {
+    for (size_t i = 0; i < numSswsPerPlane; ++i) {
+      sim->addNode(
+          fmt::format("ssw-{}-{}", plane, i), i == 0 and plane < numRoots);
+    }
+  }
+  for (size_t pod = 0; pod < numPods; ++pod) {
+    for (size_t plane = 0; plane < numPlanes; ++plane) {
+      const auto fsw = fmt::format("fsw-{}-{}", pod, plane);
+      sim->addNode(fsw, false);
+      for (size_t i = 0; i < numSswsPerPlane; ++i) {
+        sim->addLink(fsw, fmt::format("ssw-{}-{}", plane, i), 1);
+      }
+    }
+    for (size_t i = 0; i < numRswsPerPod; ++i) {
+      const auto rsw = fmt::format("rsw-{}-{}", pod, i);
+      sim->addNode(rsw, false);
+      for (size_t plane = 0; plane < numPlanes; ++plane) {
+        sim->addLink(rsw, fmt::format("fsw-{}-{}", pod, plane), 1);
+      }
+    }
+  }
+  return sim;
+}
+
+/*
+ * WAN-like topology: a ring for connectivity plus random chords up to
+ * avgDegree, with link costs from 1 to 10. Flood roots are spread evenly over
+ * the ring.
+ */
+std::unique_ptr<DualSimulator>
+createWan(size_t numNodes, size_t avgDegree, size_t numRoots) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<size_t> nodeDist(0, numNodes - 1);
+  std::uniform_int_distribution<int64_t> costDist(1, 10);
+  auto sim = std::make_unique<DualSimulator>();
+  auto name = [](size_t i) { return fmt::format("node-{}", i); };
+  const size_t rootSpacing = std::max<size_t>(numNodes / numRoots, 1);
+  for (size_t i = 0; i < numNodes; ++i) {
+    sim->addNode(name(i), i % rootSpacing == 0 and i / rootSpacing < numRoots);
+  }
+  for (size_t i = 0; i < numNodes; ++i) {
+    sim->addLink(name(i), name((i + 1) % numNodes), costDist(gen));
+  }
+  const size_t numChords = numNodes * (std::max<size_t>(avgDegree, 2) - 2) / 2;
+  for (size_t i = 0; i < numChords; ++i) {
+    const auto node1 = nodeDist(gen);
+    const auto node2 = nodeDist(gen);
+    if (node1 != node2) {
+      sim->addLink(name(node1), name(node2), costDist(gen));
+    }
+  }
+  return sim;
+}
+
+void
+reportStats(
+    folly::UserCounters& counters,
+    const std::string& event,
+    const DualSimulator::Stats& stats) {
+  counters[event + "_rounds"] = stats.rounds;
+  counters[event + "_msgs"] = stats.messages;
+  counters[event + "_pkts"] = stats.packets;
+}
+
+/*
+ * Brings all links up, then fails the nexthop link of the last node towards
+ * the active flood root and finally the active flood root itself, running
+ * DUAL to convergence after each event. Flooding is sampled from a few
+ * origins before the failures.
+ */
+void
+runSimulation(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    const std::function<std::unique_ptr<DualSimulator>()>& createSim) {
+  auto suspender = folly::BenchmarkSuspender();
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto sim = createSim();
+    const auto numNodes = sim->getNodes().size();
+
+    suspender.dismiss();
+    const auto startTime = std::chrono::steady_clock::now();
+    sim->allLinksUp();
+    const auto initialStats = sim->run();
+    const auto initialTime = std::chrono::steady_clock::now() - startTime;
+    suspender.rehire();
+
+    // flood redundancy versus flooding over all links
+    size_t sptTransmissions{0};
+    size_t fullTransmissions{0};
+    size_t sptReached{0};
+    size_t numOrigins{0};
+    const auto step = std::max<size_t>(numNodes / kNumFloodOrigins, 1);
+    size_t index{0};
+    for (const auto& [nodeId, _] : sim->getNodes()) {
+      if (index++ % step) {
+        continue;
+      }
+      const auto sptFlood = sim->flood(nodeId, true);
+      const auto fullFlood = sim->flood(nodeId, false);
+      sptTransmissions += sptFlood.transmissions;
+      sptReached += sptFlood.reached;
+      fullTransmissions += fullFlood.transmissions;
+      ++numOrigins;
+    }
+
+    // link failure on the SPT
+    const auto& lastNode = *sim->getNodes().rbegin()->second;
+    const auto rootId = lastNode.getSptRootId();
+    CHECK(rootId.has_value()) << "no flood root reachable";
+    const auto nexthop = lastNode.getInfo(*rootId)->nexthop;
+    CHECK(nexthop.has_value());
+    const auto lastNodeId = lastNode.nodeId;
+    suspender.dismiss();
+    sim->linkDown(lastNodeId, *nexthop);
+    const auto linkStats = sim->run();
+
+    // failure of the flood root in use
+    sim->nodeDown(*rootId);
+    const auto rootStats = sim->run();
+    suspender.rehire();
+
+    counters["num_nodes"] = numNodes;
+    counters["initial_us"] =
+        std::chrono::duration_cast<std::chrono::microseconds>(initialTime)
+            .count();
+    reportStats(counters, "initial", initialStats);
+    reportStats(counters, "link_failure", linkStats);
+    reportStats(counters, "root_failure", rootStats);
+    counters["flood_spt_msgs"] = sptTransmissions / numOrigins;
+    counters["flood_full_msgs"] = fullTransmissions / numOrigins;
+    // percentage of transmissions saved by flooding over the SPT, and the
+    // share of nodes it reached
+    counters["flood_reduction_pct"] = fullTransmissions
+        ? 100 - 100 * sptTransmissions / fullTransmissions
+        : 0;
+    counters["flood_coverage_pct"] = 100 * sptReached / (numOrigins * numNodes);
+  }
+}
+
+} // namespace
+
+/*
+ * BM_DualFabric:
+ * DUAL convergence and flood reduction on a fabric topology
+ */
+void
+BM_DualFabric(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numPods,
+    size_t numRoots) {
+  runSimulation(
+      counters, iters, [&]() { return createFabric(numPods, numRoots); });
+}
+
+/*
+ * BM_DualWan:
+ * DUAL convergence and flood reduction on a WAN-like topology
+ */
+void
+BM_DualWan(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numNodes,
+    size_t avgDegree,
+    size_t numRoots) {
+  runSimulation(counters, iters, [&]() {
+    return createWan(numNodes, avgDegree, numRoots);
+  });
+}
+
+/*
+ * @first integer: number of pods (24 nodes each, plus 32 spines)
+ * @second integer: number of flood roots
+ */
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualFabric, counters, 10_2, 10, 2);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualFabric, counters, 40_2, 40, 2);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualFabric, counters, 40_4, 40, 4);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualFabric, counters, 100_4, 100, 4);
+
+/*
+ * @first integer: number of nodes
+ * @second integer: average node degree
+ * @third integer: number of flood roots
+ */
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualWan, counters, 100_4_2, 100, 4, 2);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualWan, counters, 1000_4_2, 1000, 4, 2);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualWan, counters, 1000_8_4, 1000, 8, 4);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DualWan, counters, 5000_4_4, 5000, 4, 4);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
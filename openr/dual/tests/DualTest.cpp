@@ -15,6 +15,7 @@
 #include <folly/io/async/EventBase.h>
 #include <openr/dual/Dual.h>
 
+#include <set>
 #include <vector>
 
 using namespace openr;
@@ -222,6 +223,45 @@ TEST(Dual, StateMachine) {
   EXPECT_EQ(sm.state, DualState::ACTIVE3);
 }
 
+// Test superseded UPDATEs are dropped while QUERY and REPLY are kept in order
+TEST(DualNode, CoalesceDualMessages) {
+  auto createMsg = [](const std::string& rootId,
+                      int64_t distance,
+                      thrift::DualMessageType type) {
+    thrift::DualMessage msg;
+    msg.dstId_ref() = rootId;
+    msg.distance_ref() = distance;
+    msg.type_ref() = type;
+    return msg;
+  };
+
+  std::vector<thrift::DualMessage> msgs;
+  msgs.emplace_back(createMsg("r1", 1, thrift::DualMessageType::UPDATE));
+  msgs.emplace_back(createMsg("r2", 1, thrift::DualMessageType::UPDATE));
+  msgs.emplace_back(createMsg("r1", 2, thrift::DualMessageType::UPDATE));
+  msgs.emplace_back(createMsg("r2", 2, thrift::DualMessageType::QUERY));
+  msgs.emplace_back(createMsg("r2", 3, thrift::DualMessageType::UPDATE));
+  msgs.emplace_back(createMsg("r1", 3, thrift::DualMessageType::UPDATE));
+  msgs.emplace_back(createMsg("r2", 4, thrift::DualMessageType::REPLY));
+  DualNode::coalesceDualMessages(msgs);
+
+  // r1: only the last UPDATE is kept
+  // r2: UPDATEs are separated by QUERY and REPLY, all are kept
+  std::vector<std::pair<std::string, int64_t>> expected{
+      {"r2", 1}, {"r2", 2}, {"r2", 3}, {"r1", 3}, {"r2", 4}};
+  ASSERT_EQ(expected.size(), msgs.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected.at(i).first, *msgs.at(i).dstId_ref());
+    EXPECT_EQ(expected.at(i).second, *msgs.at(i).distance_ref());
+  }
+  EXPECT_EQ(thrift::DualMessageType::QUERY, *msgs.at(1).type_ref());
+  EXPECT_EQ(thrift::DualMessageType::REPLY, *msgs.at(4).type_ref());
+
+  // nothing to coalesce
+  DualNode::coalesceDualMessages(msgs);
+  EXPECT_EQ(expected.size(), msgs.size());
+}
+
 // Dual Implementation Test Node
 class DualTestNode final : public DualNode {
  public:
@@ -979,6 +1019,43 @@ TEST_P(DualFixture, FullMeshTest) {
   EXPECT_TRUE(multiFailureTest(flap));
 }
 
+/**
+ *  Full-Mesh Topology
+ *  flood-root picked by hash covers all roots, hash 0 is the smallest root
+ */
+TEST_P(DualFixture, SptRootIdByHash) {
+  const auto& param = GetParam();
+  const auto& totalRoots = param.totalRoots;
+
+  int numNodes = 4;
+  for (int i = 0; i < numNodes; ++i) {
+    bool isRoot = i < totalRoots;
+    addNode(folly::sformat("n{}", i), isRoot);
+  }
+  for (int i = 0; i < numNodes; ++i) {
+    for (int j = i + 1; j < numNodes; ++j) {
+      addLink(folly::sformat("n{}", i), folly::sformat("n{}", j), 1);
+    }
+  }
+
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  EXPECT_TRUE(validate());
+
+  for (const auto& [nodeId, node] : nodes) {
+    evb->runInEventBaseThreadAndWait([&, id = nodeId, node = node]() {
+      EXPECT_EQ(node->getSptRootId(), node->getSptRootId(0));
+      std::set<std::string> floodRootIds;
+      for (size_t hash = 0; hash < 16; ++hash) {
+        if (auto rootId = node->getSptRootId(hash)) {
+          floodRootIds.emplace(*rootId);
+        }
+      }
+      EXPECT_EQ(static_cast<size_t>(totalRoots), floodRootIds.size()) << id;
+    });
+  }
+}
+
 /**
  * m X n Grid Topology
  */
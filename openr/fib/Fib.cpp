@@ -6,15 +6,19 @@
  */
 
 #include <fb303/ServiceData.h>
+#include <folly/Conv.h>
 #include <folly/IPAddress.h>
+#include <folly/hash/Hash.h>
 #include <thrift/lib/cpp/protocol/TProtocolTypes.h>
 #include <thrift/lib/cpp/transport/THeader.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 #include <algorithm>
+#include <deque>
 #include <exception>
 
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/PageCollector.h>
 #include <openr/common/Util.h>
 #include <openr/decision/RouteUpdate.h>
 #include <openr/fib/Fib.h>
@@ -23,6 +27,63 @@ namespace fb303 = facebook::fb303;
 
 namespace openr {
 
+namespace {
+
+// prefix of page cursors of MPLS routes, see getRouteDetailDbPage()
+const folly::StringPiece kMplsCursorPrefix{"mpls:"};
+
+const std::string kRouteDigestKey{"fib-route-digest"};
+
+// size class of a route update, latency histograms are kept per class
+const char*
+getRouteUpdateSizeClass(size_t numRoutes) {
+  if (numRoutes <= 10) {
+    return "small";
+  }
+  if (numRoutes <= 1000) {
+    return "medium";
+  }
+  return "large";
+}
+
+int64_t
+getElapsedMs(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
+size_t
+getNumRouteUpdates(const thrift::RouteDatabaseDelta& delta) {
+  return delta.unicastRoutesToUpdate_ref()->size() +
+      delta.unicastRoutesToDelete_ref()->size() +
+      delta.mplsRoutesToUpdate_ref()->size() +
+      delta.mplsRoutesToDelete_ref()->size();
+}
+
+// Hash of route for route digest. Next-hops are sorted, as their order is
+// not stable across restarts
+template <typename Route>
+int64_t
+getRouteHash(Route route) {
+  std::sort(route.nextHops_ref()->begin(), route.nextHops_ref()->end());
+  return static_cast<int64_t>(folly::hash::fnv64(
+      apache::thrift::CompactSerializer::serialize<std::string>(route)));
+}
+
+bool
+isSameNextHops(
+    const std::vector<thrift::NextHopThrift>& nextHops,
+    const std::vector<thrift::NextHopThrift>& otherNextHops) {
+  return nextHops.size() == otherNextHops.size() and
+      std::unordered_set<thrift::NextHopThrift>(
+          nextHops.begin(), nextHops.end()) ==
+      std::unordered_set<thrift::NextHopThrift>(
+          otherNextHops.begin(), otherNextHops.end());
+}
+
+} // namespace
+
 Fib::Fib(
     std::shared_ptr<const Config> config,
     int32_t thriftPort,
@@ -30,7 +91,8 @@ Fib::Fib(
     messaging::RQueue<DecisionRouteUpdate> routeUpdatesQueue,
     messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue,
     messaging::ReplicateQueue<DecisionRouteUpdate>& fibUpdatesQueue,
-    messaging::ReplicateQueue<LogSample>& logSampleQueue)
+    messaging::ReplicateQueue<LogSample>& logSampleQueue,
+    PersistentStore* configStore)
     : myNodeName_(*config->getConfig().node_name_ref()),
       thriftPort_(thriftPort),
       syncRoutesExpBackoff_(
@@ -43,6 +105,37 @@ Fib::Fib(
 
   dryrun_ = tConfig.dryrun_ref().value_or(false);
   enableSegmentRouting_ = tConfig.enable_segment_routing_ref().value_or(false);
+  if (const auto& fibConf = tConfig.fib_programming_config_ref()) {
+    fibChunkSize_ = *fibConf->chunk_size_ref();
+    fibMaxChunksInFlight_ = *fibConf->max_chunks_in_flight_ref();
+    highPriorityPrefixTypes_ = *fibConf->high_priority_prefix_types_ref();
+    highPriorityPrefixTags_ = *fibConf->high_priority_prefix_tags_ref();
+    incrementalSync_ = *fibConf->enable_incremental_sync_ref();
+    compactRouteState_ = *fibConf->enable_compact_route_state_ref();
+    if (auto sloMs = fibConf->route_programming_slo_ms_ref()) {
+      routeProgrammingSlo_ = std::chrono::milliseconds(*sloMs);
+    }
+    shadowTableId_ = fibConf->shadow_table_id_ref().to_optional();
+    if (*fibConf->enable_graceful_restart_ref() and not dryrun_) {
+      configStore_ = configStore;
+    }
+  }
+
+  // Load route digest of previous instance for graceful restart
+  if (configStore_) {
+    auto digest =
+        configStore_->loadThriftObj<thrift::FibRouteDigest>(kRouteDigestKey)
+            .get();
+    if (digest.hasValue()) {
+      LOG(INFO) << fmt::format(
+          "Loaded route digest of {} unicast and {} mpls routes for graceful "
+          "restart",
+          digest->unicastRouteHashes_ref()->size(),
+          digest->mplsRouteHashes_ref()->size());
+      restartRouteDigest_ = std::move(digest.value());
+      routeDigestPersisted_ = true;
+    }
+  }
 
   syncRoutesTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
     if (routeState_.hasRoutesFromDecision) {
@@ -63,6 +156,47 @@ Fib::Fib(
   // On startup we do require routedb_sync so explicitly set the counter to 0
   fb303::fbData->setCounter("fib.synced", 0);
 
+  persistRouteDigestTimer_ =
+      folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+        // Persist routes only if they are all programmed. Rescheduled on next
+        // successful programming otherwise.
+        if (routeState_.dirtyRouteDb or not hasSyncedFib_ or
+            syncRoutesTimer_->isScheduled()) {
+          return;
+        }
+        try {
+          createFibClient(evb_, socket_, client_, thriftPort_);
+          // Routes are synced once more if agent restarted meanwhile
+          const auto aliveSince = client_->sync_aliveSince();
+          if (aliveSince != latestAliveSince_) {
+            persistRouteDigestTimer_->scheduleTimeout(
+                Constants::kFibRouteDigestPersistDelay);
+            return;
+          }
+          thrift::FibRouteDigest digest;
+          digest.agentAliveSince_ref() = aliveSince;
+          for (auto const& route :
+               createUnicastRoutesFromMap(routeState_.unicastRoutes)) {
+            digest.unicastRouteHashes_ref()->emplace(
+                toString(*route.dest_ref()), getRouteHash(route));
+          }
+          if (enableSegmentRouting_) {
+            for (auto const& route : createMplsRoutesWithSelectedNextHopsMap(
+                     routeState_.mplsRoutes)) {
+              digest.mplsRouteHashes_ref()->emplace(
+                  *route.topLabel_ref(), getRouteHash(route));
+            }
+          }
+          configStore_->storeThriftObj(kRouteDigestKey, digest).get();
+          routeDigestPersisted_ = true;
+          VLOG(1) << "Persisted route digest";
+        } catch (const std::exception& e) {
+          client_.reset();
+          LOG(ERROR) << "Failed to persist route digest. Error: "
+                     << folly::exceptionStr(e);
+        }
+      });
+
   if (not tConfig.eor_time_s_ref()) {
     routeState_.hasRoutesFromDecision = true;
     LOG(INFO)
@@ -91,17 +225,31 @@ Fib::Fib(
     keepAliveTimer_->scheduleTimeout(Constants::kKeepAliveCheckInterval);
   }
 
-  // Fiber to process route updates from Decision
+  // Task to process route updates from Decision
+#if FOLLY_HAS_COROUTINES
+  addCoroTask(processDecisionRouteUpdates(std::move(routeUpdatesQueue)));
+#else
   addFiberTask([q = std::move(routeUpdatesQueue), this]() mutable noexcept {
     while (true) {
+      // Read all available route updates before programming next slice of
+      // bulk routes, for high priority route updates to preempt them
+      if (not pendingBulkRoutes_.empty() and q.size() == 0) {
+        updateRoutesSemaphore_.wait();
+        programBulkRouteSlice();
+        updateRoutesSemaphore_.signal();
+        continue;
+      }
       auto maybeThriftObj = q.get(); // perform read
       if (maybeThriftObj.hasError()) {
         VLOG(1) << "Terminating route delta processing fiber";
         break;
       }
-      processRouteUpdates(std::move(maybeThriftObj).value());
+      updateRoutesSemaphore_.wait();
+      handleRouteUpdate(std::move(maybeThriftObj).value());
+      updateRoutesSemaphore_.signal();
     }
   });
+#endif
 
   syncStaticRoutesTimer_ =
       folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
@@ -131,10 +279,13 @@ Fib::Fib(
         }
       });
 
-  // Fiber to process and program static route updates.
+  // Task to process and program static route updates.
   // - The routes are only programmed and updated but not deleted
   // - Updates arriving before first Decision RIB update will be processed. The
-  //   fiber will terminate after that.
+  //   task will terminate after that.
+#if FOLLY_HAS_COROUTINES
+  addCoroTask(processStaticRouteUpdates(std::move(staticRouteUpdatesQueue)));
+#else
   addFiberTask([q = std::move(staticRouteUpdatesQueue),
                 this]() mutable noexcept {
     LOG(INFO) << "Starting static routes update processing fiber";
@@ -147,32 +298,40 @@ Fib::Fib(
         break;
       }
 
-      // NOTE: We only process the static MPLS routes to add or update
-      LOG(INFO) << "Received static routes update";
-      maybeThriftPub->unicastRoutesToUpdate.clear();
-      maybeThriftPub->unicastRoutesToDelete.clear();
-      maybeThriftPub->mplsRoutesToDelete.clear();
-
-      // Backup static MPLS routes. In case of update Routes failed, later
-      // scheduled syncStaticRoutesTimer_ will retry programming the routes.
-      routeState_.hasStaticMplsRoutes = true;
-      backupRouteState(maybeThriftPub.value());
-
-      // Program received static route updates
-      if (not updateRoutes(
-              std::move(maybeThriftPub).value(), true /* static routes */)) {
-        // If failed, trigger syncStaticRoutesTimer_ to retry programming of
-        // static MPLS routes.
-        syncStaticRoutesTimer_->scheduleTimeout(Constants::kFibInitialBackoff);
-      }
+      updateRoutesSemaphore_.wait();
+      processStaticRouteUpdate(std::move(maybeThriftPub).value());
+      updateRoutesSemaphore_.signal();
     }
   });
+#endif
 
   // Initialize stats keys
   fb303::fbData->addStatExportType("fib.convergence_time_ms", fb303::AVG);
   fb303::fbData->addStatExportType(
       "fib.local_route_program_time_ms", fb303::AVG);
   fb303::fbData->addStatExportType("fib.num_of_route_updates", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "fib.route_programming.num_chunks", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "fib.route_programming.high_priority_time_ms", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "fib.route_sync.incremental.num_route_updates", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "fib.route_sync.incremental.failure", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "fib.route_sync.graceful_restart.num_route_updates", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "fib.route_sync.graceful_restart.failure", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "fib.num_of_high_priority_route_updates", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "fib.route_programming.num_chunk_retries", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "fib.route_programming.failure.chunk", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "fib.bulk_route_updates.preempted", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "fib.bulk_route_updates.slices", fb303::COUNT);
   fb303::fbData->addStatExportType("fib.process_route_db", fb303::COUNT);
   fb303::fbData->addStatExportType("fib.sync_fib_calls", fb303::COUNT);
   fb303::fbData->addStatExportType(
@@ -182,6 +341,25 @@ Fib::Fib(
   fb303::fbData->addStatExportType("fib.thrift.failure.sync_fib", fb303::COUNT);
   fb303::fbData->addStatExportType("fib.route_programming.time_ms", fb303::AVG);
   fb303::fbData->addStatExportType("fib.route_sync.time_ms", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "fib.route_programming.slo_exceeded_routes", fb303::SUM);
+
+  // Latency histograms of route programming, time in queue from Decision
+  // and acknowledgement of chunks by the FIB agent
+  std::vector<std::string> histograms{
+      "fib.route_programming.queue_time_ms",
+      "fib.route_programming.chunk_ack_time_ms",
+      "fib.route_programming.unicast_time_ms",
+      "fib.route_programming.mpls_time_ms"};
+  for (auto const sizeClass : {"small", "medium", "large"}) {
+    histograms.emplace_back(
+        fmt::format("fib.route_programming.time_ms.{}", sizeClass));
+    histograms.emplace_back(fmt::format("fib.shadow.time_ms.{}", sizeClass));
+  }
+  for (auto const& histogram : histograms) {
+    fb303::fbData->addHistogram(histogram, 10, 0, 5000);
+    fb303::fbData->exportHistogramPercentile(histogram, 50, 95, 99);
+  }
 }
 
 void
@@ -193,25 +371,66 @@ Fib::stop() {
 std::optional<folly::CIDRNetwork>
 Fib::longestPrefixMatch(
     const folly::CIDRNetwork& inputPrefix,
-    const std::unordered_map<folly::CIDRNetwork, RibUnicastEntry>&
-        unicastRoutes) {
-  std::optional<folly::CIDRNetwork> matchedPrefix;
-  int maxMask = -1;
-  const auto& inputIP = inputPrefix.first;
-  const auto& inputMask = inputPrefix.second;
-
-  // longest prefix matching
+    const PrefixTrie<folly::Unit>& unicastRouteTrie) {
+  const auto match = unicastRouteTrie.longestPrefixMatch(inputPrefix);
+  if (not match) {
+    return std::nullopt;
+  }
+  return match->first;
+}
+
+thrift::RouteDatabaseDelta
+Fib::getRouteDbDiff(
+    const std::vector<thrift::UnicastRoute>& unicastRoutes,
+    const std::vector<thrift::MplsRoute>& mplsRoutes,
+    const std::vector<thrift::UnicastRoute>& agentUnicastRoutes,
+    const std::vector<thrift::MplsRoute>& agentMplsRoutes) {
+  thrift::RouteDatabaseDelta delta;
+
+  // unicast routes, leaving the ones of agent only to delete
+  std::unordered_map<folly::CIDRNetwork, const thrift::UnicastRoute*>
+      agentUnicastRouteMap;
+  for (const auto& route : agentUnicastRoutes) {
+    agentUnicastRouteMap.emplace(toIPNetwork(*route.dest_ref()), &route);
+  }
   for (const auto& route : unicastRoutes) {
-    const auto& dbIP = route.first.first;
-    const auto& dbMask = route.first.second;
+    auto it = agentUnicastRouteMap.find(toIPNetwork(*route.dest_ref()));
+    if (it == agentUnicastRouteMap.end() or
+        route.adminDistance_ref().to_optional() !=
+            it->second->adminDistance_ref().to_optional() or
+        not isSameNextHops(
+            *route.nextHops_ref(), *it->second->nextHops_ref())) {
+      delta.unicastRoutesToUpdate_ref()->emplace_back(route);
+    }
+    if (it != agentUnicastRouteMap.end()) {
+      agentUnicastRouteMap.erase(it);
+    }
+  }
+  for (const auto& [_, route] : agentUnicastRouteMap) {
+    delta.unicastRoutesToDelete_ref()->emplace_back(*route->dest_ref());
+  }
 
-    if (maxMask < dbMask && inputMask >= dbMask &&
-        inputIP.mask(dbMask) == dbIP) {
-      maxMask = dbMask;
-      matchedPrefix = route.first;
+  // mpls routes, leaving the ones of agent only to delete
+  std::unordered_map<int32_t, const thrift::MplsRoute*> agentMplsRouteMap;
+  for (const auto& route : agentMplsRoutes) {
+    agentMplsRouteMap.emplace(*route.topLabel_ref(), &route);
+  }
+  for (const auto& route : mplsRoutes) {
+    auto it = agentMplsRouteMap.find(*route.topLabel_ref());
+    if (it == agentMplsRouteMap.end() or
+        not isSameNextHops(
+            *route.nextHops_ref(), *it->second->nextHops_ref())) {
+      delta.mplsRoutesToUpdate_ref()->emplace_back(route);
     }
+    if (it != agentMplsRouteMap.end()) {
+      agentMplsRouteMap.erase(it);
+    }
+  }
+  for (const auto& [label, _] : agentMplsRouteMap) {
+    delta.mplsRoutesToDelete_ref()->emplace_back(label);
   }
-  return matchedPrefix;
+
+  return delta;
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
@@ -221,6 +440,8 @@ Fib::getRouteDb() {
   runInEventBaseThread([p = std::move(p), this]() mutable {
     thrift::RouteDatabase routeDb;
     *routeDb.thisNodeName_ref() = myNodeName_;
+    routeDb.unicastRoutes_ref()->reserve(routeState_.unicastRoutes.size());
+    routeDb.mplsRoutes_ref()->reserve(routeState_.mplsRoutes.size());
     for (const auto& route : routeState_.unicastRoutes) {
       routeDb.unicastRoutes_ref()->emplace_back(route.second.toThrift());
     }
@@ -239,6 +460,9 @@ Fib::getRouteDetailDb() {
   runInEventBaseThread([p = std::move(p), this]() mutable {
     thrift::RouteDatabaseDetail routeDetailDb;
     *routeDetailDb.thisNodeName_ref() = myNodeName_;
+    routeDetailDb.unicastRoutes_ref()->reserve(
+        routeState_.unicastRoutes.size());
+    routeDetailDb.mplsRoutes_ref()->reserve(routeState_.mplsRoutes.size());
     for (const auto& route : routeState_.unicastRoutes) {
       routeDetailDb.unicastRoutes_ref()->emplace_back(
           route.second.toThriftDetail());
@@ -253,6 +477,75 @@ Fib::getRouteDetailDb() {
   return sf;
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetailPage>>
+Fib::getRouteDetailDbPage(thrift::PageParams page) {
+  folly::Promise<std::unique_ptr<thrift::RouteDatabaseDetailPage>> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([p = std::move(p), page, this]() mutable {
+    try {
+      const auto limit = getPageLimit(page);
+      // cursor of MPLS routes is the label with `kMplsCursorPrefix`,
+      // otherwise a prefix
+      std::optional<folly::CIDRNetwork> unicastCursor;
+      std::optional<uint32_t> mplsCursor;
+      if (page.cursor_ref().has_value()) {
+        folly::StringPiece cursor(*page.cursor_ref());
+        if (cursor.removePrefix(kMplsCursorPrefix)) {
+          auto label = folly::tryTo<uint32_t>(cursor);
+          if (label.hasError()) {
+            throw thrift::OpenrError(
+                fmt::format("Invalid page cursor {}", *page.cursor_ref()));
+          }
+          mplsCursor = label.value();
+        } else {
+          unicastCursor = getPrefixFromPageCursor(*page.cursor_ref());
+        }
+      }
+
+      thrift::RouteDatabaseDetailPage thriftPage;
+      auto& routeDetailDb = *thriftPage.routeDb_ref();
+      *routeDetailDb.thisNodeName_ref() = myNodeName_;
+
+      if (not mplsCursor.has_value()) {
+        PageCollector<folly::CIDRNetwork, RibUnicastEntry const*> unicastPage(
+            unicastCursor, limit);
+        for (auto const& [prefix, entry] : routeState_.unicastRoutes) {
+          unicastPage.add(prefix, &entry);
+        }
+        if (auto nextCursor = unicastPage.getNextCursor()) {
+          thriftPage.nextCursor_ref() = toPageCursor(*nextCursor);
+        }
+        for (auto const& [_, entry] : unicastPage.release()) {
+          routeDetailDb.unicastRoutes_ref()->emplace_back(
+              entry->toThriftDetail());
+        }
+      }
+
+      // fill the rest of the page with MPLS routes
+      const auto numUnicastRoutes = routeDetailDb.unicastRoutes_ref()->size();
+      if (numUnicastRoutes < limit) {
+        PageCollector<uint32_t, RibMplsEntry const*> mplsPage(
+            mplsCursor, limit - numUnicastRoutes);
+        for (auto const& [label, entry] : routeState_.mplsRoutes) {
+          mplsPage.add(label, &entry);
+        }
+        if (auto nextCursor = mplsPage.getNextCursor()) {
+          thriftPage.nextCursor_ref() =
+              fmt::format("{}{}", kMplsCursorPrefix, *nextCursor);
+        }
+        for (auto const& [_, entry] : mplsPage.release()) {
+          routeDetailDb.mplsRoutes_ref()->emplace_back(entry->toThriftDetail());
+        }
+      }
+      p.setValue(std::make_unique<thrift::RouteDatabaseDetailPage>(
+          std::move(thriftPage)));
+    } catch (thrift::OpenrError const& e) {
+      p.setException(e);
+    }
+  });
+  return sf;
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
 Fib::getUnicastRoutes(std::vector<std::string> prefixes) {
   folly::Promise<std::unique_ptr<std::vector<thrift::UnicastRoute>>> p;
@@ -296,6 +589,7 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
 
   // if the params is empty, return all routes
   if (prefixes.empty()) {
+    retRouteVec.reserve(routeState_.unicastRoutes.size());
     for (const auto& routes : routeState_.unicastRoutes) {
       retRouteVec.emplace_back(routes.second.toThrift());
     }
@@ -315,7 +609,7 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
 
     // do longest prefix match, add the matched prefix to the result set
     const auto& matchedPrefix =
-        Fib::longestPrefixMatch(inputPrefix, routeState_.unicastRoutes);
+        Fib::longestPrefixMatch(inputPrefix, routeState_.unicastRouteTrie);
     if (matchedPrefix.has_value()) {
       matchPrefixSet.insert(matchedPrefix.value());
     }
@@ -336,6 +630,7 @@ Fib::getMplsRoutesFiltered(std::vector<int32_t> labels) {
 
   // if the params is empty, return all MPLS routes
   if (labels.empty()) {
+    retRouteVec.reserve(routeState_.mplsRoutes.size());
     for (const auto& routes : routeState_.mplsRoutes) {
       retRouteVec.emplace_back(routes.second.toThrift());
     }
@@ -348,10 +643,11 @@ Fib::getMplsRoutesFiltered(std::vector<int32_t> labels) {
     labelFilterSet.insert(label);
   }
 
-  // get the filtered MPLS routes and avoid duplicates
-  for (const auto& routes : routeState_.mplsRoutes) {
-    if (labelFilterSet.find(routes.first) != labelFilterSet.end()) {
-      retRouteVec.emplace_back(routes.second.toThrift());
+  // look up the filtered MPLS routes, duplicates are removed by the set
+  for (const auto label : labelFilterSet) {
+    auto it = routeState_.mplsRoutes.find(label);
+    if (it != routeState_.mplsRoutes.end()) {
+      retRouteVec.emplace_back(it->second.toThrift());
     }
   }
 
@@ -368,35 +664,115 @@ Fib::backupRouteState(const DecisionRouteUpdate& routeUpdate) {
   // Add/Update unicast routes to update
   for (const auto& [prefix, route] : routeUpdate.unicastRoutesToUpdate) {
     auto it = routeState_.unicastRoutes.find(prefix);
-    if (it != routeState_.unicastRoutes.end()) {
-      it->second = route;
+    if (it == routeState_.unicastRoutes.end()) {
+      it = routeState_.unicastRoutes.emplace(prefix, RibUnicastEntry(prefix))
+               .first;
+      routeState_.unicastRouteTrie.insert(prefix, folly::unit);
+    }
+    if (compactRouteState_) {
+      // next-hop groups are shared with Decision, best prefix entry is not
+      RibUnicastEntry compactRoute(prefix, route.nexthops);
+      compactRoute.doNotInstall = route.doNotInstall;
+      compactRoute.backupNexthops = route.backupNexthops;
+      it->second = std::move(compactRoute);
     } else {
-      routeState_.unicastRoutes.emplace(prefix, route);
+      it->second = route;
     }
   }
 
   // Add mpls routes to update
   for (const auto& route : routeUpdate.mplsRoutesToUpdate) {
-    auto it = routeState_.mplsRoutes.find(route.label);
-    if (it != routeState_.mplsRoutes.end()) {
-      it->second = route;
-    } else {
-      routeState_.mplsRoutes.emplace(route.label, route);
-    }
+    routeState_.mplsRoutes.insert_or_assign(route.label, route);
   }
 
   // Delete unicast routes
   for (const auto& dest : routeUpdate.unicastRoutesToDelete) {
     routeState_.unicastRoutes.erase(dest);
+    routeState_.unicastRouteTrie.erase(dest);
   }
 
   // Delete mpls routes
   for (const auto& topLabel : routeUpdate.mplsRoutesToDelete) {
     routeState_.mplsRoutes.erase(topLabel);
   }
+
+  if (not routeUpdate.empty()) {
+    ++routeStateVersion_;
+  }
 }
 
 // Process new route updates received from Decision module.
+#if FOLLY_HAS_COROUTINES
+folly::coro::Task<void>
+Fib::processDecisionRouteUpdates(
+    messaging::RQueue<DecisionRouteUpdate> routeUpdatesQueue) {
+  while (true) {
+    // Read all available route updates before programming next slice of
+    // bulk routes, for high priority route updates to preempt them
+    if (not pendingBulkRoutes_.empty() and routeUpdatesQueue.size() == 0) {
+      co_await updateRoutesSemaphore_.co_wait();
+      SCOPE_EXIT {
+        updateRoutesSemaphore_.signal();
+      };
+      programBulkRouteSlice();
+      continue;
+    }
+    auto maybeThriftObj = co_await routeUpdatesQueue.getCoro();
+    if (maybeThriftObj.hasError()) {
+      VLOG(1) << "Terminating route delta processing task";
+      break;
+    }
+    co_await updateRoutesSemaphore_.co_wait();
+    SCOPE_EXIT {
+      updateRoutesSemaphore_.signal();
+    };
+    handleRouteUpdate(std::move(maybeThriftObj).value());
+  }
+}
+
+folly::coro::Task<void>
+Fib::processStaticRouteUpdates(
+    messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue) {
+  LOG(INFO) << "Starting static routes update processing task";
+  while (true) {
+    auto maybeThriftPub = co_await staticRouteUpdatesQueue.getCoro();
+
+    // Terminate if queue is closed or we've received RIB from Decision
+    if (maybeThriftPub.hasError() or routeState_.hasRoutesFromDecision) {
+      LOG(INFO) << "Terminating static routes update processing task";
+      break;
+    }
+
+    co_await updateRoutesSemaphore_.co_wait();
+    SCOPE_EXIT {
+      updateRoutesSemaphore_.signal();
+    };
+    processStaticRouteUpdate(std::move(maybeThriftPub).value());
+  }
+}
+#endif
+
+void
+Fib::processStaticRouteUpdate(DecisionRouteUpdate&& routeUpdate) {
+  // NOTE: We only process the static MPLS routes to add or update
+  LOG(INFO) << "Received static routes update";
+  routeUpdate.unicastRoutesToUpdate.clear();
+  routeUpdate.unicastRoutesToDelete.clear();
+  routeUpdate.mplsRoutesToDelete.clear();
+
+  // Backup static MPLS routes. In case of update Routes failed, later
+  // scheduled syncStaticRoutesTimer_ will retry programming the routes.
+  routeState_.hasStaticMplsRoutes = true;
+  backupRouteState(routeUpdate);
+
+  // Program received static route updates
+  if (not programRoutes(std::move(routeUpdate), true /* static routes */)) {
+    // If failed, trigger syncStaticRoutesTimer_ to retry programming of
+    // static MPLS routes.
+    syncStaticRoutesTimer_->scheduleTimeout(Constants::kFibInitialBackoff);
+  }
+}
+
 void
 Fib::processRouteUpdates(DecisionRouteUpdate&& routeUpdate) {
   routeState_.hasRoutesFromDecision = true;
@@ -406,6 +782,20 @@ Fib::processRouteUpdates(DecisionRouteUpdate&& routeUpdate) {
   if (routeUpdate.perfEvents.has_value()) {
     addPerfEvent(
         routeUpdate.perfEvents.value(), myNodeName_, "FIB_ROUTE_DB_RECVD");
+    // time since Decision sent the update
+    auto const& events = *routeUpdate.perfEvents->events_ref();
+    if (events.size() > 1) {
+      fb303::fbData->addHistogramValue(
+          "fib.route_programming.queue_time_ms",
+          std::max<int64_t>(
+              0,
+              *events.back().unixTs_ref() -
+                  *events.at(events.size() - 2).unixTs_ref()));
+    }
+    endPerfSpan(
+        routeUpdate.perfEvents.value(),
+        myNodeName_,
+        Constants::kPerfSpanRouteUpdatesQueue);
   }
 
   // Before anything, get rid of doNotInstall routes
@@ -427,12 +817,174 @@ Fib::processRouteUpdates(DecisionRouteUpdate&& routeUpdate) {
   // Add some counters
   fb303::fbData->addStatValue("fib.process_route_db", 1, fb303::COUNT);
 
-  if (updateRoutes(std::move(routeUpdate), false /* static routes */)) {
+  // Shadow table is programmed after forwarding routes, keep its delta
+  std::vector<thrift::UnicastRoute> shadowRoutesToUpdate;
+  std::vector<thrift::IpPrefix> shadowRoutesToDelete;
+  if (shadowTableId_ and not shadowTableDirty_) {
+    for (auto const& [_, route] : routeUpdate.unicastRoutesToUpdate) {
+      shadowRoutesToUpdate.emplace_back(route.toThrift());
+    }
+    for (auto const& prefix : routeUpdate.unicastRoutesToDelete) {
+      shadowRoutesToDelete.emplace_back(toIpPrefix(prefix));
+    }
+  }
+
+  if (programRoutes(std::move(routeUpdate), false /* static routes */)) {
     routeState_.dirtyRouteDb = false;
   } else {
     routeState_.dirtyRouteDb = true;
     syncRouteDbDebounced(); // Schedule future full sync of route DB
   }
+
+  if (shadowTableId_) {
+    programShadowRoutes(shadowRoutesToUpdate, shadowRoutesToDelete);
+  }
+}
+
+template <typename Route>
+void
+Fib::programShadowChunks(
+    const std::vector<Route>& routes,
+    folly::Function<folly::SemiFuture<folly::Unit>(std::vector<Route>&&)>
+        programChunk) {
+  const auto chunkSize = fibChunkSize_ ? fibChunkSize_ : routes.size();
+  std::deque<folly::SemiFuture<folly::Unit>> inFlight;
+  // throws if the chunk failed, see programRoutesInChunks() for evb_
+  auto waitFrontChunk = [&]() {
+    std::move(inFlight.front()).via(&evb_).getVia(&evb_);
+    inFlight.pop_front();
+  };
+  for (size_t start = 0; start < routes.size(); start += chunkSize) {
+    if (inFlight.size() >= fibMaxChunksInFlight_) {
+      waitFrontChunk();
+    }
+    const auto end = std::min(start + chunkSize, routes.size());
+    inFlight.emplace_back(programChunk(
+        std::vector<Route>(routes.begin() + start, routes.begin() + end)));
+  }
+  while (not inFlight.empty()) {
+    waitFrontChunk();
+  }
+}
+
+void
+Fib::programShadowRoutes(
+    const std::vector<thrift::UnicastRoute>& routesToUpdate,
+    const std::vector<thrift::IpPrefix>& routesToDelete) {
+  const auto table = *shadowTableId_;
+  if (not shadowTableDirty_ and routesToUpdate.empty() and
+      routesToDelete.empty()) {
+    return;
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  size_t numRoutes{0};
+  try {
+    createFibClient(evb_, shadowSocket_, shadowClient_, thriftPort_);
+    if (shadowTableDirty_) {
+      auto routes = createUnicastRoutesFromMap(routeState_.unicastRoutes);
+      numRoutes = routes.size();
+      LOG(INFO) << fmt::format(
+          "Syncing {} routes in shadow table {}", numRoutes, table);
+      shadowClient_->sync_syncFibTables(kFibId_, {{table, std::move(routes)}});
+      shadowTableDirty_ = false;
+      fb303::fbData->addStatValue("fib.shadow.num_syncs", 1, fb303::SUM);
+    } else {
+      numRoutes = routesToUpdate.size() + routesToDelete.size();
+      programShadowChunks<thrift::IpPrefix>(
+          routesToDelete, [&](std::vector<thrift::IpPrefix>&& chunk) {
+            return shadowClient_->semifuture_deleteUnicastRoutesInTables(
+                kFibId_, {{table, std::move(chunk)}});
+          });
+      programShadowChunks<thrift::UnicastRoute>(
+          routesToUpdate, [&](std::vector<thrift::UnicastRoute>&& chunk) {
+            return shadowClient_->semifuture_addUnicastRoutesInTables(
+                kFibId_, {{table, std::move(chunk)}});
+          });
+    }
+  } catch (const std::exception& e) {
+    shadowClient_.reset();
+    shadowTableDirty_ = true;
+    fb303::fbData->addStatValue("fib.shadow.failures", 1, fb303::COUNT);
+    LOG(ERROR) << "Failed to program routes in shadow table " << table
+               << ". Error: " << folly::exceptionStr(e);
+    return;
+  }
+
+  const auto elapsedMs = getElapsedMs(startTime);
+  VLOG(1) << fmt::format(
+      "It took {} ms to update {} routes in shadow table {}",
+      elapsedMs,
+      numRoutes,
+      table);
+  fb303::fbData->addStatValue("fib.shadow.num_routes", numRoutes, fb303::SUM);
+  fb303::fbData->addStatValue("fib.shadow.time_ms", elapsedMs, fb303::AVG);
+  fb303::fbData->addHistogramValue(
+      fmt::format("fib.shadow.time_ms.{}", getRouteUpdateSizeClass(numRoutes)),
+      elapsedMs);
+}
+
+void
+Fib::handleRouteUpdate(DecisionRouteUpdate&& routeUpdate) {
+  switch (routeUpdate.priority) {
+  case DecisionRouteUpdate::BULK:
+    // empty updates still signal routes received from Decision
+    if (not routeUpdate.empty()) {
+      pendingBulkRoutes_.merge(std::move(routeUpdate));
+      return;
+    }
+    break;
+  case DecisionRouteUpdate::HIGH:
+    if (not pendingBulkRoutes_.empty()) {
+      pendingBulkRoutes_.eraseRoutesOf(routeUpdate);
+      fb303::fbData->addStatValue(
+          "fib.bulk_route_updates.preempted", 1, fb303::COUNT);
+    }
+    break;
+  case DecisionRouteUpdate::NONE:
+    // not assigned to a lane, keep order of updates
+    while (not pendingBulkRoutes_.empty()) {
+      programBulkRouteSlice();
+    }
+    break;
+  }
+  processRouteUpdates(std::move(routeUpdate));
+}
+
+void
+Fib::programBulkRouteSlice() {
+  const size_t sliceSize = fibChunkSize_
+      ? fibChunkSize_ * fibMaxChunksInFlight_
+      : pendingBulkRoutes_.size();
+  if (pendingBulkRoutes_.size() <= sliceSize) {
+    processRouteUpdates(
+        std::exchange(pendingBulkRoutes_, DecisionRouteUpdate{}));
+    return;
+  }
+
+  DecisionRouteUpdate slice;
+  slice.type = pendingBulkRoutes_.type;
+  slice.priority = DecisionRouteUpdate::BULK;
+  slice.perfEvents = std::exchange(pendingBulkRoutes_.perfEvents, std::nullopt);
+  auto moveRoutes = [&](auto& from, auto& to) {
+    while (not from.empty() and slice.size() < sliceSize) {
+      to.emplace_back(std::move(from.back()));
+      from.pop_back();
+    }
+  };
+  // withdrawals first
+  moveRoutes(
+      pendingBulkRoutes_.unicastRoutesToDelete, slice.unicastRoutesToDelete);
+  moveRoutes(pendingBulkRoutes_.mplsRoutesToDelete, slice.mplsRoutesToDelete);
+  auto& unicastRoutes = pendingBulkRoutes_.unicastRoutesToUpdate;
+  for (auto it = unicastRoutes.begin();
+       it != unicastRoutes.end() and slice.size() < sliceSize;) {
+    slice.unicastRoutesToUpdate.emplace(it->first, std::move(it->second));
+    it = unicastRoutes.erase(it);
+  }
+  moveRoutes(pendingBulkRoutes_.mplsRoutesToUpdate, slice.mplsRoutesToUpdate);
+  fb303::fbData->addStatValue("fib.bulk_route_updates.slices", 1, fb303::COUNT);
+  processRouteUpdates(std::move(slice));
 }
 
 thrift::PerfDatabase
@@ -477,13 +1029,129 @@ Fib::printMplsRoutesAddUpdate(
   }
 }
 
+bool
+Fib::isHighPriorityRoute(const RibUnicastEntry& route) const {
+  const auto& prefixEntry = route.bestPrefixEntry;
+  if (highPriorityPrefixTypes_.count(*prefixEntry.type_ref())) {
+    return true;
+  }
+  for (const auto& tag : *prefixEntry.tags_ref()) {
+    if (highPriorityPrefixTags_.count(tag)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Route>
+bool
+Fib::programRoutesInChunks(
+    const std::vector<Route>& routes,
+    folly::Function<folly::SemiFuture<folly::Unit>(const std::vector<Route>&)>
+        programChunk) {
+  auto getChunk = [&](size_t start) {
+    auto const end = std::min(start + fibChunkSize_, routes.size());
+    return std::vector<Route>(routes.begin() + start, routes.begin() + end);
+  };
+
+  // Responses are only read while evb_ runs, so wait for a chunk by driving
+  // evb_ until it is done. This reads the responses of all chunks in flight.
+  auto waitChunk = [this](folly::SemiFuture<folly::Unit>&& future) {
+    auto result = std::move(future).via(&evb_).getTryVia(&evb_);
+    if (result.hasException()) {
+      LOG(ERROR) << "Failed to program chunk of routes in FIB. Error: "
+                 << folly::exceptionStr(result.exception());
+    }
+    return result.hasValue();
+  };
+
+  auto getChunkSize = [&](size_t start) {
+    return std::min(fibChunkSize_, routes.size() - start);
+  };
+
+  // Pipeline chunks. Each is sent as soon as a slot is free without waiting
+  // for the agent to program the ones before it.
+  struct InFlightChunk {
+    size_t start;
+    std::chrono::steady_clock::time_point sendTime;
+    folly::SemiFuture<folly::Unit> future;
+  };
+  std::vector<size_t> failedChunks;
+  std::deque<InFlightChunk> inFlight;
+  auto waitFrontChunk = [&]() {
+    auto& chunk = inFlight.front();
+    if (waitChunk(std::move(chunk.future))) {
+      fb303::fbData->addHistogramValue(
+          "fib.route_programming.chunk_ack_time_ms",
+          getElapsedMs(chunk.sendTime));
+      checkRouteProgrammingSlo(getChunkSize(chunk.start));
+    } else {
+      failedChunks.emplace_back(chunk.start);
+    }
+    inFlight.pop_front();
+  };
+  size_t numChunks{0};
+  for (size_t start = 0; start < routes.size(); start += fibChunkSize_) {
+    if (inFlight.size() >= fibMaxChunksInFlight_) {
+      waitFrontChunk();
+    }
+    const auto sendTime = std::chrono::steady_clock::now();
+    inFlight.push_back(InFlightChunk{
+        start, sendTime, folly::makeSemiFutureWith([&]() {
+          return programChunk(getChunk(start));
+        })});
+    ++numChunks;
+  }
+  while (not inFlight.empty()) {
+    waitFrontChunk();
+  }
+  fb303::fbData->addStatValue(
+      "fib.route_programming.num_chunks", numChunks, fb303::SUM);
+
+  // Retry failed chunks one at a time. Routes of other chunks are programmed
+  // already and don't need to be sent again.
+  for (auto const start : failedChunks) {
+    bool programmed{false};
+    for (int32_t retry = 0;
+         retry < Constants::kFibChunkMaxRetries and not programmed;
+         ++retry) {
+      fb303::fbData->addStatValue(
+          "fib.route_programming.num_chunk_retries", 1, fb303::SUM);
+      programmed = waitChunk(folly::makeSemiFutureWith([&]() {
+        // Connection may have broken along with the chunk
+        createFibClient(evb_, socket_, client_, thriftPort_);
+        return programChunk(getChunk(start));
+      }));
+    }
+    if (not programmed) {
+      fb303::fbData->addStatValue(
+          "fib.route_programming.failure.chunk", 1, fb303::COUNT);
+      return false;
+    }
+    checkRouteProgrammingSlo(getChunkSize(start));
+  }
+  return true;
+}
+
+void
+Fib::checkRouteProgrammingSlo(size_t numRoutes) {
+  if (routeSloDeadline_.has_value() and
+      std::chrono::steady_clock::now() > *routeSloDeadline_) {
+    numRoutesOverSlo_ += numRoutes;
+  }
+}
+
 bool
 Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
   SCOPE_EXIT {
     updateRoutesSemaphore_.signal(); // Release when this function returns
   };
   updateRoutesSemaphore_.wait();
+  return programRoutes(std::move(routeUpdate), isStaticRoutes);
+}
 
+bool
+Fib::programRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
   // update flat counters here as they depend on routeState_ and its change
   updateGlobalCounters();
 
@@ -524,7 +1192,7 @@ Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
   // Convert DecisionRouteUpdate to RouteDatabaseDelta to use UnicastRoute
   // and MplsRoute with the FibService client APIs
   auto routeDbDelta = routeUpdate.toThrift();
-  auto const& unicastRoutesToUpdate = *routeDbDelta.unicastRoutesToUpdate_ref();
+  auto& unicastRoutesToUpdate = *routeDbDelta.unicastRoutesToUpdate_ref();
   auto const& mplsRoutesToUpdate = createMplsRoutesWithSelectedNextHops(
       *routeDbDelta.mplsRoutesToUpdate_ref());
 
@@ -545,10 +1213,85 @@ Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
   try {
     LOG(INFO) << "Updating routes in FIB";
     const auto startTime = std::chrono::steady_clock::now();
+    numRoutesOverSlo_ = 0;
+    if (routeProgrammingSlo_.has_value()) {
+      routeSloDeadline_ = startTime + *routeProgrammingSlo_;
+    }
+    SCOPE_EXIT {
+      routeSloDeadline_.reset();
+    };
 
     // Create FIB client if doesn't exists
     createFibClient(evb_, socket_, client_, thriftPort_);
 
+    invalidateRouteDigest();
+    // Static MPLS routes programmed ahead of the first sync may differ from
+    // the ones in the digest
+    if (restartRouteDigest_) {
+      for (auto const& route : mplsRoutesToUpdate) {
+        (*restartRouteDigest_->mplsRouteHashes_ref())[*route.topLabel_ref()] =
+            0;
+      }
+    }
+
+    // Traced update, span lasts until the agent acks programming of the
+    // routes, i.e. netlink acks for the platform agent
+    if (routeUpdate.perfEvents.has_value()) {
+      startPerfSpan(
+          routeUpdate.perfEvents.value(),
+          myNodeName_,
+          Constants::kPerfSpanFibProgram);
+    }
+
+    // Result of pipelined programming, chunks which fail don't throw
+    bool allChunksProgrammed{true};
+
+    // Add high priority unicast routes ahead of all other updates
+    if (fibChunkSize_ and numUnicastRoutesToUpdate) {
+      auto highPriorityEnd = std::stable_partition(
+          unicastRoutesToUpdate.begin(),
+          unicastRoutesToUpdate.end(),
+          [&](const thrift::UnicastRoute& route) {
+            return isHighPriorityRoute(routeUpdate.unicastRoutesToUpdate.at(
+                toIPNetwork(*route.dest_ref())));
+          });
+      std::vector<thrift::UnicastRoute> highPriorityRoutes(
+          std::make_move_iterator(unicastRoutesToUpdate.begin()),
+          std::make_move_iterator(highPriorityEnd));
+      unicastRoutesToUpdate.erase(
+          unicastRoutesToUpdate.begin(), highPriorityEnd);
+
+      if (not highPriorityRoutes.empty()) {
+        LOG(INFO) << "Adding/Updating " << highPriorityRoutes.size()
+                  << " high priority unicast routes in FIB";
+        printUnicastRoutesAddUpdate(highPriorityRoutes);
+
+        allChunksProgrammed &= programRoutesInChunks<thrift::UnicastRoute>(
+            highPriorityRoutes,
+            [this](const std::vector<thrift::UnicastRoute>& chunk) {
+              return client_->semifuture_addUnicastRoutes(kFibId_, chunk);
+            });
+
+        const auto highPriorityTime =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startTime);
+        fb303::fbData->addStatValue(
+            "fib.route_programming.high_priority_time_ms",
+            highPriorityTime.count(),
+            fb303::AVG);
+        fb303::fbData->addStatValue(
+            "fib.num_of_high_priority_route_updates",
+            highPriorityRoutes.size(),
+            fb303::SUM);
+        if (routeUpdate.perfEvents.has_value()) {
+          addPerfEvent(
+              routeUpdate.perfEvents.value(),
+              myNodeName_,
+              "FIB_HIGH_PRIORITY_ROUTES_PROGRAMMED");
+        }
+      }
+    }
+
     // Delete unicast routes
     if (numUnicastRoutesToDelete) {
       LOG(INFO) << "Deleting " << numUnicastRoutesToDelete
@@ -557,20 +1300,43 @@ Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
         VLOG(1) << "> " << toString(prefix);
       }
 
-      client_->sync_deleteUnicastRoutes(
-          kFibId_, *routeDbDelta.unicastRoutesToDelete_ref());
+      if (fibChunkSize_) {
+        allChunksProgrammed &= programRoutesInChunks<thrift::IpPrefix>(
+            *routeDbDelta.unicastRoutesToDelete_ref(),
+            [this](const std::vector<thrift::IpPrefix>& chunk) {
+              return client_->semifuture_deleteUnicastRoutes(kFibId_, chunk);
+            });
+      } else {
+        client_->sync_deleteUnicastRoutes(
+            kFibId_, *routeDbDelta.unicastRoutesToDelete_ref());
+        checkRouteProgrammingSlo(numUnicastRoutesToDelete);
+      }
     }
 
     // Add unicast routes
-    if (numUnicastRoutesToUpdate) {
-      LOG(INFO) << "Adding/Updating " << numUnicastRoutesToUpdate
+    if (not unicastRoutesToUpdate.empty()) {
+      LOG(INFO) << "Adding/Updating " << unicastRoutesToUpdate.size()
                 << " unicast routes in FIB";
       printUnicastRoutesAddUpdate(unicastRoutesToUpdate);
 
-      client_->sync_addUnicastRoutes(kFibId_, unicastRoutesToUpdate);
+      if (fibChunkSize_) {
+        allChunksProgrammed &= programRoutesInChunks<thrift::UnicastRoute>(
+            unicastRoutesToUpdate,
+            [this](const std::vector<thrift::UnicastRoute>& chunk) {
+              return client_->semifuture_addUnicastRoutes(kFibId_, chunk);
+            });
+      } else {
+        client_->sync_addUnicastRoutes(kFibId_, unicastRoutesToUpdate);
+        checkRouteProgrammingSlo(unicastRoutesToUpdate.size());
+      }
+    }
+    if (numUnicastRoutesToDelete or numUnicastRoutesToUpdate) {
+      fb303::fbData->addHistogramValue(
+          "fib.route_programming.unicast_time_ms", getElapsedMs(startTime));
     }
 
     if (enableSegmentRouting_) {
+      const auto mplsStartTime = std::chrono::steady_clock::now();
       // Delete mpls routes
       if (numMplsRoutesToDelete) {
         LOG(INFO) << "Deleting " << numMplsRoutesToDelete
@@ -579,8 +1345,17 @@ Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
           VLOG(1) << "> " << std::to_string(topLabel);
         }
 
-        client_->sync_deleteMplsRoutes(
-            kFibId_, *routeDbDelta.mplsRoutesToDelete_ref());
+        if (fibChunkSize_) {
+          allChunksProgrammed &= programRoutesInChunks<int32_t>(
+              *routeDbDelta.mplsRoutesToDelete_ref(),
+              [this](const std::vector<int32_t>& chunk) {
+                return client_->semifuture_deleteMplsRoutes(kFibId_, chunk);
+              });
+        } else {
+          client_->sync_deleteMplsRoutes(
+              kFibId_, *routeDbDelta.mplsRoutesToDelete_ref());
+          checkRouteProgrammingSlo(numMplsRoutesToDelete);
+        }
       }
 
       // Add mpls routes
@@ -589,10 +1364,31 @@ Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
                   << " mpls routes in FIB";
         printMplsRoutesAddUpdate(mplsRoutesToUpdate);
 
-        client_->sync_addMplsRoutes(kFibId_, mplsRoutesToUpdate);
+        if (fibChunkSize_) {
+          allChunksProgrammed &= programRoutesInChunks<thrift::MplsRoute>(
+              mplsRoutesToUpdate,
+              [this](const std::vector<thrift::MplsRoute>& chunk) {
+                return client_->semifuture_addMplsRoutes(kFibId_, chunk);
+              });
+        } else {
+          client_->sync_addMplsRoutes(kFibId_, mplsRoutesToUpdate);
+          checkRouteProgrammingSlo(numMplsRoutesToUpdate);
+        }
+      }
+      if (numMplsRoutesToDelete or numMplsRoutesToUpdate) {
+        fb303::fbData->addHistogramValue(
+            "fib.route_programming.mpls_time_ms",
+            getElapsedMs(mplsStartTime));
       }
     }
 
+    if (not allChunksProgrammed) {
+      fb303::fbData->addStatValue(
+          "fib.thrift.failure.add_del_route", 1, fb303::COUNT);
+      LOG(ERROR) << "Failed to program some chunks of route updates in FIB";
+      return false;
+    }
+
     const auto elapsedTime =
         std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - startTime);
@@ -606,6 +1402,41 @@ Fib::updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes) {
         "fib.route_programming.time_ms", elapsedTime.count(), fb303::AVG);
     fb303::fbData->addStatValue(
         "fib.num_of_route_updates", numOfRouteUpdates, fb303::SUM);
+    fb303::fbData->addHistogramValue(
+        fmt::format(
+            "fib.route_programming.time_ms.{}",
+            getRouteUpdateSizeClass(numOfRouteUpdates)),
+        elapsedTime.count());
+
+    // Mark updates with routes programmed past their SLO
+    if (numRoutesOverSlo_) {
+      LOG(WARNING) << fmt::format(
+          "{} of {} routes exceeded programming SLO of {}ms",
+          numRoutesOverSlo_,
+          numOfRouteUpdates,
+          routeProgrammingSlo_->count());
+      fb303::fbData->addStatValue(
+          "fib.route_programming.slo_exceeded_routes",
+          numRoutesOverSlo_,
+          fb303::SUM);
+      if (routeUpdate.perfEvents.has_value()) {
+        addPerfEvent(
+            routeUpdate.perfEvents.value(),
+            myNodeName_,
+            "FIB_ROUTE_PROGRAMMING_SLO_EXCEEDED");
+      }
+    }
+
+    // Log convergence of route updates, including time taken by high
+    // priority routes if any
+    if (routeUpdate.perfEvents.has_value()) {
+      endPerfSpan(
+          routeUpdate.perfEvents.value(),
+          myNodeName_,
+          Constants::kPerfSpanFibProgram);
+    }
+    logPerfEvents(routeUpdate.perfEvents);
+    scheduleRouteDigestPersist();
     return true;
   } catch (const std::exception& e) {
     client_.reset();
@@ -645,17 +1476,31 @@ Fib::syncRouteDb() {
 
     createFibClient(evb_, socket_, client_, thriftPort_);
     fb303::fbData->addStatValue("fib.sync_fib_calls", 1, fb303::COUNT);
+    invalidateRouteDigest();
+
+    if (restartRouteDigest_ and
+        syncRouteDbFromDigest(unicastRoutes, mplsRoutes)) {
+      LOG(INFO) << "Synced routes in FIB against route digest";
+    } else if (
+        incrementalSync_ and
+        syncRouteDbIncremental(unicastRoutes, mplsRoutes)) {
+      LOG(INFO) << "Synced routes in FIB incrementally";
+    } else {
+      // Connection may have broken during incremental sync
+      createFibClient(evb_, socket_, client_, thriftPort_);
 
-    // Sync unicast routes
-    LOG(INFO) << "Syncing " << unicastRoutes.size() << " unicast routes in FIB";
-    client_->sync_syncFib(kFibId_, unicastRoutes);
-    printUnicastRoutesAddUpdate(unicastRoutes);
-
-    // Sync mpls routes
-    if (enableSegmentRouting_) {
-      LOG(INFO) << "Syncing " << mplsRoutes.size() << " mpls routes in FIB";
-      client_->sync_syncMplsFib(kFibId_, mplsRoutes);
-      printMplsRoutesAddUpdate(mplsRoutes);
+      // Sync unicast routes
+      LOG(INFO) << "Syncing " << unicastRoutes.size()
+                << " unicast routes in FIB";
+      client_->sync_syncFib(kFibId_, unicastRoutes);
+      printUnicastRoutesAddUpdate(unicastRoutes);
+
+      // Sync mpls routes
+      if (enableSegmentRouting_) {
+        LOG(INFO) << "Syncing " << mplsRoutes.size() << " mpls routes in FIB";
+        client_->sync_syncMplsFib(kFibId_, mplsRoutes);
+        printMplsRoutesAddUpdate(mplsRoutes);
+      }
     }
 
     const auto elapsedTime =
@@ -666,6 +1511,7 @@ Fib::syncRouteDb() {
     fb303::fbData->addStatValue(
         "fib.route_sync.time_ms", elapsedTime.count(), fb303::AVG);
     routeState_.dirtyRouteDb = false;
+    scheduleRouteDigestPersist();
     return true;
   } catch (std::exception const& e) {
     fb303::fbData->addStatValue("fib.thrift.failure.sync_fib", 1, fb303::COUNT);
@@ -677,6 +1523,177 @@ Fib::syncRouteDb() {
   }
 }
 
+bool
+Fib::syncRouteDbIncremental(
+    const std::vector<thrift::UnicastRoute>& unicastRoutes,
+    const std::vector<thrift::MplsRoute>& mplsRoutes) {
+  thrift::RouteDatabaseDelta delta;
+  try {
+    // Connection may have broken during sync against route digest
+    createFibClient(evb_, socket_, client_, thriftPort_);
+    std::vector<thrift::UnicastRoute> agentUnicastRoutes;
+    client_->sync_getRouteTableByClient(agentUnicastRoutes, kFibId_);
+    std::vector<thrift::MplsRoute> agentMplsRoutes;
+    if (enableSegmentRouting_) {
+      client_->sync_getMplsRouteTableByClient(agentMplsRoutes, kFibId_);
+    }
+    delta = getRouteDbDiff(
+        unicastRoutes,
+        enableSegmentRouting_ ? mplsRoutes : std::vector<thrift::MplsRoute>{},
+        agentUnicastRoutes,
+        agentMplsRoutes);
+  } catch (std::exception const& e) {
+    fb303::fbData->addStatValue(
+        "fib.route_sync.incremental.failure", 1, fb303::COUNT);
+    LOG(ERROR) << "Failed to get routes from FIB, fall back to full sync. "
+               << "Error: " << folly::exceptionStr(e);
+    client_.reset();
+    return false;
+  }
+
+  LOG(INFO) << "Syncing routes in FIB incrementally";
+  fb303::fbData->addStatValue(
+      "fib.route_sync.incremental.num_route_updates",
+      getNumRouteUpdates(delta),
+      fb303::SUM);
+
+  if (not programSyncDelta(delta)) {
+    fb303::fbData->addStatValue(
+        "fib.route_sync.incremental.failure", 1, fb303::COUNT);
+    LOG(ERROR) << "Failed to sync routes in FIB incrementally, fall back to "
+               << "full sync";
+    return false;
+  }
+  return true;
+}
+
+bool
+Fib::syncRouteDbFromDigest(
+    const std::vector<thrift::UnicastRoute>& unicastRoutes,
+    const std::vector<thrift::MplsRoute>& mplsRoutes) {
+  // Digest only applies to the first sync after restart
+  auto digest = std::move(*restartRouteDigest_);
+  restartRouteDigest_.reset();
+
+  try {
+    const auto aliveSince = client_->sync_aliveSince();
+    if (aliveSince != *digest.agentAliveSince_ref()) {
+      LOG(INFO) << "FIB agent restarted since route digest was persisted, "
+                << "fall back to regular sync";
+      return false;
+    }
+  } catch (std::exception const& e) {
+    fb303::fbData->addStatValue(
+        "fib.route_sync.graceful_restart.failure", 1, fb303::COUNT);
+    LOG(ERROR) << "Failed to get aliveSince of FIB agent, fall back to "
+               << "regular sync. Error: " << folly::exceptionStr(e);
+    client_.reset();
+    return false;
+  }
+
+  // Routes which are new or changed are programmed. Routes left in the
+  // digest are stale.
+  thrift::RouteDatabaseDelta delta;
+  auto& unicastHashes = *digest.unicastRouteHashes_ref();
+  for (auto const& route : unicastRoutes) {
+    auto it = unicastHashes.find(toString(*route.dest_ref()));
+    if (it == unicastHashes.end() or it->second != getRouteHash(route)) {
+      delta.unicastRoutesToUpdate_ref()->emplace_back(route);
+    }
+    if (it != unicastHashes.end()) {
+      unicastHashes.erase(it);
+    }
+  }
+  for (auto const& [prefix, _] : unicastHashes) {
+    delta.unicastRoutesToDelete_ref()->emplace_back(toIpPrefix(prefix));
+  }
+  if (enableSegmentRouting_) {
+    auto& mplsHashes = *digest.mplsRouteHashes_ref();
+    for (auto const& route : mplsRoutes) {
+      auto it = mplsHashes.find(*route.topLabel_ref());
+      if (it == mplsHashes.end() or it->second != getRouteHash(route)) {
+        delta.mplsRoutesToUpdate_ref()->emplace_back(route);
+      }
+      if (it != mplsHashes.end()) {
+        mplsHashes.erase(it);
+      }
+    }
+    for (auto const& [label, _] : mplsHashes) {
+      delta.mplsRoutesToDelete_ref()->emplace_back(label);
+    }
+  }
+
+  LOG(INFO) << "Syncing routes in FIB against route digest";
+  fb303::fbData->addStatValue(
+      "fib.route_sync.graceful_restart.num_route_updates",
+      getNumRouteUpdates(delta),
+      fb303::SUM);
+
+  if (not programSyncDelta(delta)) {
+    fb303::fbData->addStatValue(
+        "fib.route_sync.graceful_restart.failure", 1, fb303::COUNT);
+    LOG(ERROR) << "Failed to sync routes in FIB against route digest, fall "
+               << "back to regular sync";
+    return false;
+  }
+  return true;
+}
+
+bool
+Fib::programSyncDelta(const thrift::RouteDatabaseDelta& delta) {
+  const auto& unicastRoutesToUpdate = *delta.unicastRoutesToUpdate_ref();
+  const auto& unicastRoutesToDelete = *delta.unicastRoutesToDelete_ref();
+  const auto& mplsRoutesToUpdate = *delta.mplsRoutesToUpdate_ref();
+  const auto& mplsRoutesToDelete = *delta.mplsRoutesToDelete_ref();
+  LOG(INFO) << fmt::format(
+      "Unicast routes to add/update {}, to delete {}. Mpls routes to "
+      "add/update {}, to delete {}",
+      unicastRoutesToUpdate.size(),
+      unicastRoutesToDelete.size(),
+      mplsRoutesToUpdate.size(),
+      mplsRoutesToDelete.size());
+  printUnicastRoutesAddUpdate(unicastRoutesToUpdate);
+  printMplsRoutesAddUpdate(mplsRoutesToUpdate);
+
+  // Delete routes first, to not exceed route table of agent with stale routes
+  bool allChunksProgrammed = programRoutesInChunks<thrift::IpPrefix>(
+      unicastRoutesToDelete,
+      [this](const std::vector<thrift::IpPrefix>& chunk) {
+        return client_->semifuture_deleteUnicastRoutes(kFibId_, chunk);
+      });
+  allChunksProgrammed &= programRoutesInChunks<int32_t>(
+      mplsRoutesToDelete, [this](const std::vector<int32_t>& chunk) {
+        return client_->semifuture_deleteMplsRoutes(kFibId_, chunk);
+      });
+  allChunksProgrammed &= programRoutesInChunks<thrift::UnicastRoute>(
+      unicastRoutesToUpdate,
+      [this](const std::vector<thrift::UnicastRoute>& chunk) {
+        return client_->semifuture_addUnicastRoutes(kFibId_, chunk);
+      });
+  allChunksProgrammed &= programRoutesInChunks<thrift::MplsRoute>(
+      mplsRoutesToUpdate, [this](const std::vector<thrift::MplsRoute>& chunk) {
+        return client_->semifuture_addMplsRoutes(kFibId_, chunk);
+      });
+
+  return allChunksProgrammed;
+}
+
+void
+Fib::invalidateRouteDigest() {
+  if (routeDigestPersisted_) {
+    configStore_->erase(kRouteDigestKey).get();
+    routeDigestPersisted_ = false;
+  }
+}
+
+void
+Fib::scheduleRouteDigestPersist() {
+  if (configStore_ and not persistRouteDigestTimer_->isScheduled()) {
+    persistRouteDigestTimer_->scheduleTimeout(
+        Constants::kFibRouteDigestPersistDelay);
+  }
+}
+
 void
 Fib::syncRouteDbDebounced() {
   if (!syncRoutesTimer_->isScheduled()) {
@@ -695,6 +1712,7 @@ Fib::keepAliveCheck() {
                  << "Performing full route DB sync ...";
     // set dirty flag
     routeState_.dirtyRouteDb = true;
+    shadowTableDirty_ = true;
     syncRoutesExpBackoff_.reportSuccess();
     syncRouteDbDebounced();
   }
@@ -755,6 +1773,13 @@ Fib::updateGlobalCounters() {
       "fib.num_unicast_routes", routeState_.unicastRoutes.size());
   fb303::fbData->setCounter(
       "fib.num_mpls_routes", routeState_.mplsRoutes.size());
+
+  // approximate memory held by the routes, accounted for by Watchdog
+  fb303::fbData->setCounter(
+      "fib.memory.routes_bytes",
+      routeState_.unicastRoutes.size() *
+              sizeof(decltype(routeState_.unicastRoutes)::value_type) +
+          routeState_.mplsRoutes.getMemoryUsage());
 }
 
 void
@@ -790,11 +1815,16 @@ Fib::logPerfEvents(std::optional<thrift::PerfEvents>& perfEvents) {
 
   // Log event
   auto eventStrs = sprintPerfEvents(*perfEvents);
+  auto spanStrs = sprintPerfSpans(*perfEvents);
+  const auto traceId = perfEvents->traceId_ref().value_or(0);
   LOG(INFO) << "OpenR convergence performance. "
             << "Duration=" << totalDuration.count();
   for (auto& str : eventStrs) {
     VLOG(2) << "  " << str;
   }
+  for (auto& str : spanStrs) {
+    VLOG(2) << "  trace: " << traceId << ", " << str;
+  }
 
   // Add new entry to perf DB and purge extra entries
   perfDb_.push_back(std::move(perfEvents).value());
@@ -811,6 +1841,10 @@ Fib::logPerfEvents(std::optional<thrift::PerfEvents>& perfEvents) {
   sample.addString("event", "ROUTE_CONVERGENCE");
   sample.addStringVector("perf_events", eventStrs);
   sample.addInt("duration_ms", totalDuration.count());
+  if (traceId) {
+    sample.addInt("trace_id", traceId);
+    sample.addStringVector("perf_spans", spanStrs);
+  }
   logSampleQueue_.push(sample);
 }
 
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <folly/Function.h>
+#include <folly/Unit.h>
+#include <folly/futures/Future.h>
 #include <folly/fibers/Semaphore.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -14,8 +17,11 @@
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/LabelMap.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/PrefixTrie.h>
 #include <openr/common/Util.h>
+#include <openr/config-store/PersistentStore.h>
 #include <openr/config/Config.h>
 #include <openr/decision/RibEntry.h>
 #include <openr/decision/RouteUpdate.h>
@@ -53,7 +59,8 @@ class Fib final : public OpenrEventBase {
       messaging::RQueue<DecisionRouteUpdate> routeUpdatesQueue,
       messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue,
       messaging::ReplicateQueue<DecisionRouteUpdate>& fibUpdatesQueue,
-      messaging::ReplicateQueue<LogSample>& logSampleQueue);
+      messaging::ReplicateQueue<LogSample>& logSampleQueue,
+      PersistentStore* configStore = nullptr);
 
   /**
    * Override stop method of OpenrEventBase
@@ -74,14 +81,29 @@ class Fib final : public OpenrEventBase {
   /**
    * Perform longest prefix match among all prefixes in route database.
    * @param inputPrefix - a prefix that need to be matched
-   * @param unicastRoutes - current unicast routes in RouteDatabase
+   * @param unicastRouteTrie - prefixes of current unicast routes in
+   *                           RouteDatabase
    *
    * @return the matched CIDRNetwork if prefix matching succeed.
    */
   static std::optional<folly::CIDRNetwork> longestPrefixMatch(
       const folly::CIDRNetwork& inputPrefix,
-      const std::unordered_map<folly::CIDRNetwork, RibUnicastEntry>&
-          unicastRoutes);
+      const PrefixTrie<folly::Unit>& unicastRouteTrie);
+
+  /**
+   * Compute route updates bringing the routes of the FIB agent to the given
+   * routes. Routes are compared by destination, next-hops in any order, and
+   * admin distance.
+   * @param unicastRoutes, mplsRoutes - routes to be in the agent
+   * @param agentUnicastRoutes, agentMplsRoutes - routes in the agent
+   *
+   * @return routes to add or update and to delete in the agent
+   */
+  static thrift::RouteDatabaseDelta getRouteDbDiff(
+      const std::vector<thrift::UnicastRoute>& unicastRoutes,
+      const std::vector<thrift::MplsRoute>& mplsRoutes,
+      const std::vector<thrift::UnicastRoute>& agentUnicastRoutes,
+      const std::vector<thrift::MplsRoute>& agentMplsRoutes);
 
   /**
    * Show unicast routes which are to be added or updated
@@ -103,6 +125,32 @@ class Fib final : public OpenrEventBase {
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetail>>
   getRouteDetailDb();
 
+  /**
+   * Whether unicast routes are kept without their best prefix entries, see
+   * FibProgrammingConfig::enable_compact_route_state. Route details then
+   * carry an empty best route, to be completed by Decision.
+   */
+  bool
+  isRouteStateCompact() const {
+    return compactRouteState_;
+  }
+
+  /**
+   * Version of the route database, bumped on every non-empty route update.
+   * Safe to read from any thread, used to invalidate cached responses.
+   */
+  int64_t
+  getRouteStateVersion() const {
+    return routeStateVersion_.load();
+  }
+
+  /**
+   * One page of the route detail database, see thrift::PageParams. Unicast
+   * routes by ascending prefix come first, then MPLS routes by label.
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabaseDetailPage>>
+  getRouteDetailDbPage(thrift::PageParams page);
+
   /**
    * Retrieve unicast routes for specified prefixes or IP. Returns all if
    * no prefix is specified in filter list.
@@ -149,11 +197,44 @@ class Fib final : public OpenrEventBase {
   std::vector<thrift::MplsRoute> getMplsRoutesFiltered(
       std::vector<int32_t> labels);
 
+#if FOLLY_HAS_COROUTINES
   /**
-   * Process new route updates received from Decision module
+   * Reader tasks of route updates from Decision and static route updates
+   */
+  folly::coro::Task<void> processDecisionRouteUpdates(
+      messaging::RQueue<DecisionRouteUpdate> routeUpdatesQueue);
+  folly::coro::Task<void> processStaticRouteUpdates(
+      messaging::RQueue<DecisionRouteUpdate> staticRouteUpdatesQueue);
+#endif
+
+  /**
+   * Process new route updates received from Decision module. Caller must
+   * hold updateRoutesSemaphore_.
    */
   void processRouteUpdates(DecisionRouteUpdate&& routeUpdate);
 
+  /**
+   * Handle route update of a priority lane of Decision. Bulk route updates
+   * are merged into pendingBulkRoutes_, which are programmed one slice at a
+   * time by programBulkRouteSlice() in between reads of route updates. High
+   * priority route updates are programmed right away, superseding pending
+   * bulk routes of the same prefixes and labels. Caller must hold
+   * updateRoutesSemaphore_.
+   */
+  void handleRouteUpdate(DecisionRouteUpdate&& routeUpdate);
+
+  /**
+   * Program next slice of pendingBulkRoutes_, one round of pipelined chunks.
+   * Caller must hold updateRoutesSemaphore_.
+   */
+  void programBulkRouteSlice();
+
+  /**
+   * Program static MPLS routes, ignoring unicast routes and deletions. Caller
+   * must hold updateRoutesSemaphore_.
+   */
+  void processStaticRouteUpdate(DecisionRouteUpdate&& routeUpdate);
+
   /**
    * Trigger add/del routes thrift calls
    * on success no action needed
@@ -161,6 +242,36 @@ class Fib final : public OpenrEventBase {
    */
   bool updateRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes);
 
+  /**
+   * Same as updateRoutes, with updateRoutesSemaphore_ already held by caller
+   */
+  bool programRoutes(DecisionRouteUpdate&& routeUpdate, bool isStaticRoutes);
+
+  /**
+   * Whether route is of a high priority prefix type or tag, to be programmed
+   * ahead of other route updates
+   */
+  bool isHighPriorityRoute(const RibUnicastEntry& route) const;
+
+  /**
+   * Program routes in chunks of fibChunkSize_ routes with up to
+   * fibMaxChunksInFlight_ calls outstanding on the FIB agent connection.
+   * A chunk which fails is retried on its own, up to
+   * Constants::kFibChunkMaxRetries times.
+   * @return false if some chunk could not be programmed
+   */
+  template <typename Route>
+  bool programRoutesInChunks(
+      const std::vector<Route>& routes,
+      folly::Function<folly::SemiFuture<folly::Unit>(const std::vector<Route>&)>
+          programChunk);
+
+  /**
+   * Count numRoutes just acknowledged by the FIB agent against the
+   * programming SLO of the route update being programmed, if any
+   */
+  void checkRouteProgrammingSlo(size_t numRoutes);
+
   /**
    * Sync the current routeDb_ with the switch agent.
    * on success no action needed
@@ -168,6 +279,65 @@ class Fib final : public OpenrEventBase {
    */
   bool syncRouteDb();
 
+  /**
+   * Sync routes by programming the difference to the routes in the switch
+   * agent only.
+   * @return false if routes of the agent could not be fetched, or some of
+   *         the difference could not be programmed
+   */
+  bool syncRouteDbIncremental(
+      const std::vector<thrift::UnicastRoute>& unicastRoutes,
+      const std::vector<thrift::MplsRoute>& mplsRoutes);
+
+  /**
+   * Sync routes after a restart of Open/R by programming the difference to
+   * the route digest persisted by the previous instance only. Does not apply
+   * if the agent restarted meanwhile, as its routes are gone then.
+   * @return false if the digest does not apply, or some of the difference
+   *         could not be programmed
+   */
+  bool syncRouteDbFromDigest(
+      const std::vector<thrift::UnicastRoute>& unicastRoutes,
+      const std::vector<thrift::MplsRoute>& mplsRoutes);
+
+  /**
+   * Program unicast route delta into the shadow table, once it was
+   * programmed for forwarding. The whole shadow table is synced with
+   * routeState_ instead, if dirty. Failures only mark it dirty.
+   */
+  void programShadowRoutes(
+      const std::vector<thrift::UnicastRoute>& routesToUpdate,
+      const std::vector<thrift::IpPrefix>& routesToDelete);
+
+  /**
+   * Program routes into the shadow table in chunks, pipelined like
+   * programRoutesInChunks() but without retries.
+   * Throws if some chunk could not be programmed.
+   */
+  template <typename Route>
+  void programShadowChunks(
+      const std::vector<Route>& routes,
+      folly::Function<folly::SemiFuture<folly::Unit>(std::vector<Route>&&)>
+          programChunk);
+
+  /**
+   * Program route delta of a route sync, deletions first
+   * @return false if some of the routes could not be programmed
+   */
+  bool programSyncDelta(const thrift::RouteDatabaseDelta& delta);
+
+  /**
+   * Erase persisted route digest, before programmed routes change. A stale
+   * digest would leave routes of the agent unsynced on next restart.
+   */
+  void invalidateRouteDigest();
+
+  /**
+   * Schedule persisting the route digest of routes in routeState_, after
+   * they were all programmed successfully
+   */
+  void scheduleRouteDigestPersist();
+
   /**
    * Asynchrounsly schedules the syncRouteDb call and returns immediately. All
    * APIs should call this function to sync-routes.
@@ -193,7 +363,10 @@ class Fib final : public OpenrEventBase {
   struct RouteState {
     // Non modified copy of Unicast and MPLS routes received from Decision
     std::unordered_map<folly::CIDRNetwork, RibUnicastEntry> unicastRoutes;
-    std::unordered_map<uint32_t, RibMplsEntry> mplsRoutes;
+    LabelMap<uint32_t, RibMplsEntry> mplsRoutes;
+
+    // Prefixes of unicastRoutes for longest prefix match lookups
+    PrefixTrie<folly::Unit> unicastRouteTrie;
 
     // Indicates we've received a decision route publication and therefore have
     // routes to sync. Will not synce routes with system until this is set.
@@ -210,6 +383,9 @@ class Fib final : public OpenrEventBase {
   };
   RouteState routeState_;
 
+  // Bumped on every change of routeState_ routes, see getRouteStateVersion()
+  std::atomic<int64_t> routeStateVersion_{0};
+
   // Events to capture and indicate performance of protocol convergence.
   std::deque<thrift::PerfEvents> perfDb_;
 
@@ -228,6 +404,49 @@ class Fib final : public OpenrEventBase {
   // Enable segment routing
   bool enableSegmentRouting_{false};
 
+  // Routes per call and calls outstanding of pipelined route programming.
+  // Route updates are programmed in one call per kind of update if chunk size
+  // is 0
+  size_t fibChunkSize_{0};
+  size_t fibMaxChunksInFlight_{1};
+
+  // Sync routes by programming the difference to the agent's routes only
+  bool incrementalSync_{false};
+
+  // Keep routes of routeState_ without best prefix entries
+  bool compactRouteState_{false};
+
+  // Table shadowing unicast routes, see shadow_table_id, and whether it must
+  // be synced with routeState_ before programming deltas into it
+  std::optional<int32_t> shadowTableId_;
+  bool shadowTableDirty_{true};
+
+  // Per route programming SLO, and deadline of the route update being
+  // programmed along with the number of its routes acknowledged past it
+  std::optional<std::chrono::milliseconds> routeProgrammingSlo_;
+  std::optional<std::chrono::steady_clock::time_point> routeSloDeadline_;
+  size_t numRoutesOverSlo_{0};
+
+  // Store of the route digest for graceful restart, nullptr if disabled
+  PersistentStore* configStore_{nullptr};
+
+  // Route digest persisted by previous instance, used by first sync only
+  std::optional<thrift::FibRouteDigest> restartRouteDigest_;
+
+  // Whether configStore_ holds a route digest
+  bool routeDigestPersisted_{false};
+
+  // Timer to persist route digest, see scheduleRouteDigestPersist()
+  std::unique_ptr<folly::AsyncTimeout> persistRouteDigestTimer_{nullptr};
+
+  // Unicast routes of these prefix types or tags are programmed first
+  std::set<thrift::PrefixType> highPriorityPrefixTypes_;
+  std::set<std::string> highPriorityPrefixTags_;
+
+  // Bulk route updates from Decision yet to be programmed, see
+  // handleRouteUpdate()
+  DecisionRouteUpdate pendingBulkRoutes_;
+
   apache::thrift::CompactSerializer serializer_;
 
   // Thrift client connection to switch FIB Agent using which we actually
@@ -236,6 +455,11 @@ class Fib final : public OpenrEventBase {
   folly::AsyncSocket* socket_{nullptr};
   std::unique_ptr<thrift::FibServiceAsyncClient> client_{nullptr};
 
+  // Separate connection for shadow programming, so that its calls don't
+  // queue up with the ones programming forwarding routes
+  folly::AsyncSocket* shadowSocket_{nullptr};
+  std::unique_ptr<thrift::FibServiceAsyncClient> shadowClient_{nullptr};
+
   // Callback timer to sync routes to switch agent and scheduled on route-sync
   // failure. ExponentialBackoff timer to ease up things if they go wrong
   std::unique_ptr<folly::AsyncTimeout> syncRoutesTimer_{nullptr};
@@ -259,9 +483,8 @@ class Fib final : public OpenrEventBase {
 
   const int16_t kFibId_{static_cast<int16_t>(thrift::FibClient::OPENR)};
 
-  // TODO: Remove if not needed
-  // Semaphore to serialize route programming across two fibers (interface
-  // updates & route updates)
+  // Semaphore to serialize route programming across reader tasks (static and
+  // Decision route updates) and the static routes sync timer
   // NOTE: Initializing with a single slot to avoid parallel processing
   folly::fibers::Semaphore updateRoutesSemaphore_{1};
 
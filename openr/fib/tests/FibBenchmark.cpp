@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <atomic>
+
 #include <gtest/gtest.h>
 
 #include <folly/Benchmark.h>
@@ -53,8 +55,31 @@ static const uint32_t kDeltaSize = 10;
 // Number of nexthops
 const uint8_t kNumOfNexthops = 128;
 
+// count of heap allocations made by this process, replaced below for this
+// benchmark binary only
+std::atomic<uint64_t> allocationCount{0};
+
 } // anonymous namespace
 
+void*
+operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
 namespace openr {
 
 using apache::thrift::ThriftServer;
@@ -281,12 +306,50 @@ BM_Fib(folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
   counters["route_install"] = processTimes[2];
 }
 
+/**
+ * Benchmark for the conversion of a route update into the thrift delta Fib
+ * programs, reporting heap allocations per conversion
+ */
+static void
+BM_FibDeltaToThrift(
+    folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  PrefixGenerator prefixGenerator;
+  DecisionRouteUpdate routeUpdate;
+  for (auto& prefix :
+       prefixGenerator.ipv6PrefixGenerator(numOfPrefixes, kBitMaskLen)) {
+    auto nhs =
+        prefixGenerator.getRandomNextHopsUnicast(kNumOfNexthops, kVethNameY);
+    routeUpdate.unicastRoutesToUpdate.emplace(
+        toIPNetwork(prefix),
+        RibUnicastEntry(
+            toIPNetwork(prefix),
+            std::unordered_set<thrift::NextHopThrift>(nhs.begin(), nhs.end())));
+  }
+
+  const auto startAllocations = allocationCount.load();
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    auto delta = routeUpdate.toThrift();
+    folly::doNotOptimizeAway(delta);
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  counters["allocs_per_op"] =
+      (allocationCount.load() - startAllocations) / std::max(iters, 1u);
+}
+
 // The parameter is the number of prefixes sent to fib
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 10);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 100);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 9000);
 
+// The parameter is the number of prefixes in the converted update
+BENCHMARK_COUNTERS_PARAM(BM_FibDeltaToThrift, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_FibDeltaToThrift, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_FibDeltaToThrift, counters, 10000);
+
 } // namespace openr
 
 int
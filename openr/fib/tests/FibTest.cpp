@@ -14,6 +14,7 @@
 #include "openr/if/gen-cpp2/Network_types.h"
 
 #include <openr/common/NetworkUtil.h>
+#include <openr/config-store/PersistentStore.h>
 #include <openr/config/Config.h>
 #include <openr/config/tests/Utils.h>
 #include <openr/ctrl-server/OpenrCtrlHandler.h>
@@ -286,8 +287,12 @@ checkEqualRouteDatabaseDeltaDetailUnicast(
 
 class FibTestFixture : public ::testing::Test {
  public:
-  explicit FibTestFixture(bool waitOnDecision = false)
-      : waitOnDecision_(waitOnDecision) {}
+  explicit FibTestFixture(
+      bool waitOnDecision = false,
+      std::optional<thrift::FibProgrammingConfig> fibProgrammingConfig =
+          std::nullopt)
+      : waitOnDecision_(waitOnDecision),
+        fibProgrammingConfig_(std::move(fibProgrammingConfig)) {}
   void
   SetUp() override {
     mockFibHandler_ = std::make_shared<MockNetlinkFibHandler>();
@@ -312,6 +317,9 @@ class FibTestFixture : public ::testing::Test {
     if (waitOnDecision_) {
       tConfig.eor_time_s_ref() = 1;
     }
+    if (fibProgrammingConfig_) {
+      tConfig.fib_programming_config_ref() = *fibProgrammingConfig_;
+    }
 
     config_ = make_shared<Config>(tConfig);
 
@@ -522,6 +530,7 @@ class FibTestFixture : public ::testing::Test {
 
  private:
   bool waitOnDecision_{false};
+  std::optional<thrift::FibProgrammingConfig> fibProgrammingConfig_;
 };
 
 // Fib single streaming client test.
@@ -994,6 +1003,611 @@ TEST_F(FibTestFixture, basicAddAndDelete) {
   EXPECT_EQ(mockFibHandler_->getDelMplsRoutesCount(), 2);
 }
 
+class FibTestFixturePipelined : public FibTestFixture {
+ public:
+  FibTestFixturePipelined()
+      : FibTestFixture(false /* waitOnDecision */, getFibProgrammingConfig()) {}
+
+  static thrift::FibProgrammingConfig
+  getFibProgrammingConfig() {
+    thrift::FibProgrammingConfig fibConf;
+    fibConf.chunk_size_ref() = 1;
+    fibConf.max_chunks_in_flight_ref() = 2;
+    return fibConf;
+  }
+};
+
+/**
+ * Verify route updates programmed in pipelined chunks of one route each. The
+ * next update is only processed once all chunks of the previous one are done,
+ * so waiting for it ensures the previous update is programmed completely.
+ */
+TEST_F(FibTestFixturePipelined, chunkedAddAndDelete) {
+  // initial syncFib debounce
+  mockFibHandler_->waitForSyncFib();
+  mockFibHandler_->waitForSyncMplsFib();
+
+  // add four unicast routes, one chunk each
+  {
+    DecisionRouteUpdate routeUpdate;
+    for (const auto& prefix : {prefix1, prefix2, prefix3, prefix4}) {
+      routeUpdate.addRouteToUpdate(
+          RibUnicastEntry(toIPNetwork(prefix), {path1_2_1}));
+    }
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+
+  // delete two of them
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete = {
+        toIPNetwork(prefix1), toIPNetwork(prefix2)};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+
+  // add mpls routes
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.mplsRoutesToUpdate.emplace_back(
+        RibMplsEntry(label1, {mpls_path1_2_1}));
+    routeUpdate.mplsRoutesToUpdate.emplace_back(
+        RibMplsEntry(label2, {mpls_path1_2_2}));
+    routeUpdate.mplsRoutesToUpdate.emplace_back(
+        RibMplsEntry(label3, {mpls_path1_2_1}));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForUpdateMplsRoutes();
+
+  // delete an mpls route, once all mpls routes are added
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.mplsRoutesToDelete = {label1};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteMplsRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler_->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+  EXPECT_EQ(mockFibHandler_->getAddRoutesCount(), 4);
+  EXPECT_EQ(mockFibHandler_->getDelRoutesCount(), 2);
+
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mockFibHandler_->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(mplsRoutes.size(), 2);
+  EXPECT_EQ(mockFibHandler_->getAddMplsRoutesCount(), 3);
+  EXPECT_EQ(mockFibHandler_->getDelMplsRoutesCount(), 1);
+
+  // no chunk failed, so no full sync after the initial one
+  EXPECT_EQ(mockFibHandler_->getFibSyncCount(), 1);
+  EXPECT_EQ(mockFibHandler_->getFibMplsSyncCount(), 1);
+}
+
+/**
+ * Verify loopback routes, the default high priority prefix type, are
+ * programmed ahead of other routes of the same update, and the time taken is
+ * logged as a perf event of their own.
+ */
+TEST_F(FibTestFixturePipelined, highPriorityRoutesFirst) {
+  // initial syncFib debounce
+  mockFibHandler_->waitForSyncFib();
+  mockFibHandler_->waitForSyncMplsFib();
+
+  {
+    DecisionRouteUpdate routeUpdate;
+    for (const auto& prefix : {prefix1, prefix2, prefix3}) {
+      routeUpdate.addRouteToUpdate(RibUnicastEntry(
+          toIPNetwork(prefix),
+          {path1_2_1},
+          createPrefixEntry(prefix, thrift::PrefixType::BGP),
+          "area"));
+    }
+    routeUpdate.addRouteToUpdate(RibUnicastEntry(
+        toIPNetwork(prefix4),
+        {path1_2_1},
+        createPrefixEntry(prefix4, thrift::PrefixType::LOOPBACK),
+        "area"));
+    routeUpdate.perfEvents = thrift::PerfEvents();
+    addPerfEvent(*routeUpdate.perfEvents, "node-1", "DECISION_RECEIVED");
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+
+  // wait for a followup update, processed once above is programmed
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete = {toIPNetwork(prefix1)};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+
+  const auto addedPrefixes = mockFibHandler_->getAddedUnicastPrefixes();
+  ASSERT_EQ(addedPrefixes.size(), 4);
+  EXPECT_EQ(addedPrefixes.front(), prefix4);
+
+  auto perfDb = fib_->getPerfDb().get();
+  ASSERT_EQ(perfDb->eventInfo_ref()->size(), 1);
+  std::vector<std::string> eventDescrs;
+  for (const auto& event : *perfDb->eventInfo_ref()->at(0).events_ref()) {
+    eventDescrs.emplace_back(*event.eventDescr_ref());
+  }
+  EXPECT_EQ(
+      eventDescrs,
+      std::vector<std::string>(
+          {"DECISION_RECEIVED",
+           "FIB_ROUTE_DB_RECVD",
+           "FIB_HIGH_PRIORITY_ROUTES_PROGRAMMED",
+           "OPENR_FIB_ROUTES_PROGRAMMED"}));
+}
+
+class FibTestFixtureRouteSlo : public FibTestFixture {
+ public:
+  FibTestFixtureRouteSlo()
+      : FibTestFixture(false /* waitOnDecision */, getFibProgrammingConfig()) {}
+
+  static thrift::FibProgrammingConfig
+  getFibProgrammingConfig() {
+    auto fibConf = FibTestFixturePipelined::getFibProgrammingConfig();
+    fibConf.route_programming_slo_ms_ref() = 0;
+    return fibConf;
+  }
+};
+
+/**
+ * Verify route updates with routes programmed past the programming SLO are
+ * marked in the perf DB
+ */
+TEST_F(FibTestFixtureRouteSlo, sloExceededMarked) {
+  // initial syncFib debounce
+  mockFibHandler_->waitForSyncFib();
+  mockFibHandler_->waitForSyncMplsFib();
+
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix1), {path1_2_1}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix2), {path1_2_2}));
+    routeUpdate.perfEvents = thrift::PerfEvents();
+    addPerfEvent(*routeUpdate.perfEvents, "node-1", "DECISION_RECEIVED");
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForUpdateUnicastRoutes();
+
+  // wait for a followup update, processed once above is programmed
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete = {toIPNetwork(prefix1)};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+
+  auto perfDb = fib_->getPerfDb().get();
+  ASSERT_EQ(perfDb->eventInfo_ref()->size(), 1);
+  std::vector<std::string> eventDescrs;
+  for (const auto& event : *perfDb->eventInfo_ref()->at(0).events_ref()) {
+    eventDescrs.emplace_back(*event.eventDescr_ref());
+  }
+  EXPECT_EQ(
+      eventDescrs,
+      std::vector<std::string>(
+          {"DECISION_RECEIVED",
+           "FIB_ROUTE_DB_RECVD",
+           "FIB_ROUTE_PROGRAMMING_SLO_EXCEEDED",
+           "OPENR_FIB_ROUTES_PROGRAMMED"}));
+}
+
+/**
+ * Verify bulk route updates are programmed in slices of one round of
+ * pipelined chunks, preempted by high priority route updates which supersede
+ * bulk routes not yet programmed.
+ */
+TEST_F(FibTestFixturePipelined, bulkRoutesPreempted) {
+  // initial syncFib debounce
+  mockFibHandler_->waitForSyncFib();
+  mockFibHandler_->waitForSyncMplsFib();
+
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.priority = DecisionRouteUpdate::BULK;
+    for (const auto& prefix : {prefix1, prefix2, prefix3}) {
+      routeUpdate.addRouteToUpdate(
+          RibUnicastEntry(toIPNetwork(prefix), {path1_2_1}));
+    }
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.priority = DecisionRouteUpdate::HIGH;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix1), {path1_2_2}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix4), {path1_2_2}));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+
+  // route update not assigned to a lane is programmed after all bulk routes
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete = {toIPNetwork(prefix2)};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+
+  // at most one slice of two bulk routes is programmed ahead
+  const auto addedPrefixes = mockFibHandler_->getAddedUnicastPrefixes();
+  auto it = std::find(addedPrefixes.begin(), addedPrefixes.end(), prefix4);
+  ASSERT_NE(it, addedPrefixes.end());
+  EXPECT_LE(std::distance(addedPrefixes.begin(), it), 2);
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler_->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 3);
+  for (const auto& route : routes) {
+    const auto& expected =
+        *route.dest_ref() == prefix3 ? path1_2_1 : path1_2_2;
+    ASSERT_EQ(route.nextHops_ref()->size(), 1);
+    EXPECT_EQ(
+        *route.nextHops_ref()->at(0).address_ref(),
+        *expected.address_ref());
+  }
+}
+
+class FibTestFixtureIncrementalSync : public FibTestFixture {
+ public:
+  FibTestFixtureIncrementalSync()
+      : FibTestFixture(false /* waitOnDecision */, getFibProgrammingConfig()) {}
+
+  static thrift::FibProgrammingConfig
+  getFibProgrammingConfig() {
+    auto fibConf = FibTestFixturePipelined::getFibProgrammingConfig();
+    fibConf.enable_incremental_sync_ref() = true;
+    return fibConf;
+  }
+};
+
+/**
+ * Verify initial sync deletes stale routes of agent and adds missing ones,
+ * without sending the whole route table via syncFib.
+ */
+TEST_F(FibTestFixtureIncrementalSync, syncDifferenceOnly) {
+  // stale route in agent, e.g. left by previous Open/R instance
+  mockFibHandler_->addUnicastRoutes(
+      kFibId,
+      std::make_unique<std::vector<thrift::UnicastRoute>>(
+          std::vector<thrift::UnicastRoute>{
+              createUnicastRoute(prefix4, {path1_2_1})}));
+  mockFibHandler_->waitForUpdateUnicastRoutes();
+
+  // first route update from decision triggers sync
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix1), {path1_2_1}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix2), {path1_2_2}));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+
+  // followup delta, processed once above sync is done
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete = {toIPNetwork(prefix1)};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler_->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(*routes.at(0).dest_ref(), prefix2);
+  EXPECT_EQ(mockFibHandler_->getFibSyncCount(), 0);
+  EXPECT_EQ(mockFibHandler_->getFibMplsSyncCount(), 0);
+}
+
+class FibTestFixtureCompactRouteState : public FibTestFixture {
+ public:
+  FibTestFixtureCompactRouteState()
+      : FibTestFixture(false /* waitOnDecision */, getFibProgrammingConfig()) {}
+
+  static thrift::FibProgrammingConfig
+  getFibProgrammingConfig() {
+    thrift::FibProgrammingConfig fibConf;
+    fibConf.enable_compact_route_state_ref() = true;
+    return fibConf;
+  }
+};
+
+/**
+ * Verify routes are programmed and served as before with a compact route
+ * state, their details without best route when no Decision completes them
+ */
+TEST_F(FibTestFixtureCompactRouteState, routesWithoutBestRoute) {
+  EXPECT_TRUE(fib_->isRouteStateCompact());
+
+  thrift::RouteDatabase routeDb;
+  *routeDb.thisNodeName_ref() = "node-1";
+  routeDb.unicastRoutes_ref()->emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1, path1_2_2}));
+  thrift::RouteDatabaseDetail routeDetailDb;
+  *routeDetailDb.thisNodeName_ref() = "node-1";
+  routeDetailDb.unicastRoutes_ref()->emplace_back(createUnicastRouteDetail(
+      prefix2, {path1_2_1, path1_2_2}, thrift::PrefixEntry()));
+
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(RibUnicastEntry(
+        toIPNetwork(prefix2), {path1_2_1, path1_2_2}, bestRoute2, "0"));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForUpdateUnicastRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler_->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 1);
+  EXPECT_TRUE(checkEqualRouteDatabaseUnicast(routeDb, getRouteDb()));
+  EXPECT_TRUE(
+      checkEqualRouteDatabaseUnicastDetail(routeDetailDb, getRouteDetailDb()));
+}
+
+class FibTestFixtureShadowTable : public FibTestFixture {
+ public:
+  FibTestFixtureShadowTable()
+      : FibTestFixture(false /* waitOnDecision */, getFibProgrammingConfig()) {}
+
+  static thrift::FibProgrammingConfig
+  getFibProgrammingConfig() {
+    thrift::FibProgrammingConfig fibConf;
+    fibConf.shadow_table_id_ref() = kShadowTable;
+    return fibConf;
+  }
+
+  static constexpr int32_t kShadowTable{100};
+};
+
+/**
+ * Verify the shadow table is synced with the first route update and then
+ * follows route deltas, one call per kind of update
+ */
+TEST_F(FibTestFixtureShadowTable, shadowRoutes) {
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix1), {path1_2_1}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix2), {path1_2_2}));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForUpdateTables();
+  EXPECT_EQ(1, mockFibHandler_->getFibTablesSyncCount());
+  EXPECT_EQ(
+      std::unordered_set<folly::CIDRNetwork>(
+          {toIPNetwork(prefix1), toIPNetwork(prefix2)}),
+      mockFibHandler_->getTablePrefixes(kShadowTable));
+
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete = {toIPNetwork(prefix1)};
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForUpdateTables();
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix3), {path1_2_1}));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForUpdateTables();
+
+  // no full sync after the initial one
+  EXPECT_EQ(1, mockFibHandler_->getFibTablesSyncCount());
+  EXPECT_EQ(
+      std::unordered_set<folly::CIDRNetwork>(
+          {toIPNetwork(prefix2), toIPNetwork(prefix3)}),
+      mockFibHandler_->getTablePrefixes(kShadowTable));
+}
+
+/**
+ * Fixture restarting Fib against a running agent, with the route digest
+ * persisted in a config store kept across restarts.
+ */
+class FibGracefulRestartTestFixture : public ::testing::Test {
+ public:
+  void
+  SetUp() override {
+    mockFibHandler_ = std::make_shared<MockNetlinkFibHandler>();
+    server_ = make_shared<ThriftServer>();
+    server_->setNumIOWorkerThreads(1);
+    server_->setNumAcceptThreads(1);
+    server_->setPort(0);
+    server_->setInterface(mockFibHandler_);
+    fibThriftThread_.start(server_);
+
+    auto tConfig = getBasicOpenrConfig(
+        "node-1",
+        "domain",
+        {}, /* area config */
+        true, /* enableV4 */
+        true /*enableSegmentRouting*/,
+        false /*orderedFibProgramming*/,
+        false /*dryrun*/);
+    thrift::FibProgrammingConfig fibConf;
+    fibConf.enable_graceful_restart_ref() = true;
+    tConfig.fib_programming_config_ref() = fibConf;
+    config_ = make_shared<Config>(tConfig);
+
+    configStore_ =
+        std::make_unique<PersistentStore>(config_, true /* dryrun */);
+    configStoreThread_ = std::thread([this]() { configStore_->run(); });
+    configStore_->waitUntilRunning();
+  }
+
+  void
+  TearDown() override {
+    stopFib();
+    configStore_->stop();
+    configStoreThread_.join();
+    mockFibHandler_->stop();
+    fibThriftThread_.stop();
+  }
+
+  void
+  startFib() {
+    instance_ = std::make_unique<FibInstance>();
+    instance_->fib = std::make_unique<Fib>(
+        config_,
+        fibThriftThread_.getAddress()->getPort(),
+        std::chrono::seconds(2), /* coldStartDuration */
+        instance_->routeUpdatesQueue.getReader(),
+        instance_->staticRouteUpdatesQueue.getReader(),
+        instance_->fibUpdatesQueue,
+        instance_->logSampleQueue,
+        configStore_.get());
+    instance_->thread = std::thread([this]() { instance_->fib->run(); });
+    instance_->fib->waitUntilRunning();
+  }
+
+  void
+  stopFib() {
+    if (not instance_) {
+      return;
+    }
+    instance_->routeUpdatesQueue.close();
+    instance_->staticRouteUpdatesQueue.close();
+    instance_->fibUpdatesQueue.close();
+    instance_->logSampleQueue.close();
+    instance_->fib->stop();
+    instance_->thread.join();
+    instance_.reset();
+  }
+
+  void
+  waitForRouteDigest() {
+    while (not configStore_->load("fib-route-digest").get()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+
+ protected:
+  struct FibInstance {
+    messaging::ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue;
+    messaging::ReplicateQueue<DecisionRouteUpdate> staticRouteUpdatesQueue;
+    messaging::ReplicateQueue<DecisionRouteUpdate> fibUpdatesQueue;
+    messaging::ReplicateQueue<LogSample> logSampleQueue;
+    std::unique_ptr<Fib> fib;
+    std::thread thread;
+  };
+  std::unique_ptr<FibInstance> instance_;
+
+  std::shared_ptr<MockNetlinkFibHandler> mockFibHandler_;
+  std::shared_ptr<ThriftServer> server_;
+  ScopedServerThread fibThriftThread_;
+  std::shared_ptr<Config> config_;
+  std::unique_ptr<PersistentStore> configStore_;
+  std::thread configStoreThread_;
+};
+
+/**
+ * Verify first sync after restart of Open/R programs only routes which
+ * changed since the route digest was persisted, without fetching or syncing
+ * the whole route table of the agent.
+ */
+TEST_F(FibGracefulRestartTestFixture, syncAgainstRouteDigest) {
+  startFib();
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix1), {path1_2_1, path1_2_2}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix2), {path1_2_1}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix4), {path1_2_1}));
+    routeUpdate.mplsRoutesToUpdate.emplace_back(
+        RibMplsEntry(label1, {mpls_path1_2_1}));
+    instance_->routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForSyncFib();
+  mockFibHandler_->waitForSyncMplsFib();
+  waitForRouteDigest();
+
+  // Restart Open/R, routes of agent stay in place
+  stopFib();
+  startFib();
+
+  // prefix1 and label1 unchanged, prefix2 changed, prefix3 added and prefix4
+  // removed while Open/R was down
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix1), {path1_2_2, path1_2_1}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix2), {path1_2_2}));
+    routeUpdate.addRouteToUpdate(
+        RibUnicastEntry(toIPNetwork(prefix3), {path1_2_1}));
+    routeUpdate.mplsRoutesToUpdate.emplace_back(
+        RibMplsEntry(label1, {mpls_path1_2_1}));
+    instance_->routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+  mockFibHandler_->waitForDeleteUnicastRoutes();
+  mockFibHandler_->waitForUpdateUnicastRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler_->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+  EXPECT_EQ(mockFibHandler_->getFibSyncCount(), 1);
+  EXPECT_EQ(mockFibHandler_->getFibMplsSyncCount(), 1);
+  EXPECT_EQ(mockFibHandler_->getAddRoutesCount(), 2);
+  EXPECT_EQ(mockFibHandler_->getDelRoutesCount(), 1);
+  EXPECT_EQ(mockFibHandler_->getAddMplsRoutesCount(), 0);
+
+  // Digest of the new routes is persisted again
+  waitForRouteDigest();
+}
+
+TEST(FibTest, routeDbDiff) {
+  const std::vector<thrift::UnicastRoute> unicastRoutes{
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}),
+      createUnicastRoute(prefix2, {path1_2_1}),
+      createUnicastRoute(prefix3, {path1_3_1})};
+  const std::vector<thrift::MplsRoute> mplsRoutes{
+      createMplsRoute(label1, {mpls_path1_2_1}),
+      createMplsRoute(label2, {mpls_path1_2_2})};
+
+  // agent has prefix1 with next-hops in other order, prefix2 with other
+  // next-hops, stale prefix4, label1 and stale label3
+  const std::vector<thrift::UnicastRoute> agentUnicastRoutes{
+      createUnicastRoute(prefix1, {path1_2_2, path1_2_1}),
+      createUnicastRoute(prefix2, {path1_2_2}),
+      createUnicastRoute(prefix4, {path1_2_1})};
+  const std::vector<thrift::MplsRoute> agentMplsRoutes{
+      createMplsRoute(label1, {mpls_path1_2_1}),
+      createMplsRoute(label3, {mpls_path1_2_1})};
+
+  auto delta = Fib::getRouteDbDiff(
+      unicastRoutes, mplsRoutes, agentUnicastRoutes, agentMplsRoutes);
+
+  std::set<thrift::IpPrefix> updatedPrefixes;
+  for (const auto& route : *delta.unicastRoutesToUpdate_ref()) {
+    updatedPrefixes.emplace(*route.dest_ref());
+  }
+  EXPECT_EQ(updatedPrefixes, std::set<thrift::IpPrefix>({prefix2, prefix3}));
+  EXPECT_EQ(
+      *delta.unicastRoutesToDelete_ref(),
+      std::vector<thrift::IpPrefix>({prefix4}));
+  ASSERT_EQ(delta.mplsRoutesToUpdate_ref()->size(), 1);
+  EXPECT_EQ(*delta.mplsRoutesToUpdate_ref()->at(0).topLabel_ref(), label2);
+  EXPECT_EQ(*delta.mplsRoutesToDelete_ref(), std::vector<int32_t>({label3}));
+
+  // no difference to itself
+  delta = Fib::getRouteDbDiff(
+      unicastRoutes, mplsRoutes, unicastRoutes, mplsRoutes);
+  EXPECT_TRUE(delta.unicastRoutesToUpdate_ref()->empty());
+  EXPECT_TRUE(delta.unicastRoutesToDelete_ref()->empty());
+  EXPECT_TRUE(delta.mplsRoutesToUpdate_ref()->empty());
+  EXPECT_TRUE(delta.mplsRoutesToDelete_ref()->empty());
+}
+
 TEST_F(FibTestFixture, fibRestart) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -1240,7 +1854,7 @@ TEST_F(FibTestFixture, getUnicastRoutesFilteredTest) {
 }
 
 TEST_F(FibTestFixture, longestPrefixMatchTest) {
-  std::unordered_map<folly::CIDRNetwork, RibUnicastEntry> unicastRoutes;
+  PrefixTrie<folly::Unit> unicastRoutes;
   const auto& defaultRoute = toIpPrefix("::/0");
   const auto& dbPrefix1 = toIpPrefix("192.168.0.0/16");
   const auto& dbPrefix2 = toIpPrefix("192.168.0.0/20");
@@ -1253,12 +1867,11 @@ TEST_F(FibTestFixture, longestPrefixMatchTest) {
   const auto dbPrefix3Cidr = toIPNetwork(dbPrefix3);
   const auto dbPrefix4Cidr = toIPNetwork(dbPrefix4);
 
-  unicastRoutes.emplace(
-      defaultRouteCidr, RibUnicastEntry(defaultRouteCidr, {}));
-  unicastRoutes.emplace(dbPrefix1Cidr, RibUnicastEntry(dbPrefix1Cidr, {}));
-  unicastRoutes.emplace(dbPrefix2Cidr, RibUnicastEntry(dbPrefix2Cidr, {}));
-  unicastRoutes.emplace(dbPrefix3Cidr, RibUnicastEntry(dbPrefix3Cidr, {}));
-  unicastRoutes.emplace(dbPrefix4Cidr, RibUnicastEntry(dbPrefix4Cidr, {}));
+  unicastRoutes.insert(defaultRouteCidr, folly::unit);
+  unicastRoutes.insert(dbPrefix1Cidr, folly::unit);
+  unicastRoutes.insert(dbPrefix2Cidr, folly::unit);
+  unicastRoutes.insert(dbPrefix3Cidr, folly::unit);
+  unicastRoutes.insert(dbPrefix4Cidr, folly::unit);
 
   const auto inputdefaultRoute =
       folly::IPAddress::tryCreateNetwork("::/0").value();
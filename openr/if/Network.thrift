@@ -114,6 +114,9 @@ struct MplsRoute {
   1: i32 topLabel;
   3: optional AdminDistance adminDistance;
   4: list<NextHopThrift> nextHops;
+  // Loop-free alternates, if computed. Platforms supporting fast reroute can
+  // switch to them locally upon failure of nextHops.
+  5: optional list<NextHopThrift> backupNextHops;
 } (cpp.minimize_padding)
 
 enum PrefixType {
@@ -12,6 +12,7 @@ namespace py3 openr.thrift
 namespace wiki Open_Routing.Thrift_APIs.OpenrConfig
 
 include "BgpConfig.thrift"
+include "Network.thrift"
 include "configerator/structs/neteng/config/routing_policy.thrift"
 
 exception ConfigError {
@@ -23,6 +24,32 @@ struct KvstoreFloodRate {
   2: i32 flood_msg_burst_size;
 }
 
+/**
+ * Adaptive coalescing of flooded publications. The first update after a quiet
+ * period is flooded right away and opens a coalescing window. Updates within
+ * the window are merged, keeping only the latest value of a key, and flooded
+ * together when it ends. The window doubles while updates keep arriving, up to
+ * max_window_ms, and halves after a quiet one, down to min_window_ms.
+ */
+struct KvstoreFloodCoalesce {
+  1: i32 min_window_ms = 2;
+  2: i32 max_window_ms = 64;
+  /**
+   * Flood the merged publication before the window ends once this many keys
+   * are pending.
+   */
+  3: i32 max_batch_keys = 1024;
+}
+
+/**
+ * Class of KvStore keys starting with one of key_prefixes (literal prefixes,
+ * not regexes), see KvstoreConfig.key_classes.
+ */
+struct KvstoreKeyClass {
+  1: string name;
+  2: list<string> key_prefixes;
+}
+
 struct KvstoreConfig {
   /**
    * Set the TTL (in ms) of a key in the KvStore. For larger networks where
@@ -71,6 +98,93 @@ struct KvstoreConfig {
    */
   9: optional bool is_flood_root;
 
+  /**
+   * Set this true to run the KvStore of each area on an event base thread of
+   * its own, instead of sharing one for all areas. Flooding, TTL refresh and
+   * sync in one area are then not delayed by a burst of updates in another.
+   */
+  10: optional bool enable_per_area_event_base;
+
+  /**
+   * Coalesce flooded publications during churn. Disabled if not set.
+   */
+  11: optional KvstoreFloodCoalesce flood_coalesce;
+
+  /**
+   * Flood a new version of a key as a patch of its previous version (see
+   * Types.ValuePatch) when that is much smaller than the new value, e.g. one
+   * changed adjacency in an adjacency database. Must be enabled on all nodes
+   * of an area, stores without it ignore patched values until the next
+   * full-sync.
+   */
+  12: optional bool enable_flood_value_patch;
+
+  /**
+   * Fraction of locally originated updates, in [0, 1], which are traced end
+   * to end: every flooding hop, queue and Decision/Fib stage they go through
+   * on every node is recorded as a span of their PerfEvents. Traces are
+   * exported with Fib perf events (getPerfDb and ROUTE_CONVERGENCE logs).
+   * Disabled if not set.
+   */
+  13: optional double perf_trace_sample_rate;
+
+  /**
+   * With flooding-optimization, flood each locally originated publication on
+   * the SPT of one of the healthy flood-roots picked by hashing its keys,
+   * instead of always on the SPT of the smallest root. Flooding load is then
+   * spread over several spanning trees. Other nodes keep flooding on the
+   * root picked by the originator, so this may be enabled node by node.
+   */
+  14: optional bool enable_flood_root_load_balancing;
+
+  /**
+   * Send values of at least 1KB, e.g. adjacency databases with many
+   * adjacencies, zstd compressed in publications flooded to peers and in
+   * full-sync responses. Only peers running a version which can decompress
+   * them get compressed values, so this may be enabled node by node.
+   */
+  15: optional bool enable_flood_value_compression;
+
+  /**
+   * Write a snapshot of the key-values of each area to
+   * `<snapshot_file_path>.<area>` every snapshot_interval_s seconds. After a
+   * restart, KvStore loads the snapshot (TTLs reduced by the time passed
+   * since) before syncing with its first peer, which then only sends what
+   * changed. Disabled if not set.
+   */
+  16: optional string snapshot_file_path;
+  17: optional i32 snapshot_interval_s;
+
+  /**
+   * Receive floods of peers over a long lived stream per peer, see
+   * OpenrCtrlCpp.subscribeKvStorePeerFlood, instead of one call per
+   * publication. Floods then cost one-way network time, and a slow peer
+   * gets its updates coalesced instead of calls piling up. Peers which
+   * don't stream floods, e.g. running an older version, keep flooding
+   * with calls, so this may be enabled node by node.
+   */
+  18: optional bool enable_flood_stream;
+
+  /**
+   * With flood_rate set, also rate limit floods of the keys of each
+   * originator on a token bucket of its own. Keys of an originator above its
+   * rate are held back without using up the flood rate of others, so a
+   * single misbehaving originator can't starve the updates of the rest.
+   * Adjacency keys are always rate limited apart from other keys, on a token
+   * bucket of flood_rate, and flood ahead of them during a storm.
+   */
+  19: optional KvstoreFloodRate originator_flood_rate;
+
+  /**
+   * Priority classes of keys, highest priority first. A key belongs to the
+   * first class with a matching prefix, keys of no class to the implicit
+   * lowest priority class `default`. Keys of higher priority classes of a
+   * publication are flooded and delivered to subscribers first, and merged
+   * first out of large full-sync responses. Each class gets its own
+   * kvstore.key_class.<name>.* counters.
+   */
+  20: optional list<KvstoreKeyClass> key_classes;
+
   /**
   * Set buffering size for KvStore socket communication. Updates to neighbor node during
   * flooding can be buffered upto this number. For larger networks where burst of updates
@@ -85,6 +199,59 @@ struct KvstoreConfig {
   200: bool enable_thrift_dual_msg = false;
 } (cpp.minimize_padding)
 
+/**
+ * Penalty based prefix flap dampening, in the spirit of BGP route flap
+ * dampening (RFC 2439). Withdrawal of an advertised prefix adds
+ * withdraw_penalty to its penalty, a change of its best prefix entry adds
+ * attribute_change_penalty. Penalty decays exponentially with half_life_ms.
+ * Routes of a prefix are withheld from Fib once its penalty reaches
+ * suppress_threshold, until it decays below reuse_threshold, but for no
+ * longer than max_suppress_ms. Only prefixes of prefix_types are dampened.
+ */
+struct PrefixDampeningConfig {
+  1: i32 withdraw_penalty = 1000;
+  2: i32 attribute_change_penalty = 500;
+  3: i32 suppress_threshold = 2000;
+  4: i32 reuse_threshold = 750;
+  5: i32 half_life_ms = 60000;
+  6: i32 max_suppress_ms = 300000;
+  7: set<Network.PrefixType> prefix_types = [
+    Network.PrefixType.BGP,
+    Network.PrefixType.VIP,
+  ];
+}
+
+/**
+ * Segment routing traffic engineering (SR-TE) policy headed at this node.
+ * Decision computes the shortest path to `destination` satisfying all
+ * constraints (CSPF) and steers routes of `prefixes` advertised by
+ * `destination` onto it, with the label stack encoding the path. Routes fall
+ * back to shortest paths while no path satisfies the constraints.
+ *
+ * Affinity constraints are matched against `Adjacency.adminGroups` of every
+ * link on the path:
+ * - include_any: link has at least one of the groups, if non-zero
+ * - include_all: link has all of the groups
+ * - exclude_any: link has none of the groups
+ *
+ * Paths of policies of the same `disjoint_group` share no link. They are
+ * computed in order of policy name, each avoiding the links of the ones
+ * before. Node segment labels are used wherever the shortest path between
+ * two nodes of the path is unique and follows it, adjacency segment labels
+ * otherwise. Paths needing more than `max_segments` labels are rejected.
+ */
+struct SrPolicyConfig {
+  1: string name;
+  2: string destination;
+  3: list<string> prefixes = [];
+  4: i64 include_any = 0;
+  5: i64 include_all = 0;
+  6: i64 exclude_any = 0;
+  7: optional i64 max_metric;
+  8: optional string disjoint_group;
+  9: i32 max_segments = 10;
+}
+
 struct DecisionConfig {
   /** Fast reaction time to update decision SPF upon receiving adj db update
   (in milliseconds). */
@@ -92,11 +259,78 @@ struct DecisionConfig {
   /** Decision debounce time to update SPF in frequent adj db update
     (in milliseconds). */
   2: i32 debounce_max_ms = 250;
+  /** Number of threads used to compute per-prefix routes on a full route
+    rebuild. With 1 (default) routes are computed on the Decision thread. */
+  3: i32 route_build_threads = 1;
+  /** Number of threads used to deserialize values of large KvStore
+    publications ahead of applying them. With 1 (default) values are
+    deserialized on the Decision thread. */
+  4: i32 publication_decode_threads = 1;
+  /** Adapt the route rebuild debounce to the rate of updates and the cost
+    of the last rebuild. Isolated updates are processed right away, the
+    window grows during update storms, bounded by debounce_max_ms. */
+  5: bool enable_adaptive_debounce = false;
+  /** Compute loop-free alternates (RFC 5286) of IP routes and ship them to
+    Fib as backup next-hops, for platforms to reroute locally upon next-hop
+    failure. */
+  6: bool enable_lfa = false;
+  /** Unequal cost multipath. Weight next-hops of IP routes by the capacity
+    of the shortest paths through them, from adjacency weights along the
+    shortest path DAG, instead of spreading traffic evenly. Weights are
+    normalized to a bounded integer total. */
+  7: bool enable_ucmp = false;
+  /** Dampen routes of flapping prefixes, see PrefixDampeningConfig. Not
+    dampened if not set. */
+  8: optional PrefixDampeningConfig prefix_dampening_config;
+  /** Split route updates into priority lanes. Withdrawals and route changes
+    caused by topology changes, e.g. link failures, are published ahead of
+    bulk route changes, which Fib programs in slices and preempts whenever
+    high priority route updates arrive. */
+  9: bool enable_route_update_lanes = false;
+  /** Segment routing policies, see SrPolicyConfig. Requires segment routing
+    labels to be enabled at the nodes the policy paths go through. */
+  10: list<SrPolicyConfig> sr_policies = [];
+  /** Persist computed routes and, after a restart, publish them to Fib
+    right away. The route rebuild at the end of the cold start (eor_time_s)
+    then only publishes the difference. Snapshots older than
+    Constants::kDecisionRouteDbSnapshotMaxAge are ignored. Requires
+    eor_time_s, best paired with fib_programming_config's
+    enable_graceful_restart. */
+  11: bool enable_warm_start = false;
 
   /** Knob to enable/disable BGP route programming. */
   101: bool enable_bgp_route_programming = true;
 }
 
+/**
+ * Penalty based link-flap dampening, in the spirit of BGP route flap
+ * dampening (RFC 2439). Every link flap adds penalty_per_flap to the penalty
+ * of the interface, which decays exponentially with half_life_ms. Interface is
+ * suppressed once its penalty reaches suppress_threshold and is reused once it
+ * decays below reuse_threshold. Penalty is capped such that an interface is
+ * never suppressed for longer than max_suppress_ms.
+ */
+struct LinkFlapDampeningConfig {
+  1: i32 penalty_per_flap = 1000;
+  2: i32 suppress_threshold = 2000;
+  3: i32 reuse_threshold = 750;
+  4: i32 half_life_ms = 60000;
+  5: i32 max_suppress_ms = 300000;
+}
+
+/**
+ * Quantization of RTT based metrics, to keep RTT jitter from re-advertising
+ * adjacencies. RTT is rounded down to bands of band_width_us and the metric of
+ * an adjacency only changes once RTT leaves the band of its advertised RTT by
+ * more than hysteresis_us. Metric of an adjacency changes at most once every
+ * min_hold_time_ms, later changes are held back until then.
+ */
+struct RttMetricQuantizationConfig {
+  1: i32 band_width_us = 1000;
+  2: i32 hysteresis_us = 200;
+  3: i32 min_hold_time_ms = 30000;
+}
+
 struct LinkMonitorConfig {
   /**
    * When link goes down after being stable/up for long time, then the backoff
@@ -134,6 +368,35 @@ struct LinkMonitorConfig {
   * Enable convergence performance measurement for adjacency updates.
   */
   7: bool enable_perf_measurement = true;
+
+  /**
+   * Coalescing of adjacency advertisements. Adjacency changes are advertised
+   * once no further change happened for adj_advertise_min_interval_ms, but no
+   * later than adj_advertise_max_delay_ms after the first pending change.
+   * Neighbor down events are advertised right away, unless an advertisement
+   * was made within the last adj_advertise_min_interval_ms.
+   */
+  8: i32 adj_advertise_min_interval_ms = 100;
+  9: i32 adj_advertise_max_delay_ms = 1000;
+
+  /**
+   * If set, penalty based dampening is used for flapping links instead of
+   * the exponential backoff specified by linkflap_initial_backoff_ms and
+   * linkflap_max_backoff_ms.
+   */
+  10: optional LinkFlapDampeningConfig linkflap_dampening_config;
+
+  /**
+   * Administrative groups of adjacencies formed over an interface, by
+   * interface name. See `Adjacency.adminGroups`.
+   */
+  11: map<string, i64> interface_admin_groups = {};
+
+  /**
+   * If set, RTT based metrics (see use_rtt_metric) are quantized into bands
+   * with hysteresis and hold time instead of following every RTT change.
+   */
+  12: optional RttMetricQuantizationConfig rtt_metric_quantization_config;
 }
 
 struct StepDetectorConfig {
@@ -144,6 +407,20 @@ struct StepDetectorConfig {
   5: i64 ads_threshold = 500;
 }
 
+/**
+ * Fast neighbor failure detection, in the spirit of BFD. Minimal heartbeats
+ * are exchanged with established neighbors every tx_interval_ms on a
+ * dedicated thread, over UDP port `port`. Adjacency is brought down when none
+ * is received for detect_multiplier intervals. Detection only starts once the
+ * first packet of a neighbor is received, neighbors without fast detection
+ * rely on regular heartbeats.
+ */
+struct SparkFastDetectionConfig {
+  1: i32 tx_interval_ms = 50;
+  2: i32 detect_multiplier = 3;
+  3: i32 port = 6667;
+}
+
 struct SparkConfig {
   1: i32 neighbor_discovery_port = 6666;
   /** How often to send SparkHelloMsg to neighbors. */
@@ -171,6 +448,38 @@ struct SparkConfig {
   6: i32 graceful_restart_time_s = 30;
 
   7: StepDetectorConfig step_detector_conf;
+
+  /**
+   * Detect neighbor failures within tx_interval_ms * detect_multiplier, in
+   * addition to hold_time_s. Disabled if not set.
+   */
+  8: optional SparkFastDetectionConfig fast_detection_config;
+
+  /**
+   * Number of event bases processing Spark packets. Interfaces are sharded
+   * across them, so packets of different interfaces are processed in
+   * parallel. Neighbors of an interface are always handled by the same one.
+   */
+  9: i32 num_workers = 1;
+}
+
+/**
+ * Placement and scheduling of the thread running a module's event base
+ */
+struct ThreadConfig {
+  /**
+   * Name of the thread, `openr-<module>` if not set. At most 15 characters.
+   */
+  1: optional string thread_name;
+  /**
+   * CPUs the thread is allowed to run on. Thread can run on any CPU if empty.
+   */
+  2: list<i32> cpu_affinity = [];
+  /**
+   * Nice value of the thread, in range [-20, 19]. Lower value means higher
+   * scheduling priority. Negative values require CAP_SYS_NICE.
+   */
+  3: optional i32 nice;
 }
 
 struct WatchdogConfig {
@@ -185,6 +494,11 @@ struct WatchdogConfig {
    * useful to guarantee protocol doesn’t cause trouble to other services on
    * device where it runs and takes care of slow memory leak kind of issues. */
   3: i32 max_memory_mb = 800;
+  /**
+   * Allow sampling profiles of the Open/R threads, started with the
+   * `startProfiler` ctrl API. Profiles are sampled by thread CPU time, at a
+   * bounded frequency for a bounded duration. */
+  4: bool enable_profiler = false;
 }
 
 struct MonitorConfig {
@@ -192,6 +506,12 @@ struct MonitorConfig {
   1: i32 max_event_log = 100;
   /** If set, will enable Monitor::processEventLog() to submit the event logs. */
   2: bool enable_event_log_submission = true;
+  /**
+   * If set, counters are exported every second into a read-only shared memory
+   * file at this path, e.g. `/dev/shm/openr_counters`. Local agents can then
+   * scrape them with `CounterSegmentReader` without RPC. Disabled if not set.
+   */
+  3: optional string counter_export_path;
 }
 
 struct MemoryProfilingConfig {
@@ -246,6 +566,12 @@ struct ThriftServerConfig {
   9: optional string ticket_seed_path;
   /** Verify type for client when enabling secure server. */
   10: optional VerifyClientType verify_client_type;
+  /** Number of IO threads of the OpenrCtrl thrift server. */
+  11: i32 num_io_worker_threads = 1;
+  /** Number of CPU worker threads running OpenrCtrl handler calls. Reads
+  served from module snapshots run on these threads, while other calls are
+  forwarded to module event bases. */
+  12: i32 num_cpu_worker_threads = 1;
 }
 
 struct ThriftClientConfig {
@@ -255,6 +581,19 @@ struct ThriftClientConfig {
   2: VerifyServerType verify_server_type;
 }
 
+/**
+ * Buffering of updates of ctrl streaming APIs (subscribeAndGetKvStore,
+ * subscribeAndGetFib, ...) for subscribers which don't keep up.
+ */
+struct CtrlStreamConfig {
+  /** Updates buffered for a subscriber. Past it, further updates are
+  coalesced to the latest state per key or route. */
+  1: i32 max_buffered_updates = 1000;
+  /** Keys or routes coalesced for a subscriber. Past it, the subscriber is
+  disconnected and must subscribe again to resync with a snapshot. */
+  2: i32 max_coalesced_entries = 100000;
+}
+
 enum PrefixForwardingType {
   /** IP nexthop is used for routing to the prefix. */
   IP = 0,
@@ -319,6 +658,22 @@ struct PrefixAllocationConfig {
    * set as 80, /80 prefix will be elected for a node. e.g. face:b00c:0:0:1234::/80
    */
   6: optional i32 allocate_prefix_len;
+
+  /**
+   * Re-claim the prefix index persisted from the previous incarnation right
+   * away, advertising the prefix before the allocation is confirmed through
+   * KvStore. The claim is validated asynchronously and the prefix is replaced
+   * if another node owns the index.
+   */
+  7: bool enable_fast_reclaim = false;
+
+  /**
+   * Batch contention resolution for mass reboots. Nodes without a persisted
+   * prefix index wait for this long before claiming one, so that rebooting
+   * nodes re-claim their persisted indices first. New claims then pick among
+   * the remaining free indices in one step. Disabled if 0.
+   */
+  8: i32 batch_claim_hold_time_ms = 0;
 }
 
 struct OriginatedPrefix {
@@ -558,6 +913,15 @@ struct AreaConfig {
    * should be unique per device per area.
    */
   8: optional SegmentRoutingNodeLabel area_sr_node_label;
+
+  /**
+   * Summary prefixes of routes redistributed into this area from other
+   * areas. Routes more specific than a summary prefix are not redistributed
+   * into this area, the summary prefix is advertised instead as long as at
+   * least one of them exists. Routes which came from this area, as per their
+   * area stack, don't count.
+   */
+  9: list<string> summary_prefixes;
 } (cpp.minimize_padding)
 
 /**
@@ -625,6 +989,74 @@ struct BgpRouteTranslationConfig {
   10: bool disable_legacy_translation = 0;
 } (cpp.minimize_padding)
 
+/**
+ * Pipelined programming of route updates. Each kind of route update is sent to
+ * the FIB agent in chunks of chunk_size routes, with up to
+ * max_chunks_in_flight calls outstanding, instead of in one blocking call. A
+ * chunk which fails is retried on its own before falling back to a full sync
+ * of the route database.
+ */
+struct FibProgrammingConfig {
+  1: i32 chunk_size = 1000;
+  2: i32 max_chunks_in_flight = 4;
+
+  /**
+   * Unicast routes of prefixes of these types, or carrying any of these tags,
+   * are programmed ahead of all other route updates. E.g. loopbacks restoring
+   * reachability of nodes ahead of thousands of service prefixes. Time taken
+   * to program them is logged as FIB_HIGH_PRIORITY_ROUTES_PROGRAMMED perf
+   * event.
+   */
+  3: set<Network.PrefixType> high_priority_prefix_types = [
+    Network.PrefixType.LOOPBACK,
+  ];
+  4: set<string> high_priority_prefix_tags;
+
+  /**
+   * Sync the route database by fetching the routes of the FIB agent and
+   * programming only the difference, instead of sending all routes. Avoids
+   * reprogramming the whole table on the agent after an Open/R restart. Falls
+   * back to a full sync if fetching or programming the difference fails.
+   */
+  5: bool enable_incremental_sync = false;
+
+  /**
+   * Persist a digest of the programmed routes and, after an Open/R restart,
+   * program only the routes which differ from it. Routes of the FIB agent are
+   * left in place until the first sync, so forwarding is hitless as long as
+   * the agent keeps running. Falls back to regular sync if the agent restarted
+   * as well, or no valid digest was persisted.
+   */
+  6: bool enable_graceful_restart = false;
+
+  /**
+   * Keep only what route programming needs of the routes received from
+   * Decision, i.e. drop their best prefix entries, which Decision holds
+   * anyway. Route details served by the ctrl API are then completed from
+   * the latest route snapshot of Decision.
+   */
+  7: bool enable_compact_route_state = false;
+
+  /**
+   * Programming latency objective of a route, from the start of programming
+   * of its route update to the FIB agent acknowledging it. Routes exceeding
+   * it are counted in fib.route_programming.slo_exceeded_routes and their
+   * update is marked with a FIB_ROUTE_PROGRAMMING_SLO_EXCEEDED perf event.
+   */
+  8: optional i32 route_programming_slo_ms;
+
+  /**
+   * Shadow programming: every unicast route update is also programmed, after
+   * the forwarding routes, into this Linux routing table via a separate FIB
+   * agent connection. The table must not be referenced by any policy rule,
+   * so it doesn't forward. Programming time and throughput are reported as
+   * fib.shadow.* counters, side by side with the production ones. Shadow
+   * failures only cause a resync of the shadow table. With dryrun, only the
+   * shadow table is programmed. Disabled if not set.
+   */
+  9: optional i32 shadow_table_id;
+} (cpp.minimize_padding)
+
 struct OpenrConfig {
   1: string node_name;
   /** Deprecated. Use area config. */
@@ -833,6 +1265,76 @@ struct OpenrConfig {
   */
   58: bool enable_fib_ack = false;
 
+  /**
+   * Program route updates in chunks pipelined over the FIB agent connection.
+   * Route updates are programmed in one call per kind of update if not set.
+   */
+  59: optional FibProgrammingConfig fib_programming_config;
+
+  /**
+   * Program ECMP unicast routes with nexthop group objects in
+   * NetlinkFibHandler, instead of inline next-hops. Routes sharing
+   * next-hops refer to one group, shrinking route messages. Requires Linux 5.3
+   * or later.
+   */
+  60: bool enable_netlink_nexthop_objects = false;
+
+  /**
+   * Thread configuration of modules, keyed by module name, i.e. `kvstore`,
+   * `decision`, `fib`, `spark`, `link_monitor`, `prefix_manager`, `monitor`,
+   * `prefix_allocator`, `netlink`, `config_store` and `watchdog`. Modules not
+   * listed run with default thread attributes.
+   */
+  61: map<string, ThreadConfig> thread_configs = {};
+
+  /**
+   * Limits of buffered updates of ctrl streaming APIs per subscriber
+   */
+  62: CtrlStreamConfig ctrl_stream_config;
+
+  /**
+   * Pack advertised prefixes into this number of hash bucketed KvStore keys
+   * per area, `prefixshard:<node>:<area>:<shard>`, instead of one key per
+   * prefix. Only shards with changed prefixes are re-advertised. Cuts the
+   * number of keys, and hence TTL refreshes and full-sync sizes, for nodes
+   * advertising many prefixes. All nodes (Decision) must understand sharded
+   * prefix keys before enabling it. Disabled if 0.
+   */
+  63: i32 num_prefix_db_shards = 0;
+
+  /**
+   * Number of threads PrefixManager uses to select best entries, apply area
+   * policies and serialize values of changed prefixes when syncing them to
+   * KvStore in chunks. With 1 (default) the sync runs on the PrefixManager
+   * thread only.
+   */
+  64: i32 prefix_manager_sync_threads = 1;
+
+  /**
+   * Let node label and prefix index allocation pick values among the free
+   * ones of a bitmap of the range, built from the allocation keys in KvStore,
+   * instead of probing values one at a time. Converges faster when the range
+   * is nearly consumed.
+   */
+  65: bool enable_range_allocator_bitmap = false;
+
+  /**
+   * Keep persistent config store as log segments next to
+   * `persistent_config_store_path`, compacted in the background, instead of
+   * periodically rewriting the whole file. Segments are memory mapped on
+   * startup. An existing store file is migrated into the first segment, so
+   * disabling it again starts with an empty store.
+   */
+  66: bool enable_log_structured_config_store = false;
+
+  /**
+   * Group commit window of persistent config store. Writes within the window
+   * are appended with one writev and fdatasync, and their futures complete
+   * once the batch is durable. Disabled if 0, writes complete immediately and
+   * are flushed to disk in the background.
+   */
+  67: i32 config_store_group_commit_ms = 0;
+
   # vip thrift injection service
   90: optional bool enable_vip_service;
 
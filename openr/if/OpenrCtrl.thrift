@@ -59,6 +59,35 @@ struct AdvertisedRouteFilter {
   2: optional Network.PrefixType prefixType;
 }
 
+/**
+ * Batch of prefix changes applied atomically by PrefixManager. Withdrawals are
+ * applied before advertisements, hence a prefix present in both ends up
+ * advertised.
+ */
+struct PrefixChangeBatch {
+  1: list<Types.PrefixEntry> prefixesToAdvertise;
+  2: list<Types.PrefixEntry> prefixesToWithdraw;
+  // Sync changes to KvStore right away instead of after the throttle timeout
+  3: bool syncImmediately = true;
+}
+
+/**
+ * Timing of a PrefixChangeBatch, as measured on PrefixManager's event base
+ */
+struct PrefixChangeBatchResult {
+  // Whether the batch changed any advertised entry
+  1: bool updated;
+  // Time spent applying the batch to PrefixManager's prefix db
+  2: i64 applyTimeUs;
+  // Whether changes were synced, false if deferred to the throttled sync e.g.
+  // before the initial KvStore sync
+  3: bool synced;
+  // Number of changed prefixes synced, including the ones pending from earlier
+  // calls, and time spent syncing them. 0 if not synced
+  4: i64 numPrefixesSynced;
+  5: i64 syncTimeUs;
+}
+
 //
 // Decision data structures
 //
@@ -215,6 +244,133 @@ struct RouteDatabaseDeltaDetail {
   4: list<i32> mplsRoutesToDelete;
 }
 
+//
+// Compact Fib stream, see OpenrCtrlCpp.subscribeAndGetFibCompact()
+//
+
+/**
+ * Prefixes are packed as the network address bytes (4 or 16) followed by one
+ * byte of prefix length. Next-hops are dictionary coded, routes reference a
+ * next-hop group by id.
+ */
+struct UnicastRouteCompact {
+  1: binary prefix;
+  2: i64 nextHopGroupId;
+  3: optional Network.AdminDistance adminDistance;
+}
+
+struct MplsRouteCompact {
+  1: i32 topLabel;
+  2: i64 nextHopGroupId;
+  3: optional Network.AdminDistance adminDistance;
+}
+
+/**
+ * Delta of routes and of the next-hop group dictionary. Apply
+ * `nextHopGroupsToAdd` first, then routes, then `nextHopGroupsToDelete`.
+ * Groups are immutable and their ids are never reused by the server, groups
+ * are deleted once no route references them.
+ */
+struct RouteDatabaseDeltaCompact {
+  1: map<i64, list<Network.NextHopThrift>> nextHopGroupsToAdd;
+  2: list<UnicastRouteCompact> unicastRoutesToUpdate;
+  3: list<binary> unicastRoutesToDelete;
+  4: list<MplsRouteCompact> mplsRoutesToUpdate;
+  5: list<i32> mplsRoutesToDelete;
+  6: list<i64> nextHopGroupsToDelete;
+}
+
+/**
+ * Execution time of a named callback run by an event base
+ */
+struct CallbackProfile {
+  1: string name;
+  2: i64 count = 0;
+  3: i64 total_us = 0;
+  4: i64 max_us = 0;
+}
+
+/**
+ * Loop iteration latency and slowest callbacks of a module's event base
+ */
+struct EventBaseProfile {
+  1: string evb_name;
+  /** Busy time of recent loop iterations */
+  2: i64 loop_time_p50_us = 0;
+  3: i64 loop_time_p99_us = 0;
+  /** Busy time of the slowest loop iteration since start */
+  4: i64 loop_time_max_us = 0;
+  /** Callbacks with highest max execution time, slowest first */
+  5: list<CallbackProfile> slow_callbacks;
+}
+
+/**
+ * Position of a client in the stream of counter changes, see
+ * getRegexCountersDelta(). Versions are only comparable within the same
+ * `epoch`, i.e. the same server instance.
+ */
+struct CountersDeltaToken {
+  1: i64 epoch = 0;
+  2: i64 version = 0;
+}
+
+struct CountersDelta {
+  /** Matching counters whose value changed since the given token */
+  1: map<string, i64> counters;
+  /** Token to pass to the next call */
+  2: CountersDeltaToken token;
+  /** Set if `counters` holds all matching counters, e.g. on first call */
+  3: bool isFullDump = false;
+}
+
+//
+// Paginated dumps
+//
+
+/**
+ * Cursor based pagination of bulk dumps. Entries are returned in ascending key
+ * order, up to `limit` per page, starting after `cursor` or from the start if
+ * not set. `nextCursor` of a page is set if there may be more entries.
+ *
+ * No snapshot is held between pages. Entries added, updated or removed while
+ * paging may or may not be reflected in later pages.
+ *
+ * Cursors are opaque and only meant to be passed back to the same API.
+ */
+struct PageParams {
+  1: optional string cursor;
+  2: i32 limit = 1000;
+}
+
+struct KvStoreKeyValsPage {
+  1: Types.Publication publication;
+  2: optional string nextCursor;
+}
+
+/*
+ * Unicast routes are returned first, then MPLS routes
+ */
+struct RouteDatabaseDetailPage {
+  1: RouteDatabaseDetail routeDb;
+  2: optional string nextCursor;
+}
+
+struct ReceivedRoutesPage {
+  1: list<ReceivedRouteDetail> routes;
+  2: optional string nextCursor;
+}
+
+/**
+ * Version vector of adjacencies in KvStore, see watchKvStoreAdj(). Holds the
+ * generation of every watched area, bumped whenever an `adj:` key of the area
+ * is added, updated or expired. Generations are only comparable within the
+ * same `epoch`, i.e. the same server instance.
+ */
+struct KvStoreAdjWatchToken {
+  1: i64 epoch = 0;
+  2: map<string, i64> generations;
+}
+
 /**
  * Thrift service - exposes RPC APIs for interaction with all of Open/R's
  * modules.
@@ -244,6 +400,15 @@ service OpenrCtrl extends fb303_core.BaseService {
    */
   string dryrunConfig(1: string file) throws (1: OpenrError error);
 
+  /**
+   * Load config from file and apply it without restarting Open/R. Changes of
+   * area regexes, spark hello timers and originated prefixes are applied in
+   * place by the modules. Config with any other change is rejected, as it
+   * can only be applied upon restart.
+   * Loaded content is returned like in dryrunConfig.
+   */
+  string reloadConfig(1: string file) throws (1: OpenrError error);
+
   //
   // PrefixManager APIs
   //
@@ -280,6 +445,14 @@ service OpenrCtrl extends fb303_core.BaseService {
     2: list<Types.PrefixEntry> prefixes,
   ) throws (1: OpenrError error);
 
+  /**
+   * Advertise and withdraw prefixes in a single transaction. All changes of
+   * the batch are applied at once and synced to KvStore in one pass.
+   */
+  PrefixChangeBatchResult applyPrefixChanges(
+    1: PrefixChangeBatch batch,
+  ) throws (1: OpenrError error);
+
   /**
    * Get all prefixes being advertised
    * @deprecated - use getAdvertisedRoutes() instead
@@ -328,6 +501,14 @@ service OpenrCtrl extends fb303_core.BaseService {
     1: ReceivedRouteFilter filter,
   ) throws (1: OpenrError error);
 
+  /**
+   * Paginated variant of getReceivedRoutesFiltered, paged by prefix
+   */
+  ReceivedRoutesPage getReceivedRoutesFilteredPage(
+    1: ReceivedRouteFilter filter,
+    2: PageParams page,
+  ) throws (1: OpenrError error);
+
   /**
    * Get route database of the current node. It is retrieved from FIB module.
    */
@@ -338,6 +519,13 @@ service OpenrCtrl extends fb303_core.BaseService {
    */
   RouteDatabaseDetail getRouteDetailDb() throws (1: OpenrError error);
 
+  /**
+   * Paginated variant of getRouteDetailDb
+   */
+  RouteDatabaseDetailPage getRouteDetailDbPage(1: PageParams page) throws (
+    1: OpenrError error,
+  );
+
   /**
    * Get route database from decision module. Since Decision has global
    * topology information, any node can be retrieved.
@@ -461,6 +649,16 @@ service OpenrCtrl extends fb303_core.BaseService {
     2: string area,
   ) throws (1: OpenrError error);
 
+  /**
+   * Paginated variant of getKvStoreKeyValsFilteredArea, paged by key.
+   * `keyValHashes` and `keyValBucketHashes` of filter are not supported.
+   */
+  KvStoreKeyValsPage getKvStoreKeyValsFilteredAreaPage(
+    1: Types.KeyDumpParams filter,
+    2: string area,
+    3: PageParams page,
+  ) throws (1: OpenrError error);
+
   /**
    * Get kvstore metadata (no values) with filter
    */
@@ -499,6 +697,20 @@ service OpenrCtrl extends fb303_core.BaseService {
     1: OpenrError error,
   );
 
+  /**
+   * Watch adjacency changes in KvStore. Returns the current token of
+   * `selectAreas` (all configured areas if empty) as soon as it differs from
+   * the given one, or the same token once the hold time elapsed without
+   * change. Start with a default token to get the current one immediately.
+   *
+   * Unlike longPollKvStoreAdjArea(), which diffs a snapshot of all `adj:` keys
+   * on every request, watches are answered from generation counters.
+   */
+  KvStoreAdjWatchToken watchKvStoreAdj(
+    1: set<string> selectAreas,
+    2: KvStoreAdjWatchToken token,
+  ) throws (1: OpenrError error);
+
   /**
    * Send Dual message
    */
@@ -625,6 +837,22 @@ service OpenrCtrl extends fb303_core.BaseService {
    */
   Types.BuildInfo getBuildInfo() throws (1: OpenrError error);
 
+  /**
+   * Command to request loop latency and slowest callbacks of every module's
+   * event base
+   */
+  list<EventBaseProfile> getEventBaseProfiles() throws (1: OpenrError error);
+
+  /**
+   * Counters matching `regex` (like getRegexCounters()) which changed since
+   * the call that returned `token`. Start with a default token to get all
+   * matching counters. Removed counters are not reported.
+   */
+  CountersDelta getRegexCountersDelta(
+    1: string regex,
+    2: CountersDeltaToken token,
+  ) throws (1: OpenrError error);
+
   //
   // PersistentStore APIs (query / alter dynamic configuration)
   //
@@ -670,6 +898,20 @@ service OpenrCtrl extends fb303_core.BaseService {
   // Get log events
   list<string> getEventLogs() throws (1: OpenrError error);
 
+  //
+  // Profiler APIs, see WatchdogConfig.enable_profiler
+  //
+
+  // Sample stacks of the Open/R threads for durationS seconds, frequencyHz
+  // times per second of CPU time of each thread. Restarts a running profile
+  void startProfiler(1: i32 durationS, 2: i32 frequencyHz) throws (
+    1: OpenrError error,
+  );
+
+  // Samples of the current or last profile as folded stacks, one line per
+  // stack: `<thread>;<outermost frame>;...;<innermost frame> <count>`
+  string getProfilerFoldedStacks() throws (1: OpenrError error);
+
   // Get Openr Node Name
   string getMyNodeName();
 
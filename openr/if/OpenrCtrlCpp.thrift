@@ -52,4 +52,52 @@ service OpenrCtrlCpp extends OpenrCtrl.OpenrCtrl {
   OpenrCtrl.RouteDatabaseDetail, stream<
     OpenrCtrl.RouteDatabaseDeltaDetail
   > subscribeAndGetFibDetail();
+
+  /**
+   * Compact variant of subscribeAndGetFib() for high rate collectors, see
+   * OpenrCtrl.RouteDatabaseDeltaCompact. The snapshot holds all routes of Fib
+   * along with the next-hop groups they reference, and is consistent with
+   * the stream, i.e. no update is lost or replicated.
+   */
+  OpenrCtrl.RouteDatabaseDeltaCompact, stream<
+    OpenrCtrl.RouteDatabaseDeltaCompact
+  > subscribeAndGetFibCompact();
+
+  /**
+   * Streaming variants of bulk dumps. Pages of up to `page.limit` entries are
+   * produced one after another as the client consumes them, releasing the
+   * module's event base in between, and the stream completes after the last
+   * page. See OpenrCtrl.PageParams.
+   *
+   * `nextCursor` of the last page received can be used to resume a stream
+   * interrupted by the client.
+   */
+  stream<OpenrCtrl.KvStoreKeyValsPage> streamKvStoreKeyValsFilteredArea(
+    1: Types.KeyDumpParams filter,
+    2: string area,
+    3: OpenrCtrl.PageParams page,
+  );
+  stream<OpenrCtrl.RouteDatabaseDetailPage> streamRouteDetailDb(
+    1: OpenrCtrl.PageParams page,
+  );
+  stream<OpenrCtrl.ReceivedRoutesPage> streamReceivedRoutesFiltered(
+    1: OpenrCtrl.ReceivedRouteFilter filter,
+    2: OpenrCtrl.PageParams page,
+  );
+
+  /**
+   * Stream of the publications this node floods to KvStore peer `peerName`
+   * in `area`, in place of setKvStoreKeyVals() calls. Opened by the peer,
+   * which applies stream items as it would apply the calls. Publications
+   * are buffered and coalesced while the peer lags behind, and the stream
+   * completes with an error once the peer lags too much, for the peer to
+   * sync again. Replaces the previous stream of the peer in the area, if any.
+   *
+   * Fails if streaming floods is not enabled, see
+   * KvstoreConfig.enable_flood_stream.
+   */
+  stream<Types.KeySetParams> subscribeKvStorePeerFlood(
+    1: string area,
+    2: string peerName,
+  ) throws (1: OpenrCtrl.OpenrError error);
 }
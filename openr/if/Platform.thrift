@@ -102,6 +102,34 @@ service FibService extends fb303_core.BaseService {
     1: PlatformError error,
   );
 
+  //
+  // VRF Unicast Routes API. Routes are keyed by Linux routing table ID, one
+  // per VRF. Main table is programmed with API above, and can't be used here
+  // along with local and unspecified tables.
+  //
+  void addUnicastRoutesInTables(
+    1: i16 clientId,
+    2: map<i32, list<Network.UnicastRoute>> tableRoutes,
+  ) throws (1: PlatformError error);
+
+  void deleteUnicastRoutesInTables(
+    1: i16 clientId,
+    2: map<i32, list<Network.IpPrefix>> tablePrefixes,
+  ) throws (1: PlatformError error);
+
+  // Sync routes of given tables, in one pass over kernel routes for all of
+  // them. Tables programmed by client before, which are missing, are flushed
+  void syncFibTables(
+    1: i16 clientId,
+    2: map<i32, list<Network.UnicastRoute>> tableRoutes,
+  ) throws (1: PlatformError error);
+
+  // Retrieve list of unicast routes per client in table
+  list<Network.UnicastRoute> getRouteTableByClientInTable(
+    1: i16 clientId,
+    2: i32 tableId,
+  ) throws (1: PlatformError error);
+
   //
   // MPLS routes API
   //
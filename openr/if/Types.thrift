@@ -37,11 +37,36 @@ struct PerfEvent {
  * list as data object is originated, observed by node. This helps in tracking
  * things like time it takes for link down event to route convergence in HW.
  */
+/**
+ * Time spent by a traced data object in one stage of its propagation, e.g.
+ * a KvStore flood hop or a queue between two modules. Timestamps are in
+ * microseconds since epoch, `endUs` is 0 while the span is open.
+ */
+struct PerfSpan {
+  1: string stage;
+  2: string startNodeName;
+  3: i64 startUs = 0;
+  4: string endNodeName;
+  5: i64 endUs = 0;
+}
+
 struct PerfEvents {
   /**
    * Ordered list of event. Most recent event is appended at the back
    */
   1: list<PerfEvent> events;
+
+  /**
+   * Set when the data object is sampled for tracing (see
+   * KvstoreConfig.perf_trace_sample_rate). Unique across the network, shared
+   * by all updates triggered by the traced one.
+   */
+  2: optional i64 traceId;
+
+  /**
+   * Stages traversed by a traced data object, in order of their start
+   */
+  3: list<PerfSpan> spans;
 }
 
 /**
@@ -134,6 +159,13 @@ struct Adjacency {
    * established.
    */
   11: string otherIfName = "";
+
+  /**
+   * Administrative groups (aka link colors or affinities) of this adjacency,
+   * as a bitmask of up to 64 groups. Matched against the affinity
+   * constraints of segment routing policies.
+   */
+  12: i64 adminGroups = 0;
 } (cpp.minimize_padding)
 
 /**
@@ -543,6 +575,23 @@ struct DualCounters {
   2: RootCounters rootCounters;
 }
 
+/**
+ * Change of application data relative to an older version of the same key.
+ * The new data is the base data with the bytes between its first
+ * `prefixLength` and last `suffixLength` bytes replaced by `middle`.
+ */
+struct ValuePatch {
+  /**
+   * Version and hash of the Value the patch applies to
+   */
+  1: i64 baseVersion;
+  2: i64 baseHash;
+
+  3: i32 prefixLength;
+  4: i32 suffixLength;
+  5: binary middle;
+}
+
 /**
  * `V` of `KV` Store. It encompasses the data that needs to be synchronized
  * along with few attributes that helps ensure eventual consistency.
@@ -597,6 +646,24 @@ struct Value {
    * operation.
    */
   6: optional i64 hash;
+
+  /**
+   * Set instead of `value` when flooding a new version of a key as a patch of
+   * its previous version. `hash` must be set along with it. A store without
+   * the base version ignores the value and fetches the key from the sender.
+   * Never present in a KvStore data-base, stores apply the patch on receipt.
+   */
+  7: optional ValuePatch patch;
+
+  /**
+   * Set instead of `value` when flooding or syncing a large value to a peer
+   * which accepts compressed values, see
+   * `KeyDumpParams.acceptCompressedValues`. zstd compressed data of the
+   * value, `hash` is the one of the uncompressed data and must be set along
+   * with it. Never present in a KvStore data-base, stores decompress the
+   * value on receipt.
+   */
+  8: optional binary compressedValue;
 } (cpp.minimize_padding)
 
 /**
@@ -671,6 +738,11 @@ struct KeySetParams {
    * system timestamp in milliseconds since epoch
    */
   7: optional i64 timestamp_ms;
+
+  /**
+   * Optional trace of a sampled update, carried across flooding hops
+   */
+  8: optional PerfEvents perfEvents;
 } (cpp.minimize_padding)
 
 /**
@@ -680,6 +752,21 @@ struct KeyGetParams {
   1: list<string> keys;
 }
 
+/**
+ * Position in the change log of a KvStore, see `KeyDumpParams.changesSince`
+ */
+struct KvStoreChangeLogPosition {
+  /**
+   * Identifies the change log, KvStore starts a new one on restart
+   */
+  1: i64 epoch;
+
+  /**
+   * Sequence number of the latest change logged
+   */
+  2: i64 sequence;
+}
+
 /**
  * Request object for retrieving KvStore entries or subscribing KvStore updates.
  * This is more powerful version than KeyGetParams.
@@ -729,6 +816,37 @@ struct KeyDumpParams {
    * getting "adj:.*" keys from open/r domain.
    */
   5: optional list<string> keys;
+
+  /**
+   * Optional per bucket hashes of the requester's KvStore, see
+   * KvStoreBucketHashes. Used for full-sync in place of `keyValHashes`:
+   * responder compares them with its own and ONLY responds with its keyVals
+   * in the buckets which differ, listed in `Publication.keyValBuckets`.
+   */
+  8: optional list<i64> keyValBucketHashes;
+
+  /**
+   * Optional position of the responder's change log which the requester was
+   * in sync with at its previous full-sync, see
+   * `Publication.changeLogPosition`. If the change log still covers it,
+   * responder ONLY responds with its keyVals changed since then and sets
+   * `Publication.changesSince`. Otherwise it falls back to full-sync with
+   * `keyValBucketHashes`.
+   */
+  9: optional KvStoreChangeLogPosition changesSince;
+
+  /**
+   * Name of the requesting node, set by peers in full-sync requests
+   */
+  10: optional string senderId;
+
+  /**
+   * Set by peers which can decompress values. If value compression is
+   * enabled, responder then sends large values of the response, and of the
+   * publications it floods to the requester afterwards, as
+   * `Value.compressedValue`.
+   */
+  11: optional bool acceptCompressedValues;
 } (cpp.minimize_padding)
 
 /**
@@ -831,6 +949,11 @@ struct SptInfo {
    * a set of spt children
    */
   4: PeerNames children;
+
+  /**
+   * number of publications this node flooded on the spt
+   */
+  5: i64 floodPublications = 0;
 }
 
 /**
@@ -934,8 +1057,59 @@ struct Publication {
    * in milliseconds since epoch
    */
   8: optional i64 timestamp_ms;
+
+  /**
+   * Set in response to `KeyDumpParams.keyValBucketHashes`. Buckets on which
+   * hashes differ, `keyVals` holds all of the sender's entries in them. Full-
+   * sync initiator works out `tobeUpdatedKeys` from its own entries in these
+   * buckets.
+   */
+  9: optional list<i32> keyValBuckets;
+
+  /**
+   * Optional trace of a sampled update. Set on flooded publications and on
+   * the ones KvStore sends to its subscribers.
+   */
+  10: optional PerfEvents perfEvents;
+
+  /**
+   * Set in full-sync responses. Position of the sender's change log the
+   * response is in sync with, to ask for changes since in the next full-sync.
+   */
+  11: optional KvStoreChangeLogPosition changeLogPosition;
+
+  /**
+   * Set in response to `KeyDumpParams.changesSince`, `keyVals` ONLY holds
+   * the sender's entries changed since this position.
+   */
+  12: optional KvStoreChangeLogPosition changesSince;
+
+  /**
+   * Set on publications of expired keys KvStore sends to its subscribers.
+   * Originators none of whose keys are left in the area after the expiry,
+   * e.g. a node gone. Subscribers may drop their state of these all at once
+   * rather than key by key.
+   */
+  13: optional list<string> expiredOriginators;
 } (cpp.minimize_padding)
 
+/**
+ * Key-values of a KvStore area written to disk periodically. A restarting
+ * KvStore loads them before syncing with its first peer, the full-sync then
+ * only exchanges what changed in between.
+ */
+struct KvStoreSnapshot {
+  1: string area;
+
+  /**
+   * Unix timestamp when the snapshot was taken. TTLs of the key-values are
+   * the time they had left then
+   */
+  2: i64 timestamp_ms;
+
+  3: KeyVals keyVals;
+}
+
 /**
  * Struct summarizing KvStoreDB for a given area. This is currently used for
  * sending responses to 'breeze kvstore summary'
@@ -1196,6 +1370,73 @@ struct LinkMonitorState {
   5: map<AdjKey, i32> adjMetricOverrides;
 } (cpp.minimize_padding)
 
+/**
+ * Digest of the routes programmed by Fib, persisted for graceful restart of
+ * Open/R. Only valid for the FIB agent instance it was taken with.
+ */
+struct FibRouteDigest {
+  /**
+   * aliveSince of the FIB agent when routes were programmed
+   */
+  1: i64 agentAliveSince;
+
+  /**
+   * Hash of unicast route, keyed by prefix
+   */
+  2: map<string, i64> unicastRouteHashes;
+
+  /**
+   * Hash of MPLS route, keyed by top label
+   */
+  3: map<i32, i64> mplsRouteHashes;
+}
+
+/**
+ * Unicast route of a DecisionRouteDbSnapshot
+ */
+struct DecisionUnicastRouteEntry {
+  1: Network.IpPrefix prefix;
+
+  /**
+   * Index into nextHopGroups of the snapshot
+   */
+  2: i32 nextHopGroup;
+
+  3: list<Network.NextHopThrift> backupNextHops;
+  4: PrefixEntry bestPrefixEntry;
+  5: string bestArea;
+  6: bool doNotInstall;
+}
+
+/**
+ * MPLS route of a DecisionRouteDbSnapshot
+ */
+struct DecisionMplsRouteEntry {
+  1: i32 label;
+
+  /**
+   * Index into nextHopGroups of the snapshot
+   */
+  2: i32 nextHopGroup;
+}
+
+/**
+ * Routes computed by Decision, persisted for warm start of Open/R. Next-hop
+ * groups shared by routes are stored once.
+ */
+struct DecisionRouteDbSnapshot {
+  1: string thisNodeName;
+
+  /**
+   * Time the snapshot was taken at, in milliseconds since epoch
+   */
+  2: i64 timestampMs;
+
+  3: list<list<Network.NextHopThrift>> nextHopGroups;
+  4: list<DecisionUnicastRouteEntry> unicastRoutes;
+  5: list<DecisionMplsRouteEntry> mplsRoutes;
+}
+
 /**
  * Struct representing build information. Attributes are described in detail
  * in `openr/common/BuildInfo.h`
@@ -7,13 +7,19 @@
 
 #include <fb303/ServiceData.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/GLog.h>
 #include <folly/Random.h>
 #include <folly/String.h>
+#include <folly/compression/Compression.h>
+#include <folly/hash/Checksum.h>
+#include <folly/lang/Bits.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/EventLogger.h>
+#include <openr/common/PageCollector.h>
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/OpenrCtrl_types.h>
 #include <openr/kvstore/KvStore.h>
@@ -23,6 +29,60 @@ using namespace std::chrono;
 namespace fb303 = facebook::fb303;
 
 namespace {
+// Counters of the flooding path, bumped for every sent and received
+// publication
+openr::StatCounter numUpdatesCounter{"kvstore.num_updates", fb303::COUNT};
+openr::StatCounter numFloodPubCounter{
+    "kvstore.thrift.num_flood_pub", fb303::COUNT};
+openr::StatCounter numFloodKeyValsCounter{
+    "kvstore.thrift.num_flood_key_vals", fb303::SUM};
+openr::StatCounter numFloodValuePatchesCounter{
+    "kvstore.thrift.num_flood_value_patches", fb303::SUM};
+openr::StatCounter numFloodPubSuccessCounter{
+    "kvstore.thrift.num_flood_pub_success", fb303::COUNT};
+openr::StatCounter numFloodPubFailureCounter{
+    "kvstore.thrift.num_flood_pub_failure", fb303::COUNT};
+openr::StatCounter receivedPublicationsCounter{
+    "kvstore.received_publications", fb303::COUNT};
+openr::StatCounter receivedKeyValsCounter{
+    "kvstore.received_key_vals", fb303::SUM};
+openr::StatCounter loopedPublicationsCounter{
+    "kvstore.looped_publications", fb303::COUNT};
+openr::StatCounter appliedValuePatchesCounter{
+    "kvstore.applied_value_patches", fb303::COUNT};
+openr::StatCounter numFloodCompressedValuesCounter{
+    "kvstore.thrift.num_flood_compressed_values", fb303::SUM};
+openr::StatCounter decompressedValuesCounter{
+    "kvstore.decompressed_values", fb303::COUNT};
+openr::StatCounter invalidCompressedValuesCounter{
+    "kvstore.invalid_compressed_values", fb303::COUNT};
+openr::StatCounter updatedKeyValsCounter{
+    "kvstore.updated_key_vals", fb303::SUM};
+openr::StatCounter receivedRedundantPublicationsCounter{
+    "kvstore.received_redundant_publications", fb303::COUNT};
+openr::StatCounter floodHopLatencyCounter{
+    "kvstore.flood_hop_latency_us", fb303::AVG};
+openr::StatCounter snapshotKeysLoadedCounter{
+    "kvstore.snapshot.num_keys_loaded", fb303::SUM};
+openr::StatCounter dumpCacheHitsCounter{
+    "kvstore.dump_cache.hits", fb303::COUNT};
+openr::StatCounter dumpCacheMissesCounter{
+    "kvstore.dump_cache.misses", fb303::COUNT};
+
+// max number of distinct filters dumps are cached for, per area
+constexpr size_t kMaxCachedDumps{8};
+
+// leading bytes of snapshot files, followed by the big-endian crc32c of
+// the serialized thrift::KvStoreSnapshot
+const std::string kSnapshotMarker{"OPENR_KVSTORE_SNAPSHOT_V1"};
+
+// codec of compressed values. Codecs keep state, one per thread
+folly::io::Codec&
+getValueCodec() {
+  thread_local auto codec = folly::io::getCodec(folly::io::CodecType::ZSTD);
+  return *codec;
+}
+
 std::optional<openr::KvStoreFilters>
 getKvStoreFilters(std::shared_ptr<const openr::Config> config) {
   std::optional<openr::KvStoreFilters> kvFilters{std::nullopt};
@@ -57,7 +117,58 @@ KvStoreFilters::KvStoreFilters(
     std::set<std::string> const& nodeIds)
     : keyPrefixList_(keyPrefix),
       originatorIds_(nodeIds),
-      keyRegexSet_(RegexSet(keyPrefixList_)) {}
+      keyRegexSet_(RegexSet(getKeyRegexes(keyPrefix))) {
+  std::vector<std::string> literalKeyPrefixes;
+  for (auto const& prefix : keyPrefixList_) {
+    if (isLiteralKeyPrefix(prefix)) {
+      literalKeyPrefixes.emplace_back(prefix);
+    } else {
+      hasKeyRegex_ = true;
+    }
+  }
+  // a prefix sorts right after the ones it starts with, so comparing with
+  // the last kept prefix is enough to drop the covered ones
+  std::sort(literalKeyPrefixes.begin(), literalKeyPrefixes.end());
+  for (auto& prefix : literalKeyPrefixes) {
+    if (not literalKeyPrefixes_.empty()) {
+      auto const& lastPrefix = literalKeyPrefixes_.back();
+      if (prefix.compare(0, lastPrefix.size(), lastPrefix) == 0) {
+        continue;
+      }
+    }
+    literalKeyPrefixes_.emplace_back(std::move(prefix));
+  }
+}
+
+// static, private
+bool
+KvStoreFilters::isLiteralKeyPrefix(std::string const& keyPrefix) {
+  // RE2 set is anchored at the start of keys, so a prefix without any regex
+  // syntax matches exactly the keys starting with it
+  return keyPrefix.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+}
+
+// static, private
+std::vector<std::string>
+KvStoreFilters::getKeyRegexes(std::vector<std::string> const& keyPrefix) {
+  std::vector<std::string> keyRegexes;
+  for (auto const& prefix : keyPrefix) {
+    if (not isLiteralKeyPrefix(prefix)) {
+      keyRegexes.emplace_back(prefix);
+    }
+  }
+  return keyRegexes;
+}
+
+bool
+KvStoreFilters::keyPrefixMatch(std::string const& key) const {
+  for (auto const& prefix : literalKeyPrefixes_) {
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      return true;
+    }
+  }
+  return hasKeyRegex_ && keyRegexSet_.match(key);
+}
 
 bool
 KvStoreFilters::keyMatchAny(
@@ -65,7 +176,7 @@ KvStoreFilters::keyMatchAny(
   if (keyPrefixList_.empty() && originatorIds_.empty()) {
     return true;
   }
-  if (!keyPrefixList_.empty() && keyRegexSet_.match(key)) {
+  if (!keyPrefixList_.empty() && keyPrefixMatch(key)) {
     return true;
   }
   if (!originatorIds_.empty() &&
@@ -96,7 +207,7 @@ KvStoreFilters::keyMatchAll(
     return true;
   }
 
-  if (!keyPrefixList_.empty() && not keyRegexSet_.match(key)) {
+  if (!keyPrefixList_.empty() && not keyPrefixMatch(key)) {
     return false;
   }
 
@@ -108,12 +219,12 @@ KvStoreFilters::keyMatchAll(
   return true;
 }
 
-std::vector<std::string>
+std::vector<std::string> const&
 KvStoreFilters::getKeyPrefixes() const {
   return keyPrefixList_;
 }
 
-std::set<std::string>
+std::set<std::string> const&
 KvStoreFilters::getOriginatorIdList() const {
   return originatorIds_;
 }
@@ -132,6 +243,531 @@ KvStoreFilters::str() const {
   return result;
 }
 
+void
+KvStoreKeyIndex::add(std::string const& key, thrift::Value const& value) {
+  auto const& storedKey = *keys_.emplace(key).first;
+  originatorKeys_[*value.originatorId_ref()].emplace(&storedKey);
+}
+
+void
+KvStoreKeyIndex::remove(std::string const& key, thrift::Value const& value) {
+  auto keyIt = keys_.find(key);
+  if (keyIt == keys_.end()) {
+    return;
+  }
+  auto it = originatorKeys_.find(*value.originatorId_ref());
+  if (it != originatorKeys_.end()) {
+    it->second.erase(&*keyIt);
+    if (it->second.empty()) {
+      originatorKeys_.erase(it);
+    }
+  }
+  keys_.erase(keyIt);
+}
+
+void
+KvStoreKeyIndex::updateOriginator(
+    std::string const& key,
+    std::string const& oldOriginatorId,
+    std::string const& newOriginatorId) {
+  if (oldOriginatorId == newOriginatorId) {
+    return;
+  }
+  auto const& storedKey = *keys_.emplace(key).first;
+  auto it = originatorKeys_.find(oldOriginatorId);
+  if (it != originatorKeys_.end()) {
+    it->second.erase(&storedKey);
+    if (it->second.empty()) {
+      originatorKeys_.erase(it);
+    }
+  }
+  originatorKeys_[newOriginatorId].emplace(&storedKey);
+}
+
+bool
+KvStoreKeyIndex::forEachCandidate(
+    KvStoreFilters const& filters,
+    thrift::FilterOperator oper,
+    folly::FunctionRef<void(std::string const&)> cb) const {
+  auto const& originatorIds = filters.getOriginatorIdList();
+
+  // keys must match an originator ID, regardless of key prefixes
+  if (oper == thrift::FilterOperator::AND and not originatorIds.empty()) {
+    for (auto const& originatorId : originatorIds) {
+      auto it = originatorKeys_.find(originatorId);
+      if (it == originatorKeys_.end()) {
+        continue;
+      }
+      for (auto const* key : it->second) {
+        cb(*key);
+      }
+    }
+    return true;
+  }
+
+  // no filters match all keys, regexes can't be looked up
+  if ((filters.getKeyPrefixes().empty() and originatorIds.empty()) or
+      filters.hasKeyRegex()) {
+    return false;
+  }
+
+  // literal prefixes don't cover one another, so no key is visited twice
+  for (auto const& prefix : filters.getLiteralKeyPrefixes()) {
+    for (auto it = keys_.lower_bound(prefix);
+         it != keys_.end() and it->compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+      cb(*it);
+    }
+  }
+
+  // for OR, also keys of the originator IDs not visited by the range scans
+  // above. AND has no originator IDs here
+  for (auto const& originatorId : originatorIds) {
+    auto it = originatorKeys_.find(originatorId);
+    if (it == originatorKeys_.end()) {
+      continue;
+    }
+    for (auto const* key : it->second) {
+      if (not filters.keyPrefixMatch(*key)) {
+        cb(*key);
+      }
+    }
+  }
+  return true;
+}
+
+void
+KvStoreKeyIndex::forEachKeyAfter(
+    std::optional<std::string> const& cursor,
+    folly::FunctionRef<bool(std::string const&)> cb) const {
+  auto it = cursor.has_value() ? keys_.upper_bound(*cursor) : keys_.begin();
+  for (; it != keys_.end(); ++it) {
+    if (not cb(*it)) {
+      return;
+    }
+  }
+}
+
+KvStoreBucketHashes::KvStoreBucketHashes(size_t numBuckets)
+    : hashes_(numBuckets, 0) {
+  CHECK_GT(numBuckets, 0);
+}
+
+int32_t
+KvStoreBucketHashes::getBucket(std::string const& key) const {
+  return boost::hash<std::string>()(key) % hashes_.size();
+}
+
+int64_t
+KvStoreBucketHashes::getDigest(
+    std::string const& key, thrift::Value const& value) {
+  DCHECK(value.hash_ref().has_value());
+  size_t seed = 0;
+  boost::hash_combine(seed, key);
+  boost::hash_combine(seed, value.hash_ref().value_or(0));
+  boost::hash_combine(seed, *value.ttlVersion_ref());
+  return static_cast<int64_t>(seed);
+}
+
+size_t
+KvStoreBucketHashes::getSize(
+    std::string const& key, thrift::Value const& value) {
+  return sizeof(std::pair<const std::string, thrift::Value>) + key.size() +
+      value.originatorId_ref()->size() +
+      (value.value_ref().has_value() ? value.value_ref()->size() : 0);
+}
+
+void
+KvStoreBucketHashes::add(std::string const& key, thrift::Value const& value) {
+  hashes_[getBucket(key)] ^= getDigest(key, value);
+  numBytes_ += getSize(key, value);
+}
+
+void
+KvStoreBucketHashes::remove(
+    std::string const& key, thrift::Value const& value) {
+  // XOR is its own inverse
+  hashes_[getBucket(key)] ^= getDigest(key, value);
+  numBytes_ -= getSize(key, value);
+}
+
+std::vector<int32_t>
+KvStoreBucketHashes::getDifferingBuckets(
+    std::vector<int64_t> const& peerHashes) const {
+  std::vector<int32_t> buckets;
+  for (size_t bucket = 0; bucket < hashes_.size(); ++bucket) {
+    if (peerHashes.size() != hashes_.size() or
+        peerHashes[bucket] != hashes_[bucket]) {
+      buckets.push_back(bucket);
+    }
+  }
+  return buckets;
+}
+
+KvStoreChangeLog::KvStoreChangeLog(size_t capacity) : capacity_(capacity) {
+  CHECK_GT(capacity, 0);
+}
+
+void
+KvStoreChangeLog::add(std::string const& key) {
+  if (keys_.size() == capacity_) {
+    keys_.pop_front();
+  }
+  keys_.emplace_back(key);
+  ++sequence_;
+}
+
+bool
+KvStoreChangeLog::covers(int64_t sequence) const {
+  return sequence <= sequence_ and
+      sequence >= sequence_ - static_cast<int64_t>(keys_.size());
+}
+
+std::unordered_set<std::string>
+KvStoreChangeLog::getKeysSince(int64_t sequence) const {
+  DCHECK(covers(sequence));
+  std::unordered_set<std::string> keys;
+  for (auto it = keys_.end() - (sequence_ - sequence); it != keys_.end();
+       ++it) {
+    keys.emplace(*it);
+  }
+  return keys;
+}
+
+KvStoreKeyClasses::KvStoreKeyClasses(
+    std::vector<thrift::KvstoreKeyClass> const& keyClasses) {
+  for (auto const& keyClass : keyClasses) {
+    for (auto const& keyPrefix : *keyClass.key_prefixes_ref()) {
+      keyPrefixes_.emplace_back(keyPrefix, names_.size());
+    }
+    names_.emplace_back(*keyClass.name_ref());
+  }
+  names_.emplace_back("default");
+}
+
+size_t
+KvStoreKeyClasses::getClass(std::string const& key) const {
+  for (auto const& [keyPrefix, keyClass] : keyPrefixes_) {
+    if (key.compare(0, keyPrefix.size(), keyPrefix) == 0) {
+      return keyClass;
+    }
+  }
+  return names_.size() - 1;
+}
+
+std::vector<thrift::Publication>
+KvStoreKeyClasses::split(thrift::Publication&& publication) const {
+  std::vector<thrift::Publication> pubs;
+
+  // keys of a single class, nothing to split
+  std::optional<size_t> firstClass;
+  bool isMixed{false};
+  auto checkKey = [&](std::string const& key) {
+    const auto keyClass = getClass(key);
+    isMixed = isMixed or (firstClass.has_value() and *firstClass != keyClass);
+    firstClass = keyClass;
+  };
+  for (auto const& [key, _] : *publication.keyVals_ref()) {
+    checkKey(key);
+  }
+  for (auto const& key : *publication.expiredKeys_ref()) {
+    checkKey(key);
+  }
+  if (not isMixed) {
+    pubs.emplace_back(std::move(publication));
+    return pubs;
+  }
+
+  std::vector<thrift::Publication> classPubs(names_.size());
+  for (auto& [key, value] : *publication.keyVals_ref()) {
+    classPubs.at(getClass(key)).keyVals_ref()->emplace(key, std::move(value));
+  }
+  for (auto& key : *publication.expiredKeys_ref()) {
+    classPubs.at(getClass(key)).expiredKeys_ref()->emplace_back(key);
+  }
+  for (auto& classPub : classPubs) {
+    if (classPub.keyVals_ref()->empty() and
+        classPub.expiredKeys_ref()->empty()) {
+      continue;
+    }
+    classPub.area_ref().copy_from(publication.area_ref());
+    classPub.nodeIds_ref().copy_from(publication.nodeIds_ref());
+    classPub.floodRootId_ref().copy_from(publication.floodRootId_ref());
+    classPub.expiredOriginators_ref().copy_from(
+        publication.expiredOriginators_ref());
+    // trace follows the highest priority keys
+    if (pubs.empty()) {
+      classPub.perfEvents_ref().move_from(publication.perfEvents_ref());
+    }
+    pubs.emplace_back(std::move(classPub));
+  }
+  return pubs;
+}
+
+KvStoreClientIndex::KvStoreClientIndex(
+    messaging::ReplicateQueue<thrift::Publication>& updatesQueue)
+    : updatesQueue_(updatesQueue) {}
+
+std::pair<KvStoreClientIndex::ClientId, messaging::RQueue<thrift::Publication>>
+KvStoreClientIndex::addClient() {
+  auto state = state_.wlock();
+  // forget about the clients whose reader is gone
+  for (auto it = state->clients.begin(); it != state->clients.end();) {
+    if (it->second.queue.use_count() > 1) {
+      ++it;
+      continue;
+    }
+    for (auto const& key : it->second.keys) {
+      auto& ids = state->keyClients.at(key);
+      ids.erase(std::remove(ids.begin(), ids.end(), it->first), ids.end());
+      if (ids.empty()) {
+        state->keyClients.erase(key);
+      }
+    }
+    auto& filterIds = state->filterClients;
+    filterIds.erase(
+        std::remove(filterIds.begin(), filterIds.end(), it->first),
+        filterIds.end());
+    it = state->clients.erase(it);
+  }
+
+  const auto id = state->nextId++;
+  auto& client = state->clients[id];
+  client.queue = updatesQueue_.getDirectQueue();
+  return {id, messaging::RQueue<thrift::Publication>(client.queue)};
+}
+
+void
+KvStoreClientIndex::addKey(ClientId id, std::string const& key) {
+  auto state = state_.wlock();
+  if (state->clients.at(id).keys.emplace(key).second) {
+    state->keyClients[key].emplace_back(id);
+  }
+}
+
+void
+KvStoreClientIndex::removeKey(ClientId id, std::string const& key) {
+  auto state = state_.wlock();
+  if (not state->clients.at(id).keys.erase(key)) {
+    return;
+  }
+  auto& ids = state->keyClients.at(key);
+  ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+  if (ids.empty()) {
+    state->keyClients.erase(key);
+  }
+}
+
+void
+KvStoreClientIndex::setFilter(
+    ClientId id, std::optional<KvStoreFilters> filter) {
+  auto state = state_.wlock();
+  auto& filterIds = state->filterClients;
+  filterIds.erase(
+      std::remove(filterIds.begin(), filterIds.end(), id), filterIds.end());
+  if (filter.has_value()) {
+    filterIds.emplace_back(id);
+  }
+  state->clients.at(id).filter = std::move(filter);
+}
+
+void
+KvStoreClientIndex::dispatch(thrift::Publication const& publication) {
+  auto state = state_.rlock();
+  if (state->clients.empty()) {
+    return;
+  }
+
+  std::unordered_map<ClientId, thrift::Publication> publications;
+  auto getPublication = [&](ClientId id) -> thrift::Publication& {
+    auto [it, inserted] = publications.try_emplace(id);
+    if (inserted) {
+      it->second.area_ref() = publication.get_area();
+      it->second.nodeIds_ref().copy_from(publication.nodeIds_ref());
+    }
+    return it->second;
+  };
+
+  for (auto const& [key, value] : *publication.keyVals_ref()) {
+    if (not value.value_ref().has_value()) {
+      // TTL update
+      continue;
+    }
+    auto it = state->keyClients.find(key);
+    if (it != state->keyClients.end()) {
+      for (auto id : it->second) {
+        getPublication(id).keyVals_ref()->emplace(key, value);
+      }
+    }
+    for (auto id : state->filterClients) {
+      if (state->clients.at(id).filter->keyMatch(key, value)) {
+        // no-op if the key is delivered to the client already
+        getPublication(id).keyVals_ref()->emplace(key, value);
+      }
+    }
+  }
+
+  for (auto const& key : *publication.expiredKeys_ref()) {
+    auto it = state->keyClients.find(key);
+    if (it == state->keyClients.end()) {
+      continue;
+    }
+    for (auto id : it->second) {
+      getPublication(id).expiredKeys_ref()->emplace_back(key);
+    }
+  }
+
+  for (auto& [id, clientPublication] : publications) {
+    state->clients.at(id).queue->push(std::move(clientPublication));
+  }
+}
+
+TtlCountdownWheel::TtlCountdownWheel(
+    std::chrono::milliseconds tick, std::chrono::steady_clock::time_point start)
+    : tick_(tick), start_(start) {
+  CHECK_GT(tick.count(), 0);
+}
+
+uint64_t
+TtlCountdownWheel::toTick(std::chrono::steady_clock::time_point time) const {
+  if (time <= start_) {
+    return 0;
+  }
+  // round up, an entry must never expire before its expiryTime
+  return (time - start_ + tick_ - std::chrono::nanoseconds(1)) / tick_;
+}
+
+std::chrono::steady_clock::time_point
+TtlCountdownWheel::toTime(uint64_t tick) const {
+  return start_ + tick * tick_;
+}
+
+void
+TtlCountdownWheel::place(std::string const& key, Entry& entry) {
+  // lowest level on which expiry and current tick share all higher bits,
+  // entries beyond the top level wait there and get re-placed on cascade
+  size_t level = 0;
+  while (level + 1 < kLevels and
+         (entry.expiryTick >> (kSlotBits * (level + 1))) !=
+             (currentTick_ >> (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+  auto& slot =
+      slots_[level][(entry.expiryTick >> (kSlotBits * level)) & (kSlots - 1)];
+  entry.level = level;
+  entry.slotIt = slot.insert(slot.end(), &key);
+  ++levelSizes_[level];
+}
+
+void
+TtlCountdownWheel::schedule(TtlCountdownQueueEntry entry) {
+  auto it = entries_.find(entry.key);
+  if (it == entries_.end()) {
+    std::tie(it, std::ignore) = entries_.emplace(entry.key, Entry{});
+  } else {
+    // reschedule, take it out of its current slot
+    auto& old = it->second;
+    slots_[old.level]
+          [(old.expiryTick >> (kSlotBits * old.level)) & (kSlots - 1)]
+              .erase(old.slotIt);
+    --levelSizes_[old.level];
+  }
+  auto& wheelEntry = it->second;
+  // expiries in the past are due on the next tick
+  wheelEntry.expiryTick = std::max(toTick(entry.expiryTime), currentTick_ + 1);
+  wheelEntry.entry = std::move(entry);
+  place(it->first, wheelEntry);
+}
+
+void
+TtlCountdownWheel::erase(std::string const& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return;
+  }
+  auto& entry = it->second;
+  slots_[entry.level]
+        [(entry.expiryTick >> (kSlotBits * entry.level)) & (kSlots - 1)]
+            .erase(entry.slotIt);
+  --levelSizes_[entry.level];
+  entries_.erase(it);
+}
+
+TtlCountdownQueueEntry const*
+TtlCountdownWheel::find(std::string const& key) const {
+  auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : &it->second.entry;
+}
+
+void
+TtlCountdownWheel::cascade(size_t level) {
+  auto& slot =
+      slots_[level][(currentTick_ >> (kSlotBits * level)) & (kSlots - 1)];
+  Slot keys;
+  keys.swap(slot);
+  levelSizes_[level] -= keys.size();
+  for (auto const* key : keys) {
+    place(*key, entries_.at(*key));
+  }
+}
+
+std::vector<TtlCountdownQueueEntry>
+TtlCountdownWheel::advance(std::chrono::steady_clock::time_point now) {
+  std::vector<TtlCountdownQueueEntry> expired;
+  // toTick() rounds up, only ticks fully in the past are due
+  const uint64_t targetTick = now < start_ ? 0 : (now - start_) / tick_;
+
+  while (currentTick_ < targetTick) {
+    if (entries_.empty()) {
+      // nothing to expire, jump ahead
+      currentTick_ = targetTick;
+      break;
+    }
+    ++currentTick_;
+
+    // lower levels wrapped around, bring entries of higher levels down
+    for (size_t level = kLevels - 1; level > 0; --level) {
+      if (levelSizes_[level] and
+          (currentTick_ & ((uint64_t{1} << (kSlotBits * level)) - 1)) == 0) {
+        cascade(level);
+      }
+    }
+
+    auto& slot = slots_[0][currentTick_ & (kSlots - 1)];
+    while (not slot.empty()) {
+      auto it = entries_.find(*slot.front());
+      slot.pop_front();
+      --levelSizes_[0];
+      expired.emplace_back(std::move(it->second.entry));
+      entries_.erase(it);
+    }
+  }
+  return expired;
+}
+
+std::optional<std::chrono::steady_clock::time_point>
+TtlCountdownWheel::getNextWakeup() const {
+  if (entries_.empty()) {
+    return std::nullopt;
+  }
+  if (levelSizes_[0]) {
+    for (uint64_t tick = currentTick_ + 1; tick <= currentTick_ + kSlots;
+         ++tick) {
+      if (not slots_[0][tick & (kSlots - 1)].empty()) {
+        return toTime(tick);
+      }
+    }
+  }
+  // wake up when the lowest occupied level cascades next
+  for (size_t level = 1; level < kLevels; ++level) {
+    if (levelSizes_[level]) {
+      const auto shift = kSlotBits * level;
+      return toTime(((currentTick_ >> shift) + 1) << shift);
+    }
+  }
+  return std::nullopt;
+}
+
 KvStore::KvStore(
     // initializers for immutable state
     fbzmq::Context& zmqContext,
@@ -162,12 +798,18 @@ KvStore::KvStore(
           config->getKvStoreConfig().enable_flood_optimization_ref().value_or(
               false),
           config->getKvStoreConfig().is_flood_root_ref().value_or(false),
-          config->getKvStoreConfig().get_enable_thrift_dual_msg()) {
+          config->getKvStoreConfig().get_enable_thrift_dual_msg(),
+          config->getKvStoreConfig().flood_coalesce_ref().to_optional(),
+          config->getKvStoreConfig().enable_flood_value_patch_ref().value_or(
+              false)) {
   // Schedule periodic timer for counters submission
   counterUpdateTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
-    for (auto& [key, val] : getGlobalCounters()) {
-      fb303::fbData->setCounter(key, val);
-    }
+    getCounters().via(getEvb()).thenValue(
+        [](std::map<std::string, int64_t>&& counters) {
+          for (auto& [key, val] : counters) {
+            fb303::fbData->setCounter(key, val);
+          }
+        });
     counterUpdateTimer_->scheduleTimeout(Constants::kCounterSubmitInterval);
   });
   counterUpdateTimer_->scheduleTimeout(Constants::kCounterSubmitInterval);
@@ -179,6 +821,27 @@ KvStore::KvStore(
     maybeIpTos = ipTosConfig.value();
   }
   kvParams_.maybeIpTos = maybeIpTos;
+  kvParams_.perfTraceSampleRate =
+      config->getKvStoreConfig().perf_trace_sample_rate_ref().value_or(0);
+  kvParams_.enableFloodRootLoadBalancing =
+      config->getKvStoreConfig()
+          .enable_flood_root_load_balancing_ref()
+          .value_or(false);
+  kvParams_.enableFloodValueCompression =
+      config->getKvStoreConfig().enable_flood_value_compression_ref().value_or(
+          false);
+  kvParams_.enableFloodStream =
+      config->getKvStoreConfig().enable_flood_stream_ref().value_or(false);
+  kvParams_.originatorFloodRate =
+      config->getKvStoreConfig().originator_flood_rate_ref().to_optional();
+  if (auto keyClasses = config->getKvStoreConfig().key_classes_ref()) {
+    kvParams_.keyClasses = *keyClasses;
+  }
+  kvParams_.snapshotFilePath =
+      config->getKvStoreConfig().snapshot_file_path_ref().to_optional();
+  kvParams_.snapshotInterval = std::chrono::seconds(
+      config->getKvStoreConfig().snapshot_interval_s_ref().value_or(
+          Constants::kKvStoreSnapshotInterval.count()));
 
   // [TO BE DEPRECATED]
   if (kvParams_.enableFloodOptimization) {
@@ -230,12 +893,24 @@ KvStore::KvStore(
   });
 
   // create KvStoreDb instances
+  const bool perAreaEvb =
+      config->getKvStoreConfig().enable_per_area_event_base_ref().value_or(
+          false);
   for (auto const& area : config->getAreaIds()) {
+    fb303::fbData->addStatExportType(
+        fmt::format("kvstore.area_queue_delay_ms.{}", area), fb303::AVG);
+    OpenrEventBase* evb = this;
+    if (perAreaEvb) {
+      auto& areaEvb = areaEvbs_[area];
+      areaEvb = std::make_unique<OpenrEventBase>();
+      areaEvb->setEvbName(fmt::format("kvstore.{}", area));
+      evb = areaEvb.get();
+    }
     kvStoreDb_.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(area),
         std::forward_as_tuple(
-            this,
+            evb,
             kvParams_,
             area,
             fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT>(
@@ -249,27 +924,53 @@ KvStore::KvStore(
   }
 }
 
+void
+KvStore::run() {
+  for (auto& [_, areaEvb] : areaEvbs_) {
+    areaEvbThreads_.emplace_back([evb = areaEvb.get()]() { evb->run(); });
+    areaEvb->waitUntilRunning();
+  }
+
+  // Invoke run method of super class, this blocks until stop()
+  OpenrEventBase::run();
+}
+
 void
 KvStore::stop() {
   getEvb()->runImmediatelyOrRunInEventBaseThreadAndWait([this]() {
     // NOTE: destructor of every instance inside `kvStoreDb_` will gracefully
     //       exit and wait for all pending thrift requests to be processed
-    //       before eventbase stops.
+    //       before eventbase stops. It runs in the event base of its area,
+    //       so these must still be running.
     kvStoreDb_.clear();
   });
 
+  for (auto& [_, areaEvb] : areaEvbs_) {
+    areaEvb->stop();
+  }
+  for (auto& thread : areaEvbThreads_) {
+    thread.join();
+  }
+  areaEvbThreads_.clear();
+
   // Invoke stop method of super class
   OpenrEventBase::stop();
 }
 
 // static, public
+template <typename KvStoreMapT>
 std::unordered_map<std::string, thrift::Value>
 KvStore::mergeKeyValues(
-    std::unordered_map<std::string, thrift::Value>& kvStore,
+    KvStoreMapT& kvStore,
     std::unordered_map<std::string, thrift::Value> const& keyVals,
-    std::optional<KvStoreFilters> const& filters) {
-  // the publication to build if we update our KV store
+    std::optional<KvStoreFilters> const& filters,
+    KvStoreBucketHashes* bucketHashes,
+    bool createPatches,
+    KvStoreKeyIndex* keyIndex) {
+  // the publication to build if we update our KV store. Sized for all keys
+  // upfront, flooded publications mostly carry updates
   std::unordered_map<std::string, thrift::Value> kvUpdates;
+  kvUpdates.reserve(keyVals.size());
 
   // Counters for logging
   uint32_t ttlUpdateCnt{0}, valUpdateCnt{0};
@@ -328,7 +1029,12 @@ KvStore::mergeKeyValues(
         // differ(higher in this case but can be lower as long as it's
         // deterministic). Otherwise, local store can have new value while
         // other stores have old value and they never sync.
-        int rc = (*value.value_ref()).compare(*kvStoreIt->second.value_ref());
+        // Same hash means same value, only differing values are compared
+        int rc = 0;
+        if (not value.hash_ref().has_value() or
+            value.hash_ref() != kvStoreIt->second.hash_ref()) {
+          rc = (*value.value_ref()).compare(*kvStoreIt->second.value_ref());
+        }
         if (rc > 0) {
           // versions and orginatorIds are same but value is higher
           VLOG(3) << "Previous incarnation reflected back for key " << key;
@@ -374,6 +1080,12 @@ KvStore::mergeKeyValues(
     // grab the new value (this will copy, intended)
     thrift::Value newValue = value;
 
+    if (bucketHashes and kvStoreIt != kvStore.end()) {
+      bucketHashes->remove(key, kvStoreIt->second);
+    }
+
+    std::optional<thrift::ValuePatch> patch;
+
     if (updateAllNeeded) {
       ++valUpdateCnt;
       FB_LOG_EVERY_MS(INFO, 500)
@@ -386,21 +1098,34 @@ KvStore::mergeKeyValues(
       // update everything for such key
       //
       CHECK(value.value_ref().has_value());
+      // update hash if it's not there
+      if (not newValue.hash_ref().has_value()) {
+        newValue.hash_ref() = generateHash(
+            *value.version_ref(), *value.originatorId_ref(), value.value_ref());
+      }
+      newValue.patch_ref().reset();
       if (kvStoreIt == kvStore.end()) {
         // create new entry
         std::tie(kvStoreIt, std::ignore) = kvStore.emplace(
             std::piecewise_construct,
             std::forward_as_tuple(key),
             std::forward_as_tuple(std::move(newValue)));
+        if (keyIndex) {
+          keyIndex->add(key, kvStoreIt->second);
+        }
       } else {
+        if (createPatches) {
+          patch = createValuePatch(kvStoreIt->second, newValue);
+        }
+        if (keyIndex) {
+          keyIndex->updateOriginator(
+              key,
+              *kvStoreIt->second.originatorId_ref(),
+              *newValue.originatorId_ref());
+        }
         // update the entry in place, the old value will be destructed
         kvStoreIt->second = std::move(newValue);
       }
-      // update hash if it's not there
-      if (not kvStoreIt->second.hash_ref().has_value()) {
-        kvStoreIt->second.hash_ref() = generateHash(
-            *value.version_ref(), *value.originatorId_ref(), value.value_ref());
-      }
     } else if (updateTtlNeeded) {
       ++ttlUpdateCnt;
       //
@@ -408,19 +1133,291 @@ KvStore::mergeKeyValues(
       //
       CHECK(kvStoreIt != kvStore.end());
 
-      // update TTL only, nothing else
-      kvStoreIt->second.ttl_ref() = *value.ttl_ref();
-      kvStoreIt->second.ttlVersion_ref() = *value.ttlVersion_ref();
+      // update TTL only, nothing else
+      kvStoreIt->second.ttl_ref() = *value.ttl_ref();
+      kvStoreIt->second.ttlVersion_ref() = *value.ttlVersion_ref();
+    }
+
+    if (bucketHashes) {
+      bucketHashes->add(key, kvStoreIt->second);
+    }
+
+    // announce the update, along with the hash of the value so that it is
+    // not computed again by the stores it gets flooded to
+    auto& update = kvUpdates.emplace(key, value).first->second;
+    update.patch_ref().reset();
+    if (updateAllNeeded) {
+      update.hash_ref().copy_from(kvStoreIt->second.hash_ref());
+    }
+    if (patch.has_value()) {
+      update.patch_ref() = std::move(*patch);
+    }
+  }
+
+  VLOG(4) << "(mergeKeyValues) updating " << kvUpdates.size()
+          << " keyvals. ValueUpdates: " << valUpdateCnt
+          << ", TtlUpdates: " << ttlUpdateCnt;
+  return kvUpdates;
+}
+
+template std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues<KvStoreMap>(
+    KvStoreMap& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    KvStoreBucketHashes* bucketHashes,
+    bool createPatches,
+    KvStoreKeyIndex* keyIndex);
+
+template std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues<thrift::KeyVals>(
+    thrift::KeyVals& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    KvStoreBucketHashes* bucketHashes,
+    bool createPatches,
+    KvStoreKeyIndex* keyIndex);
+
+// static, public
+std::optional<thrift::ValuePatch>
+KvStore::createValuePatch(
+    thrift::Value const& base, thrift::Value const& value) {
+  if (not base.value_ref().has_value() or not value.value_ref().has_value() or
+      not base.hash_ref().has_value() or not value.hash_ref().has_value()) {
+    return std::nullopt;
+  }
+  auto const& baseData = *base.value_ref();
+  auto const& data = *value.value_ref();
+
+  // changed bytes lie between the longest common prefix and suffix
+  const size_t maxCommon = std::min(baseData.size(), data.size());
+  size_t prefixLength = 0;
+  while (prefixLength < maxCommon and
+         baseData[prefixLength] == data[prefixLength]) {
+    ++prefixLength;
+  }
+  size_t suffixLength = 0;
+  while (suffixLength < maxCommon - prefixLength and
+         baseData[baseData.size() - 1 - suffixLength] ==
+             data[data.size() - 1 - suffixLength]) {
+    ++suffixLength;
+  }
+
+  const size_t middleLength = data.size() - prefixLength - suffixLength;
+  if (middleLength * 2 >= data.size()) {
+    // not worth it, flood the value
+    return std::nullopt;
+  }
+
+  thrift::ValuePatch patch;
+  patch.baseVersion_ref() = *base.version_ref();
+  patch.baseHash_ref() = *base.hash_ref();
+  patch.prefixLength_ref() = prefixLength;
+  patch.suffixLength_ref() = suffixLength;
+  patch.middle_ref() = data.substr(prefixLength, middleLength);
+  return patch;
+}
+
+// static, public
+bool
+KvStore::applyValuePatch(thrift::Value const& base, thrift::Value& value) {
+  auto const& patch = value.patch_ref();
+  if (not patch.has_value() or not value.hash_ref().has_value() or
+      not base.value_ref().has_value() or
+      *base.version_ref() != *patch->baseVersion_ref() or
+      base.hash_ref() != patch->baseHash_ref()) {
+    return false;
+  }
+  auto const& baseData = *base.value_ref();
+  const size_t prefixLength = *patch->prefixLength_ref();
+  const size_t suffixLength = *patch->suffixLength_ref();
+  if (prefixLength + suffixLength > baseData.size()) {
+    return false;
+  }
+
+  std::optional<std::string> data{std::in_place};
+  data->reserve(prefixLength + patch->middle_ref()->size() + suffixLength);
+  data->append(baseData, 0, prefixLength);
+  data->append(*patch->middle_ref());
+  data->append(baseData, baseData.size() - suffixLength, suffixLength);
+  if (generateHash(*value.version_ref(), *value.originatorId_ref(), data) !=
+      *value.hash_ref()) {
+    return false;
+  }
+
+  value.value_ref() = std::move(*data);
+  value.patch_ref().reset();
+  return true;
+}
+
+// static, public
+bool
+KvStore::compressValue(thrift::Value& value) {
+  if (not value.value_ref().has_value() or
+      value.value_ref()->size() < Constants::kKvStoreCompressValueMinSize) {
+    return false;
+  }
+  auto compressed = getValueCodec().compress(*value.value_ref());
+  if (compressed.size() * 4 > value.value_ref()->size() * 3) {
+    // not worth it, send the value
+    return false;
+  }
+  // receiver checks the decompressed data against it
+  if (not value.hash_ref().has_value()) {
+    value.hash_ref() = generateHash(
+        *value.version_ref(), *value.originatorId_ref(), value.value_ref());
+  }
+  value.compressedValue_ref() = std::move(compressed);
+  value.value_ref().reset();
+  return true;
+}
+
+// static, public
+bool
+KvStore::decompressValue(thrift::Value& value) {
+  if (not value.compressedValue_ref().has_value() or
+      not value.hash_ref().has_value()) {
+    return false;
+  }
+  std::optional<std::string> data;
+  try {
+    data = getValueCodec().uncompress(*value.compressedValue_ref());
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to decompress value: " << folly::exceptionStr(e);
+    return false;
+  }
+  if (generateHash(*value.version_ref(), *value.originatorId_ref(), data) !=
+      *value.hash_ref()) {
+    return false;
+  }
+  value.value_ref() = std::move(*data);
+  value.compressedValue_ref().reset();
+  return true;
+}
+
+// static, public
+bool
+KvStore::mergeFloodParams(
+    thrift::KeySetParams& queued, thrift::KeySetParams const& params) {
+  if (queued.nodeIds_ref() != params.nodeIds_ref() or
+      queued.floodRootId_ref() != params.floodRootId_ref() or
+      queued.perfEvents_ref().has_value() or
+      params.perfEvents_ref().has_value()) {
+    return false;
+  }
+  for (auto const& [key, value] : *params.keyVals_ref()) {
+    auto it = queued.keyVals_ref()->find(key);
+    if (it == queued.keyVals_ref()->end() or
+        (value.value_ref().has_value() and
+         not value.patch_ref().has_value())) {
+      continue;
+    }
+    auto const& queuedValue = it->second;
+    if (value.patch_ref().has_value() or
+        *value.version_ref() != *queuedValue.version_ref() or
+        *value.originatorId_ref() != *queuedValue.originatorId_ref()) {
+      return false;
+    }
+  }
+
+  for (auto const& [key, value] : *params.keyVals_ref()) {
+    auto [it, inserted] = queued.keyVals_ref()->emplace(key, value);
+    if (inserted) {
+      continue;
+    }
+    if (value.value_ref().has_value()) {
+      it->second = value;
+    } else {
+      // ttl refresh of the queued version
+      it->second.ttl_ref() = *value.ttl_ref();
+      it->second.ttlVersion_ref() = *value.ttlVersion_ref();
+    }
+  }
+  queued.timestamp_ms_ref().copy_from(params.timestamp_ms_ref());
+  return true;
+}
+
+void
+FloodParamsCoalescer::add(thrift::KeySetParams&& params) {
+  if (params.nodeIds_ref().has_value() and not params.nodeIds_ref()->empty()) {
+    nodeId_ = params.nodeIds_ref()->back();
+  }
+  for (auto& [key, value] : *params.keyVals_ref()) {
+    auto it = keyVals_.find(key);
+    if (it != keyVals_.end() and not value.value_ref().has_value() and
+        not value.patch_ref().has_value() and
+        *it->second.version_ref() == *value.version_ref()) {
+      // TTL update of a value not sent yet
+      it->second.ttl_ref() = *value.ttl_ref();
+      it->second.ttlVersion_ref() = *value.ttlVersion_ref();
+      continue;
     }
+    // a patch of a value not sent yet misses its base, the peer requests
+    // the key on reception
+    keyVals_.insert_or_assign(key, std::move(value));
+  }
+}
 
-    // announce the update
-    kvUpdates.emplace(key, value);
+std::vector<thrift::KeySetParams>
+FloodParamsCoalescer::release() {
+  std::vector<thrift::KeySetParams> floods;
+  if (keyVals_.empty()) {
+    return floods;
+  }
+  thrift::KeySetParams params;
+  params.keyVals_ref() = std::move(keyVals_);
+  if (nodeId_.has_value()) {
+    params.nodeIds_ref() = std::vector<std::string>{*nodeId_};
   }
+  params.timestamp_ms_ref() = getUnixTimeStampMs();
+  floods.emplace_back(std::move(params));
+  keyVals_.clear();
+  return floods;
+}
 
-  VLOG(4) << "(mergeKeyValues) updating " << kvUpdates.size()
-          << " keyvals. ValueUpdates: " << valUpdateCnt
-          << ", TtlUpdates: " << ttlUpdateCnt;
-  return kvUpdates;
+// static, public
+std::string
+KvStore::encodeSnapshot(thrift::KvStoreSnapshot const& snapshot) {
+  const auto payload =
+      apache::thrift::CompactSerializer::serialize<std::string>(snapshot);
+  const uint32_t checksum = folly::Endian::big(
+      folly::crc32c(
+          reinterpret_cast<const uint8_t*>(payload.data()), payload.size()));
+
+  std::string data;
+  data.reserve(kSnapshotMarker.size() + sizeof(checksum) + payload.size());
+  data.append(kSnapshotMarker);
+  data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+  data.append(payload);
+  return data;
+}
+
+// static, public
+std::optional<thrift::KvStoreSnapshot>
+KvStore::decodeSnapshot(std::string const& data) {
+  const auto headerSize = kSnapshotMarker.size() + sizeof(uint32_t);
+  if (data.size() < headerSize or
+      data.compare(0, kSnapshotMarker.size(), kSnapshotMarker) != 0) {
+    LOG(ERROR) << "Snapshot has no valid header";
+    return std::nullopt;
+  }
+  uint32_t checksum{0};
+  std::memcpy(
+      &checksum, data.data() + kSnapshotMarker.size(), sizeof(checksum));
+  const auto payload = folly::StringPiece(data).subpiece(headerSize);
+  if (folly::Endian::big(checksum) !=
+      folly::crc32c(
+          reinterpret_cast<const uint8_t*>(payload.data()), payload.size())) {
+    LOG(ERROR) << "Snapshot checksum mismatch";
+    return std::nullopt;
+  }
+  try {
+    return apache::thrift::CompactSerializer::deserialize<
+        thrift::KvStoreSnapshot>(payload);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to deserialize snapshot: " << folly::exceptionStr(e);
+    return std::nullopt;
+  }
 }
 
 /**
@@ -521,6 +1518,39 @@ KvStore::getAreaDbOrThrow(
   return search->second;
 }
 
+OpenrEventBase&
+KvStore::getAreaEvb(std::string const& areaId) {
+  auto search = areaEvbs_.find(areaId);
+  if (search != areaEvbs_.end()) {
+    return *search->second;
+  }
+  if (areaEvbs_.size() == 1) {
+    // same fallback to the single area as in getAreaDbOrThrow()
+    return *areaEvbs_.begin()->second;
+  }
+  return *this;
+}
+
+void
+KvStore::runInAreaEventBaseThread(
+    std::string const& areaId, folly::EventBase::Func callback) {
+  getAreaEvb(areaId).runInEventBaseThread(
+      [this,
+       areaId,
+       callback = std::move(callback),
+       queuedAt = steady_clock::now()]() mutable {
+        // time spent waiting behind other work on this event base
+        if (kvStoreDb_.count(areaId)) {
+          fb303::fbData->addStatValue(
+              fmt::format("kvstore.area_queue_delay_ms.{}", areaId),
+              duration_cast<milliseconds>(steady_clock::now() - queuedAt)
+                  .count(),
+              fb303::AVG);
+        }
+        callback();
+      });
+}
+
 void
 KvStore::processCmdSocketRequest(std::vector<fbzmq::Message>&& req) noexcept {
   if (req.empty()) {
@@ -570,7 +1600,15 @@ KvStore::processRequestMsg(
     auto& kvStoreDb =
         getAreaDbOrThrow(thriftRequest.get_area(), "processRequestMsg");
     VLOG(2) << "Request received for area " << kvStoreDb.getAreaId();
-    auto response = kvStoreDb.processRequestMsgHelper(requestId, thriftRequest);
+    // zmq socket belongs to this thread, wait for the response
+    folly::Expected<fbzmq::Message, fbzmq::Error> response =
+        folly::makeUnexpected(fbzmq::Error());
+    getAreaEvb(kvStoreDb.getAreaId())
+        .getEvb()
+        ->runImmediatelyOrRunInEventBaseThreadAndWait([&]() {
+          response =
+              kvStoreDb.processRequestMsgHelper(requestId, thriftRequest);
+        });
     if (response.hasValue()) {
       fb303::fbData->addStatValue(
           "kvstore.peers.bytes_sent", response->size(), fb303::SUM);
@@ -604,94 +1642,212 @@ KvStore::getKvStoreKeyVals(
     std::string area, thrift::KeyGetParams keyGetParams) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyGetParams = std::move(keyGetParams),
-                        area]() mutable {
-    VLOG(3) << "Get key requested for AREA: " << area;
-    try {
-      auto& kvStoreDb = getAreaDbOrThrow(area, "getKvStoreKeyVals");
-      fb303::fbData->addStatValue("kvstore.cmd_key_get", 1, fb303::COUNT);
-
-      auto thriftPub = kvStoreDb.getKeyVals(*keyGetParams.keys_ref());
-      kvStoreDb.updatePublicationTtl(thriftPub);
-
-      p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keyGetParams = std::move(keyGetParams),
+       area]() mutable {
+        VLOG(3) << "Get key requested for AREA: " << area;
+        try {
+          auto& kvStoreDb = getAreaDbOrThrow(area, "getKvStoreKeyVals");
+          fb303::fbData->addStatValue("kvstore.cmd_key_get", 1, fb303::COUNT);
+
+          auto thriftPub = kvStoreDb.getKeyVals(*keyGetParams.keys_ref());
+          kvStoreDb.updatePublicationTtl(thriftPub);
+
+          p.setValue(
+              std::make_unique<thrift::Publication>(std::move(thriftPub)));
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::Publication>>>
 KvStore::dumpKvStoreKeys(
     thrift::KeyDumpParams keyDumpParams, std::set<std::string> selectAreas) {
-  folly::Promise<std::unique_ptr<std::vector<thrift::Publication>>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        selectAreas = std::move(selectAreas),
-                        keyDumpParams = std::move(keyDumpParams)]() mutable {
-    VLOG(3)
-        << "Dump all keys requested for "
-        << (selectAreas.empty()
-                ? "all areas."
-                : fmt::format("areas: {}.", folly::join(", ", selectAreas)));
+  VLOG(3) << "Dump all keys requested for "
+          << (selectAreas.empty()
+                  ? "all areas."
+                  : fmt::format("areas: {}.", folly::join(", ", selectAreas)));
+
+  // Each area is dumped on the event base owning its KvStoreDb and the
+  // per-area publications are collected once all of them are ready.
+  std::vector<folly::SemiFuture<std::optional<thrift::Publication>>> sfs;
+  for (auto const& area : selectAreas) {
+    folly::Promise<std::optional<thrift::Publication>> p;
+    sfs.emplace_back(p.getSemiFuture());
+    runInAreaEventBaseThread(
+        area, [this, p = std::move(p), area, keyDumpParams]() mutable {
+          try {
+            auto& kvStoreDb = getAreaDbOrThrow(area, "dumpKvStoreKeys");
+            fb303::fbData->addStatValue(
+                "kvstore.cmd_key_dump", 1, fb303::COUNT);
+
+            std::vector<std::string> keyPrefixList;
+            if (keyDumpParams.keys_ref().has_value()) {
+              keyPrefixList = *keyDumpParams.keys_ref();
+            } else {
+              folly::split(
+                  ",", *keyDumpParams.prefix_ref(), keyPrefixList, true);
+            }
+            const auto keyPrefixMatch = KvStoreFilters(
+                keyPrefixList, *keyDumpParams.originatorIds_ref());
 
-    auto result = std::make_unique<std::vector<thrift::Publication>>();
-    for (auto& area : selectAreas) {
-      try {
-        auto& kvStoreDb = getAreaDbOrThrow(area, "dumpKvStoreKeys");
-        fb303::fbData->addStatValue("kvstore.cmd_key_dump", 1, fb303::COUNT);
+            thrift::FilterOperator oper = thrift::FilterOperator::OR;
+            if (keyDumpParams.oper_ref().has_value()) {
+              oper = *keyDumpParams.oper_ref();
+            }
 
-        std::vector<std::string> keyPrefixList;
-        if (keyDumpParams.keys_ref().has_value()) {
-          keyPrefixList = *keyDumpParams.keys_ref();
-        } else {
-          folly::split(",", *keyDumpParams.prefix_ref(), keyPrefixList, true);
-        }
-        const auto keyPrefixMatch =
-            KvStoreFilters(keyPrefixList, *keyDumpParams.originatorIds_ref());
+            thrift::Publication thriftPub;
+            std::optional<thrift::Publication> changesPub;
+            if (keyDumpParams.changesSince_ref().has_value() and
+                not keyDumpParams.keyValHashes_ref().has_value()) {
+              // incremental full-sync request from a peer synced before
+              changesPub = kvStoreDb.dumpChangesSince(
+                  *keyDumpParams.changesSince_ref(), keyPrefixMatch, oper);
+            }
+            if (changesPub.has_value()) {
+              thriftPub = std::move(*changesPub);
+              LOG(INFO) << "[Thrift Sync] Processed incremental full-sync "
+                        << "request. Sending "
+                        << thriftPub.keyVals_ref()->size()
+                        << " key-vals changed since sequence "
+                        << *keyDumpParams.changesSince_ref()->sequence_ref();
+            } else if (
+                keyDumpParams.keyValBucketHashes_ref().has_value() and
+                not keyDumpParams.keyValHashes_ref().has_value()) {
+              // full-sync request with a summary of the requester's KV store
+              thriftPub = kvStoreDb.dumpBucketDifference(
+                  *keyDumpParams.keyValBucketHashes_ref(),
+                  keyPrefixMatch,
+                  oper);
+              LOG(INFO) << "[Thrift Sync] Processed full-sync request with "
+                        << keyDumpParams.keyValBucketHashes_ref()->size()
+                        << " bucket hashes. Sending "
+                        << thriftPub.keyVals_ref()->size() << " key-vals from "
+                        << thriftPub.keyValBuckets_ref()->size()
+                        << " differing buckets";
+            } else if (
+                keyDumpParams.keyValHashes_ref().has_value() and
+                not *keyDumpParams.doNotPublishValue_ref()) {
+              // full-sync request with hashes of every key, compared with
+              // the dump shared by concurrent requests
+              auto dump = kvStoreDb.getCachedDump(
+                  keyPrefixMatch, oper, false /* hashOnly */);
+              thriftPub = kvStoreDb.dumpDifference(
+                  *dump->keyVals_ref(),
+                  keyDumpParams.keyValHashes_ref().value());
+            } else {
+              thriftPub = kvStoreDb.dumpAllWithFilters(
+                  keyPrefixMatch, oper, *keyDumpParams.doNotPublishValue_ref());
+              if (keyDumpParams.keyValHashes_ref().has_value()) {
+                thriftPub = kvStoreDb.dumpDifference(
+                    *thriftPub.keyVals_ref(),
+                    keyDumpParams.keyValHashes_ref().value());
+              }
+            }
+            kvStoreDb.updatePublicationTtl(thriftPub);
+            // I'm the initiator, set flood-root-id
+            thriftPub.floodRootId_ref().from_optional(kvStoreDb.getSptRootId());
+            if (keyDumpParams.keyValBucketHashes_ref().has_value() or
+                keyDumpParams.changesSince_ref().has_value()) {
+              // full-sync requester asks for changes since next time
+              thriftPub.changeLogPosition_ref() =
+                  kvStoreDb.getChangeLogPosition();
+            }
+            if (auto senderId = keyDumpParams.senderId_ref()) {
+              kvStoreDb.updatePeerValueCompression(
+                  *senderId,
+                  keyDumpParams.acceptCompressedValues_ref().value_or(false),
+                  thriftPub);
+            }
 
-        thrift::FilterOperator oper = thrift::FilterOperator::OR;
-        if (keyDumpParams.oper_ref().has_value()) {
-          oper = *keyDumpParams.oper_ref();
-        }
+            if (keyDumpParams.keyValHashes_ref().has_value() and
+                (*keyDumpParams.prefix_ref()).empty() and
+                (not keyDumpParams.keys_ref().has_value() or
+                 (*keyDumpParams.keys_ref()).empty())) {
+              // This usually comes from neighbor nodes
+              size_t numMissingKeys = 0;
+              if (thriftPub.tobeUpdatedKeys_ref().has_value()) {
+                numMissingKeys = thriftPub.tobeUpdatedKeys_ref()->size();
+              }
+              LOG(INFO) << "[Thrift Sync] Processed full-sync request with "
+                        << keyDumpParams.keyValHashes_ref().value().size()
+                        << " keyValHashes item(s). Sending "
+                        << thriftPub.keyVals_ref()->size() << " key-vals and "
+                        << numMissingKeys << " missing keys";
+            }
+            p.setValue(std::move(thriftPub));
+          } catch (thrift::OpenrError const& e) {
+            LOG(ERROR) << " Failed to find area " << area << " in kvStoreDb_.";
+            p.setValue(std::nullopt);
+          }
+        });
+  }
 
-        auto thriftPub = kvStoreDb.dumpAllWithFilters(
-            keyPrefixMatch, oper, *keyDumpParams.doNotPublishValue_ref());
-        if (keyDumpParams.keyValHashes_ref().has_value()) {
-          thriftPub = kvStoreDb.dumpDifference(
-              *thriftPub.keyVals_ref(),
-              keyDumpParams.keyValHashes_ref().value());
-        }
-        kvStoreDb.updatePublicationTtl(thriftPub);
-        // I'm the initiator, set flood-root-id
-        thriftPub.floodRootId_ref().from_optional(kvStoreDb.getSptRootId());
-
-        if (keyDumpParams.keyValHashes_ref().has_value() and
-            (*keyDumpParams.prefix_ref()).empty() and
-            (not keyDumpParams.keys_ref().has_value() or
-             (*keyDumpParams.keys_ref()).empty())) {
-          // This usually comes from neighbor nodes
-          size_t numMissingKeys = 0;
-          if (thriftPub.tobeUpdatedKeys_ref().has_value()) {
-            numMissingKeys = thriftPub.tobeUpdatedKeys_ref()->size();
+  return folly::collect(std::move(sfs))
+      .deferValue(
+          [](std::vector<std::optional<thrift::Publication>>&& pubs) {
+            auto result = std::make_unique<std::vector<thrift::Publication>>();
+            for (auto& pub : pubs) {
+              if (pub.has_value()) {
+                result->push_back(std::move(pub).value());
+              }
+            }
+            return result;
+          });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::KvStoreKeyValsPage>>
+KvStore::dumpKvStoreKeysPage(
+    std::string area,
+    thrift::KeyDumpParams keyDumpParams,
+    thrift::PageParams page) {
+  folly::Promise<std::unique_ptr<thrift::KvStoreKeyValsPage>> p;
+  auto sf = p.getSemiFuture();
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       area,
+       keyDumpParams = std::move(keyDumpParams),
+       page = std::move(page)]() mutable {
+        try {
+          auto& kvStoreDb = getAreaDbOrThrow(area, "dumpKvStoreKeysPage");
+          fb303::fbData->addStatValue(
+              "kvstore.cmd_key_dump_page", 1, fb303::COUNT);
+
+          if (keyDumpParams.keyValHashes_ref().has_value() or
+              keyDumpParams.keyValBucketHashes_ref().has_value()) {
+            throw thrift::OpenrError(
+                "Paginated dump doesn't support keyValHashes or "
+                "keyValBucketHashes");
+          }
+
+          std::vector<std::string> keyPrefixList;
+          if (keyDumpParams.keys_ref().has_value()) {
+            keyPrefixList = *keyDumpParams.keys_ref();
+          } else {
+            folly::split(",", *keyDumpParams.prefix_ref(), keyPrefixList, true);
           }
-          LOG(INFO) << "[Thrift Sync] Processed full-sync request with "
-                    << keyDumpParams.keyValHashes_ref().value().size()
-                    << " keyValHashes item(s). Sending "
-                    << thriftPub.keyVals_ref()->size() << " key-vals and "
-                    << numMissingKeys << " missing keys";
+          const auto keyPrefixMatch =
+              KvStoreFilters(keyPrefixList, *keyDumpParams.originatorIds_ref());
+
+          auto thriftPage = kvStoreDb.dumpPageWithFilters(
+              keyPrefixMatch,
+              keyDumpParams.oper_ref().value_or(thrift::FilterOperator::OR),
+              *keyDumpParams.doNotPublishValue_ref(),
+              page);
+          kvStoreDb.updatePublicationTtl(*thriftPage.publication_ref());
+          p.setValue(std::make_unique<thrift::KvStoreKeyValsPage>(
+              std::move(thriftPage)));
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
         }
-        result->push_back(std::move(thriftPub));
-      } catch (thrift::OpenrError const& e) {
-        LOG(ERROR) << " Failed to find area " << area << " in kvStoreDb_.";
-      }
-    }
-    p.setValue(std::move(result));
-  });
+      });
   return sf;
 }
 
@@ -700,30 +1856,34 @@ KvStore::dumpKvStoreHashes(
     std::string area, thrift::KeyDumpParams keyDumpParams) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyDumpParams = std::move(keyDumpParams),
-                        area]() mutable {
-    VLOG(3) << "Dump all hashes requested for AREA: " << area;
-    try {
-      auto& kvStoreDb = getAreaDbOrThrow(area, "dumpKvStoreHashes");
-      fb303::fbData->addStatValue("kvstore.cmd_hash_dump", 1, fb303::COUNT);
-
-      std::set<std::string> originator{};
-      std::vector<std::string> keyPrefixList{};
-      if (keyDumpParams.keys_ref().has_value()) {
-        keyPrefixList = *keyDumpParams.keys_ref();
-      } else {
-        folly::split(",", *keyDumpParams.prefix_ref(), keyPrefixList, true);
-      }
-      KvStoreFilters kvFilters{keyPrefixList, originator};
-      auto thriftPub = kvStoreDb.dumpHashWithFilters(kvFilters);
-      kvStoreDb.updatePublicationTtl(thriftPub);
-      p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keyDumpParams = std::move(keyDumpParams),
+       area]() mutable {
+        VLOG(3) << "Dump all hashes requested for AREA: " << area;
+        try {
+          auto& kvStoreDb = getAreaDbOrThrow(area, "dumpKvStoreHashes");
+          fb303::fbData->addStatValue("kvstore.cmd_hash_dump", 1, fb303::COUNT);
+
+          std::set<std::string> originator{};
+          std::vector<std::string> keyPrefixList{};
+          if (keyDumpParams.keys_ref().has_value()) {
+            keyPrefixList = *keyDumpParams.keys_ref();
+          } else {
+            folly::split(",", *keyDumpParams.prefix_ref(), keyPrefixList, true);
+          }
+          KvStoreFilters kvFilters{keyPrefixList, originator};
+          auto thriftPub = *kvStoreDb.getCachedDump(
+              kvFilters, thrift::FilterOperator::OR, true /* hashOnly */);
+          kvStoreDb.updatePublicationTtl(thriftPub);
+          p.setValue(
+              std::make_unique<thrift::Publication>(std::move(thriftPub)));
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
@@ -732,49 +1892,45 @@ KvStore::setKvStoreKeyVals(
     std::string area, thrift::KeySetParams keySetParams) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keySetParams = std::move(keySetParams),
-                        area]() mutable {
-    VLOG(3) << "Set key requested for AREA: " << area;
-    try {
-      auto& kvStoreDb = getAreaDbOrThrow(area, "setKvStoreKeyVals");
-      // Update statistics
-      fb303::fbData->addStatValue("kvstore.cmd_key_set", 1, fb303::COUNT);
-      if (keySetParams.timestamp_ms_ref().has_value()) {
-        auto floodMs =
-            getUnixTimeStampMs() - keySetParams.timestamp_ms_ref().value();
-        if (floodMs > 0) {
-          fb303::fbData->addStatValue(
-              "kvstore.flood_duration_ms", floodMs, fb303::AVG);
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keySetParams = std::move(keySetParams),
+       area]() mutable {
+        VLOG(3) << "Set key requested for AREA: " << area;
+        try {
+          auto& kvStoreDb = getAreaDbOrThrow(area, "setKvStoreKeyVals");
+          // Update statistics
+          fb303::fbData->addStatValue("kvstore.cmd_key_set", 1, fb303::COUNT);
+          // ready to return once merged
+          kvStoreDb.setKeyValsCombined(std::move(keySetParams), std::move(p));
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
         }
-      }
+      });
+  return sf;
+}
 
-      // Update hash for key-values
-      for (auto& [_, value] : *keySetParams.keyVals_ref()) {
-        if (value.value_ref().has_value()) {
-          value.hash_ref() = generateHash(
-              *value.version_ref(),
-              *value.originatorId_ref(),
-              value.value_ref());
+void
+KvStore::addKvStoreFloodStream(
+    std::string area,
+    std::string peerName,
+    KvStoreFloodStreamPublisher publisher) {
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       area,
+       peerName = std::move(peerName),
+       publisher = std::move(publisher)]() mutable {
+        try {
+          getAreaDbOrThrow(area, "addKvStoreFloodStream")
+              .addFloodStream(peerName, std::move(publisher));
+        } catch (thrift::OpenrError const& e) {
+          publisher.complete(
+              folly::make_exception_wrapper<thrift::OpenrError>(e));
         }
-      }
-
-      // Create publication and merge it with local KvStore
-      thrift::Publication rcvdPublication;
-      rcvdPublication.keyVals_ref() = std::move(*keySetParams.keyVals_ref());
-      rcvdPublication.nodeIds_ref().move_from(keySetParams.nodeIds_ref());
-      rcvdPublication.floodRootId_ref().move_from(
-          keySetParams.floodRootId_ref());
-      kvStoreDb.mergePublication(rcvdPublication);
-
-      // ready to return
-      p.setValue();
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
-  return sf;
+      });
 }
 
 folly::SemiFuture<std::optional<thrift::KvStorePeerState>>
@@ -782,8 +1938,8 @@ KvStore::getKvStorePeerState(
     std::string const& area, std::string const& peerName) {
   folly::Promise<std::optional<thrift::KvStorePeerState>> promise;
   auto sf = promise.getSemiFuture();
-  runInEventBaseThread(
-      [this, p = std::move(promise), peerName, area]() mutable {
+  runInAreaEventBaseThread(
+      area, [this, p = std::move(promise), peerName, area]() mutable {
         try {
           p.setValue(getAreaDbOrThrow(area, "getKvStorePeerState")
                          .getCurrentState(peerName));
@@ -798,76 +1954,93 @@ folly::SemiFuture<std::unique_ptr<thrift::PeersMap>>
 KvStore::getKvStorePeers(std::string area) {
   folly::Promise<std::unique_ptr<thrift::PeersMap>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this, p = std::move(p), area]() mutable {
-    VLOG(2) << "Peer dump requested for AREA: " << area;
-    try {
-      p.setValue(std::make_unique<thrift::PeersMap>(
-          getAreaDbOrThrow(area, "getKvStorePeers").dumpPeers()));
-      fb303::fbData->addStatValue("kvstore.cmd_peer_dump", 1, fb303::COUNT);
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area, [this, p = std::move(p), area]() mutable {
+        VLOG(2) << "Peer dump requested for AREA: " << area;
+        try {
+          p.setValue(std::make_unique<thrift::PeersMap>(
+              getAreaDbOrThrow(area, "getKvStorePeers").dumpPeers()));
+          fb303::fbData->addStatValue("kvstore.cmd_peer_dump", 1, fb303::COUNT);
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::KvStoreAreaSummary>>>
 KvStore::getKvStoreAreaSummaryInternal(std::set<std::string> selectAreas) {
-  folly::Promise<std::unique_ptr<std::vector<thrift::KvStoreAreaSummary>>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        selectAreas = std::move(selectAreas)]() mutable {
-    LOG(INFO)
-        << "KvStore Summary requested for "
-        << (selectAreas.empty()
-                ? "all areas."
-                : fmt::format("areas: {}.", folly::join(", ", selectAreas)));
-
-    auto result = std::make_unique<std::vector<thrift::KvStoreAreaSummary>>();
-    for (auto& [area, kvStoreDb] : kvStoreDb_) {
-      thrift::KvStoreAreaSummary areaSummary;
-
-      areaSummary.area_ref() = area;
-      auto kvDbCounters = kvStoreDb.getCounters();
-      areaSummary.keyValsCount_ref() = kvDbCounters["kvstore.num_keys"];
-      areaSummary.peersMap_ref() = kvStoreDb.dumpPeers();
-      areaSummary.keyValsBytes_ref() = kvStoreDb.getKeyValsSize();
-
-      result->emplace_back(std::move(areaSummary));
-    }
-    p.setValue(std::move(result));
-  });
-  return sf;
+  LOG(INFO) << "KvStore Summary requested for "
+            << (selectAreas.empty()
+                    ? "all areas."
+                    : fmt::format(
+                          "areas: {}.", folly::join(", ", selectAreas)));
+
+  std::vector<folly::SemiFuture<thrift::KvStoreAreaSummary>> sfs;
+  for (auto& [area, _] : kvStoreDb_) {
+    folly::Promise<thrift::KvStoreAreaSummary> p;
+    sfs.emplace_back(p.getSemiFuture());
+    runInAreaEventBaseThread(
+        area, [this, p = std::move(p), area = area]() mutable {
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          thrift::KvStoreAreaSummary areaSummary;
+
+          areaSummary.area_ref() = area;
+          auto kvDbCounters = kvStoreDb.getCounters();
+          areaSummary.keyValsCount_ref() = kvDbCounters["kvstore.num_keys"];
+          areaSummary.peersMap_ref() = kvStoreDb.dumpPeers();
+          areaSummary.keyValsBytes_ref() = kvStoreDb.getKeyValsSize();
+
+          p.setValue(std::move(areaSummary));
+        });
+  }
+
+  return folly::collect(std::move(sfs))
+      .deferValue([](std::vector<thrift::KvStoreAreaSummary>&& summaries) {
+        return std::make_unique<std::vector<thrift::KvStoreAreaSummary>>(
+            std::move(summaries));
+      });
+}
+
+int64_t
+KvStore::getKvStoreSummaryGeneration() const {
+  int64_t generation{0};
+  for (auto const& [_, kvStoreDb] : kvStoreDb_) {
+    generation += kvStoreDb.getSummaryGeneration();
+  }
+  return generation;
 }
 
 folly::SemiFuture<folly::Unit>
 KvStore::addUpdateKvStorePeers(std::string area, thrift::PeersMap peersToAdd) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        peersToAdd = std::move(peersToAdd),
-                        area]() mutable {
-    try {
-      auto str = folly::gen::from(peersToAdd) | folly::gen::get<0>() |
-          folly::gen::as<std::vector<std::string>>();
-
-      LOG(INFO) << "Peer addition for: [" << folly::join(",", str)
-                << "] in area: " << area;
-      auto& kvStoreDb = getAreaDbOrThrow(area, "addUpdateKvStorePeers");
-      if (peersToAdd.empty()) {
-        p.setException(thrift::OpenrError(
-            "Empty peerNames from peer-add request, ignoring"));
-      } else {
-        fb303::fbData->addStatValue("kvstore.cmd_peer_add", 1, fb303::COUNT);
-        kvStoreDb.addPeers(peersToAdd);
-        p.setValue();
-      }
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       peersToAdd = std::move(peersToAdd),
+       area]() mutable {
+        try {
+          auto str = folly::gen::from(peersToAdd) | folly::gen::get<0>() |
+              folly::gen::as<std::vector<std::string>>();
+
+          LOG(INFO) << "Peer addition for: [" << folly::join(",", str)
+                    << "] in area: " << area;
+          auto& kvStoreDb = getAreaDbOrThrow(area, "addUpdateKvStorePeers");
+          if (peersToAdd.empty()) {
+            p.setException(thrift::OpenrError(
+                "Empty peerNames from peer-add request, ignoring"));
+          } else {
+            fb303::fbData->addStatValue(
+                "kvstore.cmd_peer_add", 1, fb303::COUNT);
+            kvStoreDb.addPeers(peersToAdd);
+            p.setValue();
+          }
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
@@ -876,26 +2049,28 @@ KvStore::deleteKvStorePeers(
     std::string area, std::vector<std::string> peersToDel) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        peersToDel = std::move(peersToDel),
-                        area]() mutable {
-    LOG(INFO) << "Peer deletion for: [" << folly::join(",", peersToDel)
-              << "] in area: " << area;
-    try {
-      auto& kvStoreDb = getAreaDbOrThrow(area, "deleteKvStorePeers");
-      if (peersToDel.empty()) {
-        p.setException(thrift::OpenrError(
-            "Empty peerNames from peer-del request, ignoring"));
-      } else {
-        fb303::fbData->addStatValue("kvstore.cmd_per_del", 1, fb303::COUNT);
-        kvStoreDb.delPeers(peersToDel);
-        p.setValue();
-      }
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       peersToDel = std::move(peersToDel),
+       area]() mutable {
+        LOG(INFO) << "Peer deletion for: [" << folly::join(",", peersToDel)
+                  << "] in area: " << area;
+        try {
+          auto& kvStoreDb = getAreaDbOrThrow(area, "deleteKvStorePeers");
+          if (peersToDel.empty()) {
+            p.setException(thrift::OpenrError(
+                "Empty peerNames from peer-del request, ignoring"));
+          } else {
+            fb303::fbData->addStatValue("kvstore.cmd_per_del", 1, fb303::COUNT);
+            kvStoreDb.delPeers(peersToDel);
+            p.setValue();
+          }
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
@@ -903,16 +2078,17 @@ folly::SemiFuture<std::unique_ptr<thrift::SptInfos>>
 KvStore::getSpanningTreeInfos(std::string area) {
   folly::Promise<std::unique_ptr<thrift::SptInfos>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this, p = std::move(p), area]() mutable {
-    VLOG(3) << "FLOOD_TOPO_GET command requested for AREA: " << area;
-    try {
-      p.setValue(std::make_unique<thrift::SptInfos>(
-          getAreaDbOrThrow(area, "getSpanningTreeInfos")
-              .processFloodTopoGet()));
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area, [this, p = std::move(p), area]() mutable {
+        VLOG(3) << "FLOOD_TOPO_GET command requested for AREA: " << area;
+        try {
+          p.setValue(std::make_unique<thrift::SptInfos>(
+              getAreaDbOrThrow(area, "getSpanningTreeInfos")
+                  .processFloodTopoGet()));
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
@@ -921,19 +2097,21 @@ KvStore::updateFloodTopologyChild(
     std::string area, thrift::FloodTopoSetParams floodTopoSetParams) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        floodTopoSetParams = std::move(floodTopoSetParams),
-                        area]() mutable {
-    VLOG(2) << "FLOOD_TOPO_SET command requested for AREA: " << area;
-    try {
-      getAreaDbOrThrow(area, "updateFloodTopologyChild")
-          .processFloodTopoSet(std::move(floodTopoSetParams));
-      p.setValue();
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       floodTopoSetParams = std::move(floodTopoSetParams),
+       area]() mutable {
+        VLOG(2) << "FLOOD_TOPO_SET command requested for AREA: " << area;
+        try {
+          getAreaDbOrThrow(area, "updateFloodTopologyChild")
+              .processFloodTopoSet(std::move(floodTopoSetParams));
+          p.setValue();
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
@@ -942,44 +2120,56 @@ KvStore::processKvStoreDualMessage(
     std::string area, thrift::DualMessages dualMessages) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        dualMessages = std::move(dualMessages),
-                        area]() mutable {
-    VLOG(2) << "DUAL messages received for AREA: " << area;
-    try {
-      auto& kvStoreDb = getAreaDbOrThrow(area, "processKvStoreDualMessage");
-      if (dualMessages.messages_ref()->empty()) {
-        LOG(ERROR) << "Empty DUAL msg receved";
-        p.setValue();
-      } else {
-        fb303::fbData->addStatValue(
-            "kvstore.received_dual_messages", 1, fb303::COUNT);
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       dualMessages = std::move(dualMessages),
+       area]() mutable {
+        VLOG(2) << "DUAL messages received for AREA: " << area;
+        try {
+          auto& kvStoreDb = getAreaDbOrThrow(area, "processKvStoreDualMessage");
+          if (dualMessages.messages_ref()->empty()) {
+            LOG(ERROR) << "Empty DUAL msg receved";
+            p.setValue();
+          } else {
+            fb303::fbData->addStatValue(
+                "kvstore.received_dual_messages", 1, fb303::COUNT);
 
-        kvStoreDb.processDualMessages(std::move(dualMessages));
-        p.setValue();
-      }
-    } catch (thrift::OpenrError const& e) {
-      p.setException(e);
-    }
-  });
+            kvStoreDb.processDualMessages(std::move(dualMessages));
+            p.setValue();
+          }
+        } catch (thrift::OpenrError const& e) {
+          p.setException(e);
+        }
+      });
   return sf;
 }
 
 folly::SemiFuture<std::map<std::string, int64_t>>
 KvStore::getCounters() {
-  auto pf = folly::makePromiseContract<std::map<std::string, int64_t>>();
-  runInEventBaseThread([this, p = std::move(pf.first)]() mutable {
-    p.setValue(getGlobalCounters());
-  });
-  return std::move(pf.second);
+  std::vector<folly::SemiFuture<std::map<std::string, int64_t>>> sfs;
+  for (auto& [area, _] : kvStoreDb_) {
+    auto pf = folly::makePromiseContract<std::map<std::string, int64_t>>();
+    sfs.emplace_back(std::move(pf.second));
+    runInAreaEventBaseThread(
+        area, [this, p = std::move(pf.first), area = area]() mutable {
+          p.setValue(kvStoreDb_.at(area).getCounters());
+        });
+  }
+  return folly::collect(std::move(sfs))
+      .deferValue(
+          [](std::vector<std::map<std::string, int64_t>>&& areaCounters) {
+            return mergeCounters(areaCounters);
+          });
 }
 
+// static
 std::map<std::string, int64_t>
-KvStore::getGlobalCounters() const {
+KvStore::mergeCounters(
+    std::vector<std::map<std::string, int64_t>> const& areaCounters) {
   std::map<std::string, int64_t> flatCounters;
-  for (auto& [_, kvDb] : kvStoreDb_) {
-    auto kvDbCounters = kvDb.getCounters();
+  for (auto const& kvDbCounters : areaCounters) {
     // add up counters for same key from all kvStoreDb instances
     flatCounters = std::accumulate(
         kvDbCounters.begin(),
@@ -997,21 +2187,26 @@ KvStore::getGlobalCounters() const {
 // static util function to fetch peers by state
 std::vector<std::string>
 KvStoreDb::getPeersByState(thrift::KvStorePeerState state) {
-  std::vector<std::string> res;
-  for (auto const& [_, peer] : thriftPeers_) {
-    if (peer.peerSpec.get_state() == state) {
-      res.emplace_back(peer.nodeName);
-    }
+  auto it = peersByState_.find(state);
+  if (it == peersByState_.end()) {
+    return {};
   }
-  return res;
+  return {it->second.begin(), it->second.end()};
+}
+
+size_t
+KvStoreDb::getNumPeersByState(thrift::KvStorePeerState state) const {
+  auto it = peersByState_.find(state);
+  return it == peersByState_.end() ? 0 : it->second.size();
 }
 
-// static util function to log state transition
+// util function to log state transition
 void
 KvStoreDb::logStateTransition(
     std::string const& peerName,
     thrift::KvStorePeerState oldState,
     thrift::KvStorePeerState newState) {
+  ++summaryGeneration_;
   SYSLOG(INFO)
       << EventTag() << "State change: ["
       << apache::thrift::util::enumNameSafe<thrift::KvStorePeerState>(oldState)
@@ -1021,6 +2216,18 @@ KvStoreDb::logStateTransition(
       << "for peer: " << peerName;
 }
 
+void
+KvStoreDb::setPeerState(
+    std::string const& peerName,
+    KvStorePeer& peer,
+    thrift::KvStorePeerState state) {
+  const auto oldState = peer.peerSpec.get_state();
+  logStateTransition(peerName, oldState, state);
+  peersByState_[oldState].erase(peerName);
+  peersByState_[state].emplace(peerName);
+  peer.peerSpec.state_ref() = state;
+}
+
 // static util function to fetch current peer state
 std::optional<thrift::KvStorePeerState>
 KvStoreDb::getCurrentState(std::string const& peerName) {
@@ -1149,6 +2356,24 @@ KvStoreDb::KvStorePeer::getOrCreateThriftClient(
   return true;
 }
 
+void
+KvStoreDb::KvStorePeer::resetFloodPipeline() {
+  for (auto const& params : queuedFloods) {
+    for (auto const& [key, _] : params.get_keyVals()) {
+      pendingKeysDuringInitialization.insert(key);
+    }
+  }
+  queuedFloods.clear();
+  numPendingFloods = 0;
+  floodSubscriptionPending = false;
+  if (floodSubscription.has_value()) {
+    floodSubscription->cancel();
+    std::move(*floodSubscription).detach();
+    floodSubscription.reset();
+  }
+  client.reset();
+}
+
 //
 // KvStoreDb is the class instance that maintains the KV pairs with internal
 // map per AREA. KvStoreDb will sync with peers to maintain eventual
@@ -1167,7 +2392,11 @@ KvStoreDb::KvStorePeer::getOrCreateThriftClient(
 //  peer; kvstore.thrift.num_full_sync_success: # of successful full-sync
 //  performed; kvstore.thrift.num_full_sync_failure: # of failed full-sync
 //  performed; kvstore.thrift.full_sync_duration_ms: avg time elapsed for a
-//  full-sync req;
+//  full-sync req; kvstore.thrift.num_differing_buckets: # of buckets
+//  which differ from peer's in full-sync responses;
+//  kvstore.thrift.num_full_sync_chunks: # of chunks large full-sync
+//  responses were merged in; kvstore.thrift.parallel_sync_limit: avg # of
+//  full-syncs allowed in flight;
 //
 //  kvstore.thrift.num_flood_pub: # of flooding req issued;
 //  kvstore.thrift.num_flood_key_vals: # of keyVals one flooding req
@@ -1193,19 +2422,53 @@ KvStoreDb::KvStoreDb(
       kvParams_(kvParams),
       area_(area),
       peerSyncSock_(std::move(peersyncSock)),
+      keyClasses_(kvParams.keyClasses),
       evb_(evb) {
   if (kvParams_.floodRate) {
     floodLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
         *kvParams_.floodRate->flood_msg_per_sec_ref(),
         *kvParams_.floodRate->flood_msg_burst_size_ref());
+    priorityFloodLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
+        *kvParams_.floodRate->flood_msg_per_sec_ref(),
+        *kvParams_.floodRate->flood_msg_burst_size_ref());
     pendingPublicationTimer_ =
         folly::AsyncTimeout::make(*evb_->getEvb(), [this]() noexcept {
-          if (!floodLimiter_->consume(1)) {
+          bool const keysHeld = releaseHeldKeys();
+          if (not publicationBuffer_.empty()) {
+            if (!floodLimiter_->consume(1)) {
+              pendingPublicationTimer_->scheduleTimeout(
+                  Constants::kFloodPendingPublication);
+              return;
+            }
+            floodBufferedUpdates();
+          }
+          if (keysHeld) {
             pendingPublicationTimer_->scheduleTimeout(
                 Constants::kFloodPendingPublication);
+          }
+        });
+  }
+  if (kvParams_.floodCoalesce) {
+    const std::chrono::milliseconds minWindow{
+        *kvParams_.floodCoalesce->min_window_ms_ref()};
+    const std::chrono::milliseconds maxWindow{
+        *kvParams_.floodCoalesce->max_window_ms_ref()};
+    coalesceWindow_ = minWindow;
+    coalesceTimer_ = folly::AsyncTimeout::make(
+        *evb_->getEvb(), [this, minWindow, maxWindow]() noexcept {
+          if (not coalesceWindowBusy_) {
+            // quiet window, close it. Next publication is flooded right away
+            coalesceWindow_ = std::max(coalesceWindow_ / 2, minWindow);
             return;
           }
-          floodBufferedUpdates();
+          // busy window, flood what was merged and keep coalescing over a
+          // longer window
+          coalesceWindowBusy_ = false;
+          coalesceWindow_ = std::min(coalesceWindow_ * 2, maxWindow);
+          if (numCoalescedPubs_) {
+            floodCoalescedUpdates();
+          }
+          coalesceTimer_->scheduleTimeout(coalesceWindow_);
         });
   }
 
@@ -1223,10 +2486,28 @@ KvStoreDb::KvStoreDb(
         *evb_->getEvb(), [this]() noexcept { requestFullSyncFromPeers(); });
   }
 
+  // Send out dual messages of all events handled in one loop iteration
+  dualFlushTimer_ = folly::AsyncTimeout::make(
+      *evb_->getEvb(), [this]() noexcept { flushDualMessages(); });
+
+  // Merge local writes of all calls handled in one loop iteration
+  combinedKeyValsTimer_ = folly::AsyncTimeout::make(
+      *evb_->getEvb(), [this]() noexcept { flushCombinedKeyVals(); });
+
   // Perform full-sync if there are peers to sync with.
   thriftSyncTimer_ = folly::AsyncTimeout::make(
       *evb_->getEvb(), [this]() noexcept { requestThriftPeerSync(); });
 
+  // Periodically write snapshots for warm restart
+  if (kvParams_.snapshotFilePath) {
+    snapshotTimer_ =
+        folly::AsyncTimeout::make(*evb_->getEvb(), [this]() noexcept {
+          writeSnapshot();
+          snapshotTimer_->scheduleTimeout(kvParams_.snapshotInterval);
+        });
+    snapshotTimer_->scheduleTimeout(kvParams_.snapshotInterval);
+  }
+
   // Hook up timer with cleanupTtlCountdownQueue(). The actual scheduling
   // happens within updateTtlCountdownQueue()
   ttlCountdownTimer_ = folly::AsyncTimeout::make(
@@ -1241,6 +2522,8 @@ KvStoreDb::KvStoreDb(
       "kvstore.thrift.num_full_sync_success", fb303::COUNT);
   fb303::fbData->addStatExportType(
       "kvstore.thrift.num_full_sync_failure", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.num_incremental_sync", fb303::COUNT);
   fb303::fbData->addStatExportType(
       "kvstore.thrift.num_flood_pub", fb303::COUNT);
   fb303::fbData->addStatExportType(
@@ -1260,6 +2543,8 @@ KvStoreDb::KvStoreDb(
 
   fb303::fbData->addStatExportType(
       "kvstore.thrift.full_sync_duration_ms", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.parallel_sync_limit", fb303::AVG);
   fb303::fbData->addStatExportType(
       "kvstore.thrift.flood_pub_duration_ms", fb303::AVG);
   fb303::fbData->addStatExportType(
@@ -1269,10 +2554,16 @@ KvStoreDb::KvStoreDb(
 
   fb303::fbData->addStatExportType(
       "kvstore.thrift.num_missing_keys", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.num_differing_buckets", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.num_full_sync_chunks", fb303::COUNT);
   fb303::fbData->addStatExportType(
       "kvstore.thrift.num_flood_key_vals", fb303::SUM);
   fb303::fbData->addStatExportType(
       "kvstore.thrift.num_keyvals_update", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.num_flood_value_patches", fb303::SUM);
 
   // TODO: remove `kvstore.zmq.*` counters once ZMQ socket is deprecated
   fb303::fbData->addStatExportType("kvstore.zmq.num_missing_keys", fb303::SUM);
@@ -1280,6 +2571,8 @@ KvStoreDb::KvStoreDb(
       "kvstore.zmq.num_keyvals_update", fb303::SUM);
 
   // Initialize stats keys
+  fb303::fbData->addStatExportType(
+      "kvstore.applied_value_patches", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_hash_dump", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_key_dump", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_key_get", fb303::COUNT);
@@ -1288,9 +2581,28 @@ KvStoreDb::KvStoreDb(
   fb303::fbData->addStatExportType("kvstore.cmd_peer_dump", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_per_del", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.expired_key_vals", fb303::SUM);
+  fb303::fbData->addStatExportType("kvstore.expired_originators", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "kvstore.expiry_slices_deferred", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.flood_coalesce_window_ms", fb303::AVG);
+  fb303::fbData->addHistogram("kvstore.flood_batch_keys", 16, 0, 2048);
+  fb303::fbData->exportHistogramPercentile(
+      "kvstore.flood_batch_keys", 50, 95, 99);
+  fb303::fbData->addHistogram("kvstore.flood_batch_publications", 4, 0, 512);
+  fb303::fbData->exportHistogramPercentile(
+      "kvstore.flood_batch_publications", 50, 95, 99);
   fb303::fbData->addStatExportType("kvstore.flood_duration_ms", fb303::AVG);
+  for (size_t i = 0; keyClasses_.size() > 1 and i < keyClasses_.size(); ++i) {
+    fb303::fbData->addStatExportType(
+        fmt::format(
+            "kvstore.key_class.{}.flood_duration_ms", keyClasses_.getName(i)),
+        fb303::AVG);
+  }
   fb303::fbData->addStatExportType("kvstore.full_sync_duration_ms", fb303::AVG);
   fb303::fbData->addStatExportType("kvstore.looped_publications", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.missing_value_patch_bases", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.peers.bytes_received", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.peers.bytes_sent", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.rate_limit_keys", fb303::AVG);
@@ -1313,7 +2625,15 @@ KvStoreDb::~KvStoreDb() {
   evb_->getEvb()->runImmediatelyOrRunInEventBaseThreadAndWait([this]() {
     // Destroy thrift clients associated with peers, which will
     // fulfill promises with exceptions if any.
+    for (auto& [_, peer] : thriftPeers_) {
+      peer.resetFloodPipeline();
+    }
     thriftPeers_.clear();
+    peersByState_.clear();
+    for (auto& [_, floodStream] : floodStreams_) {
+      floodStream.complete();
+    }
+    floodStreams_.clear();
   });
 
   // remove ZMQ socket
@@ -1326,26 +2646,31 @@ KvStoreDb::~KvStoreDb() {
 
 void
 KvStoreDb::updateTtlCountdownQueue(const thrift::Publication& publication) {
-  for (const auto& [key, value] : *publication.keyVals_ref()) {
-    if (*value.ttl_ref() != Constants::kTtlInfinity) {
-      TtlCountdownQueueEntry queueEntry;
-      queueEntry.expiryTime = std::chrono::steady_clock::now() +
-          std::chrono::milliseconds(*value.ttl_ref());
-      queueEntry.key = key;
-      queueEntry.version = *value.version_ref();
-      queueEntry.ttlVersion = *value.ttlVersion_ref();
-      queueEntry.originatorId = *value.originatorId_ref();
-
-      if ((ttlCountdownQueue_.empty() or
-           (queueEntry.expiryTime <= ttlCountdownQueue_.top().expiryTime)) and
-          ttlCountdownTimer_) {
-        // Reschedule the shorter timeout
-        ttlCountdownTimer_->scheduleTimeout(
-            std::chrono::milliseconds(*value.ttl_ref()));
-      }
+  for (const auto& [key, value] : *publication.keyVals_ref()) {
+    if (*value.ttl_ref() == Constants::kTtlInfinity) {
+      // key no longer expires
+      ttlCountdownWheel_.erase(key);
+      continue;
+    }
 
-      ttlCountdownQueue_.push(std::move(queueEntry));
+    TtlCountdownQueueEntry queueEntry;
+    queueEntry.expiryTime = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(*value.ttl_ref());
+    queueEntry.key = key;
+    queueEntry.version = *value.version_ref();
+    queueEntry.ttlVersion = *value.ttlVersion_ref();
+    queueEntry.originatorId = *value.originatorId_ref();
+
+    if ((not ttlCountdownWakeup_.has_value() or
+         queueEntry.expiryTime < *ttlCountdownWakeup_) and
+        ttlCountdownTimer_) {
+      // Reschedule the shorter timeout
+      ttlCountdownWakeup_ = queueEntry.expiryTime;
+      ttlCountdownTimer_->scheduleTimeout(
+          std::chrono::milliseconds(*value.ttl_ref()));
     }
+
+    ttlCountdownWheel_.schedule(std::move(queueEntry));
   }
 }
 
@@ -1397,43 +2722,86 @@ KvStoreDb::dumpAllWithFilters(
   thrift::Publication thriftPub;
   thriftPub.area_ref() = area_;
 
-  switch (oper) {
-  case thrift::FilterOperator::AND:
-    for (auto const& [key, val] : kvStore_) {
-      if (not kvFilters.keyMatchAll(key, val)) {
-        continue;
-      }
-      if (not doNotPublishValue) {
-        thriftPub.keyVals_ref()[key] = val;
-      } else {
-        thriftPub.keyVals_ref()[key] = createThriftValueWithoutBinaryValue(val);
-      }
+  auto addKeyVal = [&](std::string const& key, thrift::Value const& val) {
+    if (not kvFilters.keyMatch(key, val, oper)) {
+      return;
+    }
+    if (not doNotPublishValue) {
+      thriftPub.keyVals_ref()[key] = val;
+    } else {
+      thriftPub.keyVals_ref()[key] = createThriftValueWithoutBinaryValue(val);
     }
-    break;
-  default:
+  };
+
+  if (not kvStoreKeyIndex_.forEachCandidate(
+          kvFilters, oper, [&](std::string const& key) {
+            auto it = kvStore_.find(key);
+            DCHECK(it != kvStore_.end());
+            addKeyVal(it->first, it->second);
+          })) {
     for (auto const& [key, val] : kvStore_) {
-      if (not kvFilters.keyMatch(key, val)) {
-        continue;
-      }
-      if (not doNotPublishValue) {
-        thriftPub.keyVals_ref()[key] = val;
-      } else {
-        thriftPub.keyVals_ref()[key] = createThriftValueWithoutBinaryValue(val);
-      }
+      addKeyVal(key, val);
     }
   }
   return thriftPub;
 }
 
+// dump one page of the entries of my KV store whose keys match filter. Only
+// the page is copied, selection holds iterators to the matching entries.
+// Without narrowing indexes, sorted keys are scanned from the cursor on.
+thrift::KvStoreKeyValsPage
+KvStoreDb::dumpPageWithFilters(
+    KvStoreFilters const& kvFilters,
+    thrift::FilterOperator oper,
+    bool doNotPublishValue,
+    thrift::PageParams const& page) const {
+  PageCollector<std::string, KvStoreMap::const_iterator> collector(
+      page.cursor_ref().to_optional(), getPageLimit(page));
+
+  auto addKeyVal = [&](KvStoreMap::const_iterator it) {
+    if (kvFilters.keyMatch(it->first, it->second, oper)) {
+      collector.add(it->first, it);
+    }
+  };
+
+  if (not kvStoreKeyIndex_.forEachCandidate(
+          kvFilters, oper, [&](std::string const& key) {
+            auto it = kvStore_.find(key);
+            DCHECK(it != kvStore_.end());
+            addKeyVal(it);
+          })) {
+    // keys are visited in order, stop once the page is full
+    kvStoreKeyIndex_.forEachKeyAfter(
+        page.cursor_ref().to_optional(), [&](std::string const& key) {
+          auto it = kvStore_.find(key);
+          DCHECK(it != kvStore_.end());
+          addKeyVal(it);
+          return not collector.isFull();
+        });
+  }
+
+  thrift::KvStoreKeyValsPage thriftPage;
+  thriftPage.nextCursor_ref().from_optional(collector.getNextCursor());
+  auto& thriftPub = *thriftPage.publication_ref();
+  thriftPub.area_ref() = area_;
+  for (auto const& [key, it] : collector.release()) {
+    thriftPub.keyVals_ref()->emplace(
+        key,
+        doNotPublishValue ? createThriftValueWithoutBinaryValue(it->second)
+                          : it->second);
+  }
+  return thriftPage;
+}
+
 // dump the hashes of my KV store whose keys match the given prefix
 // if prefix is the empty string, the full hash store is dumped
 thrift::Publication
 KvStoreDb::dumpHashWithFilters(KvStoreFilters const& kvFilters) const {
   thrift::Publication thriftPub;
   thriftPub.area_ref() = area_;
-  for (auto const& [key, val] : kvStore_) {
+  auto addHash = [&](std::string const& key, thrift::Value const& val) {
     if (not kvFilters.keyMatch(key, val)) {
-      continue;
+      return;
     }
     DCHECK(val.hash_ref().has_value());
     auto& value = thriftPub.keyVals_ref()[key];
@@ -1442,10 +2810,58 @@ KvStoreDb::dumpHashWithFilters(KvStoreFilters const& kvFilters) const {
     value.hash_ref().copy_from(val.hash_ref());
     value.ttl_ref() = *val.ttl_ref();
     value.ttlVersion_ref() = *val.ttlVersion_ref();
+  };
+
+  if (not kvStoreKeyIndex_.forEachCandidate(
+          kvFilters, thrift::FilterOperator::OR, [&](std::string const& key) {
+            auto it = kvStore_.find(key);
+            DCHECK(it != kvStore_.end());
+            addHash(it->first, it->second);
+          })) {
+    for (auto const& [key, val] : kvStore_) {
+      addHash(key, val);
+    }
   }
   return thriftPub;
 }
 
+std::shared_ptr<const thrift::Publication>
+KvStoreDb::getCachedDump(
+    KvStoreFilters const& kvFilters,
+    thrift::FilterOperator oper,
+    bool hashOnly) {
+  if (dumpCacheGeneration_ != kvStoreGeneration_) {
+    dumpCache_.clear();
+    dumpCacheGeneration_ = kvStoreGeneration_;
+  }
+
+  // hash dumps always match any of the filters
+  if (hashOnly) {
+    oper = thrift::FilterOperator::OR;
+  }
+  auto cacheKey = fmt::format(
+      "{}|{}|{}|{}",
+      hashOnly ? "hash" : "all",
+      apache::thrift::util::enumNameSafe<thrift::FilterOperator>(oper),
+      folly::join(",", kvFilters.getKeyPrefixes()),
+      folly::join(",", kvFilters.getOriginatorIdList()));
+  auto it = dumpCache_.find(cacheKey);
+  if (it != dumpCache_.end()) {
+    dumpCacheHitsCounter.add(1);
+    return it->second;
+  }
+
+  dumpCacheMissesCounter.add(1);
+  auto dump = std::make_shared<const thrift::Publication>(
+      hashOnly ? dumpHashWithFilters(kvFilters)
+               : dumpAllWithFilters(kvFilters, oper));
+  if (dumpCache_.size() >= kMaxCachedDumps) {
+    dumpCache_.clear();
+  }
+  dumpCache_.emplace(std::move(cacheKey), dump);
+  return dump;
+}
+
 // dump the keys on which hashes differ from given keyVals
 // thriftPub.keyVals: better keys or keys exist only in MY-KEY-VAL
 // thriftPub.tobeUpdatedKeys: better keys or keys exist only in REQ-KEY-VAL
@@ -1497,6 +2913,257 @@ KvStoreDb::dumpDifference(
   return thriftPub;
 }
 
+// dump the entries of my KV store in buckets on which hashes differ from
+// the requester's. Requester can't tell which of its keys I'm missing on
+// its own, so thriftPub.keyValBuckets tells it which buckets to check
+thrift::Publication
+KvStoreDb::dumpBucketDifference(
+    std::vector<int64_t> const& reqBucketHashes,
+    KvStoreFilters const& kvFilters,
+    thrift::FilterOperator oper) const {
+  thrift::Publication thriftPub;
+  thriftPub.area_ref() = area_;
+
+  auto const buckets =
+      kvStoreBucketHashes_.getDifferingBuckets(reqBucketHashes);
+  thriftPub.keyValBuckets_ref() = buckets;
+  if (buckets.empty()) {
+    return thriftPub;
+  }
+
+  std::vector<bool> isDifferingBucket(
+      kvStoreBucketHashes_.getHashes().size(), false);
+  for (auto const bucket : buckets) {
+    isDifferingBucket[bucket] = true;
+  }
+  for (auto const& [key, val] : kvStore_) {
+    if (isDifferingBucket[kvStoreBucketHashes_.getBucket(key)] and
+        kvFilters.keyMatch(key, val, oper)) {
+      thriftPub.keyVals_ref()->emplace(key, val);
+    }
+  }
+  return thriftPub;
+}
+
+std::optional<thrift::Publication>
+KvStoreDb::dumpChangesSince(
+    thrift::KvStoreChangeLogPosition const& position,
+    KvStoreFilters const& kvFilters,
+    thrift::FilterOperator oper) const {
+  if (*position.epoch_ref() != changeLogEpoch_ or
+      not changeLog_.covers(*position.sequence_ref())) {
+    return std::nullopt;
+  }
+
+  thrift::Publication thriftPub;
+  thriftPub.area_ref() = area_;
+  thriftPub.changesSince_ref() = position;
+  for (auto const& key : changeLog_.getKeysSince(*position.sequence_ref())) {
+    // keys gone since expired on the requester as well
+    auto it = kvStore_.find(key);
+    if (it != kvStore_.end() and kvFilters.keyMatch(key, it->second, oper)) {
+      thriftPub.keyVals_ref()->emplace(key, it->second);
+    }
+  }
+  return thriftPub;
+}
+
+thrift::KvStoreChangeLogPosition
+KvStoreDb::getChangeLogPosition() const {
+  thrift::KvStoreChangeLogPosition position;
+  position.epoch_ref() = changeLogEpoch_;
+  position.sequence_ref() = changeLog_.getSequence();
+  return position;
+}
+
+void
+KvStoreDb::decompressKeyVals(thrift::KeyVals& keyVals) {
+  for (auto it = keyVals.begin(); it != keyVals.end();) {
+    auto& value = it->second;
+    if (not value.compressedValue_ref().has_value()) {
+      ++it;
+      continue;
+    }
+    if (KvStore::decompressValue(value)) {
+      decompressedValuesCounter.add();
+      ++it;
+      continue;
+    }
+    LOG(ERROR) << "Ignoring invalid compressed value of key: " << it->first;
+    invalidCompressedValuesCounter.add();
+    it = keyVals.erase(it);
+  }
+}
+
+std::string
+KvStoreDb::getSnapshotFilePath() const {
+  return fmt::format("{}.{}", *kvParams_.snapshotFilePath, area_);
+}
+
+void
+KvStoreDb::writeSnapshot() {
+  if (not snapshotLoaded_) {
+    return;
+  }
+  const auto startTs = std::chrono::steady_clock::now();
+  auto pub = dumpAllWithFilters(KvStoreFilters({}, {}));
+  updatePublicationTtl(pub, true /* removeAboutToExpire */);
+
+  thrift::KvStoreSnapshot snapshot;
+  snapshot.area_ref() = area_;
+  snapshot.timestamp_ms_ref() = getUnixTimeStampMs();
+  snapshot.keyVals_ref() = std::move(*pub.keyVals_ref());
+  const auto filePath = getSnapshotFilePath();
+  try {
+    folly::writeFileAtomic(filePath, KvStore::encodeSnapshot(snapshot), 0666);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to write KvStore snapshot to " << filePath << ": "
+               << folly::exceptionStr(e);
+    fb303::fbData->addStatValue(
+        "kvstore.snapshot.num_write_failures", 1, fb303::COUNT);
+    return;
+  }
+  fb303::fbData->addStatValue(
+      "kvstore.snapshot.write_duration_ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTs)
+          .count(),
+      fb303::AVG);
+}
+
+void
+KvStoreDb::loadSnapshot() {
+  snapshotLoaded_ = true;
+  const auto filePath = getSnapshotFilePath();
+  std::string data;
+  if (not folly::readFile(filePath.c_str(), data)) {
+    LOG(INFO) << "No KvStore snapshot to load from " << filePath;
+    return;
+  }
+  auto snapshot = KvStore::decodeSnapshot(data);
+  if (not snapshot.has_value() or *snapshot->area_ref() != area_) {
+    LOG(ERROR) << "Ignoring invalid KvStore snapshot " << filePath;
+    return;
+  }
+
+  // TTLs count down from the time the snapshot was taken
+  const auto elapsedMs = std::max<int64_t>(
+      0, getUnixTimeStampMs() - *snapshot->timestamp_ms_ref());
+  thrift::Publication pub;
+  pub.area_ref() = area_;
+  for (auto& [key, value] : *snapshot->keyVals_ref()) {
+    if (*value.ttl_ref() != Constants::kTtlInfinity) {
+      value.ttl_ref() = *value.ttl_ref() - elapsedMs;
+      if (*value.ttl_ref() < Constants::kTtlThreshold.count()) {
+        continue;
+      }
+    }
+    pub.keyVals_ref()->emplace(key, std::move(value));
+  }
+  const auto numKeys = pub.keyVals_ref()->size();
+  mergePublication(pub);
+  snapshotKeysLoadedCounter.add(numKeys);
+  LOG(INFO) << "Loaded " << numKeys << " keys of KvStore snapshot " << filePath
+            << " taken " << elapsedMs << "ms ago";
+}
+
+void
+KvStoreDb::updatePeerValueCompression(
+    std::string const& peerName,
+    bool acceptsCompressedValues,
+    thrift::Publication& syncResponse) {
+  if (not kvParams_.enableFloodValueCompression or
+      not acceptsCompressedValues) {
+    compressedValuePeers_.erase(peerName);
+    return;
+  }
+  compressedValuePeers_.emplace(peerName);
+  size_t numCompressed = 0;
+  for (auto& [_, value] : *syncResponse.keyVals_ref()) {
+    if (KvStore::compressValue(value)) {
+      ++numCompressed;
+    }
+  }
+  fb303::fbData->addStatValue(
+      "kvstore.thrift.num_sync_compressed_values", numCompressed, fb303::SUM);
+}
+
+// keys which the full-sync responder needs from me: better keys or keys
+// exist only in my KV store, among the buckets covered by the response
+std::vector<std::string>
+KvStoreDb::getKeysToUpdateFromSyncResponse(
+    thrift::Publication const& pub) const {
+  std::optional<std::vector<bool>> isCoveredBucket;
+  if (auto buckets = pub.keyValBuckets_ref()) {
+    isCoveredBucket = std::vector<bool>(
+        kvStoreBucketHashes_.getHashes().size(), false);
+    for (auto const bucket : *buckets) {
+      if (bucket >= 0 and
+          static_cast<size_t>(bucket) < isCoveredBucket->size()) {
+        isCoveredBucket->at(bucket) = true;
+      }
+    }
+  }
+  // otherwise this is a peer without bucket hash support, it responded with
+  // all of its keys
+
+  std::vector<std::string> keys;
+  for (auto const& [key, myVal] : kvStore_) {
+    if (isCoveredBucket.has_value() and
+        not isCoveredBucket->at(kvStoreBucketHashes_.getBucket(key))) {
+      continue;
+    }
+    auto const reqKv = pub.keyVals_ref()->find(key);
+    if (reqKv == pub.keyVals_ref()->end()) {
+      keys.emplace_back(key);
+      continue;
+    }
+    int rc = KvStore::compareValues(myVal, reqKv->second);
+    if (rc == 1 or rc == -2) {
+      // myVal is better or unknown
+      keys.emplace_back(key);
+    }
+  }
+  return keys;
+}
+
+// keys which the incremental full-sync responder needs from me: my keys
+// changed since the previous full-sync with it and keys of the response
+// which I have a better value for
+std::vector<std::string>
+KvStoreDb::getKeysToUpdateFromIncrementalSyncResponse(
+    std::string const& peerName, thrift::Publication const& pub) const {
+  auto const posIt = peerSyncPositions_.find(peerName);
+  if (posIt == peerSyncPositions_.end() or
+      not changeLog_.covers(posIt->second.localSequence)) {
+    // can't tell my changes anymore, compare all of my keys
+    return getKeysToUpdateFromSyncResponse(pub);
+  }
+  auto candidates = changeLog_.getKeysSince(posIt->second.localSequence);
+  for (auto const& [key, _] : *pub.keyVals_ref()) {
+    candidates.emplace(key);
+  }
+
+  std::vector<std::string> keys;
+  for (auto const& key : candidates) {
+    auto const myKv = kvStore_.find(key);
+    if (myKv == kvStore_.end()) {
+      continue;
+    }
+    auto const reqKv = pub.keyVals_ref()->find(key);
+    if (reqKv == pub.keyVals_ref()->end()) {
+      keys.emplace_back(key);
+      continue;
+    }
+    int rc = KvStore::compareValues(myKv->second, reqKv->second);
+    if (rc == 1 or rc == -2) {
+      // myVal is better or unknown
+      keys.emplace_back(key);
+    }
+  }
+  return keys;
+}
+
 // This function serves the purpose of periodically scanning peers in
 // IDLE state and promote them to SYNCING state. The initial dump will
 // happen in async nature to unblock KvStore to process other requests.
@@ -1507,16 +3174,16 @@ KvStoreDb::requestThriftPeerSync() {
 
   // pre-fetch of peers in "SYNCING" state for later calculation
   uint32_t numThriftPeersInSync =
-      getPeersByState(thrift::KvStorePeerState::SYNCING).size();
+      getNumPeersByState(thrift::KvStorePeerState::SYNCING);
 
-  // Scan over thriftPeers to promote IDLE peers to SYNCING
-  for (auto& [peerName, thriftPeer] : thriftPeers_) {
-    auto& peerSpec = thriftPeer.peerSpec; // thrift::PeerSpec
+  // filters and bucket hashes of my KV store, shared by the sync requests to
+  // all peers of this round, e.g. neighbors of a line card coming up together
+  std::optional<thrift::KeyDumpParams> baseParams;
 
-    // ignore peers in state other than IDLE
-    if (thriftPeer.peerSpec.get_state() != thrift::KvStorePeerState::IDLE) {
-      continue;
-    }
+  // Scan over IDLE peers to promote them to SYNCING
+  for (auto const& peerName :
+       getPeersByState(thrift::KvStorePeerState::IDLE)) {
+    auto& thriftPeer = thriftPeers_.at(peerName);
 
     // update the global minimum timeout value for next try
     if (not thriftPeer.expBackoff.canTryNow()) {
@@ -1533,32 +3200,54 @@ KvStoreDb::requestThriftPeerSync() {
     }
 
     // state transition
-    auto oldState = thriftPeer.peerSpec.get_state();
-    thriftPeer.peerSpec.state_ref() =
-        getNextState(oldState, KvStorePeerEvent::PEER_ADD);
-    logStateTransition(peerName, oldState, thriftPeer.peerSpec.get_state());
+    setPeerState(
+        peerName,
+        thriftPeer,
+        getNextState(
+            thriftPeer.peerSpec.get_state(), KvStorePeerEvent::PEER_ADD));
 
     // mark peer from IDLE -> SYNCING
     numThriftPeersInSync += 1;
 
+    // floods of the peer stream in once the stream is up, the ones before
+    // come as calls
+    if (kvParams_.enableFloodStream and
+        not thriftPeer.floodSubscription.has_value() and
+        not thriftPeer.floodSubscriptionPending) {
+      subscribeFloodStream(peerName, thriftPeer);
+    }
+
     // build KeyDumpParam
-    thrift::KeyDumpParams params;
-    if (kvParams_.filters.has_value()) {
-      std::string keyPrefix =
-          folly::join(",", kvParams_.filters.value().getKeyPrefixes());
-      /* prefix is for backward compatibility */
-      params.prefix_ref() = keyPrefix;
-      if (not keyPrefix.empty()) {
-        params.keys_ref() = kvParams_.filters.value().getKeyPrefixes();
+    if (not baseParams.has_value()) {
+      baseParams.emplace();
+      if (kvParams_.filters.has_value()) {
+        std::string keyPrefix =
+            folly::join(",", kvParams_.filters.value().getKeyPrefixes());
+        /* prefix is for backward compatibility */
+        baseParams->prefix_ref() = keyPrefix;
+        if (not keyPrefix.empty()) {
+          baseParams->keys_ref() = kvParams_.filters.value().getKeyPrefixes();
+        }
+        baseParams->originatorIds_ref() =
+            kvParams_.filters.value().getOriginatorIdList();
       }
-      params.originatorIds_ref() =
-          kvParams_.filters.value().getOriginatorIdList();
+      // send a summary of my KV store instead of hashes of every key. Peer
+      // responds with its keys in buckets which differ
+      baseParams->keyValBucketHashes_ref() = kvStoreBucketHashes_.getHashes();
     }
-    KvStoreFilters kvFilters(
-        std::vector<std::string>{}, /* keyPrefixList */
-        std::set<std::string>{} /* originator */);
-    params.keyValHashes_ref() =
-        std::move(*dumpHashWithFilters(kvFilters).keyVals_ref());
+    thrift::KeyDumpParams params = *baseParams;
+    // peer synced with before, e.g. after a session flap, ONLY sends the
+    // changes since if its change log covers them. Mine has to cover my
+    // changes since as well to send them back
+    thriftPeer.syncRequestSequence = changeLog_.getSequence();
+    auto posIt = peerSyncPositions_.find(peerName);
+    if (posIt != peerSyncPositions_.end() and
+        changeLog_.covers(posIt->second.localSequence)) {
+      params.changesSince_ref() = posIt->second.peerPosition;
+    }
+    // I can always decompress values, peer decides whether to compress
+    params.senderId_ref() = kvParams_.nodeId;
+    params.acceptCompressedValues_ref() = true;
 
     // record telemetry for initial full-sync
     fb303::fbData->addStatValue(
@@ -1608,7 +3297,7 @@ KvStoreDb::requestThriftPeerSync() {
 
   // process the rest after min timeout if NOT scheduled
   uint32_t numThriftPeersInIdle =
-      getPeersByState(thrift::KvStorePeerState::IDLE).size();
+      getNumPeersByState(thrift::KvStorePeerState::IDLE);
   if (numThriftPeersInIdle > 0 or
       numThriftPeersInSync > parallelSyncLimitOverThrift_) {
     LOG_IF(INFO, numThriftPeersInIdle)
@@ -1620,9 +3309,9 @@ KvStoreDb::requestThriftPeerSync() {
 }
 
 // This function will process the full-dump response from peers:
-//  1) Merge peer's publication with local KvStoreDb;
+//  1) Merge peer's publication with local KvStoreDb, in chunks if large;
 //  2) Send a finalized full-sync to peer for missing keys;
-//  3) Exponetially update number of peers to SYNC in parallel;
+//  3) Update number of peers to SYNC in parallel based on response time;
 //  4) Promote KvStorePeerState from SYNCING -> INITIALIZED;
 void
 KvStoreDb::processThriftSuccess(
@@ -1648,6 +3337,71 @@ KvStoreDb::processThriftSuccess(
     return;
   }
 
+  // values are compared with mine, decompress them first
+  decompressKeyVals(*pub.keyVals_ref());
+
+  // work out missing keys of peer before merging its keys. A response from
+  // a peer with bucket hash support comes without them
+  if (not pub.tobeUpdatedKeys_ref().has_value()) {
+    pub.tobeUpdatedKeys_ref() = pub.changesSince_ref().has_value()
+        ? getKeysToUpdateFromIncrementalSyncResponse(peerName, pub)
+        : getKeysToUpdateFromSyncResponse(pub);
+    if (pub.changesSince_ref().has_value()) {
+      fb303::fbData->addStatValue(
+          "kvstore.thrift.num_incremental_sync", 1, fb303::COUNT);
+    }
+  }
+  if (auto buckets = pub.keyValBuckets_ref()) {
+    fb303::fbData->addStatValue(
+        "kvstore.thrift.num_differing_buckets", buckets->size(), fb303::SUM);
+  }
+
+  // Merge large responses in chunks, one per event loop iteration. Floods
+  // and responses of other peers are processed in between instead of queuing
+  // up behind the whole response. The last chunk finalizes the full-sync
+  if (pub.keyVals_ref()->size() > Constants::kFullSyncMergeChunkSize) {
+    thrift::Publication chunk;
+    chunk.area_ref() = area_;
+    chunk.floodRootId_ref().copy_from(pub.floodRootId_ref());
+    auto& keyVals = *pub.keyVals_ref();
+    if (keyClasses_.size() > 1) {
+      // keys of the highest priority class left first
+      size_t minClass = keyClasses_.size() - 1;
+      for (auto const& [key, _] : keyVals) {
+        minClass = std::min(minClass, keyClasses_.getClass(key));
+        if (minClass == 0) {
+          break;
+        }
+      }
+      for (auto it = keyVals.begin(); it != keyVals.end() and
+           chunk.keyVals_ref()->size() < Constants::kFullSyncMergeChunkSize;) {
+        if (keyClasses_.getClass(it->first) == minClass) {
+          chunk.keyVals_ref()->insert(keyVals.extract(it++));
+        } else {
+          ++it;
+        }
+      }
+    } else {
+      while (chunk.keyVals_ref()->size() <
+             Constants::kFullSyncMergeChunkSize) {
+        chunk.keyVals_ref()->insert(keyVals.extract(keyVals.begin()));
+      }
+    }
+    fb303::fbData->addStatValue(
+        "kvstore.thrift.num_keyvals_update",
+        mergePublication(chunk),
+        fb303::SUM);
+    fb303::fbData->addStatValue(
+        "kvstore.thrift.num_full_sync_chunks", 1, fb303::COUNT);
+
+    pub.keyValBuckets_ref().reset();
+    evb_->getEvb()->runInEventBaseThread(
+        [this, peerName, pub = std::move(pub), timeDelta]() mutable {
+          processThriftSuccess(peerName, std::move(pub), timeDelta);
+        });
+    return;
+  }
+
   // ATTN: `peerName` is MANDATORY to fulfill the finialized
   //       full-sync with peers.
   const auto kvUpdateCnt = mergePublication(pub, peerName);
@@ -1672,29 +3426,48 @@ KvStoreDb::processThriftSuccess(
             << " key-value updates."
             << " Processing time: " << timeDelta.count() << "ms.";
 
+  // next full-sync with peer only needs the changes since this one
+  if (auto position = pub.changeLogPosition_ref()) {
+    peerSyncPositions_[peerName] =
+        PeerSyncPosition{*position, peer.syncRequestSequence};
+  }
+
   // State transition
-  auto oldState = peer.peerSpec.get_state();
-  peer.peerSpec.state_ref() =
-      getNextState(oldState, KvStorePeerEvent::SYNC_RESP_RCVD);
-  logStateTransition(peerName, oldState, peer.peerSpec.get_state());
+  setPeerState(
+      peerName,
+      peer,
+      getNextState(
+          peer.peerSpec.get_state(), KvStorePeerEvent::SYNC_RESP_RCVD));
 
   kvParams_.kvStoreSyncEventsQueue.push(KvStoreSyncEvent(peerName, area_));
 
   // Log full-sync event via replicate queue
   logSyncEvent(peerName, timeDelta);
 
-  // Successfully received full-sync response. Double the parallel
-  // sync limit. This is to:
-  //  1) accelerate the rest of pending full-syncs if any;
-  //  2) assume subsequeny sync diff will be small in traffic amount;
-  parallelSyncLimitOverThrift_ = std::min(
-      2 * parallelSyncLimitOverThrift_,
-      Constants::kMaxFullSyncPendingCountThreshold);
+  // Successfully received full-sync response. Adjust the parallel sync
+  // limit to how long it took:
+  //  1) fast response doubles it, to accelerate the rest of pending
+  //     full-syncs if any;
+  //  2) slow response means peers or this node are overloaded by syncs in
+  //     flight, back off by one;
+  if (timeDelta <= Constants::kFullSyncTargetLatency) {
+    parallelSyncLimitOverThrift_ = std::min(
+        2 * parallelSyncLimitOverThrift_,
+        Constants::kMaxFullSyncPendingCountThreshold);
+  } else {
+    parallelSyncLimitOverThrift_ = std::max(
+        parallelSyncLimitOverThrift_ - 1,
+        Constants::kMinFullSyncPendingCountThreshold);
+  }
+  fb303::fbData->addStatValue(
+      "kvstore.thrift.parallel_sync_limit",
+      parallelSyncLimitOverThrift_,
+      fb303::AVG);
 
   // Schedule another round of `thriftSyncTimer_` full-sync request if
   // there is still peer in IDLE state. If no IDLE peer, cancel timeout.
   uint32_t numThriftPeersInIdle =
-      getPeersByState(thrift::KvStorePeerState::IDLE).size();
+      getNumPeersByState(thrift::KvStorePeerState::IDLE);
   if (numThriftPeersInIdle > 0) {
     thriftSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
   } else {
@@ -1724,13 +3497,20 @@ KvStoreDb::processThriftFailure(
   auto& peer = thriftPeers_.at(peerName);
   peer.keepAliveTimer->cancelTimeout();
   peer.expBackoff.reportError(); // apply exponential backoff
-  peer.client.reset();
+  peer.resetFloodPipeline();
+
+  // halve the parallel sync limit, failures are likely timeouts of peers
+  // overloaded by syncs in flight
+  parallelSyncLimitOverThrift_ = std::max(
+      parallelSyncLimitOverThrift_ / 2,
+      Constants::kMinFullSyncPendingCountThreshold);
 
   // state transition
-  auto oldState = peer.peerSpec.get_state();
-  peer.peerSpec.state_ref() =
-      getNextState(oldState, KvStorePeerEvent::THRIFT_API_ERROR);
-  logStateTransition(peerName, oldState, peer.peerSpec.get_state());
+  setPeerState(
+      peerName,
+      peer,
+      getNextState(
+          peer.peerSpec.get_state(), KvStorePeerEvent::THRIFT_API_ERROR));
 
   // Schedule another round of `thriftSyncTimer_` in case it is
   // NOT scheduled.
@@ -1742,6 +3522,11 @@ KvStoreDb::processThriftFailure(
 void
 KvStoreDb::addThriftPeers(
     std::unordered_map<std::string, thrift::PeerSpec> const& peers) {
+  // warm up with the snapshot before the first full-sync
+  if (kvParams_.snapshotFilePath and not snapshotLoaded_) {
+    loadSnapshot();
+  }
+
   // kvstore external sync over thrift port of knob enabled
   for (auto const& [peerName, newPeerSpec] : peers) {
     // try to connect with peer
@@ -1758,16 +3543,14 @@ KvStoreDb::addThriftPeers(
                   << *oldPeerSpec.peerAddr_ref()
                   << " to: " << *newPeerSpec.peerAddr_ref();
       }
-      logStateTransition(
-          peerName,
-          peerIter->second.peerSpec.get_state(),
-          thrift::KvStorePeerState::IDLE);
+      setPeerState(
+          peerName, peerIter->second, thrift::KvStorePeerState::IDLE);
 
       peerIter->second.peerSpec = newPeerSpec; // update peerSpec
       peerIter->second.peerSpec.state_ref() =
           thrift::KvStorePeerState::IDLE; // set IDLE initially
       peerIter->second.keepAliveTimer->cancelTimeout(); // cancel timer
-      peerIter->second.client.reset(); // destruct thriftClient
+      peerIter->second.resetFloodPipeline(); // destruct thriftClient
     } else {
       // case 2: found a new peer coming up
       LOG(INFO) << "[Peer Add] " << peerName << " is added."
@@ -1782,7 +3565,7 @@ KvStoreDb::addThriftPeers(
       // will NOT be closed by thrift server due to inactivity
       const auto name = peerName;
       peer.keepAliveTimer =
-          folly::AsyncTimeout::make(*(evb_->getEvb()), [this, name]() noexcept {
+          evb_->getTimerWheel().makeTimer([this, name]() noexcept {
             auto period = addJitter(Constants::kThriftClientKeepAliveInterval);
             auto& p = thriftPeers_.at(name);
             CHECK(p.client) << "thrift client is NOT initialized";
@@ -1790,6 +3573,8 @@ KvStoreDb::addThriftPeers(
             p.keepAliveTimer->scheduleTimeout(period);
           });
       thriftPeers_.emplace(name, std::move(peer));
+      peersByState_[thrift::KvStorePeerState::IDLE].emplace(name);
+      ++summaryGeneration_;
     }
 
     // create thrift client and do backoff if can't go through
@@ -1923,6 +3708,10 @@ KvStoreDb::getCounters() const {
   // Add some more flat counters
   counters["kvstore.num_keys"] = kvStore_.size();
   counters["kvstore.num_peers"] = peers_.size();
+
+  // approximate memory held by the key-values, accounted for by Watchdog
+  counters["kvstore.memory.key_vals_bytes"] =
+      kvStoreBucketHashes_.getNumBytes();
   return counters;
 }
 
@@ -1942,8 +3731,17 @@ KvStoreDb::delThriftPeers(std::vector<std::string> const& peers) {
 
     // destroy peer info
     peerIter->second.keepAliveTimer.reset();
-    peerIter->second.client.reset();
+    peerIter->second.resetFloodPipeline();
+    peersByState_[peerSpec.get_state()].erase(peerName);
     thriftPeers_.erase(peerIter);
+    auto streamIt = floodStreams_.find(peerName);
+    if (streamIt != floodStreams_.end()) {
+      streamIt->second.complete();
+      floodStreams_.erase(streamIt);
+    }
+    // a new session tells again whether it accepts compressed values
+    compressedValuePeers_.erase(peerName);
+    ++summaryGeneration_;
   }
 }
 
@@ -2095,26 +3893,27 @@ void
 KvStoreDb::updatePublicationTtl(
     thrift::Publication& thriftPub, bool removeAboutToExpire) {
   auto timeNow = std::chrono::steady_clock::now();
-  for (const auto& qE : ttlCountdownQueue_) {
+  for (auto kv = thriftPub.keyVals_ref()->begin();
+       kv != thriftPub.keyVals_ref()->end();) {
     // Find key and ensure we are taking time from right entry from queue
-    auto kv = thriftPub.keyVals_ref()->find(qE.key);
-    if (kv == thriftPub.keyVals_ref()->end() or
-        *kv->second.version_ref() != qE.version or
-        *kv->second.originatorId_ref() != qE.originatorId or
-        *kv->second.ttlVersion_ref() != qE.ttlVersion) {
+    auto const* qE = ttlCountdownWheel_.find(kv->first);
+    if (not qE or *kv->second.version_ref() != qE->version or
+        *kv->second.originatorId_ref() != qE->originatorId or
+        *kv->second.ttlVersion_ref() != qE->ttlVersion) {
+      ++kv;
       continue;
     }
 
     // Compute timeLeft and do sanity check on it
-    auto timeLeft = duration_cast<milliseconds>(qE.expiryTime - timeNow);
+    auto timeLeft = duration_cast<milliseconds>(qE->expiryTime - timeNow);
     if (timeLeft <= kvParams_.ttlDecr) {
-      thriftPub.keyVals_ref()->erase(kv);
+      kv = thriftPub.keyVals_ref()->erase(kv);
       continue;
     }
 
     // filter key from publication if time left is below ttl threshold
     if (removeAboutToExpire and timeLeft < Constants::kTtlThreshold) {
-      thriftPub.keyVals_ref()->erase(kv);
+      kv = thriftPub.keyVals_ref()->erase(kv);
       continue;
     }
 
@@ -2122,6 +3921,7 @@ KvStoreDb::updatePublicationTtl(
     // deterministically whenever it is exchanged between KvStores. This
     // will avoid looping of updates between stores.
     kv->second.ttl_ref() = timeLeft.count() - kvParams_.ttlDecr.count();
+    ++kv;
   }
 }
 
@@ -2155,9 +3955,13 @@ KvStoreDb::processRequestMsgHelper(
 
     const auto keyPrefixMatch =
         KvStoreFilters(keyPrefixList, *keyDumpParamsVal.originatorIds_ref());
-    auto thriftPub = dumpAllWithFilters(keyPrefixMatch);
+    thrift::Publication thriftPub;
     if (auto keyValHashes = keyDumpParamsVal.keyValHashes_ref()) {
-      thriftPub = dumpDifference(*thriftPub.keyVals_ref(), *keyValHashes);
+      auto dump = getCachedDump(
+          keyPrefixMatch, thrift::FilterOperator::OR, false /* hashOnly */);
+      thriftPub = dumpDifference(*dump->keyVals_ref(), *keyValHashes);
+    } else {
+      thriftPub = dumpAllWithFilters(keyPrefixMatch);
     }
     updatePublicationTtl(thriftPub);
     // I'm the initiator, set flood-root-id
@@ -2231,6 +4035,10 @@ KvStoreDb::processFloodTopoGet() noexcept {
     }
     sptInfo.parent_ref().from_optional(nexthop);
     sptInfo.children_ref() = dual.children();
+    auto it = floodRootPublications_.find(rootId);
+    if (it != floodRootPublications_.end()) {
+      sptInfo.floodPublications_ref() = it->second;
+    }
     sptInfos.infos_ref()->emplace(rootId, sptInfo);
   }
 
@@ -2584,69 +4392,190 @@ KvStoreDb::drainPeerSyncSock() {
 
 void
 KvStoreDb::cleanupTtlCountdownQueue() {
-  // record all expired keys
+  // record all expired keys, and their originators
   std::vector<std::string> expiredKeys;
+  std::unordered_set<std::string> originators;
   auto now = std::chrono::steady_clock::now();
+  ttlCountdownWakeup_ = std::nullopt;
 
-  // Iterate through ttlCountdownQueue_ until the top expires in the future
-  while (not ttlCountdownQueue_.empty()) {
-    auto top = ttlCountdownQueue_.top();
-    if (top.expiryTime > now) {
-      // Nothing in queue worth evicting
-      break;
-    }
-    auto it = kvStore_.find(top.key);
-    if (it != kvStore_.end() and *it->second.version_ref() == top.version and
-        *it->second.originatorId_ref() == top.originatorId and
-        *it->second.ttlVersion_ref() == top.ttlVersion) {
-      expiredKeys.emplace_back(top.key);
+  // All entries due by now, already in expiry order
+  for (auto& entry : ttlCountdownWheel_.advance(now)) {
+    dueTtlEntries_.emplace_back(std::move(entry));
+  }
+
+  // Expire a slice per event loop iteration, so that a mass expiry (e.g. a
+  // node gone with all of its keys) doesn't stall the area and is published
+  // in chunks. Entries refreshed since were moved in the wheel, but the value
+  // may still have changed without a TTL (e.g. overridden by a higher
+  // version), so check against kvStore_
+  while (not dueTtlEntries_.empty() and
+         expiredKeys.size() < Constants::kTtlExpirySliceSize) {
+    auto entry = std::move(dueTtlEntries_.front());
+    dueTtlEntries_.pop_front();
+    auto it = kvStore_.find(entry.key);
+    if (it != kvStore_.end() and *it->second.version_ref() == entry.version and
+        *it->second.originatorId_ref() == entry.originatorId and
+        *it->second.ttlVersion_ref() == entry.ttlVersion) {
+      expiredKeys.emplace_back(entry.key);
       LOG(WARNING)
           << "Delete expired (key, version, originatorId, ttlVersion, ttl, "
           << "node, area) "
           << fmt::format(
                  "({}, {}, {}, {}, {}, {}, {})",
-                 top.key,
+                 entry.key,
                  *it->second.version_ref(),
                  *it->second.originatorId_ref(),
                  *it->second.ttlVersion_ref(),
                  *it->second.ttl_ref(),
                  kvParams_.nodeId,
                  area_);
-      logKvEvent("KEY_EXPIRE", top.key);
+      logKvEvent("KEY_EXPIRE", entry.key);
+      kvStoreBucketHashes_.remove(it->first, it->second);
+      kvStoreKeyIndex_.remove(it->first, it->second);
       kvStore_.erase(it);
+      originators.emplace(std::move(entry.originatorId));
+      ++summaryGeneration_;
+      ++kvStoreGeneration_;
+    }
+  }
+
+  // Reschedule right away for the rest of the due entries, otherwise based
+  // on the next entry due
+  if (not dueTtlEntries_.empty()) {
+    ttlCountdownWakeup_ = now;
+    ttlCountdownTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+    fb303::fbData->addStatValue(
+        "kvstore.expiry_slices_deferred", 1, fb303::COUNT);
+  } else if (auto wakeup = ttlCountdownWheel_.getNextWakeup()) {
+    ttlCountdownWakeup_ = *wakeup;
+    // round up, waking before the tick is due would find nothing to expire
+    ttlCountdownTimer_->scheduleTimeout(std::max(
+        std::chrono::milliseconds(0),
+        std::chrono::ceil<std::chrono::milliseconds>(*wakeup - now)));
+  }
+
+  if (expiredKeys.empty()) {
+    // no key expires
+    return;
+  }
+
+  fb303::fbData->addStatValue(
+      "kvstore.expired_key_vals", expiredKeys.size(), fb303::SUM);
+
+  // ATTN: expired key will be ONLY notified to local subscribers
+  //       via replicate-queue. KvStore will NOT flood publication
+  //       with expired keys ONLY to external peers.
+  thrift::Publication expiredKeysPub{};
+  expiredKeysPub.expiredKeys_ref() = std::move(expiredKeys);
+  expiredKeysPub.area_ref() = area_;
+
+  // summary of the originators gone along with their last keys
+  std::vector<std::string> expiredOriginators;
+  for (auto const& originator : originators) {
+    if (not kvStoreKeyIndex_.hasOriginator(originator)) {
+      expiredOriginators.emplace_back(originator);
+    }
+  }
+  if (not expiredOriginators.empty()) {
+    fb303::fbData->addStatValue(
+        "kvstore.expired_originators", expiredOriginators.size(), fb303::SUM);
+    expiredKeysPub.expiredOriginators_ref() = std::move(expiredOriginators);
+  }
+  floodPublication(std::move(expiredKeysPub));
+}
+
+void
+KvStoreDb::bufferPublication(thrift::Publication&& publication) {
+  fb303::fbData->addStatValue("kvstore.rate_limit_suppress", 1, fb303::COUNT);
+  fb303::fbData->addStatValue(
+      "kvstore.rate_limit_keys", publication.keyVals_ref()->size(), fb303::AVG);
+  addToPublicationBuffer(publication);
+}
+
+thrift::Publication
+KvStoreDb::extractPriorityKeys(thrift::Publication& publication) {
+  thrift::Publication priorityPub;
+  priorityPub.area_ref().copy_from(publication.area_ref());
+  priorityPub.nodeIds_ref().copy_from(publication.nodeIds_ref());
+  priorityPub.floodRootId_ref().copy_from(publication.floodRootId_ref());
+  auto& keyVals = *publication.keyVals_ref();
+  for (auto it = keyVals.begin(); it != keyVals.end();) {
+    if (it->first.find(Constants::kAdjDbMarker.toString()) == 0) {
+      priorityPub.keyVals_ref()->emplace(it->first, std::move(it->second));
+      it = keyVals.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return priorityPub;
+}
+
+void
+KvStoreDb::holdThrottledKeys(thrift::Publication& publication) {
+  // the publication takes one token of every originator with keys in it
+  std::unordered_set<std::string> originators;
+  for (auto const& [_, value] : *publication.keyVals_ref()) {
+    originators.emplace(*value.originatorId_ref());
+  }
+  std::unordered_set<std::string> throttled;
+  for (auto const& originator : originators) {
+    auto it = originatorFloodLimiters_
+                  .try_emplace(
+                      originator,
+                      *kvParams_.originatorFloodRate->flood_msg_per_sec_ref(),
+                      *kvParams_.originatorFloodRate
+                           ->flood_msg_burst_size_ref())
+                  .first;
+    // keys of an originator with keys held already wait their turn as well
+    if (heldKeys_.count(originator) or not it->second.consume(1)) {
+      throttled.emplace(originator);
+    }
+  }
+  if (throttled.empty()) {
+    return;
+  }
+
+  std::optional<std::string> floodRootId{std::nullopt};
+  if (publication.floodRootId_ref().has_value()) {
+    floodRootId = publication.floodRootId_ref().value();
+  }
+  size_t numHeld = 0;
+  auto& keyVals = *publication.keyVals_ref();
+  for (auto it = keyVals.begin(); it != keyVals.end();) {
+    auto const& originator = *it->second.originatorId_ref();
+    if (throttled.count(originator)) {
+      heldKeys_[originator][floodRootId].emplace(it->first);
+      it = keyVals.erase(it);
+      ++numHeld;
+    } else {
+      ++it;
     }
-    ttlCountdownQueue_.pop();
   }
-
-  // Reschedule based on most recent timeout
-  if (not ttlCountdownQueue_.empty()) {
-    ttlCountdownTimer_->scheduleTimeout(
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            ttlCountdownQueue_.top().expiryTime - now));
+  fb303::fbData->addStatValue(
+      "kvstore.rate_limit_held_keys", numHeld, fb303::SUM);
+  if (not pendingPublicationTimer_->isScheduled()) {
+    pendingPublicationTimer_->scheduleTimeout(
+        Constants::kFloodPendingPublication);
   }
+}
 
-  if (expiredKeys.empty()) {
-    // no key expires
-    return;
+bool
+KvStoreDb::releaseHeldKeys() {
+  for (auto it = heldKeys_.begin(); it != heldKeys_.end();) {
+    if (not originatorFloodLimiters_.at(it->first).consume(1)) {
+      ++it;
+      continue;
+    }
+    for (auto& [rootId, keys] : it->second) {
+      publicationBuffer_[rootId].merge(keys);
+    }
+    it = heldKeys_.erase(it);
   }
-
-  fb303::fbData->addStatValue(
-      "kvstore.expired_key_vals", expiredKeys.size(), fb303::SUM);
-
-  // ATTN: expired key will be ONLY notified to local subscribers
-  //       via replicate-queue. KvStore will NOT flood publication
-  //       with expired keys ONLY to external peers.
-  thrift::Publication expiredKeysPub{};
-  expiredKeysPub.expiredKeys_ref() = std::move(expiredKeys);
-  expiredKeysPub.area_ref() = area_;
-  floodPublication(std::move(expiredKeysPub));
+  return not heldKeys_.empty();
 }
 
 void
-KvStoreDb::bufferPublication(thrift::Publication&& publication) {
-  fb303::fbData->addStatValue("kvstore.rate_limit_suppress", 1, fb303::COUNT);
-  fb303::fbData->addStatValue(
-      "kvstore.rate_limit_keys", publication.keyVals_ref()->size(), fb303::AVG);
+KvStoreDb::addToPublicationBuffer(const thrift::Publication& publication) {
   std::optional<std::string> floodRootId{std::nullopt};
   if (publication.floodRootId_ref().has_value()) {
     floodRootId = publication.floodRootId_ref().value();
@@ -2660,13 +4589,54 @@ KvStoreDb::bufferPublication(thrift::Publication&& publication) {
   }
 }
 
+void
+KvStoreDb::coalescePublication(thrift::Publication&& publication) {
+  // only the key is kept, its latest value is read from kvStore_ when the
+  // merged publication is flooded
+  addToPublicationBuffer(publication);
+  coalesceWindowBusy_ = true;
+  ++numCoalescedPubs_;
+  numCoalescedKeys_ += publication.keyVals_ref()->size() +
+      publication.expiredKeys_ref()->size();
+
+  // don't let a burst grow the batch unbounded, flood it before the window
+  // ends
+  if (numCoalescedKeys_ >=
+      static_cast<size_t>(*kvParams_.floodCoalesce->max_batch_keys_ref())) {
+    floodCoalescedUpdates();
+  }
+}
+
+void
+KvStoreDb::floodCoalescedUpdates() {
+  fb303::fbData->addHistogramValue(
+      "kvstore.flood_batch_publications", numCoalescedPubs_);
+  fb303::fbData->addHistogramValue(
+      "kvstore.flood_batch_keys", numCoalescedKeys_);
+  fb303::fbData->addStatValue(
+      "kvstore.flood_coalesce_window_ms", coalesceWindow_.count(), fb303::AVG);
+  numCoalescedPubs_ = 0;
+  numCoalescedKeys_ = 0;
+
+  if (floodLimiter_ && !floodLimiter_->consume(1)) {
+    // keys stay buffered until the rate limiter lets them through
+    if (not pendingPublicationTimer_->isScheduled()) {
+      pendingPublicationTimer_->scheduleTimeout(
+          Constants::kFloodPendingPublication);
+    }
+    return;
+  }
+  floodBufferedUpdates();
+}
+
 void
 KvStoreDb::floodBufferedUpdates() {
   if (!publicationBuffer_.size()) {
     return;
   }
 
-  // merged-publications to be sent
+  // merged-publications to be sent, adjacency keys first if rate limited
+  std::vector<thrift::Publication> priorityPublications;
   std::vector<thrift::Publication> publications;
 
   // merge publication per root-id
@@ -2681,22 +4651,62 @@ KvStoreDb::floodBufferedUpdates() {
     for (const auto& key : keys) {
       auto kvStoreIt = kvStore_.find(key);
       if (kvStoreIt != kvStore_.end()) {
-        publication.keyVals_ref()->emplace(make_pair(key, kvStoreIt->second));
+        publication.keyVals_ref()->emplace(key, kvStoreIt->second);
       } else {
         publication.expiredKeys_ref()->emplace_back(key);
       }
     }
+    if (priorityFloodLimiter_) {
+      auto priorityPub = extractPriorityKeys(publication);
+      if (not priorityPub.keyVals_ref()->empty()) {
+        priorityPublications.emplace_back(std::move(priorityPub));
+      }
+      if (publication.keyVals_ref()->empty() and
+          publication.expiredKeys_ref()->empty()) {
+        continue;
+      }
+    }
     publications.emplace_back(std::move(publication));
   }
 
   publicationBuffer_.clear();
 
-  for (auto& pub : publications) {
-    // when sending out merged publication, we maintain orginal-root-id
-    // we act as a forwarder, NOT an initiator. Disable set-flood-root here
-    floodPublication(
-        std::move(pub), false /* rate-limit */, false /* set-flood-root */);
+  for (auto* pubs : {&priorityPublications, &publications}) {
+    for (auto& pub : *pubs) {
+      // when sending out merged publication, we maintain orginal-root-id
+      // we act as a forwarder, NOT an initiator. Disable set-flood-root here
+      floodPublication(
+          std::move(pub), false /* rate-limit */, false /* set-flood-root */);
+    }
+  }
+}
+
+void
+KvStoreDb::requestKeysFromPeer(
+    std::string const& peerName, std::vector<std::string> keys) {
+  auto peerIt = thriftPeers_.find(peerName);
+  if (peerIt == thriftPeers_.end() or (not peerIt->second.client) or
+      peerIt->second.peerSpec.get_state() !=
+          thrift::KvStorePeerState::INITIALIZED) {
+    // peer will be fully synced once it is (re-)initialized
+    LOG(INFO) << "Can't fetch " << keys.size() << " keys from peer "
+              << peerName << ", waiting for full-sync";
+    return;
   }
+
+  VLOG(2) << "Fetching keys missing patch base from peer " << peerName << ": "
+          << folly::join(",", keys);
+  auto sf = peerIt->second.client->semifuture_getKvStoreKeyValsArea(
+      std::move(keys), area_);
+  std::move(sf)
+      .via(evb_->getEvb())
+      .thenValue([this](thrift::Publication&& pub) {
+        // dumped values come with full data
+        mergePublication(pub);
+      })
+      .thenError([this, peerName](const folly::exception_wrapper& ew) {
+        processThriftFailure(peerName, ew.what(), std::chrono::milliseconds(0));
+      });
 }
 
 void
@@ -2812,6 +4822,40 @@ KvStoreDb::collectSendFailureStats(
 void
 KvStoreDb::floodPublication(
     thrift::Publication&& publication, bool rateLimit, bool setFloodRoot) {
+  if (floodLimiter_ && rateLimit) {
+    // adjacency keys of a publication which would wait for the rate limiter
+    // flood ahead of it, on their own token bucket
+    if (not publicationBuffer_.empty() or floodLimiter_->available() < 1 or
+        (coalesceTimer_ && coalesceTimer_->isScheduled())) {
+      auto priorityPub = extractPriorityKeys(publication);
+      if (not priorityPub.keyVals_ref()->empty()) {
+        if (priorityFloodLimiter_->consume(1)) {
+          fb303::fbData->addStatValue(
+              "kvstore.rate_limit_priority_floods", 1, fb303::COUNT);
+          floodPublication(
+              std::move(priorityPub), false /* rate-limit */, setFloodRoot);
+        } else {
+          bufferPublication(std::move(priorityPub));
+          if (not pendingPublicationTimer_->isScheduled()) {
+            pendingPublicationTimer_->scheduleTimeout(
+                Constants::kFloodPendingPublication);
+          }
+        }
+      }
+    }
+    if (kvParams_.originatorFloodRate) {
+      holdThrottledKeys(publication);
+    }
+    if (publication.keyVals_ref()->empty() &&
+        publication.expiredKeys_ref()->empty()) {
+      return;
+    }
+  }
+  // merge into the open coalescing window if configured
+  if (coalesceTimer_ && rateLimit && coalesceTimer_->isScheduled()) {
+    coalescePublication(std::move(publication));
+    return;
+  }
   // rate limit if configured
   if (floodLimiter_ && rateLimit && !floodLimiter_->consume(1)) {
     bufferPublication(std::move(publication));
@@ -2819,11 +4863,24 @@ KvStoreDb::floodPublication(
         Constants::kFloodPendingPublication);
     return;
   }
-  // merge with buffered publication and flood
-  if (publicationBuffer_.size()) {
+  // merge with buffered publication and flood. Publications flooded with
+  // rateLimit unset don't take buffered keys along
+  if (rateLimit && publicationBuffer_.size()) {
     bufferPublication(std::move(publication));
     return floodBufferedUpdates();
   }
+  // flood and deliver keys of higher priority classes first
+  if (keyClasses_.size() > 1) {
+    auto classPubs = keyClasses_.split(std::move(publication));
+    if (classPubs.size() > 1) {
+      for (auto& classPub : classPubs) {
+        floodPublication(
+            std::move(classPub), false /* rate-limit */, setFloodRoot);
+      }
+      return;
+    }
+    publication = std::move(classPubs.front());
+  }
   // Update ttl on keys we are trying to advertise. Also remove keys which
   // are about to expire.
   updatePublicationTtl(publication, true);
@@ -2847,12 +4904,18 @@ KvStoreDb::floodPublication(
   }
   publication.nodeIds_ref()->emplace_back(kvParams_.nodeId);
 
-  // Flood publication to internal subscribers
-  kvParams_.kvStoreUpdatesQueue.push(publication);
-  fb303::fbData->addStatValue("kvstore.num_updates", 1, fb303::COUNT);
+  // Flooding was idle, this publication goes out right away. Open a window
+  // to coalesce the ones following it
+  if (coalesceTimer_ && not coalesceTimer_->isScheduled()) {
+    coalesceTimer_->scheduleTimeout(coalesceWindow_);
+  }
 
   // Flood keyValue ONLY updates to external neighbors
   if (publication.keyVals_ref()->empty()) {
+    // Flood publication to internal subscribers
+    kvParams_.clientIndex.dispatch(publication);
+    kvParams_.kvStoreUpdatesQueue.push(std::move(publication));
+    numUpdatesCounter.add();
     return;
   }
 
@@ -2864,23 +4927,78 @@ KvStoreDb::floodPublication(
           << " to peers with: " << keysToUpdate.size()
           << " key-vals. Updated keys: " << folly::join(",", keysToUpdate);
 
-  if (setFloodRoot and not senderId.has_value()) {
-    // I'm the initiator, set flood-root-id
-    publication.floodRootId_ref().from_optional(DualNode::getSptRootId());
-  }
-
   // prepare thrift structure for flooding purpose
   thrift::KeySetParams params;
-  params.keyVals_ref() = *publication.keyVals_ref();
+  size_t numPatched = 0;
+  if (kvParams_.enableFloodValuePatch) {
+    // peers get the patch instead of the data, subscribers only the data.
+    // Data of patched values is not copied for peers, patches are moved
+    auto& peerKeyVals = *params.keyVals_ref();
+    peerKeyVals.reserve(publication.keyVals_ref()->size());
+    for (auto& [key, value] : *publication.keyVals_ref()) {
+      if (not value.patch_ref().has_value()) {
+        peerKeyVals.emplace(key, value);
+        continue;
+      }
+      auto peerValue = createThriftValueWithoutBinaryValue(value);
+      peerValue.patch_ref() = std::move(*value.patch_ref());
+      value.patch_ref().reset();
+      peerKeyVals.emplace(key, std::move(peerValue));
+      ++numPatched;
+    }
+  } else {
+    params.keyVals_ref() = *publication.keyVals_ref();
+  }
   params.nodeIds_ref().copy_from(publication.nodeIds_ref());
   params.floodRootId_ref().copy_from(publication.floodRootId_ref());
   params.timestamp_ms_ref() = getUnixTimeStampMs();
+  if (setFloodRoot and not senderId.has_value()) {
+    // I'm the initiator, set flood-root-id
+    if (kvParams_.enableFloodRootLoadBalancing) {
+      // pick the root by the smallest key, so that updates of a key keep
+      // following the same SPT while the roots stay the same
+      std::string const* minKey{nullptr};
+      for (auto const& [key, _] : *params.keyVals_ref()) {
+        if (not minKey or key < *minKey) {
+          minKey = &key;
+        }
+      }
+      params.floodRootId_ref().from_optional(
+          DualNode::getSptRootId(std::hash<std::string>{}(*minKey)));
+    } else {
+      params.floodRootId_ref().from_optional(DualNode::getSptRootId());
+    }
+  }
+  // Traced update, next hops close the flood span on reception and
+  // subscribers the queue span
+  if (auto perfEvents = publication.perfEvents_ref()) {
+    params.perfEvents_ref() = *perfEvents;
+    startPerfSpan(
+        *params.perfEvents_ref(),
+        kvParams_.nodeId,
+        Constants::kPerfSpanKvStoreFlood);
+    startPerfSpan(
+        *perfEvents, kvParams_.nodeId, Constants::kPerfSpanKvStoreUpdatesQueue);
+  }
+
+  // Flood publication to internal subscribers. It is no longer needed here,
+  // move it so values are copied for all but one subscriber
+  kvParams_.clientIndex.dispatch(publication);
+  kvParams_.kvStoreUpdatesQueue.push(std::move(publication));
+  numUpdatesCounter.add();
 
   std::optional<std::string> floodRootId{std::nullopt};
   if (params.floodRootId_ref().has_value()) {
     floodRootId = params.floodRootId_ref().value();
   }
   const auto& floodPeers = getFloodPeers(floodRootId);
+  if (floodRootId.has_value()) {
+    ++floodRootPublications_[*floodRootId];
+  }
+
+  // params with large values compressed, see compressedValuePeers_
+  std::optional<thrift::KeySetParams> compressedParams;
+  size_t numCompressed = 0;
 
   for (const auto& peerName : floodPeers) {
     auto peerIt = thriftPeers_.find(peerName);
@@ -2909,46 +5027,316 @@ KvStoreDb::floodPublication(
     }
 
     // record telemetry for flooding publications
-    fb303::fbData->addStatValue(
-        "kvstore.thrift.num_flood_pub", 1, fb303::COUNT);
-    fb303::fbData->addStatValue(
-        "kvstore.thrift.num_flood_key_vals",
-        publication.keyVals_ref()->size(),
-        fb303::SUM);
+    numFloodPubCounter.add();
+    numFloodKeyValsCounter.add(params.get_keyVals().size());
+    numFloodValuePatchesCounter.add(numPatched);
+
+    // pipeline to the peer is full, batch with the floods waiting for it
+    if (thriftPeer.numPendingFloods >= Constants::kMaxPendingFloodsPerPeer) {
+      auto& queued = thriftPeer.queuedFloods;
+      if (not queued.empty() and
+          KvStore::mergeFloodParams(queued.back(), params)) {
+        fb303::fbData->addStatValue(
+            "kvstore.thrift.num_flood_pub_batched", 1, fb303::COUNT);
+      } else {
+        queued.emplace_back(params);
+      }
+      continue;
+    }
 
-    auto startTime = std::chrono::steady_clock::now();
-    auto sf = thriftPeer.client->semifuture_setKvStoreKeyVals(params, area_);
-    std::move(sf)
-        .via(evb_->getEvb())
-        .thenValue([peerName, startTime](folly::Unit&&) {
-          VLOG(4) << "Flooding ack received from peer: " << peerName;
+    // values are compressed once for all peers accepting them
+    auto const* peerParams = &params;
+    if (compressedValuePeers_.count(peerName)) {
+      if (not compressedParams.has_value()) {
+        compressedParams = params;
+        for (auto& [_, value] : *compressedParams->keyVals_ref()) {
+          if (KvStore::compressValue(value)) {
+            ++numCompressed;
+          }
+        }
+      }
+      peerParams = &*compressedParams;
+      numFloodCompressedValuesCounter.add(numCompressed);
+    }
 
-          auto endTime = std::chrono::steady_clock::now();
-          auto timeDelta =
-              std::chrono::duration_cast<std::chrono::milliseconds>(
-                  endTime - startTime);
+    // peer streams my floods, one-way
+    auto streamIt = floodStreams_.find(peerName);
+    if (streamIt != floodStreams_.end()) {
+      if (not streamIt->second.isCompleted()) {
+        streamIt->second.next(*peerParams);
+        fb303::fbData->addStatValue(
+            "kvstore.thrift.num_flood_stream_pub", 1, fb303::COUNT);
+        continue;
+      }
+      floodStreams_.erase(streamIt);
+    }
 
-          // record telemetry for thrift calls
-          fb303::fbData->addStatValue(
-              "kvstore.thrift.num_flood_pub_success", 1, fb303::COUNT);
-          fb303::fbData->addStatValue(
-              "kvstore.thrift.flood_pub_duration_ms",
-              timeDelta.count(),
-              fb303::AVG);
-        })
-        .thenError(
-            [this, peerName, startTime](const folly::exception_wrapper& ew) {
-              // state transition to IDLE
-              auto endTime = std::chrono::steady_clock::now();
-              auto timeDelta =
-                  std::chrono::duration_cast<std::chrono::milliseconds>(
-                      endTime - startTime);
-              processThriftFailure(peerName, ew.what(), timeDelta);
+    sendFloodToPeer(peerName, thriftPeer, *peerParams);
+  }
+}
 
-              // record telemetry for thrift calls
-              fb303::fbData->addStatValue(
-                  "kvstore.thrift.num_flood_pub_failure", 1, fb303::COUNT);
-            });
+void
+KvStoreDb::addFloodStream(
+    std::string const& peerName, KvStoreFloodStreamPublisher&& publisher) {
+  LOG(INFO) << "[Flood Stream] " << peerName << " streams floods of area "
+            << area_;
+  auto it = floodStreams_.find(peerName);
+  if (it != floodStreams_.end()) {
+    it->second.complete();
+    it->second = std::move(publisher);
+  } else {
+    floodStreams_.emplace(peerName, std::move(publisher));
+  }
+}
+
+void
+KvStoreDb::subscribeFloodStream(
+    std::string const& peerName, KvStorePeer& peer) {
+  peer.floodSubscriptionPending = true;
+  auto const* client = peer.client.get();
+  client->semifuture_subscribeKvStorePeerFlood(area_, kvParams_.nodeId)
+      .via(evb_->getEvb())
+      .thenValue(
+          [this, peerName, client](
+              apache::thrift::ClientBufferedStream<thrift::KeySetParams>&&
+                  stream) {
+            // stream of a client which is gone, dropped along with it
+            auto peerIt = thriftPeers_.find(peerName);
+            if (peerIt == thriftPeers_.end() or
+                peerIt->second.client.get() != client) {
+              return;
+            }
+            LOG(INFO) << "[Flood Stream] Receiving floods of " << peerName
+                      << " over stream";
+            auto& peer = peerIt->second;
+            peer.floodSubscriptionPending = false;
+            peer.floodSubscription = std::move(stream).subscribeExTry(
+                folly::Executor::getKeepAliveToken(evb_->getEvb()),
+                [this, peerName, client](
+                    folly::Try<thrift::KeySetParams>&& maybeParams) {
+                  if (maybeParams.hasValue()) {
+                    fb303::fbData->addStatValue(
+                        "kvstore.thrift.num_flood_stream_received",
+                        1,
+                        fb303::COUNT);
+                    setKeyVals(std::move(maybeParams).value());
+                    return;
+                  }
+                  onFloodStreamEnd(
+                      peerName,
+                      client,
+                      maybeParams.hasException()
+                          ? maybeParams.exception()
+                          : folly::exception_wrapper());
+                });
+          })
+      .thenError([this, peerName, client](const folly::exception_wrapper& ew) {
+        // peer doesn't stream floods, it keeps flooding with calls
+        auto peerIt = thriftPeers_.find(peerName);
+        if (peerIt != thriftPeers_.end() and
+            peerIt->second.client.get() == client) {
+          peerIt->second.floodSubscriptionPending = false;
+        }
+        LOG(WARNING) << "[Flood Stream] " << peerName
+                     << " doesn't stream floods: " << ew.what();
+      });
+}
+
+void
+KvStoreDb::onFloodStreamEnd(
+    std::string const& peerName,
+    thrift::OpenrCtrlCppAsyncClient const* client,
+    folly::exception_wrapper ew) {
+  // the subscription is released out of its own callback
+  evb_->getEvb()->runInEventBaseThread(
+      [this, peerName, client, ew = std::move(ew)]() {
+        auto peerIt = thriftPeers_.find(peerName);
+        if (peerIt == thriftPeers_.end() or
+            peerIt->second.client.get() != client or
+            not peerIt->second.floodSubscription.has_value()) {
+          return;
+        }
+        if (not ew) {
+          // peer floods with calls again, e.g. after it restarted
+          LOG(INFO) << "[Flood Stream] Stream of " << peerName << " ended";
+          std::move(*peerIt->second.floodSubscription).detach();
+          peerIt->second.floodSubscription.reset();
+          return;
+        }
+        // floods may be lost, sync again
+        fb303::fbData->addStatValue(
+            "kvstore.thrift.num_flood_stream_failure", 1, fb303::COUNT);
+        processThriftFailure(
+            peerName, ew.what(), std::chrono::milliseconds(0));
+      });
+}
+
+void
+KvStoreDb::sendFloodToPeer(
+    std::string const& peerName,
+    KvStorePeer& peer,
+    thrift::KeySetParams const& params) {
+  ++peer.numPendingFloods;
+  auto const* client = peer.client.get();
+  auto startTime = std::chrono::steady_clock::now();
+  auto sf = peer.client->semifuture_setKvStoreKeyVals(params, area_);
+  std::move(sf)
+      .via(evb_->getEvb())
+      .thenValue([this, peerName, client, startTime](folly::Unit&&) {
+        VLOG(4) << "Flooding ack received from peer: " << peerName;
+
+        auto endTime = std::chrono::steady_clock::now();
+        auto timeDelta = std::chrono::duration_cast<std::chrono::milliseconds>(
+            endTime - startTime);
+
+        // record telemetry for thrift calls
+        numFloodPubSuccessCounter.add();
+        fb303::fbData->addStatValue(
+            "kvstore.thrift.flood_pub_duration_ms",
+            timeDelta.count(),
+            fb303::AVG);
+
+        // ack of a pipeline which is gone
+        auto peerIt = thriftPeers_.find(peerName);
+        if (peerIt == thriftPeers_.end() or
+            peerIt->second.client.get() != client) {
+          return;
+        }
+        auto& thriftPeer = peerIt->second;
+        --thriftPeer.numPendingFloods;
+        if (thriftPeer.queuedFloods.empty()) {
+          return;
+        }
+        auto nextParams = std::move(thriftPeer.queuedFloods.front());
+        thriftPeer.queuedFloods.pop_front();
+        if (compressedValuePeers_.count(peerName)) {
+          size_t numCompressed = 0;
+          for (auto& [_, value] : *nextParams.keyVals_ref()) {
+            if (KvStore::compressValue(value)) {
+              ++numCompressed;
+            }
+          }
+          numFloodCompressedValuesCounter.add(numCompressed);
+        }
+        sendFloodToPeer(peerName, thriftPeer, nextParams);
+      })
+      .thenError([this, peerName, client, startTime](
+                     const folly::exception_wrapper& ew) {
+        // record telemetry for thrift calls
+        numFloodPubFailureCounter.add();
+
+        // failure of a pipeline which is gone, the peer reconnected
+        auto peerIt = thriftPeers_.find(peerName);
+        if (peerIt == thriftPeers_.end() or
+            peerIt->second.client.get() != client) {
+          return;
+        }
+
+        // state transition to IDLE
+        auto endTime = std::chrono::steady_clock::now();
+        auto timeDelta = std::chrono::duration_cast<std::chrono::milliseconds>(
+            endTime - startTime);
+        processThriftFailure(peerName, ew.what(), timeDelta);
+      });
+}
+
+void
+KvStoreDb::setKeyVals(thrift::KeySetParams&& keySetParams) {
+  if (keySetParams.timestamp_ms_ref().has_value()) {
+    auto floodMs =
+        getUnixTimeStampMs() - keySetParams.timestamp_ms_ref().value();
+    if (floodMs > 0) {
+      fb303::fbData->addStatValue(
+          "kvstore.flood_duration_ms", floodMs, fb303::AVG);
+      if (keyClasses_.size() > 1) {
+        std::vector<bool> hasClass(keyClasses_.size(), false);
+        for (auto const& [key, _] : *keySetParams.keyVals_ref()) {
+          hasClass.at(keyClasses_.getClass(key)) = true;
+        }
+        for (size_t i = 0; i < hasClass.size(); ++i) {
+          if (hasClass[i]) {
+            fb303::fbData->addStatValue(
+                fmt::format(
+                    "kvstore.key_class.{}.flood_duration_ms",
+                    keyClasses_.getName(i)),
+                floodMs,
+                fb303::AVG);
+          }
+        }
+      }
+    }
+  }
+
+  // Update hash for key-values. Ones flooded by peers carry the hash
+  // computed by the first store they went through, it is kept
+  const bool fromPeer = keySetParams.nodeIds_ref().has_value() and
+      not keySetParams.nodeIds_ref()->empty();
+  for (auto& [_, value] : *keySetParams.keyVals_ref()) {
+    if (value.value_ref().has_value() and
+        (not fromPeer or not value.hash_ref().has_value())) {
+      value.hash_ref() = generateHash(
+          *value.version_ref(), *value.originatorId_ref(), value.value_ref());
+    }
+  }
+
+  // Create publication and merge it with local KvStore
+  thrift::Publication rcvdPublication;
+  rcvdPublication.keyVals_ref() = std::move(*keySetParams.keyVals_ref());
+  rcvdPublication.nodeIds_ref().move_from(keySetParams.nodeIds_ref());
+  rcvdPublication.floodRootId_ref().move_from(keySetParams.floodRootId_ref());
+  rcvdPublication.perfEvents_ref().move_from(keySetParams.perfEvents_ref());
+  mergePublication(rcvdPublication);
+}
+
+void
+KvStoreDb::setKeyValsCombined(
+    thrift::KeySetParams&& keySetParams, folly::Promise<folly::Unit> promise) {
+  // floods of peers and traced writes keep their own publication
+  const bool isLocal = (not keySetParams.nodeIds_ref().has_value() or
+                        keySetParams.nodeIds_ref()->empty()) and
+      not keySetParams.floodRootId_ref().has_value() and
+      not keySetParams.perfEvents_ref().has_value();
+  if (not isLocal) {
+    flushCombinedKeyVals();
+    setKeyVals(std::move(keySetParams));
+    promise.setValue();
+    return;
+  }
+
+  // key written again within the iteration, merge writes in order
+  auto& combinedKeyVals = *combinedKeySetParams_.keyVals_ref();
+  for (auto const& [key, _] : *keySetParams.keyVals_ref()) {
+    if (combinedKeyVals.count(key)) {
+      flushCombinedKeyVals();
+      break;
+    }
+  }
+  for (auto& [key, value] : *keySetParams.keyVals_ref()) {
+    combinedKeyVals.emplace(key, std::move(value));
+  }
+  // earliest write of the batch
+  if (auto timestamp = keySetParams.timestamp_ms_ref()) {
+    combinedKeySetParams_.timestamp_ms_ref() = std::min(
+        combinedKeySetParams_.timestamp_ms_ref().value_or(*timestamp),
+        *timestamp);
+  }
+  combinedKeySetPromises_.emplace_back(std::move(promise));
+  if (not combinedKeyValsTimer_->isScheduled()) {
+    combinedKeyValsTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
+
+void
+KvStoreDb::flushCombinedKeyVals() {
+  if (combinedKeySetPromises_.empty()) {
+    return;
+  }
+  auto promises = std::exchange(combinedKeySetPromises_, {});
+  fb303::fbData->addStatValue(
+      "kvstore.combined_key_set_writes", promises.size(), fb303::AVG);
+  setKeyVals(std::exchange(combinedKeySetParams_, thrift::KeySetParams{}));
+  for (auto& promise : promises) {
+    promise.setValue();
   }
 }
 
@@ -2957,11 +5345,8 @@ KvStoreDb::mergePublication(
     const thrift::Publication& rcvdPublication,
     std::optional<std::string> senderId) {
   // Add counters
-  fb303::fbData->addStatValue("kvstore.received_publications", 1, fb303::COUNT);
-  fb303::fbData->addStatValue(
-      "kvstore.received_key_vals",
-      rcvdPublication.keyVals_ref()->size(),
-      fb303::SUM);
+  receivedPublicationsCounter.add();
+  receivedKeyValsCounter.add(rcvdPublication.keyVals_ref()->size());
 
   static const std::vector<std::string> kUpdatedKeys = {};
 
@@ -2991,27 +5376,125 @@ KvStoreDb::mergePublication(
   if (nodeIds.has_value() and
       std::find(nodeIds->cbegin(), nodeIds->cend(), kvParams_.nodeId) !=
           nodeIds->cend()) {
-    fb303::fbData->addStatValue("kvstore.looped_publications", 1, fb303::COUNT);
+    loopedPublicationsCounter.add();
     return 0;
   }
 
+  // Compressed values come without data, decompress it. Their hash is the
+  // one of the data, so they merge as if they came uncompressed
+  const thrift::KeyVals* keyVals = &*rcvdPublication.keyVals_ref();
+  thrift::KeyVals patchedKeyVals;
+  if (std::any_of(keyVals->begin(), keyVals->end(), [](auto const& kv) {
+        return kv.second.compressedValue_ref().has_value();
+      })) {
+    patchedKeyVals = *keyVals;
+    decompressKeyVals(patchedKeyVals);
+    keyVals = &patchedKeyVals;
+  }
+
+  // Patched values come without data, rebuild it from the version we have.
+  // Keys we can't rebuild are fetched from the node that flooded them
+  std::vector<std::string> missingBaseKeys;
+  if (std::any_of(keyVals->begin(), keyVals->end(), [](auto const& kv) {
+        return kv.second.patch_ref().has_value();
+      })) {
+    if (keyVals != &patchedKeyVals) {
+      patchedKeyVals = *keyVals;
+    }
+    for (auto it = patchedKeyVals.begin(); it != patchedKeyVals.end();) {
+      auto& value = it->second;
+      if (not value.patch_ref().has_value()) {
+        ++it;
+        continue;
+      }
+      auto baseIt = kvStore_.find(it->first);
+      if (baseIt != kvStore_.end() and
+          *baseIt->second.version_ref() >= *value.version_ref()) {
+        // nothing new, merge skips it
+        ++it;
+        continue;
+      }
+      if (baseIt != kvStore_.end() and
+          KvStore::applyValuePatch(baseIt->second, value)) {
+        appliedValuePatchesCounter.add();
+        ++it;
+        continue;
+      }
+      missingBaseKeys.emplace_back(it->first);
+      it = patchedKeyVals.erase(it);
+    }
+    keyVals = &patchedKeyVals;
+  }
+  if (not missingBaseKeys.empty()) {
+    fb303::fbData->addStatValue(
+        "kvstore.missing_value_patch_bases",
+        missingBaseKeys.size(),
+        fb303::SUM);
+    auto floodSender = senderId;
+    if (not floodSender.has_value() and nodeIds.has_value() and
+        not nodeIds->empty()) {
+      floodSender = nodeIds->back();
+    }
+    if (floodSender.has_value()) {
+      requestKeysFromPeer(*floodSender, std::move(missingBaseKeys));
+    }
+  }
+
   // Generate delta with local KvStore
   thrift::Publication deltaPublication;
   deltaPublication.keyVals_ref() = KvStore::mergeKeyValues(
-      kvStore_, *rcvdPublication.keyVals_ref(), kvParams_.filters);
+      kvStore_,
+      *keyVals,
+      kvParams_.filters,
+      &kvStoreBucketHashes_,
+      kvParams_.enableFloodValuePatch,
+      &kvStoreKeyIndex_);
   deltaPublication.floodRootId_ref().copy_from(
       rcvdPublication.floodRootId_ref());
   deltaPublication.area_ref() = area_;
 
   const size_t kvUpdateCnt = deltaPublication.keyVals_ref()->size();
-  fb303::fbData->addStatValue(
-      "kvstore.updated_key_vals", kvUpdateCnt, fb303::SUM);
+  updatedKeyValsCounter.add(kvUpdateCnt);
+  if (kvUpdateCnt) {
+    ++kvStoreGeneration_;
+  }
+  for (auto const& [key, _] : *deltaPublication.keyVals_ref()) {
+    changeLog_.add(key);
+  }
+
+  // TTL refreshes carry no value and leave the summary unchanged
+  for (auto const& [_, value] : *deltaPublication.keyVals_ref()) {
+    if (value.value_ref().has_value()) {
+      ++summaryGeneration_;
+      break;
+    }
+  }
 
   // Populate nodeIds and our nodeId_ to the end
   if (rcvdPublication.nodeIds_ref().has_value()) {
     deltaPublication.nodeIds_ref().copy_from(rcvdPublication.nodeIds_ref());
   }
 
+  // Carry on trace of the received update, or sample updates originated by
+  // local clients
+  if (kvUpdateCnt) {
+    if (auto perfEvents = rcvdPublication.perfEvents_ref()) {
+      deltaPublication.perfEvents_ref() = *perfEvents;
+      auto floodLatency = endPerfSpan(
+          *deltaPublication.perfEvents_ref(),
+          kvParams_.nodeId,
+          Constants::kPerfSpanKvStoreFlood);
+      if (floodLatency.has_value()) {
+        floodHopLatencyCounter.add(floodLatency->count());
+      }
+    } else if (not senderId.has_value() and not nodeIds.has_value()) {
+      thrift::PerfEvents trace;
+      if (maybeStartPerfTrace(trace, kvParams_.perfTraceSampleRate)) {
+        deltaPublication.perfEvents_ref() = std::move(trace);
+      }
+    }
+  }
+
   // Update ttl values of keys
   updateTtlCountdownQueue(deltaPublication);
 
@@ -3020,8 +5503,7 @@ KvStoreDb::mergePublication(
     floodPublication(std::move(deltaPublication));
   } else {
     // Keep track of received publications which din't update any field
-    fb303::fbData->addStatValue(
-        "kvstore.received_redundant_publications", 1, fb303::COUNT);
+    receivedRedundantPublicationsCounter.add();
   }
 
   // response to senderId with tobeUpdatedKeys + Vals
@@ -3130,4 +5612,16 @@ KvStoreDb::sendDualMessages(
   return true;
 }
 
+void
+KvStoreDb::scheduleDualMessagesFlush() {
+  if (not dualFlushTimer_) {
+    // dual messages sent while constructing
+    flushDualMessages();
+    return;
+  }
+  if (not dualFlushTimer_->isScheduled()) {
+    dualFlushTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
+
 } // namespace openr
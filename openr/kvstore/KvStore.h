@@ -7,19 +7,27 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <deque>
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 
-#include <boost/heap/priority_queue.hpp>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Function.h>
 #include <folly/Optional.h>
+#include <folly/Random.h>
+#include <folly/Synchronized.h>
 #include <folly/TokenBucket.h>
+#include <folly/container/F14Map.h>
 #include <folly/futures/Future.h>
 #include <folly/gen/Base.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/AsyncTimeout.h>
+#include <thrift/lib/cpp2/async/ClientBufferedStream.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
@@ -29,8 +37,10 @@
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
 #include <openr/config/Config.h>
+#include <openr/ctrl-server/StreamPublisher.h>
 #include <openr/dual/Dual.h>
 #include <openr/if/gen-cpp2/OpenrConfig_types.h>
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
 #include <openr/if/gen-cpp2/Types_constants.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 #include <openr/messaging/ReplicateQueue.h>
@@ -49,24 +59,124 @@ enum class KvStorePeerEvent {
   THRIFT_API_ERROR = 3,
 };
 
+// Key-values of a KvStoreDb. Values are large enough for F14FastMap to pick
+// the vector layout: they live in one contiguous array indexed by a compact
+// open-addressing table, so full dumps and hash dumps scan memory linearly
+// instead of chasing one heap node per key.
+using KvStoreMap = folly::F14FastMap<std::string, thrift::Value>;
+
+// Coalescer of the floods streamed to a lagging peer, see
+// BufferedStreamPublisher. Keeps the latest value per key. Coalesced floods
+// lose their flooding path, they are sent as originated by this node and
+// flooded further to all peers
+class FloodParamsCoalescer {
+ public:
+  void add(thrift::KeySetParams&& params);
+
+  // number of coalesced keys
+  size_t
+  size() const {
+    return keyVals_.size();
+  }
+
+  std::vector<thrift::KeySetParams> release();
+
+ private:
+  thrift::KeyVals keyVals_;
+  std::optional<std::string> nodeId_;
+};
+
+using KvStoreFloodStreamPublisher =
+    BufferedStreamPublisher<thrift::KeySetParams, FloodParamsCoalescer>;
+using KvStoreFloodSubscription =
+    apache::thrift::ClientBufferedStream<thrift::KeySetParams>::Subscription;
+
 struct TtlCountdownQueueEntry {
   std::chrono::steady_clock::time_point expiryTime;
   std::string key;
   int64_t version{0};
   int64_t ttlVersion{0};
   std::string originatorId;
+};
+
+// Hierarchical timing wheel tracking TTL expiry of keys. It holds at most one
+// entry per key, so memory is bounded by the number of keys with a finite TTL.
+// schedule() and erase() are O(1), a TTL refresh moves the key to a new slot
+// instead of queueing another entry.
+//
+// Level 0 has kSlots slots of one tick each, every higher level has kSlots
+// slots spanning the whole level beneath it. An entry is placed on the lowest
+// level whose range contains its expiry and moves down a level every time the
+// level beneath wraps around.
+class TtlCountdownWheel {
+ public:
+  explicit TtlCountdownWheel(
+      std::chrono::milliseconds tick = Constants::kTtlCountdownTick,
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now());
+
+  // add entry or move the existing entry of entry.key to its new expiry
+  void schedule(TtlCountdownQueueEntry entry);
+
+  void erase(std::string const& key);
+
+  // entry of key, nullptr if key is not being counted down
+  TtlCountdownQueueEntry const* find(std::string const& key) const;
+
+  // advance the wheel to now and return all entries that expired, ordered by
+  // expiry tick
+  std::vector<TtlCountdownQueueEntry> advance(
+      std::chrono::steady_clock::time_point now);
+
+  // earliest time the next advance() may return expired entries. This can be
+  // a bit early when entries wait on a higher level. std::nullopt if empty
+  std::optional<std::chrono::steady_clock::time_point> getNextWakeup() const;
+
+  size_t
+  size() const {
+    return entries_.size();
+  }
+
   bool
-  operator>(TtlCountdownQueueEntry other) const {
-    return expiryTime > other.expiryTime;
+  empty() const {
+    return entries_.empty();
   }
-};
 
-// TODO: migrate to std::priority_queue
-using TtlCountdownQueue = boost::heap::priority_queue<
-    TtlCountdownQueueEntry,
-    // Always returns smallest first
-    boost::heap::compare<std::greater<TtlCountdownQueueEntry>>,
-    boost::heap::stable<true>>;
+ private:
+  static constexpr size_t kLevels{4};
+  static constexpr size_t kSlotBits{8};
+  static constexpr size_t kSlots{1 << kSlotBits};
+
+  using Slot = std::list<std::string const*>;
+
+  struct Entry {
+    TtlCountdownQueueEntry entry;
+    uint64_t expiryTick{0};
+    size_t level{0};
+    Slot::iterator slotIt;
+  };
+
+  // first tick at or after time
+  uint64_t toTick(std::chrono::steady_clock::time_point time) const;
+
+  std::chrono::steady_clock::time_point toTime(uint64_t tick) const;
+
+  // put entry of key into the slot matching its expiryTick
+  void place(std::string const& key, Entry& entry);
+
+  // move all entries of the current slot at level down the wheel
+  void cascade(size_t level);
+
+  const std::chrono::milliseconds tick_;
+  const std::chrono::steady_clock::time_point start_;
+
+  // all ticks up to and including currentTick_ have been processed
+  uint64_t currentTick_{0};
+
+  std::unordered_map<std::string, Entry> entries_;
+  std::array<std::array<Slot, kSlots>, kLevels> slots_;
+  std::array<size_t, kLevels> levelSizes_{};
+};
 
 class KvStoreFilters {
  public:
@@ -87,26 +197,253 @@ class KvStoreFilters {
       thrift::Value const& value,
       thrift::FilterOperator const& oper = thrift::FilterOperator::OR) const;
 
+  // Check if key matches one of the key prefixes, false if there are none
+  bool keyPrefixMatch(std::string const& key) const;
+
   // return comma separeated string prefix
-  std::vector<std::string> getKeyPrefixes() const;
+  std::vector<std::string> const& getKeyPrefixes() const;
 
   // return set of origninator IDs
-  std::set<std::string> getOriginatorIdList() const;
+  std::set<std::string> const& getOriginatorIdList() const;
+
+  // key prefixes without regex syntax, sorted and without the ones covered
+  // by a shorter prefix, so that each key matches at most one of them
+  std::vector<std::string> const&
+  getLiteralKeyPrefixes() const {
+    return literalKeyPrefixes_;
+  }
+
+  // whether some key prefix is a true regex and needs RE2 to match
+  bool
+  hasKeyRegex() const {
+    return hasKeyRegex_;
+  }
 
   // print filters
   std::string str() const;
 
  private:
+  static bool isLiteralKeyPrefix(std::string const& keyPrefix);
+
+  static std::vector<std::string> getKeyRegexes(
+      std::vector<std::string> const& keyPrefix);
+
   // list of string prefixes, empty list matches all keys
   std::vector<std::string> keyPrefixList_{};
 
   // set of node IDs to match, empty set matches all nodes
   std::set<std::string> originatorIds_{};
 
-  // keyPrefix class to create RE2 set and to match keys
+  // key prefixes matched by comparing the start of keys
+  std::vector<std::string> literalKeyPrefixes_{};
+
+  bool hasKeyRegex_{false};
+
+  // keyPrefix class to create RE2 set and to match keys. Holds the key
+  // prefixes which are true regexes only
   RegexSet keyRegexSet_;
 };
 
+// Indexes of the keys of a KvStore, maintained along with it. Filters on
+// literal key prefixes run as range scans over the sorted keys and filters
+// on originator IDs as lookups, instead of matching every key in the store.
+class KvStoreKeyIndex {
+ public:
+  void add(std::string const& key, thrift::Value const& value);
+  void remove(std::string const& key, thrift::Value const& value);
+
+  // value of key was replaced by one from another originator
+  void updateOriginator(
+      std::string const& key,
+      std::string const& oldOriginatorId,
+      std::string const& newOriginatorId);
+
+  // call cb once for every key which may match filters with oper, callers
+  // still have to match them. Returns false without calling cb if the
+  // indexes don't narrow down the keys, e.g. for regexes, and every key has
+  // to be matched instead
+  bool forEachCandidate(
+      KvStoreFilters const& filters,
+      thrift::FilterOperator oper,
+      folly::FunctionRef<void(std::string const&)> cb) const;
+
+  // call cb for keys greater than cursor (all if not set) in ascending order,
+  // until it returns false
+  void forEachKeyAfter(
+      std::optional<std::string> const& cursor,
+      folly::FunctionRef<bool(std::string const&)> cb) const;
+
+  // whether any key has a value from originatorId
+  bool
+  hasOriginator(std::string const& originatorId) const {
+    return originatorKeys_.count(originatorId) != 0;
+  }
+
+ private:
+  // all keys, sorted, so keys with the same prefix are adjacent
+  std::set<std::string> keys_;
+
+  // keys by originator ID of their value. Point into keys_, whose nodes are
+  // stable, so each key is held once however many indexes refer to it
+  std::unordered_map<std::string, std::unordered_set<std::string const*>>
+      originatorKeys_;
+};
+
+// Summary of a KvStore for full-sync. Keys are hashed into a fixed number of
+// buckets and each bucket holds the XOR of the digests of its key-values. XOR
+// makes add() and remove() O(1) and independent of order, so stores with the
+// same key-values have the same bucket hashes no matter how they got there.
+// Peers exchange bucket hashes and then only sync keys in differing buckets.
+// The approximate memory held by the key-values is summed along, as it is
+// maintained at the same mutation sites.
+class KvStoreBucketHashes {
+ public:
+  explicit KvStoreBucketHashes(
+      size_t numBuckets = Constants::kKvStoreSyncBuckets);
+
+  // bucket of key. Stable across nodes, like the hash of thrift::Value
+  int32_t getBucket(std::string const& key) const;
+
+  // update the bucket of key. value must have its hash set
+  void add(std::string const& key, thrift::Value const& value);
+  void remove(std::string const& key, thrift::Value const& value);
+
+  std::vector<int64_t> const&
+  getHashes() const {
+    return hashes_;
+  }
+
+  // approximate bytes held by the added key-values
+  size_t
+  getNumBytes() const {
+    return numBytes_;
+  }
+
+  // buckets on which hashes differ from peerHashes. All buckets if peer uses
+  // a different number of buckets
+  std::vector<int32_t> getDifferingBuckets(
+      std::vector<int64_t> const& peerHashes) const;
+
+ private:
+  static int64_t getDigest(std::string const& key, thrift::Value const& value);
+
+  static size_t getSize(std::string const& key, thrift::Value const& value);
+
+  std::vector<int64_t> hashes_;
+
+  size_t numBytes_{0};
+};
+
+// Bounded log of recent key changes of a KvStore for incremental full-sync.
+// Every change gets the next sequence number and the oldest ones are dropped
+// once the log is full. A peer in sync up to a sequence number the log still
+// covers only needs the keys changed since.
+class KvStoreChangeLog {
+ public:
+  explicit KvStoreChangeLog(
+      size_t capacity = Constants::kKvStoreChangeLogSize);
+
+  // log a change of key
+  void add(std::string const& key);
+
+  // sequence number of the latest change, 0 if none
+  int64_t
+  getSequence() const {
+    return sequence_;
+  }
+
+  // whether all changes after sequence are still logged
+  bool covers(int64_t sequence) const;
+
+  // keys changed after sequence, which must be covered
+  std::unordered_set<std::string> getKeysSince(int64_t sequence) const;
+
+ private:
+  const size_t capacity_;
+
+  int64_t sequence_{0};
+
+  // keys of the changes up to sequence_, oldest first
+  std::deque<std::string> keys_;
+};
+
+// Priority classes of keys by key prefix, see thrift::KvstoreKeyClass. Class
+// 0 has the highest priority. Keys of no configured class belong to the last
+// one, `default`, which is the only class if none are configured.
+class KvStoreKeyClasses {
+ public:
+  explicit KvStoreKeyClasses(
+      std::vector<thrift::KvstoreKeyClass> const& keyClasses = {});
+
+  size_t getClass(std::string const& key) const;
+
+  size_t
+  size() const {
+    return names_.size();
+  }
+
+  std::string const&
+  getName(size_t keyClass) const {
+    return names_.at(keyClass);
+  }
+
+  // split key-values and expired keys of publication into one publication
+  // per class with keys, highest priority first. Publication is returned as
+  // is if it has keys of a single class
+  std::vector<thrift::Publication> split(
+      thrift::Publication&& publication) const;
+
+ private:
+  // key prefixes and their class, in order of priority
+  std::vector<std::pair<std::string, size_t>> keyPrefixes_;
+
+  std::vector<std::string> names_;
+};
+
+// Keys and key filters the KvStoreClientInternal instances of a KvStore are
+// interested in. KvStore looks up the keys of a publication once for all
+// clients and pushes each of them only its key-values and expired keys, on a
+// reader of its own. TTL updates are not delivered, clients ignore them.
+// Thread-safe, clients update their interests from their own event base.
+class KvStoreClientIndex {
+ public:
+  using ClientId = uint64_t;
+
+  explicit KvStoreClientIndex(
+      messaging::ReplicateQueue<thrift::Publication>& updatesQueue);
+
+  // register a client. Its reader gets closed along with updatesQueue and
+  // the client is forgotten once the reader is gone
+  std::pair<ClientId, messaging::RQueue<thrift::Publication>> addClient();
+
+  void addKey(ClientId id, std::string const& key);
+  void removeKey(ClientId id, std::string const& key);
+
+  // key-values matching the filter are delivered as well
+  void setFilter(ClientId id, std::optional<KvStoreFilters> filter);
+
+  // push the parts of publication clients are interested in
+  void dispatch(thrift::Publication const& publication);
+
+ private:
+  struct Client {
+    std::shared_ptr<messaging::RWQueue<thrift::Publication>> queue;
+    std::unordered_set<std::string> keys;
+    std::optional<KvStoreFilters> filter;
+  };
+
+  struct State {
+    ClientId nextId{0};
+    std::unordered_map<ClientId, Client> clients;
+    std::unordered_map<std::string, std::vector<ClientId>> keyClients;
+    std::vector<ClientId> filterClients;
+  };
+
+  messaging::ReplicateQueue<thrift::Publication>& updatesQueue_;
+
+  folly::Synchronized<State> state_;
+};
+
 // structure for common params across all instances of KvStoreDb
 struct KvStoreParams {
   // the name of this node (unique in domain)
@@ -115,6 +452,10 @@ struct KvStoreParams {
   // Queue for publishing KvStore updates to other modules within a process
   messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue;
 
+  // Interests of the KvStoreClientInternal instances, which get their
+  // updates from it instead of kvStoreUpdatesQueue
+  KvStoreClientIndex clientIndex;
+
   // Queue for publishing kvstore peer initial sync events
   messaging::ReplicateQueue<KvStoreSyncEvent>& kvStoreSyncEventsQueue;
 
@@ -134,12 +475,32 @@ struct KvStoreParams {
   std::optional<KvStoreFilters> filters;
   // Kvstore flooding rate
   std::optional<thrift::KvstoreFloodRate> floodRate;
+  // flooding rate of each originator, along with floodRate
+  std::optional<thrift::KvstoreFloodRate> originatorFloodRate;
+  // priority classes of keys, highest priority first
+  std::vector<thrift::KvstoreKeyClass> keyClasses;
   // TTL decrement factor
   std::chrono::milliseconds ttlDecr{Constants::kTtlDecrement};
   // DUAL related config knob
   bool enableFloodOptimization{false};
   bool isFloodRoot{false};
   bool enableThriftDualMsg{false};
+  // Kvstore flood coalescing
+  std::optional<thrift::KvstoreFloodCoalesce> floodCoalesce;
+  // flood new versions of keys as patches of their previous version
+  bool enableFloodValuePatch{false};
+  // fraction of locally originated updates traced end to end
+  double perfTraceSampleRate{0};
+  // flood locally originated updates on the SPTs of all healthy roots
+  bool enableFloodRootLoadBalancing{false};
+  // send large values compressed to peers accepting them
+  bool enableFloodValueCompression{false};
+  // receive floods of peers over a stream, see
+  // OpenrCtrlCpp.subscribeKvStorePeerFlood, and stream floods to peers asking
+  bool enableFloodStream{false};
+  // file prefix of the periodic snapshots of each area, if any
+  std::optional<std::string> snapshotFilePath;
+  std::chrono::seconds snapshotInterval{Constants::kKvStoreSnapshotInterval};
 
   KvStoreParams(
       std::string nodeId,
@@ -159,9 +520,13 @@ struct KvStoreParams {
       // DUAL related config knob
       bool enableFloodOptimization,
       bool isFloodRoot,
-      bool enableThriftDualMsg)
+      bool enableThriftDualMsg,
+      // Kvstore flood coalescing
+      std::optional<thrift::KvstoreFloodCoalesce> floodcoalesce = std::nullopt,
+      bool enableFloodValuePatch = false)
       : nodeId(nodeId),
         kvStoreUpdatesQueue(kvStoreUpdatesQueue),
+        clientIndex(kvStoreUpdatesQueue),
         kvStoreSyncEventsQueue(kvStoreSyncEventsQueue),
         logSampleQueue(logSampleQueue),
         globalCmdSock(std::move(globalCmdSock)),
@@ -172,7 +537,9 @@ struct KvStoreParams {
         ttlDecr(ttldecr),
         enableFloodOptimization(enableFloodOptimization),
         isFloodRoot(isFloodRoot),
-        enableThriftDualMsg(enableThriftDualMsg) {}
+        enableThriftDualMsg(enableThriftDualMsg),
+        floodCoalesce(std::move(floodcoalesce)),
+        enableFloodValuePatch(enableFloodValuePatch) {}
 };
 
 // The class represents a KV Store DB and stores KV pairs in internal map.
@@ -206,6 +573,13 @@ class KvStoreDb : public DualNode {
   // Calculate size of KvStoreDB (just the key/val pairs)
   size_t getKeyValsSize() const;
 
+  // Generation of the area summary (keys, values and peers), bumped on any of
+  // their changes but not on TTL refreshes. Safe to read from any thread.
+  int64_t
+  getSummaryGeneration() const {
+    return summaryGeneration_.load();
+  }
+
   // get multiple keys at once
   thrift::Publication getKeyVals(std::vector<std::string> const& keys);
 
@@ -215,16 +589,72 @@ class KvStoreDb : public DualNode {
       thrift::FilterOperator oper = thrift::FilterOperator::OR,
       bool doNotPublishValue = false) const;
 
+  // dump one page of the entries matching the filter, in ascending key order
+  // throws thrift::OpenrError on invalid page params
+  thrift::KvStoreKeyValsPage dumpPageWithFilters(
+      KvStoreFilters const& kvFilters,
+      thrift::FilterOperator oper,
+      bool doNotPublishValue,
+      thrift::PageParams const& page) const;
+
   // dump the hashes of my KV store whose keys match the given prefix
   // if prefix is the empty sting, the full hash store is dumped
   thrift::Publication dumpHashWithFilters(
       KvStoreFilters const& kvFilters) const;
 
+  // dumpAllWithFilters(), or dumpHashWithFilters() if hashOnly, shared with
+  // the other callers asking for the same filters until kvStore_ changes,
+  // e.g. the full-sync requests of all peers after a restart
+  std::shared_ptr<const thrift::Publication> getCachedDump(
+      KvStoreFilters const& kvFilters,
+      thrift::FilterOperator oper,
+      bool hashOnly);
+
   // dump the keys on which hashes differ from given keyVals
   thrift::Publication dumpDifference(
       std::unordered_map<std::string, thrift::Value> const& myKeyVal,
       std::unordered_map<std::string, thrift::Value> const& reqKeyVal) const;
 
+  // dump the entries of my KV store in buckets on which hashes differ from
+  // given bucket hashes, see KvStoreBucketHashes
+  thrift::Publication dumpBucketDifference(
+      std::vector<int64_t> const& reqBucketHashes,
+      KvStoreFilters const& kvFilters,
+      thrift::FilterOperator oper = thrift::FilterOperator::OR) const;
+
+  // dump the entries of my KV store changed since given position of my
+  // change log. std::nullopt if the change log doesn't cover it anymore
+  std::optional<thrift::Publication> dumpChangesSince(
+      thrift::KvStoreChangeLogPosition const& position,
+      KvStoreFilters const& kvFilters,
+      thrift::FilterOperator oper = thrift::FilterOperator::OR) const;
+
+  // position of the latest change in my change log
+  thrift::KvStoreChangeLogPosition getChangeLogPosition() const;
+
+  // record whether peer accepts compressed values, see
+  // thrift::KeyDumpParams.acceptCompressedValues. If so and value
+  // compression is enabled, compress the large values of its full-sync
+  // response
+  void updatePeerValueCompression(
+      std::string const& peerName,
+      bool acceptsCompressedValues,
+      thrift::Publication& syncResponse);
+
+  // apply key-values set by a client, or flooded by a peer
+  void setKeyVals(thrift::KeySetParams&& keySetParams);
+
+  // as setKeyVals(), but local writes of one event loop iteration are merged
+  // and flooded as a single publication. Promise is fulfilled once the write
+  // is merged. Floods of peers are applied right away
+  void setKeyValsCombined(
+      thrift::KeySetParams&& keySetParams, folly::Promise<folly::Unit> promise);
+
+  // stream floods to peerName over publisher instead of flooding calls,
+  // completing its previous stream if any
+  void addFloodStream(
+      std::string const& peerName, KvStoreFloodStreamPublisher&& publisher);
+
   // Merge received publication with local store and publish out the delta.
   // If senderId is set, will build <key:value> map from kvStore_ and
   // rcvdPublication.tobeUpdatedKeys and send back to senderId to update it
@@ -269,6 +699,9 @@ class KvStoreDb : public DualNode {
   // util function to fetch peer by its state
   std::vector<std::string> getPeersByState(thrift::KvStorePeerState state);
 
+  // number of peers in state, without copying their names
+  size_t getNumPeersByState(thrift::KvStorePeerState state) const;
+
   // util function for state transition
   static thrift::KvStorePeerState getNextState(
       std::optional<thrift::KvStorePeerState> const& currState,
@@ -280,7 +713,7 @@ class KvStoreDb : public DualNode {
   KvStoreDb& operator=(KvStoreDb const&) = delete;
 
   // util function to log state transition
-  static void logStateTransition(
+  void logStateTransition(
       std::string const& peerName,
       thrift::KvStorePeerState oldState,
       thrift::KvStorePeerState newState);
@@ -288,6 +721,30 @@ class KvStoreDb : public DualNode {
   // method to scan over thriftPeers to send full-dump request
   void requestThriftPeerSync();
 
+  // keys of full-sync response from peer, which peer needs to be updated
+  // with. The response covers `pub.keyValBuckets` or all keys if not set
+  std::vector<std::string> getKeysToUpdateFromSyncResponse(
+      thrift::Publication const& pub) const;
+
+  // util function to work out keys to send back in full-sync with peer for
+  // a response with changes since the previous full-sync
+  std::vector<std::string> getKeysToUpdateFromIncrementalSyncResponse(
+      std::string const& peerName, thrift::Publication const& pub) const;
+
+  // decompress compressed values received from a peer, dropping the ones
+  // which can't be decompressed
+  void decompressKeyVals(thrift::KeyVals& keyVals);
+
+  // file the snapshots of this area are written to
+  std::string getSnapshotFilePath() const;
+
+  // write all key-values of this area to the snapshot file
+  void writeSnapshot();
+
+  // merge the key-values of the snapshot file, with TTLs reduced by the time
+  // since it was written, to warm up the store before syncing with peers
+  void loadSnapshot();
+
   // util function to process when sync response received
   void processThriftSuccess(
       std::string const& peerName,
@@ -305,6 +762,9 @@ class KvStoreDb : public DualNode {
       const std::string& neighbor,
       const thrift::DualMessages& msgs) noexcept override;
 
+  // flush queued dual messages once the current event loop iteration is done
+  void scheduleDualMessagesFlush() override;
+
   // send topology-set command to peer, peer will set/unset me as child
   // rootId: action will applied on given rootId
   // peerName: peer name
@@ -369,6 +829,10 @@ class KvStoreDb : public DualNode {
       bool rateLimit = true,
       bool setFloodRoot = true);
 
+  // fetch keys from peer, used for patched values whose base we don't have
+  void requestKeysFromPeer(
+      std::string const& peerName, std::vector<std::string> keys);
+
   // perform last step as a 3-way full-sync request
   // full-sync initiator sends back key-val to senderId (where we made
   // full-sync request to) who need to update those keys
@@ -395,6 +859,28 @@ class KvStoreDb : public DualNode {
   // buffer publications blocked by the rate limiter
   void bufferPublication(thrift::Publication&& publication);
 
+  // move adjacency keys of publication into a publication of their own
+  static thrift::Publication extractPriorityKeys(
+      thrift::Publication& publication);
+
+  // move keys of originators without a token left in their bucket from
+  // publication to heldKeys_
+  void holdThrottledKeys(thrift::Publication& publication);
+
+  // move held keys of originators with a token again to publicationBuffer_,
+  // serving every originator once. Returns whether keys are still held
+  bool releaseHeldKeys();
+
+  // add keys of publication to publicationBuffer_
+  void addToPublicationBuffer(const thrift::Publication& publication);
+
+  // merge publication into the open coalescing window
+  void coalescePublication(thrift::Publication&& publication);
+
+  // flood publications merged in the coalescing window, subject to the rate
+  // limiter
+  void floodCoalescedUpdates();
+
   // flood pending update blocked by rate limiter
   void floodBufferedUpdates(void);
 
@@ -431,6 +917,10 @@ class KvStoreDb : public DualNode {
     bool getOrCreateThriftClient(
         OpenrEventBase* evb, std::optional<int> maybeIpTos);
 
+    // drop floods in flight and queued, along with the client they were sent
+    // over. Queued keys are flooded again once the peer is initialized
+    void resetFloodPipeline();
+
     // node name
     const std::string nodeName;
 
@@ -446,17 +936,78 @@ class KvStoreDb : public DualNode {
     // timer to periodically send keep-alive status
     // ATTN: this mechanism serves the purpose of avoiding channel being
     //       closed from thrift server due to IDLE timeout(i.e. 60s by default)
-    std::unique_ptr<folly::AsyncTimeout> keepAliveTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> keepAliveTimer{nullptr};
 
     // Stores set of keys that may have changed during initialization of this
     // peer. Will flood to them in finalizeFullSync(), the last step of initial
     // sync.
     std::unordered_set<std::string> pendingKeysDuringInitialization;
+
+    // sequence number of my change log when the pending full-sync request
+    // was sent
+    int64_t syncRequestSequence{0};
+
+    // floods sent to the peer and not acked yet, at most
+    // Constants::kMaxPendingFloodsPerPeer
+    size_t numPendingFloods{0};
+
+    // floods held back while the pipeline to the peer is full, merged where
+    // possible. Sent in order as floods in flight are acked
+    std::deque<thrift::KeySetParams> queuedFloods;
+
+    // stream of the floods of the peer, if it streams them
+    std::optional<KvStoreFloodSubscription> floodSubscription;
+    bool floodSubscriptionPending{false};
+  };
+
+  // transition peer to state, along with peersByState_
+  void setPeerState(
+      std::string const& peerName,
+      KvStorePeer& peer,
+      thrift::KvStorePeerState state);
+
+  // send flood over the pipeline to the peer, and the queued floods following
+  // it as it gets acked
+  void sendFloodToPeer(
+      std::string const& peerName,
+      KvStorePeer& peer,
+      thrift::KeySetParams const& params);
+
+  // open the stream of the floods of the peer, over its client. Floods keep
+  // coming as calls if the peer doesn't stream them
+  void subscribeFloodStream(std::string const& peerName, KvStorePeer& peer);
+
+  // flood stream of the peer over client ended, with an error if floods may
+  // be lost
+  void onFloodStreamEnd(
+      std::string const& peerName,
+      thrift::OpenrCtrlCppAsyncClient const* client,
+      folly::exception_wrapper ew);
+
+  // positions of the change logs at the last full-sync with a peer. Kept
+  // across peer flaps, so that a reconnecting peer syncs incrementally
+  struct PeerSyncPosition {
+    // peer's change log position the full-sync response was in sync with
+    thrift::KvStoreChangeLogPosition peerPosition;
+    // sequence number of my change log when requesting the full-sync
+    int64_t localSequence{0};
   };
+  std::unordered_map<std::string, PeerSyncPosition> peerSyncPositions_;
+
+  // peers getting the large values of flooded publications compressed
+  std::unordered_set<std::string> compressedValuePeers_;
+
+  // peers streaming my floods, see addFloodStream()
+  std::unordered_map<std::string, KvStoreFloodStreamPublisher> floodStreams_;
 
   // set of peers with all info over thrift channel
   std::unordered_map<std::string, KvStorePeer> thriftPeers_{};
 
+  // names of thriftPeers_ by state. Sync rounds only visit the peers which
+  // are IDLE, nodes with hundreds of peers don't scan all of them
+  std::unordered_map<thrift::KvStorePeerState, std::unordered_set<std::string>>
+      peersByState_;
+
   // [TO BE DEPRECATED]
   // The peers we will be talking to: both PUB and CMD URLs for each. We use
   // peerAddCounter_ to uniquely identify a peering session's socket-id.
@@ -481,14 +1032,45 @@ class KvStoreDb : public DualNode {
   apache::thrift::CompactSerializer serializer_;
 
   // store keys mapped to (version, originatoId, value)
-  std::unordered_map<std::string, thrift::Value> kvStore_;
+  KvStoreMap kvStore_;
+
+  // see getSummaryGeneration()
+  std::atomic<int64_t> summaryGeneration_{0};
+
+  // generation of kvStore_, bumped on any of its changes including TTL
+  // refreshes, and generation of the dumps in dumpCache_
+  uint64_t kvStoreGeneration_{0};
+  uint64_t dumpCacheGeneration_{0};
+
+  // see getCachedDump(), keyed by filters and kind of dump
+  std::unordered_map<std::string, std::shared_ptr<const thrift::Publication>>
+      dumpCache_;
+
+  // summary of kvStore_ for full-sync, maintained along with it
+  KvStoreBucketHashes kvStoreBucketHashes_;
+
+  // indexes of kvStore_ keys for filtered dumps, maintained along with it
+  KvStoreKeyIndex kvStoreKeyIndex_;
 
-  // TTL count down queue
-  TtlCountdownQueue ttlCountdownQueue_;
+  // recent changes of kvStore_ for incremental full-sync. The epoch tells
+  // change logs of different runs apart
+  KvStoreChangeLog changeLog_;
+  const int64_t changeLogEpoch_{
+      static_cast<int64_t>(folly::Random::rand64() >> 1)};
+
+  // TTL count down of keys
+  TtlCountdownWheel ttlCountdownWheel_;
 
   // TTL count down timer
   std::unique_ptr<folly::AsyncTimeout> ttlCountdownTimer_;
 
+  // entries taken off ttlCountdownWheel_ as due and not expired yet. Expired
+  // in slices of Constants::kTtlExpirySliceSize per event loop iteration
+  std::deque<TtlCountdownQueueEntry> dueTtlEntries_;
+
+  // time ttlCountdownTimer_ is scheduled for, if it is
+  std::optional<std::chrono::steady_clock::time_point> ttlCountdownWakeup_;
+
   // [TO BE DEPRECATED]
   // Map of latest peer sync up request send to each peer
   // this is used to measure full-dump sync time between this node and each of
@@ -501,21 +1083,80 @@ class KvStoreDb : public DualNode {
   // Kvstore rate limiter
   std::unique_ptr<folly::BasicTokenBucket<>> floodLimiter_{nullptr};
 
+  // rate limiter of adjacency keys, which flood ahead of other keys
+  // blocked by floodLimiter_ so that topology changes don't queue behind a
+  // prefix storm
+  std::unique_ptr<folly::BasicTokenBucket<>> priorityFloodLimiter_{nullptr};
+
+  // keys of higher priority classes are flooded and merged first
+  const KvStoreKeyClasses keyClasses_;
+
+  // rate limiter of each originator, if kvParams_.originatorFloodRate is set
+  std::unordered_map<std::string, folly::BasicTokenBucket<>>
+      originatorFloodLimiters_;
+
+  // keys held back by the rate limiter of their originator
+  // map<originator: map<flood-root-id: set<keys>>>
+  std::unordered_map<
+      std::string,
+      std::unordered_map<
+          std::optional<std::string>,
+          std::unordered_set<std::string>>>
+      heldKeys_;
+
   // timer to send pending kvstore publication
   std::unique_ptr<folly::AsyncTimeout> pendingPublicationTimer_{nullptr};
 
+  // coalescing window of flooding. Scheduled while the window is open, see
+  // floodPublication()
+  std::unique_ptr<folly::AsyncTimeout> coalesceTimer_{nullptr};
+
+  // current length of the coalescing window
+  std::chrono::milliseconds coalesceWindow_{0};
+
+  // whether the open coalescing window merged any publication
+  bool coalesceWindowBusy_{false};
+
+  // publications and keys merged since the last coalesced flood
+  size_t numCoalescedPubs_{0};
+  size_t numCoalescedKeys_{0};
+
+  // timer to send dual messages queued within one event loop iteration
+  std::unique_ptr<folly::AsyncTimeout> dualFlushTimer_{nullptr};
+
+  // merge local writes combined by setKeyValsCombined()
+  void flushCombinedKeyVals();
+
+  // local writes of the current event loop iteration, and the promises of
+  // their writers
+  thrift::KeySetParams combinedKeySetParams_;
+  std::vector<folly::Promise<folly::Unit>> combinedKeySetPromises_;
+
+  // timer to merge local writes combined within one event loop iteration
+  std::unique_ptr<folly::AsyncTimeout> combinedKeyValsTimer_{nullptr};
+
   // timer for requesting full-sync
   std::unique_ptr<folly::AsyncTimeout> requestSyncTimer_{nullptr};
 
   // timer to promote idle peers for initial syncing
   std::unique_ptr<folly::AsyncTimeout> thriftSyncTimer_{nullptr};
 
+  // timer to write snapshots, if enabled
+  std::unique_ptr<folly::AsyncTimeout> snapshotTimer_{nullptr};
+
+  // whether the snapshot was loaded. Snapshots are only written afterwards,
+  // not to replace the one from before a restart by an empty store
+  bool snapshotLoaded_{false};
+
   // pending keys to flood publication
   // map<flood-root-id: set<keys>>
   std::
       unordered_map<std::optional<std::string>, std::unordered_set<std::string>>
           publicationBuffer_{};
 
+  // publications flooded on the SPT of each flood-root
+  std::unordered_map<std::string, int64_t> floodRootPublications_;
+
   // [TO BE DEPRECATED]
   // max parallel syncs allowed. It's initialized with '2' and doubles
   // up to a max value of kMaxFullSyncPendingCountThresholdfor each full sync
@@ -523,7 +1164,8 @@ class KvStoreDb : public DualNode {
   size_t parallelSyncLimit_{2};
 
   // thrift version of "parallelSyncLimit_"
-  size_t parallelSyncLimitOverThrift_{2};
+  size_t parallelSyncLimitOverThrift_{
+      Constants::kMinFullSyncPendingCountThreshold};
 
   // event loop
   OpenrEventBase* evb_{nullptr};
@@ -556,16 +1198,62 @@ class KvStore final : public OpenrEventBase {
 
   ~KvStore() override = default;
 
+  // override run() method of OpenrEventBase, starts per area event bases
+  void run() override;
+
   // override stop() method of OpenrEventBase
   void stop() override;
 
   // process the key-values publication, and attempt to
   // merge it in existing map (first argument)
   // Return a publication made out of the updated values
+  // If bucketHashes or keyIndex are set, they are kept in sync with kvStore
+  // If createPatches is set, updated values replacing an older version carry
+  // a patch against it when that is worthwhile, see createValuePatch()
+  // Instantiated for KvStoreMap and thrift::KeyVals
+  template <typename KvStoreMapT>
   static std::unordered_map<std::string, thrift::Value> mergeKeyValues(
-      std::unordered_map<std::string, thrift::Value>& kvStore,
+      KvStoreMapT& kvStore,
       std::unordered_map<std::string, thrift::Value> const& update,
-      std::optional<KvStoreFilters> const& filters = std::nullopt);
+      std::optional<KvStoreFilters> const& filters = std::nullopt,
+      KvStoreBucketHashes* bucketHashes = nullptr,
+      bool createPatches = false,
+      KvStoreKeyIndex* keyIndex = nullptr);
+
+  // patch turning data of base into data of value. std::nullopt unless both
+  // have data and hash, and the patch is less than half the size of the data
+  static std::optional<thrift::ValuePatch> createValuePatch(
+      thrift::Value const& base, thrift::Value const& value);
+
+  // rebuild data of patched value from base. Returns false, leaving value
+  // untouched, if base is not the version the patch applies to or the
+  // result doesn't match the hash of value
+  static bool applyValuePatch(thrift::Value const& base, thrift::Value& value);
+
+  // replace data of value by its compressed version, setting the hash if
+  // missing, if it has at least kKvStoreCompressValueMinSize bytes and
+  // compresses well. Returns whether value is compressed
+  static bool compressValue(thrift::Value& value);
+
+  // restore data of compressed value. Returns false, leaving value
+  // untouched, if the data can't be decompressed or doesn't match the hash
+  static bool decompressValue(thrift::Value& value);
+
+  // merge flooding params into the params queued before them for the same
+  // peer. Returns false, leaving queued untouched, if they can't be sent as
+  // one: different flooding path, traced, or a key whose new value doesn't
+  // supersede the queued one on its own (patch, or ttl refresh of another
+  // version)
+  static bool mergeFloodParams(
+      thrift::KeySetParams& queued, thrift::KeySetParams const& params);
+
+  // content of a snapshot file: marker, checksum and serialized snapshot
+  static std::string encodeSnapshot(thrift::KvStoreSnapshot const& snapshot);
+
+  // snapshot from the content of a snapshot file. std::nullopt if the
+  // content is not a snapshot or is corrupted
+  static std::optional<thrift::KvStoreSnapshot> decodeSnapshot(
+      std::string const& data);
 
   // compare two thrift::Values to figure out which value is better to
   // use, it will compare following attributes in order
@@ -585,6 +1273,14 @@ class KvStore final : public OpenrEventBase {
   folly::SemiFuture<folly::Unit> setKvStoreKeyVals(
       std::string area, thrift::KeySetParams keySetParams);
 
+  // stream floods to peerName in area over publisher, see
+  // OpenrCtrlCpp.subscribeKvStorePeerFlood. Publisher is completed with an
+  // error if the area is unknown
+  void addKvStoreFloodStream(
+      std::string area,
+      std::string peerName,
+      KvStoreFloodStreamPublisher publisher);
+
   // return publication for each area in selectAreas or all areas if select
   // areas is empty
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::Publication>>>
@@ -592,6 +1288,13 @@ class KvStore final : public OpenrEventBase {
       thrift::KeyDumpParams keyDumpParams,
       std::set<std::string> selectAreas = {});
 
+  // return one page of key-values of area, see thrift::PageParams
+  folly::SemiFuture<std::unique_ptr<thrift::KvStoreKeyValsPage>>
+  dumpKvStoreKeysPage(
+      std::string area,
+      thrift::KeyDumpParams keyDumpParams,
+      thrift::PageParams page);
+
   folly::SemiFuture<std::unique_ptr<thrift::Publication>> dumpKvStoreHashes(
       std::string area, thrift::KeyDumpParams keyDumpParams);
 
@@ -601,6 +1304,10 @@ class KvStore final : public OpenrEventBase {
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::KvStoreAreaSummary>>>
   getKvStoreAreaSummaryInternal(std::set<std::string> selectAreas = {});
 
+  // Generation of the summaries of all areas, see
+  // KvStoreDb::getSummaryGeneration()
+  int64_t getKvStoreSummaryGeneration() const;
+
   folly::SemiFuture<folly::Unit> addUpdateKvStorePeers(
       std::string area, thrift::PeersMap peersToAdd);
 
@@ -621,6 +1328,12 @@ class KvStore final : public OpenrEventBase {
   // API to get reader for kvStoreUpdatesQueue
   messaging::RQueue<thrift::Publication> getKvStoreUpdatesReader();
 
+  // index dispatching updates to KvStoreClientInternal instances
+  KvStoreClientIndex&
+  getClientIndex() {
+    return kvParams_.clientIndex;
+  }
+
   // API to fetch state of peerNode, used for unit-testing
   folly::SemiFuture<std::optional<thrift::KvStorePeerState>>
   getKvStorePeerState(std::string const& area, std::string const& peerName);
@@ -648,7 +1361,19 @@ class KvStore final : public OpenrEventBase {
 
   void processPeerUpdates(PeerEvent&& event);
 
-  std::map<std::string, int64_t> getGlobalCounters() const;
+  // sum of counters of all areas
+  static std::map<std::string, int64_t> mergeCounters(
+      std::vector<std::map<std::string, int64_t>> const& areaCounters);
+
+  // event base of the KvStoreDb for areaId. This is the KvStore event base
+  // unless enable_per_area_event_base is set. Falls back to it for unknown
+  // areas, getAreaDbOrThrow() deals with those
+  OpenrEventBase& getAreaEvb(std::string const& areaId);
+
+  // run callback in the event base thread of area, see getAreaEvb(). All
+  // access to a KvStoreDb must go through this
+  void runInAreaEventBaseThread(
+      std::string const& areaId, folly::EventBase::Func callback);
 
   // helper for public semifuture API. Returns a reference to the relevant
   // KvStoreDb (to be captured and operated on in this event loop) or throws an
@@ -669,7 +1394,14 @@ class KvStore final : public OpenrEventBase {
   // kvstore parameters common to all kvstoreDB
   KvStoreParams kvParams_;
 
-  // map of area IDs and instance of KvStoreDb
+  // event base and its thread per area if enable_per_area_event_base is set.
+  // Must outlive kvStoreDb_
+  std::unordered_map<std::string /* area ID */, std::unique_ptr<OpenrEventBase>>
+      areaEvbs_{};
+  std::vector<std::thread> areaEvbThreads_{};
+
+  // map of area IDs and instance of KvStoreDb. Only modified in the
+  // constructor and stop(), so it can be looked up from any thread
   std::unordered_map<std::string /* area ID */, KvStoreDb> kvStoreDb_{};
 
   // the serializer/deserializer helper we'll be using
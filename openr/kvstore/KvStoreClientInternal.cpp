@@ -14,6 +14,18 @@ namespace fb303 = facebook::fb303;
 
 namespace openr {
 
+namespace {
+
+// TTL updates of a key are sent up to this early, to go along with the ones
+// of other keys
+std::chrono::milliseconds
+getTtlRefreshEpoch(int64_t ttl) {
+  return std::min(
+      Constants::kTtlRefreshEpoch, std::chrono::milliseconds(ttl / 8));
+}
+
+} // namespace
+
 KvStoreClientInternal::KvStoreClientInternal(
     OpenrEventBase* eventBase,
     std::string const& nodeId,
@@ -30,10 +42,12 @@ KvStoreClientInternal::KvStoreClientInternal(
   CHECK(not nodeId.empty());
   CHECK(kvStore_);
 
-  // Fiber to process thrift::Publication from KvStore
+  // Fiber to process thrift::Publication from KvStore. Only the updates of
+  // keys this client is interested in are delivered
+  auto [clientId, reader] = kvStore_->getClientIndex().addClient();
+  clientId_ = clientId;
   taskFuture_ = eventBase_->addFiberTaskFuture(
-      [q = std::move(kvStore_->getKvStoreUpdatesReader()),
-       this]() mutable noexcept {
+      [q = std::move(reader), this]() mutable noexcept {
         LOG(INFO) << "Starting KvStore updates processing fiber";
         while (true) {
           auto maybePublication = q.get(); // perform read
@@ -222,9 +236,106 @@ KvStoreClientInternal::persistKey(
   std::unordered_map<AreaId, std::unordered_set<std::string>>
       pendingKeysToAdvertise{};
 
-  auto& persistedKeyVals = persistedKeyVals_[area];
+  // Key is first-time persisted: retrieve it from `KvStore`
+  std::unordered_map<std::string, thrift::Value> kvStoreKeyVals;
+  if (not persistedKeyVals_[area].count(key)) {
+    if (auto maybeValue = getKey(area, key)) {
+      kvStoreKeyVals.emplace(key, std::move(maybeValue).value());
+    }
+  }
+
+  const auto hasTtlChanged = persistKeyImpl(
+      area,
+      key,
+      val,
+      ttl,
+      kvStoreKeyVals,
+      useThrottle_ ? keysToAdvertise_[area] : pendingKeysToAdvertise[area]);
+  if (not hasTtlChanged.has_value()) {
+    return false;
+  }
+
+  if (useThrottle_) {
+    // Throttled fashion to advertise pending keys
+    advertisePendingKeysThrottled_->operator()();
+  } else {
+    // ONLY advertise this key. Will NOT advertise any throttled keys
+    advertisePendingKeys(pendingKeysToAdvertise);
+  }
+
+  scheduleTtlUpdates(area, key, *hasTtlChanged);
+  return true;
+}
+
+size_t
+KvStoreClientInternal::persistKeys(
+    AreaId const& area,
+    std::vector<std::pair<std::string, std::string>> const& keyVals,
+    std::chrono::milliseconds const ttl) {
+  CHECK(eventBase_->getEvb()->isInEventBaseThread());
+
+  VLOG(3) << "KvStoreClientInternal: persistKeys called for "
+          << keyVals.size() << " keys, area:" << area.t;
+
+  // local variable to hold pending keys to advertise
+  std::unordered_map<AreaId, std::unordered_set<std::string>>
+      pendingKeysToAdvertise{};
+
+  // Keys first-time persisted: retrieve them from `KvStore` at once
+  std::unordered_map<std::string, thrift::Value> kvStoreKeyVals;
+  thrift::KeyGetParams params;
+  const auto& persistedKeyVals = persistedKeyVals_[area];
+  for (auto const& [key, _] : keyVals) {
+    if (not persistedKeyVals.count(key)) {
+      params.keys_ref()->emplace_back(key);
+    }
+  }
+  if (not params.keys_ref()->empty()) {
+    try {
+      auto pub = kvStore_->getKvStoreKeyVals(area, params).get();
+      kvStoreKeyVals = std::move(*pub->keyVals_ref());
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Failed to get keyvals from kvstore. Exception: "
+                 << ex.what();
+    }
+  }
+
   auto& keysToAdvertise =
       useThrottle_ ? keysToAdvertise_[area] : pendingKeysToAdvertise[area];
+  std::vector<std::pair<std::string, bool /* hasTtlChanged */>> changedKeys;
+  for (auto const& [key, val] : keyVals) {
+    if (auto hasTtlChanged = persistKeyImpl(
+            area, key, val, ttl, kvStoreKeyVals, keysToAdvertise)) {
+      changedKeys.emplace_back(key, *hasTtlChanged);
+    }
+  }
+  if (changedKeys.empty()) {
+    return 0;
+  }
+
+  if (useThrottle_) {
+    // Throttled fashion to advertise pending keys
+    advertisePendingKeysThrottled_->operator()();
+  } else {
+    // ONLY advertise these keys. Will NOT advertise any throttled keys
+    advertisePendingKeys(pendingKeysToAdvertise);
+  }
+
+  for (auto const& [key, hasTtlChanged] : changedKeys) {
+    scheduleTtlUpdates(area, key, hasTtlChanged);
+  }
+  return changedKeys.size();
+}
+
+std::optional<bool>
+KvStoreClientInternal::persistKeyImpl(
+    AreaId const& area,
+    std::string const& key,
+    std::string const& val,
+    std::chrono::milliseconds const ttl,
+    std::unordered_map<std::string, thrift::Value> const& kvStoreKeyVals,
+    std::unordered_set<std::string>& keysToAdvertise) {
+  auto& persistedKeyVals = persistedKeyVals_[area];
   auto& callbacks = keyCallbacks_[area];
 
   // Look it up in local cached storage
@@ -241,17 +352,18 @@ KvStoreClientInternal::persistKey(
   //  1) Key has been persisted before:
   //     Retrieve it from local cached storage;
   //  2) Key is first-time persisted:
-  //     Retrieve it from `KvStore` via `getKey()` API;
+  //     Retrieve it from `KvStore` values fetched by the caller;
   //      <1> Key is found in `KvStore`, use it;
   //      <2> Key is NOT found in `KvStore` (ATTN:
   //          new key advertisement)
   if (keyIt == persistedKeyVals.end()) {
-    // Get latest value from KvStore
-    if (auto maybeValue = getKey(area, key)) {
-      thriftValue = maybeValue.value();
+    auto kvStoreIt = kvStoreKeyVals.find(key);
+    if (kvStoreIt != kvStoreKeyVals.end()) {
+      thriftValue = kvStoreIt->second;
       // TTL update pub is never saved in kvstore
       DCHECK(thriftValue.value_ref());
     } else {
+      VLOG(2) << "Key: " << key << " NOT found in kvstore. Area: " << area.t;
       thriftValue.version_ref() = 1;
       shouldAdvertise = true;
     }
@@ -260,7 +372,7 @@ KvStoreClientInternal::persistKey(
     if (*thriftValue.value_ref() == val and
         *thriftValue.ttl_ref() == ttl.count()) {
       // this is a no op, return early and change no state
-      return false;
+      return std::nullopt;
     }
 
     const auto& keyTtlBackoffs = keyTtlBackoffs_[area];
@@ -291,6 +403,7 @@ KvStoreClientInternal::persistKey(
 
   // Cache it in persistedKeyVals_. Override the existing one
   persistedKeyVals[key] = thriftValue;
+  updateKeyInterest(key);
 
   // Override existing backoff as well
   backoffs_[area][key] = ExponentialBackoff<std::chrono::milliseconds>(
@@ -307,23 +420,20 @@ KvStoreClientInternal::persistKey(
     keysToAdvertise.insert(key);
   }
 
-  if (useThrottle_) {
-    // Throttled fashion to advertise pending keys
-    advertisePendingKeysThrottled_->operator()();
-  } else {
-    // ONLY advertise this key. Will NOT advertise any throttled keys
-    advertisePendingKeys(pendingKeysToAdvertise);
-  }
+  return hasTtlChanged;
+}
 
+void
+KvStoreClientInternal::scheduleTtlUpdates(
+    AreaId const& area, std::string const& key, bool advertiseImmediately) {
+  const auto& thriftValue = persistedKeyVals_[area].at(key);
   scheduleTtlUpdates(
       area,
       key,
       *thriftValue.version_ref(),
       *thriftValue.ttlVersion_ref(),
-      ttl.count(),
-      hasTtlChanged);
-
-  return true;
+      *thriftValue.ttl_ref(),
+      advertiseImmediately);
 }
 
 thrift::Value
@@ -399,6 +509,7 @@ KvStoreClientInternal::scheduleTtlUpdates(
   if (ttl == Constants::kTtlInfinity) {
     // in case ttl is finite before
     keyTtlBackoffs.erase(key);
+    updateKeyInterest(key);
     return;
   }
 
@@ -418,6 +529,7 @@ KvStoreClientInternal::scheduleTtlUpdates(
       ExponentialBackoff<std::chrono::milliseconds>(
           std::chrono::milliseconds(ttl / 4),
           std::chrono::milliseconds(ttl / 4 + 1)));
+  updateKeyInterest(key);
 
   // Delay first ttl advertisement by (ttl / 4). We have just advertised key or
   // update and would like to avoid sending unncessary immediate ttl update
@@ -440,6 +552,7 @@ KvStoreClientInternal::unsetKey(AreaId const& area, std::string const& key) {
   backoffs_[area].erase(key);
   keyTtlBackoffs_[area].erase(key);
   keysToAdvertise_[area].erase(key);
+  updateKeyInterest(key);
 }
 
 void
@@ -595,6 +708,7 @@ KvStoreClientInternal::subscribeKey(
 
   VLOG(3) << "KvStoreClientInternal: subscribeKey called for key " << key;
   keyCallbacks_[area][key] = std::move(callback);
+  updateKeyInterest(key);
 
   return fetchKeyValue ? getKey(area, key) : std::nullopt;
 }
@@ -604,6 +718,10 @@ KvStoreClientInternal::subscribeKeyFilter(
     KvStoreFilters kvFilters, KeyCallback callback) {
   CHECK(eventBase_->getEvb()->isInEventBaseThread());
 
+  kvStore_->getClientIndex().setFilter(
+      clientId_,
+      KvStoreFilters(
+          kvFilters.getKeyPrefixes(), kvFilters.getOriginatorIdList()));
   keyPrefixFilter_ = std::move(kvFilters);
   keyPrefixFilterCallback_ = std::move(callback);
   return;
@@ -615,6 +733,7 @@ KvStoreClientInternal::unsubscribeKeyFilter() {
 
   keyPrefixFilterCallback_ = nullptr;
   keyPrefixFilter_ = KvStoreFilters({}, {});
+  kvStore_->getClientIndex().setFilter(clientId_, std::nullopt);
   return;
 }
 
@@ -628,6 +747,26 @@ KvStoreClientInternal::unsubscribeKey(
   if (keyCallbacks_[area].erase(key) == 0) {
     LOG(WARNING) << "UnsubscribeKey called for non-existing key" << key;
   }
+  updateKeyInterest(key);
+}
+
+void
+KvStoreClientInternal::updateKeyInterest(std::string const& key) {
+  auto isInterested = [&key](auto const& areaMaps) {
+    for (auto const& [_, keys] : areaMaps) {
+      if (keys.count(key)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  auto& clientIndex = kvStore_->getClientIndex();
+  if (isInterested(persistedKeyVals_) or isInterested(keyTtlBackoffs_) or
+      isInterested(keyCallbacks_)) {
+    clientIndex.addKey(clientId_, key);
+  } else {
+    clientIndex.removeKey(clientId_, key);
+  }
 }
 
 void
@@ -678,6 +817,7 @@ KvStoreClientInternal::processPublication(
            *rcvdValue.originatorId_ref() > *setValue.originatorId_ref())) {
         // key lost, cancel TTL update
         keyTtlBackoffs.erase(sk);
+        updateKeyInterest(key);
       } else if (
           *rcvdValue.version_ref() == *setValue.version_ref() and
           *rcvdValue.originatorId_ref() == *setValue.originatorId_ref() and
@@ -855,16 +995,22 @@ void
 KvStoreClientInternal::advertiseTtlUpdates() {
   // Build set of keys to advertise ttl updates
   auto timeout = Constants::kMaxTtlUpdateInterval;
+  // shortest epoch among keys, next epoch starts within it
+  auto epoch = Constants::kTtlRefreshEpoch;
 
   // advertise TTL updates for each area
   for (auto& [area, keyTtlBackoffs] : keyTtlBackoffs_) {
     std::unordered_map<std::string, thrift::Value> keyVals;
     auto& persistedKeyVals = persistedKeyVals_[area];
+    const auto keysToAdvertiseIt = keysToAdvertise_.find(area);
 
     for (auto& [key, val] : keyTtlBackoffs) {
       auto& thriftValue = val.first;
       auto& backoff = val.second;
-      if (not backoff.canTryNow()) {
+      const auto keyEpoch = getTtlRefreshEpoch(*thriftValue.ttl_ref());
+      epoch = std::min(epoch, keyEpoch);
+      // TTL updates due within the epoch go out with this one
+      if (backoff.getTimeRemainingUntilRetry() > keyEpoch) {
         VLOG(2) << "Skipping key: " << key << ", area: " << area.t;
         timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
         continue;
@@ -874,6 +1020,14 @@ KvStoreClientInternal::advertiseTtlUpdates() {
       backoff.reportError();
       timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
 
+      // pending value update of the key refreshes its TTL as well
+      if (keysToAdvertiseIt != keysToAdvertise_.end() and
+          keysToAdvertiseIt->second.count(key)) {
+        VLOG(2) << "Skipping ttl update of key: " << key
+                << " with pending update, area: " << area.t;
+        continue;
+      }
+
       const auto it = persistedKeyVals.find(key);
       if (it != persistedKeyVals.end()) {
         // we may have got a newer vesion for persisted key
@@ -905,6 +1059,19 @@ KvStoreClientInternal::advertiseTtlUpdates() {
     }
   }
 
+  // Align the next run to a grid of half epochs, at or before the earliest
+  // TTL update. It goes out along with the others due within half an epoch
+  // after it at least
+  const auto grid = epoch / 2;
+  if (timeout < Constants::kMaxTtlUpdateInterval and grid.count() > 0) {
+    const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    const auto phase = std::chrono::milliseconds(
+        static_cast<int64_t>(ttlRefreshPhase_ * grid.count()));
+    const auto runAt = (now + timeout - phase) / grid * grid + phase;
+    timeout = std::max(runAt - now, std::chrono::milliseconds(0));
+  }
+
   // Schedule next-timeout for processing/clearing backoffs
   VLOG(2) << "Scheduling ttl timer after " << timeout.count() << "ms.";
   ttlTimer_->scheduleTimeout(timeout);
@@ -13,6 +13,7 @@
 
 #include <folly/Function.h>
 #include <folly/Optional.h>
+#include <folly/Random.h>
 #include <folly/SocketAddress.h>
 
 #include <openr/common/AsyncThrottle.h>
@@ -80,6 +81,18 @@ class KvStoreClientInternal {
       std::string const& value,
       std::chrono::milliseconds const ttl = Constants::kTtlInfInterval);
 
+  /**
+   * Batched flavour of persistKey() for many keys of one area. Keys persisted
+   * for the first time are looked up in KvStore with a single request, and
+   * changed keys are advertised together.
+   *
+   * returns number of keys whose state changed for this client
+   */
+  size_t persistKeys(
+      AreaId const& area,
+      std::vector<std::pair<std::string, std::string>> const& keyVals,
+      std::chrono::milliseconds const ttl = Constants::kTtlInfInterval);
+
   /**
    * Advertise the key-value into KvStore with specified version. If version is
    * not specified than the one greater than the latest known will be used.
@@ -218,6 +231,29 @@ class KvStoreClientInternal {
    */
   void processExpiredKeys(thrift::Publication const& publication);
 
+  /**
+   * Register key in KvStore's client index if this client persists, sets or
+   * subscribed to it in any area, remove it otherwise
+   */
+  void updateKeyInterest(std::string const& key);
+
+  /**
+   * Common part of persistKey() and persistKeys(). Updates the persisted
+   * value of key and adds it to `keysToAdvertise` if it must be advertised.
+   * `kvStoreKeyVals` holds the latest values in KvStore of keys persisted
+   * for the first time.
+   *
+   * returns std::nullopt if key state is unchanged, otherwise whether its ttl
+   * changed, for the caller to schedule TTL updates once keys are advertised
+   */
+  std::optional<bool> persistKeyImpl(
+      AreaId const& area,
+      std::string const& key,
+      std::string const& val,
+      std::chrono::milliseconds const ttl,
+      std::unordered_map<std::string, thrift::Value> const& kvStoreKeyVals,
+      std::unordered_set<std::string>& keysToAdvertise);
+
   /*
    * Utility function to build thrift::Value in KvStoreClientInternal
    * This method will:
@@ -256,6 +292,12 @@ class KvStoreClientInternal {
    */
   void clearPendingKeys();
 
+  /**
+   * Helper function to schedule TTL update advertisement of a persisted key
+   */
+  void scheduleTtlUpdates(
+      AreaId const& area, std::string const& key, bool advertiseImmediately);
+
   /**
    * Helper function to schedule TTL update advertisement
    */
@@ -268,7 +310,10 @@ class KvStoreClientInternal {
       bool advertiseImmediately);
 
   /**
-   * Helper function to advertise TTL update
+   * Helper function to advertise TTL update. TTL updates due within the
+   * current epoch are sent together, in one request per area. Epochs are
+   * aligned to a grid with a random phase per client, so that clients started
+   * together don't refresh in lockstep.
    */
   void advertiseTtlUpdates();
 
@@ -364,12 +409,19 @@ class KvStoreClientInternal {
   // Timer to advertise ttl updates for key-vals
   std::unique_ptr<folly::AsyncTimeout> ttlTimer_;
 
+  // phase of the TTL update epochs, as a fraction of the epoch length
+  const double ttlRefreshPhase_{folly::Random::randDouble01()};
+
   // Timer to periodically advertise counters
   std::unique_ptr<folly::AsyncTimeout> counterUpdateTimer_;
 
   // prefix key filter to apply for key updates
   KvStoreFilters keyPrefixFilter_{{}, {}};
 
+  // id in the KvStore index delivering this client the updates of the keys
+  // it is interested in
+  KvStoreClientIndex::ClientId clientId_{0};
+
   // fiber task future hold
   folly::Future<folly::Unit> taskFuture_;
 };
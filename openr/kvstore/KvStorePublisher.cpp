@@ -9,20 +9,72 @@
 
 #include <re2/re2.h>
 
+#include <fmt/format.h>
 #include <folly/ExceptionString.h>
+#include <folly/String.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/ssl/OpenSSLUtils.h>
 #include <openr/common/Constants.h>
 #include <openr/common/Util.h>
 #include <openr/kvstore/KvStore.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 namespace openr {
 
+void
+PublicationCoalescer::add(thrift::Publication&& pub) {
+  auto& updates = areaUpdates_[*pub.area_ref()];
+  for (auto& [key, value] : *pub.keyVals_ref()) {
+    updates.expiredKeys.erase(key);
+    auto it = updates.keyVals.find(key);
+    if (it != updates.keyVals.end() and it->second.value_ref().has_value() and
+        not value.value_ref().has_value() and
+        *it->second.version_ref() == *value.version_ref()) {
+      // TTL update of a value not sent yet
+      it->second.ttl_ref() = *value.ttl_ref();
+      it->second.ttlVersion_ref() = *value.ttlVersion_ref();
+      continue;
+    }
+    updates.keyVals.insert_or_assign(key, std::move(value));
+  }
+  for (auto& key : *pub.expiredKeys_ref()) {
+    updates.keyVals.erase(key);
+    updates.expiredKeys.emplace(std::move(key));
+  }
+}
+
+size_t
+PublicationCoalescer::size() const {
+  size_t size{0};
+  for (auto const& [_, updates] : areaUpdates_) {
+    size += updates.keyVals.size() + updates.expiredKeys.size();
+  }
+  return size;
+}
+
+std::vector<thrift::Publication>
+PublicationCoalescer::release() {
+  std::vector<thrift::Publication> pubs;
+  for (auto& [area, updates] : areaUpdates_) {
+    if (updates.keyVals.empty() and updates.expiredKeys.empty()) {
+      continue;
+    }
+    thrift::Publication pub;
+    pub.area_ref() = area;
+    pub.keyVals_ref() = std::move(updates.keyVals);
+    pub.expiredKeys_ref()->assign(
+        updates.expiredKeys.begin(), updates.expiredKeys.end());
+    pubs.emplace_back(std::move(pub));
+  }
+  areaUpdates_.clear();
+  return pubs;
+}
+
 KvStorePublisher::KvStorePublisher(
     std::set<std::string> const& selectAreas,
     thrift::KeyDumpParams filter,
-    apache::thrift::ServerStreamPublisher<thrift::Publication>&& publisher)
+    KvStoreStreamPublisher&& publisher)
     : selectAreas_(selectAreas),
       filter_(filter),
       publisher_(std::move(publisher)) {
@@ -36,6 +88,11 @@ KvStorePublisher::KvStorePublisher(
 
   keyPrefixFilter_ =
       KvStoreFilters(keyPrefix, std::move(*filter.originatorIds_ref()));
+
+  filterKey_ = fmt::format(
+      "{}|{}",
+      folly::join(",", selectAreas_),
+      apache::thrift::CompactSerializer::serialize<std::string>(filter_));
 }
 
 /**
@@ -54,8 +111,21 @@ KvStorePublisher::KvStorePublisher(
  */
 void
 KvStorePublisher::publish(const thrift::Publication& pub) {
+  if (auto filteredPub = filter(pub)) {
+    publishFiltered(std::move(filteredPub).value());
+  }
+}
+
+void
+KvStorePublisher::publishFiltered(thrift::Publication&& pub) {
+  pub.timestamp_ms_ref() = getUnixTimeStampMs();
+  publisher_.next(std::move(pub));
+}
+
+std::optional<thrift::Publication>
+KvStorePublisher::filter(const thrift::Publication& pub) const {
   if (not(selectAreas_.empty() || selectAreas_.count(pub.get_area()))) {
-    return;
+    return std::nullopt;
   }
   if ((not filter_.keys_ref().has_value() or (*filter_.keys_ref()).empty()) and
       (not filter_.originatorIds_ref().is_set() or
@@ -64,10 +134,7 @@ KvStorePublisher::publish(const thrift::Publication& pub) {
     // No filtering criteria. Accept all updates as TTL updates are not be
     // to be updated. If we don't optimize here, we will have go through
     // key values of a publication and copy them.
-    auto filteredPub = std::make_unique<thrift::Publication>(pub);
-    filteredPub->timestamp_ms_ref() = getUnixTimeStampMs();
-    publisher_.next(std::move(*filteredPub));
-    return;
+    return pub;
   }
 
   thrift::Publication publication_filtered;
@@ -115,11 +182,103 @@ KvStorePublisher::publish(const thrift::Publication& pub) {
     }
   }
 
-  if (keyvals.size()) {
-    // There is at least one key value in the publication for the client
-    publication_filtered.keyVals_ref() = keyvals;
-    publication_filtered.timestamp_ms_ref() = getUnixTimeStampMs();
-    publisher_.next(std::move(publication_filtered));
+  if (keyvals.empty()) {
+    return std::nullopt;
+  }
+  // There is at least one key value in the publication for the client
+  publication_filtered.keyVals_ref() = std::move(keyvals);
+  return publication_filtered;
+}
+
+void
+KvStorePublisherIndex::add(
+    int64_t token, std::unique_ptr<KvStorePublisher> publisher) {
+  auto const& filterKey = publisher->getFilterKey();
+  if (publisher->getSelectAreas().empty()) {
+    allAreasFilterKeys_.emplace(filterKey);
+  }
+  for (auto const& area : publisher->getSelectAreas()) {
+    areaToFilterKeys_[area].emplace(filterKey);
+  }
+  tokenToFilterKey_.emplace(token, filterKey);
+  groups_[filterKey].emplace(token, std::move(publisher));
+}
+
+bool
+KvStorePublisherIndex::remove(int64_t token) {
+  auto tokenIt = tokenToFilterKey_.find(token);
+  if (tokenIt == tokenToFilterKey_.end()) {
+    return false;
+  }
+  auto const filterKey = std::move(tokenIt->second);
+  tokenToFilterKey_.erase(tokenIt);
+
+  auto groupIt = groups_.find(filterKey);
+  CHECK(groupIt != groups_.end());
+  auto& group = groupIt->second;
+  auto publisherIt = group.find(token);
+  CHECK(publisherIt != group.end());
+  const auto selectAreas = publisherIt->second->getSelectAreas();
+  group.erase(publisherIt);
+  if (not group.empty()) {
+    return true;
+  }
+
+  // last publisher of the group, drop it from the index
+  groups_.erase(groupIt);
+  allAreasFilterKeys_.erase(filterKey);
+  for (auto const& area : selectAreas) {
+    auto areaIt = areaToFilterKeys_.find(area);
+    CHECK(areaIt != areaToFilterKeys_.end());
+    areaIt->second.erase(filterKey);
+    if (areaIt->second.empty()) {
+      areaToFilterKeys_.erase(areaIt);
+    }
+  }
+  return true;
+}
+
+void
+KvStorePublisherIndex::publish(const thrift::Publication& pub) {
+  auto areaIt = areaToFilterKeys_.find(pub.get_area());
+  if (areaIt != areaToFilterKeys_.end()) {
+    for (auto const& filterKey : areaIt->second) {
+      publishToGroup(groups_.at(filterKey), pub);
+    }
+  }
+  for (auto const& filterKey : allAreasFilterKeys_) {
+    publishToGroup(groups_.at(filterKey), pub);
+  }
+}
+
+void
+KvStorePublisherIndex::publishToGroup(
+    Group& group, const thrift::Publication& pub) {
+  CHECK(not group.empty());
+  auto filteredPub = group.begin()->second->filter(pub);
+  if (not filteredPub.has_value()) {
+    return;
+  }
+  // copy filtered publication for all but the last publisher
+  auto last = std::prev(group.end());
+  for (auto it = group.begin(); it != last; ++it) {
+    it->second->publishFiltered(thrift::Publication(*filteredPub));
+  }
+  last->second->publishFiltered(std::move(filteredPub).value());
+}
+
+std::vector<std::unique_ptr<KvStorePublisher>>
+KvStorePublisherIndex::releaseAll() {
+  std::vector<std::unique_ptr<KvStorePublisher>> publishers;
+  for (auto& groupIt : groups_) {
+    for (auto& [_, publisher] : groupIt.second) {
+      publishers.emplace_back(std::move(publisher));
+    }
   }
+  groups_.clear();
+  tokenToFilterKey_.clear();
+  areaToFilterKeys_.clear();
+  allAreasFilterKeys_.clear();
+  return publishers;
 }
 } // namespace openr
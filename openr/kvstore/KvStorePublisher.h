@@ -7,30 +7,88 @@
 
 #pragma once
 
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <openr/common/Types.h>
 #include <openr/config/Config.h>
+#include <openr/ctrl-server/StreamPublisher.h>
 #include <openr/if/gen-cpp2/OpenrCtrlCpp.h>
 #include <openr/if/gen-cpp2/Types_constants.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 #include <openr/kvstore/KvStore.h>
 
 namespace openr {
+
+/**
+ * Coalescer of KvStore publications, for lagging stream subscribers. Keeps
+ * latest value or expiry per key and area.
+ */
+class PublicationCoalescer {
+ public:
+  void add(thrift::Publication&& pub);
+
+  // number of coalesced keys
+  size_t size() const;
+
+  // one publication per area
+  std::vector<thrift::Publication> release();
+
+ private:
+  struct AreaUpdates {
+    thrift::KeyVals keyVals;
+    std::unordered_set<std::string> expiredKeys;
+  };
+
+  std::map<std::string, AreaUpdates> areaUpdates_;
+};
+
+using KvStoreStreamPublisher =
+    BufferedStreamPublisher<thrift::Publication, PublicationCoalescer>;
+
 class KvStorePublisher {
  public:
   KvStorePublisher(
       std::set<std::string> const& selectAreas,
       thrift::KeyDumpParams filter,
-      apache::thrift::ServerStreamPublisher<thrift::Publication>&& publisher);
+      KvStoreStreamPublisher&& publisher);
 
   ~KvStorePublisher() {}
 
   // Invoked whenever there is change. Apply filter and publish changes
   void publish(const thrift::Publication& pub);
 
+  // Apply filter. Return std::nullopt if nothing is to be published
+  std::optional<thrift::Publication> filter(
+      const thrift::Publication& pub) const;
+
+  // Publish a publication which went through filter() of this publisher, or
+  // of one with the same filter key
+  void publishFiltered(thrift::Publication&& pub);
+
+  // Publishers with equal filter keys publish the same updates
+  std::string const&
+  getFilterKey() const {
+    return filterKey_;
+  }
+
+  std::set<std::string> const&
+  getSelectAreas() const {
+    return selectAreas_;
+  }
+
   template <class... Args>
   void
   complete(Args&&... args) {
-    std::move(publisher_).complete(std::forward<Args>(args)...);
+    publisher_.complete(std::forward<Args>(args)...);
+  }
+
+  // updates not yet pulled by the subscriber
+  size_t
+  getLag() const {
+    return publisher_.getLag();
   }
 
  private:
@@ -38,6 +96,61 @@ class KvStorePublisher {
   std::set<std::string> selectAreas_;
   thrift::KeyDumpParams filter_;
   KvStoreFilters keyPrefixFilter_{{}, {}};
-  apache::thrift::ServerStreamPublisher<thrift::Publication> publisher_;
+  std::string filterKey_;
+  KvStoreStreamPublisher publisher_;
+};
+
+/**
+ * Dispatches KvStore publications to publishers of all subscribed streams.
+ * Publishers are indexed by area of interest and grouped by filter key. A
+ * publication is only seen by groups of its area, and is filtered once per
+ * group instead of once per subscriber. Monitoring clients subscribing with
+ * the same filter thus cost a filtering pass only for the first of them.
+ */
+class KvStorePublisherIndex {
+ public:
+  void add(int64_t token, std::unique_ptr<KvStorePublisher> publisher);
+
+  // Return false if stream `token` is unknown
+  bool remove(int64_t token);
+
+  bool
+  contains(int64_t token) const {
+    return tokenToFilterKey_.count(token) != 0;
+  }
+
+  // number of publishers
+  size_t
+  size() const {
+    return tokenToFilterKey_.size();
+  }
+
+  // number of distinct filter keys
+  size_t
+  getNumGroups() const {
+    return groups_.size();
+  }
+
+  void publish(const thrift::Publication& pub);
+
+  // Remove and return all publishers, e.g. to complete their streams
+  std::vector<std::unique_ptr<KvStorePublisher>> releaseAll();
+
+ private:
+  using Group = std::map<int64_t, std::unique_ptr<KvStorePublisher>>;
+
+  void publishToGroup(Group& group, const thrift::Publication& pub);
+
+  // filter key -> publishers
+  std::unordered_map<std::string, Group> groups_;
+
+  std::unordered_map<int64_t, std::string> tokenToFilterKey_;
+
+  // area -> filter keys of groups subscribed to it
+  std::unordered_map<std::string, std::unordered_set<std::string>>
+      areaToFilterKeys_;
+
+  // filter keys of groups subscribed to all areas
+  std::unordered_set<std::string> allAreasFilterKeys_;
 };
 } // namespace openr
@@ -19,9 +19,8 @@ parseThriftValue(thrift::Value const& value) {
 
   DCHECK(value.value_ref().has_value());
 
-  auto buf = folly::IOBuf::wrapBufferAsValue(
-      value.value_ref()->data(), value.value_ref()->size());
-  return readThriftObj<ThriftType>(buf, serializer);
+  return readThriftObj<ThriftType>(
+      folly::ByteRange(folly::StringPiece(*value.value_ref())), serializer);
 }
 
 // static
@@ -66,45 +65,22 @@ dumpAllWithPrefixMultipleAndParse(
   return std::make_pair(parseThriftValues<ThriftType>(*res), unreachableAddrs);
 }
 
-// static method to dump KvStore key-val over multiple instances
-std::pair<
-    std::optional<std::unordered_map<std::string /* key */, thrift::Value>>,
-    std::vector<folly::SocketAddress> /* unreachable addresses */>
-dumpAllWithThriftClientFromMultiple(
-    std::optional<AreaId> area,
-    const std::vector<folly::SocketAddress>& sockAddrs,
-    const std::string& keyPrefix,
+// static
+OpenrCtrlClientPool::ClientFactory
+getOpenrCtrlClientFactory(
+    folly::EventBase& evb,
     std::chrono::milliseconds connectTimeout,
     std::chrono::milliseconds processTimeout,
     const std::shared_ptr<folly::SSLContext> sslContext,
     std::optional<int> maybeIpTos /* std::nullopt */,
     const folly::SocketAddress&
         bindAddr /* folly::AsyncSocket::anyAddress()*/) {
-  folly::EventBase evb;
-  std::vector<folly::SemiFuture<thrift::Publication>> calls;
-  std::unordered_map<std::string, thrift::Value> merged;
-  std::vector<folly::SocketAddress> unreachableAddrs;
-
-  thrift::KeyDumpParams params;
-  *params.prefix_ref() = keyPrefix;
-  if (not keyPrefix.empty()) {
-    params.keys_ref() = {keyPrefix};
-  }
-
-  auto addrStrs =
-      folly::gen::from(sockAddrs) |
-      folly::gen::mapped([](const folly::SocketAddress& sockAddr) {
-        return folly::sformat(
-            "[{}, {}]", sockAddr.getAddressStr(), sockAddr.getPort());
-      }) |
-      folly::gen::as<std::vector<std::string>>();
-
-  VLOG(1) << "Dump kvStore key-vals from: " << folly::join(",", addrStrs)
-          << ". Required SSL secure connection: " << std::boolalpha
-          << (sslContext != nullptr);
-
-  auto startTime = std::chrono::steady_clock::now();
-  for (auto const& sockAddr : sockAddrs) {
+  return [&evb,
+          connectTimeout,
+          processTimeout,
+          sslContext,
+          maybeIpTos,
+          bindAddr](const folly::SocketAddress& sockAddr) {
     std::unique_ptr<thrift::OpenrCtrlCppAsyncClient> client{nullptr};
     if (sslContext) {
       VLOG(3) << "Try to connect Open/R SSL secure client.";
@@ -145,6 +121,69 @@ dumpAllWithThriftClientFromMultiple(
             << "via plain-text client. Exception: " << folly::exceptionStr(ex);
       }
     }
+    return client;
+  };
+}
+
+// static method to dump KvStore key-val over multiple instances
+std::pair<
+    std::optional<std::unordered_map<std::string /* key */, thrift::Value>>,
+    std::vector<folly::SocketAddress> /* unreachable addresses */>
+dumpAllWithThriftClientFromMultiple(
+    std::optional<AreaId> area,
+    const std::vector<folly::SocketAddress>& sockAddrs,
+    const std::string& keyPrefix,
+    std::chrono::milliseconds connectTimeout,
+    std::chrono::milliseconds processTimeout,
+    const std::shared_ptr<folly::SSLContext> sslContext,
+    std::optional<int> maybeIpTos /* std::nullopt */,
+    const folly::SocketAddress&
+        bindAddr /* folly::AsyncSocket::anyAddress()*/) {
+  folly::EventBase evb;
+  OpenrCtrlClientPool pool(getOpenrCtrlClientFactory(
+      evb, connectTimeout, processTimeout, sslContext, maybeIpTos, bindAddr));
+  VLOG(1) << "Required SSL secure connection: " << std::boolalpha
+          << (sslContext != nullptr);
+  return dumpAllWithThriftClientFromMultiple(
+      evb, pool, area, sockAddrs, keyPrefix);
+}
+
+// static method to dump KvStore key-val over multiple instances
+std::pair<
+    std::optional<std::unordered_map<std::string /* key */, thrift::Value>>,
+    std::vector<folly::SocketAddress> /* unreachable addresses */>
+dumpAllWithThriftClientFromMultiple(
+    folly::EventBase& evb,
+    OpenrCtrlClientPool& pool,
+    std::optional<AreaId> area,
+    const std::vector<folly::SocketAddress>& sockAddrs,
+    const std::string& keyPrefix) {
+  std::vector<folly::SemiFuture<thrift::Publication>> calls;
+  std::unordered_map<std::string, thrift::Value> merged;
+  std::vector<folly::SocketAddress> unreachableAddrs;
+  // keep clients alive until all calls completed
+  std::vector<std::shared_ptr<thrift::OpenrCtrlCppAsyncClient>> clients;
+  std::vector<folly::SocketAddress> calledAddrs;
+
+  thrift::KeyDumpParams params;
+  *params.prefix_ref() = keyPrefix;
+  if (not keyPrefix.empty()) {
+    params.keys_ref() = {keyPrefix};
+  }
+
+  auto addrStrs =
+      folly::gen::from(sockAddrs) |
+      folly::gen::mapped([](const folly::SocketAddress& sockAddr) {
+        return folly::sformat(
+            "[{}, {}]", sockAddr.getAddressStr(), sockAddr.getPort());
+      }) |
+      folly::gen::as<std::vector<std::string>>();
+
+  VLOG(1) << "Dump kvStore key-vals from: " << folly::join(",", addrStrs);
+
+  auto startTime = std::chrono::steady_clock::now();
+  for (auto const& sockAddr : sockAddrs) {
+    auto client = pool.getClient(sockAddr);
 
     // Cannot connect to Open/R via either plain-text client or secured client
     if (!client) {
@@ -158,6 +197,8 @@ dumpAllWithThriftClientFromMultiple(
     calls.emplace_back(
         area ? client->semifuture_getKvStoreKeyValsFilteredArea(params, *area)
              : client->semifuture_getKvStoreKeyValsFiltered(params));
+    clients.emplace_back(std::move(client));
+    calledAddrs.emplace_back(sockAddr);
   }
 
   // can't connect to ANY single Open/R instance
@@ -171,11 +212,14 @@ dumpAllWithThriftClientFromMultiple(
                 << " different Open/R instances.";
 
         // loop semifuture collection to merge all values
-        for (auto& result : results) {
+        for (size_t i = 0; i < results.size(); ++i) {
+          auto& result = results.at(i);
           // folly::Try will contain either value or exception
           if (result.hasException()) {
             LOG(ERROR) << "Exception: "
                        << folly::exceptionStr(result.exception());
+            // don't hand out client of a failed call again
+            pool.invalidate(calledAddrs.at(i));
           } else if (result.hasValue()) {
             auto keyVals = *result.value().keyVals_ref();
             const auto deltaPub = KvStore::mergeKeyValues(merged, keyVals);
@@ -9,6 +9,7 @@
 
 #include <folly/io/async/AsyncSocket.h>
 #include <openr/common/Constants.h>
+#include <openr/common/OpenrClient.h>
 #include <openr/common/Types.h>
 #include <openr/if/gen-cpp2/OpenrCtrlCppAsyncClient.h>
 #include <openr/if/gen-cpp2/Types_constants.h>
@@ -96,6 +97,34 @@ dumpAllWithThriftClientFromMultiple(
     std::optional<int> maybeIpTos = std::nullopt,
     const folly::SocketAddress& bindAddr = folly::AsyncSocket::anyAddress());
 
+/*
+ * Factory of OpenrCtrl clients for OpenrCtrlClientPool, connecting over SSL if
+ * sslContext is set, and over plain-text otherwise or if that fails. Clients
+ * are bound to evb. Parameters are as for dumpAllWithThriftClientFromMultiple
+ */
+static OpenrCtrlClientPool::ClientFactory getOpenrCtrlClientFactory(
+    folly::EventBase& evb,
+    std::chrono::milliseconds connectTimeout = Constants::kServiceConnTimeout,
+    std::chrono::milliseconds processTimeout = Constants::kServiceProcTimeout,
+    const std::shared_ptr<folly::SSLContext> sslContext = nullptr,
+    std::optional<int> maybeIpTos = std::nullopt,
+    const folly::SocketAddress& bindAddr = folly::AsyncSocket::anyAddress());
+
+/*
+ * Same as above with clients taken from pool, whose clients are bound to evb.
+ * Tools dumping repeatedly keep evb and pool across calls to reuse their
+ * connections. Clients of failed calls are dropped from the pool.
+ */
+static std::pair<
+    std::optional<std::unordered_map<std::string, thrift::Value>>,
+    std::vector<folly::SocketAddress> /* unreachable addresses */>
+dumpAllWithThriftClientFromMultiple(
+    folly::EventBase& evb,
+    OpenrCtrlClientPool& pool,
+    std::optional<AreaId> area,
+    const std::vector<folly::SocketAddress>& sockAddrs,
+    const std::string& prefix);
+
 } // namespace openr
 
 #include <openr/kvstore/KvStoreUtil-inl.h>
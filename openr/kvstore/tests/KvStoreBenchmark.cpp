@@ -6,7 +6,11 @@
  */
 
 #include <folly/Benchmark.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <new>
+#include <thread>
 #include <unordered_set>
 
 #include <fbzmq/zmq/Zmq.h>
@@ -20,8 +24,33 @@
 #include <openr/config/tests/Utils.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 #include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStorePublisher.h>
 #include <openr/kvstore/KvStoreWrapper.h>
 
+namespace {
+// number of heap allocations made by the process, see OperationStats
+std::atomic<uint64_t> numAllocations{0};
+} // namespace
+
+void*
+operator new(size_t size) {
+  numAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t /* size */) noexcept {
+  std::free(ptr);
+}
+
 namespace {
 
 // interval for periodic syncs
@@ -31,6 +60,14 @@ const std::chrono::seconds kDbSyncInterval(10000);
 const int kSizeOfKey = 32;
 // The byte size of a value
 const int kSizeOfValue = 1024;
+// Number of keys in store for footprint benchmarks
+const uint32_t kNumOfFootprintKeys = 1000000;
+// The byte size of a value for benchmarks with large stores
+const int kSizeOfSmallValue = 64;
+// Number of keys updated per operation of flood path benchmarks
+const uint32_t kNumOfFloodKeys = 100;
+// Number of keys set into kvStore per publication while filling it
+const uint32_t kNumOfKeysPerSet = 10000;
 
 /**
  * Produce a random string of given length - for value generation
@@ -48,6 +85,51 @@ genRandomStr(const int len) {
   }
   return s;
 }
+
+/**
+ * Latency and heap allocations of the operations timed by a benchmark,
+ * reported as p99_latency_us and allocs_per_op counters next to the time per
+ * iteration and iterations per second folly reports
+ */
+class OperationStats {
+ public:
+  explicit OperationStats(uint32_t iters) {
+    latencies_.reserve(iters);
+  }
+
+  void
+  start() {
+    startAllocations_ = numAllocations.load(std::memory_order_relaxed);
+    startTime_ = std::chrono::steady_clock::now();
+  }
+
+  void
+  stop() {
+    auto endTime = std::chrono::steady_clock::now();
+    allocations_ +=
+        numAllocations.load(std::memory_order_relaxed) - startAllocations_;
+    latencies_.emplace_back(endTime - startTime_);
+  }
+
+  void
+  report(folly::UserCounters& counters) const {
+    if (latencies_.empty()) {
+      return;
+    }
+    auto latencies = latencies_;
+    auto p99 = latencies.begin() + latencies.size() * 99 / 100;
+    std::nth_element(latencies.begin(), p99, latencies.end());
+    counters["p99_latency_us"] =
+        std::chrono::duration_cast<std::chrono::microseconds>(*p99).count();
+    counters["allocs_per_op"] = allocations_ / latencies_.size();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point startTime_;
+  uint64_t startAllocations_{0};
+  uint64_t allocations_{0};
+  std::vector<std::chrono::steady_clock::duration> latencies_;
+};
 } // namespace
 
 namespace openr {
@@ -104,7 +186,7 @@ void
 updateKvStore(
     const uint32_t numOfUpdateKeys,
     uint64_t& version,
-    std::unordered_map<std::string, thrift::Value>& kvStore) {
+    KvStoreMap& kvStore) {
   auto suspender = folly::BenchmarkSuspender();
   std::unordered_map<std::string, thrift::Value> update;
   // Randomly choose the start index of the keys to be updated
@@ -191,7 +273,7 @@ BM_KvStoreMergeKeyValues(
     uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
   CHECK_LE(numOfUpdateKeys, numOfKeysInStore);
   auto suspender = folly::BenchmarkSuspender();
-  std::unordered_map<std::string, thrift::Value> kvStore;
+  KvStoreMap kvStore;
 
   // Insert (key, value)s into kvStore
   uint64_t version = 1;
@@ -290,6 +372,377 @@ BM_KvStoreFloodingUpdate(uint32_t iters, size_t numOfUpdateKeys) {
   }
 }
 
+/**
+ * Table footprint of a store holding a million keys, without the key and
+ * data bytes which are the same for every layout:
+ * 1. Insert keys with empty values into the map
+ * 2. Report the bytes held by the table per key
+ */
+template <typename MapT>
+void
+fillKvStoreMap(MapT& kvStore, uint32_t numOfKeys) {
+  kvStore.reserve(numOfKeys);
+  for (uint32_t idx = 0; idx < numOfKeys; idx++) {
+    thrift::Value thriftValue(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        "kvStore" /* originatorId */,
+        "" /* value */,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    kvStore.emplace(genRandomStr(kSizeOfKey), std::move(thriftValue));
+  }
+}
+
+BENCHMARK_COUNTERS(BM_KvStoreMapFootprint, counters, iters) {
+  auto suspender = folly::BenchmarkSuspender();
+  for (uint32_t i = 0; i < iters; i++) {
+    KvStoreMap kvStore;
+    fillKvStoreMap(kvStore, kNumOfFootprintKeys);
+    counters["table_bytes_per_key"] =
+        kvStore.getAllocatedMemorySize() / kvStore.size();
+  }
+}
+
+BENCHMARK_COUNTERS(BM_KvStoreNodeMapFootprint, counters, iters) {
+  auto suspender = folly::BenchmarkSuspender();
+  for (uint32_t i = 0; i < iters; i++) {
+    std::unordered_map<std::string, thrift::Value> kvStore;
+    fillKvStoreMap(kvStore, kNumOfFootprintKeys);
+    // one bucket pointer per bucket, one node per key holding the next
+    // pointer, the (key, value) pair and the cached hash
+    const size_t nodeSize = sizeof(void*) +
+        sizeof(std::pair<const std::string, thrift::Value>) + sizeof(size_t);
+    counters["table_bytes_per_key"] =
+        (kvStore.bucket_count() * sizeof(void*) + kvStore.size() * nodeSize) /
+        kvStore.size();
+  }
+}
+
+/**
+ * Create a value with its hash set, as it is stored in kvStore
+ */
+thrift::Value
+createBenchmarkValue(
+    uint64_t version,
+    int sizeOfValue,
+    int64_t ttl = Constants::kTtlInfinity,
+    std::string const& originatorId = "kvStore") {
+  thrift::Value thriftVal(
+      apache::thrift::FRAGILE,
+      version /* version */,
+      originatorId /* originatorId */,
+      genRandomStr(sizeOfValue) /* value */,
+      ttl /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  thriftVal.hash_ref() = generateHash(
+      *thriftVal.version_ref(),
+      *thriftVal.originatorId_ref(),
+      thriftVal.value_ref());
+  return thriftVal;
+}
+
+/**
+ * Set keyVals into kvStore in batches and drain the publications it floods
+ */
+void
+fillKvStore(
+    KvStoreWrapper* kvStore,
+    std::vector<std::pair<std::string, thrift::Value>> const& keyVals) {
+  for (size_t idx = 0; idx < keyVals.size(); idx += kNumOfKeysPerSet) {
+    auto end = keyVals.begin() +
+        std::min(keyVals.size(), size_t(idx + kNumOfKeysPerSet));
+    kvStore->setKeys(
+        kTestingAreaName,
+        std::vector<std::pair<std::string, thrift::Value>>(
+            keyVals.begin() + idx, end));
+    kvStore->recvPublication();
+  }
+}
+
+/**
+ * Benchmark for mergeKeyValues() with different value sizes:
+ * 1. Put #numOfKeysInStore (key, value)s of #sizeOfValue bytes into kvStore
+ * 2. Merge updates of kNumOfFloodKeys keys with new values of the same size
+ */
+static void
+BM_KvStoreMergeValueSize(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfKeysInStore,
+    int sizeOfValue) {
+  auto suspender = folly::BenchmarkSuspender();
+  KvStoreMap kvStore;
+  std::vector<std::string> keys;
+  keys.reserve(numOfKeysInStore);
+  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
+    keys.emplace_back(genRandomStr(kSizeOfKey));
+    kvStore.emplace(keys.back(), createBenchmarkValue(1, sizeOfValue));
+  }
+
+  OperationStats stats(iters);
+  uint64_t version = 2;
+  for (uint32_t i = 0; i < iters; i++) {
+    std::unordered_map<std::string, thrift::Value> update;
+    for (uint32_t idx = 0; idx < kNumOfFloodKeys; idx++) {
+      update.emplace(
+          keys[folly::Random::rand32() % keys.size()],
+          createBenchmarkValue(version, sizeOfValue));
+    }
+    version++;
+
+    suspender.dismiss();
+    stats.start();
+    KvStore::mergeKeyValues(kvStore, update);
+    stats.stop();
+    suspender.rehire();
+  }
+  stats.report(counters);
+}
+
+/**
+ * Benchmark for dumpDifference() of a full-sync with a large store:
+ * 1. Put #numOfKeysInStore (key, value)s into kvStore
+ * 2. Take hashes of all keys, 1% of them from a newer version
+ * 3. Benchmark the time for the difference against those hashes
+ */
+static void
+BM_KvStoreDumpDifference(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfKeysInStore) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore");
+  kvStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  keyVals.reserve(numOfKeysInStore);
+  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
+    keyVals.emplace_back(
+        genRandomStr(kSizeOfKey), createBenchmarkValue(1, kSizeOfSmallValue));
+  }
+  fillKvStore(kvStore, keyVals);
+
+  thrift::KeyVals keyValHashes;
+  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
+    auto& [key, value] = keyVals[idx];
+    auto& hash = keyValHashes[key];
+    hash.version_ref() = *value.version_ref() + (idx % 100 == 0 ? 1 : 0);
+    hash.originatorId_ref() = *value.originatorId_ref();
+    hash.hash_ref() = idx % 100 == 0 ? 0 : *value.hash_ref();
+    hash.ttl_ref() = *value.ttl_ref();
+    hash.ttlVersion_ref() = *value.ttlVersion_ref();
+  }
+
+  OperationStats stats(iters);
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    stats.start();
+    kvStore->syncKeyVals(kTestingAreaName, keyValHashes);
+    stats.stop();
+  }
+  stats.report(counters);
+}
+
+/**
+ * Benchmark for flooding to many peers:
+ * 1. Start a kvStore peering with #numOfPeers kvStores
+ * 2. Set kNumOfFloodKeys keys into it and wait until all peers have them
+ */
+static void
+BM_KvStoreFloodFanout(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfPeers) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore");
+  kvStore->run();
+
+  std::vector<KvStoreWrapper*> peers;
+  for (uint32_t idx = 0; idx < numOfPeers; idx++) {
+    peers.emplace_back(
+        kvStoreTestFixture->createKvStore(fmt::format("peer-{}", idx)));
+    peers.back()->run();
+    kvStore->addPeer(
+        kTestingAreaName,
+        peers.back()->getNodeId(),
+        peers.back()->getPeerSpec());
+  }
+  for (auto const& peer : peers) {
+    while (kvStore->getPeerState(kTestingAreaName, peer->getNodeId()) !=
+           thrift::KvStorePeerState::INITIALIZED) {
+      std::this_thread::yield();
+    }
+  }
+
+  std::vector<std::string> keys;
+  for (uint32_t idx = 0; idx < kNumOfFloodKeys; idx++) {
+    keys.emplace_back(genRandomStr(kSizeOfKey));
+  }
+
+  OperationStats stats(iters);
+  uint64_t version = 1;
+  for (uint32_t i = 0; i < iters; i++) {
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    for (auto const& key : keys) {
+      keyVals.emplace_back(key, createBenchmarkValue(version, kSizeOfValue));
+    }
+
+    suspender.dismiss();
+    stats.start();
+    kvStore->setKeys(kTestingAreaName, keyVals);
+    for (auto const& peer : peers) {
+      for (auto const& key : keys) {
+        while (true) {
+          auto value = peer->getKey(kTestingAreaName, key);
+          if (value.has_value() and *value->version_ref() == version) {
+            break;
+          }
+          std::this_thread::yield();
+        }
+      }
+    }
+    stats.stop();
+    suspender.rehire();
+    version++;
+  }
+  stats.report(counters);
+}
+
+/**
+ * Benchmark for a storm of TTL refreshes:
+ * 1. Put #numOfKeysInStore (key, value)s with a finite TTL into kvStore
+ * 2. Refresh the TTL of all of them at once
+ */
+static void
+BM_KvStoreTtlRefreshStorm(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfKeysInStore) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore");
+  kvStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  keyVals.reserve(numOfKeysInStore);
+  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
+    keyVals.emplace_back(
+        genRandomStr(kSizeOfKey),
+        createBenchmarkValue(1, kSizeOfSmallValue, 3600000 /* ttl */));
+  }
+  fillKvStore(kvStore, keyVals);
+
+  // TTL refreshes come without value
+  for (auto& [_, value] : keyVals) {
+    value.value_ref().reset();
+  }
+
+  OperationStats stats(iters);
+  for (uint32_t i = 0; i < iters; i++) {
+    for (auto& [_, value] : keyVals) {
+      (*value.ttlVersion_ref())++;
+    }
+
+    suspender.dismiss();
+    stats.start();
+    fillKvStore(kvStore, keyVals);
+    stats.stop();
+    suspender.rehire();
+  }
+  stats.report(counters);
+}
+
+/**
+ * Benchmark for flooding a single key update into a large store:
+ * 1. Put #numOfKeysInStore (key, value)s with a finite TTL into kvStore
+ * 2. Set one key with a finite TTL and receive its publication
+ * TTLs of flooded keys are looked up per key of the publication, time per
+ * update should not grow with the number of keys counted down
+ */
+static void
+BM_KvStoreFloodWithTtls(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfKeysInStore) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore");
+  kvStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  keyVals.reserve(numOfKeysInStore);
+  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
+    keyVals.emplace_back(
+        genRandomStr(kSizeOfKey),
+        createBenchmarkValue(1, kSizeOfSmallValue, 3600000 /* ttl */));
+  }
+  fillKvStore(kvStore, keyVals);
+
+  auto const key = keyVals.front().first;
+  OperationStats stats(iters);
+  for (uint32_t i = 0; i < iters; i++) {
+    auto value = createBenchmarkValue(i + 2, kSizeOfValue, 3600000 /* ttl */);
+
+    suspender.dismiss();
+    stats.start();
+    kvStore->setKey(kTestingAreaName, key, std::move(value));
+    auto pub = kvStore->recvPublication();
+    stats.stop();
+    suspender.rehire();
+    CHECK_EQ(1, pub.keyVals_ref()->size());
+  }
+  stats.report(counters);
+}
+
+/**
+ * Benchmark for publishing updates to filtered subscribers:
+ * 1. Create #numOfSubscribers subscribers, each with a key prefix filter.
+ *    Random one character prefixes, subscribers often share their filter.
+ * 2. Publish a publication of kNumOfFloodKeys keys to all of them
+ */
+static void
+BM_KvStoreFilteredFanout(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSubscribers) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<apache::thrift::ServerStream<thrift::Publication>> streams;
+  KvStorePublisherIndex publishers;
+  // streams are not consumed, buffer all updates
+  thrift::CtrlStreamConfig streamConfig;
+  streamConfig.max_buffered_updates_ref() =
+      std::numeric_limits<int32_t>::max();
+  for (uint32_t idx = 0; idx < numOfSubscribers; idx++) {
+    thrift::KeyDumpParams filter;
+    filter.keys_ref() = std::vector<std::string>{genRandomStr(1)};
+    auto streamAndPublisher = KvStoreStreamPublisher::create(
+        fmt::format("benchmark.{}", idx), streamConfig, []() {});
+    streams.emplace_back(std::move(streamAndPublisher.first));
+    publishers.add(
+        idx,
+        std::make_unique<KvStorePublisher>(
+            std::set<std::string>{},
+            std::move(filter),
+            std::move(streamAndPublisher.second)));
+  }
+
+  thrift::Publication pub;
+  pub.area_ref() = kTestingAreaName;
+  for (uint32_t idx = 0; idx < kNumOfFloodKeys; idx++) {
+    pub.keyVals_ref()->emplace(
+        genRandomStr(kSizeOfKey), createBenchmarkValue(1, kSizeOfValue));
+  }
+
+  OperationStats stats(iters);
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    stats.start();
+    publishers.publish(pub);
+    stats.stop();
+  }
+  suspender.rehire();
+
+  for (auto& publisher : publishers.releaseAll()) {
+    publisher->complete();
+  }
+  stats.report(counters);
+}
+
 // The first integer parameter is number of keyVals already in store
 // The second integer parameter is the number of keyVals for update
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10_10, 10, 10);
@@ -312,6 +765,41 @@ BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 100);
 BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 1000);
 BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 10000);
 
+// The first integer parameter is number of keyVals already in store
+// The second integer parameter is the byte size of values
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_KvStoreMergeValueSize, counters, 10000_64, 10000, 64);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_KvStoreMergeValueSize, counters, 10000_1024, 10000, 1024);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_KvStoreMergeValueSize, counters, 10000_16384, 10000, 16384);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_KvStoreMergeValueSize, counters, 100000_1024, 100000, 1024);
+
+// The parameter is number of keyVals already in store
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreDumpDifference, counters, 100000);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreDumpDifference, counters, 1000000);
+
+// The parameter is number of peers to flood to
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFloodFanout, counters, 10);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFloodFanout, counters, 50);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFloodFanout, counters, 200);
+
+// The parameter is number of keyVals refreshed at once
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreTtlRefreshStorm, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreTtlRefreshStorm, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreTtlRefreshStorm, counters, 100000);
+
+// The parameter is number of keyVals with a finite TTL already in store
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFloodWithTtls, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFloodWithTtls, counters, 100000);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFloodWithTtls, counters, 500000);
+
+// The parameter is number of filtered subscribers
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFilteredFanout, counters, 10);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFilteredFanout, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_KvStoreFilteredFanout, counters, 1000);
+
 } // namespace openr
 
 int
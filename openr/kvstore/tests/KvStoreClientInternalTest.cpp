@@ -596,6 +596,73 @@ TEST(KvStoreClientInternal, PersistKeyClearKeyThrottle) {
   evbThread.join();
 }
 
+TEST(KvStoreClientInternal, PersistKeys) {
+  OpenrEventBase evb;
+  fbzmq::Context context;
+  folly::Baton waitBaton;
+
+  int scheduleAt{0};
+
+  // start kvstore for interaction
+  auto config = std::make_shared<Config>(getBasicOpenrConfig("node1"));
+  auto store = std::make_unique<KvStoreWrapper>(context, config);
+  store->run();
+
+  // key already in KvStore from someone else gets version bumped
+  thrift::Value thriftVal = createThriftValue(
+      3 /* version */, "node2", std::string("v0"), kTtl.count());
+  store->setKey(kTestingAreaName, "k1", thriftVal);
+
+  auto client = std::make_shared<KvStoreClientInternal>(
+      &evb, store->getNodeId(), store->getKvStore(), true /* use throttle */);
+
+  evb.scheduleTimeout(
+      std::chrono::milliseconds(scheduleAt += 0), [&]() noexcept {
+        EXPECT_EQ(
+            2,
+            client->persistKeys(
+                kTestingAreaName, {{"k1", "v1"}, {"k2", "v2"}}, kTtl));
+        // no-op for unchanged keys
+        EXPECT_EQ(
+            1,
+            client->persistKeys(
+                kTestingAreaName, {{"k1", "v1"}, {"k2", "v3"}}, kTtl));
+      });
+
+  evb.scheduleTimeout(
+      std::chrono::milliseconds(scheduleAt += 300), [&]() noexcept {
+        auto k1 = store->getKey(kTestingAreaName, "k1");
+        ASSERT_TRUE(k1.has_value());
+        EXPECT_EQ("v1", k1->value_ref());
+        EXPECT_EQ(4, *k1->version_ref());
+        EXPECT_EQ("node1", *k1->originatorId_ref());
+
+        auto k2 = store->getKey(kTestingAreaName, "k2");
+        ASSERT_TRUE(k2.has_value());
+        EXPECT_EQ("v3", k2->value_ref());
+        EXPECT_EQ(2, *k2->version_ref());
+
+        // Synchronization primitive
+        waitBaton.post();
+      });
+
+  // Start the event loop and wait until it is finished execution.
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  // Synchronization primitive
+  waitBaton.wait();
+
+  // Stop store
+  LOG(INFO) << "Stopping stores";
+  store->stop();
+  client.reset();
+
+  evb.stop();
+  evb.waitUntilStopped();
+  evbThread.join();
+}
+
 TEST(KvStoreClientInternal, EmptyValueKey) {
   fbzmq::Context context;
   folly::Baton waitBaton;
@@ -927,6 +994,59 @@ TEST(KvStoreClientInternal, PersistKeyChangeTtlTest) {
   evbThread.join();
 }
 
+/**
+ * TTL updates of keys persisted shortly after each other are sent together
+ */
+TEST(KvStoreClientInternal, TtlUpdatesBatched) {
+  fbzmq::Context context;
+  folly::Baton waitBaton;
+  const std::string nodeId{"test_store"};
+  // TTL updates every 1s, batched within 500ms epochs
+  const std::chrono::milliseconds ttl{4000};
+
+  // Initialize and start KvStore
+  auto config = std::make_shared<Config>(getBasicOpenrConfig(nodeId));
+  auto store = std::make_shared<KvStoreWrapper>(context, config);
+  store->run();
+
+  OpenrEventBase evb;
+  auto client1 = std::make_unique<KvStoreClientInternal>(
+      &evb, nodeId, store->getKvStore());
+
+  evb.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    client1->persistKey(kTestingAreaName, "test-key1", "test-value1", ttl);
+  });
+  evb.scheduleTimeout(std::chrono::milliseconds(100), [&]() noexcept {
+    client1->persistKey(kTestingAreaName, "test-key2", "test-value2", ttl);
+  });
+
+  // two rounds of TTL updates, both keys are refreshed in the same ones
+  evb.scheduleTimeout(std::chrono::milliseconds(2600), [&]() noexcept {
+    auto maybeVal1 = client1->getKey(kTestingAreaName, "test-key1");
+    auto maybeVal2 = client1->getKey(kTestingAreaName, "test-key2");
+    ASSERT_TRUE(maybeVal1.has_value());
+    ASSERT_TRUE(maybeVal2.has_value());
+    EXPECT_LE(2, *maybeVal1->ttlVersion_ref()); // can be flaky under stress
+    EXPECT_EQ(*maybeVal1->ttlVersion_ref(), *maybeVal2->ttlVersion_ref());
+
+    waitBaton.post();
+  });
+
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  waitBaton.wait();
+
+  store->closeQueue();
+  client1.reset();
+  store->stop();
+  store.reset();
+
+  evb.stop();
+  evb.waitUntilStopped();
+  evbThread.join();
+}
+
 /**
  * Start a store and attach two clients to it. Set some Keys and add/del peers.
  * Verify that changes are visible in KvStore via a separate REQ socket to
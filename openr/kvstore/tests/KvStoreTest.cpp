@@ -16,11 +16,13 @@
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/Random.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/gen/Base.h>
 #include <folly/init/Init.h>
 #include <gtest/gtest.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
 #include <openr/config/Config.h>
 #include <openr/config/tests/Utils.h>
@@ -374,6 +376,7 @@ INSTANTIATE_TEST_CASE_P(
 //
 TEST_F(KvStoreTestFixture, CounterReport) {
   // clean up counters before testing
+  StatCounter::flushAll();
   fb303::fbData->resetAllData();
 
   auto kvStore = createKvStore("node1");
@@ -410,6 +413,7 @@ TEST_F(KvStoreTestFixture, CounterReport) {
 
   // Wait till counters updated
   std::this_thread::sleep_for(std::chrono::milliseconds(counterUpdateWaitTime));
+  StatCounter::flushAll();
   auto counters = fb303::fbData->getCounters();
 
   // Verify the counter keys exist
@@ -478,6 +482,7 @@ TEST_F(KvStoreTestFixture, CounterReport) {
   // Wait for counter update again
   std::this_thread::sleep_for(std::chrono::milliseconds(counterUpdateWaitTime));
   // Verify the num_keys counter is the same
+  StatCounter::flushAll();
   counters = fb303::fbData->getCounters();
   EXPECT_EQ(expect_num_key, counters.at("kvstore.num_keys"));
 
@@ -739,6 +744,84 @@ TEST_F(KvStoreTestFixture, TtlVerification) {
   kvStore->stop();
 }
 
+/**
+ * Verify a mass expiry is published in slices of expired keys, the last one
+ * telling the originator is gone along with all of its keys
+ */
+TEST_F(KvStoreTestFixture, MassExpiry) {
+  const size_t numKeys = 2 * Constants::kTtlExpirySliceSize + 10;
+  auto kvStore = createKvStore("test");
+  kvStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < numKeys; ++i) {
+    keyVals.emplace_back(
+        folly::sformat("prefix:node1:{}", i),
+        createThriftValue(1, "node1", "value", 1000 /* ttl */));
+  }
+  keyVals.emplace_back(
+      "prefix:node2:1", createThriftValue(1, "node2", "value"));
+  EXPECT_TRUE(kvStore->setKeys(kTestingAreaName, keyVals));
+  EXPECT_EQ(numKeys + 1, kvStore->recvPublication().keyVals_ref()->size());
+
+  size_t numExpired = 0;
+  size_t numPublications = 0;
+  while (numExpired < numKeys) {
+    auto publication = kvStore->recvPublication();
+    EXPECT_TRUE(publication.keyVals_ref()->empty());
+    EXPECT_LE(
+        publication.expiredKeys_ref()->size(), Constants::kTtlExpirySliceSize);
+    numExpired += publication.expiredKeys_ref()->size();
+    ++numPublications;
+    if (numExpired < numKeys) {
+      EXPECT_FALSE(publication.expiredOriginators_ref().has_value());
+    } else {
+      ASSERT_TRUE(publication.expiredOriginators_ref().has_value());
+      EXPECT_EQ(
+          std::vector<std::string>{"node1"},
+          *publication.expiredOriginators_ref());
+    }
+  }
+  EXPECT_EQ(numKeys, numExpired);
+  EXPECT_LE(3, numPublications);
+  EXPECT_EQ(1, kvStore->dumpAll(kTestingAreaName).size());
+
+  kvStore->stop();
+}
+
+/**
+ * Verify dumps are shared by requests until the store changes
+ */
+TEST_F(KvStoreTestFixture, DumpCache) {
+  auto kvStore = createKvStore("test");
+  kvStore->run();
+
+  EXPECT_TRUE(kvStore->setKey(
+      kTestingAreaName, "key1", createThriftValue(1, "node1", "value1")));
+
+  StatCounter::flushAll();
+  auto oldCounters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, kvStore->dumpHashes(kTestingAreaName).size());
+  EXPECT_EQ(1, kvStore->dumpHashes(kTestingAreaName).size());
+  StatCounter::flushAll();
+  auto newCounters = fb303::fbData->getCounters();
+  EXPECT_EQ(
+      oldCounters["kvstore.dump_cache.misses.count"] + 1,
+      newCounters["kvstore.dump_cache.misses.count"]);
+  EXPECT_EQ(
+      oldCounters["kvstore.dump_cache.hits.count"] + 1,
+      newCounters["kvstore.dump_cache.hits.count"]);
+
+  // new key invalidates the cached dump
+  EXPECT_TRUE(kvStore->setKey(
+      kTestingAreaName, "key2", createThriftValue(1, "node1", "value2")));
+  auto hashes = kvStore->dumpHashes(kTestingAreaName);
+  EXPECT_EQ(2, hashes.size());
+  EXPECT_EQ(1, hashes.count("key2"));
+
+  kvStore->stop();
+}
+
 TEST_F(KvStoreTestFixture, LeafNode) {
   auto store0Conf = getTestKvConf();
   store0Conf.set_leaf_node_ref() = true;
@@ -1869,6 +1952,7 @@ TEST_F(KvStoreTestFixture, BasicSync) {
   LOG(INFO) << "Testing flooding behavior";
 
   // Get current counters
+  StatCounter::flushAll();
   auto oldCounters = fb303::fbData->getCounters();
 
   // Set new key
@@ -1902,6 +1986,7 @@ TEST_F(KvStoreTestFixture, BasicSync) {
 
   // Get new counters
   LOG(INFO) << "Getting counters snapshot";
+  StatCounter::flushAll();
   auto newCounters = fb303::fbData->getCounters();
 
   // Verify counters
@@ -2150,6 +2235,84 @@ TEST_F(KvStoreTestFixture, DumpPrefix) {
       myStore->dumpAll(kTestingAreaName, std::move(kvFilters)));
 }
 
+/**
+ * Paginated dump returns matching keys in order, page after page
+ */
+TEST_F(KvStoreTestFixture, DumpPage) {
+  auto store = createKvStore("node1");
+  store->run();
+  for (int i = 0; i < 5; ++i) {
+    store->setKey(
+        kTestingAreaName,
+        fmt::format("key{}", i),
+        createThriftValue(1, "node1", "value"));
+    store->setKey(
+        kTestingAreaName,
+        fmt::format("other{}", i),
+        createThriftValue(1, "node1", "value"));
+  }
+
+  auto getPage = [&](thrift::KeyDumpParams const& params,
+                     thrift::PageParams const& page) {
+    return std::move(
+        *store->getKvStore()
+             ->dumpKvStoreKeysPage(kTestingAreaName, params, page)
+             .get());
+  };
+
+  //
+  // All keys with prefix, two per page
+  //
+  {
+    thrift::KeyDumpParams params;
+    params.keys_ref() = {"key"};
+    thrift::PageParams page;
+    page.limit_ref() = 2;
+    std::vector<std::string> keys;
+    while (true) {
+      auto thriftPage = getPage(params, page);
+      auto const& keyVals = *thriftPage.publication_ref()->keyVals_ref();
+      EXPECT_LE(keyVals.size(), 2);
+      for (auto const& [key, _] : keyVals) {
+        keys.emplace_back(key);
+      }
+      if (not thriftPage.nextCursor_ref().has_value()) {
+        break;
+      }
+      page.cursor_ref() = *thriftPage.nextCursor_ref();
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(
+        std::vector<std::string>({"key0", "key1", "key2", "key3", "key4"}),
+        keys);
+  }
+
+  //
+  // No filter, sorted keys are scanned from the cursor
+  //
+  {
+    thrift::PageParams page;
+    page.limit_ref() = 3;
+    page.cursor_ref() = "key3";
+    auto thriftPage = getPage(thrift::KeyDumpParams(), page);
+    auto const& keyVals = *thriftPage.publication_ref()->keyVals_ref();
+    EXPECT_EQ(3, keyVals.size());
+    EXPECT_EQ(1, keyVals.count("key4"));
+    EXPECT_EQ(1, keyVals.count("other0"));
+    EXPECT_EQ(1, keyVals.count("other1"));
+    EXPECT_EQ("other1", thriftPage.nextCursor_ref().value());
+  }
+
+  //
+  // Invalid page params
+  //
+  {
+    thrift::PageParams page;
+    page.limit_ref() = 0;
+    EXPECT_THROW(getPage(thrift::KeyDumpParams(), page), thrift::OpenrError);
+  }
+}
+
 /**
  * Start single testable store, and set key values.
  * Try to request for KEY_DUMP with a few keyValHashes.
@@ -2438,7 +2601,100 @@ TEST_F(KvStoreTestFixture, RateLimiterFlood) {
   EXPECT_EQ(expectNumKeys, kv2.size());
 }
 
+/**
+ * Test fair rate limiting of originators with flooding rate-limiter enabled
+ * s0 -- s1 (rate-limited, per originator as well) -- s2
+ * s2 floods a storm of keys of its own, s0 sets one adjacency and one prefix
+ * key in the middle of it. The keys of s0 must make it to s2 while the storm
+ * still goes on, and all stores have the same keys in the end
+ */
+TEST_F(KvStoreTestFixture, RateLimiterFairness) {
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  thrift::KvstoreConfig rateLimitConf;
+  rateLimitConf.flood_rate_ref() = thrift::KvstoreFloodRate(
+      apache::thrift::FRAGILE,
+      20 /*flood_msg_per_sec*/,
+      20 /*flood_msg_burst_size*/);
+  rateLimitConf.originator_flood_rate_ref() = thrift::KvstoreFloodRate(
+      apache::thrift::FRAGILE,
+      5 /*flood_msg_per_sec*/,
+      5 /*flood_msg_burst_size*/);
+
+  auto store0 = createKvStore("store0");
+  auto store1 = createKvStore("store1", rateLimitConf);
+  auto store2 = createKvStore("store2");
+  store0->run();
+  store1->run();
+  store2->run();
+
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store0->getNodeId(), store0->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store2->getNodeId(), store2->getPeerSpec());
+  store2->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+
+  auto createValue = [](std::string const& originatorId) {
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        originatorId /* originatorId */,
+        "value" /* value */,
+        300000 /* ttl */,
+        1 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash_ref() = generateHash(
+        *thriftVal.version_ref(),
+        *thriftVal.originatorId_ref(),
+        thriftVal.value_ref());
+    return thriftVal;
+  };
+
+  auto const startTime = steady_clock::now();
+  const auto duration = std::chrono::seconds(4);
+  int numStormKeys{0};
+  bool store0KeysSet{false};
+  bool store0KeysReceived{false};
+  while (steady_clock::now() - startTime < duration) {
+    EXPECT_TRUE(store2->setKey(
+        kTestingAreaName,
+        fmt::format("prefix:store2:{}", ++numStormKeys),
+        createValue("store2")));
+    if (not store0KeysSet and
+        steady_clock::now() - startTime > std::chrono::seconds(1)) {
+      EXPECT_TRUE(store0->setKey(
+          kTestingAreaName, "adj:store0", createValue("store0")));
+      EXPECT_TRUE(store0->setKey(
+          kTestingAreaName, "prefix:store0", createValue("store0")));
+      store0KeysSet = true;
+    }
+    if (store0KeysSet and not store0KeysReceived) {
+      store0KeysReceived =
+          store2->getKey(kTestingAreaName, "adj:store0").has_value() and
+          store2->getKey(kTestingAreaName, "prefix:store0").has_value();
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(store0KeysReceived);
+
+  // held keys of the storm are flooded eventually
+  const size_t expectNumKeys = numStormKeys + 2;
+  for (auto* store : {store0, store2}) {
+    while (store->dumpAll(kTestingAreaName).size() != expectNumKeys) {
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  EXPECT_EQ(expectNumKeys, store1->dumpAll(kTestingAreaName).size());
+
+  StatCounter::flushAll();
+  EXPECT_LT(
+      0, fb303::fbData->getCounters()["kvstore.rate_limit_held_keys.sum"]);
+}
+
 TEST_F(KvStoreTestFixture, RateLimiter) {
+  StatCounter::flushAll();
   fb303::fbData->resetAllData();
 
   const size_t messageRate{10}, burstSize{50};
@@ -2490,6 +2746,7 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   /* sleep override */
   std::this_thread::sleep_for(std::chrono::seconds(1));
 
+  StatCounter::flushAll();
   auto s0PubSent1 =
       fb303::fbData->getCounters()["kvstore.thrift.num_flood_pub.count"];
 
@@ -2508,6 +2765,7 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   const int wait = 2; // in seconds
   int i2{0};
   uint64_t elapsedTime2{0};
+  StatCounter::flushAll();
   fb303::fbData->resetAllData();
   do {
     thrift::Value thriftVal(
@@ -2537,6 +2795,7 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   ASSERT_TRUE(getRes.has_value());
   EXPECT_EQ(i2, *getRes->ttlVersion_ref());
 
+  StatCounter::flushAll();
   auto allCounters = fb303::fbData->getCounters();
   auto s1PubSent2 = allCounters["kvstore.thrift.num_flood_pub.count"];
   auto s0KeyNum2 = store0->dumpAll(kTestingAreaName).size();
@@ -2580,6 +2839,7 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   /* sleep override */
   std::this_thread::sleep_for(std::chrono::seconds(wait));
 
+  StatCounter::flushAll();
   allCounters = fb303::fbData->getCounters();
   auto s1PubSent3 = allCounters["kvstore.thrift.num_flood_pub.count"];
   auto s1Supressed3 = allCounters["kvstore.rate_limit_suppress.count"];
@@ -2627,6 +2887,7 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   /* sleep override */
   std::this_thread::sleep_for(std::chrono::milliseconds(2 * ttlLow));
 
+  StatCounter::flushAll();
   allCounters = fb303::fbData->getCounters();
   auto s1Supressed4 = allCounters["kvstore.rate_limit_suppress.count"];
   // expired keys are not sent (or received). Just check expired keys
@@ -2634,6 +2895,358 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
   EXPECT_GE(s1Supressed4 - s1Supressed3, 1);
 }
 
+/**
+ * Verify a small change to a large value is flooded as a patch and rebuilt by
+ * the receiving store.
+ */
+TEST_F(KvStoreTestFixture, FloodValuePatch) {
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  auto patchConf = getTestKvConf();
+  patchConf.enable_flood_value_patch_ref() = true;
+  auto store0 = createKvStore("store0", patchConf);
+  auto store1 = createKvStore("store1", patchConf);
+  store0->run();
+  store1->run();
+
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store0->getNodeId(), store0->getPeerSpec());
+  waitForAllPeersInitialized();
+
+  std::string data(4096, 'a');
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName, "key", createThriftValue(1, "store0", data)));
+  waitForKeyInStoreWithTimeout(store1, kTestingAreaName, "key");
+
+  data[2048] = 'b';
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName, "key", createThriftValue(2, "store0", data)));
+  auto const start = std::chrono::steady_clock::now();
+  while (*store1->getKey(kTestingAreaName, "key")->version_ref() != 2 &&
+         (std::chrono::steady_clock::now() - start <
+          kTimeoutOfKvStorePropagation)) {
+    std::this_thread::yield();
+  }
+
+  auto value = store1->getKey(kTestingAreaName, "key");
+  ASSERT_TRUE(value.has_value());
+  EXPECT_EQ(2, *value->version_ref());
+  EXPECT_EQ(data, *value->value_ref());
+  EXPECT_FALSE(value->patch_ref().has_value());
+
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters["kvstore.thrift.num_flood_value_patches.sum"]);
+  EXPECT_EQ(1, counters["kvstore.applied_value_patches.count"]);
+}
+
+/**
+ * Verify large values are sent compressed in full-sync responses and flooded
+ * publications, and decompressed by the receiving store.
+ */
+TEST_F(KvStoreTestFixture, FloodValueCompression) {
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  auto compressionConf = getTestKvConf();
+  compressionConf.enable_flood_value_compression_ref() = true;
+  auto store0 = createKvStore("store0", compressionConf);
+  auto store1 = createKvStore("store1", compressionConf);
+  store0->run();
+  store1->run();
+
+  // key synced with the peer
+  const std::string data1(4096, 'a');
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName, "key1", createThriftValue(1, "store0", data1)));
+
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store0->getNodeId(), store0->getPeerSpec());
+  waitForAllPeersInitialized();
+
+  // key flooded to the peer
+  const std::string data2(4096, 'b');
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName, "key2", createThriftValue(1, "store0", data2)));
+  waitForKeyInStoreWithTimeout(store1, kTestingAreaName, "key2");
+
+  auto value1 = store1->getKey(kTestingAreaName, "key1");
+  ASSERT_TRUE(value1.has_value());
+  EXPECT_EQ(data1, *value1->value_ref());
+  EXPECT_FALSE(value1->compressedValue_ref().has_value());
+  auto value2 = store1->getKey(kTestingAreaName, "key2");
+  ASSERT_TRUE(value2.has_value());
+  EXPECT_EQ(data2, *value2->value_ref());
+  EXPECT_FALSE(value2->compressedValue_ref().has_value());
+
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters["kvstore.thrift.num_sync_compressed_values.sum"]);
+  EXPECT_EQ(1, counters["kvstore.thrift.num_flood_compressed_values.sum"]);
+  EXPECT_EQ(2, counters["kvstore.decompressed_values.count"]);
+  EXPECT_EQ(0, counters["kvstore.invalid_compressed_values.count"]);
+}
+
+/**
+ * Verify floods stream between peers with flood stream enabled. store0 and
+ * store1 stream the floods of each other, floods between store1 and store2
+ * keep coming as calls as store2 doesn't stream them.
+ */
+TEST_F(KvStoreTestFixture, FloodStream) {
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  auto streamConf = getTestKvConf();
+  streamConf.enable_flood_stream_ref() = true;
+  auto store0 = createKvStore("store0", streamConf);
+  auto store1 = createKvStore("store1", streamConf);
+  auto store2 = createKvStore("store2");
+  store0->run();
+  store1->run();
+  store2->run();
+
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store0->getNodeId(), store0->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store2->getNodeId(), store2->getPeerSpec());
+  store2->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  waitForAllPeersInitialized();
+
+  // stream of store1 is opened along with its sync, floods of store0 go over
+  // it once store0 has it
+  auto numStreamedFloods = []() {
+    return fb303::fbData->getCounters()
+        ["kvstore.thrift.num_flood_stream_pub.count"];
+  };
+  auto const start = std::chrono::steady_clock::now();
+  int64_t version{0};
+  while (numStreamedFloods() == 0 and
+         std::chrono::steady_clock::now() - start <
+             kTimeoutOfKvStorePropagation) {
+    EXPECT_TRUE(store0->setKey(
+        kTestingAreaName,
+        "key0",
+        createThriftValue(++version, "store0", "value0")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_GT(numStreamedFloods(), 0);
+
+  // flooded over streams, and over the calls of store2
+  for (int i = 1; i <= 10; ++i) {
+    EXPECT_TRUE(store0->setKey(
+        kTestingAreaName,
+        fmt::format("key{}", i),
+        createThriftValue(i, "store0", "value")));
+  }
+  EXPECT_TRUE(store2->setKey(
+      kTestingAreaName, "key2-0", createThriftValue(1, "store2", "value")));
+  waitForKeyInStoreWithTimeout(store2, kTestingAreaName, "key10");
+  waitForKeyInStoreWithTimeout(store0, kTestingAreaName, "key2-0");
+  EXPECT_EQ(10, *store1->getKey(kTestingAreaName, "key10")->version_ref());
+
+  // store1 asked store2 for a stream in vain
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_GE(counters["kvstore.thrift.num_flood_stream_received.count"], 11);
+  EXPECT_EQ(0, counters["kvstore.thrift.num_flood_stream_failure.count"]);
+}
+
+/**
+ * Verify warm restart from snapshot. store0 writes its keys to the snapshot
+ * file, a store restarted with the same file has them before syncing with
+ * any peer.
+ */
+TEST_F(KvStoreTestFixture, SnapshotWarmRestart) {
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  folly::test::TemporaryDirectory snapshotDir;
+  auto snapshotConf = getTestKvConf();
+  snapshotConf.snapshot_file_path_ref() =
+      (snapshotDir.path() / "kvstore").string();
+  snapshotConf.snapshot_interval_s_ref() = 1;
+  const auto snapshotFile =
+      snapshotDir.path() / fmt::format("kvstore.{}", kTestingAreaName.t);
+
+  auto store0 = createKvStore("store0", snapshotConf);
+  auto store1 = createKvStore("store1");
+  store0->run();
+  store1->run();
+
+  // snapshots are written once the previous one is loaded with the first
+  // peer
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName, "key1", createThriftValue(1, "store0", "value1")));
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName,
+      "key2",
+      createThriftValue(1, "store0", "value2", 3600 * 1000)));
+  while (not boost::filesystem::exists(snapshotFile)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  store0->stop();
+
+  auto store2 = createKvStore("store0", snapshotConf);
+  store2->run();
+  EXPECT_FALSE(store2->getKey(kTestingAreaName, "key1").has_value());
+  store2->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+
+  auto value1 = store2->getKey(kTestingAreaName, "key1");
+  ASSERT_TRUE(value1.has_value());
+  EXPECT_EQ("value1", *value1->value_ref());
+  auto value2 = store2->getKey(kTestingAreaName, "key2");
+  ASSERT_TRUE(value2.has_value());
+  EXPECT_EQ("value2", *value2->value_ref());
+  // TTL kept counting down
+  EXPECT_LT(*value2->ttl_ref(), 3600 * 1000);
+
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(2, counters["kvstore.snapshot.num_keys_loaded.sum"]);
+}
+
+/**
+ * Verify tracing of sampled updates. Key set on store0 is traced, its trace is
+ * flooded to store1 with a closed flood span and handed to subscribers of
+ * store1 with an open queue span.
+ */
+TEST_F(KvStoreTestFixture, PerfTrace) {
+  auto traceConf = getTestKvConf();
+  traceConf.perf_trace_sample_rate_ref() = 1;
+  auto store0 = createKvStore("store0", traceConf);
+  auto store1 = createKvStore("store1", traceConf);
+  store0->run();
+  store1->run();
+
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store0->getNodeId(), store0->getPeerSpec());
+  waitForAllPeersInitialized();
+
+  EXPECT_TRUE(store0->setKey(
+      kTestingAreaName, "key", createThriftValue(1, "store0", "value")));
+
+  thrift::Publication pub;
+  while (not pub.keyVals_ref()->count("key")) {
+    pub = store1->recvPublication();
+  }
+  ASSERT_TRUE(pub.perfEvents_ref().has_value());
+  EXPECT_TRUE(pub.perfEvents_ref()->traceId_ref().has_value());
+  auto const& spans = *pub.perfEvents_ref()->spans_ref();
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ("KVSTORE_FLOOD", *spans.at(0).stage_ref());
+  EXPECT_EQ("store0", *spans.at(0).startNodeName_ref());
+  EXPECT_EQ("store1", *spans.at(0).endNodeName_ref());
+  EXPECT_NE(0, *spans.at(0).endUs_ref());
+  EXPECT_EQ("KVSTORE_UPDATES_QUEUE", *spans.at(1).stage_ref());
+  EXPECT_EQ("store1", *spans.at(1).startNodeName_ref());
+  EXPECT_EQ(0, *spans.at(1).endUs_ref());
+}
+
+/**
+ * Verify flood coalescing. store0 sets a burst of keys. They must all reach
+ * store1 with far fewer flooded publications than keys, and the repeatedly
+ * updated key must arrive with its latest version.
+ */
+TEST_F(KvStoreTestFixture, FloodCoalescing) {
+  StatCounter::flushAll();
+  fb303::fbData->resetAllData();
+
+  auto coalesceConf = getTestKvConf();
+  thrift::KvstoreFloodCoalesce floodCoalesce;
+  floodCoalesce.min_window_ms_ref() = 10;
+  floodCoalesce.max_window_ms_ref() = 100;
+  coalesceConf.flood_coalesce_ref() = floodCoalesce;
+
+  auto store0 = createKvStore("store0", coalesceConf);
+  auto store1 = createKvStore("store1");
+  store0->run();
+  store1->run();
+
+  store0->addPeer(kTestingAreaName, store1->getNodeId(), store1->getPeerSpec());
+  store1->addPeer(kTestingAreaName, store0->getNodeId(), store0->getPeerSpec());
+  waitForAllPeersInitialized();
+
+  const int numKeys{200};
+  for (int i = 0; i < numKeys; ++i) {
+    auto thriftVal = createThriftValue(
+        1 /* version */,
+        "store0" /* originatorId */,
+        "value" /* value */,
+        Constants::kTtlInfinity /* ttl */);
+    EXPECT_TRUE(store0->setKey(
+        kTestingAreaName, fmt::format("coalesce-key-{}", i), thriftVal));
+
+    // same key again with a newer version
+    auto churnVal = createThriftValue(
+        i + 1 /* version */,
+        "store0" /* originatorId */,
+        "value" /* value */,
+        Constants::kTtlInfinity /* ttl */);
+    EXPECT_TRUE(store0->setKey(kTestingAreaName, "churn-key", churnVal));
+  }
+
+  for (int i = 0; i < numKeys; ++i) {
+    waitForKeyInStoreWithTimeout(
+        store1, kTestingAreaName, fmt::format("coalesce-key-{}", i));
+  }
+  waitForKeyInStoreWithTimeout(store1, kTestingAreaName, "churn-key");
+  auto const start = std::chrono::steady_clock::now();
+  while (*store1->getKey(kTestingAreaName, "churn-key")->version_ref() !=
+             numKeys &&
+         (std::chrono::steady_clock::now() - start <
+          kTimeoutOfKvStorePropagation)) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(
+      numKeys, *store1->getKey(kTestingAreaName, "churn-key")->version_ref());
+
+  // 2 * numKeys updates were merged into a handful of floods
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_LT(counters["kvstore.thrift.num_flood_pub.count"], numKeys);
+}
+
+/**
+ * Verify local writes issued back to back are all applied, and published at
+ * most once each, whether or not they got combined
+ */
+TEST_F(KvStoreTestFixture, CombinedKeySets) {
+  auto store = createKvStore("store");
+  store->run();
+
+  const int numKeys{100};
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
+  for (int i = 0; i < numKeys; ++i) {
+    thrift::KeySetParams params;
+    params.keyVals_ref()->emplace(
+        fmt::format("combined-key-{}", i),
+        createThriftValue(
+            1 /* version */,
+            "store" /* originatorId */,
+            "value" /* value */,
+            Constants::kTtlInfinity /* ttl */));
+    futures.emplace_back(store->getKvStore()->setKvStoreKeyVals(
+        kTestingAreaName, std::move(params)));
+  }
+  for (auto& future : futures) {
+    std::move(future).get();
+  }
+
+  // every write is visible once its future completed
+  EXPECT_EQ(numKeys, store->dumpAll(kTestingAreaName).size());
+
+  int numPublications{0};
+  std::unordered_set<std::string> published;
+  while (published.size() < numKeys) {
+    auto pub = store->recvPublication();
+    ++numPublications;
+    for (auto const& [key, _] : *pub.keyVals_ref()) {
+      published.emplace(key);
+    }
+  }
+  EXPECT_LE(numPublications, numKeys);
+}
+
 /**
  * this is to verify correctness of 3-way full-sync
  * tuple represents (key, value-version, value)
@@ -2984,6 +3597,69 @@ TEST_F(KvStoreTestFixture, KeySyncMultipleArea) {
   }
 }
 
+/*
+ * Same topology as above, but every area's KvStoreDb runs on its own event
+ * base. Verify flooding stays within an area and that summaries and counters
+ * are aggregated across the per-area event bases.
+ */
+TEST_F(KvStoreTestFixture, PerAreaEventBase) {
+  thrift::AreaConfig pod, plane;
+  *pod.area_id_ref() = "pod-area";
+  pod.neighbor_regexes_ref()->emplace_back(".*");
+  *plane.area_id_ref() = "plane-area";
+  plane.neighbor_regexes_ref()->emplace_back(".*");
+  AreaId podAreaId{pod.get_area_id()};
+  AreaId planeAreaId{plane.get_area_id()};
+
+  auto kvConf = getTestKvConf();
+  kvConf.enable_per_area_event_base_ref() = true;
+
+  auto storeA = createKvStore("storeA", kvConf, {pod});
+  auto storeB = createKvStore("storeB", kvConf, {pod, plane});
+  auto storeC = createKvStore("storeC", kvConf, {plane});
+
+  storeA->run();
+  storeB->run();
+  storeC->run();
+
+  storeA->addPeer(podAreaId, "storeB", storeB->getPeerSpec());
+  storeB->addPeer(podAreaId, "storeA", storeA->getPeerSpec());
+  storeB->addPeer(planeAreaId, "storeC", storeC->getPeerSpec());
+  storeC->addPeer(planeAreaId, "storeB", storeB->getPeerSpec());
+  waitForAllPeersInitialized();
+
+  const std::string podKey{"pod-area-0"};
+  const std::string planeKey{"plane-area-0"};
+  auto thriftVal = createThriftValue(
+      1 /* version */,
+      "storeA" /* originatorId */,
+      "value" /* value */,
+      Constants::kTtlInfinity /* ttl */);
+
+  EXPECT_TRUE(storeA->setKey(podAreaId, podKey, thriftVal));
+  EXPECT_TRUE(storeC->setKey(planeAreaId, planeKey, thriftVal));
+  waitForKeyInStoreWithTimeout(storeB, podAreaId, podKey);
+  waitForKeyInStoreWithTimeout(storeB, planeAreaId, planeKey);
+
+  // keys must not leak across areas
+  EXPECT_FALSE(storeB->getKey(planeAreaId, podKey).has_value());
+  EXPECT_FALSE(storeB->getKey(podAreaId, planeKey).has_value());
+  EXPECT_FALSE(storeA->getKey(podAreaId, planeKey).has_value());
+  EXPECT_FALSE(storeC->getKey(planeAreaId, podKey).has_value());
+
+  // summary carries one entry per area
+  auto summary = storeB->getSummary({});
+  ASSERT_EQ(2, summary.size());
+  EXPECT_EQ(1, summary.at(0).get_keyValsCount());
+  EXPECT_EQ(1, summary.at(1).get_keyValsCount());
+
+  // counters are summed across areas
+  auto counters = storeB->getCounters();
+  ASSERT_EQ(1, counters.count("kvstore.num_keys"));
+  EXPECT_EQ(2, counters.at("kvstore.num_keys"));
+  EXPECT_EQ(1, storeA->getCounters().at("kvstore.num_keys"));
+}
+
 /**
  * this is to verify correctness of 3-way full-sync between default and
  * non-default Areas. storeA is in kDefaultArea, while storeB is in areaB.
@@ -481,6 +481,102 @@ TEST_F(KvStoreThriftTestFixture, UnidirectionThriftFullSync) {
 // Simple Topology:
 //
 // node1 <---> node2
+//
+// Full-sync with a response larger than the merge chunk size
+//
+// 1) Start 2 kvStores, one of them with a few chunks worth of keys;
+// 2) Add peer in one direction;
+// 3) Make sure response is merged in chunks and all keys are synced;
+//
+TEST_F(SimpleKvStoreThriftTestFixture, ChunkedThriftFullSync) {
+  createSimpleThriftTestTopo();
+
+  auto store1 = stores_.front();
+  auto store2 = stores_.back();
+
+  const size_t numKeys = 3 * Constants::kFullSyncMergeChunkSize;
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < numKeys; ++i) {
+    keyVals.emplace_back(
+        "chunk-key" + std::to_string(i),
+        createThriftValue(1, store2->getNodeId(), std::string("value")));
+  }
+  EXPECT_TRUE(store2->setKeys(kTestingAreaName, keyVals));
+
+  const std::string numChunksCounter{
+      "kvstore.thrift.num_full_sync_chunks.count"};
+  const auto oldNumChunks =
+      facebook::fb303::fbData->getCounters()[numChunksCounter];
+
+  EXPECT_TRUE(store1->addPeer(
+      kTestingAreaName, store2->getNodeId(), store2->getPeerSpec()));
+  EXPECT_TRUE(verifyKvStorePeerState(
+      store1.get(),
+      store2->getNodeId(),
+      thrift::KvStorePeerState::INITIALIZED,
+      kTestingAreaName));
+
+  // key1 of store1, key2 and the keys set above of store2
+  EXPECT_EQ(numKeys + 2, store1->dumpAll(kTestingAreaName).size());
+  EXPECT_LE(
+      oldNumChunks + 3,
+      facebook::fb303::fbData->getCounters()[numChunksCounter]);
+}
+
+//
+// Peer flaps after initial full-sync. Next full-sync only exchanges the keys
+// changed since on both sides.
+//
+TEST_F(SimpleKvStoreThriftTestFixture, IncrementalThriftFullSync) {
+  createSimpleThriftTestTopo();
+
+  auto store1 = stores_.front();
+  auto store2 = stores_.back();
+
+  EXPECT_TRUE(store1->addPeer(
+      kTestingAreaName, store2->getNodeId(), store2->getPeerSpec()));
+  EXPECT_TRUE(verifyKvStorePeerState(
+      store1.get(),
+      store2->getNodeId(),
+      thrift::KvStorePeerState::INITIALIZED,
+      kTestingAreaName));
+  EXPECT_TRUE(
+      verifyKvStoreKeyVal(store1.get(), key2, thriftVal2, kTestingAreaName));
+  EXPECT_TRUE(
+      verifyKvStoreKeyVal(store2.get(), key1, thriftVal1, kTestingAreaName));
+
+  // keys change on both sides while the peer is down
+  EXPECT_TRUE(store1->delPeer(kTestingAreaName, store2->getNodeId()));
+  const auto thriftVal3 =
+      createThriftValue(1, store1->getNodeId(), std::string("value3"));
+  const auto thriftVal4 =
+      createThriftValue(1, store2->getNodeId(), std::string("value4"));
+  EXPECT_TRUE(store1->setKey(kTestingAreaName, "key3", thriftVal3));
+  EXPECT_TRUE(store2->setKey(kTestingAreaName, "key4", thriftVal4));
+
+  const std::string numIncrementalSyncCounter{
+      "kvstore.thrift.num_incremental_sync.count"};
+  const auto oldNumIncrementalSync =
+      facebook::fb303::fbData->getCounters()[numIncrementalSyncCounter];
+
+  EXPECT_TRUE(store1->addPeer(
+      kTestingAreaName, store2->getNodeId(), store2->getPeerSpec()));
+  EXPECT_TRUE(verifyKvStorePeerState(
+      store1.get(),
+      store2->getNodeId(),
+      thrift::KvStorePeerState::INITIALIZED,
+      kTestingAreaName));
+  EXPECT_TRUE(
+      verifyKvStoreKeyVal(store1.get(), "key4", thriftVal4, kTestingAreaName));
+  EXPECT_TRUE(
+      verifyKvStoreKeyVal(store2.get(), "key3", thriftVal3, kTestingAreaName));
+  EXPECT_EQ(4, store1->dumpAll(kTestingAreaName).size());
+  EXPECT_EQ(4, store2->dumpAll(kTestingAreaName).size());
+  EXPECT_EQ(
+      oldNumIncrementalSync + 1,
+      facebook::fb303::fbData->getCounters()[numIncrementalSyncCounter]);
+}
+
 //
 // A ---> B indicates: A has B as its thrift peer
 //
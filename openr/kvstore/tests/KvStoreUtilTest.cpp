@@ -9,6 +9,7 @@
 #include <thread>
 
 #include <fbzmq/zmq/Zmq.h>
+#include <fmt/format.h>
 #include <folly/init/Init.h>
 #include <glog/logging.h>
 #include <gmock/gmock.h>
@@ -22,6 +23,12 @@
 
 using namespace openr;
 
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
+
 namespace {
 // ttl used in test for (K,V) pair
 const std::chrono::milliseconds kTtl{1000};
@@ -160,6 +167,10 @@ TEST(KvStore, mergeKeyValuesTest) {
     myKvIt->second = thriftValue;
     newKvIt->second = thriftValue;
     newKvIt->second.value_ref() = "dummyValueTest";
+    newKvIt->second.hash_ref() = generateHash(
+        *newKvIt->second.version_ref(),
+        *newKvIt->second.originatorId_ref(),
+        newKvIt->second.value_ref());
     auto keyVals = KvStore::mergeKeyValues(myStore, newStore);
     EXPECT_EQ(myStore, newStore);
     EXPECT_EQ(keyVals, newStore);
@@ -170,6 +181,10 @@ TEST(KvStore, mergeKeyValuesTest) {
     myKvIt->second = thriftValue;
     newKvIt->second = thriftValue;
     newKvIt->second.value_ref() = "dummy";
+    newKvIt->second.hash_ref() = generateHash(
+        *newKvIt->second.version_ref(),
+        *newKvIt->second.originatorId_ref(),
+        newKvIt->second.value_ref());
     auto keyVals = KvStore::mergeKeyValues(myStore, newStore);
     EXPECT_EQ(myStore, oldStore);
     EXPECT_EQ(keyVals.size(), 0);
@@ -214,12 +229,38 @@ TEST(KvStore, mergeKeyValuesTest) {
     myKvIt->second = thriftValue;
     newKvIt->second = thriftValue;
     newKvIt->second.value_ref() = "dummy";
+    newKvIt->second.hash_ref() = generateHash(
+        *newKvIt->second.version_ref(),
+        *newKvIt->second.originatorId_ref(),
+        newKvIt->second.value_ref());
     (*newKvIt->second.ttlVersion_ref())++;
     auto keyVals = KvStore::mergeKeyValues(myStore, newStore);
     EXPECT_EQ(myStore, oldStore);
     EXPECT_EQ(keyVals.size(), 0);
   }
 
+  // same hash means same value, bytes are not compared
+  {
+    myKvIt->second = thriftValue;
+    newKvIt->second = thriftValue;
+    newKvIt->second.value_ref() = "dummyValueTest";
+    auto keyVals = KvStore::mergeKeyValues(myStore, newStore);
+    EXPECT_EQ(myStore, oldStore);
+    EXPECT_EQ(keyVals.size(), 0);
+  }
+
+  // update is announced with the hash of the stored value
+  {
+    myKvIt->second = thriftValue;
+    newKvIt->second = thriftValue;
+    newKvIt->second.hash_ref().reset();
+    (*newKvIt->second.version_ref())++;
+    auto keyVals = KvStore::mergeKeyValues(myStore, newStore);
+    ASSERT_EQ(1, keyVals.count(key));
+    EXPECT_TRUE(myKvIt->second.hash_ref().has_value());
+    EXPECT_EQ(myKvIt->second.hash_ref(), keyVals.at(key).hash_ref());
+  }
+
   // bogus ttl value (see it should get ignored)
   {
     std::unordered_map<std::string, thrift::Value> emptyStore;
@@ -231,6 +272,492 @@ TEST(KvStore, mergeKeyValuesTest) {
   }
 }
 
+//
+// validate KvStoreKeyIndex maintained by mergeKeyValues narrows down filters
+// to the matching keys
+//
+TEST(KvStore, keyIndexTest) {
+  std::unordered_map<std::string, thrift::Value> store;
+  KvStoreKeyIndex keyIndex;
+  auto merge = [&](std::string const& key, std::string const& node) {
+    auto value = createThriftValue(1, node, "value", 3600, 0);
+    if (store.count(key)) {
+      value.version_ref() = *store.at(key).version_ref() + 1;
+    }
+    KvStore::mergeKeyValues(
+        store, {{key, value}}, std::nullopt, nullptr, false, &keyIndex);
+  };
+  merge("adj:node1", "node1");
+  merge("adj:node2", "node2");
+  merge("prefix:node1", "node1");
+  merge("prefix:node2", "node2");
+  merge("adjacent", "node3");
+
+  auto candidates = [&](KvStoreFilters const& filters,
+                        thrift::FilterOperator oper) {
+    std::vector<std::string> keys;
+    EXPECT_TRUE(keyIndex.forEachCandidate(
+        filters, oper, [&](std::string const& key) { keys.push_back(key); }));
+    return keys;
+  };
+
+  // overlapping literal prefixes are scanned once
+  KvStoreFilters adjFilters({"adj:", "adj:node1"}, {});
+  EXPECT_FALSE(adjFilters.hasKeyRegex());
+  EXPECT_THAT(adjFilters.getLiteralKeyPrefixes(), ElementsAre("adj:"));
+  EXPECT_THAT(
+      candidates(adjFilters, thrift::FilterOperator::OR),
+      ElementsAre("adj:node1", "adj:node2"));
+
+  // OR adds keys of the originator not covered by the prefixes
+  KvStoreFilters orFilters({"adj:"}, {"node1"});
+  EXPECT_THAT(
+      candidates(orFilters, thrift::FilterOperator::OR),
+      UnorderedElementsAreArray({"adj:node1", "adj:node2", "prefix:node1"}));
+
+  // AND looks up the originator only, prefixes are matched by the caller
+  EXPECT_THAT(
+      candidates(orFilters, thrift::FilterOperator::AND),
+      UnorderedElementsAreArray({"adj:node1", "prefix:node1"}));
+
+  // regex prefixes and empty filters can't use the index
+  KvStoreFilters regexFilters({"adj:node[12]"}, {});
+  EXPECT_TRUE(regexFilters.hasKeyRegex());
+  EXPECT_TRUE(regexFilters.keyPrefixMatch("adj:node2"));
+  EXPECT_FALSE(regexFilters.keyPrefixMatch("adj:node3"));
+  EXPECT_FALSE(keyIndex.forEachCandidate(
+      regexFilters, thrift::FilterOperator::OR, [](std::string const&) {}));
+  EXPECT_FALSE(keyIndex.forEachCandidate(
+      KvStoreFilters({}, {}),
+      thrift::FilterOperator::OR,
+      [](std::string const&) {}));
+
+  // new originator of a key moves it in the index
+  merge("prefix:node1", "node2");
+  EXPECT_THAT(
+      candidates(KvStoreFilters({}, {"node1"}), thrift::FilterOperator::OR),
+      ElementsAre("adj:node1"));
+
+  // removed keys are gone from both indexes
+  keyIndex.remove("adj:node1", store.at("adj:node1"));
+  EXPECT_THAT(
+      candidates(adjFilters, thrift::FilterOperator::OR),
+      ElementsAre("adj:node2"));
+  EXPECT_THAT(
+      candidates(KvStoreFilters({}, {"node1"}), thrift::FilterOperator::OR),
+      IsEmpty());
+}
+
+//
+// validate KvStoreBucketHashes maintained by mergeKeyValues
+//
+TEST(KvStore, bucketHashesTest) {
+  std::unordered_map<std::string, thrift::Value> keyVals;
+  for (int i = 0; i < 100; ++i) {
+    keyVals.emplace(
+        "key" + std::to_string(i),
+        createThriftValue(
+            1, /* version */
+            "node1", /* node id */
+            "value" + std::to_string(i),
+            3600, /* ttl */
+            0 /* ttl version */));
+  }
+
+  // same key-values merged in different order result in the same hashes
+  std::unordered_map<std::string, thrift::Value> store1, store2;
+  KvStoreBucketHashes hashes1(64), hashes2(64);
+  KvStore::mergeKeyValues(store1, keyVals, std::nullopt, &hashes1);
+  for (auto const& [key, value] : keyVals) {
+    KvStore::mergeKeyValues(store2, {{key, value}}, std::nullopt, &hashes2);
+  }
+  EXPECT_EQ(hashes1.getHashes(), hashes2.getHashes());
+  EXPECT_THAT(hashes1.getDifferingBuckets(hashes2.getHashes()), IsEmpty());
+  EXPECT_LT(0, hashes1.getNumBytes());
+  EXPECT_EQ(hashes1.getNumBytes(), hashes2.getNumBytes());
+
+  // newer version of one key
+  auto value = keyVals.at("key7");
+  (*value.version_ref())++;
+  value.hash_ref().reset();
+  KvStore::mergeKeyValues(store2, {{"key7", value}}, std::nullopt, &hashes2);
+  EXPECT_THAT(
+      hashes1.getDifferingBuckets(hashes2.getHashes()),
+      ElementsAre(hashes1.getBucket("key7")));
+
+  // ttl update of another key
+  value = store2.at("key8");
+  (*value.ttlVersion_ref())++;
+  value.value_ref().reset();
+  KvStore::mergeKeyValues(store2, {{"key8", value}}, std::nullopt, &hashes2);
+  EXPECT_THAT(
+      hashes1.getDifferingBuckets(hashes2.getHashes()),
+      UnorderedElementsAreArray(std::set<int32_t>{
+          hashes1.getBucket("key7"), hashes1.getBucket("key8")}));
+
+  // catching up brings hashes back in sync
+  KvStore::mergeKeyValues(store1, store2, std::nullopt, &hashes1);
+  EXPECT_EQ(store1, store2);
+  EXPECT_EQ(hashes1.getHashes(), hashes2.getHashes());
+  EXPECT_EQ(hashes1.getNumBytes(), hashes2.getNumBytes());
+
+  // removing all keys leaves empty buckets
+  for (auto const& [key, val] : store1) {
+    hashes1.remove(key, val);
+  }
+  EXPECT_EQ(KvStoreBucketHashes(64).getHashes(), hashes1.getHashes());
+  EXPECT_EQ(0, hashes1.getNumBytes());
+
+  // different number of buckets, all of them differ
+  EXPECT_THAT(
+      KvStoreBucketHashes(32).getDifferingBuckets(hashes2.getHashes()),
+      SizeIs(32));
+}
+
+TEST(KvStore, changeLogTest) {
+  KvStoreChangeLog changeLog(4);
+  EXPECT_EQ(0, changeLog.getSequence());
+  EXPECT_TRUE(changeLog.covers(0));
+  EXPECT_THAT(changeLog.getKeysSince(0), IsEmpty());
+
+  changeLog.add("key1");
+  changeLog.add("key2");
+  changeLog.add("key1");
+  EXPECT_EQ(3, changeLog.getSequence());
+  EXPECT_THAT(
+      changeLog.getKeysSince(0), UnorderedElementsAre("key1", "key2"));
+  EXPECT_THAT(changeLog.getKeysSince(2), UnorderedElementsAre("key1"));
+  EXPECT_THAT(changeLog.getKeysSince(3), IsEmpty());
+  // sequence numbers not handed out yet
+  EXPECT_FALSE(changeLog.covers(4));
+
+  // log is full, oldest changes are dropped
+  changeLog.add("key3");
+  changeLog.add("key4");
+  EXPECT_EQ(5, changeLog.getSequence());
+  EXPECT_FALSE(changeLog.covers(0));
+  EXPECT_TRUE(changeLog.covers(1));
+  EXPECT_THAT(
+      changeLog.getKeysSince(1),
+      UnorderedElementsAre("key1", "key2", "key3", "key4"));
+  EXPECT_THAT(
+      changeLog.getKeysSince(3), UnorderedElementsAre("key3", "key4"));
+}
+
+TEST(KvStore, keyClassesTest) {
+  thrift::KvstoreKeyClass adjClass;
+  adjClass.name_ref() = "adj";
+  adjClass.key_prefixes_ref() = {"adj:"};
+  thrift::KvstoreKeyClass prefixClass;
+  prefixClass.name_ref() = "prefix";
+  prefixClass.key_prefixes_ref() = {"prefix:", "adj:prefix"};
+  KvStoreKeyClasses keyClasses({adjClass, prefixClass});
+  EXPECT_EQ(3, keyClasses.size());
+  EXPECT_EQ("default", keyClasses.getName(2));
+
+  // first class with a matching prefix
+  EXPECT_EQ(0, keyClasses.getClass("adj:node1"));
+  EXPECT_EQ(0, keyClasses.getClass("adj:prefix"));
+  EXPECT_EQ(1, keyClasses.getClass("prefix:node1"));
+  EXPECT_EQ(2, keyClasses.getClass("key1"));
+  EXPECT_EQ(0, KvStoreKeyClasses().getClass("adj:node1"));
+
+  thrift::Publication publication;
+  publication.area_ref() = "area1";
+  publication.floodRootId_ref() = "node1";
+  auto& keyVals = *publication.keyVals_ref();
+  keyVals.emplace("key1", createThriftValue(1, "node1", "value1"));
+  keyVals.emplace("prefix:node1", createThriftValue(1, "node1", "value2"));
+  publication.expiredKeys_ref() = {"adj:node2"};
+
+  // one publication per class, highest priority first
+  auto pubs = keyClasses.split(thrift::Publication(publication));
+  ASSERT_THAT(pubs, SizeIs(3));
+  EXPECT_THAT(*pubs.at(0).keyVals_ref(), IsEmpty());
+  EXPECT_THAT(*pubs.at(0).expiredKeys_ref(), ElementsAre("adj:node2"));
+  EXPECT_THAT(*pubs.at(1).keyVals_ref(), SizeIs(1));
+  EXPECT_EQ(1, pubs.at(1).keyVals_ref()->count("prefix:node1"));
+  EXPECT_THAT(*pubs.at(2).keyVals_ref(), SizeIs(1));
+  EXPECT_EQ(1, pubs.at(2).keyVals_ref()->count("key1"));
+  for (auto const& pub : pubs) {
+    EXPECT_EQ("area1", *pub.area_ref());
+    EXPECT_EQ("node1", pub.floodRootId_ref().value_or(""));
+  }
+
+  // keys of a single class, returned as is
+  publication.expiredKeys_ref()->clear();
+  keyVals.erase("key1");
+  pubs = keyClasses.split(thrift::Publication(publication));
+  ASSERT_THAT(pubs, SizeIs(1));
+  EXPECT_EQ(publication, pubs.at(0));
+}
+
+TEST(KvStore, clientIndexTest) {
+  messaging::ReplicateQueue<thrift::Publication> updatesQueue;
+  KvStoreClientIndex clientIndex(updatesQueue);
+  auto [id1, reader1] = clientIndex.addClient();
+  auto [id2, reader2] = clientIndex.addClient();
+  clientIndex.addKey(id1, "key1");
+  clientIndex.addKey(id2, "key1");
+  clientIndex.addKey(id2, "key2");
+  clientIndex.setFilter(id1, KvStoreFilters({"prefix:"}, {}));
+
+  thrift::Publication publication;
+  publication.area_ref() = "area1";
+  auto& keyVals = *publication.keyVals_ref();
+  keyVals.emplace("key1", createThriftValue(1, "node1", "value1"));
+  keyVals.emplace("key2", createThriftValue(1, "node1", "value2"));
+  keyVals.emplace("key3", createThriftValue(1, "node1", "value3"));
+  keyVals.emplace("prefix:key", createThriftValue(1, "node1", "value4"));
+  // TTL update
+  keyVals.emplace("prefix:ttl", createThriftValue(1, "node1", std::nullopt));
+  publication.expiredKeys_ref() = std::vector<std::string>{"key2", "key4"};
+  clientIndex.dispatch(publication);
+
+  auto pub1 = reader1.get().value();
+  EXPECT_EQ("area1", pub1.get_area());
+  EXPECT_THAT(
+      folly::gen::from(*pub1.keyVals_ref()) | folly::gen::get<0>() |
+          folly::gen::as<std::vector<std::string>>(),
+      UnorderedElementsAre("key1", "prefix:key"));
+  EXPECT_THAT(*pub1.expiredKeys_ref(), IsEmpty());
+
+  auto pub2 = reader2.get().value();
+  EXPECT_THAT(
+      folly::gen::from(*pub2.keyVals_ref()) | folly::gen::get<0>() |
+          folly::gen::as<std::vector<std::string>>(),
+      UnorderedElementsAre("key1", "key2"));
+  EXPECT_THAT(*pub2.expiredKeys_ref(), ElementsAre("key2"));
+
+  // nothing of interest, nothing delivered
+  clientIndex.removeKey(id2, "key1");
+  clientIndex.removeKey(id2, "key2");
+  clientIndex.dispatch(publication);
+  EXPECT_EQ(1, reader1.size());
+  EXPECT_EQ(0, reader2.size());
+
+  // readers are closed along with the updates queue
+  updatesQueue.close();
+  EXPECT_TRUE(reader1.get().hasError());
+  EXPECT_TRUE(reader2.get().hasError());
+}
+
+TEST(KvStore, valuePatchTest) {
+  const std::string data(1000, 'a');
+  auto base = createThriftValue(1, "node1", data);
+  base.hash_ref() =
+      generateHash(*base.version_ref(), *base.originatorId_ref(), data);
+
+  // one byte changed in the middle
+  auto newData = data;
+  newData[500] = 'b';
+  auto value = createThriftValue(2, "node1", newData);
+  value.hash_ref() =
+      generateHash(*value.version_ref(), *value.originatorId_ref(), newData);
+
+  auto patch = KvStore::createValuePatch(base, value);
+  ASSERT_TRUE(patch.has_value());
+  EXPECT_EQ(1, *patch->baseVersion_ref());
+  EXPECT_EQ("b", *patch->middle_ref());
+
+  // flooded form carries the patch only
+  auto patched = value;
+  patched.value_ref().reset();
+  patched.patch_ref() = *patch;
+  EXPECT_TRUE(KvStore::applyValuePatch(base, patched));
+  EXPECT_EQ(value, patched);
+
+  // wrong base version
+  patched.value_ref().reset();
+  patched.patch_ref() = *patch;
+  auto otherBase = base;
+  otherBase.version_ref() = 3;
+  EXPECT_FALSE(KvStore::applyValuePatch(otherBase, patched));
+  EXPECT_FALSE(patched.value_ref().has_value());
+
+  // result doesn't match hash
+  patched.hash_ref() = *value.hash_ref() + 1;
+  EXPECT_FALSE(KvStore::applyValuePatch(base, patched));
+
+  // no patch if most of the data changed
+  auto otherValue = createThriftValue(2, "node1", std::string(1000, 'c'));
+  otherValue.hash_ref() = generateHash(
+      *otherValue.version_ref(),
+      *otherValue.originatorId_ref(),
+      otherValue.value_ref());
+  EXPECT_FALSE(KvStore::createValuePatch(base, otherValue).has_value());
+
+  // mergeKeyValues attaches patches on request only, the store never has them
+  std::unordered_map<std::string, thrift::Value> store{{"key", base}};
+  auto updates = KvStore::mergeKeyValues(
+      store, {{"key", value}}, std::nullopt, nullptr, true);
+  ASSERT_EQ(1, updates.count("key"));
+  EXPECT_TRUE(updates.at("key").patch_ref().has_value());
+  EXPECT_FALSE(store.at("key").patch_ref().has_value());
+  EXPECT_EQ(newData, *store.at("key").value_ref());
+}
+
+TEST(KvStore, valueCompressionTest) {
+  std::string data;
+  for (int i = 0; i < 200; ++i) {
+    data += fmt::format("adj:node{}:iface{};", i % 10, i);
+  }
+  auto value = createThriftValue(1, "node1", data);
+  auto compressed = value;
+  ASSERT_TRUE(KvStore::compressValue(compressed));
+  EXPECT_FALSE(compressed.value_ref().has_value());
+  ASSERT_TRUE(compressed.compressedValue_ref().has_value());
+  EXPECT_LT(compressed.compressedValue_ref()->size(), data.size());
+  // hash of the uncompressed data is set along with it
+  EXPECT_EQ(
+      generateHash(1, "node1", data), compressed.hash_ref().value_or(0));
+
+  auto decompressed = compressed;
+  EXPECT_TRUE(KvStore::decompressValue(decompressed));
+  EXPECT_EQ(data, *decompressed.value_ref());
+  EXPECT_FALSE(decompressed.compressedValue_ref().has_value());
+
+  // decompressed data doesn't match hash
+  auto corrupted = compressed;
+  corrupted.hash_ref() = *compressed.hash_ref() + 1;
+  EXPECT_FALSE(KvStore::decompressValue(corrupted));
+  EXPECT_FALSE(corrupted.value_ref().has_value());
+
+  // not compressed data
+  corrupted = compressed;
+  corrupted.compressedValue_ref() = "garbage";
+  EXPECT_FALSE(KvStore::decompressValue(corrupted));
+
+  // small values are sent as is
+  auto small = createThriftValue(1, "node1", "value");
+  EXPECT_FALSE(KvStore::compressValue(small));
+  EXPECT_EQ("value", *small.value_ref());
+}
+
+TEST(KvStore, mergeFloodParamsTest) {
+  thrift::KeySetParams queued;
+  queued.keyVals_ref() = {
+      {"key1", createThriftValue(1, "node1", "value1", 1000, 1)},
+      {"key2", createThriftValue(1, "node1", "value2", 1000, 1)}};
+  queued.nodeIds_ref() = std::vector<std::string>{"node1"};
+  queued.timestamp_ms_ref() = 1;
+
+  // newer value of key1, ttl refresh of key2 and a new key
+  thrift::KeySetParams params;
+  params.keyVals_ref() = {
+      {"key1", createThriftValue(2, "node1", "value1b", 1000, 1)},
+      {"key2", createThriftValue(1, "node1", std::nullopt, 2000, 2)},
+      {"key3", createThriftValue(1, "node1", "value3", 1000, 1)}};
+  params.nodeIds_ref() = std::vector<std::string>{"node1"};
+  params.timestamp_ms_ref() = 2;
+  EXPECT_TRUE(KvStore::mergeFloodParams(queued, params));
+  ASSERT_EQ(3, queued.keyVals_ref()->size());
+  EXPECT_EQ("value1b", *queued.keyVals_ref()->at("key1").value_ref());
+  auto const& key2 = queued.keyVals_ref()->at("key2");
+  EXPECT_EQ("value2", *key2.value_ref());
+  EXPECT_EQ(2000, *key2.ttl_ref());
+  EXPECT_EQ(2, *key2.ttlVersion_ref());
+  EXPECT_EQ(2, *queued.timestamp_ms_ref());
+
+  const auto merged = queued;
+
+  // ttl refresh of another version
+  thrift::KeySetParams refresh;
+  refresh.keyVals_ref() = {
+      {"key1", createThriftValue(3, "node1", std::nullopt, 2000, 2)}};
+  refresh.nodeIds_ref() = std::vector<std::string>{"node1"};
+  EXPECT_FALSE(KvStore::mergeFloodParams(queued, refresh));
+
+  // patch of a queued key
+  thrift::KeySetParams patch;
+  patch.keyVals_ref() = {
+      {"key1", createThriftValue(3, "node1", std::nullopt, 1000, 1)}};
+  patch.keyVals_ref()->at("key1").patch_ref() = thrift::ValuePatch();
+  patch.nodeIds_ref() = std::vector<std::string>{"node1"};
+  EXPECT_FALSE(KvStore::mergeFloodParams(queued, patch));
+
+  // flooded on another path
+  params.nodeIds_ref() = std::vector<std::string>{"node2", "node1"};
+  EXPECT_FALSE(KvStore::mergeFloodParams(queued, params));
+  EXPECT_EQ(merged, queued);
+}
+
+TEST(KvStore, snapshotEncodingTest) {
+  thrift::KvStoreSnapshot snapshot;
+  snapshot.area_ref() = "area1";
+  snapshot.timestamp_ms_ref() = 12345;
+  snapshot.keyVals_ref()->emplace("key1", createThriftValue(1, "node1", "a"));
+  snapshot.keyVals_ref()->emplace(
+      "key2", createThriftValue(2, "node2", "b", 3600 * 1000));
+  const auto data = KvStore::encodeSnapshot(snapshot);
+
+  auto decoded = KvStore::decodeSnapshot(data);
+  ASSERT_TRUE(decoded.has_value());
+  EXPECT_EQ(snapshot, *decoded);
+
+  // payload doesn't match checksum
+  auto corrupted = data;
+  corrupted.back() ^= 0xff;
+  EXPECT_FALSE(KvStore::decodeSnapshot(corrupted).has_value());
+
+  // not a snapshot
+  EXPECT_FALSE(KvStore::decodeSnapshot("garbage").has_value());
+  EXPECT_FALSE(KvStore::decodeSnapshot("").has_value());
+  corrupted = data;
+  corrupted.front() = 'X';
+  EXPECT_FALSE(KvStore::decodeSnapshot(corrupted).has_value());
+}
+
+TEST(KvStore, ttlCountdownWheelTest) {
+  using std::chrono::milliseconds;
+  const auto start = std::chrono::steady_clock::now();
+  TtlCountdownWheel wheel(milliseconds(1), start);
+
+  auto makeEntry = [&](std::string const& key, milliseconds ttl) {
+    TtlCountdownQueueEntry entry;
+    entry.key = key;
+    entry.expiryTime = start + ttl;
+    return entry;
+  };
+  auto expiredKeys = [&](milliseconds elapsed) {
+    std::vector<std::string> keys;
+    for (auto const& entry : wheel.advance(start + elapsed)) {
+      keys.emplace_back(entry.key);
+    }
+    return keys;
+  };
+
+  // keys on every level of the wheel
+  wheel.schedule(makeEntry("key1", milliseconds(10)));
+  wheel.schedule(makeEntry("key2", milliseconds(300)));
+  wheel.schedule(makeEntry("key3", milliseconds(70000)));
+  wheel.schedule(makeEntry("key4", milliseconds(20)));
+  EXPECT_EQ(4, wheel.size());
+  EXPECT_EQ(start + milliseconds(10), wheel.getNextWakeup());
+
+  // refresh moves key4 instead of adding another entry
+  wheel.schedule(makeEntry("key4", milliseconds(400)));
+  EXPECT_EQ(4, wheel.size());
+  ASSERT_NE(nullptr, wheel.find("key4"));
+  EXPECT_EQ(start + milliseconds(400), wheel.find("key4")->expiryTime);
+
+  EXPECT_THAT(expiredKeys(milliseconds(9)), IsEmpty());
+  EXPECT_THAT(expiredKeys(milliseconds(30)), ElementsAre("key1"));
+  EXPECT_EQ(nullptr, wheel.find("key1"));
+
+  // entries expiring together are returned in expiry order
+  EXPECT_THAT(expiredKeys(milliseconds(1000)), ElementsAre("key2", "key4"));
+
+  wheel.erase("key3");
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(std::nullopt, wheel.getNextWakeup());
+  EXPECT_THAT(expiredKeys(milliseconds(100000)), IsEmpty());
+
+  // expiry in the past is due on the next advance
+  wheel.schedule(makeEntry("key5", milliseconds(0)));
+  EXPECT_THAT(expiredKeys(milliseconds(100001)), ElementsAre("key5"));
+}
+
 //
 // Test compareValues method
 //
@@ -398,6 +925,48 @@ TEST_F(MultipleKvStoreTestFixture, dumpAllTest) {
   }
 }
 
+//
+// Test dumpAllWithThriftClient API reuses clients of a pool
+//
+TEST_F(MultipleKvStoreTestFixture, dumpAllPooledTest) {
+  std::vector<folly::SocketAddress> sockAddrs;
+  for (auto port :
+       {kvStoreWrapper1_->getThriftPort(), kvStoreWrapper2_->getThriftPort()}) {
+    sockAddrs.push_back(
+        folly::SocketAddress{Constants::kPlatformHost.toString(), port});
+  }
+
+  folly::EventBase clientEvb;
+  int numCreated{0};
+  auto factory = getOpenrCtrlClientFactory(clientEvb);
+  OpenrCtrlClientPool pool(
+      [&](const folly::SocketAddress& sockAddr) {
+        ++numCreated;
+        return factory(sockAddr);
+      });
+
+  // clients are created once and reused by subsequent dumps
+  for (int i = 0; i < 3; ++i) {
+    const auto [db, unreachableAddrs] = dumpAllWithThriftClientFromMultiple(
+        clientEvb, pool, kTestingAreaName, sockAddrs, "");
+    ASSERT_TRUE(db.has_value());
+    EXPECT_TRUE(unreachableAddrs.empty());
+  }
+  EXPECT_EQ(2, numCreated);
+  EXPECT_EQ(2, pool.size());
+
+  // clients of failed calls are dropped
+  kvStoreWrapper1_->closeQueue();
+  kvStoreWrapper2_->closeQueue();
+  kvStoreWrapper1_->stopThriftServer();
+  kvStoreWrapper2_->stopThriftServer();
+  const auto [db, _] = dumpAllWithThriftClientFromMultiple(
+      clientEvb, pool, kTestingAreaName, sockAddrs, "");
+  ASSERT_TRUE(db.has_value());
+  EXPECT_TRUE(db.value().empty());
+  EXPECT_EQ(0, pool.size());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
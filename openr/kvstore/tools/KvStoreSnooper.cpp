@@ -5,23 +5,268 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cstring>
 #include <iostream>
+#include <set>
+#include <thread>
 
+#include <fmt/format.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
 #include <folly/init/Init.h>
+#include <folly/lang/Bits.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/OpenrClient.h>
+#include <openr/config/tests/Utils.h>
+#include <openr/decision/Decision.h>
 #include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStoreWrapper.h>
 
 DEFINE_string(host, "::1", "Host to connect to");
 DEFINE_int32(port, openr::Constants::kOpenrCtrlPort, "OpenrCtrl server port");
 DEFINE_int32(connect_timeout_ms, 1000, "Connect timeout for client");
 DEFINE_int32(processing_timeout_ms, 5000, "Processing timeout for client");
+DEFINE_string(
+    record_file,
+    "",
+    "Record the publications to this file instead of printing them");
+DEFINE_string(
+    replay_file,
+    "",
+    "Replay the publications recorded in this file into a local KvStore and "
+    "Decision instead of connecting to host");
+DEFINE_double(
+    replay_speed,
+    1,
+    "Speed-up of the replay over the recorded timing, 0 to replay as fast as "
+    "possible");
+
+namespace {
+
+/*
+ * Layout of a recorded log, all integers big-endian:
+ *   kLogMarker | u32 length | name of the recorded node
+ * followed by one record per publication:
+ *   i64 unix timestamp in ms | u32 length | compact serialized Publication
+ * Records carry their length, a log can be skipped through without
+ * deserializing the publications.
+ */
+const std::string kLogMarker{"OPENR_KVSTORE_LOG_V1"};
+const size_t kRecordHeaderSize{sizeof(int64_t) + sizeof(uint32_t)};
+
+template <typename T>
+void
+appendBigEndian(std::string& buf, T val) {
+  val = folly::Endian::big(val);
+  buf.append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+template <typename T>
+T
+readBigEndian(std::string const& buf, size_t offset) {
+  T val;
+  std::memcpy(&val, buf.data() + offset, sizeof(val));
+  return folly::Endian::big(val);
+}
+
+class KvStoreLogWriter {
+ public:
+  KvStoreLogWriter(std::string const& path, std::string const& nodeName)
+      : file_(path, O_WRONLY | O_CREAT | O_TRUNC, 0666) {
+    std::string header{kLogMarker};
+    appendBigEndian<uint32_t>(header, nodeName.size());
+    header.append(nodeName);
+    write(header);
+  }
+
+  void
+  append(openr::thrift::Publication const& pub) {
+    const auto payload =
+        apache::thrift::CompactSerializer::serialize<std::string>(pub);
+    std::string record;
+    record.reserve(kRecordHeaderSize + payload.size());
+    appendBigEndian<int64_t>(record, openr::getUnixTimeStampMs());
+    appendBigEndian<uint32_t>(record, payload.size());
+    record.append(payload);
+    write(record);
+  }
+
+ private:
+  void
+  write(std::string const& data) {
+    // one write per record, a killed recorder leaves only complete records
+    if (folly::writeFull(file_.fd(), data.data(), data.size()) < 0) {
+      throw std::runtime_error(
+          fmt::format("Failed to write log: {}", folly::errnoStr(errno)));
+    }
+  }
+
+  folly::File file_;
+};
+
+struct KvStoreLogRecord {
+  int64_t timestampMs{0};
+  openr::thrift::Publication publication;
+};
+
+struct KvStoreLog {
+  std::string nodeName;
+  std::vector<KvStoreLogRecord> records;
+};
+
+KvStoreLog
+readKvStoreLog(std::string const& path) {
+  std::string data;
+  if (not folly::readFile(path.c_str(), data)) {
+    throw std::runtime_error(fmt::format(
+        "Failed to read {}: {}", path, folly::errnoStr(errno)));
+  }
+  size_t offset = kLogMarker.size() + sizeof(uint32_t);
+  if (data.size() < offset or
+      data.compare(0, kLogMarker.size(), kLogMarker) != 0) {
+    throw std::runtime_error(fmt::format("{} is not a KvStore log", path));
+  }
+  KvStoreLog log;
+  const auto nameSize = readBigEndian<uint32_t>(data, kLogMarker.size());
+  log.nodeName = data.substr(offset, nameSize);
+  offset += nameSize;
+
+  while (offset + kRecordHeaderSize <= data.size()) {
+    KvStoreLogRecord record;
+    record.timestampMs = readBigEndian<int64_t>(data, offset);
+    const auto size = readBigEndian<uint32_t>(data, offset + sizeof(int64_t));
+    offset += kRecordHeaderSize;
+    if (offset + size > data.size()) {
+      LOG(WARNING) << "Ignoring truncated record at the end of " << path;
+      break;
+    }
+    record.publication = apache::thrift::CompactSerializer::deserialize<
+        openr::thrift::Publication>(folly::StringPiece(data, offset, size));
+    offset += size;
+    log.records.emplace_back(std::move(record));
+  }
+  return log;
+}
+
+/*
+ * Feed the recorded publications into a KvStore, with Decision computing
+ * routes of the recorded node off its updates, keeping the recorded pace
+ * scaled by FLAGS_replay_speed.
+ */
+int
+replay() {
+  auto log = readKvStoreLog(FLAGS_replay_file);
+  LOG(INFO) << "Replaying " << log.records.size() << " publications of "
+            << log.nodeName;
+  if (log.records.empty()) {
+    return 0;
+  }
+
+  std::set<std::string> areas;
+  for (auto const& record : log.records) {
+    areas.emplace(*record.publication.area_ref());
+  }
+  std::vector<openr::thrift::AreaConfig> areaConfigs;
+  for (auto const& area : areas) {
+    areaConfigs.emplace_back(createAreaConfig(area, {".*"}, {".*"}));
+  }
+  auto config = std::make_shared<openr::Config>(
+      getBasicOpenrConfig(log.nodeName, "domain", areaConfigs));
+
+  fbzmq::Context context;
+  openr::KvStoreWrapper kvStore(context, config);
+  kvStore.run();
+
+  openr::messaging::ReplicateQueue<openr::DecisionRouteUpdate>
+      staticRouteUpdatesQueue;
+  openr::messaging::ReplicateQueue<openr::DecisionRouteUpdate>
+      routeUpdatesQueue;
+  openr::Decision decision(
+      config,
+      true, /* enableBgpRouteProgramming */
+      kvStore.getReader(),
+      staticRouteUpdatesQueue.getReader(),
+      routeUpdatesQueue);
+  std::thread decisionThread([&decision]() { decision.run(); });
+  decision.waitUntilRunning();
+
+  size_t numRouteUpdates{0};
+  size_t numRoutesChanged{0};
+  std::thread routeReaderThread(
+      [&numRouteUpdates,
+       &numRoutesChanged,
+       reader = routeUpdatesQueue.getReader()]() mutable {
+        while (true) {
+          auto maybeUpdate = reader.get();
+          if (maybeUpdate.hasError()) {
+            break;
+          }
+          ++numRouteUpdates;
+          numRoutesChanged += maybeUpdate->unicastRoutesToUpdate.size() +
+              maybeUpdate->unicastRoutesToDelete.size();
+        }
+      });
+
+  const auto startTs = std::chrono::steady_clock::now();
+  const auto firstTimestampMs = log.records.front().timestampMs;
+  size_t numKeyVals{0};
+  for (auto& record : log.records) {
+    if (FLAGS_replay_speed > 0) {
+      std::this_thread::sleep_until(
+          startTs +
+          std::chrono::milliseconds(static_cast<int64_t>(
+              (record.timestampMs - firstTimestampMs) / FLAGS_replay_speed)));
+    }
+    auto& pub = record.publication;
+    std::vector<std::pair<std::string, openr::thrift::Value>> keyVals;
+    for (auto& [key, value] : *pub.keyVals_ref()) {
+      keyVals.emplace_back(key, std::move(value));
+    }
+    numKeyVals += keyVals.size();
+    // expired keys of the recording expire in the local store on their own
+    if (not keyVals.empty()) {
+      kvStore.setKeys(openr::AreaId{*pub.area_ref()}, keyVals);
+    }
+  }
+  const auto replayDuration = std::chrono::steady_clock::now() - startTs;
+
+  // let Decision process the last updates
+  std::this_thread::sleep_for(std::chrono::milliseconds(
+      2 * *config->getConfig().decision_config_ref()->debounce_max_ms_ref()));
+
+  kvStore.closeQueue();
+  staticRouteUpdatesQueue.close();
+  routeUpdatesQueue.close();
+  decision.stop();
+  decisionThread.join();
+  routeReaderThread.join();
+  kvStore.stop();
+
+  std::cout << "Replayed publications: " << log.records.size() << std::endl;
+  std::cout << "Replayed key-values: " << numKeyVals << std::endl;
+  std::cout << "Replay duration (ms): "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   replayDuration)
+                   .count()
+            << std::endl;
+  std::cout << "Route updates: " << numRouteUpdates << std::endl;
+  std::cout << "Routes changed: " << numRoutesChanged << std::endl;
+  return 0;
+}
+
+} // namespace
 
 int
 main(int argc, char** argv) {
   // Initialize all params
   folly::init(&argc, &argv);
 
+  if (not FLAGS_replay_file.empty()) {
+    return replay();
+  }
+
   // Define and start event base
   folly::EventBase evb;
   std::thread evbThread([&evb]() { evb.loopForever(); });
@@ -40,10 +285,21 @@ main(int argc, char** argv) {
       std::unordered_map<std::string /* key */, openr::thrift::Value>>
       areaKeyVals;
   LOG(INFO) << "Stream is connected, updates will follow";
+
+  // Record the initial dumps as the first publications
+  std::shared_ptr<KvStoreLogWriter> logWriter;
+  if (not FLAGS_record_file.empty()) {
+    logWriter = std::make_shared<KvStoreLogWriter>(
+        FLAGS_record_file, client->semifuture_getMyNodeName().get());
+    LOG(INFO) << "Recording publications to " << FLAGS_record_file;
+  }
   for (auto const& pub : response.response) {
     LOG(INFO) << "Received " << pub.get_keyVals().size()
               << " entries in initial dump for area: " << pub.get_area();
     areaKeyVals[pub.get_area()] = pub.get_keyVals();
+    if (logWriter) {
+      logWriter->append(pub);
+    }
   }
   LOG(INFO) << "";
 
@@ -51,13 +307,18 @@ main(int argc, char** argv) {
       std::move(response.stream)
           .subscribeExTry(
               folly::Executor::getKeepAliveToken(&evb),
-              [areaKeyVals = std::move(areaKeyVals)](
+              [areaKeyVals = std::move(areaKeyVals), logWriter](
                   folly::Try<openr::thrift::Publication>&& maybePub) mutable {
                 if (maybePub.hasException()) {
                   LOG(ERROR) << maybePub.exception().what();
                   return;
                 }
                 auto& pub = maybePub.value();
+                if (logWriter) {
+                  logWriter->append(pub);
+                  return;
+                }
+
                 // Print expired key-vals
                 for (const auto& key : *pub.expiredKeys_ref()) {
                   std::cout << "Expired Key: " << key << std::endl;
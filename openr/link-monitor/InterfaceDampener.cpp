@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "InterfaceDampener.h"
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// Heap with fewer entries is never compacted
+constexpr size_t kMinHeapSizeForCompaction{64};
+
+} // namespace
+
+InterfaceDampener::InterfaceDampener(
+    std::chrono::milliseconds initBackoff,
+    std::chrono::milliseconds maxBackoff,
+    std::optional<thrift::LinkFlapDampeningConfig> penaltyConfig)
+    : initBackoff_(initBackoff),
+      maxBackoff_(maxBackoff),
+      penaltyConfig_(std::move(penaltyConfig)) {
+  CHECK_GE(maxBackoff_.count(), initBackoff_.count());
+  if (penaltyConfig_.has_value()) {
+    CHECK_GT(*penaltyConfig_->half_life_ms_ref(), 0);
+    CHECK_GT(*penaltyConfig_->reuse_threshold_ref(), 0);
+    // Penalty which takes exactly max_suppress_ms to decay to reuse threshold
+    const double halfLives =
+        static_cast<double>(*penaltyConfig_->max_suppress_ms_ref()) /
+        *penaltyConfig_->half_life_ms_ref();
+    maxPenalty_ = *penaltyConfig_->reuse_threshold_ref() *
+        std::exp2(std::min(halfLives, 64.0));
+  }
+}
+
+double
+InterfaceDampener::getDecayedPenalty(
+    State const& state, Clock::time_point now) const {
+  if (not penaltyConfig_.has_value() or state.penalty <= 0) {
+    return 0;
+  }
+  const double elapsedMs =
+      std::chrono::duration<double, std::milli>(now - state.lastFlapTime)
+          .count();
+  const double halfLives =
+      std::max(elapsedMs, 0.0) / *penaltyConfig_->half_life_ms_ref();
+  return state.penalty * std::exp2(-halfLives);
+}
+
+void
+InterfaceDampener::reportFlap(
+    std::string const& ifName, Clock::time_point now) {
+  auto& state = states_[ifName];
+
+  if (penaltyConfig_.has_value()) {
+    const bool wasSuppressed = state.eligibleTime > now;
+    state.penalty = std::min(
+        getDecayedPenalty(state, now) + *penaltyConfig_->penalty_per_flap_ref(),
+        maxPenalty_);
+    state.lastFlapTime = now;
+    if (not wasSuppressed and
+        state.penalty < *penaltyConfig_->suppress_threshold_ref()) {
+      return;
+    }
+    // Suppressed until penalty decays below reuse threshold
+    const double suppressMs = *penaltyConfig_->half_life_ms_ref() *
+        std::log2(state.penalty / *penaltyConfig_->reuse_threshold_ref());
+    const auto suppress = std::chrono::duration<double, std::milli>(
+        std::max(suppressMs, 0.0));
+    state.eligibleTime =
+        now + std::chrono::duration_cast<Clock::duration>(suppress);
+  } else {
+    // Clear history if interface has been stable for max backoff
+    if (now - state.lastFlapTime > maxBackoff_) {
+      state.backoff = std::chrono::milliseconds(0);
+    }
+    state.backoff = state.backoff.count() == 0
+        ? initBackoff_
+        : std::min(maxBackoff_, state.backoff * 2);
+    state.lastFlapTime = now;
+    state.eligibleTime = now + state.backoff;
+  }
+
+  if (state.eligibleTime <= now) {
+    return;
+  }
+
+  heap_.emplace(state.eligibleTime, ifName);
+
+  // Drop stale entries. Amortized over the pushes which created them.
+  if (heap_.size() > kMinHeapSizeForCompaction and
+      heap_.size() > 2 * states_.size()) {
+    std::vector<HeapEntry> entries;
+    for (auto const& [name, ifState] : states_) {
+      if (ifState.eligibleTime > now) {
+        entries.emplace_back(ifState.eligibleTime, name);
+      }
+    }
+    heap_ = decltype(heap_)(std::greater<HeapEntry>(), std::move(entries));
+  }
+}
+
+std::chrono::milliseconds
+InterfaceDampener::getRemainingTime(
+    std::string const& ifName, Clock::time_point now) const {
+  auto it = states_.find(ifName);
+  if (it == states_.end() or it->second.eligibleTime <= now) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::ceil<std::chrono::milliseconds>(
+      it->second.eligibleTime - now);
+}
+
+std::chrono::milliseconds
+InterfaceDampener::getNextEligibleTime(Clock::time_point now) {
+  while (not heap_.empty()) {
+    auto const& [eligibleTime, ifName] = heap_.top();
+    auto it = states_.find(ifName);
+    if (eligibleTime <= now or it == states_.end() or
+        it->second.eligibleTime != eligibleTime) {
+      heap_.pop();
+      continue;
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(eligibleTime - now);
+  }
+  return std::chrono::milliseconds(0);
+}
+
+double
+InterfaceDampener::getPenalty(
+    std::string const& ifName, Clock::time_point now) const {
+  auto it = states_.find(ifName);
+  if (it == states_.end()) {
+    return 0;
+  }
+  return getDecayedPenalty(it->second, now);
+}
+
+} // namespace openr
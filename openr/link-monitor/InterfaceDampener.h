@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openr/if/gen-cpp2/OpenrConfig_types.h>
+
+namespace openr {
+
+/**
+ * Link-flap dampening engine shared by all interfaces. Every UP to DOWN
+ * transition of an interface is reported as a flap, which holds the interface
+ * down (i.e. not eligible for neighbor discovery) for some time. Two schemes
+ * are supported:
+ *
+ * - Exponential backoff (default): the hold time starts at `initBackoff` and
+ *   doubles on every flap up to `maxBackoff`. History is cleared when the
+ *   interface did not flap for `maxBackoff`.
+ * - Penalty: every flap adds `penalty_per_flap` to a penalty decaying
+ *   exponentially with `half_life_ms`. The interface is suppressed once its
+ *   penalty reaches `suppress_threshold`, until it decays below
+ *   `reuse_threshold`, but for no longer than `max_suppress_ms`.
+ *
+ * Held down interfaces are kept in a min-heap keyed by the time they become
+ * eligible again. Reporting a flap costs O(log n) and finding the next
+ * interface to become eligible is amortized O(log n), n being the number of
+ * interfaces.
+ */
+class InterfaceDampener final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  InterfaceDampener(
+      std::chrono::milliseconds initBackoff,
+      std::chrono::milliseconds maxBackoff,
+      std::optional<thrift::LinkFlapDampeningConfig> penaltyConfig =
+          std::nullopt);
+
+  // Report UP to DOWN transition of interface
+  void reportFlap(
+      std::string const& ifName, Clock::time_point now = Clock::now());
+
+  // Time for which interface is still held down, 0 if it is eligible
+  std::chrono::milliseconds getRemainingTime(
+      std::string const& ifName, Clock::time_point now = Clock::now()) const;
+
+  // Smallest remaining time among held down interfaces, 0 if there is none
+  std::chrono::milliseconds getNextEligibleTime(
+      Clock::time_point now = Clock::now());
+
+  // Current penalty of interface, always 0 for exponential backoff
+  double getPenalty(
+      std::string const& ifName, Clock::time_point now = Clock::now()) const;
+
+ private:
+  struct State {
+    Clock::time_point lastFlapTime;
+    // time at which interface becomes eligible again
+    Clock::time_point eligibleTime;
+    // exponential backoff
+    std::chrono::milliseconds backoff{0};
+    // penalty as of lastFlapTime
+    double penalty{0};
+  };
+
+  // penalty decayed from last flap to `now`
+  double getDecayedPenalty(State const& state, Clock::time_point now) const;
+
+  const std::chrono::milliseconds initBackoff_{0};
+  const std::chrono::milliseconds maxBackoff_{0};
+  const std::optional<thrift::LinkFlapDampeningConfig> penaltyConfig_;
+
+  // penalty ceiling, so that suppression never exceeds max_suppress_ms
+  double maxPenalty_{0};
+
+  std::unordered_map<std::string /* ifName */, State> states_;
+
+  // Min-heap of held down interfaces. Entries are invalidated lazily, i.e. an
+  // entry is valid only if it matches the eligibleTime of its interface.
+  using HeapEntry = std::pair<Clock::time_point, std::string /* ifName */>;
+  std::priority_queue<
+      HeapEntry,
+      std::vector<HeapEntry>,
+      std::greater<HeapEntry>>
+      heap_;
+};
+
+} // namespace openr
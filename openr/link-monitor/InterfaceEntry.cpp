@@ -14,11 +14,10 @@ namespace openr {
 
 InterfaceEntry::InterfaceEntry(
     std::string const& ifName,
-    std::chrono::milliseconds const& initBackoff,
-    std::chrono::milliseconds const& maxBackoff,
+    InterfaceDampener& dampener,
     AsyncThrottle& updateCallback,
     folly::AsyncTimeout& updateTimeout)
-    : backoff_(initBackoff, maxBackoff),
+    : dampener_(dampener),
       updateCallback_(updateCallback),
       updateTimeout_(updateTimeout) {
   CHECK(not ifName.empty());
@@ -38,8 +37,8 @@ InterfaceEntry::updateAttrs(int ifIndex, bool isUp) {
 
   // Look for specific case of interface state transition to DOWN
   if (wasUp != isUp and wasUp) {
-    // Penalize backoff on transitioning to DOWN state
-    backoff_.reportError();
+    // Penalize interface on transitioning to DOWN state
+    dampener_.reportFlap(info_.ifName);
   }
 
   // Look for active to down transition
@@ -59,18 +58,12 @@ InterfaceEntry::isActive() {
   if (not info_.isUp) {
     return false;
   }
-
-  const auto lastErrorTime = backoff_.getLastErrorTime();
-  const auto now = std::chrono::steady_clock::now();
-  if (now - lastErrorTime > backoff_.getMaxBackoff()) {
-    backoff_.reportSuccess();
-  }
-  return backoff_.canTryNow();
+  return getBackoffDuration().count() == 0;
 }
 
 std::chrono::milliseconds
 InterfaceEntry::getBackoffDuration() const {
-  return backoff_.getTimeRemainingUntilRetry();
+  return dampener_.getRemainingTime(info_.ifName);
 }
 
 bool
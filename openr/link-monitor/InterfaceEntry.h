@@ -12,9 +12,9 @@
 #include <folly/io/async/AsyncTimeout.h>
 
 #include <openr/common/AsyncThrottle.h>
-#include <openr/common/ExponentialBackoff.h>
 #include <openr/common/Types.h>
 #include <openr/if/gen-cpp2/Types_types.h>
+#include <openr/link-monitor/InterfaceDampener.h>
 
 namespace openr {
 
@@ -31,8 +31,7 @@ class InterfaceEntry final {
  public:
   InterfaceEntry(
       std::string const& ifName,
-      std::chrono::milliseconds const& initBackoff,
-      std::chrono::milliseconds const& maxBackoff,
+      InterfaceDampener& dampener,
       AsyncThrottle& updateCallback,
       folly::AsyncTimeout& updateTimeout);
 
@@ -90,8 +89,8 @@ class InterfaceEntry final {
   std::vector<folly::CIDRNetwork> getGlobalUnicastNetworks(bool enableV4) const;
 
  private:
-  // Backoff variables
-  ExponentialBackoff<std::chrono::milliseconds> backoff_;
+  // Link-flap dampening shared by all interfaces
+  InterfaceDampener& dampener_;
 
   // Update callback
   AsyncThrottle& updateCallback_;
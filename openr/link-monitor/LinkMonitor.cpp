@@ -24,15 +24,6 @@ namespace {
 
 const std::string kConfigKey{"link-monitor-config"};
 
-/**
- * Transformation function to convert measured rtt (in us) to a metric value
- * to be used. Metric can never be zero.
- */
-int32_t
-getRttMetric(int64_t rttUs) {
-  return std::max((int)(rttUs / 100), (int)1);
-}
-
 void
 printLinkMonitorState(openr::thrift::LinkMonitorState const& state) {
   VLOG(1) << "LinkMonitor state .... ";
@@ -63,7 +54,7 @@ LinkMonitor::LinkMonitor(
     fbnl::NetlinkProtocolSocket* nlSock,
     KvStore* kvStore,
     PersistentStore* configStore,
-    messaging::ReplicateQueue<InterfaceDatabase>& interfaceUpdatesQueue,
+    messaging::ReplicateQueue<InterfaceDatabaseUpdate>& interfaceUpdatesQueue,
     messaging::ReplicateQueue<PrefixEvent>& prefixUpdatesQueue,
     messaging::ReplicateQueue<PeerEvent>& peerUpdatesQueue,
     messaging::ReplicateQueue<LogSample>& logSampleQueue,
@@ -78,17 +69,35 @@ LinkMonitor::LinkMonitor(
       enableV4_(config->isV4Enabled()),
       v4OverV6Nexthop_(config->isV4OverV6NexthopEnabled()),
       enableSegmentRouting_(config->isSegmentRoutingEnabled()),
+      useRangeAllocatorBitmap_(
+          *config->getConfig().enable_range_allocator_bitmap_ref()),
       enableNewGRBehavior_(config->isNewGRBehaviorEnabled()),
       prefixForwardingType_(*config->getConfig().prefix_forwarding_type_ref()),
       prefixForwardingAlgorithm_(
           *config->getConfig().prefix_forwarding_algorithm_ref()),
       useRttMetric_(*config->getLinkMonitorConfig().use_rtt_metric_ref()),
+      rttMetricQuantizer_(config->getLinkMonitorConfig()
+                              .rtt_metric_quantization_config_ref()
+                              .to_optional()),
+      interfaceAdminGroups_(
+          *config->getLinkMonitorConfig().interface_admin_groups_ref()),
       linkflapInitBackoff_(std::chrono::milliseconds(
           *config->getLinkMonitorConfig().linkflap_initial_backoff_ms_ref())),
       linkflapMaxBackoff_(std::chrono::milliseconds(
           *config->getLinkMonitorConfig().linkflap_max_backoff_ms_ref())),
+      interfaceDampener_(
+          linkflapInitBackoff_,
+          linkflapMaxBackoff_,
+          config->getLinkMonitorConfig()
+              .linkflap_dampening_config_ref()
+              .to_optional()),
       ttlKeyInKvStore_(config->getKvStoreKeyTtl()),
+      adjAdvertiseMinInterval_(std::chrono::milliseconds(
+          *config->getLinkMonitorConfig().adj_advertise_min_interval_ms_ref())),
+      adjAdvertiseMaxDelay_(std::chrono::milliseconds(
+          *config->getLinkMonitorConfig().adj_advertise_max_delay_ms_ref())),
       areas_(config->getAreas()),
+      config_(config),
       interfaceUpdatesQueue_(interfaceUpdatesQueue),
       prefixUpdatesQueue_(prefixUpdatesQueue),
       peerUpdatesQueue_(peerUpdatesQueue),
@@ -109,12 +118,15 @@ LinkMonitor::LinkMonitor(
     advertiseRedistAddrs();
   });
 
-  // Create throttled adjacency advertiser
-  advertiseAdjacenciesThrottled_ = std::make_unique<AsyncThrottle>(
-      getEvb(), Constants::kAdjacencyThrottleTimeout, [this]() noexcept {
-        // will advertise to all areas but will not trigger a adj key update
-        // if nothing changed.
-        advertiseAdjacencies();
+  // Create coalescing adjacency advertiser
+  advertiseAdjacenciesTimer_ =
+      folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+        // will not trigger a adj key update if nothing changed.
+        auto areas = std::move(pendingAdjAreas_);
+        pendingAdjAreas_.clear();
+        for (auto const& area : areas) {
+          advertiseAdjacencies(area);
+        }
       });
 
   // Create throttled interfaces and addresses advertiser
@@ -126,6 +138,27 @@ LinkMonitor::LinkMonitor(
   advertiseIfaceAddrTimer_ = folly::AsyncTimeout::make(
       *getEvb(), [this]() noexcept { advertiseIfaceAddr(); });
 
+  // Create timer to process coalesced LINK/ADDR events
+  netlinkEventsTimer_ = folly::AsyncTimeout::make(
+      *getEvb(), [this]() noexcept { flushNetlinkEvents(); });
+
+  // Create timer to send batched KvStore peer events
+  peerEventsTimer_ = folly::AsyncTimeout::make(
+      *getEvb(), [this]() noexcept { flushPeerEvents(); });
+
+  // Create timer to apply held back RTT metric changes
+  rttMetricHoldTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+    for (auto& [_, adjValue] : adjacencies_) {
+      if (adjValue.heldRttUs and
+          rttMetricQuantizer_
+                  .getRemainingHoldTime(adjValue.rttMetricChangeTime)
+                  .count() == 0) {
+        updateRttMetric(adjValue, *adjValue.heldRttUs);
+      }
+    }
+    scheduleRttMetricHoldTimer();
+  });
+
   // Create config-store client
   LOG(INFO) << "Loading link-monitor state";
   auto state =
@@ -179,7 +212,8 @@ LinkMonitor::LinkMonitor(
               std::chrono::seconds(2), /* maxBackoffDur */
               false /* override owner */,
               nullptr, /* checkValueInUseCb */
-              Constants::kRangeAllocTtl));
+              Constants::kRangeAllocTtl,
+              useRangeAllocatorBitmap_));
 
       // Delay range allocation until we have formed all of our adjcencies
       auto startAllocTimer =
@@ -219,7 +253,7 @@ LinkMonitor::LinkMonitor(
         LOG(INFO) << "Terminating netlink events processing fiber";
         break;
       }
-      processNetlinkEvent(std::move(maybeEvent).value());
+      bufferNetlinkEvent(std::move(maybeEvent).value());
     }
   });
 
@@ -242,7 +276,8 @@ LinkMonitor::LinkMonitor(
     if (success) {
       VLOG(2) << "InterfaceDb Sync is successful";
       expBackoff_.reportSuccess();
-      interfaceDbSyncTimer_->scheduleTimeout(Constants::kPlatformSyncInterval);
+      interfaceDbSyncTimer_->scheduleTimeout(
+          Constants::kInterfaceSafetySyncInterval);
     } else {
       fb303::fbData->addStatValue(
           "link_monitor.thrift.failure.getAllLinks", 1, fb303::SUM);
@@ -273,7 +308,17 @@ LinkMonitor::LinkMonitor(
   fb303::fbData->addStatExportType("link_monitor.neighbor_down", fb303::SUM);
   fb303::fbData->addStatExportType(
       "link_monitor.advertise_adjacencies", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "link_monitor.advertise_adjacencies_skipped", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "link_monitor.adj_db_entries_rebuilt", fb303::SUM);
   fb303::fbData->addStatExportType("link_monitor.advertise_links", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "link_monitor.netlink_events.received", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "link_monitor.netlink_events.applied", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "link_monitor.peer_events.peers_batched", fb303::SUM);
   fb303::fbData->addStatExportType(
       "link_monitor.thrift.failure.getAllLinks", fb303::SUM);
 }
@@ -311,13 +356,17 @@ LinkMonitor::neighborUpEvent(const thrift::SparkNeighbor& info) {
       localIfName /* local ifName neighbor discovered on */,
       toString(neighborAddrV6) /* nextHopV6 */,
       toString(neighborAddrV4) /* nextHopV4 */,
-      useRttMetric_ ? getRttMetric(rttUs) : 1 /* metric */,
+      useRttMetric_ ? rttMetricQuantizer_.getMetric(rttUs) : 1 /* metric */,
       enableSegmentRouting_ ? *info.label_ref() : 0 /* adjacency-label */,
       false /* overload bit */,
       useRttMetric_ ? rttUs : 0 /* rtt */,
       timestamp,
       1 /* weight */,
       remoteIfName);
+  if (auto it = interfaceAdminGroups_.find(localIfName);
+      it != interfaceAdminGroups_.end()) {
+    newAdj.adminGroups_ref() = it->second;
+  }
 
   SYSLOG(INFO)
       << EventTag() << "Neighbor " << remoteNodeName << " is up on interface "
@@ -372,7 +421,7 @@ LinkMonitor::neighborUpEvent(const thrift::SparkNeighbor& info) {
   updateKvStorePeerNeighborUp(area, adjId, adjacencies_[adjId]);
 
   // Advertise new adjancies in a throttled fashion
-  advertiseAdjacenciesThrottled_->operator()();
+  scheduleAdvertiseAdjacencies(area, false /* urgent */);
 }
 
 void
@@ -399,8 +448,8 @@ LinkMonitor::neighborDownEvent(const thrift::SparkNeighbor& info) {
   // remove such adjacencies
   adjacencies_.erase(adjValueIt);
 
-  // advertise adjacencies
-  advertiseAdjacencies(area);
+  // advertise adjacencies, coalescing with other neighbor down events
+  scheduleAdvertiseAdjacencies(area, true /* urgent */);
 }
 
 void
@@ -424,6 +473,7 @@ LinkMonitor::neighborRestartingEvent(const thrift::SparkNeighbor& info) {
 
   // update adjacencies_ restarting-bit and advertise peers
   adjValueIt->second.isRestarting = true;
+  adjValueIt->second.stale = true;
 
   // update KvStore Peer
   updateKvStorePeerNeighborDown(area, adjId, adjValueIt->second);
@@ -434,17 +484,66 @@ LinkMonitor::neighborRttChangeEvent(const thrift::SparkNeighbor& info) {
   const auto& remoteNodeName = *info.nodeName_ref();
   const auto& localIfName = *info.localIfName_ref();
   const auto& rttUs = *info.rttUs_ref();
-  int32_t newRttMetric = getRttMetric(rttUs);
 
-  VLOG(1) << "Metric value changed for neighbor " << remoteNodeName
-          << " on interface: " << localIfName << " to " << newRttMetric;
+  VLOG(1) << "RTT changed for neighbor " << remoteNodeName
+          << " on interface: " << localIfName << " to " << rttUs << "us";
 
   auto it = adjacencies_.find({remoteNodeName, localIfName});
   if (it != adjacencies_.end()) {
-    auto& adj = it->second.adjacency;
-    adj.metric_ref() = newRttMetric;
-    adj.rtt_ref() = rttUs;
-    advertiseAdjacenciesThrottled_->operator()();
+    updateRttMetric(it->second, rttUs);
+  }
+}
+
+void
+LinkMonitor::updateRttMetric(AdjacencyValue& adjValue, int64_t rttUs) {
+  auto& adj = adjValue.adjacency;
+  adjValue.heldRttUs = std::nullopt;
+
+  const auto newMetric =
+      rttMetricQuantizer_.getMetricChange(*adj.rtt_ref(), rttUs);
+  if (not newMetric) {
+    // advertised RTT is kept, so that adjacency is not re-advertised
+    fb303::fbData->addStatValue(
+        "link_monitor.rtt_metric.suppressed", 1, fb303::SUM);
+    return;
+  }
+
+  if (rttMetricQuantizer_.getRemainingHoldTime(adjValue.rttMetricChangeTime)
+          .count() > 0) {
+    // applied upon hold time expiry, unless RTT changes again meanwhile
+    adjValue.heldRttUs = rttUs;
+    fb303::fbData->addStatValue("link_monitor.rtt_metric.held", 1, fb303::SUM);
+    scheduleRttMetricHoldTimer();
+    return;
+  }
+
+  VLOG(1) << "Metric value changed for neighbor " << *adj.otherNodeName_ref()
+          << " on interface: " << *adj.ifName_ref() << " to " << *newMetric;
+  fb303::fbData->addStatValue(
+      "link_monitor.rtt_metric.advertised", 1, fb303::SUM);
+
+  adj.metric_ref() = *newMetric;
+  adj.rtt_ref() = rttUs;
+  adjValue.rttMetricChangeTime = std::chrono::steady_clock::now();
+  adjValue.stale = true;
+  scheduleAdvertiseAdjacencies(adjValue.area, false /* urgent */);
+}
+
+void
+LinkMonitor::scheduleRttMetricHoldTimer() {
+  std::optional<std::chrono::milliseconds> holdTime;
+  for (auto const& [_, adjValue] : adjacencies_) {
+    if (not adjValue.heldRttUs) {
+      continue;
+    }
+    const auto remaining =
+        rttMetricQuantizer_.getRemainingHoldTime(adjValue.rttMetricChangeTime);
+    holdTime = holdTime ? std::min(*holdTime, remaining) : remaining;
+  }
+  if (holdTime) {
+    rttMetricHoldTimer_->scheduleTimeout(*holdTime);
+  } else {
+    rttMetricHoldTimer_->cancelTimeout();
   }
 }
 
@@ -490,7 +589,9 @@ LinkMonitor::processKvStoreSyncEvent(KvStoreSyncEvent&& event) {
     }
   }
 
-  advertiseAdjacenciesThrottled_->operator()();
+  // all adjacencies to the peer are affected by its initial sync state
+  invalidateAdjacencies(nodeName, std::nullopt);
+  scheduleAdvertiseAdjacencies(area, false /* urgent */);
 }
 
 void
@@ -526,13 +627,9 @@ LinkMonitor::updateKvStorePeerNeighborUp(
       remoteNodeName,
       KvStorePeerValue(adjVal.peerSpec, initialSynced, {adjId}));
 
-  // Advertise KvStore peers immediately
-  thrift::PeersMap peersToAdd;
-  peersToAdd.emplace(remoteNodeName, adjVal.peerSpec);
+  // Advertise KvStore peers along with the ones coming up at the same time
   logPeerEvent("ADD_PEER", remoteNodeName, adjVal.peerSpec);
-
-  PeerEvent event(area, peersToAdd, {});
-  peerUpdatesQueue_.push(std::move(event));
+  bufferPeerAdd(area, remoteNodeName, adjVal.peerSpec);
 }
 
 void
@@ -571,12 +668,12 @@ LinkMonitor::updateKvStorePeerNeighborDown(
     logPeerEvent("DEL_PEER", remoteNodeName, peer.tPeerSpec);
 
     // send peer del event
-    std::vector<std::string> peersToDel{remoteNodeName};
-    PeerEvent event(area, {} /* peersToAdd */, peersToDel);
-    peerUpdatesQueue_.push(std::move(event));
+    bufferPeerDel(area, remoteNodeName);
 
-    // remove kvstore peer from internal store.
+    // remove kvstore peer from internal store. Adjacencies to the peer in GR
+    // are now waiting for initial sync again.
     areaPeers->second.erase(remoteNodeName);
+    invalidateAdjacencies(remoteNodeName, std::nullopt);
     return;
   }
 
@@ -595,11 +692,73 @@ LinkMonitor::updateKvStorePeerNeighborDown(
 
   // peer spec change, send peer add event
   logPeerEvent("ADD_PEER", remoteNodeName, peer.tPeerSpec);
+  bufferPeerAdd(area, remoteNodeName, peer.tPeerSpec);
+}
+
+void
+LinkMonitor::bufferPeerAdd(
+    const std::string& area,
+    const std::string& peerName,
+    const thrift::PeerSpec& peerSpec) {
+  auto it = pendingPeerEvents_.find(area);
+  if (it != pendingPeerEvents_.end()) {
+    auto& peersToDel = it->second.peersToDel;
+    if (std::find(peersToDel.begin(), peersToDel.end(), peerName) !=
+        peersToDel.end()) {
+      // KvStore adds peers before deleting them, send the pending deletion
+      // first to re-establish the session
+      flushPeerEvents();
+      it = pendingPeerEvents_.end();
+    }
+  }
+  if (it == pendingPeerEvents_.end()) {
+    it = pendingPeerEvents_
+             .emplace(area, PeerEvent(area, {} /* peersToAdd */, {}))
+             .first;
+  }
+  // latest peer spec wins
+  it->second.peersToAdd.insert_or_assign(peerName, peerSpec);
 
-  thrift::PeersMap peersToAdd;
-  peersToAdd.emplace(remoteNodeName, peer.tPeerSpec);
-  PeerEvent event(area, peersToAdd, {});
-  peerUpdatesQueue_.push(std::move(event));
+  if (not peerEventsTimer_->isScheduled()) {
+    peerEventsTimer_->scheduleTimeout(Constants::kPeerEventCoalesceWindow);
+  }
+}
+
+void
+LinkMonitor::bufferPeerDel(
+    const std::string& area, const std::string& peerName) {
+  auto it = pendingPeerEvents_.find(area);
+  if (it == pendingPeerEvents_.end()) {
+    it = pendingPeerEvents_
+             .emplace(area, PeerEvent(area, {} /* peersToAdd */, {}))
+             .first;
+  }
+  // peer deleted right after being added needs no addition
+  it->second.peersToAdd.erase(peerName);
+  auto& peersToDel = it->second.peersToDel;
+  if (std::find(peersToDel.begin(), peersToDel.end(), peerName) ==
+      peersToDel.end()) {
+    peersToDel.emplace_back(peerName);
+  }
+
+  if (not peerEventsTimer_->isScheduled()) {
+    peerEventsTimer_->scheduleTimeout(Constants::kPeerEventCoalesceWindow);
+  }
+}
+
+void
+LinkMonitor::flushPeerEvents() {
+  peerEventsTimer_->cancelTimeout();
+  auto events = std::move(pendingPeerEvents_);
+  pendingPeerEvents_.clear();
+
+  for (auto& [_, event] : events) {
+    fb303::fbData->addStatValue(
+        "link_monitor.peer_events.peers_batched",
+        event.peersToAdd.size() + event.peersToDel.size(),
+        fb303::SUM);
+    peerUpdatesQueue_.push(std::move(event));
+  }
 }
 
 void
@@ -608,21 +767,43 @@ LinkMonitor::advertiseAdjacencies(const std::string& area) {
     return;
   }
 
-  // Cancel throttle timeout if scheduled
-  if (advertiseAdjacenciesThrottled_->isActive()) {
-    advertiseAdjacenciesThrottled_->cancel();
+  // Cancel coalesced advertisement if nothing else is pending
+  pendingAdjAreas_.erase(area);
+  if (pendingAdjAreas_.empty()) {
+    advertiseAdjacenciesTimer_->cancelTimeout();
   }
+  lastAdjAdvertiseTime_ = std::chrono::steady_clock::now();
 
   // Extract information from `adjacencies_`
   auto adjDb = buildAdjacencyDatabase(area);
 
-  LOG(INFO) << "Updating adjacency database in KvStore with "
-            << adjDb.adjacencies_ref()->size() << " entries in area: " << area;
+  // Skip KvStore update if nothing but perf events changed
+  std::optional<thrift::PerfEvents> perfEvents;
+  if (adjDb.perfEvents_ref().has_value()) {
+    perfEvents = std::move(adjDb.perfEvents_ref().value());
+    adjDb.perfEvents_ref().reset();
+  }
+  auto& advertisedAdjDb = advertisedAdjDbs_[area];
+  if (advertisedAdjDb == adjDb) {
+    VLOG(2) << "Skip updating unchanged adjacency database in area: " << area;
+    fb303::fbData->addStatValue(
+        "link_monitor.advertise_adjacencies_skipped", 1, fb303::SUM);
+  } else {
+    advertisedAdjDb = adjDb;
+    if (perfEvents.has_value()) {
+      adjDb.perfEvents_ref() = std::move(perfEvents.value());
+    }
+
+    LOG(INFO) << "Updating adjacency database in KvStore with "
+              << adjDb.adjacencies_ref()->size()
+              << " entries in area: " << area;
 
-  // Persist `adj:node_Id` key into KvStore via KvStoreClientInternal
-  const auto keyName = Constants::kAdjDbMarker.toString() + nodeId_;
-  std::string adjDbStr = writeThriftObjStr(adjDb, serializer_);
-  kvStoreClient_->persistKey(AreaId{area}, keyName, adjDbStr, ttlKeyInKvStore_);
+    // Persist `adj:node_Id` key into KvStore via KvStoreClientInternal
+    const auto keyName = Constants::kAdjDbMarker.toString() + nodeId_;
+    std::string adjDbStr = writeThriftObjStr(adjDb, serializer_);
+    kvStoreClient_->persistKey(
+        AreaId{area}, keyName, adjDbStr, ttlKeyInKvStore_);
+  }
 
   // Config is most likely to have changed. Update it in `ConfigStore`
   configStore_->storeThriftObj(kConfigKey, state_); // not awaiting on result
@@ -647,6 +828,57 @@ LinkMonitor::advertiseAdjacencies() {
   }
 }
 
+void
+LinkMonitor::scheduleAdvertiseAdjacencies(
+    const std::string& area, bool urgent) {
+  const auto now = std::chrono::steady_clock::now();
+  if (pendingAdjAreas_.empty()) {
+    firstPendingAdjTime_ = now;
+    urgentAdjAdvertisePending_ = false;
+  }
+  pendingAdjAreas_.emplace(area);
+
+  auto deadline = now + adjAdvertiseMinInterval_;
+  if (urgent) {
+    // advertise right away, unless we just did
+    deadline = std::max(now, lastAdjAdvertiseTime_ + adjAdvertiseMinInterval_);
+    if (urgentAdjAdvertisePending_) {
+      deadline = std::min(deadline, advertiseAdjacenciesDeadline_);
+    }
+    urgentAdjAdvertisePending_ = true;
+  } else if (urgentAdjAdvertisePending_) {
+    // will be advertised along with pending urgent change
+    return;
+  }
+
+  // never hold changes for more than max-delay
+  deadline = std::min(deadline, firstPendingAdjTime_ + adjAdvertiseMaxDelay_);
+  advertiseAdjacenciesDeadline_ = deadline;
+  advertiseAdjacenciesTimer_->scheduleTimeout(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::max(deadline - now, std::chrono::steady_clock::duration(0))));
+}
+
+void
+LinkMonitor::scheduleAdvertiseAdjacencies() {
+  for (const auto& [areaId, _] : areas_) {
+    scheduleAdvertiseAdjacencies(areaId, false /* urgent */);
+  }
+}
+
+void
+LinkMonitor::invalidateAdjacencies(
+    std::optional<std::string> const& nodeName,
+    std::optional<std::string> const& ifName) {
+  for (auto& [adjKey, adjValue] : adjacencies_) {
+    if ((nodeName.has_value() and adjKey.first != *nodeName) or
+        (ifName.has_value() and adjKey.second != *ifName)) {
+      continue;
+    }
+    adjValue.stale = true;
+  }
+}
+
 void
 LinkMonitor::advertiseIfaceAddr() {
   auto retryTime = getRetryTimeOnUnstableInterfaces();
@@ -673,8 +905,8 @@ LinkMonitor::advertiseInterfaces() {
   fb303::fbData->addStatValue("link_monitor.advertise_links", 1, fb303::SUM);
 
   // Create interface database
-  InterfaceDatabase ifDb;
-  for (auto& [_, interface] : interfaces_) {
+  std::unordered_map<std::string, InterfaceInfo> ifDb;
+  for (auto& [ifName, interface] : interfaces_) {
     // Perform regex match
     if (not anyAreaShouldDiscoverOnIface(interface.getIfName())) {
       continue;
@@ -685,12 +917,38 @@ LinkMonitor::advertiseInterfaces() {
     // Override `UP` status
     interfaceInfo.isUp = interface.isActive();
 
-    // Construct `InterfaceDatabase` object
-    ifDb.emplace_back(std::move(interfaceInfo));
+    ifDb.emplace(ifName, std::move(interfaceInfo));
+  }
+
+  // Construct full sync periodically, delta of last advertised otherwise
+  InterfaceDatabaseUpdate update;
+  const auto now = std::chrono::steady_clock::now();
+  if (not lastInterfaceFullSync_.has_value() or
+      now - *lastInterfaceFullSync_ >=
+          Constants::kInterfaceDbFullSyncInterval) {
+    lastInterfaceFullSync_ = now;
+    for (const auto& [_, interfaceInfo] : ifDb) {
+      update.interfaces.emplace_back(interfaceInfo);
+    }
+  } else {
+    update.isFullSync = false;
+    for (const auto& [ifName, interfaceInfo] : ifDb) {
+      auto it = advertisedInterfaces_.find(ifName);
+      if (it == advertisedInterfaces_.end() or
+          not(it->second == interfaceInfo)) {
+        update.interfaces.emplace_back(interfaceInfo);
+      }
+    }
+    for (const auto& [ifName, _] : advertisedInterfaces_) {
+      if (not ifDb.count(ifName)) {
+        update.removedIfNames.emplace_back(ifName);
+      }
+    }
   }
+  advertisedInterfaces_ = std::move(ifDb);
 
   // publish via replicate queue
-  interfaceUpdatesQueue_.push(std::move(ifDb));
+  interfaceUpdatesQueue_.push(std::move(update));
 }
 
 void
@@ -712,12 +970,8 @@ LinkMonitor::advertiseRedistAddrs() {
     }
 
     // Derive list of area to advertise (NOTE: areas are ordered persistently)
-    std::vector<std::string> dstAreas;
-    for (auto const& [areaId, areaConf] : areas_) {
-      if (areaConf.shouldRedistributeIface(interface.getIfName())) {
-        dstAreas.emplace_back(areaId);
-      }
-    }
+    const auto dstAreas =
+        config_->getRedistributeAreaIds(interface.getIfName());
 
     // Do not advertise interface addresses if no destination area qualifies
     if (dstAreas.empty()) {
@@ -808,20 +1062,11 @@ LinkMonitor::advertiseRedistAddrs() {
 
 std::chrono::milliseconds
 LinkMonitor::getRetryTimeOnUnstableInterfaces() {
-  std::chrono::milliseconds minRemainMs{0};
-  for (auto& [_, interface] : interfaces_) {
-    if (interface.isActive()) {
-      continue;
-    }
-
-    const auto& curRemainMs = interface.getBackoffDuration();
-    if (curRemainMs.count() > 0) {
-      VLOG(2) << "Interface " << interface.getIfName()
-              << " is in backoff state for " << curRemainMs.count() << "ms";
-      minRemainMs = std::min(linkflapMaxBackoff_, curRemainMs);
-    }
+  const auto minRemainMs = interfaceDampener_.getNextEligibleTime();
+  if (minRemainMs.count() > 0) {
+    VLOG(2) << "Next interface leaves backoff state in " << minRemainMs.count()
+            << "ms";
   }
-
   return minRemainMs;
 }
 
@@ -835,52 +1080,26 @@ LinkMonitor::buildAdjacencyDatabase(const std::string& area) {
   adjDb.nodeLabel_ref() = enableSegmentRouting_ ? *state_.nodeLabel_ref() : 0;
   *adjDb.area_ref() = area;
 
+  size_t numRebuilt{0};
   for (auto& [adjKey, adjValue] : adjacencies_) {
     // ignore unrelated area
     if (adjValue.area != area) {
       continue;
     }
 
-    // ignore adjs that are waiting first KvStore full sync
-    bool waitingInitialSync{true};
-
-    const auto& areaPeers = peers_.find(area);
-    if (areaPeers != peers_.end()) {
-      const auto& peerVal = areaPeers->second.find(adjKey.first);
-      // set waitingInitialSync false if peer has reached initial sync state
-      if (peerVal != areaPeers->second.end() && peerVal->second.initialSynced) {
-        waitingInitialSync = false;
-      }
+    // patch entries changed since last build only
+    if (adjValue.stale) {
+      adjValue.advertisedAdjacency = buildAdjacency(adjKey, adjValue);
+      adjValue.stale = false;
+      ++numRebuilt;
     }
 
-    // If adj is not in GR and it's waiting for kvstore sync,
-    // skip announcement
-    if (not adjValue.isRestarting && waitingInitialSync) {
-      continue;
+    if (adjValue.advertisedAdjacency.has_value()) {
+      adjDb.adjacencies_ref()->emplace_back(*adjValue.advertisedAdjacency);
     }
-
-    // NOTE: copy on purpose
-    auto adj = folly::copy(adjValue.adjacency);
-
-    // Set link overload bit
-    adj.isOverloaded_ref() =
-        state_.overloadedLinks_ref()->count(*adj.ifName_ref()) > 0;
-
-    // Override metric with link metric if it exists
-    adj.metric_ref() = folly::get_default(
-        *state_.linkMetricOverrides_ref(),
-        *adj.ifName_ref(),
-        *adj.metric_ref());
-
-    // Override metric with adj metric if it exists
-    thrift::AdjKey tAdjKey;
-    *tAdjKey.nodeName_ref() = *adj.otherNodeName_ref();
-    *tAdjKey.ifName_ref() = *adj.ifName_ref();
-    adj.metric_ref() = folly::get_default(
-        *state_.adjMetricOverrides_ref(), tAdjKey, *adj.metric_ref());
-
-    adjDb.adjacencies_ref()->emplace_back(std::move(adj));
   }
+  fb303::fbData->addStatValue(
+      "link_monitor.adj_db_entries_rebuilt", numRebuilt, fb303::SUM);
 
   // Add perf information if enabled
   if (enablePerfMeasurement_) {
@@ -894,6 +1113,48 @@ LinkMonitor::buildAdjacencyDatabase(const std::string& area) {
   return adjDb;
 }
 
+std::optional<thrift::Adjacency>
+LinkMonitor::buildAdjacency(
+    const AdjacencyKey& adjKey, const AdjacencyValue& adjValue) const {
+  // ignore adjs that are waiting first KvStore full sync
+  bool waitingInitialSync{true};
+
+  const auto& areaPeers = peers_.find(adjValue.area);
+  if (areaPeers != peers_.end()) {
+    const auto& peerVal = areaPeers->second.find(adjKey.first);
+    // set waitingInitialSync false if peer has reached initial sync state
+    if (peerVal != areaPeers->second.end() && peerVal->second.initialSynced) {
+      waitingInitialSync = false;
+    }
+  }
+
+  // If adj is not in GR and it's waiting for kvstore sync,
+  // skip announcement
+  if (not adjValue.isRestarting && waitingInitialSync) {
+    return std::nullopt;
+  }
+
+  // NOTE: copy on purpose
+  auto adj = folly::copy(adjValue.adjacency);
+
+  // Set link overload bit
+  adj.isOverloaded_ref() =
+      state_.overloadedLinks_ref()->count(*adj.ifName_ref()) > 0;
+
+  // Override metric with link metric if it exists
+  adj.metric_ref() = folly::get_default(
+      *state_.linkMetricOverrides_ref(), *adj.ifName_ref(), *adj.metric_ref());
+
+  // Override metric with adj metric if it exists
+  thrift::AdjKey tAdjKey;
+  *tAdjKey.nodeName_ref() = *adj.otherNodeName_ref();
+  *tAdjKey.ifName_ref() = *adj.ifName_ref();
+  adj.metric_ref() = folly::get_default(
+      *state_.adjMetricOverrides_ref(), tAdjKey, *adj.metric_ref());
+
+  return adj;
+}
+
 InterfaceEntry* FOLLY_NULLABLE
 LinkMonitor::getOrCreateInterfaceEntry(const std::string& ifName) {
   // Return null if ifName doesn't quality regex match criteria
@@ -913,8 +1174,7 @@ LinkMonitor::getOrCreateInterfaceEntry(const std::string& ifName) {
       ifName,
       InterfaceEntry(
           ifName,
-          linkflapInitBackoff_,
-          linkflapMaxBackoff_,
+          interfaceDampener_,
           *advertiseIfaceAddrThrottled_,
           *advertiseIfaceAddrTimer_));
 
@@ -1015,6 +1275,8 @@ LinkMonitor::processNetlinkEvent(fbnl::NetlinkEvent&& event) {
     auto it = ifIndexToName_.find(ifIndex);
     if (it == ifIndexToName_.end()) {
       LOG(ERROR) << "Address event for unknown iface index: " << ifIndex;
+      // LINK event of the interface was missed
+      scheduleInterfaceResync("unknown_link");
       return;
     }
 
@@ -1026,6 +1288,93 @@ LinkMonitor::processNetlinkEvent(fbnl::NetlinkEvent&& event) {
   }
 }
 
+void
+LinkMonitor::scheduleInterfaceResync(std::string const& reason) {
+  fb303::fbData->addStatValue(
+      fmt::format("link_monitor.interface_resync.{}", reason), 1, fb303::SUM);
+  // respect backoff of failed syncs. Rescheduling defers the sync to the end
+  // of a burst of lost events
+  interfaceDbSyncTimer_->scheduleTimeout(std::max(
+      Constants::kNetlinkEventCoalesceWindow,
+      expBackoff_.getTimeRemainingUntilRetry()));
+}
+
+void
+LinkMonitor::bufferNetlinkEvent(fbnl::NetlinkEvent&& event) {
+  if (std::holds_alternative<fbnl::EventsLost>(event)) {
+    LOG(WARNING) << "Netlink events were lost, re-sync interfaces";
+    scheduleInterfaceResync("events_lost");
+    return;
+  }
+
+  fb303::fbData->addStatValue(
+      "link_monitor.netlink_events.received", 1, fb303::SUM);
+
+  if (auto* link = std::get_if<fbnl::Link>(&event)) {
+    auto it = pendingLinkEvents_.find(link->getIfIndex());
+    if (it != pendingLinkEvents_.end() and
+        it->second.link.getLinkName() != link->getLinkName()) {
+      // ifIndex re-used by another link, apply events of previous one
+      flushNetlinkEvents();
+      it = pendingLinkEvents_.end();
+    }
+    if (it == pendingLinkEvents_.end()) {
+      it = pendingLinkEvents_
+               .emplace(link->getIfIndex(), PendingLinkEvent{*link, {}})
+               .first;
+    }
+    if (not link->isUp()) {
+      it->second.downLink = *link;
+    }
+    it->second.link = std::move(*link);
+  } else if (auto* addr = std::get_if<fbnl::IfAddress>(&event)) {
+    auto prefix = addr->getPrefix();
+    if (not prefix.has_value()) {
+      processNetlinkEvent(std::move(event));
+      return;
+    }
+    // latest event of an address wins
+    auto& addrEvents = pendingAddrEvents_[addr->getIfIndex()];
+    addrEvents.erase(*prefix);
+    addrEvents.emplace(*prefix, std::move(*addr));
+  }
+
+  if (not netlinkEventsTimer_->isScheduled()) {
+    netlinkEventsTimer_->scheduleTimeout(
+        Constants::kNetlinkEventCoalesceWindow);
+  }
+}
+
+void
+LinkMonitor::flushNetlinkEvents() {
+  netlinkEventsTimer_->cancelTimeout();
+  auto linkEvents = std::move(pendingLinkEvents_);
+  auto addrEvents = std::move(pendingAddrEvents_);
+  pendingLinkEvents_.clear();
+  pendingAddrEvents_.clear();
+
+  size_t numApplied{0};
+  // apply LINK events first to learn ifIndex -> ifName mapping
+  for (auto& [_, linkEvent] : linkEvents) {
+    // report flap of link which is UP again
+    if (linkEvent.downLink.has_value() and linkEvent.link.isUp()) {
+      processNetlinkEvent(std::move(*linkEvent.downLink));
+      ++numApplied;
+    }
+    processNetlinkEvent(std::move(linkEvent.link));
+    ++numApplied;
+  }
+  for (auto& [_, ifAddrEvents] : addrEvents) {
+    for (auto& prefixAddr : ifAddrEvents) {
+      processNetlinkEvent(std::move(prefixAddr.second));
+      ++numApplied;
+    }
+  }
+
+  fb303::fbData->addStatValue(
+      "link_monitor.netlink_events.applied", numApplied, fb303::SUM);
+}
+
 void
 LinkMonitor::processNeighborEvent(NeighborEvent&& event) {
   const auto& info = event.info;
@@ -1095,6 +1444,26 @@ LinkMonitor::setNodeOverload(bool isOverloaded) {
   return sf;
 }
 
+folly::SemiFuture<folly::Unit>
+LinkMonitor::updateConfig(std::shared_ptr<const Config> config) {
+  folly::Promise<folly::Unit> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread(
+      [this, p = std::move(p), config = std::move(config)]() mutable {
+        CHECK_EQ(areas_.size(), config->getAreas().size())
+            << "Areas can't be changed without restart";
+        areas_ = config->getAreas();
+        config_ = std::move(config);
+
+        // pick up interfaces newly matching regexes, and stop advertising
+        // the ones no longer matching
+        interfaceDbSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+        advertiseIfaceAddrThrottled_->operator()();
+        p.setValue();
+      });
+  return sf;
+}
+
 folly::SemiFuture<folly::Unit>
 LinkMonitor::setInterfaceOverload(
     std::string interfaceName, bool isOverloaded) {
@@ -1136,7 +1505,8 @@ LinkMonitor::setInterfaceOverload(
           SYSLOG(INFO) << EventTag() << "Unsetting overload bit for interface "
                        << interfaceName;
         }
-        advertiseAdjacenciesThrottled_->operator()();
+        invalidateAdjacencies(std::nullopt, interfaceName);
+        scheduleAdvertiseAdjacencies();
         p.setValue();
       });
   return sf;
@@ -1188,7 +1558,8 @@ LinkMonitor::setLinkMetric(
           SYSLOG(INFO) << "Removing metric override for interface "
                        << interfaceName;
         }
-        advertiseAdjacenciesThrottled_->operator()();
+        invalidateAdjacencies(std::nullopt, interfaceName);
+        scheduleAdvertiseAdjacencies();
         p.setValue();
       });
   return sf;
@@ -1248,7 +1619,8 @@ LinkMonitor::setAdjacencyMetric(
       SYSLOG(INFO) << "Removing metric override for adjacency: [" << adjNodeName
                    << ":" << interfaceName << "]";
     }
-    advertiseAdjacenciesThrottled_->operator()();
+    invalidateAdjacencies(adjNodeName, interfaceName);
+    scheduleAdvertiseAdjacencies();
     p.setValue();
   });
   return sf;
@@ -1421,20 +1793,12 @@ LinkMonitor::logPeerEvent(
 
 bool
 LinkMonitor::anyAreaShouldDiscoverOnIface(std::string const& iface) const {
-  bool anyMatch = false;
-  for (auto const& [_, areaConf] : areas_) {
-    anyMatch |= areaConf.shouldDiscoverOnIface(iface);
-  }
-  return anyMatch;
+  return config_->anyAreaShouldDiscoverOnIface(iface);
 }
 
 bool
 LinkMonitor::anyAreaShouldRedistributeIface(std::string const& iface) const {
-  bool anyMatch = false;
-  for (auto const& [_, areaConf] : areas_) {
-    anyMatch |= areaConf.shouldRedistributeIface(iface);
-  }
-  return anyMatch;
+  return config_->anyAreaShouldRedistributeIface(iface);
 }
 
 } // namespace openr
@@ -21,13 +21,16 @@
 
 #include <openr/allocators/RangeAllocator.h>
 #include <openr/common/AsyncThrottle.h>
+#include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/if/gen-cpp2/OpenrConfig_types.h>
 #include <openr/if/gen-cpp2/Platform_types.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 #include <openr/kvstore/KvStoreClientInternal.h>
+#include <openr/link-monitor/InterfaceDampener.h>
 #include <openr/link-monitor/InterfaceEntry.h>
+#include <openr/link-monitor/RttMetricQuantizer.h>
 #include <openr/messaging/ReplicateQueue.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
 #include <openr/spark/Spark.h>
@@ -43,6 +46,19 @@ struct AdjacencyValue {
   bool isRestarting{false};
   std::string area{};
 
+  // Entry of this adjacency in the adjacency database, with link/adj overrides
+  // applied. Unset if the adjacency is not advertised. It is (re)built by
+  // buildAdjacencyDatabase() only when `stale` is set, i.e. after a change of
+  // the adjacency, its overrides or the initial sync state of its peer.
+  std::optional<thrift::Adjacency> advertisedAdjacency{std::nullopt};
+  bool stale{true};
+
+  // Time of the last RTT metric change of the adjacency, and RTT measured
+  // while its hold time is running, see RttMetricQuantizer
+  std::chrono::steady_clock::time_point rttMetricChangeTime{
+      std::chrono::steady_clock::now()};
+  std::optional<int64_t> heldRttUs{std::nullopt};
+
   AdjacencyValue() {}
   AdjacencyValue(
       std::string areaId,
@@ -102,7 +118,7 @@ class LinkMonitor final : public OpenrEventBase {
       KvStore* kvstore,
       PersistentStore* configStore,
       // producer queue
-      messaging::ReplicateQueue<InterfaceDatabase>& interfaceUpdatesQueue,
+      messaging::ReplicateQueue<InterfaceDatabaseUpdate>& interfaceUpdatesQueue,
       messaging::ReplicateQueue<PrefixEvent>& prefixUpdatesQueue,
       messaging::ReplicateQueue<PeerEvent>& peerUpdatesQueue,
       messaging::ReplicateQueue<LogSample>& logSampleQueue,
@@ -157,6 +173,13 @@ class LinkMonitor final : public OpenrEventBase {
   getAdjacencies(thrift::AdjacenciesFilter filter = {});
   folly::SemiFuture<InterfaceDatabase> getAllLinks();
 
+  /*
+   * Apply area regexes of a reloaded config, with the same set of areas.
+   * Interfaces are re-synced and re-advertised against the new regexes.
+   */
+  folly::SemiFuture<folly::Unit> updateConfig(
+      std::shared_ptr<const Config> config);
+
   // create required peers <nodeName: PeerSpec> map from current adjacencies_
   static std::unordered_map<std::string, thrift::PeerSpec>
   getPeersFromAdjacencies(
@@ -181,6 +204,13 @@ class LinkMonitor final : public OpenrEventBase {
   void neighborDownEvent(const thrift::SparkNeighbor& info);
   void neighborRttChangeEvent(const thrift::SparkNeighbor& info);
 
+  // apply measured RTT to metric of adjacency, unless the change is within
+  // hysteresis or held back by hold time
+  void updateRttMetric(AdjacencyValue& adjValue, int64_t rttUs);
+
+  // (re)schedule rttMetricHoldTimer_ for the first held RTT metric change
+  void scheduleRttMetricHoldTimer();
+
   /*
    * [KvStore] initial sync event
    */
@@ -193,10 +223,23 @@ class LinkMonitor final : public OpenrEventBase {
   // process LINK/ADDR event updates from platform
   void processNetlinkEvent(fbnl::NetlinkEvent&& event);
 
+  // Buffer LINK/ADDR event, collapsing events of the same link or address
+  // received within Constants::kNetlinkEventCoalesceWindow into their net
+  // change. A link going down and up again within the window is still
+  // reported as a flap to honor link dampening.
+  void bufferNetlinkEvent(fbnl::NetlinkEvent&& event);
+
+  // process buffered LINK events first, then ADDR events
+  void flushNetlinkEvents();
+
   // Used for initial interface discovery and periodic sync with system handler
   // return true if sync is successful
   bool syncInterfaces();
 
+  // Interface state is built from LINK/ADDR events. Schedule a full sync when
+  // events were lost, reason is accounted in stats
+  void scheduleInterfaceResync(std::string const& reason);
+
   // Get or create InterfaceEntry object.
   // Returns nullptr if ifName doesn't qualify regex match
   // used in syncInterfaces() and LINK/ADDRESS EVENT
@@ -232,6 +275,17 @@ class LinkMonitor final : public OpenrEventBase {
       const AdjacencyKey& adjId,
       const AdjacencyValue& adjVal);
 
+  // Buffer addition/update or deletion of KvStore peer of area into the
+  // pending peer event of the area, sent within kPeerEventCoalesceWindow
+  void bufferPeerAdd(
+      const std::string& area,
+      const std::string& peerName,
+      const thrift::PeerSpec& peerSpec);
+  void bufferPeerDel(const std::string& area, const std::string& peerName);
+
+  // Send pending peer events, one per area
+  void flushPeerEvents();
+
   /*
    * [Kvstore] Advertise my adjacencies_ (kvStoreClient_->persistKey)
    *
@@ -241,8 +295,24 @@ class LinkMonitor final : public OpenrEventBase {
   void advertiseAdjacencies(const std::string& area);
   void advertiseAdjacencies(); // Advertise my adjacencies_ in to all areas
 
+  /*
+   * Coalesced versions of advertiseAdjacencies(). Changes are advertised once
+   * no further change happened for adjAdvertiseMinInterval_, but no later than
+   * adjAdvertiseMaxDelay_ after the first pending change. `urgent` changes
+   * (neighbor down) are advertised right away unless an advertisement was made
+   * within the last adjAdvertiseMinInterval_.
+   */
+  void scheduleAdvertiseAdjacencies(const std::string& area, bool urgent);
+  void scheduleAdvertiseAdjacencies(); // all areas, not urgent
+
+  // mark adjacency entries to remote node and/or on local interface as stale
+  void invalidateAdjacencies(
+      std::optional<std::string> const& nodeName,
+      std::optional<std::string> const& ifName);
+
   /*
    * [Spark/Fib] Advertise interfaces_ over interfaceUpdatesQueue_ to Spark/Fib
+   * as delta of previously advertised ones, or as full sync periodically
    *
    * Called in advertiseIfaceAddr() upon interface changes
    */
@@ -264,13 +334,17 @@ class LinkMonitor final : public OpenrEventBase {
    */
 
   // get next try time, which should be the minimum remaining time among
-  // all unstable (getTimeRemainingUntilRetry() > 0) interfaces.
+  // all unstable (held down by interfaceDampener_) interfaces.
   // return 0 if no more unstable interface
   std::chrono::milliseconds getRetryTimeOnUnstableInterfaces();
 
-  // build AdjacencyDatabase
+  // build AdjacencyDatabase, rebuilding only stale adjacency entries
   thrift::AdjacencyDatabase buildAdjacencyDatabase(const std::string& area);
 
+  // build entry of adjacency in AdjacencyDatabase, unset if not advertised
+  std::optional<thrift::Adjacency> buildAdjacency(
+      const AdjacencyKey& adjKey, const AdjacencyValue& adjValue) const;
+
   // submit events to monitor
   void logNeighborEvent(NeighborEvent const& event);
 
@@ -307,6 +381,8 @@ class LinkMonitor final : public OpenrEventBase {
   bool v4OverV6Nexthop_{false};
   // enable segment routing
   bool enableSegmentRouting_{false};
+  // pick node label from a bitmap of free labels
+  const bool useRangeAllocatorBitmap_{false};
   // Feature gate for new graceful restart behavior:
   // If enableNewGRBehavior_, GR = neighbor restart -> kvstore initial sync.
   // We promote adj up after kvstore initial sync event.
@@ -317,13 +393,26 @@ class LinkMonitor final : public OpenrEventBase {
   thrift::PrefixForwardingAlgorithm prefixForwardingAlgorithm_;
   // Use spark measured RTT to neighbor as link metric
   bool useRttMetric_{false};
+  // RTT to metric conversion, with optional quantization
+  const RttMetricQuantizer rttMetricQuantizer_;
+  // administrative groups of adjacencies, by local interface name
+  const std::map<std::string, int64_t> interfaceAdminGroups_;
   // link flap back offs
   std::chrono::milliseconds linkflapInitBackoff_;
   std::chrono::milliseconds linkflapMaxBackoff_;
+  // link flap dampening shared by all interfaces
+  InterfaceDampener interfaceDampener_;
   // TTL for a key in the key value store
   std::chrono::milliseconds ttlKeyInKvStore_;
+  // adjacency advertisement coalescing
+  const std::chrono::milliseconds adjAdvertiseMinInterval_;
+  const std::chrono::milliseconds adjAdvertiseMaxDelay_;
+
+  // replaced by updateConfig()
+  std::unordered_map<std::string, AreaConfiguration> areas_;
 
-  std::unordered_map<std::string, AreaConfiguration> const areas_;
+  // memoizes interface matches of area regexes
+  std::shared_ptr<const Config> config_;
 
   //
   // Mutable state
@@ -337,7 +426,7 @@ class LinkMonitor final : public OpenrEventBase {
   thrift::LinkMonitorState state_;
 
   // Queue to publish interface updates to fib/spark
-  messaging::ReplicateQueue<InterfaceDatabase>& interfaceUpdatesQueue_;
+  messaging::ReplicateQueue<InterfaceDatabaseUpdate>& interfaceUpdatesQueue_;
 
   // Queue to publish prefix updates to PrefixManager
   messaging::ReplicateQueue<PrefixEvent>& prefixUpdatesQueue_;
@@ -367,6 +456,10 @@ class LinkMonitor final : public OpenrEventBase {
   // Keyed by interface Name
   std::unordered_map<std::string, InterfaceEntry> interfaces_;
 
+  // Interfaces last advertised to Spark/Fib, and time of last full sync
+  std::unordered_map<std::string, InterfaceInfo> advertisedInterfaces_;
+  std::optional<std::chrono::steady_clock::time_point> lastInterfaceFullSync_;
+
   // Container storing map of advertised prefixes - Map<prefix, list<area>>
   std::map<folly::CIDRNetwork, std::vector<std::string>> advertisedPrefixes_;
 
@@ -374,11 +467,42 @@ class LinkMonitor final : public OpenrEventBase {
   // on address events
   std::unordered_map<int64_t, std::string> ifIndexToName_;
 
+  // Buffered LINK/ADDR events, see bufferNetlinkEvent()
+  struct PendingLinkEvent {
+    // latest event of the link
+    fbnl::Link link;
+    // last DOWN event of the link, if any
+    std::optional<fbnl::Link> downLink;
+  };
+  std::unordered_map<int /* ifIndex */, PendingLinkEvent> pendingLinkEvents_;
+  std::unordered_map<
+      int /* ifIndex */,
+      std::map<folly::CIDRNetwork, fbnl::IfAddress>>
+      pendingAddrEvents_;
+  std::unique_ptr<folly::AsyncTimeout> netlinkEventsTimer_;
+
+  // Buffered KvStore peer events per area, see bufferPeerAdd()
+  std::unordered_map<std::string /* area */, PeerEvent> pendingPeerEvents_;
+  std::unique_ptr<folly::AsyncTimeout> peerEventsTimer_;
+
   // Throttled versions of "advertise<>" functions. It batches
   // up multiple calls and send them in one go!
-  std::unique_ptr<AsyncThrottle> advertiseAdjacenciesThrottled_;
   std::unique_ptr<AsyncThrottle> advertiseIfaceAddrThrottled_;
 
+  // Timer for coalesced adjacency advertisements of pendingAdjAreas_, see
+  // scheduleAdvertiseAdjacencies()
+  std::unique_ptr<folly::AsyncTimeout> advertiseAdjacenciesTimer_;
+  std::unordered_set<std::string> pendingAdjAreas_;
+  std::chrono::steady_clock::time_point firstPendingAdjTime_;
+  std::chrono::steady_clock::time_point advertiseAdjacenciesDeadline_;
+  bool urgentAdjAdvertisePending_{false};
+  std::chrono::steady_clock::time_point lastAdjAdvertiseTime_;
+
+  // Last advertised adjacency database per area, without perf events. Used to
+  // skip advertising unchanged adjacency databases.
+  std::unordered_map<std::string /* area */, thrift::AdjacencyDatabase>
+      advertisedAdjDbs_;
+
   // Timer for processing interfaces which are in backoff states
   std::unique_ptr<folly::AsyncTimeout> advertiseIfaceAddrTimer_;
 
@@ -407,6 +531,9 @@ class LinkMonitor final : public OpenrEventBase {
 
   // Timer for initial hold time expiry
   std::unique_ptr<folly::AsyncTimeout> adjHoldTimer_;
+
+  // Timer applying RTT metric changes held back by hold time
+  std::unique_ptr<folly::AsyncTimeout> rttMetricHoldTimer_;
 }; // LinkMonitor
 
 } // namespace openr
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/link-monitor/RttMetricQuantizer.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+RttMetricQuantizer::RttMetricQuantizer(
+    std::optional<thrift::RttMetricQuantizationConfig> config)
+    : config_(std::move(config)) {
+  if (config_) {
+    CHECK_GT(*config_->band_width_us_ref(), 0);
+    CHECK_GE(*config_->hysteresis_us_ref(), 0);
+    CHECK_GE(*config_->min_hold_time_ms_ref(), 0);
+  }
+}
+
+int64_t
+RttMetricQuantizer::getBand(int64_t rttUs) const {
+  const int64_t bandWidth = *config_->band_width_us_ref();
+  return (rttUs / bandWidth) * bandWidth;
+}
+
+int32_t
+RttMetricQuantizer::getMetric(int64_t rttUs) const {
+  if (config_) {
+    rttUs = getBand(rttUs);
+  }
+  return std::max((int)(rttUs / 100), (int)1);
+}
+
+std::optional<int32_t>
+RttMetricQuantizer::getMetricChange(
+    int64_t advertisedRttUs, int64_t rttUs) const {
+  const auto metric = getMetric(rttUs);
+  if (config_) {
+    const auto lower = getBand(advertisedRttUs);
+    const auto upper = lower + *config_->band_width_us_ref();
+    const auto hysteresis = *config_->hysteresis_us_ref();
+    if (rttUs >= lower - hysteresis and rttUs < upper + hysteresis) {
+      return std::nullopt;
+    }
+    if (metric == getMetric(advertisedRttUs)) {
+      return std::nullopt;
+    }
+  }
+  return metric;
+}
+
+std::chrono::milliseconds
+RttMetricQuantizer::getRemainingHoldTime(
+    Clock::time_point lastChangeTime, Clock::time_point now) const {
+  if (not config_) {
+    return std::chrono::milliseconds(0);
+  }
+  const auto holdEnd = lastChangeTime +
+      std::chrono::milliseconds(*config_->min_hold_time_ms_ref());
+  if (holdEnd <= now) {
+    return std::chrono::milliseconds(0);
+  }
+  // round up, so that waiting for it lets the hold expire
+  return std::chrono::ceil<std::chrono::milliseconds>(holdEnd - now);
+}
+
+} // namespace openr
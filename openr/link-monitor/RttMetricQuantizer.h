@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include <openr/if/gen-cpp2/OpenrConfig_types.h>
+
+namespace openr {
+
+/**
+ * Conversion of measured RTT (in us) into adjacency metrics. Without
+ * quantization config, the metric is RTT / 100 and every RTT change reported
+ * by Spark changes it.
+ *
+ * With quantization, RTT is rounded down to bands of `band_width_us`, and the
+ * metric only changes when RTT leaves the band of the last advertised RTT by
+ * more than `hysteresis_us`. A metric change made within `min_hold_time_ms`
+ * of the previous change of the adjacency is held back until it expires.
+ * Jitter around a band edge therefore no longer re-advertises adjacencies.
+ */
+class RttMetricQuantizer final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit RttMetricQuantizer(
+      std::optional<thrift::RttMetricQuantizationConfig> config =
+          std::nullopt);
+
+  // Metric of an adjacency with RTT rttUs. Metric can never be zero
+  int32_t getMetric(int64_t rttUs) const;
+
+  // New metric of an adjacency last advertised with RTT advertisedRttUs upon
+  // measuring rttUs, std::nullopt if the change is within hysteresis
+  std::optional<int32_t> getMetricChange(
+      int64_t advertisedRttUs, int64_t rttUs) const;
+
+  // Time until metric of an adjacency last changed at lastChangeTime may
+  // change again, 0 if it may change right away
+  std::chrono::milliseconds getRemainingHoldTime(
+      Clock::time_point lastChangeTime,
+      Clock::time_point now = Clock::now()) const;
+
+ private:
+  // lower bound of the band of rttUs
+  int64_t getBand(int64_t rttUs) const;
+
+  const std::optional<thrift::RttMetricQuantizationConfig> config_;
+};
+
+} // namespace openr
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fmt/format.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/link-monitor/InterfaceDampener.h>
+
+using namespace std::chrono_literals;
+
+namespace openr {
+
+/**
+ * Verify exponential backoff of a single interface
+ * - backoff doubles on every flap up to max backoff
+ * - history is cleared after being stable for max backoff
+ */
+TEST(InterfaceDampener, ExponentialBackoff) {
+  InterfaceDampener dampener(8ms, 64ms);
+  const auto start = InterfaceDampener::Clock::now();
+
+  EXPECT_EQ(0ms, dampener.getRemainingTime("iface1", start));
+  EXPECT_EQ(0ms, dampener.getNextEligibleTime(start));
+
+  dampener.reportFlap("iface1", start);
+  EXPECT_EQ(8ms, dampener.getRemainingTime("iface1", start));
+  EXPECT_EQ(8ms, dampener.getNextEligibleTime(start));
+  EXPECT_EQ(0ms, dampener.getRemainingTime("iface1", start + 8ms));
+  EXPECT_EQ(0.0, dampener.getPenalty("iface1", start));
+
+  dampener.reportFlap("iface1", start + 1ms);
+  dampener.reportFlap("iface1", start + 2ms);
+  EXPECT_EQ(32ms, dampener.getRemainingTime("iface1", start + 2ms));
+
+  // Capped at max backoff
+  dampener.reportFlap("iface1", start + 3ms);
+  dampener.reportFlap("iface1", start + 4ms);
+  EXPECT_EQ(64ms, dampener.getRemainingTime("iface1", start + 4ms));
+  EXPECT_EQ(64ms, dampener.getNextEligibleTime(start + 4ms));
+  EXPECT_EQ(0ms, dampener.getNextEligibleTime(start + 68ms));
+
+  // Stable for longer than max backoff, start fresh
+  dampener.reportFlap("iface1", start + 100ms);
+  EXPECT_EQ(8ms, dampener.getRemainingTime("iface1", start + 100ms));
+}
+
+/**
+ * Verify next eligible time across many interfaces, including stale heap
+ * entries left behind by repeated flaps of the same interface
+ */
+TEST(InterfaceDampener, NextEligibleTime) {
+  InterfaceDampener dampener(10ms, 10000ms);
+  const auto start = InterfaceDampener::Clock::now();
+  const int numIfaces = 10000;
+
+  for (int i = 0; i < numIfaces; ++i) {
+    dampener.reportFlap(fmt::format("iface{}", i), start);
+  }
+  EXPECT_EQ(10ms, dampener.getNextEligibleTime(start));
+
+  // Flap even interfaces again, their backoff doubles to 20ms
+  for (int i = 0; i < numIfaces; i += 2) {
+    dampener.reportFlap(fmt::format("iface{}", i), start + 5ms);
+  }
+  EXPECT_EQ(5ms, dampener.getNextEligibleTime(start + 5ms));
+  EXPECT_EQ(20ms, dampener.getRemainingTime("iface0", start + 5ms));
+  EXPECT_EQ(5ms, dampener.getRemainingTime("iface1", start + 5ms));
+
+  // Stale entries of even interfaces are skipped
+  EXPECT_EQ(15ms, dampener.getNextEligibleTime(start + 10ms));
+  EXPECT_EQ(0ms, dampener.getNextEligibleTime(start + 25ms));
+
+  // Repeated flaps of a single interface, stale entries get compacted
+  for (int i = 0; i < 3 * numIfaces; ++i) {
+    dampener.reportFlap("iface1", start + 30ms);
+  }
+  EXPECT_EQ(10000ms, dampener.getNextEligibleTime(start + 30ms));
+  EXPECT_EQ(0ms, dampener.getRemainingTime("iface0", start + 30ms));
+}
+
+/**
+ * Verify penalty based dampening
+ * - interface is suppressed once penalty reaches suppress threshold
+ * - interface is reused once penalty decays below reuse threshold
+ * - suppression never exceeds max suppress time
+ */
+TEST(InterfaceDampener, Penalty) {
+  thrift::LinkFlapDampeningConfig config;
+  config.penalty_per_flap_ref() = 1000;
+  config.suppress_threshold_ref() = 2000;
+  config.reuse_threshold_ref() = 500;
+  config.half_life_ms_ref() = 1000;
+  config.max_suppress_ms_ref() = 3000;
+  InterfaceDampener dampener(8ms, 64ms, config);
+  const auto start = InterfaceDampener::Clock::now();
+
+  // First flap doesn't suppress interface
+  dampener.reportFlap("iface1", start);
+  EXPECT_DOUBLE_EQ(1000, dampener.getPenalty("iface1", start));
+  EXPECT_DOUBLE_EQ(500, dampener.getPenalty("iface1", start + 1000ms));
+  EXPECT_EQ(0ms, dampener.getRemainingTime("iface1", start));
+  EXPECT_EQ(0ms, dampener.getNextEligibleTime(start));
+
+  // Second flap reaches suppress threshold, reuse after two half lives
+  dampener.reportFlap("iface1", start);
+  EXPECT_DOUBLE_EQ(2000, dampener.getPenalty("iface1", start));
+  EXPECT_EQ(2000ms, dampener.getRemainingTime("iface1", start));
+  EXPECT_EQ(2000ms, dampener.getNextEligibleTime(start));
+
+  // Flaps while suppressed extend suppression up to max suppress time
+  for (int i = 0; i < 10; ++i) {
+    dampener.reportFlap("iface1", start);
+  }
+  EXPECT_DOUBLE_EQ(4000, dampener.getPenalty("iface1", start));
+  EXPECT_EQ(3000ms, dampener.getRemainingTime("iface1", start));
+  EXPECT_EQ(3000ms, dampener.getNextEligibleTime(start));
+  EXPECT_EQ(0ms, dampener.getRemainingTime("iface1", start + 3000ms));
+  EXPECT_EQ(0ms, dampener.getNextEligibleTime(start + 3000ms));
+
+  // Decayed below suppress threshold, single flap doesn't suppress
+  dampener.reportFlap("iface1", start + 3000ms);
+  EXPECT_DOUBLE_EQ(1500, dampener.getPenalty("iface1", start + 3000ms));
+  EXPECT_EQ(0ms, dampener.getRemainingTime("iface1", start + 3000ms));
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
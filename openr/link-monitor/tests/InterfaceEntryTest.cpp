@@ -35,12 +35,9 @@ TEST(InterfaceEntry, GetSetTest) {
   OpenrEventBase evl;
   AsyncThrottle throttle(evl.getEvb(), std::chrono::milliseconds(1), []() {});
   auto timeout = folly::AsyncTimeout::make(*evl.getEvb(), []() noexcept {});
-  InterfaceEntry interface(
-      "iface1",
-      std::chrono::milliseconds(1),
-      std::chrono::milliseconds(64),
-      throttle,
-      *timeout);
+  InterfaceDampener dampener(
+      std::chrono::milliseconds(1), std::chrono::milliseconds(64));
+  InterfaceEntry interface("iface1", dampener, throttle, *timeout);
 
   EXPECT_EQ("iface1", interface.getIfName());
 
@@ -109,12 +106,9 @@ TEST(InterfaceEntry, BackoffTest) {
   OpenrEventBase evl;
   AsyncThrottle throttle(evl.getEvb(), std::chrono::milliseconds(1), []() {});
   auto timeout = folly::AsyncTimeout::make(*evl.getEvb(), []() noexcept {});
-  InterfaceEntry interface(
-      "iface1",
-      std::chrono::milliseconds(8),
-      std::chrono::milliseconds(512),
-      throttle,
-      *timeout);
+  InterfaceDampener dampener(
+      std::chrono::milliseconds(8), std::chrono::milliseconds(512));
+  InterfaceEntry interface("iface1", dampener, throttle, *timeout);
   std::chrono::milliseconds backoff{0};
 
   // 1. Set interface to UP
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <thread>
 
+#include <fb303/ServiceData.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Format.h>
 #include <folly/init/Init.h>
@@ -355,10 +356,23 @@ class LinkMonitorTestFixture : public ::testing::Test {
   // Receive and process interface updates from the update queue
   void
   recvAndReplyIfUpdate() {
-    auto ifDb = interfaceUpdatesReader.get();
-    ASSERT_TRUE(ifDb.hasValue());
-    // ATTN: update class variable `sparkIfDb` for later verification
-    sparkIfDb = ifDb.value();
+    auto update = interfaceUpdatesReader.get();
+    ASSERT_TRUE(update.hasValue());
+    // ATTN: update class variable `sparkIfDb` for later verification, by
+    // applying update to interfaces received so far
+    if (update->isFullSync) {
+      sparkInterfaces.clear();
+    }
+    for (const auto& info : update->interfaces) {
+      sparkInterfaces[info.ifName] = info;
+    }
+    for (const auto& ifName : update->removedIfNames) {
+      sparkInterfaces.erase(ifName);
+    }
+    sparkIfDb.clear();
+    for (const auto& [_, info] : sparkInterfaces) {
+      sparkIfDb.emplace_back(info);
+    }
     LOG(INFO) << "----------- Interface Updates ----------";
     for (const auto& info : sparkIfDb) {
       LOG(INFO) << "  Name=" << info.ifName << ", Status=" << info.isUp
@@ -550,14 +564,14 @@ class LinkMonitorTestFixture : public ::testing::Test {
   folly::EventBase nlEvb_;
   std::unique_ptr<fbnl::MockNetlinkProtocolSocket> nlSock{nullptr};
 
-  messaging::ReplicateQueue<InterfaceDatabase> interfaceUpdatesQueue;
+  messaging::ReplicateQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue;
   messaging::ReplicateQueue<PeerEvent> peerUpdatesQueue;
   messaging::ReplicateQueue<NeighborEvent> neighborUpdatesQueue;
   messaging::ReplicateQueue<KvStoreSyncEvent> kvStoreSyncEventsQueue;
   messaging::ReplicateQueue<PrefixEvent> prefixUpdatesQueue;
   messaging::ReplicateQueue<DecisionRouteUpdate> staticRouteUpdatesQueue;
   messaging::ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue;
-  messaging::RQueue<InterfaceDatabase> interfaceUpdatesReader{
+  messaging::RQueue<InterfaceDatabaseUpdate> interfaceUpdatesReader{
       interfaceUpdatesQueue.getReader()};
   messaging::ReplicateQueue<openr::LogSample> logSampleQueue;
 
@@ -580,6 +594,7 @@ class LinkMonitorTestFixture : public ::testing::Test {
 
   std::queue<thrift::AdjacencyDatabase> expectedAdjDbs;
   InterfaceDatabase sparkIfDb;
+  std::map<std::string, InterfaceInfo> sparkInterfaces;
 };
 
 // Start LinkMonitor and ensure empty adjacency database and prefixes are
@@ -1020,7 +1035,7 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
     neighborUpdatesQueue.push(std::move(neighborEvent));
   }
 
-  // initial sync event on nb2, kick advertiseAdjacenciesThrottled_
+  // initial sync event on nb2, kick coalesced adjacency advertisement
   kvStoreSyncEventsQueue.push(
       KvStoreSyncEvent(*nb2.nodeName_ref(), kTestingAreaName));
   // another initial sync event from nb3
@@ -1038,6 +1053,54 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
   checkNextAdjPub("adj:node-1");
 }
 
+// Test coalescing of adjacency advertisements
+TEST_F(LinkMonitorTestFixture, CoalesceAdjacencyEvents) {
+  SetUp({});
+  {
+    // restart linkMonitor with long coalescing interval
+    stopLinkMonitor();
+    neighborUpdatesQueue.open();
+    kvStoreSyncEventsQueue.open();
+    nlSock->openQueue();
+    kvStoreWrapper->openQueue();
+
+    auto tConfigCopy = getTestOpenrConfig();
+    auto& lmConf = *tConfigCopy.link_monitor_config_ref();
+    lmConf.adj_advertise_min_interval_ms_ref() = 1000;
+    lmConf.adj_advertise_max_delay_ms_ref() = 3000;
+    createLinkMonitor(std::make_shared<Config>(tConfigCopy));
+  }
+
+  // recv publications until we get adjacency database of node-1
+  auto getNextAdjDb = [&]() {
+    while (true) {
+      auto value = getPublicationValueForKey("adj:node-1");
+      if (value.has_value()) {
+        return readThriftObjStr<thrift::AdjacencyDatabase>(
+            value->value_ref().value(), serializer);
+      }
+    }
+  };
+
+  // neighbor 2 and 3 up
+  for (auto const& nb : {nb2, nb3}) {
+    neighborUpdatesQueue.push(
+        NeighborEvent(NeighborEventType::NEIGHBOR_UP, nb));
+    kvStoreSyncEventsQueue.push(
+        KvStoreSyncEvent(*nb.nodeName_ref(), kTestingAreaName));
+  }
+  while (getNextAdjDb().adjacencies_ref()->size() != 2) {
+  }
+
+  // both neighbors down right after last advertisement. Down events are held
+  // for min-interval and advertised together.
+  for (auto const& nb : {nb2, nb3}) {
+    neighborUpdatesQueue.push(
+        NeighborEvent(NeighborEventType::NEIGHBOR_DOWN, nb));
+  }
+  EXPECT_EQ(0, getNextAdjDb().adjacencies_ref()->size());
+}
+
 // parallel adjacencies between two nodes via different interfaces
 TEST_F(LinkMonitorTestFixture, ParallelAdj) {
   SetUp({});
@@ -1721,6 +1784,74 @@ TEST_F(LinkMonitorTestFixture, DampenLinkFlaps) {
   }
 }
 
+// Test bursts of link events are coalesced into their net change
+TEST_F(LinkMonitorTestFixture, CoalesceNetlinkEvents) {
+  SetUp({}, std::chrono::milliseconds(2000), std::chrono::milliseconds(4000));
+  const std::string linkX = kTestVethNamePrefix + "X";
+
+  nlEventsInjector->sendLinkEvent(
+      linkX /* link name */,
+      kTestVethIfIndex[0] /* ifIndex */,
+      true /* is up */);
+  recvAndReplyIfUpdate();
+  EXPECT_TRUE(checkExpectedUPCount(sparkIfDb, 1));
+
+  auto getCounter = [](std::string const& key) {
+    auto counters = fb303::fbData->getCounters();
+    return counters.count(key) ? counters.at(key) : 0;
+  };
+  const auto numReceived =
+      getCounter("link_monitor.netlink_events.received.sum");
+  const auto numApplied = getCounter("link_monitor.netlink_events.applied.sum");
+
+  // link flaps several times and ends up UP
+  const int numFlaps{5};
+  for (int i = 0; i < numFlaps; ++i) {
+    nlEventsInjector->sendLinkEvent(linkX, kTestVethIfIndex[0], false);
+    nlEventsInjector->sendLinkEvent(linkX, kTestVethIfIndex[0], true);
+  }
+
+  // flap is still reported, link is held DOWN by backoff
+  recvAndReplyIfUpdate();
+  EXPECT_TRUE(checkExpectedUPCount(sparkIfDb, 0));
+  auto links = linkMonitor->getInterfaces().get();
+  EXPECT_TRUE(links->interfaceDetails_ref()
+                  ->at(linkX)
+                  .linkFlapBackOffMs_ref()
+                  .has_value());
+
+  // wait for all events to be received
+  while (getCounter("link_monitor.netlink_events.received.sum") <
+         numReceived + 2 * numFlaps) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(Constants::kNetlinkEventCoalesceWindow * 2);
+  EXPECT_LT(
+      getCounter("link_monitor.netlink_events.applied.sum") - numApplied,
+      2 * numFlaps);
+}
+
+// Test interfaces are re-synced from netlink when events were lost
+TEST_F(LinkMonitorTestFixture, ResyncOnEventsLost) {
+  SetUp({});
+  const std::string linkX = kTestVethNamePrefix + "X";
+  const std::string linkY = kTestVethNamePrefix + "Y";
+
+  nlEventsInjector->sendLinkEvent(linkX, kTestVethIfIndex[0], true);
+  recvAndReplyIfUpdate();
+  EXPECT_TRUE(checkExpectedUPCount(sparkIfDb, 1));
+
+  // LINK event of linkY is lost, learnt from full dump upon overrun
+  nlSock->dropEvents(true);
+  nlEventsInjector->sendLinkEvent(linkY, kTestVethIfIndex[1], true);
+  nlSock->dropEvents(false);
+  recvAndReplyIfUpdate();
+  EXPECT_TRUE(checkExpectedUPCount(sparkIfDb, 2));
+
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters.at("link_monitor.interface_resync.events_lost.sum"));
+}
+
 // Test Interface events to Spark
 TEST_F(LinkMonitorTestFixture, verifyLinkEventSubscription) {
   SetUp({});
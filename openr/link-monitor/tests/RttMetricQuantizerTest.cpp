@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/link-monitor/RttMetricQuantizer.h>
+
+using namespace std::chrono_literals;
+
+namespace openr {
+
+/**
+ * Verify metric follows every RTT change without quantization config
+ */
+TEST(RttMetricQuantizer, NoQuantization) {
+  RttMetricQuantizer quantizer;
+  const auto start = RttMetricQuantizer::Clock::now();
+
+  EXPECT_EQ(1, quantizer.getMetric(0));
+  EXPECT_EQ(1, quantizer.getMetric(150));
+  EXPECT_EQ(12, quantizer.getMetric(1250));
+
+  EXPECT_EQ(12, quantizer.getMetricChange(1000, 1250));
+  EXPECT_EQ(10, quantizer.getMetricChange(1250, 1010));
+  EXPECT_EQ(0ms, quantizer.getRemainingHoldTime(start, start));
+}
+
+/**
+ * Verify banding and hysteresis
+ * - metric is the one of the lower bound of the band
+ * - RTT within hysteresis of the advertised band doesn't change metric
+ */
+TEST(RttMetricQuantizer, Hysteresis) {
+  thrift::RttMetricQuantizationConfig config;
+  config.band_width_us_ref() = 1000;
+  config.hysteresis_us_ref() = 200;
+  RttMetricQuantizer quantizer(config);
+
+  EXPECT_EQ(1, quantizer.getMetric(999));
+  EXPECT_EQ(10, quantizer.getMetric(1000));
+  EXPECT_EQ(10, quantizer.getMetric(1999));
+  EXPECT_EQ(20, quantizer.getMetric(2000));
+
+  // advertised band is [1000, 2000)
+  EXPECT_EQ(std::nullopt, quantizer.getMetricChange(1500, 1999));
+  EXPECT_EQ(std::nullopt, quantizer.getMetricChange(1500, 2199));
+  EXPECT_EQ(std::nullopt, quantizer.getMetricChange(1500, 800));
+  EXPECT_EQ(20, quantizer.getMetricChange(1500, 2200));
+  EXPECT_EQ(1, quantizer.getMetricChange(1500, 799));
+
+  // jitter around 2000 only changes metric once
+  EXPECT_EQ(20, quantizer.getMetricChange(1900, 2300));
+  EXPECT_EQ(std::nullopt, quantizer.getMetricChange(2300, 1900));
+  EXPECT_EQ(std::nullopt, quantizer.getMetricChange(2300, 2100));
+}
+
+/**
+ * Verify remaining hold time since the last metric change
+ */
+TEST(RttMetricQuantizer, HoldTime) {
+  thrift::RttMetricQuantizationConfig config;
+  config.min_hold_time_ms_ref() = 100;
+  RttMetricQuantizer quantizer(config);
+  const auto start = RttMetricQuantizer::Clock::now();
+
+  EXPECT_EQ(100ms, quantizer.getRemainingHoldTime(start, start));
+  EXPECT_EQ(60ms, quantizer.getRemainingHoldTime(start, start + 40ms));
+  EXPECT_EQ(1ms, quantizer.getRemainingHoldTime(start, start + 99900us));
+  EXPECT_EQ(0ms, quantizer.getRemainingHoldTime(start, start + 100ms));
+  EXPECT_EQ(0ms, quantizer.getRemainingHoldTime(start, start + 1s));
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
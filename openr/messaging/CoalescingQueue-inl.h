@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+namespace openr {
+namespace messaging {
+
+template <typename KeyType, typename ValueType>
+CoalescingQueue<KeyType, ValueType>::CoalescingQueue() {}
+
+template <typename KeyType, typename ValueType>
+CoalescingQueue<KeyType, ValueType>::~CoalescingQueue() {
+  close();
+}
+
+template <typename KeyType, typename ValueType>
+template <typename KeyTypeT, typename ValueTypeT>
+bool
+CoalescingQueue<KeyType, ValueType>::push(KeyTypeT&& key, ValueTypeT&& val) {
+  std::lock_guard<std::mutex> l(lock_);
+
+  // If queue is closed, don't enqueue
+  if (closed_) {
+    return false;
+  }
+
+  if (pendingReads_.size()) {
+    // Unblock a pending read. Queue must be empty.
+    auto& pendingRead = pendingReads_.front().get();
+    pendingRead.data.emplace(
+        std::forward<KeyTypeT>(key), std::forward<ValueTypeT>(val));
+    pendingRead.baton.post();
+    pendingReads_.pop_front();
+    return true;
+  }
+
+  auto it = values_.find(key);
+  if (it != values_.end()) {
+    // Replace unread value, keeping its position
+    it->second = std::forward<ValueTypeT>(val);
+    ++numCoalesced_;
+  } else {
+    // Add data into the queue
+    keys_.emplace_back(key);
+    values_.emplace(std::forward<KeyTypeT>(key), std::forward<ValueTypeT>(val));
+  }
+
+  return true;
+}
+
+template <typename KeyType, typename ValueType>
+folly::Expected<
+    typename CoalescingQueue<KeyType, ValueType>::ElementType,
+    QueueError>
+CoalescingQueue<KeyType, ValueType>::get() {
+  PendingRead pendingRead;
+
+  // Queue is closed
+  auto maybeImmediateRead = getAnyImpl(pendingRead);
+  if (maybeImmediateRead.hasError()) {
+    return folly::makeUnexpected(maybeImmediateRead.error());
+  }
+
+  // Post our own baton if read is immediate to ensure fiber-fairness
+  if (maybeImmediateRead.value()) {
+    CHECK(pendingRead.data);
+    pendingRead.baton.post();
+  }
+
+  // Wait for baton and read the data
+  pendingRead.baton.wait();
+  if (pendingRead.data) {
+    return std::move(pendingRead.data).value();
+  }
+  return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+}
+
+#if FOLLY_HAS_COROUTINES
+template <typename KeyType, typename ValueType>
+folly::coro::Task<folly::Expected<
+    typename CoalescingQueue<KeyType, ValueType>::ElementType,
+    QueueError>>
+CoalescingQueue<KeyType, ValueType>::getCoro() {
+  PendingRead pendingRead;
+
+  // Queue is closed
+  auto maybeImmediateRead = getAnyImpl(pendingRead);
+  if (maybeImmediateRead.hasError()) {
+    co_return folly::makeUnexpected(maybeImmediateRead.error());
+  }
+
+  // Wait if there is no data
+  if (maybeImmediateRead.value()) {
+    CHECK(pendingRead.data);
+    pendingRead.baton.post();
+  }
+
+  // Wait for baton and read the data
+  co_await pendingRead.baton;
+  if (pendingRead.data) {
+    co_return std::move(pendingRead.data).value();
+  }
+  co_return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+}
+#endif
+
+template <typename KeyType, typename ValueType>
+folly::Expected<bool, QueueError>
+CoalescingQueue<KeyType, ValueType>::getAnyImpl(PendingRead& pendingRead) {
+  std::lock_guard<std::mutex> l(lock_);
+
+  // If queue is closed, return immediately
+  if (closed_) {
+    return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+  }
+
+  // Perform immediate read if data is available
+  if (keys_.size()) {
+    auto it = values_.find(keys_.front());
+    CHECK(it != values_.end());
+    pendingRead.data.emplace(std::move(keys_.front()), std::move(it->second));
+    values_.erase(it);
+    keys_.pop_front();
+    return true;
+  }
+
+  // Else enqueue read request
+  pendingReads_.emplace_back(pendingRead);
+  return false;
+}
+
+template <typename KeyType, typename ValueType>
+void
+CoalescingQueue<KeyType, ValueType>::close() {
+  std::lock_guard<std::mutex> l(lock_);
+
+  if (not closed_) {
+    closed_ = true;
+    // Set empty value to all pending reads
+    while (pendingReads_.size()) {
+      auto& pendingRead = pendingReads_.front().get();
+      pendingRead.baton.post();
+      pendingReads_.pop_front();
+    }
+    keys_.clear();
+    values_.clear();
+  }
+}
+
+template <typename KeyType, typename ValueType>
+bool
+CoalescingQueue<KeyType, ValueType>::isClosed() {
+  std::lock_guard<std::mutex> l(lock_);
+  return closed_;
+}
+
+template <typename KeyType, typename ValueType>
+size_t
+CoalescingQueue<KeyType, ValueType>::size() {
+  std::lock_guard<std::mutex> l(lock_);
+  return keys_.size();
+}
+
+template <typename KeyType, typename ValueType>
+size_t
+CoalescingQueue<KeyType, ValueType>::numCoalesced() {
+  std::lock_guard<std::mutex> l(lock_);
+  return numCoalesced_;
+}
+
+template <typename KeyType, typename ValueType>
+size_t
+CoalescingQueue<KeyType, ValueType>::numPendingReads() {
+  std::lock_guard<std::mutex> l(lock_);
+  return pendingReads_.size();
+}
+
+} // namespace messaging
+} // namespace openr
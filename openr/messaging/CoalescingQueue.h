@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include <folly/Expected.h>
+#include <folly/fibers/Baton.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/experimental/coro/Task.h>
+#endif
+
+#include <openr/messaging/Queue.h>
+
+namespace openr {
+namespace messaging {
+
+/**
+ * Multiple writers and readers queue for "latest state wins" data. Every
+ * element is associated with a key. Pushing a value for a key which has an
+ * unread value replaces that value in place, i.e. it keeps the position of
+ * the unread one. Readers never see stale intermediate states and their work
+ * is bounded by the number of distinct keys rather than by the update rate.
+ *
+ * Same as RWQueue, data is protected by a lock, reads are blocking for native
+ * threads/fibers or asynchronous for co-routines. After closing queue, all
+ * subsequent push are ignored and return false, all subsequent reads return
+ * QUEUE_CLOSED error.
+ */
+template <typename KeyType, typename ValueType>
+class CoalescingQueue {
+ public:
+  using ElementType = std::pair<KeyType, ValueType>;
+
+  CoalescingQueue();
+  ~CoalescingQueue();
+
+  /**
+   * non-copyable
+   */
+  CoalescingQueue(CoalescingQueue const&) = delete;
+  CoalescingQueue& operator=(CoalescingQueue const&) = delete;
+
+  /**
+   * Non blocking push. Replaces unread value of `key` if any.
+   * Return true/false!!
+   */
+  template <typename KeyTypeT, typename ValueTypeT>
+  bool push(KeyTypeT&& key, ValueTypeT&& val);
+
+  /**
+   * Blocking read for native threads/fibers. In-case of fibers, the fiber
+   * performing blocking read will be suspended.
+   */
+  folly::Expected<ElementType, QueueError> get();
+
+#if FOLLY_HAS_COROUTINES
+  /**
+   * Read methods for co-routines
+   */
+  folly::coro::Task<folly::Expected<ElementType, QueueError>> getCoro();
+#endif
+
+  /**
+   * Close the queue. All new push will be ignored and pending data will be lost
+   */
+  void close();
+  bool isClosed();
+
+  /**
+   * Return size of the current queue (number of keys with unread value)
+   */
+  size_t size();
+
+  /**
+   * Return number of values replaced before being read
+   */
+  size_t numCoalesced();
+
+  /**
+   * Return number of active reads
+   */
+  size_t numPendingReads();
+
+ private:
+  struct PendingRead {
+    folly::fibers::Baton baton;
+    std::optional<ElementType> data;
+  };
+
+  /**
+   * Implementation for reading a pending or future data element.
+   *
+   * @returns true/false indicating if immediate read is performed
+   * @returns QUEUE_CLOSED error if queue is closed.
+   */
+  folly::Expected<bool, QueueError> getAnyImpl(PendingRead& pendingRead);
+
+  // Lock to protect below private variables
+  std::mutex lock_;
+
+  // State of queue
+  bool closed_{false};
+
+  // Pending reads - readers are actively waiting for data
+  std::deque<std::reference_wrapper<PendingRead>> pendingReads_;
+
+  // Pending data. Keys in order of their oldest unread push, and their latest
+  // value.
+  std::deque<KeyType> keys_;
+  std::unordered_map<KeyType, ValueType> values_;
+
+  size_t numCoalesced_{0};
+};
+
+} // namespace messaging
+} // namespace openr
+
+#include <openr/messaging/CoalescingQueue-inl.h>
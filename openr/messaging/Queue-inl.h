@@ -22,6 +22,13 @@ RQueue<ValueType>::get() {
   return queue_->get();
 }
 
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RQueue<ValueType>::getBatch(
+    size_t maxItems, std::chrono::milliseconds maxWait) {
+  return queue_->getBatch(maxItems, maxWait);
+}
+
 #if FOLLY_HAS_COROUTINES
 template <typename ValueType>
 folly::coro::Task<folly::Expected<ValueType, QueueError>>
@@ -29,6 +36,14 @@ RQueue<ValueType>::getCoro() {
   auto val = co_await queue_->getCoro();
   co_return val;
 }
+
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RQueue<ValueType>::getBatchCoro(
+    size_t maxItems, std::chrono::milliseconds maxWait) {
+  auto val = co_await queue_->getBatchCoro(maxItems, maxWait);
+  co_return val;
+}
 #endif
 
 template <typename ValueType>
@@ -40,6 +55,21 @@ RQueue<ValueType>::size() {
 template <typename ValueType>
 RWQueue<ValueType>::RWQueue() {}
 
+template <typename ValueType>
+RWQueue<ValueType>::RWQueue(RWQueueOptions<ValueType> options)
+    : options_(std::move(options)) {
+  if (not options_.statsName.empty()) {
+    stats_ = std::make_unique<QueueStats>(options_.statsName);
+  }
+  if (options_.capacity) {
+    CHECK(
+        options_.policy != BackpressurePolicy::COALESCE or
+        options_.coalesceFn)
+        << "COALESCE policy requires coalesceFn";
+    ring_ = std::make_unique<RingBuffer<Entry>>(options_.capacity);
+  }
+}
+
 template <typename ValueType>
 RWQueue<ValueType>::~RWQueue() {
   close();
@@ -49,6 +79,10 @@ template <typename ValueType>
 template <typename ValueTypeT>
 bool
 RWQueue<ValueType>::push(ValueTypeT&& val) {
+  if (ring_) {
+    return pushRing(std::forward<ValueTypeT>(val));
+  }
+
   std::lock_guard<std::mutex> l(lock_);
 
   // If queue is closed, don't enqueue
@@ -62,9 +96,15 @@ RWQueue<ValueType>::push(ValueTypeT&& val) {
     pendingRead.data = std::forward<ValueTypeT>(val);
     pendingRead.baton.post();
     pendingReads_.pop_front();
+    if (stats_) {
+      stats_->onRead(QueueStats::Clock::now(), 0);
+    }
   } else {
     // Add data into the queue
-    queue_.emplace_back(std::forward<ValueTypeT>(val));
+    queue_.emplace_back(std::forward<ValueTypeT>(val), getEnqueueTime());
+    if (stats_) {
+      stats_->onPush(queue_.size());
+    }
   }
 
   return true;
@@ -73,6 +113,21 @@ RWQueue<ValueType>::push(ValueTypeT&& val) {
 template <typename ValueType>
 folly::Expected<ValueType, QueueError>
 RWQueue<ValueType>::get() {
+  if (ring_) {
+    while (true) {
+      PendingRead pendingRead;
+      auto maybeImmediateRead = getRingImpl(pendingRead);
+      if (maybeImmediateRead.hasError()) {
+        return folly::makeUnexpected(maybeImmediateRead.error());
+      }
+      if (maybeImmediateRead.value()) {
+        return std::move(pendingRead.data).value();
+      }
+      // Wait for data and retry
+      pendingRead.baton.wait();
+    }
+  }
+
   PendingRead pendingRead;
 
   // Queue is closed
@@ -101,6 +156,21 @@ RWQueue<ValueType>::get() {
 template <typename ValueType>
 folly::coro::Task<folly::Expected<ValueType, QueueError>>
 RWQueue<ValueType>::getCoro() {
+  if (ring_) {
+    while (true) {
+      PendingRead pendingRead;
+      auto maybeImmediateRead = getRingImpl(pendingRead);
+      if (maybeImmediateRead.hasError()) {
+        co_return folly::makeUnexpected(maybeImmediateRead.error());
+      }
+      if (maybeImmediateRead.value()) {
+        co_return std::move(pendingRead.data).value();
+      }
+      // Wait for data and retry
+      co_await pendingRead.baton;
+    }
+  }
+
   PendingRead pendingRead;
 
   // Queue is closed
@@ -124,6 +194,107 @@ RWQueue<ValueType>::getCoro() {
 }
 #endif
 
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RWQueue<ValueType>::getBatch(
+    size_t maxItems, std::chrono::milliseconds maxWait) {
+  auto maybeFirst = get();
+  if (maybeFirst.hasError()) {
+    return folly::makeUnexpected(maybeFirst.error());
+  }
+
+  std::vector<ValueType> batch;
+  batch.emplace_back(std::move(maybeFirst).value());
+  drainInto(batch, maxItems);
+
+  const auto deadline = std::chrono::steady_clock::now() + maxWait;
+  while (batch.size() < maxItems and not closed_) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      break;
+    }
+    auto maybeVal = getFor(deadline - now);
+    if (maybeVal) {
+      batch.emplace_back(std::move(maybeVal).value());
+      drainInto(batch, maxItems);
+    }
+  }
+  return batch;
+}
+
+#if FOLLY_HAS_COROUTINES
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RWQueue<ValueType>::getBatchCoro(
+    size_t maxItems, std::chrono::milliseconds maxWait) {
+  auto maybeFirst = co_await getCoro();
+  if (maybeFirst.hasError()) {
+    co_return folly::makeUnexpected(maybeFirst.error());
+  }
+
+  std::vector<ValueType> batch;
+  batch.emplace_back(std::move(maybeFirst).value());
+  drainInto(batch, maxItems);
+
+  if (batch.size() < maxItems and maxWait.count() > 0) {
+    co_await folly::coro::sleep(maxWait);
+    drainInto(batch, maxItems);
+  }
+  co_return batch;
+}
+#endif
+
+template <typename ValueType>
+std::optional<ValueType>
+RWQueue<ValueType>::getFor(std::chrono::steady_clock::duration timeout) {
+  PendingRead pendingRead;
+
+  auto maybeImmediateRead =
+      ring_ ? getRingImpl(pendingRead) : getAnyImpl(pendingRead);
+  if (maybeImmediateRead.hasError()) {
+    return std::nullopt;
+  }
+  if (maybeImmediateRead.value()) {
+    return std::move(pendingRead.data);
+  }
+
+  // Withdraw read request on timeout. If writer fulfilled it meanwhile, data
+  // is already set (under lock) and we keep it.
+  if (not pendingRead.baton.try_wait_for(timeout)) {
+    removePendingRead(pendingRead);
+  }
+
+  // Bounded queue posts the baton without data, read it now
+  if (ring_ and not closed_ and not pendingRead.data) {
+    tryReadRing(pendingRead);
+  }
+  return std::move(pendingRead.data);
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::drainInto(std::vector<ValueType>& batch, size_t maxItems) {
+  if (ring_) {
+    while (batch.size() < maxItems and not closed_) {
+      PendingRead pendingRead;
+      if (not tryReadRing(pendingRead)) {
+        break;
+      }
+      batch.emplace_back(std::move(pendingRead.data).value());
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  while (batch.size() < maxItems and queue_.size()) {
+    batch.emplace_back(std::move(queue_.front().value));
+    if (stats_) {
+      stats_->onRead(queue_.front().enqueueTime, queue_.size() - 1);
+    }
+    queue_.pop_front();
+  }
+}
+
 template <typename ValueType>
 folly::Expected<bool, QueueError>
 RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
@@ -136,7 +307,10 @@ RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
 
   // Perform immediate read if data is available
   if (queue_.size()) {
-    pendingRead.data = std::move(queue_.front());
+    pendingRead.data = std::move(queue_.front().value);
+    if (stats_) {
+      stats_->onRead(queue_.front().enqueueTime, queue_.size() - 1);
+    }
     queue_.pop_front();
     return true;
   }
@@ -146,6 +320,214 @@ RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
   return false;
 }
 
+template <typename ValueType>
+template <typename ValueTypeT>
+bool
+RWQueue<ValueType>::pushRing(ValueTypeT&& val) {
+  if (closed_) {
+    return false;
+  }
+
+  // Once an overflow element exists, every push is merged into it to preserve
+  // ordering until the reader drains it
+  if (hasCoalesced_.load(std::memory_order_acquire)) {
+    std::unique_lock<std::mutex> l(lock_);
+    if (closed_) {
+      return false;
+    }
+    if (coalesced_) {
+      options_.coalesceFn(
+          *coalesced_, ValueType(std::forward<ValueTypeT>(val)));
+      l.unlock();
+      notifyReader();
+      return true;
+    }
+  }
+
+  while (true) {
+    if (ring_->tryEnqueue(std::forward<ValueTypeT>(val), getEnqueueTime())) {
+      if (stats_) {
+        stats_->onPush(ring_->size());
+      }
+      notifyReader();
+      return true;
+    }
+
+    // Ring is full
+    switch (options_.policy) {
+    case BackpressurePolicy::DROP_OLDEST: {
+      ring_->tryDequeue();
+      break;
+    }
+    case BackpressurePolicy::COALESCE: {
+      std::unique_lock<std::mutex> l(lock_);
+      if (closed_) {
+        return false;
+      }
+      if (coalesced_) {
+        options_.coalesceFn(
+            *coalesced_, ValueType(std::forward<ValueTypeT>(val)));
+      } else {
+        coalesced_.emplace(std::forward<ValueTypeT>(val));
+        coalescedTime_ = getEnqueueTime();
+        hasCoalesced_.store(true, std::memory_order_release);
+      }
+      if (stats_) {
+        stats_->onPush(ring_->size() + 1);
+      }
+      l.unlock();
+      notifyReader();
+      return true;
+    }
+    case BackpressurePolicy::BLOCK: {
+      folly::fibers::Baton baton;
+      {
+        std::lock_guard<std::mutex> l(lock_);
+        if (closed_) {
+          return false;
+        }
+        pendingWrites_.emplace_back(baton);
+        numWaitingWrites_.fetch_add(1);
+      }
+
+      // Re-check after registering, reader may have made room before seeing us
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (not ring_->full()) {
+        std::lock_guard<std::mutex> l(lock_);
+        auto it = std::find_if(
+            pendingWrites_.begin(), pendingWrites_.end(), [&baton](auto& b) {
+              return &b.get() == &baton;
+            });
+        if (it != pendingWrites_.end()) {
+          pendingWrites_.erase(it);
+          numWaitingWrites_.fetch_sub(1);
+          baton.post();
+        }
+      }
+      baton.wait();
+      if (closed_) {
+        return false;
+      }
+      break;
+    }
+    }
+  }
+}
+
+template <typename ValueType>
+folly::Expected<bool, QueueError>
+RWQueue<ValueType>::getRingImpl(PendingRead& pendingRead) {
+  // If queue is closed, return immediately
+  if (closed_) {
+    return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+  }
+
+  // Perform immediate read if data is available
+  if (tryReadRing(pendingRead)) {
+    return true;
+  }
+
+  // Else enqueue read request
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (closed_) {
+      return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+    }
+    pendingReads_.emplace_back(pendingRead);
+    numWaitingReads_.fetch_add(1);
+  }
+
+  // Re-check after registering, writer may have pushed before seeing us
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if ((not ring_->empty() or hasCoalesced_.load()) and
+      removePendingRead(pendingRead)) {
+    pendingRead.baton.post();
+  }
+  return false;
+}
+
+template <typename ValueType>
+bool
+RWQueue<ValueType>::tryReadRing(PendingRead& pendingRead) {
+  auto entry = ring_->tryDequeue();
+  if (entry) {
+    pendingRead.data = std::move(entry->value);
+    if (stats_) {
+      stats_->onRead(
+          entry->enqueueTime, ring_->size() + (hasCoalesced_ ? 1 : 0));
+    }
+    notifyWriter();
+    return true;
+  }
+
+  // Overflow element is read only after the ring got drained
+  if (hasCoalesced_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> l(lock_);
+    if (coalesced_) {
+      pendingRead.data = std::move(coalesced_);
+      coalesced_.reset();
+      hasCoalesced_.store(false, std::memory_order_release);
+      if (stats_) {
+        stats_->onRead(coalescedTime_, ring_->size());
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename ValueType>
+bool
+RWQueue<ValueType>::removePendingRead(PendingRead& pendingRead) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto it = std::find_if(
+      pendingReads_.begin(), pendingReads_.end(), [&pendingRead](auto& r) {
+        return &r.get() == &pendingRead;
+      });
+  if (it == pendingReads_.end()) {
+    return false;
+  }
+  pendingReads_.erase(it);
+  if (ring_) {
+    numWaitingReads_.fetch_sub(1);
+  }
+  return true;
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::notifyReader() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numWaitingReads_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  if (pendingReads_.size()) {
+    // Reader retries the read once woken up
+    pendingReads_.front().get().baton.post();
+    pendingReads_.pop_front();
+    numWaitingReads_.fetch_sub(1);
+  }
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::notifyWriter() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numWaitingWrites_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  if (pendingWrites_.size()) {
+    // Writer retries the push once woken up
+    pendingWrites_.front().get().post();
+    pendingWrites_.pop_front();
+    numWaitingWrites_.fetch_sub(1);
+  }
+}
+
 template <typename ValueType>
 void
 RWQueue<ValueType>::close() {
@@ -162,6 +544,20 @@ RWQueue<ValueType>::close() {
       pendingReads_.pop_front();
     }
     queue_.clear();
+
+    // Bounded queue
+    while (pendingWrites_.size()) {
+      pendingWrites_.front().get().post();
+      pendingWrites_.pop_front();
+    }
+    numWaitingReads_ = 0;
+    numWaitingWrites_ = 0;
+    if (ring_) {
+      while (ring_->tryDequeue().has_value()) {
+      }
+    }
+    coalesced_.reset();
+    hasCoalesced_ = false;
   }
 }
 
@@ -175,6 +571,9 @@ RWQueue<ValueType>::isClosed() {
 template <typename ValueType>
 size_t
 RWQueue<ValueType>::size() {
+  if (ring_) {
+    return ring_->size() + (hasCoalesced_ ? 1 : 0);
+  }
   std::lock_guard<std::mutex> l(lock_);
   return queue_.size();
 }
@@ -7,18 +7,29 @@
 
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <atomic>
+#include <chrono>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <folly/Expected.h>
 #include <folly/fibers/Baton.h>
 #if FOLLY_HAS_COROUTINES
+#include <folly/experimental/coro/Sleep.h>
 #include <folly/experimental/coro/Task.h>
 #endif
 
+#include <openr/messaging/QueueStats.h>
+#include <openr/messaging/RingBuffer.h>
+
 namespace openr {
 namespace messaging {
 
@@ -26,6 +37,34 @@ enum class QueueError {
   QUEUE_CLOSED,
 };
 
+/**
+ * Behavior of bounded RWQueue on push when it is full
+ */
+enum class BackpressurePolicy {
+  // Writer waits until a reader makes room
+  BLOCK,
+  // Oldest element is discarded to make room
+  DROP_OLDEST,
+  // Value is merged into a single overflow element read after the buffered
+  // ones, using `RWQueueOptions::coalesceFn`
+  COALESCE,
+};
+
+template <typename ValueType>
+struct RWQueueOptions {
+  // Bound on number of buffered elements. 0 means unbounded, lock based queue
+  size_t capacity{0};
+
+  BackpressurePolicy policy{BackpressurePolicy::BLOCK};
+
+  // Merge newer value `from` into older value `into`. Required for COALESCE
+  std::function<void(ValueType& into, ValueType&& from)> coalesceFn;
+
+  // Timestamp elements on push and export QueueStats under this name, unless
+  // empty
+  std::string statsName;
+};
+
 template <typename ValueType>
 class RWQueue;
 
@@ -44,11 +83,22 @@ class RQueue {
    */
   folly::Expected<ValueType, QueueError> get();
 
+  /**
+   * Blocking batch read. Refer to RWQueue::getBatch
+   */
+  folly::Expected<std::vector<ValueType>, QueueError> getBatch(
+      size_t maxItems,
+      std::chrono::milliseconds maxWait = std::chrono::milliseconds(0));
+
 #if FOLLY_HAS_COROUTINES
   /**
    * Read methods for co-routines
    */
   folly::coro::Task<folly::Expected<ValueType, QueueError>> getCoro();
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getBatchCoro(
+      size_t maxItems,
+      std::chrono::milliseconds maxWait = std::chrono::milliseconds(0));
 #endif
 
   // Utility function to retrieve size of pending data in underlying queue
@@ -68,15 +118,22 @@ class RQueue {
  *
  * After closing queue, all subsequent push are ignored and return false. All
  * subsequent reads return QUEUE_CLOSED error
+ *
+ * With non-zero `RWQueueOptions::capacity` data is buffered in a bounded
+ * lock-free ring instead. Push and read don't take the lock unless a reader
+ * (or blocked writer) has to be woken up, or the ring is full and the value is
+ * handled as per `RWQueueOptions::policy`.
  */
 template <typename ValueType>
 class RWQueue {
  public:
   RWQueue();
+  explicit RWQueue(RWQueueOptions<ValueType> options);
   ~RWQueue();
 
   /**
-   * Non blocking push. Any typed value can be pushed!
+   * Non blocking push, unless queue is bounded with BLOCK policy and full.
+   * Any typed value can be pushed!
    * Return true/false!!
    */
   template <typename ValueTypeT>
@@ -88,11 +145,30 @@ class RWQueue {
    */
   folly::Expected<ValueType, QueueError> get();
 
+  /**
+   * Blocking batch read. Waits for the first element like get(), then returns
+   * it along with the pending elements, up to `maxItems` in total. If there
+   * are fewer, waits up to `maxWait` for more elements to arrive. Error is
+   * returned only if the queue is closed before the first element is read.
+   */
+  folly::Expected<std::vector<ValueType>, QueueError> getBatch(
+      size_t maxItems,
+      std::chrono::milliseconds maxWait = std::chrono::milliseconds(0));
+
 #if FOLLY_HAS_COROUTINES
   /**
    * Read methods for co-routines
    */
   folly::coro::Task<folly::Expected<ValueType, QueueError>> getCoro();
+
+  /**
+   * Coroutine counterpart of getBatch. If the batch isn't full, pending
+   * elements are drained once more after sleeping for `maxWait`.
+   */
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getBatchCoro(
+      size_t maxItems,
+      std::chrono::milliseconds maxWait = std::chrono::milliseconds(0));
 #endif
 
   /**
@@ -117,6 +193,22 @@ class RWQueue {
     std::optional<ValueType> data;
   };
 
+  // Buffered element
+  struct Entry {
+    template <typename ValueTypeT>
+    Entry(ValueTypeT&& val, QueueStats::Clock::time_point time)
+        : value(std::forward<ValueTypeT>(val)), enqueueTime(time) {}
+
+    ValueType value;
+    // Only set if stats are enabled
+    QueueStats::Clock::time_point enqueueTime;
+  };
+
+  QueueStats::Clock::time_point
+  getEnqueueTime() const {
+    return stats_ ? QueueStats::Clock::now() : QueueStats::Clock::time_point();
+  }
+
   /**
    * Implementation for reading a pending or future data element.
    *
@@ -125,17 +217,58 @@ class RWQueue {
    */
   folly::Expected<bool, QueueError> getAnyImpl(PendingRead& pendingRead);
 
+  /**
+   * Bounded queue counterparts of push and getAnyImpl. A read which is not
+   * immediate must be retried once its baton is posted.
+   */
+  template <typename ValueTypeT>
+  bool pushRing(ValueTypeT&& val);
+  folly::Expected<bool, QueueError> getRingImpl(PendingRead& pendingRead);
+  bool tryReadRing(PendingRead& pendingRead);
+
+  // Remove read request which is no longer waited on. Return false if it was
+  // already fulfilled (and removed) by a writer.
+  bool removePendingRead(PendingRead& pendingRead);
+
+  // Read one element, waiting no longer than `timeout`
+  std::optional<ValueType> getFor(std::chrono::steady_clock::duration timeout);
+
+  // Move pending elements into `batch` until it holds `maxItems` elements
+  void drainInto(std::vector<ValueType>& batch, size_t maxItems);
+
+  // Wake up one waiting reader, respectively blocked writer, if any
+  void notifyReader();
+  void notifyWriter();
+
+  const RWQueueOptions<ValueType> options_;
+
+  // Optional instrumentation
+  std::unique_ptr<QueueStats> stats_;
+
   // Lock to protect below private variables
   std::mutex lock_;
 
   // State of queue
-  bool closed_{false};
+  std::atomic<bool> closed_{false};
 
   // Pending reads - readers are actively waiting for data
   std::deque<std::reference_wrapper<PendingRead>> pendingReads_;
 
   // Pending data
-  std::deque<ValueType> queue_;
+  std::deque<Entry> queue_;
+
+  // Bounded queue only. Counters mirror sizes of pendingReads_/pendingWrites_
+  // so that producers/consumers can skip the lock when nobody waits.
+  std::unique_ptr<RingBuffer<Entry>> ring_;
+  std::deque<std::reference_wrapper<folly::fibers::Baton>> pendingWrites_;
+  std::atomic<size_t> numWaitingReads_{0};
+  std::atomic<size_t> numWaitingWrites_{0};
+
+  // Bounded queue with COALESCE policy only. Overflow element, read after
+  // all elements of the ring.
+  std::optional<ValueType> coalesced_;
+  QueueStats::Clock::time_point coalescedTime_;
+  std::atomic<bool> hasCoalesced_{false};
 };
 
 } // namespace messaging
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <fb303/ServiceData.h>
+
+namespace openr {
+namespace messaging {
+
+/**
+ * Latency and depth instrumentation of a queue, exported as fb303 counters
+ * under `name`
+ * - `<name>.wait_ms` (p50/p95/p99): time elements waited in the queue
+ * - `<name>.depth`: number of elements read by nobody yet, i.e. reader lag
+ * - `<name>.depth_hwm`: highest depth seen so far
+ */
+class QueueStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit QueueStats(std::string const& name)
+      : waitTimeKey_(name + ".wait_ms"),
+        depthKey_(name + ".depth"),
+        depthHwmKey_(name + ".depth_hwm") {
+    fb303::fbData->addHistogram(waitTimeKey_, 5, 0, 5000);
+    fb303::fbData->exportHistogramPercentile(waitTimeKey_, 50, 95, 99);
+    fb303::fbData->setCounter(depthKey_, 0);
+    fb303::fbData->setCounter(depthHwmKey_, 0);
+  }
+
+  // Element got queued, `depth` including it
+  void
+  onPush(size_t depth) {
+    fb303::fbData->setCounter(depthKey_, depth);
+    size_t hwm = depthHwm_.load(std::memory_order_relaxed);
+    while (depth > hwm) {
+      if (depthHwm_.compare_exchange_weak(hwm, depth)) {
+        fb303::fbData->setCounter(depthHwmKey_, depth);
+        break;
+      }
+    }
+  }
+
+  // Element queued at `enqueueTime` got read, `depth` elements remain
+  void
+  onRead(Clock::time_point enqueueTime, size_t depth) {
+    const auto waitTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - enqueueTime);
+    fb303::fbData->addHistogramValue(waitTimeKey_, waitTime.count());
+    fb303::fbData->setCounter(depthKey_, depth);
+  }
+
+ private:
+  const std::string waitTimeKey_;
+  const std::string depthKey_;
+  const std::string depthHwmKey_;
+
+  std::atomic<size_t> depthHwm_{0};
+};
+
+} // namespace messaging
+} // namespace openr
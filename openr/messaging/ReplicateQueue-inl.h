@@ -13,6 +13,10 @@ namespace messaging {
 template <typename ValueType>
 ReplicateQueue<ValueType>::ReplicateQueue() {}
 
+template <typename ValueType>
+ReplicateQueue<ValueType>::ReplicateQueue(std::string name)
+    : name_(std::move(name)) {}
+
 template <typename ValueType>
 ReplicateQueue<ValueType>::~ReplicateQueue() {
   close();
@@ -60,14 +64,50 @@ ReplicateQueue<ValueType>::push(ValueTypeT&& value) {
 template <typename ValueType>
 RQueue<ValueType>
 ReplicateQueue<ValueType>::getReader() {
+  return getReader(RWQueueOptions<ValueType>{});
+}
+
+template <typename ValueType>
+RQueue<ValueType>
+ReplicateQueue<ValueType>::getReader(RWQueueOptions<ValueType> options) {
   auto lockedReaders = readers_.wlock();
   if (closed_) {
     throw std::runtime_error("queue is closed");
   }
-  lockedReaders->emplace_back(std::make_shared<RWQueue<ValueType>>());
+  lockedReaders->emplace_back(
+      std::make_shared<RWQueue<ValueType>>(std::move(options)));
   return RQueue<ValueType>(lockedReaders->back());
 }
 
+template <typename ValueType>
+RQueue<ValueType>
+ReplicateQueue<ValueType>::getReader(
+    std::string const& readerName, RWQueueOptions<ValueType> options) {
+  if (not name_.empty()) {
+    options.statsName = "messaging." + name_ + ".reader." + readerName;
+  }
+  return getReader(std::move(options));
+}
+
+template <typename ValueType>
+std::shared_ptr<RWQueue<ValueType>>
+ReplicateQueue<ValueType>::getDirectQueue(RWQueueOptions<ValueType> options) {
+  auto lockedReaders = readers_.wlock();
+  if (closed_) {
+    throw std::runtime_error("queue is closed");
+  }
+  // forget about the queues dropped by their owner
+  directQueues_.erase(
+      std::remove_if(
+          directQueues_.begin(),
+          directQueues_.end(),
+          [](auto const& queue) { return queue.expired(); }),
+      directQueues_.end());
+  auto queue = std::make_shared<RWQueue<ValueType>>(std::move(options));
+  directQueues_.emplace_back(queue);
+  return queue;
+}
+
 template <typename ValueType>
 size_t
 ReplicateQueue<ValueType>::getNumReaders() {
@@ -92,6 +132,25 @@ ReplicateQueue<ValueType>::close() {
     queue->close();
   }
   lockedReaders->clear();
+  for (auto& weakQueue : directQueues_) {
+    if (auto queue = weakQueue.lock()) {
+      queue->close();
+    }
+  }
+  directQueues_.clear();
+}
+
+template <typename ValueType>
+template <typename ValueTypeT>
+bool
+SharedReplicateQueue<ValueType>::push(ValueTypeT&& value) {
+  if constexpr (std::is_convertible_v<ValueTypeT&&, SharedValueType>) {
+    return ReplicateQueue<SharedValueType>::push(
+        SharedValueType(std::forward<ValueTypeT>(value)));
+  } else {
+    return ReplicateQueue<SharedValueType>::push(
+        std::make_shared<const ValueType>(std::forward<ValueTypeT>(value)));
+  }
 }
 
 } // namespace messaging
@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
 #include <openr/messaging/Queue.h>
 
 namespace openr {
@@ -24,6 +29,12 @@ class ReplicateQueue {
  public:
   ReplicateQueue();
 
+  /**
+   * Named queue. Readers created with a name export QueueStats under
+   * `messaging.<name>.reader.<readerName>`
+   */
+  explicit ReplicateQueue(std::string name);
+
   ~ReplicateQueue();
 
   /**
@@ -51,6 +62,28 @@ class ReplicateQueue {
    */
   RQueue<ValueType> getReader();
 
+  /**
+   * Get new reader stream backed by a bounded queue. With BLOCK policy, push
+   * waits until every such reader has room.
+   */
+  RQueue<ValueType> getReader(RWQueueOptions<ValueType> options);
+
+  /**
+   * Get new named reader stream, instrumented if this queue is named too
+   */
+  RQueue<ValueType> getReader(
+      std::string const& readerName,
+      RWQueueOptions<ValueType> options = RWQueueOptions<ValueType>{});
+
+  /**
+   * Get new queue which doesn't get the values pushed into this one. Its
+   * owner writes values into it directly, e.g. the subset of values a reader
+   * is interested in, and hands out readers with RQueue(queue). It gets
+   * closed along with this queue.
+   */
+  std::shared_ptr<RWQueue<ValueType>> getDirectQueue(
+      RWQueueOptions<ValueType> options = RWQueueOptions<ValueType>{});
+
   /**
    * Number of replicated streams/readers
    */
@@ -70,10 +103,39 @@ class ReplicateQueue {
   void close();
 
  private:
+  std::string name_;
   folly::Synchronized<std::list<std::shared_ptr<RWQueue<ValueType>>>> readers_;
   bool closed_{false}; // Protected by above Synchronized lock
+  // queues of getDirectQueue(), protected by above Synchronized lock
+  std::vector<std::weak_ptr<RWQueue<ValueType>>> directQueues_;
+};
+
+/**
+ * ReplicateQueue variant for large values which readers don't modify. Pushed
+ * value is wrapped once into `std::shared_ptr<const ValueType>` and every
+ * reader receives the same immutable object. Replicating to N readers costs N
+ * refcount bumps instead of N-1 deep copies.
+ */
+template <typename ValueType>
+class SharedReplicateQueue
+    : public ReplicateQueue<std::shared_ptr<const ValueType>> {
+ public:
+  using SharedValueType = std::shared_ptr<const ValueType>;
+
+  /**
+   * Push value, or already shared value, into the queue. Value is wrapped,
+   * moving it if possible, before being replicated to all the readers.
+   */
+  template <typename ValueTypeT>
+  bool push(ValueTypeT&& value);
 };
 
+/**
+ * Reader stream of SharedReplicateQueue
+ */
+template <typename ValueType>
+using SharedRQueue = RQueue<std::shared_ptr<const ValueType>>;
+
 } // namespace messaging
 } // namespace openr
 
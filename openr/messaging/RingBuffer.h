@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <folly/lang/Align.h>
+#include <glog/logging.h>
+
+namespace openr {
+namespace messaging {
+
+/**
+ * Bounded lock-free ring buffer for multiple producers and consumers. Both
+ * enqueue and dequeue are non blocking and report full/empty ring instead of
+ * waiting. Every slot carries a sequence number which tells whether it is
+ * free for the producer or filled for the consumer of a given lap, so that
+ * producers and consumers only contend on their respective position counter.
+ *
+ * Capacity is rounded up to the next power of two.
+ */
+template <typename ValueType>
+class RingBuffer {
+ public:
+  explicit RingBuffer(size_t capacity);
+  ~RingBuffer();
+
+  /**
+   * non-copyable, non-movable
+   */
+  RingBuffer(RingBuffer const&) = delete;
+  RingBuffer& operator=(RingBuffer const&) = delete;
+
+  /**
+   * Construct value at the tail from `args`. Arguments are left untouched and
+   * false is returned if the ring is full.
+   */
+  template <typename... Args>
+  bool tryEnqueue(Args&&... args);
+
+  /**
+   * Dequeue value from the head. Return std::nullopt if the ring is empty.
+   */
+  std::optional<ValueType> tryDequeue();
+
+  /**
+   * Whether the head slot holds no value, respectively the tail slot holds a
+   * value of the previous lap. Only a hint with concurrent producers/consumers.
+   */
+  bool empty() const;
+  bool full() const;
+
+  /**
+   * Approximate number of elements. Exact when there are no concurrent
+   * producers or consumers.
+   */
+  size_t size() const;
+
+  size_t
+  capacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq{0};
+    std::aligned_storage_t<sizeof(ValueType), alignof(ValueType)> storage;
+  };
+
+  static size_t
+  roundUpCapacity(size_t capacity) {
+    size_t result = 1;
+    while (result < capacity) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t mask_{0};
+  std::unique_ptr<Slot[]> slots_;
+
+  // Keep producer and consumer positions on separate cache lines
+  alignas(folly::hardware_destructive_interference_size)
+      std::atomic<size_t> enqueuePos_{0};
+  alignas(folly::hardware_destructive_interference_size)
+      std::atomic<size_t> dequeuePos_{0};
+};
+
+template <typename ValueType>
+RingBuffer<ValueType>::RingBuffer(size_t capacity)
+    : mask_(roundUpCapacity(capacity) - 1),
+      slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+  CHECK_GT(capacity, 0);
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename ValueType>
+RingBuffer<ValueType>::~RingBuffer() {
+  while (tryDequeue().has_value()) {
+  }
+}
+
+template <typename ValueType>
+template <typename... Args>
+bool
+RingBuffer<ValueType>::tryEnqueue(Args&&... args) {
+  Slot* slot{nullptr};
+  size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+  while (true) {
+    slot = &slots_[pos & mask_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const auto diff =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+    if (diff == 0) {
+      // Slot is free for this lap, claim it
+      if (enqueuePos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Slot still holds value of previous lap
+      return false;
+    } else {
+      pos = enqueuePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  new (&slot->storage) ValueType(std::forward<Args>(args)...);
+  slot->seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename ValueType>
+std::optional<ValueType>
+RingBuffer<ValueType>::tryDequeue() {
+  Slot* slot{nullptr};
+  size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+  while (true) {
+    slot = &slots_[pos & mask_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const auto diff =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+    if (diff == 0) {
+      // Slot is filled for this lap, claim it
+      if (dequeuePos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Slot is not yet filled
+      return std::nullopt;
+    } else {
+      pos = dequeuePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  auto* ptr = std::launder(reinterpret_cast<ValueType*>(&slot->storage));
+  std::optional<ValueType> val(std::move(*ptr));
+  ptr->~ValueType();
+  // Release slot for the next lap
+  slot->seq.store(pos + mask_ + 1, std::memory_order_release);
+  return val;
+}
+
+template <typename ValueType>
+size_t
+RingBuffer<ValueType>::size() const {
+  const size_t dequeuePos = dequeuePos_.load(std::memory_order_acquire);
+  const size_t enqueuePos = enqueuePos_.load(std::memory_order_acquire);
+  return enqueuePos > dequeuePos ? std::min(enqueuePos - dequeuePos, mask_ + 1)
+                                 : 0;
+}
+
+template <typename ValueType>
+bool
+RingBuffer<ValueType>::empty() const {
+  const size_t pos = dequeuePos_.load(std::memory_order_acquire);
+  const size_t seq = slots_[pos & mask_].seq.load(std::memory_order_acquire);
+  return static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1) <
+      0;
+}
+
+template <typename ValueType>
+bool
+RingBuffer<ValueType>::full() const {
+  const size_t pos = enqueuePos_.load(std::memory_order_acquire);
+  const size_t seq = slots_[pos & mask_].seq.load(std::memory_order_acquire);
+  return static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos) < 0;
+}
+
+} // namespace messaging
+} // namespace openr
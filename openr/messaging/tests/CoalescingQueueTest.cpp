@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <folly/fibers/EventBaseLoopController.h>
+#include <folly/fibers/FiberManager.h>
+#include <folly/fibers/FiberManagerMap.h>
+#include <folly/io/async/EventBase.h>
+
+#include <openr/messaging/CoalescingQueue.h>
+
+using namespace openr::messaging;
+
+TEST(CoalescingQueueTest, CoalesceSameKey) {
+  CoalescingQueue<std::string, int> q;
+
+  q.push(std::string("iface1"), 1);
+  q.push(std::string("iface2"), 1);
+  q.push(std::string("iface1"), 2);
+  q.push(std::string("iface3"), 1);
+  q.push(std::string("iface1"), 3);
+
+  // Unread values got replaced in place
+  EXPECT_EQ(3, q.size());
+  EXPECT_EQ(2, q.numCoalesced());
+  EXPECT_EQ(std::make_pair(std::string("iface1"), 3), q.get().value());
+  EXPECT_EQ(std::make_pair(std::string("iface2"), 1), q.get().value());
+
+  // Key which has been read is queued again
+  q.push(std::string("iface1"), 4);
+  EXPECT_EQ(std::make_pair(std::string("iface3"), 1), q.get().value());
+  EXPECT_EQ(std::make_pair(std::string("iface1"), 4), q.get().value());
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(CoalescingQueueTest, PendingReads) {
+  CoalescingQueue<int, int> q;
+
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable {
+    EXPECT_EQ(std::make_pair(1, 1), q.get().value());
+    auto x = q.get();
+    ASSERT_TRUE(x.hasError());
+    EXPECT_EQ(x.error(), QueueError::QUEUE_CLOSED);
+  });
+
+  evb.loopOnce(); // Fiber should get stuck at the read
+  EXPECT_EQ(1, q.numPendingReads());
+
+  // Handed over to pending read directly, nothing to coalesce with
+  q.push(1, 1);
+  EXPECT_EQ(0, q.size());
+  evb.loopOnce();
+  EXPECT_EQ(1, q.numPendingReads());
+
+  q.close();
+  evb.loop();
+  EXPECT_TRUE(q.isClosed());
+  EXPECT_EQ(0, q.numPendingReads());
+  EXPECT_FALSE(q.push(1, 2));
+  EXPECT_EQ(q.get().error(), QueueError::QUEUE_CLOSED);
+}
+
+TEST(CoalescingQueueTest, SlowReader) {
+  const int kNumKeys{16};
+  const int kNumUpdates{1024};
+  CoalescingQueue<int, int> q;
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+
+  // Writer publishes all updates before reader gets to run
+  manager.addTask([&q]() {
+    for (int i = 0; i < kNumUpdates; ++i) {
+      q.push(i % kNumKeys, i);
+    }
+  });
+  manager.addTask([&q]() {
+    // Reader only processes the latest state of every key
+    for (int i = 0; i < kNumKeys; ++i) {
+      auto [key, val] = q.get().value();
+      EXPECT_EQ(i, key);
+      EXPECT_EQ(kNumUpdates - kNumKeys + i, val);
+    }
+    EXPECT_EQ(0, q.size());
+    q.close();
+  });
+  evb.loop();
+  EXPECT_EQ(kNumUpdates - kNumKeys, q.numCoalesced());
+}
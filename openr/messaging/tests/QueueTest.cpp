@@ -291,6 +291,186 @@ TEST(RWQueueTest, CoroTest) {
 }
 #endif
 
+TEST(RWQueueTest, GetBatch) {
+  RWQueueOptions<int> options;
+  options.capacity = 8;
+  // Run against both unbounded and bounded queue
+  for (auto const& q : {std::make_shared<RWQueue<int>>(),
+                        std::make_shared<RWQueue<int>>(options)}) {
+    for (int i = 1; i <= 5; ++i) {
+      q->push(i);
+    }
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), q->getBatch(3).value());
+    EXPECT_EQ((std::vector<int>{4, 5}), q->getBatch(10).value());
+    EXPECT_EQ(0, q->size());
+
+    // Wait for more elements until batch is full
+    std::thread writer([q]() {
+      for (int i = 1; i <= 3; ++i) {
+        /* sleep override */
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        q->push(i);
+      }
+    });
+    EXPECT_EQ(
+        (std::vector<int>{1, 2, 3}),
+        q->getBatch(3, std::chrono::seconds(10)).value());
+    writer.join();
+
+    // Return on timeout with partial batch
+    q->push(1);
+    EXPECT_EQ(
+        std::vector<int>{1},
+        q->getBatch(3, std::chrono::milliseconds(10)).value());
+    EXPECT_EQ(0, q->numPendingReads());
+
+    q->close();
+    EXPECT_EQ(q->getBatch(3).error(), QueueError::QUEUE_CLOSED);
+  }
+}
+
+TEST(BoundedRWQueueTest, PendingReads) {
+  RWQueueOptions<int> options;
+  options.capacity = 4;
+  RWQueue<int> q(options);
+
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable { EXPECT_EQ(1, q.get().value()); });
+  manager.addTask([&q]() mutable { EXPECT_EQ(2, q.get().value()); });
+
+  evb.loopOnce();
+  EXPECT_EQ(0, q.size());
+  EXPECT_EQ(2, q.numPendingReads());
+
+  q.push(1);
+  q.push(2);
+  evb.loopOnce();
+  EXPECT_EQ(0, q.size());
+  EXPECT_EQ(0, q.numPendingReads());
+
+  q.close();
+  EXPECT_FALSE(q.push(3));
+  EXPECT_EQ(q.get().error(), QueueError::QUEUE_CLOSED);
+}
+
+TEST(BoundedRWQueueTest, DropOldest) {
+  RWQueueOptions<int> options;
+  options.capacity = 4;
+  options.policy = BackpressurePolicy::DROP_OLDEST;
+  RWQueue<int> q(options);
+
+  for (int i = 1; i <= 6; ++i) {
+    EXPECT_TRUE(q.push(i));
+  }
+  EXPECT_EQ(4, q.size());
+  for (int i = 3; i <= 6; ++i) {
+    EXPECT_EQ(i, q.get().value());
+  }
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(BoundedRWQueueTest, Coalesce) {
+  RWQueueOptions<std::vector<int>> options;
+  options.capacity = 2;
+  options.policy = BackpressurePolicy::COALESCE;
+  options.coalesceFn = [](std::vector<int>& into, std::vector<int>&& from) {
+    into.insert(into.end(), from.begin(), from.end());
+  };
+  RWQueue<std::vector<int>> q(options);
+
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_TRUE(q.push(std::vector<int>{i}));
+  }
+  // Ring is full, 3 and 4 are merged into overflow element
+  EXPECT_EQ(3, q.size());
+  EXPECT_EQ(std::vector<int>{1}, q.get().value());
+
+  // Merged into overflow element even though ring has room, to keep ordering
+  EXPECT_TRUE(q.push(std::vector<int>{5}));
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(std::vector<int>{2}, q.get().value());
+  EXPECT_EQ((std::vector<int>{3, 4, 5}), q.get().value());
+
+  EXPECT_TRUE(q.push(std::vector<int>{6}));
+  EXPECT_EQ(std::vector<int>{6}, q.get().value());
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(BoundedRWQueueTest, BlockedWriter) {
+  const int kCount{128};
+  RWQueueOptions<int> options;
+  options.capacity = 2;
+  RWQueue<int> q(options);
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+
+  manager.addTask([&q]() {
+    for (int i = 0; i < kCount; ++i) {
+      EXPECT_TRUE(q.push(i));
+      EXPECT_GE(2, q.size());
+    }
+  });
+  manager.addTask([&q]() {
+    for (int i = 0; i < kCount; ++i) {
+      EXPECT_EQ(i, q.get().value());
+    }
+  });
+  evb.loop();
+  EXPECT_EQ(0, q.size());
+
+  // Writer blocked on full queue is released on close
+  EXPECT_TRUE(q.push(1));
+  EXPECT_TRUE(q.push(2));
+  manager.addTask([&q]() { EXPECT_FALSE(q.push(3)); });
+  evb.loopOnce();
+  q.close();
+  evb.loop();
+}
+
+TEST(BoundedRWQueueTest, MultiThreadTest) {
+  const size_t kNumReaders{8};
+  const size_t kNumWriters{8};
+  const size_t kCountPerWriter{8192};
+  RWQueueOptions<size_t> options;
+  options.capacity = 64;
+  RWQueue<size_t> q(options);
+
+  std::atomic<size_t> totalReads{0};
+  std::atomic<size_t> totalSum{0};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kNumReaders; ++i) {
+    threads.emplace_back([&q, &totalReads, &totalSum]() {
+      while (true) {
+        auto maybeNum = q.get();
+        if (maybeNum.hasError()) {
+          EXPECT_EQ(QueueError::QUEUE_CLOSED, maybeNum.error());
+          break;
+        }
+        totalSum += maybeNum.value();
+        if (++totalReads == kNumWriters * kCountPerWriter) {
+          LOG(INFO) << "Closing queue";
+          q.close();
+        }
+      }
+    });
+  }
+  for (size_t i = 0; i < kNumWriters; ++i) {
+    threads.emplace_back([&q, i]() {
+      for (size_t j = 0; j < kCountPerWriter; ++j) {
+        EXPECT_TRUE(q.push(i * kCountPerWriter + j));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const size_t total = kNumWriters * kCountPerWriter;
+  EXPECT_EQ(total, totalReads);
+  EXPECT_EQ(total * (total - 1) / 2, totalSum);
+}
+
 TEST(RQueueTest, ReadTest) {
   auto rwq = std::make_shared<RWQueue<int>>();
   RQueue<int> rq(rwq);
@@ -301,6 +481,10 @@ TEST(RQueueTest, ReadTest) {
   EXPECT_EQ(1, rq.get().value());
   EXPECT_EQ(2, rq.get().value());
 
+  rwq->push(3);
+  rwq->push(4);
+  EXPECT_EQ((std::vector<int>{3, 4}), rq.getBatch(10).value());
+
 #if FOLLY_HAS_COROUTINES
   auto coroRead = [](RQueue<int>& rq, int expected) -> folly::coro::Task<void> {
     LOG(INFO) << "Performing coro read";
@@ -320,5 +504,16 @@ TEST(RQueueTest, ReadTest) {
   executor.drive();
   EXPECT_EQ(0, rwq->numPendingReads());
   EXPECT_EQ(0, rwq->size());
+
+  auto coroBatchRead = [](RQueue<int>& rq) -> folly::coro::Task<void> {
+    auto items = co_await rq.getBatchCoro(2);
+    EXPECT_EQ((std::vector<int>{6, 7}), items.value());
+  };
+  rwq->push(6);
+  rwq->push(7);
+  rwq->push(8);
+  coroBatchRead(rq).scheduleOn(&executor).start();
+  executor.drive();
+  EXPECT_EQ(1, rwq->size());
 #endif
 }
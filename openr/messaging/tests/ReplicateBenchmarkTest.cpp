@@ -5,6 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <thread>
+
+#include <fmt/format.h>
+
 #include <folly/Benchmark.h>
 #include <folly/init/Init.h>
 
@@ -14,13 +19,67 @@
 #include <folly/fibers/FiberManager.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/io/async/EventBase.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/experimental/coro/Task.h>
+#endif
 
+#include <openr/decision/RouteUpdate.h>
+#include <openr/messaging/CoalescingQueue.h>
 #include <openr/messaging/ReplicateQueue.h>
 
+using openr::messaging::CoalescingQueue;
 using openr::messaging::ReplicateQueue;
+using openr::messaging::RQueue;
+using openr::messaging::RWQueue;
+using openr::messaging::RWQueueOptions;
+using openr::messaging::SharedReplicateQueue;
+
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes parameters to another one, with a custom name.
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FOLLY_PP_STRINGIZE(name) "(" FOLLY_PP_STRINGIZE(param_name) ")", \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
 
 namespace openr {
 
+namespace {
+// Messages pushed per benchmark iteration
+const size_t kNumPublications{100000};
+const size_t kNumRouteUpdates{10000};
+// Routes of a route update, shared among kNumNextHopGroups groups
+const size_t kRoutesPerUpdate{100};
+const size_t kNumNextHopGroups{16};
+// Max elements of a batch read
+const size_t kBatchSize{64};
+// Capacity of bounded, lock-free ring readers
+const size_t kRingCapacity{1024};
+} // namespace
+
+/**
+ * How readers consume their queue. All readers run on a single event base.
+ */
+enum class ReadMode {
+  // fiber, one element per get()
+  FIBER,
+  // fiber, up to kBatchSize elements per getBatch()
+  FIBER_BATCH,
+#if FOLLY_HAS_COROUTINES
+  // co-routine, one element per getCoro()
+  CORO,
+  // co-routine, up to kBatchSize elements per getBatchCoro()
+  CORO_BATCH,
+#endif
+};
+
 class QueueBenchmarkTestFixture : public OpenrBenchmarkBase {
  public:
   explicit QueueBenchmarkTestFixture() {
@@ -30,6 +89,7 @@ class QueueBenchmarkTestFixture : public OpenrBenchmarkBase {
     // nothing to do
   }
 
+  // KvStore publications of two adjacency and two prefix keys
   std::vector<thrift::Publication>
   getPublications(const size_t kTotalWrites) {
     std::vector<thrift::Publication> allPublications;
@@ -56,77 +116,499 @@ class QueueBenchmarkTestFixture : public OpenrBenchmarkBase {
 
     return allPublications;
   }
+
+  // Incremental Decision route updates of kRoutesPerUpdate routes each, as
+  // streamed to Fib
+  static std::vector<DecisionRouteUpdate>
+  getRouteUpdates(const size_t kTotalWrites) {
+    std::vector<NextHopGroup> nextHopGroups;
+    for (size_t i = 0; i < kNumNextHopGroups; ++i) {
+      nextHopGroups.emplace_back(NextHopGroup::NextHopSet{
+          createNextHop(toBinaryAddress(fmt::format("fe80::{}", i + 1))),
+          createNextHop(toBinaryAddress(fmt::format("fe80::{}", i + 2)))});
+    }
+
+    std::vector<DecisionRouteUpdate> routeUpdates;
+    for (size_t i = 0; i < kTotalWrites; ++i) {
+      DecisionRouteUpdate routeUpdate;
+      routeUpdate.type = DecisionRouteUpdate::INCREMENTAL;
+      for (size_t j = 0; j < kRoutesPerUpdate; ++j) {
+        const auto network = folly::IPAddress::createNetwork(
+            fmt::format("fc00:{:x}:{:x}::/64", i, j));
+        routeUpdate.unicastRoutesToUpdate.emplace(
+            network,
+            RibUnicastEntry(
+                network, nextHopGroups.at((i + j) % nextHopGroups.size())));
+      }
+      routeUpdates.emplace_back(std::move(routeUpdate));
+    }
+    return routeUpdates;
+  }
 };
 
-static void
-BM_ReplicateQueueTest(
+/**
+ * Queue backends under benchmark. Each hands out readers of `ReadType` values
+ * and, unless `kReplicated` is false, delivers every pushed value to all of
+ * them.
+ */
+
+// Single queue, every value is read by one of the readers
+template <typename ValueType>
+struct RWQueueBackend {
+  using ReadType = ValueType;
+  static constexpr bool kReplicated{false};
+
+  RQueue<ReadType>
+  getReader() {
+    return RQueue<ReadType>(queue);
+  }
+
+  template <typename ValueTypeT>
+  void
+  push(ValueTypeT&& value) {
+    queue->push(std::forward<ValueTypeT>(value));
+  }
+
+  void
+  close() {
+    queue->close();
+  }
+
+  std::shared_ptr<RWQueue<ValueType>> queue{
+      std::make_shared<RWQueue<ValueType>>()};
+};
+
+// Unbounded lock based reader queues, value is copied for every reader
+template <typename ValueType>
+struct ReplicateQueueBackend {
+  using ReadType = ValueType;
+  static constexpr bool kReplicated{true};
+
+  RQueue<ReadType>
+  getReader() {
+    return queue.getReader();
+  }
+
+  template <typename ValueTypeT>
+  void
+  push(ValueTypeT&& value) {
+    queue.push(std::forward<ValueTypeT>(value));
+  }
+
+  void
+  close() {
+    queue.close();
+  }
+
+  ReplicateQueue<ValueType> queue;
+};
+
+// Bounded lock-free ring reader queues, writers block on full rings
+template <typename ValueType>
+struct RingReplicateQueueBackend : public ReplicateQueueBackend<ValueType> {
+  RQueue<ValueType>
+  getReader() {
+    RWQueueOptions<ValueType> options;
+    options.capacity = kRingCapacity;
+    return this->queue.getReader(std::move(options));
+  }
+};
+
+// Readers share a single immutable copy of every value
+template <typename ValueType>
+struct SharedReplicateQueueBackend {
+  using ReadType = std::shared_ptr<const ValueType>;
+  static constexpr bool kReplicated{true};
+
+  RQueue<ReadType>
+  getReader() {
+    return queue.getReader();
+  }
+
+  template <typename ValueTypeT>
+  void
+  push(ValueTypeT&& value) {
+    queue.push(std::forward<ValueTypeT>(value));
+  }
+
+  void
+  close() {
+    queue.close();
+  }
+
+  SharedReplicateQueue<ValueType> queue;
+};
+
+#if FOLLY_HAS_COROUTINES
+template <typename ReadType, typename OnReadFn, typename OnDoneFn>
+folly::coro::Task<void>
+readCoro(
+    RQueue<ReadType> reader, bool batch, OnReadFn& onRead, OnDoneFn& onDone) {
+  while (true) {
+    if (batch) {
+      auto items = co_await reader.getBatchCoro(kBatchSize);
+      if (items.hasError()) {
+        break;
+      }
+      onRead(items->size());
+    } else {
+      auto item = co_await reader.getCoro();
+      if (item.hasError()) {
+        break;
+      }
+      onRead(1);
+    }
+  }
+  onDone();
+}
+#endif
+
+/**
+ * Push the messages of getPayloads() into a queue of `Backend` and read them
+ * with kNumReaders readers running on one event base. Messages are split
+ * among kNumWriterThreads writer threads contending on the queue, or pushed
+ * by a single fiber on the readers' event base if kNumWriterThreads is 0.
+ * Measures the time until every reader has read all its messages.
+ */
+template <typename Backend, typename GetPayloadsFn>
+void
+runQueueBenchmark(
     uint32_t iters,
+    GetPayloadsFn getPayloads,
     const size_t kNumReaders,
-    const size_t kNumWriters,
-    const size_t kTotalWrites) {
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
   auto suspender = folly::BenchmarkSuspender();
+  const auto payloads = getPayloads();
 
-  auto queueBenchmarkTestFixture =
-      std::make_unique<QueueBenchmarkTestFixture>();
+  for (uint32_t k = 0; k < iters; k++) {
+    Backend backend;
+    folly::EventBase evb;
+    auto& manager = folly::fibers::getFiberManager(evb);
 
-  ReplicateQueue<thrift::Publication> q;
-  folly::EventBase evb;
-  auto& manager = folly::fibers::getFiberManager(evb);
-  std::atomic<size_t> totalReads{0};
+    // Readers close the queue once all messages are read, last one to notice
+    // ends the benchmark
+    const size_t expectedReads =
+        payloads.size() * (Backend::kReplicated ? kNumReaders : 1);
+    size_t totalReads{0};
+    size_t numDoneReaders{0};
+    auto onRead = [&](size_t numReads) {
+      totalReads += numReads;
+      if (totalReads == expectedReads) {
+        backend.close();
+      }
+    };
+    auto onDone = [&]() {
+      if (++numDoneReaders == kNumReaders) {
+        evb.terminateLoopSoon();
+      }
+    };
 
-  auto pubs = queueBenchmarkTestFixture->getPublications(kTotalWrites);
-
-  for (size_t k = 0; k < iters; k++) {
     for (size_t i = 0; i < kNumReaders; ++i) {
-      manager.addTask([reader = q.getReader(),
-                       &q,
-                       &totalReads,
-                       kTotalWrites = kTotalWrites,
-                       kNumReaders = kNumReaders]() mutable {
-        size_t numReads{0};
-        while (true) {
-          auto maybeNum = reader.get();
-          if (maybeNum.hasError()) {
-            break;
-          }
-          ++numReads;
-          ++totalReads;
-          if (totalReads == kTotalWrites * kNumReaders) {
-            LOG(INFO) << "Closing queue";
-            q.close();
-          }
-        }
+      switch (kReadMode) {
+      case ReadMode::FIBER: {
+        manager.addTask(
+            [reader = backend.getReader(), &onRead, &onDone]() mutable {
+              while (reader.get().hasValue()) {
+                onRead(1);
+              }
+              onDone();
+            });
+        break;
+      }
+      case ReadMode::FIBER_BATCH: {
+        manager.addTask(
+            [reader = backend.getReader(), &onRead, &onDone]() mutable {
+              while (true) {
+                auto items = reader.getBatch(kBatchSize);
+                if (items.hasError()) {
+                  break;
+                }
+                onRead(items->size());
+              }
+              onDone();
+            });
+        break;
+      }
+#if FOLLY_HAS_COROUTINES
+      case ReadMode::CORO:
+      case ReadMode::CORO_BATCH: {
+        readCoro(
+            backend.getReader(),
+            kReadMode == ReadMode::CORO_BATCH,
+            onRead,
+            onDone)
+            .scheduleOn(&evb)
+            .start();
+        break;
+      }
+#endif
+      }
+    }
+
+    // messages are moved into the queue, copy them outside of measurement
+    auto writes = payloads;
+    auto writeRange = [&backend, &writes](size_t begin, size_t end) {
+      for (size_t j = begin; j < end; ++j) {
+        backend.push(std::move(writes.at(j)));
+      }
+    };
+
+    suspender.dismiss(); // Start measuring benchmark time
+    std::vector<std::thread> writerThreads;
+    if (kNumWriterThreads == 0) {
+      manager.addTask([&writeRange, &writes]() {
+        writeRange(0, writes.size());
+      });
+    }
+    for (size_t i = 0; i < kNumWriterThreads; ++i) {
+      writerThreads.emplace_back([&, i]() {
+        writeRange(
+            i * writes.size() / kNumWriterThreads,
+            (i + 1) * writes.size() / kNumWriterThreads);
       });
     }
+    evb.loopForever();
+    for (auto& writerThread : writerThreads) {
+      writerThread.join();
+    }
+    suspender.rehire(); // Stop measuring time again
+  }
+}
+
+std::vector<thrift::Publication>
+getPublications() {
+  return QueueBenchmarkTestFixture().getPublications(kNumPublications);
+}
+
+std::vector<DecisionRouteUpdate>
+getRouteUpdates() {
+  return QueueBenchmarkTestFixture::getRouteUpdates(kNumRouteUpdates);
+}
+
+static void
+BM_RWQueue(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<RWQueueBackend<thrift::Publication>>(
+      iters, getPublications, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+static void
+BM_ReplicateQueue(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<ReplicateQueueBackend<thrift::Publication>>(
+      iters, getPublications, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+static void
+BM_RingReplicateQueue(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<RingReplicateQueueBackend<thrift::Publication>>(
+      iters, getPublications, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+static void
+BM_SharedReplicateQueue(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<SharedReplicateQueueBackend<thrift::Publication>>(
+      iters, getPublications, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+static void
+BM_ReplicateQueueRouteUpdate(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<ReplicateQueueBackend<DecisionRouteUpdate>>(
+      iters, getRouteUpdates, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+static void
+BM_RingReplicateQueueRouteUpdate(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<RingReplicateQueueBackend<DecisionRouteUpdate>>(
+      iters, getRouteUpdates, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+static void
+BM_SharedReplicateQueueRouteUpdate(
+    uint32_t iters,
+    const size_t kNumReaders,
+    const size_t kNumWriterThreads,
+    const ReadMode kReadMode) {
+  runQueueBenchmark<SharedReplicateQueueBackend<DecisionRouteUpdate>>(
+      iters, getRouteUpdates, kNumReaders, kNumWriterThreads, kReadMode);
+}
+
+/**
+ * Push kNumPublications publications over kNumKeys keys into a
+ * CoalescingQueue, read by a single fiber. Writers run as for
+ * runQueueBenchmark(). Records the number of reads, i.e. of publications
+ * left after coalescing.
+ */
+static void
+BM_CoalescingQueue(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    const size_t kNumKeys,
+    const size_t kNumWriterThreads) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto payloads = getPublications();
+  size_t totalReads{0};
 
-    // Add writer task
-    for (size_t i = 0; i < kNumWriters; ++i) {
-      manager.addTask([&q, kTotalWrites, &pubs, i, kNumWriters]() {
-        for (size_t j = i * kTotalWrites / kNumWriters;
-             j < (i + 1) * kTotalWrites / kNumWriters;
-             j++) {
-          q.push(std::move(pubs.at(j)));
+  for (uint32_t k = 0; k < iters; k++) {
+    CoalescingQueue<size_t, thrift::Publication> q;
+    folly::EventBase evb;
+    auto& manager = folly::fibers::getFiberManager(evb);
+
+    // Last writer pushes key kNumKeys, read after all coalesced ones
+    manager.addTask([&q, &evb, &totalReads, kNumKeys]() {
+      while (true) {
+        auto item = q.get();
+        if (item.hasError()) {
+          break;
         }
-        LOG(INFO) << "Writer" << i << " finished pushing "
-                  << kTotalWrites / kNumWriters << " messages.";
-      });
+        ++totalReads;
+        if (item->first == kNumKeys) {
+          q.close();
+        }
+      }
+      evb.terminateLoopSoon();
+    });
+
+    auto writes = payloads;
+    const size_t numWriters = std::max(kNumWriterThreads, size_t(1));
+    std::atomic<size_t> numDoneWriters{0};
+    auto writeRange = [&](size_t i) {
+      const auto begin = i * writes.size() / numWriters;
+      const auto end = (i + 1) * writes.size() / numWriters;
+      for (size_t j = begin; j < end; ++j) {
+        q.push(j % kNumKeys, std::move(writes.at(j)));
+      }
+      if (++numDoneWriters == numWriters) {
+        q.push(kNumKeys, thrift::Publication());
+      }
+    };
+
+    suspender.dismiss(); // Start measuring benchmark time
+    std::vector<std::thread> writerThreads;
+    if (kNumWriterThreads == 0) {
+      manager.addTask([&writeRange]() { writeRange(0); });
+    }
+    for (size_t i = 0; i < kNumWriterThreads; ++i) {
+      writerThreads.emplace_back([&writeRange, i]() { writeRange(i); });
     }
+    evb.loopForever();
+    for (auto& writerThread : writerThreads) {
+      writerThread.join();
+    }
+    suspender.rehire(); // Stop measuring time again
   }
 
-  suspender.dismiss(); // Start measuring benchmark time
-  evb.loop();
-  suspender.rehire(); // Stop measuring time again
+  counters["reads"] = totalReads / iters;
 }
 
 // The first integer parameter is number of readers
-// The second integer parameter is the number of writers
-// The third interger parameter is the number of messages
-BENCHMARK_NAMED_PARAM(BM_ReplicateQueueTest, m100000_r1_w1, 1, 1, 100000);
-BENCHMARK_NAMED_PARAM(BM_ReplicateQueueTest, m100000_r10_w1, 10, 1, 100000);
-BENCHMARK_NAMED_PARAM(BM_ReplicateQueueTest, m100000_r50_w1, 50, 1, 100000);
-BENCHMARK_NAMED_PARAM(BM_ReplicateQueueTest, m100000_r100_w1, 100, 1, 100000);
-BENCHMARK_NAMED_PARAM(BM_ReplicateQueueTest, m100000_r10_w10, 10, 10, 100000);
-BENCHMARK_NAMED_PARAM(BM_ReplicateQueueTest, m100000_r50_w10, 50, 10, 100000);
+// The second integer parameter is the number of writer threads, 0 for a
+// single writer fiber on the event base of the readers
+// The third parameter is how readers consume their queue
+BENCHMARK_NAMED_PARAM(BM_RWQueue, r1_w0_fiber, 1, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_RWQueue, r1_w0_fiber_batch, 1, 0, ReadMode::FIBER_BATCH);
+BENCHMARK_NAMED_PARAM(BM_RWQueue, r4_w4_fiber, 4, 4, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(BM_RWQueue, r16_w16_fiber, 16, 16, ReadMode::FIBER);
+
+BENCHMARK_NAMED_PARAM(BM_ReplicateQueue, r1_w0_fiber, 1, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(BM_ReplicateQueue, r4_w0_fiber, 4, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueue, r16_w0_fiber, 16, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueue, r16_w0_fiber_batch, 16, 0, ReadMode::FIBER_BATCH);
+BENCHMARK_NAMED_PARAM(BM_ReplicateQueue, r4_w4_fiber, 4, 4, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueue, r16_w16_fiber, 16, 16, ReadMode::FIBER);
+
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueue, r1_w0_fiber, 1, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueue, r16_w0_fiber, 16, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueue, r16_w0_fiber_batch, 16, 0, ReadMode::FIBER_BATCH);
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueue, r4_w4_fiber, 4, 4, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueue, r16_w16_fiber, 16, 16, ReadMode::FIBER);
+
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueue, r1_w0_fiber, 1, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueue, r4_w0_fiber, 4, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueue, r16_w0_fiber, 16, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueue, r16_w0_fiber_batch, 16, 0, ReadMode::FIBER_BATCH);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueue, r16_w16_fiber, 16, 16, ReadMode::FIBER);
+
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueueRouteUpdate, r1_w0_fiber, 1, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueueRouteUpdate, r4_w0_fiber, 4, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueueRouteUpdate, r16_w0_fiber, 16, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueueRouteUpdate, r16_w0_fiber, 16, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueueRouteUpdate, r1_w0_fiber, 1, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueueRouteUpdate, r4_w0_fiber, 4, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueueRouteUpdate, r16_w0_fiber, 16, 0, ReadMode::FIBER);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueueRouteUpdate,
+    r16_w4_fiber_batch,
+    16,
+    4,
+    ReadMode::FIBER_BATCH);
+
+#if FOLLY_HAS_COROUTINES
+BENCHMARK_NAMED_PARAM(BM_RWQueue, r1_w0_coro, 1, 0, ReadMode::CORO);
+BENCHMARK_NAMED_PARAM(BM_ReplicateQueue, r16_w0_coro, 16, 0, ReadMode::CORO);
+BENCHMARK_NAMED_PARAM(
+    BM_ReplicateQueue, r16_w0_coro_batch, 16, 0, ReadMode::CORO_BATCH);
+BENCHMARK_NAMED_PARAM(
+    BM_RingReplicateQueue, r16_w0_coro, 16, 0, ReadMode::CORO);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueue, r16_w0_coro, 16, 0, ReadMode::CORO);
+BENCHMARK_NAMED_PARAM(
+    BM_SharedReplicateQueueRouteUpdate, r16_w0_coro, 16, 0, ReadMode::CORO);
+#endif
+
+// The first integer parameter is the number of distinct keys
+// The second integer parameter is the number of writer threads, 0 for a
+// single writer fiber on the event base of the reader
+BENCHMARK_COUNTERS_NAME_PARAM(BM_CoalescingQueue, counters, k100_w0, 100, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_CoalescingQueue, counters, k100_w4, 100, 4);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CoalescingQueue, counters, k10000_w0, 10000, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_CoalescingQueue, counters, k10000_w4, 10000, 4);
 } // namespace openr
 
 int
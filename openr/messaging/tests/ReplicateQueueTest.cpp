@@ -10,6 +10,7 @@
 #include <folly/fibers/EventBaseLoopController.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/fibers/FiberManagerMap.h>
+#include <fb303/ServiceData.h>
 #include <folly/io/async/EventBase.h>
 
 #include <openr/messaging/ReplicateQueue.h>
@@ -84,3 +85,84 @@ TEST(ReplicateQueueTest, OpenQueueTest) {
 
   q.close();
 }
+
+TEST(ReplicateQueueTest, SharedReplicateQueueTest) {
+  SharedReplicateQueue<std::vector<int>> q;
+  auto r1 = q.getReader();
+  auto r2 = q.getReader();
+  EXPECT_EQ(2, q.getNumReaders());
+
+  // value is wrapped once and shared by all readers
+  std::vector<int> value{1, 2, 3};
+  EXPECT_TRUE(q.push(std::move(value)));
+  auto v1 = r1.get();
+  auto v2 = r2.get();
+  ASSERT_TRUE(v1.hasValue());
+  ASSERT_TRUE(v2.hasValue());
+  EXPECT_EQ(v1.value().get(), v2.value().get());
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), *v1.value());
+
+  // already shared value is pushed as is
+  auto sharedValue = std::make_shared<const std::vector<int>>(4, 4);
+  EXPECT_TRUE(q.push(sharedValue));
+  v1 = r1.get();
+  v2 = r2.get();
+  ASSERT_TRUE(v1.hasValue());
+  ASSERT_TRUE(v2.hasValue());
+  EXPECT_EQ(sharedValue.get(), v1.value().get());
+  EXPECT_EQ(sharedValue.get(), v2.value().get());
+  EXPECT_EQ(0, r1.size());
+  EXPECT_EQ(0, r2.size());
+
+  q.close();
+  EXPECT_FALSE(q.push(std::vector<int>{5}));
+}
+
+TEST(ReplicateQueueTest, DirectQueueTest) {
+  ReplicateQueue<int> q;
+  auto r1 = q.getReader();
+  auto direct = q.getDirectQueue();
+  RQueue<int> r2(direct);
+  EXPECT_EQ(1, q.getNumReaders());
+
+  // direct queue only gets the values written into it
+  EXPECT_TRUE(q.push(1));
+  EXPECT_TRUE(direct->push(2));
+  EXPECT_EQ(1, r1.size());
+  EXPECT_EQ(1, r2.size());
+  EXPECT_EQ(1, r1.get().value());
+  EXPECT_EQ(2, r2.get().value());
+
+  // and gets closed along with the queue
+  q.close();
+  EXPECT_TRUE(direct->isClosed());
+  EXPECT_TRUE(r2.get().hasError());
+  EXPECT_THROW(q.getDirectQueue(), std::runtime_error);
+}
+
+TEST(ReplicateQueueTest, ReaderStatsTest) {
+  ReplicateQueue<int> q("testQueue");
+  auto r1 = q.getReader("reader1");
+  auto r2 = q.getReader("reader2");
+  auto r3 = q.getReader(); // Not instrumented
+
+  for (int i = 0; i < 3; ++i) {
+    q.push(i);
+  }
+  EXPECT_EQ(0, r1.get().value());
+
+  const std::string r1Prefix{"messaging.testQueue.reader.reader1"};
+  const std::string r2Prefix{"messaging.testQueue.reader.reader2"};
+  EXPECT_EQ(2, fb303::fbData->getCounter(r1Prefix + ".depth"));
+  EXPECT_EQ(3, fb303::fbData->getCounter(r1Prefix + ".depth_hwm"));
+  EXPECT_EQ(3, fb303::fbData->getCounter(r2Prefix + ".depth"));
+  EXPECT_EQ(3, fb303::fbData->getCounter(r2Prefix + ".depth_hwm"));
+
+  // Unnamed queue doesn't export anything
+  ReplicateQueue<int> unnamedQueue;
+  auto r4 = unnamedQueue.getReader("reader4");
+  unnamedQueue.push(1);
+  for (auto const& [key, _] : fb303::fbData->getCounters()) {
+    EXPECT_EQ(std::string::npos, key.find("reader4"));
+  }
+}
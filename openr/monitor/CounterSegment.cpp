@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/monitor/CounterSegment.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <folly/String.h>
+
+namespace openr {
+
+namespace {
+
+// retries of a read racing with updates before giving up on a writer which
+// died while updating
+constexpr int kMaxReadAttempts{1000};
+
+size_t
+alignUp(size_t offset) {
+  return (offset + alignof(int64_t) - 1) & ~(alignof(int64_t) - 1);
+}
+
+std::runtime_error
+makeError(std::string const& what, std::string const& path) {
+  return std::runtime_error(
+      fmt::format("Failed to {} {}: {}", what, path, folly::errnoStr(errno)));
+}
+
+// mark the segment at path stale, if any, e.g. left by a crashed writer
+void
+markSegmentStale(std::string const& path) {
+  const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 or
+      static_cast<size_t>(st.st_size) < sizeof(CounterSegment::Header)) {
+    ::close(fd);
+    return;
+  }
+  void* segment = ::mmap(
+      nullptr,
+      sizeof(CounterSegment::Header),
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED,
+      fd,
+      0);
+  ::close(fd);
+  if (segment == MAP_FAILED) {
+    return;
+  }
+  auto* header = static_cast<CounterSegment::Header*>(segment);
+  if (header->magic == CounterSegment::kMagic) {
+    header->stale.store(1, std::memory_order_release);
+  }
+  ::munmap(segment, sizeof(CounterSegment::Header));
+}
+
+int64_t
+getNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+size_t
+CounterSegment::getValuesOffset(uint32_t capacity, uint32_t namesCapacity) {
+  return alignUp(sizeof(Header) + capacity * sizeof(Slot) + namesCapacity);
+}
+
+size_t
+CounterSegment::getSize(uint32_t capacity, uint32_t namesCapacity) {
+  return getValuesOffset(capacity, namesCapacity) + capacity * sizeof(int64_t);
+}
+
+//
+// CounterSegmentWriter
+//
+
+CounterSegmentWriter::CounterSegmentWriter(
+    std::string path, uint32_t capacity, uint32_t namesCapacity)
+    : path_(std::move(path)) {
+  markSegmentStale(path_);
+  create(std::max<uint32_t>(capacity, 1), std::max<uint32_t>(namesCapacity, 1));
+}
+
+CounterSegmentWriter::~CounterSegmentWriter() {
+  // don't leave counters of a stopped process behind
+  ::unlink(path_.c_str());
+  release(true);
+}
+
+CounterSegment::Header*
+CounterSegmentWriter::header() {
+  return static_cast<CounterSegment::Header*>(segment_);
+}
+
+CounterSegment::Slot*
+CounterSegmentWriter::slots() {
+  return reinterpret_cast<CounterSegment::Slot*>(
+      static_cast<char*>(segment_) + sizeof(CounterSegment::Header));
+}
+
+char*
+CounterSegmentWriter::names() {
+  return reinterpret_cast<char*>(slots() + capacity_);
+}
+
+std::atomic<int64_t>*
+CounterSegmentWriter::values() {
+  return reinterpret_cast<std::atomic<int64_t>*>(
+      static_cast<char*>(segment_) +
+      CounterSegment::getValuesOffset(capacity_, namesCapacity_));
+}
+
+void
+CounterSegmentWriter::create(uint32_t capacity, uint32_t namesCapacity) {
+  // readers only ever open a complete segment
+  const auto tmpPath = path_ + ".tmp";
+  const int fd =
+      ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw makeError("create", tmpPath);
+  }
+  const auto size = CounterSegment::getSize(capacity, namesCapacity);
+  if (::ftruncate(fd, size) != 0) {
+    auto error = makeError("resize", tmpPath);
+    ::close(fd);
+    ::unlink(tmpPath.c_str());
+    throw error;
+  }
+  void* segment =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (segment == MAP_FAILED) {
+    auto error = makeError("map", tmpPath);
+    ::unlink(tmpPath.c_str());
+    throw error;
+  }
+
+  auto* header = new (segment) CounterSegment::Header();
+  header->magic = CounterSegment::kMagic;
+  header->version = CounterSegment::kVersion;
+  header->capacity = capacity;
+  header->namesCapacity = namesCapacity;
+  if (::rename(tmpPath.c_str(), path_.c_str()) != 0) {
+    auto error = makeError("rename", tmpPath);
+    ::munmap(segment, size);
+    ::unlink(tmpPath.c_str());
+    throw error;
+  }
+
+  release(true);
+  segment_ = segment;
+  size_ = size;
+  capacity_ = capacity;
+  namesCapacity_ = namesCapacity;
+  names_.clear();
+}
+
+void
+CounterSegmentWriter::release(bool markStale) {
+  if (not segment_) {
+    return;
+  }
+  if (markStale) {
+    header()->stale.store(1, std::memory_order_release);
+  }
+  ::munmap(segment_, size_);
+  segment_ = nullptr;
+}
+
+void
+CounterSegmentWriter::writeLayout(
+    std::map<std::string, int64_t> const& counters) {
+  names_.clear();
+  uint32_t offset{0};
+  for (auto const& [name, _] : counters) {
+    slots()[names_.size()] = {offset, static_cast<uint32_t>(name.size())};
+    std::memcpy(names() + offset, name.data(), name.size());
+    offset += name.size();
+    names_.emplace_back(name);
+  }
+  header()->numCounters.store(
+      static_cast<uint32_t>(names_.size()), std::memory_order_relaxed);
+  header()->layoutVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+CounterSegmentWriter::update(std::map<std::string, int64_t> const& counters) {
+  // counters are sorted as names of the segment, compare them in lockstep
+  bool layoutChanged = counters.size() != names_.size();
+  size_t namesSize{0};
+  auto nameIt = names_.begin();
+  for (auto const& [name, _] : counters) {
+    namesSize += name.size();
+    if (not layoutChanged and name != *nameIt++) {
+      layoutChanged = true;
+    }
+  }
+
+  if (layoutChanged and
+      (counters.size() > capacity_ or namesSize > namesCapacity_)) {
+    auto capacity = capacity_;
+    auto namesCapacity = namesCapacity_;
+    while (counters.size() > capacity) {
+      capacity *= 2;
+    }
+    while (namesSize > namesCapacity) {
+      namesCapacity *= 2;
+    }
+    create(capacity, namesCapacity);
+  }
+
+  auto* header = this->header();
+  const auto sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (layoutChanged) {
+    writeLayout(counters);
+  }
+  auto* values = this->values();
+  size_t slot{0};
+  for (auto const& [_, value] : counters) {
+    values[slot++].store(value, std::memory_order_relaxed);
+  }
+  header->updateTimeMs.store(getNowMs(), std::memory_order_relaxed);
+
+  header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+//
+// CounterSegmentReader
+//
+
+CounterSegmentReader::CounterSegmentReader(std::string path)
+    : path_(std::move(path)) {}
+
+CounterSegmentReader::~CounterSegmentReader() {
+  close();
+}
+
+void
+CounterSegmentReader::open() {
+  const int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw makeError("open", path_);
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    auto error = makeError("stat", path_);
+    ::close(fd);
+    throw error;
+  }
+  const auto size = static_cast<size_t>(st.st_size);
+  if (size < sizeof(CounterSegment::Header)) {
+    ::close(fd);
+    throw std::runtime_error(fmt::format("{} is not a counter segment", path_));
+  }
+  void const* segment = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (segment == MAP_FAILED) {
+    throw makeError("map", path_);
+  }
+
+  auto const* header = static_cast<CounterSegment::Header const*>(segment);
+  if (header->magic != CounterSegment::kMagic or
+      header->version != CounterSegment::kVersion or
+      CounterSegment::getSize(header->capacity, header->namesCapacity) >
+          size) {
+    ::munmap(const_cast<void*>(segment), size);
+    throw std::runtime_error(fmt::format("{} is not a counter segment", path_));
+  }
+  segment_ = segment;
+  size_ = size;
+  // layout versions restart with every segment
+  layoutVersion_ = 0;
+  names_.clear();
+}
+
+void
+CounterSegmentReader::close() {
+  if (segment_) {
+    ::munmap(const_cast<void*>(segment_), size_);
+    segment_ = nullptr;
+  }
+}
+
+bool
+CounterSegmentReader::tryRead(std::map<std::string, int64_t>& counters) {
+  auto const* base = static_cast<char const*>(segment_);
+  auto const* header = static_cast<CounterSegment::Header const*>(segment_);
+  const auto sequence = header->sequence.load(std::memory_order_acquire);
+  if (sequence & 1) {
+    return false;
+  }
+
+  const auto layoutVersion =
+      header->layoutVersion.load(std::memory_order_relaxed);
+  const auto numCounters = std::min(
+      header->numCounters.load(std::memory_order_relaxed), header->capacity);
+  std::vector<std::string> names;
+  const bool layoutChanged =
+      layoutVersion != layoutVersion_ or names_.size() != numCounters;
+  if (layoutChanged) {
+    // slots may be torn by a concurrent update, bound them before copying
+    auto const* slots = reinterpret_cast<CounterSegment::Slot const*>(
+        base + sizeof(CounterSegment::Header));
+    auto const* nameChars =
+        reinterpret_cast<char const*>(slots + header->capacity);
+    names.reserve(numCounters);
+    for (uint32_t i = 0; i < numCounters; ++i) {
+      const auto slot = slots[i];
+      if (size_t{slot.nameOffset} + slot.nameLength > header->namesCapacity) {
+        return false;
+      }
+      names.emplace_back(nameChars + slot.nameOffset, slot.nameLength);
+    }
+  }
+
+  auto const* values = reinterpret_cast<std::atomic<int64_t> const*>(
+      base +
+      CounterSegment::getValuesOffset(
+          header->capacity, header->namesCapacity));
+  std::vector<int64_t> snapshot(numCounters);
+  for (uint32_t i = 0; i < numCounters; ++i) {
+    snapshot[i] = values[i].load(std::memory_order_relaxed);
+  }
+  const auto updateTimeMs =
+      header->updateTimeMs.load(std::memory_order_relaxed);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->sequence.load(std::memory_order_relaxed) != sequence) {
+    return false;
+  }
+
+  if (layoutChanged) {
+    names_ = std::move(names);
+    layoutVersion_ = layoutVersion;
+  }
+  updateTimeMs_ = updateTimeMs;
+  counters.clear();
+  for (uint32_t i = 0; i < numCounters; ++i) {
+    counters.emplace_hint(counters.end(), names_[i], snapshot[i]);
+  }
+  return true;
+}
+
+std::map<std::string, int64_t>
+CounterSegmentReader::getCounters() {
+  if (not segment_) {
+    open();
+  }
+  std::map<std::string, int64_t> counters;
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    auto const* header = static_cast<CounterSegment::Header const*>(segment_);
+    if (header->stale.load(std::memory_order_acquire)) {
+      // replaced by a larger one or abandoned by its writer
+      close();
+      open();
+      header = static_cast<CounterSegment::Header const*>(segment_);
+      if (header->stale.load(std::memory_order_acquire)) {
+        throw std::runtime_error(
+            fmt::format("Segment {} has no writer", path_));
+      }
+    }
+    if (tryRead(counters)) {
+      return counters;
+    }
+    std::this_thread::yield();
+  }
+  throw std::runtime_error(
+      fmt::format("Segment {} is busy, its writer may be gone", path_));
+}
+
+} // namespace openr
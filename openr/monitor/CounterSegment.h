@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace openr {
+
+/**
+ * Export of counters into a file mapped in shared memory, e.g. under
+ * /dev/shm, for local agents to scrape them without RPC and without
+ * contending with Open/R on any lock. See `MonitorConfig.counter_export_path`.
+ *
+ * Layout, in host byte order:
+ *
+ *   Header
+ *   Slot[capacity]           name of each counter, offset into names
+ *   char[namesCapacity]      counter names
+ *   int64_t[capacity]        counter values
+ *
+ * Counters are sorted by name. The writer updates values in place. Names
+ * are only rewritten when counters are added or removed, which bumps
+ * `layoutVersion`, so readers need to copy them only then.
+ *
+ * Segment is protected by a seqlock: the writer makes `sequence` odd while
+ * updating it. Readers retry reads during which `sequence` was odd or
+ * changed. Once the writer outgrows a segment, it renames a larger one over
+ * the path and marks the old one `stale` for readers to re-open the path.
+ * Segments left behind by a crashed writer are marked stale by the next
+ * one, readers may also check the update time to detect a hung writer.
+ */
+class CounterSegment {
+ public:
+  static constexpr uint64_t kMagic{0x4f70656e52436e74}; // "OpenRCnt"
+  static constexpr uint32_t kVersion{1};
+
+  struct Header {
+    uint64_t magic{0};
+    uint32_t version{0};
+    uint32_t capacity{0};
+    uint32_t namesCapacity{0};
+    uint32_t reserved{0};
+    // seqlock, odd while the writer updates the segment
+    std::atomic<uint64_t> sequence{0};
+    // bumped whenever names change
+    std::atomic<uint64_t> layoutVersion{0};
+    std::atomic<uint32_t> numCounters{0};
+    std::atomic<uint32_t> stale{0};
+    // unix timestamp of the last update
+    std::atomic<int64_t> updateTimeMs{0};
+  };
+
+  struct Slot {
+    uint32_t nameOffset{0};
+    uint32_t nameLength{0};
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+  static_assert(std::atomic<int64_t>::is_always_lock_free);
+  static_assert(std::is_standard_layout_v<Header>);
+
+  // bytes of the segment and offsets of its sections
+  static size_t getSize(uint32_t capacity, uint32_t namesCapacity);
+  static size_t getValuesOffset(uint32_t capacity, uint32_t namesCapacity);
+};
+
+/**
+ * Owner of the segment at path, creating it on construction and removing it
+ * on destruction. Not thread safe, there must be a single writer.
+ */
+class CounterSegmentWriter {
+ public:
+  // throws std::runtime_error if the segment can't be created
+  explicit CounterSegmentWriter(
+      std::string path,
+      uint32_t capacity = 16384,
+      uint32_t namesCapacity = 1 << 20);
+  ~CounterSegmentWriter();
+
+  /**
+   * non-copyable
+   */
+  CounterSegmentWriter(CounterSegmentWriter const&) = delete;
+  CounterSegmentWriter& operator=(CounterSegmentWriter const&) = delete;
+
+  // replace counters of the segment, growing it if needed
+  void update(std::map<std::string, int64_t> const& counters);
+
+  uint32_t
+  getCapacity() const {
+    return capacity_;
+  }
+
+ private:
+  // map a new zeroed segment and rename it over path
+  void create(uint32_t capacity, uint32_t namesCapacity);
+
+  // release the current segment, marking it stale if not removed
+  void release(bool markStale);
+
+  // rewrite names of the segment, which must fit
+  void writeLayout(std::map<std::string, int64_t> const& counters);
+
+  CounterSegment::Header* header();
+  CounterSegment::Slot* slots();
+  char* names();
+  std::atomic<int64_t>* values();
+
+  const std::string path_;
+  uint32_t capacity_{0};
+  uint32_t namesCapacity_{0};
+  void* segment_{nullptr};
+  size_t size_{0};
+
+  // sorted names of the counters in the segment, by slot
+  std::vector<std::string> names_;
+};
+
+/**
+ * Read-only mapping of the segment at path, for agents and tests.
+ * Not thread safe.
+ */
+class CounterSegmentReader {
+ public:
+  explicit CounterSegmentReader(std::string path);
+  ~CounterSegmentReader();
+
+  /**
+   * non-copyable
+   */
+  CounterSegmentReader(CounterSegmentReader const&) = delete;
+  CounterSegmentReader& operator=(CounterSegmentReader const&) = delete;
+
+  // consistent snapshot of the counters, re-opening the path if the segment
+  // is stale. throws std::runtime_error if no valid segment is found
+  std::map<std::string, int64_t> getCounters();
+
+  // unix timestamp of the update of the last snapshot
+  int64_t
+  getUpdateTimeMs() const {
+    return updateTimeMs_;
+  }
+
+ private:
+  void open();
+  void close();
+
+  // false if the segment changed during the read
+  bool tryRead(std::map<std::string, int64_t>& counters);
+
+  const std::string path_;
+  void const* segment_{nullptr};
+  size_t size_{0};
+
+  // names of the layout version last read
+  uint64_t layoutVersion_{0};
+  std::vector<std::string> names_;
+  int64_t updateTimeMs_{0};
+};
+
+} // namespace openr
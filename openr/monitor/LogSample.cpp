@@ -7,7 +7,7 @@
 
 #include "openr/monitor/LogSample.h"
 
-#include <folly/DynamicConverter.h>
+#include <folly/Format.h>
 #include <folly/json.h>
 
 namespace {
@@ -23,6 +23,87 @@ const std::string STRINGTAGSET_KEY{"tagset"};
 
 const std::string kTimeCol{"time"};
 
+template <typename T>
+using Fields = std::vector<std::pair<std::string, T>>;
+
+template <typename T>
+T const*
+findField(Fields<T> const& fields, folly::StringPiece key) {
+  for (auto const& [fieldKey, value] : fields) {
+    if (fieldKey == key) {
+      return &value;
+    }
+  }
+  return nullptr;
+}
+
+template <typename T>
+void
+setField(Fields<T>& fields, folly::StringPiece key, T value) {
+  for (auto& [fieldKey, fieldValue] : fields) {
+    if (fieldKey == key) {
+      fieldValue = std::move(value);
+      return;
+    }
+  }
+  fields.emplace_back(key.str(), std::move(value));
+}
+
+template <typename T>
+T const&
+getField(
+    Fields<T> const& fields,
+    folly::StringPiece keyType,
+    folly::StringPiece key) {
+  if (auto value = findField(fields, key)) {
+    return *value;
+  }
+  throw std::invalid_argument(
+      folly::sformat("invalid key: {} with keyType: {} ", key, keyType));
+}
+
+// json object of the fields, keyType of them is not set if there are none
+template <typename T>
+void
+addFieldsToJson(
+    folly::dynamic& json, std::string const& keyType, Fields<T> const& fields) {
+  if (fields.empty()) {
+    return;
+  }
+  auto obj = folly::dynamic::object();
+  for (auto const& [key, value] : fields) {
+    if constexpr (std::is_arithmetic_v<T> or std::is_same_v<T, std::string>) {
+      obj[key] = value;
+    } else {
+      obj[key] = folly::dynamic(value.begin(), value.end());
+    }
+  }
+  json[keyType] = std::move(obj);
+}
+
+template <typename T, typename Fn>
+void
+addFieldsFromJson(
+    folly::dynamic const& json,
+    std::string const& keyType,
+    Fields<T>& fields,
+    Fn&& convert) {
+  if (auto obj = json.get_ptr(keyType)) {
+    for (auto const& [key, value] : obj->items()) {
+      setField(fields, key.asString(), convert(value));
+    }
+  }
+}
+
+std::vector<std::string>
+toStringVector(folly::dynamic const& values) {
+  std::vector<std::string> result;
+  for (auto const& value : values) {
+    result.emplace_back(value.asString());
+  }
+  return result;
+}
+
 } // anonymous namespace
 
 namespace openr {
@@ -31,9 +112,7 @@ LogSample::LogSample() : LogSample(std::chrono::system_clock::now()) {}
 
 LogSample::LogSample(std::chrono::system_clock::time_point timestamp)
     : timestamp_(timestamp) {
-  json_ = folly::dynamic::object;
-
-  // add the timestamp to the json sample
+  // add the timestamp to the sample
   addInt(
       kTimeCol,
       std::chrono::duration_cast<std::chrono::seconds>(
@@ -43,7 +122,23 @@ LogSample::LogSample(std::chrono::system_clock::time_point timestamp)
 
 LogSample::LogSample(
     folly::dynamic json, std::chrono::system_clock::time_point timestamp)
-    : json_(json), timestamp_(timestamp) {}
+    : timestamp_(timestamp) {
+  addFieldsFromJson(json, INT_KEY, ints_, [](folly::dynamic const& v) {
+    return v.asInt();
+  });
+  addFieldsFromJson(json, DOUBLE_KEY, doubles_, [](folly::dynamic const& v) {
+    return v.asDouble();
+  });
+  addFieldsFromJson(json, STRING_KEY, strings_, [](folly::dynamic const& v) {
+    return v.asString();
+  });
+  addFieldsFromJson(json, STRINGVECTOR_KEY, stringVectors_, toStringVector);
+  addFieldsFromJson(
+      json, STRINGTAGSET_KEY, stringTagsets_, [](folly::dynamic const& v) {
+        auto values = toStringVector(v);
+        return std::set<std::string>(values.begin(), values.end());
+      });
+}
 
 LogSample
 LogSample::fromJson(const std::string& json) {
@@ -56,134 +151,93 @@ LogSample::fromJson(const std::string& json) {
 
 std::string
 LogSample::toJson() const {
+  auto json = folly::dynamic::object();
+  addFieldsToJson(json, INT_KEY, ints_);
+  addFieldsToJson(json, DOUBLE_KEY, doubles_);
+  addFieldsToJson(json, STRING_KEY, strings_);
+  addFieldsToJson(json, STRINGVECTOR_KEY, stringVectors_);
+  addFieldsToJson(json, STRINGTAGSET_KEY, stringTagsets_);
+
   folly::json::serialization_opts opts;
   opts.sort_keys = true;
-  return folly::json::serialize(json_, opts);
+  return folly::json::serialize(json, opts);
 }
 
 void
 LogSample::addInt(folly::StringPiece key, int64_t value) {
-  if (json_.find(INT_KEY) == json_.items().end()) {
-    json_.insert(INT_KEY, folly::dynamic::object());
-  }
-
-  json_[INT_KEY][key] = value;
+  setField(ints_, key, value);
 }
 
 void
 LogSample::addDouble(folly::StringPiece key, double value) {
-  if (json_.find(DOUBLE_KEY) == json_.items().end()) {
-    json_.insert(DOUBLE_KEY, folly::dynamic::object());
-  }
-
-  json_[DOUBLE_KEY][key] = value;
+  setField(doubles_, key, value);
 }
 
 void
 LogSample::addString(folly::StringPiece key, folly::StringPiece value) {
-  if (json_.find(STRING_KEY) == json_.items().end()) {
-    json_.insert(STRING_KEY, folly::dynamic::object());
-  }
-
-  json_[STRING_KEY][key] = value;
+  setField(strings_, key, value.str());
 }
 
 void
 LogSample::addStringVector(
     folly::StringPiece key, const std::vector<std::string>& values) {
-  if (json_.find(STRINGVECTOR_KEY) == json_.items().end()) {
-    json_.insert(STRINGVECTOR_KEY, folly::dynamic::object());
-  }
-
-  json_[STRINGVECTOR_KEY][key] = folly::dynamic(values.begin(), values.end());
+  setField(stringVectors_, key, values);
 }
 
 void
 LogSample::addStringTagset(
     folly::StringPiece key, const std::set<std::string>& tags) {
-  if (json_.find(STRINGTAGSET_KEY) == json_.items().end()) {
-    json_.insert(STRINGTAGSET_KEY, folly::dynamic::object());
-  }
-
-  json_[STRINGTAGSET_KEY][key] = folly::dynamic(tags.begin(), tags.end());
+  setField(stringTagsets_, key, tags);
 }
 
 int64_t
 LogSample::getInt(folly::StringPiece key) const {
-  return folly::convertTo<int64_t>(getInnerValue(INT_KEY, key));
+  return getField(ints_, INT_KEY, key);
 }
 
 double
 LogSample::getDouble(folly::StringPiece key) const {
-  return folly::convertTo<double>(getInnerValue(DOUBLE_KEY, key));
+  return getField(doubles_, DOUBLE_KEY, key);
 }
 
 std::string
 LogSample::getString(folly::StringPiece key) const {
-  return folly::convertTo<std::string>(getInnerValue(STRING_KEY, key));
+  return getField(strings_, STRING_KEY, key);
 }
 
 std::vector<std::string>
 LogSample::getStringVector(folly::StringPiece key) const {
-  return folly::convertTo<std::vector<std::string>>(
-      getInnerValue(STRINGVECTOR_KEY, key));
+  return getField(stringVectors_, STRINGVECTOR_KEY, key);
 }
 
 std::set<std::string>
 LogSample::getStringTagset(folly::StringPiece key) const {
-  return folly::convertTo<std::set<std::string>>(
-      getInnerValue(STRINGTAGSET_KEY, key));
+  return getField(stringTagsets_, STRINGTAGSET_KEY, key);
 }
 
 bool
 LogSample::isIntSet(folly::StringPiece key) const {
-  return isInnerValueSet(INT_KEY, key);
+  return findField(ints_, key) != nullptr;
 }
 
 bool
 LogSample::isDoubleSet(folly::StringPiece key) const {
-  return isInnerValueSet(DOUBLE_KEY, key);
+  return findField(doubles_, key) != nullptr;
 }
 
 bool
 LogSample::isStringSet(folly::StringPiece key) const {
-  return isInnerValueSet(STRING_KEY, key);
+  return findField(strings_, key) != nullptr;
 }
 
 bool
 LogSample::isStringVectorSet(folly::StringPiece key) const {
-  return isInnerValueSet(STRINGVECTOR_KEY, key);
+  return findField(stringVectors_, key) != nullptr;
 }
 
 bool
 LogSample::isStringTagsetSet(folly::StringPiece key) const {
-  return isInnerValueSet(STRINGTAGSET_KEY, key);
-}
-
-bool
-LogSample::isInnerValueSet(
-    folly::StringPiece keyType, folly::StringPiece key) const {
-  if (auto obj = json_.get_ptr(keyType)) {
-    if (auto data = obj->get_ptr(key)) {
-      (void)data;
-      return true;
-    }
-  }
-
-  return false;
-}
-
-const folly::dynamic&
-LogSample::getInnerValue(
-    folly::StringPiece keyType, folly::StringPiece key) const {
-  if (auto obj = json_.get_ptr(keyType)) {
-    if (auto data = obj->get_ptr(key)) {
-      return *data;
-    }
-  }
-
-  throw std::invalid_argument(
-      folly::sformat("invalid key: {} with keyType: {} ", key, keyType));
+  return findField(stringTagsets_, key) != nullptr;
 }
 
 } // namespace openr
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <folly/Range.h>
@@ -36,6 +37,10 @@ namespace openr {
  *    auto json = sample.toJson();
  *    myMonitoringServiceClient.send(sample.json)
  *
+ * Values are kept typed, per value type, and only rendered to json by
+ * toJson(). Samples are cheap to create and pass around at high rate, json
+ * formatting is left to the rare consumers of it.
+ *
  * NOTE: Timestamp is critical part of Sample as it tells when event/log was
  * generated. It must be a measurement related to system clock (no steady
  * clock) to get absolute notion of time.
@@ -102,13 +107,16 @@ class LogSample {
   bool isStringTagsetSet(folly::StringPiece key) const;
 
  private:
-  bool isInnerValueSet(
-      folly::StringPiece keyType, folly::StringPiece key) const;
-  const folly::dynamic& getInnerValue(
-      folly::StringPiece keyType, folly::StringPiece key) const;
-
-  // Internal json representation of this sample
-  folly::dynamic json_ = folly::dynamic::object;
+  // values of one type, in insertion order. Samples have few values, lookups
+  // by linear search beat hashing them
+  template <typename T>
+  using Fields = std::vector<std::pair<std::string, T>>;
+
+  Fields<int64_t> ints_;
+  Fields<double> doubles_;
+  Fields<std::string> strings_;
+  Fields<std::vector<std::string>> stringVectors_;
+  Fields<std::set<std::string>> stringTagsets_;
 
   // Timepoint associated with this sample
   std::chrono::system_clock::time_point timestamp_;
@@ -7,6 +7,7 @@
 
 #include "openr/monitor/MonitorBase.h"
 #include <openr/common/Constants.h>
+#include <openr/common/StatCounter.h>
 
 namespace openr {
 
@@ -18,6 +19,8 @@ MonitorBase::MonitorBase(
       maxLogEvents_{
           folly::to<uint32_t>(*config->getMonitorConfig().max_event_log_ref())},
       startTime_{std::chrono::steady_clock::now()} {
+  recentLog_.wlock()->logs.reserve(maxLogEvents_);
+
   // Initialize stats counter
   fb303::fbData->addStatExportType("monitor.log.publish.failure", fb303::COUNT);
 
@@ -31,6 +34,38 @@ MonitorBase::MonitorBase(
   // Schedule an immediate timeout
   setProcessCounterTimer_->scheduleTimeout(0);
 
+  // Counters of the export are as fresh as flushed hot path counters
+  const auto& counterExportPath =
+      config->getMonitorConfig().counter_export_path_ref();
+  if (counterExportPath.has_value()) {
+    try {
+      counterSegment_ =
+          std::make_unique<CounterSegmentWriter>(*counterExportPath);
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Counters won't be exported to shared memory: "
+                 << e.what();
+    }
+  }
+
+  // Periodically flush hot path counters aggregated per thread
+  flushStatCountersTimer_ =
+      folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+        StatCounter::flushAll();
+        if (counterSegment_) {
+          try {
+            counterSegment_->update(fb303::fbData->getCounters());
+          } catch (std::exception const& e) {
+            LOG(ERROR) << "Stopped exporting counters to shared memory: "
+                       << e.what();
+            counterSegment_.reset();
+          }
+        }
+        flushStatCountersTimer_->scheduleTimeout(
+            Constants::kStatCounterFlushInterval);
+      });
+  flushStatCountersTimer_->scheduleTimeout(
+      Constants::kStatCounterFlushInterval);
+
   // Fiber task to read the LogSample from queue and publish
   addFiberTask(
       [q = std::move(logSampleQueue), config, this]() mutable noexcept {
@@ -38,47 +73,86 @@ MonitorBase::MonitorBase(
                   << "with isLogSubmissionEnable() flag: "
                   << config->isLogSubmissionEnabled();
         while (true) {
-          // perform read log from the queue
-          auto maybeLog = q.get();
-          VLOG(2) << "Received log sample update";
-          if (maybeLog.hasError()) {
+          // perform read of all pending logs from the queue
+          auto maybeLogs = q.getBatch(Constants::kMonitorMaxEventLogBatch);
+          VLOG(2) << "Received log sample updates";
+          if (maybeLogs.hasError()) {
             LOG(INFO) << "Terminating log sample updates processing fiber";
             break;
           }
 
-          // validate, process and publish the event logs
-          try {
-            auto inputLog = maybeLog.value();
-            // add common attributes
-            inputLog.addString("node_name", config->getNodeName());
-            inputLog.addString("domain", *config->getConfig().domain_ref());
+          // validate and add common attributes to the event logs
+          std::vector<LogSample> eventLogs;
+          eventLogs.reserve(maybeLogs->size());
+          for (auto& inputLog : maybeLogs.value()) {
+            try {
+              // add common attributes
+              inputLog.addString("node_name", config->getNodeName());
+              inputLog.addString("domain", *config->getConfig().domain_ref());
 
-            // throws std::invalid_argument if not exist
-            inputLog.getString("event");
-
-            // add to recent log list
-            if (recentLog_.size() >= maxLogEvents_) {
-              recentLog_.pop_front();
+              // throws std::invalid_argument if not exist
+              inputLog.getString("event");
+              eventLogs.emplace_back(std::move(inputLog));
+            } catch (const std::exception& e) {
+              fb303::fbData->addStatValue(
+                  "monitor.log.publish.failure", 1, fb303::COUNT);
+              LOG(ERROR) << "Failed to publish the log. Error: "
+                         << folly::exceptionStr(e);
             }
-            recentLog_.emplace_back(inputLog.toJson());
+          }
 
-            // publish the log if enable log submission
-            if (config->isLogSubmissionEnabled()) {
-              processEventLog(inputLog);
+          // add to recent log list
+          if (maxLogEvents_ > 0) {
+            recentLog_.withWLock([&](auto& ring) {
+              for (auto const& eventLog : eventLogs) {
+                if (ring.logs.size() < maxLogEvents_) {
+                  ring.logs.emplace_back(eventLog);
+                } else {
+                  ring.logs[ring.next] = eventLog;
+                }
+                ring.next = (ring.next + 1) % maxLogEvents_;
+              }
+            });
+          }
+
+          // publish the logs if enable log submission
+          if (config->isLogSubmissionEnabled() and not eventLogs.empty()) {
+            try {
+              processEventLogs(eventLogs);
+            } catch (const std::exception& e) {
+              fb303::fbData->addStatValue(
+                  "monitor.log.publish.failure", 1, fb303::COUNT);
+              LOG(ERROR) << "Failed to publish the logs. Error: "
+                         << folly::exceptionStr(e);
             }
-          } catch (const std::exception& e) {
-            fb303::fbData->addStatValue(
-                "monitor.log.publish.failure", 1, fb303::COUNT);
-            LOG(ERROR) << "Failed to publish the log. Error: "
-                       << folly::exceptionStr(e);
           }
         }
       });
 }
 
+void
+MonitorBase::processEventLogs(std::vector<LogSample> const& eventLogs) {
+  for (auto const& eventLog : eventLogs) {
+    processEventLog(eventLog);
+  }
+}
+
 std::list<std::string>
 MonitorBase::getRecentEventLogs() {
-  return recentLog_;
+  // copy the logs oldest first, rendering happens outside of the lock
+  std::vector<LogSample> recentLog;
+  recentLog_.withRLock([&](auto const& ring) {
+    recentLog.reserve(ring.logs.size());
+    const auto start = ring.logs.size() < maxLogEvents_ ? 0 : ring.next;
+    for (size_t i = 0; i < ring.logs.size(); ++i) {
+      recentLog.emplace_back(ring.logs[(start + i) % ring.logs.size()]);
+    }
+  });
+  std::list<std::string> jsonLogs;
+  for (auto const& eventLog : recentLog) {
+    jsonLogs.emplace_back(eventLog.toJson());
+  }
+  return jsonLogs;
 }
 
 void
@@ -8,11 +8,13 @@
 #pragma once
 
 #include <folly/Function.h>
+#include <folly/Synchronized.h>
 
 #include <fb303/ServiceData.h>
 #include <openr/common/OpenrEventBase.h>
 #include <openr/config/Config.h>
 #include <openr/messaging/ReplicateQueue.h>
+#include <openr/monitor/CounterSegment.h>
 #include <openr/monitor/LogSample.h>
 #include <openr/monitor/SystemMetrics.h>
 
@@ -24,10 +26,12 @@ namespace openr {
  * This class is a base class for Open/R monitoring. It
  * implements common functions:
  * 1. Start a fiber to read the log queue and export logs to database based on
- *    subclass's processEventLog() implementation.
- * 2. Store and return the most recent logs;
+ *    subclass's processEventLogs() implementation, in batches of the logs
+ *    pending in the queue.
+ * 2. Store the most recent logs, rendered as json only when queried;
  * 3. Export process counters: process.memory.rss, process.uptime,
  *    and process.cpu.pct
+ * 4. Optionally export all counters into shared memory, see CounterSegment
  */
 class MonitorBase : public OpenrEventBase {
  public:
@@ -50,6 +54,10 @@ class MonitorBase : public OpenrEventBase {
   // Pure virtual function for processing and publishing a log
   virtual void processEventLog(LogSample const& eventLog) = 0;
 
+  // Process and publish a batch of logs. Calls processEventLog() for each
+  // one unless overridden by backends submitting batches at once
+  virtual void processEventLogs(std::vector<LogSample> const& eventLogs);
+
   // Set process counters
   void updateProcessCounters();
 
@@ -59,12 +67,25 @@ class MonitorBase : public OpenrEventBase {
   // Number of last log events to queue
   const uint32_t maxLogEvents_{0};
 
-  // List of recent log
-  std::list<std::string> recentLog_{};
+  // Ring of the last maxLogEvents_ logs. Once full, the oldest log is at
+  // `next` and gets overwritten in place, reusing its memory
+  struct RecentLogRing {
+    std::vector<LogSample> logs;
+    size_t next{0};
+  };
+
+  // Recent logs, read by getRecentEventLogs() from other threads
+  folly::Synchronized<RecentLogRing> recentLog_{};
 
   // Timer to periodically set process cpu/uptime/memory counter
   std::unique_ptr<folly::AsyncTimeout> setProcessCounterTimer_;
 
+  // Timer to periodically flush StatCounter values into fb303
+  std::unique_ptr<folly::AsyncTimeout> flushStatCountersTimer_;
+
+  // Shared memory export of counters, refreshed along with the flush
+  std::unique_ptr<CounterSegmentWriter> counterSegment_;
+
   // Start timestamp for calculate process.uptime.seconds
   const std::chrono::steady_clock::time_point startTime_;
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <fmt/format.h>
+#include <folly/experimental/TestUtil.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/monitor/CounterSegment.h>
+
+using namespace openr;
+
+TEST(CounterSegmentTest, UpdateAndRead) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "counters").string();
+
+  CounterSegmentReader reader(path);
+  EXPECT_THROW(reader.getCounters(), std::runtime_error);
+
+  auto writer = std::make_unique<CounterSegmentWriter>(path, 2, 16);
+  EXPECT_TRUE(reader.getCounters().empty());
+
+  // values are updated in place
+  std::map<std::string, int64_t> counters{{"a.b", 1}, {"c", -2}};
+  writer->update(counters);
+  EXPECT_EQ(counters, reader.getCounters());
+  EXPECT_LT(0, reader.getUpdateTimeMs());
+  counters.at("a.b") = 3;
+  writer->update(counters);
+  EXPECT_EQ(counters, reader.getCounters());
+
+  // added and removed counters
+  counters.erase("c");
+  counters.emplace("b", 4);
+  writer->update(counters);
+  EXPECT_EQ(counters, reader.getCounters());
+
+  // outgrown segment is replaced by a larger one
+  counters.emplace("d", 5);
+  counters.emplace("a.very.long.counter.name", 6);
+  writer->update(counters);
+  EXPECT_EQ(4, writer->getCapacity());
+  EXPECT_EQ(counters, reader.getCounters());
+  EXPECT_EQ(counters, CounterSegmentReader(path).getCounters());
+
+  // a new writer takes over the path
+  auto newWriter = std::make_unique<CounterSegmentWriter>(path);
+  counters = {{"e", 7}};
+  newWriter->update(counters);
+  EXPECT_EQ(counters, reader.getCounters());
+
+  // segment is removed along with its writer
+  newWriter.reset();
+  EXPECT_THROW(reader.getCounters(), std::runtime_error);
+  writer.reset();
+}
+
+TEST(CounterSegmentTest, ConsistentSnapshots) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "counters").string();
+  CounterSegmentWriter writer(path, 8);
+
+  // all counters of an update have the same value, and the set of counters
+  // changes along with it
+  std::atomic<bool> stop{false};
+  std::thread writerThread([&]() {
+    for (int64_t i = 0; not stop; ++i) {
+      std::map<std::string, int64_t> counters;
+      for (int64_t j = 0; j < 1 + i % 32; ++j) {
+        counters.emplace(fmt::format("counter.{}", j), i);
+      }
+      writer.update(counters);
+    }
+  });
+
+  CounterSegmentReader reader(path);
+  for (int i = 0; i < 10000; ++i) {
+    auto counters = reader.getCounters();
+    if (counters.empty()) {
+      continue;
+    }
+    const auto value = counters.begin()->second;
+    EXPECT_EQ(1 + value % 32, counters.size());
+    for (auto const& [_, counterValue] : counters) {
+      ASSERT_EQ(value, counterValue);
+    }
+  }
+  stop = true;
+  writerThread.join();
+}
+
+int
+main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InstallFailureSignalHandler();
+
+  return RUN_ALL_TESTS();
+}
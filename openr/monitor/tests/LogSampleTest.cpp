@@ -153,6 +153,32 @@ TEST(LogSampleTest, fromJsonTest) {
   EXPECT_THROW(LogSample::fromJson(jsonSampleNoTimeKey), std::exception);
 }
 
+TEST(LogSampleTest, OverwriteAndRoundTripTest) {
+  const auto timestamp =
+      std::chrono::system_clock::time_point(std::chrono::seconds(111));
+  LogSample sample(timestamp);
+  sample.addString("event", "NEIGHBOR_UP");
+  sample.addInt("rtt_ms", 3000);
+  sample.addStringVector("addresses", {"1.2.3.4", "fe80::1"});
+
+  // same key of a value type is overwritten, other types are independent
+  sample.addInt("rtt_ms", 4000);
+  sample.addDouble("rtt_ms", 1.5);
+  EXPECT_EQ(4000, sample.getInt("rtt_ms"));
+  EXPECT_EQ(1.5, sample.getDouble("rtt_ms"));
+
+  auto copy = LogSample::fromJson(sample.toJson());
+  EXPECT_EQ(timestamp, copy.getTimestamp());
+  EXPECT_EQ("NEIGHBOR_UP", copy.getString("event"));
+  EXPECT_EQ(4000, copy.getInt("rtt_ms"));
+  EXPECT_EQ(1.5, copy.getDouble("rtt_ms"));
+  EXPECT_EQ(
+      std::vector<std::string>({"1.2.3.4", "fe80::1"}),
+      copy.getStringVector("addresses"));
+  EXPECT_FALSE(copy.isStringTagsetSet("addresses"));
+  EXPECT_EQ(sample.toJson(), copy.toJson());
+}
+
 } // namespace openr
 
 int
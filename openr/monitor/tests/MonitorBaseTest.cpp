@@ -111,6 +111,34 @@ TEST_F(MonitorTestFixture, LogBasicOperation) {
   }
 }
 
+TEST_F(MonitorTestFixture, RecentLogRingTest) {
+  EXPECT_CALL(*monitor, processEventLog(_)).Times(AnyNumber());
+
+  // 1.5 times the default of max_event_log
+  const int numLogs = 150;
+  for (int i = 0; i < numLogs; ++i) {
+    LogSample log;
+    log.addString("event", "event_unit_test");
+    log.addInt("num", i);
+    eventLogUpdatesQueue.push(std::move(log));
+  }
+
+  // Wait for the last log, only the most recent ones are kept, oldest first
+  while (true) {
+    auto recentLogs = monitor->getRecentEventLogs();
+    if (not recentLogs.empty() and
+        LogSample::fromJson(recentLogs.back()).getInt("num") == numLogs - 1) {
+      ASSERT_EQ(100, recentLogs.size());
+      int num = numLogs - 100;
+      for (auto const& log : recentLogs) {
+        EXPECT_EQ(num++, LogSample::fromJson(log).getInt("num"));
+      }
+      break;
+    }
+    std::this_thread::yield();
+  }
+}
+
 TEST_F(MonitorTestFixture, ProcessCounterTest) {
   // Wait for calling getCPUpercentage() twice for calculating the cpu% counter
   while (true) {
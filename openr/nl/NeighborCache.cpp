@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/nl/NeighborCache.h>
+
+extern "C" {
+#include <linux/neighbour.h>
+}
+
+namespace openr::fbnl {
+
+void
+NeighborCache::reset(std::vector<Neighbor> const& neighbors) {
+  std::map<std::pair<int, folly::IPAddress>, int> newNeighbors;
+  for (auto const& neighbor : neighbors) {
+    if (neighbor.getState().has_value()) {
+      newNeighbors.emplace(
+          std::make_pair(neighbor.getIfIndex(), neighbor.getDestination()),
+          neighbor.getState().value());
+    }
+  }
+  *neighbors_.wlock() = std::move(newNeighbors);
+}
+
+bool
+NeighborCache::update(Neighbor const& neighbor) {
+  auto key = std::make_pair(neighbor.getIfIndex(), neighbor.getDestination());
+  auto neighbors = neighbors_.wlock();
+  auto it = neighbors->find(key);
+  const bool wasFailed = it != neighbors->end() and it->second == NUD_FAILED;
+  if (neighbor.isDeleted() or not neighbor.getState().has_value()) {
+    if (it != neighbors->end()) {
+      neighbors->erase(it);
+    }
+    return wasFailed;
+  }
+  const auto state = neighbor.getState().value();
+  (*neighbors)[key] = state;
+  return wasFailed != (state == NUD_FAILED);
+}
+
+bool
+NeighborCache::isFailed(int ifIndex, folly::IPAddress const& address) const {
+  auto neighbors = neighbors_.rlock();
+  auto it = neighbors->find(std::make_pair(ifIndex, address));
+  return it != neighbors->end() and it->second == NUD_FAILED;
+}
+
+size_t
+NeighborCache::size() const {
+  return neighbors_.rlock()->size();
+}
+
+} // namespace openr::fbnl
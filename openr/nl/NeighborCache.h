@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddress.h>
+#include <folly/Synchronized.h>
+
+#include <openr/nl/NetlinkTypes.h>
+
+namespace openr::fbnl {
+
+/**
+ * Resolution state of next-hops, mirrored from kernel neighbor (ARP/ND)
+ * table. Seeded with `getAllNeighbors()` and kept up to date with neighbor
+ * events. Thread-safe, lookups are done while programming routes and updates
+ * come from the netlink events reader.
+ *
+ * A next-hop is failed only if kernel gave up resolving it (NUD_FAILED).
+ * Unknown next-hops, or ones being resolved (NUD_INCOMPLETE), are not, as
+ * kernel only resolves neighbors traffic is sent to. Entries deleted by
+ * kernel garbage collection are forgotten, so pruned next-hops get traffic
+ * and are probed again.
+ */
+class NeighborCache final {
+ public:
+  // Replace cache with neighbors dumped from kernel
+  void reset(std::vector<Neighbor> const& neighbors);
+
+  // Apply neighbor event. Returns true if failed state of neighbor changed
+  bool update(Neighbor const& neighbor);
+
+  bool isFailed(int ifIndex, folly::IPAddress const& address) const;
+
+  size_t size() const;
+
+ private:
+  // (ifIndex, address) -> neighbor state
+  folly::Synchronized<std::map<std::pair<int, folly::IPAddress>, int>>
+      neighbors_;
+};
+
+} // namespace openr::fbnl
@@ -5,22 +5,75 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+
 #include <openr/nl/NetlinkMessageBase.h>
 
 namespace openr::fbnl {
 
+NetlinkMessagePool&
+NetlinkMessagePool::getInstance() {
+  // Never destroyed, messages may outlive static destruction
+  static auto* pool = new NetlinkMessagePool();
+  return *pool;
+}
+
+std::unique_ptr<NetlinkMessagePool::Buffer>
+NetlinkMessagePool::acquire() {
+  std::unique_ptr<Buffer> buffer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++numInUse_;
+    if (freeBuffers_.empty()) {
+      ++numAllocated_;
+    } else {
+      buffer = std::move(freeBuffers_.back());
+      freeBuffers_.pop_back();
+    }
+  }
+
+  if (not buffer) {
+    return std::make_unique<Buffer>();
+  }
+  buffer->fill(0);
+  return buffer;
+}
+
+void
+NetlinkMessagePool::release(std::unique_ptr<Buffer> buffer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  --numInUse_;
+  if (freeBuffers_.size() < kMaxNlPooledBuffers) {
+    freeBuffers_.emplace_back(std::move(buffer));
+  }
+  // else buffer is freed on return
+}
+
+NetlinkMessagePool::Stats
+NetlinkMessagePool::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.numFree = freeBuffers_.size();
+  stats.numInUse = numInUse_;
+  stats.numAllocated = numAllocated_;
+  return stats;
+}
+
 NetlinkMessageBase::NetlinkMessageBase()
-    : msghdr_(reinterpret_cast<struct nlmsghdr*>(msg.data())) {}
+    : msg_(NetlinkMessagePool::getInstance().acquire()),
+      msghdr_(reinterpret_cast<struct nlmsghdr*>(msg_->data())) {}
 
 NetlinkMessageBase::NetlinkMessageBase(int type)
-    : msghdr_(reinterpret_cast<struct nlmsghdr*>(msg.data())) {
+    : msg_(NetlinkMessagePool::getInstance().acquire()),
+      msghdr_(reinterpret_cast<struct nlmsghdr*>(msg_->data())) {
   // initialize netlink header
   msghdr_->nlmsg_len = NLMSG_LENGTH(0);
   msghdr_->nlmsg_type = type;
 }
 
 NetlinkMessageBase::~NetlinkMessageBase() {
-  CHECK(promise_.isFulfilled());
+  CHECK(status_.has_value());
+  NetlinkMessagePool::getInstance().release(std::move(msg_));
 }
 
 struct nlmsghdr*
@@ -92,16 +145,98 @@ NetlinkMessageBase::addAttributes(
 
 folly::SemiFuture<int>
 NetlinkMessageBase::getSemiFuture() {
+  CHECK(not batch_) << "Status is reported to batch";
+  if (status_.has_value()) {
+    return folly::SemiFuture<int>(*status_);
+  }
+  if (not promise_.valid()) {
+    promise_ = folly::Promise<int>();
+  }
   return promise_.getSemiFuture();
 }
 
+void
+NetlinkMessageBase::setBatch(
+    std::shared_ptr<NetlinkBatch> batch, size_t index) {
+  CHECK(not promise_.valid()) << "Status is reported to future";
+  batch_ = std::move(batch);
+  batchIndex_ = index;
+}
+
 void
 NetlinkMessageBase::setReturnStatus(int status) {
   VLOG(3) << "Netlink request completed. retval=" << status << ", "
           << folly::errnoStr(std::abs(status));
-  promise_.setValue(status);
+  CHECK(not status_.has_value()) << "Status already set";
+  status_ = status;
+  if (batch_) {
+    batch_->setReturnStatus(batchIndex_, status, errorMessage_);
+    batch_.reset();
+  } else if (promise_.valid()) {
+    promise_.setValue(status);
+  }
 }
 
+void
+NetlinkMessageBase::setErrorMessage(std::string errorMessage) {
+  errorMessage_ = std::move(errorMessage);
+}
+
+NetlinkBatch::NetlinkBatch(
+    size_t numRequests, std::unordered_set<int> ignoredErrors)
+    : numPending_(numRequests), ignoredErrors_(std::move(ignoredErrors)) {
+  if (numPending_ == 0) {
+    promise_.setValue();
+  }
+}
+
+folly::SemiFuture<folly::Unit>
+NetlinkBatch::getSemiFuture() {
+  return promise_.getSemiFuture();
+}
+
+void
+NetlinkBatch::setReturnStatus(
+    size_t index, int status, std::string const& errorMessage) {
+  CHECK_GT(numPending_, 0);
+  const auto retval = std::abs(status);
+  if (retval != 0 and not ignoredErrors_.count(retval)) {
+    errors_.push_back(RequestError{index, retval, errorMessage});
+  }
+  if (--numPending_ > 0) {
+    return;
+  }
+  if (errors_.empty()) {
+    promise_.setValue();
+    return;
+  }
+  std::sort(errors_.begin(), errors_.end(), [](auto const& a, auto const& b) {
+    return a.index < b.index;
+  });
+  promise_.setException(NlBatchException(std::move(errors_)));
+}
+
+namespace {
+
+std::string
+describeBatchErrors(std::vector<NetlinkBatch::RequestError> const& errors) {
+  auto description = fmt::format(
+      "{} netlink request(s) failed, first at index {}",
+      errors.size(),
+      errors.front().index);
+  if (not errors.front().message.empty()) {
+    description += ": " + errors.front().message;
+  }
+  return description;
+}
+
+} // namespace
+
+NlBatchException::NlBatchException(
+    std::vector<NetlinkBatch::RequestError> errors)
+    : NlException(describeBatchErrors(errors), errors.front().error),
+      errors_(std::move(errors)) {}
+
 folly::Expected<folly::IPAddress, folly::IPAddressFormatError>
 NetlinkMessageBase::parseIp(const struct rtattr* ipAttr, unsigned char family) {
   if (family == AF_INET) {
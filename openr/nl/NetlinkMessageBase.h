@@ -7,8 +7,14 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <queue>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <limits.h>
 #include <linux/lwtunnel.h>
@@ -25,6 +31,98 @@ namespace openr::fbnl {
 
 constexpr uint16_t kMaxNlPayloadSize{4096};
 
+// Maximum number of free message buffers retained by pool
+constexpr size_t kMaxNlPooledBuffers{4096};
+
+/*
+ * Pool of message buffers. Every message type is bounded by
+ * `kMaxNlPayloadSize`, hence all buffers have this size. Message returns its
+ * buffer on destruction, i.e. once request is acked, and the buffer is handed
+ * out to the next message instead of being freed. Up-to `kMaxNlPooledBuffers`
+ * free buffers are retained.
+ *
+ * Pool is thread safe, as messages are usually created in the caller's thread
+ * and destroyed in the netlink event-base.
+ */
+class NetlinkMessagePool {
+ public:
+  using Buffer = std::array<char, kMaxNlPayloadSize>;
+
+  struct Stats {
+    // Buffers retained for re-use
+    size_t numFree{0};
+    // Buffers owned by messages
+    size_t numInUse{0};
+    // Buffers allocated over lifetime of the pool
+    uint64_t numAllocated{0};
+  };
+
+  // Process wide instance
+  static NetlinkMessagePool& getInstance();
+
+  // Get zeroed buffer, re-used one if any
+  std::unique_ptr<Buffer> acquire();
+
+  // Return buffer to pool
+  void release(std::unique_ptr<Buffer> buffer);
+
+  Stats getStats() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Buffer>> freeBuffers_;
+  size_t numInUse_{0};
+  uint64_t numAllocated_{0};
+};
+
+/*
+ * Completion shared by a batch of requests, e.g. of addRoutes(...). Requests
+ * of the batch report their status here instead of through a promise each,
+ * and the batch is fulfilled once all of them did. Statuses are reported in
+ * the netlink event-base, or by the caller before the requests are enqueued.
+ */
+class NetlinkBatch {
+ public:
+  // failed request of a batch
+  struct RequestError {
+    size_t index{0};
+    int error{0};
+    // explanation of the error by kernel, if any
+    std::string message;
+  };
+
+  NetlinkBatch(size_t numRequests, std::unordered_set<int> ignoredErrors);
+
+  // Fulfilled once all requests completed. Throws NlBatchException, with the
+  // error of the first request in the batch failing with an error not
+  // ignored, and the errors of all failed requests.
+  folly::SemiFuture<folly::Unit> getSemiFuture();
+
+  // status of the request at index of the batch
+  void setReturnStatus(
+      size_t index, int status, std::string const& errorMessage = "");
+
+ private:
+  size_t numPending_{0};
+  const std::unordered_set<int> ignoredErrors_;
+  std::vector<RequestError> errors_;
+  folly::Promise<folly::Unit> promise_;
+};
+
+class NlBatchException : public NlException {
+ public:
+  explicit NlBatchException(std::vector<NetlinkBatch::RequestError> errors);
+
+  // failed requests, by index in batch
+  const std::vector<NetlinkBatch::RequestError>&
+  getErrors() const {
+    return errors_;
+  }
+
+ private:
+  std::vector<NetlinkBatch::RequestError> errors_;
+};
+
 /*
  * Data structure representing a netlink message, either to be sent or received.
  * It wraps `struct nlmsghdr` and provides buffer for appending message payload.
@@ -34,7 +132,8 @@ constexpr uint16_t kMaxNlPayloadSize{4096};
  * Aim of the message is to faciliate serialization and deserialization of
  * C++ object (application) to/from bytes (kernel).
  *
- * Maximum size of message is limited by `kMaxNlPayloadSize` parameter.
+ * Maximum size of message is limited by `kMaxNlPayloadSize` parameter. Message
+ * buffer is taken from and returned to `NetlinkMessagePool`.
  */
 /*
  * For netlink reference:
@@ -100,9 +199,6 @@ class NetlinkMessageBase {
   // get current length
   uint32_t getDataLength() const;
 
-  // Buffer to create message
-  std::array<char, kMaxNlPayloadSize> msg = {};
-
   /**
    * APIs for accumulating objects of `GET_<>` request. These APIs are invoked
    * when an object is received from kernel in-response to this netlink-message.
@@ -144,6 +240,18 @@ class NetlinkMessageBase {
    */
   folly::SemiFuture<int> getSemiFuture();
 
+  /**
+   * Report the return status to batch, as request at index of it, instead of
+   * through the future of this message.
+   */
+  void setBatch(std::shared_ptr<NetlinkBatch> batch, size_t index);
+
+  /**
+   * Explanation of the error by kernel, from the extended ack. Set before the
+   * return status.
+   */
+  void setErrorMessage(std::string errorMessage);
+
   /**
    * Set the return value of the netlink request. Invoke this on receipt of the
    * ack. This must be invoked before class is destroyed.
@@ -193,6 +301,9 @@ class NetlinkMessageBase {
   struct rtattr* addSubAttributes(
       struct rtattr* rta, int type, const void* data, uint32_t len) const;
 
+  // Buffer to create message, from NetlinkMessagePool
+  std::unique_ptr<NetlinkMessagePool::Buffer> msg_;
+
   // pointer to the netlink message header
   struct nlmsghdr* msghdr_{nullptr};
 
@@ -201,8 +312,19 @@ class NetlinkMessageBase {
   NetlinkMessageBase(NetlinkMessageBase const&) = delete;
   NetlinkMessageBase& operator=(NetlinkMessageBase const&) = delete;
 
-  // Promise to relay the status code received from kernel
-  folly::Promise<int> promise_;
+  // Promise to relay the status code received from kernel. Only created
+  // once the future is retrieved
+  folly::Promise<int> promise_{folly::Promise<int>::makeEmpty()};
+
+  // Status code, once set
+  std::optional<int> status_;
+
+  // Batch to report the status code to instead, if set
+  std::shared_ptr<NetlinkBatch> batch_;
+  size_t batchIndex_{0};
+
+  // Error explanation from kernel, if any
+  std::string errorMessage_;
 
   // Timestamp when message object was created
   const std::chrono::steady_clock::time_point createTs_{
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/nl/NetlinkNexthopMessage.h>
+
+namespace openr::fbnl {
+
+NetlinkNexthopMessage::NetlinkNexthopMessage() : NetlinkMessageBase() {}
+
+NetlinkNexthopMessage::~NetlinkNexthopMessage() {}
+
+void
+NetlinkNexthopMessage::init(int type, uint8_t family, uint8_t protocolId) {
+  if (type != RTM_NEWNEXTHOP && type != RTM_DELNEXTHOP) {
+    LOG(ERROR) << "Incorrect Netlink message type";
+    return;
+  }
+
+  // initialize netlink header
+  msghdr_->nlmsg_len = NLMSG_LENGTH(sizeof(struct nhmsg));
+  msghdr_->nlmsg_type = type;
+  msghdr_->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+
+  if (type == RTM_NEWNEXTHOP) {
+    // We create new nexthop or replace existing
+    msghdr_->nlmsg_flags |= NLM_F_CREATE;
+    msghdr_->nlmsg_flags |= NLM_F_REPLACE;
+  }
+
+  // intialize the nexthop message header
+  auto nlmsgAlen = NLMSG_ALIGN(sizeof(struct nlmsghdr));
+  nhmsg_ = reinterpret_cast<struct nhmsg*>((char*)msghdr_ + nlmsgAlen);
+  nhmsg_->nh_family = family;
+  nhmsg_->nh_protocol = protocolId;
+}
+
+int
+NetlinkNexthopMessage::addNexthop(
+    uint32_t id, uint8_t protocolId, uint8_t family, const NextHop& nextHop) {
+  if (nextHop.getLabelAction().has_value()) {
+    LOG(ERROR) << "MPLS action is not supported for nexthop object " << id;
+    return EINVAL;
+  }
+
+  const auto gateway = nextHop.getGateway();
+  if (not gateway.has_value() and not nextHop.getIfIndex().has_value()) {
+    LOG(ERROR) << "Gateway or interface is required for nexthop object " << id;
+    return EINVAL;
+  }
+
+  // Family of gateway takes precedence, e.g. IPv6 next-hop of IPv4 route
+  init(
+      RTM_NEWNEXTHOP,
+      gateway.has_value() ? gateway->family() : family,
+      protocolId);
+
+  int status{0};
+  if ((status = addNexthopId(id))) {
+    return status;
+  }
+
+  if (nextHop.getIfIndex().has_value()) {
+    const uint32_t ifIndex = nextHop.getIfIndex().value();
+    if ((status = addAttributes(
+             NHA_OIF,
+             reinterpret_cast<const char*>(&ifIndex),
+             sizeof(uint32_t)))) {
+      return status;
+    }
+  }
+
+  if (gateway.has_value()) {
+    if ((status = addAttributes(
+             NHA_GATEWAY,
+             reinterpret_cast<const char*>(gateway->bytes()),
+             gateway->byteCount()))) {
+      return status;
+    }
+  }
+
+  return 0;
+}
+
+int
+NetlinkNexthopMessage::addNexthopGroup(
+    uint32_t id,
+    uint8_t protocolId,
+    const std::vector<NexthopGroupMember>& members) {
+  if (members.empty()) {
+    LOG(ERROR) << "Empty nexthop group " << id;
+    return EINVAL;
+  }
+
+  // Family must be unspecified for groups
+  init(RTM_NEWNEXTHOP, AF_UNSPEC, protocolId);
+
+  int status{0};
+  if ((status = addNexthopId(id))) {
+    return status;
+  }
+
+  std::vector<struct nexthop_grp> group(members.size());
+  for (size_t i = 0; i < members.size(); ++i) {
+    if (not members[i].weight) {
+      LOG(ERROR) << "Invalid weight 0 for member " << members[i].id
+                 << " of nexthop group " << id;
+      return EINVAL;
+    }
+    group[i].id = members[i].id;
+    group[i].weight = members[i].weight - 1; // Kernel weight is 0 based
+  }
+
+  return addAttributes(
+      NHA_GROUP,
+      reinterpret_cast<const char*>(group.data()),
+      group.size() * sizeof(struct nexthop_grp));
+}
+
+int
+NetlinkNexthopMessage::deleteNexthop(uint32_t id) {
+  init(RTM_DELNEXTHOP, AF_UNSPEC, 0);
+  return addNexthopId(id);
+}
+
+int
+NetlinkNexthopMessage::addNexthopId(uint32_t id) {
+  return addAttributes(
+      NHA_ID, reinterpret_cast<const char*>(&id), sizeof(uint32_t));
+}
+
+} // namespace openr::fbnl
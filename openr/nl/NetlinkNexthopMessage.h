@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <openr/nl/NetlinkMessageBase.h>
+#include <openr/nl/NetlinkTypes.h>
+
+extern "C" {
+#include <linux/nexthop.h>
+#include <linux/rtnetlink.h>
+}
+
+namespace openr::fbnl {
+
+// Member of nexthop group, referring to nexthop object by ID
+struct NexthopGroupMember {
+  uint32_t id{0};
+  // Weight of member in group, starting from 1
+  uint8_t weight{1};
+};
+
+/**
+ * Message specialization for rtnetlink NEXTHOP type (Linux 5.3+)
+ *
+ * For reference: https://man7.org/linux/man-pages/man8/ip-nexthop.8.html
+ *
+ * RTM_NEWNEXTHOP, RTM_DELNEXTHOP
+ *    Create or replace, remove a nexthop object identified with ID. Object
+ *    is either a single next-hop, or a group of next-hop objects with
+ *    weights. Routes refer to nexthop object with RTA_NH_ID instead of
+ *    carrying their next-hops inline. Replacing a nexthop object updates all
+ *    routes referring to it at once.
+ *
+ *    struct nhmsg {
+ *        unsigned char nh_family;
+ *        unsigned char nh_scope;     // return only
+ *        unsigned char nh_protocol;  // Routing protocol that installed nh
+ *        unsigned char resvd;
+ *        unsigned int  nh_flags;     // RTNH_F flags
+ *    };
+ */
+class NetlinkNexthopMessage final : public NetlinkMessageBase {
+ public:
+  NetlinkNexthopMessage();
+
+  ~NetlinkNexthopMessage() override;
+
+  // initiallize nexthop message with default params
+  void init(int type, uint8_t family, uint8_t protocolId);
+
+  // add or replace nexthop object for single next-hop. Next-hop weight is
+  // ignored, it is property of group membership. MPLS actions are not
+  // supported.
+  int addNexthop(
+      uint32_t id, uint8_t protocolId, uint8_t family, const NextHop& nextHop);
+
+  // add or replace nexthop group object
+  int addNexthopGroup(
+      uint32_t id,
+      uint8_t protocolId,
+      const std::vector<NexthopGroupMember>& members);
+
+  // delete nexthop object, single next-hop or group
+  int deleteNexthop(uint32_t id);
+
+ private:
+  // add NHA_ID attribute
+  int addNexthopId(uint32_t id);
+
+  // pointer to nexthop message header
+  struct nhmsg* nhmsg_{nullptr};
+};
+
+} // namespace openr::fbnl
@@ -9,6 +9,7 @@
 
 #include <fb303/ServiceData.h>
 
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
 
@@ -17,14 +18,104 @@ namespace fb303 = facebook::fb303;
 
 namespace openr::fbnl {
 
+namespace {
+
+// Counters bumped for every netlink message sent or received
+StatCounter errorsCounter{"netlink.errors", fb303::SUM};
+StatCounter requestsCounter{"netlink.requests", fb303::SUM};
+StatCounter requestErrorsCounter{"netlink.requests.error", fb303::SUM};
+StatCounter requestSuccessesCounter{"netlink.requests.success", fb303::SUM};
+StatCounter requestLatencyCounter{"netlink.requests.latency_ms", fb303::AVG};
+StatCounter bytesTxCounter{"netlink.bytes.tx", fb303::SUM};
+StatCounter bytesRxCounter{"netlink.bytes.rx", fb303::SUM};
+StatCounter routeNotificationsCounter{
+    "netlink.notifications.route", fb303::SUM};
+StatCounter linkNotificationsCounter{"netlink.notifications.link", fb303::SUM};
+StatCounter addrNotificationsCounter{"netlink.notifications.addr", fb303::SUM};
+StatCounter neighborNotificationsCounter{
+    "netlink.notifications.neighbor", fb303::SUM};
+StatCounter ruleNotificationsCounter{"netlink.notifications.rule", fb303::SUM};
+StatCounter recvOverrunCounter{"netlink.recv.overrun", fb303::SUM};
+
+// Filter for IPv4 routes of protocol in default routing table
+fbnl::Route
+createIPv4RouteFilter(uint8_t protocolId) {
+  fbnl::RouteBuilder builder;
+  // Set address family to MPLS with default v4 route
+  builder.setDestination({folly::IPAddressV4("0.0.0.0"), 0});
+  // Set protocol ID
+  builder.setProtocolId(protocolId);
+  builder.setType(RTN_UNSPEC); // Explicitly set type to 0
+  return builder.build();
+}
+
+// Filter for IPv6 routes of protocol in default routing table
+fbnl::Route
+createIPv6RouteFilter(uint8_t protocolId) {
+  fbnl::RouteBuilder builder;
+  // Set address family to MPLS with default v6 route
+  builder.setDestination({folly::IPAddressV6("::"), 0});
+  // Set protocol ID
+  builder.setProtocolId(protocolId);
+  builder.setType(RTN_UNSPEC); // Explicitly set type to 0
+  return builder.build();
+}
+
+// Filter for MPLS routes of protocol
+fbnl::Route
+createMplsRouteFilter(uint8_t protocolId) {
+  fbnl::RouteBuilder builder;
+  // Set address family to MPLS with default label
+  builder.setMplsLabel(0);
+  // Set protocol ID
+  builder.setProtocolId(protocolId);
+  return builder.build();
+}
+
+// Explanation of the error of an extended ack, e.g. which attribute of a
+// route kernel rejected. Empty if kernel gave none
+std::string
+parseExtAckMessage(const struct nlmsghdr* nlh) {
+  if (not(nlh->nlmsg_flags & NLM_F_ACK_TLVS)) {
+    return "";
+  }
+  // attributes follow the error, and the failed request unless it is capped
+  const auto* ack = reinterpret_cast<const struct nlmsgerr*>(NLMSG_DATA(nlh));
+  size_t offset = sizeof(struct nlmsgerr);
+  if (not(nlh->nlmsg_flags & NLM_F_CAPPED)) {
+    offset += ack->msg.nlmsg_len - NLMSG_HDRLEN;
+  }
+  const char* attrs =
+      reinterpret_cast<const char*>(NLMSG_DATA(nlh)) + NLMSG_ALIGN(offset);
+  const char* end = reinterpret_cast<const char*>(nlh) + nlh->nlmsg_len;
+  while (attrs + NLA_HDRLEN <= end) {
+    const auto* attr = reinterpret_cast<const struct nlattr*>(attrs);
+    if (attr->nla_len < NLA_HDRLEN or attrs + attr->nla_len > end) {
+      break;
+    }
+    if ((attr->nla_type & NLA_TYPE_MASK) == NLMSGERR_ATTR_MSG) {
+      const char* msg = attrs + NLA_HDRLEN;
+      return std::string(msg, ::strnlen(msg, attr->nla_len - NLA_HDRLEN));
+    }
+    attrs += NLA_ALIGN(attr->nla_len);
+  }
+  return "";
+}
+
+} // namespace
+
 NetlinkProtocolSocket::NetlinkProtocolSocket(
     folly::EventBase* evb,
     messaging::ReplicateQueue<NetlinkEvent>& netlinkEventsQ,
-    bool enableIPv6RouteReplaceSemantics)
+    bool enableIPv6RouteReplaceSemantics,
+    uint32_t eventGroups)
     : EventHandler(evb),
       evb_(evb),
       netlinkEventsQueue_(netlinkEventsQ),
-      enableIPv6RouteReplaceSemantics_(enableIPv6RouteReplaceSemantics) {
+      enableIPv6RouteReplaceSemantics_(enableIPv6RouteReplaceSemantics),
+      eventGroups_(eventGroups) {
+  CHECK_EQ(eventGroups_ & ~kNetlinkAllEvents, 0)
+      << "Unsupported netlink multicast groups " << eventGroups_;
   CHECK_NOTNULL(evb_);
 
   nlMessageTimer_ = folly::AsyncTimeout::make(*evb_, [this]() noexcept {
@@ -36,7 +127,7 @@ NetlinkProtocolSocket::NetlinkProtocolSocket(
 
     LOG(ERROR) << "Timed-out receiving ack for " << nlSeqNumMap_.size()
                << " message(s).";
-    fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+    errorsCounter.add();
     for (auto& kv : nlSeqNumMap_) {
       LOG(ERROR) << "  Pending seq=" << kv.first << ", message-type="
                  << static_cast<int>(kv.second->getMessageType())
@@ -61,12 +152,13 @@ NetlinkProtocolSocket::NetlinkProtocolSocket(
       folly::NotificationQueue<std::unique_ptr<NetlinkMessageBase>>::Consumer::
           make([this](std::unique_ptr<NetlinkMessageBase>&& nlmsg) noexcept {
             msgQueue_.push(std::move(nlmsg));
-            // Invoke send messages API if socket is initialized and no in
-            // flight messages
-            if (nlSock_ >= 0 && !nlMessageTimer_->isScheduled()) {
-              sendNetlinkMessage();
+            // Send messages once all enqueued ones are consumed in this loop
+            // iteration, so that messages enqueued together are sent together
+            if (not isLoopCallbackScheduled()) {
+              evb_->runInLoop(this);
             }
           });
+  notifConsumer_->setMaxReadAtOnce(kMaxInflightMsg);
 
   // Initialize the socket in an event loop
   nlInitTimer_ = folly::AsyncTimeout::schedule(
@@ -108,11 +200,31 @@ NetlinkProtocolSocket::init() {
   if (nlSock_ < 0) {
     LOG(FATAL) << "Netlink socket create failed.";
   }
+  // increase socket recv and send buffer size. Try beyond the system limits
+  // first, which requires CAP_NET_ADMIN
   int size = kNetlinkSockRecvBuf;
-  // increase socket recv buffer size
-  if (setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+  if (setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) <
+          0 and
+      setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
     LOG(FATAL) << "Netlink socket set recv buffer failed.";
   };
+  size = kNetlinkSockSendBuf;
+  if (setsockopt(nlSock_, SOL_SOCKET, SO_SNDBUFFORCE, &size, sizeof(size)) <
+          0 and
+      setsockopt(nlSock_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0) {
+    LOG(FATAL) << "Netlink socket set send buffer failed.";
+  };
+
+  // Have kernel explain errors in extended acks, which don't echo the failed
+  // request. Not supported before Linux 4.12, errors are reported without
+  // explanation then
+  const int enable = 1;
+  for (int option : {NETLINK_EXT_ACK, NETLINK_CAP_ACK}) {
+    if (setsockopt(nlSock_, SOL_NETLINK, option, &enable, sizeof(enable)) < 0) {
+      LOG(WARNING) << "Failed to set netlink socket option " << option << ": "
+                   << folly::errnoStr(errno);
+    }
+  }
 
   // Bind on the source address. We let kernel chose the available port-ID
   struct sockaddr_nl saddr;
@@ -120,11 +232,9 @@ NetlinkProtocolSocket::init() {
   saddr.nl_family = AF_NETLINK;
   saddr.nl_pid = 0; // We let kernel assign the port-ID
   /* We can subscribe to different Netlink mutlicast groups for specific types
-   * of events: link, IPv4/IPv6 address and neighbor. */
-  saddr.nl_groups = RTMGRP_LINK // listen for link events
-      | RTMGRP_IPV4_IFADDR // listen for IPv4 address events
-      | RTMGRP_IPV6_IFADDR // listen for IPv6 address events
-      | RTMGRP_NEIGH; // listen for Neighbor (ARP) events
+   * of events: link, IPv4/IPv6 address and neighbor. Only the groups of
+   * interest to the events queue readers are subscribed. */
+  saddr.nl_groups = eventGroups_;
 
   if (bind(nlSock_, (struct sockaddr*)&saddr, sizeof(saddr)) != 0) {
     LOG(FATAL) << "Failed to bind netlink socket: " << folly::errnoStr(errno);
@@ -153,17 +263,21 @@ NetlinkProtocolSocket::handlerReady(uint16_t events) noexcept {
     recvNetlinkMessage();
   } catch (std::exception const& e) {
     LOG(ERROR) << "Error processing netlink message" << folly::exceptionStr(e);
-    fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+    errorsCounter.add();
   }
 }
 
 void
-NetlinkProtocolSocket::processAck(uint32_t ack, int status) {
+NetlinkProtocolSocket::processAck(
+    uint32_t ack, int status, std::string const& errorMessage) {
   VLOG(2) << "Completed netlink request. seq=" << ack << ", retval=" << status;
+  LOG_IF(WARNING, not errorMessage.empty())
+      << "Netlink request failed. seq=" << ack << ", retval=" << status
+      << ", error: " << errorMessage;
   if (std::abs(status) != EEXIST && std::abs(status) != ESRCH && status != 0) {
-    fbData->addStatValue("netlink.requests.error", 1, fb303::SUM);
+    requestErrorsCounter.add();
   } else {
-    fbData->addStatValue("netlink.requests.success", 1, fb303::SUM);
+    requestSuccessesCounter.add();
   }
 
   auto it = nlSeqNumMap_.find(ack);
@@ -171,48 +285,97 @@ NetlinkProtocolSocket::processAck(uint32_t ack, int status) {
     // Calculate and add the latency of the request in fb303
     auto requestLatency = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - it->second->getCreateTs());
-    fbData->addStatValue(
-        "netlink.requests.latency_ms", requestLatency.count(), fb303::AVG);
+    requestLatencyCounter.add(requestLatency.count());
 
     // Set return status on promise
+    if (not errorMessage.empty()) {
+      it->second->setErrorMessage(errorMessage);
+    }
     it->second->setReturnStatus(status);
     nlSeqNumMap_.erase(it);
   } else {
     LOG(ERROR) << "Broken promise for netlink request. seq=" << ack;
-    fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+    errorsCounter.add();
   }
 
   // Cancel timer if there are no more expected responses
   if (nlSeqNumMap_.empty()) {
     nlMessageTimer_->cancelTimeout();
+    updateMessagePoolCounters();
   } else {
     // Extend timer and wait for next ack
     nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
   }
 
+  // Kernel keeps up with a full window of messages, allow more in flight
+  if (++numAcksInWindow_ >= maxInflightMsgs_) {
+    setMaxInflightMsgs(std::min(2 * maxInflightMsgs_, kMaxInflightMsg));
+  }
+
   // We've successfully completed at-least one message. Send more messages
   // if any pending. Here we add optimization to wait for some more acks and
   // send pending message in batch of atleast `kMinIovMsg`
-  if (nlSeqNumMap_.empty() or (kMaxIovMsg - nlSeqNumMap_.size() > kMinIovMsg)) {
+  if (canSendNetlinkMessage()) {
+    sendNetlinkMessage();
+  }
+}
+
+void
+NetlinkProtocolSocket::runLoopCallback() noexcept {
+  // Send if socket is initialized and enough of the window is free
+  if (nlSock_ >= 0 and canSendNetlinkMessage()) {
     sendNetlinkMessage();
   }
 }
 
+bool
+NetlinkProtocolSocket::canSendNetlinkMessage() const {
+  return nlSeqNumMap_.empty() or
+      (nlSeqNumMap_.size() < maxInflightMsgs_ and
+       maxInflightMsgs_ - nlSeqNumMap_.size() >= kMinIovMsg);
+}
+
+void
+NetlinkProtocolSocket::setMaxInflightMsgs(size_t maxInflightMsgs) {
+  maxInflightMsgs_ = maxInflightMsgs;
+  numAcksInWindow_ = 0;
+  fbData->setCounter("netlink.requests.inflight_window", maxInflightMsgs_);
+}
+
+void
+NetlinkProtocolSocket::updateMessagePoolCounters() {
+  const auto stats = NetlinkMessagePool::getInstance().getStats();
+  fbData->setCounter("netlink.message_pool.free", stats.numFree);
+  fbData->setCounter("netlink.message_pool.in_use", stats.numInUse);
+  fbData->setCounter("netlink.message_pool.allocated", stats.numAllocated);
+}
+
 void
 NetlinkProtocolSocket::sendNetlinkMessage() {
   CHECK(evb_->isInEventBaseThread());
-  struct sockaddr_nl nladdr = {
-      .nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
-  CHECK_LE(nlSeqNumMap_.size(), kMaxIovMsg)
-      << "We must have capacity to send at-least one message!";
-  uint32_t count{0};
-  const uint32_t iovSize =
-      std::min(msgQueue_.size(), kMaxIovMsg - nlSeqNumMap_.size());
-
-  if (!iovSize) {
+  // Window may have shrunk below number of in-flight messages
+  if (nlSeqNumMap_.size() >= maxInflightMsgs_ or msgQueue_.empty()) {
     return;
   }
 
+  // Send batches of up to `kMaxIovMsg` messages until window is full
+  while (nlSeqNumMap_.size() < maxInflightMsgs_ and not msgQueue_.empty()) {
+    sendNetlinkMessageBatch(std::min(
+        {msgQueue_.size(),
+         kMaxIovMsg,
+         maxInflightMsgs_ - nlSeqNumMap_.size()}));
+  }
+
+  // Schedule timer to wait for acks and send next set of messages
+  nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+  updateMessagePoolCounters();
+}
+
+void
+NetlinkProtocolSocket::sendNetlinkMessageBatch(uint32_t iovSize) {
+  struct sockaddr_nl nladdr = {
+      .nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
+  uint32_t count{0};
   auto iov = std::make_unique<struct iovec[]>(iovSize);
 
   while (count < iovSize && !msgQueue_.empty()) {
@@ -234,7 +397,7 @@ NetlinkProtocolSocket::sendNetlinkMessage() {
     // check if one request per message
     if ((nlmsg_hdr->nlmsg_flags & NLM_F_MULTI) != 0) {
       LOG(ERROR) << "Error: multipart netlink message not supported";
-      fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+      errorsCounter.add();
     }
 
     // Add seq number -> netlink request mapping
@@ -261,16 +424,13 @@ NetlinkProtocolSocket::sendNetlinkMessage() {
     LOG(ERROR) << "Error sending on netlink socket. Error: "
                << folly::errnoStr(std::abs(errno)) << ", errno=" << errno
                << ", fd=" << nlSock_ << ", num-messages=" << outMsg->msg_iovlen;
-    fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+    errorsCounter.add();
   } else {
-    fbData->addStatValue("netlink.bytes.tx", bytesSent, fb303::SUM);
+    bytesTxCounter.add(bytesSent);
   }
-  fbData->addStatValue("netlink.requests", outMsg->msg_iovlen, fb303::SUM);
+  requestsCounter.add(outMsg->msg_iovlen);
   VLOG(2) << "Sent " << outMsg->msg_iovlen << " netlink requests on fd "
           << nlSock_;
-
-  // Schedule timer to wait for acks and send next set of messages
-  nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
 }
 
 void
@@ -300,7 +460,7 @@ NetlinkProtocolSocket::processMessage(
         nlSeqIt->second->rcvdRoute(std::move(route));
       } else {
         // Route notification
-        fbData->addStatValue("netlink.notifications.route", 1, fb303::SUM);
+        routeNotificationsCounter.add();
         DCHECK(false) << "Route notifications are not subscribed";
       }
     } break;
@@ -318,7 +478,7 @@ NetlinkProtocolSocket::processMessage(
       } else {
         // Link notification
         VLOG(1) << "Link event. " << link.str();
-        fbData->addStatValue("netlink.notifications.link", 1, fb303::SUM);
+        linkNotificationsCounter.add();
         netlinkEventsQueue_.push(link);
       }
     } break;
@@ -352,7 +512,7 @@ NetlinkProtocolSocket::processMessage(
       if (isNotification) {
         // IfAddress notification
         VLOG(1) << "Address event. " << addr.str();
-        fbData->addStatValue("netlink.notifications.addr", 1, fb303::SUM);
+        addrNotificationsCounter.add();
         netlinkEventsQueue_.push(addr);
       }
     } break;
@@ -370,7 +530,7 @@ NetlinkProtocolSocket::processMessage(
       } else {
         // Neighbor notification
         VLOG(2) << "Neighbor event. " << neighbor.str();
-        fbData->addStatValue("netlink.notifications.neighbor", 1, fb303::SUM);
+        neighborNotificationsCounter.add();
         netlinkEventsQueue_.push(neighbor);
       }
     } break;
@@ -388,7 +548,7 @@ NetlinkProtocolSocket::processMessage(
       } else {
         // Rule notification
         VLOG(2) << "Rule event. " << rule.str();
-        fbData->addStatValue("netlink.notifications.rule", 1, fb303::SUM);
+        ruleNotificationsCounter.add();
         netlinkEventsQueue_.push(rule);
       }
     } break;
@@ -399,10 +559,10 @@ NetlinkProtocolSocket::processMessage(
       if (ack->msg.nlmsg_pid != portId_) {
         LOG(ERROR) << "received netlink message with wrong PID, received: "
                    << ack->msg.nlmsg_pid << " expected: " << portId_;
-        fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+        errorsCounter.add();
         break;
       }
-      processAck(ack->msg.nlmsg_seq, ack->error);
+      processAck(ack->msg.nlmsg_seq, ack->error, parseExtAckMessage(nlh));
     } break;
 
     case NLMSG_NOOP:
@@ -416,31 +576,54 @@ NetlinkProtocolSocket::processMessage(
 
     default:
       LOG(ERROR) << "Unknown message type: " << nlh->nlmsg_type;
-      fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+      errorsCounter.add();
     }
   } while ((nlh = NLMSG_NEXT(nlh, bytesRead)));
 }
 
 void
 NetlinkProtocolSocket::recvNetlinkMessage() {
-  // messages buffer
-  std::array<char, kMaxNlPayloadSize> recvMsg = {};
+  std::array<struct iovec, kMaxRecvBatch> iovs;
+  std::array<struct mmsghdr, kMaxRecvBatch> msgs;
+  for (size_t i = 0; i < kMaxRecvBatch; ++i) {
+    iovs[i].iov_base = recvBufs_[i].data();
+    iovs[i].iov_len = kMaxNlPayloadSize;
+    msgs[i] = {};
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
 
-  int32_t bytesRead = ::recv(nlSock_, recvMsg.data(), kMaxNlPayloadSize, 0);
-  VLOG(4) << "Message received with size: " << bytesRead;
+  // Socket is readable, don't block for the rest of the batch
+  int numMsgs =
+      ::recvmmsg(nlSock_, msgs.data(), kMaxRecvBatch, MSG_DONTWAIT, nullptr);
+  VLOG(4) << "Messages received: " << numMsgs;
 
-  if (bytesRead < 0) {
+  if (numMsgs < 0) {
     if (errno == EINTR || errno == EAGAIN) {
       return;
     }
-    LOG(ERROR) << "Error in netlink socket receive: " << bytesRead
+    if (errno == ENOBUFS) {
+      // Receive buffer overran and messages were dropped. Acks of pending
+      // requests may be lost, they'll time out. Allow fewer in flight.
+      LOG(WARNING) << "Netlink socket receive buffer overrun, reducing "
+                   << "in-flight window from " << maxInflightMsgs_;
+      recvOverrunCounter.add();
+      setMaxInflightMsgs(std::max(maxInflightMsgs_ / 2, kMaxIovMsg));
+      if (eventGroups_) {
+        // Notifications may have been dropped as well
+        netlinkEventsQueue_.push(EventsLost{});
+      }
+      return;
+    }
+    LOG(ERROR) << "Error in netlink socket receive: " << numMsgs
                << " err: " << folly::errnoStr(std::abs(errno));
-    fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+    errorsCounter.add();
     return;
-  } else {
-    fbData->addStatValue("netlink.bytes.rx", bytesRead, fb303::SUM);
   }
-  processMessage(recvMsg, static_cast<uint32_t>(bytesRead));
+  for (int i = 0; i < numMsgs; ++i) {
+    bytesRxCounter.add(msgs[i].msg_len);
+    processMessage(recvBufs_[i], msgs[i].msg_len);
+  }
 }
 
 folly::SemiFuture<folly::Unit>
@@ -461,35 +644,43 @@ NetlinkProtocolSocket::collectReturnStatus(
       });
 }
 
-folly::SemiFuture<int>
-NetlinkProtocolSocket::addRoute(const openr::fbnl::Route& route) {
-  VLOG(1) << "Netlink add route. " << route.str();
-  auto rtmMsg = std::make_unique<NetlinkRouteMessage>();
-  auto future = rtmMsg->getSemiFuture();
-
+int
+NetlinkProtocolSocket::encodeRouteMessage(
+    NetlinkRouteMessage& rtmMsg, const fbnl::Route& route, bool isAdd) {
   int status{0};
   switch (route.getFamily()) {
-  case AF_INET6:
-    if (not enableIPv6RouteReplaceSemantics_) {
-      // Special case for IPv6 route add. We first delete the route and then
-      // add it.
-      // NOTE: We ignore the error for the deleteRoute
-      deleteRoute(route);
-    }
-    FOLLY_FALLTHROUGH;
   case AF_INET:
-    status = rtmMsg->addRoute(route);
+  case AF_INET6:
+    status = isAdd ? rtmMsg.addRoute(route) : rtmMsg.deleteRoute(route);
     break;
   case AF_MPLS:
-    status = rtmMsg->addLabelRoute(route);
+    status =
+        isAdd ? rtmMsg.addLabelRoute(route) : rtmMsg.deleteLabelRoute(route);
     break;
   default:
     status = -EPROTONOSUPPORT;
   }
 
   if (status != 0) {
-    rtmMsg->setReturnStatus(status);
-  } else {
+    rtmMsg.setReturnStatus(status);
+  }
+  return status;
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::addRoute(const openr::fbnl::Route& route) {
+  VLOG(1) << "Netlink add route. " << route.str();
+  if (route.getFamily() == AF_INET6 and
+      not enableIPv6RouteReplaceSemantics_) {
+    // Special case for IPv6 route add. We first delete the route and then
+    // add it.
+    // NOTE: We ignore the error for the deleteRoute
+    deleteRoute(route);
+  }
+
+  auto rtmMsg = std::make_unique<NetlinkRouteMessage>();
+  auto future = rtmMsg->getSemiFuture();
+  if (encodeRouteMessage(*rtmMsg, route, true /* isAdd */) == 0) {
     notifQueue_.putMessage(std::move(rtmMsg));
   }
 
@@ -501,26 +692,122 @@ NetlinkProtocolSocket::deleteRoute(const openr::fbnl::Route& route) {
   VLOG(1) << "Netlink delete route. " << route.str();
   auto rtmMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
   auto future = rtmMsg->getSemiFuture();
+  if (encodeRouteMessage(*rtmMsg, route, false /* isAdd */) == 0) {
+    notifQueue_.putMessage(std::move(rtmMsg));
+  }
 
-  int status{0};
-  switch (route.getFamily()) {
-  case AF_INET:
-  case AF_INET6:
-    status = rtmMsg->deleteRoute(route);
-    break;
-  case AF_MPLS:
-    status = rtmMsg->deleteLabelRoute(route);
-    break;
-  default:
-    status = -EPROTONOSUPPORT;
+  return future;
+}
+
+folly::SemiFuture<folly::Unit>
+NetlinkProtocolSocket::addRoutes(
+    const std::vector<openr::fbnl::Route>& routes,
+    std::unordered_set<int> ignoredErrors) {
+  VLOG(1) << "Netlink add " << routes.size() << " routes";
+  // one completion for all routes, instead of a future per route
+  auto batch =
+      std::make_shared<NetlinkBatch>(routes.size(), std::move(ignoredErrors));
+  auto future = batch->getSemiFuture();
+  std::vector<std::unique_ptr<NetlinkMessageBase>> msgs;
+  msgs.reserve(routes.size());
+  for (size_t i = 0; i < routes.size(); ++i) {
+    const auto& route = routes[i];
+    VLOG(2) << "Netlink add route. " << route.str();
+    if (route.getFamily() == AF_INET6 and
+        not enableIPv6RouteReplaceSemantics_) {
+      // Delete IPv6 route first, see addRoute(...). Error is ignored.
+      auto delMsg = std::make_unique<NetlinkRouteMessage>();
+      if (encodeRouteMessage(*delMsg, route, false /* isAdd */) == 0) {
+        msgs.emplace_back(std::move(delMsg));
+      }
+    }
+
+    auto rtmMsg = std::make_unique<NetlinkRouteMessage>();
+    rtmMsg->setBatch(batch, i);
+    if (encodeRouteMessage(*rtmMsg, route, true /* isAdd */) == 0) {
+      msgs.emplace_back(std::move(rtmMsg));
+    }
+  }
+  notifQueue_.putMessages(
+      std::make_move_iterator(msgs.begin()),
+      std::make_move_iterator(msgs.end()));
+
+  return future;
+}
+
+folly::SemiFuture<folly::Unit>
+NetlinkProtocolSocket::deleteRoutes(
+    const std::vector<openr::fbnl::Route>& routes,
+    std::unordered_set<int> ignoredErrors) {
+  VLOG(1) << "Netlink delete " << routes.size() << " routes";
+  auto batch =
+      std::make_shared<NetlinkBatch>(routes.size(), std::move(ignoredErrors));
+  auto future = batch->getSemiFuture();
+  std::vector<std::unique_ptr<NetlinkMessageBase>> msgs;
+  msgs.reserve(routes.size());
+  for (size_t i = 0; i < routes.size(); ++i) {
+    const auto& route = routes[i];
+    VLOG(2) << "Netlink delete route. " << route.str();
+    auto rtmMsg = std::make_unique<NetlinkRouteMessage>();
+    rtmMsg->setBatch(batch, i);
+    if (encodeRouteMessage(*rtmMsg, route, false /* isAdd */) == 0) {
+      msgs.emplace_back(std::move(rtmMsg));
+    }
   }
+  notifQueue_.putMessages(
+      std::make_move_iterator(msgs.begin()),
+      std::make_move_iterator(msgs.end()));
 
+  return future;
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::addNexthop(
+    uint32_t id,
+    uint8_t protocolId,
+    uint8_t family,
+    const openr::fbnl::NextHop& nextHop) {
+  VLOG(1) << "Netlink add nexthop " << id << ". " << nextHop.str();
+  auto nhMsg = std::make_unique<NetlinkNexthopMessage>();
+  auto future = nhMsg->getSemiFuture();
+  int status = nhMsg->addNexthop(id, protocolId, family, nextHop);
   if (status != 0) {
-    rtmMsg->setReturnStatus(status);
+    nhMsg->setReturnStatus(status);
   } else {
-    notifQueue_.putMessage(std::move(rtmMsg));
+    notifQueue_.putMessage(std::move(nhMsg));
+  }
+  return future;
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::addNexthopGroup(
+    uint32_t id,
+    uint8_t protocolId,
+    const std::vector<openr::fbnl::NexthopGroupMember>& members) {
+  VLOG(1) << "Netlink add nexthop group " << id << " with " << members.size()
+          << " members";
+  auto nhMsg = std::make_unique<NetlinkNexthopMessage>();
+  auto future = nhMsg->getSemiFuture();
+  int status = nhMsg->addNexthopGroup(id, protocolId, members);
+  if (status != 0) {
+    nhMsg->setReturnStatus(status);
+  } else {
+    notifQueue_.putMessage(std::move(nhMsg));
   }
+  return future;
+}
 
+folly::SemiFuture<int>
+NetlinkProtocolSocket::deleteNexthop(uint32_t id) {
+  VLOG(1) << "Netlink delete nexthop " << id;
+  auto nhMsg = std::make_unique<NetlinkNexthopMessage>();
+  auto future = nhMsg->getSemiFuture();
+  int status = nhMsg->deleteNexthop(id);
+  if (status != 0) {
+    nhMsg->setReturnStatus(status);
+  } else {
+    notifQueue_.putMessage(std::move(nhMsg));
+  }
   return future;
 }
 
@@ -697,34 +984,50 @@ NetlinkProtocolSocket::getAllRoutes() {
 
 folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>>
 NetlinkProtocolSocket::getIPv4Routes(uint8_t protocolId) {
-  fbnl::RouteBuilder builder;
-  // Set address family to MPLS with default v4 route
-  builder.setDestination({folly::IPAddressV4("0.0.0.0"), 0});
-  // Set protocol ID
-  builder.setProtocolId(protocolId);
-  builder.setType(RTN_UNSPEC); // Explicitly set type to 0
-  return getRoutes(builder.build());
+  return getRoutes(createIPv4RouteFilter(protocolId));
 }
 
 folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>>
 NetlinkProtocolSocket::getIPv6Routes(uint8_t protocolId) {
-  fbnl::RouteBuilder builder;
-  // Set address family to MPLS with default v6 route
-  builder.setDestination({folly::IPAddressV6("::"), 0});
-  // Set protocol ID
-  builder.setProtocolId(protocolId);
-  builder.setType(RTN_UNSPEC); // Explicitly set type to 0
-  return getRoutes(builder.build());
+  return getRoutes(createIPv6RouteFilter(protocolId));
 }
 
 folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>>
 NetlinkProtocolSocket::getMplsRoutes(uint8_t protocolId) {
-  fbnl::RouteBuilder builder;
-  // Set address family to MPLS with default label
-  builder.setMplsLabel(0);
-  // Set protocol ID
-  builder.setProtocolId(protocolId);
-  return getRoutes(builder.build());
+  return getRoutes(createMplsRouteFilter(protocolId));
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::streamRoutes(
+    const fbnl::Route& filter, RouteCallback callback) {
+  VLOG(1) << "Netlink stream routes with filter. " << filter.str();
+  auto routeMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+  routeMsg->setRouteCallback(std::move(callback));
+  auto future = routeMsg->getSemiFuture();
+
+  // Initialize message fields to get all routes matching filter
+  routeMsg->initGet(0, filter);
+  notifQueue_.putMessage(std::move(routeMsg));
+
+  return future;
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::streamIPv4Routes(
+    uint8_t protocolId, RouteCallback callback) {
+  return streamRoutes(createIPv4RouteFilter(protocolId), std::move(callback));
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::streamIPv6Routes(
+    uint8_t protocolId, RouteCallback callback) {
+  return streamRoutes(createIPv6RouteFilter(protocolId), std::move(callback));
+}
+
+folly::SemiFuture<int>
+NetlinkProtocolSocket::streamMplsRoutes(
+    uint8_t protocolId, RouteCallback callback) {
+  return streamRoutes(createMplsRouteFilter(protocolId), std::move(callback));
 }
 
 } // namespace openr::fbnl
@@ -19,30 +19,58 @@
 #include <openr/nl/NetlinkLinkMessage.h>
 #include <openr/nl/NetlinkMessageBase.h>
 #include <openr/nl/NetlinkNeighborMessage.h>
+#include <openr/nl/NetlinkNexthopMessage.h>
 #include <openr/nl/NetlinkRouteMessage.h>
 #include <openr/nl/NetlinkRuleMessage.h>
 #include <openr/nl/NetlinkTypes.h>
 
 namespace openr::fbnl {
 
-// Netlink event as union of LINK/ADDR/NEIGH/RULE event
-using NetlinkEvent =
-    std::variant<fbnl::Link, fbnl::IfAddress, fbnl::Neighbor, fbnl::Rule>;
-
-// Receive socket buffer for netlink socket
-constexpr uint32_t kNetlinkSockRecvBuf{1 * 1024 * 1024};
+// Published when the receive buffer overran and notifications were dropped.
+// State built from the event stream must be re-synced with a full dump.
+struct EventsLost {};
 
-// Maximum number of in-flight messages. `kMinIovMsg` indicates the soft
-// requirement for sending bufferred messages.
+// Netlink event as union of LINK/ADDR/NEIGH/RULE event
+using NetlinkEvent = std::variant<
+    fbnl::Link,
+    fbnl::IfAddress,
+    fbnl::Neighbor,
+    fbnl::Rule,
+    fbnl::EventsLost>;
+
+// Receive and send socket buffers for netlink socket. Receive buffer must be
+// large enough to hold acks of all in-flight messages.
+constexpr uint32_t kNetlinkSockRecvBuf{8 * 1024 * 1024};
+constexpr uint32_t kNetlinkSockSendBuf{8 * 1024 * 1024};
+
+// Maximum number of messages sent with one `sendmsg`. `kMinIovMsg` indicates
+// the soft requirement for sending bufferred messages.
 constexpr size_t kMaxIovMsg{500};
 constexpr size_t kMinIovMsg{200};
 
+// Maximum number of in-flight messages. The in-flight window starts at
+// `kMaxIovMsg`, doubles after every window of acks received, and halves when
+// the receive buffer overruns, never below `kMaxIovMsg`.
+constexpr size_t kMaxInflightMsg{4000};
+
 // Timeout for an ack from kernel for netlink messages we sent. The response for
 // big request (e.g. adding 5k routes or getting 10k routes) is sent back in
 // multiple parts. If we don't receive any part of below specified timeout, we
 // assume kernel is not responsive.
 constexpr std::chrono::milliseconds kNlRequestAckTimeout{1000};
 
+// Maximum number of netlink messages received with one `recvmmsg`. Replies of
+// bulk requests and bursts of events are drained with few syscalls.
+constexpr size_t kMaxRecvBatch{32};
+
+// Multicast groups of kernel events published through the events queue.
+// Kernel only delivers events of the subscribed groups, the others are never
+// received nor parsed. Route events are never subscribed, routes of other
+// daemons can churn a lot and Open/R doesn't react to them.
+constexpr uint32_t kNetlinkLinkAddrEvents{
+    RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR};
+constexpr uint32_t kNetlinkAllEvents{kNetlinkLinkAddrEvents | RTMGRP_NEIGH};
+
 /**
  * C++ async interface for netlink APIs. It supports minimal functionality that
  * Open/R needs but can be easily extended to support any netlink message
@@ -66,9 +94,12 @@ constexpr std::chrono::milliseconds kNlRequestAckTimeout{1000};
  * Above threading model allows multiple requests to be sent in parallel and
  * process their response asynchronously. Outstanding requests to kernel is
  * rate-limited to not overwhelm the socket buffers. Rate-limiting of requests
- * is governed by params kMaxIovMsg and kMinIovMsg. This allows adding 100k
- * routes in under 2 seconds. These performance benchmarks can be observed
- * by running associated UTs and it might vary on different systems.
+ * is governed by an in-flight window adapted to the rate of acks, within
+ * kMaxIovMsg and kMaxInflightMsg, and by kMinIovMsg. Messages enqueued
+ * together, e.g. with addRoutes, are sent together with as few `sendmsg` calls
+ * as the window allows. This allows adding 100k routes in under 2 seconds.
+ * These performance benchmarks can be observed by running associated UTs and
+ * it might vary on different systems.
  *
  * NOTE Logging:
  * Netlink protocol is tricky when it comes to debugging. To faciliate debugging
@@ -89,6 +120,11 @@ constexpr std::chrono::milliseconds kNlRequestAckTimeout{1000};
  *   netlink.requests.success : Request that completed successfully
  *   netlink.requests.error : Request with non zero return code
  *   netlink.requests.latency_ms : Average latency of netlink request
+ *   netlink.requests.inflight_window : Current window of in-flight requests
+ *   netlink.recv.overrun : Receive buffer overruns, acks may have been lost
+ *   netlink.message_pool.free : Message buffers pooled for re-use
+ *   netlink.message_pool.in_use : Message buffers owned by messages
+ *   netlink.message_pool.allocated : Message buffers allocated by pool
  *   netlink.bytes.rx : Bytes received over netlink socket
  *   netlink.bytes.tx : Bytes sent over netlink socket
  *   netlink.notifications.link : Received link notifications
@@ -96,12 +132,14 @@ constexpr std::chrono::milliseconds kNlRequestAckTimeout{1000};
  *   netlink.notifications.neighbors : Received neighbor notifications
  *   netlink.notifications.route : Received route notifications
  */
-class NetlinkProtocolSocket : public folly::EventHandler {
+class NetlinkProtocolSocket : public folly::EventHandler,
+                              public folly::EventBase::LoopCallback {
  public:
   explicit NetlinkProtocolSocket(
       folly::EventBase* evb,
       messaging::ReplicateQueue<NetlinkEvent>& netlinkEventsQ,
-      bool enableIPv6RouteReplaceSemantics = false);
+      bool enableIPv6RouteReplaceSemantics = false,
+      uint32_t eventGroups = kNetlinkAllEvents);
 
   virtual ~NetlinkProtocolSocket();
 
@@ -135,6 +173,59 @@ class NetlinkProtocolSocket : public folly::EventHandler {
    */
   virtual folly::SemiFuture<int> deleteRoute(const openr::fbnl::Route& route);
 
+  /**
+   * Add or replace routes in batch, with the semantics of addRoute(...) for
+   * each. Messages of all routes are enqueued at once and sent to kernel
+   * together.
+   *
+   * @returns one future, fulfilled once all routes are acked. It throws
+   *          NlException with the first error code not in ignoredErrors.
+   */
+  virtual folly::SemiFuture<folly::Unit> addRoutes(
+      const std::vector<openr::fbnl::Route>& routes,
+      std::unordered_set<int> ignoredErrors = {});
+
+  /**
+   * Delete routes in batch, with the semantics of deleteRoute(...) for each.
+   *
+   * @returns one future, fulfilled once all routes are acked. It throws
+   *          NlException with the first error code not in ignoredErrors.
+   */
+  virtual folly::SemiFuture<folly::Unit> deleteRoutes(
+      const std::vector<openr::fbnl::Route>& routes,
+      std::unordered_set<int> ignoredErrors = {});
+
+  /**
+   * Add or replace nexthop object with single next-hop. Next-hop weight is
+   * ignored, see addNexthopGroup(...). Requires Linux 5.3+
+   *
+   * @returns 0 on success else appropriate system error code
+   */
+  virtual folly::SemiFuture<int> addNexthop(
+      uint32_t id,
+      uint8_t protocolId,
+      uint8_t family,
+      const openr::fbnl::NextHop& nextHop);
+
+  /**
+   * Add or replace nexthop group object, made of existing nexthop objects.
+   * Replacing group updates next-hops of all routes referring to it.
+   *
+   * @returns 0 on success else appropriate system error code
+   */
+  virtual folly::SemiFuture<int> addNexthopGroup(
+      uint32_t id,
+      uint8_t protocolId,
+      const std::vector<openr::fbnl::NexthopGroupMember>& members);
+
+  /**
+   * Delete nexthop object, single next-hop or group. Kernel deletes routes
+   * still referring to it.
+   *
+   * @returns 0 on success else appropriate system error code
+   */
+  virtual folly::SemiFuture<int> deleteNexthop(uint32_t id);
+
   /**
    * Add an address to the interface
    *
@@ -228,6 +319,25 @@ class NetlinkProtocolSocket : public folly::EventHandler {
   virtual folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>>
   getMplsRoutes(uint8_t protocolId);
 
+  /**
+   * Streaming variants of route retrieval APIs. Instead of collecting all
+   * routes, each one is handed to callback as soon as it is parsed. Memory
+   * stays bounded by what callback retains, as opposed to a copy of the whole
+   * table. Callback is invoked in netlink event-base, and reading of further
+   * messages of the dump waits for it to return, which paces the kernel.
+   *
+   * Returned future is fulfilled with status of the dump, 0 on success, once
+   * last route is handed to callback.
+   */
+  virtual folly::SemiFuture<int> streamRoutes(
+      const fbnl::Route& filter, RouteCallback callback);
+  folly::SemiFuture<int> streamIPv4Routes(
+      uint8_t protocolId, RouteCallback callback);
+  folly::SemiFuture<int> streamIPv6Routes(
+      uint8_t protocolId, RouteCallback callback);
+  folly::SemiFuture<int> streamMplsRoutes(
+      uint8_t protocolId, RouteCallback callback);
+
   /**
    * Utility function to accumulate result of multiple requests into one.
    * It will throw the exception with the first non-zero value(aka error code),
@@ -248,11 +358,32 @@ class NetlinkProtocolSocket : public folly::EventHandler {
   // Implement EventHandler callback for reading netlink messages
   void handlerReady(uint16_t events) noexcept override;
 
-  // Send a message batch to netlink socket from queue_
+  // Encode message to add or delete route. On failure return status is set on
+  // message and error code returned, the message must not be sent then.
+  int encodeRouteMessage(
+      NetlinkRouteMessage& rtmMsg, const fbnl::Route& route, bool isAdd);
+
+  // Implement LoopCallback to send messages enqueued in this loop iteration
+  void runLoopCallback() noexcept override;
+
+  // Whether enough of the in-flight window is free to send messages
+  bool canSendNetlinkMessage() const;
+
+  // Send message batches to netlink socket from queue_, as long as there is
+  // room in the in-flight window
   void sendNetlinkMessage();
 
-  // Receive messages from netlink socket. Invoke `processMessage` for every
-  // message received.
+  // Send next iovSize messages from queue_ with one `sendmsg`
+  void sendNetlinkMessageBatch(uint32_t iovSize);
+
+  // Set in-flight window and export it
+  void setMaxInflightMsgs(size_t maxInflightMsgs);
+
+  // Export occupancy of NetlinkMessagePool as counters
+  void updateMessagePoolCounters();
+
+  // Receive messages pending on netlink socket, up to kMaxRecvBatch of them
+  // with a single syscall. Invoke `processMessage` for every message received.
   void recvNetlinkMessage();
 
   // Process received netlink message. Set return values for pending requests
@@ -260,9 +391,11 @@ class NetlinkProtocolSocket : public folly::EventHandler {
   void processMessage(
       const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead);
 
-  // Process ack message. Set return status on pending requests in nlSeqNumMap_
+  // Process ack message. Set return status, and error explanation of kernel
+  // if any, on pending requests in nlSeqNumMap_
   // Resume sending messages from queue_ if any pending
-  void processAck(uint32_t ack, int status);
+  void processAck(
+      uint32_t ack, int status, std::string const& errorMessage = "");
 
   // Event base for serializing read/write requests to netlink socket. Also
   // ensure thread safety of private member variables.
@@ -282,10 +415,17 @@ class NetlinkProtocolSocket : public folly::EventHandler {
   // Use new IPv6 route replace semantics. See documentation for addRoute(...)
   const bool enableIPv6RouteReplaceSemantics_{false};
 
+  // Multicast groups the socket is bound to, e.g. kNetlinkLinkAddrEvents
+  const uint32_t eventGroups_{kNetlinkAllEvents};
+
   // Netlink socket fd. Created when class is constructed. Re-created on timeout
   // when no response is received for any of our pending requests.
   int nlSock_{-1};
 
+  // Receive buffers of recvNetlinkMessage(), kept across calls
+  std::vector<NetlinkMessagePool::Buffer> recvBufs_ =
+      std::vector<NetlinkMessagePool::Buffer>(kMaxRecvBatch);
+
   // nl_pid stands for port-ID and not process-ID. Netlink sockets are bound on
   // this specified port. This must be unique for every netlink socket that
   // is created on the system. Ironically kernel assigns the process-ID as the
@@ -321,6 +461,11 @@ class NetlinkProtocolSocket : public folly::EventHandler {
   std::unordered_map<uint32_t, std::shared_ptr<NetlinkMessageBase>>
       nlSeqNumMap_;
 
+  // Window of in-flight messages and number of acks received since it was
+  // last adjusted
+  size_t maxInflightMsgs_{kMaxIovMsg};
+  size_t numAcksInWindow_{0};
+
   // Timer to help keep track of timeout of messages sent to kernel. It also
   // ensures the aliveness of the netlink socket-fd. Timer is
   // - Started when a new message is sent
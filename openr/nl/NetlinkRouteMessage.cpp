@@ -48,7 +48,13 @@ NetlinkRouteMessage::rcvdRoute(Route&& route) {
   if (reverted) {
     route.setNextHops(reversedMplsLabelNhs);
   }
+  // routes of a dump share few distinct next-hop sets
+  route.poolNextHops(nextHopSetPool_);
 
+  if (routeCallback_) {
+    routeCallback_(std::move(route));
+    return;
+  }
   rcvdRoutes_.emplace_back(std::move(route));
 }
 
@@ -623,6 +629,11 @@ NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) {
       routeBuilder.setPriority(*(reinterpret_cast<int*> RTA_DATA(routeAttr)));
     } break;
 
+    case RTA_NH_ID: {
+      // parse ID of nexthop object. Kernel also reports its next-hops
+      routeBuilder.setNhId(*(reinterpret_cast<uint32_t*> RTA_DATA(routeAttr)));
+    } break;
+
     // Nexthop attributes
     case RTA_GATEWAY:
     case RTA_OIF:
@@ -753,6 +764,13 @@ NetlinkRouteMessage::addRoute(const Route& route) {
     return status;
   }
 
+  // Refer to nexthop object. Kernel rejects inline next-hops along with it
+  if (route.getNhId().has_value()) {
+    const uint32_t nhId = route.getNhId().value();
+    return addAttributes(
+        RTA_NH_ID, reinterpret_cast<const char*>(&nhId), sizeof(uint32_t));
+  }
+
   return addNextHops(route);
 }
 
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/IPAddress.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/nl/NetlinkMessageBase.h>
@@ -29,6 +30,9 @@ constexpr uint32_t kLabelBosShift{8};
 constexpr uint32_t kLabelShift{12};
 constexpr uint32_t kLabelSizeBits{20};
 
+// Callback invoked for each route received in response to GET request
+using RouteCallback = folly::Function<void(Route&&)>;
+
 /**
  * Message specialization for rtnetlink ROUTE type
  *
@@ -70,6 +74,14 @@ class NetlinkRouteMessage final : public NetlinkMessageBase {
     return routePromise_.getSemiFuture();
   }
 
+  // Hand received routes to callback as they're parsed, instead of collecting
+  // them for routePromise_. Callback is invoked in netlink event-base, and
+  // reading of further messages waits for it to return.
+  void
+  setRouteCallback(RouteCallback callback) {
+    routeCallback_ = std::move(callback);
+  }
+
   // initiallize route message with default params
   void init(int type, uint32_t flags, const Route& route);
 
@@ -178,6 +190,12 @@ class NetlinkRouteMessage final : public NetlinkMessageBase {
   // promise to be fulfilled when receiving kernel reply
   folly::Promise<folly::Expected<std::vector<Route>, int>> routePromise_;
   std::vector<Route> rcvdRoutes_;
+
+  // next-hops of received routes
+  NextHopSetPool nextHopSetPool_;
+
+  // consumer of received routes, if set
+  RouteCallback routeCallback_;
 };
 
 } // namespace openr::fbnl
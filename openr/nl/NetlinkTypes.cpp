@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <folly/hash/Hash.h>
+
 #include <openr/nl/NetlinkTypes.h>
 
 extern "C" {
@@ -15,6 +17,31 @@ extern "C" {
 
 namespace openr::fbnl {
 
+NlErrorClass
+classifyNlError(int error) {
+  switch (std::abs(error)) {
+  case EAGAIN:
+  case EBUSY:
+  case EINTR:
+  case ENOBUFS:
+  case ENOMEM:
+  case ETIMEDOUT:
+    return NlErrorClass::TRANSIENT;
+  case E2BIG:
+  case EAFNOSUPPORT:
+  case EHOSTUNREACH:
+  case EINVAL:
+  case EMSGSIZE:
+  case ENETUNREACH:
+  case EOPNOTSUPP:
+  case EPROTONOSUPPORT:
+  case ERANGE:
+    return NlErrorClass::PERMANENT;
+  default:
+    return NlErrorClass::FATAL;
+  }
+}
+
 /*=================================Route====================================*/
 
 Route
@@ -146,6 +173,17 @@ RouteBuilder::getAdvMss() const {
   return advMss_;
 }
 
+RouteBuilder&
+RouteBuilder::setNhId(uint32_t nhId) {
+  nhId_ = nhId;
+  return *this;
+}
+
+std::optional<uint32_t>
+RouteBuilder::getNhId() const {
+  return nhId_;
+}
+
 RouteBuilder&
 RouteBuilder::addNextHop(const NextHop& nextHop) {
   nextHops_.emplace(nextHop);
@@ -185,6 +223,7 @@ RouteBuilder::reset() {
   tos_.reset();
   mtu_.reset();
   advMss_.reset();
+  nhId_.reset();
   nextHops_.clear();
 }
 
@@ -200,9 +239,11 @@ Route::Route(const RouteBuilder& builder)
       tos_(builder.getTos()),
       mtu_(builder.getMtu()),
       advMss_(builder.getAdvMss()),
-      nextHops_(builder.getNextHops()),
+      nhId_(builder.getNhId()),
       dst_(builder.getDestination()),
-      mplsLabel_(builder.getMplsLabel()) {}
+      mplsLabel_(builder.getMplsLabel()) {
+  setNextHops(builder.getNextHops());
+}
 
 Route::~Route() {}
 
@@ -225,6 +266,7 @@ Route::operator=(Route&& other) noexcept {
   tos_ = std::move(other.tos_);
   mtu_ = std::move(other.mtu_);
   advMss_ = std::move(other.advMss_);
+  nhId_ = std::move(other.nhId_);
   nextHops_ = std::move(other.nextHops_);
   dst_ = std::move(other.dst_);
   family_ = std::move(other.family_);
@@ -251,6 +293,7 @@ Route::operator=(const Route& other) {
   tos_ = other.tos_;
   mtu_ = other.mtu_;
   advMss_ = other.advMss_;
+  nhId_ = other.nhId_;
   nextHops_ = other.nextHops_;
   dst_ = other.dst_;
   family_ = other.family_;
@@ -271,7 +314,7 @@ operator==(const Route& lhs, const Route& rhs) {
        lhs.getFlags() == rhs.getFlags() &&
        lhs.getPriority() == rhs.getPriority() && lhs.getTos() == rhs.getTos() &&
        lhs.getMtu() == rhs.getMtu() && lhs.getAdvMss() == rhs.getAdvMss() &&
-       lhs.getFamily() == rhs.getFamily());
+       lhs.getNhId() == rhs.getNhId() && lhs.getFamily() == rhs.getFamily());
 
   if (!ret) {
     return false;
@@ -322,6 +365,11 @@ Route::getAdvMss() const {
   return advMss_;
 }
 
+std::optional<uint32_t>
+Route::getNhId() const {
+  return nhId_;
+}
+
 uint32_t
 Route::getRouteTable() const {
   return routeTable_;
@@ -349,7 +397,8 @@ Route::getPriority() const {
 
 const NextHopSet&
 Route::getNextHops() const {
-  return nextHops_;
+  static const NextHopSet kNoNextHops;
+  return nextHops_ ? *nextHops_ : kNoNextHops;
 }
 
 bool
@@ -389,7 +438,10 @@ Route::str() const {
   if (advMss_) {
     result += fmt::format(", advmss {}", advMss_.value());
   }
-  for (auto const& nextHop : nextHops_) {
+  if (nhId_) {
+    result += fmt::format(", nhid {}", nhId_.value());
+  }
+  for (auto const& nextHop : getNextHops()) {
     result += "\n  " + nextHop.str();
   }
   return result;
@@ -400,9 +452,38 @@ Route::setPriority(uint32_t priority) {
   priority_ = priority;
 }
 
+void
+Route::setNhId(uint32_t nhId) {
+  nhId_ = nhId;
+}
+
 void
 Route::setNextHops(const NextHopSet& nextHops) {
-  nextHops_ = nextHops;
+  nextHops_ =
+      nextHops.empty() ? nullptr : std::make_shared<const NextHopSet>(nextHops);
+}
+
+void
+Route::poolNextHops(NextHopSetPool& pool) {
+  if (nextHops_) {
+    nextHops_ = pool.get(std::move(nextHops_));
+  }
+}
+
+std::shared_ptr<const NextHopSet>
+NextHopSetPool::get(std::shared_ptr<const NextHopSet> nextHops) {
+  CHECK(nextHops);
+  size_t hash{0};
+  for (auto const& nextHop : *nextHops) {
+    hash += NextHopHash()(nextHop);
+  }
+  auto [begin, end] = sets_.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    if (*it->second == *nextHops) {
+      return it->second;
+    }
+  }
+  return sets_.emplace(hash, std::move(nextHops))->second;
 }
 
 /*=================================NextHop====================================*/
@@ -526,16 +607,15 @@ operator==(const NextHop& lhs, const NextHop& rhs) {
 
 size_t
 NextHopHash::operator()(const NextHop& nh) const {
+  // fields compared by operator== which tell next-hops apart in practice
   size_t res = 0;
   if (nh.getIfIndex().has_value()) {
-    res += std::hash<std::string>()(std::to_string(nh.getIfIndex().value()));
+    res = folly::hash::hash_combine(res, nh.getIfIndex().value());
   }
   if (nh.getGateway().has_value()) {
-    res += std::hash<std::string>()(nh.getGateway().value().str());
+    res = folly::hash::hash_combine(res, nh.getGateway().value().hash());
   }
-  res += std::hash<std::string>()(
-      std::to_string(std::max(nh.getWeight(), uint8_t(1))));
-  return res;
+  return folly::hash::hash_combine(res, std::max(nh.getWeight(), uint8_t(1)));
 }
 
 std::optional<int>
@@ -852,6 +932,7 @@ NeighborBuilder&
 NeighborBuilder::setState(int state, bool deleted) {
   state_ = state;
   isReachable_ = deleted ? false : isNeighborReachable(state);
+  isDeleted_ = deleted;
   return *this;
 }
 
@@ -865,9 +946,15 @@ NeighborBuilder::getIsReachable() const {
   return isReachable_;
 }
 
+bool
+NeighborBuilder::getIsDeleted() const {
+  return isDeleted_;
+}
+
 Neighbor::Neighbor(const NeighborBuilder& builder)
     : ifIndex_(builder.getIfIndex()),
       isReachable_(builder.getIsReachable()),
+      isDeleted_(builder.getIsDeleted()),
       destination_(builder.getDestination()),
       linkAddress_(builder.getLinkAddress()),
       state_(builder.getState()) {}
@@ -886,6 +973,7 @@ Neighbor::operator=(Neighbor&& other) noexcept {
 
   ifIndex_ = other.ifIndex_;
   isReachable_ = other.isReachable_;
+  isDeleted_ = other.isDeleted_;
   destination_ = other.destination_;
   linkAddress_ = other.linkAddress_;
   state_ = other.state_;
@@ -904,6 +992,7 @@ Neighbor::operator=(const Neighbor& other) {
 
   ifIndex_ = other.ifIndex_;
   isReachable_ = other.isReachable_;
+  isDeleted_ = other.isDeleted_;
   destination_ = other.destination_;
   linkAddress_ = other.linkAddress_;
   state_ = other.state_;
@@ -940,6 +1029,11 @@ Neighbor::isReachable() const {
   return isReachable_;
 }
 
+bool
+Neighbor::isDeleted() const {
+  return isDeleted_;
+}
+
 std::string
 Neighbor::str() const {
   std::string stateStr{"n/a"};
@@ -29,6 +29,21 @@ class NlException : public std::runtime_error {
             "Error({}) - {}. {} ", err, folly::errnoStr(std::abs(err)), msg)) {}
 };
 
+/**
+ * How a request failing with an error code is best recovered from
+ */
+enum class NlErrorClass {
+  // kernel lacked resources, the same request may succeed when retried
+  TRANSIENT,
+  // request is rejected, e.g. a route with an invalid next-hop. Retrying or
+  // syncing again fails the same way
+  PERMANENT,
+  // kernel state differs from what the request assumed, it needs be synced
+  FATAL,
+};
+
+NlErrorClass classifyNlError(int error);
+
 const uint8_t DEFAULT_PROTOCOL_ID = 99;
 
 class NextHop;
@@ -120,6 +135,27 @@ struct NextHopHash {
 };
 
 using NextHopSet = std::unordered_set<NextHop, NextHopHash>;
+
+/**
+ * Pool of the distinct next-hop sets of a batch of routes, e.g. of a route
+ * dump or of a FIB update. Routes are spread over few ECMP groups, routes
+ * with equal next-hops share the pooled set instead of holding one each.
+ */
+class NextHopSetPool final {
+ public:
+  // pooled set equal to nextHops, which is pooled if there is none yet
+  std::shared_ptr<const NextHopSet> get(
+      std::shared_ptr<const NextHopSet> nextHops);
+
+  size_t
+  size() const {
+    return sets_.size();
+  }
+
+ private:
+  // pooled sets by hash, independent of the order of next-hops
+  std::unordered_multimap<size_t, std::shared_ptr<const NextHopSet>> sets_;
+};
 /**
  * Values for core fields
  * ============================
@@ -221,6 +257,12 @@ class RouteBuilder {
   RouteBuilder& setAdvMss(uint32_t tos);
   std::optional<uint32_t> getAdvMss() const;
 
+  // Nexthop object related methods. Route refers to nexthop (group) object
+  // with this ID, instead of carrying its next-hops inline, when set. See
+  // `NetlinkNexthopMessage`
+  RouteBuilder& setNhId(uint32_t nhId);
+  std::optional<uint32_t> getNhId() const;
+
   // ATTN: `family_` will be set when:
   //    UNICAST: `dst_` is set;
   //    MPLS: `mplsLabel_` is set;
@@ -242,7 +284,9 @@ class RouteBuilder {
   std::optional<uint8_t> tos_;
   std::optional<uint32_t> mtu_;
   std::optional<uint32_t> advMss_;
-  NextHopSet nextHops_;
+  std::optional<uint32_t> nhId_;
+  // immutable, shared by copies of the route. Not set if there are none
+  std::shared_ptr<const NextHopSet> nextHops_;
   folly::CIDRNetwork dst_;
   std::optional<uint32_t> mplsLabel_;
 };
@@ -283,16 +327,23 @@ class Route final {
 
   std::optional<uint32_t> getAdvMss() const;
 
+  std::optional<uint32_t> getNhId() const;
+
   const NextHopSet& getNextHops() const;
 
   bool isValid() const;
 
   void setPriority(uint32_t priority);
 
+  void setNhId(uint32_t nhId);
+
   std::string str() const;
 
   void setNextHops(const NextHopSet& nextHops);
 
+  // share next-hops with routes of pool having equal next-hops
+  void poolNextHops(NextHopSetPool& pool);
+
  private:
   uint8_t type_{RTN_UNICAST};
   uint32_t routeTable_{RT_TABLE_MAIN};
@@ -305,7 +356,9 @@ class Route final {
   std::optional<uint8_t> tos_;
   std::optional<uint32_t> mtu_;
   std::optional<uint32_t> advMss_;
-  NextHopSet nextHops_;
+  std::optional<uint32_t> nhId_;
+  // immutable, shared by copies of the route. Not set if there are none
+  std::shared_ptr<const NextHopSet> nextHops_;
   folly::CIDRNetwork dst_;
   std::optional<uint32_t> mplsLabel_;
 };
@@ -428,6 +481,8 @@ class NeighborBuilder final {
 
   bool getIsReachable() const;
 
+  bool getIsDeleted() const;
+
   /**
    * NUD_INCOMPLETE
    * NUD_REACHABLE
@@ -445,6 +500,7 @@ class NeighborBuilder final {
  private:
   int ifIndex_{0};
   bool isReachable_{false};
+  bool isDeleted_{false};
   folly::IPAddress destination_;
   std::optional<folly::MacAddress> linkAddress_;
   std::optional<int> state_;
@@ -465,6 +521,9 @@ class Neighbor final {
 
   bool isReachable() const;
 
+  // Whether neighbor entry was removed from kernel (RTM_DELNEIGH)
+  bool isDeleted() const;
+
   int getFamily() const;
 
   folly::IPAddress getDestination() const;
@@ -478,6 +537,7 @@ class Neighbor final {
  private:
   int ifIndex_{0};
   bool isReachable_{false};
+  bool isDeleted_{false};
   folly::IPAddress destination_;
   std::optional<folly::MacAddress> linkAddress_;
   std::optional<int> state_;
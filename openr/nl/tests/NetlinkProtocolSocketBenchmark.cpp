@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <folly/Benchmark.h>
+#include <folly/IPAddress.h>
+#include <folly/Subprocess.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/system/Shell.h>
+
+#include <openr/nl/NetlinkProtocolSocket.h>
+
+/**
+ * Route programming throughput against the kernel, through
+ * NetlinkProtocolSocket. Must be run as root. Runs in a network namespace of
+ * its own, with a dummy interface the next-hops are reachable through, so
+ * the routes of the host are left untouched.
+ *
+ * Every iteration adds, or deletes, a batch of routes with one call. Counters
+ * report the cost per route and the distribution of the time for a batch to
+ * be acked by kernel.
+ */
+
+using namespace openr;
+using namespace openr::fbnl;
+using namespace folly::literals::shell_literals;
+
+namespace {
+
+const std::string kIfName{"nlbench0"};
+const uint8_t kProtocolId{99};
+const uint32_t kPriority{10};
+const uint32_t kFirstLabel{10000};
+const uint32_t kSwapLabel{100};
+
+enum class RouteFamily { V4, V6, MPLS };
+
+// socket under benchmark, set up by main() in the namespace
+std::unique_ptr<NetlinkProtocolSocket> nlSock;
+int ifIndex{0};
+bool mplsSupported{false};
+
+bool
+runCmd(std::vector<std::string> cmd) {
+  folly::Subprocess proc(std::move(cmd));
+  return proc.wait().exitStatus() == 0;
+}
+
+// isolate the benchmark from the routes of the host
+void
+setupNetns() {
+  PCHECK(::unshare(CLONE_NEWNET) == 0) << "Failed to create network namespace";
+  CHECK(runCmd("ip link set lo up"_shellify()));
+  CHECK(runCmd("ip link add {} type dummy"_shellify(kIfName.c_str())));
+  CHECK(runCmd("ip link set {} up"_shellify(kIfName.c_str())));
+  CHECK(runCmd("ip addr add 10.254.0.1/16 dev {}"_shellify(kIfName.c_str())));
+  CHECK(runCmd(
+      "ip -6 addr add fd00:254::1/64 dev {} nodad"_shellify(kIfName.c_str())));
+
+  // MPLS routes need the label space of the namespace, and mpls_router
+  std::ofstream platformLabels("/proc/sys/net/mpls/platform_labels");
+  platformLabels << kFirstLabel + 100000;
+  mplsSupported = platformLabels.good();
+  LOG_IF(WARNING, not mplsSupported)
+      << "MPLS is not supported, is mpls_router loaded? Skipping MPLS routes";
+}
+
+NextHop
+buildNextHop(RouteFamily family, size_t index) {
+  NextHopBuilder builder;
+  builder.setIfIndex(ifIndex);
+  if (family == RouteFamily::V4) {
+    builder.setGateway(folly::IPAddressV4::fromLongHBO(
+        (10u << 24) | (254u << 16) | static_cast<uint32_t>(index + 2)));
+  } else {
+    builder.setGateway(
+        folly::IPAddress(fmt::format("fd00:254::{:x}", index + 2)));
+  }
+  if (family == RouteFamily::MPLS) {
+    builder.setLabelAction(thrift::MplsActionCode::SWAP);
+    builder.setSwapLabel(kSwapLabel);
+  }
+  return builder.build();
+}
+
+std::vector<Route>
+buildRoutes(RouteFamily family, size_t numRoutes, size_t ecmpWidth) {
+  NextHopSetPool pool;
+  std::vector<Route> routes;
+  routes.reserve(numRoutes);
+  for (size_t i = 0; i < numRoutes; ++i) {
+    RouteBuilder builder;
+    builder.setProtocolId(kProtocolId).setFlags(0).setValid(true);
+    switch (family) {
+    case RouteFamily::V4:
+      builder.setDestination(
+          {folly::IPAddressV4::fromLongHBO(
+               (20u << 24) | static_cast<uint32_t>(i << 8)),
+           24});
+      builder.setPriority(kPriority);
+      break;
+    case RouteFamily::V6:
+      builder.setDestination(folly::IPAddress::createNetwork(
+          fmt::format("fd01:{:x}:{:x}::/64", i >> 16, i & 0xffff)));
+      builder.setPriority(kPriority);
+      break;
+    case RouteFamily::MPLS:
+      builder.setMplsLabel(kFirstLabel + i);
+      break;
+    }
+    for (size_t nh = 0; nh < ecmpWidth; ++nh) {
+      builder.addNextHop(buildNextHop(family, nh));
+    }
+    routes.emplace_back(builder.build());
+    routes.back().poolNextHops(pool);
+  }
+  return routes;
+}
+
+/**
+ * Add (or delete) a batch of numRoutes routes with ecmpWidth next-hops every
+ * iteration. Routes are deleted (or added) again outside of the measurement,
+ * so every iteration starts off the same table.
+ */
+void
+runRouteBenchmark(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    RouteFamily family,
+    bool isAdd,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  auto suspender = folly::BenchmarkSuspender();
+  if (family == RouteFamily::MPLS and not mplsSupported) {
+    return;
+  }
+  const auto routes = buildRoutes(family, numRoutes, ecmpWidth);
+
+  std::vector<std::chrono::microseconds> latencies;
+  latencies.reserve(iters);
+  for (uint32_t i = 0; i < iters; ++i) {
+    if (not isAdd) {
+      nlSock->addRoutes(routes, {EEXIST}).get();
+    }
+
+    suspender.dismiss();
+    const auto startTs = std::chrono::steady_clock::now();
+    if (isAdd) {
+      nlSock->addRoutes(routes, {EEXIST}).get();
+    } else {
+      nlSock->deleteRoutes(routes, {ESRCH}).get();
+    }
+    latencies.emplace_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTs));
+    suspender.rehire();
+
+    if (isAdd) {
+      nlSock->deleteRoutes(routes, {ESRCH}).get();
+    }
+  }
+
+  if (latencies.empty()) {
+    return;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies.at(std::min(
+                            latencies.size() - 1,
+                            static_cast<size_t>(p * latencies.size())))
+        .count();
+  };
+  std::chrono::microseconds total{0};
+  for (auto const& latency : latencies) {
+    total += latency;
+  }
+  counters["ns_per_route"] = std::chrono::duration_cast<
+                                 std::chrono::nanoseconds>(total)
+                                 .count() /
+      (latencies.size() * numRoutes);
+  counters["ack_p50_us"] = percentile(0.5);
+  counters["ack_p90_us"] = percentile(0.9);
+  counters["ack_p99_us"] = percentile(0.99);
+  counters["ack_max_us"] = latencies.back().count();
+}
+
+void
+BM_NetlinkAddV4Routes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  runRouteBenchmark(
+      counters, iters, RouteFamily::V4, true, numRoutes, ecmpWidth);
+}
+
+void
+BM_NetlinkDeleteV4Routes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  runRouteBenchmark(
+      counters, iters, RouteFamily::V4, false, numRoutes, ecmpWidth);
+}
+
+void
+BM_NetlinkAddV6Routes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  runRouteBenchmark(
+      counters, iters, RouteFamily::V6, true, numRoutes, ecmpWidth);
+}
+
+void
+BM_NetlinkDeleteV6Routes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  runRouteBenchmark(
+      counters, iters, RouteFamily::V6, false, numRoutes, ecmpWidth);
+}
+
+void
+BM_NetlinkAddMplsRoutes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  runRouteBenchmark(
+      counters, iters, RouteFamily::MPLS, true, numRoutes, ecmpWidth);
+}
+
+void
+BM_NetlinkDeleteMplsRoutes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numRoutes,
+    size_t ecmpWidth) {
+  runRouteBenchmark(
+      counters, iters, RouteFamily::MPLS, false, numRoutes, ecmpWidth);
+}
+
+} // namespace
+
+// The first parameter is the number of routes per batch, the second the
+// number of next-hops per route. Label routes with 128 next-hops don't fit in
+// one netlink message.
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_NetlinkAddV4Routes, counters, 1_1, 1, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_NetlinkAddV4Routes, counters, 100_1, 100, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddV4Routes, counters, 10000_1, 10000, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddV4Routes, counters, 10000_16, 10000, 16);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddV4Routes, counters, 10000_128, 10000, 128);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkDeleteV4Routes, counters, 10000_1, 10000, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkDeleteV4Routes, counters, 10000_128, 10000, 128);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_NetlinkAddV6Routes, counters, 1_1, 1, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_NetlinkAddV6Routes, counters, 100_1, 100, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddV6Routes, counters, 10000_1, 10000, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddV6Routes, counters, 10000_16, 10000, 16);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddV6Routes, counters, 10000_128, 10000, 128);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkDeleteV6Routes, counters, 10000_1, 10000, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkDeleteV6Routes, counters, 10000_128, 10000, 128);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_NetlinkAddMplsRoutes, counters, 1_1, 1, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddMplsRoutes, counters, 100_1, 100, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddMplsRoutes, counters, 10000_1, 10000, 1);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddMplsRoutes, counters, 10000_16, 10000, 16);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkAddMplsRoutes, counters, 10000_64, 10000, 64);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_NetlinkDeleteMplsRoutes, counters, 10000_1, 10000, 1);
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  if (::getuid() != 0) {
+    LOG(ERROR) << "Must be run as root";
+    return 1;
+  }
+  setupNetns();
+
+  folly::EventBase evb;
+  std::thread evbThread([&evb]() { evb.loopForever(); });
+  evb.waitUntilRunning();
+
+  messaging::ReplicateQueue<NetlinkEvent> netlinkEventsQueue;
+  nlSock = std::make_unique<NetlinkProtocolSocket>(
+      &evb,
+      netlinkEventsQueue,
+      false /* enableIPv6RouteReplaceSemantics */,
+      0 /* eventGroups */);
+  for (auto const& link : nlSock->getAllLinks().get().value()) {
+    if (link.getLinkName() == kIfName) {
+      ifIndex = link.getIfIndex();
+    }
+  }
+  CHECK_NE(0, ifIndex) << "Interface " << kIfName << " not found";
+
+  folly::runBenchmarks();
+
+  netlinkEventsQueue.close();
+  evb.terminateLoopSoon();
+  evbThread.join();
+  nlSock.reset();
+  return 0;
+}
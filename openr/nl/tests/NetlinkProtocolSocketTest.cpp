@@ -20,6 +20,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <openr/common/StatCounter.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/if/gen-cpp2/Platform_constants.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
@@ -87,17 +88,20 @@ uint32_t inLabel5{141};
 
 int64_t
 getErrorCount() {
+  StatCounter::flushAll();
   return facebook::fb303::fbData->getCounters()["netlink.requests.error.sum"];
 }
 
 int64_t
 getAckCount() {
+  StatCounter::flushAll();
   return facebook::fb303::fbData->getCounters()["netlink.requests.success.sum"];
 }
 
 void
 printCounters() {
   LOG(INFO) << "Printing counters ";
+  StatCounter::flushAll();
   for (auto const& [key, value] : facebook::fb303::fbData->getCounters()) {
     LOG(INFO) << "  " << key << " : " << value;
   }
@@ -942,6 +946,43 @@ TEST_F(NlMessageFixture, NeighborEventPublication) {
   }
 }
 
+/*
+ * Verify a socket bound to link and address events only doesn't publish
+ * neighbor events, while still publishing the address events which follow
+ */
+TEST_F(NlMessageFixture, EventGroupsFilter) {
+  messaging::ReplicateQueue<NetlinkEvent> linkAddrEventsQ;
+  auto linkAddrEventsReader = linkAddrEventsQ.getReader();
+  auto linkAddrSock = std::make_unique<NetlinkProtocolSocket>(
+      &evb,
+      linkAddrEventsQ,
+      FLAGS_enable_ipv6_rr_semantics,
+      kNetlinkLinkAddrEvents);
+  // wait for the socket to be bound
+  linkAddrSock->getAllLinks().get();
+
+  const folly::IPAddress neighborV4{"172.8.0.1"};
+  addV4NeighborEntry(kVethNameX, neighborV4, kLinkAddr1);
+  addAddress(kVethNameX, "172.9.0.1", 31);
+
+  auto startTime = std::chrono::steady_clock::now();
+  while (true) {
+    ASSERT_LT(std::chrono::steady_clock::now() - startTime, kProcTimeout);
+    auto req = linkAddrEventsReader.get();
+    ASSERT_TRUE(req.hasValue());
+    EXPECT_EQ(nullptr, std::get_if<Neighbor>(&req.value()));
+    auto* addr = std::get_if<IfAddress>(&req.value());
+    if (addr and addr->getPrefix().has_value() and
+        addr->getPrefix()->first == folly::IPAddress("172.9.0.1")) {
+      break;
+    }
+  }
+
+  deleteV4NeighborEntry(kVethNameX, neighborV4, kLinkAddr1);
+  linkAddrEventsQ.close();
+  linkAddrSock.reset();
+}
+
 /*
  * Check empty route from kernel
  */
@@ -1815,6 +1856,102 @@ TEST_F(NlMessageFixture, MultipleLabelRoutes) {
   EXPECT_EQ(0, kernelRoutes.size());
 }
 
+/*
+ * Batch failures report the failed routes, with the error class and
+ * explanation of kernel
+ */
+TEST_F(NlMessageFixture, BatchRouteErrors) {
+  std::vector<NextHop> validPaths{buildNextHop(
+      std::nullopt, std::nullopt, std::nullopt, ipAddrY1V4, ifIndexX)};
+  // gateway is not reachable through the interface
+  std::vector<NextHop> invalidPaths{buildNextHop(
+      std::nullopt,
+      std::nullopt,
+      std::nullopt,
+      folly::IPAddress("10.254.0.1"),
+      ifIndexX)};
+  std::vector<Route> routes{
+      buildRoute(
+          kRouteProtoId,
+          folly::IPAddress::createNetwork("10.10.0.0/24"),
+          std::nullopt,
+          validPaths),
+      buildRoute(
+          kRouteProtoId,
+          folly::IPAddress::createNetwork("10.10.1.0/24"),
+          std::nullopt,
+          invalidPaths)};
+
+  try {
+    nlSock->addRoutes(routes).get();
+    FAIL() << "Route with invalid gateway should fail";
+  } catch (NlBatchException const& e) {
+    ASSERT_EQ(1, e.getErrors().size());
+    auto const& error = e.getErrors().front();
+    EXPECT_EQ(1, error.index);
+    EXPECT_EQ(NlErrorClass::PERMANENT, classifyNlError(error.error));
+    LOG(INFO) << "Kernel error explanation: " << error.message;
+  }
+
+  auto kernelRoutes = nlSock->getIPv4Routes(kRouteProtoId).get().value();
+  EXPECT_TRUE(checkRouteInKernelRoutes(kernelRoutes, routes.at(0)));
+  EXPECT_FALSE(checkRouteInKernelRoutes(kernelRoutes, routes.at(1)));
+  EXPECT_EQ(0, nlSock->deleteRoute(routes.at(0)).get());
+}
+
+/*
+ * Add, stream and delete label routes with batch APIs, exceeding the initial
+ * window of in-flight messages
+ */
+TEST_F(NlMessageFixture, BatchLabelRoutes) {
+  uint32_t ackCount{0};
+  uint32_t count{20000};
+  std::vector<NextHop> paths;
+  paths.push_back(buildNextHop(
+      std::nullopt,
+      swapLabel,
+      thrift::MplsActionCode::SWAP,
+      ipAddrY1V6,
+      ifIndexX));
+  std::vector<Route> labelRoutes;
+  for (uint32_t i = 0; i < count; i++) {
+    labelRoutes.push_back(
+        buildRoute(kRouteProtoId, std::nullopt, 600 + i, paths));
+  }
+
+  ackCount = getAckCount();
+  EXPECT_EQ(nlSock->addRoutes(labelRoutes).get(), folly::Unit());
+  EXPECT_GE(getAckCount(), ackCount + count);
+  EXPECT_EQ(0, getErrorCount());
+
+  auto kernelRoutes = nlSock->getMplsRoutes(kRouteProtoId).get().value();
+  EXPECT_EQ(kernelRoutes.size(), labelRoutes.size());
+  EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, labelRoutes), count);
+
+  // stream routes instead of collecting them
+  std::vector<Route> streamedRoutes;
+  EXPECT_EQ(
+      0,
+      nlSock
+          ->streamMplsRoutes(
+              kRouteProtoId,
+              [&streamedRoutes](Route&& route) {
+                streamedRoutes.emplace_back(std::move(route));
+              })
+          .get());
+  EXPECT_EQ(findRoutesInKernelRoutes(streamedRoutes, labelRoutes), count);
+
+  // deleting twice fails with ESRCH, unless ignored
+  ackCount = getAckCount();
+  EXPECT_EQ(nlSock->deleteRoutes(labelRoutes).get(), folly::Unit());
+  EXPECT_GE(getAckCount(), ackCount + count);
+  EXPECT_THROW(nlSock->deleteRoutes(labelRoutes).get(), NlException);
+  EXPECT_EQ(nlSock->deleteRoutes(labelRoutes, {ESRCH}).get(), folly::Unit());
+
+  kernelRoutes = nlSock->getMplsRoutes(kRouteProtoId).get().value();
+  EXPECT_EQ(0, kernelRoutes.size());
+}
+
 /*
  * Flap multiple links up and down and stress test link events
  */
@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <openr/nl/NeighborCache.h>
+#include <openr/nl/NetlinkRouteMessage.h>
 #include <openr/nl/NetlinkTypes.h>
 
 #include <glog/logging.h>
@@ -299,6 +301,53 @@ TEST(NetlinkTypes, RouteCopyTest) {
   EXPECT_EQ(route, route2);
 }
 
+TEST(NetlinkTypes, RouteNextHopSetPoolTest) {
+  NextHopBuilder nhBuilder;
+  auto nh1 = nhBuilder.setIfIndex(kIfIndex)
+                 .setGateway(folly::IPAddress("face:cafe:3::3"))
+                 .build();
+  nhBuilder.reset();
+  auto nh2 = nhBuilder.setIfIndex(kIfIndex)
+                 .setGateway(folly::IPAddress("face:cafe:3::4"))
+                 .build();
+
+  auto buildRoute = [](std::string const& dst,
+                       std::vector<NextHop> const& nextHops) {
+    RouteBuilder builder;
+    builder.setDestination(folly::IPAddress::createNetwork(dst));
+    for (auto const& nextHop : nextHops) {
+      builder.addNextHop(nextHop);
+    }
+    return builder.build();
+  };
+  auto route1 = buildRoute("fc00:cafe:3::1/128", {nh1, nh2});
+  auto route2 = buildRoute("fc00:cafe:3::2/128", {nh2, nh1});
+  auto route3 = buildRoute("fc00:cafe:3::3/128", {nh1});
+  auto route4 = buildRoute("fc00:cafe:3::4/128", {});
+
+  // routes with equal next-hops, in any order, share them
+  NextHopSetPool pool;
+  for (auto* route : {&route1, &route2, &route3, &route4}) {
+    route->poolNextHops(pool);
+  }
+  EXPECT_EQ(2, pool.size());
+  EXPECT_EQ(&route1.getNextHops(), &route2.getNextHops());
+  EXPECT_NE(&route1.getNextHops(), &route3.getNextHops());
+  EXPECT_EQ(2, route2.getNextHops().size());
+  EXPECT_EQ(1, route3.getNextHops().size());
+  EXPECT_TRUE(route4.getNextHops().empty());
+
+  // next-hops of a route are replaced, not changed in place
+  route2.setNextHops({nh2});
+  EXPECT_EQ(2, route1.getNextHops().size());
+  EXPECT_EQ(1, route2.getNextHops().size());
+
+  // copies share next-hops
+  Route route5(route1);
+  EXPECT_EQ(&route1.getNextHops(), &route5.getNextHops());
+  EXPECT_EQ(route1, route5);
+}
+
 TEST(NetlinkTypes, RouteOptionalParamTest) {
   folly::CIDRNetwork dst{folly::IPAddress("fc00:cafe:3::3"), 128};
   uint32_t flags = 0x01;
@@ -500,6 +549,47 @@ TEST(NetlinkTypes, NeighborCopyTest) {
   EXPECT_EQ(neigh, neigh2);
 }
 
+TEST(NetlinkTypes, NeighborCacheTest) {
+  folly::IPAddress dst1("fc00:cafe:3::3");
+  folly::IPAddress dst2("10.0.0.2");
+  auto buildNeighbor = [](const folly::IPAddress& dst,
+                          int state,
+                          bool deleted = false) {
+    return NeighborBuilder()
+        .setIfIndex(kIfIndex)
+        .setDestination(dst)
+        .setState(state, deleted)
+        .build();
+  };
+
+  NeighborCache cache;
+  cache.reset({buildNeighbor(dst1, NUD_REACHABLE),
+               buildNeighbor(dst2, NUD_FAILED)});
+  EXPECT_EQ(2, cache.size());
+  EXPECT_FALSE(cache.isFailed(kIfIndex, dst1));
+  EXPECT_TRUE(cache.isFailed(kIfIndex, dst2));
+  // Same address on other interface is unknown
+  EXPECT_FALSE(cache.isFailed(kIfIndex + 1, dst2));
+
+  // Resolution in progress is not a failure
+  EXPECT_FALSE(cache.update(buildNeighbor(dst1, NUD_INCOMPLETE)));
+  EXPECT_FALSE(cache.isFailed(kIfIndex, dst1));
+
+  // Failed, and failed again
+  EXPECT_TRUE(cache.update(buildNeighbor(dst1, NUD_FAILED)));
+  EXPECT_TRUE(cache.isFailed(kIfIndex, dst1));
+  EXPECT_FALSE(cache.update(buildNeighbor(dst1, NUD_FAILED)));
+
+  // Recovered
+  EXPECT_TRUE(cache.update(buildNeighbor(dst1, NUD_REACHABLE)));
+  EXPECT_FALSE(cache.isFailed(kIfIndex, dst1));
+
+  // Failed entry garbage collected by kernel is forgotten
+  EXPECT_TRUE(cache.update(buildNeighbor(dst2, NUD_FAILED, true)));
+  EXPECT_FALSE(cache.isFailed(kIfIndex, dst2));
+  EXPECT_EQ(1, cache.size());
+}
+
 TEST(NetlinkTypes, LinkTypeBaseTest) {
   const std::string linkName("iface");
   unsigned int flags = 0x0 | IFF_RUNNING;
@@ -653,6 +743,91 @@ TEST(NetlinkTypes, RuleTypeBaseTest) {
   EXPECT_EQ(priority, rule.getPriority());
 }
 
+TEST(NetlinkTypes, MessagePoolTest) {
+  auto& pool = NetlinkMessagePool::getInstance();
+  const auto before = pool.getStats();
+
+  // Buffer of destroyed message is re-used, and zeroed, by the next one
+  struct nlmsghdr* msgPtr{nullptr};
+  {
+    auto msg = std::make_unique<NetlinkRouteMessage>();
+    msgPtr = msg->getMessagePtr();
+    msgPtr->nlmsg_len = kMaxNlPayloadSize;
+    EXPECT_EQ(before.numInUse + 1, pool.getStats().numInUse);
+    msg->setReturnStatus(0);
+  }
+  EXPECT_EQ(before.numInUse, pool.getStats().numInUse);
+  EXPECT_LE(1, pool.getStats().numFree);
+
+  {
+    auto msg = std::make_unique<NetlinkRouteMessage>();
+    EXPECT_EQ(msgPtr, msg->getMessagePtr());
+    EXPECT_EQ(0, msg->getDataLength());
+    msg->setReturnStatus(0);
+  }
+  EXPECT_EQ(before.numInUse, pool.getStats().numInUse);
+  EXPECT_GE(before.numAllocated + 1, pool.getStats().numAllocated);
+}
+
+TEST(NetlinkTypes, MessageBatchTest) {
+  auto makeBatch = [](size_t numRequests) {
+    auto batch = std::make_shared<NetlinkBatch>(
+        numRequests, std::unordered_set<int>{EEXIST});
+    std::vector<std::unique_ptr<NetlinkRouteMessage>> msgs;
+    for (size_t i = 0; i < numRequests; ++i) {
+      msgs.emplace_back(std::make_unique<NetlinkRouteMessage>());
+      msgs.back()->setBatch(batch, i);
+    }
+    return std::make_pair(batch->getSemiFuture(), std::move(msgs));
+  };
+
+  // empty batch is complete right away
+  EXPECT_TRUE(makeBatch(0).first.isReady());
+
+  // complete once all requests are, ignored errors don't fail it
+  {
+    auto [future, msgs] = makeBatch(2);
+    msgs.at(1)->setReturnStatus(-EEXIST);
+    EXPECT_FALSE(future.isReady());
+    msgs.at(0)->setReturnStatus(0);
+    EXPECT_NO_THROW(std::move(future).get());
+  }
+
+  // fails with error of the first failed request, in batch order
+  {
+    auto [future, msgs] = makeBatch(3);
+    msgs.at(2)->setReturnStatus(-ENOENT);
+    msgs.at(1)->setErrorMessage("Invalid prefix for given prefix length");
+    msgs.at(1)->setReturnStatus(-EINVAL);
+    msgs.at(0)->setReturnStatus(0);
+    try {
+      std::move(future).get();
+      FAIL() << "Batch should fail";
+    } catch (NlBatchException const& e) {
+      EXPECT_NE(
+          std::string::npos,
+          std::string(e.what()).find(fmt::format("Error({})", EINVAL)));
+      ASSERT_EQ(2, e.getErrors().size());
+      EXPECT_EQ(1, e.getErrors().at(0).index);
+      EXPECT_EQ(EINVAL, e.getErrors().at(0).error);
+      EXPECT_EQ(
+          "Invalid prefix for given prefix length",
+          e.getErrors().at(0).message);
+      EXPECT_EQ(2, e.getErrors().at(1).index);
+      EXPECT_EQ(ENOENT, e.getErrors().at(1).error);
+    }
+  }
+}
+
+TEST(NetlinkTypes, ErrorClassTest) {
+  EXPECT_EQ(NlErrorClass::TRANSIENT, classifyNlError(-ENOBUFS));
+  EXPECT_EQ(NlErrorClass::TRANSIENT, classifyNlError(ENOMEM));
+  EXPECT_EQ(NlErrorClass::PERMANENT, classifyNlError(-EINVAL));
+  EXPECT_EQ(NlErrorClass::PERMANENT, classifyNlError(-ENETUNREACH));
+  EXPECT_EQ(NlErrorClass::FATAL, classifyNlError(-ENOENT));
+  EXPECT_EQ(NlErrorClass::FATAL, classifyNlError(-EPERM));
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -13,11 +13,21 @@
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 #include <openr/common/OpenrEventBase.h>
+#include <openr/nl/NeighborCache.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
 #include <openr/platform/NetlinkFibHandler.h>
 
 DEFINE_int32(
     fib_thrift_port, 60100, "Thrift server port for the NetlinkFibHandler");
+DEFINE_bool(
+    enable_nexthop_objects,
+    false,
+    "Program ECMP unicast routes with nexthop group objects (Linux 5.3+)");
+DEFINE_bool(
+    enable_neighbor_pruning,
+    false,
+    "Prune next-hops of unicast routes whose ARP/ND resolution failed in "
+    "kernel, as long as routes have other next-hops");
 
 using openr::NetlinkFibHandler;
 
@@ -37,8 +47,12 @@ main(int argc, char** argv) {
   auto nlEvb = std::make_unique<folly::EventBase>();
   openr::messaging::ReplicateQueue<openr::fbnl::NetlinkEvent>
       netlinkEventsQueue;
+  // only neighbor events are read, for neighbor pruning
   auto nlSock = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
-      nlEvb.get(), netlinkEventsQueue);
+      nlEvb.get(),
+      netlinkEventsQueue,
+      false /* enableIPv6RouteReplaceSemantics */,
+      FLAGS_enable_neighbor_pruning ? RTMGRP_NEIGH : 0 /* eventGroups */);
   allThreads.emplace_back(std::thread([&nlEvb]() {
     LOG(INFO) << "Starting NetlinkProtolSocketEvl thread...";
     folly::setThreadName("NetlinkProtolSocketEvl");
@@ -47,8 +61,46 @@ main(int argc, char** argv) {
   }));
   nlEvb->waitUntilRunning();
 
+  // Seed neighbor cache with kernel neighbor table, events received
+  // meanwhile are queued and applied on top of it
+  std::unique_ptr<openr::fbnl::NeighborCache> neighborCache;
+  std::optional<openr::messaging::RQueue<openr::fbnl::NetlinkEvent>>
+      neighborEventsReader;
+  if (FLAGS_enable_neighbor_pruning) {
+    neighborEventsReader = netlinkEventsQueue.getReader();
+    neighborCache = std::make_unique<openr::fbnl::NeighborCache>();
+    auto neighbors = nlSock->getAllNeighbors().get();
+    if (neighbors.hasValue()) {
+      neighborCache->reset(neighbors.value());
+      LOG(INFO) << "Loaded " << neighborCache->size() << " kernel neighbors";
+    } else {
+      LOG(ERROR) << "Failed fetching kernel neighbors, error "
+                 << neighbors.error();
+    }
+  }
+
   apache::thrift::ThriftServer linuxFibAgentServer;
-  auto fibHandler = std::make_shared<NetlinkFibHandler>(nlSock.get());
+  auto fibHandler = std::make_shared<NetlinkFibHandler>(
+      nlSock.get(), FLAGS_enable_nexthop_objects, neighborCache.get());
+
+  // start neighbor events reader thread
+  if (neighborCache) {
+    allThreads.emplace_back(std::thread(
+        [fibHandler, reader = std::move(*neighborEventsReader)]() mutable {
+          folly::setThreadName("NeighborEvents");
+          while (true) {
+            auto maybeEvent = reader.get();
+            if (maybeEvent.hasError()) {
+              break;
+            }
+            if (auto* neighbor =
+                    std::get_if<openr::fbnl::Neighbor>(&maybeEvent.value())) {
+              fibHandler->processNeighborEvent(*neighbor);
+            }
+          }
+          LOG(INFO) << "Neighbor events reader stopped.";
+        }));
+  }
 
   // start FibService thread
   auto fibThriftThread = std::thread([fibHandler, &linuxFibAgentServer]() {
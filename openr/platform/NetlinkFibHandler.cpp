@@ -10,10 +10,14 @@
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <set>
 #include <thread>
 #include <utility>
 
+#include <fb303/ServiceData.h>
+#include <fmt/core.h>
 #include <folly/Format.h>
+#include <folly/executors/InlineExecutor.h>
 #include <folly/gen/Base.h>
 
 #include <openr/common/NetworkUtil.h>
@@ -21,6 +25,8 @@
 #include <openr/if/gen-cpp2/Platform_constants.h>
 #include <openr/platform/NetlinkFibHandler.h>
 
+namespace fb303 = facebook::fb303;
+
 namespace openr {
 
 namespace {
@@ -34,17 +40,254 @@ const uint8_t kMaxRouteProtocolId = 253;
 
 template <typename T>
 folly::SemiFuture<T>
-createSemiFutureWithClientIdError() {
+createSemiFutureWithError(const std::string& error) {
   auto [p, sf] = folly::makePromiseContract<T>();
-  p.setException(fbnl::NlException("Invalid clientId or protocol mapping"));
+  p.setException(fbnl::NlException(error));
   return std::move(sf);
 }
 
+template <typename T>
+folly::SemiFuture<T>
+createSemiFutureWithClientIdError() {
+  return createSemiFutureWithError<T>("Invalid clientId or protocol mapping");
+}
+
+// Whether table can be programmed with VRF APIs. Main table has its own APIs,
+// local and unspecified ones are reserved
+bool
+isVrfTable(int32_t table) {
+  return table > RT_TABLE_UNSPEC and table != RT_TABLE_MAIN and
+      table != RT_TABLE_LOCAL;
+}
+
+template <typename Map>
+std::optional<int32_t>
+findInvalidVrfTable(const Map& tables) {
+  for (const auto& [table, _] : tables) {
+    if (not isVrfTable(table)) {
+      return table;
+    }
+  }
+  return std::nullopt;
+}
+
+// Filter for routes of protocol in all tables of address family
+fbnl::Route
+createAllTablesRouteFilter(const folly::IPAddress& family, uint8_t protocol) {
+  fbnl::RouteBuilder builder;
+  builder.setDestination({family, 0})
+      .setProtocolId(protocol)
+      .setType(RTN_UNSPEC)
+      .setRouteTable(RT_TABLE_UNSPEC);
+  return builder.build();
+}
+
+// Key of unicast route in VRF tables
+using TableRouteKey = std::pair<uint32_t, folly::CIDRNetwork>;
+
+// Combine result of routes programming with one of nexthop objects
+folly::SemiFuture<folly::Unit>
+collectWithNexthopResults(
+    folly::SemiFuture<folly::Unit> routesResult,
+    std::vector<folly::SemiFuture<int>> nexthopResults) {
+  if (nexthopResults.empty()) {
+    return routesResult;
+  }
+  return folly::collect(
+             std::move(routesResult),
+             fbnl::NetlinkProtocolSocket::collectReturnStatus(
+                 std::move(nexthopResults), {EEXIST, ESRCH}))
+      .deferValue([](auto&&) {});
+}
+
+// Logging representation of route key
+std::string
+routeKeyToString(const folly::CIDRNetwork& prefix) {
+  return folly::IPAddress::networkToString(prefix);
+}
+
+std::string
+routeKeyToString(uint32_t label) {
+  return std::to_string(label);
+}
+
+std::string
+routeKeyToString(const TableRouteKey& key) {
+  return fmt::format(
+      "{} table {}", folly::IPAddress::networkToString(key.second), key.first);
+}
+
+/**
+ * State of syncing one route table (IPv4, IPv6 or MPLS) with kernel, shared
+ * by the stages of sync. New routes are sorted by key once, and routes
+ * streamed from kernel are matched against them by binary search. New routes
+ * not matched with an equal kernel route are programmed, unmatched kernel
+ * routes are stale. Tables are synced independently of each other.
+ */
+template <typename Key>
+struct RouteTableSync {
+  RouteTableSync(
+      std::string name, std::vector<std::pair<Key, fbnl::Route>> routes)
+      : name(std::move(name)), newRoutes(std::move(routes)) {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // Keep the last of routes with same key
+    std::stable_sort(
+        newRoutes.begin(),
+        newRoutes.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    size_t numRoutes = 0;
+    for (size_t i = 0; i < newRoutes.size(); ++i) {
+      if (i + 1 < newRoutes.size() and
+          newRoutes[i].first == newRoutes[i + 1].first) {
+        continue;
+      }
+      if (numRoutes != i) {
+        newRoutes[numRoutes] = std::move(newRoutes[i]);
+      }
+      ++numRoutes;
+    }
+    newRoutes.erase(newRoutes.begin() + numRoutes, newRoutes.end());
+    inKernel.resize(newRoutes.size(), false);
+    diffTime = std::chrono::steady_clock::now() - startTime;
+  }
+
+  // Match route streamed from kernel. Invoked in netlink event-base
+  void
+  diff(fbnl::Route&& route) {
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto key = getKey(route);
+    auto it = std::lower_bound(
+        newRoutes.begin(),
+        newRoutes.end(),
+        key,
+        [](const auto& entry, const Key& key) { return entry.first < key; });
+    if (it == newRoutes.end() or it->first != key) {
+      staleRoutes.emplace_back(std::move(route));
+    } else if (it->second == route) {
+      // Existing route is same as the one we're trying to add. SKIP
+      inKernel[it - newRoutes.begin()] = true;
+    } else {
+      LOG(INFO) << "Updating " << name << " route \n[OLD] " << route.str();
+    }
+    diffTime += std::chrono::steady_clock::now() - startTime;
+  }
+
+  // Add new routes or replace existing ones, and delete stale routes
+  std::vector<folly::SemiFuture<int>>
+  program(fbnl::NetlinkProtocolSocket* nlSock) {
+    programStartTime = std::chrono::steady_clock::now();
+    dumpTime = programStartTime - dumpStartTime;
+
+    std::vector<folly::SemiFuture<int>> result;
+    for (size_t i = 0; i < newRoutes.size(); ++i) {
+      if (inKernel[i]) {
+        continue;
+      }
+      LOG(INFO) << "Adding " << name << " route \n[NEW]"
+                << newRoutes[i].second.str();
+      result.emplace_back(nlSock->addRoute(newRoutes[i].second));
+    }
+    for (auto& nlRoute : staleRoutes) {
+      LOG(INFO) << "Deleting " << name << " route "
+                << routeKeyToString(getKey(nlRoute));
+      result.emplace_back(nlSock->deleteRoute(nlRoute));
+    }
+    return result;
+  }
+
+  // Log and export phase timings, once programming completed
+  void
+  report() const {
+    using namespace std::chrono;
+    const auto programTime = steady_clock::now() - programStartTime;
+    const auto toMs = [](auto duration) {
+      return duration_cast<milliseconds>(duration).count();
+    };
+    LOG(INFO) << "Synced " << name << " routes, numRoutes=" << newRoutes.size()
+              << ", numStaleRoutes=" << staleRoutes.size()
+              << ". Timings dump=" << toMs(dumpTime)
+              << "ms, diff=" << toMs(diffTime)
+              << "ms, program=" << toMs(programTime) << "ms";
+    const auto prefix = fmt::format("fibhandler.sync.{}.", name);
+    fb303::fbData->addStatValue(
+        prefix + "dump_ms", toMs(dumpTime), fb303::AVG);
+    fb303::fbData->addStatValue(
+        prefix + "diff_ms", toMs(diffTime), fb303::AVG);
+    fb303::fbData->addStatValue(
+        prefix + "program_ms", toMs(programTime), fb303::AVG);
+  }
+
+  static Key getKey(const fbnl::Route& route);
+
+  const std::string name;
+
+  // New routes sorted by key, and whether kernel has them already
+  std::vector<std::pair<Key, fbnl::Route>> newRoutes;
+  std::vector<bool> inKernel;
+
+  // Kernel routes not in new routes
+  std::vector<fbnl::Route> staleRoutes;
+
+  // Phase timings. Diff covers sorting of new routes and matching of streamed
+  // routes, which runs interleaved with dump
+  std::chrono::steady_clock::time_point dumpStartTime;
+  std::chrono::steady_clock::time_point programStartTime;
+  std::chrono::steady_clock::duration dumpTime{0};
+  std::chrono::steady_clock::duration diffTime{0};
+};
+
+template <>
+folly::CIDRNetwork
+RouteTableSync<folly::CIDRNetwork>::getKey(const fbnl::Route& route) {
+  return route.getDestination();
+}
+
+template <>
+uint32_t
+RouteTableSync<uint32_t>::getKey(const fbnl::Route& route) {
+  return route.getMplsLabel().value();
+}
+
+template <>
+TableRouteKey
+RouteTableSync<TableRouteKey>::getKey(const fbnl::Route& route) {
+  return {route.getRouteTable(), route.getDestination()};
+}
+
+// Dump route table, and program it once dump completed, independently of
+// other tables. `dumpRoutes` streams kernel routes of table to sync
+template <typename Key, typename DumpFn>
+folly::SemiFuture<folly::Unit>
+syncRouteTable(
+    fbnl::NetlinkProtocolSocket* nlSock,
+    std::shared_ptr<RouteTableSync<Key>> sync,
+    DumpFn&& dumpRoutes,
+    std::unordered_set<int> ignoredErrors) {
+  sync->dumpStartTime = std::chrono::steady_clock::now();
+  return dumpRoutes()
+      .deferValue([nlSock, sync, ignoredErrors = std::move(ignoredErrors)](
+                      int error) mutable {
+        if (error != 0) {
+          throw fbnl::NlException(
+              fmt::format("Failed fetching {} routes", sync->name), error);
+        }
+        return fbnl::NetlinkProtocolSocket::collectReturnStatus(
+            sync->program(nlSock), std::move(ignoredErrors));
+      })
+      .deferValue([sync](folly::Unit) { sync->report(); });
+}
+
 } // namespace
 
-NetlinkFibHandler::NetlinkFibHandler(fbnl::NetlinkProtocolSocket* nlSock)
+NetlinkFibHandler::NetlinkFibHandler(
+    fbnl::NetlinkProtocolSocket* nlSock,
+    bool enableNexthopObjects,
+    fbnl::NeighborCache* neighborCache)
     : facebook::fb303::BaseService("openr"),
       nlSock_(nlSock),
+      enableNexthopObjects_(enableNexthopObjects),
+      neighborCache_(neighborCache),
       startTime_(std::chrono::duration_cast<std::chrono::seconds>(
                      std::chrono::system_clock::now().time_since_epoch())
                      .count()) {
@@ -112,14 +355,33 @@ NetlinkFibHandler::semifuture_addUnicastRoutes(
   CHECK(protocol.has_value());
   LOG(INFO) << "Adding/Updating unicast routes of client "
             << getClientName(clientId) << ", numRoutes=" << routes->size();
+  updateClientUnicastRoutes(clientId, *routes, false /* replace */);
 
-  // Add routes and return a collected semifuture
-  std::vector<folly::SemiFuture<int>> result;
+  // Add routes in batch and return the collected semifuture. Routes with
+  // equal next-hops share them
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(routes->size());
+  fbnl::NextHopSetPool nextHopSetPool;
   for (auto& route : *routes) {
-    result.emplace_back(nlSock_->addRoute(buildRoute(route, protocol.value())));
+    nlRoutes.emplace_back(buildRoute(route, protocol.value()));
+    nlRoutes.back().poolNextHops(nextHopSetPool);
+  }
+  if (not enableNexthopObjects_) {
+    return addRoutesWithRecovery(std::move(nlRoutes));
   }
-  return fbnl::NetlinkProtocolSocket::collectReturnStatus(
-      std::move(result), {EEXIST});
+
+  // Refer ECMP routes to nexthop groups. New objects are enqueued ahead of
+  // routes referring to them, and stale ones are deleted after.
+  std::vector<folly::SemiFuture<int>> nexthopResults;
+  std::vector<uint32_t> staleNexthopIds;
+  auto state = nexthopObjects_.wlock();
+  for (auto& nlRoute : nlRoutes) {
+    assignNexthopGroup(*state, nlRoute, nexthopResults, staleNexthopIds);
+  }
+  auto routesResult = nlSock_->addRoutes(nlRoutes, {EEXIST});
+  deleteNexthops(staleNexthopIds, nexthopResults);
+  return collectWithNexthopResults(
+      std::move(routesResult), std::move(nexthopResults));
 }
 
 folly::SemiFuture<folly::Unit>
@@ -132,17 +394,32 @@ NetlinkFibHandler::semifuture_deleteUnicastRoutes(
   CHECK(protocol.has_value());
   LOG(INFO) << "Deleting unicast routes of client " << getClientName(clientId)
             << ", numRoutes=" << prefixes->size();
+  deleteClientUnicastRoutes(clientId, *prefixes);
 
-  // Delete routes and return a collected semifuture
-  std::vector<folly::SemiFuture<int>> result;
+  // Delete routes in batch and return the collected semifuture
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(prefixes->size());
   for (auto& prefix : *prefixes) {
     fbnl::RouteBuilder rtBuilder;
     rtBuilder.setDestination(toIPNetwork(prefix));
     rtBuilder.setProtocolId(protocol.value());
-    result.emplace_back(nlSock_->deleteRoute(rtBuilder.build()));
+    nlRoutes.emplace_back(rtBuilder.build());
   }
-  return fbnl::NetlinkProtocolSocket::collectReturnStatus(
-      std::move(result), {ESRCH});
+  if (not enableNexthopObjects_) {
+    return nlSock_->deleteRoutes(nlRoutes, {ESRCH});
+  }
+
+  // Delete nexthop objects no longer referred to, after routes
+  std::vector<folly::SemiFuture<int>> nexthopResults;
+  std::vector<uint32_t> staleNexthopIds;
+  auto state = nexthopObjects_.wlock();
+  for (auto& nlRoute : nlRoutes) {
+    releaseNexthopGroup(*state, nlRoute.getDestination(), staleNexthopIds);
+  }
+  auto routesResult = nlSock_->deleteRoutes(nlRoutes, {ESRCH});
+  deleteNexthops(staleNexthopIds, nexthopResults);
+  return collectWithNexthopResults(
+      std::move(routesResult), std::move(nexthopResults));
 }
 
 folly::SemiFuture<folly::Unit>
@@ -156,14 +433,51 @@ NetlinkFibHandler::semifuture_addMplsRoutes(
   LOG(INFO) << "Adding/Updating mpls routes of client "
             << getClientName(clientId) << ", numRoutes=" << routes->size();
 
-  // Add routes and return a collected semifuture
-  std::vector<folly::SemiFuture<int>> result;
+  // Add routes in batch and return the collected semifuture
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(routes->size());
+  fbnl::NextHopSetPool nextHopSetPool;
   for (auto& route : *routes) {
-    result.emplace_back(
-        nlSock_->addRoute(buildMplsRoute(route, protocol.value())));
+    nlRoutes.emplace_back(buildMplsRoute(route, protocol.value()));
+    nlRoutes.back().poolNextHops(nextHopSetPool);
   }
-  return fbnl::NetlinkProtocolSocket::collectReturnStatus(
-      std::move(result), {EEXIST});
+  return addRoutesWithRecovery(std::move(nlRoutes));
+}
+
+folly::SemiFuture<folly::Unit>
+NetlinkFibHandler::addRoutesWithRecovery(std::vector<fbnl::Route> nlRoutes) {
+  auto result = nlSock_->addRoutes(nlRoutes, {EEXIST});
+  return std::move(result).deferError(
+      folly::tag_t<fbnl::NlBatchException>{},
+      [this, nlRoutes = std::move(nlRoutes)](
+          fbnl::NlBatchException const& e) -> folly::SemiFuture<folly::Unit> {
+        std::vector<fbnl::Route> retryRoutes;
+        for (auto const& error : e.getErrors()) {
+          auto const& nlRoute = nlRoutes.at(error.index);
+          switch (fbnl::classifyNlError(error.error)) {
+          case fbnl::NlErrorClass::TRANSIENT:
+            retryRoutes.emplace_back(nlRoute);
+            break;
+          case fbnl::NlErrorClass::PERMANENT:
+            LOG(ERROR) << "Skipping route rejected by kernel with error "
+                       << folly::errnoStr(error.error) << " " << error.message
+                       << ". " << nlRoute.str();
+            fb303::fbData->addStatValue(
+                "fibagent.routes.rejected", 1, fb303::SUM);
+            break;
+          case fbnl::NlErrorClass::FATAL:
+            throw e;
+          }
+        }
+        if (retryRoutes.empty()) {
+          return folly::SemiFuture<folly::Unit>(folly::Unit());
+        }
+        LOG(WARNING) << "Retrying " << retryRoutes.size()
+                     << " routes failed for lack of kernel resources";
+        fb303::fbData->addStatValue(
+            "fibagent.routes.retried", retryRoutes.size(), fb303::SUM);
+        return nlSock_->addRoutes(retryRoutes, {EEXIST});
+      });
 }
 
 folly::SemiFuture<folly::Unit>
@@ -177,16 +491,16 @@ NetlinkFibHandler::semifuture_deleteMplsRoutes(
   LOG(INFO) << "Deleting mpls routes of client " << getClientName(clientId)
             << ", numRoutes=" << topLabels->size();
 
-  // Delete routes and return a collected semifuture
-  std::vector<folly::SemiFuture<int>> result;
+  // Delete routes in batch and return the collected semifuture
+  std::vector<fbnl::Route> nlRoutes;
+  nlRoutes.reserve(topLabels->size());
   for (auto& topLabel : *topLabels) {
     fbnl::RouteBuilder rtBuilder;
     rtBuilder.setMplsLabel(topLabel);
     rtBuilder.setProtocolId(protocol.value());
-    result.emplace_back(nlSock_->deleteRoute(rtBuilder.build()));
+    nlRoutes.emplace_back(rtBuilder.build());
   }
-  return fbnl::NetlinkProtocolSocket::collectReturnStatus(
-      std::move(result), {ESRCH});
+  return nlSock_->deleteRoutes(nlRoutes, {ESRCH});
 }
 
 folly::SemiFuture<folly::Unit>
@@ -200,76 +514,298 @@ NetlinkFibHandler::semifuture_syncFib(
   CHECK(protocol.has_value());
   LOG(INFO) << "Syncing unicast FIB for client " << getClientName(clientId)
             << ", numRoutes=" << unicastRoutes->size();
+  updateClientUnicastRoutes(clientId, *unicastRoutes, true /* replace */);
+
+  // Split new routes per table. IPv4 and IPv6 tables are dumped, diffed and
+  // programmed independently, each table is programmed as soon as its dump
+  // completes, while other table is still dumped.
+  std::vector<std::pair<folly::CIDRNetwork, fbnl::Route>> v4Routes;
+  std::vector<std::pair<folly::CIDRNetwork, fbnl::Route>> v6Routes;
+  fbnl::NextHopSetPool nextHopSetPool;
+  for (auto& route : *unicastRoutes) {
+    auto prefix = toIPNetwork(*route.dest_ref());
+    auto& routes = prefix.first.isV4() ? v4Routes : v6Routes;
+    routes.emplace_back(prefix, buildRoute(route, protocol.value()));
+    routes.back().second.poolNextHops(nextHopSetPool);
+  }
+  auto v4Sync = std::make_shared<RouteTableSync<folly::CIDRNetwork>>(
+      "ipv4", std::move(v4Routes));
+  auto v6Sync = std::make_shared<RouteTableSync<folly::CIDRNetwork>>(
+      "ipv6", std::move(v6Routes));
+
+  // Refer ECMP routes to nexthop groups, and release groups of routes which
+  // are not part of FIB anymore
+  // NOTE: Routes referring to new groups are programmed after dump, without
+  // the lock. Calls modifying routes of client must not overlap with sync.
+  std::vector<folly::SemiFuture<int>> nexthopResults;
+  std::vector<uint32_t> staleNexthopIds;
+  if (enableNexthopObjects_) {
+    auto state = nexthopObjects_.wlock();
+    std::unordered_set<folly::CIDRNetwork> prefixes;
+    for (auto* sync : {v4Sync.get(), v6Sync.get()}) {
+      for (auto& [prefix, nlRoute] : sync->newRoutes) {
+        assignNexthopGroup(*state, nlRoute, nexthopResults, staleNexthopIds);
+        prefixes.emplace(prefix);
+      }
+    }
+    std::vector<folly::CIDRNetwork> stalePrefixes;
+    for (auto& [prefix, _] : state->routeGroups) {
+      if (not prefixes.count(prefix)) {
+        stalePrefixes.emplace_back(prefix);
+      }
+    }
+    for (auto& prefix : stalePrefixes) {
+      releaseNexthopGroup(*state, prefix, staleNexthopIds);
+    }
+  }
 
-  // SemiFuture vector for collecting return values of all API calls
-  std::vector<folly::SemiFuture<int>> result;
+  // NOTE: Callbacks are invoked in netlink event-base
+  auto diffRoute = [](auto sync) {
+    return [sync = std::move(sync)](fbnl::Route&& route) {
+      // Linux will report a null next-hop for RTN_BLACKHOLE type while
+      // RIB does not
+      if (route.getType() == RTN_BLACKHOLE) {
+        route.setNextHops({});
+      }
+      sync->diff(std::move(route));
+    };
+  };
+  auto v4Result = syncRouteTable(
+      nlSock_,
+      v4Sync,
+      [&]() {
+        return nlSock_->streamIPv4Routes(protocol.value(), diffRoute(v4Sync));
+      },
+      {EEXIST});
+  auto v6Result = syncRouteTable(
+      nlSock_,
+      v6Sync,
+      [&]() {
+        return nlSock_->streamIPv6Routes(protocol.value(), diffRoute(v6Sync));
+      },
+      {EEXIST});
+
+  // Delete stale nexthop objects once routes of both tables are programmed,
+  // and return collected result
+  // NOTE: We're ignoring EEXIST error code. ESRCH error code must not be
+  // raised because we're deleting route that already exist
+  return folly::collectAll(std::move(v4Result), std::move(v6Result))
+      .deferValue([this,
+                   nexthopResults = std::move(nexthopResults),
+                   staleNexthopIds = std::move(staleNexthopIds)](
+                      auto&& tableResults) mutable {
+        deleteNexthops(staleNexthopIds, nexthopResults);
+        return fbnl::NetlinkProtocolSocket::collectReturnStatus(
+                   std::move(nexthopResults), {EEXIST, ESRCH})
+            .deferValue(
+                [tableResults = std::move(tableResults)](folly::Unit) {
+                  std::get<0>(tableResults).throwUnlessValue();
+                  std::get<1>(tableResults).throwUnlessValue();
+                });
+      });
+}
 
-  // Create set of existing route
-  // NOTE: Synchronous call to retrieve all the routes. We first make both
-  // requests to retrieve IPv4 and IPv6 routes. Subsequently we wait on them
-  // to complete and prepare the map of existing routes
-  std::unordered_map<folly::CIDRNetwork, fbnl::Route> existingRoutes;
+folly::SemiFuture<folly::Unit>
+NetlinkFibHandler::semifuture_addUnicastRoutesInTables(
+    int16_t clientId,
+    std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+        tableRoutes) {
+  const auto protocol = getProtocol(clientId);
+  if (not protocol.has_value()) {
+    return createSemiFutureWithClientIdError<folly::Unit>();
+  }
+  if (auto table = findInvalidVrfTable(*tableRoutes)) {
+    return createSemiFutureWithError<folly::Unit>(
+        fmt::format("Invalid VRF table {}", *table));
+  }
+  LOG(INFO) << "Adding/Updating unicast routes of client "
+            << getClientName(clientId)
+            << " in tables, numTables=" << tableRoutes->size();
+
+  // Add routes of all tables in one batch
+  std::vector<fbnl::Route> nlRoutes;
+  fbnl::NextHopSetPool nextHopSetPool;
   {
-    auto v4Routes = nlSock_->getIPv4Routes(protocol.value()).get();
-    auto v6Routes = nlSock_->getIPv6Routes(protocol.value()).get();
-    if (v4Routes.hasError()) {
-      throw fbnl::NlException("Failed fetching IPv4 routes", v4Routes.error());
-    }
-    if (v6Routes.hasError()) {
-      throw fbnl::NlException("Failed fetching IPv6 routes", v6Routes.error());
-    }
-    for (auto& routesPtr : {&v4Routes, &v6Routes}) {
-      for (auto& route : routesPtr->value()) {
-        const auto prefix = route.getDestination();
-        // Linux will report a null next-hop for RTN_BLACKHOLE type while
-        // RIB does not
-        if (route.getType() == RTN_BLACKHOLE) {
-          route.setNextHops({});
-        }
-        existingRoutes.emplace(prefix, std::move(route));
+    auto clientTables = clientTables_.wlock();
+    for (auto& [table, routes] : *tableRoutes) {
+      (*clientTables)[clientId].emplace(table);
+      for (auto& route : routes) {
+        nlRoutes.emplace_back(buildRoute(route, protocol.value(), table));
+        nlRoutes.back().poolNextHops(nextHopSetPool);
       }
     }
   }
+  return addRoutesWithRecovery(std::move(nlRoutes));
+}
 
-  // Go over the new routes. Add or update
-  std::unordered_set<folly::CIDRNetwork> newPrefixes;
-  for (auto& route : *unicastRoutes) {
-    const auto network = toIPNetwork(*route.dest_ref());
-    newPrefixes.insert(network);
-    auto nlRoute = buildRoute(route, protocol.value());
-    auto it = existingRoutes.find(network);
-    if (it != existingRoutes.end() and it->second == nlRoute) {
-      // Existing route is same as the one we're trying to add. SKIP
-      continue;
-    }
-    if (it != existingRoutes.end()) {
-      LOG(INFO) << "Updating unicast-route "
-                << "\n[OLD] " << it->second.str() << "\n[NEW] "
-                << nlRoute.str();
-    } else {
-      LOG(INFO) << "Adding unicast-route \n[NEW]" << nlRoute.str();
+folly::SemiFuture<folly::Unit>
+NetlinkFibHandler::semifuture_deleteUnicastRoutesInTables(
+    int16_t clientId,
+    std::unique_ptr<std::map<int32_t, std::vector<thrift::IpPrefix>>>
+        tablePrefixes) {
+  const auto protocol = getProtocol(clientId);
+  if (not protocol.has_value()) {
+    return createSemiFutureWithClientIdError<folly::Unit>();
+  }
+  if (auto table = findInvalidVrfTable(*tablePrefixes)) {
+    return createSemiFutureWithError<folly::Unit>(
+        fmt::format("Invalid VRF table {}", *table));
+  }
+  LOG(INFO) << "Deleting unicast routes of client " << getClientName(clientId)
+            << " in tables, numTables=" << tablePrefixes->size();
+
+  // Delete routes of all tables in one batch
+  std::vector<fbnl::Route> nlRoutes;
+  for (auto& [table, prefixes] : *tablePrefixes) {
+    for (auto& prefix : prefixes) {
+      fbnl::RouteBuilder rtBuilder;
+      rtBuilder.setDestination(toIPNetwork(prefix))
+          .setProtocolId(protocol.value())
+          .setRouteTable(table);
+      nlRoutes.emplace_back(rtBuilder.build());
     }
-    // Add new route or replace existing one
-    result.emplace_back(nlSock_->addRoute(nlRoute));
   }
+  return nlSock_->deleteRoutes(nlRoutes, {ESRCH});
+}
 
-  // Go over the old routes to remove stale ones
-  for (auto& [prefix, nlRoute] : existingRoutes) {
-    if (newPrefixes.count(prefix)) {
-      // not a stale route
-      continue;
+folly::SemiFuture<folly::Unit>
+NetlinkFibHandler::semifuture_syncFibTables(
+    int16_t clientId,
+    std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+        tableRoutes) {
+  const auto protocol = getProtocol(clientId);
+  if (not protocol.has_value()) {
+    return createSemiFutureWithClientIdError<folly::Unit>();
+  }
+  if (auto table = findInvalidVrfTable(*tableRoutes)) {
+    return createSemiFutureWithError<folly::Unit>(
+        fmt::format("Invalid VRF table {}", *table));
+  }
+
+  // Tables to sync are given ones, and ones previously programmed by client
+  // which are missing, all of their routes are stale
+  auto tables = std::make_shared<std::unordered_set<uint32_t>>();
+  {
+    auto clientTables = clientTables_.wlock();
+    auto& knownTables = (*clientTables)[clientId];
+    tables->insert(knownTables.begin(), knownTables.end());
+    knownTables.clear();
+    for (auto& [table, _] : *tableRoutes) {
+      knownTables.emplace(table);
+      tables->emplace(table);
     }
-    // Delete stale route
-    LOG(INFO) << "Deleting unicast-route "
-              << folly::IPAddress::networkToString(prefix);
-    result.emplace_back(nlSock_->deleteRoute(nlRoute));
   }
+  LOG(INFO) << "Syncing unicast FIB tables for client "
+            << getClientName(clientId) << ", numTables=" << tables->size();
+
+  // Routes of all tables are synced together, per address family. Each
+  // family is dumped once for all tables, instead of once per table, and
+  // kernel routes of other tables are skipped.
+  std::vector<std::pair<TableRouteKey, fbnl::Route>> v4Routes;
+  std::vector<std::pair<TableRouteKey, fbnl::Route>> v6Routes;
+  fbnl::NextHopSetPool nextHopSetPool;
+  for (auto& [table, routes] : *tableRoutes) {
+    for (auto& route : routes) {
+      auto prefix = toIPNetwork(*route.dest_ref());
+      auto& familyRoutes = prefix.first.isV4() ? v4Routes : v6Routes;
+      familyRoutes.emplace_back(
+          TableRouteKey{table, prefix},
+          buildRoute(route, protocol.value(), table));
+      familyRoutes.back().second.poolNextHops(nextHopSetPool);
+    }
+  }
+  auto v4Sync = std::make_shared<RouteTableSync<TableRouteKey>>(
+      "ipv4_vrf", std::move(v4Routes));
+  auto v6Sync = std::make_shared<RouteTableSync<TableRouteKey>>(
+      "ipv6_vrf", std::move(v6Routes));
+
+  // NOTE: Callbacks are invoked in netlink event-base
+  auto diffRoute = [tables](auto sync) {
+    return [sync = std::move(sync), tables](fbnl::Route&& route) {
+      if (not tables->count(route.getRouteTable())) {
+        return;
+      }
+      // Linux will report a null next-hop for RTN_BLACKHOLE type while
+      // RIB does not
+      if (route.getType() == RTN_BLACKHOLE) {
+        route.setNextHops({});
+      }
+      sync->diff(std::move(route));
+    };
+  };
+  auto v4Result = syncRouteTable(
+      nlSock_,
+      v4Sync,
+      [&]() {
+        return nlSock_->streamRoutes(
+            createAllTablesRouteFilter(
+                folly::IPAddressV4("0.0.0.0"), protocol.value()),
+            diffRoute(v4Sync));
+      },
+      {EEXIST});
+  auto v6Result = syncRouteTable(
+      nlSock_,
+      v6Sync,
+      [&]() {
+        return nlSock_->streamRoutes(
+            createAllTablesRouteFilter(
+                folly::IPAddressV6("::"), protocol.value()),
+            diffRoute(v6Sync));
+      },
+      {EEXIST});
+  return folly::collectAll(std::move(v4Result), std::move(v6Result))
+      .deferValue([](auto&& tableResults) {
+        std::get<0>(tableResults).throwUnlessValue();
+        std::get<1>(tableResults).throwUnlessValue();
+      });
+}
 
-  // Return collected result
-  // NOTE: We're ignoring EEXIST error code. ESRCH error code must not be
-  // raised because we're deleting route that already exist
-  return fbnl::NetlinkProtocolSocket::collectReturnStatus(
-      std::move(result), {EEXIST});
+folly::SemiFuture<std::unique_ptr<std::vector<openr::thrift::UnicastRoute>>>
+NetlinkFibHandler::semifuture_getRouteTableByClientInTable(
+    int16_t clientId, int32_t tableId) {
+  using RoutesT = std::unique_ptr<std::vector<openr::thrift::UnicastRoute>>;
+  const auto protocol = getProtocol(clientId);
+  if (not protocol.has_value()) {
+    return createSemiFutureWithClientIdError<RoutesT>();
+  }
+  if (not isVrfTable(tableId)) {
+    return createSemiFutureWithError<RoutesT>(
+        fmt::format("Invalid VRF table {}", tableId));
+  }
+  LOG(INFO) << "Get unicast routes for client " << getClientName(clientId)
+            << " in table " << tableId;
+
+  std::vector<folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>>>
+      results;
+  for (const auto& family :
+       {folly::IPAddress("0.0.0.0"), folly::IPAddress("::")}) {
+    fbnl::RouteBuilder builder;
+    builder.setDestination({family, 0})
+        .setProtocolId(protocol.value())
+        .setType(RTN_UNSPEC)
+        .setRouteTable(tableId);
+    results.emplace_back(nlSock_->getRoutes(builder.build()));
+  }
+  return folly::collectAll(std::move(results))
+      .deferValue(
+          [this](std::vector<
+                 folly::Try<folly::Expected<std::vector<fbnl::Route>, int>>>&&
+                     res) {
+            auto routes = std::make_unique<std::vector<thrift::UnicastRoute>>();
+            for (auto& nlRoutes : res) {
+              if (nlRoutes.value().hasError()) {
+                throw fbnl::NlException(
+                    "Failed fetching routes", nlRoutes.value().error());
+              }
+              for (auto& nlRoute : nlRoutes.value().value()) {
+                thrift::UnicastRoute route;
+                route.dest_ref() = toIpPrefix(nlRoute.getDestination());
+                route.nextHops_ref() = toThriftNextHops(nlRoute.getNextHops());
+                routes->emplace_back(std::move(route));
+              }
+            }
+            return routes;
+          });
 }
 
 folly::SemiFuture<folly::Unit>
@@ -284,57 +820,30 @@ NetlinkFibHandler::semifuture_syncMplsFib(
   LOG(INFO) << "Syncing mpls FIB for client " << getClientName(clientId)
             << ", numRoutes=" << mplsRoutes->size();
 
-  // SemiFuture vector for collecting return values of all API calls
-  std::vector<folly::SemiFuture<int>> result;
-
-  // Create set of existing route
-  // NOTE: Synchronous call to retrieve all the routes
-  std::unordered_map<int32_t, fbnl::Route> existingRoutes;
-  auto nlRoutes = nlSock_->getMplsRoutes(protocol.value()).get();
-  if (nlRoutes.hasError()) {
-    throw fbnl::NlException("Failed fetching IPv6 routes", nlRoutes.error());
-  }
-  for (auto& route : std::move(nlRoutes).value()) {
-    const auto topLabel = route.getMplsLabel().value();
-    existingRoutes.emplace(topLabel, std::move(route));
-  }
-
-  // Go over the new routes. Add or update
-  std::unordered_set<uint32_t> newLabels;
+  // Diff routes streamed from kernel against new routes. See syncFib(...)
+  std::vector<std::pair<uint32_t, fbnl::Route>> routes;
+  routes.reserve(mplsRoutes->size());
+  fbnl::NextHopSetPool nextHopSetPool;
   for (auto& route : *mplsRoutes) {
-    const auto label = *route.topLabel_ref();
-    newLabels.insert(label);
-    auto nlRoute = buildMplsRoute(route, protocol.value());
-    auto it = existingRoutes.find(label);
-    if (it != existingRoutes.end() and it->second == nlRoute) {
-      // Existing route is same as the one we're trying to add. SKIP
-      continue;
-    }
-    if (it != existingRoutes.end()) {
-      LOG(INFO) << "Updating mpls-route "
-                << "\n[OLD] " << it->second.str() << "\n[NEW] "
-                << nlRoute.str();
-    } else {
-      LOG(INFO) << "Adding mpls-route \n[NEW]" << nlRoute.str();
-    }
-    // Add new route or replace existing one
-    result.emplace_back(nlSock_->addRoute(nlRoute));
-  }
-
-  // Go over the old routes to remove stale ones
-  for (auto& [topLabel, nlRoute] : existingRoutes) {
-    if (newLabels.count(topLabel)) {
-      // not a stale route
-      continue;
-    }
-    // Delete stale route
-    LOG(INFO) << "Deleting mpls-route " << *nlRoute.getMplsLabel();
-    result.emplace_back(nlSock_->deleteRoute(nlRoute));
+    routes.emplace_back(
+        *route.topLabel_ref(), buildMplsRoute(route, protocol.value()));
+    routes.back().second.poolNextHops(nextHopSetPool);
   }
+  auto sync =
+      std::make_shared<RouteTableSync<uint32_t>>("mpls", std::move(routes));
+  auto diffRoute = [sync](fbnl::Route&& route) {
+    sync->diff(std::move(route));
+  };
 
   // Return collected result
-  return fbnl::NetlinkProtocolSocket::collectReturnStatus(
-      std::move(result), {EEXIST, ESRCH});
+  return syncRouteTable(
+      nlSock_,
+      sync,
+      [&]() {
+        return nlSock_->streamMplsRoutes(
+            protocol.value(), std::move(diffRoute));
+      },
+      {EEXIST, ESRCH});
 }
 
 int64_t
@@ -511,19 +1020,141 @@ NetlinkFibHandler::buildNextHop(
   }
 }
 
+void
+NetlinkFibHandler::assignNexthopGroup(
+    NexthopObjects& state,
+    fbnl::Route& route,
+    std::vector<folly::SemiFuture<int>>& pendingResults,
+    std::vector<uint32_t>& staleNexthopIds) {
+  const auto& prefix = route.getDestination();
+  const auto& nextHops = route.getNextHops();
+
+  // Only ECMP routes without MPLS action, of distinct members, use groups
+  std::set<NexthopKey> memberKeys;
+  bool isEligible = route.getType() == RTN_UNICAST and nextHops.size() > 1;
+  for (const auto& nh : nextHops) {
+    if (not isEligible) {
+      break;
+    }
+    isEligible = not nh.getLabelAction().has_value() and
+        memberKeys
+            .emplace(
+                route.getProtocolId(),
+                route.getFamily(),
+                nh.getIfIndex(),
+                nh.getGateway())
+            .second;
+  }
+  if (not isEligible) {
+    releaseNexthopGroup(state, prefix, staleNexthopIds);
+    return;
+  }
+
+  // Get members, adding missing ones. Members of existing groups exist, so
+  // new members always belong to a new group which references them.
+  NexthopGroupKey groupKey;
+  groupKey.reserve(nextHops.size());
+  for (const auto& nh : nextHops) {
+    const NexthopKey key{
+        route.getProtocolId(),
+        route.getFamily(),
+        nh.getIfIndex(),
+        nh.getGateway()};
+    auto [it, isNew] = state.nexthops.try_emplace(key);
+    if (isNew) {
+      it->second.id = state.nextId++;
+      state.nexthopKeys.emplace(it->second.id, key);
+      pendingResults.emplace_back(nlSock_->addNexthop(
+          it->second.id, route.getProtocolId(), route.getFamily(), nh));
+    }
+    groupKey.emplace_back(it->second.id, std::max<uint8_t>(nh.getWeight(), 1));
+  }
+  std::sort(groupKey.begin(), groupKey.end());
+
+  // Get group, adding it if missing
+  auto [groupIt, isNewGroup] = state.groups.try_emplace(groupKey);
+  auto& group = groupIt->second;
+  if (isNewGroup) {
+    group.id = state.nextId++;
+    state.groupKeys.emplace(group.id, groupKey);
+    std::vector<fbnl::NexthopGroupMember> members;
+    members.reserve(groupKey.size());
+    for (const auto& [memberId, weight] : groupKey) {
+      ++state.nexthops.at(state.nexthopKeys.at(memberId)).refCount;
+      members.emplace_back(fbnl::NexthopGroupMember{memberId, weight});
+    }
+    pendingResults.emplace_back(
+        nlSock_->addNexthopGroup(group.id, route.getProtocolId(), members));
+  }
+
+  // Refer to group, then release the previous one. Releasing first could
+  // delete the group route refers to already
+  ++group.refCount;
+  releaseNexthopGroup(state, prefix, staleNexthopIds);
+  state.routeGroups.emplace(prefix, group.id);
+  route.setNhId(group.id);
+}
+
+void
+NetlinkFibHandler::releaseNexthopGroup(
+    NexthopObjects& state,
+    const folly::CIDRNetwork& prefix,
+    std::vector<uint32_t>& staleNexthopIds) {
+  auto routeIt = state.routeGroups.find(prefix);
+  if (routeIt == state.routeGroups.end()) {
+    return;
+  }
+  const auto groupId = routeIt->second;
+  state.routeGroups.erase(routeIt);
+
+  auto groupKeyIt = state.groupKeys.find(groupId);
+  auto groupIt = state.groups.find(groupKeyIt->second);
+  if (--groupIt->second.refCount) {
+    return;
+  }
+
+  // Delete group, then members no longer referred to by any group
+  staleNexthopIds.emplace_back(groupId);
+  for (const auto& [memberId, _] : groupKeyIt->second) {
+    auto nexthopKeyIt = state.nexthopKeys.find(memberId);
+    auto nexthopIt = state.nexthops.find(nexthopKeyIt->second);
+    if (--nexthopIt->second.refCount == 0) {
+      staleNexthopIds.emplace_back(memberId);
+      state.nexthops.erase(nexthopIt);
+      state.nexthopKeys.erase(nexthopKeyIt);
+    }
+  }
+  state.groups.erase(groupIt);
+  state.groupKeys.erase(groupKeyIt);
+}
+
+void
+NetlinkFibHandler::deleteNexthops(
+    const std::vector<uint32_t>& staleNexthopIds,
+    std::vector<folly::SemiFuture<int>>& pendingResults) {
+  for (const auto id : staleNexthopIds) {
+    pendingResults.emplace_back(nlSock_->deleteNexthop(id));
+  }
+}
+
 fbnl::Route
-NetlinkFibHandler::buildRoute(const thrift::UnicastRoute& route, int protocol) {
+NetlinkFibHandler::buildRoute(
+    const thrift::UnicastRoute& route, int protocol, uint32_t table) {
   // Create route object
   fbnl::RouteBuilder rtBuilder;
   rtBuilder.setDestination(toIPNetwork(*route.dest_ref()))
       .setProtocolId(protocol)
       .setPriority(protocolToPriority(protocol))
+      .setRouteTable(table)
       .setFlags(0)
       .setValid(true);
 
   if (route.nextHops_ref()->empty()) {
     // Empty nexthops is same as DROP (aka RTN_BLACKHOLE)
     rtBuilder.setType(RTN_BLACKHOLE);
+  } else if (neighborCache_ and table == RT_TABLE_MAIN) {
+    // Add nexthops, without unresolved ones
+    buildNextHop(rtBuilder, pruneFailedNextHops(route));
   } else {
     // Add nexthops
     buildNextHop(rtBuilder, *route.nextHops_ref());
@@ -532,6 +1163,114 @@ NetlinkFibHandler::buildRoute(const thrift::UnicastRoute& route, int protocol) {
   return rtBuilder.build();
 }
 
+std::vector<thrift::NextHopThrift>
+NetlinkFibHandler::pruneFailedNextHops(const thrift::UnicastRoute& route) {
+  std::vector<thrift::NextHopThrift> nextHops;
+  for (const auto& nh : *route.nextHops_ref()) {
+    const auto& ifName = nh.address_ref()->ifName_ref();
+    if (ifName.has_value()) {
+      const auto ifIndex = getIfIndex(*ifName);
+      if (ifIndex.has_value() and
+          neighborCache_->isFailed(
+              ifIndex.value(), toIPAddress(*nh.address_ref()))) {
+        continue;
+      }
+    }
+    nextHops.emplace_back(nh);
+  }
+
+  if (nextHops.empty()) {
+    // All next-hops failed, keep them all instead of dropping traffic
+    fb303::fbData->addStatValue("fibagent.routes.unresolved", 1, fb303::SUM);
+    return *route.nextHops_ref();
+  }
+  const auto numPruned = route.nextHops_ref()->size() - nextHops.size();
+  if (numPruned) {
+    VLOG(1) << "Pruned " << numPruned << " unresolved next-hops of route "
+            << toString(*route.dest_ref());
+    fb303::fbData->addStatValue(
+        "fibagent.nexthops.pruned", numPruned, fb303::SUM);
+  }
+  return nextHops;
+}
+
+void
+NetlinkFibHandler::updateClientUnicastRoutes(
+    int16_t clientId,
+    const std::vector<thrift::UnicastRoute>& routes,
+    bool replace) {
+  if (not neighborCache_) {
+    return;
+  }
+  auto clientRoutes = clientUnicastRoutes_.wlock();
+  auto& prefixToRoute = (*clientRoutes)[clientId];
+  if (replace) {
+    prefixToRoute.clear();
+  }
+  for (const auto& route : routes) {
+    prefixToRoute.insert_or_assign(toIPNetwork(*route.dest_ref()), route);
+  }
+}
+
+void
+NetlinkFibHandler::deleteClientUnicastRoutes(
+    int16_t clientId, const std::vector<thrift::IpPrefix>& prefixes) {
+  if (not neighborCache_) {
+    return;
+  }
+  auto clientRoutes = clientUnicastRoutes_.wlock();
+  auto& prefixToRoute = (*clientRoutes)[clientId];
+  for (const auto& prefix : prefixes) {
+    prefixToRoute.erase(toIPNetwork(prefix));
+  }
+}
+
+void
+NetlinkFibHandler::processNeighborEvent(const fbnl::Neighbor& neighbor) {
+  if (not neighborCache_ or not neighborCache_->update(neighbor)) {
+    return;
+  }
+  const auto ifName = getIfName(neighbor.getIfIndex());
+  if (not ifName.has_value()) {
+    return;
+  }
+
+  // Routes with a next-hop through neighbor
+  const auto address = neighbor.getDestination();
+  std::unordered_map<int16_t, std::vector<thrift::UnicastRoute>> routesToUpdate;
+  auto clientRoutes = clientUnicastRoutes_.rlock();
+  for (const auto& [clientId, prefixToRoute] : *clientRoutes) {
+    for (const auto& [_, route] : prefixToRoute) {
+      for (const auto& nh : *route.nextHops_ref()) {
+        if (nh.address_ref()->ifName_ref().to_optional() == ifName and
+            toIPAddress(*nh.address_ref()) == address) {
+          routesToUpdate[clientId].emplace_back(route);
+          break;
+        }
+      }
+    }
+  }
+  clientRoutes.unlock();
+
+  const bool isFailed =
+      neighborCache_->isFailed(neighbor.getIfIndex(), address);
+  for (auto& [clientId, routes] : routesToUpdate) {
+    LOG(INFO) << "Neighbor " << address.str() << "%" << ifName.value()
+              << (isFailed ? " failed" : " recovered") << ", re-programming "
+              << routes.size() << " routes of client "
+              << getClientName(clientId);
+    semifuture_addUnicastRoutes(
+        clientId,
+        std::make_unique<std::vector<thrift::UnicastRoute>>(std::move(routes)))
+        .via(&folly::InlineExecutor::instance())
+        .thenError(
+            folly::tag_t<std::exception>{}, [](const std::exception& e) {
+              LOG(ERROR) << "Failed re-programming routes on neighbor "
+                         << "event. " << folly::exceptionStr(e);
+            });
+  }
+}
+
 fbnl::Route
 NetlinkFibHandler::buildMplsRoute(
     const thrift::MplsRoute& mplsRoute, int protocol) {
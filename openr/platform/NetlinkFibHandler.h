@@ -8,9 +8,12 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <fb303/BaseService.h>
@@ -23,6 +26,7 @@
 #include <openr/if/gen-cpp2/FibService.h>
 #include <openr/if/gen-cpp2/NeighborListenerClientForFibagent.h>
 #include <openr/if/gen-cpp2/Types_types.h>
+#include <openr/nl/NeighborCache.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
 #include <openr/nl/NetlinkTypes.h>
 
@@ -38,7 +42,18 @@ namespace openr {
 class NetlinkFibHandler : public thrift::FibServiceSvIf,
                           public facebook::fb303::BaseService {
  public:
-  explicit NetlinkFibHandler(fbnl::NetlinkProtocolSocket* nlSock);
+  /**
+   * @param enableNexthopObjects: Program ECMP unicast routes with nexthop
+   *        group objects, instead of inline next-hops. Requires Linux 5.3+
+   * @param neighborCache: Kernel neighbor state. If set, next-hops with
+   *        failed neighbor resolution are pruned from unicast routes, as long
+   *        as route has other next-hops, and routes are re-programmed on
+   *        neighbor events passed to processNeighborEvent(...)
+   */
+  explicit NetlinkFibHandler(
+      fbnl::NetlinkProtocolSocket* nlSock,
+      bool enableNexthopObjects = false,
+      fbnl::NeighborCache* neighborCache = nullptr);
   ~NetlinkFibHandler() override;
 
   void
@@ -60,6 +75,30 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf,
       int16_t clientId,
       std::unique_ptr<std::vector<thrift::IpPrefix>> prefixes) override;
 
+  /**
+   * Unicast routes in VRF tables. All tables of a call are programmed in one
+   * batch, and synced with one dump per address family. Next-hops are inline
+   * regardless of nexthop objects, and aren't pruned by neighbor cache.
+   */
+  folly::SemiFuture<folly::Unit> semifuture_addUnicastRoutesInTables(
+      int16_t clientId,
+      std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+          tableRoutes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_deleteUnicastRoutesInTables(
+      int16_t clientId,
+      std::unique_ptr<std::map<int32_t, std::vector<thrift::IpPrefix>>>
+          tablePrefixes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_syncFibTables(
+      int16_t clientId,
+      std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+          tableRoutes) override;
+
+  folly::SemiFuture<std::unique_ptr<std::vector<openr::thrift::UnicastRoute>>>
+  semifuture_getRouteTableByClientInTable(
+      int16_t clientId, int32_t tableId) override;
+
   folly::SemiFuture<folly::Unit> semifuture_addMplsRoutes(
       int16_t clientId,
       std::unique_ptr<std::vector<thrift::MplsRoute>> mplsRoute) override;
@@ -94,6 +133,13 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf,
   folly::SemiFuture<std::unique_ptr<std::vector<openr::thrift::MplsRoute>>>
   semifuture_getMplsRouteTableByClient(int16_t clientId) override;
 
+  /**
+   * Apply neighbor event to neighbor cache. If neighbor resolution failed,
+   * or recovered, unicast routes through it are re-programmed with their
+   * next-hops pruned accordingly. No-op without neighbor cache.
+   */
+  void processNeighborEvent(const fbnl::Neighbor& neighbor);
+
   /**
    * Static API to convert protocol to clientId
    */
@@ -144,7 +190,10 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf,
    * API to convert thrift route representation to netlink. Used for programming
    * routes in kernel.
    */
-  fbnl::Route buildRoute(const thrift::UnicastRoute& route, int protocol);
+  fbnl::Route buildRoute(
+      const thrift::UnicastRoute& route,
+      int protocol,
+      uint32_t table = RT_TABLE_MAIN);
   fbnl::Route buildMplsRoute(const thrift::MplsRoute& mplsRoute, int protocol);
   void buildMplsAction(
       fbnl::NextHopBuilder& nhBuilder, const thrift::NextHopThrift& nhop);
@@ -152,6 +201,22 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf,
       fbnl::RouteBuilder& rtBuilder,
       const std::vector<thrift::NextHopThrift>& nhop);
 
+  /**
+   * Next-hops of unicast route, without ones whose neighbor resolution
+   * failed. All next-hops are kept if all of them failed, as pruning all
+   * would turn route into a blackhole.
+   */
+  std::vector<thrift::NextHopThrift> pruneFailedNextHops(
+      const thrift::UnicastRoute& route);
+
+  // Track unicast routes of client, if neighbor cache is set
+  void updateClientUnicastRoutes(
+      int16_t clientId,
+      const std::vector<thrift::UnicastRoute>& routes,
+      bool replace);
+  void deleteClientUnicastRoutes(
+      int16_t clientId, const std::vector<thrift::IpPrefix>& prefixes);
+
   /**
    * APIs to convert ifName <-> ifIndex for thrift <-> netlink route conversions
    * Returns `folly::none` if can't find the mapping.
@@ -171,9 +236,81 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf,
    */
   std::optional<int> getLoopbackIfIndex();
 
+  /**
+   * Add routes, recovering from the routes kernel failed according to their
+   * error class. Transient failures are retried once, routes rejected for
+   * good are skipped and reported in fibagent.routes.rejected, as
+   * re-programming doesn't help them. The call fails on fatal errors, or
+   * if a retried route fails again, for the client to sync all routes.
+   */
+  folly::SemiFuture<folly::Unit> addRoutesWithRecovery(
+      std::vector<fbnl::Route> nlRoutes);
+
   // Used to interact with Linux kernel routing table
   fbnl::NetlinkProtocolSocket* nlSock_{nullptr};
 
+  /**
+   * Nexthop objects state. ECMP unicast routes refer to a nexthop group
+   * object instead of carrying their next-hops inline. Groups are
+   * de-duplicated by their members, and reference counted by routes. Members
+   * are single next-hop objects, de-duplicated by protocol, family,
+   * interface and gateway, and reference counted by groups.
+   *
+   * All routes sharing the same next-hops hence send a fixed-size message
+   * referring to one group, instead of the whole group each.
+   */
+  // protocol, family, interface index, gateway
+  using NexthopKey = std::tuple<
+      uint8_t,
+      uint8_t,
+      std::optional<int>,
+      std::optional<folly::IPAddress>>;
+  // members of group, sorted by nexthop ID, with their weights
+  using NexthopGroupKey = std::vector<std::pair<uint32_t, uint8_t>>;
+
+  struct NexthopObject {
+    uint32_t id{0};
+    size_t refCount{0};
+  };
+
+  struct NexthopObjects {
+    std::map<NexthopKey, NexthopObject> nexthops;
+    std::map<NexthopGroupKey, NexthopObject> groups;
+    // group ID -> group, and nexthop ID -> nexthop, for releasing them
+    std::unordered_map<uint32_t, NexthopGroupKey> groupKeys;
+    std::unordered_map<uint32_t, NexthopKey> nexthopKeys;
+    // prefix -> ID of group the route refers to
+    std::unordered_map<folly::CIDRNetwork, uint32_t> routeGroups;
+    // next ID to allocate
+    uint32_t nextId{1};
+  };
+
+  /**
+   * Make route refer to nexthop group of its next-hops, if it is an ECMP
+   * route of next-hops without MPLS action. Group and members are added to
+   * kernel if they're new, before route is programmed. Group previously
+   * referred to by route is released.
+   *
+   * @param pendingResults: futures of nexthop object programming
+   * @param staleNexthopIds: objects to delete, after routes referring to them
+   */
+  void assignNexthopGroup(
+      NexthopObjects& state,
+      fbnl::Route& route,
+      std::vector<folly::SemiFuture<int>>& pendingResults,
+      std::vector<uint32_t>& staleNexthopIds);
+
+  // Release group of route, if any. See assignNexthopGroup(...)
+  void releaseNexthopGroup(
+      NexthopObjects& state,
+      const folly::CIDRNetwork& prefix,
+      std::vector<uint32_t>& staleNexthopIds);
+
+  // Delete stale nexthop objects
+  void deleteNexthops(
+      const std::vector<uint32_t>& staleNexthopIds,
+      std::vector<folly::SemiFuture<int>>& pendingResults);
+
  private:
   /**
    * Disable copy & assignment operators
@@ -194,6 +331,27 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf,
   // Loopback interface index cache. Initialized to negative number
   std::atomic<int> loopbackIfIndex_{-1};
 
+  // Whether nexthop objects are used for ECMP unicast routes
+  const bool enableNexthopObjects_{false};
+
+  // Nexthop objects programmed in kernel. Lock is held while route updates
+  // referring to them are enqueued, so that enqueue order matches updates.
+  folly::Synchronized<NexthopObjects> nexthopObjects_;
+
+  // Kernel neighbor state, not owned. Unicast routes of clients, as given by
+  // them before pruning, are kept only if set, to re-program them once
+  // neighbor state changes
+  fbnl::NeighborCache* const neighborCache_{nullptr};
+  folly::Synchronized<std::unordered_map<
+      int16_t /* clientId */,
+      std::unordered_map<folly::CIDRNetwork, thrift::UnicastRoute>>>
+      clientUnicastRoutes_;
+
+  // VRF tables programmed by client, flushed if missing from its next sync
+  folly::Synchronized<
+      std::unordered_map<int16_t /* clientId */, std::set<uint32_t>>>
+      clientTables_;
+
   // Time when service started, in number of seconds, since epoch
   const int64_t startTime_{0};
 };
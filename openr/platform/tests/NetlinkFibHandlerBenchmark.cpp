@@ -38,6 +38,9 @@ const std::string kVethNameY("vethTestY");
 static const uint8_t kBitMaskLen = 128;
 // Number of nexthops
 const uint8_t kNumOfNexthops = 128;
+// Number of nexthops for route table at boot scale, keeping memory of 1M
+// routes in check
+const uint8_t kNumOfBulkNexthops = 4;
 
 const int16_t kFibId{static_cast<int16_t>(openr::thrift::FibClient::OPENR)};
 
@@ -78,7 +81,8 @@ class NetlinkFibWrapper {
  * 4. Wait until the completion of routes update
  */
 static void
-BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
+runNetlinkFibHandlerBenchmark(
+    uint32_t iters, size_t numOfPrefixes, uint8_t numOfNexthops) {
   auto suspender = folly::BenchmarkSuspender();
   auto netlinkFibWrapper = std::make_unique<NetlinkFibWrapper>();
 
@@ -86,8 +90,6 @@ BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
   auto prefixes = netlinkFibWrapper->prefixGenerator.ipv6PrefixGenerator(
       numOfPrefixes, kBitMaskLen);
 
-  suspender.dismiss(); // Start measuring benchmark time
-
   for (uint32_t i = 0; i < iters; i++) {
     auto routes = std::make_unique<std::vector<thrift::UnicastRoute>>();
     routes->reserve(prefixes.size());
@@ -97,22 +99,38 @@ BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
       routes->emplace_back(createUnicastRoute(
           prefixes[index],
           netlinkFibWrapper->prefixGenerator.getRandomNextHopsUnicast(
-              kNumOfNexthops, kVethNameY)));
+              numOfNexthops, kVethNameY)));
     }
 
-    suspender.rehire(); // Stop measuring time again
+    suspender.dismiss(); // Start measuring benchmark time
     // Add new routes through netlink
     netlinkFibWrapper->fibHandler
         ->semifuture_addUnicastRoutes(kFibId, std::move(routes))
         .wait();
+    suspender.rehire(); // Stop measuring time again
   }
 }
 
+static void
+BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
+  runNetlinkFibHandlerBenchmark(iters, numOfPrefixes, kNumOfNexthops);
+}
+
+/**
+ * Add the whole route table in one batch, as on boot
+ */
+static void
+BM_NetlinkFibHandlerBulk(uint32_t iters, size_t numOfPrefixes) {
+  runNetlinkFibHandlerBenchmark(iters, numOfPrefixes, kNumOfBulkNexthops);
+}
+
 // The parameter is the number of prefixes
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 10);
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 100);
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 1000);
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 10000);
+BENCHMARK_PARAM(BM_NetlinkFibHandlerBulk, 100000);
+BENCHMARK_PARAM(BM_NetlinkFibHandlerBulk, 1000000);
 
 } // namespace openr
 
@@ -18,6 +18,7 @@
 #include <folly/system/ThreadName.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <openr/common/NetworkUtil.h>
@@ -320,6 +321,81 @@ TEST_P(FibHandlerFixture, UnicastAddUpdateDel) {
   EXPECT_EQ(0, routes->size());
 }
 
+//
+// Test ECMP routes programmed with nexthop objects
+//
+// Add two ECMP routes with same nexthops and one single nexthop route - verify
+// routes share one group, and single nexthop route uses none
+// Update one ECMP route, then sync FIB without the other - verify stale group
+// is removed
+// Delete all routes - verify all objects are removed
+//
+TEST(NetlinkFibHandler, UnicastNexthopGroups) {
+  const int16_t kClientId = 786;
+  folly::EventBase evb;
+  fbnl::MockNetlinkProtocolSocket nlSock(&evb);
+  for (size_t i = 0; i < kInterfaces.size(); ++i) {
+    ASSERT_EQ(
+        0,
+        nlSock
+            .addLink(fbnl::utils::createLink(
+                i + 1, kInterfaces.at(i), true, false))
+            .get());
+  }
+  NetlinkFibHandler handler(&nlSock, true /* enableNexthopObjects */);
+
+  const auto nextHops = createNextHops(2, true /* isV4 */);
+  auto r1 = createUnicastRoute(0, 1, true /* isV4 */);
+  auto r2 = createUnicastRoute(1, 1, true /* isV4 */);
+  auto r3 = createUnicastRoute(2, 1, true /* isV4 */);
+  *r1.nextHops_ref() = nextHops;
+  *r2.nextHops_ref() = nextHops;
+
+  handler
+      .semifuture_addUnicastRoutes(
+          kClientId,
+          std::make_unique<std::vector<thrift::UnicastRoute>>(
+              std::vector<thrift::UnicastRoute>{r1, r2, r3}))
+      .get();
+  EXPECT_EQ(2, nlSock.getNumNexthops());
+  EXPECT_EQ(1, nlSock.getNumNexthopGroups());
+  auto routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  EXPECT_EQ(3, routes->size());
+
+  // Update r1 with one more nexthop. New group with one new member
+  r1.nextHops_ref()->push_back(createNextHop(2, true /* isV4 */));
+  handler
+      .semifuture_addUnicastRoute(
+          kClientId, std::make_unique<thrift::UnicastRoute>(r1))
+      .get();
+  EXPECT_EQ(3, nlSock.getNumNexthops());
+  EXPECT_EQ(2, nlSock.getNumNexthopGroups());
+
+  // Sync without r2. Its group is removed, members are still used by r1
+  handler
+      .semifuture_syncFib(
+          kClientId,
+          std::make_unique<std::vector<thrift::UnicastRoute>>(
+              std::vector<thrift::UnicastRoute>{r1, r3}))
+      .get();
+  EXPECT_EQ(3, nlSock.getNumNexthops());
+  EXPECT_EQ(1, nlSock.getNumNexthopGroups());
+  routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  EXPECT_EQ(2, routes->size());
+
+  // Delete all routes
+  handler
+      .semifuture_deleteUnicastRoutes(
+          kClientId,
+          std::make_unique<std::vector<thrift::IpPrefix>>(
+              std::vector<thrift::IpPrefix>{*r1.dest_ref(), *r3.dest_ref()}))
+      .get();
+  EXPECT_EQ(0, nlSock.getNumNexthops());
+  EXPECT_EQ(0, nlSock.getNumNexthopGroups());
+  routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  EXPECT_EQ(0, routes->size());
+}
+
 //
 // Add route with different weights. Make sure the code translates the weight
 // and reads it again when working with fbnl data structures
@@ -412,6 +488,140 @@ TEST_P(FibHandlerFixture, UnicastSync) {
   EXPECT_EQ(rts, *routes);
 }
 
+//
+// Test SyncFib with routes of both families, synced as separate tables
+//
+// syncFib with v4 and v6 routes, and a duplicate - ensure last one is added
+// syncFib with routes of one family - ensure routes of other one are deleted
+//
+TEST_P(FibHandlerFixture, UnicastSyncBothFamilies) {
+  const int16_t kClientId = 786;
+  const bool isV4 = GetParam();
+
+  auto rts = createUnicastRoutes(4, isV4);
+  auto otherRts = createUnicastRoutes(3, not isV4);
+  auto duplicate = createUnicastRoute(0, kInterfaces.size(), isV4);
+  auto allRts = rts;
+  allRts.insert(allRts.end(), otherRts.begin(), otherRts.end());
+  allRts.emplace_back(duplicate);
+  handler
+      .semifuture_syncFib(
+          kClientId,
+          std::make_unique<std::vector<thrift::UnicastRoute>>(allRts))
+      .get();
+  auto routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  ASSERT_EQ(7, routes->size());
+  rts.at(0) = duplicate;
+  allRts = rts;
+  allRts.insert(allRts.end(), otherRts.begin(), otherRts.end());
+  sortNextHops(allRts);
+  sortNextHops(*routes);
+  EXPECT_THAT(*routes, testing::UnorderedElementsAreArray(allRts));
+
+  handler
+      .semifuture_syncFib(
+          kClientId, std::make_unique<std::vector<thrift::UnicastRoute>>(rts))
+      .get();
+  routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  sortNextHops(rts);
+  sortNextHops(*routes);
+  EXPECT_THAT(*routes, testing::UnorderedElementsAreArray(rts));
+}
+
+//
+// Test VRF tables, programmed and synced together, independently of main
+// table and of each other
+//
+// add routes in two tables - ensure they're not in main table
+// syncFibTables with one table - ensure other table is flushed
+// delete routes of table - ensure table is empty
+//
+TEST_P(FibHandlerFixture, UnicastVrfTables) {
+  const int16_t kClientId = 786;
+  const int32_t kTable1 = 100;
+  const int32_t kTable2 = 200;
+  const bool isV4 = GetParam();
+
+  // Main table and reserved tables are rejected
+  EXPECT_THROW(
+      handler
+          .semifuture_addUnicastRoutesInTables(
+              kClientId,
+              std::make_unique<
+                  std::map<int32_t, std::vector<thrift::UnicastRoute>>>(
+                  std::map<int32_t, std::vector<thrift::UnicastRoute>>{
+                      {RT_TABLE_MAIN, createUnicastRoutes(1, isV4)}}))
+          .get(),
+      fbnl::NlException);
+  EXPECT_THROW(
+      handler.semifuture_getRouteTableByClientInTable(kClientId, 0).get(),
+      fbnl::NlException);
+
+  auto rts1 = createUnicastRoutes(4, isV4);
+  auto rts2 = createUnicastRoutes(2, isV4);
+  auto mainRts = createUnicastRoutes(3, isV4);
+  handler
+      .semifuture_syncFib(
+          kClientId,
+          std::make_unique<std::vector<thrift::UnicastRoute>>(mainRts))
+      .get();
+  handler
+      .semifuture_addUnicastRoutesInTables(
+          kClientId,
+          std::make_unique<
+              std::map<int32_t, std::vector<thrift::UnicastRoute>>>(
+              std::map<int32_t, std::vector<thrift::UnicastRoute>>{
+                  {kTable1, rts1}, {kTable2, rts2}}))
+      .get();
+  auto routes =
+      handler.semifuture_getRouteTableByClientInTable(kClientId, kTable1).get();
+  sortNextHops(rts1);
+  sortNextHops(*routes);
+  EXPECT_THAT(*routes, testing::UnorderedElementsAreArray(rts1));
+  routes =
+      handler.semifuture_getRouteTableByClientInTable(kClientId, kTable2).get();
+  EXPECT_EQ(2, routes->size());
+  routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  EXPECT_EQ(3, routes->size());
+
+  // Sync of table 1 only flushes table 2, main table is left as is
+  rts1 = createUnicastRoutes(6, isV4);
+  handler
+      .semifuture_syncFibTables(
+          kClientId,
+          std::make_unique<
+              std::map<int32_t, std::vector<thrift::UnicastRoute>>>(
+              std::map<int32_t, std::vector<thrift::UnicastRoute>>{
+                  {kTable1, rts1}}))
+      .get();
+  routes =
+      handler.semifuture_getRouteTableByClientInTable(kClientId, kTable1).get();
+  sortNextHops(rts1);
+  sortNextHops(*routes);
+  EXPECT_THAT(*routes, testing::UnorderedElementsAreArray(rts1));
+  routes =
+      handler.semifuture_getRouteTableByClientInTable(kClientId, kTable2).get();
+  EXPECT_EQ(0, routes->size());
+  routes = handler.semifuture_getRouteTableByClient(kClientId).get();
+  EXPECT_EQ(3, routes->size());
+
+  // Delete routes of table 1
+  std::vector<thrift::IpPrefix> prefixes;
+  for (const auto& route : rts1) {
+    prefixes.emplace_back(*route.dest_ref());
+  }
+  handler
+      .semifuture_deleteUnicastRoutesInTables(
+          kClientId,
+          std::make_unique<std::map<int32_t, std::vector<thrift::IpPrefix>>>(
+              std::map<int32_t, std::vector<thrift::IpPrefix>>{
+                  {kTable1, prefixes}}))
+      .get();
+  routes =
+      handler.semifuture_getRouteTableByClientInTable(kClientId, kTable1).get();
+  EXPECT_EQ(0, routes->size());
+}
+
 //
 // Test correctness of multiple client support. Incrementally add and remove
 // route for same prefix1 from client1 and client2. Verify that addition or
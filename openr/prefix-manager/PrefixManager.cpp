@@ -8,6 +8,8 @@
 #include "PrefixManager.h"
 
 #include <fb303/ServiceData.h>
+#include <folly/String.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 #include <optional>
@@ -56,7 +58,8 @@ PrefixManager::PrefixManager(
       preferOpenrOriginatedRoutes_(
           config->getConfig().get_prefer_openr_originated_routes()),
       enableNewPrefixFormat_(
-          config->getConfig().get_enable_new_prefix_format()) {
+          config->getConfig().get_enable_new_prefix_format()),
+      numPrefixDbShards_(*config->getConfig().num_prefix_db_shards_ref()) {
   CHECK(kvStore_);
   CHECK(config);
 
@@ -66,6 +69,19 @@ PrefixManager::PrefixManager(
 
   for (const auto& [areaId, areaConf] : config->getAreas()) {
     areaToPolicy_.emplace(areaId, areaConf.getImportPolicyName());
+    for (const auto& network : areaConf.getSummaryPrefixes()) {
+      areaSummaries_[network].areas.emplace(areaId);
+    }
+  }
+  for (auto& [network, summary] : areaSummaries_) {
+    areaSummaryTrie_.insert(network, &summary);
+  }
+
+  if (auto syncThreads = *config->getConfig().prefix_manager_sync_threads_ref();
+      syncThreads > 1) {
+    syncPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        syncThreads,
+        std::make_shared<folly::NamedThreadFactory>("PrefixManagerSync"));
   }
 
   // Create KvStore client
@@ -127,6 +143,10 @@ PrefixManager::PrefixManager(
         LOG(ERROR) << "Unknown command received. "
                    << static_cast<int>(update.eventType);
       }
+
+      if (update.ack) {
+        update.ack->setValue(update.seqNum);
+      }
     }
   });
 
@@ -249,6 +269,28 @@ PrefixManager::PrefixManager(
     syncKvStoreThrottled_->operator()();
   }
 
+  // ATTN: prefix db shards previously advertised are withdrawn upon the
+  //       first sync, unless prefixes hashed to them are advertised again.
+  //       This also cleans up shards after disabling sharding.
+  const auto shardKeyPrefix = fmt::format(
+      "{}{}:", Constants::kPrefixShardDbMarker.toString(), nodeId_);
+  for (const auto& [area, _] : areaToPolicy_) {
+    auto result =
+        kvStoreClient_->dumpAllWithPrefix(AreaId{area}, shardKeyPrefix);
+    if (not result.has_value()) {
+      LOG(ERROR) << "Failed dumping prefix " << shardKeyPrefix
+                 << " from area " << area;
+      continue;
+    }
+    for (auto const& [shardKeyStr, _] : result.value()) {
+      prefixDbShards_[shardKeyStr].area = area;
+      dirtyPrefixDbShards_.emplace(shardKeyStr);
+    }
+  }
+  if (not dirtyPrefixDbShards_.empty()) {
+    syncKvStoreThrottled_->operator()();
+  }
+
   // schedule one-time initial dump
   initialSyncKvStoreTimer_->scheduleTimeout(initialDumpTime);
 
@@ -337,11 +379,69 @@ PrefixManager::buildOriginatedPrefixDb(
             std::move(unicastEntry),
             std::unordered_set<folly::CIDRNetwork>{}));
   }
+
+  // index once all routes are in place
+  originatedPrefixTrie_.clear();
+  for (auto& [network, route] : originatedPrefixDb_) {
+    originatedPrefixTrie_.insert(network, &route);
+  }
 }
 
-std::unordered_set<std::string>
-PrefixManager::updateKvStoreKeyHelper(const PrefixEntry& entry) {
-  std::unordered_set<std::string> prefixKeys;
+void
+PrefixManager::updateOriginatedPrefixes(
+    const std::vector<thrift::OriginatedPrefix>& prefixes) {
+  std::unordered_map<folly::CIDRNetwork, thrift::OriginatedPrefix> newPrefixes;
+  for (const auto& prefix : prefixes) {
+    newPrefixes.emplace(
+        folly::IPAddress::createNetwork(*prefix.prefix_ref()), prefix);
+  }
+
+  // withdraw removed or modified originated prefixes
+  std::vector<thrift::PrefixEntry> withdrawnPrefixes{};
+  for (auto it = originatedPrefixDb_.begin();
+       it != originatedPrefixDb_.end();) {
+    auto newIt = newPrefixes.find(it->first);
+    if (newIt != newPrefixes.end() and
+        newIt->second == it->second.originatedPrefix) {
+      newPrefixes.erase(newIt);
+      ++it;
+      continue;
+    }
+    if (it->second.isAdvertised) {
+      withdrawnPrefixes.emplace_back(
+          createPrefixEntry(toIpPrefix(it->first), thrift::PrefixType::CONFIG));
+      LOG(INFO) << "[Route Origination] Withdrawing reconfigured route "
+                << folly::IPAddress::networkToString(it->first);
+    }
+    it = originatedPrefixDb_.erase(it);
+  }
+  withdrawPrefixesImpl(withdrawnPrefixes);
+
+  std::vector<thrift::OriginatedPrefix> addedPrefixes;
+  for (auto& [_, prefix] : newPrefixes) {
+    addedPrefixes.emplace_back(std::move(prefix));
+  }
+  buildOriginatedPrefixDb(addedPrefixes);
+
+  // re-compute supporting routes, the same for unchanged originated prefixes
+  for (auto& [_, route] : originatedPrefixDb_) {
+    route.supportingRoutes.clear();
+  }
+  for (auto& [prefix, networks] : ribPrefixDb_) {
+    networks.clear();
+    for (auto const* entry : originatedPrefixTrie_.getCoveringPrefixes(
+             {prefix.first, uint8_t(prefix.first.bitCount())})) {
+      networks.emplace_back(entry->first);
+      entry->second->supportingRoutes.emplace(prefix);
+    }
+  }
+
+  processOriginatedPrefixes();
+}
+
+std::vector<PrefixManager::AreaKeyVal>
+PrefixManager::buildAreaKeyVals(const PrefixEntry& entry) const {
+  std::vector<AreaKeyVal> keyVals;
   const auto& tPrefixEntry = entry.tPrefixEntry;
   const auto& type = *tPrefixEntry->type_ref();
   const std::unordered_set<std::string> areaStack{
@@ -384,29 +484,75 @@ PrefixManager::updateKvStoreKeyHelper(const PrefixEntry& entry) {
       postPolicyTPrefixEntry = tPrefixEntry;
     }
 
-    const auto prefixKey = PrefixKey(nodeId_, entry.network, toArea);
-    const auto prefixKeyStr = enableNewPrefixFormat_
-        ? prefixKey.getPrefixKeyV2()
-        : prefixKey.getPrefixKey();
-    auto prefixDb = createPrefixDb(nodeId_, {*postPolicyTPrefixEntry}, toArea);
-    auto prefixDbStr = writeThriftObjStr(std::move(prefixDb), serializer_);
+    AreaKeyVal keyVal;
+    keyVal.area = toArea;
+    if (numPrefixDbShards_ > 0) {
+      // shard is updated in memory, advertised once per sync
+      keyVal.key =
+          PrefixShardKey(
+              nodeId_,
+              toArea,
+              PrefixShardKey::getShard(entry.network, numPrefixDbShards_))
+              .getPrefixShardKey();
+    } else {
+      const auto prefixKey = PrefixKey(nodeId_, entry.network, toArea);
+      keyVal.key = enableNewPrefixFormat_ ? prefixKey.getPrefixKeyV2()
+                                          : prefixKey.getPrefixKey();
+      keyVal.value = writeThriftObjStr(
+          createPrefixDb(nodeId_, {*postPolicyTPrefixEntry}, toArea),
+          serializer_);
+    }
+    keyVal.postPolicyEntry = std::move(postPolicyTPrefixEntry);
+    keyVals.emplace_back(std::move(keyVal));
+  }
+  return keyVals;
+}
 
-    // advertise key to `KvStore`
-    bool changed = kvStoreClient_->persistKey(
-        AreaId{toArea}, prefixKeyStr, prefixDbStr, ttlKeyInKvStore_);
+std::unordered_set<std::string>
+PrefixManager::updateKvStoreKeyHelper(
+    const PrefixEntry& entry,
+    std::vector<AreaKeyVal>&& keyVals,
+    std::unordered_map<
+        std::string,
+        std::vector<std::pair<std::string, std::string>>>& keyValsToPersist) {
+  std::unordered_set<std::string> prefixKeys;
+  const auto& type = *entry.tPrefixEntry->type_ref();
+
+  for (auto& keyVal : keyVals) {
     fb303::fbData->addStatValue(
         "prefix_manager.route_advertisements", 1, fb303::SUM);
-    VLOG_IF(1, changed) << "[Prefix Advertisement] "
-                        << "Area: " << toArea << ", "
-                        << "Type: " << toString(type) << ", "
-                        << toString(*postPolicyTPrefixEntry, VLOG_IS_ON(2));
-    prefixKeys.emplace(prefixKeyStr);
+    prefixKeys.emplace(keyVal.key);
+
+    if (numPrefixDbShards_ > 0) {
+      auto& shard = prefixDbShards_[keyVal.key];
+      shard.area = keyVal.area;
+      auto [it, inserted] =
+          shard.entries.emplace(entry.network, *keyVal.postPolicyEntry);
+      if (inserted or not(it->second == *keyVal.postPolicyEntry)) {
+        it->second = *keyVal.postPolicyEntry;
+        dirtyPrefixDbShards_.emplace(keyVal.key);
+        VLOG(1) << "[Prefix Advertisement] "
+                << "Area: " << keyVal.area << ", "
+                << "Shard: " << keyVal.key << ", "
+                << "Type: " << toString(type) << ", "
+                << toString(*keyVal.postPolicyEntry, VLOG_IS_ON(2));
+      }
+      continue;
+    }
+
+    VLOG(2) << "[Prefix Advertisement] "
+            << "Area: " << keyVal.area << ", "
+            << "Type: " << toString(type) << ", "
+            << toString(*keyVal.postPolicyEntry, VLOG_IS_ON(3));
+    keyValsToPersist[keyVal.area].emplace_back(
+        std::move(keyVal.key), std::move(keyVal.value));
   }
   return prefixKeys;
 }
 
 void
 PrefixManager::deleteKvStoreKeyHelper(
+    const folly::CIDRNetwork& network,
     const std::unordered_set<std::string>& deletedKeys) {
   // Prepare thrift::PrefixDatabase object for deletion
   thrift::PrefixDatabase deletedPrefixDb;
@@ -415,6 +561,21 @@ PrefixManager::deleteKvStoreKeyHelper(
 
   // TODO: see if we can avoid encoding/decoding of string
   for (const auto& prefixStr : deletedKeys) {
+    // remove prefix from its shard, cleared along with the shard if last
+    auto shardIt = prefixDbShards_.find(prefixStr);
+    if (shardIt != prefixDbShards_.end()) {
+      if (shardIt->second.entries.erase(network)) {
+        dirtyPrefixDbShards_.emplace(prefixStr);
+        VLOG(1) << "[Prefix Withdraw] "
+                << "Area: " << shardIt->second.area << ", "
+                << "Shard: " << prefixStr << ", "
+                << folly::IPAddress::networkToString(network);
+        fb303::fbData->addStatValue(
+            "prefix_manager.route_withdraws", 1, fb303::SUM);
+      }
+      continue;
+    }
+
     auto prefixKey = PrefixKey::fromStr(prefixStr);
     CHECK(prefixKey.hasValue());
 
@@ -435,17 +596,67 @@ PrefixManager::deleteKvStoreKeyHelper(
   }
 }
 
+void
+PrefixManager::syncPrefixDbShards() {
+  for (auto const& shardKeyStr : dirtyPrefixDbShards_) {
+    auto it = prefixDbShards_.find(shardKeyStr);
+    if (it == prefixDbShards_.end()) {
+      continue;
+    }
+    auto const& shard = it->second;
+
+    if (shard.entries.empty()) {
+      kvStoreClient_->clearKey(
+          AreaId{shard.area},
+          shardKeyStr,
+          writeThriftObjStr(
+              createPrefixDb(nodeId_, {}, shard.area, true /* withdraw */),
+              serializer_),
+          ttlKeyInKvStore_);
+      prefixDbShards_.erase(it);
+      continue;
+    }
+
+    std::vector<thrift::PrefixEntry> entries;
+    entries.reserve(shard.entries.size());
+    for (auto const& [_, entry] : shard.entries) {
+      entries.emplace_back(entry);
+    }
+    kvStoreClient_->persistKey(
+        AreaId{shard.area},
+        shardKeyStr,
+        writeThriftObjStr(
+            createPrefixDb(nodeId_, entries, shard.area), serializer_),
+        ttlKeyInKvStore_);
+  }
+  VLOG_IF(1, not dirtyPrefixDbShards_.empty())
+      << "[KvStore Sync] Synced " << dirtyPrefixDbShards_.size()
+      << " prefix db shards";
+  dirtyPrefixDbShards_.clear();
+  fb303::fbData->setCounter(
+      "prefix_manager.prefix_db_shards", prefixDbShards_.size());
+}
+
 void
 PrefixManager::syncKvStore() {
   VLOG(1)
       << "[KvStore Sync] Syncing "
       << pendingUpdates_.getChangedPrefixes().size()
       << " changed prefixes. Total prefixes advertised: " << prefixMap_.size();
+  const auto startTime = std::chrono::steady_clock::now();
+  auto syncEntries =
+      buildPrefixSyncEntries(pendingUpdates_.getChangedPrefixes());
+
   DecisionRouteUpdate routeUpdatesOut;
+  // per-prefix keys to advertise, batched per area
+  std::unordered_map<
+      std::string,
+      std::vector<std::pair<std::string, std::string>>>
+      keyValsToPersist;
   // iterate over `pendingUpdates_` to advertise/withdraw incremental changes
-  for (auto const& network : pendingUpdates_.getChangedPrefixes()) {
-    auto it = prefixMap_.find(network);
-    if (it == prefixMap_.end()) {
+  for (auto& syncEntry : syncEntries) {
+    const auto& network = syncEntry.network;
+    if (not syncEntry.bestEntry) {
       // delete actual keys being advertised in the cache
       //
       // Sample format:
@@ -454,7 +665,7 @@ PrefixManager::syncKvStore() {
       //  marker        nodeId      areaId        prefixStr
       auto keysIt = advertisedKeys_.find(network);
       if (keysIt != advertisedKeys_.end()) {
-        deleteKvStoreKeyHelper(keysIt->second.keys);
+        deleteKvStoreKeyHelper(network, keysIt->second.keys);
         if (keysIt->second.installedToFib) {
           routeUpdatesOut.unicastRoutesToDelete.emplace_back(network);
         }
@@ -462,22 +673,11 @@ PrefixManager::syncKvStore() {
       }
     } else {
       // add/update keys in `KvStore`
-      const auto& typeToPrefixes = it->second;
-
-      // select the best entry/entries by comparing metric_ref() field
-      const auto bestTypes = selectBestPrefixMetrics(typeToPrefixes);
-      auto bestType = *bestTypes.begin();
-      // if best route is BGP, and an equivalent CONFIG route exists,
-      // then prefer config route if knob prefer_openr_originated_config_=true
-      if (bestType == thrift::PrefixType::BGP and
-          preferOpenrOriginatedRoutes_ and
-          bestTypes.count(thrift::PrefixType::CONFIG)) {
-        bestType = thrift::PrefixType::CONFIG;
-      }
-      auto& bestEntry = typeToPrefixes.at(bestType);
+      const auto& bestEntry = *syncEntry.bestEntry;
 
       // advertise best-entry for this prefix to `KvStore`
-      auto newKeys = updateKvStoreKeyHelper(bestEntry);
+      auto newKeys = updateKvStoreKeyHelper(
+          bestEntry, std::move(syncEntry.keyVals), keyValsToPersist);
 
       auto keysIt = advertisedKeys_.find(network);
       if (keysIt != advertisedKeys_.end()) {
@@ -494,7 +694,7 @@ PrefixManager::syncKvStore() {
         // t0: prefix_1 => {area_1, area_2}
         // t1: prefix_1 => {area_1, area_3}
         //     (prefix_1, area_2) will be removed
-        deleteKvStoreKeyHelper(keysIt->second.keys);
+        deleteKvStoreKeyHelper(network, keysIt->second.keys);
       }
 
       // override `advertisedKeys_` for next-round syncing
@@ -518,6 +718,18 @@ PrefixManager::syncKvStore() {
       }
     }
   }
+  // advertise per-prefix keys, one batch per area
+  for (auto const& [area, keyVals] : keyValsToPersist) {
+    const auto numChanged =
+        kvStoreClient_->persistKeys(AreaId{area}, keyVals, ttlKeyInKvStore_);
+    VLOG_IF(1, numChanged) << "[Prefix Advertisement] Area: " << area
+                           << ", advertised " << numChanged << " of "
+                           << keyVals.size() << " keys";
+  }
+
+  // advertise shards changed by this round of syncing
+  syncPrefixDbShards();
+
   // push originatedRoutes update via replicate queue
   if (routeUpdatesOut.unicastRoutesToUpdate.size() or
       routeUpdatesOut.unicastRoutesToDelete.size()) {
@@ -530,6 +742,13 @@ PrefixManager::syncKvStore() {
           << pendingUpdates_.getChangedPrefixes().size()
           << " changed prefixes.";
 
+  fb303::fbData->addStatValue(
+      "prefix_manager.sync_kvstore_ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime)
+          .count(),
+      fb303::AVG);
+
   // clean up
   pendingUpdates_.reset();
 
@@ -543,6 +762,69 @@ PrefixManager::syncKvStore() {
       "prefix_manager.advertised_prefixes", prefixMap_.size());
 }
 
+std::vector<PrefixManager::PrefixSyncEntry>
+PrefixManager::buildPrefixSyncEntries(
+    const std::unordered_set<folly::CIDRNetwork>& networks) const {
+  std::vector<PrefixSyncEntry> syncEntries;
+  syncEntries.reserve(networks.size());
+  if (not syncPool_ or networks.size() <= Constants::kPrefixSyncChunkSize) {
+    for (auto const& network : networks) {
+      syncEntries.emplace_back(buildPrefixSyncEntry(network));
+    }
+    return syncEntries;
+  }
+
+  // ATTN: workers only read `prefixMap_` and config. Each fills its own
+  //       slice of `syncEntries` while the PrefixManager thread waits.
+  std::vector<folly::CIDRNetwork const*> prefixes;
+  prefixes.reserve(networks.size());
+  for (auto const& network : networks) {
+    prefixes.emplace_back(&network);
+  }
+  syncEntries.resize(prefixes.size());
+  std::vector<folly::Future<folly::Unit>> futures;
+  for (size_t begin = 0; begin < prefixes.size();
+       begin += Constants::kPrefixSyncChunkSize) {
+    const auto end =
+        std::min(prefixes.size(), begin + Constants::kPrefixSyncChunkSize);
+    futures.emplace_back(folly::via(
+        folly::getKeepAliveToken(syncPool_.get()),
+        [this, &prefixes, &syncEntries, begin, end]() {
+          for (auto i = begin; i < end; ++i) {
+            syncEntries.at(i) = buildPrefixSyncEntry(*prefixes.at(i));
+          }
+        }));
+  }
+  // rethrows the first failure, if any
+  folly::collect(futures).get();
+  return syncEntries;
+}
+
+PrefixManager::PrefixSyncEntry
+PrefixManager::buildPrefixSyncEntry(const folly::CIDRNetwork& network) const {
+  PrefixSyncEntry syncEntry;
+  syncEntry.network = network;
+
+  auto it = prefixMap_.find(network);
+  if (it == prefixMap_.end()) {
+    return syncEntry;
+  }
+  const auto& typeToPrefixes = it->second;
+
+  // select the best entry/entries by comparing metric_ref() field
+  const auto bestTypes = selectBestPrefixMetrics(typeToPrefixes);
+  auto bestType = *bestTypes.begin();
+  // if best route is BGP, and an equivalent CONFIG route exists,
+  // then prefer config route if knob prefer_openr_originated_config_=true
+  if (bestType == thrift::PrefixType::BGP and preferOpenrOriginatedRoutes_ and
+      bestTypes.count(thrift::PrefixType::CONFIG)) {
+    bestType = thrift::PrefixType::CONFIG;
+  }
+  syncEntry.bestEntry = &typeToPrefixes.at(bestType);
+  syncEntry.keyVals = buildAreaKeyVals(*syncEntry.bestEntry);
+  return syncEntry;
+}
+
 folly::SemiFuture<bool>
 PrefixManager::advertisePrefixes(std::vector<thrift::PrefixEntry> prefixes) {
   folly::Promise<bool> p;
@@ -595,6 +877,54 @@ PrefixManager::syncPrefixesByType(
   return sf;
 }
 
+folly::SemiFuture<thrift::PrefixChangeBatchResult>
+PrefixManager::applyPrefixChanges(thrift::PrefixChangeBatch batch) {
+  folly::Promise<thrift::PrefixChangeBatchResult> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([this,
+                        p = std::move(p),
+                        batch = std::move(batch)]() mutable noexcept {
+    thrift::PrefixChangeBatchResult result;
+
+    // apply whole batch within one event base task, nothing is synced in
+    // between
+    const auto applyStart = std::chrono::steady_clock::now();
+    bool updated = false;
+    updated |= withdrawPrefixesImpl(*batch.prefixesToWithdraw_ref());
+    updated |= advertisePrefixesImpl(
+        std::move(*batch.prefixesToAdvertise_ref()), allAreaIds());
+    result.updated_ref() = updated;
+    result.applyTimeUs_ref() =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - applyStart)
+            .count();
+
+    // No write to KvStore before initial KvStore sync
+    if (*batch.syncImmediately_ref() and
+        not initialSyncKvStoreTimer_->isScheduled()) {
+      result.numPrefixesSynced_ref() =
+          pendingUpdates_.getChangedPrefixes().size();
+      const auto syncStart = std::chrono::steady_clock::now();
+      syncKvStoreThrottled_->cancel();
+      syncKvStore();
+      result.syncTimeUs_ref() =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - syncStart)
+              .count();
+      result.synced_ref() = true;
+    }
+
+    fb303::fbData->addStatValue(
+        "prefix_manager.apply_prefix_changes", 1, fb303::COUNT);
+    fb303::fbData->addStatValue(
+        "prefix_manager.apply_prefix_changes_ms",
+        (*result.applyTimeUs_ref() + *result.syncTimeUs_ref()) / 1000,
+        fb303::AVG);
+    p.setValue(std::move(result));
+  });
+  return sf;
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
 PrefixManager::getPrefixes() {
   folly::Promise<std::unique_ptr<std::vector<thrift::PrefixEntry>>> p;
@@ -632,6 +962,31 @@ PrefixManager::getPrefixesByType(thrift::PrefixType prefixType) {
   return sf;
 }
 
+template <typename Fn>
+void
+PrefixManager::forEachFilteredPrefix(
+    thrift::AdvertisedRouteFilter const& filter, Fn&& fn) const {
+  if (filter.prefixes_ref()) {
+    // Explicitly lookup the requested prefixes
+    for (auto& prefix : filter.prefixes_ref().value()) {
+      auto it = prefixMap_.find(toIPNetwork(prefix));
+      if (it != prefixMap_.end()) {
+        fn(it->first, it->second);
+      }
+    }
+  } else if (filter.prefixType_ref()) {
+    // Only prefixes with an entry of the type
+    for (auto const& prefix : getPrefixesOfType(*filter.prefixType_ref())) {
+      fn(prefix, prefixMap_.at(prefix));
+    }
+  } else {
+    // Iterate over all prefixes
+    for (auto const& [prefix, prefixEntries] : prefixMap_) {
+      fn(prefix, prefixEntries);
+    }
+  }
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::AdvertisedRouteDetail>>>
 PrefixManager::getAdvertisedRoutesFiltered(
     thrift::AdvertisedRouteFilter filter) {
@@ -641,23 +996,11 @@ PrefixManager::getAdvertisedRoutesFiltered(
       [this, p = std::move(p), filter = std::move(filter)]() mutable noexcept {
         auto routes =
             std::make_unique<std::vector<thrift::AdvertisedRouteDetail>>();
-        if (filter.prefixes_ref()) {
-          // Explicitly lookup the requested prefixes
-          for (auto& prefix : filter.prefixes_ref().value()) {
-            auto it = prefixMap_.find(toIPNetwork(prefix));
-            if (it == prefixMap_.end()) {
-              continue;
-            }
-            filterAndAddAdvertisedRoute(
-                *routes, filter.prefixType_ref(), it->first, it->second);
-          }
-        } else {
-          // Iterate over all prefixes
-          for (auto& [prefix, prefixEntries] : prefixMap_) {
-            filterAndAddAdvertisedRoute(
-                *routes, filter.prefixType_ref(), prefix, prefixEntries);
-          }
-        }
+        forEachFilteredPrefix(
+            filter, [&](auto const& prefix, auto const& prefixEntries) {
+              filterAndAddAdvertisedRoute(
+                  *routes, filter.prefixType_ref(), prefix, prefixEntries);
+            });
         p.setValue(std::move(routes));
       });
   return std::move(sf);
@@ -676,30 +1019,14 @@ PrefixManager::getAreaAdvertisedRoutes(
                         areaName = std::move(areaName),
                         routeFilterType = routeFilterType]() mutable noexcept {
     auto routes = std::make_unique<std::vector<thrift::AdvertisedRoute>>();
-    if (filter.prefixes_ref()) {
-      // Explicitly lookup the requested prefixes
-      for (auto& prefix : filter.prefixes_ref().value()) {
-        auto it = prefixMap_.find(toIPNetwork(prefix));
-        if (it == prefixMap_.end()) {
-          continue;
-        }
-        filterAndAddAreaRoute(
-            *routes,
-            areaName,
-            routeFilterType,
-            it->second,
-            filter.prefixType_ref());
-      }
-    } else {
-      for (auto& [prefix, prefixEntries] : prefixMap_) {
-        filterAndAddAreaRoute(
-            *routes,
-            areaName,
-            routeFilterType,
-            prefixEntries,
-            filter.prefixType_ref());
-      }
-    }
+    forEachFilteredPrefix(filter, [&](auto const&, auto const& prefixEntries) {
+      filterAndAddAreaRoute(
+          *routes,
+          areaName,
+          routeFilterType,
+          prefixEntries,
+          filter.prefixType_ref());
+    });
     p.setValue(std::move(routes));
   });
   return std::move(sf);
@@ -733,6 +1060,20 @@ PrefixManager::getOriginatedPrefixes() {
   return sf;
 }
 
+folly::SemiFuture<folly::Unit>
+PrefixManager::updateConfig(std::shared_ptr<const Config> config) {
+  folly::Promise<folly::Unit> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread(
+      [this, p = std::move(p), config = std::move(config)]() mutable noexcept {
+        updateOriginatedPrefixes(
+            config->getConfig().originated_prefixes_ref().value_or(
+                std::vector<thrift::OriginatedPrefix>{}));
+        p.setValue();
+      });
+  return sf;
+}
+
 void
 PrefixManager::filterAndAddAdvertisedRoute(
     std::vector<thrift::AdvertisedRouteDetail>& routes,
@@ -848,13 +1189,14 @@ PrefixManager::advertisePrefixesImpl(
     return false;
   }
   std::vector<PrefixEntry> toAddOrUpdate;
+  toAddOrUpdate.reserve(tPrefixEntries.size());
   for (auto& tPrefixEntry : tPrefixEntries) {
     auto dstAreasCp = dstAreas;
     toAddOrUpdate.emplace_back(
         std::make_shared<thrift::PrefixEntry>(std::move(tPrefixEntry)),
         std::move(dstAreasCp));
   }
-  return advertisePrefixesImpl(toAddOrUpdate);
+  return advertisePrefixesImpl(std::move(toAddOrUpdate));
 }
 
 bool
@@ -865,40 +1207,46 @@ PrefixManager::advertisePrefixesImpl(
     return false;
   }
 
-  std::vector<PrefixEntry> toAddOrUpdate;
   for (auto& prefixEntry : prefixEntries) {
     auto dstAreasCp = dstAreas;
     prefixEntry.dstAreas = std::move(dstAreasCp);
-
-    // Create PrefixEntry and set unicastRotues
-    toAddOrUpdate.push_back(std::move(prefixEntry));
   }
-  return advertisePrefixesImpl(toAddOrUpdate);
+  return advertisePrefixesImpl(std::move(prefixEntries));
 }
 
 bool
 PrefixManager::advertisePrefixesImpl(
     const std::vector<PrefixEntry>& prefixEntries) {
+  auto prefixEntriesCp = prefixEntries;
+  return advertisePrefixesImpl(std::move(prefixEntriesCp));
+}
+
+bool
+PrefixManager::advertisePrefixesImpl(std::vector<PrefixEntry>&& prefixEntries) {
   folly::small_vector<folly::CIDRNetwork> changed{};
 
-  for (const auto& entry : prefixEntries) {
-    const auto& type = *entry.tPrefixEntry->type_ref();
-    const auto& prefixCidr = entry.network;
+  for (auto& entry : prefixEntries) {
+    const auto type = *entry.tPrefixEntry->type_ref();
+    const auto prefixCidr = entry.network;
 
     // ATTN: create new folly::CIDRNetwork -> typeToPrefixes
     //       mapping if it is new prefix. `[]` operator is
     //       used intentionally.
-    auto [it, inserted] = prefixMap_[prefixCidr].emplace(type, entry);
+    auto& typeToPrefixes = prefixMap_[prefixCidr];
+    auto it = typeToPrefixes.find(type);
 
-    if (not inserted) {
+    if (it != typeToPrefixes.end()) {
       if (it->second == entry) {
         // Case 1: ignore SAME `PrefixEntry`
         continue;
       }
       // Case 2: update existing `PrefixEntry`
-      it->second = entry;
+      it->second = std::move(entry);
+    } else {
+      // Case 3: create new `PrefixEntry`
+      typeToPrefixes.emplace(type, std::move(entry));
+      prefixesByType_[type].emplace(prefixCidr);
     }
-    // Case 3: create new `PrefixEntry`
     changed.emplace_back(prefixCidr);
   }
 
@@ -926,17 +1274,9 @@ PrefixManager::withdrawPrefixesImpl(
     const auto& type = *prefixEntry.type_ref();
     const auto& prefixCidr = toIPNetwork(*prefixEntry.prefix_ref());
 
-    // iterator usage to avoid multiple times of map access
-    auto typeIt = prefixMap_.find(prefixCidr);
-
     // ONLY populate changed collection when successfully erased key
-    if (typeIt != prefixMap_.end() and typeIt->second.erase(type)) {
+    if (eraseEntry(prefixCidr, type)) {
       changed.emplace_back(prefixCidr);
-
-      // clean up data structure
-      if (typeIt->second.empty()) {
-        prefixMap_.erase(prefixCidr);
-      }
     }
   }
 
@@ -963,16 +1303,9 @@ PrefixManager::withdrawPrefixEntriesImpl(
   for (const auto& prefixEntry : prefixEntries) {
     const auto& type = *prefixEntry.tPrefixEntry->type_ref();
 
-    // iterator usage to avoid multiple times of map access
-    auto typeIt = prefixMap_.find(prefixEntry.network);
-
     // ONLY populate changed collection when successfully erased key
-    if (typeIt != prefixMap_.end() and typeIt->second.erase(type)) {
+    if (eraseEntry(prefixEntry.network, type)) {
       changed.emplace_back(prefixEntry.network);
-      // clean up data structure
-      if (typeIt->second.empty()) {
-        prefixMap_.erase(prefixEntry.network);
-      }
     }
   }
 
@@ -997,12 +1330,7 @@ PrefixManager::syncPrefixesByTypeImpl(
   // building these lists so we can call add and remove and get detailed
   // logging
   std::vector<thrift::PrefixEntry> toAddOrUpdate, toRemove;
-  std::unordered_set<folly::CIDRNetwork> toRemoveSet;
-  for (auto const& [prefix, typeToPrefixes] : prefixMap_) {
-    if (typeToPrefixes.count(type)) {
-      toRemoveSet.emplace(prefix);
-    }
-  }
+  auto toRemoveSet = getPrefixesOfType(type);
   for (auto const& entry : tPrefixEntries) {
     CHECK(type == *entry.type_ref());
     toRemoveSet.erase(toIPNetwork(*entry.prefix_ref()));
@@ -1021,18 +1349,50 @@ PrefixManager::syncPrefixesByTypeImpl(
 bool
 PrefixManager::withdrawPrefixesByTypeImpl(thrift::PrefixType type) {
   std::vector<thrift::PrefixEntry> toRemove;
-  for (auto const& [prefix, typeToPrefixes] : prefixMap_) {
-    auto it = typeToPrefixes.find(type);
-    if (it != typeToPrefixes.end()) {
-      toRemove.emplace_back(*it->second.tPrefixEntry);
-    }
+  for (auto const& prefix : getPrefixesOfType(type)) {
+    toRemove.emplace_back(*prefixMap_.at(prefix).at(type).tPrefixEntry);
   }
 
   return withdrawPrefixesImpl(toRemove);
 }
 
+bool
+PrefixManager::eraseEntry(
+    folly::CIDRNetwork const& prefix, thrift::PrefixType type) {
+  // iterator usage to avoid multiple times of map access
+  auto typeIt = prefixMap_.find(prefix);
+  if (typeIt == prefixMap_.end() or not typeIt->second.erase(type)) {
+    return false;
+  }
+  if (type == thrift::PrefixType::RIB) {
+    // re-redistribute route with its next update
+    redistributedRoutes_.erase(prefix);
+  }
+  // clean up data structures
+  if (typeIt->second.empty()) {
+    prefixMap_.erase(typeIt);
+  }
+  auto indexIt = prefixesByType_.find(type);
+  if (indexIt != prefixesByType_.end()) {
+    indexIt->second.erase(prefix);
+    if (indexIt->second.empty()) {
+      prefixesByType_.erase(indexIt);
+    }
+  }
+  return true;
+}
+
+std::unordered_set<folly::CIDRNetwork> const&
+PrefixManager::getPrefixesOfType(thrift::PrefixType type) const {
+  static const std::unordered_set<folly::CIDRNetwork> kEmptyPrefixes;
+  auto it = prefixesByType_.find(type);
+  return it != prefixesByType_.end() ? it->second : kEmptyPrefixes;
+}
+
 void
-PrefixManager::aggregatesToAdvertise(const folly::CIDRNetwork& prefix) {
+PrefixManager::aggregatesToAdvertise(
+    const folly::CIDRNetwork& prefix,
+    std::unordered_set<folly::CIDRNetwork>& changedAggregates) {
   // ATTN: ignore attribute-ONLY update for existing RIB entries
   //       as it won't affect `supporting_route_cnt`
   auto [ribPrefixIt, inserted] =
@@ -1041,12 +1401,12 @@ PrefixManager::aggregatesToAdvertise(const folly::CIDRNetwork& prefix) {
     return;
   }
 
-  for (auto& [network, route] : originatedPrefixDb_) {
-    // folly::CIDRNetwork.first -> IPAddress
-    // folly::CIDRNetwork.second -> cidr length
-    if (not prefix.first.inSubnet(network.first, network.second)) {
-      continue;
-    }
+  // ATTN: RIB prefix supports originated prefixes containing its address,
+  //       regardless of its length, hence look up the host prefix
+  for (auto const* entry : originatedPrefixTrie_.getCoveringPrefixes(
+           {prefix.first, uint8_t(prefix.first.bitCount())})) {
+    auto const& network = entry->first;
+    auto& route = *entry->second;
 
     VLOG(1) << "[Route Origination] Adding supporting route "
             << folly::IPAddress::networkToString(prefix)
@@ -1058,11 +1418,14 @@ PrefixManager::aggregatesToAdvertise(const folly::CIDRNetwork& prefix) {
 
     // mapping: OriginatedPrefix -> RIB prefixEntries
     route.supportingRoutes.emplace(prefix);
+    changedAggregates.emplace(network);
   }
 }
 
 void
-PrefixManager::aggregatesToWithdraw(const folly::CIDRNetwork& prefix) {
+PrefixManager::aggregatesToWithdraw(
+    const folly::CIDRNetwork& prefix,
+    std::unordered_set<folly::CIDRNetwork>& changedAggregates) {
   // ignore invalid RIB entry
   auto ribPrefixIt = ribPrefixDb_.find(prefix);
   if (ribPrefixIt == ribPrefixDb_.end()) {
@@ -1081,6 +1444,7 @@ PrefixManager::aggregatesToWithdraw(const folly::CIDRNetwork& prefix) {
             << folly::IPAddress::networkToString(network);
 
     route.supportingRoutes.erase(prefix);
+    changedAggregates.emplace(network);
   }
 
   // clean local caching
@@ -1089,10 +1453,21 @@ PrefixManager::aggregatesToWithdraw(const folly::CIDRNetwork& prefix) {
 
 void
 PrefixManager::processOriginatedPrefixes() {
+  std::unordered_set<folly::CIDRNetwork> networks;
+  for (auto const& [network, _] : originatedPrefixDb_) {
+    networks.emplace(network);
+  }
+  processOriginatedPrefixes(networks);
+}
+
+void
+PrefixManager::processOriginatedPrefixes(
+    const std::unordered_set<folly::CIDRNetwork>& networks) {
   std::vector<PrefixEntry> advertisedPrefixes{};
   std::vector<thrift::PrefixEntry> withdrawnPrefixes{};
 
-  for (auto& [network, route] : originatedPrefixDb_) {
+  for (auto const& network : networks) {
+    auto& route = originatedPrefixDb_.at(network);
     if (route.shouldAdvertise()) {
       route.isAdvertised = true; // mark as advertised
       advertisedPrefixes.emplace_back(
@@ -1126,6 +1501,10 @@ PrefixManager::processDecisionRouteUpdates(
     DecisionRouteUpdate&& decisionRouteUpdate) {
   std::vector<PrefixEntry> advertisedPrefixes{};
   std::vector<thrift::PrefixEntry> withdrawnPrefixes{};
+  // originated prefixes whose supporting routes changed
+  std::unordered_set<folly::CIDRNetwork> changedAggregates{};
+  // summary prefixes whose summarized areas changed
+  std::unordered_set<folly::CIDRNetwork> changedSummaries{};
 
   // ATTN: Routes imported from local BGP won't show up inside
   // `decisionRouteUpdate`. However, local-originated static route
@@ -1149,6 +1528,28 @@ PrefixManager::processDecisionRouteUpdates(
       }
     }
 
+    // populate routes to be advertised to KvStore
+    auto dstAreas = allAreaIds();
+    for (const auto& nh : route.nexthops) {
+      if (nh.area_ref().has_value()) {
+        dstAreas.erase(*nh.area_ref());
+      }
+    }
+
+    // skip route if it redistributes the same as last time
+    if (route.fingerprint == 0) {
+      route.updateFingerprint();
+    }
+    auto& redistributed = redistributedRoutes_[prefix];
+    if (redistributed.fingerprint == route.fingerprint and
+        redistributed.bestArea == route.bestArea and
+        redistributed.dstAreas == dstAreas) {
+      fb303::fbData->addStatValue(
+          "prefix_manager.redistribution_skipped", 1, fb303::SUM);
+      continue;
+    }
+    redistributed = {route.fingerprint, route.bestArea, dstAreas};
+
     // 1. append area stack
     prefixEntry.area_stack_ref()->emplace_back(route.bestArea);
     // 2. increase distance by 1
@@ -1161,19 +1562,18 @@ PrefixManager::processDecisionRouteUpdates(
     // for the purposes of redistribution from one area to another.
     prefixEntry.prependLabel_ref().reset();
 
-    // populate routes to be advertised to KvStore
-    auto dstAreas = allAreaIds();
-    for (const auto& nh : route.nexthops) {
-      if (nh.area_ref().has_value()) {
-        dstAreas.erase(*nh.area_ref());
-      }
+    // replace by summary prefixes in areas summarizing it
+    if (not areaSummaries_.empty()) {
+      unsummarizeRoute(prefix, changedSummaries);
+      summarizeRoute(
+          prefix, *prefixEntry.area_stack_ref(), dstAreas, changedSummaries);
     }
     advertisedPrefixes.emplace_back(
         std::make_shared<thrift::PrefixEntry>(std::move(prefixEntry)),
         std::move(dstAreas));
 
     // adjust supporting route count due to prefix advertisement
-    aggregatesToAdvertise(prefix);
+    aggregatesToAdvertise(prefix, changedAggregates);
   }
 
   // Delete unicast routes
@@ -1184,17 +1584,22 @@ PrefixManager::processDecisionRouteUpdates(
       // part of its own supporting routes.
       continue;
     }
+    redistributedRoutes_.erase(prefix);
 
     // Routes to be withdrawn via KvStore
     withdrawnPrefixes.emplace_back(
         createPrefixEntry(toIpPrefix(prefix), thrift::PrefixType::RIB));
 
     // adjust supporting route count due to prefix withdrawn
-    aggregatesToWithdraw(prefix);
+    aggregatesToWithdraw(prefix, changedAggregates);
+
+    if (not areaSummaries_.empty()) {
+      unsummarizeRoute(prefix, changedSummaries);
+    }
   }
 
   // Maybe advertise/withdrawn for local originated routes
-  processOriginatedPrefixes();
+  processOriginatedPrefixes(changedAggregates);
 
   // Redisrtibute RIB route ONLY when there are multiple `areaId` configured .
   // We want to keep processDecisionRouteUpdates() running as dynamic
@@ -1202,11 +1607,103 @@ PrefixManager::processDecisionRouteUpdates(
   if (areaToPolicy_.size() > 1) {
     advertisePrefixesImpl(advertisedPrefixes);
     withdrawPrefixesImpl(withdrawnPrefixes);
+    processAreaSummaries(changedSummaries);
   }
 
   // ignore mpls updates
 }
 
+void
+PrefixManager::summarizeRoute(
+    const folly::CIDRNetwork& prefix,
+    const std::vector<std::string>& areaStack,
+    std::unordered_set<std::string>& dstAreas,
+    std::unordered_set<folly::CIDRNetwork>& changedSummaries) {
+  auto const covering = areaSummaryTrie_.getCoveringPrefixes(prefix);
+  // most specific summary prefix first
+  for (auto it = covering.rbegin(); it != covering.rend(); ++it) {
+    auto const& network = (*it)->first;
+    auto& summary = *(*it)->second;
+    if (network.second >= prefix.second) {
+      // summary prefix itself is not summarized
+      continue;
+    }
+    std::unordered_set<std::string> areas;
+    for (auto const& area : summary.areas) {
+      // route from an area doesn't support summary prefix into it
+      if (dstAreas.erase(area) and
+          std::find(areaStack.begin(), areaStack.end(), area) ==
+              areaStack.end()) {
+        areas.emplace(area);
+      }
+    }
+    if (areas.empty()) {
+      continue;
+    }
+    for (auto const& area : areas) {
+      if (summary.numSupportingRoutes[area]++ == 0) {
+        changedSummaries.emplace(network);
+      }
+    }
+    summary.supportingRoutes.emplace(prefix, std::move(areas));
+  }
+}
+
+void
+PrefixManager::unsummarizeRoute(
+    const folly::CIDRNetwork& prefix,
+    std::unordered_set<folly::CIDRNetwork>& changedSummaries) {
+  for (auto const* entry : areaSummaryTrie_.getCoveringPrefixes(prefix)) {
+    auto& summary = *entry->second;
+    auto it = summary.supportingRoutes.find(prefix);
+    if (it == summary.supportingRoutes.end()) {
+      continue;
+    }
+    for (auto const& area : it->second) {
+      auto countIt = summary.numSupportingRoutes.find(area);
+      CHECK(countIt != summary.numSupportingRoutes.end());
+      if (--countIt->second == 0) {
+        summary.numSupportingRoutes.erase(countIt);
+        changedSummaries.emplace(entry->first);
+      }
+    }
+    summary.supportingRoutes.erase(it);
+  }
+}
+
+void
+PrefixManager::processAreaSummaries(
+    const std::unordered_set<folly::CIDRNetwork>& networks) {
+  std::vector<PrefixEntry> advertisedSummaries{};
+  std::vector<thrift::PrefixEntry> withdrawnSummaries{};
+  for (auto const& network : networks) {
+    auto& summary = areaSummaries_.at(network);
+    std::unordered_set<std::string> areas;
+    for (auto const& [area, _] : summary.numSupportingRoutes) {
+      areas.emplace(area);
+    }
+    if (areas == summary.advertisedAreas) {
+      continue;
+    }
+
+    VLOG(1) << "[Area Summarization] Summary prefix "
+            << folly::IPAddress::networkToString(network)
+            << " advertised to areas [" << folly::join(", ", areas) << "]";
+    if (areas.empty()) {
+      withdrawnSummaries.emplace_back(
+          createPrefixEntry(toIpPrefix(network), thrift::PrefixType::CONFIG));
+    } else {
+      advertisedSummaries.emplace_back(
+          std::make_shared<thrift::PrefixEntry>(createPrefixEntry(
+              toIpPrefix(network), thrift::PrefixType::CONFIG)),
+          areas);
+    }
+    summary.advertisedAreas = std::move(areas);
+  }
+  advertisePrefixesImpl(advertisedSummaries);
+  withdrawPrefixesImpl(withdrawnSummaries);
+}
+
 std::unordered_set<std::string>
 PrefixManager::allAreaIds() {
   std::unordered_set<std::string> allAreaIds;
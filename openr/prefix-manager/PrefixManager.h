@@ -7,19 +7,24 @@
 
 #pragma once
 
+#include <map>
+
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include "openr/if/gen-cpp2/Network_types.h"
 
 #include <openr/common/AsyncThrottle.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/PrefixTrie.h>
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/config/Config.h>
 #include <openr/decision/RouteUpdate.h>
 #include <openr/if/gen-cpp2/Network_types.h>
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 #include <openr/kvstore/KvStoreClientInternal.h>
 #include <openr/messaging/Queue.h>
@@ -87,6 +92,8 @@ class PrefixManager final : public OpenrEventBase {
    *  - withdraw prefixes
    *  - withdraw prefixes by type
    *  - sync prefixes by type: replace all prefixes of @type w/ @prefixes
+   *  - apply prefix changes: withdraw and add prefixes in one transaction,
+   *    optionally syncing kvstore right away
    *
    *
    * Read APIs - dump internal prefixDb
@@ -104,6 +111,10 @@ class PrefixManager final : public OpenrEventBase {
   folly::SemiFuture<bool> syncPrefixesByType(
       thrift::PrefixType prefixType, std::vector<thrift::PrefixEntry> prefixes);
 
+  // see OpenrCtrl.applyPrefixChanges()
+  folly::SemiFuture<thrift::PrefixChangeBatchResult> applyPrefixChanges(
+      thrift::PrefixChangeBatch batch);
+
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
   getPrefixes();
 
@@ -116,6 +127,13 @@ class PrefixManager final : public OpenrEventBase {
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::OriginatedPrefixEntry>>>
   getOriginatedPrefixes();
 
+  /*
+   * Apply originated prefixes of a reloaded config. Originated prefixes
+   * left unchanged keep their supporting routes and advertisement state.
+   */
+  folly::SemiFuture<folly::Unit> updateConfig(
+      std::shared_ptr<const Config> config);
+
   /**
    * Helper functinon used in getAreaAdvertisedRoutes()
    * Filter routes with 1. <type> attribute
@@ -176,10 +194,27 @@ class PrefixManager final : public OpenrEventBase {
       std::vector<PrefixEntry>&& tPrefixEntries,
       const std::unordered_set<std::string>& dstAreas);
   bool advertisePrefixesImpl(const std::vector<PrefixEntry>& prefixEntries);
+  // entries are moved into the db, avoiding a copy per prefix for bulk
+  // injection of prefixes
+  bool advertisePrefixesImpl(std::vector<PrefixEntry>&& prefixEntries);
   bool withdrawPrefixesImpl(
       const std::vector<thrift::PrefixEntry>& tPrefixEntries);
   bool withdrawPrefixEntriesImpl(const std::vector<PrefixEntry>& prefixEntries);
   bool withdrawPrefixesByTypeImpl(thrift::PrefixType type);
+
+  // remove entry of type from prefixMap_ and prefixesByType_
+  // @return false if there was none
+  bool eraseEntry(folly::CIDRNetwork const& prefix, thrift::PrefixType type);
+
+  // prefixes with an entry of type
+  std::unordered_set<folly::CIDRNetwork> const& getPrefixesOfType(
+      thrift::PrefixType type) const;
+
+  // call fn(prefix, typeToPrefixes) for prefixes with entries possibly
+  // passing filter
+  template <typename Fn>
+  void forEachFilteredPrefix(
+      thrift::AdvertisedRouteFilter const& filter, Fn&& fn) const;
   bool syncPrefixesByTypeImpl(
       thrift::PrefixType type,
       const std::vector<thrift::PrefixEntry>& tPrefixEntries,
@@ -192,12 +227,56 @@ class PrefixManager final : public OpenrEventBase {
    */
   void syncKvStore();
 
-  std::unordered_set<std::string> updateKvStoreKeyHelper(
-      const PrefixEntry& entry);
+  // prefix entry to advertise into an area, after area policy
+  struct AreaKeyVal {
+    std::string area;
+    // per-prefix key, or prefix db shard key
+    std::string key;
+    std::shared_ptr<thrift::PrefixEntry> postPolicyEntry;
+    // serialized prefix db, empty for prefix db shards
+    std::string value;
+  };
+
+  // best entry of a changed prefix along with its advertisements
+  struct PrefixSyncEntry {
+    folly::CIDRNetwork network;
+    // unset if prefix is withdrawn
+    PrefixEntry const* bestEntry{nullptr};
+    std::vector<AreaKeyVal> keyVals;
+  };
+
+  /*
+   * Select best entries of changed prefixes, run area policies and serialize
+   * values. Reads state ONLY, hence runs chunks of prefixes on `syncPool_`
+   * if configured.
+   */
+  std::vector<PrefixSyncEntry> buildPrefixSyncEntries(
+      const std::unordered_set<folly::CIDRNetwork>& networks) const;
 
+  PrefixSyncEntry buildPrefixSyncEntry(const folly::CIDRNetwork& network) const;
+
+  std::vector<AreaKeyVal> buildAreaKeyVals(const PrefixEntry& entry) const;
+
+  // advertise `keyVals` of entry, appending per-prefix keys to
+  // `keyValsToPersist` to persist in one batch per area
+  // @return keys advertised
+  std::unordered_set<std::string> updateKvStoreKeyHelper(
+      const PrefixEntry& entry,
+      std::vector<AreaKeyVal>&& keyVals,
+      std::unordered_map<
+          std::string,
+          std::vector<std::pair<std::string, std::string>>>& keyValsToPersist);
+
+  // withdraw `network` from deletedKeys, clearing per-prefix keys and
+  // removing it from prefix db shards
   void deleteKvStoreKeyHelper(
+      const folly::CIDRNetwork& network,
       const std::unordered_set<std::string>& deletedKeys);
 
+  // advertise prefix db shards changed since last sync, see
+  // `num_prefix_db_shards`
+  void syncPrefixDbShards();
+
   /*
    * [Route Origination/Aggregation]
    *
@@ -212,17 +291,29 @@ class PrefixManager final : public OpenrEventBase {
   void buildOriginatedPrefixDb(
       const std::vector<thrift::OriginatedPrefix>& prefixes);
 
+  /*
+   * Replace originated prefixes with the given ones. Removed and modified
+   * ones are withdrawn, and supporting routes are re-computed from the RIB
+   * prefixes received so far.
+   */
+  void updateOriginatedPrefixes(
+      const std::vector<thrift::OriginatedPrefix>& prefixes);
+
   /*
    * Util function to process ribEntry update from `Decision` and populate
    * aggregates to advertise
    */
-  void aggregatesToAdvertise(const folly::CIDRNetwork& prefix);
+  void aggregatesToAdvertise(
+      const folly::CIDRNetwork& prefix,
+      std::unordered_set<folly::CIDRNetwork>& changedAggregates);
 
   /*
    * Util function to process ribEntry update from `Decision` and populate
    * aggregates to withdraw
    */
-  void aggregatesToWithdraw(const folly::CIDRNetwork& prefix);
+  void aggregatesToWithdraw(
+      const folly::CIDRNetwork& prefix,
+      std::unordered_set<folly::CIDRNetwork>& changedAggregates);
 
   /*
    * Util function to iterate through originatedPrefixDb_ for route
@@ -230,6 +321,36 @@ class PrefixManager final : public OpenrEventBase {
    */
   void processOriginatedPrefixes();
 
+  /*
+   * Same as above, for the given originated prefixes ONLY, i.e. the ones
+   * whose supporting routes changed
+   */
+  void processOriginatedPrefixes(
+      const std::unordered_set<folly::CIDRNetwork>& networks);
+
+  /*
+   * [Area Summarization]
+   *
+   * Remove areas summarizing the route of prefix from the ones it is
+   * redistributed to, and record it as supporting route of the summary
+   * prefixes into them, unless the route came from them as per areaStack.
+   */
+  void summarizeRoute(
+      const folly::CIDRNetwork& prefix,
+      const std::vector<std::string>& areaStack,
+      std::unordered_set<std::string>& dstAreas,
+      std::unordered_set<folly::CIDRNetwork>& changedSummaries);
+
+  // Remove route of prefix from supporting routes of summary prefixes
+  void unsummarizeRoute(
+      const folly::CIDRNetwork& prefix,
+      std::unordered_set<folly::CIDRNetwork>& changedSummaries);
+
+  // Advertise/withdraw summary prefixes to the areas they have supporting
+  // routes for
+  void processAreaSummaries(
+      const std::unordered_set<folly::CIDRNetwork>& networks);
+
   // process decision route update, inject routes to different areas
   void processDecisionRouteUpdates(DecisionRouteUpdate&& decisionRouteUpdate);
 
@@ -275,6 +396,11 @@ class PrefixManager final : public OpenrEventBase {
       std::unordered_map<thrift::PrefixType, PrefixEntry>>
       prefixMap_;
 
+  // Index of prefixMap_ by prefix type. Serves queries filtered by type and
+  // sync or withdrawal of all prefixes of a type without a scan of prefixMap_
+  std::unordered_map<thrift::PrefixType, std::unordered_set<folly::CIDRNetwork>>
+      prefixesByType_;
+
   // the serializer/deserializer helper we'll be using
   apache::thrift::CompactSerializer serializer_;
 
@@ -362,6 +488,33 @@ class PrefixManager final : public OpenrEventBase {
    */
   bool enableNewPrefixFormat_{false};
 
+  /*
+   * [Sharded Prefix Db]
+   *
+   * Prefixes are packed into `numPrefixDbShards_` keys per area, if > 0.
+   * Shards are rebuilt in memory as prefixes are advertised/withdrawn and the
+   * dirty ones are written to `KvStore` in whole once per sync.
+   */
+  int32_t numPrefixDbShards_{0};
+
+  struct PrefixDbShard {
+    std::string area;
+    // ordered to serialize same shard content into same value
+    std::map<folly::CIDRNetwork, thrift::PrefixEntry> entries;
+  };
+  std::unordered_map<std::string /* shard key */, PrefixDbShard>
+      prefixDbShards_;
+  std::unordered_set<std::string> dirtyPrefixDbShards_;
+
+  /*
+   * [Parallel KvStore Sync]
+   *
+   * Workers building advertisements of changed prefixes in chunks of
+   * Constants::kPrefixSyncChunkSize, see `prefix_manager_sync_threads`.
+   * Unset with a single thread.
+   */
+  std::unique_ptr<folly::CPUThreadPoolExecutor> syncPool_;
+
   /*
    * prefixes to be originated from prefix-manager
    * ATTN: to support quick information retrieval, cache the mapping:
@@ -370,6 +523,14 @@ class PrefixManager final : public OpenrEventBase {
    */
   std::unordered_map<folly::CIDRNetwork, OriginatedRoute> originatedPrefixDb_;
 
+  /*
+   * index of originatedPrefixDb_ to find the originated prefixes covering a
+   * RIB prefix in O(prefix length) instead of a scan of all of them
+   * ATTN: points into originatedPrefixDb_, re-built along with it in
+   *       buildOriginatedPrefixDb()
+   */
+  PrefixTrie<OriginatedRoute*> originatedPrefixTrie_;
+
   /*
    * prefixes received from decision
    * ATTN: to avoid loop through ALL entries inside `originatedPrefixes`,
@@ -379,6 +540,53 @@ class PrefixManager final : public OpenrEventBase {
    */
   std::unordered_map<folly::CIDRNetwork, std::vector<folly::CIDRNetwork>>
       ribPrefixDb_;
+
+  /*
+   * [Route Redistribution]
+   *
+   * Last redistributed state of RIB routes received from decision. Updates
+   * of a route with the same best prefix entry, best area and destination
+   * areas, e.g. next-hop changes within an area, redistribute nothing new
+   * and are skipped without rebuilding their entries.
+   * ATTN: area policies and summaries are fixed for PrefixManager's
+   *       lifetime, so redistributed entries only depend on these.
+   */
+  struct RedistributedRoute {
+    // fingerprint of the best prefix entry, see RibUnicastEntry
+    uint64_t fingerprint{0};
+    std::string bestArea;
+    std::unordered_set<std::string> dstAreas;
+  };
+  std::unordered_map<folly::CIDRNetwork, RedistributedRoute>
+      redistributedRoutes_;
+
+  /*
+   * [Area Summarization]
+   *
+   * RIB routes redistributed into an area are replaced by the summary
+   * prefixes of that area covering them, see `AreaConfig.summary_prefixes`.
+   * A summary prefix is advertised into an area as long as it has a
+   * supporting route, i.e. a more specific route redistributed into it.
+   */
+  struct AreaSummary {
+    // areas summary prefix is configured for
+    std::unordered_set<std::string> areas;
+
+    // supporting routes: RIB prefix -> areas it is summarized into
+    std::unordered_map<folly::CIDRNetwork, std::unordered_set<std::string>>
+        supportingRoutes{};
+
+    // number of supporting routes per area, areas with none are erased
+    std::unordered_map<std::string, size_t> numSupportingRoutes{};
+
+    // areas summary prefix is advertised to
+    std::unordered_set<std::string> advertisedAreas{};
+  };
+  std::unordered_map<folly::CIDRNetwork, AreaSummary> areaSummaries_;
+
+  // index of areaSummaries_ to find the summary prefixes covering a RIB
+  // prefix
+  PrefixTrie<AreaSummary*> areaSummaryTrie_;
 }; // PrefixManager
 
 } // namespace openr
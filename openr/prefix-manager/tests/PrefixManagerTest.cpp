@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <fb303/ServiceData.h>
+#include <fmt/format.h>
 #include <folly/init/Init.h>
 #include <glog/logging.h>
 #include <gmock/gmock.h>
@@ -806,6 +808,102 @@ TEST_F(PrefixManagerTestFixture, GetPrefixes) {
   EXPECT_EQ(0, resp7->size());
 }
 
+TEST_F(PrefixManagerTestFixture, ApplyPrefixChanges) {
+  EXPECT_TRUE(prefixManager->advertisePrefixes({prefixEntry1}).get());
+
+  // withdraw and advertise within one batch
+  thrift::PrefixChangeBatch batch;
+  batch.prefixesToAdvertise_ref() = {prefixEntry2, prefixEntry3};
+  batch.prefixesToWithdraw_ref() = {prefixEntry1};
+  auto result = prefixManager->applyPrefixChanges(batch).get();
+  EXPECT_TRUE(*result.updated_ref());
+  EXPECT_TRUE(*result.synced_ref());
+  // prefixEntry1 change is still pending, hence synced with the batch
+  EXPECT_EQ(3, *result.numPrefixesSynced_ref());
+  EXPECT_LE(0, *result.applyTimeUs_ref());
+  EXPECT_LE(0, *result.syncTimeUs_ref());
+
+  auto prefixes = prefixManager->getPrefixes().get();
+  ASSERT_TRUE(prefixes);
+  EXPECT_EQ(2, prefixes->size());
+  EXPECT_EQ(
+      std::find(prefixes->cbegin(), prefixes->cend(), prefixEntry1),
+      prefixes->cend());
+
+  // prefix present in both ends up advertised, without any change
+  batch.prefixesToAdvertise_ref() = {prefixEntry2};
+  batch.prefixesToWithdraw_ref() = {prefixEntry2};
+  result = prefixManager->applyPrefixChanges(batch).get();
+  EXPECT_TRUE(*result.updated_ref());
+  EXPECT_EQ(1, *result.numPrefixesSynced_ref());
+  EXPECT_EQ(2, prefixManager->getPrefixes().get()->size());
+
+  // no-op batch left to throttled sync
+  batch.prefixesToAdvertise_ref() = {prefixEntry3};
+  batch.prefixesToWithdraw_ref() = {};
+  batch.syncImmediately_ref() = false;
+  result = prefixManager->applyPrefixChanges(batch).get();
+  EXPECT_FALSE(*result.updated_ref());
+  EXPECT_FALSE(*result.synced_ref());
+  EXPECT_EQ(0, *result.numPrefixesSynced_ref());
+}
+
+class PrefixManagerParallelSyncFixture : public PrefixManagerTestFixture {
+ public:
+  thrift::OpenrConfig
+  createConfig() override {
+    auto tConfig = PrefixManagerTestFixture::createConfig();
+    tConfig.prefix_manager_sync_threads_ref() = 4;
+    return tConfig;
+  }
+
+  void
+  waitForNumPrefixes(uint32_t expected) {
+    const auto startTime = std::chrono::steady_clock::now();
+    while (getNumPrefixes(Constants::kPrefixDbMarker.toString()) != expected) {
+      ASSERT_LT(
+          std::chrono::steady_clock::now() - startTime,
+          std::chrono::seconds(10));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+};
+
+/*
+ * Syncs spanning multiple chunks are built on the worker pool and advertise
+ * the same keys as the sequential sync
+ */
+TEST_F(PrefixManagerParallelSyncFixture, AdvertiseWithdraw) {
+  const size_t numPrefixes = 3 * Constants::kPrefixSyncChunkSize + 1;
+  std::vector<thrift::PrefixEntry> prefixes;
+  for (size_t i = 0; i < numPrefixes; ++i) {
+    prefixes.emplace_back(createPrefixEntry(
+        toIpPrefix(fmt::format("fc00:{:x}::/64", i)),
+        thrift::PrefixType::LOOPBACK));
+  }
+
+  thrift::PrefixChangeBatch batch;
+  batch.prefixesToAdvertise_ref() = prefixes;
+  auto result = prefixManager->applyPrefixChanges(batch).get();
+  EXPECT_TRUE(*result.synced_ref());
+  EXPECT_EQ(numPrefixes, *result.numPrefixesSynced_ref());
+  waitForNumPrefixes(numPrefixes);
+
+  // withdraw every other prefix
+  std::vector<thrift::PrefixEntry> withdrawn;
+  for (size_t i = 0; i < numPrefixes; i += 2) {
+    withdrawn.emplace_back(prefixes.at(i));
+  }
+  batch.prefixesToAdvertise_ref() = {};
+  batch.prefixesToWithdraw_ref() = withdrawn;
+  result = prefixManager->applyPrefixChanges(batch).get();
+  EXPECT_TRUE(*result.synced_ref());
+  waitForNumPrefixes(numPrefixes - withdrawn.size());
+  EXPECT_EQ(
+      numPrefixes - withdrawn.size(),
+      prefixManager->getPrefixes().get()->size());
+}
+
 TEST_F(PrefixManagerTestFixture, PrefixUpdatesQueue) {
   // ADD_PREFIXES
   {
@@ -934,6 +1032,32 @@ TEST_F(PrefixManagerTestFixture, PrefixUpdatesQueue) {
   }
 }
 
+/**
+ * Verifies events of prefixUpdatesQueue are acknowledged with their sequence
+ * number once applied
+ */
+TEST_F(PrefixManagerTestFixture, PrefixUpdatesQueueAck) {
+  std::vector<folly::SemiFuture<uint64_t>> acks;
+  for (uint64_t seqNum : {1, 2}) {
+    PrefixEvent event(
+        PrefixEventType::ADD_PREFIXES,
+        std::nullopt,
+        {seqNum == 1 ? prefixEntry1 : prefixEntry7});
+    event.seqNum = seqNum;
+    event.ack = std::make_shared<folly::Promise<uint64_t>>();
+    acks.emplace_back(event.ack->getSemiFuture());
+    prefixUpdatesQueue.push(std::move(event));
+  }
+
+  EXPECT_EQ(1, std::move(acks.at(0)).get());
+  EXPECT_EQ(2, std::move(acks.at(1)).get());
+
+  // Both events are applied once acknowledged
+  auto prefixes = prefixManager->getPrefixes().get();
+  EXPECT_THAT(
+      *prefixes, testing::UnorderedElementsAre(prefixEntry1, prefixEntry7));
+}
+
 /**
  * Verifies `getAdvertisedRoutesFiltered` with all filter combinations
  */
@@ -1294,7 +1418,23 @@ TEST_F(PrefixManagerMultiAreaTestFixture, DecisionRouteNexthopUpdates) {
   }
 
   //
-  // 2. add C into ecmp group, ecmp areas = [A, B, C], best area = A
+  // 2. add another nexthop of A into ecmp group, ecmp areas = [A, B]
+  //    => nothing to redistribute, route is skipped
+  //
+  auto path1_3_1 = createNextHop(
+      toBinaryAddress(folly::IPAddress("fe80::3")),
+      std::string("iface_1_3_1"),
+      1);
+  path1_3_1.area_ref() = "A";
+  unicast1A.nexthops.emplace(path1_3_1);
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.addRouteToUpdate(unicast1A);
+    routeUpdatesQueue.push(std::move(routeUpdate));
+  }
+
+  //
+  // 3. add C into ecmp group, ecmp areas = [A, B, C], best area = A
   //    => C receive withdraw
   //
   unicast1A.nexthops.emplace(path1_2_3);
@@ -1311,10 +1451,14 @@ TEST_F(PrefixManagerMultiAreaTestFixture, DecisionRouteNexthopUpdates) {
     EXPECT_EQ(0, got.size());
     EXPECT_EQ(1, gotDeleted.size());
     EXPECT_EQ(addr1, *gotDeleted.at(keyStrC).prefix_ref());
+
+    // update of step 2 was processed before
+    EXPECT_TRUE(fb303::fbData->getCounters().count(
+        "prefix_manager.redistribution_skipped.sum"));
   }
 
   //
-  // 3. withdraw B from ecmp group, ecmp areas = [A, C], best area = A
+  // 4. withdraw B from ecmp group, ecmp areas = [A, C], best area = A
   //    => B receive update
   //
   unicast1A.nexthops.erase(path1_2_2);
@@ -1334,7 +1478,7 @@ TEST_F(PrefixManagerMultiAreaTestFixture, DecisionRouteNexthopUpdates) {
   }
 
   //
-  // 4. change ecmp group to [B], best area = B
+  // 5. change ecmp group to [B], best area = B
   //    => B receive withdraw, A, C receive update
   //
 
@@ -1374,7 +1518,7 @@ TEST_F(PrefixManagerMultiAreaTestFixture, DecisionRouteNexthopUpdates) {
   }
 
   //
-  // 5. Withdraw prefix1
+  // 6. Withdraw prefix1
   //    => A, C receive prefix withdrawal
   //
   {
@@ -1396,6 +1540,107 @@ TEST_F(PrefixManagerMultiAreaTestFixture, DecisionRouteNexthopUpdates) {
   }
 }
 
+class AreaSummaryTestFixture : public PrefixManagerMultiAreaTestFixture {
+ protected:
+  thrift::OpenrConfig
+  createConfig() override {
+    auto tConfig = PrefixManagerMultiAreaTestFixture::createConfig();
+    for (auto& areaConfig : *tConfig.areas_ref()) {
+      if (*areaConfig.area_id_ref() == "C") {
+        areaConfig.summary_prefixes_ref() = {"10.0.0.0/8"};
+      }
+    }
+    return tConfig;
+  }
+};
+
+/**
+ * Verify more specific routes are replaced by the summary prefix in the area
+ * configured with it, which is advertised as long as any of them exists
+ */
+TEST_F(AreaSummaryTestFixture, SummarizeRoutes) {
+  auto kvStoreUpdatesQueue = kvStoreWrapper->getReader();
+
+  auto path = createNextHop(
+      toBinaryAddress(folly::IPAddress("fe80::2")),
+      std::string("iface_1_2_1"),
+      1);
+  path.area_ref() = "A";
+
+  const auto summary = toIpPrefix("10.0.0.0/8");
+  const auto prefix1 = toIpPrefix("10.1.0.0/16");
+  const auto prefix2 = toIpPrefix("10.2.0.0/16");
+  auto getKey = [&](thrift::IpPrefix const& prefix, std::string const& area) {
+    return PrefixKey(nodeId_, toIPNetwork(prefix), area).getPrefixKey();
+  };
+  using Entries = std::map<std::string, thrift::PrefixEntry>;
+  auto readPublications =
+      [&](size_t numPubs, Entries& got, Entries& gotDeleted) {
+        // skip ttl updates
+        size_t gotPubCnt{0};
+        while (gotPubCnt < numPubs) {
+          auto pub = kvStoreUpdatesQueue.get().value();
+          gotPubCnt += readPublication(pub, got, gotDeleted);
+        }
+      };
+
+  //
+  // 1. Inject prefix1 and prefix2 from area A
+  //    => B receives both, C receives summary prefix only
+  //
+  {
+    DecisionRouteUpdate routeUpdate;
+    for (auto const& prefix : {prefix1, prefix2}) {
+      routeUpdate.addRouteToUpdate(RibUnicastEntry(
+          toIPNetwork(prefix), {path}, createPrefixEntry(prefix), "A", false));
+    }
+    routeUpdatesQueue.push(std::move(routeUpdate));
+
+    Entries got, gotDeleted;
+    readPublications(3, got, gotDeleted);
+    EXPECT_EQ(0, gotDeleted.size());
+    ASSERT_EQ(3, got.size());
+    EXPECT_EQ(prefix1, *got.at(getKey(prefix1, "B")).prefix_ref());
+    EXPECT_EQ(prefix2, *got.at(getKey(prefix2, "B")).prefix_ref());
+    auto const& summaryEntry = got.at(getKey(summary, "C"));
+    EXPECT_EQ(summary, *summaryEntry.prefix_ref());
+    EXPECT_EQ(thrift::PrefixType::CONFIG, *summaryEntry.type_ref());
+  }
+
+  //
+  // 2. Withdraw prefix1
+  //    => B receives withdrawal, summary prefix stays in C
+  //
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete.emplace_back(toIPNetwork(prefix1));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+
+    Entries got, gotDeleted;
+    readPublications(1, got, gotDeleted);
+    EXPECT_EQ(0, got.size());
+    ASSERT_EQ(1, gotDeleted.size());
+    EXPECT_EQ(1, gotDeleted.count(getKey(prefix1, "B")));
+  }
+
+  //
+  // 3. Withdraw prefix2
+  //    => B receives withdrawal, summary prefix is withdrawn from C
+  //
+  {
+    DecisionRouteUpdate routeUpdate;
+    routeUpdate.unicastRoutesToDelete.emplace_back(toIPNetwork(prefix2));
+    routeUpdatesQueue.push(std::move(routeUpdate));
+
+    Entries got, gotDeleted;
+    readPublications(2, got, gotDeleted);
+    EXPECT_EQ(0, got.size());
+    ASSERT_EQ(2, gotDeleted.size());
+    EXPECT_EQ(1, gotDeleted.count(getKey(prefix2, "B")));
+    EXPECT_EQ(1, gotDeleted.count(getKey(summary, "C")));
+  }
+}
+
 class RouteOriginationFixture : public PrefixManagerMultiAreaTestFixture {
  public:
   openr::thrift::OpenrConfig
@@ -1626,6 +1871,48 @@ TEST_F(RouteOriginationOverrideFixture, ReadFromConfig) {
   waitForKvStorePublication(kvStoreUpdatesReader, exp, expDeleted);
 }
 
+//
+// Test case to verify originated prefixes removed from a reloaded config are
+// withdrawn, while the ones left in place stay advertised.
+//
+TEST_F(RouteOriginationOverrideFixture, UpdateConfig) {
+  auto kvStoreUpdatesReader = kvStoreWrapper->getReader();
+
+  const auto bestPrefixEntryV4_ =
+      createPrefixEntry(toIpPrefix(v4Prefix_), thrift::PrefixType::CONFIG);
+  const auto bestPrefixEntryV6_ =
+      createPrefixEntry(toIpPrefix(v6Prefix_), thrift::PrefixType::CONFIG);
+  {
+    std::unordered_map<std::string, thrift::PrefixEntry> exp({
+        {keyStrAV4_, bestPrefixEntryV4_},
+        {keyStrBV4_, bestPrefixEntryV4_},
+        {keyStrCV4_, bestPrefixEntryV4_},
+        {keyStrAV6_, bestPrefixEntryV6_},
+        {keyStrBV6_, bestPrefixEntryV6_},
+        {keyStrCV6_, bestPrefixEntryV6_},
+    });
+    std::unordered_set<std::string> expDeleted{};
+    waitForKvStorePublication(kvStoreUpdatesReader, exp, expDeleted);
+  }
+
+  // reload config without the v6 originated prefix
+  auto tConfig = createConfig();
+  tConfig.originated_prefixes_ref()->pop_back();
+  prefixManager->updateConfig(std::make_shared<const Config>(tConfig)).get();
+
+  {
+    std::unordered_map<std::string, thrift::PrefixEntry> exp{};
+    std::unordered_set<std::string> expDeleted{
+        keyStrAV6_, keyStrBV6_, keyStrCV6_};
+    waitForKvStorePublication(kvStoreUpdatesReader, exp, expDeleted);
+  }
+
+  auto prefixEntries = *prefixManager->getOriginatedPrefixes().get();
+  ASSERT_EQ(1, prefixEntries.size());
+  EXPECT_EQ(v4Prefix_, *prefixEntries.at(0).prefix_ref()->prefix_ref());
+  EXPECT_TRUE(*prefixEntries.at(0).installed_ref());
+}
+
 TEST_F(RouteOriginationFixture, BasicAdvertiseWithdraw) {
   // RQueue interface to read route updates
   auto staticRoutesReader = staticRouteUpdatesQueue.getReader();
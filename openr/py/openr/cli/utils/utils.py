@@ -1881,8 +1881,13 @@ def print_spt_infos(
             state = click.style("PASSIVE", fg="green")
         else:
             state = click.style("ACTIVE", fg="red")
-        cap = "root@{}[{}]: parent: {}, cost: {}, ({}) children".format(
-            root, state, info.parent, info.cost, len(info.children)
+        cap = "root@{}[{}]: parent: {}, cost: {}, ({}) children, {} flooded".format(
+            root,
+            state,
+            info.parent,
+            info.cost,
+            len(info.children),
+            info.floodPublications,
         )
         rows = []
         # pyre-fixme[16]: `Optional` has no attribute `items`.
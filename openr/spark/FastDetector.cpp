@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+
+#include <fb303/ServiceData.h>
+#include <folly/IPAddress.h>
+#include <folly/String.h>
+#include <folly/hash/Hash.h>
+#include <folly/lang/Bits.h>
+#include <glog/logging.h>
+
+#include <openr/common/Constants.h>
+#include <openr/spark/FastDetector.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace {
+
+//
+// Max number of packets received per syscall
+//
+const int kMaxRecvBatchSize = 32;
+
+//
+// The acceptable hop limit, assuming we send packets with this TTL
+//
+const int kHopLimit = 255;
+
+std::chrono::microseconds
+getCurrentTimeInUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+}
+
+} // namespace
+
+namespace openr {
+
+FastDetector::FastDetector(
+    std::string const& nodeName,
+    uint16_t port,
+    std::chrono::milliseconds txInterval,
+    uint32_t detectMultiplier,
+    std::optional<int> maybeIpTos,
+    std::shared_ptr<IoProvider> ioProvider,
+    NeighborDownCallback neighborDownCb)
+    : myNodeHash_(hashNodeName(nodeName)),
+      port_(port),
+      txInterval_(txInterval),
+      detectTime_(txInterval * detectMultiplier),
+      maybeIpTos_(maybeIpTos),
+      ioProvider_(std::move(ioProvider)),
+      neighborDownCb_(std::move(neighborDownCb)) {
+  CHECK(txInterval_ > std::chrono::milliseconds(0))
+      << "fast detection interval can't be 0";
+  CHECK(detectMultiplier > 0) << "detect multiplier can't be 0";
+  CHECK(ioProvider_) << "Got null IoProvider";
+  CHECK(neighborDownCb_) << "Got null neighbor down callback";
+
+  prepareSocket();
+
+  // periodic send and expiry check
+  tickTimer_ = folly::AsyncTimeout::make(
+      *getEvb(), [this]() noexcept { processTick(); });
+  tickTimer_->scheduleTimeout(txInterval_);
+
+  fb303::fbData->addStatExportType(
+      "spark.fast_detection.jitter_us", fb303::AVG);
+  fb303::fbData->addStatExportType(
+      "spark.fast_detection.jitter_us", fb303::MAX);
+  fb303::fbData->addStatExportType(
+      "spark.fast_detection.neighbor_down", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "spark.fast_detection.false_positive", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "spark.fast_detection.invalid_packet", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "spark.fast_detection.send_failure", fb303::SUM);
+}
+
+void
+FastDetector::run() {
+  // NOTE: lowest real-time priority is already above any SCHED_OTHER thread
+  struct sched_param param;
+  param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+  const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (err != 0) {
+    LOG(WARNING) << "Failed raising priority of fast detection thread. "
+                 << "Error: " << folly::errnoStr(err);
+  }
+
+  // Invoke run method of super class, this blocks until stop()
+  OpenrEventBase::run();
+}
+
+void
+FastDetector::addSession(
+    std::string const& ifName,
+    int ifIndex,
+    folly::IPAddressV6 const& v6LinkLocalAddr,
+    std::string const& neighborName) {
+  runInEventBaseThread([this,
+                        ifName,
+                        ifIndex,
+                        v6LinkLocalAddr,
+                        neighborName]() noexcept {
+    const SessionKey key{ifIndex, hashNodeName(neighborName)};
+    if (sessions_.count(key)) {
+      return;
+    }
+
+    // a recently downed session already holds a reference on the interface
+    if (downSessions_.erase(key) == 0) {
+      refInterface(ifIndex, v6LinkLocalAddr);
+    }
+
+    Session session;
+    session.ifName = ifName;
+    session.neighborName = neighborName;
+    sessions_.emplace(key, std::move(session));
+
+    VLOG(1) << "Added fast detection session with " << neighborName
+            << " on interface " << ifName;
+  });
+}
+
+void
+FastDetector::removeSession(
+    std::string const& ifName, std::string const& neighborName) {
+  runInEventBaseThread([this, ifName, neighborName]() noexcept {
+    const auto nodeHash = hashNodeName(neighborName);
+    for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+      if (it->first.second == nodeHash and it->second.ifName == ifName) {
+        const auto ifIndex = it->first.first;
+        sessions_.erase(it);
+        unrefInterface(ifIndex);
+
+        VLOG(1) << "Removed fast detection session with " << neighborName
+                << " on interface " << ifName;
+        return;
+      }
+    }
+  });
+}
+
+folly::SemiFuture<size_t>
+FastDetector::getNumSessions() {
+  folly::Promise<size_t> promise;
+  auto sf = promise.getSemiFuture();
+  runInEventBaseThread([this, promise = std::move(promise)]() mutable {
+    promise.setValue(sessions_.size());
+  });
+  return sf;
+}
+
+// static
+std::string
+FastDetector::encodePacket(uint32_t seqNum, uint64_t nodeHash) {
+  std::string packet(kPacketSize, '\0');
+  auto* buf = reinterpret_cast<uint8_t*>(packet.data());
+
+  const uint16_t magic = folly::Endian::big(kPacketMagic);
+  const uint32_t seq = folly::Endian::big(seqNum);
+  const uint64_t hash = folly::Endian::big(nodeHash);
+  ::memcpy(buf, &magic, sizeof(magic));
+  buf[2] = kPacketVersion;
+  buf[3] = 0; // reserved
+  ::memcpy(buf + 4, &seq, sizeof(seq));
+  ::memcpy(buf + 8, &hash, sizeof(hash));
+  return packet;
+}
+
+// static
+bool
+FastDetector::decodePacket(
+    uint8_t const* buf, size_t len, uint32_t& seqNum, uint64_t& nodeHash) {
+  if (len != kPacketSize) {
+    return false;
+  }
+
+  uint16_t magic;
+  ::memcpy(&magic, buf, sizeof(magic));
+  if (folly::Endian::big(magic) != kPacketMagic or buf[2] != kPacketVersion) {
+    return false;
+  }
+
+  uint32_t seq;
+  uint64_t hash;
+  ::memcpy(&seq, buf + 4, sizeof(seq));
+  ::memcpy(&hash, buf + 8, sizeof(hash));
+  seqNum = folly::Endian::big(seq);
+  nodeHash = folly::Endian::big(hash);
+  return true;
+}
+
+// static
+uint64_t
+FastDetector::hashNodeName(std::string const& nodeName) {
+  return folly::hash::fnv64(nodeName);
+}
+
+void
+FastDetector::prepareSocket() {
+  fd_ = ioProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd_ < 0) {
+    LOG(FATAL) << "Failed creating fast detection UDP socket. Error: "
+               << folly::errnoStr(errno);
+  }
+  LOG(INFO) << "Created UDP socket for fast detection. fd: " << fd_;
+
+  // make socket non-blocking
+  if (ioProvider_->fcntl(fd_, F_SETFL, O_NONBLOCK) != 0) {
+    LOG(FATAL) << "Failed making the socket non-blocking. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // make v6 only
+  int v6Only = 1;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only)) != 0) {
+    LOG(FATAL) << "Failed making the socket v6 only. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  int reuseAddr = 1;
+  if (ioProvider_->setsockopt(
+          fd_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr)) != 0) {
+    LOG(FATAL) << "Failed making the socket reuse addr. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // request input iface index and sender address
+  int recvPktInfo = 1;
+  if (ioProvider_->setsockopt(
+          fd_,
+          IPPROTO_IPV6,
+          IPV6_RECVPKTINFO,
+          &recvPktInfo,
+          sizeof(recvPktInfo)) != 0) {
+    LOG(FATAL) << "Failed enabling PKTINFO option. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // Set ip-tos
+  if (maybeIpTos_.has_value()) {
+    int ipTos = maybeIpTos_.value();
+    if (ioProvider_->setsockopt(
+            fd_, IPPROTO_IPV6, IPV6_TCLASS, &ipTos, sizeof(int)) != 0) {
+      LOG(FATAL) << "Failed setting ip-tos value on socket. Error: "
+                 << folly::errnoStr(errno);
+    }
+  }
+
+  // bind the socket to receive any mcast packet on fast detection port
+  {
+    auto sockAddr = folly::SocketAddress(folly::IPAddress("::"), port_);
+    sockaddr_storage addrStorage;
+    sockAddr.getAddress(&addrStorage);
+    sockaddr* saddr = reinterpret_cast<sockaddr*>(&addrStorage);
+
+    if (ioProvider_->bind(fd_, saddr, sockAddr.getActualSize()) != 0) {
+      LOG(FATAL) << "Failed binding the socket. Error: "
+                 << folly::errnoStr(errno);
+    }
+  }
+
+  // set the TTL to maximum, so we can check for spoofed addresses
+  int ttl = kHopLimit;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof(ttl)) != 0) {
+    LOG(FATAL) << "Failed setting TTL on socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // allow reporting the packet TTL to user space
+  int recvHopLimit = 1;
+  if (ioProvider_->setsockopt(
+          fd_,
+          IPPROTO_IPV6,
+          IPV6_RECVHOPLIMIT,
+          &recvHopLimit,
+          sizeof(recvHopLimit)) != 0) {
+    LOG(FATAL) << "Failed enabling TTL receive on socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // disable looping packets to ourselves
+  const int loop = 0;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+    LOG(FATAL) << "Failed disabling looping on socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // kernel timestamps make jitter measurement independent of our scheduling
+  const int enabled = 1;
+  if (ioProvider_->setsockopt(
+          fd_, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) != 0) {
+    LOG(ERROR) << "Failed to enable kernel timestamping. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  addSocketFd(fd_, ZMQ_POLLIN, [this](int) noexcept {
+    try {
+      processPacket();
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "FastDetector: error processing packet "
+                 << folly::exceptionStr(err);
+    }
+  });
+}
+
+void
+FastDetector::refInterface(
+    int ifIndex, folly::IPAddressV6 const& v6LinkLocalAddr) {
+  auto [it, inserted] =
+      interfaces_.emplace(ifIndex, std::make_pair(0, v6LinkLocalAddr));
+  ++it->second.first;
+  if (not inserted) {
+    return;
+  }
+
+  const auto mcastGroup = folly::IPAddressV6(Constants::kSparkMcastAddr.str());
+  struct ipv6_mreq mreq;
+  mreq.ipv6mr_interface = ifIndex;
+  ::memcpy(&mreq.ipv6mr_multiaddr, mcastGroup.bytes(), mcastGroup.byteCount());
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)) != 0) {
+    LOG(ERROR) << "Failed joining multicast group on ifIndex " << ifIndex
+               << ". Error: " << folly::errnoStr(errno);
+  }
+}
+
+void
+FastDetector::unrefInterface(int ifIndex) {
+  auto it = interfaces_.find(ifIndex);
+  CHECK(it != interfaces_.end());
+  if (--it->second.first > 0) {
+    return;
+  }
+  interfaces_.erase(it);
+
+  const auto mcastGroup = folly::IPAddressV6(Constants::kSparkMcastAddr.str());
+  struct ipv6_mreq mreq;
+  mreq.ipv6mr_interface = ifIndex;
+  ::memcpy(&mreq.ipv6mr_multiaddr, mcastGroup.bytes(), mcastGroup.byteCount());
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_LEAVE_GROUP, &mreq, sizeof(mreq)) != 0) {
+    LOG(ERROR) << "Failed leaving multicast group on ifIndex " << ifIndex
+               << ". Error: " << folly::errnoStr(errno);
+  }
+}
+
+void
+FastDetector::processTick() noexcept {
+  const auto now = std::chrono::steady_clock::now();
+
+  // send one packet per interface, with a single syscall
+  if (not interfaces_.empty()) {
+    const auto packet = encodePacket(seqNum_++, myNodeHash_);
+    const folly::SocketAddress dstAddr(
+        folly::IPAddress(Constants::kSparkMcastAddr.str()), port_);
+
+    std::vector<IoProvider::SendRequest> requests;
+    requests.reserve(interfaces_.size());
+    for (auto const& [ifIndex, entry] : interfaces_) {
+      requests.emplace_back(
+          IoProvider::SendRequest{ifIndex, entry.second, dstAddr, packet});
+    }
+    const auto results =
+        IoProvider::sendMessages(fd_, requests, ioProvider_.get());
+    for (auto const bytesSent : results) {
+      if (bytesSent != static_cast<ssize_t>(packet.size())) {
+        fb303::fbData->addStatValue(
+            "spark.fast_detection.send_failure", 1, fb303::SUM);
+      }
+    }
+  }
+
+  // declare down armed sessions we have not heard from within detect time
+  std::vector<SessionKey> expiredKeys;
+  for (auto const& [key, session] : sessions_) {
+    if (session.armed and now - session.lastRecvTime > detectTime_) {
+      expiredKeys.emplace_back(key);
+    }
+  }
+  for (auto const& key : expiredKeys) {
+    auto it = sessions_.find(key);
+    auto session = std::move(it->second);
+    sessions_.erase(it);
+
+    LOG(INFO) << "Fast detection timer expired for: " << session.neighborName
+              << " on interface " << session.ifName;
+    fb303::fbData->addStatValue(
+        "spark.fast_detection.neighbor_down", 1, fb303::SUM);
+
+    // keep the interface reference until downed session is purged
+    downSessions_[key] = DownSession{session.lastSeqNum, now};
+    neighborDownCb_(session.ifName, session.neighborName);
+  }
+
+  // purge downed sessions not heard from within detect time
+  for (auto it = downSessions_.begin(); it != downSessions_.end();) {
+    if (now - it->second.downTime > detectTime_) {
+      unrefInterface(it->first.first);
+      it = downSessions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  tickTimer_->scheduleTimeout(txInterval_);
+}
+
+void
+FastDetector::processPacket() {
+  recvBuf_.resize(kMaxRecvBatchSize * kPacketSize);
+  while (true) {
+    const auto msgs = IoProvider::recvMessages(
+        fd_,
+        recvBuf_.data(),
+        kPacketSize,
+        kMaxRecvBatchSize,
+        ioProvider_.get());
+    const auto now = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < msgs.size(); ++i) {
+      auto const& [bytesRead, ifIndex, srcAddr, hopLimit, kernelRecvTs] =
+          msgs[i];
+
+      uint32_t seqNum{0};
+      uint64_t nodeHash{0};
+      if (hopLimit < kHopLimit or bytesRead < 0 or
+          not decodePacket(
+              recvBuf_.data() + i * kPacketSize,
+              static_cast<size_t>(bytesRead),
+              seqNum,
+              nodeHash)) {
+        fb303::fbData->addStatValue(
+            "spark.fast_detection.invalid_packet", 1, fb303::SUM);
+        continue;
+      }
+      if (nodeHash == myNodeHash_) {
+        continue; // looped packet
+      }
+
+      const SessionKey key{ifIndex, nodeHash};
+      auto it = sessions_.find(key);
+      if (it == sessions_.end()) {
+        // neighbor declared down recently but kept on sending
+        auto downIt = downSessions_.find(key);
+        if (downIt != downSessions_.end() and
+            seqNum > downIt->second.lastSeqNum) {
+          LOG(WARNING) << "Fast detection false positive on ifIndex "
+                       << ifIndex << ", seq#: " << seqNum
+                       << ", last seq#: " << downIt->second.lastSeqNum;
+          fb303::fbData->addStatValue(
+              "spark.fast_detection.false_positive", 1, fb303::SUM);
+          downSessions_.erase(downIt);
+          unrefInterface(ifIndex);
+        }
+        continue;
+      }
+
+      auto& session = it->second;
+      const auto recvTs = kernelRecvTs.count() ? kernelRecvTs
+                                               : getCurrentTimeInUs();
+      if (session.armed and seqNum == session.lastSeqNum + 1) {
+        const auto interArrival = recvTs - session.lastRecvTs;
+        const auto jitter = std::chrono::abs(
+            interArrival -
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                txInterval_));
+        fb303::fbData->addStatValue(
+            "spark.fast_detection.jitter_us", jitter.count(), fb303::AVG);
+      }
+      session.armed = true;
+      session.lastSeqNum = seqNum;
+      session.lastRecvTime = now;
+      session.lastRecvTs = recvTs;
+    }
+
+    if (msgs.size() < static_cast<size_t>(kMaxRecvBatchSize)) {
+      break; // socket drained
+    }
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddressV6.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/AsyncTimeout.h>
+
+#include <openr/common/OpenrEventBase.h>
+#include <openr/spark/IoProvider.h>
+
+namespace openr {
+
+//
+// FastDetector implements a BFD-like liveness check for established Spark
+// neighbors. It runs on its own event base and thread (with real-time
+// priority when permitted), so that its timers are not delayed by the
+// processing of the main Spark event base. Every `txInterval` it multicasts a
+// fixed 16-byte packet over each interface having sessions, on a dedicated
+// UDP port. A session is declared down when nothing has been heard from the
+// neighbor for `txInterval * detectMultiplier`.
+//
+// FastDetector only ever signals neighbor down via the callback (invoked in
+// its own thread). Neighbor discovery and the adjacency state machine remain
+// with Spark. Sessions are armed on the first packet received from the
+// neighbor, so nodes not running fast detection fall back to Spark's
+// heartbeat hold timer.
+//
+// Exported counters:
+//  - spark.fast_detection.jitter_us: deviation of packet inter-arrival time
+//    from `txInterval`
+//  - spark.fast_detection.neighbor_down: sessions declared down
+//  - spark.fast_detection.false_positive: sessions declared down whose
+//    neighbor kept sending, i.e. packet with an increasing sequence number
+//    received within detect time after declaring it down
+//
+class FastDetector final : public OpenrEventBase {
+ public:
+  using NeighborDownCallback = std::function<void(
+      std::string const& ifName, std::string const& neighborName)>;
+
+  FastDetector(
+      std::string const& nodeName,
+      uint16_t port,
+      std::chrono::milliseconds txInterval,
+      uint32_t detectMultiplier,
+      std::optional<int> maybeIpTos,
+      std::shared_ptr<IoProvider> ioProvider,
+      NeighborDownCallback neighborDownCb);
+
+  ~FastDetector() override = default;
+
+  // override run() to raise scheduling priority of the detector thread
+  void run() override;
+
+  // start tracking neighbor on the interface. Thread safe.
+  void addSession(
+      std::string const& ifName,
+      int ifIndex,
+      folly::IPAddressV6 const& v6LinkLocalAddr,
+      std::string const& neighborName);
+
+  // stop tracking neighbor on the interface. Thread safe.
+  void removeSession(
+      std::string const& ifName, std::string const& neighborName);
+
+  // number of tracked sessions, used for unit-testing
+  folly::SemiFuture<size_t> getNumSessions();
+
+  //
+  // Packet encoding. All fields are in network byte order.
+  //
+  static constexpr size_t kPacketSize{16};
+  static constexpr uint16_t kPacketMagic{0x5fd7};
+  static constexpr uint8_t kPacketVersion{1};
+
+  static std::string encodePacket(uint32_t seqNum, uint64_t nodeHash);
+
+  // return false if packet is malformed
+  static bool decodePacket(
+      uint8_t const* buf, size_t len, uint32_t& seqNum, uint64_t& nodeHash);
+
+ private:
+  FastDetector(FastDetector const&) = delete;
+  FastDetector& operator=(FastDetector const&) = delete;
+
+  struct Session {
+    std::string ifName;
+    std::string neighborName;
+    // sessions are armed once we heard from the neighbor
+    bool armed{false};
+    uint32_t lastSeqNum{0};
+    std::chrono::steady_clock::time_point lastRecvTime;
+    // kernel or user-space receive time of last packet, for jitter
+    std::chrono::microseconds lastRecvTs{0};
+  };
+
+  struct DownSession {
+    uint32_t lastSeqNum{0};
+    std::chrono::steady_clock::time_point downTime;
+  };
+
+  // sessions are keyed by interface index and hash of neighbor name
+  using SessionKey = std::pair<int /* ifIndex */, uint64_t /* nodeHash */>;
+
+  struct SessionKeyHash {
+    size_t
+    operator()(SessionKey const& key) const {
+      return std::hash<int>()(key.first) ^ std::hash<uint64_t>()(key.second);
+    }
+  };
+
+  void prepareSocket();
+
+  // send packets, check sessions and schedule the next tick
+  void processTick() noexcept;
+
+  void processPacket();
+
+  // join/leave multicast group based on number of sessions on interface
+  void refInterface(int ifIndex, folly::IPAddressV6 const& v6LinkLocalAddr);
+  void unrefInterface(int ifIndex);
+
+  static uint64_t hashNodeName(std::string const& nodeName);
+
+  const uint64_t myNodeHash_{0};
+  const uint16_t port_{0};
+  const std::chrono::milliseconds txInterval_;
+  const std::chrono::milliseconds detectTime_;
+  const std::optional<int> maybeIpTos_;
+
+  std::shared_ptr<IoProvider> ioProvider_;
+  NeighborDownCallback neighborDownCb_;
+
+  int fd_{-1};
+
+  // sequence number of next packet to send
+  uint32_t seqNum_{0};
+
+  std::unordered_map<SessionKey, Session, SessionKeyHash> sessions_;
+
+  // recently declared down sessions, for false positive accounting
+  std::unordered_map<SessionKey, DownSession, SessionKeyHash> downSessions_;
+
+  // interfaces with sessions: ifIndex -> (refcount, source address)
+  std::unordered_map<int, std::pair<size_t, folly::IPAddressV6>> interfaces_;
+
+  std::unique_ptr<folly::AsyncTimeout> tickTimer_;
+
+  std::vector<uint8_t> recvBuf_;
+};
+
+} // namespace openr
@@ -6,7 +6,9 @@
  */
 
 #include <glog/logging.h>
+#include <linux/errqueue.h>
 #include <net/if.h>
+#include <optional>
 
 #include <folly/Format.h>
 #include <folly/SocketAddress.h>
@@ -14,84 +16,29 @@
 
 namespace openr {
 
-int
-IoProvider::socket(int domain, int type, int protocol) {
-  return ::socket(domain, type, protocol);
-}
-
-int
-IoProvider::fcntl(int fd, int cmd, int arg) {
-  return ::fcntl(fd, cmd, arg);
-}
-
-int
-IoProvider::bind(
-    int sockfd, const struct sockaddr* my_addr, socklen_t addrlen) {
-  return ::bind(sockfd, my_addr, addrlen);
-}
-
-ssize_t
-IoProvider::recvfrom(
-    int sockfd,
-    void* buf,
-    size_t len,
-    int flags,
-    struct sockaddr* src_addr,
-    socklen_t* addrlen) {
-  return ::recvfrom(sockfd, buf, len, flags, src_addr, addrlen);
-}
-
-ssize_t
-IoProvider::sendto(
-    int sockfd,
-    const void* buf,
-    size_t len,
-    int flags,
-    const struct sockaddr* dest_addr,
-    socklen_t addrlen) {
-  return ::sendto(sockfd, buf, len, flags, dest_addr, addrlen);
-}
-
-int
-IoProvider::setsockopt(
-    int sockfd, int level, int optname, const void* optval, socklen_t optlen) {
-  return ::setsockopt(sockfd, level, optname, optval, optlen);
-}
-
-ssize_t
-IoProvider::recvmsg(int sockfd, struct msghdr* msg, int flags) {
-  return ::recvmsg(sockfd, msg, flags);
-}
-
-ssize_t
-IoProvider::sendmsg(int sockfd, const struct msghdr* msg, int flags) {
-  return ::sendmsg(sockfd, msg, flags);
-}
-
-std::tuple<
-    ssize_t /* size */,
-    int /* ifIndex */,
-    folly::SocketAddress /* srcAddr */,
-    int /* hopLimit */,
-    std::chrono::microseconds /* kernel timestamp */>
-IoProvider::recvMessage(
-    int fd, unsigned char* buf, int len, openr::IoProvider* ioProvider) {
-  // the control message buffer
-  // XXX: hardcoded, but this hardly should be a problem
-  union {
-    char ctrlBuf[CMSG_SPACE(1024)];
-    struct cmsghdr align;
-  } u;
-
-  // the message header to receive into
-  struct msghdr msg;
-
-  // the IO vector for data to be received with recvmsg
-  struct iovec entry;
-
-  // for address of the sender
-  sockaddr_storage addrStorage;
-
+namespace {
+
+// the control message buffer for receiving
+// XXX: hardcoded, but this hardly should be a problem
+union RecvControlBuffer {
+  char ctrlBuf[CMSG_SPACE(1024)];
+  struct cmsghdr align;
+};
+
+// the control message buffer for sending, aligned by control message hdr
+union SendControlBuffer {
+  char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+  struct cmsghdr align;
+};
+
+void
+prepareRecvHeader(
+    struct msghdr& msg,
+    struct iovec& entry,
+    sockaddr_storage& addrStorage,
+    RecvControlBuffer& u,
+    unsigned char* buf,
+    int len) {
   ::memset(&msg, 0, sizeof(msg));
 
   // we only expect to receive one block of data, single entry
@@ -116,18 +63,20 @@ IoProvider::recvMessage(
   // write the data here
   entry.iov_base = buf;
   entry.iov_len = len;
+}
 
-  ssize_t bytesRead = ioProvider->recvmsg(fd, &msg, MSG_DONTWAIT);
-
-  if (bytesRead < 0) {
-    throw std::runtime_error(fmt::format(
-        "Failed reading message on fd {}: {}", fd, folly::errnoStr(errno)));
-  }
-
-  if (msg.msg_flags & MSG_TRUNC) {
-    throw std::runtime_error("Message truncated");
-  }
+// cast to int64_t since ts.tv_sec is 32 bits on some platforms like arm
+std::chrono::microseconds
+toMicroseconds(struct timespec const& ts) {
+  return std::chrono::microseconds(
+      static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
 
+IoProvider::ReceivedMessage
+parseRecvHeader(
+    const struct msghdr& msg,
+    const sockaddr_storage& addrStorage,
+    ssize_t bytesRead) {
   // grab the inIndex we received this packet on and the hopLimit
   // those are available since we requested them via socket options
   struct cmsghdr* cmsg{nullptr};
@@ -139,7 +88,8 @@ IoProvider::recvMessage(
       std::chrono::duration_cast<std::chrono::microseconds>(
           std::chrono::system_clock::now().time_since_epoch())};
 
-  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
     if (cmsg->cmsg_level == IPPROTO_IPV6) {
       if (cmsg->cmsg_type == IPV6_PKTINFO) {
         struct in6_pktinfo pktinfo;
@@ -155,16 +105,18 @@ IoProvider::recvMessage(
             sizeof(hopLimit));
       }
     }
-    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+    if (cmsg->cmsg_level == SOL_SOCKET &&
+        (cmsg->cmsg_type == SO_TIMESTAMPNS ||
+         cmsg->cmsg_type == SCM_TIMESTAMPING)) {
+      // SO_TIMESTAMPING reports software timestamp first
       struct timespec ts {
         0, 0
       };
       memcpy(reinterpret_cast<void*>(&ts), CMSG_DATA(cmsg), sizeof(ts));
-
-      // cast to int64_t since ts.tv_sec is 32 bits on some platforms like arm
-      const int64_t usecs =
-          static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
-      const std::chrono::microseconds kernelRecvTs(usecs);
+      const auto kernelRecvTs = toMicroseconds(ts);
+      if (!kernelRecvTs.count()) {
+        continue;
+      }
 
       // sanity check
       DCHECK(recvTs >= kernelRecvTs) << "Time anomaly";
@@ -178,7 +130,8 @@ IoProvider::recvMessage(
   // build the source socket address from recvmsg data
   folly::SocketAddress srcAddr{};
   // this will throw if sender address was not filled in
-  srcAddr.setFromSockaddr(reinterpret_cast<struct sockaddr*>(&addrStorage));
+  srcAddr.setFromSockaddr(
+      reinterpret_cast<const struct sockaddr*>(&addrStorage));
 
   DCHECK(ifIndex != -1) << "ifIndex is not found";
   DCHECK(hopLimit) << "hopLimit is not found";
@@ -186,25 +139,19 @@ IoProvider::recvMessage(
   return std::make_tuple(bytesRead, ifIndex, srcAddr, hopLimit, recvTs);
 }
 
-ssize_t
-IoProvider::sendMessage(
-    int fd,
+void
+prepareSendHeader(
+    struct msghdr& msg,
+    struct iovec& entry,
+    sockaddr_storage& addrStorage,
+    SendControlBuffer& u,
     int ifIndex,
-    folly::IPAddressV6 srcAddr,
-    folly::SocketAddress dstAddr,
-    std::string const& packet,
-    IoProvider* ioProvider) {
-  struct msghdr msg;
+    const folly::IPAddressV6& srcAddr,
+    const folly::SocketAddress& dstAddr,
+    std::string const& packet) {
   struct cmsghdr* cmsg{nullptr};
 
-  // pack control buffer, aligned by control message hdr
-  union {
-    char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
-    struct cmsghdr align;
-  } u;
-
   // Set the destination address for the message
-  sockaddr_storage addrStorage;
   dstAddr.getAddress(&addrStorage);
 
   ::memset(&msg, 0, sizeof(msg));
@@ -226,15 +173,265 @@ IoProvider::sendMessage(
   ::memcpy(&pktinfo->ipi6_addr, srcAddr.bytes(), srcAddr.byteCount());
 
   // the IO vector for data to be sent
-  struct iovec entry;
   msg.msg_iov = &entry;
   msg.msg_iovlen = 1;
 
   // write the data here (we need to remove the const qualifier)
   entry.iov_base = const_cast<char*>(packet.data());
   entry.iov_len = packet.size();
+}
+
+} // namespace
+
+int
+IoProvider::socket(int domain, int type, int protocol) {
+  return ::socket(domain, type, protocol);
+}
+
+int
+IoProvider::fcntl(int fd, int cmd, int arg) {
+  return ::fcntl(fd, cmd, arg);
+}
+
+int
+IoProvider::bind(
+    int sockfd, const struct sockaddr* my_addr, socklen_t addrlen) {
+  return ::bind(sockfd, my_addr, addrlen);
+}
+
+ssize_t
+IoProvider::recvfrom(
+    int sockfd,
+    void* buf,
+    size_t len,
+    int flags,
+    struct sockaddr* src_addr,
+    socklen_t* addrlen) {
+  return ::recvfrom(sockfd, buf, len, flags, src_addr, addrlen);
+}
+
+ssize_t
+IoProvider::sendto(
+    int sockfd,
+    const void* buf,
+    size_t len,
+    int flags,
+    const struct sockaddr* dest_addr,
+    socklen_t addrlen) {
+  return ::sendto(sockfd, buf, len, flags, dest_addr, addrlen);
+}
+
+int
+IoProvider::setsockopt(
+    int sockfd, int level, int optname, const void* optval, socklen_t optlen) {
+  return ::setsockopt(sockfd, level, optname, optval, optlen);
+}
+
+ssize_t
+IoProvider::recvmsg(int sockfd, struct msghdr* msg, int flags) {
+  return ::recvmsg(sockfd, msg, flags);
+}
+
+ssize_t
+IoProvider::sendmsg(int sockfd, const struct msghdr* msg, int flags) {
+  return ::sendmsg(sockfd, msg, flags);
+}
+
+int
+IoProvider::recvmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return ::recvmmsg(sockfd, msgvec, vlen, flags, nullptr);
+}
+
+int
+IoProvider::sendmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return ::sendmmsg(sockfd, msgvec, vlen, flags);
+}
+
+IoProvider::ReceivedMessage
+IoProvider::recvMessage(
+    int fd, unsigned char* buf, int len, openr::IoProvider* ioProvider) {
+  // the message header to receive into
+  struct msghdr msg;
+
+  // the IO vector for data to be received with recvmsg
+  struct iovec entry;
+
+  // for address of the sender
+  sockaddr_storage addrStorage;
+
+  RecvControlBuffer u;
+  prepareRecvHeader(msg, entry, addrStorage, u, buf, len);
+
+  ssize_t bytesRead = ioProvider->recvmsg(fd, &msg, MSG_DONTWAIT);
+
+  if (bytesRead < 0) {
+    throw std::runtime_error(fmt::format(
+        "Failed reading message on fd {}: {}", fd, folly::errnoStr(errno)));
+  }
+
+  if (msg.msg_flags & MSG_TRUNC) {
+    throw std::runtime_error("Message truncated");
+  }
+
+  return parseRecvHeader(msg, addrStorage, bytesRead);
+}
+
+std::vector<IoProvider::ReceivedMessage>
+IoProvider::recvMessages(
+    int fd,
+    unsigned char* buf,
+    int len,
+    int maxMessages,
+    IoProvider* ioProvider) {
+  std::vector<struct mmsghdr> msgs(maxMessages);
+  std::vector<struct iovec> entries(maxMessages);
+  std::vector<sockaddr_storage> addrStorages(maxMessages);
+  std::vector<RecvControlBuffer> ctrlBufs(maxMessages);
+  for (int i = 0; i < maxMessages; ++i) {
+    prepareRecvHeader(
+        msgs[i].msg_hdr,
+        entries[i],
+        addrStorages[i],
+        ctrlBufs[i],
+        buf + i * len,
+        len);
+  }
+
+  int numRead =
+      ioProvider->recvmmsg(fd, msgs.data(), maxMessages, MSG_DONTWAIT);
+  if (numRead < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return {};
+    }
+    throw std::runtime_error(fmt::format(
+        "Failed reading messages on fd {}: {}", fd, folly::errnoStr(errno)));
+  }
+
+  std::vector<ReceivedMessage> result;
+  result.reserve(numRead);
+  for (int i = 0; i < numRead; ++i) {
+    const auto& msg = msgs[i].msg_hdr;
+    ssize_t bytesRead = msgs[i].msg_len;
+    if (msg.msg_flags & MSG_TRUNC) {
+      LOG(ERROR) << "Message truncated on fd " << fd;
+      bytesRead = -1;
+    }
+    result.emplace_back(parseRecvHeader(msg, addrStorages[i], bytesRead));
+  }
+  return result;
+}
+
+ssize_t
+IoProvider::sendMessage(
+    int fd,
+    int ifIndex,
+    folly::IPAddressV6 srcAddr,
+    folly::SocketAddress dstAddr,
+    std::string const& packet,
+    IoProvider* ioProvider) {
+  struct msghdr msg;
+
+  // the IO vector for data to be sent
+  struct iovec entry;
+
+  // Set the destination address for the message
+  sockaddr_storage addrStorage;
+
+  SendControlBuffer u;
+  prepareSendHeader(
+      msg, entry, addrStorage, u, ifIndex, srcAddr, dstAddr, packet);
 
   return ioProvider->sendmsg(fd, &msg, MSG_DONTWAIT);
 }
 
+std::vector<IoProvider::TxTimestamp>
+IoProvider::recvTxTimestamps(int fd, IoProvider* ioProvider) {
+  std::vector<TxTimestamp> result;
+  while (true) {
+    struct msghdr msg;
+    struct iovec entry;
+    sockaddr_storage addrStorage;
+    RecvControlBuffer u;
+    // no payload is looped back with SOF_TIMESTAMPING_OPT_TSONLY
+    unsigned char buf[1];
+    prepareRecvHeader(msg, entry, addrStorage, u, buf, sizeof(buf));
+
+    if (ioProvider->recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG(ERROR) << "Failed reading error queue on fd " << fd << ": "
+                   << folly::errnoStr(errno);
+      }
+      break;
+    }
+
+    std::optional<uint32_t> packetId;
+    std::chrono::microseconds txTs{0};
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        struct scm_timestamping tss;
+        memcpy(reinterpret_cast<void*>(&tss), CMSG_DATA(cmsg), sizeof(tss));
+        txTs = toMicroseconds(tss.ts[0]);
+      } else if (
+          cmsg->cmsg_level == IPPROTO_IPV6 &&
+          cmsg->cmsg_type == IPV6_RECVERR) {
+        struct sock_extended_err err;
+        memcpy(reinterpret_cast<void*>(&err), CMSG_DATA(cmsg), sizeof(err));
+        if (err.ee_errno == ENOMSG &&
+            err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+          packetId = err.ee_data;
+        }
+      }
+    }
+
+    if (packetId.has_value() && txTs.count()) {
+      result.emplace_back(*packetId, txTs);
+    }
+  }
+  return result;
+}
+
+std::vector<ssize_t>
+IoProvider::sendMessages(
+    int fd,
+    std::vector<SendRequest> const& requests,
+    IoProvider* ioProvider) {
+  const auto numMsgs = requests.size();
+  std::vector<struct mmsghdr> msgs(numMsgs);
+  std::vector<struct iovec> entries(numMsgs);
+  std::vector<sockaddr_storage> addrStorages(numMsgs);
+  std::vector<SendControlBuffer> ctrlBufs(numMsgs);
+  for (size_t i = 0; i < numMsgs; ++i) {
+    auto const& request = requests[i];
+    prepareSendHeader(
+        msgs[i].msg_hdr,
+        entries[i],
+        addrStorages[i],
+        ctrlBufs[i],
+        request.ifIndex,
+        request.srcAddr,
+        request.dstAddr,
+        request.packet);
+  }
+
+  // sendmmsg stops at first message failing, skip it and resume after
+  std::vector<ssize_t> result(numMsgs, 0);
+  size_t numSent = 0;
+  while (numSent < numMsgs) {
+    int ret = ioProvider->sendmmsg(
+        fd, msgs.data() + numSent, numMsgs - numSent, MSG_DONTWAIT);
+    if (ret <= 0) {
+      result[numSent++] = -errno;
+      continue;
+    }
+    for (int i = 0; i < ret; ++i, ++numSent) {
+      result[numSent] = msgs[numSent].msg_len;
+    }
+  }
+  return result;
+}
+
 } // namespace openr
@@ -13,6 +13,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <chrono>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include <folly/IPAddress.h>
 #include <folly/SocketAddress.h>
@@ -59,22 +62,42 @@ class IoProvider {
 
   virtual ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags);
 
+  virtual int recvmmsg(
+      int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+
+  virtual int sendmmsg(
+      int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+
   virtual int setsockopt(
       int sockfd, int level, int optname, const void* optval, socklen_t optlen);
 
   // Utility functions that operate on sockets
 
-  /*
-   * Receive a message on fd, and return its size, interface index,
-   * and the source address
-   */
-  static std::tuple<
+  using ReceivedMessage = std::tuple<
       ssize_t /* size */,
       int /* ifIndex */,
       folly::SocketAddress /* srcAddr */,
       int /* hopLimit */,
-      std::chrono::microseconds /* kernel timestamp */>
-  recvMessage(int fd, unsigned char* buf, int len, IoProvider* ioProvider);
+      std::chrono::microseconds /* kernel timestamp */>;
+
+  /*
+   * Receive a message on fd, and return its size, interface index,
+   * and the source address
+   */
+  static ReceivedMessage recvMessage(
+      int fd, unsigned char* buf, int len, IoProvider* ioProvider);
+
+  /*
+   * Receive up to maxMessages messages on fd with a single syscall. Message
+   * i is written at buf + i * len. Size of truncated messages is -1. Returns
+   * no message if none is pending.
+   */
+  static std::vector<ReceivedMessage> recvMessages(
+      int fd,
+      unsigned char* buf,
+      int len,
+      int maxMessages,
+      IoProvider* ioProvider);
 
   /*
    * Send message on fd via given interface to the address provided
@@ -88,6 +111,36 @@ class IoProvider {
       std::string const& packet,
       IoProvider* ioProvider);
 
+  // Kernel timestamp of a sent packet, identified by the number of packets
+  // sent on the socket before it (SOF_TIMESTAMPING_OPT_ID)
+  using TxTimestamp = std::pair<
+      uint32_t /* packet id */,
+      std::chrono::microseconds /* kernel timestamp */>;
+
+  /*
+   * Drain TX timestamps from error queue of fd. Socket must have been set up
+   * with SO_TIMESTAMPING and SOF_TIMESTAMPING_OPT_ID | OPT_TSONLY flags.
+   */
+  static std::vector<TxTimestamp> recvTxTimestamps(
+      int fd, IoProvider* ioProvider);
+
+  // Message to send with sendMessages(...), see sendMessage(...)
+  struct SendRequest {
+    int ifIndex{0};
+    folly::IPAddressV6 srcAddr;
+    folly::SocketAddress dstAddr;
+    std::string packet;
+  };
+
+  /*
+   * Send messages on fd, in as few syscalls as possible. Returns number of
+   * bytes sent for each message, or negative errno for failed ones
+   */
+  static std::vector<ssize_t> sendMessages(
+      int fd,
+      std::vector<SendRequest> const& requests,
+      IoProvider* ioProvider);
+
  private:
   IoProvider(IoProvider const&) = delete;
   IoProvider& operator=(IoProvider const&) = delete;
@@ -6,6 +6,7 @@
  */
 
 #include <ifaddrs.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <netinet/in.h>
 
@@ -23,6 +24,7 @@
 #include <openr/common/Constants.h>
 #include <openr/common/EventLogger.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/Types_constants.h>
 #include <openr/spark/Spark.h>
@@ -31,6 +33,10 @@
 
 namespace fb303 = facebook::fb303;
 
+#ifndef IPV6_MULTICAST_ALL
+#define IPV6_MULTICAST_ALL 29
+#endif
+
 namespace {
 //
 // The min size of IPv6 packet is 1280 bytes. We use this
@@ -38,6 +44,11 @@ namespace {
 //
 const int kMinIpv6Mtu = 1280;
 
+//
+// Max number of packets received per syscall
+//
+const size_t kMaxRecvBatchSize = 32;
+
 //
 // The acceptable hop limit, assuming we send packets with this TTL
 //
@@ -46,6 +57,19 @@ const int kSparkHopLimit = 255;
 // number of restarting packets to send out per interface before I'm going down
 const int kNumRestartingPktSent = 3;
 
+//
+// Bounds on hello packets tracked for TX timestamps: pending ones overall,
+// and timestamped ones per interface
+//
+const size_t kMaxPendingTxTimestamps = 1024;
+const size_t kMaxHelloTxTimestamps = 8;
+
+//
+// Max delay between user-space and kernel TX timestamps of a packet. Larger
+// delays are more likely a mismatched packet id.
+//
+const std::chrono::seconds kMaxTxTimestampDelay{1};
+
 //
 // Function to get current timestamp in microseconds using steady clock
 // NOTE: we use non-monotonic clock since kernel time-stamps do not support
@@ -105,6 +129,101 @@ toggleMcastGroup(
   return true;
 }
 
+//
+// Helpers to patch i64 fields of serialized packets in place. Compact
+// protocol encodes i64 as zigzag varint, and strings as varint length
+// followed by bytes. Every patch first checks the bytes it replaces hold the
+// old value.
+//
+size_t
+getVarintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+std::string
+encodeCompactI64(int64_t value) {
+  uint64_t zigzag =
+      (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+  std::string bytes;
+  while (zigzag >= 0x80) {
+    bytes.push_back(static_cast<char>((zigzag & 0x7f) | 0x80));
+    zigzag >>= 7;
+  }
+  bytes.push_back(static_cast<char>(zigzag));
+  return bytes;
+}
+
+// replace value at offset if new value encodes to the same size
+bool
+patchI64(
+    std::string& packet, size_t offset, int64_t oldValue, int64_t newValue) {
+  auto const oldBytes = encodeCompactI64(oldValue);
+  auto const newBytes = encodeCompactI64(newValue);
+  if (oldBytes.size() != newBytes.size() or
+      packet.compare(offset, oldBytes.size(), oldBytes) != 0) {
+    return false;
+  }
+  packet.replace(offset, newBytes.size(), newBytes);
+  return true;
+}
+
+// replace value of last field of message, followed by stop fields of message
+// and packet. Any new value fits
+bool
+patchTrailingI64(std::string& packet, int64_t oldValue, int64_t newValue) {
+  auto const oldTail = encodeCompactI64(oldValue) + std::string(2, '\0');
+  if (packet.size() < oldTail.size() or
+      packet.compare(
+          packet.size() - oldTail.size(), oldTail.size(), oldTail) != 0) {
+    return false;
+  }
+  packet.resize(packet.size() - oldTail.size());
+  packet.append(encodeCompactI64(newValue));
+  packet.append(2, '\0');
+  return true;
+}
+
+//
+// Counters of the packet path, bumped for every hello, handshake and
+// heartbeat packet sent or received
+//
+openr::StatCounter loopedPacketCounter{
+    "spark.invalid_keepalive.looped_packet", fb303::SUM};
+openr::StatCounter helloPacketRecvCounter{
+    "spark.hello.packet_recv", fb303::SUM};
+openr::StatCounter helloPacketRecvSizeCounter{
+    "spark.hello.packet_recv_size", fb303::SUM};
+openr::StatCounter helloPacketDroppedCounter{
+    "spark.hello.packet_dropped", fb303::SUM};
+openr::StatCounter helloPacketProcessedCounter{
+    "spark.hello.packet_processed", fb303::SUM};
+openr::StatCounter helloPacketPatchedCounter{
+    "spark.hello.packet_patched", fb303::SUM};
+openr::StatCounter helloPacketSerializedCounter{
+    "spark.hello.packet_serialized", fb303::SUM};
+openr::StatCounter helloBytesSentCounter{"spark.hello.bytes_sent", fb303::SUM};
+openr::StatCounter helloPacketSentCounter{
+    "spark.hello.packet_sent", fb303::SUM};
+openr::StatCounter txTimestampMismatchCounter{
+    "spark.hello.tx_timestamp_mismatch", fb303::SUM};
+openr::StatCounter txTimestampDelayCounter{
+    "spark.hello.tx_timestamp_delay_us", fb303::AVG};
+openr::StatCounter handshakeBytesSentCounter{
+    "spark.handshake.bytes_sent", fb303::SUM};
+openr::StatCounter handshakePacketSentCounter{
+    "spark.handshake.packet_sent", fb303::SUM};
+openr::StatCounter heartbeatBytesSentCounter{
+    "spark.heartbeat.bytes_sent", fb303::SUM};
+openr::StatCounter heartbeatPacketSentCounter{
+    "spark.heartbeat.packet_sent", fb303::SUM};
+openr::StatCounter heartbeatSendBatchSizeCounter{
+    "spark.heartbeat.send_batch_size", fb303::AVG};
+
 } // namespace
 
 namespace openr {
@@ -222,7 +341,7 @@ Spark::SparkNeighbor::SparkNeighbor(
 }
 
 Spark::Spark(
-    messaging::RQueue<InterfaceDatabase> interfaceUpdatesQueue,
+    messaging::RQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue,
     messaging::ReplicateQueue<NeighborEvent>& neighborUpdatesQueue,
     KvStoreCmdPort kvStoreCmdPort,
     OpenrCtrlThriftPort openrCtrlThriftPort,
@@ -230,6 +349,30 @@ Spark::Spark(
     std::shared_ptr<const Config> config,
     std::pair<uint32_t, uint32_t> version,
     std::optional<uint32_t> maybeMaxAllowedPps)
+    : Spark(
+          std::move(interfaceUpdatesQueue),
+          neighborUpdatesQueue,
+          kvStoreCmdPort,
+          openrCtrlThriftPort,
+          std::move(ioProvider),
+          config,
+          version,
+          maybeMaxAllowedPps,
+          Shard{
+              0,
+              static_cast<size_t>(
+                  *config->getSparkConfig().num_workers_ref())}) {}
+
+Spark::Spark(
+    messaging::RQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue,
+    messaging::ReplicateQueue<NeighborEvent>& neighborUpdatesQueue,
+    KvStoreCmdPort kvStoreCmdPort,
+    OpenrCtrlThriftPort openrCtrlThriftPort,
+    std::shared_ptr<IoProvider> ioProvider,
+    std::shared_ptr<const Config> config,
+    std::pair<uint32_t, uint32_t> version,
+    std::optional<uint32_t> maybeMaxAllowedPps,
+    Shard shard)
     : myDomainName_(*config->getConfig().domain_ref()),
       myNodeName_(config->getNodeName()),
       neighborDiscoveryPort_(static_cast<uint16_t>(
@@ -255,7 +398,8 @@ Spark::Spark(
       kOpenrCtrlThriftPort_(openrCtrlThriftPort),
       kVersion_(apache::thrift::FRAGILE, version.first, version.second),
       ioProvider_(std::move(ioProvider)),
-      config_(std::move(config)) {
+      config_(std::move(config)),
+      shard_(shard) {
   CHECK(gracefulRestartTime_ >= 3 * keepAliveTime_)
       << "Keep-alive-time must be less than hold-time.";
   CHECK(keepAliveTime_ > std::chrono::milliseconds(0))
@@ -267,6 +411,27 @@ Spark::Spark(
   CHECK(fastInitHelloTime_ <= helloTime_)
       << "fastInit helloMsg interval must be smaller than normal interval";
   CHECK(ioProvider_) << "Got null IoProvider";
+  CHECK_LT(shard_.index, shard_.count) << "Invalid shard";
+
+  // Create instances handling other shards of interfaces
+  if (shard_.index == 0) {
+    for (size_t i = 1; i < shard_.count; ++i) {
+      auto& queue = workerInterfaceUpdatesQueues_.emplace_back(
+          std::make_unique<
+              messaging::ReplicateQueue<InterfaceDatabaseUpdate>>());
+      // NOTE: constructor is private, hence not using std::make_unique
+      workers_.emplace_back(std::unique_ptr<Spark>(new Spark(
+          queue->getReader(),
+          neighborUpdatesQueue,
+          kvStoreCmdPort,
+          openrCtrlThriftPort,
+          ioProvider_,
+          config_,
+          version,
+          maybeMaxAllowedPps,
+          Shard{i, shard_.count})));
+    }
+  }
 
   // Initialize list of BucketedTimeSeries
   const std::chrono::seconds sec{1};
@@ -290,13 +455,36 @@ Spark::Spark(
         break;
       }
 
-      processInterfaceUpdates(std::move(interfaceUpdates).value());
+      processInterfaceUpdates(
+          dispatchInterfaceUpdates(std::move(interfaceUpdates).value()));
     }
   });
 
   // Initialize UDP socket for neighbor discovery
   prepareSocket();
 
+  // Initialize fast detection, which signals neighbor down to this thread
+  auto const& fastDetectionConfig =
+      config_->getSparkConfig().fast_detection_config_ref();
+  if (fastDetectionConfig.has_value()) {
+    std::optional<int> maybeIpTos;
+    if (config_->getConfig().ip_tos_ref().has_value()) {
+      maybeIpTos = config_->getConfig().ip_tos_ref().value();
+    }
+    fastDetector_ = std::make_unique<FastDetector>(
+        myNodeName_,
+        static_cast<uint16_t>(*fastDetectionConfig->port_ref()),
+        std::chrono::milliseconds(*fastDetectionConfig->tx_interval_ms_ref()),
+        static_cast<uint32_t>(*fastDetectionConfig->detect_multiplier_ref()),
+        maybeIpTos,
+        ioProvider_,
+        [this](std::string const& ifName, std::string const& neighborName) {
+          runInEventBaseThread([this, ifName, neighborName]() noexcept {
+            processFastDetectionTimeout(ifName, neighborName);
+          });
+        });
+  }
+
   // Initialize some stat keys
   fb303::fbData->addStatExportType(
       "spark.invalid_keepalive.different_domain", fb303::SUM);
@@ -332,10 +520,43 @@ Spark::toStr(SparkNeighState state) {
   }
 }
 
+void
+Spark::run() {
+  if (fastDetector_) {
+    fastDetectorThread_ = std::thread([this]() { fastDetector_->run(); });
+    fastDetector_->waitUntilRunning();
+  }
+
+  for (auto& worker : workers_) {
+    workerThreads_.emplace_back([worker = worker.get()]() { worker->run(); });
+    worker->waitUntilRunning();
+  }
+
+  // Invoke run method of super class, this blocks until stop()
+  OpenrEventBase::run();
+}
+
 void
 Spark::stop() {
   // NOTE: explicitly wait for msg to send out before going down
-  floodRestartingMsg().get();
+  floodShardRestartingMsg().get();
+
+  // workers send out their own restarting msg when stopped
+  for (auto& queue : workerInterfaceUpdatesQueues_) {
+    queue->close();
+  }
+  for (auto& worker : workers_) {
+    worker->stop();
+  }
+  for (auto& thread : workerThreads_) {
+    thread.join();
+  }
+  workerThreads_.clear();
+
+  if (fastDetector_ and fastDetectorThread_.joinable()) {
+    fastDetector_->stop();
+    fastDetectorThread_.join();
+  }
   OpenrEventBase::stop();
 }
 
@@ -440,26 +661,57 @@ Spark::prepareSocket() noexcept {
                << folly::errnoStr(errno);
   }
 
-  // enable timestamping for this socket
-  const int enabled = 1;
+  // only receive multicast on interfaces this shard joined the group on
+  if (shard_.count > 1) {
+    const int mcastAll = 0;
+    if (ioProvider_->setsockopt(
+            fd,
+            IPPROTO_IPV6,
+            IPV6_MULTICAST_ALL,
+            &mcastAll,
+            sizeof(mcastAll)) != 0) {
+      LOG(WARNING) << "Failed disabling IPV6_MULTICAST_ALL on socket. Error: "
+                   << folly::errnoStr(errno);
+    }
+  }
+
+  // enable kernel RX and TX timestamping for this socket, so that scheduling
+  // delays of this thread do not add to measured RTTs. Fall back to RX
+  // timestamps only.
+  const int tsFlags = SOF_TIMESTAMPING_RX_SOFTWARE |
+      SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+      SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
   if (ioProvider_->setsockopt(
-          fd, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) != 0) {
-    LOG(ERROR) << "Failed to enable kernel timestamping. Measured RTTs are "
-               << "likely to have more noise in them. Error: "
-               << folly::errnoStr(errno);
+          fd, SOL_SOCKET, SO_TIMESTAMPING, &tsFlags, sizeof(tsFlags)) == 0) {
+    txTimestampingEnabled_ = true;
+  } else {
+    LOG(WARNING) << "Failed to enable kernel TX timestamping. Error: "
+                 << folly::errnoStr(errno);
+
+    const int enabled = 1;
+    if (ioProvider_->setsockopt(
+            fd, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) != 0) {
+      LOG(ERROR) << "Failed to enable kernel timestamping. Measured RTTs are "
+                 << "likely to have more noise in them. Error: "
+                 << folly::errnoStr(errno);
+    }
   }
 
   LOG(INFO) << "Spark thread attaching socket/events callbacks...";
 
   // Listen for incoming messages on multicast FD
-  addSocketFd(mcastFd_, ZMQ_POLLIN, [this](int) noexcept {
-    try {
-      processPacket();
-    } catch (std::exception const& err) {
-      LOG(ERROR) << "Spark: error processing hello packet "
-                 << folly::exceptionStr(err);
-    }
-  });
+  addSocketFd(
+      mcastFd_,
+      ZMQ_POLLIN,
+      [this](int) noexcept {
+        try {
+          processPacket();
+        } catch (std::exception const& err) {
+          LOG(ERROR) << "Spark: error processing hello packet "
+                     << folly::exceptionStr(err);
+        }
+      },
+      "process_packet");
 
   // update counters every few seconds
   counterUpdateTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
@@ -478,8 +730,7 @@ Spark::sanityCheckHelloPkt(
   // check if own packet has looped
   if (neighborName == myNodeName_) {
     VLOG(2) << "Ignore packet from self (" << myNodeName_ << ")";
-    fb303::fbData->addStatValue(
-        "spark.invalid_keepalive.looped_packet", 1, fb303::SUM);
+    loopedPacketCounter.add();
     return PacketValidationResult::SKIP_LOOPED_SELF;
   }
   // version check
@@ -520,19 +771,17 @@ Spark::shouldProcessHelloPacket(
 
 bool
 Spark::parsePacket(
+    IoProvider::ReceivedMessage const& msg,
+    uint8_t const* buf,
     thrift::SparkHelloPacket& pkt,
     std::string& ifName,
     std::chrono::microseconds& recvTime) {
-  // the read buffer
-  uint8_t buf[kMinIpv6Mtu];
-
   ssize_t bytesRead;
   int ifIndex;
   folly::SocketAddress clientAddr;
   int hopLimit;
 
-  std::tie(bytesRead, ifIndex, clientAddr, hopLimit, recvTime) =
-      IoProvider::recvMessage(mcastFd_, buf, kMinIpv6Mtu, ioProvider_.get());
+  std::tie(bytesRead, ifIndex, clientAddr, hopLimit, recvTime) = msg;
 
   if (hopLimit < kSparkHopLimit) {
     LOG(ERROR) << "Rejecting packet from " << clientAddr.getAddressStr()
@@ -541,6 +790,10 @@ Spark::parsePacket(
   }
 
   auto res = findInterfaceFromIfindex(ifIndex);
+  if (!res.has_value() and shard_.count > 1) {
+    // interface of another shard, multicast filtering is not supported
+    return false;
+  }
   if (!res.has_value()) {
     LOG(ERROR) << "Received packet from " << clientAddr.getAddressStr()
                << " on unknown interface with index " << ifIndex
@@ -554,20 +807,19 @@ Spark::parsePacket(
           << " from " << clientAddr.getAddressStr();
 
   // update counters for packets received, dropped and processed
-  fb303::fbData->addStatValue("spark.hello.packet_recv", 1, fb303::SUM);
+  helloPacketRecvCounter.add();
 
   // update counters for total size of packets received
-  fb303::fbData->addStatValue(
-      "spark.hello.packet_recv_size", bytesRead, fb303::SUM);
+  helloPacketRecvSizeCounter.add(bytesRead);
 
   if (!shouldProcessHelloPacket(ifName, clientAddr.getIPAddress())) {
     LOG(ERROR) << "Spark: dropping hello packet due to rate limiting on iface: "
                << ifName << " from addr: " << clientAddr.getAddressStr();
-    fb303::fbData->addStatValue("spark.hello.packet_dropped", 1, fb303::SUM);
+    helloPacketDroppedCounter.add();
     return false;
   }
 
-  fb303::fbData->addStatValue("spark.hello.packet_processed", 1, fb303::SUM);
+  helloPacketProcessedCounter.add();
 
   if (bytesRead >= 0) {
     VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
@@ -583,10 +835,10 @@ Spark::parsePacket(
     return false;
   }
 
-  // Copy buffer into string object and parse it into helloPacket.
-  std::string readBuf(reinterpret_cast<const char*>(&buf[0]), bytesRead);
+  // Parse helloPacket straight out of the read buffer
   try {
-    pkt = readThriftObjStr<thrift::SparkHelloPacket>(readBuf, serializer_);
+    pkt = readThriftObj<thrift::SparkHelloPacket>(
+        folly::ByteRange(buf, bytesRead), serializer_);
   } catch (std::out_of_range const& err) {
     LOG(INFO) << "Malformed Thrift packet: " << folly::exceptionStr(err);
     return false;
@@ -799,10 +1051,11 @@ Spark::sendHandshakeMsg(
     return;
   }
 
+  ++txPacketId_;
+
   // update counters for number of pkts and total size of pkts sent
-  fb303::fbData->addStatValue(
-      "spark.handshake.bytes_sent", packet.size(), fb303::SUM);
-  fb303::fbData->addStatValue("spark.handshake.packet_sent", 1, fb303::SUM);
+  handshakeBytesSentCounter.add(packet.size());
+  handshakePacketSentCounter.add();
 }
 
 void
@@ -830,15 +1083,21 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
   const auto ifIndex = interfaceEntry.ifIndex;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
 
-  // build heartbeat msg
-  thrift::SparkHeartbeatMsg heartbeatMsg;
-  heartbeatMsg.nodeName_ref() = myNodeName_;
-  heartbeatMsg.seqNum_ref() = mySeqNum_;
+  // heartbeats of all interfaces only differ by seqNum, the last field.
+  // Patch it into last heartbeat, and only build msg if that fails
+  const int64_t seqNum = mySeqNum_;
+  if (not patchTrailingI64(heartbeatPacket_, heartbeatSeqNum_, seqNum)) {
+    thrift::SparkHeartbeatMsg heartbeatMsg;
+    heartbeatMsg.nodeName_ref() = myNodeName_;
+    heartbeatMsg.seqNum_ref() = seqNum;
 
-  thrift::SparkHelloPacket pkt;
-  pkt.heartbeatMsg_ref() = std::move(heartbeatMsg);
+    thrift::SparkHelloPacket pkt;
+    pkt.heartbeatMsg_ref() = std::move(heartbeatMsg);
 
-  auto packet = writeThriftObjStr(pkt, serializer_);
+    writeThriftObjStr(pkt, serializer_, heartbeatPacket_);
+  }
+  heartbeatSeqNum_ = seqNum;
+  auto packet = heartbeatPacket_;
 
   // send the pkt
   folly::SocketAddress dstAddr(
@@ -850,19 +1109,54 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
     return;
   }
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  // queue the pkt, to be sent with other heartbeats of this loop iteration
+  if (pendingHeartbeats_.empty()) {
+    getEvb()->runInLoop([this]() noexcept { sendPendingHeartbeats(); });
+  }
+  pendingHeartbeats_.emplace_back(
+      ifName,
+      IoProvider::SendRequest{
+          ifIndex, v6Addr.asV6(), std::move(dstAddr), std::move(packet)});
+}
 
-  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
-    VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
-            << ifName << " failed due to error " << folly::errnoStr(errno);
+void
+Spark::sendPendingHeartbeats() {
+  auto pendingHeartbeats = std::move(pendingHeartbeats_);
+  pendingHeartbeats_.clear();
+
+  // skip interfaces removed since heartbeat was queued
+  std::vector<std::string> ifNames;
+  std::vector<IoProvider::SendRequest> requests;
+  for (auto& [ifName, request] : pendingHeartbeats) {
+    if (interfaceDb_.count(ifName)) {
+      ifNames.emplace_back(std::move(ifName));
+      requests.emplace_back(std::move(request));
+    }
+  }
+  if (requests.empty()) {
     return;
   }
 
-  // update counters for number of pkts and total size of pkts sent
-  fb303::fbData->addStatValue(
-      "spark.heartbeat.bytes_sent", packet.size(), fb303::SUM);
-  fb303::fbData->addStatValue("spark.heartbeat.packet_sent", 1, fb303::SUM);
+  const auto bytesSent =
+      IoProvider::sendMessages(mcastFd_, requests, ioProvider_.get());
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    auto const& packet = requests[i].packet;
+    if ((bytesSent[i] < 0) ||
+        (static_cast<size_t>(bytesSent[i]) != packet.size())) {
+      VLOG(1) << "Sending multicast to "
+              << requests[i].dstAddr.getAddressStr() << " on " << ifNames[i]
+              << " failed due to error " << folly::errnoStr(-bytesSent[i]);
+      continue;
+    }
+
+    ++txPacketId_;
+
+    // update counters for number of pkts and total size of pkts sent
+    heartbeatBytesSentCounter.add(packet.size());
+    heartbeatPacketSentCounter.add();
+  }
+  heartbeatSendBatchSizeCounter.add(requests.size());
 }
 
 void
@@ -932,6 +1226,12 @@ Spark::checkNeighborState(
 folly::SemiFuture<std::optional<SparkNeighState>>
 Spark::getSparkNeighState(
     std::string const& ifName, std::string const& neighborName) {
+  const auto shardIndex = getShardIndex(ifName);
+  if (shardIndex != shard_.index) {
+    return workers_.at(shardIndex - 1)->getSparkNeighState(
+        ifName, neighborName);
+  }
+
   folly::Promise<std::optional<SparkNeighState>> promise;
   auto sf = promise.getSemiFuture();
   runInEventBaseThread(
@@ -958,6 +1258,59 @@ Spark::getSparkNeighState(
 
 folly::SemiFuture<folly::Unit>
 Spark::floodRestartingMsg() {
+  if (workers_.empty()) {
+    return floodShardRestartingMsg();
+  }
+
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
+  futures.emplace_back(floodShardRestartingMsg());
+  for (auto& worker : workers_) {
+    futures.emplace_back(worker->floodShardRestartingMsg());
+  }
+  return folly::collectAll(std::move(futures))
+      .deferValue([](std::vector<folly::Try<folly::Unit>>&&) {});
+}
+
+folly::SemiFuture<folly::Unit>
+Spark::updateConfig(std::shared_ptr<const Config> config) {
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
+  for (auto& worker : workers_) {
+    futures.emplace_back(worker->updateShardConfig(config));
+  }
+  futures.emplace_back(updateShardConfig(std::move(config)));
+  return folly::collectAll(std::move(futures))
+      .deferValue([](std::vector<folly::Try<folly::Unit>>&&) {});
+}
+
+folly::SemiFuture<folly::Unit>
+Spark::updateShardConfig(std::shared_ptr<const Config> config) {
+  folly::Promise<folly::Unit> promise;
+  auto sf = promise.getSemiFuture();
+  runInEventBaseThread(
+      [this, p = std::move(promise), config = std::move(config)]() mutable {
+        // ATTN: hello timers are rolled upon every send, hence applied from
+        //       the next hello msg onwards
+        const std::chrono::milliseconds helloTime = std::chrono::seconds(
+            *config->getSparkConfig().hello_time_s_ref());
+        const std::chrono::milliseconds fastInitHelloTime(
+            *config->getSparkConfig().fastinit_hello_time_ms_ref());
+        if (fastInitHelloTime <= helloTime) {
+          helloTime_ = helloTime;
+          fastInitHelloTime_ = fastInitHelloTime;
+          handshakeTime_ = fastInitHelloTime;
+        } else {
+          LOG(ERROR) << "Ignoring hello timers, fastInit helloMsg interval "
+                     << "must be smaller than normal interval";
+        }
+        // area of neighbors discovered from now on
+        config_ = std::move(config);
+        p.setValue();
+      });
+  return sf;
+}
+
+folly::SemiFuture<folly::Unit>
+Spark::floodShardRestartingMsg() {
   folly::Promise<folly::Unit> promise;
   auto sf = promise.getSemiFuture();
   runInEventBaseThread([this, p = std::move(promise)]() mutable {
@@ -991,7 +1344,29 @@ Spark::getNeighbors() {
     p.setValue(
         std::make_unique<std::vector<thrift::SparkNeighbor>>(std::move(res)));
   });
-  return sf;
+  if (workers_.empty()) {
+    return sf;
+  }
+
+  // merge neighbors of all shards
+  using NeighborsT = std::unique_ptr<std::vector<thrift::SparkNeighbor>>;
+  std::vector<folly::SemiFuture<NeighborsT>> futures;
+  futures.emplace_back(std::move(sf));
+  for (auto& worker : workers_) {
+    futures.emplace_back(worker->getNeighbors());
+  }
+  return folly::collectAll(std::move(futures))
+      .deferValue([](std::vector<folly::Try<NeighborsT>>&& results) {
+        auto res = std::make_unique<std::vector<thrift::SparkNeighbor>>();
+        for (auto& result : results) {
+          auto& neighbors = result.value();
+          res->insert(
+              res->end(),
+              std::make_move_iterator(neighbors->begin()),
+              std::make_move_iterator(neighbors->end()));
+        }
+        return res;
+      });
 } // namespace openr
 
 void
@@ -1006,12 +1381,15 @@ Spark::neighborUpWrapper(
   neighbor.negotiateHoldTimer.reset();
 
   // create heartbeat hold timer when promote to "ESTABLISHED"
-  neighbor.heartbeatHoldTimer = folly::AsyncTimeout::make(
-      *getEvb(), [this, ifName, neighborName]() noexcept {
+  neighbor.heartbeatHoldTimer =
+      getTimerWheel().makeTimer([this, ifName, neighborName]() noexcept {
         processHeartbeatTimeout(ifName, neighborName);
       });
   neighbor.heartbeatHoldTimer->scheduleTimeout(neighbor.heartbeatHoldTime);
 
+  // track neighbor liveness with fast detection as well, if enabled
+  addFastDetectionSession(ifName, neighborName);
+
   // add neighborName to collection
   ifNameToActiveNeighbors_[ifName].emplace(neighborName);
 
@@ -1028,6 +1406,10 @@ Spark::neighborDownWrapper(
   notifySparkNeighborEvent(
       NeighborEventType::NEIGHBOR_DOWN, neighbor.toThrift());
 
+  if (fastDetector_) {
+    fastDetector_->removeSession(ifName, neighborName);
+  }
+
   // remove neighborship on this interface
   if (ifNameToActiveNeighbors_.find(ifName) == ifNameToActiveNeighbors_.end()) {
     LOG(WARNING) << "Ignore " << ifName << " as there is NO active neighbors.";
@@ -1058,6 +1440,7 @@ Spark::processHeartbeatTimeout(
   SCOPE_EXIT {
     allocatedLabels_.erase(neighbor.label);
     ifNeighbors.erase(neighborName);
+    invalidateHelloPacket(ifName);
   };
 
   LOG(INFO) << "Heartbeat timer expired for: " << neighborName
@@ -1110,6 +1493,7 @@ Spark::processGRTimeout(
   SCOPE_EXIT {
     allocatedLabels_.erase(neighbor.label);
     ifNeighbors.erase(neighborName);
+    invalidateHelloPacket(ifName);
   };
 
   LOG(INFO) << "Graceful restart timer expired for: " << neighborName
@@ -1127,6 +1511,47 @@ Spark::processGRTimeout(
   neighborDownWrapper(neighbor, ifName, neighborName);
 }
 
+void
+Spark::processFastDetectionTimeout(
+    std::string const& ifName, std::string const& neighborName) {
+  // neighbor may have gone away while signal was in flight
+  auto ifNeighborsIt = sparkNeighbors_.find(ifName);
+  if (ifNeighborsIt == sparkNeighbors_.end()) {
+    return;
+  }
+  auto neighborIt = ifNeighborsIt->second.find(neighborName);
+  if (neighborIt == ifNeighborsIt->second.end() or
+      neighborIt->second.state != SparkNeighState::ESTABLISHED) {
+    return;
+  }
+
+  LOG(INFO) << "Fast detection declared down: " << neighborName
+            << " on interface " << ifName;
+
+  // same as heartbeat hold timer expiry
+  processHeartbeatTimeout(ifName, neighborName);
+}
+
+void
+Spark::addFastDetectionSession(
+    std::string const& ifName, std::string const& neighborName) {
+  if (not fastDetector_) {
+    return;
+  }
+
+  auto interfaceIt = interfaceDb_.find(ifName);
+  if (interfaceIt == interfaceDb_.end()) {
+    return;
+  }
+
+  auto const& interfaceEntry = interfaceIt->second;
+  fastDetector_->addSession(
+      ifName,
+      interfaceEntry.ifIndex,
+      interfaceEntry.v6LinkLocalNetwork.first.asV6(),
+      neighborName);
+}
+
 void
 Spark::processGRMsg(
     std::string const& neighborName,
@@ -1137,8 +1562,8 @@ Spark::processGRMsg(
       NeighborEventType::NEIGHBOR_RESTARTING, neighbor.toThrift());
 
   // start graceful-restart timer
-  neighbor.gracefulRestartHoldTimer = folly::AsyncTimeout::make(
-      *getEvb(), [this, ifName, neighborName]() noexcept {
+  neighbor.gracefulRestartHoldTimer =
+      getTimerWheel().makeTimer([this, ifName, neighborName]() noexcept {
         // change the state back to IDLE
         processGRTimeout(ifName, neighborName);
       });
@@ -1152,6 +1577,11 @@ Spark::processGRMsg(
 
   // neihbor is restarting, shutdown heartbeat hold timer
   neighbor.heartbeatHoldTimer.reset();
+
+  // neighbor stops sending fast detection packets while restarting
+  if (fastDetector_) {
+    fastDetector_->removeSession(ifName, neighborName);
+  }
 }
 
 void
@@ -1197,7 +1627,7 @@ Spark::processHelloMsg(
     // TODO: Spark is yet to support area change due to dynamic configuration.
     //       To avoid running area deducing logic for every single helloMsg,
     //       ONLY deduce for unknown neighbors.
-    auto area = getNeighborArea(neighborName, ifName, config_->getAreas());
+    auto area = getNeighborArea(neighborName, ifName, *config_);
     if (not area.has_value()) {
       return;
     }
@@ -1236,6 +1666,10 @@ Spark::processHelloMsg(
   neighbor.neighborTimestamp = nbrSentTimeInUs;
   neighbor.localTimestamp = myRecvTimeInUs;
 
+  // neighbor info reflected in hello packets changed, including seqNum and
+  // neighbor added or removed below
+  invalidateHelloPacket(ifName);
+
   // Deduce RTT for this neighbor and update timestamps
   auto tsIt = neighborInfos.find(myNodeName_);
   if (tsIt != neighborInfos.end()) {
@@ -1243,8 +1677,8 @@ Spark::processHelloMsg(
     updateNeighborRtt(
         // recvTime of neighbor helloPkt
         myRecvTimeInUs,
-        // sentTime of my helloPkt recorded by neighbor
-        std::chrono::microseconds(*ts.lastNbrMsgSentTsInUs_ref()),
+        // sentTime of my helloPkt recorded by neighbor, as seen by kernel
+        getHelloTxTimestamp(ifName, *ts.lastNbrMsgSentTsInUs_ref()),
         // recvTime of my helloPkt recorded by neighbor
         std::chrono::microseconds(*ts.lastMyMsgRcvdTsInUs_ref()),
         // sentTime of neighbor helloPkt
@@ -1297,8 +1731,8 @@ Spark::processHelloMsg(
 
     // Starts timer to periodically send hankshake msg
     const std::string neighborAreaId = neighbor.area;
-    neighbor.negotiateTimer = folly::AsyncTimeout::make(
-        *getEvb(), [this, ifName, neighborName, neighborAreaId]() noexcept {
+    neighbor.negotiateTimer = getTimerWheel().makeTimer(
+        [this, ifName, neighborName, neighborAreaId]() noexcept {
           sendHandshakeMsg(ifName, neighborName, neighborAreaId, false);
           // send out handshake msg periodically to this neighbor
           CHECK(sparkNeighbors_.count(ifName) > 0)
@@ -1313,8 +1747,8 @@ Spark::processHelloMsg(
     neighbor.negotiateTimer->scheduleTimeout(handshakeTime_);
 
     // Starts negotiate hold-timer
-    neighbor.negotiateHoldTimer = folly::AsyncTimeout::make(
-        *getEvb(), [this, ifName, neighborName]() noexcept {
+    neighbor.negotiateHoldTimer =
+        getTimerWheel().makeTimer([this, ifName, neighborName]() noexcept {
           // prevent to stucking in NEGOTIATE forever
           processNegotiateTimeout(ifName, neighborName);
         });
@@ -1383,12 +1817,15 @@ Spark::processHelloMsg(
         NeighborEventType::NEIGHBOR_RESTARTED, neighbor.toThrift());
 
     // start heartbeat timer again to make sure neighbor is alive
-    neighbor.heartbeatHoldTimer = folly::AsyncTimeout::make(
-        *getEvb(), [this, ifName, neighborName]() noexcept {
+    neighbor.heartbeatHoldTimer =
+        getTimerWheel().makeTimer([this, ifName, neighborName]() noexcept {
           processHeartbeatTimeout(ifName, neighborName);
         });
     neighbor.heartbeatHoldTimer->scheduleTimeout(neighbor.heartbeatHoldTime);
 
+    // resume fast detection for neighbor
+    addFastDetectionSession(ifName, neighborName);
+
     // stop the graceful-restart hold-timer
     neighbor.gracefulRestartHoldTimer.reset();
 
@@ -1593,23 +2030,104 @@ Spark::processHeartbeatMsg(
 }
 
 void
-Spark::processPacket() {
-  // receive and parse pkt
-  thrift::SparkHelloPacket helloPacket;
-  std::string ifName;
-  std::chrono::microseconds myRecvTime;
+Spark::processTxTimestamps() {
+  for (auto const& [packetId, txTs] :
+       IoProvider::recvTxTimestamps(mcastFd_, ioProvider_.get())) {
+    // ids are reported in order, earlier packets won't be reported anymore
+    auto it = pendingHelloTxTimestamps_.begin();
+    while (it != pendingHelloTxTimestamps_.end() and it->first < packetId) {
+      it = pendingHelloTxTimestamps_.erase(it);
+    }
+    if (it == pendingHelloTxTimestamps_.end() or it->first != packetId) {
+      continue; // not a hello packet
+    }
 
-  if (!parsePacket(helloPacket, ifName, myRecvTime)) {
-    return;
+    auto const [ifName, sentTsInUs] = it->second;
+    pendingHelloTxTimestamps_.erase(it);
+
+    const auto delay = txTs - std::chrono::microseconds(sentTsInUs);
+    if (delay.count() < 0 or delay > kMaxTxTimestampDelay) {
+      txTimestampMismatchCounter.add();
+      continue;
+    }
+
+    if (not interfaceDb_.count(ifName)) {
+      continue;
+    }
+    auto& txTimestamps = ifNameToHelloTxTimestamps_[ifName];
+    txTimestamps.emplace(sentTsInUs, txTs);
+    if (txTimestamps.size() > kMaxHelloTxTimestamps) {
+      txTimestamps.erase(txTimestamps.begin());
+    }
+    txTimestampDelayCounter.add(delay.count());
+  }
+}
+
+std::chrono::microseconds
+Spark::getHelloTxTimestamp(
+    std::string const& ifName, int64_t sentTsInUs) const {
+  auto ifIt = ifNameToHelloTxTimestamps_.find(ifName);
+  if (ifIt != ifNameToHelloTxTimestamps_.end()) {
+    auto tsIt = ifIt->second.find(sentTsInUs);
+    if (tsIt != ifIt->second.end()) {
+      return tsIt->second;
+    }
   }
+  return std::chrono::microseconds(sentTsInUs);
+}
+
+void
+Spark::processPacket() {
+  // TX timestamps of our hello packets are needed to measure RTT from
+  // neighbors' replies, collect them first
+  if (txTimestampingEnabled_) {
+    processTxTimestamps();
+  }
+
+  // drain the socket, receiving a batch of pkts per syscall
+  recvBuf_.resize(kMaxRecvBatchSize * kMinIpv6Mtu);
+  while (true) {
+    const auto msgs = IoProvider::recvMessages(
+        mcastFd_,
+        recvBuf_.data(),
+        kMinIpv6Mtu,
+        kMaxRecvBatchSize,
+        ioProvider_.get());
+
+    for (size_t i = 0; i < msgs.size(); ++i) {
+      try {
+        // parse pkt
+        thrift::SparkHelloPacket helloPacket;
+        std::string ifName;
+        std::chrono::microseconds myRecvTime;
+
+        if (!parsePacket(
+                msgs[i],
+                recvBuf_.data() + i * kMinIpv6Mtu,
+                helloPacket,
+                ifName,
+                myRecvTime)) {
+          continue;
+        }
+
+        // Spark specific msg processing
+        if (helloPacket.helloMsg_ref().has_value()) {
+          processHelloMsg(
+              helloPacket.helloMsg_ref().value(), ifName, myRecvTime);
+        } else if (helloPacket.heartbeatMsg_ref().has_value()) {
+          processHeartbeatMsg(helloPacket.heartbeatMsg_ref().value(), ifName);
+        } else if (helloPacket.handshakeMsg_ref().has_value()) {
+          processHandshakeMsg(helloPacket.handshakeMsg_ref().value(), ifName);
+        }
+      } catch (std::exception const& err) {
+        LOG(ERROR) << "Spark: error processing hello packet "
+                   << folly::exceptionStr(err);
+      }
+    }
 
-  // Spark specific msg processing
-  if (helloPacket.helloMsg_ref().has_value()) {
-    processHelloMsg(helloPacket.helloMsg_ref().value(), ifName, myRecvTime);
-  } else if (helloPacket.heartbeatMsg_ref().has_value()) {
-    processHeartbeatMsg(helloPacket.heartbeatMsg_ref().value(), ifName);
-  } else if (helloPacket.handshakeMsg_ref().has_value()) {
-    processHandshakeMsg(helloPacket.handshakeMsg_ref().value(), ifName);
+    if (msgs.size() < kMaxRecvBatchSize) {
+      break; // socket drained
+    }
   }
 }
 
@@ -1639,6 +2157,68 @@ Spark::sendHelloMsg(
   const auto ifIndex = interfaceEntry.ifIndex;
   const auto v4Addr = interfaceEntry.v4Network.first;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
+  const int64_t seqNum = mySeqNum_;
+  const int64_t sentTsInUs = getCurrentTimeInUs().count();
+
+  // reuse last packet of interface if only seqNum and sentTsInUs changed
+  auto& cache = ifNameToHelloPackets_[ifName];
+  if (cache.valid and cache.inFastInitState == inFastInitState and
+      cache.restarting == restarting and
+      patchI64(cache.packet, cache.seqNumOffset, cache.seqNum, seqNum) and
+      patchTrailingI64(cache.packet, cache.sentTsInUs, sentTsInUs)) {
+    helloPacketPatchedCounter.add();
+  } else {
+    serializeHelloPacket(
+        ifName, inFastInitState, restarting, seqNum, sentTsInUs, cache);
+  }
+  cache.seqNum = seqNum;
+  cache.sentTsInUs = sentTsInUs;
+  auto const& packet = cache.packet;
+
+  // send the payload
+  folly::SocketAddress dstAddr(
+      folly::IPAddress(Constants::kSparkMcastAddr.toString()),
+      neighborDiscoveryPort_);
+
+  if (kMinIpv6Mtu < packet.size()) {
+    LOG(ERROR) << "Hello packet is too big, cannot sent!";
+    return;
+  }
+
+  auto bytesSent = IoProvider::sendMessage(
+      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+
+  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
+    VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
+            << ifName << " failed due to error " << folly::errnoStr(errno);
+    return;
+  }
+
+  // wait for kernel TX timestamp of this packet
+  if (txTimestampingEnabled_) {
+    pendingHelloTxTimestamps_.emplace(
+        txPacketId_, std::make_pair(ifName, sentTsInUs));
+    if (pendingHelloTxTimestamps_.size() > kMaxPendingTxTimestamps) {
+      pendingHelloTxTimestamps_.erase(pendingHelloTxTimestamps_.begin());
+    }
+  }
+  ++txPacketId_;
+
+  // update counters for number of pkts and total size of pkts sent
+  helloBytesSentCounter.add(packet.size());
+  helloPacketSentCounter.add();
+
+  VLOG(4) << "Sent " << bytesSent << " bytes in hello packet";
+}
+
+void
+Spark::serializeHelloPacket(
+    std::string const& ifName,
+    bool inFastInitState,
+    bool restarting,
+    int64_t seqNum,
+    int64_t sentTsInUs,
+    HelloPacketCache& cache) {
   thrift::OpenrVersion openrVer(*kVersion_.version_ref());
 
   // build the helloMsg from scratch
@@ -1646,13 +2226,13 @@ Spark::sendHelloMsg(
   helloMsg.domainName_ref() = myDomainName_;
   helloMsg.nodeName_ref() = myNodeName_;
   helloMsg.ifName_ref() = ifName;
-  helloMsg.seqNum_ref() = mySeqNum_;
+  helloMsg.seqNum_ref() = seqNum;
   helloMsg.neighborInfos_ref() =
       std::map<std::string, thrift::ReflectedNeighborInfo>{};
   helloMsg.version_ref() = openrVer;
   helloMsg.solicitResponse_ref() = inFastInitState;
   helloMsg.restarting_ref() = restarting;
-  helloMsg.sentTsInUs_ref() = getCurrentTimeInUs().count();
+  helloMsg.sentTsInUs_ref() = sentTsInUs;
 
   // bake neighborInfo into helloMsg
   for (const auto& kv : sparkNeighbors_.at(ifName)) {
@@ -1670,36 +2250,32 @@ Spark::sendHelloMsg(
   thrift::SparkHelloPacket helloPacket;
   helloPacket.helloMsg_ref() = std::move(helloMsg);
 
-  // send the payload
-  auto packet = writeThriftObjStr(helloPacket, serializer_);
-  folly::SocketAddress dstAddr(
-      folly::IPAddress(Constants::kSparkMcastAddr.toString()),
-      neighborDiscoveryPort_);
+  writeThriftObjStr(helloPacket, serializer_, cache.packet);
+  cache.valid = true;
+  cache.inFastInitState = inFastInitState;
+  cache.restarting = restarting;
 
-  if (kMinIpv6Mtu < packet.size()) {
-    LOG(ERROR) << "Hello packet is too big, cannot sent!";
-    return;
+  // seqNum follows the header of helloMsg, and the headers and values of
+  // domainName, nodeName and ifName. Patching double checks the value there
+  cache.seqNumOffset = 1;
+  for (auto const* str : {&myDomainName_, &myNodeName_, &ifName}) {
+    cache.seqNumOffset += 1 + getVarintSize(str->size()) + str->size();
   }
+  cache.seqNumOffset += 1;
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  helloPacketSerializedCounter.add();
+}
 
-  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
-    VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
-            << ifName << " failed due to error " << folly::errnoStr(errno);
-    return;
+void
+Spark::invalidateHelloPacket(std::string const& ifName) {
+  auto it = ifNameToHelloPackets_.find(ifName);
+  if (it != ifNameToHelloPackets_.end()) {
+    it->second.valid = false;
   }
-
-  // update counters for number of pkts and total size of pkts sent
-  fb303::fbData->addStatValue(
-      "spark.hello.bytes_sent", packet.size(), fb303::SUM);
-  fb303::fbData->addStatValue("spark.hello.packet_sent", 1, fb303::SUM);
-
-  VLOG(4) << "Sent " << bytesSent << " bytes in hello packet";
 }
 
 void
-Spark::processInterfaceUpdates(InterfaceDatabase&& ifDb) {
+Spark::processInterfaceUpdates(InterfaceDatabaseUpdate&& update) {
   decltype(interfaceDb_) newInterfaceDb{};
 
   //
@@ -1708,7 +2284,7 @@ Spark::processInterfaceUpdates(InterfaceDatabase&& ifDb) {
   // - have a v6LinkLocal IP
   // - have an IPv4 addr when v4 is enabled
   //
-  for (const auto& info : ifDb) {
+  for (const auto& info : update.interfaces) {
     // ATTN: multiple networks can be associated with one ifName.
     //  - Retrieve networks in sorted order;
     //  - Use the lowest one (other node will do similar)
@@ -1740,6 +2316,32 @@ Spark::processInterfaceUpdates(InterfaceDatabase&& ifDb) {
   std::vector<std::string> toDel{};
   std::vector<std::string> toUpdate{};
 
+  if (not update.isFullSync) {
+    // only interfaces of delta have changed
+    for (const auto& info : update.interfaces) {
+      auto oldIt = interfaceDb_.find(info.ifName);
+      auto newIt = newInterfaceDb.find(info.ifName);
+      if (oldIt == interfaceDb_.end()) {
+        if (newIt != newInterfaceDb.end()) {
+          toAdd.emplace_back(info.ifName);
+        }
+      } else if (newIt == newInterfaceDb.end()) {
+        toDel.emplace_back(info.ifName);
+      } else if (newIt->second != oldIt->second) {
+        toUpdate.emplace_back(info.ifName);
+      }
+    }
+    for (const auto& ifName : update.removedIfNames) {
+      if (interfaceDb_.count(ifName)) {
+        toDel.emplace_back(ifName);
+      }
+    }
+    deleteInterface(toDel);
+    addInterface(toAdd, newInterfaceDb);
+    updateInterface(toUpdate, newInterfaceDb);
+    return;
+  }
+
   // iterate old and new interfaceDb to catch difference
   for (const auto& [oldIfName, oldInterface] : interfaceDb_) {
     auto it = newInterfaceDb.find(oldIfName);
@@ -1814,6 +2416,8 @@ Spark::deleteInterface(const std::vector<std::string>& toDel) {
     }
     // cleanup for this interface
     ifNameToHelloTimers_.erase(ifName);
+    ifNameToHelloPackets_.erase(ifName);
+    ifNameToHelloTxTimestamps_.erase(ifName);
     interfaceDb_.erase(ifName);
   }
 }
@@ -1854,7 +2458,7 @@ Spark::addInterface(
 
       // heartbeatTimers will start as soon as intf is in UP state
       auto heartbeatTimer =
-          folly::AsyncTimeout::make(*getEvb(), [this, ifName]() noexcept {
+          getTimerWheel().makeTimer([this, ifName]() noexcept {
             sendHeartbeatMsg(ifName);
             // schedule heartbeatTimers periodically as soon as intf is UP
             ifNameToHeartbeatTimers_.at(ifName)->scheduleTimeout(
@@ -1883,8 +2487,7 @@ Spark::addInterface(
     // this is due to the fact that it may not have yet configured a link-local
     // address. The hello packet will be sent later and will have good chances
     // of making it out if small delay is introduced.
-    auto helloTimer = folly::AsyncTimeout::make(
-        *getEvb(),
+    auto helloTimer = getTimerWheel().makeTimer(
         [this, ifName, timePoint, roll, rollFast]() mutable noexcept {
           VLOG(3) << "Sending hello multicast packet on interface " << ifName;
           bool inFastInitState = false;
@@ -1980,10 +2583,11 @@ Spark::getNewLabelForIface(const std::string& ifName) {
     return label;
   }
 
-  // Label already exists let's try to find out a new one from the back
-  label = Constants::kSrLocalRange.second; // last possible one
+  // Label already exists let's try to find out a new one from the back.
+  // Every shard allocates from its own interleaved subset of labels.
+  label = Constants::kSrLocalRange.second - shard_.index; // last possible one
   while (!allocatedLabels_.insert(label).second) { // value already exists
-    label--;
+    label -= shard_.count;
   }
 
   if (label < Constants::kSrLocalRange.first) {
@@ -2012,17 +2616,18 @@ Spark::updateGlobalCounters() {
           "spark.seq_num." + neighbor.nodeName, neighbor.seqNum);
     }
   }
-  fb303::fbData->setCounter(
-      "spark.num_tracked_interfaces", sparkNeighbors_.size());
-  fb303::fbData->setCounter(
-      "spark.num_tracked_neighbors", trackedNeighborCount);
-  fb303::fbData->setCounter(
-      "spark.num_adjacent_neighbors", adjacentNeighborCount);
-  fb303::fbData->setCounter(
+  setAggregatedCounter("spark.num_tracked_interfaces", sparkNeighbors_.size());
+  setAggregatedCounter("spark.num_tracked_neighbors", trackedNeighborCount);
+  setAggregatedCounter("spark.num_adjacent_neighbors", adjacentNeighborCount);
+  setAggregatedCounter(
       "spark.tracked_adjacent_neighbors_diff",
       trackedNeighborCount - adjacentNeighborCount);
-  fb303::fbData->setCounter("spark.my_seq_num", mySeqNum_);
-  fb303::fbData->setCounter("spark.pending_timers", getEvb()->timer().count());
+  setAggregatedCounter(
+      "spark.pending_timers",
+      getEvb()->timer().count() + getTimerWheel().getNumScheduled());
+  if (shard_.index == 0) {
+    fb303::fbData->setCounter("spark.my_seq_num", mySeqNum_);
+  }
 }
 
 // This is a static function
@@ -2030,23 +2635,17 @@ std::optional<std::string>
 Spark::getNeighborArea(
     const std::string& peerNodeName,
     const std::string& localIfName,
-    const std::unordered_map<std::string /* areaId */, AreaConfiguration>&
-        areaConfigs) {
-  // IMPT: ordered set. Function yeilds lowest areaId in case of multiple
+    const Config& config) {
+  // IMPT: sorted. Function yeilds lowest areaId in case of multiple
   // candidate areas
-  std::set<std::string> candidateAreas{};
-
-  // looping through areaIdRegexList
-  for (const auto& [areaId, areaConfig] : areaConfigs) {
-    if (areaConfig.shouldDiscoverOnIface(localIfName) &&
-        areaConfig.shouldPeerWithNeighbor(peerNodeName)) {
-      VLOG(1) << fmt::format(
-          "Area: {} found for neighbor: {} on interface: {}",
-          areaId,
-          peerNodeName,
-          localIfName);
-      candidateAreas.insert(areaId);
-    }
+  const auto candidateAreas =
+      config.getNeighborAreaIds(peerNodeName, localIfName);
+  for (const auto& areaId : candidateAreas) {
+    VLOG(1) << fmt::format(
+        "Area: {} found for neighbor: {} on interface: {}",
+        areaId,
+        peerNodeName,
+        localIfName);
   }
 
   if (candidateAreas.empty()) {
@@ -2066,6 +2665,60 @@ Spark::getNeighborArea(
 void
 Spark::setThrowParserErrors(bool val) {
   isThrowParserErrorsOn_ = val;
+  for (auto& worker : workers_) {
+    worker->setThrowParserErrors(val);
+  }
+}
+
+size_t
+Spark::getShardIndex(std::string const& ifName) const {
+  if (shard_.count == 1) {
+    return 0;
+  }
+  return std::hash<std::string>()(ifName) % shard_.count;
+}
+
+InterfaceDatabaseUpdate
+Spark::dispatchInterfaceUpdates(InterfaceDatabaseUpdate&& update) {
+  if (workers_.empty()) {
+    return std::move(update);
+  }
+
+  // NOTE: every worker gets a full sync, so that it also learns about removal
+  // of all of its interfaces. Deltas only go to workers they're about
+  std::vector<InterfaceDatabaseUpdate> shardUpdates(shard_.count);
+  for (auto& shardUpdate : shardUpdates) {
+    shardUpdate.isFullSync = update.isFullSync;
+  }
+  for (auto& info : update.interfaces) {
+    shardUpdates.at(getShardIndex(info.ifName))
+        .interfaces.emplace_back(std::move(info));
+  }
+  for (auto& ifName : update.removedIfNames) {
+    shardUpdates.at(getShardIndex(ifName))
+        .removedIfNames.emplace_back(std::move(ifName));
+  }
+  for (size_t i = 1; i < shard_.count; ++i) {
+    auto& shardUpdate = shardUpdates.at(i);
+    if (shardUpdate.isFullSync or not shardUpdate.interfaces.empty() or
+        not shardUpdate.removedIfNames.empty()) {
+      workerInterfaceUpdatesQueues_.at(i - 1)->push(std::move(shardUpdate));
+    }
+  }
+  return std::move(shardUpdates.at(0));
+}
+
+void
+Spark::setAggregatedCounter(std::string const& key, int64_t value) {
+  if (shard_.count == 1) {
+    fb303::fbData->setCounter(key, value);
+    return;
+  }
+
+  // every shard contributes the delta since its last export
+  auto& lastValue = aggregatedCounters_[key];
+  fb303::fbData->incrementCounter(key, value - lastValue);
+  lastValue = value;
 }
 
 } // namespace openr
@@ -10,6 +10,8 @@
 #include <fmt/format.h>
 #include <chrono>
 #include <functional>
+#include <map>
+#include <thread>
 
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -19,6 +21,7 @@
 #include <openr/common/Constants.h>
 #include <openr/common/OpenrEventBase.h>
 #include <openr/common/StepDetector.h>
+#include <openr/common/TimerWheel.h>
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
 #include <openr/config/Config.h>
@@ -26,6 +29,7 @@
 #include <openr/if/gen-cpp2/Types_constants.h>
 #include <openr/if/gen-cpp2/Types_types.h>
 #include <openr/messaging/ReplicateQueue.h>
+#include <openr/spark/FastDetector.h>
 #include <openr/spark/IoProvider.h>
 
 namespace openr {
@@ -78,7 +82,7 @@ class Spark final : public OpenrEventBase {
  public:
   Spark(
       // consumer Queue
-      messaging::RQueue<InterfaceDatabase> interfaceUpdatesQueue,
+      messaging::RQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue,
       // producer Queue
       messaging::ReplicateQueue<NeighborEvent>& nbrUpdatesQueue,
       // port for TCP connection
@@ -100,6 +104,10 @@ class Spark final : public OpenrEventBase {
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::SparkNeighbor>>>
   getNeighbors();
 
+  // apply hello timers and area regexes of a reloaded config to all shards
+  folly::SemiFuture<folly::Unit> updateConfig(
+      std::shared_ptr<const Config> config);
+
   // get the current state of neighborNode, used for unit-testing
   folly::SemiFuture<std::optional<SparkNeighState>> getSparkNeighState(
       std::string const& ifName, std::string const& neighborName);
@@ -107,6 +115,9 @@ class Spark final : public OpenrEventBase {
   // Util function to convert ENUM SparlNeighborState to string
   static std::string toStr(SparkNeighState state);
 
+  // override eventloop run(), starts fast detection thread if enabled
+  void run() override;
+
   // override eventloop stop()
   void stop() override;
 
@@ -114,6 +125,45 @@ class Spark final : public OpenrEventBase {
   void setThrowParserErrors(bool);
 
  private:
+  //
+  // Interfaces are sharded across `count` Spark instances, each running its
+  // own event base. Instance of shard 0 is the one constructed by the public
+  // constructor. It creates and owns the others, and dispatches interface
+  // updates and public API calls to them.
+  //
+  struct Shard {
+    size_t index{0};
+    size_t count{1};
+  };
+
+  Spark(
+      messaging::RQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue,
+      messaging::ReplicateQueue<NeighborEvent>& nbrUpdatesQueue,
+      KvStoreCmdPort kvStoreCmdPort,
+      OpenrCtrlThriftPort openrCtrlThriftPort,
+      std::shared_ptr<IoProvider> ioProvider,
+      std::shared_ptr<const Config> config,
+      std::pair<uint32_t, uint32_t> version,
+      std::optional<uint32_t> maybeMaxAllowedPps,
+      Shard shard);
+
+  // index of shard handling the interface
+  size_t getShardIndex(std::string const& ifName) const;
+
+  // forward updates of other shards' interfaces, return ones of this shard
+  InterfaceDatabaseUpdate dispatchInterfaceUpdates(
+      InterfaceDatabaseUpdate&& update);
+
+  // send out restarting msg over interfaces of this shard only
+  folly::SemiFuture<folly::Unit> floodShardRestartingMsg();
+
+  // apply reloaded config to this shard only
+  folly::SemiFuture<folly::Unit> updateShardConfig(
+      std::shared_ptr<const Config> config);
+
+  // set counter aggregated over all shards
+  void setAggregatedCounter(std::string const& key, int64_t value);
+
   //
   // Interface tracking
   //
@@ -158,8 +208,8 @@ class Spark final : public OpenrEventBase {
   bool shouldProcessHelloPacket(
       std::string const& ifName, folly::IPAddress const& addr);
 
-  // process hello packet from a neighbor. we want to see if
-  // the neighbor could be added as adjacent peer.
+  // process hello packets from neighbors, draining the socket. we want to
+  // see if the neighbor could be added as adjacent peer.
   void processPacket();
 
   // process helloMsg in Spark context
@@ -176,12 +226,43 @@ class Spark final : public OpenrEventBase {
   void processHandshakeMsg(
       thrift::SparkHandshakeMsg const& handshakeMsg, std::string const& ifName);
 
+  // Last hello packet serialized for an interface. Sent again with seqNum
+  // and sentTsInUs patched in place as long as neighbor infos and flags of
+  // interface are unchanged
+  struct HelloPacketCache {
+    // cleared when neighbor infos of interface change
+    bool valid{false};
+
+    // flags and values packet was built or last patched with
+    bool inFastInitState{false};
+    bool restarting{false};
+    int64_t seqNum{0};
+    int64_t sentTsInUs{0};
+
+    // offset of seqNum value in packet
+    size_t seqNumOffset{0};
+
+    std::string packet;
+  };
+
   // util call to send hello msg
   void sendHelloMsg(
       std::string const& ifName,
       bool inFastInitState = false,
       bool restarting = false);
 
+  // build and serialize hello packet of interface into cache
+  void serializeHelloPacket(
+      std::string const& ifName,
+      bool inFastInitState,
+      bool restarting,
+      int64_t seqNum,
+      int64_t sentTsInUs,
+      HelloPacketCache& cache);
+
+  // force next hello packet of interface to be built from neighbor infos
+  void invalidateHelloPacket(std::string const& ifName);
+
   // util call to send handshake msg
   void sendHandshakeMsg(
       std::string const& ifName,
@@ -189,12 +270,17 @@ class Spark final : public OpenrEventBase {
       std::string const& neighborAreaId,
       bool isAdjEstablished);
 
-  // util call to send heartbeat msg
+  // util call to send heartbeat msg. Heartbeats of an event loop iteration
+  // are sent together, see sendPendingHeartbeats()
   void sendHeartbeatMsg(std::string const& ifName);
 
+  // send heartbeats queued by sendHeartbeatMsg in one syscall
+  void sendPendingHeartbeats();
+
   // Function processes interface updates from LinkMonitor and appropriately
-  // enable/disable neighbor discovery
-  void processInterfaceUpdates(InterfaceDatabase&& interfaceUpdates);
+  // enable/disable neighbor discovery. Only interfaces of a delta update are
+  // looked at, a full sync is diffed against all tracked interfaces
+  void processInterfaceUpdates(InterfaceDatabaseUpdate&& interfaceUpdates);
 
   // util function to delete interface in spark
   void deleteInterface(const std::vector<std::string>& toDel);
@@ -240,15 +326,16 @@ class Spark final : public OpenrEventBase {
   // against `thrift::AreaConfig` parsed by Spark. It support both
   // interface and peer node name regexes. Treat multiple/conflict
   // deduced area as error. Tie-breaking mechanism can be implemented
-  // if needed.
+  // if needed. Matches are memoized by Config.
   static std::optional<std::string> getNeighborArea(
       const std::string& peerNodeName,
       const std::string& ifName,
-      const std::unordered_map<std::string /* areaId */, AreaConfiguration>&
-          areaConfigs);
+      const Config& config);
 
-  // function to receive and parse received pkt
+  // function to parse received pkt
   bool parsePacket(
+      IoProvider::ReceivedMessage const& msg /* received message */,
+      uint8_t const* buf /* data of received message */,
       thrift::SparkHelloPacket& pkt /* packet( type will be renamed later) */,
       std::string& ifName /* interface */,
       std::chrono::microseconds& recvTime /* kernel timestamp when recved */);
@@ -333,16 +420,16 @@ class Spark final : public OpenrEventBase {
     SparkNeighState state{SparkNeighState::IDLE};
 
     // timer to periodically send out handshake pkt
-    std::unique_ptr<folly::AsyncTimeout> negotiateTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> negotiateTimer{nullptr};
 
     // negotiate stage hold-timer
-    std::unique_ptr<folly::AsyncTimeout> negotiateHoldTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> negotiateHoldTimer{nullptr};
 
     // heartbeat hold-timer
-    std::unique_ptr<folly::AsyncTimeout> heartbeatHoldTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> heartbeatHoldTimer{nullptr};
 
     // graceful restart hold-timer
-    std::unique_ptr<folly::AsyncTimeout> gracefulRestartHoldTimer{nullptr};
+    std::unique_ptr<TimerWheel::Timer> gracefulRestartHoldTimer{nullptr};
 
     // KvStore related port. Info passed to LinkMonitor for neighborEvent
     int32_t kvStoreCmdPort{0};
@@ -414,6 +501,14 @@ class Spark final : public OpenrEventBase {
   void notifySparkNeighborEvent(
       NeighborEventType type, thrift::SparkNeighbor const& info);
 
+  // drain TX timestamps of sent packets reported by kernel
+  void processTxTimestamps();
+
+  // kernel TX timestamp of hello packet sent at `sentTsInUs`, or
+  // `sentTsInUs` itself if not known
+  std::chrono::microseconds getHelloTxTimestamp(
+      std::string const& ifName, int64_t sentTsInUs) const;
+
   // callback function for rtt change
   void processRttChange(
       std::string const& ifName,
@@ -438,6 +533,14 @@ class Spark final : public OpenrEventBase {
   void processGRTimeout(
       std::string const& ifName, std::string const& neighborName);
 
+  // process neighbor down signaled by fast detection
+  void processFastDetectionTimeout(
+      std::string const& ifName, std::string const& neighborName);
+
+  // start fast detection for neighbor if enabled
+  void addFastDetectionSession(
+      std::string const& ifName, std::string const& neighborName);
+
   // Util function for state transition
   static SparkNeighState getNextState(
       std::optional<SparkNeighState> const& currState,
@@ -456,14 +559,14 @@ class Spark final : public OpenrEventBase {
   // UDP port for send/recv of spark hello messages
   const uint16_t neighborDiscoveryPort_{6666};
 
-  // Spark hello msg sendout interval
-  const std::chrono::milliseconds helloTime_{0};
+  // Spark hello msg sendout interval, replaced by updateConfig()
+  std::chrono::milliseconds helloTime_{0};
 
   // Spark hello msg sendout interval under fast-init case
-  const std::chrono::milliseconds fastInitHelloTime_{0};
+  std::chrono::milliseconds fastInitHelloTime_{0};
 
   // Spark handshake msg sendout interval
-  const std::chrono::milliseconds handshakeTime_{0};
+  std::chrono::milliseconds handshakeTime_{0};
 
   // Spark heartbeat msg sendout interval (keepAliveTime)
   const std::chrono::milliseconds keepAliveTime_{0};
@@ -511,15 +614,48 @@ class Spark final : public OpenrEventBase {
   // Hello packet send timers for each interface
   std::unordered_map<
       std::string /* ifName */,
-      std::unique_ptr<folly::AsyncTimeout>>
+      std::unique_ptr<TimerWheel::Timer>>
       ifNameToHelloTimers_{};
 
   // heartbeat packet send timers for each interface
   std::unordered_map<
       std::string /* ifName */,
-      std::unique_ptr<folly::AsyncTimeout>>
+      std::unique_ptr<TimerWheel::Timer>>
       ifNameToHeartbeatTimers_{};
 
+  // hello packets of each interface, see HelloPacketCache
+  std::unordered_map<std::string /* ifName */, HelloPacketCache>
+      ifNameToHelloPackets_{};
+
+  // Whether kernel reports TX timestamps of packets sent on mcastFd_
+  bool txTimestampingEnabled_{false};
+
+  // number of packets sent on mcastFd_, matching kernel's TX timestamp ids
+  uint32_t txPacketId_{0};
+
+  // hello packets waiting for their TX timestamp, by packet id
+  std::map<uint32_t, std::pair<std::string /* ifName */, int64_t /* sentTs */>>
+      pendingHelloTxTimestamps_{};
+
+  // kernel TX timestamps of latest hello packets sent on each interface,
+  // by sentTsInUs carried in packet. Used in place of sentTsInUs for RTT.
+  std::unordered_map<
+      std::string /* ifName */,
+      std::map<int64_t /* sentTsInUs */, std::chrono::microseconds>>
+      ifNameToHelloTxTimestamps_{};
+
+  // last heartbeat packet sent, same for all interfaces but its seqNum
+  std::string heartbeatPacket_{};
+  int64_t heartbeatSeqNum_{0};
+
+  // heartbeat packets waiting to be sent at the end of event loop iteration,
+  // with their interface
+  std::vector<std::pair<std::string /* ifName */, IoProvider::SendRequest>>
+      pendingHeartbeats_{};
+
+  // buffer for receiving a batch of packets
+  std::vector<uint8_t> recvBuf_{};
+
   // number of active neighbors for each interface
   std::unordered_map<
       std::string /* ifName */,
@@ -548,6 +684,24 @@ class Spark final : public OpenrEventBase {
   // Timer for updating and submitting counters periodically
   std::unique_ptr<folly::AsyncTimeout> counterUpdateTimer_{nullptr};
 
+  // Interface shard handled by this instance
+  const Shard shard_;
+
+  // Instances handling other shards, their threads and interface update
+  // queues. Only populated for shard 0.
+  std::vector<std::unique_ptr<Spark>> workers_;
+  std::vector<std::thread> workerThreads_;
+  std::vector<
+      std::unique_ptr<messaging::ReplicateQueue<InterfaceDatabaseUpdate>>>
+      workerInterfaceUpdatesQueues_;
+
+  // Values of aggregated counters last exported by this shard
+  std::unordered_map<std::string, int64_t> aggregatedCounters_;
+
+  // Optional fast neighbor failure detection, running in its own thread
+  std::unique_ptr<FastDetector> fastDetector_{nullptr};
+  std::thread fastDetectorThread_;
+
   // Optional rate-limit on processing inbound Spark messages
   std::optional<uint32_t> maybeMaxAllowedPps_;
 
@@ -72,7 +72,12 @@ SparkWrapper::stop() {
 
 void
 SparkWrapper::updateInterfaceDb(const InterfaceDatabase& ifDb) {
-  interfaceUpdatesQueue_.push(ifDb);
+  interfaceUpdatesQueue_.push(InterfaceDatabaseUpdate(ifDb));
+}
+
+void
+SparkWrapper::sendInterfaceUpdate(const InterfaceDatabaseUpdate& update) {
+  interfaceUpdatesQueue_.push(update);
 }
 
 std::optional<NeighborEvent>
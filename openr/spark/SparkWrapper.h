@@ -49,6 +49,9 @@ class SparkWrapper {
   // return true upon success and false otherwise
   void updateInterfaceDb(const InterfaceDatabase& ifDb);
 
+  // send interface update as is, e.g. a delta
+  void sendInterfaceUpdate(const InterfaceDatabaseUpdate& update);
+
   // receive spark neighbor event
   std::optional<NeighborEvent> recvNeighborEvent(
       std::optional<std::chrono::milliseconds> timeout = std::nullopt);
@@ -89,7 +92,7 @@ class SparkWrapper {
       neighborUpdatesQueue_.getReader()};
 
   // Queue to receive interface update from LinkMonitor
-  messaging::ReplicateQueue<InterfaceDatabase> interfaceUpdatesQueue_;
+  messaging::ReplicateQueue<InterfaceDatabaseUpdate> interfaceUpdatesQueue_;
 
   // Spark owned by this wrapper.
   std::shared_ptr<Spark> spark_{nullptr};
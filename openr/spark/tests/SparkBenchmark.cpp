@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <poll.h>
+#include <time.h>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+
+#include <fb303/ServiceData.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/config/Config.h>
+#include <openr/config/tests/Utils.h>
+#include <openr/spark/SparkWrapper.h>
+#include <openr/tests/mocks/MockIoProvider.h>
+#include <openr/tests/mocks/MockIoProviderUtils.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace {
+
+const std::string kNodeName{"node-dut"};
+const std::string kDomainName{"bench_domain"};
+
+// ifIndex of interfaces of simulated neighbors is offset from the ones of
+// the Spark under test
+const int kPeerIfIndexOffset{100000};
+
+// Size of receive buffer, Spark packets never exceed min IPv6 MTU
+const size_t kMinIpv6Mtu{1280};
+
+// Time to wait for Spark under test to process events
+const std::chrono::seconds kMaxWaitTime{60};
+
+int64_t
+getCurrentTimeInUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+namespace openr {
+
+/**
+ * Single Spark under test, connected to #numNeighbors simulated neighbors
+ * spread over #numIfaces interfaces. Neighbors are not backed by Spark
+ * instances, their packets are crafted and injected via MockIoProvider so as
+ * to measure the cost of Spark under test alone:
+ * - Neighbors reflect the latest hello packet of Spark under test seen on
+ *   their interface, which is drained by the fixture
+ * - Hello, hello and handshake bring a neighbor from IDLE to ESTABLISHED
+ */
+class SparkBenchmarkFixture {
+ public:
+  SparkBenchmarkFixture(uint32_t numIfaces, uint32_t numNeighbors)
+      : numIfaces_(numIfaces), numNeighbors_(numNeighbors) {
+    mockIoProvider_ = std::make_shared<MockIoProvider>();
+    mockIoProviderThread_ = std::make_unique<std::thread>(
+        [this]() { mockIoProvider_->start(); });
+    mockIoProvider_->waitUntilRunning();
+
+    // Connect every interface of Spark under test to one of neighbors, which
+    // all of its neighbors share
+    IfNameAndifIndex ifNameAndIfIndex;
+    ConnectedIfPairs connectedPairs;
+    for (uint32_t i = 0; i < numIfaces_; ++i) {
+      const auto ifName = getIfName(i);
+      const auto peerIfName = getPeerIfName(i);
+      ifNameAndIfIndex.emplace_back(ifName, getIfIndex(i));
+      ifNameAndIfIndex.emplace_back(peerIfName, getPeerIfIndex(i));
+      connectedPairs[ifName] = {{peerIfName, 0}};
+      connectedPairs[peerIfName] = {{ifName, 0}};
+    }
+    mockIoProvider_->addIfNameIfIndex(ifNameAndIfIndex);
+    mockIoProvider_->setConnectedPairs(connectedPairs);
+
+    // Single socket receiving on and sending from all neighbor interfaces
+    peerFd_ = mockIoProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    for (uint32_t i = 0; i < numIfaces_; ++i) {
+      struct ipv6_mreq mreq;
+      mreq.ipv6mr_interface = getPeerIfIndex(i);
+      mockIoProvider_->setsockopt(
+          peerFd_, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq));
+    }
+
+    auto tConfig = getBasicOpenrConfig(
+        kNodeName, kDomainName, {} /* areaCfg */, false /* enableV4 */);
+    tConfig.spark_config_ref()->hold_time_s_ref() = 30;
+    tConfig.spark_config_ref()->graceful_restart_time_s_ref() = 60;
+    config_ = std::make_shared<Config>(tConfig);
+
+    spark_ = std::make_unique<SparkWrapper>(
+        kNodeName,
+        std::make_pair(
+            Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+        mockIoProvider_,
+        config_);
+    spark_->run();
+
+    InterfaceDatabase ifDb;
+    for (uint32_t i = 0; i < numIfaces_; ++i) {
+      const auto linkLocal =
+          folly::IPAddress::createNetwork(fmt::format("fe80::{:x}/128", i + 1));
+      ifDb.emplace_back(InterfaceInfo(
+          getIfName(i), true /* isUp */, getIfIndex(i), {linkLocal}));
+    }
+    spark_->updateInterfaceDb(ifDb);
+
+    // Wait for Spark under test to say hello on all interfaces
+    waitUntil([this]() { return dutHellos_.size() == numIfaces_; });
+  }
+
+  ~SparkBenchmarkFixture() {
+    spark_->stop();
+    spark_.reset();
+    mockIoProvider_->stop();
+    mockIoProviderThread_->join();
+  }
+
+  // Bring all neighbors to ESTABLISHED and wait for all NEIGHBOR_UP events
+  void
+  establishNeighbors() {
+    for (uint32_t k = 0; k < numNeighbors_; ++k) {
+      // IDLE => WARM
+      sendHello(k);
+      // WARM => NEGOTIATE
+      sendHello(k);
+      // NEGOTIATE => ESTABLISHED
+      sendHandshake(k);
+    }
+
+    uint32_t numUp{0};
+    const auto startTime = std::chrono::steady_clock::now();
+    while (numUp < numNeighbors_) {
+      CHECK(std::chrono::steady_clock::now() - startTime < kMaxWaitTime)
+          << "Timed out waiting for neighbors to come up";
+      drainDutPackets();
+      auto event = spark_->recvNeighborEvent(std::chrono::milliseconds(1));
+      if (event.has_value() and
+          event->eventType == NeighborEventType::NEIGHBOR_UP) {
+        ++numUp;
+      }
+    }
+  }
+
+  void
+  sendHellos() {
+    for (uint32_t k = 0; k < numNeighbors_; ++k) {
+      sendHello(k);
+    }
+  }
+
+  void
+  sendHeartbeats() {
+    for (uint32_t k = 0; k < numNeighbors_; ++k) {
+      thrift::SparkHeartbeatMsg heartbeatMsg;
+      heartbeatMsg.nodeName_ref() = getNeighborName(k);
+      heartbeatMsg.seqNum_ref() = ++seqNums_[k];
+
+      thrift::SparkHelloPacket pkt;
+      pkt.heartbeatMsg_ref() = std::move(heartbeatMsg);
+      sendPacket(k, pkt);
+    }
+  }
+
+  // Wait for Spark under test to process #numPackets more packets
+  void
+  waitForPacketsProcessed(uint64_t numPackets) {
+    waitUntil([this, numPackets]() {
+      return getNumPacketsProcessed() >= numPacketsProcessed_ + numPackets;
+    });
+    numPacketsProcessed_ += numPackets;
+    // counter is bumped ahead of processing, wait for last packet as well
+    getSparkCpuTime();
+  }
+
+  int64_t
+  getNumPacketsProcessed() const {
+    return fb303::fbData->getCounter("spark.hello.packet_processed.sum");
+  }
+
+  // CPU time consumed by thread of Spark under test
+  std::chrono::microseconds
+  getSparkCpuTime() {
+    struct timespec ts {};
+    spark_->get()->getEvb()->runInEventBaseThreadAndWait(
+        [&ts]() { clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts); });
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+  }
+
+  // Start counting processed packets from now on
+  void
+  resetNumPacketsProcessed() {
+    numPacketsProcessed_ = getNumPacketsProcessed();
+  }
+
+ private:
+  struct DutHello {
+    int64_t seqNum{0};
+    int64_t sentTsInUs{0};
+    int64_t rcvdTsInUs{0};
+  };
+
+  static std::string
+  getIfName(uint32_t i) {
+    return fmt::format("iface-{}", i);
+  }
+
+  static std::string
+  getPeerIfName(uint32_t i) {
+    return fmt::format("peer-iface-{}", i);
+  }
+
+  static int
+  getIfIndex(uint32_t i) {
+    return i + 1;
+  }
+
+  static int
+  getPeerIfIndex(uint32_t i) {
+    return kPeerIfIndexOffset + i + 1;
+  }
+
+  static std::string
+  getNeighborName(uint32_t k) {
+    return fmt::format("neighbor-{}", k);
+  }
+
+  static folly::IPAddressV6
+  getNeighborAddr(uint32_t k) {
+    return folly::IPAddressV6(
+        fmt::format("fe80::1:{:x}:{:x}", (k + 1) >> 16, (k + 1) & 0xffff));
+  }
+
+  uint32_t
+  getNeighborIface(uint32_t k) const {
+    return k % numIfaces_;
+  }
+
+  template <typename Pred>
+  void
+  waitUntil(Pred pred) {
+    const auto startTime = std::chrono::steady_clock::now();
+    while (not pred()) {
+      CHECK(std::chrono::steady_clock::now() - startTime < kMaxWaitTime)
+          << "Timed out waiting for Spark under test";
+      drainDutPackets();
+      std::this_thread::yield();
+    }
+  }
+
+  // Receive packets sent by Spark under test, remember latest hello per
+  // interface to be reflected by neighbors
+  void
+  drainDutPackets() {
+    struct pollfd pfd {
+      peerFd_, POLLIN, 0
+    };
+    while (::poll(&pfd, 1, 0 /* timeout */) > 0) {
+      char buf[kMinIpv6Mtu];
+      std::array<char, CMSG_SPACE(sizeof(struct in6_pktinfo)) * 4> cbuf{};
+      struct sockaddr_storage srcAddr {};
+      struct iovec entry {
+        buf, sizeof(buf)
+      };
+      struct msghdr msg {};
+      msg.msg_name = &srcAddr;
+      msg.msg_namelen = sizeof(srcAddr);
+      msg.msg_iov = &entry;
+      msg.msg_iovlen = 1;
+      msg.msg_control = cbuf.data();
+      msg.msg_controllen = cbuf.size();
+
+      auto bytesRead = mockIoProvider_->recvmsg(peerFd_, &msg, 0);
+      if (bytesRead <= 0) {
+        break;
+      }
+      const int peerIfIndex = MockIoProviderUtils::getMsgIfIndex(&msg);
+      auto pkt = readThriftObjStr<thrift::SparkHelloPacket>(
+          std::string(buf, bytesRead), serializer_);
+      if (auto helloMsg = pkt.helloMsg_ref()) {
+        auto& dutHello = dutHellos_[peerIfIndex - kPeerIfIndexOffset - 1];
+        dutHello.seqNum = *helloMsg->seqNum_ref();
+        dutHello.sentTsInUs = *helloMsg->sentTsInUs_ref();
+        dutHello.rcvdTsInUs = getCurrentTimeInUs();
+      }
+    }
+  }
+
+  void
+  sendHello(uint32_t k) {
+    const auto& dutHello = dutHellos_.at(getNeighborIface(k));
+
+    thrift::ReflectedNeighborInfo neighborInfo;
+    neighborInfo.seqNum_ref() = dutHello.seqNum;
+    neighborInfo.lastNbrMsgSentTsInUs_ref() = dutHello.sentTsInUs;
+    neighborInfo.lastMyMsgRcvdTsInUs_ref() = dutHello.rcvdTsInUs;
+
+    thrift::SparkHelloMsg helloMsg;
+    helloMsg.domainName_ref() = kDomainName;
+    helloMsg.nodeName_ref() = getNeighborName(k);
+    helloMsg.ifName_ref() = getPeerIfName(getNeighborIface(k));
+    helloMsg.seqNum_ref() = ++seqNums_[k];
+    helloMsg.neighborInfos_ref()->emplace(kNodeName, std::move(neighborInfo));
+    helloMsg.version_ref() = Constants::kOpenrVersion;
+    helloMsg.solicitResponse_ref() = false;
+    helloMsg.restarting_ref() = false;
+    helloMsg.sentTsInUs_ref() = getCurrentTimeInUs();
+
+    thrift::SparkHelloPacket pkt;
+    pkt.helloMsg_ref() = std::move(helloMsg);
+    sendPacket(k, pkt);
+  }
+
+  void
+  sendHandshake(uint32_t k) {
+    thrift::SparkHandshakeMsg handshakeMsg;
+    handshakeMsg.nodeName_ref() = getNeighborName(k);
+    handshakeMsg.isAdjEstablished_ref() = true;
+    handshakeMsg.holdTime_ref() = 30000;
+    handshakeMsg.gracefulRestartTime_ref() = 60000;
+    handshakeMsg.transportAddressV6_ref() =
+        toBinaryAddress(folly::IPAddress(getNeighborAddr(k)));
+    handshakeMsg.transportAddressV4_ref() =
+        toBinaryAddress(folly::IPAddress("0.0.0.0"));
+    handshakeMsg.openrCtrlThriftPort_ref() = 2018;
+    handshakeMsg.kvStoreCmdPort_ref() = 10002;
+    handshakeMsg.area_ref() = kTestingAreaName;
+    handshakeMsg.neighborNodeName_ref() = kNodeName;
+
+    thrift::SparkHelloPacket pkt;
+    pkt.handshakeMsg_ref() = std::move(handshakeMsg);
+    sendPacket(k, pkt);
+  }
+
+  void
+  sendPacket(uint32_t k, thrift::SparkHelloPacket const& pkt) {
+    const folly::SocketAddress dstAddr(
+        folly::IPAddress(Constants::kSparkMcastAddr.toString()),
+        *config_->getSparkConfig().neighbor_discovery_port_ref());
+    const auto packet = writeThriftObjStr(pkt, serializer_);
+    const auto bytesSent = IoProvider::sendMessage(
+        peerFd_,
+        getPeerIfIndex(getNeighborIface(k)),
+        getNeighborAddr(k),
+        dstAddr,
+        packet,
+        mockIoProvider_.get());
+    CHECK_EQ(packet.size(), bytesSent);
+  }
+
+  const uint32_t numIfaces_{0};
+  const uint32_t numNeighbors_{0};
+
+  std::shared_ptr<MockIoProvider> mockIoProvider_{nullptr};
+  std::unique_ptr<std::thread> mockIoProviderThread_{nullptr};
+  std::shared_ptr<const Config> config_{nullptr};
+  std::unique_ptr<SparkWrapper> spark_{nullptr};
+
+  int peerFd_{-1};
+  apache::thrift::CompactSerializer serializer_;
+
+  // latest hello of Spark under test, keyed by interface
+  std::unordered_map<uint32_t, DutHello> dutHellos_;
+  // seqNum of neighbors
+  std::unordered_map<uint32_t, int64_t> seqNums_;
+  // packets processed by Spark under test, as expected by fixture
+  int64_t numPacketsProcessed_{0};
+};
+
+/**
+ * Benchmark for neighbor-up convergence:
+ * 1. Track #numIfaces interfaces on Spark under test
+ * 2. Bring up #numNeighbors neighbors at once, until all are reported up
+ */
+static void
+BM_SparkNeighborUp(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numIfaces,
+    uint32_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::chrono::microseconds cpuTime{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    auto fixture =
+        std::make_unique<SparkBenchmarkFixture>(numIfaces, numNeighbors);
+    const auto startCpuTime = fixture->getSparkCpuTime();
+
+    suspender.dismiss();
+    fixture->establishNeighbors();
+    suspender.rehire();
+
+    cpuTime += fixture->getSparkCpuTime() - startCpuTime;
+  }
+  counters["cpu_us_per_neighbor_up"] =
+      cpuTime.count() / (static_cast<uint64_t>(iters) * numNeighbors);
+}
+
+/**
+ * Benchmark for hello processing with all neighbors ESTABLISHED:
+ * 1. Bring up #numNeighbors neighbors over #numIfaces interfaces
+ * 2. Every neighbor sends one hello, until all are processed
+ */
+static void
+BM_SparkHelloProcessing(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numIfaces,
+    uint32_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fixture =
+      std::make_unique<SparkBenchmarkFixture>(numIfaces, numNeighbors);
+  fixture->establishNeighbors();
+  fixture->resetNumPacketsProcessed();
+  const auto startCpuTime = fixture->getSparkCpuTime();
+
+  std::chrono::steady_clock::duration elapsed{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss();
+    const auto startTime = std::chrono::steady_clock::now();
+    fixture->sendHellos();
+    fixture->waitForPacketsProcessed(numNeighbors);
+    elapsed += std::chrono::steady_clock::now() - startTime;
+    suspender.rehire();
+  }
+
+  const uint64_t numHellos = static_cast<uint64_t>(iters) * numNeighbors;
+  counters["cpu_us_per_hello"] =
+      (fixture->getSparkCpuTime() - startCpuTime).count() / numHellos;
+  counters["hellos_per_sec"] = numHellos /
+      std::max(std::chrono::duration<double>(elapsed).count(), 1e-6);
+}
+
+/**
+ * Benchmark for heartbeat processing with all neighbors ESTABLISHED:
+ * 1. Bring up #numNeighbors neighbors over #numIfaces interfaces
+ * 2. Every neighbor sends one heartbeat, until all are processed
+ */
+static void
+BM_SparkHeartbeatProcessing(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numIfaces,
+    uint32_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fixture =
+      std::make_unique<SparkBenchmarkFixture>(numIfaces, numNeighbors);
+  fixture->establishNeighbors();
+  fixture->resetNumPacketsProcessed();
+  const auto startCpuTime = fixture->getSparkCpuTime();
+
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss();
+    fixture->sendHeartbeats();
+    fixture->waitForPacketsProcessed(numNeighbors);
+    suspender.rehire();
+  }
+
+  counters["cpu_ns_per_heartbeat"] =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          fixture->getSparkCpuTime() - startCpuTime)
+          .count() /
+      (static_cast<uint64_t>(iters) * numNeighbors);
+}
+
+// The first integer parameter is number of interfaces
+// The second integer parameter is number of neighbors
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkNeighborUp, counters, 100_1000, 100, 1000);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkNeighborUp, counters, 500_5000, 500, 5000);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkNeighborUp, counters, 500_10000, 500, 10000);
+
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkHelloProcessing, counters, 100_1000, 100, 1000);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkHelloProcessing, counters, 500_5000, 500, 5000);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkHelloProcessing, counters, 500_10000, 500, 10000);
+
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkHeartbeatProcessing, counters, 100_1000, 100, 1000);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkHeartbeatProcessing, counters, 500_5000, 500, 5000);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SparkHeartbeatProcessing, counters, 500_10000, 500, 10000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
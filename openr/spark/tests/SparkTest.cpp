@@ -10,12 +10,14 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <linux/net_tstamp.h>
 #include <sodium.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <fb303/ServiceData.h>
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/StatCounter.h>
 #include <openr/common/Util.h>
 #include <openr/config/Config.h>
 #include <openr/config/tests/Utils.h>
@@ -578,6 +580,41 @@ TEST_F(SimpleSparkFixture, InterfaceRemovalTest) {
   }
 }
 
+//
+// Start 2 Spark instances and wait them forming adj. Then remove/add
+// interface from one instance's perspective with delta updates
+//
+TEST_F(SimpleSparkFixture, InterfaceDeltaUpdateTest) {
+  // create Spark instances and establish connections
+  createAndConnect();
+
+  auto waitTime = std::chrono::seconds(
+      *node1->getSparkConfig().graceful_restart_time_s_ref());
+
+  // delta without changes doesn't affect tracked interfaces
+  InterfaceDatabaseUpdate update;
+  update.isFullSync = false;
+  node1->sendInterfaceUpdate(update);
+  EXPECT_FALSE(node1->recvNeighborEvent(waitTime).has_value());
+
+  // delta removing interface
+  update.removedIfNames = {iface1};
+  node1->sendInterfaceUpdate(update);
+  EXPECT_TRUE(node1->waitForEvent(NB_DOWN).has_value());
+  LOG(INFO) << "node-1 reported down adjacency to node-2";
+
+  // delta adding interface back
+  update.removedIfNames.clear();
+  update.interfaces = {InterfaceInfo(
+      iface1 /* ifName */,
+      true /* isUp */,
+      ifIndex1 /* ifIndex */,
+      {ip1V4, ip1V6} /* networks */)};
+  node1->sendInterfaceUpdate(update);
+  EXPECT_TRUE(node1->waitForEvent(NB_UP).has_value());
+  LOG(INFO) << "node-1 reported up adjacency to node-2";
+}
+
 //
 // Start 2 Spark instances for different versions but within supported
 // range. Make sure they will form adjacency. Then add node3 with out-of-range
@@ -1217,6 +1254,258 @@ TEST_F(SparkFixture, LoopedHelloPktTest) {
   }
 }
 
+//
+// Start 1 Spark instance with no neighbor. Its hello packets, serialized once
+// and patched afterwards, must decode with increasing seqNum and sentTsInUs
+// and unchanged other fields.
+//
+TEST_F(SparkFixture, HelloPacketPatchTest) {
+  // Define interface names for the test
+  mockIoProvider_->addIfNameIfIndex({{iface1, ifIndex1}, {iface2, ifIndex2}});
+  mockIoProvider_->setConnectedPairs({{iface1, {{iface2, 0}}}});
+
+  // capture packets sent to iface2
+  const int fd = mockIoProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  struct ipv6_mreq mreq;
+  mreq.ipv6mr_interface = ifIndex2;
+  ASSERT_EQ(
+      0,
+      mockIoProvider_->setsockopt(
+          fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)));
+
+  StatCounter::flushAll();
+  const auto patchedBefore =
+      fb303::fbData->getCounters()["spark.hello.packet_patched.sum"];
+
+  auto tConfig1 = getBasicOpenrConfig("node-1", kDomainName);
+  auto config1 = std::make_shared<Config>(tConfig1);
+  auto node1 = createSpark("node-1", config1);
+  node1->updateInterfaceDb({InterfaceInfo(
+      iface1 /* ifName */,
+      true /* isUp */,
+      ifIndex1 /* ifIndex */,
+      {ip1V4, ip1V6} /* networks */)});
+
+  // collect hello packets sent under fast-init
+  CompactSerializer serializer;
+  std::vector<thrift::SparkHelloMsg> hellos;
+  const int len{1280};
+  std::vector<unsigned char> buf(len * 8);
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (hellos.size() < 4 and std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::vector<IoProvider::ReceivedMessage> messages;
+    try {
+      messages = IoProvider::recvMessages(
+          fd, buf.data(), len, 8, mockIoProvider_.get());
+    } catch (std::invalid_argument const&) {
+      continue; // nothing sent to iface2 yet
+    }
+    for (size_t i = 0; i < messages.size(); ++i) {
+      const std::string packet(
+          reinterpret_cast<char*>(buf.data() + i * len),
+          std::get<0>(messages[i]));
+      auto pkt =
+          readThriftObjStr<thrift::SparkHelloPacket>(packet, serializer);
+      ASSERT_TRUE(pkt.helloMsg_ref().has_value());
+      hellos.emplace_back(std::move(pkt.helloMsg_ref().value()));
+    }
+  }
+
+  ASSERT_LE(4, hellos.size());
+  for (size_t i = 0; i < hellos.size(); ++i) {
+    auto const& hello = hellos[i];
+    EXPECT_EQ(kDomainName, *hello.domainName_ref());
+    EXPECT_EQ("node-1", *hello.nodeName_ref());
+    EXPECT_EQ(iface1, *hello.ifName_ref());
+    EXPECT_TRUE(hello.neighborInfos_ref()->empty());
+    EXPECT_EQ(Constants::kOpenrVersion, *hello.version_ref());
+    EXPECT_FALSE(*hello.restarting_ref());
+    if (i > 0) {
+      EXPECT_LT(*hellos[i - 1].seqNum_ref(), *hello.seqNum_ref());
+      EXPECT_LE(*hellos[i - 1].sentTsInUs_ref(), *hello.sentTsInUs_ref());
+    }
+  }
+
+  // hello packets are serialized again only for first packet and when
+  // leaving fast-init
+  StatCounter::flushAll();
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_LE(2, counters["spark.hello.packet_patched.sum"] - patchedBefore);
+}
+
+//
+// Start 2 Spark instances with fast detection enabled and wait them forming
+// adj. Then remove the underlying connection and make sure both nodes report
+// neighbor down well before heartbeat hold time expires.
+//
+TEST_F(SparkFixture, FastDetectionTest) {
+  // Define interface names for the test
+  mockIoProvider_->addIfNameIfIndex({{iface1, ifIndex1}, {iface2, ifIndex2}});
+
+  // connect interfaces directly
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface2, 1}}},
+      {iface2, {{iface1, 1}}},
+  };
+  mockIoProvider_->setConnectedPairs(connectedPairs);
+
+  thrift::SparkFastDetectionConfig fastDetectionConfig;
+  fastDetectionConfig.tx_interval_ms_ref() = 20;
+  fastDetectionConfig.detect_multiplier_ref() = 5;
+
+  auto tConfig1 = getBasicOpenrConfig("node-1", kDomainName);
+  tConfig1.spark_config_ref()->fast_detection_config_ref() =
+      fastDetectionConfig;
+  auto config1 = std::make_shared<Config>(tConfig1);
+
+  auto tConfig2 = getBasicOpenrConfig("node-2", kDomainName);
+  tConfig2.spark_config_ref()->fast_detection_config_ref() =
+      fastDetectionConfig;
+  auto config2 = std::make_shared<Config>(tConfig2);
+
+  const auto downBefore =
+      fb303::fbData->getCounters()["spark.fast_detection.neighbor_down.sum"];
+
+  auto node1 = createSpark("node-1", config1);
+  auto node2 = createSpark("node-2", config2);
+
+  node1->updateInterfaceDb({InterfaceInfo(
+      iface1 /* ifName */,
+      true /* isUp */,
+      ifIndex1 /* ifIndex */,
+      {ip1V4, ip1V6} /* networks */)});
+  node2->updateInterfaceDb({InterfaceInfo(
+      iface2 /* ifName */,
+      true /* isUp */,
+      ifIndex2 /* ifIndex */,
+      {ip2V4, ip2V6} /* networks */)});
+
+  EXPECT_TRUE(node1->waitForEvent(NB_UP).has_value());
+  EXPECT_TRUE(node2->waitForEvent(NB_UP).has_value());
+
+  // let fast detection sessions arm on both sides
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // record time for future comparison
+  auto startTime = std::chrono::steady_clock::now();
+
+  // remove underneath connections between to nodes
+  mockIoProvider_->setConnectedPairs({});
+
+  {
+    LOG(INFO) << "Waiting for both nodes to time out with each other";
+
+    EXPECT_TRUE(node1->waitForEvent(NB_DOWN).has_value());
+    EXPECT_TRUE(node2->waitForEvent(NB_DOWN).has_value());
+
+    // neighbor down must be signaled by fast detection, not hold timer
+    auto endTime = std::chrono::steady_clock::now();
+    ASSERT_TRUE(
+        endTime - startTime <
+        std::chrono::seconds(*node1->getSparkConfig().hold_time_s_ref()));
+  }
+
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_LE(2, counters["spark.fast_detection.neighbor_down.sum"] - downBefore);
+  EXPECT_EQ(1, counters.count("spark.fast_detection.jitter_us.avg"));
+  EXPECT_EQ(1, counters.count("spark.fast_detection.false_positive.sum"));
+}
+
+//
+// Start 1 Spark instance with interfaces sharded across multiple workers,
+// and 2 other instances connected to it over different interfaces. Make sure
+// adjacencies are formed over all interfaces and reported by public APIs.
+// Then remove one interface and make sure only its neighbor goes down.
+//
+TEST_F(SparkFixture, ShardedInterfacesTest) {
+  const std::string iface4{"iface4"};
+  const int ifIndex4{4};
+  const folly::CIDRNetwork ip4V4 = folly::IPAddress::createNetwork(
+      "192.168.0.4", 24, false /* apply mask */);
+  const folly::CIDRNetwork ip4V6 =
+      folly::IPAddress::createNetwork("fe80::4/128");
+
+  // Define interface names for the test
+  mockIoProvider_->addIfNameIfIndex(
+      {{iface1, ifIndex1},
+       {iface2, ifIndex2},
+       {iface3, ifIndex3},
+       {iface4, ifIndex4}});
+
+  // node-1 (iface1) <-> node-2 (iface2), node-1 (iface3) <-> node-3 (iface4)
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface2, 10}}},
+      {iface2, {{iface1, 10}}},
+      {iface3, {{iface4, 10}}},
+      {iface4, {{iface3, 10}}},
+  };
+  mockIoProvider_->setConnectedPairs(connectedPairs);
+
+  auto tConfig1 = getBasicOpenrConfig("node-1", kDomainName);
+  tConfig1.spark_config_ref()->num_workers_ref() = 3;
+  auto config1 = std::make_shared<Config>(tConfig1);
+  auto config2 =
+      std::make_shared<Config>(getBasicOpenrConfig("node-2", kDomainName));
+  auto config3 =
+      std::make_shared<Config>(getBasicOpenrConfig("node-3", kDomainName));
+
+  auto node1 = createSpark("node-1", config1);
+  auto node2 = createSpark("node-2", config2);
+  auto node3 = createSpark("node-3", config3);
+
+  const auto if1 = InterfaceInfo(
+      iface1 /* ifName */,
+      true /* isUp */,
+      ifIndex1 /* ifIndex */,
+      {ip1V4, ip1V6} /* networks */);
+  const auto if3 = InterfaceInfo(
+      iface3 /* ifName */,
+      true /* isUp */,
+      ifIndex3 /* ifIndex */,
+      {ip3V4, ip3V6} /* networks */);
+  node1->updateInterfaceDb({if1, if3});
+  node2->updateInterfaceDb({InterfaceInfo(
+      iface2 /* ifName */,
+      true /* isUp */,
+      ifIndex2 /* ifIndex */,
+      {ip2V4, ip2V6} /* networks */)});
+  node3->updateInterfaceDb({InterfaceInfo(
+      iface4 /* ifName */,
+      true /* isUp */,
+      ifIndex4 /* ifIndex */,
+      {ip4V4, ip4V6} /* networks */)});
+
+  // node-1 must report adjacency with both neighbors
+  {
+    std::set<std::string> neighbors;
+    for (int i = 0; i < 2; ++i) {
+      auto event = node1->waitForEvent(NB_UP);
+      ASSERT_TRUE(event.has_value());
+      neighbors.emplace(*event->info.nodeName_ref());
+    }
+    EXPECT_EQ(std::set<std::string>({"node-2", "node-3"}), neighbors);
+    EXPECT_TRUE(node2->waitForEvent(NB_UP).has_value());
+    EXPECT_TRUE(node3->waitForEvent(NB_UP).has_value());
+  }
+
+  EXPECT_EQ(ESTABLISHED, node1->getSparkNeighState(iface1, "node-2"));
+  EXPECT_EQ(ESTABLISHED, node1->getSparkNeighState(iface3, "node-3"));
+  EXPECT_EQ(2, node1->get()->getNeighbors().get()->size());
+
+  // remove iface3 from node-1, only adjacency with node-3 goes down
+  node1->updateInterfaceDb({if1});
+  {
+    auto event = node1->waitForEvent(NB_DOWN);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ("node-3", *event->info.nodeName_ref());
+    EXPECT_EQ(iface3, *event->info.localIfName_ref());
+  }
+  EXPECT_EQ(ESTABLISHED, node1->getSparkNeighState(iface1, "node-2"));
+  EXPECT_EQ(1, node1->get()->getNeighbors().get()->size());
+}
+
 //
 // Start 2 Spark instances within different v4 subnet. Then
 // make sure they can't form adj as NEGOTIATION failed. Bring
@@ -1836,6 +2125,120 @@ TEST_F(SparkFixture, MultiplePeersWithDiffAreaOverSameLink) {
   }
 }
 
+//
+// Send and receive batches of packets with sendMessages(...) and
+// recvMessages(...), in order and with their ancillary data
+//
+TEST(IoProviderTest, BatchSendRecv) {
+  auto ioProvider = std::make_shared<MockIoProvider>();
+  ioProvider->addIfNameIfIndex({{iface1, ifIndex1}, {iface2, ifIndex2}});
+  ioProvider->setConnectedPairs({{iface1, {{iface2, 0}}}});
+
+  auto joinIface = [&](int ifIndex) {
+    int fd = ioProvider->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    struct ipv6_mreq mreq;
+    mreq.ipv6mr_interface = ifIndex;
+    EXPECT_EQ(
+        0,
+        ioProvider->setsockopt(
+            fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)));
+    return fd;
+  };
+  const int fd1 = joinIface(ifIndex1);
+  const int fd2 = joinIface(ifIndex2);
+
+  const size_t numPackets{5};
+  std::vector<IoProvider::SendRequest> requests;
+  for (size_t i = 0; i < numPackets; ++i) {
+    requests.push_back(
+        {ifIndex1,
+         ip1V6.first.asV6(),
+         folly::SocketAddress(Constants::kSparkMcastAddr.str(), 6666),
+         "packet-" + std::to_string(i)});
+  }
+  auto bytesSent = IoProvider::sendMessages(fd1, requests, ioProvider.get());
+  ASSERT_EQ(numPackets, bytesSent.size());
+  for (size_t i = 0; i < numPackets; ++i) {
+    EXPECT_EQ(requests[i].packet.size(), size_t(bytesSent[i]));
+  }
+
+  // wait for delivery time of packets to pass
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  const int len{1280};
+  std::vector<unsigned char> buf(len * 8);
+  auto messages =
+      IoProvider::recvMessages(fd2, buf.data(), len, 8, ioProvider.get());
+  ASSERT_EQ(numPackets, messages.size());
+  for (size_t i = 0; i < numPackets; ++i) {
+    auto const& [size, ifIndex, srcAddr, hopLimit, recvTime] = messages[i];
+    ASSERT_EQ(requests[i].packet.size(), size_t(size));
+    EXPECT_EQ(
+        requests[i].packet,
+        std::string(reinterpret_cast<char*>(buf.data() + i * len), size));
+    EXPECT_EQ(ifIndex2, ifIndex);
+    EXPECT_EQ(ip1V6.first, srcAddr.getIPAddress());
+    EXPECT_EQ(255, hopLimit);
+  }
+
+  // nothing left to receive
+  EXPECT_TRUE(
+      IoProvider::recvMessages(fd2, buf.data(), len, 8, ioProvider.get())
+          .empty());
+}
+
+TEST(IoProviderTest, TxTimestamps) {
+  auto ioProvider = std::make_shared<MockIoProvider>();
+  ioProvider->addIfNameIfIndex({{iface1, ifIndex1}, {iface2, ifIndex2}});
+  ioProvider->setConnectedPairs({{iface1, {{iface2, 0}}}});
+
+  int fd = ioProvider->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  struct ipv6_mreq mreq;
+  mreq.ipv6mr_interface = ifIndex1;
+  EXPECT_EQ(
+      0,
+      ioProvider->setsockopt(
+          fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)));
+
+  // no TX timestamps without SO_TIMESTAMPING
+  const IoProvider::SendRequest request{
+      ifIndex1,
+      ip1V6.first.asV6(),
+      folly::SocketAddress(Constants::kSparkMcastAddr.str(), 6666),
+      "packet"};
+  ASSERT_EQ(
+      request.packet.size(),
+      size_t(IoProvider::sendMessages(fd, {request}, ioProvider.get())[0]));
+  EXPECT_TRUE(IoProvider::recvTxTimestamps(fd, ioProvider.get()).empty());
+
+  int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+      SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+  EXPECT_EQ(
+      0,
+      ioProvider->setsockopt(
+          fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)));
+
+  const size_t numPackets{5};
+  const auto sentTs = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+  auto bytesSent = IoProvider::sendMessages(
+      fd,
+      std::vector<IoProvider::SendRequest>(numPackets, request),
+      ioProvider.get());
+  ASSERT_EQ(numPackets, bytesSent.size());
+
+  // packets are identified by their sequence on the socket
+  auto txTimestamps = IoProvider::recvTxTimestamps(fd, ioProvider.get());
+  ASSERT_EQ(numPackets, txTimestamps.size());
+  for (size_t i = 0; i < numPackets; ++i) {
+    EXPECT_EQ(i, txTimestamps[i].first);
+    EXPECT_LE(sentTs, txTimestamps[i].second);
+  }
+
+  // error queue is drained
+  EXPECT_TRUE(IoProvider::recvTxTimestamps(fd, ioProvider.get()).empty());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -215,7 +215,8 @@ OpenrWrapper<Serializer>::OpenrWrapper(
       true, // enableBgpRouteProgramming
       kvStoreUpdatesQueue_.getReader(),
       staticRoutesQueue_.getReader(),
-      routeUpdatesQueue_);
+      routeUpdatesQueue_,
+      configStore_.get());
 
   //
   // create FIB
@@ -227,7 +228,8 @@ OpenrWrapper<Serializer>::OpenrWrapper(
       routeUpdatesQueue_.getReader(),
       staticRoutesQueue_.getReader(),
       fibUpdatesQueue_,
-      logSampleQueue_);
+      logSampleQueue_,
+      configStore_.get());
 
   //
   // create PrefixAllocator
@@ -457,7 +459,7 @@ OpenrWrapper<Serializer>::checkKeyExists(std::string key) {
 template <class Serializer>
 void
 OpenrWrapper<Serializer>::updateInterfaceDb(const InterfaceDatabase& ifDb) {
-  interfaceUpdatesQueue_.push(ifDb);
+  interfaceUpdatesQueue_.push(InterfaceDatabaseUpdate(ifDb));
 }
 
 template <class Serializer>
@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include <fb303/ServiceData.h>
+#include <fbzmq/zmq/Zmq.h>
+#include <fmt/format.h>
+#include <folly/Benchmark.h>
+#include <folly/Synchronized.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/StatCounter.h>
+#include <openr/common/Util.h>
+#include <openr/config/Config.h>
+#include <openr/config/tests/Utils.h>
+#include <openr/decision/Decision.h>
+#include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/monitor/SystemMetrics.h>
+
+namespace openr {
+
+namespace {
+
+// periodic KvStore full syncs are kept out of the measurements
+const std::chrono::seconds kDbSyncInterval(3600);
+
+// interval of convergence checks
+const std::chrono::milliseconds kPollInterval(1);
+
+// time left for floods to settle after routes converged, before reading
+// flooding counters
+const std::chrono::milliseconds kFloodSettleTime(200);
+
+// give up on convergence after that long
+const std::chrono::seconds kConvergenceTimeout(300);
+
+// CPU time used by the process, all threads
+std::chrono::microseconds
+getCpuTime() {
+  struct rusage usage {};
+  ::getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+      std::chrono::microseconds(
+          usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+// key-values merged by all KvStores of the process, local and flooded ones
+int64_t
+getMergedKeyVals() {
+  StatCounter::flushAll();
+  auto counters = facebook::fb303::fbData->getCounters();
+  auto it = counters.find("kvstore.received_key_vals.sum");
+  return it != counters.end() ? it->second : 0;
+}
+
+/**
+ * Lightweight in-process Open/R instance: KvStore, peering with other
+ * instances over its thrift server, and Decision fed by KvStore. Fib is left
+ * out, routes computed by Decision are kept in a local RIB of next-hop
+ * nodes. Adjacencies and prefixes are set into KvStore the way LinkMonitor
+ * and PrefixManager would, so no IO or netlink is involved.
+ */
+class SystemNode {
+ public:
+  SystemNode(fbzmq::Context& context, std::string const& nodeName)
+      : nodeName_(nodeName) {
+    auto tConfig = getBasicOpenrConfig(nodeName_);
+    tConfig.kvstore_config_ref()->sync_interval_s_ref() =
+        kDbSyncInterval.count();
+    tConfig.decision_config_ref()->debounce_min_ms_ref() = 10;
+    tConfig.decision_config_ref()->debounce_max_ms_ref() = 250;
+    config_ = std::make_shared<Config>(tConfig);
+
+    kvStore_ = std::make_unique<KvStoreWrapper>(context, config_);
+    kvStore_->run();
+
+    decision_ = std::make_unique<Decision>(
+        config_,
+        false, /* enableBgpRouteProgramming */
+        kvStore_->getReader(),
+        staticRoutesQueue_.getReader(),
+        routeUpdatesQueue_);
+    decisionThread_ = std::thread([this]() { decision_->run(); });
+    decision_->waitUntilRunning();
+
+    ribThread_ = std::thread([this]() {
+      while (true) {
+        auto maybeUpdate = routeUpdatesReader_.get();
+        if (maybeUpdate.hasError()) {
+          break;
+        }
+        applyRouteUpdate(*maybeUpdate);
+      }
+    });
+  }
+
+  ~SystemNode() {
+    kvStore_->closeQueue();
+    staticRoutesQueue_.close();
+    decision_->stop();
+    decisionThread_.join();
+    routeUpdatesQueue_.close();
+    ribThread_.join();
+    kvStore_->stop();
+  }
+
+  std::string const&
+  getNodeName() const {
+    return nodeName_;
+  }
+
+  void
+  addPeer(SystemNode& peer) {
+    kvStore_->addPeer(
+        kTestingAreaName, peer.getNodeName(), peer.kvStore_->getPeerSpec());
+  }
+
+  void
+  delPeer(SystemNode const& peer) {
+    kvStore_->delPeer(kTestingAreaName, peer.getNodeName());
+  }
+
+  // advertise adjacency database towards neighbors, as LinkMonitor does
+  void
+  setNeighbors(
+      std::set<std::string> const& neighbors,
+      std::unordered_map<std::string, size_t> const& nodeIndexes) {
+    std::vector<thrift::Adjacency> adjs;
+    for (auto const& neighbor : neighbors) {
+      const auto index = nodeIndexes.at(neighbor);
+      adjs.emplace_back(createAdjacency(
+          neighbor,
+          fmt::format("{}/{}", nodeName_, neighbor),
+          fmt::format("{}/{}", neighbor, nodeName_),
+          fmt::format("fe80::{:x}", index + 1),
+          fmt::format(
+              "10.{}.{}.{}", index >> 16, (index >> 8) & 0xff, index & 0xff),
+          1 /* metric */,
+          0 /* adjLabel */));
+    }
+    kvStore_->setKey(
+        kTestingAreaName,
+        fmt::format("{}{}", Constants::kAdjDbMarker.toString(), nodeName_),
+        createThriftValue(
+            ++adjDbVersion_,
+            nodeName_,
+            writeThriftObjStr(createAdjDb(nodeName_, adjs, 0), serializer_)));
+  }
+
+  void
+  advertisePrefix(thrift::IpPrefix const& prefix) {
+    auto [key, value] = createPrefixKeyValue(nodeName_, 1, prefix);
+    kvStore_->setKey(kTestingAreaName, key, value);
+  }
+
+  // next-hop nodes of the route to prefix, empty if there is none
+  std::set<std::string>
+  getNextHopNodes(folly::CIDRNetwork const& prefix) const {
+    auto rib = rib_.rlock();
+    auto it = rib->find(prefix);
+    return it != rib->end() ? it->second : std::set<std::string>{};
+  }
+
+ private:
+  void
+  applyRouteUpdate(DecisionRouteUpdate const& update) {
+    auto rib = rib_.wlock();
+    if (update.type == DecisionRouteUpdate::FULL_SYNC) {
+      rib->clear();
+    }
+    for (auto const& [prefix, route] : update.unicastRoutesToUpdate) {
+      auto& nextHopNodes = (*rib)[prefix];
+      nextHopNodes.clear();
+      for (auto const& nextHop : route.nexthops) {
+        nextHopNodes.emplace(nextHop.neighborNodeName_ref().value_or(""));
+      }
+    }
+    for (auto const& prefix : update.unicastRoutesToDelete) {
+      rib->erase(prefix);
+    }
+  }
+
+  const std::string nodeName_;
+  apache::thrift::CompactSerializer serializer_;
+  int64_t adjDbVersion_{0};
+
+  std::shared_ptr<Config> config_;
+  std::unique_ptr<KvStoreWrapper> kvStore_;
+  std::unique_ptr<Decision> decision_;
+  std::thread decisionThread_;
+
+  messaging::ReplicateQueue<DecisionRouteUpdate> staticRoutesQueue_;
+  messaging::ReplicateQueue<DecisionRouteUpdate> routeUpdatesQueue_;
+  // created along with the queue, so that no route update is missed
+  messaging::RQueue<DecisionRouteUpdate> routeUpdatesReader_{
+      routeUpdatesQueue_.getReader()};
+  std::thread ribThread_;
+
+  // prefix -> next-hop nodes
+  folly::Synchronized<
+      std::unordered_map<folly::CIDRNetwork, std::set<std::string>>>
+      rib_;
+};
+
+/**
+ * Two tier Clos fabric of SystemNodes, each leaf connected to every spine
+ * and advertising a prefix. Failures are injected by withdrawing links from
+ * the adjacency databases of their ends, and tearing down the KvStore
+ * peering running over them.
+ */
+class ClosFabric {
+ public:
+  ClosFabric(uint32_t numSpines, uint32_t numLeaves) {
+    for (uint32_t i = 0; i < numSpines; ++i) {
+      spines_.emplace_back(fmt::format("spine-{}", i));
+    }
+    for (uint32_t i = 0; i < numLeaves; ++i) {
+      leaves_.emplace_back(fmt::format("leaf-{}", i));
+      prefixes_.emplace_back(
+          toIpPrefix(fmt::format("fc00:{:x}::/64", i + 1)));
+    }
+    for (auto const* names : {&spines_, &leaves_}) {
+      for (auto const& name : *names) {
+        nodeIndexes_.emplace(name, nodes_.size());
+        nodes_.emplace(name, std::make_unique<SystemNode>(context_, name));
+      }
+    }
+
+    for (auto const& leaf : leaves_) {
+      for (auto const& spine : spines_) {
+        links_[leaf].insert(spine);
+        links_[spine].insert(leaf);
+        nodes_.at(leaf)->addPeer(*nodes_.at(spine));
+        nodes_.at(spine)->addPeer(*nodes_.at(leaf));
+      }
+    }
+    for (auto const& [name, node] : nodes_) {
+      node->setNeighbors(links_[name], nodeIndexes_);
+    }
+    for (size_t i = 0; i < leaves_.size(); ++i) {
+      nodes_.at(leaves_[i])->advertisePrefix(prefixes_[i]);
+    }
+  }
+
+  size_t
+  size() const {
+    return nodes_.size();
+  }
+
+  std::string const&
+  spine(size_t index) const {
+    return spines_.at(index);
+  }
+
+  std::string const&
+  leaf(size_t index) const {
+    return leaves_.at(index);
+  }
+
+  // adjacency databases updated by the last failure or repair
+  size_t
+  getNumUpdatedAdjDbs() const {
+    return numUpdatedAdjDbs_;
+  }
+
+  void
+  linkDown(std::string const& a, std::string const& b) {
+    removeLink(a, b);
+    advertise({a, b});
+  }
+
+  void
+  linkUp(std::string const& a, std::string const& b) {
+    addLink(a, b);
+    advertise({a, b});
+  }
+
+  // node goes away, its neighbors withdraw their links towards it. Its own
+  // adjacency database is stale but left in KvStore
+  void
+  nodeDown(std::string const& name) {
+    auto neighbors = links_[name];
+    for (auto const& neighbor : neighbors) {
+      removeLink(name, neighbor);
+      failedLinks_[name].insert(neighbor);
+    }
+    advertise(neighbors);
+  }
+
+  void
+  nodeUp(std::string const& name) {
+    auto neighbors = std::move(failedLinks_[name]);
+    failedLinks_.erase(name);
+    for (auto const& neighbor : neighbors) {
+      addLink(name, neighbor);
+    }
+    neighbors.insert(name);
+    advertise(neighbors);
+  }
+
+  // wait until every leaf routes the prefix of every other leaf via all the
+  // spines they share. Returns the time it took
+  std::chrono::milliseconds
+  waitForConvergence() const {
+    const auto startTime = std::chrono::steady_clock::now();
+    while (not isConverged()) {
+      if (std::chrono::steady_clock::now() - startTime > kConvergenceTimeout) {
+        throw std::runtime_error("Clos fabric didn't converge");
+      }
+      std::this_thread::sleep_for(kPollInterval);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime);
+  }
+
+ private:
+  void
+  addLink(std::string const& a, std::string const& b) {
+    links_[a].insert(b);
+    links_[b].insert(a);
+    nodes_.at(a)->addPeer(*nodes_.at(b));
+    nodes_.at(b)->addPeer(*nodes_.at(a));
+  }
+
+  void
+  removeLink(std::string const& a, std::string const& b) {
+    links_[a].erase(b);
+    links_[b].erase(a);
+    nodes_.at(a)->delPeer(*nodes_.at(b));
+    nodes_.at(b)->delPeer(*nodes_.at(a));
+  }
+
+  void
+  advertise(std::set<std::string> const& names) {
+    for (auto const& name : names) {
+      nodes_.at(name)->setNeighbors(links_[name], nodeIndexes_);
+    }
+    numUpdatedAdjDbs_ = names.size();
+  }
+
+  bool
+  isConverged() const {
+    for (auto const& leaf : leaves_) {
+      auto const& node = *nodes_.at(leaf);
+      auto const& leafLinks = links_.at(leaf);
+      for (size_t i = 0; i < leaves_.size(); ++i) {
+        if (leaves_[i] == leaf) {
+          continue;
+        }
+        std::set<std::string> expected;
+        for (auto const& spine : links_.at(leaves_[i])) {
+          if (leafLinks.count(spine)) {
+            expected.insert(spine);
+          }
+        }
+        if (node.getNextHopNodes(toIPNetwork(prefixes_[i])) != expected) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  fbzmq::Context context_;
+  std::vector<std::string> spines_;
+  std::vector<std::string> leaves_;
+  // prefix advertised by each leaf
+  std::vector<thrift::IpPrefix> prefixes_;
+  std::unordered_map<std::string, size_t> nodeIndexes_;
+  std::map<std::string, std::unique_ptr<SystemNode>> nodes_;
+
+  // node -> neighbors it is linked to
+  std::unordered_map<std::string, std::set<std::string>> links_;
+  // node -> links withdrawn by nodeDown()
+  std::unordered_map<std::string, std::set<std::string>> failedLinks_;
+  size_t numUpdatedAdjDbs_{0};
+};
+
+/**
+ * Bring a Clos fabric up, then repeatedly inject a failure and measure the
+ * time until all leaves have converged. Reports
+ * - initial_convergence_ms: from start of all nodes to converged routes
+ * - rss_kb_per_node: process memory once converged, over the nodes
+ * - convergence_ms: average time to converge after the failure
+ * - cpu_us_per_node: CPU time spent by the process per failure, over the
+ *   nodes
+ * - flood_amplification_pct: key-values merged by all KvStores per failure,
+ *   relative to one merge of each updated adjacency database on every node
+ */
+void
+runClosFailureBenchmark(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numSpines,
+    uint32_t numLeaves,
+    std::function<void(ClosFabric&)> const& fail,
+    std::function<void(ClosFabric&)> const& repair) {
+  auto suspender = folly::BenchmarkSuspender();
+  SystemMetrics systemMetrics;
+  const auto rssBefore = systemMetrics.getRSSMemBytes().value_or(0);
+
+  const auto startTime = std::chrono::steady_clock::now();
+  ClosFabric fabric(numSpines, numLeaves);
+  fabric.waitForConvergence();
+  const auto initialConvergence =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime);
+  const auto rssAfter = systemMetrics.getRSSMemBytes().value_or(0);
+
+  std::chrono::milliseconds convergence{0};
+  std::chrono::microseconds cpuTime{0};
+  int64_t mergedKeyVals{0};
+  int64_t expectedKeyVals{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    std::this_thread::sleep_for(kFloodSettleTime);
+    const auto startKeyVals = getMergedKeyVals();
+    const auto startCpuTime = getCpuTime();
+
+    suspender.dismiss(); // Start measuring benchmark time
+    fail(fabric);
+    convergence += fabric.waitForConvergence();
+    suspender.rehire(); // Stop measuring time again
+
+    std::this_thread::sleep_for(kFloodSettleTime);
+    cpuTime += std::chrono::duration_cast<std::chrono::microseconds>(
+        getCpuTime() - startCpuTime);
+    mergedKeyVals += getMergedKeyVals() - startKeyVals;
+    expectedKeyVals += fabric.getNumUpdatedAdjDbs() * fabric.size();
+
+    repair(fabric);
+    fabric.waitForConvergence();
+  }
+
+  iters = iters == 0 ? 1 : iters;
+  counters["initial_convergence_ms"] = initialConvergence.count();
+  counters["rss_kb_per_node"] =
+      rssAfter > rssBefore ? (rssAfter - rssBefore) / 1024 / fabric.size() : 0;
+  counters["convergence_ms"] = convergence.count() / iters;
+  counters["cpu_us_per_node"] = cpuTime.count() / iters / fabric.size();
+  counters["flood_amplification_pct"] =
+      expectedKeyVals ? mergedKeyVals * 100 / expectedKeyVals : 0;
+}
+
+} // namespace
+
+/**
+ * BM_SystemClosLinkFailure:
+ * link between the first leaf and the first spine goes down
+ */
+void
+BM_SystemClosLinkFailure(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numSpines,
+    uint32_t numLeaves) {
+  runClosFailureBenchmark(
+      counters,
+      iters,
+      numSpines,
+      numLeaves,
+      [](ClosFabric& fabric) {
+        fabric.linkDown(fabric.leaf(0), fabric.spine(0));
+      },
+      [](ClosFabric& fabric) {
+        fabric.linkUp(fabric.leaf(0), fabric.spine(0));
+      });
+}
+
+/**
+ * BM_SystemClosNodeFailure:
+ * first spine goes down, all leaves withdraw their link towards it
+ */
+void
+BM_SystemClosNodeFailure(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numSpines,
+    uint32_t numLeaves) {
+  runClosFailureBenchmark(
+      counters,
+      iters,
+      numSpines,
+      numLeaves,
+      [](ClosFabric& fabric) { fabric.nodeDown(fabric.spine(0)); },
+      [](ClosFabric& fabric) { fabric.nodeUp(fabric.spine(0)); });
+}
+
+// The first integer parameter is number of spines
+// The second integer parameter is number of leaves
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_SystemClosLinkFailure, counters, 4_96, 4, 96);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SystemClosLinkFailure, counters, 8_192, 8, 192);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SystemClosLinkFailure, counters, 16_484, 16, 484);
+
+BENCHMARK_COUNTERS_NAMED_PARAM(BM_SystemClosNodeFailure, counters, 4_96, 4, 96);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SystemClosNodeFailure, counters, 8_192, 8, 192);
+BENCHMARK_COUNTERS_NAMED_PARAM(
+    BM_SystemClosNodeFailure, counters, 16_484, 16, 484);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
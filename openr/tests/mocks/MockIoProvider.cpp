@@ -6,6 +6,8 @@
  */
 
 #include <glog/logging.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <chrono>
 
 #include <folly/Exception.h>
@@ -58,16 +60,19 @@ MockIoProvider::fcntl(int sockFd, int /* cmd */, int /* arg */) {
 
 int
 MockIoProvider::bind(
-    int sockFd, const struct sockaddr* /* my_addr */, socklen_t /* addrlen */) {
+    int sockFd, const struct sockaddr* my_addr, socklen_t /* addrlen */) {
   VLOG(4) << "MockIoProvider::bind called";
 
   std::lock_guard<std::mutex> lock(mutex_);
   CHECK(pipeFds_.count(sockFd));
+  folly::SocketAddress addr;
+  addr.setFromSockaddr(my_addr);
+  fdToPort_[sockFd] = addr.getPort();
   return 0;
 }
 
 ssize_t
-MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int /* flags */) {
+MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int flags) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   SCOPE_FAIL {
@@ -78,6 +83,43 @@ MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int /* flags */) {
 
   CHECK(pipeFds_.count(sockFd));
 
+  // deliver TX timestamp from error queue, with no payload
+  if (flags & MSG_ERRQUEUE) {
+    auto& errQueue = errQueues_[sockFd];
+    if (errQueue.empty()) {
+      errno = EAGAIN;
+      return -1;
+    }
+    auto const [packetId, txTs] = errQueue.front();
+    errQueue.pop_front();
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+    CHECK(cmsg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TIMESTAMPING;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct scm_timestamping));
+    struct scm_timestamping tss;
+    ::memset(&tss, 0, sizeof(tss));
+    tss.ts[0].tv_sec = txTs.count() / 1000000;
+    tss.ts[0].tv_nsec = (txTs.count() % 1000000) * 1000;
+    ::memcpy(CMSG_DATA(cmsg), &tss, sizeof(tss));
+
+    cmsg = CMSG_NXTHDR(msg, cmsg);
+    CHECK(cmsg);
+    cmsg->cmsg_level = IPPROTO_IPV6;
+    cmsg->cmsg_type = IPV6_RECVERR;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct sock_extended_err));
+    struct sock_extended_err err;
+    ::memset(&err, 0, sizeof(err));
+    err.ee_errno = ENOMSG;
+    err.ee_origin = SO_EE_ORIGIN_TIMESTAMPING;
+    err.ee_data = packetId;
+    ::memcpy(CMSG_DATA(cmsg), &err, sizeof(err));
+
+    msg->msg_flags = MSG_ERRQUEUE;
+    return 0;
+  }
+
   auto it = mailboxes_.find(sockFd);
   CHECK_THROW(it != mailboxes_.end(), std::invalid_argument);
   if (it->second.size() == 0) {
@@ -202,6 +244,15 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
 
   CHECK(srcIfIndex != -1);
 
+  uint16_t dstPort{0};
+  if (msg->msg_name and msg->msg_namelen > 0) {
+    folly::SocketAddress dstAddr;
+    dstAddr.setFromSockaddr(
+        reinterpret_cast<const struct sockaddr*>(msg->msg_name),
+        msg->msg_namelen);
+    dstPort = dstAddr.getPort();
+  }
+
   auto srcIfName = ifIndexToIfName_.at(srcIfIndex);
 
   VLOG(4) << "MockIoProvider::sendmsg sending message from iface " << srcIfName;
@@ -222,12 +273,17 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
       continue;
     }
 
-    try {
-      otherFd = ifIndexToFd_.at(dstIfIndex);
-    } catch (std::out_of_range const& err) {
+    // deliver to fd bound to destination port, or else to unbound fd
+    auto const& portToFd = ifIndexToFds_[dstIfIndex];
+    auto fdIt = portToFd.find(dstPort);
+    if (fdIt == portToFd.end()) {
+      fdIt = portToFd.find(0);
+    }
+    if (fdIt == portToFd.end()) {
       LOG(ERROR) << "No sockets bound to " << dstIfName;
       continue;
     }
+    otherFd = fdIt->second;
 
     // ATTN: In UT env, we explicitly allow pkt to send to itself to
     //       mimick case that pkt looped back to its own intf.
@@ -253,18 +309,75 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
 
   // return the length of single vector sent
   if (sent) {
+    if (fdToTsFlags_[sockFd] & SOF_TIMESTAMPING_TX_SOFTWARE) {
+      errQueues_[sockFd].emplace_back(
+          fdToTxPacketId_[sockFd]++,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::system_clock::now().time_since_epoch()));
+    }
     return msg->msg_iov->iov_len;
   }
   return -1;
 }
 
+int
+MockIoProvider::recvmmsg(
+    int sockFd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  VLOG(4) << "MockIoProvider::recvmmsg called";
+
+  unsigned int numRead = 0;
+  for (; numRead < vlen; ++numRead) {
+    if (numRead > 0) {
+      // emulate latency, don't deliver messages ahead of time
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = mailboxes_.find(sockFd);
+      if (it == mailboxes_.end() or it->second.empty() or
+          not it->second.front().isActive()) {
+        break;
+      }
+    }
+    auto bytesRead = recvmsg(sockFd, &msgvec[numRead].msg_hdr, flags);
+    if (bytesRead < 0) {
+      break;
+    }
+    msgvec[numRead].msg_len = bytesRead;
+  }
+
+  if (numRead == 0) {
+    errno = EAGAIN;
+    return -1;
+  }
+  return numRead;
+}
+
+int
+MockIoProvider::sendmmsg(
+    int sockFd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  VLOG(4) << "MockIoProvider::sendmmsg called";
+
+  unsigned int numSent = 0;
+  for (; numSent < vlen; ++numSent) {
+    auto bytesSent = sendmsg(sockFd, &msgvec[numSent].msg_hdr, flags);
+    if (bytesSent < 0) {
+      break;
+    }
+    msgvec[numSent].msg_len = bytesSent;
+  }
+
+  if (numSent == 0) {
+    errno = ENETUNREACH;
+    return -1;
+  }
+  return numSent;
+}
+
 //
 // Simply accept all setsockopts, and build fd to ifName mapping
 //
 int
 MockIoProvider::setsockopt(
     int sockFd,
-    int /* level */,
+    int level,
     int optname,
     const void* optval,
     socklen_t /* optlen */) {
@@ -284,10 +397,14 @@ MockIoProvider::setsockopt(
       errno = ERANGE;
       return -1;
     }
-    ifIndexToFd_[ifIndex] = sockFd;
+    ifIndexToFds_[ifIndex][fdToPort_[sockFd]] = sockFd;
     fdToIfName_[sockFd] = ifName;
   }
 
+  if (level == SOL_SOCKET and optname == SO_TIMESTAMPING) {
+    fdToTsFlags_[sockFd] = *static_cast<const int*>(optval);
+  }
+
   return 0;
 }
 
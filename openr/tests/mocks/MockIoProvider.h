@@ -97,6 +97,20 @@ class MockIoProvider final : public IoProvider {
 
   ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags) override;
 
+  // Emulated with recvmsg/sendmsg per message. Messages after first one are
+  // received only once their delivery time passed.
+  int recvmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
+  int sendmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
   int setsockopt(
       int sockfd,
       int level,
@@ -130,9 +144,21 @@ class MockIoProvider final : public IoProvider {
 
   std::map<std::string /* ifName */, int /* ifIndex */> ifNameToIfIndex_{};
 
-  // maps the fds that have joined the interface: we can have same fd
-  // joining on multiple interfaces
-  std::map<int /* ifIndex */, int /* fd */> ifIndexToFd_{};
+  // port each fd is bound to. Unbound fds receive packets sent to any port
+  std::map<int /* fd */, uint16_t /* port */> fdToPort_{};
+
+  // maps the fds that have joined the interface by their port: we can have
+  // same fd joining on multiple interfaces
+  std::map<int /* ifIndex */, std::map<uint16_t /* port */, int /* fd */>>
+      ifIndexToFds_{};
+
+  // SO_TIMESTAMPING flags set per fd
+  std::map<int /* fd */, int /* flags */> fdToTsFlags_{};
+
+  // TX timestamps pending on error queue of fds and their next packet id,
+  // emulating SOF_TIMESTAMPING_TX_SOFTWARE with OPT_ID and OPT_TSONLY
+  std::map<int /* fd */, std::list<IoProvider::TxTimestamp>> errQueues_{};
+  std::map<int /* fd */, uint32_t /* packet id */> fdToTxPacketId_{};
 
   struct IoMessage {
     IoMessage(
@@ -88,6 +88,11 @@ MockNetlinkFibHandler::addUnicastRoutes(
       unicastRouteDb_.emplace(prefix, newNextHops);
     }
   }
+  SYNCHRONIZED(addedUnicastPrefixes_) {
+    for (auto const& route : *routes) {
+      addedUnicastPrefixes_.emplace_back(*route.dest_ref());
+    }
+  }
   addRoutesCount_ += routes->size();
   updateUnicastRoutesBaton_.post();
 }
@@ -186,6 +191,63 @@ MockNetlinkFibHandler::syncMplsFib(
   syncMplsFibBaton_.post();
 }
 
+void
+MockNetlinkFibHandler::addUnicastRoutesInTables(
+    int16_t,
+    std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+        tableRoutes) {
+  if (not isHealthy_) {
+    throw std::runtime_error("Handler rejects routes since it is unhealthy");
+  }
+  SYNCHRONIZED(tablePrefixes_) {
+    for (auto const& [table, routes] : *tableRoutes) {
+      for (auto const& route : routes) {
+        tablePrefixes_[table].emplace(toIPNetwork(*route.dest_ref()));
+      }
+    }
+  }
+  updateTablesBaton_.post();
+}
+
+void
+MockNetlinkFibHandler::deleteUnicastRoutesInTables(
+    int16_t,
+    std::unique_ptr<std::map<int32_t, std::vector<thrift::IpPrefix>>>
+        tablePrefixes) {
+  if (not isHealthy_) {
+    throw std::runtime_error("Handler rejects routes since it is unhealthy");
+  }
+  SYNCHRONIZED(tablePrefixes_) {
+    for (auto const& [table, prefixes] : *tablePrefixes) {
+      for (auto const& prefix : prefixes) {
+        tablePrefixes_[table].erase(toIPNetwork(prefix));
+      }
+    }
+  }
+  updateTablesBaton_.post();
+}
+
+void
+MockNetlinkFibHandler::syncFibTables(
+    int16_t,
+    std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+        tableRoutes) {
+  if (not isHealthy_) {
+    throw std::runtime_error("Handler rejects routes since it is unhealthy");
+  }
+  SYNCHRONIZED(tablePrefixes_) {
+    tablePrefixes_.clear();
+    for (auto const& [table, routes] : *tableRoutes) {
+      auto& prefixes = tablePrefixes_[table];
+      for (auto const& route : routes) {
+        prefixes.emplace(toIPNetwork(*route.dest_ref()));
+      }
+    }
+  }
+  ++fibTablesSyncCount_;
+  updateTablesBaton_.post();
+}
+
 int64_t
 MockNetlinkFibHandler::aliveSince() {
   int64_t res = 0;
@@ -254,6 +316,12 @@ MockNetlinkFibHandler::waitForSyncFib() {
   syncFibBaton_.reset();
 }
 
+void
+MockNetlinkFibHandler::waitForUpdateTables() {
+  updateTablesBaton_.wait();
+  updateTablesBaton_.reset();
+}
+
 void
 MockNetlinkFibHandler::waitForUpdateMplsRoutes() {
   updateMplsRoutesBaton_.wait();
@@ -277,6 +345,7 @@ MockNetlinkFibHandler::stop() {
   SYNCHRONIZED(unicastRouteDb_) {
     unicastRouteDb_.clear();
   }
+  addedUnicastPrefixes_->clear();
   fibSyncCount_ = 0;
   addRoutesCount_ = 0;
   delRoutesCount_ = 0;
@@ -297,6 +366,7 @@ MockNetlinkFibHandler::restart() {
                      std::chrono::system_clock::now().time_since_epoch())
                      .count();
   }
+  addedUnicastPrefixes_->clear();
   fibSyncCount_ = 0;
   addRoutesCount_ = 0;
   delRoutesCount_ = 0;
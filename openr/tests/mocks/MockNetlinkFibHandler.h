@@ -66,6 +66,22 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
       int16_t clientId,
       std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) override;
 
+  // VRF tables, only keeping prefixes of routes
+  void addUnicastRoutesInTables(
+      int16_t clientId,
+      std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+          tableRoutes) override;
+
+  void deleteUnicastRoutesInTables(
+      int16_t clientId,
+      std::unique_ptr<std::map<int32_t, std::vector<thrift::IpPrefix>>>
+          tablePrefixes) override;
+
+  void syncFibTables(
+      int16_t clientId,
+      std::unique_ptr<std::map<int32_t, std::vector<thrift::UnicastRoute>>>
+          tableRoutes) override;
+
   // Wait for adding/deleting routes to complete
   void waitForUpdateUnicastRoutes();
   void waitForDeleteUnicastRoutes();
@@ -73,6 +89,7 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   void waitForUpdateMplsRoutes();
   void waitForDeleteMplsRoutes();
   void waitForSyncMplsFib();
+  void waitForUpdateTables();
 
   int64_t aliveSince() override;
 
@@ -97,6 +114,12 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   getDelRoutesCount() {
     return delRoutesCount_;
   }
+
+  // destinations of added unicast routes, in order they were added
+  std::vector<thrift::IpPrefix>
+  getAddedUnicastPrefixes() {
+    return *addedUnicastPrefixes_.rlock();
+  }
   size_t
   getFibMplsSyncCount() {
     return fibMplsSyncCount_;
@@ -109,6 +132,19 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   getDelMplsRoutesCount() {
     return delMplsRoutesCount_;
   }
+  size_t
+  getFibTablesSyncCount() {
+    return fibTablesSyncCount_;
+  }
+
+  // prefixes of routes in VRF table
+  std::unordered_set<folly::CIDRNetwork>
+  getTablePrefixes(int32_t table) {
+    auto tables = tablePrefixes_.rlock();
+    auto it = tables->find(table);
+    return it != tables->end() ? it->second
+                               : std::unordered_set<folly::CIDRNetwork>{};
+  }
 
   void
   setHandlerHealthyState(bool isHealthy) {
@@ -126,11 +162,19 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   // Abstract route Db to hide kernel level routing details from Fib
   folly::Synchronized<UnicastRoutes> unicastRouteDb_{};
 
+  // Destinations of added unicast routes, in order
+  folly::Synchronized<std::vector<thrift::IpPrefix>> addedUnicastPrefixes_{};
+
   // Mpls Route db
   folly::Synchronized<
       std::unordered_map<int32_t, std::vector<thrift::NextHopThrift>>>
       mplsRouteDb_;
 
+  // Prefixes of routes in VRF tables
+  folly::Synchronized<
+      std::unordered_map<int32_t, std::unordered_set<folly::CIDRNetwork>>>
+      tablePrefixes_;
+
   // Stats
   std::atomic<size_t> fibSyncCount_{0};
   std::atomic<size_t> addRoutesCount_{0};
@@ -138,6 +182,7 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   std::atomic<size_t> fibMplsSyncCount_{0};
   std::atomic<size_t> addMplsRoutesCount_{0};
   std::atomic<size_t> delMplsRoutesCount_{0};
+  std::atomic<size_t> fibTablesSyncCount_{0};
   std::atomic<bool> isHealthy_{true};
 
   // A baton for synchronization
@@ -147,6 +192,7 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   folly::Baton<> updateMplsRoutesBaton_;
   folly::Baton<> deleteMplsRoutesBaton_;
   folly::Baton<> syncMplsFibBaton_;
+  folly::Baton<> updateTablesBaton_;
 };
 
 } // namespace openr
@@ -59,12 +59,18 @@ MockNetlinkProtocolSocket::MockNetlinkProtocolSocket(folly::EventBase* evb)
 folly::SemiFuture<int>
 MockNetlinkProtocolSocket::addRoute(const fbnl::Route& route) {
   fb303::fbData->addStatValue("nlmock.add_route", 1, fb303::SUM);
+  // Nexthop group route refers to must exist
+  if (route.getNhId().has_value() and
+      not nexthopGroups_.count(route.getNhId().value())) {
+    return folly::SemiFuture<int>(EINVAL);
+  }
   // Blindly replace existing route
   const auto proto = route.getProtocolId();
   if (route.getFamily() == AF_MPLS) {
     mplsRoutes_[proto][route.getMplsLabel().value()] = route;
   } else {
-    unicastRoutes_[proto][route.getDestination()] = route;
+    unicastRoutes_[proto][{route.getRouteTable(), route.getDestination()}] =
+        route;
   }
   return folly::SemiFuture<int>(0);
 }
@@ -78,17 +84,81 @@ MockNetlinkProtocolSocket::deleteRoute(const fbnl::Route& route) {
   if (route.getFamily() == AF_MPLS) {
     cnt = mplsRoutes_[proto].erase(route.getMplsLabel().value());
   } else {
-    cnt = unicastRoutes_[proto].erase(route.getDestination());
+    cnt = unicastRoutes_[proto].erase(
+        {route.getRouteTable(), route.getDestination()});
   }
   // Return 0 on success else ESRCH (no such process) error code
   return folly::SemiFuture<int>(cnt ? 0 : ESRCH);
 }
 
+folly::SemiFuture<int>
+MockNetlinkProtocolSocket::addNexthop(
+    uint32_t id,
+    uint8_t /* protocolId */,
+    uint8_t /* family */,
+    const fbnl::NextHop& nextHop) {
+  nexthops_.insert_or_assign(id, nextHop);
+  return folly::SemiFuture<int>(0);
+}
+
+folly::SemiFuture<int>
+MockNetlinkProtocolSocket::addNexthopGroup(
+    uint32_t id,
+    uint8_t /* protocolId */,
+    const std::vector<fbnl::NexthopGroupMember>& members) {
+  // Members must exist
+  for (const auto& member : members) {
+    if (not nexthops_.count(member.id)) {
+      return folly::SemiFuture<int>(EINVAL);
+    }
+  }
+  nexthopGroups_.insert_or_assign(id, members);
+  return folly::SemiFuture<int>(0);
+}
+
+folly::SemiFuture<int>
+MockNetlinkProtocolSocket::deleteNexthop(uint32_t id) {
+  // Kernel removes deleted nexthop from groups. Mock rejects it instead, to
+  // verify that groups are deleted ahead of their members
+  for (const auto& [_, members] : nexthopGroups_) {
+    for (const auto& member : members) {
+      if (member.id == id) {
+        return folly::SemiFuture<int>(EBUSY);
+      }
+    }
+  }
+  const auto cnt = nexthops_.erase(id) + nexthopGroups_.erase(id);
+  return folly::SemiFuture<int>(cnt ? 0 : ESRCH);
+}
+
+folly::SemiFuture<folly::Unit>
+MockNetlinkProtocolSocket::addRoutes(
+    const std::vector<fbnl::Route>& routes,
+    std::unordered_set<int> ignoredErrors) {
+  std::vector<folly::SemiFuture<int>> futures;
+  for (const auto& route : routes) {
+    futures.emplace_back(addRoute(route));
+  }
+  return collectReturnStatus(std::move(futures), std::move(ignoredErrors));
+}
+
+folly::SemiFuture<folly::Unit>
+MockNetlinkProtocolSocket::deleteRoutes(
+    const std::vector<fbnl::Route>& routes,
+    std::unordered_set<int> ignoredErrors) {
+  std::vector<folly::SemiFuture<int>> futures;
+  for (const auto& route : routes) {
+    futures.emplace_back(deleteRoute(route));
+  }
+  return collectReturnStatus(std::move(futures), std::move(ignoredErrors));
+}
+
 folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>>
 MockNetlinkProtocolSocket::getRoutes(const fbnl::Route& filter) {
   const auto filterFamily = filter.getFamily();
   const auto filterProto = filter.getProtocolId();
   const auto filterType = filter.getType();
+  const auto filterTable = filter.getRouteTable();
 
   std::vector<fbnl::Route> result;
   auto applyFilter = [&](const fbnl::Route& route) {
@@ -107,6 +177,12 @@ MockNetlinkProtocolSocket::getRoutes(const fbnl::Route& filter) {
       return;
     }
 
+    // Filter on table, for unicast routes
+    if (route.getFamily() != AF_MPLS && filterTable &&
+        filterTable != route.getRouteTable()) {
+      return;
+    }
+
     result.emplace_back(route);
   };
 
@@ -127,6 +203,16 @@ MockNetlinkProtocolSocket::getRoutes(const fbnl::Route& filter) {
   return result;
 }
 
+folly::SemiFuture<int>
+MockNetlinkProtocolSocket::streamRoutes(
+    const fbnl::Route& filter, fbnl::RouteCallback callback) {
+  auto routes = getRoutes(filter).get();
+  for (auto& route : routes.value()) {
+    callback(std::move(route));
+  }
+  return folly::SemiFuture<int>(0);
+}
+
 folly::SemiFuture<int>
 MockNetlinkProtocolSocket::addIfAddress(const fbnl::IfAddress& addr) {
   // Search for addr list of interface index (it must exists)
@@ -146,7 +232,7 @@ MockNetlinkProtocolSocket::addIfAddress(const fbnl::IfAddress& addr) {
   it->second.emplace_back(addr); // Add
 
   // Publish update via queue
-  netlinkEventsQueue_.push(addr);
+  publishEvent(addr);
   return folly::SemiFuture<int>(0);
 }
 
@@ -164,7 +250,7 @@ MockNetlinkProtocolSocket::deleteIfAddress(const fbnl::IfAddress& addr) {
       it->second.erase(addrIt);
 
       // Publish update via queue
-      netlinkEventsQueue_.push(addr);
+      publishEvent(addr);
       return folly::SemiFuture<int>(0);
     }
   }
@@ -191,7 +277,7 @@ MockNetlinkProtocolSocket::addLink(const fbnl::Link& link) {
   ifAddrs_.emplace(link.getIfIndex(), std::list<fbnl::IfAddress>());
 
   // Publish update via queue
-  netlinkEventsQueue_.push(link);
+  publishEvent(link);
 
   return folly::SemiFuture<int>(0);
 }
@@ -210,4 +296,19 @@ MockNetlinkProtocolSocket::getAllNeighbors() {
   CHECK(false) << "Not implemented";
 }
 
+void
+MockNetlinkProtocolSocket::dropEvents(bool drop) {
+  if (dropEvents_ and not drop) {
+    netlinkEventsQueue_.push(EventsLost{});
+  }
+  dropEvents_ = drop;
+}
+
+void
+MockNetlinkProtocolSocket::publishEvent(NetlinkEvent&& event) {
+  if (not dropEvents_) {
+    netlinkEventsQueue_.push(std::move(event));
+  }
+}
+
 } // namespace openr::fbnl
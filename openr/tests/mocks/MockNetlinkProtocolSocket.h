@@ -52,8 +52,27 @@ class MockNetlinkProtocolSocket : public NetlinkProtocolSocket {
    */
   folly::SemiFuture<int> addRoute(const fbnl::Route& route) override;
   folly::SemiFuture<int> deleteRoute(const fbnl::Route& route) override;
+  folly::SemiFuture<folly::Unit> addRoutes(
+      const std::vector<fbnl::Route>& routes,
+      std::unordered_set<int> ignoredErrors = {}) override;
+  folly::SemiFuture<folly::Unit> deleteRoutes(
+      const std::vector<fbnl::Route>& routes,
+      std::unordered_set<int> ignoredErrors = {}) override;
   folly::SemiFuture<folly::Expected<std::vector<fbnl::Route>, int>> getRoutes(
       const fbnl::Route& filter) override;
+  folly::SemiFuture<int> streamRoutes(
+      const fbnl::Route& filter, fbnl::RouteCallback callback) override;
+
+  folly::SemiFuture<int> addNexthop(
+      uint32_t id,
+      uint8_t protocolId,
+      uint8_t family,
+      const fbnl::NextHop& nextHop) override;
+  folly::SemiFuture<int> addNexthopGroup(
+      uint32_t id,
+      uint8_t protocolId,
+      const std::vector<fbnl::NexthopGroupMember>& members) override;
+  folly::SemiFuture<int> deleteNexthop(uint32_t id) override;
 
   folly::SemiFuture<int> addIfAddress(const fbnl::IfAddress&) override;
   folly::SemiFuture<int> deleteIfAddress(const fbnl::IfAddress&) override;
@@ -66,6 +85,19 @@ class MockNetlinkProtocolSocket : public NetlinkProtocolSocket {
   folly::SemiFuture<folly::Expected<std::vector<fbnl::Neighbor>, int>>
   getAllNeighbors() override;
 
+  /*
+   * APIs to inspect nexthop objects
+   */
+  size_t
+  getNumNexthops() const {
+    return nexthops_.size();
+  }
+
+  size_t
+  getNumNexthopGroups() const {
+    return nexthopGroups_.size();
+  }
+
   /*
    * API to manipulate netlinkEvents queue
    */
@@ -84,6 +116,10 @@ class MockNetlinkProtocolSocket : public NetlinkProtocolSocket {
     netlinkEventsQueue_.close();
   }
 
+  // Drop LINK/ADDR updates as on receive buffer overrun. Updates are
+  // published again once cleared, preceded by fbnl::EventsLost
+  void dropEvents(bool drop);
+
  protected:
   void
   init() override {
@@ -99,14 +135,25 @@ class MockNetlinkProtocolSocket : public NetlinkProtocolSocket {
   // NOTE: using map for ordered entries
   std::map<int, std::list<fbnl::IfAddress>> ifAddrs_;
 
-  // map<protocolId -> map<prefix/label, Route>
+  // map<protocolId -> map<(table, prefix)/label, Route>
   // NOTE: using map for ordered entries
-  std::unordered_map<uint8_t, std::map<folly::CIDRNetwork, fbnl::Route>>
+  std::unordered_map<
+      uint8_t,
+      std::map<std::pair<uint32_t, folly::CIDRNetwork>, fbnl::Route>>
       unicastRoutes_;
   std::unordered_map<uint8_t, std::map<uint32_t, fbnl::Route>> mplsRoutes_;
 
+  // map<id -> nexthop object>, for single next-hop and group objects
+  std::unordered_map<uint32_t, fbnl::NextHop> nexthops_;
+  std::unordered_map<uint32_t, std::vector<fbnl::NexthopGroupMember>>
+      nexthopGroups_;
+
+  // publish update via queue unless updates are dropped
+  void publishEvent(NetlinkEvent&& event);
+
   // queue to publish LINK/ADDR updates
   messaging::ReplicateQueue<NetlinkEvent> netlinkEventsQueue_;
+  bool dropEvents_{false};
 };
 
 } // namespace openr::fbnl
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/tests/mocks/PrefixChurnGenerator.h>
+
+#include <fmt/format.h>
+
+namespace openr {
+
+void
+PrefixChurnGenerator::IndexSet::insert(uint32_t index) {
+  if (contains(index)) {
+    return;
+  }
+  positions_.at(index) = indices_.size();
+  indices_.emplace_back(index);
+}
+
+void
+PrefixChurnGenerator::IndexSet::erase(uint32_t index) {
+  if (not contains(index)) {
+    return;
+  }
+  // move last index into the slot of the erased one
+  const auto position = positions_.at(index);
+  const auto last = indices_.back();
+  indices_.at(position) = last;
+  positions_.at(last) = position;
+  indices_.pop_back();
+  positions_.at(index) = kNone;
+}
+
+PrefixChurnGenerator::PrefixChurnGenerator(Config const& config)
+    : config_(config),
+      rng_(config.seed),
+      delayDistribution_(
+          config.advertiseRate + config.withdrawRate + config.tagChangeRate +
+          config.metricChangeRate + config.massWithdrawRate),
+      // in order of EventType
+      typeDistribution_({
+          config.advertiseRate,
+          config.withdrawRate,
+          config.tagChangeRate,
+          config.metricChangeRate,
+          config.massWithdrawRate,
+      }),
+      advertised_(config.numPrefixes),
+      withdrawn_(config.numPrefixes) {
+  CHECK_GT(config.numOriginators, 0);
+  CHECK_GT(config.numTags, 0);
+  entries_.reserve(config.numPrefixes);
+  versions_.resize(config.numPrefixes, 1);
+  std::bernoulli_distribution isAdvertised(config.initialAdvertisedShare);
+  for (uint32_t i = 0; i < config.numPrefixes; ++i) {
+    entries_.emplace_back(createEntry(i));
+    if (isAdvertised(rng_)) {
+      advertised_.insert(i);
+    } else {
+      withdrawn_.insert(i);
+    }
+  }
+}
+
+std::string
+PrefixChurnGenerator::getOriginatorName(uint32_t originator) {
+  return std::to_string(originator);
+}
+
+thrift::PrefixEntry
+PrefixChurnGenerator::createEntry(uint32_t index) {
+  auto entry = createPrefixEntryWithMetrics(
+      toIpPrefix(
+          fmt::format("fc00:{:x}:{:x}::/64", index >> 16, index & 0xffff)),
+      config_.type,
+      createMetrics(1000, 100, 1));
+  setRandomTags(entry);
+  return entry;
+}
+
+void
+PrefixChurnGenerator::setRandomTags(thrift::PrefixEntry& entry) {
+  std::uniform_int_distribution<uint32_t> tags(0, config_.numTags - 1);
+  entry.tags_ref()->clear();
+  for (uint32_t i = 0; i < config_.tagsPerPrefix; ++i) {
+    entry.tags_ref()->emplace(fmt::format("tag-{}", tags(rng_)));
+  }
+}
+
+uint32_t
+PrefixChurnGenerator::pickRandom(IndexSet const& set) {
+  std::uniform_int_distribution<size_t> position(0, set.size() - 1);
+  return set.at(position(rng_));
+}
+
+std::vector<thrift::PrefixEntry>
+PrefixChurnGenerator::getAdvertisedEntries(uint32_t originator) const {
+  std::vector<thrift::PrefixEntry> entries;
+  for (uint32_t i = originator; i < config_.numPrefixes;
+       i += config_.numOriginators) {
+    if (advertised_.contains(i)) {
+      entries.emplace_back(entries_.at(i));
+    }
+  }
+  return entries;
+}
+
+PrefixChurnGenerator::Event
+PrefixChurnGenerator::next() {
+  Event event;
+  while (true) {
+    event.delay += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::duration<double>(delayDistribution_(rng_)));
+    event.type = static_cast<EventType>(typeDistribution_(rng_));
+    auto const& candidates =
+        event.type == EventType::ADVERTISE ? withdrawn_ : advertised_;
+    if (candidates.size()) {
+      break;
+    }
+  }
+
+  if (event.type == EventType::MASS_WITHDRAW) {
+    // originators are picked in proportion to their advertised prefixes
+    event.originator = pickRandom(advertised_) % config_.numOriginators;
+    for (uint32_t i = event.originator; i < config_.numPrefixes;
+         i += config_.numOriginators) {
+      if (advertised_.contains(i)) {
+        addToEvent(i, event);
+      }
+    }
+    return event;
+  }
+
+  const auto index = pickRandom(
+      event.type == EventType::ADVERTISE ? withdrawn_ : advertised_);
+  event.originator = index % config_.numOriginators;
+  if (event.type == EventType::TAG_CHANGE) {
+    setRandomTags(entries_.at(index));
+  } else if (event.type == EventType::METRIC_CHANGE) {
+    std::uniform_int_distribution<int32_t> distance(1, 100);
+    entries_.at(index).metrics_ref()->distance_ref() = distance(rng_);
+  }
+  addToEvent(index, event);
+  return event;
+}
+
+void
+PrefixChurnGenerator::addToEvent(uint32_t index, Event& event) {
+  if (event.type == EventType::ADVERTISE) {
+    withdrawn_.erase(index);
+    advertised_.insert(index);
+  } else if (event.isWithdraw()) {
+    advertised_.erase(index);
+    withdrawn_.insert(index);
+  }
+  event.entries.emplace_back(entries_.at(index));
+  event.versions.emplace_back(++versions_.at(index));
+}
+
+std::vector<PrefixChurnGenerator::Event>
+PrefixChurnGenerator::nextFor(std::chrono::microseconds duration) {
+  std::vector<Event> events;
+  std::chrono::microseconds elapsed{0};
+  while (true) {
+    auto event = next();
+    elapsed += event.delay;
+    if (elapsed > duration) {
+      // ATTN: the event is dropped, this only biases the first event of the
+      // next call which is memoryless anyway
+      break;
+    }
+    events.emplace_back(std::move(event));
+  }
+  return events;
+}
+
+PrefixEvent
+PrefixChurnGenerator::toPrefixEvent(Event const& event) {
+  std::optional<thrift::PrefixType> type;
+  if (not event.entries.empty()) {
+    type = *event.entries.front().type_ref();
+  }
+  return PrefixEvent(
+      event.isWithdraw() ? PrefixEventType::WITHDRAW_PREFIXES
+                         : PrefixEventType::ADD_PREFIXES,
+      type,
+      event.entries);
+}
+
+std::vector<std::pair<std::string, thrift::Value>>
+PrefixChurnGenerator::toKeyVals(
+    Event const& event,
+    std::string const& area,
+    std::optional<thrift::PerfEvents> const& perfEvents) {
+  apache::thrift::CompactSerializer serializer;
+  const auto nodeName = getOriginatorName(event.originator);
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < event.entries.size(); ++i) {
+    auto [key, db] = createPrefixKeyAndDb(
+        nodeName, event.entries.at(i), area, event.isWithdraw());
+    db.perfEvents_ref().from_optional(perfEvents);
+    keyVals.emplace_back(
+        key.getPrefixKeyV2(),
+        createThriftValue(
+            event.versions.at(i),
+            nodeName,
+            writeThriftObjStr(std::move(db), serializer)));
+  }
+  return keyVals;
+}
+
+} // namespace openr
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <openr/common/Types.h>
+#include <openr/common/Util.h>
+
+namespace openr {
+
+/**
+ * Generates steady-state prefix churn for benchmarks.
+ *
+ * A fixed universe of prefixes is split among originators, e.g. nodes of a
+ * benchmark topology or BGP peers of a PrefixManager. Independent Poisson
+ * processes advertise withdrawn prefixes, withdraw advertised ones, and
+ * mutate tags and metrics of advertised ones. Mass withdrawals take out all
+ * prefixes of an originator at once, as upon failure of a peer, and its
+ * prefixes come back over time through the advertise process.
+ *
+ * Events are deterministic for a given seed. Helpers convert events into the
+ * input of PrefixManager and of KvStore and Decision, with per prefix keys.
+ */
+class PrefixChurnGenerator {
+ public:
+  struct Config {
+    // prefixes of the universe, fc00:<index>::/64, owned by originators in
+    // round robin
+    uint32_t numPrefixes{1000};
+    uint32_t numOriginators{1};
+
+    // share of the universe advertised initially
+    double initialAdvertisedShare{1.0};
+
+    // events per second of each process
+    double advertiseRate{100};
+    double withdrawRate{100};
+    double tagChangeRate{10};
+    double metricChangeRate{10};
+    double massWithdrawRate{0};
+
+    // tags of an advertised prefix are drawn out of numTags ones
+    uint32_t numTags{16};
+    uint32_t tagsPerPrefix{2};
+
+    thrift::PrefixType type{thrift::PrefixType::BGP};
+    uint64_t seed{0};
+  };
+
+  enum class EventType {
+    ADVERTISE,
+    WITHDRAW,
+    TAG_CHANGE,
+    METRIC_CHANGE,
+    MASS_WITHDRAW,
+  };
+
+  struct Event {
+    // simulated time since the previous event
+    std::chrono::microseconds delay{0};
+    EventType type{EventType::ADVERTISE};
+    uint32_t originator{0};
+    // entries advertised or withdrawn by the event, along with the versions
+    // of their keys. Versions grow with every change of a prefix, so that
+    // KvStore accepts them
+    std::vector<thrift::PrefixEntry> entries;
+    std::vector<int64_t> versions;
+
+    bool
+    isWithdraw() const {
+      return type == EventType::WITHDRAW or type == EventType::MASS_WITHDRAW;
+    }
+  };
+
+  explicit PrefixChurnGenerator(Config const& config);
+
+  // name of originator, as used by toKeyVals()
+  static std::string getOriginatorName(uint32_t originator);
+
+  // entries currently advertised by originator
+  std::vector<thrift::PrefixEntry> getAdvertisedEntries(
+      uint32_t originator) const;
+
+  size_t
+  getNumAdvertised() const {
+    return advertised_.size();
+  }
+
+  // next event of the merged processes. Events of a process without any
+  // prefix to apply to, e.g. withdrawals while all prefixes are withdrawn,
+  // are skipped and their delay is carried over
+  Event next();
+
+  // events occurring over duration of simulated time
+  std::vector<Event> nextFor(std::chrono::microseconds duration);
+
+  // PrefixManager input equivalent to event
+  static PrefixEvent toPrefixEvent(Event const& event);
+
+  // KvStore per prefix key-values of event, perfEvents are attached to prefix
+  // databases if set
+  static std::vector<std::pair<std::string, thrift::Value>> toKeyVals(
+      Event const& event,
+      std::string const& area = kTestingAreaName,
+      std::optional<thrift::PerfEvents> const& perfEvents = std::nullopt);
+
+ private:
+  // Set of prefix indices supporting uniform random picks
+  class IndexSet {
+   public:
+    explicit IndexSet(size_t universe) : positions_(universe, kNone) {}
+
+    void insert(uint32_t index);
+    void erase(uint32_t index);
+
+    bool
+    contains(uint32_t index) const {
+      return positions_.at(index) != kNone;
+    }
+
+    size_t
+    size() const {
+      return indices_.size();
+    }
+
+    uint32_t
+    at(size_t position) const {
+      return indices_.at(position);
+    }
+
+   private:
+    static constexpr size_t kNone = std::numeric_limits<size_t>::max();
+    std::vector<uint32_t> indices_;
+    std::vector<size_t> positions_;
+  };
+
+  thrift::PrefixEntry createEntry(uint32_t index);
+  void setRandomTags(thrift::PrefixEntry& entry);
+  uint32_t pickRandom(IndexSet const& set);
+
+  // move prefix between advertised_ and withdrawn_, adding it to event
+  void addToEvent(uint32_t index, Event& event);
+
+  const Config config_;
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> delayDistribution_;
+  std::discrete_distribution<int> typeDistribution_;
+
+  // by prefix index, the entry last advertised and its key version
+  std::vector<thrift::PrefixEntry> entries_;
+  std::vector<int64_t> versions_;
+  IndexSet advertised_;
+  IndexSet withdrawn_;
+};
+
+} // namespace openr
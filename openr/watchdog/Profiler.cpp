@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <folly/Demangle.h>
+#include <folly/experimental/symbolizer/StackTrace.h>
+#include <folly/experimental/symbolizer/Symbolizer.h>
+#include <glog/logging.h>
+
+#include <openr/watchdog/Profiler.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace openr {
+
+namespace {
+
+enum SampleState : int { kFree = 0, kWriting = 1, kReady = 2 };
+
+// index of the calling thread in Profiler::threads_, -1 unless registered.
+// Plain int, read from the signal handler
+thread_local int64_t profilerThread{-1};
+
+} // namespace
+
+Profiler&
+Profiler::get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() {
+  struct sigaction action {};
+  action.sa_sigaction = &Profiler::handleSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  PCHECK(sigaction(SIGPROF, &action, nullptr) == 0);
+}
+
+void
+Profiler::registerThread(std::string const& name) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (profilerThread >= 0) {
+    return;
+  }
+
+  // signal the thread every interval of its CPU time
+  struct sigevent event {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = static_cast<pid_t>(::syscall(SYS_gettid));
+  ThreadTimer thread{name, {}};
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &thread.timerId) != 0) {
+    PLOG(ERROR) << "Failed to create profiler timer of thread " << name;
+    return;
+  }
+  profilerThread = threads_.size();
+  threads_.emplace_back(std::move(thread));
+}
+
+void
+Profiler::start(std::chrono::seconds duration, uint32_t frequencyHz) {
+  if (frequencyHz == 0 or frequencyHz > kMaxFrequencyHz) {
+    throw std::invalid_argument(fmt::format(
+        "Profiler frequency should be in [1, {}] Hz", kMaxFrequencyHz));
+  }
+  if (duration.count() <= 0 or duration > kMaxDuration) {
+    throw std::invalid_argument(fmt::format(
+        "Profiler duration should be in [1, {}] seconds",
+        kMaxDuration.count()));
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  armTimers(std::chrono::nanoseconds(0));
+  for (auto& sample : samples_) {
+    sample.state.store(kFree, std::memory_order_relaxed);
+  }
+  stacks_.clear();
+  numDroppedSamples_ = 0;
+  stopTime_ = std::chrono::steady_clock::now() + duration;
+  running_ = true;
+  armTimers(std::chrono::nanoseconds(std::chrono::seconds(1)) / frequencyHz);
+  LOG(INFO) << "Started profiler of " << threads_.size() << " threads for "
+            << duration.count() << "s at " << frequencyHz << "Hz";
+}
+
+void
+Profiler::stop() {
+  std::lock_guard<std::mutex> l(mutex_);
+  armTimers(std::chrono::nanoseconds(0));
+  running_ = false;
+  stopTime_ = std::nullopt;
+}
+
+bool
+Profiler::isRunning() const {
+  return running_.load();
+}
+
+void
+Profiler::armTimers(std::chrono::nanoseconds interval) {
+  // a zero interval disarms the timers
+  struct itimerspec spec {};
+  spec.it_interval.tv_sec = interval.count() / 1000000000;
+  spec.it_interval.tv_nsec = interval.count() % 1000000000;
+  spec.it_value = spec.it_interval;
+  for (auto const& thread : threads_) {
+    // fails for threads which exited meanwhile, the others are sampled
+    if (timer_settime(thread.timerId, 0, &spec, nullptr) != 0) {
+      PLOG(ERROR) << "Failed to set profiler timer of thread " << thread.name;
+    }
+  }
+}
+
+// static
+void
+Profiler::handleSignal(int /* signum */, siginfo_t* /* info */, void*) {
+  // async-signal-safe from here on: no locks, no allocations
+  const auto savedErrno = errno;
+  if (profilerThread >= 0) {
+    get().recordSample(profilerThread);
+  }
+  errno = savedErrno;
+}
+
+void
+Profiler::recordSample(uint32_t thread) {
+  if (not running_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto& sample =
+      samples_[nextSample_.fetch_add(1, std::memory_order_relaxed) %
+               kMaxPendingSamples];
+  int expected = kFree;
+  if (not sample.state.compare_exchange_strong(
+          expected, kWriting, std::memory_order_acquire)) {
+    numDroppedSamples_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const auto depth = folly::symbolizer::getStackTraceSafe(
+      sample.frames.data(), sample.frames.size());
+  if (depth <= 0) {
+    sample.state.store(kFree, std::memory_order_release);
+    numDroppedSamples_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  sample.thread = thread;
+  sample.depth = depth;
+  sample.state.store(kReady, std::memory_order_release);
+}
+
+void
+Profiler::drain() {
+  std::lock_guard<std::mutex> l(mutex_);
+  for (auto& sample : samples_) {
+    if (sample.state.load(std::memory_order_acquire) != kReady) {
+      continue;
+    }
+    // skip the frames of the signal handler
+    const size_t skip = std::min<size_t>(sample.depth, 3);
+    std::vector<uintptr_t> frames(
+        sample.frames.begin() + skip, sample.frames.begin() + sample.depth);
+    ++stacks_[{sample.thread, std::move(frames)}];
+    sample.state.store(kFree, std::memory_order_release);
+  }
+
+  if (stopTime_ and std::chrono::steady_clock::now() >= *stopTime_) {
+    armTimers(std::chrono::nanoseconds(0));
+    running_ = false;
+    stopTime_ = std::nullopt;
+    LOG(INFO) << "Profiler run is over";
+  }
+}
+
+std::string
+Profiler::getFoldedStacks() {
+  drain();
+
+  std::lock_guard<std::mutex> l(mutex_);
+  folly::symbolizer::Symbolizer symbolizer(
+      folly::symbolizer::LocationInfoMode::DISABLED);
+  std::map<uintptr_t, std::string> names;
+  std::string result;
+  for (auto const& [key, count] : stacks_) {
+    auto const& [thread, frames] = key;
+    std::string line = threads_.at(thread).name;
+    // outermost frame first
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+      auto nameIt = names.find(*it);
+      if (nameIt == names.end()) {
+        folly::symbolizer::SymbolizedFrame frame;
+        symbolizer.symbolize(&*it, &frame, 1);
+        nameIt = names
+                     .emplace(
+                         *it,
+                         frame.found and frame.name
+                             ? folly::demangle(frame.name).toStdString()
+                             : fmt::format("{:#x}", *it))
+                     .first;
+      }
+      line += ";" + nameIt->second;
+    }
+    result += fmt::format("{} {}\n", line, count);
+  }
+  return result;
+}
+
+} // namespace openr
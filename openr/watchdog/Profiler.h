@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <time.h>
+
+namespace openr {
+
+/**
+ * Sampling profiler of the registered threads, for convergence issues which
+ * can't be caught with an external profiler.
+ *
+ * While running, each registered thread gets SIGPROF every 1/frequency of
+ * the CPU time it consumes. The signal handler records the stack of the
+ * thread into a fixed ring of samples, dropping samples if the ring is full.
+ * The samples are drained periodically, by Watchdog, and aggregated by
+ * stack. getFoldedStacks() renders them as folded stacks, the input of
+ * flame graph tools:
+ *    <thread>;<outermost frame>;...;<innermost frame> <count>
+ *
+ * Overhead is bounded by the max frequency and duration of a run, and idle
+ * threads are not sampled. There is a single profiler per process, as the
+ * signal handler is.
+ */
+class Profiler {
+ public:
+  // max frames of a sampled stack
+  static constexpr size_t kMaxFrames{48};
+
+  // samples which can be pending between two drains
+  static constexpr size_t kMaxPendingSamples{4096};
+
+  // bounds of a run
+  static constexpr uint32_t kMaxFrequencyHz{1000};
+  static constexpr std::chrono::seconds kMaxDuration{600};
+
+  static Profiler& get();
+
+  // register the calling thread to be sampled under given name
+  void registerThread(std::string const& name);
+
+  // start sampling registered threads for duration. Restarts a running
+  // profile, dropping its samples. Throws std::invalid_argument if out of
+  // bounds
+  void start(std::chrono::seconds duration, uint32_t frequencyHz);
+
+  void stop();
+
+  bool isRunning() const;
+
+  // aggregate pending samples, and stop once the run is over
+  void drain();
+
+  // aggregated samples of the current or last run, as folded stacks
+  std::string getFoldedStacks();
+
+  // samples dropped as the ring was full, or the stack couldn't be walked
+  uint64_t
+  getNumDroppedSamples() const {
+    return numDroppedSamples_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  Profiler();
+
+  struct Sample {
+    // kFree -> kWriting by the signal handler -> kReady -> kFree by drain
+    std::atomic<int> state{0};
+    uint32_t thread{0};
+    size_t depth{0};
+    std::array<uintptr_t, kMaxFrames> frames;
+  };
+
+  struct ThreadTimer {
+    std::string name;
+    timer_t timerId;
+  };
+
+  static void handleSignal(int signum, siginfo_t* info, void* context);
+
+  void recordSample(uint32_t thread);
+
+  void armTimers(std::chrono::nanoseconds interval);
+
+  // serializes the API, the signal handler doesn't take it
+  std::mutex mutex_;
+
+  std::vector<ThreadTimer> threads_;
+
+  std::array<Sample, kMaxPendingSamples> samples_;
+  std::atomic<size_t> nextSample_{0};
+  std::atomic<uint64_t> numDroppedSamples_{0};
+  std::atomic<bool> running_{false};
+
+  std::optional<std::chrono::steady_clock::time_point> stopTime_;
+
+  // sample count by thread and stack
+  std::map<std::pair<uint32_t, std::vector<uintptr_t>>, uint64_t> stacks_;
+};
+
+} // namespace openr
@@ -9,10 +9,16 @@
 
 #include <openr/common/Constants.h>
 #include <openr/common/Util.h>
+#include <openr/watchdog/Profiler.h>
 #include <openr/watchdog/Watchdog.h>
 
 namespace fb303 = facebook::fb303;
 
+namespace {
+// counters of the memory accounted for by modules
+const std::string kModuleMemCounterRegex{"^[a-z_]+\\.memory\\.[a-z_]+_bytes$"};
+} // namespace
+
 namespace openr {
 
 Watchdog::Watchdog(std::shared_ptr<const Config> config)
@@ -20,13 +26,15 @@ Watchdog::Watchdog(std::shared_ptr<const Config> config)
       interval_(*config->getWatchdogConfig().interval_s_ref()),
       threadTimeout_(*config->getWatchdogConfig().thread_timeout_s_ref()),
       maxMemoryMB_(*config->getWatchdogConfig().max_memory_mb_ref()),
-      isDeadThreadDetected_(false) {
+      isDeadThreadDetected_(false),
+      enableProfiler_(*config->getWatchdogConfig().enable_profiler_ref()) {
   // Schedule periodic timer for checking thread health
   watchdogTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
     // check dead thread
     monitorThreadStatus();
 
-    // check overall memory usage
+    // check overall memory usage, along with the share of each module
+    updateModuleMemoryCounters();
     monitorMemory();
 
     // collect evb specific counters
@@ -36,6 +44,17 @@ Watchdog::Watchdog(std::shared_ptr<const Config> config)
     watchdogTimer_->scheduleTimeout(interval_);
   });
   watchdogTimer_->scheduleTimeout(interval_);
+
+  // Aggregate samples of a running profiler before its buffer fills up
+  if (enableProfiler_) {
+    profilerTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+      if (Profiler::get().isRunning()) {
+        Profiler::get().drain();
+      }
+      profilerTimer_->scheduleTimeout(Constants::kProfilerDrainInterval);
+    });
+    profilerTimer_->scheduleTimeout(Constants::kProfilerDrainInterval);
+  }
 }
 
 void
@@ -45,6 +64,10 @@ Watchdog::addEvb(OpenrEventBase* evb) {
     CHECK_EQ(monitorEvbs_.count(evb), 0);
     monitorEvbs_.emplace(evb);
   });
+  if (enableProfiler_) {
+    evb->runInEventBaseThread(
+        [name = evb->getEvbName()]() { Profiler::get().registerThread(name); });
+  }
 }
 
 bool
@@ -66,6 +89,12 @@ Watchdog::monitorMemory() {
         "[Mem Detector] Critical memory usage: {} bytes. Memory limit: {} MB.",
         memInUse_.value(),
         maxMemoryMB_);
+    for (auto const& [module, bytes] : moduleMemBytes_) {
+      LOG(WARNING) << fmt::format(
+          "[Mem Detector] Memory accounted for by {}: {} bytes.",
+          module,
+          bytes);
+    }
     if (not memExceedTime_.has_value()) {
       memExceedTime_ = std::chrono::steady_clock::now();
       return;
@@ -137,6 +166,13 @@ Watchdog::updateThreadCounters() {
 
       fb303::fbData->setCounter(
           fmt::format("watchdog.thread_mem_usage_kb.{}", name), diff);
+
+      // CPU time consumed by the thread, rate of it gives utilization
+      fb303::fbData->setCounter(
+          fmt::format("watchdog.thread_cpu_time_ms.{}", name),
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              threading::getThreadCpuTime())
+              .count());
     });
 
     // Record eventbase's notification queue size to support memory check
@@ -146,6 +182,22 @@ Watchdog::updateThreadCounters() {
   }
 }
 
+void
+Watchdog::updateModuleMemoryCounters() {
+  std::map<std::string, int64_t> memCounters;
+  fb303::fbData->getRegexCounters(memCounters, kModuleMemCounterRegex);
+
+  std::map<std::string, int64_t> moduleMemBytes;
+  for (auto const& [name, bytes] : memCounters) {
+    moduleMemBytes[name.substr(0, name.find('.'))] += bytes;
+  }
+  for (auto const& [module, bytes] : moduleMemBytes) {
+    fb303::fbData->setCounter(
+        fmt::format("watchdog.module_mem_usage_kb.{}", module), bytes / 1024);
+  }
+  moduleMemBytes_ = std::move(moduleMemBytes);
+}
+
 void
 Watchdog::fireCrash(const std::string& msg) {
   SYSLOG(ERROR) << msg;
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <map>
+
 #include <folly/io/async/AsyncTimeout.h>
 
 #include <openr/common/Constants.h>
@@ -16,6 +18,15 @@
 
 namespace openr {
 
+/**
+ * Watchdog monitors the threads of the registered event bases and the memory
+ * of the process.
+ *
+ * Modules account for the approximate memory of their state by exporting
+ * counters `<module>.memory.<component>_bytes`. Watchdog sums them up per
+ * module into `watchdog.module_mem_usage_kb.<module>` and logs the
+ * breakdown when the memory limit is exceeded.
+ */
 class Watchdog final : public OpenrEventBase {
  public:
   explicit Watchdog(std::shared_ptr<const Config> config);
@@ -38,6 +49,9 @@ class Watchdog final : public OpenrEventBase {
   // update per-eventbase related counters
   void updateThreadCounters();
 
+  // sum up memory accounted for by modules
+  void updateModuleMemoryCounters();
+
   // force to abort, aka, crash process
   void fireCrash(const std::string& msg);
 
@@ -49,6 +63,9 @@ class Watchdog final : public OpenrEventBase {
   // Timer for checking aliveness periodically
   std::unique_ptr<folly::AsyncTimeout> watchdogTimer_{nullptr};
 
+  // Timer to aggregate samples of the profiler, if enabled
+  std::unique_ptr<folly::AsyncTimeout> profilerTimer_{nullptr};
+
   // Eventbase raw pointers
   std::unordered_set<OpenrEventBase*> monitorEvbs_;
 
@@ -64,6 +81,12 @@ class Watchdog final : public OpenrEventBase {
   // boolean to indicate previous failure
   bool isDeadThreadDetected_{false};
 
+  // whether threads of monitored evbs are registered to the profiler
+  const bool enableProfiler_{false};
+
+  // approximate bytes held by each module, see updateModuleMemoryCounters()
+  std::map<std::string /* module */, int64_t> moduleMemBytes_;
+
   // amount of time memory usage sustained above memory limit
   std::optional<std::chrono::steady_clock::time_point> memExceedTime_;
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <gtest/gtest.h>
+
+#include <openr/watchdog/Profiler.h>
+
+using namespace openr;
+
+namespace {
+
+// burn CPU time of the calling thread for at least duration
+void
+spin(std::chrono::milliseconds duration) {
+  const auto start = std::chrono::steady_clock::now();
+  volatile uint64_t sum{0};
+  while (std::chrono::steady_clock::now() - start < duration) {
+    for (int i = 0; i < 1000; ++i) {
+      sum = sum + i;
+    }
+  }
+}
+
+} // namespace
+
+TEST(ProfilerTest, InvalidParams) {
+  auto& profiler = Profiler::get();
+  EXPECT_THROW(
+      profiler.start(std::chrono::seconds(1), 0), std::invalid_argument);
+  EXPECT_THROW(
+      profiler.start(std::chrono::seconds(1), Profiler::kMaxFrequencyHz + 1),
+      std::invalid_argument);
+  EXPECT_THROW(
+      profiler.start(std::chrono::seconds(0), 100), std::invalid_argument);
+  EXPECT_THROW(
+      profiler.start(Profiler::kMaxDuration + std::chrono::seconds(1), 100),
+      std::invalid_argument);
+  EXPECT_FALSE(profiler.isRunning());
+}
+
+TEST(ProfilerTest, FoldedStacks) {
+  auto& profiler = Profiler::get();
+  std::thread worker([&]() {
+    profiler.registerThread("worker");
+    profiler.start(std::chrono::seconds(1), 1000);
+    spin(std::chrono::milliseconds(500));
+  });
+  worker.join();
+  EXPECT_TRUE(profiler.isRunning());
+
+  // one line per stack of the worker: `worker;...;frame count`
+  const auto stacks = profiler.getFoldedStacks();
+  std::vector<std::string> lines;
+  folly::split('\n', stacks, lines, true /* ignoreEmpty */);
+  ASSERT_FALSE(lines.empty());
+  uint64_t numSamples{0};
+  for (auto const& line : lines) {
+    EXPECT_EQ(0, line.find("worker;"));
+    auto countPos = line.rfind(' ');
+    ASSERT_NE(std::string::npos, countPos);
+    numSamples += folly::to<uint64_t>(line.substr(countPos + 1));
+  }
+  EXPECT_GT(numSamples, 0);
+
+  // run is over once its duration passed
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  profiler.drain();
+  EXPECT_FALSE(profiler.isRunning());
+  profiler.stop();
+}
+
+int
+main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  return RUN_ALL_TESTS();
+}
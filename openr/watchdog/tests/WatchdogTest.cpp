@@ -106,6 +106,22 @@ TEST_F(WatchdogTestFixture, CounterReport) {
   dummyThread->join();
 }
 
+TEST_F(WatchdogTestFixture, ModuleMemoryCounters) {
+  fb303::fbData->resetAllData();
+  fb303::fbData->setCounter("dummy.memory.keys_bytes", 2048);
+  fb303::fbData->setCounter("dummy.memory.values_bytes", 1024);
+  fb303::fbData->setCounter("dummy.memory.not_accounted", 4096);
+
+  OpenrEventBase evb;
+  evb.scheduleTimeout(
+      std::chrono::seconds(1 + kWatchdogInterval.count()), [&]() {
+        auto counters = fb303::fbData->getCounters();
+        EXPECT_EQ(3, counters["watchdog.module_mem_usage_kb.dummy"]);
+        evb.stop();
+      });
+  evb.run();
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags